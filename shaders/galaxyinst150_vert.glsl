@@ -0,0 +1,35 @@
+in vec4 in_Position;
+in float in_Size;
+in float in_ColorIndex;
+in float in_Brightness;
+
+// Per-galaxy attributes: the columns of the model matrix and
+// x: size, y: brightness, z: minimum feature size, w: number of blobs
+in vec4 in_Model0;
+in vec4 in_Model1;
+in vec4 in_Model2;
+in vec4 in_Model3;
+in vec4 in_InstanceParams;
+
+uniform sampler2D colorTex;
+
+out Vertex
+{
+    vec3  color;
+    float size;
+    float brightness;
+    float minimumFeatureSize;
+} vertex;
+
+void main()
+{
+    mat4 m = mat4(in_Model0, in_Model1, in_Model2, in_Model3);
+    gl_Position = m * in_Position;
+    vertex.size = in_InstanceParams.x * in_Size;
+    vertex.brightness = in_InstanceParams.y * in_Brightness;
+    vertex.color = texture(colorTex, vec2(in_ColorIndex, 0.0)).rgb;
+
+    // Galaxies in a batch share the blob count of the largest one, so drop
+    // the blobs beyond this galaxy's level of detail
+    vertex.minimumFeatureSize = float(gl_VertexID) < in_InstanceParams.w ? in_InstanceParams.z : 3.4e38;
+}
@@ -0,0 +1,9 @@
+uniform sampler2D starTex;
+in vec4 color;
+
+out vec4 v_FragColor;
+
+void main(void)
+{
+    v_FragColor = vec4(color.rgb, color.a * texture(starTex, gl_PointCoord.xy).r);
+}
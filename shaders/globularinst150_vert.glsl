@@ -0,0 +1,52 @@
+in vec3 in_Position;
+in vec3 in_TexCoord0; // reuse it for starSize, relStarDensity and colorIndex
+
+// Per-globular attributes: the offset and tidal size, the columns of the
+// orientation matrix scaled by the tidal size, and x: brightness,
+// y: pixel weight, z: sprite scale, w: index of the last sprite + 1
+in vec4 in_Offset;
+in vec3 in_Model0;
+in vec3 in_Model1;
+in vec3 in_Model2;
+in vec4 in_InstanceParams;
+
+uniform sampler2D colorTex;
+
+const float clipDistance = 100.0; // observer distance [ly] from globular, where we
+                                  // start "morphing" the star-sprite sizes towards
+                                  // their physical values
+
+out vec4 color;
+
+void main(void)
+{
+    if (float(gl_VertexID) >= in_InstanceParams.w)
+    {
+        // Outside of the clip volume
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 0.0;
+        color = vec4(0.0);
+        return;
+    }
+
+    float starSize = in_TexCoord0.s;
+    float relStarDensity = in_TexCoord0.t;
+    float colorIndex = in_TexCoord0.p;
+
+    float brightness = in_InstanceParams.x;
+    float pixelWeight = in_InstanceParams.y;
+    float scale = in_InstanceParams.z;
+
+    vec3 p = mat3(in_Model0, in_Model1, in_Model2) * in_Position.xyz;
+    float br = 2.0 * brightness;
+
+    float s = br * starSize * scale;
+
+    // "Morph" the star-sprite sizes at close observer distance such that
+    // the overdense globular core is dissolved upon closing in.
+    float obsDistanceToStarRatio = length(p + in_Offset.xyz) / clipDistance;
+    gl_PointSize = s * min(obsDistanceToStarRatio, 1.0);
+
+    color = vec4(texture(colorTex, vec2(colorIndex, 0.0)).rgb, min(1.0, br * (1.0 - pixelWeight * relStarDensity)));
+    set_vp(vec4(p + in_Offset.xyz, 1.0));
+}
@@ -0,0 +1,14 @@
+uniform vec2 timeWindow;
+
+in vec4 v_Color;
+in float v_Time;
+
+out vec4 v_FragColor;
+
+void main(void)
+{
+    // Segments partly outside of the time interval are clipped here
+    if (v_Time < timeWindow.x || v_Time > timeWindow.y)
+        discard;
+    v_FragColor = v_Color;
+}
@@ -0,0 +1,44 @@
+// Start of the segment: position and time, and velocity
+in vec4 in_Position;
+in vec4 in_StartVelocity;
+// End of the segment
+in vec4 in_End;
+in vec4 in_EndVelocity;
+
+uniform float subdivisions;
+uniform vec4 color;
+// Start and end of the time interval to draw
+uniform vec2 timeWindow;
+// Time of full transparency and fade rate, zero if not fading
+uniform vec2 fade;
+
+out vec4 v_Color;
+out float v_Time;
+
+void main(void)
+{
+    float t0 = in_Position.w;
+    float t1 = in_End.w;
+    if (t1 < timeWindow.x || t0 > timeWindow.y)
+    {
+        // Outside of the clip volume
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        v_Color = vec4(0.0);
+        v_Time = t0;
+        return;
+    }
+
+    // Evaluate the cubic Hermite curve through the end points
+    float dt = t1 - t0;
+    float s = float(gl_VertexID) / subdivisions;
+    vec3 p0 = in_Position.xyz;
+    vec3 p1 = in_End.xyz;
+    vec3 v0 = in_StartVelocity.xyz * dt;
+    vec3 v1 = in_EndVelocity.xyz * dt;
+    vec3 p = p0 + s * (v0 + s * ((3.0 * (p1 - p0) - (2.0 * v0 + v1)) + s * (2.0 * (p0 - p1) + (v1 + v0))));
+
+    v_Time = t0 + s * dt;
+    float opacity = fade.y == 0.0 ? 1.0 : clamp((v_Time - fade.x) * fade.y, 0.0, 1.0);
+    v_Color = vec4(color.rgb, color.a * opacity);
+    set_vp(vec4(p, 1.0));
+}
@@ -0,0 +1,40 @@
+uniform vec4 color;
+// Angles between the parallels and between the meridians, in radians
+uniform float parallelStep;
+uniform float meridianStep;
+// Meridians end at this latitude, in radians
+uniform float maxMeridianLatitude;
+
+varying vec3 position;
+varying float pixelAngle;
+
+const float HalfPi = 1.57079632679;
+
+// Opacity of a line about one pixel wide at an angle from its center
+float coverage(float angle)
+{
+    return clamp(1.0 - angle / pixelAngle, 0.0, 1.0);
+}
+
+void main(void)
+{
+    vec3 dir = normalize(position);
+    float latitude = asin(clamp(dir.y, -1.0, 1.0));
+    float alpha = 0.0;
+
+    // The poles are marked by crosses instead
+    float parallel = parallelStep * floor(latitude / parallelStep + 0.5);
+    if (abs(parallel) < HalfPi - 0.5 * parallelStep)
+        alpha = coverage(abs(latitude - parallel));
+
+    if (abs(latitude) <= maxMeridianLatitude)
+    {
+        float longitude = atan(-dir.z, dir.x);
+        float meridian = meridianStep * floor(longitude / meridianStep + 0.5);
+        alpha = max(alpha, coverage(abs(longitude - meridian) * cos(latitude)));
+    }
+
+    if (alpha <= 0.0)
+        discard;
+    gl_FragColor = vec4(color.rgb, color.a * alpha);
+}
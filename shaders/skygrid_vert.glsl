@@ -0,0 +1,26 @@
+attribute vec3 in_Position;
+
+uniform vec2 viewportSize;
+
+varying vec3 position;
+varying float pixelAngle;
+
+// Angle by which the vertex is displaced to measure the size of a pixel
+const float Delta = 0.001;
+
+void main(void)
+{
+    position = in_Position;
+
+    // Angle covered by a pixel at the vertex, from the projected positions
+    // of the vertex and of a point Delta radians away from it; this works
+    // for any projection.
+    vec3 axis = abs(in_Position.y) < 0.9 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(in_Position, axis));
+    vec4 p0 = calc_vp(vec4(in_Position, 1.0));
+    vec4 p1 = calc_vp(vec4(in_Position + tangent * Delta, 1.0));
+    vec2 d = (p1.xy / max(p1.w, 1.0e-6) - p0.xy / max(p0.w, 1.0e-6)) * 0.5 * viewportSize;
+    pixelAngle = Delta / max(length(d), 1.0e-6);
+
+    gl_Position = p0;
+}
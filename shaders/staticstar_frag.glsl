@@ -0,0 +1,11 @@
+uniform sampler2D starTex;
+uniform bool useTexture;
+varying vec4 color;
+
+void main(void)
+{
+    if (useTexture)
+        gl_FragColor = texture2D(starTex, gl_PointCoord) * color;
+    else
+        gl_FragColor = color;
+}
@@ -0,0 +1,107 @@
+attribute vec3 in_Position;
+attribute vec4 in_Color;
+// x: absolute magnitude, y: extinction per light year
+attribute vec2 in_TexCoord0;
+// Catalog index plus one, low byte in red; only read by the id pass
+attribute vec4 in_TexCoord1;
+
+uniform vec3 observerHigh;
+uniform vec3 observerLow;
+uniform float faintestMag;
+uniform float limitingMag;
+uniform float brightnessScale;
+uniform float brightnessBias;
+uniform float satPoint;
+uniform float baseSize;
+uniform float pointScale;
+uniform float minDistance;
+uniform float maxDistance;
+// 0: glare sprites, 1: star sprites, 2: fixed size points, 3: star ids
+uniform int pass;
+uniform bool scaledDiscs;
+
+varying vec4 color;
+
+const float LOG10_2 = 0.30102999566;
+const float LY_PER_PARSEC = 3.26156377716743;
+const float MaxScaledDiscStarSize = 8.0;
+const float GlareOpacity = 0.65;
+const float MinPickSize = 3.0;
+// Apparent magnitude mapped to the near plane by the id pass
+const float BrightestPickMag = -30.0;
+
+void hide()
+{
+    // Outside of the clip volume
+    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    gl_PointSize = 0.0;
+    color = vec4(0.0);
+}
+
+void main(void)
+{
+    // Subtract the observer position in two parts to keep the precision of
+    // the double precision position used for the streamed stars.
+    vec3 relPos = (in_Position - observerHigh) - observerLow;
+    float dist = length(relPos);
+    float appMag = in_TexCoord0.x + 5.0 * LOG10_2 * log2(dist / LY_PER_PARSEC) - 5.0 + in_TexCoord0.y * dist;
+
+    // Nearby stars are drawn by the renderer from the render list
+    if (dist <= minDistance || dist > maxDistance || appMag > limitingMag)
+    {
+        hide();
+        return;
+    }
+
+    // Same as Renderer::calculatePointSize
+    float alpha = max(0.0, (faintestMag - appMag) * brightnessScale + brightnessBias);
+    float discSize = baseSize;
+    float glareSize = 0.0;
+    float glareAlpha = 0.0;
+    if (alpha > 1.0)
+    {
+        if (scaledDiscs)
+        {
+            float discScale = min(MaxScaledDiscStarSize, pow(2.0, 0.3 * (satPoint - appMag)));
+            discSize *= max(1.0, discScale);
+            glareAlpha = min(0.5, discScale / 4.0);
+            glareSize = discSize * 3.0;
+        }
+        else
+        {
+            float discScale = min(100.0, satPoint - appMag + 2.0);
+            glareAlpha = min(GlareOpacity, (discScale - 2.0) / 4.0);
+            glareSize = 2.0 * discScale * baseSize;
+        }
+        alpha = 1.0;
+    }
+
+    if (pass == 3)
+    {
+        // Brighter stars are kept in front of the fainter ones by the
+        // depth test
+        gl_PointSize = max(discSize, MinPickSize);
+        color = vec4(in_TexCoord1.rgb, 1.0);
+        set_vp(vec4(relPos, 1.0));
+        float depth = 2.0 * (appMag - BrightestPickMag) / (limitingMag - BrightestPickMag) - 1.0;
+        gl_Position.z = clamp(depth, -1.0, 1.0) * gl_Position.w;
+        return;
+    }
+
+    if (pass == 0)
+    {
+        if (glareSize == 0.0)
+        {
+            hide();
+            return;
+        }
+        gl_PointSize = glareSize;
+        color = vec4(in_Color.rgb, glareAlpha);
+    }
+    else
+    {
+        gl_PointSize = pass == 1 ? discSize : pointScale;
+        color = vec4(in_Color.rgb, alpha);
+    }
+    set_vp(vec4(relPos, 1.0));
+}
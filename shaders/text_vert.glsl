@@ -1,4 +1,4 @@
-attribute vec2 in_Position;
+attribute vec3 in_Position;
 attribute vec2 in_TexCoord0;
 attribute vec4 in_Color;
 
@@ -7,7 +7,7 @@ varying vec4 color;
 
 void main(void)
 {
-    gl_Position = MVPMatrix * vec4(in_Position.xy, 0, 1);
+    gl_Position = MVPMatrix * vec4(in_Position, 1.0);
     texCoord = in_TexCoord0.st;
     color = in_Color;
 }
@@ -0,0 +1,13 @@
+varying vec2 texCoord;
+varying vec4 color;
+
+uniform sampler2D atlasTex;
+uniform float sdfSmoothing;
+
+void main(void)
+{
+    // The outline is at 0.5, inside is above
+    float dist = texture2D(atlasTex, texCoord).r;
+    float alpha = smoothstep(0.5 - sdfSmoothing, 0.5 + sdfSmoothing, dist);
+    gl_FragColor = vec4(color.rgb, alpha * color.a);
+}
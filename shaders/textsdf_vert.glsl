@@ -0,0 +1,13 @@
+attribute vec3 in_Position;
+attribute vec2 in_TexCoord0;
+attribute vec4 in_Color;
+
+varying vec2 texCoord;
+varying vec4 color;
+
+void main(void)
+{
+    gl_Position = MVPMatrix * vec4(in_Position, 1.0);
+    texCoord = in_TexCoord0.st;
+    color = in_Color;
+}
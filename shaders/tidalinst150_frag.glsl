@@ -0,0 +1,11 @@
+uniform sampler2D tidalTex;
+
+in vec2 texCoord;
+in vec4 color;
+
+out vec4 v_FragColor;
+
+void main(void)
+{
+    v_FragColor = vec4(color.rgb, color.a * texture(tidalTex, texCoord).r);
+}
@@ -0,0 +1,25 @@
+in vec3 in_Position;
+in vec3 in_TexCoord0; // reuse [3] as colorIndex
+
+// Per-globular attributes, see globularinst150_vert.glsl
+in vec4 in_Offset;
+in vec4 in_InstanceParams;
+
+uniform sampler2D colorTex;
+uniform mat3 viewMat;
+
+out vec2 texCoord;
+out vec4 color;
+
+void main(void)
+{
+    float tidalSize = in_Offset.w;
+    float brightness = in_InstanceParams.x;
+    float pixelWeight = in_InstanceParams.y;
+
+    vec3 p = viewMat * in_Position.xyz * tidalSize;
+    texCoord = in_TexCoord0.st;
+    float colorIndex = in_TexCoord0.p;
+    color = vec4(texture(colorTex, vec2(colorIndex, 0.0)).rgb, min(1.0, 2.0 * brightness * pixelWeight));
+    set_vp(vec4(p + in_Offset.xyz, 1.0));
+}
@@ -131,9 +131,9 @@ M3DTriangleMesh::getVertexCount() const
 }
 
 void
-M3DTriangleMesh::addVertex(const Eigen::Vector3f& p)
+M3DTriangleMesh::setVertices(std::vector<Eigen::Vector3f>&& _points)
 {
-    points.push_back(p);
+    points = std::move(_points);
 }
 
 Eigen::Vector2f
@@ -149,9 +149,9 @@ M3DTriangleMesh::getTexCoordCount() const
 }
 
 void
-M3DTriangleMesh::addTexCoord(const Eigen::Vector2f& p)
+M3DTriangleMesh::setTexCoords(std::vector<Eigen::Vector2f>&& _texCoords)
 {
-    texCoords.push_back(p);
+    texCoords = std::move(_texCoords);
 }
 
 void
@@ -170,11 +170,9 @@ M3DTriangleMesh::getFaceCount() const
 }
 
 void
-M3DTriangleMesh::addFace(std::uint16_t v0, std::uint16_t v1, std::uint16_t v2)
+M3DTriangleMesh::setFaces(std::vector<std::uint16_t>&& _faces)
 {
-    faces.push_back(v0);
-    faces.push_back(v1);
-    faces.push_back(v2);
+    faces = std::move(_faces);
 }
 
 std::uint32_t
@@ -184,9 +182,9 @@ M3DTriangleMesh::getSmoothingGroups(std::uint16_t face) const
 }
 
 void
-M3DTriangleMesh::addSmoothingGroups(std::uint32_t smGroups)
+M3DTriangleMesh::setSmoothingGroups(std::vector<std::uint32_t>&& _smoothingGroups)
 {
-    smoothingGroups.push_back(smGroups);
+    smoothingGroups = std::move(_smoothingGroups);
 }
 
 std::uint16_t
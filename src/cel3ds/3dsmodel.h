@@ -89,19 +89,21 @@ class M3DTriangleMesh
     Eigen::Matrix4f getMatrix() const;
     void setMatrix(const Eigen::Matrix4f&);
 
+    // The arrays are set as a whole, as they are read from single chunks
     Eigen::Vector3f getVertex(std::uint16_t) const;
     std::uint16_t getVertexCount() const;
-    void addVertex(const Eigen::Vector3f&);
+    void setVertices(std::vector<Eigen::Vector3f>&&);
 
     Eigen::Vector2f getTexCoord(std::uint16_t) const;
     std::uint16_t getTexCoordCount() const;
-    void addTexCoord(const Eigen::Vector2f&);
+    void setTexCoords(std::vector<Eigen::Vector2f>&&);
 
+    // Three vertex indices per face
     void getFace(std::uint16_t, std::uint16_t&, std::uint16_t&, std::uint16_t&) const;
     std::uint16_t getFaceCount() const;
-    void addFace(std::uint16_t, std::uint16_t, std::uint16_t);
+    void setFaces(std::vector<std::uint16_t>&&);
 
-    void addSmoothingGroups(std::uint32_t);
+    void setSmoothingGroups(std::vector<std::uint32_t>&&);
     std::uint32_t getSmoothingGroups(std::uint16_t) const;
     std::uint16_t getSmoothingGroupCount() const;
 
@@ -17,15 +17,19 @@
 #include <fstream>
 #include <istream>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 #include <fmt/format.h>
 
+#include <celcompat/bit.h>
 #include <celutil/binaryread.h>
 #include <celutil/logger.h>
 #include "3dsmodel.h"
 
+namespace compat = celestia::compat;
 namespace util = celestia::util;
 using util::GetLogger;
 
@@ -135,6 +139,28 @@ bool readString(std::istream& in, std::int32_t& contentSize, std::string& value)
 }
 
 
+// Read an array of little-endian values with a single read
+template<typename T>
+bool readLEArray(std::istream& in, T* values, std::size_t count)
+{
+    if (!in.read(reinterpret_cast<char*>(values), static_cast<std::streamsize>(count * sizeof(T))).good()) /* Flawfinder: ignore */
+        return false;
+
+    if constexpr (compat::endian::native != compat::endian::little)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if constexpr (std::is_floating_point_v<T>)
+                values[i] = compat::bit_cast<T>(compat::byteswap(compat::bit_cast<std::uint32_t>(values[i])));
+            else
+                values[i] = compat::byteswap(values[i]);
+        }
+    }
+
+    return true;
+}
+
+
 bool skipChunk(std::istream& in, M3DChunkType chunkType, std::int32_t contentSize)
 {
     GetLogger()->debug("Skipping {} bytes of unknown/unexpected chunk type {}\n", contentSize, chunkType);
@@ -239,20 +265,16 @@ bool readPointArray(std::istream& in, std::int32_t contentSize, M3DTriangleMesh&
         return false;
     }
 
-    for (std::int32_t i = 0; i < pointsCount; ++i)
+    static_assert(sizeof(Eigen::Vector3f) == 3 * sizeof(float), "Points must be tightly packed");
+    std::vector<Eigen::Vector3f> points(nPoints);
+    if (!readLEArray(in, reinterpret_cast<float*>(points.data()), points.size() * 3))
     {
-        Eigen::Vector3f vertex;
-        if (!util::readLE<float>(in, vertex.x())
-            || !util::readLE<float>(in, vertex.y())
-            || !util::readLE<float>(in, vertex.z()))
-        {
-            GetLogger()->error("Failed to read entry {} of point array\n", i);
-            return false;
-        }
-
-        triMesh.addVertex(vertex);
+        GetLogger()->error("Failed to read point array\n");
+        return false;
     }
 
+    triMesh.setVertices(std::move(points));
+
     return skipTrailing(in, contentSize - expectedSize);
 }
 
@@ -281,19 +303,17 @@ bool readTextureCoordArray(std::istream& in, std::int32_t contentSize, M3DTriang
         return false;
     }
 
-    for (std::int32_t i = 0; i < texCoordsCount; ++i)
+    static_assert(sizeof(Eigen::Vector2f) == 2 * sizeof(float), "Texture coords must be tightly packed");
+    std::vector<Eigen::Vector2f> texCoords(nTexCoords);
+    if (!readLEArray(in, reinterpret_cast<float*>(texCoords.data()), texCoords.size() * 2))
     {
-        Eigen::Vector2f texCoord;
-        if (!util::readLE<float>(in, texCoord.x())
-            || !util::readLE<float>(in, texCoord.y()))
-        {
-            GetLogger()->error("Failed to read entry {} of texture coord array\n", i);
-            return false;
-        }
+        GetLogger()->error("Failed to read texture coord array\n");
+        return false;
+    }
 
+    for (Eigen::Vector2f& texCoord : texCoords)
         texCoord.y() = -texCoord.y();
-        triMesh.addTexCoord(texCoord);
-    }
+    triMesh.setTexCoords(std::move(texCoords));
 
     return skipTrailing(in, contentSize - expectedSize);
 }
@@ -325,16 +345,11 @@ bool readMeshMaterialGroup(std::istream& in, std::int32_t contentSize, M3DTriang
         return false;
     }
 
-    for (std::int32_t i = 0; i < faceCount; ++i)
+    matGroup.faces.resize(nFaces);
+    if (!readLEArray(in, matGroup.faces.data(), matGroup.faces.size()))
     {
-        std::uint16_t faceIndex;
-        if (!util::readLE(in, faceIndex))
-        {
-            GetLogger()->error("Failed to read entry {} of material group face array\n", i);
-            return false;
-        }
-
-        matGroup.faces.push_back(faceIndex);
+        GetLogger()->error("Failed to read material group face array\n");
+        return false;
     }
 
     triMesh.addMeshMaterialGroup(std::move(matGroup));
@@ -352,18 +367,15 @@ bool readMeshSmoothGroup(std::istream& in, std::int32_t contentSize, M3DTriangle
         return false;
     }
 
-    for (std::int32_t i = 0; i < faceCount; ++i)
+    std::vector<std::uint32_t> groups(static_cast<std::size_t>(faceCount));
+    if (!readLEArray(in, groups.data(), groups.size()))
     {
-        std::uint32_t groups;
-        if (!util::readLE<std::uint32_t>(in, groups))
-        {
-            GetLogger()->error("Failed to read entry {} of smoothing group array\n", i);
-            return false;
-        }
-
-        triMesh.addSmoothingGroups(groups);
+        GetLogger()->error("Failed to read smoothing group array\n");
+        return false;
     }
 
+    triMesh.setSmoothingGroups(std::move(groups));
+
     return skipTrailing(in, contentSize - expectedSize);
 }
 
@@ -410,21 +422,25 @@ bool readFaceArray(std::istream& in, std::int32_t contentSize, M3DTriangleMesh&
         return false;
     }
 
-    for (std::int32_t i = 0; i < faceCount; ++i)
+    // Each face is three vertex indices and a flags word, the flags are
+    // dropped in place
+    std::vector<std::uint16_t> faces(static_cast<std::size_t>(nFaces) * 4);
+    if (!readLEArray(in, faces.data(), faces.size()))
     {
-        std::uint16_t v0, v1, v2, flags;
-        if (!util::readLE<std::uint16_t>(in, v0)
-            || !util::readLE<std::uint16_t>(in, v1)
-            || !util::readLE<std::uint16_t>(in, v2)
-            || !util::readLE<std::uint16_t>(in, flags))
-        {
-            GetLogger()->error("Failed to read entry {} of face array\n", i);
-            return false;
-        }
+        GetLogger()->error("Failed to read face array\n");
+        return false;
+    }
 
-        triMesh.addFace(v0, v1, v2);
+    for (std::size_t i = 0; i < nFaces; ++i)
+    {
+        faces[i * 3] = faces[i * 4];
+        faces[i * 3 + 1] = faces[i * 4 + 1];
+        faces[i * 3 + 2] = faces[i * 4 + 2];
     }
 
+    faces.resize(static_cast<std::size_t>(nFaces) * 3);
+    triMesh.setFaces(std::move(faces));
+
     if (expectedSize < contentSize)
     {
         return readChunks(in, contentSize - expectedSize, triMesh, processFaceArrayChunk);
@@ -9,10 +9,16 @@
 
 #include "asterism.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <ostream>
 #include <string_view>
 #include <utility>
 
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
 #include <celutil/gettext.h>
 #include <celutil/greek.h>
 #include <celutil/logger.h>
@@ -25,9 +31,17 @@ using celestia::util::GetLogger;
 namespace
 {
 
+// Binary form: the magic and the number of asterisms, then for each
+// asterism the length of its name, the name and the number of chains, and
+// for each chain the number of stars followed by the catalog number and
+// the position of each star, all little-endian
+constexpr std::array<char, 8> BinaryMagic = { 'C', 'E', 'L', 'A', 'S', 'T', 'C', '1' };
+constexpr std::size_t BinaryStarSize = sizeof(std::uint32_t) + 3 * sizeof(float);
+
 bool
 readChain(Tokenizer& tokenizer,
           Asterism::Chain& chain,
+          std::vector<AstroCatalog::IndexNumber>& stars,
           const StarDatabase& starDB,
           std::string_view astName)
 {
@@ -48,7 +62,10 @@ readChain(Tokenizer& tokenizer,
             star = starDB.find(ReplaceGreekLetterAbbr(*starName), false);
 
         if (star)
+        {
             chain.push_back(star->getPosition());
+            stars.push_back(star->getIndex());
+        }
         else
             GetLogger()->warn("Error loading star \"{}\" for asterism \"{}\"\n", *starName, astName);
     }
@@ -59,6 +76,7 @@ readChain(Tokenizer& tokenizer,
 bool
 readChains(Tokenizer& tokenizer,
            std::vector<Asterism::Chain>& chains,
+           std::vector<AstroCatalog::IndexNumber>& stars,
            const StarDatabase& starDB,
            std::string_view astName)
 {
@@ -81,12 +99,16 @@ readChains(Tokenizer& tokenizer,
         }
 
         Asterism::Chain chain;
-        if (!readChain(tokenizer, chain, starDB, astName))
+        std::vector<AstroCatalog::IndexNumber> chainStars;
+        if (!readChain(tokenizer, chain, chainStars, starDB, astName))
             return false;
 
         // skip empty (without or only with a single star) chains - no lines can be drawn for these
         if (chain.size() > 1)
+        {
             chains.push_back(std::move(chain));
+            stars.insert(stars.end(), chainStars.begin(), chainStars.end());
+        }
         else
             GetLogger()->warn("Empty or single-element chain found in asterism \"{}\"\n", astName);
     }
@@ -96,9 +118,12 @@ readChains(Tokenizer& tokenizer,
 
 } // end unnamed namespace
 
-Asterism::Asterism(std::string&& name, std::vector<Chain>&& chains) :
+Asterism::Asterism(std::string&& name,
+                   std::vector<Chain>&& chains,
+                   std::vector<AstroCatalog::IndexNumber>&& stars) :
     m_name(std::move(name)),
-    m_chains(std::move(chains))
+    m_chains(std::move(chains)),
+    m_stars(std::move(stars))
 {
 #ifdef ENABLE_NLS
     if (std::string_view localizedName(D_(m_name.c_str())); localizedName != m_name)
@@ -136,6 +161,12 @@ Asterism::getChain(int index) const
     return m_chains[index];
 }
 
+const std::vector<AstroCatalog::IndexNumber>&
+Asterism::getStars() const
+{
+    return m_stars;
+}
+
 /*! Return whether the constellation is visible.
  */
 bool
@@ -213,14 +244,141 @@ ReadAsterismList(std::istream& in, const StarDatabase& starDB)
 
         std::string astName(*tokenValue);
         std::vector<Asterism::Chain> chains;
-        if (!readChains(tokenizer, chains, starDB, astName))
+        std::vector<AstroCatalog::IndexNumber> stars;
+        if (!readChains(tokenizer, chains, stars, starDB, astName))
             return asterisms;
 
         if (chains.empty())
             GetLogger()->warn("No valid chains found for asterism \"{}\"\n", astName);
         else
-            asterisms->emplace_back(std::move(astName), std::move(chains));
+            asterisms->emplace_back(std::move(astName), std::move(chains), std::move(stars));
     }
 
     return asterisms;
 }
+
+std::unique_ptr<AsterismList>
+ReadBinaryAsterismList(const char* data, std::size_t size, const StarDatabase& starDB)
+{
+    using celestia::util::fromMemoryLE;
+
+    if (size < BinaryMagic.size() + sizeof(std::uint32_t)
+        || !std::equal(BinaryMagic.begin(), BinaryMagic.end(), data))
+    {
+        return nullptr;
+    }
+
+    const char* end = data + size;
+    data += BinaryMagic.size();
+    auto nAsterisms = fromMemoryLE<std::uint32_t>(data);
+    data += sizeof(std::uint32_t);
+
+    auto readCount = [&data, end](std::uint32_t& count)
+    {
+        if (static_cast<std::size_t>(end - data) < sizeof(std::uint32_t))
+            return false;
+        count = fromMemoryLE<std::uint32_t>(data);
+        data += sizeof(std::uint32_t);
+        return true;
+    };
+
+    auto asterisms = std::make_unique<AsterismList>();
+    asterisms->reserve(std::min(static_cast<std::size_t>(nAsterisms), size / sizeof(std::uint32_t)));
+    for (std::uint32_t i = 0; i < nAsterisms; ++i)
+    {
+        std::uint32_t nameLength;
+        if (!readCount(nameLength) || static_cast<std::size_t>(end - data) < nameLength)
+            return nullptr;
+        std::string name(data, nameLength);
+        data += nameLength;
+
+        std::uint32_t nChains;
+        if (!readCount(nChains) || nChains == 0)
+            return nullptr;
+
+        std::vector<Asterism::Chain> chains;
+        std::vector<AstroCatalog::IndexNumber> stars;
+        for (std::uint32_t j = 0; j < nChains; ++j)
+        {
+            std::uint32_t nStars;
+            if (!readCount(nStars) || nStars < 2
+                || static_cast<std::size_t>(end - data) / BinaryStarSize < nStars)
+            {
+                return nullptr;
+            }
+
+            auto& chain = chains.emplace_back();
+            chain.reserve(nStars);
+            for (std::uint32_t k = 0; k < nStars; ++k, data += BinaryStarSize)
+            {
+                auto catalogNumber = fromMemoryLE<AstroCatalog::IndexNumber>(data);
+                Eigen::Vector3f position(fromMemoryLE<float>(data + sizeof(std::uint32_t)),
+                                         fromMemoryLE<float>(data + sizeof(std::uint32_t) + sizeof(float)),
+                                         fromMemoryLE<float>(data + sizeof(std::uint32_t) + 2 * sizeof(float)));
+
+                // The star catalogs may have changed since the list was written
+                const Star* star = starDB.find(catalogNumber);
+                if (star == nullptr || star->getPosition() != position)
+                    return nullptr;
+
+                chain.push_back(position);
+                stars.push_back(catalogNumber);
+            }
+        }
+
+        asterisms->emplace_back(std::move(name), std::move(chains), std::move(stars));
+    }
+
+    if (data != end)
+        return nullptr;
+
+    return asterisms;
+}
+
+bool
+WriteBinaryAsterismList(std::ostream& out, const AsterismList& asterisms)
+{
+    using celestia::util::writeLE;
+
+    if (!out.write(BinaryMagic.data(), BinaryMagic.size()).good()
+        || !writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(asterisms.size())))
+    {
+        return false;
+    }
+
+    for (const auto& asterism : asterisms)
+    {
+        std::string_view name = asterism.getName();
+        if (!writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(name.size()))
+            || !out.write(name.data(), static_cast<std::streamsize>(name.size())).good()
+            || !writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(asterism.getChainCount())))
+        {
+            return false;
+        }
+
+        const auto& stars = asterism.getStars();
+        std::size_t starIndex = 0;
+        for (int i = 0; i < asterism.getChainCount(); ++i)
+        {
+            const auto& chain = asterism.getChain(i);
+            if (stars.size() - starIndex < chain.size()
+                || !writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(chain.size())))
+            {
+                return false;
+            }
+
+            for (const auto& position : chain)
+            {
+                if (!writeLE<std::uint32_t>(out, stars[starIndex++])
+                    || !writeLE(out, position.x())
+                    || !writeLE(out, position.y())
+                    || !writeLE(out, position.z()))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iosfwd>
 #include <memory>
 #include <string>
@@ -18,6 +19,7 @@
 #include <Eigen/Core>
 
 #include <celutil/color.h>
+#include "astroobj.h"
 
 class StarDatabase;
 
@@ -26,7 +28,7 @@ class Asterism
 public:
     using Chain = std::vector<Eigen::Vector3f>;
 
-    Asterism(std::string&&, std::vector<Chain>&&);
+    Asterism(std::string&&, std::vector<Chain>&&, std::vector<AstroCatalog::IndexNumber>&&);
     ~Asterism() = default;
 
     Asterism(const Asterism&) = delete;
@@ -37,6 +39,8 @@ public:
     std::string_view getName(bool i18n = false) const;
     int getChainCount() const;
     const Chain& getChain(int) const;
+    // Catalog numbers of the stars of all chains, in order
+    const std::vector<AstroCatalog::IndexNumber>& getStars() const;
 
     bool getActive() const;
     void setActive(bool _active);
@@ -54,6 +58,7 @@ private:
     std::string m_i18nName;
 #endif
     std::vector<Chain> m_chains;
+    std::vector<AstroCatalog::IndexNumber> m_stars;
     Eigen::Vector3f m_averagePosition{ Eigen::Vector3f::Zero() };
     Color m_color;
 
@@ -64,3 +69,10 @@ private:
 using AsterismList = std::vector<Asterism>;
 
 std::unique_ptr<AsterismList> ReadAsterismList(std::istream&, const StarDatabase&);
+
+// The binary form of an asterism list holds the catalog numbers and the
+// positions of the stars, so reading it needs no parsing or looking up of
+// star names. Returns nullptr if the data is not valid, or if one of the
+// stars is missing from starDB or has moved.
+std::unique_ptr<AsterismList> ReadBinaryAsterismList(const char* data, std::size_t size, const StarDatabase& starDB);
+bool WriteBinaryAsterismList(std::ostream&, const AsterismList&);
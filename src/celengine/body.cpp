@@ -9,10 +9,13 @@
 
 #include <cstdlib>
 #include <algorithm>
+#include <atomic>
 #include <iterator>
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
 #include <celutil/gettext.h>
+#include <celutil/memoryreport.h>
+#include <celutil/objectpool.h>
 #include <celutil/utf8.h>
 #include "geometry.h"
 #include "meshmanager.h"
@@ -53,6 +56,44 @@ constexpr auto CLASSES_SECONDARY_ILLUMINATOR = BodyClassification::Planet      |
 
 }
 
+namespace
+{
+
+// Incremented whenever a body changes, to drop the evaluation caches of
+// all bodies
+std::atomic<std::uint32_t> evaluationGeneration{ 1 };
+
+// Never destroyed, as bodies may be deleted during the destruction of
+// other static objects
+util::ObjectPool<Body>*
+GetBodyPool()
+{
+    static util::ObjectPool<Body>* const pool = std::make_unique<util::ObjectPool<Body>>().release(); //NOSONAR
+    return pool;
+}
+
+} // end unnamed namespace
+
+
+void*
+Body::operator new(std::size_t size)
+{
+    if (size != sizeof(Body))
+        return ::operator new(size);
+    return GetBodyPool()->allocate();
+}
+
+
+void
+Body::operator delete(void* ptr, std::size_t size) noexcept
+{
+    if (size != sizeof(Body))
+        ::operator delete(ptr);
+    else
+        GetBodyPool()->deallocate(ptr);
+}
+
+
 Body::Body(PlanetarySystem* _system, const std::string& _name) :
     system(_system),
     orbitVisibility(UseClassVisibility)
@@ -236,11 +277,18 @@ void Body::setTimeline(std::unique_ptr<Timeline>&& newTimeline)
 
 void Body::markChanged()
 {
+    evaluationGeneration.fetch_add(1, std::memory_order_relaxed);
     if (timeline)
         timeline->markChanged();
 }
 
 
+std::uint32_t Body::getEvaluationGeneration()
+{
+    return evaluationGeneration.load(std::memory_order_relaxed);
+}
+
+
 void Body::markUpdated()
 {
     if (frameTree)
@@ -511,6 +559,12 @@ Surface& Body::getSurface()
 }
 
 
+ShaderSlot& Body::getShaderSlot() const
+{
+    return shaderSlot;
+}
+
+
 void Body::setSurface(const Surface& surf)
 {
     surface = surf;
@@ -551,6 +605,39 @@ PlanetarySystem* Body::getOrCreateSatellites()
 //    * getVelocity
 //    * getAngularVelocity
 
+/*! Return the value of the cache at tdb, computing it if needed. As for the
+ *  orbits, the cache is not locked while the value is computed, since that
+ *  asks for the positions of other bodies.
+ */
+template<typename T, typename F>
+T Body::memoize(double tdb, T EvaluationCache::* value, std::uint32_t flag, F&& compute) const
+{
+    std::uint32_t generation = evaluationGeneration.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(evaluationCache.mutex);
+        if (evaluationCache.tdb == tdb && evaluationCache.generation == generation &&
+            (evaluationCache.valid & flag) != 0)
+        {
+            return evaluationCache.*value;
+        }
+    }
+
+    T result = compute(tdb);
+
+    std::lock_guard<std::mutex> lock(evaluationCache.mutex);
+    if (evaluationCache.tdb != tdb || evaluationCache.generation != generation)
+    {
+        evaluationCache.tdb = tdb;
+        evaluationCache.generation = generation;
+        evaluationCache.valid = 0;
+    }
+
+    evaluationCache.*value = result;
+    evaluationCache.valid |= flag;
+    return result;
+}
+
+
 /*! Get the position of the body in the universal coordinate system.
  *  This method uses high-precision coordinates and is thus
  *  slower relative to getAstrocentricPosition(), which works strictly
@@ -560,21 +647,19 @@ PlanetarySystem* Body::getOrCreateSatellites()
  */
 UniversalCoord Body::getPosition(double tdb) const
 {
-    Vector3d position = Vector3d::Zero();
+    return memoize(tdb, &EvaluationCache::position, EvaluationCache::Position,
+                   [this](double t) { return computePosition(t); });
+}
 
+
+// The position of a body centered on another body is found from the
+// cached position of the center, so that the frame hierarchy is only
+// walked once per time for all the bodies sharing a parent.
+UniversalCoord Body::computePosition(double tdb) const
+{
     const TimelinePhase* phase = timeline->findPhase(tdb).get();
-    Vector3d p = phase->orbit()->positionAtTime(tdb);
     const ReferenceFrame* frame = phase->orbitFrame().get();
-
-    while (frame->getCenter().getType() == SelectionType::Body)
-    {
-        phase = frame->getCenter().body()->timeline->findPhase(tdb).get();
-        position += frame->getOrientation(tdb).conjugate() * p;
-        p = phase->orbit()->positionAtTime(tdb);
-        frame = phase->orbitFrame().get();
-    }
-
-    position += frame->getOrientation(tdb).conjugate() * p;
+    Vector3d position = frame->getOrientation(tdb).conjugate() * phase->orbit()->positionAtTime(tdb);
 
     if (frame->getCenter().star())
         return frame->getCenter().star()->getPosition(tdb).offsetKm(position);
@@ -584,11 +669,44 @@ UniversalCoord Body::getPosition(double tdb) const
 
 
 /*! Get the orientation of the body in the universal coordinate system.
+ *  It is composed from the cached orientation of the equator, which frames
+ *  of other bodies based on this one also use, so each level of a frame
+ *  hierarchy is composed once per time.
  */
 Quaterniond Body::getOrientation(double tdb) const
 {
-    const TimelinePhase* phase = timeline->findPhase(tdb).get();
-    return phase->rotationModel()->orientationAtTime(tdb) * phase->bodyFrame()->getOrientation(tdb);
+    return memoize(tdb, &EvaluationCache::orientation, EvaluationCache::Orientation,
+                   [this](double t)
+                   {
+                       const TimelinePhase* phase = timeline->findPhase(t).get();
+                       return Quaterniond(phase->rotationModel()->spin(t) * getEclipticToEquatorial(t));
+                   });
+}
+
+
+/*! Return true if the position of the body may be computed from several
+ *  threads at once: the orbits of all its phases, and of the bodies they
+ *  are relative to, are reentrant, in frames with fixed axes.
+ */
+bool Body::hasReentrantPosition() const
+{
+    for (unsigned int i = 0; i < timeline->phaseCount(); i++)
+    {
+        const TimelinePhase* phase = timeline->getPhase(i).get();
+        const ReferenceFrame* frame = phase->orbitFrame().get();
+        if (!phase->orbit()->isReentrant() ||
+            (dynamic_cast<const J2000EclipticFrame*>(frame) == nullptr &&
+             dynamic_cast<const J2000EquatorFrame*>(frame) == nullptr))
+        {
+            return false;
+        }
+
+        const Body* center = frame->getCenter().body();
+        if (center != nullptr && center != this && !center->hasReentrantPosition())
+            return false;
+    }
+
+    return true;
 }
 
 
@@ -617,18 +735,22 @@ Vector3d Body::getVelocity(double tdb) const
  */
 Vector3d Body::getAngularVelocity(double tdb) const
 {
-    const TimelinePhase* phase = timeline->findPhase(tdb).get();
+    return memoize(tdb, &EvaluationCache::angularVelocity, EvaluationCache::AngularVelocity,
+                   [this](double t)
+                   {
+                       const TimelinePhase* phase = timeline->findPhase(t).get();
 
-    Vector3d v = phase->rotationModel()->angularVelocityAtTime(tdb);
+                       Vector3d v = phase->rotationModel()->angularVelocityAtTime(t);
 
-    const ReferenceFrame* bodyFrame = phase->bodyFrame().get();
-    v = bodyFrame->getOrientation(tdb).conjugate() * v;
-    if (!bodyFrame->isInertial())
-    {
-        v += bodyFrame->getAngularVelocity(tdb);
-    }
+                       const ReferenceFrame* bodyFrame = phase->bodyFrame().get();
+                       v = bodyFrame->getOrientation(t).conjugate() * v;
+                       if (!bodyFrame->isInertial())
+                       {
+                           v += bodyFrame->getAngularVelocity(t);
+                       }
 
-    return v;
+                       return v;
+                   });
 }
 
 
@@ -640,8 +762,7 @@ Vector3d Body::getAngularVelocity(double tdb) const
  */
 Matrix4d Body::getLocalToAstrocentric(double tdb) const
 {
-    const TimelinePhase* phase = timeline->findPhase(tdb).get();
-    Vector3d p = phase->orbitFrame()->convertToAstrocentric(phase->orbit()->positionAtTime(tdb), tdb);
+    Vector3d p = getAstrocentricPosition(tdb);
     return Eigen::Transform<double, 3, Affine>(Translation3d(p)).matrix();
 }
 
@@ -651,8 +772,12 @@ Matrix4d Body::getLocalToAstrocentric(double tdb) const
 Vector3d Body::getAstrocentricPosition(double tdb) const
 {
     // TODO: Switch the iterative method used in getPosition
-    const TimelinePhase* phase = timeline->findPhase(tdb).get();
-    return phase->orbitFrame()->convertToAstrocentric(phase->orbit()->positionAtTime(tdb), tdb);
+    return memoize(tdb, &EvaluationCache::astrocentricPosition, EvaluationCache::AstrocentricPosition,
+                   [this](double t)
+                   {
+                       const TimelinePhase* phase = timeline->findPhase(t).get();
+                       return phase->orbitFrame()->convertToAstrocentric(phase->orbit()->positionAtTime(t), t);
+                   });
 }
 
 
@@ -670,8 +795,12 @@ Quaterniond Body::getEclipticToFrame(double tdb) const
  */
 Quaterniond Body::getEclipticToEquatorial(double tdb) const
 {
-    const TimelinePhase* phase = timeline->findPhase(tdb).get();
-    return phase->rotationModel()->equatorOrientationAtTime(tdb) * phase->bodyFrame()->getOrientation(tdb);
+    return memoize(tdb, &EvaluationCache::eclipticToEquatorial, EvaluationCache::EclipticToEquatorial,
+                   [this](double t)
+                   {
+                       const TimelinePhase* phase = timeline->findPhase(t).get();
+                       return phase->rotationModel()->equatorOrientationAtTime(t) * phase->bodyFrame()->getOrientation(t);
+                   });
 }
 
 
@@ -680,8 +809,7 @@ Quaterniond Body::getEclipticToEquatorial(double tdb) const
  */
 Quaterniond Body::getEclipticToBodyFixed(double tdb) const
 {
-    const TimelinePhase* phase = timeline->findPhase(tdb).get();
-    return phase->rotationModel()->orientationAtTime(tdb) * phase->bodyFrame()->getOrientation(tdb);
+    return getOrientation(tdb);
 }
 
 
@@ -946,6 +1074,18 @@ void Body::setInfoURL(string&& _infoURL)
     infoURL = std::move(_infoURL);
 }
 
+std::size_t
+Body::getMemoryUsage() const
+{
+    std::size_t size = sizeof(Body) + util::ContainerMemoryUsage(names);
+    for (const std::string& name : names)
+        size += util::ContainerMemoryUsage(name);
+    size += util::ContainerMemoryUsage(localizedName) + util::ContainerMemoryUsage(infoURL);
+    if (satellites != nullptr)
+        size += satellites->getMemoryUsage();
+    return size;
+}
+
 /*! Sets whether or not the object is visible.
  */
 void Body::setVisible(bool _visible)
@@ -1025,6 +1165,16 @@ PlanetarySystem::PlanetarySystem(Star* _star) :
 {
 }
 
+std::size_t
+PlanetarySystem::getMemoryUsage() const
+{
+    std::size_t size = sizeof(PlanetarySystem) + util::ContainerMemoryUsage(satellites) +
+                       util::ContainerMemoryUsage(objectIndex);
+    for (const auto& entry : objectIndex)
+        size += util::ContainerMemoryUsage(entry.first);
+    return size;
+}
+
 /*! Add a new alias for an object. If an object with the specified
  *  alias already exists in the planetary system, the old entry will
  *  be replaced.
@@ -1338,6 +1488,7 @@ BodyFeaturesManager::addLocation(Body* body, std::unique_ptr<Location>&& loc)
     auto& bodyLocations = locations[body];
     loc->setParentBody(body);
     bodyLocations.locations.push_back(std::move(loc));
+    bodyLocations.indexValid = false;
     body->features |= BodyFeatures::Locations;
 }
 
@@ -1386,14 +1537,22 @@ BodyFeaturesManager::computeLocations(const Body* body)
     if (bodyLocations.locationsComputed)
         return;
 
+    // Try again in a later frame if the mesh is still loading
+    auto geometry = body->getGeometry();
+    const Geometry* g = nullptr;
+    if (geometry != InvalidResource)
+    {
+        g = engine::GetGeometryManager()->findAsync(geometry);
+        if (g == nullptr &&
+            engine::GetGeometryManager()->getState(geometry) == ResourceState::LoadingInProgress)
+        {
+            return;
+        }
+    }
+
     bodyLocations.locationsComputed = true;
 
     // No work to do if there's no mesh, or if the mesh cannot be loaded
-    auto geometry = body->getGeometry();
-    if (geometry == InvalidResource)
-        return;
-
-    const Geometry* g = engine::GetGeometryManager()->find(geometry);
     if (g == nullptr)
         return;
 
@@ -1420,6 +1579,38 @@ BodyFeaturesManager::computeLocations(const Body* body)
             loc->setPosition(v);
         }
     }
+
+    bodyLocations.indexValid = false;
+}
+
+
+const engine::LocationIndex*
+BodyFeaturesManager::getLocationIndex(const Body* body)
+{
+    if (!util::is_set(body->features, BodyFeatures::Locations))
+        return nullptr;
+
+    auto it = locations.find(body);
+    assert(it != locations.end());
+
+    auto& bodyLocations = it->second;
+    if (!bodyLocations.indexValid)
+    {
+        // Rank the locations as the renderer does when deciding whether
+        // they are large enough to label
+        std::vector<engine::LocationIndex::Entry> entries;
+        entries.reserve(bodyLocations.locations.size());
+        for (const auto& location : bodyLocations.locations)
+        {
+            float importance = location->getImportance();
+            entries.push_back({ location->getPosition(), importance < 0.0f ? location->getSize() : importance });
+        }
+
+        bodyLocations.index.build(entries);
+        bodyLocations.indexValid = true;
+    }
+
+    return &bodyLocations.index;
 }
 
 bool
@@ -1502,6 +1693,46 @@ BodyFeaturesManager::removeFeatures(Body* body)
     // as we only use this when we're deleting the Body
 }
 
+void
+BodyFeaturesManager::reportMemoryUsage(util::MemoryReport& report) const
+{
+    using namespace std::string_view_literals;
+    constexpr std::string_view subsystem = "Solar systems"sv;
+
+    report.add(subsystem, "Atmospheres"sv,
+               util::ContainerMemoryUsage(atmospheres) + atmospheres.size() * sizeof(Atmosphere),
+               atmospheres.size());
+    report.add(subsystem, "Rings"sv,
+               util::ContainerMemoryUsage(rings) + rings.size() * sizeof(RingSystem),
+               rings.size());
+
+    std::size_t nSurfaces = 0;
+    std::size_t surfacesSize = util::ContainerMemoryUsage(alternateSurfaces);
+    for (const auto& [body, surfaces] : alternateSurfaces)
+    {
+        nSurfaces += surfaces->size();
+        surfacesSize += sizeof(AltSurfaceTable) + util::ContainerMemoryUsage(*surfaces) +
+                        surfaces->size() * sizeof(Surface);
+    }
+    report.add(subsystem, "Alternate surfaces"sv, surfacesSize, nSurfaces);
+
+    std::size_t nLocations = 0;
+    std::size_t locationsSize = util::ContainerMemoryUsage(locations);
+    for (const auto& [body, bodyLocations] : locations)
+    {
+        nLocations += bodyLocations.locations.size();
+        locationsSize += util::ContainerMemoryUsage(bodyLocations.locations);
+        for (const auto& location : bodyLocations.locations)
+        {
+            locationsSize += sizeof(Location) + util::ContainerMemoryUsage(location->getName(false)) +
+                             util::ContainerMemoryUsage(location->getInfoURL());
+            if (const std::string& i18nName = location->getName(true); &i18nName != &location->getName(false))
+                locationsSize += util::ContainerMemoryUsage(i18nName);
+        }
+    }
+    report.add(subsystem, "Locations"sv, locationsSize, nLocations);
+}
+
 BodyFeaturesManager*
 GetBodyFeaturesManager()
 {
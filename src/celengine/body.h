@@ -10,9 +10,11 @@
 #pragma once
 
 #include <celengine/astroobj.h>
+#include <celengine/shaderkey.h>
 #include <celengine/surface.h>
 #include <celengine/star.h>
 #include <celengine/location.h>
+#include <celengine/locationindex.h>
 #include <celengine/timeline.h>
 #include <celephem/rotation.h>
 #include <celephem/orbit.h>
@@ -22,6 +24,10 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -41,6 +47,11 @@ class ReferenceMark;
 class Atmosphere;
 class StarDatabase;
 
+namespace celestia::util
+{
+class MemoryReport;
+}
+
 class PlanetarySystem
 {
 public:
@@ -66,6 +77,9 @@ public:
     Body* find(std::string_view, bool deepSearch = false, bool i18n = false) const;
     void getCompletion(std::vector<std::string>& completion, std::string_view _name, bool rec = true) const;
 
+    // Memory used by the system itself, excluding its bodies
+    std::size_t getMemoryUsage() const;
+
 private:
     void addBodyToNameIndex(Body* body);
     void removeBodyFromNameIndex(const Body* body);
@@ -188,6 +202,11 @@ public:
      Body(PlanetarySystem*, const std::string& name);
      ~Body();
 
+    // Bodies are allocated from a pool, so that the bodies of a system,
+    // which are usually loaded together, are close in memory
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size) noexcept;
+
     enum VisibilityPolicy
     {
         NeverVisible       = 0,
@@ -249,6 +268,10 @@ public:
     PlanetarySystem* getSatellites() const;
     PlanetarySystem* getOrCreateSatellites();
 
+    // Memory used by the body and its names, excluding its satellites,
+    // timeline and features
+    std::size_t getMemoryUsage() const;
+
     float getBoundingRadius() const;
     float getCullingRadius() const;
 
@@ -263,6 +286,9 @@ public:
     const Surface& getSurface() const;
     Surface& getSurface();
 
+    // The shader last used to render the body
+    ShaderSlot& getShaderSlot() const;
+
     float getLuminosity(const Star& sun,
                         float distanceFromSun) const;
     float getLuminosity(float sunLuminosity,
@@ -285,6 +311,7 @@ public:
     Eigen::Quaterniond getOrientation(double tdb) const;
     Eigen::Vector3d getVelocity(double tdb) const;
     Eigen::Vector3d getAngularVelocity(double tdb) const;
+    bool hasReentrantPosition() const;
 
     Eigen::Matrix4d getLocalToAstrocentric(double) const;
     Eigen::Vector3d getAstrocentricPosition(double) const;
@@ -333,23 +360,78 @@ public:
     void markUpdated();
     void recomputeCullingRadius();
 
+    // Stamp incremented whenever any body changes. Values derived from the
+    // positions or orientations of bodies may be cached for a time as long
+    // as the stamp stays the same.
+    static std::uint32_t getEvaluationGeneration();
+
 private:
+    // The results of getPosition(), getAstrocentricPosition(),
+    // getOrientation(), getEclipticToEquatorial() and getAngularVelocity()
+    // at the last time they were requested at. Rendering
+    // a frame asks for the same positions many times, from the render
+    // lists, labels, eclipses, lighting and the HUD. The cached values are
+    // dropped when any body changes, as the positions of the children of
+    // the body depend on it.
+    struct EvaluationCache
+    {
+        enum : std::uint32_t
+        {
+            Position             = 0x01,
+            AstrocentricPosition = 0x02,
+            Orientation          = 0x04,
+            EclipticToEquatorial = 0x08,
+            AngularVelocity      = 0x10,
+        };
+
+        std::mutex mutex;
+        double tdb{ std::numeric_limits<double>::quiet_NaN() };
+        std::uint32_t generation{ 0 };
+        std::uint32_t valid{ 0 };
+        UniversalCoord position;
+        Eigen::Vector3d astrocentricPosition;
+        Eigen::Quaterniond orientation;
+        Eigen::Quaterniond eclipticToEquatorial;
+        Eigen::Vector3d angularVelocity;
+    };
+
+    template<typename T, typename F>
+    T memoize(double tdb, T EvaluationCache::* value, std::uint32_t flag, F&& compute) const;
+
+    UniversalCoord computePosition(double tdb) const;
+
     void setName(const std::string& name);
 
-    std::vector<std::string> names{ 1 };
-    std::string localizedName;
+    // The fields read while building the render lists come first, so that
+    // they share a cache line; the names and the physical properties are
+    // only used on demand.
 
     // Parent in the name hierarchy
     PlanetarySystem* system;
-    // Children in the name hierarchy
-    std::unique_ptr<PlanetarySystem> satellites;
 
     std::unique_ptr<Timeline> timeline;
     // Children in the frame hierarchy
     std::unique_ptr<FrameTree> frameTree;
 
     float radius{ 1.0f };
+    float cullingRadius{ 0.0f };
     Eigen::Vector3f semiAxes{ Eigen::Vector3f::Ones() };
+
+    BodyClassification classification{ BodyClassification::Unknown };
+
+    // Track enabled features to allow fast rejection during lookup
+    BodyFeatures features{ BodyFeatures::None };
+
+    bool visible{ true };
+    bool clickable{ true };
+    VisibilityPolicy orbitVisibility : 3;
+
+    std::vector<std::string> names{ 1 };
+    std::string localizedName;
+
+    // Children in the name hierarchy
+    std::unique_ptr<PlanetarySystem> satellites;
+
     float mass{ 0.0f };
     float density{ 0.0f };
     float geomAlbedo{ 0.5f };
@@ -360,30 +442,24 @@ private:
 
     Eigen::Quaternionf geometryOrientation{ Eigen::Quaternionf::Identity() };
 
-    float cullingRadius{ 0.0f };
-
     ResourceHandle geometry{ InvalidResource };
     float geometryScale{ 1.0f };
     Surface surface{ Color(1.0f, 1.0f, 1.0f) };
-
-    BodyClassification classification{ BodyClassification::Unknown };
+    mutable ShaderSlot shaderSlot;
+    mutable EvaluationCache evaluationCache;
 
     std::string infoURL;
 
-    // Track enabled features to allow fast rejection during lookup
-    BodyFeatures features{ BodyFeatures::None };
-
-    bool visible{ true };
-    bool clickable{ true };
-    VisibilityPolicy orbitVisibility : 3;
-
     friend class BodyFeaturesManager;
 };
 
 struct BodyLocations
 {
     std::vector<std::unique_ptr<Location>> locations;
+    // Built on first use after the locations change
+    celestia::engine::LocationIndex index;
     bool locationsComputed;
+    bool indexValid;
 };
 
 class BodyFeaturesManager
@@ -439,6 +515,7 @@ public:
     Location* findLocation(const Body*, std::string_view, bool i18n = false) const;
     bool hasLocations(const Body*) const;
     void computeLocations(const Body*);
+    const celestia::engine::LocationIndex* getLocationIndex(const Body*);
 
     auto getLocations(const Body* body) const
     {
@@ -463,6 +540,8 @@ public:
 
     void removeFeatures(Body*);
 
+    void reportMemoryUsage(celestia::util::MemoryReport&) const;
+
 private:
     using AltSurfaceTable = std::map<std::string, std::unique_ptr<Surface>, std::less<>>;
 
@@ -0,0 +1,98 @@
+// bodybvh.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Bounding volume hierarchy over the bodies of a frame tree.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "bodybvh.h"
+
+#include <algorithm>
+
+#include <Eigen/Geometry>
+
+#include "body.h"
+#include "frametree.h"
+#include "timelinephase.h"
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Maximum number of entries in a leaf
+constexpr std::uint32_t LeafSize = 4;
+
+void
+addBodies(const FrameTree& tree, double tdb, std::vector<BodyBVH::Entry>& entries)
+{
+    for (unsigned int i : tree.getActiveChildren(tdb))
+    {
+        const TimelinePhase* phase = tree.getChild(i);
+        Body* body = phase->body();
+        float radius = body->getRadius();
+        if (const RingSystem* rings = GetBodyFeaturesManager()->getRings(body); rings != nullptr)
+            radius = std::max(radius, rings->outerRadius);
+
+        entries.push_back({ body,
+                            body->getAstrocentricPosition(tdb),
+                            static_cast<double>(radius),
+                            static_cast<std::uint32_t>(entries.size()) });
+
+        if (const FrameTree* bodyTree = body->getFrameTree(); bodyTree != nullptr)
+            addBodies(*bodyTree, tdb, entries);
+    }
+}
+
+} // end unnamed namespace
+
+void
+BodyBVH::build(const FrameTree& tree, double tdb)
+{
+    m_tdb = tdb;
+    m_entries.clear();
+    m_nodes.clear();
+
+    addBodies(tree, tdb, m_entries);
+    if (!m_entries.empty())
+        buildNode(0, static_cast<std::uint32_t>(m_entries.size()));
+}
+
+std::uint32_t
+BodyBVH::buildNode(std::uint32_t first, std::uint32_t last)
+{
+    Eigen::AlignedBox3d box;
+    for (std::uint32_t i = first; i < last; i++)
+        box.extend(m_entries[i].position);
+
+    Eigen::Vector3d center = box.center();
+    double radius = 0.0;
+    for (std::uint32_t i = first; i < last; i++)
+        radius = std::max(radius, (m_entries[i].position - center).norm() + m_entries[i].radius);
+
+    auto index = static_cast<std::uint32_t>(m_nodes.size());
+    m_nodes.push_back({ math::Sphered(center, radius), first, last - first });
+    if (last - first <= LeafSize)
+        return index;
+
+    // Split at the median along the longest axis of the box
+    Eigen::Index axis;
+    box.sizes().maxCoeff(&axis);
+    std::uint32_t middle = first + (last - first) / 2;
+    std::nth_element(m_entries.begin() + first, m_entries.begin() + middle, m_entries.begin() + last,
+                     [axis](const Entry& a, const Entry& b) { return a.position[axis] < b.position[axis]; });
+
+    buildNode(first, middle);
+    std::uint32_t second = buildNode(middle, last);
+    m_nodes[index].first = second;
+    m_nodes[index].count = 0;
+
+    return index;
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,115 @@
+// bodybvh.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Bounding volume hierarchy over the bodies of a frame tree.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celmath/sphere.h>
+
+class Body;
+class FrameTree;
+
+namespace celestia::engine
+{
+
+// A hierarchy of bounding spheres over the bodies of a frame tree and all
+// of its subtrees, at one instant. Queries which look for the few bodies
+// near a ray, such as picking or the search for eclipse shadow casters,
+// visit only the nodes whose spheres pass a test instead of computing the
+// position of every body in the tree.
+//
+// The hierarchy contains each body whose timeline phase includes the time
+// it was built for, with its astrocentric position and its radius, or the
+// outer radius of its rings if that is larger. Bodies aren't filtered by
+// visibility: the queries apply their own tests.
+class BodyBVH
+{
+public:
+    struct Entry
+    {
+        Body* body;
+        Eigen::Vector3d position;
+        double radius;
+        // Position of the body in a depth first traversal of the frame
+        // tree, for queries which must give the same result as one
+        std::uint32_t order;
+    };
+
+    void build(const FrameTree& tree, double tdb);
+
+    double getTime() const { return m_tdb; }
+    const std::vector<Entry>& getEntries() const { return m_entries; }
+
+    // Call visit(entry) for each entry whose sphere, and the spheres of all
+    // enclosing nodes, pass test(sphere). The test must be conservative:
+    // it may accept a sphere which doesn't contain a match, but must not
+    // reject one that does.
+    template<typename T, typename F>
+    void traverse(T&& test, F&& visit) const;
+
+private:
+    struct Node
+    {
+        math::Sphered bounds;
+        std::uint32_t first; // first entry of a leaf, or index of the second child
+        std::uint32_t count; // number of entries of a leaf, or zero
+    };
+
+    std::uint32_t buildNode(std::uint32_t first, std::uint32_t last);
+
+    double m_tdb{ 0.0 };
+    std::vector<Entry> m_entries;
+    std::vector<Node> m_nodes;
+};
+
+template<typename T, typename F>
+void
+BodyBVH::traverse(T&& test, F&& visit) const
+{
+    if (m_nodes.empty())
+        return;
+
+    // The tree is built by median splits, so its depth is at most the
+    // number of bits in the entry count
+    std::array<std::uint32_t, 64> stack;
+    std::size_t top = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const Node& node = m_nodes[stack[--top]];
+        if (!test(node.bounds))
+            continue;
+
+        if (node.count > 0)
+        {
+            for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+            {
+                const Entry& entry = m_entries[i];
+                if (test(math::Sphered(entry.position, entry.radius)))
+                    visit(entry);
+            }
+        }
+        else
+        {
+            // The first child immediately follows its parent
+            stack[top++] = node.first;
+            stack[top++] = static_cast<std::uint32_t>(&node - m_nodes.data()) + 1;
+        }
+    }
+}
+
+} // end namespace celestia::engine
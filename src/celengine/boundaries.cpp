@@ -10,7 +10,11 @@
 
 #include "boundaries.h"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <istream>
+#include <ostream>
 #include <string>
 #include <string_view>
 #include <system_error>
@@ -18,6 +22,8 @@
 
 #include <celastro/astro.h>
 #include <celcompat/charconv.h>
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
 
 using namespace std::string_view_literals;
 namespace astro = celestia::astro;
@@ -29,6 +35,10 @@ constexpr std::string_view Whitespace = " \t"sv;
 
 constexpr float BoundariesDrawDistance = 10000.0f;
 
+// Binary form: the magic, the number of chains and for each chain the
+// number of vertices followed by their coordinates, all little-endian
+constexpr std::array<char, 8> BinaryMagic = { 'C', 'E', 'L', 'B', 'N', 'D', 'C', '1' };
+
 void
 trimLeadingWhitespace(std::string_view& str)
 {
@@ -133,3 +143,74 @@ ReadBoundaries(std::istream& in)
 
     return std::make_unique<ConstellationBoundaries>(std::move(chains));
 }
+
+std::unique_ptr<ConstellationBoundaries>
+ReadBinaryBoundaries(const char* data, std::size_t size)
+{
+    using celestia::util::fromMemoryLE;
+
+    if (size < BinaryMagic.size() + sizeof(std::uint32_t)
+        || !std::equal(BinaryMagic.begin(), BinaryMagic.end(), data))
+    {
+        return nullptr;
+    }
+
+    const char* end = data + size;
+    data += BinaryMagic.size();
+    auto nChains = fromMemoryLE<std::uint32_t>(data);
+    data += sizeof(std::uint32_t);
+
+    std::vector<ConstellationBoundaries::Chain> chains;
+    chains.reserve(std::min(static_cast<std::size_t>(nChains), size / sizeof(std::uint32_t)));
+    for (std::uint32_t i = 0; i < nChains; ++i)
+    {
+        if (static_cast<std::size_t>(end - data) < sizeof(std::uint32_t))
+            return nullptr;
+
+        auto nVertices = fromMemoryLE<std::uint32_t>(data);
+        data += sizeof(std::uint32_t);
+        if (static_cast<std::size_t>(end - data) / (3 * sizeof(float)) < nVertices)
+            return nullptr;
+
+        auto& chain = chains.emplace_back();
+        chain.reserve(nVertices);
+        for (std::uint32_t j = 0; j < nVertices; ++j, data += 3 * sizeof(float))
+        {
+            chain.emplace_back(fromMemoryLE<float>(data),
+                               fromMemoryLE<float>(data + sizeof(float)),
+                               fromMemoryLE<float>(data + 2 * sizeof(float)));
+        }
+    }
+
+    if (data != end)
+        return nullptr;
+
+    return std::make_unique<ConstellationBoundaries>(std::move(chains));
+}
+
+bool
+WriteBinaryBoundaries(std::ostream& out, const ConstellationBoundaries& boundaries)
+{
+    using celestia::util::writeLE;
+
+    const auto& chains = boundaries.getChains();
+    if (!out.write(BinaryMagic.data(), BinaryMagic.size()).good()
+        || !writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(chains.size())))
+    {
+        return false;
+    }
+
+    for (const auto& chain : chains)
+    {
+        if (!writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(chain.size())))
+            return false;
+
+        for (const auto& vertex : chain)
+        {
+            if (!writeLE(out, vertex.x()) || !writeLE(out, vertex.y()) || !writeLE(out, vertex.z()))
+                return false;
+        }
+    }
+
+    return true;
+}
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iosfwd>
 #include <memory>
 #include <vector>
@@ -35,3 +36,9 @@ class ConstellationBoundaries
 };
 
 std::unique_ptr<ConstellationBoundaries> ReadBoundaries(std::istream&);
+
+// The binary form of the boundaries holds the vertices of the chains as
+// they are drawn, so reading it needs no parsing or conversion. Returns
+// nullptr if the data is not valid.
+std::unique_ptr<ConstellationBoundaries> ReadBinaryBoundaries(const char* data, std::size_t size);
+bool WriteBinaryBoundaries(std::ostream&, const ConstellationBoundaries&);
@@ -11,13 +11,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <utility>
 
 #include <celmath/geomutil.h>
 #include <celttf/truetypefont.h>
 #include <celutil/color.h>
 #include "glsupport.h"
 #include "render.h"
-#include "shadermanager.h"
 
 namespace math = celestia::math;
 
@@ -32,6 +32,17 @@ constexpr int pmod(int n, int m)
 }
 
 
+bool Console::RetainedKey::operator==(const RetainedKey& other) const
+{
+    return revision == other.revision &&
+           font == other.font &&
+           rowHeight == other.rowHeight &&
+           x == other.x &&
+           y == other.y &&
+           color == other.color;
+}
+
+
 Console::Console(Renderer& _renderer, int _nRows, int _nColumns) :
     std::ostream(&sbuf),
     nRows(_nRows),
@@ -56,6 +67,7 @@ bool Console::setRowCount(int _nRows)
 
     text.resize((nColumns + 1) * _nRows, u'\0');
     nRows = _nRows;
+    ++revision;
 
     return true;
 }
@@ -77,35 +89,50 @@ void Console::begin()
 
 void Console::end()
 {
-    if (font != nullptr)
-        font->unbind();
 }
 
 
+/*! Draw rowHeight rows of the log. The rows are laid out into a vertex
+ *  buffer which is drawn again in the following frames until the text,
+ *  the scroll position or the appearance of the console changes.
+ */
 void Console::render(int rowHeight)
 {
     if (font == nullptr)
         return;
 
-    font->bind();
-    font->setMVPMatrices(projection);
-    savePos();
-    for (int i = 0; i < rowHeight; i++)
+    RetainedKey key{ revision, font, rowHeight, global.x, global.y, color };
+    if (!(key == retainedKey) || !retainedText.isCurrent())
     {
-        //int r = (nRows - rowHeight + 1 + windowRow + i) % nRows;
-        int r = pmod(row + windowRow + i, nRows);
-        std::u16string_view line{text.data() + (r * (nColumns + 1)), static_cast<std::size_t>(nColumns)};
-        if (auto endpos = line.find(u'\0'); endpos != std::u16string_view::npos)
-            line = line.substr(0, endpos);
-
-        font->render(line, global.x, global.y);
-
-        // advance to the next line
-        restorePos();
-        global.y -= 1.0f + font->getHeight();
-        savePos();
+        retainedKey = std::move(key);
+
+        // Loading a glyph which wasn't used before rebuilds the atlas,
+        // which moves the glyphs laid out earlier
+        do
+        {
+            retainedText.clear();
+            retainedText.setColor(color);
+            savePos();
+            for (int i = 0; i < rowHeight; i++)
+            {
+                //int r = (nRows - rowHeight + 1 + windowRow + i) % nRows;
+                int r = pmod(row + windowRow + i, nRows);
+                std::u16string_view line{text.data() + (r * (nColumns + 1)), static_cast<std::size_t>(nColumns)};
+                if (auto endpos = line.find(u'\0'); endpos != std::u16string_view::npos)
+                    line = line.substr(0, endpos);
+
+                retainedText.add(font, line, global.x, global.y);
+
+                // advance to the next line
+                restorePos();
+                global.y -= 1.0f + font->getHeight();
+                savePos();
+            }
+            restorePos();
+        } while (!retainedText.isCurrent());
     }
-    restorePos();
+
+    retainedText.draw(projection);
 }
 
 
@@ -118,12 +145,7 @@ void Console::setScale(int w, int h)
 
 void Console::setFont(const std::shared_ptr<TextureFont>& f)
 {
-    if (f != font)
-    {
-        if (font != nullptr)
-            font->flush();
-        font = f;
-    }
+    font = f;
 }
 
 
@@ -134,6 +156,7 @@ void Console::newline()
 
     text[row * (nColumns + 1) + column] = '\0';
     row = (row + 1) % nRows;
+    ++revision;
     column = 0;
 
     if (autoScroll)
@@ -152,6 +175,7 @@ void Console::print(char16_t c)
             newline();
         text[row * (nColumns + 1) + column] = c;
         column++;
+        ++revision;
     }
 }
 
@@ -165,6 +189,7 @@ int Console::getWindowRow() const
 void Console::setWindowRow(int _row)
 {
     windowRow = _row;
+    ++revision;
 }
 
 
@@ -186,21 +211,15 @@ int Console::getHeight() const
 }
 
 
-void Console::setColor(float r, float g, float b, float a) const
+void Console::setColor(float r, float g, float b, float a)
 {
-    if (font != nullptr)
-        font->flush();
-    glVertexAttrib4f(CelestiaGLProgram::ColorAttributeIndex, r, g, b, a);
+    color = Color(r, g, b, a);
 }
 
 
-void Console::setColor(const Color& c) const
+void Console::setColor(const Color& c)
 {
-    if (font != nullptr)
-        font->flush();
-    glVertexAttrib4f(CelestiaGLProgram::ColorAttributeIndex,
-                     c.red(), c.green(), c.blue(), c.alpha());
-
+    color = c;
 }
 
 
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <streambuf>
@@ -17,9 +18,10 @@
 
 #include <Eigen/Core>
 
+#include <celengine/retainedtext.h>
+#include <celutil/color.h>
 #include <celutil/utf8.h>
 
-class Color;
 class Console;
 class TextureFont;
 
@@ -62,8 +64,8 @@ class Console : public std::ostream
 
     void setScale(int, int);
     void setFont(const std::shared_ptr<TextureFont>&);
-    void setColor(float r, float g, float b, float a) const;
-    void setColor(const Color& c) const;
+    void setColor(float r, float g, float b, float a);
+    void setColor(const Color& c);
 
     void moveBy(float dx, float dy);
     void setWindowHeight(int);
@@ -95,8 +97,27 @@ class Console : public std::ostream
     int xscale{ 1 };
     int yscale{ 1 };
     std::shared_ptr<TextureFont> font{ nullptr };
+    Color color{ 1.0f, 1.0f, 1.0f, 1.0f };
     Renderer& renderer;
 
+    // Changed whenever the text or the scroll position is
+    std::uint64_t revision{ 0 };
+
+    // What the retained text was laid out from
+    struct RetainedKey
+    {
+        std::uint64_t revision{ 0 };
+        std::shared_ptr<TextureFont> font{ nullptr };
+        int rowHeight{ 0 };
+        float x{ 0.0f };
+        float y{ 0.0f };
+        Color color{};
+
+        bool operator==(const RetainedKey&) const;
+    };
+    RetainedKey retainedKey{ };
+    celestia::engine::RetainedText retainedText;
+
     ConsoleStreamBuf sbuf;
 
     bool autoScroll{ true };
@@ -31,6 +31,8 @@
 #include <cmath>
 #include <memory>
 #include <vector>
+#include <celrender/gl/buffer.h>
+#include <celrender/gl/vertexobject.h>
 #include <celrender/linerenderer.h>
 
 #include "curveplot.h"
@@ -38,6 +40,7 @@
 #include "shadermanager.h"
 
 using celestia::render::LineRenderer;
+namespace gl = celestia::gl;
 
 namespace
 {
@@ -45,6 +48,17 @@ constexpr unsigned int VertexBufferCapacity = 4096;
 constexpr unsigned int SubdivisionFactor = 8;
 constexpr double InvSubdivisionFactor = 1.0 / static_cast<double>(SubdivisionFactor);
 constexpr float OrbitThickness = 1.0f;
+// Relative error of positions computed in single precision on the GPU,
+// with a margin for the transformations
+constexpr double DeviceRelativeError = 2.5e-7;
+
+// A sample as stored in the GPU buffer: the position relative to the
+// center and the time relative to the first sample, and the velocity
+struct DeviceSample
+{
+    Eigen::Vector4f position;
+    Eigen::Vector4f velocity;
+};
 
 // Convert a 3-vector to a 4-vector by adding a zero
 inline Eigen::Vector4d
@@ -338,11 +352,28 @@ HighPrec_VertexBuffer vbuf;
 } // end unnamed namespace
 
 
+struct CurvePlot::DeviceSamples
+{
+    gl::Buffer bo{ gl::Buffer::TargetHint::Array };
+    gl::VertexObject vo{ gl::VertexObject::Primitive::LineStrip };
+    bool initialized{ false };
+    int segmentCount{ 0 };
+    double baseTime{ 0.0 };
+    // Bounds of the distance of the curve from the center, and the largest
+    // segment bounding radius
+    double minRadius{ 0.0 };
+    double maxRadius{ 0.0 };
+    double maxSegmentRadius{ 0.0 };
+};
+
+
 CurvePlot::CurvePlot(const Renderer &renderer) :
     m_renderer(renderer)
 {
 }
 
+CurvePlot::~CurvePlot() = default;
+
 void
 CurvePlot::deinit()
 {
@@ -377,6 +408,7 @@ CurvePlot::addSample(const CurvePlotSample& sample)
         m_samples.push_back(sample);
     else
         m_samples.push_front(sample);
+    m_samplesChanged = true;
 
     if (m_samples.size() > 1)
     {
@@ -418,6 +450,7 @@ CurvePlot::removeSamplesBefore(double t)
     while (!m_samples.empty() && m_samples.front().t < t)
     {
         m_samples.pop_front();
+        m_samplesChanged = true;
     }
 }
 
@@ -430,6 +463,7 @@ CurvePlot::removeSamplesAfter(double t)
     while (!m_samples.empty() && m_samples.back().t > t)
     {
         m_samples.pop_back();
+        m_samplesChanged = true;
     }
 }
 
@@ -893,3 +927,137 @@ CurvePlot::renderFaded(const Eigen::Affine3d& modelview,
     vbuf.flush();
     vbuf.finish();
 }
+
+
+/** Upload the samples to the GPU buffer if they have changed since the last
+  * upload. Return false if there are too few samples to draw.
+  */
+bool
+CurvePlot::updateDeviceSamples() const
+{
+    if (m_deviceSamples == nullptr)
+        m_deviceSamples = std::make_unique<DeviceSamples>();
+    DeviceSamples& device = *m_deviceSamples;
+
+    if (m_samplesChanged)
+    {
+        m_samplesChanged = false;
+
+        device.segmentCount = std::max(static_cast<int>(m_samples.size()) - 1, 0);
+        if (device.segmentCount == 0)
+            return false;
+
+        device.baseTime = m_samples.front().t;
+        device.minRadius = m_samples.front().position.norm();
+        device.maxRadius = device.minRadius;
+        device.maxSegmentRadius = 0.0;
+
+        std::vector<DeviceSample> samples;
+        samples.reserve(m_samples.size());
+        double lastRadius = device.minRadius;
+        for (const CurvePlotSample& sample : m_samples)
+        {
+            // The bounding radius of a segment is stored with its end
+            // sample, but is measured from its start
+            device.minRadius = std::min(device.minRadius, lastRadius - sample.boundingRadius);
+            device.maxRadius = std::max(device.maxRadius, lastRadius + sample.boundingRadius);
+            device.maxSegmentRadius = std::max(device.maxSegmentRadius, sample.boundingRadius);
+            lastRadius = sample.position.norm();
+            device.maxRadius = std::max(device.maxRadius, lastRadius);
+
+            Eigen::Vector3f position = sample.position.cast<float>();
+            Eigen::Vector3f velocity = sample.velocity.cast<float>();
+            samples.push_back({ Eigen::Vector4f(position.x(), position.y(), position.z(),
+                                                static_cast<float>(sample.t - device.baseTime)),
+                                Eigen::Vector4f(velocity.x(), velocity.y(), velocity.z(), 0.0f) });
+        }
+
+        device.bo.setData(samples, gl::Buffer::BufferUsage::StaticDraw);
+    }
+
+    return device.segmentCount > 0;
+}
+
+
+bool
+CurvePlot::renderFromBuffer(const Eigen::Affine3d& modelview,
+                            double subdivisionThreshold,
+                            double pixelSize,
+                            double startTime,
+                            double endTime,
+                            const Eigen::Vector4f& color,
+                            double fadeStartTime,
+                            double fadeEndTime) const
+{
+    if (!gl::hasInstancing())
+        return false;
+
+    // Wide lines are drawn as triangles by the line renderer
+    float lineWidth = OrbitThickness * m_renderer.getScaleFactor();
+    if ((m_renderer.getRenderFlags() & Renderer::ShowSmoothLines) != 0)
+        lineWidth *= 1.5f;
+    if (lineWidth > gl::maxLineWidth)
+        return false;
+
+    if (m_samples.empty() || endTime <= m_samples.front().t || startTime >= m_samples.back().t)
+        return true;
+
+    if (!updateDeviceSamples())
+        return true;
+    const DeviceSamples& device = *m_deviceSamples;
+
+    // The center of the curve is at the translation of the modelview
+    // matrix; its distance from the camera bounds that of the curve. Use
+    // the GPU only if single precision errors stay below half a pixel and
+    // the fixed subdivision of the segments is fine enough.
+    double centerDistance = modelview.translation().norm();
+    double minDistance = std::max(centerDistance - device.maxRadius, device.minRadius - centerDistance);
+    if (minDistance <= 0.0 ||
+        DeviceRelativeError * (device.maxRadius + centerDistance) >= 0.5 * pixelSize * minDistance ||
+        device.maxSegmentRadius * InvSubdivisionFactor >= subdivisionThreshold * minDistance)
+    {
+        return false;
+    }
+
+    CelestiaGLProgram* prog = m_renderer.getShaderManager().getShaderGL3("orbitpath");
+    if (prog == nullptr)
+        return false;
+
+    if (!device.initialized)
+    {
+        m_deviceSamples->initialized = true;
+
+        // Each instance is a segment: the attributes of its end point are
+        // those of the start point of the next one
+        constexpr int stride = sizeof(DeviceSample);
+        auto& vo = m_deviceSamples->vo;
+        vo.addInstanceBuffer(device.bo, CelestiaGLProgram::VertexCoordAttributeIndex,
+                             4, gl::VertexObject::DataType::Float, false, stride,
+                             offsetof(DeviceSample, position));
+        vo.addInstanceBuffer(device.bo, prog->attribIndex("in_StartVelocity"),
+                             4, gl::VertexObject::DataType::Float, false, stride,
+                             offsetof(DeviceSample, velocity));
+        vo.addInstanceBuffer(device.bo, prog->attribIndex("in_End"),
+                             4, gl::VertexObject::DataType::Float, false, stride,
+                             stride + offsetof(DeviceSample, position));
+        vo.addInstanceBuffer(device.bo, prog->attribIndex("in_EndVelocity"),
+                             4, gl::VertexObject::DataType::Float, false, stride,
+                             stride + offsetof(DeviceSample, velocity));
+    }
+
+    double fadeRate = fadeEndTime != fadeStartTime ? 1.0 / (fadeEndTime - fadeStartTime) : 0.0;
+
+    prog->use();
+    prog->setMVPMatrices(m_renderer.getCurrentProjectionMatrix(), modelview.matrix().cast<float>());
+    prog->floatParam("subdivisions") = static_cast<float>(SubdivisionFactor);
+    prog->vec4Param("color") = color;
+    prog->vec2Param("timeWindow") = Eigen::Vector2f(static_cast<float>(startTime - device.baseTime),
+                                                     static_cast<float>(endTime - device.baseTime));
+    prog->vec2Param("fade") = Eigen::Vector2f(static_cast<float>(fadeStartTime - device.baseTime),
+                                               static_cast<float>(fadeRate));
+
+    glLineWidth(lineWidth);
+    m_deviceSamples->vo.drawInstanced(SubdivisionFactor + 1, device.segmentCount);
+
+    return true;
+}
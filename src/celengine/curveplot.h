@@ -30,6 +30,7 @@
 #pragma once
 
 #include <deque>
+#include <memory>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -53,6 +54,7 @@ class CurvePlot
 {
  public:
     explicit CurvePlot(const Renderer &renderer);
+    ~CurvePlot();
 
     double duration() const { return m_duration; }
     void setDuration(double duration);
@@ -92,6 +94,23 @@ class CurvePlot
                      double fadeStartTime,
                      double fadeEndTime) const;
 
+    // Draw the part of the curve between startTime and endTime from samples
+    // kept in a GPU buffer, evaluating the cubics in the vertex shader. The
+    // buffer is only uploaded again after samples are added or removed.
+    // Points are faded as by renderFaded() unless fadeStartTime equals
+    // fadeEndTime. Single precision is only good enough when the camera is
+    // far from the curve compared with its size; return false without
+    // drawing anything when it isn't, or when instancing isn't supported,
+    // and the caller should use one of the other render methods instead.
+    bool renderFromBuffer(const Eigen::Affine3d& modelview,
+                          double subdivisionThreshold,
+                          double pixelSize,
+                          double startTime,
+                          double endTime,
+                          const Eigen::Vector4f& color,
+                          double fadeStartTime,
+                          double fadeEndTime) const;
+
     unsigned int lastUsed() const { return m_lastUsed; }
     void setLastUsed(unsigned int lastUsed) { m_lastUsed = lastUsed; }
 
@@ -106,9 +125,16 @@ class CurvePlot
     static void deinit();
 
  private:
+    struct DeviceSamples;
+
+    bool updateDeviceSamples() const;
+
     std::deque<CurvePlotSample>     m_samples;
     const Renderer                 &m_renderer;
     double                          m_duration      { 0.0 };
     unsigned int                    m_lastUsed      { 0   };
+    // samples uploaded for renderFromBuffer(), valid until m_samples changes
+    mutable std::unique_ptr<DeviceSamples> m_deviceSamples;
+    mutable bool                    m_samplesChanged { true };
 };
 
@@ -0,0 +1,238 @@
+// distantstarcache.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Point stars far from the observer, drawn from a buffer kept over frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "distantstarcache.h"
+
+#include "pointstarrenderer.h"
+#include "star.h"
+#include "stardb.h"
+#include "staroctree.h"
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+double
+distanceFrom(const Eigen::Vector3d &position, const Eigen::Vector3f &starPosition)
+{
+    return (starPosition.cast<double>() - position).norm();
+}
+
+// Collects the vertices of the stars farther than nearDistance, for an
+// observer at the position of the cache
+class CacheBuilder : public StarRecordHandler
+{
+public:
+    CacheBuilder(const PointStarRenderer &starRenderer, double nearDistance) :
+        m_starRenderer(starRenderer),
+        m_nearDistance(nearDistance)
+    {
+    }
+
+    void process(const Star&, const StarRenderRecord &record, float distance, float appMag) override
+    {
+        if (distanceFrom(m_starRenderer.obsPos, record.position) <= m_nearDistance)
+            return;
+
+        m_starRenderer.stageStar(record, distance, appMag, stars, glare);
+        ++count;
+    }
+
+    PointStarVertexBuffer::Staging stars;
+    PointStarVertexBuffer::Staging glare;
+    std::uint32_t count{ 0 };
+
+private:
+    const PointStarRenderer &m_starRenderer;
+    double m_nearDistance;
+};
+
+// Passes the stars which are close to the position of the cache
+class NearStarFilter : public StarHandler
+{
+public:
+    NearStarFilter(PointStarRenderer &starRenderer,
+                   const Eigen::Vector3d &position,
+                   double nearDistance,
+                   float limitingMag) :
+        m_starRenderer(starRenderer),
+        m_position(position),
+        m_nearDistance(nearDistance),
+        m_limitingMag(limitingMag)
+    {
+    }
+
+    void process(const Star &star, float distance, float appMag) override
+    {
+        if (distanceFrom(m_position, star.getPosition()) > m_nearDistance)
+            return;
+
+        if (appMag <= m_limitingMag || star.getOrbit() != nullptr)
+            m_starRenderer.process(star, distance, appMag);
+    }
+
+private:
+    PointStarRenderer &m_starRenderer;
+    Eigen::Vector3d m_position;
+    double m_nearDistance;
+    float m_limitingMag;
+};
+
+// Passes the stars which are in the cache
+class DistantStarFilter : public StarRecordHandler
+{
+public:
+    DistantStarFilter(PointStarRenderer &starRenderer,
+                      const Eigen::Vector3d &position,
+                      double nearDistance) :
+        m_starRenderer(starRenderer),
+        m_position(position),
+        m_nearDistance(nearDistance)
+    {
+    }
+
+    void process(const Star &star, const StarRenderRecord &record, float distance, float appMag) override
+    {
+        if (distanceFrom(m_position, record.position) > m_nearDistance)
+            m_starRenderer.process(star, record, distance, appMag);
+    }
+
+private:
+    PointStarRenderer &m_starRenderer;
+    Eigen::Vector3d m_position;
+    double m_nearDistance;
+};
+
+} // end unnamed namespace
+
+bool
+DistantStarCache::Key::operator==(const Key &other) const
+{
+    return starDB == other.starDB
+        && nStars == other.nStars
+        && colorTable == other.colorTable
+        && faintestMag == other.faintestMag
+        && limitingMag == other.limitingMag
+        && brightnessScale == other.brightnessScale
+        && brightnessBias == other.brightnessBias
+        && saturationMag == other.saturationMag
+        && baseSize == other.baseSize
+        && distanceLimit == other.distanceLimit
+        && scaledDiscs == other.scaledDiscs;
+}
+
+DistantStarCache::DistantStarCache(float nearDistance, float maxTranslation) :
+    m_nearDistance(nearDistance),
+    m_maxTranslation(maxTranslation)
+{
+}
+
+bool
+DistantStarCache::update(const StarDatabase &starDB,
+                         const PointStarRenderer &starRenderer,
+                         const Eigen::Vector3d &obsPos,
+                         const Key &key,
+                         OctreeTraversalStats *stats)
+{
+    if (m_valid && key == m_key && inRange(m_position, obsPos))
+        return true;
+
+    if (!m_hasCandidate || key != m_candidateKey || !inRange(m_candidatePosition, obsPos))
+    {
+        m_hasCandidate = true;
+        m_candidatePosition = obsPos;
+        m_candidateKey = key;
+        return false;
+    }
+
+    CacheBuilder builder(starRenderer, m_nearDistance);
+    starDB.findAllVisibleStarRecords(builder, obsPos.cast<float>(), key.limitingMag, stats);
+    m_stars.set(builder.stars);
+    m_glare.set(builder.glare);
+    m_starCount = builder.count;
+
+    m_valid = true;
+    m_position = obsPos;
+    m_key = key;
+    m_hasCandidate = false;
+    ++m_rebuilds;
+    return true;
+}
+
+void
+DistantStarCache::findNearStars(const StarDatabase &starDB,
+                                PointStarRenderer &starRenderer,
+                                const Eigen::Vector3d &obsPos,
+                                float limitingMag) const
+{
+    // Every star within nearDistance of the position of the cache is within
+    // this radius of the observer
+    auto radius = static_cast<float>(m_nearDistance + (obsPos - m_position).norm());
+    NearStarFilter filter(starRenderer, m_position, m_nearDistance, limitingMag);
+    starDB.findCloseStars(filter, obsPos.cast<float>(), radius);
+}
+
+void
+DistantStarCache::findDistantStars(const StarDatabase &starDB,
+                                   PointStarRenderer &starRenderer,
+                                   const Eigen::Vector3d &obsPos,
+                                   const Eigen::Quaternionf &obsOrientation,
+                                   float fovY,
+                                   float aspectRatio,
+                                   float limitingMag,
+                                   OctreeTraversalStats *stats) const
+{
+    bool labelsOnly = starRenderer.labelsOnly;
+    starRenderer.labelsOnly = true;
+
+    DistantStarFilter filter(starRenderer, m_position, m_nearDistance);
+    starDB.findVisibleStarRecords(filter,
+                                  obsPos.cast<float>(),
+                                  obsOrientation,
+                                  fovY,
+                                  aspectRatio,
+                                  limitingMag,
+                                  nullptr,
+                                  stats);
+
+    starRenderer.labelsOnly = labelsOnly;
+}
+
+void
+DistantStarCache::render(PointStarVertexBuffer &starBuffer,
+                         PointStarVertexBuffer &glareBuffer,
+                         const Eigen::Vector3d &obsPos) const
+{
+    // The vertices are relative to the position of the cache
+    Eigen::Vector3f offset = (m_position - obsPos).cast<float>();
+    glareBuffer.render(m_glare, offset);
+    starBuffer.render(m_stars, offset);
+}
+
+void
+DistantStarCache::clear()
+{
+    m_valid = false;
+    m_hasCandidate = false;
+    m_stars.clear();
+    m_glare.clear();
+    m_starCount = 0;
+}
+
+bool
+DistantStarCache::inRange(const Eigen::Vector3d &position, const Eigen::Vector3d &obsPos) const
+{
+    return (obsPos - position).norm() <= static_cast<double>(m_maxTranslation);
+}
+
+} // end namespace celestia::engine
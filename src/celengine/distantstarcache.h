@@ -0,0 +1,128 @@
+// distantstarcache.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Point stars far from the observer, drawn from a buffer kept over frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celengine/pointstarvertexbuffer.h>
+#include <celengine/starcolors.h>
+
+class PointStarRenderer;
+class StarDatabase;
+
+namespace celestia::engine
+{
+
+struct OctreeTraversalStats;
+
+// The point stars farther than nearDistance from a position, in every
+// direction, are found once and their vertices kept on the graphics card.
+// While the observer stays within maxTranslation of that position and the
+// magnitude settings are unchanged, they are drawn from there, displaced by
+// the observer's offset, so only the stars close to the position and the
+// labels must be found each frame. Rotations and changes of the field of
+// view don't affect the cache.
+class DistantStarCache
+{
+public:
+    // Settings of the renderer which the cached vertices depend on
+    struct Key
+    {
+        const StarDatabase *starDB{ nullptr };
+        std::uint32_t nStars{ 0 };
+        ColorTableType colorTable{ ColorTableType::Enhanced };
+        float faintestMag{ 0.0f };
+        float limitingMag{ 0.0f };
+        float brightnessScale{ 0.0f };
+        float brightnessBias{ 0.0f };
+        float saturationMag{ 0.0f };
+        float baseSize{ 0.0f };
+        float distanceLimit{ 0.0f };
+        bool scaledDiscs{ false };
+
+        bool operator==(const Key &other) const;
+        bool operator!=(const Key &other) const { return !(*this == other); }
+    };
+
+    DistantStarCache(float nearDistance, float maxTranslation);
+    ~DistantStarCache() = default;
+    DistantStarCache(const DistantStarCache&) = delete;
+    DistantStarCache& operator=(const DistantStarCache&) = delete;
+
+    // Return true if the cache can be used for an observer at obsPos with
+    // the settings of key. When the observer has moved out of its range it
+    // is rebuilt, with starRenderer positioned at obsPos, but only once the
+    // observer stays in one place for two frames: while it moves fast, or
+    // the settings keep changing, false is returned and the stars must be
+    // found as usual.
+    bool update(const StarDatabase &starDB,
+                const PointStarRenderer &starRenderer,
+                const Eigen::Vector3d &obsPos,
+                const Key &key,
+                OctreeTraversalStats *stats = nullptr);
+
+    // Pass the stars not in the cache, those close to its position, to the
+    // star renderer
+    void findNearStars(const StarDatabase &starDB,
+                       PointStarRenderer &starRenderer,
+                       const Eigen::Vector3d &obsPos,
+                       float limitingMag) const;
+
+    // Pass the stars of the cache which may be in view and brighter than
+    // limitingMag to the star renderer, which only places their labels
+    void findDistantStars(const StarDatabase &starDB,
+                          PointStarRenderer &starRenderer,
+                          const Eigen::Vector3d &obsPos,
+                          const Eigen::Quaternionf &obsOrientation,
+                          float fovY,
+                          float aspectRatio,
+                          float limitingMag,
+                          OctreeTraversalStats *stats = nullptr) const;
+
+    // Draw the cached stars for an observer at obsPos
+    void render(PointStarVertexBuffer &starBuffer,
+                PointStarVertexBuffer &glareBuffer,
+                const Eigen::Vector3d &obsPos) const;
+
+    void clear();
+
+    // Number of stars in the cache
+    std::uint32_t getStarCount() const { return m_starCount; }
+    // Number of times the cache was built
+    std::uint64_t getRebuildCount() const { return m_rebuilds; }
+
+private:
+    bool inRange(const Eigen::Vector3d &position, const Eigen::Vector3d &obsPos) const;
+
+    float m_nearDistance;
+    float m_maxTranslation;
+
+    bool m_valid{ false };
+    Eigen::Vector3d m_position{ Eigen::Vector3d::Zero() };
+    Key m_key;
+
+    // Position and settings of the last frame for which the cache could not
+    // be used, to tell whether the observer has stopped
+    bool m_hasCandidate{ false };
+    Eigen::Vector3d m_candidatePosition{ Eigen::Vector3d::Zero() };
+    Key m_candidateKey;
+
+    PointStarVertexBuffer::StaticBatch m_stars;
+    PointStarVertexBuffer::StaticBatch m_glare;
+    std::uint32_t m_starCount{ 0 };
+    std::uint64_t m_rebuilds{ 0 };
+};
+
+} // end namespace celestia::engine
@@ -14,16 +14,91 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <utility>
 
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
+#include <celutil/memoryreport.h>
+#include <celutil/parallelfor.h>
+#include "galaxy.h"
+#include "globular.h"
 #include "name.h"
+#include "nebula.h"
+#include "opencluster.h"
 
 namespace engine = celestia::engine;
 
 using celestia::util::GetLogger;
 
+namespace
+{
+
+constexpr engine::OctreeDepthType ParallelSubtreeDepth = 2;
+
+std::array<Eigen::Hyperplane<double, 3>, 5>
+computeFrustumPlanes(const Eigen::Vector3d& obsPos,
+                     const Eigen::Quaternionf& obsOrient,
+                     float fovY,
+                     float aspectRatio)
+{
+    // Compute the bounding planes of an infinite view frustum
+    std::array<Eigen::Hyperplane<double, 3>, 5> frustumPlanes;
+
+    Eigen::Quaterniond obsOrientd = obsOrient.cast<double>();
+    Eigen::Matrix3d rot = obsOrientd.toRotationMatrix().transpose();
+    double h = std::tan(fovY / 2);
+    double w = h * aspectRatio;
+
+    std::array<Eigen::Vector3d, 5> planeNormals
+    {
+        Eigen::Vector3d( 0,  1, -h),
+        Eigen::Vector3d( 0, -1, -h),
+        Eigen::Vector3d( 1,  0, -w),
+        Eigen::Vector3d(-1,  0, -w),
+        Eigen::Vector3d( 0,  0, -1),
+    };
+
+    for (int i = 0; i < 5; ++i)
+    {
+        planeNormals[i]  = rot * planeNormals[i].normalized();
+        frustumPlanes[i] = Eigen::Hyperplane<double, 3>(planeNormals[i], obsPos);
+    }
+
+    return frustumPlanes;
+}
+
+// Adapts the visible objects processor to the indexed traversal used to
+// split the octree between threads
+class IndexedDSOProcessor
+{
+public:
+    IndexedDSOProcessor(const engine::DSOOctree& octree, engine::DSOOctreeVisibleObjectsProcessor&& processor) :
+        m_octree(octree),
+        m_processor(std::move(processor))
+    {
+    }
+
+    bool checkNode(const engine::DSOOctree::PointType& center, double size, float factor)
+    {
+        return m_processor.checkNode(center, size, factor);
+    }
+
+    void process(engine::OctreeObjectIndex idx)
+    {
+        m_processor.process(m_octree[idx]);
+    }
+
+    const engine::OctreeTraversalStats& traversalStats() const { return m_processor.traversalStats(); }
+
+private:
+    const engine::DSOOctree& m_octree;
+    engine::DSOOctreeVisibleObjectsProcessor m_processor;
+};
+
+} // end unnamed namespace
+
 DSODatabase::~DSODatabase() = default;
 
 DSODatabase::DSODatabase(std::unique_ptr<engine::DSOOctree>&& octreeRoot,
@@ -87,13 +162,13 @@ DSODatabase::getDSOName(const DeepSkyObject* dso, [[maybe_unused]] bool i18n) co
 #ifdef ENABLE_NLS
     if (i18n)
     {
-        const char* local = D_(iter->second.c_str());
+        const char* local = D_(iter->second.data());
         if (iter->second != local)
             return local;
     }
 #endif
 
-    return iter->second;
+    return std::string(iter->second);
 }
 
 std::string
@@ -110,7 +185,7 @@ DSODatabase::getDSONameList(const DeepSkyObject* dso, const unsigned int maxName
         if (count != 0)
             dsoNames.append(" / ");
 
-        dsoNames.append(D_(iter->second.c_str()));
+        dsoNames.append(D_(iter->second.data()));
         ++iter;
         ++count;
     }
@@ -124,37 +199,85 @@ DSODatabase::findVisibleDSOs(engine::DSOHandler& dsoHandler,
                              const Eigen::Quaternionf& obsOrient,
                              float fovY,
                              float aspectRatio,
-                             float limitingMag) const
+                             float limitingMag,
+                             engine::OctreeTraversalStats* stats) const
 {
-    // Compute the bounding planes of an infinite view frustum
-    std::array<Eigen::Hyperplane<double, 3>, 5> frustumPlanes;
+    auto frustumPlanes = computeFrustumPlanes(obsPos, obsOrient, fovY, aspectRatio);
 
-    Eigen::Quaterniond obsOrientd = obsOrient.cast<double>();
-    Eigen::Matrix3d rot = obsOrientd.toRotationMatrix().transpose();
-    double h = std::tan(fovY / 2);
-    double w = h * aspectRatio;
+    engine::DSOOctreeVisibleObjectsProcessor processor(&dsoHandler,
+                                                       obsPos,
+                                                       frustumPlanes,
+                                                       limitingMag);
 
-    std::array<Eigen::Vector3d, 5> planeNormals
+    m_octreeRoot->processDepthFirst(processor);
+
+    if (stats != nullptr)
+        *stats += processor.traversalStats();
+}
+
+void
+DSODatabase::findVisibleDSOs(engine::DSOHandler& dsoHandler,
+                             celestia::util::array_view<engine::DSOHandler*> workerHandlers,
+                             const Eigen::Vector3d& obsPos,
+                             const Eigen::Quaternionf& obsOrient,
+                             float fovY,
+                             float aspectRatio,
+                             float limitingMag,
+                             engine::OctreeTraversalStats* stats) const
+{
+    if (workerHandlers.empty())
     {
-        Eigen::Vector3d( 0,  1, -h),
-        Eigen::Vector3d( 0, -1, -h),
-        Eigen::Vector3d( 1,  0, -w),
-        Eigen::Vector3d(-1,  0, -w),
-        Eigen::Vector3d( 0,  0, -1),
-    };
+        findVisibleDSOs(dsoHandler, obsPos, obsOrient, fovY, aspectRatio, limitingMag, stats);
+        return;
+    }
 
-    for (int i = 0; i < 5; ++i)
+    auto frustumPlanes = computeFrustumPlanes(obsPos, obsOrient, fovY, aspectRatio);
+    std::vector<engine::OctreeNodeIndex> subtrees;
     {
-        planeNormals[i]  = rot * planeNormals[i].normalized();
-        frustumPlanes[i] = Eigen::Hyperplane<double, 3>(planeNormals[i], obsPos);
+        IndexedDSOProcessor processor(*m_octreeRoot,
+                                      engine::DSOOctreeVisibleObjectsProcessor(&dsoHandler,
+                                                                               obsPos,
+                                                                               frustumPlanes,
+                                                                               limitingMag));
+        m_octreeRoot->processTopLevelsIndexed(processor, ParallelSubtreeDepth, subtrees);
+        if (stats != nullptr)
+            *stats += processor.traversalStats();
     }
 
-    engine::DSOOctreeVisibleObjectsProcessor processor(&dsoHandler,
-                                                       obsPos,
-                                                       frustumPlanes,
-                                                       limitingMag);
+    std::atomic<std::size_t> nextSubtree{ 0 };
+    std::vector<engine::OctreeTraversalStats> workerStats(workerHandlers.size());
+    auto worker = [&](std::size_t workerIndex)
+    {
+        IndexedDSOProcessor processor(*m_octreeRoot,
+                                      engine::DSOOctreeVisibleObjectsProcessor(workerHandlers[workerIndex],
+                                                                               obsPos,
+                                                                               frustumPlanes,
+                                                                               limitingMag));
+        for (;;)
+        {
+            std::size_t i = nextSubtree.fetch_add(1, std::memory_order_relaxed);
+            if (i >= subtrees.size())
+                break;
+            m_octreeRoot->processSubtreeIndexed(processor, subtrees[i]);
+        }
 
-    m_octreeRoot->processDepthFirst(processor);
+        workerStats[workerIndex] = processor.traversalStats();
+    };
+
+    // Each handler is used by one thread at a time; the calling thread and
+    // the compute pool run the workers
+    auto nWorkers = std::min(workerHandlers.size(), subtrees.size());
+    celestia::util::ParallelFor(nWorkers, 1, static_cast<unsigned int>(nWorkers), [&worker](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+            worker(i);
+    });
+
+    if (stats != nullptr)
+    {
+        for (const engine::OctreeTraversalStats& s : workerStats)
+            *stats += s;
+    }
 }
 
 void
@@ -168,3 +291,59 @@ DSODatabase::findCloseDSOs(engine::DSOHandler& dsoHandler,
 
     m_octreeRoot->processDepthFirst(processor);
 }
+
+void
+DSODatabase::reportMemoryUsage(celestia::util::MemoryReport& report) const
+{
+    using namespace std::string_view_literals;
+    constexpr std::string_view subsystem = "Deep sky database"sv;
+    constexpr std::array<std::string_view, 4> typeNames
+    {
+        "Galaxies"sv,
+        "Globular clusters"sv,
+        "Nebulae"sv,
+        "Open clusters"sv,
+    };
+
+    // The objects are allocated one by one and the octree holds pointers
+    // to them
+    std::array<std::size_t, 4> counts{};
+    std::array<std::size_t, 4> sizes{};
+    std::uint32_t nDSOs = size();
+    for (std::uint32_t i = 0; i < nDSOs; ++i)
+    {
+        const DeepSkyObject* dso = getDSO(i);
+        auto type = static_cast<std::size_t>(dso->getObjType());
+        ++counts[type];
+        sizes[type] += celestia::util::ContainerMemoryUsage(dso->getInfoURL());
+        switch (dso->getObjType())
+        {
+        case DeepSkyObjectType::Galaxy:
+            sizes[type] += sizeof(Galaxy);
+            break;
+        case DeepSkyObjectType::Globular:
+            sizes[type] += sizeof(Globular);
+            break;
+        case DeepSkyObjectType::Nebula:
+            sizes[type] += sizeof(Nebula);
+            break;
+        case DeepSkyObjectType::OpenCluster:
+            sizes[type] += sizeof(OpenCluster);
+            break;
+        }
+    }
+
+    for (std::size_t i = 0; i < typeNames.size(); ++i)
+    {
+        if (counts[i] > 0)
+            report.add(subsystem, typeNames[i], sizes[i], counts[i]);
+    }
+
+    report.add(subsystem, "Object pointers"sv, m_octreeRoot->objectMemoryUsage(), nDSOs);
+    report.add(subsystem, "Octree nodes"sv, m_octreeRoot->nodeMemoryUsage(), m_octreeRoot->nodeCount());
+    report.add(subsystem, "Catalog number index"sv,
+               celestia::util::ContainerMemoryUsage(m_catalogNumberIndex),
+               m_catalogNumberIndex.size());
+    if (m_namesDB != nullptr)
+        report.add(subsystem, "Names"sv, m_namesDB->getMemoryUsage());
+}
@@ -21,12 +21,18 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
+#include <celutil/array_view.h>
 #include "dsooctree.h"
 
 class DeepSkyObject;
 class DSODatabaseBuilder;
 class NameDatabase;
 
+namespace celestia::util
+{
+class MemoryReport;
+}
+
 constexpr inline unsigned int MAX_DSO_NAMES = 10;
 
 // 100 Gly - on the order of the current size of the universe
@@ -45,18 +51,35 @@ public:
 
     DeepSkyObject* getDSO(const std::uint32_t) const;
     std::uint32_t size() const;
+    // The DSO with index n is object n of the octree
+    const celestia::engine::DSOOctree& getOctree() const;
 
     DeepSkyObject* find(const AstroCatalog::IndexNumber catalogNumber) const;
     DeepSkyObject* find(std::string_view, bool i18n) const;
 
     void getCompletion(std::vector<std::string>&, std::string_view) const;
 
+    // The work done by the search is added to stats if given
     void findVisibleDSOs(celestia::engine::DSOHandler& dsoHandler,
                          const Eigen::Vector3d& obsPosition,
                          const Eigen::Quaternionf& obsOrientation,
                          float fovY,
                          float aspectRatio,
-                         float limitingMag) const;
+                         float limitingMag,
+                         celestia::engine::OctreeTraversalStats* stats = nullptr) const;
+
+    // Parallel variant of findVisibleDSOs. The upper levels of the octree
+    // are processed by dsoHandler on the calling thread; the subtrees below
+    // them are shared out between the worker handlers, each of which is
+    // called from a single thread.
+    void findVisibleDSOs(celestia::engine::DSOHandler& dsoHandler,
+                         celestia::util::array_view<celestia::engine::DSOHandler*> workerHandlers,
+                         const Eigen::Vector3d& obsPosition,
+                         const Eigen::Quaternionf& obsOrientation,
+                         float fovY,
+                         float aspectRatio,
+                         float limitingMag,
+                         celestia::engine::OctreeTraversalStats* stats = nullptr) const;
 
     void findCloseDSOs(celestia::engine::DSOHandler& dsoHandler,
                        const Eigen::Vector3d& obsPosition,
@@ -67,6 +90,8 @@ public:
 
     float getAverageAbsoluteMagnitude() const;
 
+    void reportMemoryUsage(celestia::util::MemoryReport&) const;
+
 private:
     std::unique_ptr<celestia::engine::DSOOctree> m_octreeRoot;
     std::unique_ptr<NameDatabase> m_namesDB;
@@ -89,6 +114,12 @@ DSODatabase::size() const
     return m_octreeRoot->size();
 }
 
+inline const celestia::engine::DSOOctree&
+DSODatabase::getOctree() const
+{
+    return *m_octreeRoot;
+}
+
 inline float
 DSODatabase::getAverageAbsoluteMagnitude() const
 {
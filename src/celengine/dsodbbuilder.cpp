@@ -13,18 +13,29 @@
 #include "dsodbbuilder.h"
 
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <fstream>
+#include <iterator>
 #include <numeric>
+#include <ostream>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include <Eigen/Core>
 
 #include <celastro/astro.h>
 #include <celcompat/numbers.h>
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
 #include <celutil/logger.h>
 #include <celutil/gettext.h>
+#include <celutil/mappedfile.h>
 #include <celutil/stringutils.h>
 #include <celutil/tokenizer.h>
+#include <celutil/tracelog.h>
 #include "category.h"
 #include "deepskyobj.h"
 #include "dsodb.h"
@@ -37,10 +48,14 @@
 #include "octreebuilder.h"
 #include "opencluster.h"
 #include "parser.h"
+#include "selection.h"
 #include "value.h"
 
+using namespace std::string_view_literals;
+
 namespace astro = celestia::astro;
 namespace engine = celestia::engine;
+namespace util = celestia::util;
 
 using celestia::util::GetLogger;
 
@@ -92,6 +107,77 @@ DSOOctreeTraits::applyDecay(float factor)
 
 constexpr float DSO_OCTREE_MAGNITUDE = 8.0f;
 
+// Binary deep sky catalogs store the objects in octree order, followed by
+// the flattened octree nodes and a table of the names and info URLs.
+constexpr std::string_view DSODAT_MAGIC = "CELDSODB"sv;
+constexpr std::uint16_t DSODatVersion   = 0x0100;
+
+constexpr std::uint32_t NoString = UINT32_MAX;
+
+enum DSODatFlags : std::uint8_t
+{
+    Visible   = 0x1,
+    Clickable = 0x2,
+};
+
+#pragma pack(push, 1)
+
+struct DSODatHeader
+{
+    DSODatHeader() = delete;
+    char magic[8]; //NOSONAR
+    std::uint16_t version;
+    std::uint32_t objectCount;
+    std::uint32_t nodeCount;
+    std::uint32_t stringsSize;
+};
+
+struct DSODatRecord
+{
+    DSODatRecord() = delete;
+    std::uint8_t type;
+    std::uint8_t flags;
+    // GalaxyType for galaxies
+    std::uint16_t subtype;
+    double x;
+    double y;
+    double z;
+    float qw;
+    float qx;
+    float qy;
+    float qz;
+    float radius;
+    float absMag;
+    float detail;
+    // Core radius and King concentration for globulars
+    float coreRadius;
+    float kingConcentration;
+    // Offsets into the string table, or NoString
+    std::uint32_t names;
+    std::uint32_t infoURL;
+};
+
+struct DSODatNode
+{
+    DSODatNode() = delete;
+    double x;
+    double y;
+    double z;
+    double scale;
+    std::uint32_t right;
+    std::uint32_t first;
+    std::uint32_t last;
+    float brightFactor;
+};
+
+#pragma pack(pop)
+
+static_assert(std::is_standard_layout_v<DSODatHeader>);
+static_assert(std::is_standard_layout_v<DSODatRecord>);
+static_assert(std::is_standard_layout_v<DSODatNode>);
+
+constexpr std::uint16_t MaxGalaxySubtype = static_cast<std::uint16_t>(GalaxyType::E7);
+
 std::unique_ptr<DeepSkyObject>
 createDSO(std::string_view objType)
 {
@@ -196,6 +282,170 @@ buildCatalogNumberIndex(const engine::DSOOctree& DSOs)
     return catalogNumberIndex;
 }
 
+
+bool
+isBinaryRepresentable(const DeepSkyObject& obj)
+{
+    if (UserCategory::getCategories(Selection(const_cast<DeepSkyObject*>(&obj))) != nullptr) //NOSONAR
+        return false;
+
+    switch (obj.getObjType())
+    {
+    case DeepSkyObjectType::Galaxy:
+        return !static_cast<const Galaxy&>(obj).hasCustomForm();
+    case DeepSkyObjectType::Nebula:
+        return static_cast<const Nebula&>(obj).getGeometry() == InvalidResource;
+    default:
+        return true;
+    }
+}
+
+std::uint32_t
+addString(std::string& strings, std::string_view str)
+{
+    if (str.empty())
+        return NoString;
+
+    auto offset = static_cast<std::uint32_t>(strings.size());
+    strings.append(str);
+    strings.push_back('\0');
+    return offset;
+}
+
+bool
+writeDSODatRecord(std::ostream& out,
+                  const DeepSkyObject& obj,
+                  const NameDatabase& namesDB,
+                  std::string& strings)
+{
+    std::uint16_t subtype = 0;
+    float detail = 1.0f;
+    float coreRadius = 0.0f;
+    float kingConcentration = 0.0f;
+    switch (obj.getObjType())
+    {
+    case DeepSkyObjectType::Galaxy:
+        subtype = static_cast<std::uint16_t>(static_cast<const Galaxy&>(obj).getGalaxyType());
+        detail = static_cast<const Galaxy&>(obj).getDetail();
+        break;
+    case DeepSkyObjectType::Globular:
+        detail = static_cast<const Globular&>(obj).getDetail();
+        coreRadius = static_cast<const Globular&>(obj).getCoreRadius();
+        kingConcentration = static_cast<const Globular&>(obj).getKingConcentration();
+        break;
+    default:
+        break;
+    }
+
+    std::string names;
+    auto catalogNumber = obj.getIndex();
+    for (auto iter = namesDB.getFirstNameIter(catalogNumber);
+         iter != namesDB.getFinalNameIter() && iter->first == catalogNumber;
+         ++iter)
+    {
+        if (!names.empty())
+            names.push_back(':');
+        names.append(iter->second);
+    }
+
+    std::uint8_t flags = (obj.isVisible() ? DSODatFlags::Visible : 0)
+                       | (obj.isClickable() ? DSODatFlags::Clickable : 0);
+    Eigen::Vector3d position = obj.getPosition();
+    Eigen::Quaternionf orientation = obj.getOrientation();
+
+    return util::writeLE<std::uint8_t>(out, static_cast<std::uint8_t>(obj.getObjType()))
+        && util::writeLE<std::uint8_t>(out, flags)
+        && util::writeLE<std::uint16_t>(out, subtype)
+        && util::writeLE<double>(out, position.x())
+        && util::writeLE<double>(out, position.y())
+        && util::writeLE<double>(out, position.z())
+        && util::writeLE<float>(out, orientation.w())
+        && util::writeLE<float>(out, orientation.x())
+        && util::writeLE<float>(out, orientation.y())
+        && util::writeLE<float>(out, orientation.z())
+        && util::writeLE<float>(out, obj.getRadius())
+        && util::writeLE<float>(out, obj.getAbsoluteMagnitude())
+        && util::writeLE<float>(out, detail)
+        && util::writeLE<float>(out, coreRadius)
+        && util::writeLE<float>(out, kingConcentration)
+        && util::writeLE<std::uint32_t>(out, addString(strings, names))
+        && util::writeLE<std::uint32_t>(out, addString(strings, obj.getInfoURL()));
+}
+
+std::string_view
+getDSODatString(const char* strings, std::uint32_t stringsSize, std::uint32_t offset)
+{
+    if (offset >= stringsSize)
+        return {};
+
+    std::string_view remaining(strings + offset, stringsSize - offset);
+    return remaining.substr(0, remaining.find('\0'));
+}
+
+std::unique_ptr<DeepSkyObject>
+readDSODatRecord(const char* ptr, const char* strings, std::uint32_t stringsSize)
+{
+    auto type = util::fromMemoryLE<std::uint8_t>(ptr + offsetof(DSODatRecord, type));
+    auto subtype = util::fromMemoryLE<std::uint16_t>(ptr + offsetof(DSODatRecord, subtype));
+    auto detail = util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, detail));
+
+    std::unique_ptr<DeepSkyObject> obj;
+    switch (static_cast<DeepSkyObjectType>(type))
+    {
+    case DeepSkyObjectType::Galaxy:
+        if (subtype > MaxGalaxySubtype)
+            return nullptr;
+        {
+            auto galaxy = std::make_unique<Galaxy>();
+            galaxy->setGalaxyType(static_cast<GalaxyType>(subtype));
+            galaxy->setDetail(detail);
+            obj = std::move(galaxy);
+        }
+        break;
+    case DeepSkyObjectType::Globular:
+        {
+            auto globular = std::make_unique<Globular>();
+            globular->setDetail(detail);
+            obj = std::move(globular);
+        }
+        break;
+    case DeepSkyObjectType::Nebula:
+        obj = std::make_unique<Nebula>();
+        break;
+    case DeepSkyObjectType::OpenCluster:
+        obj = std::make_unique<OpenCluster>();
+        break;
+    default:
+        return nullptr;
+    }
+
+    auto flags = util::fromMemoryLE<std::uint8_t>(ptr + offsetof(DSODatRecord, flags));
+    obj->setPosition(Eigen::Vector3d(util::fromMemoryLE<double>(ptr + offsetof(DSODatRecord, x)),
+                                     util::fromMemoryLE<double>(ptr + offsetof(DSODatRecord, y)),
+                                     util::fromMemoryLE<double>(ptr + offsetof(DSODatRecord, z))));
+    obj->setOrientation(Eigen::Quaternionf(util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, qw)),
+                                           util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, qx)),
+                                           util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, qy)),
+                                           util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, qz))));
+    obj->setRadius(util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, radius)));
+    obj->setAbsoluteMagnitude(util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, absMag)));
+    obj->setVisible((flags & DSODatFlags::Visible) != 0);
+    obj->setClickable((flags & DSODatFlags::Clickable) != 0);
+
+    // The tidal radius depends on the position
+    if (obj->getObjType() == DeepSkyObjectType::Globular)
+    {
+        static_cast<Globular&>(*obj).setStructure(util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, coreRadius)),
+                                                  util::fromMemoryLE<float>(ptr + offsetof(DSODatRecord, kingConcentration)));
+    }
+
+    auto infoURL = getDSODatString(strings, stringsSize, util::fromMemoryLE<std::uint32_t>(ptr + offsetof(DSODatRecord, infoURL)));
+    if (!infoURL.empty())
+        obj->setInfoURL(std::string(infoURL));
+
+    return obj;
+}
+
 } // end unnamed namespace
 
 DSODatabaseBuilder::~DSODatabaseBuilder() = default;
@@ -204,6 +454,12 @@ bool
 DSODatabaseBuilder::load(std::istream& in, const fs::path& resourcePath)
 {
     Tokenizer tokenizer(&in);
+    return load(tokenizer, resourcePath);
+}
+
+bool
+DSODatabaseBuilder::load(Tokenizer& tokenizer, const fs::path& resourcePath)
+{
     Parser    parser(&tokenizer);
 
 #ifdef ENABLE_NLS
@@ -266,6 +522,7 @@ DSODatabaseBuilder::load(std::istream& in, const fs::path& resourcePath)
 
         obj->setIndex(objCatalogNumber);
         DSOs.emplace_back(std::move(obj));
+        prebuiltIsValid = false;
 
         addName(namesDB.get(), objCatalogNumber, objName);
     }
@@ -273,10 +530,133 @@ DSODatabaseBuilder::load(std::istream& in, const fs::path& resourcePath)
     return true;
 }
 
+/*! Load a binary deep sky catalog by mapping it into memory. If it is the
+ *  only catalog loaded, its prebuilt octree is used.
+ */
+bool
+DSODatabaseBuilder::loadBinary(const fs::path& path)
+{
+    if (auto mappedFile = util::MappedFile::open(path); mappedFile != nullptr)
+        return loadBinary(mappedFile->data(), mappedFile->size());
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good())
+        return false;
+
+    std::string data(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>{});
+    return !in.bad() && loadBinary(data.data(), data.size());
+}
+
+bool
+DSODatabaseBuilder::loadBinary(const char* data, std::size_t size)
+{
+    if (size < sizeof(DSODatHeader)
+        || std::string_view(data + offsetof(DSODatHeader, magic), DSODAT_MAGIC.size()) != DSODAT_MAGIC
+        || util::fromMemoryLE<std::uint16_t>(data + offsetof(DSODatHeader, version)) != DSODatVersion)
+    {
+        GetLogger()->error(_("Bad header for binary deep sky catalog\n"));
+        return false;
+    }
+
+    auto nObjects = util::fromMemoryLE<std::uint32_t>(data + offsetof(DSODatHeader, objectCount));
+    auto nNodes = util::fromMemoryLE<std::uint32_t>(data + offsetof(DSODatHeader, nodeCount));
+    auto stringsSize = util::fromMemoryLE<std::uint32_t>(data + offsetof(DSODatHeader, stringsSize));
+    if (size - sizeof(DSODatHeader) < static_cast<std::size_t>(nObjects) * sizeof(DSODatRecord)
+                                      + static_cast<std::size_t>(nNodes) * sizeof(DSODatNode)
+                                      + stringsSize
+        || nObjects > AstroCatalog::InvalidIndex - nextAutoCatalogNumber)
+    {
+        GetLogger()->error(_("Binary deep sky catalog is truncated\n"));
+        return false;
+    }
+
+    const char* records = data + sizeof(DSODatHeader);
+    const char* nodes = records + static_cast<std::size_t>(nObjects) * sizeof(DSODatRecord);
+    const char* strings = nodes + static_cast<std::size_t>(nNodes) * sizeof(DSODatNode);
+
+    std::vector<std::unique_ptr<DeepSkyObject>> objects;
+    objects.reserve(nObjects);
+    for (std::uint32_t i = 0; i < nObjects; ++i, records += sizeof(DSODatRecord))
+    {
+        // Dropping an object would invalidate the octree object ranges
+        std::unique_ptr<DeepSkyObject> obj = readDSODatRecord(records, strings, stringsSize);
+        if (obj == nullptr)
+        {
+            GetLogger()->error(_("Bad object in binary deep sky catalog, record #{}\n"), i);
+            return false;
+        }
+
+        objects.emplace_back(std::move(obj));
+    }
+
+    std::vector<engine::DSOOctree::NodeType> octreeNodes;
+    octreeNodes.reserve(nNodes);
+    for (std::uint32_t i = 0; i < nNodes; ++i, nodes += sizeof(DSODatNode))
+    {
+        auto& node = octreeNodes.emplace_back(Eigen::Vector3d(util::fromMemoryLE<double>(nodes + offsetof(DSODatNode, x)),
+                                                              util::fromMemoryLE<double>(nodes + offsetof(DSODatNode, y)),
+                                                              util::fromMemoryLE<double>(nodes + offsetof(DSODatNode, z))),
+                                              util::fromMemoryLE<double>(nodes + offsetof(DSODatNode, scale)));
+        node.right = util::fromMemoryLE<std::uint32_t>(nodes + offsetof(DSODatNode, right));
+        node.first = util::fromMemoryLE<std::uint32_t>(nodes + offsetof(DSODatNode, first));
+        node.last = util::fromMemoryLE<std::uint32_t>(nodes + offsetof(DSODatNode, last));
+        node.brightFactor = util::fromMemoryLE<float>(nodes + offsetof(DSODatNode, brightFactor));
+
+        // Skip links must point forwards to guarantee that traversal terminates
+        if ((node.right <= i && node.right != engine::InvalidOctreeNode)
+            || node.first > node.last
+            || node.last > nObjects)
+        {
+            GetLogger()->error(_("Bad octree node in binary deep sky catalog, node #{}\n"), i);
+            return false;
+        }
+    }
+
+    bool usePrebuilt = DSOs.empty();
+    records = data + sizeof(DSODatHeader);
+    for (std::uint32_t i = 0; i < nObjects; ++i, records += sizeof(DSODatRecord))
+    {
+        AstroCatalog::IndexNumber objCatalogNumber = nextAutoCatalogNumber;
+        ++nextAutoCatalogNumber;
+
+        objects[i]->setIndex(objCatalogNumber);
+        addName(namesDB.get(),
+                objCatalogNumber,
+                getDSODatString(strings,
+                                stringsSize,
+                                util::fromMemoryLE<std::uint32_t>(records + offsetof(DSODatRecord, names))));
+        DSOs.emplace_back(std::move(objects[i]));
+    }
+
+    prebuiltIsValid = usePrebuilt;
+    if (usePrebuilt)
+        prebuiltNodes = std::move(octreeNodes);
+    else
+        prebuiltNodes.clear();
+
+    return true;
+}
+
 std::unique_ptr<DSODatabase>
 DSODatabaseBuilder::finish()
 {
-    auto octreeRoot = buildOctree(std::move(DSOs));
+    std::unique_ptr<engine::DSOOctree> octreeRoot;
+    {
+        util::TraceScope trace("Build deep sky octree");
+        trace.addArg("objects", DSOs.size());
+        trace.addArg("prebuilt", prebuiltIsValid ? 1 : 0);
+        if (prebuiltIsValid)
+        {
+            GetLogger()->debug("Using prebuilt DSO octree with {} nodes.\n", prebuiltNodes.size());
+            octreeRoot = std::make_unique<engine::DSOOctree>(std::move(prebuiltNodes), std::move(DSOs));
+        }
+        else
+        {
+            octreeRoot = buildOctree(std::move(DSOs));
+        }
+    }
+
+    util::TraceScope trace("Build deep sky indexes");
     auto catalogNumberIndex = buildCatalogNumberIndex(*octreeRoot);
     float avgAbsMag = calcAvgAbsMag(*octreeRoot);
 
@@ -287,3 +667,70 @@ DSODatabaseBuilder::finish()
                                          std::move(catalogNumberIndex),
                                          avgAbsMag);
 }
+
+bool
+DSODatabaseBuilder::canWriteBinary() const
+{
+    return std::all_of(DSOs.begin(), DSOs.end(),
+                       [](const auto& obj) { return isBinaryRepresentable(*obj); });
+}
+
+bool
+DSODatabaseBuilder::writeBinary(std::ostream& out)
+{
+    std::vector<std::unique_ptr<DeepSkyObject>> objects;
+    objects.reserve(DSOs.size());
+    for (auto& obj : DSOs)
+    {
+        if (isBinaryRepresentable(*obj))
+        {
+            objects.emplace_back(std::move(obj));
+            continue;
+        }
+
+        GetLogger()->warn(_("Skipping deep sky object {}: meshes, custom templates and categories "
+                            "are not supported in binary catalogs\n"),
+                          obj->getIndex());
+    }
+
+    DSOs.clear();
+    auto octreeRoot = buildOctree(std::move(objects));
+
+    std::string strings;
+    std::ostringstream body;
+    for (std::uint32_t i = 0, nObjects = octreeRoot->size(); i < nObjects; ++i)
+    {
+        if (!writeDSODatRecord(body, *(*octreeRoot)[i], *namesDB, strings))
+            return false;
+    }
+
+    for (engine::OctreeNodeIndex i = 0, nNodes = octreeRoot->nodeCount(); i < nNodes; ++i)
+    {
+        const auto& node = octreeRoot->getNode(i);
+        if (!util::writeLE<double>(body, node.center.x())
+            || !util::writeLE<double>(body, node.center.y())
+            || !util::writeLE<double>(body, node.center.z())
+            || !util::writeLE<double>(body, node.scale)
+            || !util::writeLE<std::uint32_t>(body, node.right)
+            || !util::writeLE<std::uint32_t>(body, node.first)
+            || !util::writeLE<std::uint32_t>(body, node.last)
+            || !util::writeLE<float>(body, node.brightFactor))
+        {
+            return false;
+        }
+    }
+
+    // The string table is only complete after all records are written
+    out.write(DSODAT_MAGIC.data(), DSODAT_MAGIC.size());
+    if (!util::writeLE<std::uint16_t>(out, DSODatVersion)
+        || !util::writeLE<std::uint32_t>(out, octreeRoot->size())
+        || !util::writeLE<std::uint32_t>(out, octreeRoot->nodeCount())
+        || !util::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(strings.size())))
+    {
+        return false;
+    }
+
+    out << body.rdbuf();
+    out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+    return out.good();
+}
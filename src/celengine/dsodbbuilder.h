@@ -12,17 +12,20 @@
 
 #pragma once
 
+#include <cstddef>
 #include <iosfwd>
 #include <memory>
 #include <vector>
 
 #include <celcompat/filesystem.h>
 #include "astroobj.h"
+#include "dsooctree.h"
 #include "name.h"
 
 class DeepSkyObject;
 class DSODatabase;
 class NameDatabase;
+class Tokenizer;
 
 class DSODatabaseBuilder
 {
@@ -31,10 +34,28 @@ public:
     ~DSODatabaseBuilder();
 
     bool load(std::istream&, const fs::path& resourcePath = fs::path());
+    bool load(Tokenizer&, const fs::path& resourcePath = fs::path());
+    bool loadBinary(const fs::path&);
     std::unique_ptr<DSODatabase> finish();
 
+    // Build the octree from the loaded objects and write it in the format
+    // read by loadBinary(), instead of calling finish(). Objects which cannot
+    // be represented, i.e. those with meshes, custom galaxy templates or
+    // categories, are skipped with a warning.
+    bool writeBinary(std::ostream&);
+    // Return true if writeBinary() would keep all the loaded objects
+    bool canWriteBinary() const;
+
+    bool loadBinary(const char*, std::size_t);
+
 private:
+
     std::vector<std::unique_ptr<DeepSkyObject>> DSOs;
     std::unique_ptr<NameDatabase> namesDB{ std::make_unique<NameDatabase>() };
     AstroCatalog::IndexNumber nextAutoCatalogNumber{ 0 };
+
+    // Octree nodes from a binary catalog, used by finish() if the catalog
+    // was the only one loaded; the objects are then in octree order.
+    std::vector<celestia::engine::DSOOctree::NodeType> prebuiltNodes;
+    bool prebuiltIsValid{ false };
 };
@@ -27,7 +27,7 @@ DSOOctreeVisibleObjectsProcessor::DSOOctreeVisibleObjectsProcessor(DSOHandler* d
                                                                    float limitingFactor) :
     m_dsoHandler(dsoHandler),
     m_obsPosition(obsPosition),
-    m_frustumPlanes(frustumPlanes),
+    m_frustum(frustumPlanes),
     m_limitingFactor(limitingFactor)
 {
 }
@@ -37,16 +37,12 @@ DSOOctreeVisibleObjectsProcessor::checkNode(const DSOOctree::PointType& center,
                                             double size,
                                             float factor)
 {
-    // Test the cubic octree node against each one of the five
-    // planes that define the infinite view frustum.
-    for (unsigned int i = 0; i < 5; ++i)
-    {
-        const PlaneType& plane = m_frustumPlanes[i];
+    ++m_stats.nodesVisited;
 
-        double r = size * plane.normal().cwiseAbs().sum();
-        if (plane.signedDistance(center) < -r)
-            return false;
-    }
+    // Test the cubic octree node against all of the planes that define
+    // the infinite view frustum.
+    if (m_frustum.isCubeOutside(center, size))
+        return false;
 
     // Compute the distance to node; this is equal to the distance to
     // the cellCenterPos of the node minus the boundingRadius of the node, scale * SQRT3.
@@ -60,11 +56,12 @@ DSOOctreeVisibleObjectsProcessor::checkNode(const DSOOctree::PointType& center,
     // Dimmest absolute magnitude to process
     m_dimmest = minDistance > 0.0 ? (m_limitingFactor - distanceModulus) : 1000.0;
 
+    ++m_stats.nodesAccepted;
     return true;
 }
 
 void
-DSOOctreeVisibleObjectsProcessor::process(const std::unique_ptr<DeepSkyObject>& obj) const //NOSONAR
+DSOOctreeVisibleObjectsProcessor::process(const std::unique_ptr<DeepSkyObject>& obj) //NOSONAR
 {
     float absMag = obj->getAbsoluteMagnitude();
     if (absMag > m_dimmest)
@@ -74,7 +71,10 @@ DSOOctreeVisibleObjectsProcessor::process(const std::unique_ptr<DeepSkyObject>&
     auto appMag = static_cast<float>((distance >= 32.6167) ? astro::absToAppMag(static_cast<double>(absMag), distance) : absMag);
 
     if (appMag <= m_limitingFactor)
+    {
+        ++m_stats.objectsProcessed;
         m_dsoHandler->process(obj, distance, absMag);
+    }
 }
 
 DSOOctreeCloseObjectsProcessor::DSOOctreeCloseObjectsProcessor(DSOHandler* dsoHandler,
@@ -45,15 +45,18 @@ public:
                                      float);
 
     bool checkNode(const DSOOctree::PointType&, double, float);
-    void process(const std::unique_ptr<DeepSkyObject>&) const; //NOSONAR
+    void process(const std::unique_ptr<DeepSkyObject>&); //NOSONAR
+
+    const OctreeTraversalStats& traversalStats() const { return m_stats; }
 
 private:
     DSOHandler* m_dsoHandler;
     DSOOctree::PointType m_obsPosition;
-    util::array_view<PlaneType> m_frustumPlanes;
+    OctreeFrustum<double> m_frustum;
     float m_limitingFactor;
 
     float m_dimmest{ 1000.0f };
+    OctreeTraversalStats m_stats;
 };
 
 class DSOOctreeCloseObjectsProcessor
@@ -63,19 +63,29 @@ void DSORenderer::process(const std::unique_ptr<DeepSkyObject>& dso, //NOSONAR
                           double distanceToDSO,
                           float absMag)
 {
-    if (distanceToDSO > distanceLimit || !dso->isVisible())
-        return;
+    Staged staged;
+    if (stage(*dso, distanceToDSO, absMag, staged))
+        submit(staged);
+}
+
+bool DSORenderer::stage(const DeepSkyObject& dso,
+                        double distanceToDSO,
+                        float absMag,
+                        Staged& staged) const
+{
+    if (distanceToDSO > distanceLimit || !dso.isVisible())
+        return false;
 
-    Eigen::Vector3f relPos = (dso->getPosition() - obsPos).cast<float>();
+    Eigen::Vector3f relPos = (dso.getPosition() - obsPos).cast<float>();
     Eigen::Vector3f center = orientationMatrixT * relPos;
 
     // Test the object's bounding sphere against the view frustum. If we
     // avoid this stage, overcrowded octree cells may hit performance badly:
     // each object (even if it's not visible) would be sent to the OpenGL
     // pipeline.
-    double dsoRadius = dso->getBoundingSphereRadius();
+    double dsoRadius = dso.getBoundingSphereRadius();
     if (frustum.testSphere(center, (float) dsoRadius) == math::FrustumAspect::Outside)
-        return;
+        return false;
 
     float appMag;
     if (distanceToDSO >= pc10)
@@ -83,10 +93,13 @@ void DSORenderer::process(const std::unique_ptr<DeepSkyObject>& dso, //NOSONAR
     else
         appMag = absMag + (float) (enhance * tanh(distanceToDSO/pc10 - 1.0));
 
-    if ((renderFlags & dso->getRenderMask()) != 0)
-    {
-        dsosProcessed++;
+    staged.dso = &dso;
+    staged.relPos = relPos;
+    staged.render = false;
+    staged.label = false;
 
+    if ((renderFlags & dso.getRenderMask()) != 0)
+    {
         float nearZ = 0.0f, farZ = 0.0f;
         if (dsoRadius < 1000.0)
         {
@@ -105,36 +118,35 @@ void DSORenderer::process(const std::unique_ptr<DeepSkyObject>& dso, //NOSONAR
         }
 
         float b = 2.3f * (faintestMag - 4.75f) / renderer->getFaintestAM45deg(); // brightnesCorr
-        switch (dso->getObjType())
+        switch (dso.getObjType())
         {
         case DeepSkyObjectType::Galaxy:
             // -19.04f == average over 10937 galaxies in galaxies.dsc.
             b = brightness(-19.04f, absMag, appMag, b, faintestMag);
-            galaxyRenderer->add(static_cast<const Galaxy*>(dso.get()), relPos, b, nearZ, farZ);
             break;
         case DeepSkyObjectType::Globular:
             // -6.86f == average over 150 globulars in globulars.dsc.
             b = brightness(-6.86f, absMag, appMag, b, faintestMag);
-            globularRenderer->add(static_cast<const Globular*>(dso.get()), relPos, b, nearZ, farZ);
             break;
         case DeepSkyObjectType::Nebula:
-            b = brightness(avgAbsMag, absMag, appMag, b, faintestMag);
-            nebulaRenderer->add(static_cast<const Nebula*>(dso.get()), relPos, b, nearZ, farZ);
-            break;
         case DeepSkyObjectType::OpenCluster:
             b = brightness(avgAbsMag, absMag, appMag, b, faintestMag);
-            openClusterRenderer->add(static_cast<const OpenCluster*>(dso.get()), relPos, b, nearZ, farZ);
             break;
         default:
             // Unsupported DSO
             break;
         }
+
+        staged.render = true;
+        staged.brightness = b;
+        staged.nearZ = nearZ;
+        staged.farZ = farZ;
     } // renderFlags check
 
     // Only render those labels that are in front of the camera:
     // Place labels for DSOs brighter than the specified label threshold brightness
     //
-    unsigned int labelMask = dso->getLabelMask();
+    unsigned int labelMask = dso.getLabelMask();
 
     if ((labelMask & labelMode) != 0)
     {
@@ -152,14 +164,14 @@ void DSORenderer::process(const std::unique_ptr<DeepSkyObject>& dso, //NOSONAR
             rep = &renderer->nebulaRep;
             labelColor = Renderer::NebulaLabelColor;
             appMagEff = astro::absToAppMag(-7.5f, (float)distanceToDSO);
-            symbolSize = (float)(dso->getRadius() / distanceToDSO) / pixelSize;
+            symbolSize = (float)(dso.getRadius() / distanceToDSO) / pixelSize;
             step = 6.0f;
             break;
         case Renderer::OpenClusterLabels:
             rep = &renderer->openClusterRep;
             labelColor = Renderer::OpenClusterLabelColor;
             appMagEff = astro::absToAppMag(-6.0f, (float)distanceToDSO);
-            symbolSize = (float)(dso->getRadius() / distanceToDSO) / pixelSize;
+            symbolSize = (float)(dso.getRadius() / distanceToDSO) / pixelSize;
             step = 4.0f;
             break;
         case Renderer::GalaxyLabels:
@@ -186,13 +198,70 @@ void DSORenderer::process(const std::unique_ptr<DeepSkyObject>& dso, //NOSONAR
             float distr = std::min(1.0f, step * (labelThresholdMag - appMagEff) / labelThresholdMag);
             labelColor.alpha(distr * labelColor.alpha());
 
-            renderer->addBackgroundAnnotation(rep,
-                                              dsoDB->getDSOName(dso.get(), true),
-                                              labelColor,
-                                              relPos,
-                                              Renderer::LabelHorizontalAlignment::Start,
-                                              Renderer::LabelVerticalAlignment::Center,
-                                              symbolSize);
+            staged.label = true;
+            staged.labelColor = labelColor;
+            staged.rep = rep;
+            staged.symbolSize = symbolSize;
         }
     }     // labels enabled
+
+    return staged.render || staged.label;
+}
+
+void DSORenderer::submit(const Staged& staged)
+{
+    if (staged.render)
+    {
+        dsosProcessed++;
+
+        switch (staged.dso->getObjType())
+        {
+        case DeepSkyObjectType::Galaxy:
+            galaxyRenderer->add(static_cast<const Galaxy*>(staged.dso), staged.relPos, staged.brightness, staged.nearZ, staged.farZ);
+            galaxiesDrawn++;
+            break;
+        case DeepSkyObjectType::Globular:
+            globularRenderer->add(static_cast<const Globular*>(staged.dso), staged.relPos, staged.brightness, staged.nearZ, staged.farZ);
+            globularsDrawn++;
+            break;
+        case DeepSkyObjectType::Nebula:
+            nebulaRenderer->add(static_cast<const Nebula*>(staged.dso), staged.relPos, staged.brightness, staged.nearZ, staged.farZ);
+            nebulaeDrawn++;
+            break;
+        case DeepSkyObjectType::OpenCluster:
+            openClusterRenderer->add(static_cast<const OpenCluster*>(staged.dso), staged.relPos, staged.brightness, staged.nearZ, staged.farZ);
+            openClustersDrawn++;
+            break;
+        default:
+            // Unsupported DSO
+            break;
+        }
+    }
+
+    if (staged.label)
+    {
+        renderer->addBackgroundAnnotation(staged.rep,
+                                          dsoDB->getDSOName(staged.dso, true),
+                                          staged.labelColor,
+                                          staged.relPos,
+                                          Renderer::LabelHorizontalAlignment::Start,
+                                          Renderer::LabelVerticalAlignment::Center,
+                                          staged.symbolSize);
+    }
+}
+
+void DSOStagingHandler::process(const std::unique_ptr<DeepSkyObject>& dso, //NOSONAR
+                                double distanceToDSO,
+                                float absMag)
+{
+    if (DSORenderer::Staged staged; dsoRenderer->stage(*dso, distanceToDSO, absMag, staged))
+        m_staged.push_back(staged);
+}
+
+void DSOStagingHandler::finish()
+{
+    for (const DSORenderer::Staged& staged : m_staged)
+        dsoRenderer->submit(staged);
+
+    m_staged.clear();
 }
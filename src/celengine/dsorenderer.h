@@ -12,25 +12,57 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <Eigen/Core>
 
 #include <celmath/frustum.h>
 #include <celmath/mathlib.h>
 #include <celrender/rendererfwd.h>
+#include <celutil/color.h>
+#include "dsooctree.h"
 #include "objectrenderer.h"
 #include "projectionmode.h"
 
 class DeepSkyObject;
 class DSODatabase;
 
+namespace celestia
+{
+class MarkerRepresentation;
+}
+
 class DSORenderer : public ObjectRenderer<std::unique_ptr<DeepSkyObject>, double>
 {
 public:
+    // The outcome of the visibility, brightness and label tests for one
+    // object, to be submitted to the renderers on the render thread
+    struct Staged
+    {
+        const DeepSkyObject* dso;
+        Eigen::Vector3f relPos;
+        float brightness;
+        float nearZ;
+        float farZ;
+        bool render;
+        bool label;
+        Color labelColor;
+        const celestia::MarkerRepresentation* rep;
+        float symbolSize;
+    };
+
     DSORenderer();
 
     void process(const std::unique_ptr<DeepSkyObject>&, double, float) override; //NOSONAR
 
+    // Run the tests for an object; does not modify the renderer, so it may
+    // be called from several threads. Returns false if the object is
+    // neither drawn nor labelled.
+    bool stage(const DeepSkyObject&, double, float, Staged&) const;
+    // Pass a staged object to the DSO renderers and the annotation list;
+    // must be called on the render thread
+    void submit(const Staged&);
+
     celestia::math::InfiniteFrustum frustum{ celestia::math::degToRad(celestia::engine::standardFOV),
                                              1.0f,
                                              1.0f };
@@ -41,9 +73,29 @@ public:
 
     float         avgAbsMag{ 0.0f };
     std::uint32_t dsosProcessed{ 0 };
+    // Objects passed to each of the renderers below
+    std::uint32_t galaxiesDrawn{ 0 };
+    std::uint32_t globularsDrawn{ 0 };
+    std::uint32_t nebulaeDrawn{ 0 };
+    std::uint32_t openClustersDrawn{ 0 };
 
     celestia::render::GalaxyRenderer      *galaxyRenderer{ nullptr };
     celestia::render::GlobularRenderer    *globularRenderer{ nullptr };
     celestia::render::NebulaRenderer      *nebulaRenderer{ nullptr };
     celestia::render::OpenClusterRenderer *openClusterRenderer{ nullptr };
 };
+
+// DSO handler for the worker threads of the parallel DSO traversal. The
+// objects are only staged during the traversal, and submitted in finish().
+class DSOStagingHandler : public celestia::engine::DSOHandler
+{
+public:
+    void process(const std::unique_ptr<DeepSkyObject>&, double, float) override; //NOSONAR
+    // Must be called on the render thread after the traversal
+    void finish();
+
+    DSORenderer* dsoRenderer{ nullptr };
+
+private:
+    std::vector<DSORenderer::Staged> m_staged;
+};
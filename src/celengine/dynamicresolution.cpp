@@ -0,0 +1,79 @@
+// dynamicresolution.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Render scale control from measured GPU frame times.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "dynamicresolution.h"
+
+#include <algorithm>
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Weight of a new frame time in the running average
+constexpr double AverageWeight = 0.1;
+
+// Frames measured at a scale before it can change again
+constexpr int SettleFrames = 30;
+
+// The scale is raised only if the frame time predicted for the larger
+// scale leaves this margin to the target
+constexpr double RaiseMargin = 0.85;
+
+} // end unnamed namespace
+
+DynamicResolution::DynamicResolution(double targetFrameTime) :
+    m_targetFrameTime(targetFrameTime)
+{
+}
+
+bool
+DynamicResolution::update(double frameTime)
+{
+    if (m_frames == 0)
+        m_averageFrameTime = frameTime;
+    else
+        m_averageFrameTime += (frameTime - m_averageFrameTime) * AverageWeight;
+
+    if (++m_frames < SettleFrames)
+        return false;
+
+    // The GPU time is mostly spent on pixels, so it goes with the square
+    // of the scale
+    if (m_averageFrameTime > m_targetFrameTime && m_scale > MinScale)
+    {
+        setScale(std::max(m_scale - ScaleStep, MinScale));
+        return true;
+    }
+
+    if (m_scale < 1.0f)
+    {
+        float raised = std::min(m_scale + ScaleStep, 1.0f);
+        double ratio = static_cast<double>(raised) / static_cast<double>(m_scale);
+        if (m_averageFrameTime * ratio * ratio < m_targetFrameTime * RaiseMargin)
+        {
+            setScale(raised);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+DynamicResolution::setScale(float scale)
+{
+    m_scale = scale;
+    m_frames = 0;
+}
+
+} // end namespace celestia::engine
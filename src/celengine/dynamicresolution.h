@@ -0,0 +1,45 @@
+// dynamicresolution.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Render scale control from measured GPU frame times.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+namespace celestia::engine
+{
+
+// Picks the scale of the resolution the scene is rendered at, so that the
+// GPU time of a frame stays below a target. The scale changes in steps,
+// and only after the frame times measured at the current scale settled,
+// as every change reallocates the render targets.
+class DynamicResolution
+{
+public:
+    static constexpr float MinScale = 0.5f;
+    static constexpr float ScaleStep = 0.125f;
+
+    // The target frame time is in seconds
+    explicit DynamicResolution(double targetFrameTime);
+
+    // Account for the GPU time of a frame in seconds. Return true if the
+    // scale changed.
+    bool update(double frameTime);
+
+    float scale() const { return m_scale; }
+
+private:
+    void setScale(float scale);
+
+    double m_targetFrameTime;
+    double m_averageFrameTime{ 0.0 };
+    int m_frames{ 0 };
+    float m_scale{ 1.0f };
+};
+
+} // end namespace celestia::engine
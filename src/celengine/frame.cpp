@@ -11,6 +11,7 @@
 // of the License, or (at your option) any later version.
 
 #include <cassert>
+#include <mutex>
 #include <celastro/astro.h>
 #include <celastro/date.h>
 #include <celengine/star.h>
@@ -459,42 +460,56 @@ CachingFrame::CachingFrame(Selection _center) :
 }
 
 
+// The cache is locked only while it is read or updated, so that frames
+// can be evaluated from several threads at once.
 Quaterniond
 CachingFrame::getOrientation(double tjd) const
 {
-    if (tjd != lastTime)
+    std::uint32_t generation = Body::getEvaluationGeneration();
     {
-        lastTime = tjd;
-        lastOrientation = computeOrientation(tjd);
-        orientationCacheValid = true;
-        angularVelocityCacheValid = false;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (tjd == lastTime && generation == lastGeneration && orientationCacheValid)
+            return lastOrientation;
     }
-    else if (!orientationCacheValid)
+
+    Quaterniond q = computeOrientation(tjd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (tjd != lastTime || generation != lastGeneration)
     {
-        lastOrientation = computeOrientation(tjd);
-        orientationCacheValid = true;
+        lastTime = tjd;
+        lastGeneration = generation;
+        angularVelocityCacheValid = false;
     }
 
-    return lastOrientation;
+    lastOrientation = q;
+    orientationCacheValid = true;
+    return q;
 }
 
 
 Vector3d CachingFrame::getAngularVelocity(double tjd) const
 {
-    if (tjd != lastTime)
+    std::uint32_t generation = Body::getEvaluationGeneration();
     {
-        lastTime = tjd;
-        lastAngularVelocity = computeAngularVelocity(tjd);
-        orientationCacheValid = false;
-        angularVelocityCacheValid = true;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (tjd == lastTime && generation == lastGeneration && angularVelocityCacheValid)
+            return lastAngularVelocity;
     }
-    else if (!angularVelocityCacheValid)
+
+    Vector3d w = computeAngularVelocity(tjd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (tjd != lastTime || generation != lastGeneration)
     {
-        lastAngularVelocity = computeAngularVelocity(tjd);
-        angularVelocityCacheValid = true;
+        lastTime = tjd;
+        lastGeneration = generation;
+        orientationCacheValid = false;
     }
 
-    return lastAngularVelocity;
+    lastAngularVelocity = w;
+    angularVelocityCacheValid = true;
+    return w;
 }
 
 
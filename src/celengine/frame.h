@@ -10,6 +10,9 @@
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+
 #include <celengine/selection.h>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -62,7 +65,9 @@ class ReferenceFrame
 
 
 /*! Base class for complex frames where there may be some benefit
- *  to caching the last calculated orientation.
+ *  to caching the last calculated orientation. The cache is stamped with
+ *  the time and the evaluation generation of the bodies, so that it is
+ *  dropped when a body the frame depends on changes.
  */
 class CachingFrame : public ReferenceFrame
 {
@@ -78,7 +83,9 @@ class CachingFrame : public ReferenceFrame
     virtual Eigen::Vector3d computeAngularVelocity(double tjd) const;
 
  private:
+    mutable std::mutex cacheMutex;
     mutable double lastTime;
+    mutable std::uint32_t lastGeneration{ 0 };
     mutable Eigen::Quaterniond lastOrientation;
     mutable Eigen::Vector3d lastAngularVelocity;
     mutable bool orientationCacheValid;
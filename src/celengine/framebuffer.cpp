@@ -13,6 +13,7 @@
 FramebufferObject::FramebufferObject(GLuint width, GLuint height, unsigned int attachments) :
     m_width(width),
     m_height(height),
+    m_attachments(attachments),
     m_colorTexId(0),
     m_depthTexId(0),
     m_fboId(0),
@@ -27,6 +28,7 @@ FramebufferObject::FramebufferObject(GLuint width, GLuint height, unsigned int a
 FramebufferObject::FramebufferObject(FramebufferObject &&other) noexcept:
     m_width(other.m_width),
     m_height(other.m_height),
+    m_attachments(other.m_attachments),
     m_colorTexId(other.m_colorTexId),
     m_depthTexId(other.m_depthTexId),
     m_fboId(other.m_fboId),
@@ -40,6 +42,7 @@ FramebufferObject& FramebufferObject::operator=(FramebufferObject &&other) noexc
 {
     m_width        = other.m_width;
     m_height       = other.m_height;
+    m_attachments  = other.m_attachments;
     m_colorTexId   = other.m_colorTexId;
     m_depthTexId   = other.m_depthTexId;
     m_fboId        = other.m_fboId;
@@ -39,6 +39,11 @@ class FramebufferObject
         return m_height;
     }
 
+    unsigned int attachments() const
+    {
+        return m_attachments;
+    }
+
     GLuint colorTexture() const;
     GLuint depthTexture() const;
 
@@ -54,6 +59,7 @@ class FramebufferObject
  private:
     GLuint m_width;
     GLuint m_height;
+    unsigned int m_attachments;
     GLuint m_colorTexId;
     GLuint m_depthTexId;
     GLuint m_fboId;
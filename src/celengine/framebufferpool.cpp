@@ -0,0 +1,112 @@
+// framebufferpool.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Reuse of the framebuffers which are no longer needed.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "framebufferpool.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "framebuffer.h"
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Idle framebuffers kept, e.g. a few full screen views and shadow maps
+constexpr std::size_t MaxIdleBytes = 128 * 1024 * 1024;
+
+// Approximate size in graphics memory; both the color and the depth
+// attachments take about four bytes per pixel
+std::size_t
+memoryUsage(const FramebufferObject& fbo)
+{
+    std::size_t pixels = static_cast<std::size_t>(fbo.width()) * fbo.height();
+    std::size_t bytes = 0;
+    if ((fbo.attachments() & FramebufferObject::ColorAttachment) != 0)
+        bytes += pixels * 4;
+    if ((fbo.attachments() & FramebufferObject::DepthAttachment) != 0)
+        bytes += pixels * 4;
+    return bytes;
+}
+
+} // end unnamed namespace
+
+FramebufferPool::FramebufferPool(std::size_t maxIdleBytes) :
+    m_maxIdleBytes(maxIdleBytes)
+{
+}
+
+FramebufferPool::~FramebufferPool() = default;
+
+std::unique_ptr<FramebufferObject>
+FramebufferPool::acquire(GLuint width, GLuint height, unsigned int attachments)
+{
+    // The most recently released match, which is the most likely to still
+    // be resident
+    auto it = std::find_if(m_idle.rbegin(), m_idle.rend(),
+                           [width, height, attachments](const auto& fbo)
+                           {
+                               return fbo->width() == width &&
+                                      fbo->height() == height &&
+                                      fbo->attachments() == attachments;
+                           });
+    if (it == m_idle.rend())
+        return std::make_unique<FramebufferObject>(width, height, attachments);
+
+    std::unique_ptr<FramebufferObject> fbo = std::move(*it);
+    m_idle.erase(std::next(it).base());
+    m_idleBytes -= memoryUsage(*fbo);
+    return fbo;
+}
+
+void
+FramebufferPool::release(std::unique_ptr<FramebufferObject>&& fbo)
+{
+    if (fbo == nullptr || !fbo->isValid())
+    {
+        fbo = nullptr;
+        return;
+    }
+
+    std::size_t bytes = memoryUsage(*fbo);
+    if (bytes > m_maxIdleBytes)
+    {
+        fbo = nullptr;
+        return;
+    }
+
+    m_idleBytes += bytes;
+    m_idle.push_back(std::move(fbo));
+
+    auto evicted = m_idle.begin();
+    for (; m_idleBytes > m_maxIdleBytes; ++evicted)
+        m_idleBytes -= memoryUsage(**evicted);
+    m_idle.erase(m_idle.begin(), evicted);
+}
+
+void
+FramebufferPool::clear()
+{
+    m_idle.clear();
+    m_idleBytes = 0;
+}
+
+FramebufferPool*
+GetFramebufferPool()
+{
+    // Like the texture manager, the pool lives until the program exits
+    static FramebufferPool* const pool = std::make_unique<FramebufferPool>(MaxIdleBytes).release(); //NOSONAR
+    return pool;
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,62 @@
+// framebufferpool.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Reuse of the framebuffers which are no longer needed.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <celengine/glsupport.h>
+
+class FramebufferObject;
+
+namespace celestia::engine
+{
+
+// Keeps the framebuffers released by their users to hand them out again
+// to the next request of the same size and attachments, so that resizing
+// views back and forth, splitting and merging them or changing the shadow
+// map size doesn't allocate graphics memory each time. The idle
+// framebuffers are limited in size, the oldest being destroyed first. It
+// must be used on the thread which owns the OpenGL context.
+class FramebufferPool
+{
+public:
+    explicit FramebufferPool(std::size_t maxIdleBytes);
+    ~FramebufferPool();
+
+    FramebufferPool(const FramebufferPool&) = delete;
+    FramebufferPool& operator=(const FramebufferPool&) = delete;
+
+    // Return a framebuffer with the given size and attachments, reused if
+    // one was released or created otherwise; it must be checked with
+    // isValid()
+    std::unique_ptr<FramebufferObject> acquire(GLuint width, GLuint height, unsigned int attachments);
+
+    // Keep fbo for a later acquire(); invalid framebuffers are destroyed
+    void release(std::unique_ptr<FramebufferObject>&& fbo);
+
+    // Destroy the idle framebuffers
+    void clear();
+
+    std::size_t getIdleBytes() const { return m_idleBytes; }
+
+private:
+    // Oldest first
+    std::vector<std::unique_ptr<FramebufferObject>> m_idle;
+    std::size_t m_idleBytes{ 0 };
+    std::size_t m_maxIdleBytes;
+};
+
+FramebufferPool* GetFramebufferPool();
+
+} // end namespace celestia::engine
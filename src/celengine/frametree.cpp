@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include "celengine/frametree.h"
 #include "celengine/timeline.h"
 #include "celengine/timelinephase.h"
@@ -19,6 +20,7 @@
 #include <celengine/star.h>
 #include <celengine/location.h>
 #include <celengine/deepskyobj.h>
+#include <celephem/orbit.h>
 
 /* A FrameTree is hierarchy of solar system bodies organized according to
  * the relationship of their reference frames. An object will appear in as
@@ -83,6 +85,8 @@ FrameTree::getDefaultReferenceFrame() const
 void
 FrameTree::markChanged()
 {
+    m_bodyBVH.reset();
+    m_activeEnd = m_activeStart;
     if (!m_changed)
     {
         m_changed = true;
@@ -121,14 +125,17 @@ FrameTree::recomputeBoundingSphere()
     {
         m_boundingSphereRadius = 0.0;
         m_maxChildRadius = 0.0;
+        m_maxOrbitRadius = 0.0;
         m_containsSecondaryIlluminators = false;
         m_childClassMask = BodyClassification::EmptyMask;
 
         for (const auto &phase : children)
         {
             double bodyRadius = phase->body()->getRadius();
-            double r = phase->body()->getCullingRadius() + phase->orbit()->getBoundingRadius();
+            double orbitRadius = phase->orbit()->getBoundingRadius();
+            double r = phase->body()->getCullingRadius() + orbitRadius;
             m_maxChildRadius = max(m_maxChildRadius, bodyRadius);
+            m_maxOrbitRadius = max(m_maxOrbitRadius, orbitRadius);
             m_containsSecondaryIlluminators = m_containsSecondaryIlluminators || phase->body()->isSecondaryIlluminator();
             m_childClassMask |= phase->body()->getClassification();
 
@@ -138,6 +145,7 @@ FrameTree::recomputeBoundingSphere()
                 tree->recomputeBoundingSphere();
                 r += tree->m_boundingSphereRadius;
                 m_maxChildRadius = max(m_maxChildRadius, tree->m_maxChildRadius);
+                m_maxOrbitRadius = max(m_maxOrbitRadius, tree->m_maxOrbitRadius);
                 m_containsSecondaryIlluminators = m_containsSecondaryIlluminators || tree->containsSecondaryIlluminators();
                 m_childClassMask |= tree->childClassMask();
             }
@@ -154,6 +162,8 @@ void
 FrameTree::addChild(const TimelinePhase::SharedConstPtr &phase)
 {
     children.push_back(phase);
+    m_reentrantOrbits.reset();
+    m_activeEnd = m_activeStart;
     markChanged();
 }
 
@@ -168,6 +178,8 @@ FrameTree::removeChild(const TimelinePhase::SharedConstPtr &phase)
     if (iter != children.end())
     {
         children.erase(iter);
+        m_reentrantOrbits.reset();
+        m_activeEnd = m_activeStart;
         markChanged();
     }
 }
@@ -187,3 +199,66 @@ FrameTree::childCount() const
 {
     return children.size();
 }
+
+
+const FrameTree::ReentrantOrbits&
+FrameTree::getReentrantOrbits() const
+{
+    if (m_reentrantOrbits == nullptr)
+    {
+        m_reentrantOrbits = std::make_unique<ReentrantOrbits>();
+        for (unsigned int i = 0; i < children.size(); i++)
+        {
+            const celestia::ephem::Orbit* orbit = children[i]->orbit().get();
+            if (auto elliptical = dynamic_cast<const celestia::ephem::EllipticalOrbit*>(orbit); elliptical != nullptr)
+                m_reentrantOrbits->elliptical.add(*elliptical, i);
+            else if (orbit->isReentrant())
+                m_reentrantOrbits->others.push_back(i);
+        }
+    }
+
+    return *m_reentrantOrbits;
+}
+
+
+const celestia::engine::BodyBVH&
+FrameTree::getBodyBVH(double tdb) const
+{
+    if (m_bodyBVH == nullptr)
+        m_bodyBVH = std::make_unique<celestia::engine::BodyBVH>();
+    else if (m_bodyBVH->getTime() == tdb)
+        return *m_bodyBVH;
+
+    m_bodyBVH->build(*this, tdb);
+    return *m_bodyBVH;
+}
+
+
+const std::vector<unsigned int>&
+FrameTree::getActiveChildren(double tdb) const
+{
+    if (m_activeStart <= tdb && tdb < m_activeEnd)
+        return m_activeChildren;
+
+    // The set of active children is the same between the last phase
+    // boundary at or before tdb and the first one after it.
+    m_activeChildren.clear();
+    m_activeStart = -std::numeric_limits<double>::infinity();
+    m_activeEnd = std::numeric_limits<double>::infinity();
+    for (unsigned int i = 0; i < children.size(); i++)
+    {
+        const TimelinePhase* phase = children[i].get();
+        if (phase->includes(tdb))
+            m_activeChildren.push_back(i);
+
+        for (double boundary : { phase->startTime(), phase->endTime() })
+        {
+            if (boundary <= tdb)
+                m_activeStart = max(m_activeStart, boundary);
+            else
+                m_activeEnd = min(m_activeEnd, boundary);
+        }
+    }
+
+    return m_activeChildren;
+}
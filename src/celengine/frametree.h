@@ -15,6 +15,8 @@
 #include <memory>
 #include <vector>
 #include <cstddef>
+#include <celephem/orbitbatch.h>
+#include "bodybvh.h"
 #include "body.h"
 #include "frame.h"
 #include "timelinephase.h"
@@ -72,6 +74,13 @@ public:
         return m_maxChildRadius;
     }
 
+    /*! Get the bounding radius of the largest orbit in the tree.
+     */
+    double maxOrbitRadius() const
+    {
+        return m_maxOrbitRadius;
+    }
+
     /*! Return whether any of the children of this frame
      *  are secondary illuminators.
      */
@@ -88,6 +97,33 @@ public:
         return m_childClassMask;
     }
 
+    /*! The orbits of the children which may be evaluated concurrently: the
+     *  elliptical orbits, which are evaluated as a batch writing at the
+     *  child indices, and the indices of the other children. Built on first
+     *  use after the children change.
+     */
+    struct ReentrantOrbits
+    {
+        celestia::ephem::EllipticalOrbitBatch elliptical;
+        std::vector<unsigned int> others;
+    };
+
+    const ReentrantOrbits& getReentrantOrbits() const;
+
+    /*! Bounding volume hierarchy over the bodies of this tree and its
+     *  subtrees at the specified time. It is kept until it is requested
+     *  for a different time or the tree changes, so the queries of a
+     *  frame share it.
+     */
+    const celestia::engine::BodyBVH& getBodyBVH(double tdb) const;
+
+    /*! Indices of the children whose phase is active at the specified
+     *  time. The list is kept with the interval between the phase
+     *  boundaries around that time, so it is only rebuilt when the time
+     *  crosses a boundary or the tree changes.
+     */
+    const std::vector<unsigned int>& getActiveChildren(double tdb) const;
+
 private:
     Star* starParent;
     Body* bodyParent;
@@ -95,9 +131,17 @@ private:
 
     double m_boundingSphereRadius{ 0.0 };
     double m_maxChildRadius{ 0.0 };
+    double m_maxOrbitRadius{ 0.0 };
     bool m_containsSecondaryIlluminators{ false };
     bool m_changed{ false };
     BodyClassification m_childClassMask{ BodyClassification::EmptyMask };
 
     ReferenceFrame::SharedConstPtr defaultFrame;
+
+    mutable std::unique_ptr<ReentrantOrbits> m_reentrantOrbits;
+    mutable std::unique_ptr<celestia::engine::BodyBVH> m_bodyBVH;
+
+    mutable std::vector<unsigned int> m_activeChildren;
+    mutable double m_activeStart{ 0.0 };
+    mutable double m_activeEnd{ 0.0 };
 };
@@ -156,6 +156,17 @@ GalaxyType Galaxy::getGalaxyType() const
     return type;
 }
 
+void Galaxy::setGalaxyType(GalaxyType _type)
+{
+    type = _type;
+    setForm({});
+}
+
+bool Galaxy::hasCustomForm() const
+{
+    return form != static_cast<int>(type);
+}
+
 float Galaxy::getBrightnessCorrection(const Eigen::Vector3f &offset) const
 {
     Eigen::Quaternionf orientation = getOrientation().conjugate();
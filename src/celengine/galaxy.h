@@ -75,6 +75,9 @@ public:
     int getFormId() const;
 
     GalaxyType getGalaxyType() const;
+    // Set the type and use the built-in template for it
+    void setGalaxyType(GalaxyType);
+    bool hasCustomForm() const;
 
     float getBrightnessCorrection(const Eigen::Vector3f &) const;
 
@@ -8,8 +8,12 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <celimage/image.h>
 #include <celmath/randutils.h>
@@ -25,6 +29,108 @@ namespace
 {
 constexpr unsigned int kIrrGalaxyPoints = 3500u;
 
+constexpr unsigned int kLodGridBits = 10u;
+constexpr std::uint32_t kLodGridMax = (1u << kLodGridBits) - 1u;
+
+// Interleave the bits of the cell coordinates so that the cells of every
+// coarser grid are contiguous ranges of codes
+std::uint32_t
+mortonCode(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+    std::uint32_t code = 0;
+    for (unsigned int bit = 0; bit < kLodGridBits; ++bit)
+    {
+        code |= ((x >> bit) & 1u) << (3 * bit);
+        code |= ((y >> bit) & 1u) << (3 * bit + 1);
+        code |= ((z >> bit) & 1u) << (3 * bit + 2);
+    }
+    return code;
+}
+
+// Reorder the blobs after the first fixedCount so that every prefix covers
+// the whole form: the renderer draws only the first 2^n blobs of a galaxy
+// which is n levels of detail too small, and the first blobs are drawn the
+// largest. Level k picks the brightest blob from each cell of a 2^k grid
+// which has no blob picked yet; the picks of a level are shuffled so that a
+// level cut short by the galaxy detail is still spread out.
+void
+orderBlobsByImportance(GalacticForm::BlobVector& blobs, std::size_t fixedCount)
+{
+    if (blobs.size() <= fixedCount + 1)
+        return;
+
+    Eigen::Vector3f lower = blobs[fixedCount].position;
+    Eigen::Vector3f upper = lower;
+    for (auto it = blobs.begin() + fixedCount; it != blobs.end(); ++it)
+    {
+        lower = lower.cwiseMin(it->position);
+        upper = upper.cwiseMax(it->position);
+    }
+    Eigen::Vector3f extent = (upper - lower).cwiseMax(1.0e-6f);
+
+    auto quantize = [](float t)
+    {
+        return std::min(static_cast<std::uint32_t>(std::max(t * static_cast<float>(kLodGridMax + 1), 0.0f)), kLodGridMax);
+    };
+
+    std::vector<std::pair<std::uint32_t, std::size_t>> cells;
+    cells.reserve(blobs.size() - fixedCount);
+    for (std::size_t i = fixedCount; i < blobs.size(); ++i)
+    {
+        Eigen::Vector3f t = (blobs[i].position - lower).cwiseQuotient(extent);
+        cells.emplace_back(mortonCode(quantize(t.x()), quantize(t.y()), quantize(t.z())), i);
+    }
+    std::sort(cells.begin(), cells.end());
+
+    GalacticForm::BlobVector ordered(blobs.begin(), blobs.begin() + fixedCount);
+    ordered.reserve(blobs.size());
+    std::vector<bool> picked(cells.size(), false);
+    auto& rng = math::getRNG();
+
+    for (unsigned int level = 0; level <= kLodGridBits; ++level)
+    {
+        unsigned int shift = 3 * (kLodGridBits - level);
+        auto levelStart = static_cast<std::ptrdiff_t>(ordered.size());
+        for (std::size_t first = 0; first < cells.size();)
+        {
+            std::uint32_t cell = cells[first].first >> shift;
+            std::size_t last = first;
+            bool occupied = false;
+            std::size_t brightest = cells.size();
+            for (; last < cells.size() && (cells[last].first >> shift) == cell; ++last)
+            {
+                if (picked[last])
+                    occupied = true;
+                else if (brightest == cells.size()
+                         || blobs[cells[last].second].brightness > blobs[cells[brightest].second].brightness)
+                    brightest = last;
+            }
+
+            if (!occupied && brightest != cells.size())
+            {
+                picked[brightest] = true;
+                ordered.push_back(blobs[cells[brightest].second]);
+            }
+
+            first = last;
+        }
+
+        std::shuffle(ordered.begin() + levelStart, ordered.end(), rng);
+    }
+
+    // Blobs which share a cell at the finest grid, brightest first
+    auto levelStart = static_cast<std::ptrdiff_t>(ordered.size());
+    for (std::size_t i = 0; i < cells.size(); ++i)
+    {
+        if (!picked[i])
+            ordered.push_back(blobs[cells[i].second]);
+    }
+    std::stable_sort(ordered.begin() + levelStart, ordered.end(),
+                     [](const auto& b1, const auto& b2) { return b1.brightness > b2.brightness; });
+
+    blobs = std::move(ordered);
+}
+
 std::optional<celestia::engine::GalacticForm>
 buildGalacticForm(const fs::path& filename)
 {
@@ -104,9 +210,9 @@ buildGalacticForm(const fs::path& filename)
     std::sort(galacticPoints.begin(), galacticPoints.end(),
               [](const auto &b1, const auto &b2) { return b1.position.squaredNorm() < b2.position.squaredNorm(); });
 
-    // reshuffle the galaxy points randomly...except the first kmin+1 in the center!
+    // reorder the galaxy points by importance...except the first kmin+1 in the center!
     // the higher that number the stronger the central "glow"
-    std::shuffle(galacticPoints.begin() + kmin, galacticPoints.end(), math::getRNG());
+    orderBlobsByImportance(galacticPoints, static_cast<std::size_t>(kmin));
 
     std::optional<celestia::engine::GalacticForm> galacticForm(std::in_place);
     galacticForm->blobs = std::move(galacticPoints);
@@ -184,6 +290,8 @@ GalacticFormManager::initializeStandardForms()
         }
     }
 
+    orderBlobsByImportance(irregularPoints, 0);
+
     auto& irregularForm = galacticForms.emplace_back(std::in_place);
     irregularForm->blobs = std::move(irregularPoints);
     irregularForm->scale = Eigen::Vector3f::Constant(0.5f);
@@ -36,6 +36,8 @@ public:
 
     using BlobVector = std::vector<Blob>;
 
+    // Ordered by importance: any prefix of the blobs is spread over the
+    // whole form, so small galaxies draw only the first blobs
     BlobVector      blobs;
     Eigen::Vector3f scale;
 };
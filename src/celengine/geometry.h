@@ -10,12 +10,24 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 #include <Eigen/Geometry>
 
 #include <celmodel/material.h>
 
 class RenderContext;
 
+// One of the copies of a geometry drawn by Geometry::renderInstances()
+struct GeometryInstance
+{
+    // Model to eye coordinates, without the constant last row
+    Eigen::Matrix<float, 3, 4, Eigen::RowMajor> modelView;
+    // Projected radius in pixels, which selects the level of detail
+    float pixelSize;
+};
+
 class Geometry
 {
 public:
@@ -24,6 +36,16 @@ public:
     //! Render the geometry in the specified OpenGL context
     virtual void render(RenderContext& rc, double t = 0.0) = 0;
 
+    /*! Render a copy of the geometry for each of the instances, which may
+     *  be reordered, with few draw calls. The projection matrix of the
+     *  context maps from eye coordinates. Return false without drawing
+     *  anything if the geometry can't be drawn this way.
+     */
+    virtual bool renderInstances(RenderContext&, std::vector<GeometryInstance>&)
+    {
+        return false;
+    }
+
     /*! Find the closest intersection between the ray and the
      *  model.  If the ray intersects the model, return true
      *  and set distance; otherwise return false and leave
@@ -51,6 +73,19 @@ public:
     virtual void loadTextures()
     {
     }
+
+    /*! Create the OpenGL objects used to render the geometry. Geometry
+     *  which is not set up in advance does this when it is first rendered.
+     */
+    virtual void createBuffers()
+    {
+    }
+
+    //! Estimate of the memory used by the geometry, in bytes
+    virtual std::size_t getMemoryUsage() const
+    {
+        return 0;
+    }
 };
 
 class EmptyGeometry : public Geometry
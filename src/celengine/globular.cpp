@@ -151,3 +151,11 @@ void Globular::setDetail(float _detail)
 {
     detail = _detail;
 }
+
+void Globular::setStructure(float coreRadius, float kingConcentration)
+{
+    r_c = coreRadius;
+    c = kingConcentration;
+    formIndex = cSlot(c);
+    recomputeTidalRadius();
+}
@@ -47,6 +47,13 @@ public:
     float getDetail() const;
     void setDetail(float);
 
+    // Core radius in arcminutes
+    float getCoreRadius() const { return r_c; }
+    float getKingConcentration() const { return c; }
+    // The tidal radius depends on the distance, so the position must be set
+    // before calling this.
+    void setStructure(float coreRadius, float kingConcentration);
+
     float getBoundingSphereRadius() const override { return tidalRadius; }
 
     bool pick(const Eigen::ParametrizedLine<double, 3>& ray,
@@ -7,6 +7,10 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <initializer_list>
+#include <utility>
+
+#include <celrender/gl/callcounters.h>
 #include <celutil/logger.h>
 #include "glshader.h"
 
@@ -227,6 +231,7 @@ void
 GLProgram::use() const
 {
     glUseProgram(id);
+    ++celestia::gl::callCounters.shaderSwitches;
 }
 
 
@@ -239,9 +244,34 @@ GLProgram::attach(const GLShader& shader)
 
 GLShaderStatus
 GLProgram::link()
+{
+    startLink();
+    return getLinkStatus();
+}
+
+
+void
+GLProgram::startLink()
 {
     glLinkProgram(id);
+}
+
 
+bool
+GLProgram::isLinkComplete() const
+{
+    if (!celestia::gl::KHR_parallel_shader_compile)
+        return true;
+
+    GLint complete;
+    glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+
+GLShaderStatus
+GLProgram::getLinkStatus() const
+{
     GLint linkSuccess;
     glGetProgramiv(id, GL_LINK_STATUS, &linkSuccess);
     if (linkSuccess != GL_TRUE)
@@ -506,3 +536,54 @@ GLShaderLoader::CreateProgram(const std::string& vsSource,
 
     return CreateProgram(vsSourceVec, gsSourceVec, fsSourceVec, progOut);
 }
+
+
+GLShaderStatus
+GLShaderLoader::CreateProgramDeferred(const std::string& vsSource,
+                                      const std::string& fsSource,
+                                      GLProgram** progOut)
+{
+    GLuint progid = glCreateProgram();
+
+    // Compile errors aren't checked here, as that would wait for the
+    // compiler; they make the program fail to link.
+    for (auto [type, source] : { std::make_pair(GL_VERTEX_SHADER, &vsSource),
+                                 std::make_pair(GL_FRAGMENT_SHADER, &fsSource) })
+    {
+        GLuint shaderid = glCreateShader(type);
+        const char* str = source->c_str();
+        glShaderSource(shaderid, 1, &str, nullptr);
+        glCompileShader(shaderid);
+        glAttachShader(progid, shaderid);
+        // Only flagged for deletion while it's attached to the program
+        glDeleteShader(shaderid);
+    }
+
+    *progOut = new GLProgram(progid);
+
+    return GLShaderStatus::OK;
+}
+
+
+GLShaderStatus
+GLShaderLoader::CreateProgramFromBinary(GLenum format,
+                                        const void* binary,
+                                        GLsizei length,
+                                        GLProgram** progOut)
+{
+    GLuint progid = glCreateProgram();
+    glProgramBinary(progid, format, binary, length);
+
+    // The driver may reject a binary built by a different version
+    GLint linkSuccess;
+    glGetProgramiv(progid, GL_LINK_STATUS, &linkSuccess);
+    if (linkSuccess != GL_TRUE)
+    {
+        glDeleteProgram(progid);
+        return GLShaderStatus::LinkError;
+    }
+
+    *progOut = new GLProgram(progid);
+
+    return GLShaderStatus::OK;
+}
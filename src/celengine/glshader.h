@@ -84,6 +84,12 @@ class GLProgram
     virtual ~GLProgram();
 
     GLShaderStatus link();
+    // Start linking the program without waiting for the result. With
+    // KHR_parallel_shader_compile, isLinkComplete() then tells whether
+    // getLinkStatus() would block.
+    void startLink();
+    bool isLinkComplete() const;
+    GLShaderStatus getLinkStatus() const;
 
     void use() const;
     GLuint getID() const { return id; }
@@ -222,6 +228,15 @@ class GLShaderLoader
                                         const std::string& fsSource,
                                         const std::string& gsSource,
                                         GLProgram**);
+    // Create an unlinked program whose shaders may still be compiling
+    static GLShaderStatus CreateProgramDeferred(const std::string& vsSource,
+                                                const std::string& fsSource,
+                                                GLProgram**);
+    // Create a linked program from a binary returned by glGetProgramBinary
+    static GLShaderStatus CreateProgramFromBinary(GLenum format,
+                                                  const void* binary,
+                                                  GLsizei length,
+                                                  GLProgram**);
 };
 
 
@@ -13,12 +13,16 @@ CELAPI bool OES_texture_border_clamp       = false;
 CELAPI bool OES_geometry_shader            = false;
 #else
 CELAPI bool ARB_vertex_array_object        = false;
+CELAPI bool ARB_instanced_arrays           = false;
+CELAPI bool ARB_buffer_storage             = false;
+CELAPI bool ARB_timer_query                = false;
 CELAPI bool ARB_framebuffer_object         = false;
 #endif
 CELAPI bool ARB_shader_texture_lod         = false;
 CELAPI bool EXT_texture_compression_s3tc   = false;
 CELAPI bool EXT_texture_filter_anisotropic = false;
 CELAPI bool MESA_pack_invert               = false;
+CELAPI bool KHR_parallel_shader_compile    = false;
 CELAPI GLint maxPointSize                  = 0;
 CELAPI GLint maxTextureSize                = 0;
 CELAPI GLfloat maxLineWidth                = 0.0f;
@@ -83,6 +87,10 @@ bool init(util::array_view<std::string> ignore) noexcept
     OES_geometry_shader            = check_extension(ignore, "GL_OES_geometry_shader") || check_extension(ignore, "GL_EXT_geometry_shader");
 #else
     ARB_vertex_array_object        = check_extension(ignore, "GL_ARB_vertex_array_object");
+    ARB_instanced_arrays           = check_extension(ignore, "GL_ARB_instanced_arrays");
+    // Streaming into buffer storage needs sync objects
+    ARB_buffer_storage             = check_extension(ignore, "GL_ARB_buffer_storage") && checkVersion(GL_3_2);
+    ARB_timer_query                = check_extension(ignore, "GL_ARB_timer_query");
     if (!has_extension("GL_ARB_framebuffer_object"))
     {
         fmt::print(_("Mandatory extension GL_ARB_framebuffer_object is missing!\n"));
@@ -93,6 +101,7 @@ bool init(util::array_view<std::string> ignore) noexcept
     EXT_texture_compression_s3tc   = check_extension(ignore, "GL_EXT_texture_compression_s3tc");
     EXT_texture_filter_anisotropic = check_extension(ignore, "GL_EXT_texture_filter_anisotropic") || check_extension(ignore, "GL_ARB_texture_filter_anisotropic");
     MESA_pack_invert               = check_extension(ignore, "GL_MESA_pack_invert");
+    KHR_parallel_shader_compile    = check_extension(ignore, "GL_KHR_parallel_shader_compile");
 
     GLint pointSizeRange[2];
     GLfloat lineWidthRange[2];
@@ -111,6 +120,10 @@ bool init(util::array_view<std::string> ignore) noexcept
     if (gl::EXT_texture_filter_anisotropic)
         glGetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxTextureAnisotropy);
 
+    // Let the driver compile shaders on as many threads as it likes
+    if (gl::KHR_parallel_shader_compile)
+        glMaxShaderCompilerThreadsKHR(0xffffffffu);
+
     enable_workarounds();
 
     return true;
@@ -133,6 +146,15 @@ bool hasGeomShader() noexcept
 #endif
 }
 
+bool hasInstancing() noexcept
+{
+#ifdef GL_ES
+    return checkVersion(celestia::gl::GLES_3_0);
+#else
+    return checkVersion(celestia::gl::GL_3_3) || (checkVersion(celestia::gl::GL_3_2) && ARB_instanced_arrays);
+#endif
+}
+
 void enableGeomShaders() noexcept
 {
     EnableGeomShaders = true;
@@ -43,12 +43,16 @@ extern CELAPI bool ARB_shader_texture_lod; //NOSONAR
 extern CELAPI bool EXT_texture_compression_s3tc; //NOSONAR
 extern CELAPI bool EXT_texture_filter_anisotropic; //NOSONAR
 extern CELAPI bool MESA_pack_invert; //NOSONAR
+extern CELAPI bool KHR_parallel_shader_compile; //NOSONAR
 #ifdef GL_ES
 extern CELAPI bool OES_vertex_array_object; //NOSONAR
 extern CELAPI bool OES_texture_border_clamp; //NOSONAR
 extern CELAPI bool OES_geometry_shader; //NOSONAR
 #else
 extern CELAPI bool ARB_vertex_array_object; //NOSONAR
+extern CELAPI bool ARB_instanced_arrays; //NOSONAR
+extern CELAPI bool ARB_buffer_storage; //NOSONAR
+extern CELAPI bool ARB_timer_query; //NOSONAR
 #endif
 extern CELAPI GLint maxPointSize; //NOSONAR
 extern CELAPI GLint maxTextureSize; //NOSONAR
@@ -58,6 +62,7 @@ extern CELAPI GLint maxTextureAnisotropy; //NOSONAR
 bool init(util::array_view<std::string> = {}) noexcept;
 bool checkVersion(int) noexcept;
 bool hasGeomShader() noexcept;
+bool hasInstancing() noexcept;
 void enableGeomShaders() noexcept;
 void disableGeomShaders() noexcept;
 
@@ -0,0 +1,91 @@
+// gpuframetimer.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Measurement of the GPU time of frames with timer queries.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "gpuframetimer.h"
+
+namespace celestia::engine
+{
+
+GPUFrameTimer::GPUFrameTimer()
+{
+#ifndef GL_ES
+    if (isSupported())
+        glGenQueries(static_cast<GLsizei>(QueryCount), m_queries.data());
+#endif
+}
+
+GPUFrameTimer::~GPUFrameTimer()
+{
+#ifndef GL_ES
+    if (m_queries[0] != 0)
+        glDeleteQueries(static_cast<GLsizei>(QueryCount), m_queries.data());
+#endif
+}
+
+bool
+GPUFrameTimer::isSupported()
+{
+#ifdef GL_ES
+    return false;
+#else
+    return gl::ARB_timer_query;
+#endif
+}
+
+void
+GPUFrameTimer::begin()
+{
+#ifndef GL_ES
+    if (m_queries[0] == 0 || m_pending[m_next])
+        return;
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[m_next]);
+    m_active = true;
+#endif
+}
+
+void
+GPUFrameTimer::end()
+{
+#ifndef GL_ES
+    if (!m_active)
+        return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active = false;
+    m_pending[m_next] = true;
+    m_next = (m_next + 1) % QueryCount;
+#endif
+}
+
+std::optional<double>
+GPUFrameTimer::result()
+{
+#ifndef GL_ES
+    if (!m_pending[m_oldest])
+        return std::nullopt;
+
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_queries[m_oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE)
+        return std::nullopt;
+
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(m_queries[m_oldest], GL_QUERY_RESULT, &elapsed);
+    m_pending[m_oldest] = false;
+    m_oldest = (m_oldest + 1) % QueryCount;
+    return static_cast<double>(elapsed) * 1.0e-9;
+#else
+    return std::nullopt;
+#endif
+}
+
+} // end namespace celestia::engine
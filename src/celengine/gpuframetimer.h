@@ -0,0 +1,55 @@
+// gpuframetimer.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Measurement of the GPU time of frames with timer queries.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <optional>
+
+#include "glsupport.h"
+
+namespace celestia::engine
+{
+
+// Measures the GPU time spent between begin() and end() with a few timer
+// queries in flight, so that reading a result never waits for the GPU.
+// Frames started while all the queries are pending are not measured.
+class GPUFrameTimer
+{
+public:
+    GPUFrameTimer();
+    ~GPUFrameTimer();
+
+    GPUFrameTimer(const GPUFrameTimer&) = delete;
+    GPUFrameTimer& operator=(const GPUFrameTimer&) = delete;
+
+    // Timer queries are available
+    static bool isSupported();
+
+    void begin();
+    void end();
+
+    // Return the time of the oldest measured frame in seconds if the GPU
+    // finished it
+    std::optional<double> result();
+
+private:
+    static constexpr std::size_t QueryCount = 3;
+
+    std::array<GLuint, QueryCount> m_queries{};
+    std::array<bool, QueryCount> m_pending{};
+    std::size_t m_next{ 0 };
+    std::size_t m_oldest{ 0 };
+    bool m_active{ false };
+};
+
+} // end namespace celestia::engine
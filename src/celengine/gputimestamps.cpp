@@ -0,0 +1,87 @@
+// gputimestamps.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// GPU timestamps of the profiler from timer queries.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "gputimestamps.h"
+
+namespace celestia::engine
+{
+
+GPUTimestampQueries::~GPUTimestampQueries()
+{
+#ifndef GL_ES
+    if (!m_queries.empty())
+        glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+#endif
+}
+
+bool
+GPUTimestampQueries::isSupported()
+{
+#ifdef GL_ES
+    return false;
+#else
+    return gl::ARB_timer_query;
+#endif
+}
+
+std::uint32_t
+GPUTimestampQueries::record()
+{
+#ifndef GL_ES
+    std::uint32_t index;
+    if (!m_free.empty())
+    {
+        index = m_free.back();
+        m_free.pop_back();
+    }
+    else if (m_queries.size() < MaxQueries)
+    {
+        index = static_cast<std::uint32_t>(m_queries.size());
+        glGenQueries(1, &m_queries.emplace_back());
+    }
+    else
+    {
+        return InvalidTimestamp;
+    }
+
+    glQueryCounter(m_queries[index], GL_TIMESTAMP);
+    return index;
+#else
+    return InvalidTimestamp;
+#endif
+}
+
+bool
+GPUTimestampQueries::isAvailable(std::uint32_t index)
+{
+#ifndef GL_ES
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != GL_FALSE;
+#else
+    return false;
+#endif
+}
+
+std::uint64_t
+GPUTimestampQueries::take(std::uint32_t index)
+{
+#ifndef GL_ES
+    GLuint64 timestamp = 0;
+    glGetQueryObjectui64v(m_queries[index], GL_QUERY_RESULT, &timestamp);
+    m_free.push_back(index);
+    return timestamp;
+#else
+    return 0;
+#endif
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,48 @@
+// gputimestamps.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// GPU timestamps of the profiler from timer queries.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <celutil/profiler.h>
+#include "glsupport.h"
+
+namespace celestia::engine
+{
+
+// Timestamp queries, which unlike the elapsed time queries of
+// GPUFrameTimer may be nested. The queries are created as needed up to
+// MaxQueries and reused once their results are taken.
+class GPUTimestampQueries : public util::GPUTimestampSource
+{
+public:
+    GPUTimestampQueries() = default;
+    ~GPUTimestampQueries() override;
+
+    GPUTimestampQueries(const GPUTimestampQueries&) = delete;
+    GPUTimestampQueries& operator=(const GPUTimestampQueries&) = delete;
+
+    static bool isSupported();
+
+    std::uint32_t record() override;
+    bool isAvailable(std::uint32_t) override;
+    std::uint64_t take(std::uint32_t) override;
+
+private:
+    static constexpr std::uint32_t MaxQueries = 4096;
+
+    std::vector<GLuint> m_queries;
+    std::vector<std::uint32_t> m_free;
+};
+
+} // end namespace celestia::engine
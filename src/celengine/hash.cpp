@@ -8,6 +8,8 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
+
 #include <celastro/units.h>
 #include <celmath/mathlib.h>
 #include <celutil/color.h>
@@ -19,25 +21,42 @@ namespace astro = celestia::astro;
 namespace math = celestia::math;
 namespace util = celestia::util;
 
+namespace
+{
+// Enough for the keys of most catalog objects
+constexpr std::size_t InitialCapacity = 16;
+}
+
 // Define these here: at declaration the vector member contains an incomplete type
 AssociativeArray::~AssociativeArray() = default;
 
 
 const Value* AssociativeArray::getValue(std::string_view key) const
 {
-    auto iter = assoc.find(key);
-    if (iter == assoc.end())
+    auto iter = std::lower_bound(keys.begin(), keys.end(), key);
+    if (iter == keys.end() || *iter != key)
         return nullptr;
 
-    return &values[iter->second];
+    return &values[static_cast<std::size_t>(iter - keys.begin())];
 }
 
 
+/*! Add a value for the key, unless the key already has one. */
 void AssociativeArray::addValue(std::string&& key, Value&& val)
 {
-    std::size_t index = values.size();
-    if (assoc.try_emplace(std::move(key), index).second)
-        values.emplace_back(std::move(val));
+    auto iter = std::lower_bound(keys.begin(), keys.end(), key);
+    if (iter != keys.end() && *iter == key)
+        return;
+
+    auto index = iter - keys.begin();
+    if (keys.empty())
+    {
+        keys.reserve(InitialCapacity);
+        values.reserve(InitialCapacity);
+    }
+
+    keys.insert(keys.begin() + index, std::move(key));
+    values.insert(values.begin() + index, std::move(val));
 }
 
 
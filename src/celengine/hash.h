@@ -12,7 +12,6 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <map>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -32,8 +31,6 @@ class Value;
 class AssociativeArray
 {
  public:
-    using AssocType = std::map<std::string, std::size_t, std::less<>>;
-
     AssociativeArray() = default;
     ~AssociativeArray();
     AssociativeArray(AssociativeArray&&) = delete;
@@ -139,17 +136,20 @@ class AssociativeArray
     template<typename T>
     void for_all(T action) const
     {
-        for (const auto& [key, value] : assoc)
+        for (std::size_t i = 0; i < keys.size(); ++i)
         {
-            action(key, values[value]);
+            action(keys[i], values[i]);
         }
     }
 
  private:
-    // At this point, Value is an incomplete type. C++17 allows us to store
-    // this in a vector but not a map, so use the map to store vector indices
+    // The keys in sorted order and their values at the same index. Catalog
+    // objects have a few dozen keys at most, so sorted vectors are searched
+    // quickly and take two allocations per hash instead of a map node per
+    // key. At this point, Value is an incomplete type, which C++17 allows
+    // in a vector.
+    std::vector<std::string> keys;
     std::vector<Value> values;
-    AssocType assoc;
 
     std::optional<double> getNumberImpl(std::string_view) const;
     std::optional<Eigen::Vector3d> getVector3Impl(std::string_view) const;
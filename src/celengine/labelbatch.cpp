@@ -0,0 +1,264 @@
+// labelbatch.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Batched rendering of annotation labels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "labelbatch.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <celrender/gl/streambuffer.h>
+#include <celutil/color.h>
+#include "glsupport.h"
+#include "render.h"
+#include "shadermanager.h"
+
+namespace gl = celestia::gl;
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Glyphs drawn by each draw call, each one takes 6 vertices of 24 bytes,
+// so that a draw fits in a region of the stream buffer
+constexpr std::size_t MaxGlyphsPerDraw = 4096;
+
+// Number of laid out label texts above which texts not used in the
+// previous frame are forgotten
+constexpr std::size_t MaxCachedRuns = 16384;
+
+} // end unnamed namespace
+
+LabelBatch::LabelBatch(const Renderer& renderer) :
+    m_renderer(renderer)
+{
+}
+
+LabelBatch::~LabelBatch() = default;
+
+void
+LabelBatch::begin(const std::shared_ptr<TextureFont>& font,
+                  std::uint32_t frame,
+                  bool cullOverlaps,
+                  float width,
+                  float height)
+{
+    if (font != m_font)
+    {
+        m_runs.clear();
+        m_font = font;
+    }
+
+    if (frame != m_frame)
+    {
+        m_frame = frame;
+        if (m_runs.size() > MaxCachedRuns)
+            evict();
+    }
+
+    m_cullOverlaps = cullOverlaps;
+    if (m_cullOverlaps)
+        m_grid.reset(width, height);
+
+    m_labels.clear();
+}
+
+bool
+LabelBatch::add(std::string_view text,
+                TextLayout::HorizontalAlignment halign,
+                const Color& color,
+                float x,
+                float y,
+                float z)
+{
+    if (m_font == nullptr)
+        return false;
+
+    // Reuse the allocation of the lookup key
+    m_lookupKey.text.assign(text);
+    m_lookupKey.halign = halign;
+    auto it = m_runs.find(m_lookupKey);
+    if (it == m_runs.end())
+    {
+        it = m_runs.try_emplace(m_lookupKey).first;
+        layout(it->first, it->second);
+    }
+
+    GlyphRun& run = it->second;
+    run.lastUsed = m_frame;
+    if (run.quads.empty())
+        return false;
+
+    if (m_cullOverlaps)
+    {
+        Eigen::Vector2f origin(x, y);
+        if (!m_grid.reserve(Eigen::AlignedBox2f(run.bounds.min() + origin, run.bounds.max() + origin)))
+            return false;
+    }
+
+    std::uint32_t packedColor;
+    std::memcpy(&packedColor, color.data(), sizeof(packedColor));
+    m_labels.push_back({ &*it, x, y, z, packedColor });
+    return true;
+}
+
+void
+LabelBatch::end(const Eigen::Matrix4f& projection)
+{
+    if (m_labels.empty())
+        return;
+
+    // Adding a glyph which wasn't used before rebuilds the atlas, which
+    // moves the glyphs of the texts laid out earlier
+    for (;;)
+    {
+        unsigned int revision = m_font->getAtlasRevision();
+        for (const QueuedLabel& label : m_labels)
+        {
+            if (label.run->second.atlasRevision != revision)
+                layout(label.run->first, label.run->second);
+        }
+
+        if (revision == m_font->getAtlasRevision())
+            break;
+    }
+
+    gl::StreamBuffer& stream = m_renderer.getStreamBuffer();
+    if (m_vo == nullptr)
+    {
+        m_vo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Triangles);
+        m_vo->addVertexBuffer(stream.buffer(),
+                              CelestiaGLProgram::VertexCoordAttributeIndex,
+                              3,
+                              gl::VertexObject::DataType::Float,
+                              false,
+                              sizeof(LabelVertex),
+                              offsetof(LabelVertex, x));
+        m_vo->addVertexBuffer(stream.buffer(),
+                              CelestiaGLProgram::TextureCoord0AttributeIndex,
+                              2,
+                              gl::VertexObject::DataType::Float,
+                              false,
+                              sizeof(LabelVertex),
+                              offsetof(LabelVertex, u));
+        m_vo->addVertexBuffer(stream.buffer(),
+                              CelestiaGLProgram::ColorAttributeIndex,
+                              4,
+                              gl::VertexObject::DataType::UnsignedByte,
+                              true,
+                              sizeof(LabelVertex),
+                              offsetof(LabelVertex, color));
+    }
+
+    // The font sets up its program and atlas, the vertices are ours
+    m_font->setMVPMatrices(projection);
+    m_font->bind();
+
+    std::size_t remaining = 0;
+    for (const QueuedLabel& label : m_labels)
+        remaining += label.run->second.quads.size();
+
+    auto label = m_labels.cbegin();
+    std::size_t quad = 0;
+    while (remaining > 0)
+    {
+        std::size_t count = std::min(remaining, MaxGlyphsPerDraw);
+        auto allocation = stream.allocate(static_cast<GLsizeiptr>(count * 6 * sizeof(LabelVertex)),
+                                          sizeof(LabelVertex));
+        auto* vertex = static_cast<LabelVertex*>(allocation.data);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            while (quad == label->run->second.quads.size())
+            {
+                ++label;
+                quad = 0;
+            }
+
+            const TextureFont::GlyphQuad& q = label->run->second.quads[quad++];
+            float x1 = label->x + q.x1;
+            float y1 = label->y + q.y1;
+            float x2 = label->x + q.x2;
+            float y2 = label->y + q.y2;
+            float z = label->z;
+            std::uint32_t color = label->color;
+
+            *vertex++ = { x1, y1, z, q.tx1, q.ty2, color };
+            *vertex++ = { x2, y1, z, q.tx2, q.ty2, color };
+            *vertex++ = { x1, y2, z, q.tx1, q.ty1, color };
+            *vertex++ = { x2, y1, z, q.tx2, q.ty2, color };
+            *vertex++ = { x2, y2, z, q.tx2, q.ty1, color };
+            *vertex++ = { x1, y2, z, q.tx1, q.ty1, color };
+        }
+
+        stream.flush();
+        m_vo->draw(static_cast<int>(count * 6), static_cast<int>(allocation.offset / sizeof(LabelVertex)));
+        remaining -= count;
+    }
+
+    m_font->unbind();
+    m_labels.clear();
+}
+
+void
+LabelBatch::layout(const RunKey& key, GlyphRun& run)
+{
+    // Keep the revision from before the layout, so that the run is laid
+    // out again if it loads a glyph itself
+    run.atlasRevision = m_font->getAtlasRevision();
+    run.quads.clear();
+    run.bounds.setEmpty();
+
+    m_lines.clear();
+    if (!TextLayout::processString(key.text, m_lines))
+        return;
+
+    auto ascent = static_cast<float>(m_font->getMaxAscent());
+    auto descent = static_cast<float>(m_font->getMaxDescent());
+    auto lineHeight = static_cast<float>(m_font->getHeight());
+
+    // Each line is aligned to the origin separately, as TextLayout does
+    float y = 0.0f;
+    for (const auto& line : m_lines)
+    {
+        std::size_t first = run.quads.size();
+        float width = m_font->layout(line, 0.0f, y, run.quads).first;
+        float x = 0.0f;
+        if (key.halign == TextLayout::HorizontalAlignment::Center)
+            x = -width / 2.0f;
+        else if (key.halign == TextLayout::HorizontalAlignment::Right)
+            x = -width;
+
+        for (auto it = run.quads.begin() + first; it != run.quads.end(); ++it)
+        {
+            it->x1 += x;
+            it->x2 += x;
+        }
+
+        run.bounds.extend(Eigen::Vector2f(x, y - descent));
+        run.bounds.extend(Eigen::Vector2f(x + width, y + ascent));
+        y -= lineHeight;
+    }
+}
+
+void
+LabelBatch::evict()
+{
+    for (auto it = m_runs.begin(); it != m_runs.end();)
+    {
+        if (it->second.lastUsed + 1 < m_frame)
+            it = m_runs.erase(it);
+        else
+            ++it;
+    }
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,138 @@
+// labelbatch.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Batched rendering of annotation labels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celrender/gl/vertexobject.h>
+#include <celttf/truetypefont.h>
+#include "labelgrid.h"
+#include "textlayout.h"
+
+class Color;
+class Renderer;
+
+namespace celestia::engine
+{
+
+// Draws many single-style labels with a few draw calls. The glyphs of each
+// label text are laid out once and kept while the text is in use, and the
+// labels of a batch are written to the renderer's stream buffer with their
+// color and depth in the vertices, so that no state changes are needed
+// between labels. Optionally, labels which overlap a label added earlier
+// to the same batch are dropped.
+class LabelBatch
+{
+public:
+    explicit LabelBatch(const Renderer& renderer);
+    ~LabelBatch();
+
+    LabelBatch(const LabelBatch&) = delete;
+    LabelBatch& operator=(const LabelBatch&) = delete;
+
+    // Start a batch of labels in font. With cullOverlaps set, the labels
+    // are tested against a grid of the given viewport size.
+    void begin(const std::shared_ptr<TextureFont>& font,
+               std::uint32_t frame,
+               bool cullOverlaps,
+               float width,
+               float height);
+
+    // Queue a label with the alignment edge of its first baseline at
+    // (x, y), in window coordinates. Return false if the label is culled
+    // or has nothing to draw.
+    bool add(std::string_view text,
+             TextLayout::HorizontalAlignment halign,
+             const Color& color,
+             float x,
+             float y,
+             float z);
+
+    // Draw the queued labels with an orthographic projection in window
+    // coordinates
+    void end(const Eigen::Matrix4f& projection);
+
+private:
+    struct RunKey
+    {
+        std::string text;
+        TextLayout::HorizontalAlignment halign;
+
+        friend bool operator==(const RunKey& lhs, const RunKey& rhs)
+        {
+            return lhs.halign == rhs.halign && lhs.text == rhs.text;
+        }
+    };
+
+    struct RunKeyHasher
+    {
+        std::size_t operator()(const RunKey& key) const noexcept
+        {
+            return std::hash<std::string>()(key.text) ^ static_cast<std::size_t>(key.halign);
+        }
+    };
+
+    // The glyphs of a label text, aligned to the origin
+    struct GlyphRun
+    {
+        std::vector<TextureFont::GlyphQuad> quads;
+        Eigen::AlignedBox2f bounds;
+        unsigned int atlasRevision{ 0 };
+        std::uint32_t lastUsed{ 0 };
+    };
+
+    using RunCache = std::unordered_map<RunKey, GlyphRun, RunKeyHasher>;
+
+    struct QueuedLabel
+    {
+        RunCache::value_type* run;
+        float x;
+        float y;
+        float z;
+        std::uint32_t color;
+    };
+
+    struct LabelVertex
+    {
+        float x, y, z;
+        float u, v;
+        std::uint32_t color;
+    };
+
+    void layout(const RunKey& key, GlyphRun& run);
+    void evict();
+
+    const Renderer& m_renderer;
+    std::shared_ptr<TextureFont> m_font;
+    std::uint32_t m_frame{ 0 };
+    bool m_cullOverlaps{ false };
+
+    RunCache m_runs;
+    RunKey m_lookupKey;
+    std::vector<std::u16string> m_lines;
+    std::vector<QueuedLabel> m_labels;
+    LabelGrid m_grid;
+
+    std::unique_ptr<celestia::gl::VertexObject> m_vo;
+};
+
+} // end namespace celestia::engine
@@ -0,0 +1,79 @@
+// labelgrid.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Screen-space grid for culling overlapping labels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "labelgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace celestia::engine
+{
+
+LabelGrid::LabelGrid(float cellSize) :
+    m_cellSize(cellSize)
+{
+}
+
+void
+LabelGrid::reset(float width, float height)
+{
+    m_viewport = Eigen::AlignedBox2f(Eigen::Vector2f::Zero(), Eigen::Vector2f(width, height));
+    m_columns = std::max(1, static_cast<int>(std::ceil(width / m_cellSize)));
+    m_rows = std::max(1, static_cast<int>(std::ceil(height / m_cellSize)));
+
+    m_boxes.clear();
+    // Keep the allocations of the cells, they are refilled every frame
+    m_cells.resize(static_cast<std::size_t>(m_columns * m_rows));
+    for (auto& cell : m_cells)
+        cell.clear();
+}
+
+bool
+LabelGrid::reserve(const Eigen::AlignedBox2f& box)
+{
+    Eigen::AlignedBox2f clipped = box.intersection(m_viewport);
+    if (clipped.isEmpty())
+        return false;
+
+    int x0 = std::clamp(static_cast<int>(clipped.min().x() / m_cellSize), 0, m_columns - 1);
+    int x1 = std::clamp(static_cast<int>(clipped.max().x() / m_cellSize), 0, m_columns - 1);
+    int y0 = std::clamp(static_cast<int>(clipped.min().y() / m_cellSize), 0, m_rows - 1);
+    int y1 = std::clamp(static_cast<int>(clipped.max().y() / m_cellSize), 0, m_rows - 1);
+
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            for (std::uint32_t index : m_cells[static_cast<std::size_t>(y * m_columns + x)])
+            {
+                // Boxes which only share an edge don't overlap
+                const Eigen::AlignedBox2f& other = m_boxes[index];
+                if ((box.min().array() < other.max().array()).all() &&
+                    (other.min().array() < box.max().array()).all())
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    auto index = static_cast<std::uint32_t>(m_boxes.size());
+    m_boxes.push_back(box);
+    for (int y = y0; y <= y1; ++y)
+    {
+        for (int x = x0; x <= x1; ++x)
+            m_cells[static_cast<std::size_t>(y * m_columns + x)].push_back(index);
+    }
+
+    return true;
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,47 @@
+// labelgrid.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Screen-space grid for culling overlapping labels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+namespace celestia::engine
+{
+
+// Keeps track of the screen areas covered by the labels drawn so far. Each
+// area is recorded in the grid cells it touches, so that a new label is
+// only tested against the labels near it.
+class LabelGrid
+{
+public:
+    explicit LabelGrid(float cellSize = 32.0f);
+
+    // Forget all areas and set the size of the viewport
+    void reset(float width, float height);
+
+    // Reserve the area of box unless it overlaps an area reserved earlier
+    // or lies completely outside the viewport. Return true if the area was
+    // reserved.
+    bool reserve(const Eigen::AlignedBox2f& box);
+
+private:
+    float m_cellSize;
+    int m_columns{ 0 };
+    int m_rows{ 0 };
+    Eigen::AlignedBox2f m_viewport;
+    std::vector<Eigen::AlignedBox2f> m_boxes;
+    std::vector<std::vector<std::uint32_t>> m_cells;
+};
+
+} // end namespace celestia::engine
@@ -0,0 +1,149 @@
+// locationindex.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Spatial index of the surface locations of a body.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "locationindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Cells along each edge of a cube face
+constexpr int CellsPerEdge = 16;
+
+// Direction of the center of a cell of the cube face grid
+Eigen::Vector3d
+cellCenter(int face, int iu, int iv)
+{
+    int axis = face / 2;
+    double u = (iu + 0.5) * 2.0 / CellsPerEdge - 1.0;
+    double v = (iv + 0.5) * 2.0 / CellsPerEdge - 1.0;
+
+    Eigen::Vector3d center;
+    center[axis] = (face % 2) == 0 ? 1.0 : -1.0;
+    center[(axis + 1) % 3] = u;
+    center[(axis + 2) % 3] = v;
+    return center.normalized();
+}
+
+int
+cellKey(const Eigen::Vector3d& direction)
+{
+    int axis;
+    direction.cwiseAbs().maxCoeff(&axis);
+    double major = std::abs(direction[axis]);
+    int face = 2 * axis + (direction[axis] < 0.0 ? 1 : 0);
+
+    auto toCell = [](double x)
+    {
+        return std::clamp(static_cast<int>((x + 1.0) * 0.5 * CellsPerEdge), 0, CellsPerEdge - 1);
+    };
+    int iu = toCell(direction[(axis + 1) % 3] / major);
+    int iv = toCell(direction[(axis + 2) % 3] / major);
+    return (face * CellsPerEdge + iv) * CellsPerEdge + iu;
+}
+
+} // end unnamed namespace
+
+void
+LocationIndex::build(const std::vector<Entry>& entries)
+{
+    m_entries.resize(entries.size());
+    std::iota(m_entries.begin(), m_entries.end(), 0U);
+    std::stable_sort(m_entries.begin(), m_entries.end(), [&entries](std::uint32_t a, std::uint32_t b)
+    {
+        return entries[a].priority > entries[b].priority;
+    });
+
+    // Grid cell of each rank; the entries at the center sort after all cells
+    constexpr int CenterKey = 6 * CellsPerEdge * CellsPerEdge;
+    std::vector<std::pair<int, std::uint32_t>> keys;
+    keys.reserve(entries.size());
+    m_maxRadius = 0.0f;
+    for (std::uint32_t rank = 0; rank < m_entries.size(); ++rank)
+    {
+        const Eigen::Vector3f& position = entries[m_entries[rank]].position;
+        float radius = position.norm();
+        m_maxRadius = std::max(m_maxRadius, radius);
+        keys.emplace_back(radius > 0.0f ? cellKey(position.cast<double>()) : CenterKey, rank);
+    }
+
+    std::sort(keys.begin(), keys.end());
+
+    m_ranks.clear();
+    m_cells.clear();
+    m_centerBegin = static_cast<std::uint32_t>(keys.size());
+    for (std::size_t i = 0; i < keys.size();)
+    {
+        int key = keys[i].first;
+        if (key == CenterKey)
+        {
+            m_centerBegin = static_cast<std::uint32_t>(m_ranks.size());
+            for (; i < keys.size(); ++i)
+                m_ranks.push_back(keys[i].second);
+            break;
+        }
+
+        Cell& cell = m_cells.emplace_back();
+        cell.center = cellCenter(key / (CellsPerEdge * CellsPerEdge),
+                                 key % CellsPerEdge,
+                                 (key / CellsPerEdge) % CellsPerEdge);
+        cell.cosRadius = 1.0;
+        cell.begin = static_cast<std::uint32_t>(m_ranks.size());
+        for (; i < keys.size() && keys[i].first == key; ++i)
+        {
+            std::uint32_t rank = keys[i].second;
+            m_ranks.push_back(rank);
+            Eigen::Vector3d direction = entries[m_entries[rank]].position.cast<double>().normalized();
+            cell.cosRadius = std::min(cell.cosRadius, cell.center.dot(direction));
+        }
+
+        cell.end = static_cast<std::uint32_t>(m_ranks.size());
+        cell.cosRadius = std::clamp(cell.cosRadius, -1.0, 1.0);
+        cell.sinRadius = std::sqrt(1.0 - cell.cosRadius * cell.cosRadius);
+    }
+}
+
+void
+LocationIndex::query(const Eigen::Vector3d& axis, double cosAngle, std::vector<std::uint32_t>& result) const
+{
+    result.clear();
+
+    cosAngle = std::clamp(cosAngle, -1.0, 1.0);
+    double sinAngle = std::sqrt(1.0 - cosAngle * cosAngle);
+    for (const Cell& cell : m_cells)
+    {
+        // The cell may overlap the cap when the angle between the cap axis
+        // and the cell center is at most the sum of their radii; a sum of
+        // pi or more covers the whole sphere.
+        if (cell.cosRadius > -cosAngle &&
+            axis.dot(cell.center) < cosAngle * cell.cosRadius - sinAngle * cell.sinRadius)
+        {
+            continue;
+        }
+
+        result.insert(result.end(), m_ranks.begin() + cell.begin, m_ranks.begin() + cell.end);
+    }
+
+    result.insert(result.end(), m_ranks.begin() + m_centerBegin, m_ranks.end());
+
+    std::sort(result.begin(), result.end());
+    for (std::uint32_t& index : result)
+        index = m_entries[index];
+}
+
+} // end namespace celestia::engine
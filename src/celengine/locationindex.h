@@ -0,0 +1,73 @@
+// locationindex.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Spatial index of the surface locations of a body.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace celestia::engine
+{
+
+// Sorts the locations of a body into the cells of a grid on each face of
+// the cube around it, so that the locations in a cap of directions from
+// the body center can be found without testing every location.
+class LocationIndex
+{
+public:
+    struct Entry
+    {
+        // Body-fixed position of the location
+        Eigen::Vector3f position;
+        // Locations with a higher priority are listed first by query()
+        float priority;
+    };
+
+    // Index the entries; the indices returned by query() are positions in
+    // the entries vector
+    void build(const std::vector<Entry>& entries);
+
+    // Replace the contents of result with the indices of the entries whose
+    // direction from the body center may be within the cap of directions
+    // around the unit vector axis whose cosine with it is at least
+    // cosAngle, in decreasing priority. Entries at the body center are
+    // always included.
+    void query(const Eigen::Vector3d& axis, double cosAngle, std::vector<std::uint32_t>& result) const;
+
+    // Largest distance of an entry from the body center
+    float maxRadius() const { return m_maxRadius; }
+
+private:
+    struct Cell
+    {
+        Eigen::Vector3d center;
+        // Cosine and sine of the largest angle between the center and the
+        // direction of an entry in the cell
+        double cosRadius;
+        double sinRadius;
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    // Rank of the entries of each cell in decreasing priority, grouped by
+    // cell and with the entries at the center last
+    std::vector<std::uint32_t> m_ranks;
+    // Index in the entries vector of the entry of each rank
+    std::vector<std::uint32_t> m_entries;
+    // The non-empty cells
+    std::vector<Cell> m_cells;
+    std::uint32_t m_centerBegin{ 0 };
+    float m_maxRadius{ 0.0f };
+};
+
+} // end namespace celestia::engine
@@ -15,6 +15,7 @@
 #include <cstdint>
 #include <cmath>
 #include <limits>
+#include <utility>
 
 #include <boost/container/static_vector.hpp>
 
@@ -23,9 +24,13 @@
 #include <celengine/texture.h>
 #include <celmath/frustum.h>
 #include <celmath/mathlib.h>
+#include <celrender/gl/binder.h>
+#include <celrender/gl/buffer.h>
+#include <celrender/gl/callcounters.h>
 
 #define PTR(p) (reinterpret_cast<const void*>(static_cast<std::uintptr_t>(p)))
 
+namespace gl = celestia::gl;
 namespace math = celestia::math;
 
 namespace
@@ -48,6 +53,10 @@ static_assert(nIndices < std::numeric_limits<unsigned short>::max());
 //     tex coords - 2 floats * MAX_SPHERE_MESH_TEXTURES
 constexpr const int MaxVertexSize = 3 + 3 + LODSphereMesh::MAX_SPHERE_MESH_TEXTURES * 2;
 
+// Memory for the vertices of sections drawn recently; above it, the least
+// recently used sections are dropped until three quarters are left
+constexpr std::size_t MaxSectionBytes = 32 * 1024 * 1024;
+
 
 using ThetaArray = std::array<float, thetaDivisions + 1>;
 using PhiArray   = std::array<float, phiDivisions + 1>;
@@ -247,7 +256,7 @@ createVertices(std::vector<float>& vertices,
                int phi0, int phi1,
                int theta0, int theta1,
                int step,
-               const TextureCoords& tc)
+               bool hasTexCoords)
 {
     for (int phi = phi0; phi <= phi1; phi += step)
     {
@@ -271,7 +280,9 @@ createVertices(std::vector<float>& vertices,
                 vertices.push_back(-ctheta);
             }
 
-            if (tc.nTexturesUsed > 0)
+            // The texture coordinates are transformed to the tile of the
+            // section in the shader
+            if (hasTexCoords)
             {
                 vertices.push_back(static_cast<float>(theta));
                 vertices.push_back(static_cast<float>(phi));
@@ -286,7 +297,8 @@ createVertices(std::vector<float>& vertices,
 
 LODSphereMesh::~LODSphereMesh()
 {
-    glDeleteBuffers(vertexBuffers.size(), vertexBuffers.data());
+    for (const auto& section : sections)
+        glDeleteBuffers(1, &section.second.vertexBuffer);
     glDeleteBuffers(1, &indexBuffer);
 }
 
@@ -358,6 +370,7 @@ void LODSphereMesh::render(unsigned int attributes,
         nTextures = 0;
 
     RenderInfo ri(step, attributes, frustum);
+    renderCount++;
 
     // If one of the textures is split into subtextures, we may have to
     // use extra patches, since there can be at most one subtexture per patch.
@@ -403,65 +416,50 @@ void LODSphereMesh::render(unsigned int attributes,
         // would only cause problems if we rendered in two different contexts
         // and only one had vertex buffer objects.
         while(glGetError() != GL_NO_ERROR);
-        glGenBuffers(vertexBuffers.size(), vertexBuffers.data());
-        if (glGetError() != GL_NO_ERROR)
-            return;
-        vertexBuffersInitialized = true;
-        for (auto vertexBuffer : vertexBuffers)
-        {
-            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-            glBufferData(GL_ARRAY_BUFFER,
-                         maxVertices * MaxVertexSize * sizeof(float),
-                         nullptr,
-                         GL_STREAM_DRAW);
-        }
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-
         glGenBuffers(1, &indexBuffer);
         if (glGetError() != GL_NO_ERROR)
             return;
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     nIndices * sizeof(unsigned short),
-                     nullptr,
-                     GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        vertexBuffersInitialized = true;
     }
 
-    currentVB = 0;
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVB]);
-
-    // Set up the mesh vertices
+    // Set up the mesh indices; they are the same for all the sections, and
+    // only need to be rebuilt when the tesselation changes
     int nRings = phiExtent / ri.step;
     int nSlices = thetaExtent / ri.step;
 
-    indices.clear();
-    int expectedIndices = 2 * (nRings * (nSlices + 1) + std::max(nRings - 1, 0));
-    indices.reserve(expectedIndices);
-    for (int i = 0; i < nRings; i++)
+    gl::Binder::get().bind(gl::Buffer::wrap(indexBuffer, gl::Buffer::TargetHint::ElementArray));
+    if (nRings != indexRings || nSlices != indexSlices)
     {
-        if (i > 0)
-        {
-            indices.push_back(static_cast<unsigned short>(i * (nSlices + 1) + 0));
-        }
-        for (int j = 0; j <= nSlices; j++)
-        {
-            indices.push_back(static_cast<unsigned short>(i * (nSlices + 1) + j));
-            indices.push_back(static_cast<unsigned short>((i + 1) * (nSlices + 1) + j));
-        }
-        if (i < nRings - 1)
+        indices.clear();
+        int expectedIndices = 2 * (nRings * (nSlices + 1) + std::max(nRings - 1, 0));
+        assert(expectedIndices <= nIndices);
+        indices.reserve(expectedIndices);
+        for (int i = 0; i < nRings; i++)
         {
-            indices.push_back(static_cast<unsigned short>((i + 1) * (nSlices + 1) + nSlices));
+            if (i > 0)
+            {
+                indices.push_back(static_cast<unsigned short>(i * (nSlices + 1) + 0));
+            }
+            for (int j = 0; j <= nSlices; j++)
+            {
+                indices.push_back(static_cast<unsigned short>(i * (nSlices + 1) + j));
+                indices.push_back(static_cast<unsigned short>((i + 1) * (nSlices + 1) + j));
+            }
+            if (i < nRings - 1)
+            {
+                indices.push_back(static_cast<unsigned short>((i + 1) * (nSlices + 1) + nSlices));
+            }
         }
-    }
 
-    assert(expectedIndices == indices.size());
+        assert(expectedIndices == indices.size());
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 indices.size() * sizeof(unsigned short),
-                 indices.data(),
-                 GL_DYNAMIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     indices.size() * sizeof(unsigned short),
+                     indices.data(),
+                     GL_STATIC_DRAW);
+        indexRings = nRings;
+        indexSlices = nSlices;
+    }
 
     // Compute the size of a vertex
     vertexSize = 3;
@@ -546,8 +544,11 @@ void LODSphereMesh::render(unsigned int attributes,
         glActiveTexture(GL_TEXTURE0);
     }
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    gl::Binder::get()
+        .unbind(gl::Buffer::TargetHint::Array)
+        .unbind(gl::Buffer::TargetHint::ElementArray);
+
+    evictSections();
 }
 
 
@@ -637,6 +638,8 @@ LODSphereMesh::renderSection(int phi0, int theta0, int extent,
                              const RenderInfo& ri, CelestiaGLProgram *program)
 
 {
+    gl::Binder::get().bind(gl::Buffer::wrap(getSectionBuffer(phi0, theta0, extent, ri)));
+
     auto stride = static_cast<GLsizei>(vertexSize * sizeof(float));
     int texCoordOffset = ((ri.attributes & Tangents) != 0) ? 6 : 3;
 
@@ -670,8 +673,6 @@ LODSphereMesh::renderSection(int phi0, int theta0, int extent,
     // assert(isPow2(extent));
     int thetaExtent = extent;
     int phiExtent = extent / 2;
-    int theta1 = theta0 + thetaExtent;
-    int phi1 = phi0 + phiExtent;
 
     TextureCoords tc{ nTexturesUsed };
 
@@ -731,32 +732,87 @@ LODSphereMesh::renderSection(int phi0, int theta0, int extent,
         }
     }
 
+    int nRings = phiExtent / ri.step;
+    int nSlices = thetaExtent / ri.step;
+    ++gl::callCounters.drawCalls;
+    glDrawElements(GL_TRIANGLE_STRIP,
+                   nRings * (nSlices + 2) * 2 - 2,
+                   GL_UNSIGNED_SHORT,
+                   nullptr);
+}
+
+
+GLuint
+LODSphereMesh::getSectionBuffer(int phi0, int theta0, int extent,
+                                const RenderInfo& ri)
+{
+    bool hasTangents = (ri.attributes & Tangents) != 0;
+    bool hasTexCoords = nTexturesUsed > 0;
+
+    // phi0, theta0 and extent are at most maxDivisions, and the step is
+    // smaller, so each one fits in 16 bits
+    std::uint64_t key = static_cast<std::uint64_t>(phi0) |
+                        (static_cast<std::uint64_t>(theta0) << 16) |
+                        (static_cast<std::uint64_t>(extent) << 32) |
+                        (static_cast<std::uint64_t>(ri.step) << 48) |
+                        (hasTangents ? (UINT64_C(1) << 62) : 0) |
+                        (hasTexCoords ? (UINT64_C(1) << 63) : 0);
+
+    auto [it, inserted] = sections.try_emplace(key);
+    Section& section = it->second;
+    section.lastUsed = renderCount;
+    if (!inserted)
+        return section.vertexBuffer;
+
+    int phi1 = phi0 + extent / 2;
+    int theta1 = theta0 + extent;
+
     vertices.clear();
-    int perVertexFloats = (ri.attributes & Tangents) == 0 ? 3 : 6;
+    int perVertexFloats = hasTangents ? 6 : 3;
     int expectedVertices = ((phi1 - phi0) / ri.step + 1) *
-                           ((theta1 - theta0) / ri.step + 1) * (perVertexFloats + (nTexturesUsed > 0 ? 2 : 0));
+                           ((theta1 - theta0) / ri.step + 1) * (perVertexFloats + (hasTexCoords ? 2 : 0));
     assert(expectedVertices <= maxVertices * MaxVertexSize);
     vertices.reserve(expectedVertices);
-    if ((ri.attributes & Tangents) == 0)
-        createVertices<false>(vertices, phi0, phi1, theta0, theta1, ri.step, tc);
+    if (hasTangents)
+        createVertices<true>(vertices, phi0, phi1, theta0, theta1, ri.step, hasTexCoords);
     else
-        createVertices<true>(vertices, phi0, phi1, theta0, theta1, ri.step, tc);
+        createVertices<false>(vertices, phi0, phi1, theta0, theta1, ri.step, hasTexCoords);
 
     assert(expectedVertices == vertices.size());
 
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), nullptr, GL_STREAM_DRAW);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STREAM_DRAW);
+    section.size = vertices.size() * sizeof(float);
+    glGenBuffers(1, &section.vertexBuffer);
+    gl::Binder::get().bind(gl::Buffer::wrap(section.vertexBuffer));
+    glBufferData(GL_ARRAY_BUFFER, section.size, vertices.data(), GL_STATIC_DRAW);
+    sectionBytes += section.size;
+
+    return section.vertexBuffer;
+}
 
-    int nRings = phiExtent / ri.step;
-    int nSlices = thetaExtent / ri.step;
-    glDrawElements(GL_TRIANGLE_STRIP,
-                   nRings * (nSlices + 2) * 2 - 2,
-                   GL_UNSIGNED_SHORT,
-                   nullptr);
 
-    // Cycle through the vertex buffers
-    currentVB++;
-    if (currentVB == NUM_SPHERE_VERTEX_BUFFERS)
-        currentVB = 0;
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffers[currentVB]);
+void
+LODSphereMesh::evictSections()
+{
+    if (sectionBytes <= MaxSectionBytes)
+        return;
+
+    // Sections drawn by the last call are never dropped
+    std::vector<std::pair<std::uint32_t, std::uint64_t>> byAge;
+    for (const auto& [key, section] : sections)
+    {
+        if (section.lastUsed != renderCount)
+            byAge.emplace_back(section.lastUsed, key);
+    }
+    std::sort(byAge.begin(), byAge.end());
+
+    for (const auto& entry : byAge)
+    {
+        if (sectionBytes <= MaxSectionBytes / 4 * 3)
+            break;
+
+        auto it = sections.find(entry.second);
+        glDeleteBuffers(1, &it->second.vertexBuffer);
+        sectionBytes -= it->second.size;
+        sections.erase(it);
+    }
 }
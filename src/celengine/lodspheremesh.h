@@ -12,6 +12,8 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include <Eigen/Core>
@@ -31,7 +33,6 @@ class LODSphereMesh
 {
 public:
     static constexpr std::size_t MAX_SPHERE_MESH_TEXTURES = 6;
-    static constexpr std::size_t NUM_SPHERE_VERTEX_BUFFERS = 2;
 
     LODSphereMesh() = default;
     ~LODSphereMesh();
@@ -81,17 +82,35 @@ public:
 
     void renderSection(int phi0, int theta0, int extent, const RenderInfo&, CelestiaGLProgram *);
 
+    GLuint getSectionBuffer(int phi0, int theta0, int extent, const RenderInfo&);
+    void evictSections();
+
+    // Vertex buffer of a section of the sphere; the vertices depend only on
+    // the position, size and step of the section and the vertex attributes,
+    // so they are kept on the GPU while the section is in use.
+    struct Section
+    {
+        GLuint vertexBuffer{ 0 };
+        std::size_t size{ 0 };
+        std::uint32_t lastUsed{ 0 };
+    };
+
     int vertexSize{ 0 };
 
     std::vector<float> vertices{};
     std::vector<unsigned short> indices{};
+    // Shape of the triangle strips in indexBuffer
+    int indexRings{ 0 };
+    int indexSlices{ 0 };
 
     int nTexturesUsed{ 0 };
     std::array<Texture*, MAX_SPHERE_MESH_TEXTURES> textures{};
     std::array<unsigned int, MAX_SPHERE_MESH_TEXTURES> subtextures{};
 
     bool vertexBuffersInitialized{ false };
-    GLuint currentVB{ 0 };
-    std::array<GLuint, NUM_SPHERE_VERTEX_BUFFERS> vertexBuffers{};
     GLuint indexBuffer{ 0 };
+
+    std::unordered_map<std::uint64_t, Section> sections{};
+    std::size_t sectionBytes{ 0 };
+    std::uint32_t renderCount{ 0 };
 };
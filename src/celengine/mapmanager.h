@@ -11,6 +11,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <celcompat/filesystem.h>
 #include <celutil/resmanager.h>
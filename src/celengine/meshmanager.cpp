@@ -24,6 +24,7 @@
 #include <celutil/filetype.h>
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
+#include <celutil/parallelfor.h>
 #include <celutil/tokenizer.h>
 #include "hash.h"
 #include "modelgeometry.h"
@@ -40,6 +41,9 @@ namespace celestia::engine
 namespace
 {
 
+// Most threads used to convert the meshes of a 3DS model
+constexpr unsigned int Max3DSConversionThreads = 4;
+
 std::unique_ptr<cmod::Model>
 LoadCelestiaMesh(const fs::path& filename)
 {
@@ -332,6 +336,7 @@ Convert3DSModel(const M3DScene& scene, const fs::path& texPath)
 
     // Convert all models in the scene. Some confusing terminology: a 3ds 'scene' is the same
     // as a Celestia model, and a 3ds 'model' is the same as a Celestia mesh.
+    std::vector<const M3DTriangleMesh*> meshes;
     for (std::uint32_t i = 0; i < scene.getModelCount(); i++)
     {
         const M3DModel* model3ds = scene.getModel(i);
@@ -339,19 +344,29 @@ Convert3DSModel(const M3DScene& scene, const fs::path& texPath)
         {
             for (unsigned int j = 0; j < model3ds->getTriMeshCount(); j++)
             {
-                const M3DTriangleMesh* mesh = model3ds->getTriMesh(j);
-                if (mesh)
-                {
-                    cmod::Mesh cmodmesh = ConvertTriangleMesh(*mesh, scene);
-                    if (cmodmesh.getGroupCount() > 0)
-                        model->addMesh(std::move(cmodmesh));
-                    else
-                        GetLogger()->warn("Skipping mesh with 0 primitive groups!\n");
-                }
+                if (const M3DTriangleMesh* mesh = model3ds->getTriMesh(j); mesh)
+                    meshes.push_back(mesh);
             }
         }
     }
 
+    // The meshes are independent, so they are converted in parallel and
+    // added to the model in their original order
+    std::vector<cmod::Mesh> cmodMeshes(meshes.size());
+    util::ParallelFor(meshes.size(), 1, Max3DSConversionThreads, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+            cmodMeshes[i] = ConvertTriangleMesh(*meshes[i], scene);
+    });
+
+    for (cmod::Mesh& cmodmesh : cmodMeshes)
+    {
+        if (cmodmesh.getGroupCount() > 0)
+            model->addMesh(std::move(cmodmesh));
+        else
+            GetLogger()->warn("Skipping mesh with 0 primitive groups!\n");
+    }
+
     return model;
 }
 
@@ -492,6 +507,19 @@ GeometryInfo::load(const ResourceKey& key) const
     return std::make_unique<ModelGeometry>(std::move(model));
 }
 
+std::unique_ptr<Geometry>
+GeometryInfo::prepare(const ResourceKey& key) const
+{
+    return load(key);
+}
+
+std::unique_ptr<Geometry>
+GeometryInfo::finish(const ResourceKey& /*key*/, std::unique_ptr<Geometry>&& geometry) const
+{
+    geometry->createBuffers();
+    return std::move(geometry);
+}
+
 GeometryManager*
 GetGeometryManager()
 {
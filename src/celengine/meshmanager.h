@@ -26,6 +26,7 @@ class GeometryInfo
 {
 public:
     using ResourceType = Geometry;
+    using PreparedType = Geometry;
 
     // Ensure that models with different centers get resolved to different objects by
     // encoding the center, scale and normalization state in the key.
@@ -72,6 +73,10 @@ public:
 
     ResourceKey resolve(const fs::path&) const;
     std::unique_ptr<Geometry> load(const ResourceKey&) const;
+    // Background loading: the model is read by prepare(), and its vertex
+    // buffers are created by finish()
+    std::unique_ptr<Geometry> prepare(const ResourceKey&) const;
+    std::unique_ptr<Geometry> finish(const ResourceKey&, std::unique_ptr<Geometry>&&) const;
 
 private:
     fs::path source;
@@ -0,0 +1,246 @@
+// minorbodycatalog.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Compact catalog of small bodies drawn as points.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "minorbodycatalog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+#include <Eigen/Core>
+
+#include <celephem/orbit.h>
+#include <celephem/rotation.h>
+#include <celmath/mathlib.h>
+#include <celutil/gettext.h>
+#include <celutil/logger.h>
+#include <celutil/memoryreport.h>
+#include "body.h"
+#include "frametree.h"
+#include "solarsys.h"
+#include "stardb.h"
+#include "timeline.h"
+#include "timelinephase.h"
+#include "universe.h"
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Geometric albedo assumed for the size of promoted bodies
+constexpr float PromotedAlbedo = 0.15f;
+
+bool
+isCommentOrBlank(const std::string& line)
+{
+    auto first = line.find_first_not_of(" \t\r");
+    return first == std::string::npos || line[first] == '#';
+}
+
+} // end unnamed namespace
+
+MinorBodyCatalog::MinorBodyCatalog(Star* center) :
+    m_center(center)
+{
+    m_nameOffsets.push_back(0);
+}
+
+std::unique_ptr<MinorBodyCatalog>
+MinorBodyCatalog::load(std::istream& in, const StarDatabase& starDB)
+{
+    std::string line;
+    unsigned int lineNumber = 0;
+
+    std::unique_ptr<MinorBodyCatalog> catalog;
+    while (catalog == nullptr && std::getline(in, line))
+    {
+        ++lineNumber;
+        if (isCommentOrBlank(line))
+            continue;
+
+        std::istringstream fields(line);
+        std::string keyword;
+        std::string centerName;
+        if (!(fields >> keyword >> std::quoted(centerName)) || keyword != "Center")
+        {
+            util::GetLogger()->error(_("Minor body catalog must start with the name of its center star\n"));
+            return nullptr;
+        }
+
+        Star* center = starDB.find(centerName, false);
+        if (center == nullptr)
+        {
+            util::GetLogger()->error(_("Center star {} of minor body catalog not found\n"), centerName);
+            return nullptr;
+        }
+
+        catalog = std::unique_ptr<MinorBodyCatalog>(new MinorBodyCatalog(center));
+    }
+
+    if (catalog == nullptr)
+        return nullptr;
+
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        if (isCommentOrBlank(line))
+            continue;
+
+        std::istringstream fields(line);
+        std::string designation;
+        double semiMajorAxis;
+        double eccentricity;
+        double inclination;
+        double node;
+        double pericenter;
+        double meanAnomaly;
+        double epoch;
+        float absMag;
+        if (!(fields >> std::quoted(designation)
+                     >> semiMajorAxis >> eccentricity
+                     >> inclination >> node >> pericenter >> meanAnomaly
+                     >> epoch >> absMag)
+            || designation.empty()
+            || semiMajorAxis <= 0.0
+            || eccentricity < 0.0 || eccentricity >= 1.0)
+        {
+            util::GetLogger()->error(_("Bad minor body record at line {}\n"), lineNumber);
+            continue;
+        }
+
+        astro::KeplerElements elements;
+        elements.semimajorAxis = astro::AUtoKilometers(semiMajorAxis);
+        elements.eccentricity = eccentricity;
+        elements.inclination = math::degToRad(inclination);
+        elements.longAscendingNode = math::degToRad(node);
+        elements.argPericenter = math::degToRad(pericenter);
+        elements.meanAnomaly = math::degToRad(meanAnomaly);
+        // Orbital period from Kepler's third law, for a solar mass
+        elements.period = std::pow(semiMajorAxis, 1.5) * 365.25;
+
+        auto index = static_cast<std::uint32_t>(catalog->size());
+        catalog->m_orbits.add(ephem::EllipticalOrbit(elements, epoch), index);
+        catalog->m_elements.push_back(elements);
+        catalog->m_epochs.push_back(epoch);
+        catalog->m_absMags.push_back(absMag);
+        catalog->m_names += designation;
+        catalog->m_nameOffsets.push_back(static_cast<std::uint32_t>(catalog->m_names.size()));
+    }
+
+    catalog->m_nameIndex.resize(catalog->size());
+    for (std::uint32_t i = 0; i < catalog->m_nameIndex.size(); ++i)
+        catalog->m_nameIndex[i] = i;
+    std::sort(catalog->m_nameIndex.begin(), catalog->m_nameIndex.end(),
+              [&catalog](std::uint32_t a, std::uint32_t b)
+              {
+                  return catalog->getDesignation(a) < catalog->getDesignation(b);
+              });
+
+    return catalog;
+}
+
+std::unique_ptr<MinorBodyCatalog>
+MinorBodyCatalog::load(const fs::path& path, const StarDatabase& starDB)
+{
+    std::ifstream in(path);
+    if (!in.good())
+    {
+        util::GetLogger()->error(_("Error opening minor body catalog {}\n"), path);
+        return nullptr;
+    }
+
+    return load(in, starDB);
+}
+
+std::size_t
+MinorBodyCatalog::getMemoryUsage() const
+{
+    return m_orbits.getMemoryUsage() +
+           util::ContainerMemoryUsage(m_elements) +
+           util::ContainerMemoryUsage(m_epochs) +
+           util::ContainerMemoryUsage(m_absMags) +
+           util::ContainerMemoryUsage(m_names) +
+           util::ContainerMemoryUsage(m_nameOffsets) +
+           util::ContainerMemoryUsage(m_nameIndex) +
+           util::ContainerMemoryUsage(m_bodies);
+}
+
+std::string_view
+MinorBodyCatalog::getDesignation(std::uint32_t index) const
+{
+    return std::string_view(m_names).substr(m_nameOffsets[index],
+                                            m_nameOffsets[index + 1] - m_nameOffsets[index]);
+}
+
+std::uint32_t
+MinorBodyCatalog::find(std::string_view designation) const
+{
+    auto it = std::lower_bound(m_nameIndex.begin(), m_nameIndex.end(), designation,
+                               [this](std::uint32_t index, std::string_view name)
+                               {
+                                   return getDesignation(index) < name;
+                               });
+    if (it == m_nameIndex.end() || getDesignation(*it) != designation)
+        return NotFound;
+    return *it;
+}
+
+Body*
+MinorBodyCatalog::getBody(std::uint32_t index) const
+{
+    auto it = m_bodies.find(index);
+    return it == m_bodies.end() ? nullptr : it->second;
+}
+
+/*! Create a Body for a catalog entry, in the solar system of the center
+ *  star. Its size is derived from the absolute magnitude and an assumed
+ *  albedo. The catalog stops drawing the entry as a point once it has a
+ *  Body.
+ */
+Body*
+MinorBodyCatalog::promote(std::uint32_t index, Universe& universe)
+{
+    if (Body* body = getBody(index); body != nullptr)
+        return body;
+
+    SolarSystem* solarSystem = universe.getOrCreateSolarSystem(m_center);
+    Body* body = solarSystem->getPlanets()->addBody(std::string(getDesignation(index)));
+
+    // Diameter from the absolute magnitude: D = 1329 km / sqrt(albedo) * 10^(-H/5)
+    float radius = 0.5f * 1329.0f / std::sqrt(PromotedAlbedo) * std::pow(10.0f, -m_absMags[index] / 5.0f);
+    body->setSemiAxes(Eigen::Vector3f::Constant(radius));
+    body->setGeomAlbedo(PromotedAlbedo);
+    body->setClassification(BodyClassification::Asteroid);
+
+    const auto& frame = solarSystem->getFrameTree()->getDefaultReferenceFrame();
+    auto orbit = std::make_shared<ephem::EllipticalOrbit>(m_elements[index], m_epochs[index]);
+    auto phase = TimelinePhase::CreateTimelinePhase(universe,
+                                                    body,
+                                                    -std::numeric_limits<double>::infinity(),
+                                                    std::numeric_limits<double>::infinity(),
+                                                    frame,
+                                                    orbit,
+                                                    frame,
+                                                    ephem::ConstantOrientation::identity());
+    auto timeline = std::make_unique<Timeline>();
+    timeline->appendPhase(phase);
+    body->setTimeline(std::move(timeline));
+
+    m_bodies.try_emplace(index, body);
+    return body;
+}
+
+} // end namespace celestia::engine
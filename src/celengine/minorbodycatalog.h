@@ -0,0 +1,94 @@
+// minorbodycatalog.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Compact catalog of small bodies drawn as points.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <celastro/astro.h>
+#include <celcompat/filesystem.h>
+#include <celephem/orbitbatch.h>
+
+class Body;
+class Star;
+class StarDatabase;
+class Universe;
+
+namespace celestia::engine
+{
+
+// A catalog of asteroids or other small bodies which is too large to be
+// loaded as Body objects. Only the orbital elements, the absolute magnitude
+// and the designation of each body are kept, and the positions of all
+// bodies are computed together by an EllipticalOrbitBatch. The bodies are
+// drawn as points. A body is promoted to a full Body in the solar system of
+// the catalog when it is looked up by its designation, after which it is
+// drawn and selected like any other body.
+//
+// The catalog is a text file. The first line which is not a comment names
+// the star the orbits are centered on:
+//
+//     Center "Sol"
+//
+// Each following line describes one body: its quoted designation, the
+// semimajor axis in au, the eccentricity, the inclination, the longitude
+// of the ascending node, the argument of pericenter and the mean anomaly
+// in degrees, the epoch of the mean anomaly as a Julian date, and the
+// absolute magnitude H. Orbits are relative to the J2000 ecliptic. Lines
+// starting with # are comments.
+class MinorBodyCatalog
+{
+public:
+    static constexpr std::uint32_t NotFound = UINT32_MAX;
+
+    static std::unique_ptr<MinorBodyCatalog> load(std::istream&, const StarDatabase&);
+    static std::unique_ptr<MinorBodyCatalog> load(const fs::path&, const StarDatabase&);
+
+    Star* getCenter() const { return m_center; }
+    std::size_t size() const { return m_absMags.size(); }
+    // Memory used by the catalog, excluding the promoted bodies
+    std::size_t getMemoryUsage() const;
+
+    const ephem::EllipticalOrbitBatch& getOrbits() const { return m_orbits; }
+    float getAbsoluteMagnitude(std::uint32_t index) const { return m_absMags[index]; }
+    std::string_view getDesignation(std::uint32_t index) const;
+
+    std::uint32_t find(std::string_view designation) const;
+
+    // Return the Body created for a catalog entry, or nullptr if it hasn't
+    // been promoted
+    Body* getBody(std::uint32_t index) const;
+    Body* promote(std::uint32_t index, Universe&);
+
+private:
+    explicit MinorBodyCatalog(Star*);
+
+    Star* m_center;
+    ephem::EllipticalOrbitBatch m_orbits;
+    std::vector<astro::KeplerElements> m_elements;
+    std::vector<double> m_epochs;
+    std::vector<float> m_absMags;
+    // Designations, stored back to back
+    std::string m_names;
+    std::vector<std::uint32_t> m_nameOffsets;
+    // Entry indices sorted by designation
+    std::vector<std::uint32_t> m_nameIndex;
+    std::unordered_map<std::uint32_t, Body*> m_bodies;
+};
+
+} // end namespace celestia::engine
@@ -9,8 +9,12 @@
 // of the License, or (at your option) any later version.
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <utility>
+#include <celmath/frustum.h>
 #include <celrender/gl/buffer.h>
 #include <celrender/gl/vertexobject.h>
 #include <celutil/gettext.h>
@@ -21,11 +25,41 @@
 
 using celestia::util::GetLogger;
 namespace gl = celestia::gl;
+namespace math = celestia::math;
 namespace util = celestia::util;
 
 namespace
 {
 
+// Meshes with up to this many vertices get 16-bit indices
+constexpr unsigned int MaxShortIndexVertices = 65536;
+
+// Triangles in each cluster of a large triangle list
+constexpr int ClusterTriangles = 2048;
+
+// Triangle lists with fewer triangles are always drawn whole
+constexpr int MinClusteredTriangles = ClusterTriangles * 4;
+
+// Clusters with triangles facing further apart than this, given as the
+// cosine of the angle to the average normal, are never culled as facing
+// away from the viewer
+constexpr float MinConeCosine = 0.1f;
+
+// A run of consecutive triangles of a triangle list, which is skipped when
+// its bounding sphere is outside of the view frustum, or when all of its
+// triangles face away from the viewer. The triangles of a list are usually
+// ordered so that consecutive ones are close to each other, which keeps
+// the clusters compact without reordering them.
+struct Cluster
+{
+    Eigen::Vector3f center;
+    float radius;
+    Eigen::Vector3f coneAxis;
+    float coneCutoff;
+    int indicesOffset;
+    int indicesCount;
+};
+
 constexpr gl::VertexObject::DataType GLComponentTypes[static_cast<std::size_t>(cmod::VertexAttributeFormat::FormatMax)] =
 {
      gl::VertexObject::DataType::Float,         // Float1
@@ -95,6 +129,93 @@ setVertexArrays(gl::VertexObject &vao, const gl::Buffer &vbo, const cmod::Vertex
     }
 }
 
+std::vector<Cluster>
+buildClusters(const cmod::Mesh& mesh, const cmod::PrimitiveGroup& group)
+{
+    std::vector<Cluster> clusters;
+
+    const cmod::VertexAttribute& position = mesh.getVertexDescription().getAttribute(cmod::VertexAttributeSemantic::Position);
+    if (group.prim != cmod::PrimitiveGroupType::TriList ||
+        position.format != cmod::VertexAttributeFormat::Float3 ||
+        group.indicesCount < MinClusteredTriangles * 3)
+    {
+        return clusters;
+    }
+
+    const cmod::VWord* vertexData = mesh.getVertexData() + position.offsetWords;
+    unsigned int stride = mesh.getVertexStrideWords();
+    auto getPosition = [&](int index)
+    {
+        Eigen::Vector3f p;
+        std::memcpy(p.data(), vertexData + group.indices[index] * stride, sizeof(float) * 3);
+        return p;
+    };
+
+    int triangleCount = group.indicesCount / 3;
+    std::vector<Eigen::Vector3f> normals;
+    for (int first = 0; first < triangleCount; first += ClusterTriangles)
+    {
+        int last = std::min(first + ClusterTriangles, triangleCount);
+
+        Eigen::AlignedBox3f bounds;
+        Eigen::Vector3f normalSum = Eigen::Vector3f::Zero();
+        normals.clear();
+        for (int i = first * 3; i < last * 3; i += 3)
+        {
+            Eigen::Vector3f p0 = getPosition(i);
+            Eigen::Vector3f p1 = getPosition(i + 1);
+            Eigen::Vector3f p2 = getPosition(i + 2);
+            bounds.extend(p0);
+            bounds.extend(p1);
+            bounds.extend(p2);
+
+            // Front faces are counterclockwise
+            Eigen::Vector3f normal = (p1 - p0).cross(p2 - p0);
+            if (float length = normal.norm(); length > 0.0f)
+            {
+                normals.push_back(normal / length);
+                normalSum += normals.back();
+            }
+        }
+
+        Cluster& cluster = clusters.emplace_back();
+        cluster.center = bounds.center();
+        cluster.radius = 0.0f;
+        for (int i = first * 3; i < last * 3; ++i)
+            cluster.radius = std::max(cluster.radius, (getPosition(i) - cluster.center).norm());
+
+        // The cutoff of 1 never culls a cluster as facing away
+        cluster.coneAxis = normalSum.normalized();
+        cluster.coneCutoff = 1.0f;
+        if (!normals.empty() && normalSum.norm() > 0.0f)
+        {
+            float minCosine = 1.0f;
+            for (const Eigen::Vector3f& normal : normals)
+                minCosine = std::min(minCosine, normal.dot(cluster.coneAxis));
+            if (minCosine > MinConeCosine)
+                cluster.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+        }
+
+        cluster.indicesOffset = first * 3;
+        cluster.indicesCount = (last - first) * 3;
+    }
+
+    return clusters;
+}
+
+
+bool
+isClusterVisible(const Cluster& cluster, const math::Frustum& frustum, const Eigen::Vector3f& eyePos)
+{
+    if (frustum.testSphere(cluster.center, cluster.radius) == math::FrustumAspect::Outside)
+        return false;
+
+    // All the triangles face away from the eye when it is inside the cone
+    // opposite to their normals, widened by the bounding sphere
+    Eigen::Vector3f toCenter = cluster.center - eyePos;
+    return toCenter.dot(cluster.coneAxis) < cluster.coneCutoff * toCenter.norm() + cluster.radius;
+}
+
 } // anonymous namespace
 
 
@@ -104,6 +225,12 @@ public:
     std::vector<gl::Buffer> vbos; // vertex buffer objects
     std::vector<gl::Buffer> vios; // vertex index objects
     std::vector<gl::VertexObject> vaos; // vertex attributes
+    std::vector<gl::VertexObject::IndexType> indexTypes; // type of the indices of each mesh
+    std::vector<std::vector<std::vector<Cluster>>> clusters; // clusters of each group of each mesh
+
+    // Created when the model is first drawn instanced
+    gl::Buffer instances{ util::NoCreateT{} }; // per-instance model/view matrices
+    std::vector<gl::VertexObject> instancedVaos; // vertex and instance attributes
 };
 
 
@@ -134,44 +261,7 @@ ModelGeometry::pick(const Eigen::ParametrizedLine<double, 3>& r, double& distanc
 void
 ModelGeometry::render(RenderContext& rc, double /* t */)
 {
-    // The first time the mesh is rendered, we will try and place the
-    // vertex data in a vertex buffer object and potentially get a huge
-    // rendering performance boost.  This can consume a great deal of
-    // memory, since we're duplicating the vertex data.  TODO: investigate
-    // the possibility of deleting the original data.  We can always map
-    // read-only later on for things like picking, but this could be a low
-    // performance path.
-    if (!m_vbInitialized)
-    {
-        m_vbInitialized = true;
-
-        std::vector<cmod::Index32> indices;
-        for (unsigned int i = 0; i < m_model->getMeshCount(); ++i)
-        {
-            const cmod::Mesh* mesh = m_model->getMesh(i);
-            const cmod::VertexDescription& vertexDesc = mesh->getVertexDescription();
-
-            m_glData->vbos.emplace_back(
-                gl::Buffer::TargetHint::Array,
-                util::array_view<const void>(
-                    mesh->getVertexData(),
-                    mesh->getVertexCount() * vertexDesc.strideBytes));
-
-            indices.reserve(std::max(indices.capacity(), static_cast<std::size_t>(mesh->getIndexCount())));
-            for (unsigned int groupIndex = 0; groupIndex < mesh->getGroupCount(); ++groupIndex)
-            {
-                const auto* group = mesh->getGroup(groupIndex);
-                std::copy(group->indices.begin(), group->indices.end(), std::back_inserter(indices));
-            }
-            m_glData->vios.emplace_back(gl::Buffer::TargetHint::ElementArray, indices);
-            indices.clear();
-
-            gl::VertexObject vao;
-            setVertexArrays(vao, m_glData->vbos.back(), mesh->getVertexDescription());
-            vao.setIndexBuffer(m_glData->vios.back(), 0, gl::VertexObject::IndexType::UnsignedInt);
-            m_glData->vaos.emplace_back(std::move(vao));
-        }
-    }
+    createBuffers();
 
     unsigned int lastMaterial = ~0u;
     unsigned int materialCount = m_model->getMaterialCount();
@@ -187,6 +277,9 @@ ModelGeometry::render(RenderContext& rc, double /* t */)
             return;
         }
 
+        if (!mesh->isInLODRange(rc.getLODPixelSize()))
+            continue;
+
         // Iterate over all primitive groups in the mesh
         for (unsigned int groupIndex = 0; groupIndex < mesh->getGroupCount(); ++groupIndex)
         {
@@ -202,12 +295,216 @@ ModelGeometry::render(RenderContext& rc, double /* t */)
             }
 
             rc.setMaterial(material);
-            rc.drawGroup(m_glData->vaos[meshIndex], *group);
+
+            const std::vector<Cluster>& clusters = m_glData->clusters[meshIndex][groupIndex];
+            const math::Frustum* frustum = rc.getCullingFrustum();
+            if (frustum == nullptr || clusters.empty())
+            {
+                rc.drawGroup(m_glData->vaos[meshIndex], *group);
+                continue;
+            }
+
+            // Draw consecutive visible clusters together
+            int offset = 0;
+            int count = 0;
+            for (const Cluster& cluster : clusters)
+            {
+                if (isClusterVisible(cluster, *frustum, rc.getCullingEyePosition()))
+                {
+                    if (count == 0)
+                        offset = cluster.indicesOffset;
+                    count += cluster.indicesCount;
+                }
+                else if (count > 0)
+                {
+                    rc.drawGroup(m_glData->vaos[meshIndex], *group, offset, count);
+                    count = 0;
+                }
+            }
+
+            if (count > 0)
+                rc.drawGroup(m_glData->vaos[meshIndex], *group, offset, count);
+        }
+    }
+}
+
+
+bool
+ModelGeometry::renderInstances(RenderContext& rc, std::vector<GeometryInstance>& instances)
+{
+    if (!gl::hasInstancing() || instances.empty())
+        return false;
+
+    // Points and sprites are sized by their distance to the eye in model
+    // coordinates, which the instanced shaders don't have
+    for (unsigned int meshIndex = 0; meshIndex < m_model->getMeshCount(); ++meshIndex)
+    {
+        const cmod::Mesh* mesh = m_model->getMesh(meshIndex);
+        for (unsigned int groupIndex = 0; groupIndex < mesh->getGroupCount(); ++groupIndex)
+        {
+            cmod::PrimitiveGroupType prim = mesh->getGroup(groupIndex)->prim;
+            if (prim == cmod::PrimitiveGroupType::SpriteList || prim == cmod::PrimitiveGroupType::PointList)
+                return false;
+        }
+    }
+
+    createBuffers();
+    createInstanceBuffers();
+
+    // Ordered from the largest, the instances drawn with the meshes of a
+    // level of detail are consecutive, and each range is uploaded once
+    std::sort(instances.begin(), instances.end(),
+              [](const GeometryInstance& a, const GeometryInstance& b) { return a.pixelSize > b.pixelSize; });
+    auto uploadedBegin = instances.end();
+    auto uploadedEnd = instances.end();
+
+    unsigned int materialCount = m_model->getMaterialCount();
+    for (unsigned int meshIndex = 0; meshIndex < m_model->getMeshCount(); ++meshIndex)
+    {
+        const cmod::Mesh* mesh = m_model->getMesh(meshIndex);
+        auto inRange = [mesh](const GeometryInstance& instance) { return mesh->isInLODRange(instance.pixelSize); };
+        auto first = std::find_if(instances.begin(), instances.end(), inRange);
+        auto last = std::find_if_not(first, instances.end(), inRange);
+        if (first == last)
+            continue;
+
+        if (first != uploadedBegin || last != uploadedEnd)
+        {
+            m_glData->instances.setData(util::array_view<const void>(&*first, static_cast<std::size_t>(last - first) * sizeof(GeometryInstance)),
+                                        gl::Buffer::BufferUsage::StreamDraw);
+            uploadedBegin = first;
+            uploadedEnd = last;
+        }
+
+        rc.setInstanceCount(static_cast<int>(last - first));
+        for (unsigned int groupIndex = 0; groupIndex < mesh->getGroupCount(); ++groupIndex)
+        {
+            const cmod::PrimitiveGroup* group = mesh->getGroup(groupIndex);
+            rc.updateShader(mesh->getVertexDescription(), group->prim);
+
+            const cmod::Material* material = nullptr;
+            if (group->materialIndex < materialCount)
+                material = m_model->getMaterial(group->materialIndex);
+
+            rc.setMaterial(material);
+            rc.drawGroup(m_glData->instancedVaos[meshIndex], *group);
+        }
+    }
+
+    return true;
+}
+
+
+/*! Create the vertex objects which also read the per-instance model/view
+ *  matrices, unless this has been done already.
+ */
+void
+ModelGeometry::createInstanceBuffers()
+{
+    if (!m_glData->instancedVaos.empty() || m_glData->vaos.empty())
+        return;
+
+    m_glData->instances = gl::Buffer(gl::Buffer::TargetHint::Array);
+    for (unsigned int i = 0; i < m_model->getMeshCount(); ++i)
+    {
+        gl::VertexObject& vao = m_glData->instancedVaos.emplace_back();
+        setVertexArrays(vao, m_glData->vbos[i], m_model->getMesh(i)->getVertexDescription());
+        for (int row = 0; row < 3; ++row)
+        {
+            vao.addInstanceBuffer(m_glData->instances,
+                                  CelestiaGLProgram::InstanceModelViewAttributeIndex + row,
+                                  4,
+                                  gl::VertexObject::DataType::Float,
+                                  false,
+                                  sizeof(GeometryInstance),
+                                  row * sizeof(Eigen::Vector4f));
         }
+        vao.setIndexBuffer(m_glData->vios[i], 0, m_glData->indexTypes[i]);
     }
 }
 
 
+/*! Create the vertex buffers, unless this has been done already.
+ */
+void
+ModelGeometry::createBuffers()
+{
+    if (m_vbInitialized)
+        return;
+
+    // Before the mesh is first rendered, we will try and place the
+    // vertex data in a vertex buffer object and potentially get a huge
+    // rendering performance boost.  This can consume a great deal of
+    // memory, since we're duplicating the vertex data.  TODO: investigate
+    // the possibility of deleting the original data.  We can always map
+    // read-only later on for things like picking, but this could be a low
+    // performance path.
+    m_vbInitialized = true;
+
+    std::vector<cmod::Index32> indices;
+    std::vector<std::uint16_t> shortIndices;
+    for (unsigned int i = 0; i < m_model->getMeshCount(); ++i)
+    {
+        const cmod::Mesh* mesh = m_model->getMesh(i);
+        const cmod::VertexDescription& vertexDesc = mesh->getVertexDescription();
+
+        m_glData->vbos.emplace_back(
+            gl::Buffer::TargetHint::Array,
+            util::array_view<const void>(
+                mesh->getVertexData(),
+                mesh->getVertexCount() * vertexDesc.strideBytes));
+
+        indices.reserve(std::max(indices.capacity(), static_cast<std::size_t>(mesh->getIndexCount())));
+        auto& meshClusters = m_glData->clusters.emplace_back();
+        for (unsigned int groupIndex = 0; groupIndex < mesh->getGroupCount(); ++groupIndex)
+        {
+            const auto* group = mesh->getGroup(groupIndex);
+            std::copy(group->indices.begin(), group->indices.end(), std::back_inserter(indices));
+            meshClusters.push_back(buildClusters(*mesh, *group));
+        }
+
+        // Halve the size of the indices of meshes which don't need more
+        // than 16 bits for them
+        auto indexType = gl::VertexObject::IndexType::UnsignedInt;
+        if (mesh->getVertexCount() <= MaxShortIndexVertices)
+        {
+            shortIndices.assign(indices.begin(), indices.end());
+            m_glData->vios.emplace_back(gl::Buffer::TargetHint::ElementArray, shortIndices);
+            indexType = gl::VertexObject::IndexType::UnsignedShort;
+        }
+        else
+        {
+            m_glData->vios.emplace_back(gl::Buffer::TargetHint::ElementArray, indices);
+        }
+        indices.clear();
+
+        gl::VertexObject vao;
+        setVertexArrays(vao, m_glData->vbos.back(), mesh->getVertexDescription());
+        vao.setIndexBuffer(m_glData->vios.back(), 0, indexType);
+        m_glData->vaos.emplace_back(std::move(vao));
+        m_glData->indexTypes.push_back(indexType);
+    }
+}
+
+
+/*! The vertex and index data of the model, which is counted twice once it
+ *  has been copied to the vertex buffers.
+ */
+std::size_t
+ModelGeometry::getMemoryUsage() const
+{
+    std::size_t size = 0;
+    for (unsigned int i = 0; i < m_model->getMeshCount(); ++i)
+    {
+        const cmod::Mesh* mesh = m_model->getMesh(i);
+        size += static_cast<std::size_t>(mesh->getVertexCount()) * mesh->getVertexDescription().strideBytes;
+        size += static_cast<std::size_t>(mesh->getIndexCount()) * sizeof(cmod::Index32);
+    }
+
+    return m_vbInitialized ? size * 2 : size;
+}
+
+
 bool
 ModelGeometry::isOpaque() const
 {
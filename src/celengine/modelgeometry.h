@@ -10,7 +10,9 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <vector>
 
 #include <Eigen/Geometry>
 
@@ -36,14 +38,19 @@ public:
 
     //! Render the model in the current OpenGL context
     void render(RenderContext&, double t = 0.0) override;
+    bool renderInstances(RenderContext&, std::vector<GeometryInstance>&) override;
 
     bool usesTextureType(cmod::TextureSemantic) const override;
     bool isOpaque() const override;
     bool isNormalized() const override;
 
     void loadTextures() override;
+    void createBuffers() override;
+    std::size_t getMemoryUsage() const override;
 
 private:
+    void createInstanceBuffers();
+
     std::unique_ptr<cmod::Model> m_model;
     std::unique_ptr<ModelOpenGLData> m_glData;
     bool m_vbInitialized{ false };
@@ -65,10 +65,29 @@ Texture* MultiResTexture::find(unsigned int resolution)
 {
     TextureManager* texMan = GetTextureManager();
 
-    Texture* res = texMan->find(tex[resolution]);
+    Texture* res = texMan->findAsync(tex[resolution]);
     if (res != nullptr)
         return res;
 
+    // While the preferred resolution is being loaded in the background,
+    // use the best one which is already there, without loading it.
+    if (texMan->getState(tex[resolution]) == ResourceState::LoadingInProgress)
+    {
+        for (int i = kTextureResolution - 1; i >= 0; --i)
+        {
+            if (texMan->getState(tex[i]) == ResourceState::Loaded)
+                return texMan->find(tex[i]);
+        }
+
+        // Nothing can be drawn yet, so queue the lower resolutions as well,
+        // lowest first: they are much smaller and usually finish long
+        // before the preferred one
+        for (unsigned int i = lores; i < resolution; ++i)
+            texMan->findAsync(tex[i]);
+
+        return nullptr;
+    }
+
     // Preferred resolution isn't available; try the second choice
     // Set these to some defaults to avoid GCC complaints
     // about possible uninitialized variable usage:
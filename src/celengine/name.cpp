@@ -1,5 +1,6 @@
 #include "name.h"
 
+#include <algorithm>
 #include <utility>
 
 #ifdef DEBUG
@@ -7,6 +8,7 @@
 #endif
 #include <celutil/gettext.h>
 #include <celutil/greek.h>
+#include <celutil/memoryreport.h>
 #include <celutil/utf8.h>
 
 void
@@ -21,15 +23,33 @@ NameDatabase::add(const AstroCatalog::IndexNumber catalogNumber, std::string_vie
 #endif
 
     std::string fname = ReplaceGreekLetterAbbr(name);
-    nameIndex[fname] = catalogNumber;
+
+    // Share the pooled copy with the name index unless only the case of
+    // the indexed name differs
+    std::string_view pooledName;
+    if (auto iter = nameIndex.find(fname); iter != nameIndex.end())
+    {
+        if (iter->first == fname)
+            pooledName = iter->first;
+        iter->second = catalogNumber;
+    }
+    if (pooledName.empty())
+        pooledName = names.add(fname);
+    nameIndex.try_emplace(pooledName, catalogNumber);
 
 #ifdef ENABLE_NLS
-    std::string_view lname = D_(fname.c_str());
+    std::string_view lname = D_(pooledName.data());
     if (lname != fname)
-        localizedNameIndex[std::string(lname)] = catalogNumber;
+    {
+        if (auto iter = localizedNameIndex.find(lname); iter != localizedNameIndex.end())
+            iter->second = catalogNumber;
+        else
+            localizedNameIndex.try_emplace(names.add(lname), catalogNumber);
+    }
 #endif
 
-    numberIndex.emplace(catalogNumber, std::move(fname));
+    numberIndex.emplace(catalogNumber, pooledName);
+    completionIndexValid = false;
 }
 
 void NameDatabase::erase(const AstroCatalog::IndexNumber catalogNumber)
@@ -37,6 +57,19 @@ void NameDatabase::erase(const AstroCatalog::IndexNumber catalogNumber)
     numberIndex.erase(catalogNumber);
 }
 
+std::size_t
+NameDatabase::getMemoryUsage() const
+{
+    using celestia::util::ContainerMemoryUsage;
+
+    std::size_t size = names.capacity() + ContainerMemoryUsage(nameIndex) + ContainerMemoryUsage(numberIndex);
+#ifdef ENABLE_NLS
+    size += ContainerMemoryUsage(localizedNameIndex);
+#endif
+    size += ContainerMemoryUsage(foldedNames) + ContainerMemoryUsage(completionIndex);
+    return size;
+}
+
 AstroCatalog::IndexNumber
 NameDatabase::getCatalogNumberByName(std::string_view name, [[maybe_unused]] bool i18n) const
 {
@@ -81,21 +114,67 @@ NameDatabase::getFinalNameIter() const
     return numberIndex.end();
 }
 
+std::string_view
+NameDatabase::getFoldedName(const CompletionEntry& entry) const
+{
+    return std::string_view(foldedNames).substr(entry.offset, entry.length);
+}
+
 void
-NameDatabase::getCompletion(std::vector<std::string>& completion, std::string_view name) const
+NameDatabase::buildCompletionIndex() const
 {
-    std::string name2 = ReplaceGreekLetter(name);
-    for (const auto &[n, _] : nameIndex)
-    {
-        if (UTF8StartsWith(n, name2, true))
-            completion.push_back(n);
-    }
+    foldedNames.clear();
+    completionIndex.clear();
 
+    auto addNames = [this](const NameIndex& index)
+    {
+        for (const auto &[n, _] : index)
+        {
+            auto offset = static_cast<std::uint32_t>(foldedNames.size());
+            UTF8FoldCase(n, foldedNames);
+            auto length = static_cast<std::uint32_t>(foldedNames.size() - offset);
+            completionIndex.push_back({ offset, length, n });
+        }
+    };
+
+    completionIndex.reserve(nameIndex.size());
+    addNames(nameIndex);
 #ifdef ENABLE_NLS
-    for (const auto &[n, _] : localizedNameIndex)
+    completionIndex.reserve(nameIndex.size() + localizedNameIndex.size());
+    addNames(localizedNameIndex);
+#endif
+
+    std::sort(completionIndex.begin(), completionIndex.end(),
+              [this](const CompletionEntry& lhs, const CompletionEntry& rhs)
+              {
+                  return getFoldedName(lhs) < getFoldedName(rhs);
+              });
+
+    completionIndexValid = true;
+}
+
+// Add the names starting with the given one, ignoring case, found by a
+// binary search of the folded names instead of comparing all the names.
+void
+NameDatabase::getCompletion(std::vector<std::string>& completion, std::string_view name) const
+{
+    if (!completionIndexValid)
+        buildCompletionIndex();
+
+    std::string prefix;
+    if (!UTF8FoldCase(ReplaceGreekLetter(name), prefix))
+        return;
+
+    auto iter = std::lower_bound(completionIndex.begin(), completionIndex.end(), prefix,
+                                 [this](const CompletionEntry& entry, std::string_view value)
+                                 {
+                                     return getFoldedName(entry) < value;
+                                 });
+    for (; iter != completionIndex.end(); ++iter)
     {
-        if (UTF8StartsWith(n, name2, true))
-            completion.push_back(n);
+        std::string_view folded = getFoldedName(*iter);
+        if (folded.substr(0, prefix.size()) != prefix)
+            break;
+        completion.emplace_back(iter->name);
     }
-#endif
 }
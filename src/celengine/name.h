@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <map>
 #include <string>
@@ -19,15 +20,18 @@
 #include <vector>
 
 #include <celengine/astroobj.h>
+#include <celutil/stringpool.h>
 #include <celutil/stringutils.h>
 
 // TODO: this can be "detemplatized" by creating e.g. a global-scope enum InvalidCatalogNumber since there
 // lies the one and only need for type genericity.
+// The names are stored once in a string pool, with the indexes holding
+// views of them. The names of the number index are null terminated.
 class NameDatabase
 {
 public:
-    using NameIndex = std::map<std::string, AstroCatalog::IndexNumber, CompareIgnoringCasePredicate>;
-    using NumberIndex = std::multimap<AstroCatalog::IndexNumber, std::string>;
+    using NameIndex = std::map<std::string_view, AstroCatalog::IndexNumber, CompareIgnoringCasePredicate>;
+    using NumberIndex = std::multimap<AstroCatalog::IndexNumber, std::string_view>;
 
     void add(AstroCatalog::IndexNumber, std::string_view);
 
@@ -41,10 +45,33 @@ public:
 
     void getCompletion(std::vector<std::string>& completion, std::string_view name) const;
 
+    // Estimate of the memory used by the names and their indexes
+    std::size_t getMemoryUsage() const;
+
 private:
+    // A name of the name indexes with its case folded form, which is a
+    // range of the folded names buffer
+    struct CompletionEntry
+    {
+        std::uint32_t offset;
+        std::uint32_t length;
+        std::string_view name;
+    };
+
+    void buildCompletionIndex() const;
+    std::string_view getFoldedName(const CompletionEntry&) const;
+
+    celestia::util::StringPool names;
     NameIndex   nameIndex;
 #ifdef ENABLE_NLS
     NameIndex   localizedNameIndex;
 #endif
     NumberIndex numberIndex;
+
+    // The names sorted by their folded forms, so that the names starting
+    // with a prefix are adjacent. Built by the first completion after a
+    // name is added.
+    mutable std::string foldedNames;
+    mutable std::vector<CompletionEntry> completionIndex;
+    mutable bool completionIndexValid{ false };
 };
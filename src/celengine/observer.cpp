@@ -596,6 +596,7 @@ void Observer::computeGotoParameters(const Selection& destination,
     //Vector3d v = targetPosition.offsetFromKm(getPosition()).normalized();
 
     jparams.traj = Linear;
+    jparams.destination = destination;
     jparams.duration = gotoTime;
     jparams.startTime = realTime;
 
@@ -659,6 +660,7 @@ void Observer::computeGotoParametersGC(const Selection& destination,
     //Vector3d v = targetPosition.offsetFromKm(getPosition()).normalized();
 
     jparams.traj = GreatCircle;
+    jparams.destination = destination;
     jparams.duration = gotoTime;
     jparams.startTime = realTime;
 
@@ -795,6 +797,12 @@ Observer::ObserverMode Observer::getMode() const
 }
 
 
+Selection Observer::getTravelDestination() const
+{
+    return observerMode == Travelling ? journey.destination : Selection();
+}
+
+
 void Observer::setMode(Observer::ObserverMode mode)
 {
     observerMode = mode;
@@ -1316,6 +1324,7 @@ void Observer::gotoLocation(const UniversalCoord& toPosition,
 {
     journey.startTime = realTime;
     journey.duration = duration;
+    journey.destination = Selection();
 
     journey.from = position;
     journey.initialOrientation = transformedOrientation;
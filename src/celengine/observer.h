@@ -232,6 +232,8 @@ public:
 
     ObserverMode getMode() const;
     void setMode(ObserverMode);
+    // Object the observer is travelling to, or an empty selection
+    Selection getTravelDestination() const;
 
     enum TrajectoryType
     {
@@ -255,6 +257,8 @@ public:
         Eigen::Quaterniond rotation1; // rotation on the CircularOrbit around centerObject
 
         Selection centerObject;
+        // Object travelled to, if any; used to load its resources early
+        Selection destination;
 
         TrajectoryType traj;
     };
@@ -0,0 +1,189 @@
+// occlusionqueries.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Hardware occlusion tests of objects drawn as points.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "occlusionqueries.h"
+
+#include <celrender/gl/streambuffer.h>
+#include "render.h"
+#include "shadermanager.h"
+
+namespace gl = celestia::gl;
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Tests run in a frame, each one is a separate draw call
+constexpr std::size_t MaxTestsPerFrame = 64;
+
+} // end unnamed namespace
+
+OcclusionQueries::OcclusionQueries(Renderer& renderer) :
+    m_renderer(renderer)
+{
+}
+
+OcclusionQueries::~OcclusionQueries()
+{
+#ifndef GL_ES
+    for (const auto& [object, query] : m_queries)
+    {
+        if (query.id != 0)
+            glDeleteQueries(1, &query.id);
+    }
+    if (!m_freeIds.empty())
+        glDeleteQueries(static_cast<GLsizei>(m_freeIds.size()), m_freeIds.data());
+#endif
+}
+
+bool
+OcclusionQueries::isSupported()
+{
+#ifdef GL_ES
+    return false;
+#else
+    return true;
+#endif
+}
+
+void
+OcclusionQueries::beginFrame()
+{
+#ifndef GL_ES
+    for (auto it = m_queries.begin(); it != m_queries.end();)
+    {
+        Query& query = it->second;
+        if (query.pending)
+        {
+            GLint available = GL_FALSE;
+            glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available != GL_FALSE)
+            {
+                GLuint samples = 0;
+                glGetQueryObjectuiv(query.id, GL_QUERY_RESULT, &samples);
+                query.occluded = samples == 0;
+                query.pending = false;
+            }
+        }
+
+        if (!query.tested && !query.pending)
+        {
+            if (query.id != 0)
+                m_freeIds.push_back(query.id);
+            it = m_queries.erase(it);
+        }
+        else
+        {
+            query.tested = false;
+            ++it;
+        }
+    }
+#endif
+}
+
+bool
+OcclusionQueries::isOccluded(const void* object) const
+{
+    auto it = m_queries.find(object);
+    return it != m_queries.end() && it->second.occluded;
+}
+
+void
+OcclusionQueries::addTest(const void* object,
+                          const Eigen::Vector3f& position,
+                          const Eigen::Matrix4f& projection,
+                          float depth)
+{
+    if (m_tests.size() >= MaxTestsPerFrame)
+        return;
+
+    Query& query = m_queries[object];
+    query.tested = true;
+    // The object keeps the result it has until the earlier test finishes
+    if (query.pending)
+        return;
+
+    m_tests.push_back({ &query, position, projection, depth });
+}
+
+void
+OcclusionQueries::runTests(const Eigen::Matrix4f& modelview)
+{
+#ifndef GL_ES
+    if (m_tests.empty())
+        return;
+
+    auto* prog = m_renderer.getShaderManager().getShader("depth");
+    if (prog == nullptr)
+    {
+        m_tests.clear();
+        return;
+    }
+
+    gl::StreamBuffer& stream = m_renderer.getStreamBuffer();
+    if (m_vo == nullptr)
+    {
+        m_vo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
+        m_vo->addVertexBuffer(stream.buffer(),
+                              CelestiaGLProgram::VertexCoordAttributeIndex,
+                              3,
+                              gl::VertexObject::DataType::Float,
+                              false,
+                              sizeof(Eigen::Vector3f),
+                              0);
+    }
+
+    auto allocation = stream.allocate(static_cast<GLsizeiptr>(m_tests.size() * sizeof(Eigen::Vector3f)),
+                                      sizeof(Eigen::Vector3f));
+    auto* position = static_cast<Eigen::Vector3f*>(allocation.data);
+    for (const Test& test : m_tests)
+        *position++ = test.position;
+    stream.flush();
+
+    Renderer::PipelineState ps;
+    ps.depthTest = true;
+    m_renderer.setPipelineState(ps);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    prog->use();
+    auto first = static_cast<int>(allocation.offset / sizeof(Eigen::Vector3f));
+    for (const Test& test : m_tests)
+    {
+        Query& query = *test.query;
+        if (query.id == 0)
+        {
+            if (m_freeIds.empty())
+            {
+                glGenQueries(1, &query.id);
+            }
+            else
+            {
+                query.id = m_freeIds.back();
+                m_freeIds.pop_back();
+            }
+        }
+
+        prog->setMVPMatrices(test.projection, modelview);
+        glDepthRange(test.depth, test.depth);
+        glBeginQuery(GL_SAMPLES_PASSED, query.id);
+        m_vo->draw(1, first++);
+        glEndQuery(GL_SAMPLES_PASSED);
+        query.pending = true;
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    m_tests.clear();
+#endif
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,90 @@
+// occlusionqueries.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Hardware occlusion tests of objects drawn as points.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celrender/gl/vertexobject.h>
+#include "glsupport.h"
+
+class Renderer;
+
+namespace celestia::engine
+{
+
+// Tests whether the points of objects are hidden by the scene drawn in
+// front of them. The tests of a frame run against its finished depth
+// buffer, and their results are used in the next frame, so that reading
+// them doesn't wait for the GPU. Until a result comes in, an object keeps
+// the previous one; objects never tested are visible.
+class OcclusionQueries
+{
+public:
+    explicit OcclusionQueries(Renderer& renderer);
+    ~OcclusionQueries();
+
+    OcclusionQueries(const OcclusionQueries&) = delete;
+    OcclusionQueries& operator=(const OcclusionQueries&) = delete;
+
+    // Occlusion queries are available
+    static bool isSupported();
+
+    // Collect the results of the tests of the previous frame, and forget
+    // the objects which weren't tested in it
+    void beginFrame();
+
+    // Return true if the last finished test found object hidden
+    bool isOccluded(const void* object) const;
+
+    // Queue a test of the visibility of object at position, in the
+    // coordinates of the modelview and projection matrices. The test is
+    // done at the window depth of depth, so that it isn't hidden by the
+    // object itself.
+    void addTest(const void* object,
+                 const Eigen::Vector3f& position,
+                 const Eigen::Matrix4f& projection,
+                 float depth);
+
+    // Run the queued tests against the depth buffer; modelview is the one
+    // the test positions are in
+    void runTests(const Eigen::Matrix4f& modelview);
+
+private:
+    struct Query
+    {
+        GLuint id{ 0 };
+        bool pending{ false };
+        bool occluded{ false };
+        bool tested{ false };
+    };
+
+    struct Test
+    {
+        Query* query;
+        Eigen::Vector3f position;
+        Eigen::Matrix4f projection;
+        float depth;
+    };
+
+    Renderer& m_renderer;
+    std::unordered_map<const void*, Query> m_queries;
+    std::vector<Test> m_tests;
+    std::vector<GLuint> m_freeIds;
+    std::unique_ptr<celestia::gl::VertexObject> m_vo;
+};
+
+} // end namespace celestia::engine
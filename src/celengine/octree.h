@@ -12,13 +12,22 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <queue>
 #include <utility>
 #include <vector>
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celutil/array_view.h>
 
 namespace celestia::engine
 {
@@ -57,6 +66,82 @@ StaticOctreeNode<PREC>::StaticOctreeNode(const PointType& _center,
 
 } // end namespace celestia::engine::detail
 
+// View frustum planes stored in structure-of-arrays layout, so that a node
+// can be tested against all of the planes at once using SIMD operations.
+// Unused lanes have zero normals and a maximal offset, so that they never
+// cull a node.
+template<class PREC>
+class OctreeFrustum
+{
+public:
+    using PlaneType = Eigen::Hyperplane<PREC, 3>;
+    using PointType = Eigen::Matrix<PREC, 3, 1>;
+
+    enum class Classification
+    {
+        Outside,
+        Boundary,
+        Inside,
+    };
+
+    static constexpr unsigned int MaxPlanes = 8;
+
+    explicit OctreeFrustum(util::array_view<PlaneType>);
+
+    bool isCubeOutside(const PointType&, PREC) const;
+    Classification classifyCube(const PointType&, PREC, PREC) const;
+
+private:
+    using LaneType = Eigen::Array<PREC, MaxPlanes, 1>;
+
+    LaneType m_normalX{ LaneType::Zero() };
+    LaneType m_normalY{ LaneType::Zero() };
+    LaneType m_normalZ{ LaneType::Zero() };
+    LaneType m_offset{ LaneType::Constant(std::numeric_limits<PREC>::max()) };
+    // Projected half-extent of a unit cube onto each plane normal
+    LaneType m_extent{ LaneType::Zero() };
+};
+
+template<class PREC>
+OctreeFrustum<PREC>::OctreeFrustum(util::array_view<PlaneType> planes)
+{
+    assert(planes.size() <= MaxPlanes);
+    for (unsigned int i = 0, end = static_cast<unsigned int>(std::min<std::size_t>(planes.size(), MaxPlanes)); i < end; ++i)
+    {
+        const PlaneType& plane = planes[i];
+        m_normalX[i] = plane.normal().x();
+        m_normalY[i] = plane.normal().y();
+        m_normalZ[i] = plane.normal().z();
+        m_offset[i] = plane.offset();
+        m_extent[i] = plane.normal().cwiseAbs().sum();
+    }
+}
+
+// Test whether a cube with the given center and half-size lies entirely on
+// the negative side of any of the planes.
+template<class PREC>
+bool
+OctreeFrustum<PREC>::isCubeOutside(const PointType& center, PREC size) const
+{
+    LaneType distance = m_normalX * center.x() + m_normalY * center.y() + m_normalZ * center.z() + m_offset;
+    return (distance < -size * m_extent).any();
+}
+
+// Classify a cube with respect to planes which may each be displaced by up
+// to margin: Outside and Inside results hold for all such displacements.
+template<class PREC>
+typename OctreeFrustum<PREC>::Classification
+OctreeFrustum<PREC>::classifyCube(const PointType& center, PREC size, PREC margin) const
+{
+    LaneType distance = m_normalX * center.x() + m_normalY * center.y() + m_normalZ * center.z() + m_offset;
+    LaneType limit = -size * m_extent;
+    if ((distance < limit - margin).any())
+        return Classification::Outside;
+    if ((distance >= limit + margin).all())
+        return Classification::Inside;
+    return Classification::Boundary;
+}
+
 template <class OBJ, class PREC>
 class OctreeProcessor
 {
@@ -68,6 +153,23 @@ protected:
     OctreeProcessor() = default;
 };
 
+// Work done by a visibility search of an octree: the nodes tested and those
+// accepted, and the objects passed to the handler
+struct OctreeTraversalStats
+{
+    std::uint64_t nodesVisited{ 0 };
+    std::uint64_t nodesAccepted{ 0 };
+    std::uint64_t objectsProcessed{ 0 };
+
+    OctreeTraversalStats& operator+=(const OctreeTraversalStats& other)
+    {
+        nodesVisited += other.nodesVisited;
+        nodesAccepted += other.nodesAccepted;
+        objectsProcessed += other.objectsProcessed;
+        return *this;
+    }
+};
+
 template<class TRAITS, class STORAGE>
 class DynamicOctree;
 
@@ -83,8 +185,10 @@ class StaticOctree
 {
 public:
     using PointType = Eigen::Matrix<PREC, 3, 1>;
+    using NodeType = detail::StaticOctreeNode<PREC>;
 
     StaticOctree() = default;
+    StaticOctree(std::vector<NodeType>&&, std::vector<OBJ>&&);
     ~StaticOctree() = default;
 
     StaticOctree(const StaticOctree&) = delete;
@@ -94,23 +198,51 @@ public:
 
     template<typename PROCESSOR>
     void processDepthFirst(PROCESSOR&) const;
+    template<typename PROCESSOR>
+    void processDepthFirstIndexed(PROCESSOR&) const;
+    template<typename PROCESSOR>
+    void processTopLevelsIndexed(PROCESSOR&, OctreeDepthType, std::vector<OctreeNodeIndex>&) const;
+    template<typename PROCESSOR>
+    void processSubtreeIndexed(PROCESSOR&, OctreeNodeIndex) const;
+    template<typename PROCESSOR>
+    void processObjectRanges(PROCESSOR&) const;
+    template<typename PROCESSOR>
+    void processBestFirst(PROCESSOR&) const;
 
     OctreeObjectIndex size() const;
     OctreeNodeIndex nodeCount() const;
+    // Size of the node and object arrays, excluding any memory the objects
+    // point to
+    std::size_t nodeMemoryUsage() const { return m_nodes.capacity() * sizeof(NodeType); }
+    std::size_t objectMemoryUsage() const { return m_objects.capacity() * sizeof(OBJ); }
 
     OBJ& operator[](OctreeObjectIndex);
     const OBJ& operator[](OctreeObjectIndex) const;
 
-private:
-    using NodeType = detail::StaticOctreeNode<PREC>;
+    const NodeType& getNode(OctreeNodeIndex) const;
 
+private:
     std::vector<NodeType> m_nodes;
     std::vector<OBJ> m_objects;
 
+    template<typename PROCESSOR>
+    void processRangeIndexed(PROCESSOR&, OctreeNodeIndex, OctreeNodeIndex) const;
+
     template<class TRAITS, class STORAGE>
     friend class DynamicOctree;
 };
 
+// Construct a static octree from a previously flattened node array, e.g. one
+// loaded from a catalog file. The nodes must be stored in depth-first order
+// with valid skip links, and the objects must already be sorted by node.
+template<class OBJ, class PREC>
+StaticOctree<OBJ, PREC>::StaticOctree(std::vector<NodeType>&& nodes,
+                                      std::vector<OBJ>&& objects) :
+    m_nodes(std::move(nodes)),
+    m_objects(std::move(objects))
+{
+}
+
 template<class OBJ, class PREC>
 template<typename PROCESSOR>
 void
@@ -136,6 +268,185 @@ StaticOctree<OBJ, PREC>::processDepthFirst(PROCESSOR& processor) const
     }
 }
 
+// As processDepthFirst, but the processor is passed the index of each object
+// rather than the object itself, so it may read per-object data stored in
+// arrays parallel to the octree.
+template<class OBJ, class PREC>
+template<typename PROCESSOR>
+void
+StaticOctree<OBJ, PREC>::processDepthFirstIndexed(PROCESSOR& processor) const
+{
+    processRangeIndexed(processor, 0, nodeCount());
+}
+
+// Process the nodes above the specified depth, and collect the roots of the
+// subtrees at that depth whose parents were accepted by the processor. The
+// subtrees are disjoint ranges of the node array, so they may be passed to
+// processSubtreeIndexed on separate threads, each with its own processor.
+// Together the two calls visit the same objects as processDepthFirstIndexed.
+template<class OBJ, class PREC>
+template<typename PROCESSOR>
+void
+StaticOctree<OBJ, PREC>::processTopLevelsIndexed(PROCESSOR& processor,
+                                                 OctreeDepthType depth,
+                                                 std::vector<OctreeNodeIndex>& subtrees) const
+{
+    if (m_nodes.empty())
+        return;
+
+    // Pairs of node index and depth still to be visited
+    std::vector<std::pair<OctreeNodeIndex, OctreeDepthType>> stack;
+    stack.emplace_back(0, 0);
+    while (!stack.empty())
+    {
+        auto [nodeIdx, nodeDepth] = stack.back();
+        stack.pop_back();
+
+        if (nodeDepth == depth)
+        {
+            subtrees.push_back(nodeIdx);
+            continue;
+        }
+
+        const NodeType& node = m_nodes[nodeIdx];
+        if (!processor.checkNode(node.center, node.scale, node.brightFactor))
+            continue;
+
+        for (OctreeObjectIndex idx = node.first; idx < node.last; ++idx)
+        {
+            processor.process(idx);
+        }
+
+        // Children follow their parent, linked by their skip links; the
+        // last nodes in the array have no valid skip link
+        OctreeNodeIndex endIdx = std::min(node.right, nodeCount());
+        for (OctreeNodeIndex childIdx = nodeIdx + 1; childIdx < endIdx; childIdx = m_nodes[childIdx].right)
+        {
+            stack.emplace_back(childIdx, nodeDepth + 1);
+        }
+    }
+}
+
+template<class OBJ, class PREC>
+template<typename PROCESSOR>
+void
+StaticOctree<OBJ, PREC>::processSubtreeIndexed(PROCESSOR& processor,
+                                               OctreeNodeIndex rootIdx) const
+{
+    processRangeIndexed(processor, rootIdx, std::min(m_nodes[rootIdx].right, nodeCount()));
+}
+
+template<class OBJ, class PREC>
+template<typename PROCESSOR>
+void
+StaticOctree<OBJ, PREC>::processRangeIndexed(PROCESSOR& processor,
+                                             OctreeNodeIndex nodeIdx,
+                                             OctreeNodeIndex endIdx) const
+{
+    while (nodeIdx < endIdx)
+    {
+        const NodeType& node = m_nodes[nodeIdx];
+        if (!processor.checkNode(node.center, node.scale, node.brightFactor))
+        {
+            nodeIdx = node.right;
+            continue;
+        }
+
+        for (OctreeObjectIndex idx = node.first; idx < node.last; ++idx)
+        {
+            processor.process(idx);
+        }
+
+        ++nodeIdx;
+    }
+}
+
+// Node-level variant of processDepthFirstIndexed: the processor is passed
+// the range of object indices in each accepted node instead of the objects.
+template<class OBJ, class PREC>
+template<typename PROCESSOR>
+void
+StaticOctree<OBJ, PREC>::processObjectRanges(PROCESSOR& processor) const
+{
+    OctreeNodeIndex nodeIdx = 0;
+    OctreeNodeIndex endIdx = nodeCount();
+    while (nodeIdx < endIdx)
+    {
+        const NodeType& node = m_nodes[nodeIdx];
+        if (!processor.checkNode(node.center, node.scale, node.brightFactor))
+        {
+            nodeIdx = node.right;
+            continue;
+        }
+
+        if (node.first < node.last)
+            processor.process(node.first, node.last);
+
+        ++nodeIdx;
+    }
+}
+
+// Visit the nodes in increasing order of processor.nodeKey(center, scale,
+// brightFactor), which must be a lower bound of the processor's key for
+// every object in the subtree of the node, passing the index of each object
+// to processor.process(). Nodes whose key fails processor.acceptKey() are
+// skipped along with their subtrees, and the search ends at the first such
+// node taken from the queue, so a processor which collects the k objects
+// with the smallest keys only visits the nodes near them. The objects
+// outside the root node belong to no node and are passed first.
+template<class OBJ, class PREC>
+template<typename PROCESSOR>
+void
+StaticOctree<OBJ, PREC>::processBestFirst(PROCESSOR& processor) const
+{
+    if (m_nodes.empty())
+        return;
+
+    // Objects outside the root node follow the objects of the last
+    // non-empty node and can't be bounded, so they are always processed
+    OctreeObjectIndex excludedIdx = 0;
+    for (auto it = m_nodes.rbegin(); it != m_nodes.rend(); ++it)
+    {
+        if (it->last > it->first)
+        {
+            excludedIdx = it->last;
+            break;
+        }
+    }
+
+    for (OctreeObjectIndex idx = excludedIdx; idx < size(); ++idx)
+    {
+        processor.process(idx);
+    }
+
+    using KeyType = decltype(processor.nodeKey(m_nodes[0].center, m_nodes[0].scale, m_nodes[0].brightFactor));
+    using QueueEntry = std::pair<KeyType, OctreeNodeIndex>;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    queue.emplace(processor.nodeKey(m_nodes[0].center, m_nodes[0].scale, m_nodes[0].brightFactor), 0);
+    while (!queue.empty())
+    {
+        auto [key, nodeIdx] = queue.top();
+        queue.pop();
+        if (!processor.acceptKey(key))
+            break;
+
+        const NodeType& node = m_nodes[nodeIdx];
+        for (OctreeObjectIndex idx = node.first; idx < node.last; ++idx)
+        {
+            processor.process(idx);
+        }
+
+        OctreeNodeIndex endIdx = std::min(node.right, nodeCount());
+        for (OctreeNodeIndex childIdx = nodeIdx + 1; childIdx < endIdx; childIdx = m_nodes[childIdx].right)
+        {
+            const NodeType& child = m_nodes[childIdx];
+            KeyType childKey = processor.nodeKey(child.center, child.scale, child.brightFactor);
+            if (processor.acceptKey(childKey))
+                queue.emplace(childKey, childIdx);
+        }
+    }
+}
+
 template<class OBJ, class PREC>
 OctreeObjectIndex
 StaticOctree<OBJ, PREC>::size() const
@@ -164,4 +475,11 @@ StaticOctree<OBJ, PREC>::operator[](OctreeObjectIndex idx) const
     return m_objects[idx];
 }
 
+template<class OBJ, class PREC>
+const typename StaticOctree<OBJ, PREC>::NodeType&
+StaticOctree<OBJ, PREC>::getNode(OctreeNodeIndex idx) const
+{
+    return m_nodes[idx];
+}
+
 } // end namespace celestia::engine
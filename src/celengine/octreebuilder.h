@@ -16,8 +16,11 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <memory>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -41,7 +44,7 @@ struct DynamicOctreeNode
 
     explicit DynamicOctreeNode(const PointType&);
 
-    bool isStraddling(const PointType&, PREC);
+    bool isStraddling(const PointType&, PREC) const;
 
     PointType center;
     std::vector<OctreeObjectIndex> objIndices;
@@ -56,7 +59,7 @@ DynamicOctreeNode<PREC>::DynamicOctreeNode(const PointType& _center) :
 
 template<class PREC>
 bool
-DynamicOctreeNode<PREC>::isStraddling(const PointType& pos, PREC radius)
+DynamicOctreeNode<PREC>::isStraddling(const PointType& pos, PREC radius) const
 {
     return radius > PREC(0) && (pos - center).cwiseAbs().minCoeff() < radius;
 }
@@ -69,6 +72,11 @@ DynamicOctreeNode<PREC>::isStraddling(const PointType& pos, PREC radius)
 // with objects in the same octree node all placed adjacent to each other.
 // This spatial sorting of the objects dramatically improves the performance
 // of octree operations through much more coherent memory access.
+//
+// If more than one thread is requested, the objects are first partitioned
+// among the octants of the root node, and the subtrees are then built
+// concurrently. The resulting octree is identical to the one produced by
+// serial insertion.
 
 template<class TRAITS, class STORAGE>
 class DynamicOctree
@@ -88,7 +96,8 @@ public:
                   const PointType& rootCenter,
                   PrecisionType rootSize,
                   float rootExclusionFactor,
-                  OctreeObjectIndex splitThreshold);
+                  OctreeObjectIndex splitThreshold,
+                  unsigned int maxThreads = 1);
 
     DynamicOctree(const DynamicOctree&) = delete;
     DynamicOctree& operator=(const DynamicOctree&) = delete;
@@ -100,18 +109,33 @@ public:
 private:
     using NodeType = detail::DynamicOctreeNode<PrecisionType>;
 
-    void insertObject(OctreeObjectIndex);
-    void splitNode(NodeType&, OctreeDepthType);
-    OctreeNodeIndex getChild(NodeType&, OctreeDepthType, const PointType&);
+    // Node storage and per-depth node sizes and exclusion factors. Subtrees
+    // built on worker threads each have their own instance, which is merged
+    // into the main tree afterwards.
+    struct NodeTree
+    {
+        BlockArray<NodeType> nodes;
+        std::vector<PrecisionType> sizes;
+        std::vector<float> factors;
+    };
+
+    void insertObject(NodeTree&, OctreeObjectIndex, OctreeDepthType) const;
+    void insertObjectsParallel(unsigned int);
+    void splitNode(NodeTree&, NodeType&, OctreeDepthType) const;
+    OctreeNodeIndex getChild(NodeTree&, NodeType&, OctreeDepthType, const PointType&) const;
+    bool isExcluded(const PointType&) const;
+    bool isRetained(const NodeType&, const ObjectType&, const PointType&, float) const;
     void buildNode(StaticOctreeType&,
                    const NodeType&,
                    OctreeDepthType,
                    std::vector<OctreeNodeIndex>&);
 
-    BlockArray<NodeType> m_nodes;
+    static unsigned int getChildIndex(const NodeType&, const PointType&);
+    static PointType getChildCenter(const NodeType&, unsigned int, PrecisionType);
+    static void extendSizes(NodeTree&, OctreeDepthType);
+
+    NodeTree m_tree;
     STORAGE m_objects;
-    std::vector<PrecisionType> m_sizes;
-    std::vector<float> m_factors;
     std::vector<OctreeObjectIndex> m_excluded;
     OctreeObjectIndex m_splitThreshold;
 };
@@ -121,43 +145,69 @@ DynamicOctree<TRAITS, STORAGE>::DynamicOctree(STORAGE&& objects,
                                               const PointType& rootCenter,
                                               PrecisionType rootSize,
                                               float rootExclusionFactor,
-                                              OctreeObjectIndex splitThreshold) :
+                                              OctreeObjectIndex splitThreshold,
+                                              unsigned int maxThreads) :
     m_objects(std::move(objects)),
     m_splitThreshold(splitThreshold)
 {
-    m_nodes.emplace_back(rootCenter);
-    m_sizes.emplace_back(rootSize);
-    m_factors.emplace_back(rootExclusionFactor);
+    m_tree.nodes.emplace_back(rootCenter);
+    m_tree.sizes.emplace_back(rootSize);
+    m_tree.factors.emplace_back(rootExclusionFactor);
+
+    if (maxThreads > 1)
+    {
+        insertObjectsParallel(maxThreads);
+        return;
+    }
 
     for (OctreeObjectIndex i = 0, end = static_cast<OctreeObjectIndex>(m_objects.size()); i < end; ++i)
     {
-        insertObject(i);
+        if (isExcluded(TRAITS::getPosition(m_objects[i])))
+            m_excluded.push_back(i);
+        else
+            insertObject(m_tree, i, 0);
     }
 }
 
+template<class TRAITS, class STORAGE>
+bool
+DynamicOctree<TRAITS, STORAGE>::isExcluded(const PointType& pos) const
+{
+    return (pos - m_tree.nodes[0].center).cwiseAbs().maxCoeff() > m_tree.sizes[0];
+}
+
+template<class TRAITS, class STORAGE>
+bool
+DynamicOctree<TRAITS, STORAGE>::isRetained(const NodeType& node,
+                                           const ObjectType& obj,
+                                           const PointType& pos,
+                                           float factor) const
+{
+    return TRAITS::getMagnitude(obj) <= factor || node.isStraddling(pos, TRAITS::getRadius(obj));
+}
+
+// Insert an object into the subtree stored in tree, whose root node is
+// located at rootDepth in the complete octree.
 template<class TRAITS, class STORAGE>
 void
-DynamicOctree<TRAITS, STORAGE>::insertObject(OctreeObjectIndex idx)
+DynamicOctree<TRAITS, STORAGE>::insertObject(NodeTree& tree,
+                                             OctreeObjectIndex idx,
+                                             OctreeDepthType rootDepth) const
 {
     const ObjectType& obj = m_objects[idx];
     PointType pos = TRAITS::getPosition(obj);
-    if ((pos - m_nodes[0].center).cwiseAbs().maxCoeff() > m_sizes[0])
-    {
-        m_excluded.push_back(idx);
-        return;
-    }
 
     OctreeNodeIndex nodeIdx = 0;
-    OctreeDepthType depth = 0;
+    OctreeDepthType depth = rootDepth;
     for (;;)
     {
-        NodeType& node = m_nodes[nodeIdx];
+        NodeType& node = tree.nodes[nodeIdx];
 
-        if (m_factors.size() <= depth)
-            m_factors.push_back(TRAITS::applyDecay(m_factors.back()));
+        while (tree.factors.size() <= depth)
+            tree.factors.push_back(TRAITS::applyDecay(tree.factors.back()));
 
         // If the object can't be placed into this node's children, then put it here:
-        if (TRAITS::getMagnitude(obj) <= m_factors[depth] || node.isStraddling(pos, TRAITS::getRadius(obj)))
+        if (isRetained(node, obj, pos, tree.factors[depth]))
         {
             node.objIndices.push_back(idx);
             return;
@@ -178,17 +228,166 @@ DynamicOctree<TRAITS, STORAGE>::insertObject(OctreeObjectIndex idx)
                 return;
             }
 
-            splitNode(node, depth);
+            splitNode(tree, node, depth);
         }
 
         ++depth;
-        nodeIdx = getChild(node, depth, pos);
+        nodeIdx = getChild(tree, node, depth, pos);
     }
 }
 
+// Partition the objects among the octants of the root node, replicating the
+// placement decisions of serial insertion at the root level, then build the
+// subtree for each octant concurrently. Objects moved into a child when the
+// root node is split are added to that child without further checks, while
+// objects arriving after the split are inserted normally, exactly as in
+// splitNode() and insertObject().
 template<class TRAITS, class STORAGE>
 void
-DynamicOctree<TRAITS, STORAGE>::splitNode(NodeType& node, OctreeDepthType depth)
+DynamicOctree<TRAITS, STORAGE>::insertObjectsParallel(unsigned int maxThreads)
+{
+    NodeType& root = m_tree.nodes[0];
+    float rootFactor = m_tree.factors[0];
+
+    std::array<std::vector<OctreeObjectIndex>, 8> queues;
+    std::array<std::size_t, 8> splitCounts{ };
+
+    for (OctreeObjectIndex i = 0, end = static_cast<OctreeObjectIndex>(m_objects.size()); i < end; ++i)
+    {
+        const ObjectType& obj = m_objects[i];
+        PointType pos = TRAITS::getPosition(obj);
+        if (isExcluded(pos))
+        {
+            m_excluded.push_back(i);
+            continue;
+        }
+
+        if (isRetained(root, obj, pos, rootFactor))
+        {
+            root.objIndices.push_back(i);
+            continue;
+        }
+
+        if (root.children == nullptr)
+        {
+            if (root.objIndices.size() < m_splitThreshold)
+            {
+                root.objIndices.push_back(i);
+                continue;
+            }
+
+            root.children = std::make_unique<typename NodeType::ChildrenType>();
+            root.children->fill(InvalidOctreeNode);
+
+            auto writeIt = root.objIndices.begin();
+            auto endIt = root.objIndices.end();
+            for (auto readIt = writeIt; readIt != endIt; ++readIt)
+            {
+                const ObjectType& rootObj = m_objects[*readIt];
+                PointType rootObjPos = TRAITS::getPosition(rootObj);
+                if (isRetained(root, rootObj, rootObjPos, rootFactor))
+                {
+                    *writeIt = *readIt;
+                    ++writeIt;
+                }
+                else
+                {
+                    queues[getChildIndex(root, rootObjPos)].push_back(*readIt);
+                }
+            }
+
+            if (writeIt == root.objIndices.begin())
+                root.objIndices = std::vector<OctreeObjectIndex>();
+            else
+                root.objIndices.erase(writeIt, endIt);
+
+            for (unsigned int child = 0; child < 8; ++child)
+                splitCounts[child] = queues[child].size();
+        }
+
+        queues[getChildIndex(root, pos)].push_back(i);
+    }
+
+    if (root.children == nullptr)
+        return;
+
+    extendSizes(m_tree, 1);
+
+    std::array<NodeTree, 8> subtrees;
+    std::vector<unsigned int> pending;
+    for (unsigned int child = 0; child < 8; ++child)
+    {
+        if (queues[child].empty())
+            continue;
+
+        NodeTree& subtree = subtrees[child];
+        subtree.nodes.emplace_back(getChildCenter(root, child, m_tree.sizes[1]));
+        subtree.sizes = m_tree.sizes;
+        subtree.factors = m_tree.factors;
+        pending.push_back(child);
+    }
+
+    auto buildSubtree = [this, &queues, &splitCounts, &subtrees](unsigned int child)
+    {
+        NodeTree& subtree = subtrees[child];
+        const auto& queue = queues[child];
+        auto& childNode = subtree.nodes[0];
+        childNode.objIndices.assign(queue.begin(), queue.begin() + splitCounts[child]);
+        for (auto it = queue.begin() + splitCounts[child]; it != queue.end(); ++it)
+            insertObject(subtree, *it, 1);
+    };
+
+    // Octants are handed out to the worker threads in order; the calling
+    // thread takes part in the work.
+    std::atomic_uint nextTask{ 0 };
+    auto worker = [&pending, &nextTask, &buildSubtree]
+    {
+        for (unsigned int task = nextTask++; task < pending.size(); task = nextTask++)
+            buildSubtree(pending[task]);
+    };
+
+    std::vector<std::thread> threads;
+    auto nThreads = static_cast<unsigned int>(std::min<std::size_t>(maxThreads, pending.size()));
+    for (unsigned int i = 1; i < nThreads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    // Merge the subtrees into the main tree, adjusting child node indices
+    for (unsigned int child : pending)
+    {
+        NodeTree& subtree = subtrees[child];
+        auto offset = static_cast<OctreeNodeIndex>(m_tree.nodes.size());
+        (*root.children)[child] = offset;
+        m_tree.nodes.reserve(m_tree.nodes.size() + subtree.nodes.size());
+        subtree.nodes.forEachBlock([this, offset](NodeType* nodes, std::size_t count)
+        {
+            for (NodeType* node = nodes; node != nodes + count; ++node)
+            {
+                if (node->children != nullptr)
+                {
+                    for (OctreeNodeIndex& childIdx : *node->children)
+                    {
+                        if (childIdx != InvalidOctreeNode)
+                            childIdx += offset;
+                    }
+                }
+
+                m_tree.nodes.emplace_back(std::move(*node));
+            }
+        });
+
+        if (subtree.sizes.size() > m_tree.sizes.size())
+            m_tree.sizes = std::move(subtree.sizes);
+        if (subtree.factors.size() > m_tree.factors.size())
+            m_tree.factors = std::move(subtree.factors);
+    }
+}
+
+template<class TRAITS, class STORAGE>
+void
+DynamicOctree<TRAITS, STORAGE>::splitNode(NodeTree& tree, NodeType& node, OctreeDepthType depth) const
 {
     assert(node.children == nullptr);
     node.children = std::make_unique<typename NodeType::ChildrenType>();
@@ -201,14 +400,14 @@ DynamicOctree<TRAITS, STORAGE>::splitNode(NodeType& node, OctreeDepthType depth)
     {
         const ObjectType& obj = m_objects[*readIt];
         PointType pos = TRAITS::getPosition(obj);
-        if (TRAITS::getMagnitude(obj) <= m_factors[depth] || node.isStraddling(pos, TRAITS::getRadius(obj)))
+        if (isRetained(node, obj, pos, tree.factors[depth]))
         {
             *writeIt = *readIt;
             ++writeIt;
         }
         else
         {
-            NodeType& childNode = m_nodes[getChild(node, depth + 1, pos)];
+            NodeType& childNode = tree.nodes[getChild(tree, node, depth + 1, pos)];
             childNode.objIndices.push_back(*readIt);
         }
     }
@@ -226,36 +425,56 @@ DynamicOctree<TRAITS, STORAGE>::splitNode(NodeType& node, OctreeDepthType depth)
 
 template<class TRAITS, class STORAGE>
 OctreeNodeIndex
-DynamicOctree<TRAITS, STORAGE>::getChild(NodeType& node, OctreeDepthType depth, const PointType& pos)
+DynamicOctree<TRAITS, STORAGE>::getChild(NodeTree& tree, NodeType& node, OctreeDepthType depth, const PointType& pos) const
 {
     assert(node.children != nullptr);
 
-    auto childIndex = static_cast<unsigned int>(pos.x() >= node.center.x()) |
-                      (static_cast<unsigned int>(pos.y() >= node.center.y()) << 1U) |
-                      (static_cast<unsigned int>(pos.z() >= node.center.z()) << 2U);
+    auto childIndex = getChildIndex(node, pos);
     OctreeNodeIndex& result = (*node.children)[childIndex];
     if (result == InvalidOctreeNode)
     {
-        result = static_cast<OctreeNodeIndex>(m_nodes.size());
-        if (m_sizes.size() <= depth)
-            m_sizes.push_back(m_sizes.back() * PrecisionType(0.5));
-        PrecisionType scale = m_sizes[depth];
-        PointType centerPos = node.center
-                            + scale * PointType(static_cast<PrecisionType>(static_cast<int>((childIndex & 1U) << 1U) - 1),
-                                                static_cast<PrecisionType>(static_cast<int>(childIndex & 2U) - 1),
-                                                static_cast<PrecisionType>(static_cast<int>((childIndex & 4U) >> 1U) - 1));
-        m_nodes.emplace_back(centerPos);
+        result = static_cast<OctreeNodeIndex>(tree.nodes.size());
+        extendSizes(tree, depth);
+        PointType centerPos = getChildCenter(node, childIndex, tree.sizes[depth]);
+        tree.nodes.emplace_back(centerPos);
     }
 
     return result;
 }
 
+template<class TRAITS, class STORAGE>
+unsigned int
+DynamicOctree<TRAITS, STORAGE>::getChildIndex(const NodeType& node, const PointType& pos)
+{
+    return static_cast<unsigned int>(pos.x() >= node.center.x()) |
+           (static_cast<unsigned int>(pos.y() >= node.center.y()) << 1U) |
+           (static_cast<unsigned int>(pos.z() >= node.center.z()) << 2U);
+}
+
+template<class TRAITS, class STORAGE>
+typename DynamicOctree<TRAITS, STORAGE>::PointType
+DynamicOctree<TRAITS, STORAGE>::getChildCenter(const NodeType& node, unsigned int childIndex, PrecisionType scale)
+{
+    return node.center
+         + scale * PointType(static_cast<PrecisionType>(static_cast<int>((childIndex & 1U) << 1U) - 1),
+                             static_cast<PrecisionType>(static_cast<int>(childIndex & 2U) - 1),
+                             static_cast<PrecisionType>(static_cast<int>((childIndex & 4U) >> 1U) - 1));
+}
+
+template<class TRAITS, class STORAGE>
+void
+DynamicOctree<TRAITS, STORAGE>::extendSizes(NodeTree& tree, OctreeDepthType depth)
+{
+    while (tree.sizes.size() <= depth)
+        tree.sizes.push_back(tree.sizes.back() * PrecisionType(0.5));
+}
+
 template<class TRAITS, class STORAGE>
 std::unique_ptr<typename DynamicOctree<TRAITS, STORAGE>::StaticOctreeType>
 DynamicOctree<TRAITS, STORAGE>::build()
 {
     auto staticOctree = std::make_unique<StaticOctreeType>();
-    staticOctree->m_nodes.reserve(m_nodes.size());
+    staticOctree->m_nodes.reserve(m_tree.nodes.size());
     staticOctree->m_objects.reserve(m_objects.size());
 
     std::vector<std::pair<OctreeNodeIndex, OctreeDepthType>> nodeStack;
@@ -264,7 +483,7 @@ DynamicOctree<TRAITS, STORAGE>::build()
     while (!nodeStack.empty())
     {
         auto [nodeIdx, depth] = nodeStack.back();
-        const NodeType& node = m_nodes[nodeIdx];
+        const NodeType& node = m_tree.nodes[nodeIdx];
         buildNode(*staticOctree, node, depth, prevByDepth);
         nodeStack.pop_back();
 
@@ -302,7 +521,7 @@ DynamicOctree<TRAITS, STORAGE>::buildNode(StaticOctreeType& staticOctree,
 
     prevByDepth.push_back(staticNodeIdx);
 
-    auto& staticNode = staticOctree.m_nodes.emplace_back(node.center, m_sizes[depth]);
+    auto& staticNode = staticOctree.m_nodes.emplace_back(node.center, m_tree.sizes[depth]);
 
     if (node.objIndices.empty())
         return;
@@ -336,14 +555,16 @@ makeDynamicOctree(STORAGE&& objects,
                   const Eigen::Matrix<typename TRAITS::PrecisionType, 3, 1>& rootCenter,
                   typename TRAITS::PrecisionType rootSize,
                   float rootExclusionFactor,
-                  OctreeObjectIndex splitThreshold)
+                  OctreeObjectIndex splitThreshold,
+                  unsigned int maxThreads = 1)
 {
     static_assert(!std::is_reference_v<STORAGE>, "makeDynamicOctree must be called with rvalue for objects parameter");
     return std::make_unique<DynamicOctree<TRAITS, STORAGE>>(std::forward<STORAGE>(objects),
                                                             rootCenter,
                                                             rootSize,
                                                             rootExclusionFactor,
-                                                            splitThreshold);
+                                                            splitThreshold,
+                                                            maxThreads);
 }
 
 } // end namespace celestia::engine
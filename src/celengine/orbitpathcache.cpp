@@ -0,0 +1,148 @@
+// orbitpathcache.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Cache of orbit path samples which follows the display window.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "orbitpathcache.h"
+
+#include <algorithm>
+
+#include <celephem/orbit.h>
+#include "curveplot.h"
+#include "orbitsampler.h"
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Size at which the cache will be flushed of old orbit paths
+constexpr std::size_t CullThreshold = 200;
+// Age in frames at which unused orbit paths may be eliminated from the cache
+constexpr std::uint32_t RetireAge = 16;
+// Extra size of the sampled window on both sides, relative to its length
+constexpr double WindowSlack = 0.2;
+
+void
+sampleForward(const ephem::Orbit& orbit, double startTime, double endTime, CurvePlot& plot)
+{
+    OrbitSampler sampler;
+    orbit.sample(startTime, endTime, sampler);
+    sampler.insertForward(&plot);
+}
+
+void
+sampleBackward(const ephem::Orbit& orbit, double startTime, double endTime, CurvePlot& plot)
+{
+    OrbitSampler sampler;
+    orbit.sample(startTime, endTime, sampler);
+    sampler.insertBackward(&plot);
+}
+
+} // end unnamed namespace
+
+OrbitPathCache::OrbitPathCache(const Renderer& renderer) :
+    m_renderer(renderer)
+{
+}
+
+OrbitPathCache::~OrbitPathCache() = default;
+
+CurvePlot*
+OrbitPathCache::get(const ephem::Orbit* orbit, double startTime, double endTime, std::uint32_t frame)
+{
+    auto it = m_plots.find(orbit);
+    if (it == m_plots.end())
+    {
+        retire(frame);
+        it = m_plots.try_emplace(orbit, std::make_unique<CurvePlot>(m_renderer)).first;
+    }
+
+    CurvePlot& plot = *it->second;
+    plot.setLastUsed(frame);
+
+    double slack = (endTime - startTime) * WindowSlack;
+    double newStart = startTime - slack;
+    double newEnd = endTime + slack;
+
+    // Don't sample beyond the valid range of trajectories
+    double validStart = 0.0;
+    double validEnd = 0.0;
+    orbit->getValidRange(validStart, validEnd);
+    if (validStart != validEnd)
+    {
+        startTime = std::max(startTime, validStart);
+        endTime = std::min(endTime, validEnd);
+        newStart = std::max(newStart, validStart);
+        newEnd = std::min(newEnd, validEnd);
+    }
+
+    if (plot.empty() || plot.startTime() > newEnd || plot.endTime() < newStart)
+    {
+        // No samples in the new window to keep
+        it->second = std::make_unique<CurvePlot>(m_renderer);
+        it->second->setLastUsed(frame);
+        sampleForward(*orbit, newStart, newEnd, *it->second);
+        return it->second.get();
+    }
+
+    if (startTime < plot.startTime())
+    {
+        double currentStart = plot.startTime();
+
+        // Remove samples at the end of the time window
+        plot.removeSamplesAfter(newEnd);
+
+        // Trim the first sample (because it will be duplicated when we sample the orbit.)
+        plot.removeSamplesBefore(currentStart * (1.0 + 1.0e-15));
+
+        sampleBackward(*orbit, newStart, std::min(currentStart, newEnd), plot);
+    }
+    else if (endTime > plot.endTime())
+    {
+        double currentEnd = plot.endTime();
+
+        // Remove samples at the beginning of the time window
+        plot.removeSamplesBefore(newStart);
+
+        // Trim the last sample (because it will be duplicated when we sample the orbit.)
+        plot.removeSamplesAfter(currentEnd * (1.0 - 1.0e-15));
+
+        sampleForward(*orbit, std::max(currentEnd, newStart), newEnd, plot);
+    }
+
+    return &plot;
+}
+
+void
+OrbitPathCache::clear()
+{
+    m_plots.clear();
+}
+
+void
+OrbitPathCache::retire(std::uint32_t frame)
+{
+    // Check for old orbits at most once per frame
+    if (m_plots.size() <= CullThreshold || m_lastRetired == frame)
+        return;
+
+    for (auto it = m_plots.begin(); it != m_plots.end();)
+    {
+        if (frame - it->second->lastUsed() > RetireAge)
+            it = m_plots.erase(it);
+        else
+            ++it;
+    }
+
+    m_lastRetired = frame;
+}
+
+} // end namespace celestia::engine
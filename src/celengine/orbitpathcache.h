@@ -0,0 +1,63 @@
+// orbitpathcache.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Cache of orbit path samples which follows the display window.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+class CurvePlot;
+class Renderer;
+
+namespace celestia
+{
+namespace ephem
+{
+class Orbit;
+}
+
+namespace engine
+{
+
+// Samples of the orbits drawn recently, kept across frames and shared by
+// all of the views drawn by a renderer. When the display window of an
+// orbit slides, samples are added at its leading edge and dropped behind
+// its trailing edge instead of sampling the whole window again. New
+// samples are taken with the adaptive sampling parameters of the whole
+// orbit, so that the extended parts are as dense as the rest.
+class OrbitPathCache
+{
+public:
+    explicit OrbitPathCache(const Renderer& renderer);
+    ~OrbitPathCache();
+
+    OrbitPathCache(const OrbitPathCache&) = delete;
+    OrbitPathCache& operator=(const OrbitPathCache&) = delete;
+
+    // Return the samples of orbit, extended to cover [startTime, endTime]
+    // or the part of it where the orbit is valid, with some slack on both
+    // sides. frame is the number of the frame being drawn; orbits unused
+    // for a few frames may be dropped once the cache grows large.
+    CurvePlot* get(const ephem::Orbit* orbit, double startTime, double endTime, std::uint32_t frame);
+
+    void clear();
+
+private:
+    void retire(std::uint32_t frame);
+
+    const Renderer& m_renderer;
+    std::unordered_map<const ephem::Orbit*, std::unique_ptr<CurvePlot>> m_plots;
+    std::uint32_t m_lastRetired{ 0 };
+};
+
+} // end namespace engine
+} // end namespace celestia
@@ -9,6 +9,8 @@
 // of the License, or (at your option) any later version.
 
 #include <cstring>
+#include <string_view>
+#include <tuple>
 #include <Eigen/Core>
 #include <celmath/geomutil.h>
 #include <celutil/color.h>
@@ -22,17 +24,42 @@ using namespace Eigen;
 using namespace celestia::engine;
 namespace math = celestia::math;
 
+bool Overlay::TextOp::operator==(const TextOp& other) const
+{
+    return type == other.type &&
+           first == other.first &&
+           count == other.count &&
+           color == other.color &&
+           dx == other.dx &&
+           dy == other.dy;
+}
+
+void Overlay::TextBlockKey::clear()
+{
+    fonts.clear();
+    ops.clear();
+    text.clear();
+}
+
+bool Overlay::TextBlockKey::operator==(const TextBlockKey& other) const
+{
+    return x == other.x &&
+           y == other.y &&
+           color == other.color &&
+           halign == other.halign &&
+           screenDpi == other.screenDpi &&
+           fonts == other.fonts &&
+           ops == other.ops &&
+           text == other.text;
+}
+
 Overlay::Overlay(Renderer& r) :
-    layout(make_unique<TextLayout>(r.getScreenDpi())),
     renderer(r)
 {
 }
 
 void Overlay::begin()
 {
-    layout->setLayoutDirectionFollowTextAlignment(true);
-    layout->setScreenDpi(renderer.getScreenDpi());
-
     projection = math::Ortho2D(0.0f, (float)windowWidth, 0.0f, (float)windowHeight);
     // ModelView is Identity
 
@@ -41,10 +68,14 @@ void Overlay::begin()
     ps.blendFunc = {GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA};
     ps.depthMask = true;
     renderer.setPipelineState(ps);
+
+    blockCount = 0;
 }
 
 void Overlay::end()
 {
+    // Forget the blocks which weren't drawn in this frame
+    blocks.erase(blocks.begin() + blockCount, blocks.end());
 }
 
 
@@ -56,29 +87,60 @@ void Overlay::setWindowSize(int w, int h)
 
 void Overlay::setFont(const std::shared_ptr<TextureFont>& f)
 {
-    layout->setFont(f);
+    font = f;
+    if (inText)
+    {
+        recording.fonts.push_back(f);
+        record({ TextOp::Type::Font, recording.fonts.size() - 1 });
+    }
 }
 
 void Overlay::setTextAlignment(TextLayout::HorizontalAlignment halign)
 {
-    layout->setHorizontalAlignment(halign);
+    horizontalAlignment = halign;
+    if (inText)
+        record({ TextOp::Type::Alignment, static_cast<std::size_t>(halign) });
 }
 
 void Overlay::beginText()
 {
-    savePos();
-    layout->begin(projection);
+    recording.clear();
+    recording.x = positionX;
+    recording.y = positionY;
+    recording.color = color;
+    recording.halign = horizontalAlignment;
+    recording.screenDpi = renderer.getScreenDpi();
+    recording.fonts.push_back(font);
+    inText = true;
 }
 
 void Overlay::endText()
 {
-    layout->end();
-    restorePos();
+    if (!inText)
+        return;
+    inText = false;
+
+    if (blockCount == blocks.size())
+        blocks.emplace_back();
+
+    TextBlock& block = blocks[blockCount++];
+    if (!(block.key == recording) || !block.text.isCurrent())
+    {
+        std::swap(block.key, recording);
+        layoutText(block);
+    }
+
+    block.text.draw(projection);
 }
 
 void Overlay::print(std::string_view s)
 {
-    layout->render(s);
+    if (!inText || s.empty())
+        return;
+
+    TextOp op{ TextOp::Type::Print, recording.text.size(), s.size() };
+    recording.text.append(s);
+    record(std::move(op));
 }
 
 void Overlay::drawRectangle(const celestia::Rect& r) const
@@ -88,45 +150,127 @@ void Overlay::drawRectangle(const celestia::Rect& r) const
 
 void Overlay::setColor(float r, float g, float b, float a)
 {
-    layout->flush();
-    glVertexAttrib4f(CelestiaGLProgram::ColorAttributeIndex, r, g, b, a);
+    setColor(Color(r, g, b, a));
 }
 
 void Overlay::setColor(const Color& c)
 {
-    layout->flush();
-    glVertexAttrib4f(CelestiaGLProgram::ColorAttributeIndex,
-                     c.red(), c.green(), c.blue(), c.alpha());
+    color = c;
+    if (inText)
+    {
+        TextOp op{ TextOp::Type::Color };
+        op.color = c;
+        record(std::move(op));
+    }
 }
 
 void Overlay::setColor(const Color& c, float a)
 {
-    layout->flush();
-    glVertexAttrib4f(CelestiaGLProgram::ColorAttributeIndex,
-                     c.red(), c.green(), c.blue(), a);
+    setColor(Color(c, a));
 }
 
 void Overlay::moveBy(float dx, float dy)
 {
-    layout->moveRelative(dx, dy);
+    if (inText)
+    {
+        TextOp op{ TextOp::Type::Move };
+        op.dx = dx;
+        op.dy = dy;
+        record(std::move(op));
+    }
+    else
+    {
+        positionX += dx;
+        positionY += dy;
+    }
 }
 
 void Overlay::moveBy(int dx, int dy)
 {
-    layout->moveRelative(static_cast<float>(dx), static_cast<float>(dy));
+    moveBy(static_cast<float>(dx), static_cast<float>(dy));
 }
 
 void Overlay::savePos()
 {
-    posStack.push_back(layout->getCurrentPosition());
+    if (inText)
+        record({ TextOp::Type::SavePos });
+    else
+        posStack.emplace_back(positionX, positionY);
 }
 
 void Overlay::restorePos()
 {
-    if (!posStack.empty())
+    if (inText)
+    {
+        record({ TextOp::Type::RestorePos });
+    }
+    else if (!posStack.empty())
     {
-        auto [x, y] = posStack.back();
-        layout->moveAbsolute(x, y);
+        std::tie(positionX, positionY) = posStack.back();
         posStack.pop_back();
     }
 }
+
+void Overlay::record(TextOp&& op)
+{
+    recording.ops.push_back(std::move(op));
+}
+
+void Overlay::layoutText(TextBlock& block) const
+{
+    const TextBlockKey& key = block.key;
+    std::string_view text = key.text;
+    std::vector<std::pair<float, float>> stack;
+
+    // Loading a glyph which wasn't used before rebuilds the atlas, which
+    // moves the glyphs laid out earlier
+    do
+    {
+        block.text.clear();
+        block.text.setColor(key.color);
+
+        TextLayout layout(key.screenDpi, key.halign);
+        layout.setLayoutDirectionFollowTextAlignment(true);
+        layout.setFont(key.fonts.front());
+        layout.moveAbsolute(key.x, key.y);
+        layout.begin(block.text);
+
+        stack.clear();
+        for (const TextOp& op : key.ops)
+        {
+            switch (op.type)
+            {
+            case TextOp::Type::Print:
+                layout.render(text.substr(op.first, op.count));
+                break;
+            case TextOp::Type::Move:
+                layout.moveRelative(op.dx, op.dy);
+                break;
+            case TextOp::Type::Color:
+                layout.flush();
+                block.text.setColor(op.color);
+                break;
+            case TextOp::Type::Font:
+                layout.setFont(key.fonts[op.first]);
+                break;
+            case TextOp::Type::Alignment:
+                layout.setHorizontalAlignment(static_cast<TextLayout::HorizontalAlignment>(op.first));
+                break;
+            case TextOp::Type::SavePos:
+                stack.push_back(layout.getCurrentPosition());
+                break;
+            case TextOp::Type::RestorePos:
+                if (!stack.empty())
+                {
+                    layout.moveAbsolute(stack.back().first, stack.back().second);
+                    stack.pop_back();
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        layout.end();
+    } while (!block.text.isCurrent());
+}
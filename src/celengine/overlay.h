@@ -10,14 +10,18 @@
 
 #pragma once
 
+#include <cstddef>
 #include <locale>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <fmt/printf.h>
 #include <Eigen/Core>
+#include <celengine/retainedtext.h>
 #include <celengine/textlayout.h>
+#include <celutil/color.h>
 
-class Color;
 class Overlay;
 class Renderer;
 
@@ -26,6 +30,10 @@ namespace celestia
 class Rect;
 }
 
+// Text printed between beginText() and endText() is laid out into a vertex
+// buffer which is kept for the next frame. Each text block is compared with
+// the block drawn in the same order in the previous frame and is only laid
+// out again when something it is made of has changed.
 class Overlay
 {
  public:
@@ -83,13 +91,73 @@ class Overlay
     }
 
  private:
+    // A call made between beginText() and endText()
+    struct TextOp
+    {
+        enum class Type
+        {
+            Print,
+            Move,
+            Color,
+            Font,
+            Alignment,
+            SavePos,
+            RestorePos,
+        };
+
+        Type type;
+        // Range of the printed text, or the index of the font or alignment
+        std::size_t first{ 0 };
+        std::size_t count{ 0 };
+        Color color{};
+        float dx{ 0.0f };
+        float dy{ 0.0f };
+
+        bool operator==(const TextOp&) const;
+    };
+
+    // Everything the layout of a text block depends on
+    struct TextBlockKey
+    {
+        float x{ 0.0f };
+        float y{ 0.0f };
+        Color color{};
+        celestia::engine::TextLayout::HorizontalAlignment halign{ celestia::engine::TextLayout::HorizontalAlignment::Left };
+        int screenDpi{ 96 };
+        // The font at the start of the block, followed by those it sets
+        std::vector<std::shared_ptr<TextureFont>> fonts;
+        std::vector<TextOp> ops;
+        std::string text;
+
+        void clear();
+        bool operator==(const TextBlockKey&) const;
+    };
+
+    struct TextBlock
+    {
+        TextBlockKey key;
+        celestia::engine::RetainedText text;
+    };
+
+    void record(TextOp&&);
+    void layoutText(TextBlock&) const;
+
     int windowWidth{ 1 };
     int windowHeight{ 1 };
 
-    std::unique_ptr<celestia::engine::TextLayout> layout{ nullptr };
-
     Renderer& renderer;
 
+    std::shared_ptr<TextureFont> font;
+    celestia::engine::TextLayout::HorizontalAlignment horizontalAlignment{ celestia::engine::TextLayout::HorizontalAlignment::Left };
+    Color color{ 1.0f, 1.0f, 1.0f, 1.0f };
+    float positionX{ 0.0f };
+    float positionY{ 0.0f };
+
+    bool inText{ false };
+    TextBlockKey recording;
+    std::vector<TextBlock> blocks;
+    std::size_t blockCount{ 0 };
+
     std::vector<std::pair<float, float>> posStack;
     Eigen::Matrix4f projection;
 };
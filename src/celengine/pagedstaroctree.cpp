@@ -0,0 +1,318 @@
+// pagedstaroctree.cpp
+//
+// Copyright (C) 2001-2024, the Celestia Development Team
+//
+// Star octree read on demand from a version 2 stars.dat.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "pagedstaroctree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <celastro/astro.h>
+#include <celutil/binaryread.h>
+#include <celutil/gettext.h>
+#include <celutil/logger.h>
+#include <celutil/mappedfile.h>
+#include "star.h"
+#include "starcolors.h"
+#include "starsdat.h"
+#include "stellarclass.h"
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Stars with an unknown spectral type are kept in their blocks, so that the
+// object ranges of the nodes stay valid, but are never drawn.
+constexpr float HiddenStarMagnitude = 1000.0f;
+constexpr std::int16_t HiddenStarQuantizedMagnitude = std::numeric_limits<std::int16_t>::max();
+
+// Largest quantized coordinate, which maps to the edge of the node
+constexpr float QuantizedScale = 32767.0f;
+// Blocks are only quantized when the step between positions is at most
+// this, in light years, so that the quantization of the nodes near the
+// root, which hold the brightest stars, doesn't move them visibly
+constexpr float MaxQuantizationStep = 1.0e-3f;
+
+class PagedNodeFilter : public StarOctreeVisibleNodeFilter
+{
+public:
+    PagedNodeFilter(const StarOctree::PointType& obsPosition,
+                    util::array_view<PlaneType> frustumPlanes,
+                    float limitingFactor) :
+        StarOctreeVisibleNodeFilter(obsPosition, frustumPlanes, limitingFactor)
+    {
+    }
+
+    const StarOctree::PointType& obsPosition() const { return m_obsPosition; }
+    float limitingFactor() const { return m_limitingFactor; }
+    float dimmest() const { return m_dimmest; }
+};
+
+} // end unnamed namespace
+
+PagedStarOctree::PagedStarOctree(std::unique_ptr<util::MappedFile>&& file,
+                                 const char* records,
+                                 OctreeObjectIndex nStars,
+                                 OctreeNodeIndex nNodes,
+                                 std::size_t cacheSize,
+                                 bool quantize) :
+    m_file(std::move(file)),
+    m_records(records),
+    m_nStars(nStars),
+    m_nodes(records + static_cast<std::size_t>(nStars) * sizeof(StarsDatRecord)),
+    m_nNodes(nNodes),
+    m_cacheSize(cacheSize),
+    m_quantize(quantize)
+{
+}
+
+PagedStarOctree::~PagedStarOctree() = default;
+
+/*! Open a version 2 stars.dat for paged rendering. Only the file header is
+ *  read here; the nodes are validated as they are traversed. Returns nullptr if the file cannot be
+ *  mapped or is not a valid version 2 star database.
+ */
+std::unique_ptr<PagedStarOctree>
+PagedStarOctree::open(const fs::path& path, std::size_t cacheSize, bool quantize)
+{
+    auto file = util::MappedFile::open(path);
+    if (file == nullptr)
+    {
+        util::GetLogger()->error(_("Error mapping paged star database {}\n"), path);
+        return nullptr;
+    }
+
+    const char* data = file->data();
+    std::size_t size = file->size();
+
+    std::uint16_t version;
+    std::uint32_t nStars;
+    if (size < sizeof(StarsDatHeaderV2)
+        || !parseStarsDatHeader(data, version, nStars)
+        || version != StarDBVersion2)
+    {
+        util::GetLogger()->error(_("Paged star database {} is not a version 2 star database\n"), path);
+        return nullptr;
+    }
+
+    auto nNodes = util::fromMemoryLE<std::uint32_t>(data + offsetof(StarsDatHeaderV2, nodeCount));
+    const char* records = data + sizeof(StarsDatHeaderV2);
+    if (size - sizeof(StarsDatHeaderV2) < static_cast<std::size_t>(nStars) * sizeof(StarsDatRecord)
+                                          + static_cast<std::size_t>(nNodes) * sizeof(StarsDatNode))
+    {
+        util::GetLogger()->error(_("Paged star database {} is truncated\n"), path);
+        return nullptr;
+    }
+
+    return std::unique_ptr<PagedStarOctree>(new PagedStarOctree(std::move(file),
+                                                                records,
+                                                                nStars,
+                                                                nNodes,
+                                                                cacheSize,
+                                                                quantize));
+}
+
+/*! Traverse the octree with the same node test as the resident star
+ *  octree, decoding the blocks of the accepted nodes as needed. The handler
+ *  is invoked for every star brighter than limitingMag.
+ */
+void
+PagedStarOctree::findVisibleStars(PagedStarHandler& starHandler,
+                                  const Eigen::Vector3f& obsPosition,
+                                  const Eigen::Quaternionf& obsOrientation,
+                                  float fovY,
+                                  float aspectRatio,
+                                  float limitingMag)
+{
+    auto frustumPlanes = computeFrustumPlanes(obsPosition, obsOrientation, fovY, aspectRatio);
+    PagedNodeFilter filter(obsPosition, frustumPlanes, limitingMag);
+
+    detail::StaticOctreeNode<float> node(Eigen::Vector3f::Zero(), 0.0f);
+    OctreeNodeIndex nodeIdx = 0;
+    OctreeNodeIndex endIdx = m_invalid ? 0 : nodeCount();
+    while (nodeIdx < endIdx)
+    {
+        if (!readStarsDatNode(m_nodes, nodeIdx, m_nStars, node))
+        {
+            util::GetLogger()->error(_("Bad octree node in paged star database, node #{}\n"), nodeIdx);
+            m_invalid = true;
+            return;
+        }
+
+        if (!filter.checkNode(node.center, node.scale, node.brightFactor))
+        {
+            nodeIdx = node.right;
+            continue;
+        }
+
+        if (node.first < node.last)
+        {
+            const Block& block = getBlock(nodeIdx, node);
+            for (const StarRenderRecord& record : block.records)
+            {
+                if (record.absMag > filter.dimmest())
+                    continue;
+
+                float distance = (filter.obsPosition() - record.position).norm();
+                float appMag   = astro::absToAppMag(record.absMag, distance);
+                if (appMag <= filter.limitingFactor())
+                    starHandler.process(record, distance, appMag);
+            }
+
+            // The magnitude is tested before the position is decoded
+            auto dimmest = static_cast<std::int16_t>(std::clamp(std::floor(filter.dimmest() * 256.0f), -32768.0f, 32766.0f));
+            for (const QuantizedStar& star : block.quantized)
+            {
+                if (star.absMag > dimmest)
+                    continue;
+
+                StarRenderRecord record
+                {
+                    block.center + Eigen::Vector3f(static_cast<float>(star.position[0]),
+                                                   static_cast<float>(star.position[1]),
+                                                   static_cast<float>(star.position[2])) * block.step,
+                    static_cast<float>(star.absMag) / 256.0f,
+                    star.colorIndex,
+                    0,
+                };
+
+                float distance = (filter.obsPosition() - record.position).norm();
+                float appMag   = astro::absToAppMag(record.absMag, distance);
+                if (appMag <= filter.limitingFactor())
+                    starHandler.process(record, distance, appMag);
+            }
+        }
+
+        ++nodeIdx;
+    }
+}
+
+const PagedStarOctree::Block&
+PagedStarOctree::getBlock(OctreeNodeIndex nodeIdx, const detail::StaticOctreeNode<float>& node)
+{
+    if (auto it = m_blockIndex.find(nodeIdx); it != m_blockIndex.end())
+    {
+        m_blocks.splice(m_blocks.begin(), m_blocks, it->second);
+        return it->second->second;
+    }
+
+    Block block;
+    if (!m_quantize || !quantizeBlock(node, block))
+        decodeBlock(node, block);
+    std::size_t blockBytes = block.bytes();
+
+    // Evict the least recently used blocks, but never the one being added;
+    // a single block larger than the budget is still decoded.
+    while (!m_blocks.empty() && m_cachedBytes + blockBytes > m_cacheSize)
+    {
+        const auto& [evictedIdx, evicted] = m_blocks.back();
+        m_cachedBytes -= evicted.bytes();
+        m_blockIndex.erase(evictedIdx);
+        m_blocks.pop_back();
+    }
+
+    m_blocks.emplace_front(nodeIdx, std::move(block));
+    m_blockIndex.try_emplace(nodeIdx, m_blocks.begin());
+    m_cachedBytes += blockBytes;
+
+    return m_blocks.front().second;
+}
+
+void
+PagedStarOctree::decodeBlock(const detail::StaticOctreeNode<float>& node, Block& block)
+{
+    auto& records = block.records;
+    records.reserve(node.last - node.first);
+    const char* ptr = m_records + static_cast<std::size_t>(node.first) * sizeof(StarsDatRecord);
+    for (OctreeObjectIndex i = node.first; i < node.last; ++i, ptr += sizeof(StarsDatRecord))
+    {
+        auto absMag = util::fromMemoryLE<std::int16_t>(ptr + offsetof(StarsDatRecord, absMag));
+        auto temperature = getTemperature(util::fromMemoryLE<std::uint16_t>(ptr + offsetof(StarsDatRecord, spectralType)));
+        records.push_back(StarRenderRecord
+        {
+            Eigen::Vector3f(util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, x)),
+                            util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, y)),
+                            util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, z))),
+            temperature == 0 ? HiddenStarMagnitude : static_cast<float>(absMag) / 256.0f,
+            ColorTemperatureTable::colorIndex(static_cast<float>(temperature)),
+            0,
+        });
+    }
+}
+
+// Quantize the stars of the node if they all lie inside it, which isn't the
+// case for the stars outside the root node, and the node is small enough.
+// Returns false if the block must be decoded instead.
+bool
+PagedStarOctree::quantizeBlock(const detail::StaticOctreeNode<float>& node, Block& block)
+{
+    float step = node.scale / QuantizedScale;
+    if (!(step <= MaxQuantizationStep))
+        return false;
+
+    block.center = node.center;
+    block.step = step;
+    auto& quantized = block.quantized;
+    quantized.reserve(node.last - node.first);
+    const char* ptr = m_records + static_cast<std::size_t>(node.first) * sizeof(StarsDatRecord);
+    for (OctreeObjectIndex i = node.first; i < node.last; ++i, ptr += sizeof(StarsDatRecord))
+    {
+        Eigen::Vector3f offset = (Eigen::Vector3f(util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, x)),
+                                                  util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, y)),
+                                                  util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, z))) -
+                                  node.center) / step;
+        if (!(offset.cwiseAbs().maxCoeff() <= QuantizedScale))
+        {
+            quantized.clear();
+            return false;
+        }
+
+        auto absMag = util::fromMemoryLE<std::int16_t>(ptr + offsetof(StarsDatRecord, absMag));
+        auto temperature = getTemperature(util::fromMemoryLE<std::uint16_t>(ptr + offsetof(StarsDatRecord, spectralType)));
+        quantized.push_back(QuantizedStar
+        {
+            {
+                static_cast<std::int16_t>(std::lround(offset.x())),
+                static_cast<std::int16_t>(std::lround(offset.y())),
+                static_cast<std::int16_t>(std::lround(offset.z())),
+            },
+            temperature == 0 ? HiddenStarQuantizedMagnitude : absMag,
+            ColorTemperatureTable::colorIndex(static_cast<float>(temperature)),
+        });
+    }
+
+    return true;
+}
+
+// Returns zero for an unknown spectral type
+std::uint16_t
+PagedStarOctree::getTemperature(std::uint16_t spectralType)
+{
+    if (auto it = m_temperatures.find(spectralType); it != m_temperatures.end())
+        return it->second;
+
+    std::uint16_t temperature = 0;
+    if (StellarClass sc; sc.unpackV2(spectralType))
+    {
+        if (auto details = StarDetails::GetStarDetails(sc); details != nullptr)
+            temperature = static_cast<std::uint16_t>(std::clamp(std::round(details->getTemperature()), 1.0f, 65535.0f));
+    }
+
+    if (temperature == 0)
+        util::GetLogger()->error(_("Bad spectral type {:04x} in paged star database\n"), spectralType);
+
+    m_temperatures.try_emplace(spectralType, temperature);
+    return temperature;
+}
+
+} // end namespace celestia::engine
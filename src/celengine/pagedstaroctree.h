@@ -0,0 +1,141 @@
+// pagedstaroctree.h
+//
+// Copyright (C) 2001-2024, the Celestia Development Team
+//
+// Star octree read on demand from a version 2 stars.dat.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celcompat/filesystem.h>
+#include <celengine/octree.h>
+#include <celengine/staroctree.h>
+
+namespace celestia::util
+{
+class MappedFile;
+}
+
+namespace celestia::engine
+{
+
+class PagedStarHandler
+{
+public:
+    virtual ~PagedStarHandler() = default;
+    virtual void process(const StarRenderRecord&, float distance, float appMag) = 0;
+
+protected:
+    PagedStarHandler() = default;
+};
+
+// A render-only star catalog which is too large to be loaded as Star
+// objects. The file is mapped into memory read-only and the octree nodes are
+// read in place while traversing, so opening it doesn't read the file, and
+// the processes rendering the same catalog share the pages of the mapping.
+// The stars of a node are decoded into render records the first time the
+// node passes the visibility test, and the least recently used blocks are
+// discarded when the cache exceeds its budget. The stars cannot be selected
+// and carry no names, orbits or extinction.
+//
+// With quantization enabled, the blocks of the nodes small enough store the
+// positions as 16-bit offsets from the node center, with the magnitude and
+// color index in 16 bits each, half the size of the render records, so that
+// twice as many stars fit in the cache. They are decoded while traversing.
+class PagedStarOctree
+{
+public:
+    ~PagedStarOctree();
+
+    PagedStarOctree(const PagedStarOctree&) = delete;
+    PagedStarOctree& operator=(const PagedStarOctree&) = delete;
+
+    static std::unique_ptr<PagedStarOctree> open(const fs::path&,
+                                                 std::size_t cacheSize,
+                                                 bool quantize = false);
+
+    void findVisibleStars(PagedStarHandler&,
+                          const Eigen::Vector3f& obsPosition,
+                          const Eigen::Quaternionf& obsOrientation,
+                          float fovY,
+                          float aspectRatio,
+                          float limitingMag);
+
+    OctreeObjectIndex size() const { return m_nStars; }
+    OctreeNodeIndex nodeCount() const { return m_nNodes; }
+    std::size_t cachedBytes() const { return m_cachedBytes; }
+
+private:
+    struct QuantizedStar
+    {
+        // Offset from the node center in units of Block::step
+        std::array<std::int16_t, 3> position;
+        // Absolute magnitude in 1/256 magnitudes, as in the file
+        std::int16_t absMag;
+        std::uint16_t colorIndex;
+    };
+
+    // Either records or quantized holds the stars of a node
+    struct Block
+    {
+        std::vector<StarRenderRecord> records;
+        std::vector<QuantizedStar> quantized;
+        Eigen::Vector3f center;
+        float step;
+
+        std::size_t bytes() const
+        {
+            return records.size() * sizeof(StarRenderRecord) + quantized.size() * sizeof(QuantizedStar);
+        }
+    };
+
+    using BlockList = std::list<std::pair<OctreeNodeIndex, Block>>;
+
+    PagedStarOctree(std::unique_ptr<util::MappedFile>&&,
+                    const char*,
+                    OctreeObjectIndex,
+                    OctreeNodeIndex,
+                    std::size_t,
+                    bool);
+
+    const Block& getBlock(OctreeNodeIndex, const detail::StaticOctreeNode<float>&);
+    void decodeBlock(const detail::StaticOctreeNode<float>&, Block&);
+    bool quantizeBlock(const detail::StaticOctreeNode<float>&, Block&);
+    std::uint16_t getTemperature(std::uint16_t);
+
+    std::unique_ptr<util::MappedFile> m_file;
+    const char* m_records;
+    OctreeObjectIndex m_nStars;
+    // Nodes in the file format, following the records
+    const char* m_nodes;
+    OctreeNodeIndex m_nNodes;
+    // Set when an invalid node is found, after which nothing is drawn
+    bool m_invalid{ false };
+
+    std::size_t m_cacheSize;
+    bool m_quantize;
+    std::size_t m_cachedBytes{ 0 };
+    // Decoded blocks, most recently used first
+    BlockList m_blocks;
+    std::unordered_map<OctreeNodeIndex, BlockList::iterator> m_blockIndex;
+    // Temperatures indexed by packed spectral type
+    std::unordered_map<std::uint16_t, std::uint16_t> m_temperatures;
+};
+
+} // end namespace celestia::engine
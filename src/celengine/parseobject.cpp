@@ -28,6 +28,7 @@
 #include <celephem/orbit.h>
 #include <celephem/rotation.h>
 #include <celephem/samporbit.h>
+#include <celephem/streamingorbit.h>
 #include <celmath/geomutil.h>
 #include <celmath/mathlib.h>
 #include <celutil/fsutils.h>
@@ -287,6 +288,57 @@ CreateSampledTrajectory(const Hash* trajData, const fs::path& path)
     return orbit;
 }
 
+/*!
+ * Create a trajectory which follows a file as samples are appended to it:
+ *
+ * \code StreamingTrajectory
+ * {
+ *     Source <string>
+ *     Retention <number>
+ *     MaxSamples <number>
+ * } \endcode
+ *
+ * Source is the only required field; it is resolved like the source of a
+ * SampledTrajectory. Retention is the time span in days of the samples
+ * used, 1 day by default, and MaxSamples the number of samples kept in
+ * memory, 65536 by default.
+ */
+std::shared_ptr<const ephem::Orbit>
+CreateStreamingTrajectory(const Hash* trajData, const fs::path& path)
+{
+    const std::string* source = trajData->getString("Source");
+    if (source == nullptr)
+    {
+        GetLogger()->error("StreamingTrajectory is missing a source.\n");
+        return nullptr;
+    }
+
+    auto sourceFile = util::U8FileName(*source);
+    if (!sourceFile.has_value())
+    {
+        GetLogger()->error("Invalid Source filename for StreamingTrajectory\n");
+        return nullptr;
+    }
+
+    auto retention = trajData->getNumber<double>("Retention").value_or(1.0);
+    auto maxSamples = trajData->getNumber<double>("MaxSamples").value_or(65536.0);
+    if (!(retention > 0.0) || !(maxSamples >= 2.0))
+    {
+        GetLogger()->error("Invalid Retention or MaxSamples for StreamingTrajectory\n");
+        return nullptr;
+    }
+
+    if (maxSamples > static_cast<double>(ephem::MaxStreamingSamples))
+    {
+        GetLogger()->warn("MaxSamples for StreamingTrajectory limited to {}\n", ephem::MaxStreamingSamples);
+        maxSamples = static_cast<double>(ephem::MaxStreamingSamples);
+    }
+
+    return ephem::CreateStreamingTrajectory(path.empty() ? "data" / *sourceFile : path / "data" / *sourceFile,
+                                            retention,
+                                            static_cast<std::size_t>(maxSamples));
+}
+
 /** Create a new FixedPosition trajectory.
  *
  * A FixedPosition is a property list with one of the following 3-vector properties:
@@ -1461,6 +1513,18 @@ CreateOrbit(const Selection& centralObject,
         return CreateSampledTrajectory(sampledTrajData, path);
     }
 
+    if (const Value* streamingTrajDataValue = planetData->getValue("StreamingTrajectory"); streamingTrajDataValue != nullptr)
+    {
+        const Hash* streamingTrajData = streamingTrajDataValue->getHash();
+        if (streamingTrajData == nullptr)
+        {
+            GetLogger()->error("Object has incorrect syntax for StreamingTrajectory.\n");
+            return nullptr;
+        }
+
+        return CreateStreamingTrajectory(streamingTrajData, path);
+    }
+
     // Old style for sampled trajectories. Assumes cubic interpolation and
     // single precision.
     if (const std::string* sampOrbitFile = planetData->getString("SampledOrbit"); sampOrbitFile != nullptr)
@@ -163,20 +163,28 @@ std::unique_ptr<Hash> Parser::readHash()
         return nullptr;
     }
 
-    auto hash = std::make_unique<Hash>();
+    return readHashEntries(std::make_unique<Hash>());
+}
 
-    tok = tokenizer->nextToken();
-    while (tok != Tokenizer::TokenEndGroup)
+
+std::unique_ptr<Hash> Parser::readHashEntries(std::unique_ptr<Hash>&& hash, std::string&& name)
+{
+    for (;;)
     {
-        std::string name;
-        if (auto tokenValue = tokenizer->getNameValue(); tokenValue.has_value())
-        {
-            name = *tokenValue;
-        }
-        else
+        if (name.empty())
         {
-            tokenizer->pushBack();
-            return nullptr;
+            if (tokenizer->nextToken() == Tokenizer::TokenEndGroup)
+                return std::move(hash);
+
+            if (auto tokenValue = tokenizer->getNameValue(); tokenValue.has_value())
+            {
+                name = *tokenValue;
+            }
+            else
+            {
+                tokenizer->pushBack();
+                return nullptr;
+            }
         }
 
         Value::Units units = readUnits(*tokenizer);
@@ -189,11 +197,8 @@ std::unique_ptr<Hash> Parser::readHash()
 
         value.setUnits(units);
         hash->addValue(std::move(name), std::move(value));
-
-        tok = tokenizer->nextToken();
+        name.clear();
     }
-
-    return hash;
 }
 
 
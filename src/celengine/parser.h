@@ -11,6 +11,7 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
 #include "hash.h"
 #include "value.h"
@@ -25,6 +26,12 @@ class Parser
 
     Value readValue();
 
+    // Read the entries of a hash up to its closing brace, after the opening
+    // brace and possibly some entries were read by the caller. If name is
+    // not empty, it is the name of the next entry, which was already read.
+    // Returns nullptr on a syntax error.
+    std::unique_ptr<Hash> readHashEntries(std::unique_ptr<Hash>&& hash, std::string&& name = {});
+
  private:
     Tokenizer* tokenizer;
 
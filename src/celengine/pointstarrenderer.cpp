@@ -21,6 +21,7 @@ using namespace std;
 using namespace Eigen;
 
 namespace astro = celestia::astro;
+namespace engine = celestia::engine;
 
 // Convert a position in the universal coordinate system to astrocentric
 // coordinates, taking into account possible orbital motion of the star.
@@ -37,16 +38,29 @@ PointStarRenderer::PointStarRenderer() :
 }
 
 void PointStarRenderer::process(const Star& star, float distance, float appMag)
+{
+    process(star, engine::StarRenderRecord::fromStar(star), distance, appMag);
+}
+
+// The star itself is only accessed for stars that are close to the viewer,
+// in orbits, or labelled; the common case of a distant point star reads
+// just the render record.
+void PointStarRenderer::process(const Star& star,
+                                const engine::StarRenderRecord& record,
+                                float distance,
+                                float appMag)
 {
     if (distance > distanceLimit)
         return;
 
-    Vector3f starPos = star.getPosition();
+    const Vector3f& starPos = record.position;
 
     // Calculate the difference at double precision *before* converting to float.
     // This is very important for stars that are far from the origin.
     Vector3f relPos = (starPos.cast<double>() - obsPos).cast<float>();
-    float    orbitalRadius = star.getOrbitalRadius();
+    float    orbitalRadius = (record.flags & engine::StarRenderRecord::HasOrbit) != 0
+                           ? star.getOrbitalRadius()
+                           : 0.0f;
     bool     hasOrbit = orbitalRadius > 0.0f;
 
     // A very rough check to see if the star may be visible: is the star in
@@ -57,7 +71,6 @@ void PointStarRenderer::process(const Star& star, float distance, float appMag)
     // cost of a normalize per star.
     if (relPos.dot(viewNormal) > 0.0f || relPos.x() * relPos.x() < 0.1f || hasOrbit)
     {
-        Color starColor = colorTemp->lookupColor(star.getTemperature());
         float discSizeInPixels = 0.0f;
         float orbitSizeInPixels = 0.0f;
 
@@ -97,19 +110,8 @@ void PointStarRenderer::process(const Star& star, float distance, float appMag)
         // planets.
         if (distance > SolarSystemMaxDistance)
         {
-            float pointSize, alpha, glareSize, glareAlpha;
-            float size = BaseStarDiscSize * static_cast<float>(renderer->getScreenDpi()) / 96.0f;
-            renderer->calculatePointSize(appMag,
-                                         size,
-                                         pointSize,
-                                         alpha,
-                                         glareSize,
-                                         glareAlpha);
-
-            if (glareSize != 0.0f)
-                glareVertexBuffer->addStar(relPos, Color(starColor, glareAlpha), glareSize);
-            if (pointSize != 0.0f)
-                starVertexBuffer->addStar(relPos, Color(starColor, alpha), pointSize);
+            if (!labelsOnly && (!staticPointStars || (record.flags & engine::StarRenderRecord::HasOrbit) != 0))
+                addPointStar(relPos, record, appMag, *starVertexBuffer, *glareVertexBuffer);
 
             // Place labels for stars brighter than the specified label threshold brightness
             if (((labelMode & Renderer::StarLabels) != 0) && appMag < labelThresholdMag)
@@ -163,3 +165,117 @@ void PointStarRenderer::process(const Star& star, float distance, float appMag)
         }
     }
 }
+
+bool PointStarRenderer::processStaged(const engine::StarRenderRecord& record,
+                                      float distance,
+                                      float appMag,
+                                      PointStarVertexBuffer::Staging& stars,
+                                      PointStarVertexBuffer::Staging& glare) const
+{
+    if (distance > distanceLimit)
+        return true;
+
+    // Nearby and orbiting stars need the accurate position computation from
+    // the star, and may end up in the render list.
+    if (distance <= SolarSystemMaxDistance || (record.flags & engine::StarRenderRecord::HasOrbit) != 0)
+        return false;
+
+    // Annotations may only be added on the render thread
+    if ((labelMode & Renderer::StarLabels) != 0 && appMag < labelThresholdMag)
+        return false;
+
+    if (staticPointStars || labelsOnly)
+        return true;
+
+    // Same rough visibility check as in process()
+    Vector3f relPos = (record.position.cast<double>() - obsPos).cast<float>();
+    if (relPos.dot(viewNormal) <= 0.0f && relPos.x() * relPos.x() >= 0.1f)
+        return true;
+
+    addPointStar(relPos, record, appMag, stars, glare);
+    return true;
+}
+
+void PointStarRenderer::stageStar(const engine::StarRenderRecord& record,
+                                  float distance,
+                                  float appMag,
+                                  PointStarVertexBuffer::Staging& stars,
+                                  PointStarVertexBuffer::Staging& glare) const
+{
+    if (distance > distanceLimit)
+        return;
+
+    Vector3f relPos = (record.position.cast<double>() - obsPos).cast<float>();
+    addPointStar(relPos, record, appMag, stars, glare);
+}
+
+void PointStarRenderer::process(const engine::StarRenderRecord& record,
+                                float distance,
+                                float appMag)
+{
+    // Nearby stars would need the accurate position computation and the
+    // render list, which require a Star object
+    if (distance > distanceLimit || distance <= SolarSystemMaxDistance)
+        return;
+
+    Vector3f relPos = (record.position.cast<double>() - obsPos).cast<float>();
+    if (relPos.dot(viewNormal) <= 0.0f && relPos.x() * relPos.x() >= 0.1f)
+        return;
+
+    addPointStar(relPos, record, appMag, *starVertexBuffer, *glareVertexBuffer);
+}
+
+template<typename BUFFER>
+void PointStarRenderer::addPointStar(const Vector3f& relPos,
+                                     const engine::StarRenderRecord& record,
+                                     float appMag,
+                                     BUFFER& stars,
+                                     BUFFER& glare) const
+{
+    Color starColor = colorTemp->indexedColor(record.colorIndex);
+    float pointSize, alpha, glareSize, glareAlpha;
+    calculateStarSize(appMag, pointSize, alpha, glareSize, glareAlpha);
+
+    if (glareSize != 0.0f)
+        glare.addStar(relPos, Color(starColor, glareAlpha), glareSize);
+    if (pointSize != 0.0f)
+        stars.addStar(relPos, Color(starColor, alpha), pointSize);
+}
+
+void PointStarRenderer::calculateStarSize(float appMag,
+                                          float& pointSize,
+                                          float& alpha,
+                                          float& glareSize,
+                                          float& glareAlpha) const
+{
+    float size = BaseStarDiscSize * static_cast<float>(renderer->getScreenDpi()) / 96.0f;
+    renderer->calculatePointSize(appMag,
+                                 size,
+                                 pointSize,
+                                 alpha,
+                                 glareSize,
+                                 glareAlpha);
+}
+
+void PointStarStagingHandler::process(const Star& star,
+                                      const engine::StarRenderRecord& record,
+                                      float distance,
+                                      float appMag)
+{
+    if (!starRenderer->processStaged(record, distance, appMag, m_starVertices, m_glareVertices))
+        m_deferred.push_back(DeferredStar{ &star, record, distance, appMag });
+}
+
+// Point stars are drawn with additive blending, so the staged vertices may
+// be drawn in any order relative to the stars processed on the render thread.
+void PointStarStagingHandler::finish()
+{
+    starRenderer->glareVertexBuffer->addStars(m_glareVertices);
+    starRenderer->starVertexBuffer->addStars(m_starVertices);
+    for (const DeferredStar& deferred : m_deferred)
+        starRenderer->process(*deferred.star, deferred.record, deferred.distance, deferred.appMag);
+
+    m_starVertices.clear();
+    m_glareVertices.clear();
+    m_deferred.clear();
+}
@@ -15,10 +15,12 @@
 #include <Eigen/Core>
 
 #include "objectrenderer.h"
+#include "pagedstaroctree.h"
+#include "pointstarvertexbuffer.h"
 #include "renderlistentry.h"
+#include "staroctree.h"
 
 class ColorTemperatureTable;
-class PointStarVertexBuffer;
 class Star;
 class StarDatabase;
 
@@ -30,11 +32,34 @@ constexpr inline float BaseStarDiscSize      = 5.0f;
 constexpr inline float MaxScaledDiscStarSize = 8.0f;
 constexpr inline float GlareOpacity          = 0.65f;
 
-class PointStarRenderer : public ObjectRenderer<Star, float>
+class PointStarRenderer : public ObjectRenderer<Star, float>,
+                          public celestia::engine::StarRecordHandler,
+                          public celestia::engine::PagedStarHandler
 {
 public:
     PointStarRenderer();
     void process(const Star &star, float distance, float appMag) override;
+    void process(const Star &star, const celestia::engine::StarRenderRecord &record, float distance, float appMag) override;
+    // Stars of the paged catalog have no Star object, so they are only drawn
+    // as distant points, without labels
+    void process(const celestia::engine::StarRenderRecord &record, float distance, float appMag) override;
+
+    // Thread-safe part of process for the parallel traversal: distant stars
+    // without labels are written to the staging arrays. Returns false if the
+    // star must instead be passed to process on the render thread.
+    bool processStaged(const celestia::engine::StarRenderRecord &record,
+                       float distance,
+                       float appMag,
+                       PointStarVertexBuffer::Staging &stars,
+                       PointStarVertexBuffer::Staging &glare) const;
+
+    // Add a distant star to the staging arrays whatever its direction, for
+    // the distant star cache; no label is placed
+    void stageStar(const celestia::engine::StarRenderRecord &record,
+                   float distance,
+                   float appMag,
+                   PointStarVertexBuffer::Staging &stars,
+                   PointStarVertexBuffer::Staging &glare) const;
 
     Eigen::Vector3d obsPos;
     Eigen::Vector3f viewNormal;
@@ -45,4 +70,49 @@ public:
     const ColorTemperatureTable* colorTemp      { nullptr };
     float SolarSystemMaxDistance                { 1.0f };
     float cosFOV                                { 1.0f };
+    // Distant stars without orbits are drawn from the static star buffer,
+    // so only their labels are handled here
+    bool staticPointStars                       { false };
+    // Distant stars are drawn from the distant star cache, so only their
+    // labels are handled here
+    bool labelsOnly                             { false };
+
+private:
+    template<typename BUFFER>
+    void addPointStar(const Eigen::Vector3f &relPos,
+                      const celestia::engine::StarRenderRecord &record,
+                      float appMag,
+                      BUFFER &stars,
+                      BUFFER &glare) const;
+    void calculateStarSize(float appMag,
+                           float &pointSize,
+                           float &alpha,
+                           float &glareSize,
+                           float &glareAlpha) const;
+};
+
+// Star handler for the worker threads of the parallel point star traversal.
+// Stars which the renderer cannot stage are kept in a list, and replayed in
+// finish() together with the staged vertices.
+class PointStarStagingHandler : public celestia::engine::StarRecordHandler
+{
+public:
+    void process(const Star &star, const celestia::engine::StarRenderRecord &record, float distance, float appMag) override;
+    // Must be called on the render thread after the traversal
+    void finish();
+
+    PointStarRenderer* starRenderer             { nullptr };
+
+private:
+    struct DeferredStar
+    {
+        const Star* star;
+        celestia::engine::StarRenderRecord record;
+        float distance;
+        float appMag;
+    };
+
+    PointStarVertexBuffer::Staging m_starVertices;
+    PointStarVertexBuffer::Staging m_glareVertices;
+    std::vector<DeferredStar> m_deferred;
 };
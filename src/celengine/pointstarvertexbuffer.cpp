@@ -8,7 +8,11 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
+#include <array>
+#include <Eigen/Geometry>
 #include <celrender/gl/buffer.h>
+#include <celrender/gl/streambuffer.h>
 #include <celrender/gl/vertexobject.h>
 #include <celutil/color.h>
 #include "glsupport.h"
@@ -21,6 +25,15 @@
 namespace gl = celestia::gl;
 namespace util = celestia::util;
 
+namespace
+{
+
+// Side of the squares of the window in which faint stars are merged, in
+// pixels
+constexpr int SplatCellSize = 2;
+
+} // end unnamed namespace
+
 PointStarVertexBuffer* PointStarVertexBuffer::current = nullptr;
 
 PointStarVertexBuffer::PointStarVertexBuffer(const Renderer &renderer,
@@ -55,18 +68,101 @@ void PointStarVertexBuffer::render()
         if (m_texture != nullptr)
             m_texture->bind();
 
-        m_bo->invalidateData().setData(
-            util::array_view(m_vertices.get(), m_nStars),
-            gl::Buffer::BufferUsage::StreamDraw);
+        gl::StreamBuffer& stream = m_renderer.getStreamBuffer();
+        auto allocation = stream.allocate(m_nStars * sizeof(StarVertex), sizeof(StarVertex));
+        std::copy_n(m_vertices.get(), m_nStars, static_cast<StarVertex*>(allocation.data));
+        stream.flush();
 
+        auto first = static_cast<int>(allocation.offset / sizeof(StarVertex));
         if (m_pointSizeFromVertex)
-            m_vo1->draw(m_nStars);
+            m_vo1->draw(m_nStars, first);
         else
-            m_vo2->draw(m_nStars);
+            m_vo2->draw(m_nStars, first);
+        m_starsDrawn += m_nStars;
         m_nStars = 0;
     }
 }
 
+void PointStarVertexBuffer::addStars(const Staging &staging)
+{
+    if (m_splatting)
+    {
+        for (const StarVertex &vertex : staging.m_vertices)
+        {
+            addStar(vertex.position,
+                    Color(vertex.color[0], vertex.color[1], vertex.color[2], vertex.color[3]),
+                    vertex.size);
+        }
+        return;
+    }
+
+    const StarVertex *src = staging.m_vertices.data();
+    auto remaining = static_cast<capacity_t>(staging.m_vertices.size());
+    while (remaining > 0)
+    {
+        capacity_t count = std::min(remaining, m_capacity - m_nStars);
+        std::copy_n(src, count, m_vertices.get() + m_nStars);
+        m_nStars += count;
+        src += count;
+        remaining -= count;
+
+        if (m_nStars == m_capacity)
+            render();
+    }
+}
+
+void PointStarVertexBuffer::render(const StaticBatch &batch, const Eigen::Vector3f &offset)
+{
+    if (batch.m_nStars == 0 || m_prog == nullptr)
+        return;
+
+    // The vertices collected so far are drawn with the matrices of the
+    // frame, without the offset
+    finish();
+    makeCurrent();
+
+    Eigen::Affine3f translation(Eigen::Translation3f{ offset });
+    m_prog->setMVPMatrices(m_renderer.getCurrentProjectionMatrix(),
+                           m_renderer.getCurrentModelViewMatrix() * translation.matrix());
+    if (m_texture != nullptr)
+        m_texture->bind();
+
+    auto count = static_cast<int>(batch.m_nStars);
+    if (m_pointSizeFromVertex)
+        batch.m_vo1->draw(count);
+    else
+        batch.m_vo2->draw(count);
+    m_starsDrawn += batch.m_nStars;
+
+    // Set the matrices again for the next vertices
+    current = nullptr;
+}
+
+void PointStarVertexBuffer::startSplatting(float maxSize)
+{
+    if (m_splatter == nullptr)
+        m_splatter = std::make_unique<celestia::engine::StarSplatter>();
+
+    std::array<int, 4> viewport;
+    m_renderer.getViewport(viewport);
+    m_splatter->begin(m_renderer.getCurrentProjectionMatrix() * m_renderer.getCurrentModelViewMatrix(),
+                      viewport[2], viewport[3], SplatCellSize);
+    m_splatMaxSize = maxSize;
+    m_splatting = true;
+}
+
+void PointStarVertexBuffer::endSplatting()
+{
+    if (!m_splatting)
+        return;
+
+    m_splatting = false;
+    m_splatter->end([this](const Eigen::Vector3f &pos, const Color &color, float size)
+    {
+        addVertex(pos, color, size);
+    });
+}
+
 void PointStarVertexBuffer::makeCurrent()
 {
     if (current == this || m_prog == nullptr)
@@ -97,54 +193,46 @@ void PointStarVertexBuffer::setupVertexArrayObject()
     {
         m_initialized = true;
 
-        m_bo = std::make_unique<gl::Buffer>();
+        gl::Buffer& bo = m_renderer.getStreamBuffer().buffer();
         m_vo1 = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
         m_vo2 = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
+        addVertexBuffers(*m_vo1, bo, true);
+        addVertexBuffers(*m_vo2, bo, false);
+    }
+}
 
-        m_vo1->addVertexBuffer(
-            *m_bo,
-            CelestiaGLProgram::VertexCoordAttributeIndex,
-            3,
-            gl::VertexObject::DataType::Float,
-            false,
-            sizeof(StarVertex),
-            offsetof(StarVertex, position));
-
-        m_vo1->addVertexBuffer(
-            *m_bo,
-            CelestiaGLProgram::ColorAttributeIndex,
-            4,
-            gl::VertexObject::DataType::UnsignedByte,
-            true,
-            sizeof(StarVertex),
-            offsetof(StarVertex, color));
+void PointStarVertexBuffer::addVertexBuffers(gl::VertexObject &vo,
+                                             gl::Buffer &bo,
+                                             bool pointSize)
+{
+    vo.addVertexBuffer(
+        bo,
+        CelestiaGLProgram::VertexCoordAttributeIndex,
+        3,
+        gl::VertexObject::DataType::Float,
+        false,
+        sizeof(StarVertex),
+        offsetof(StarVertex, position));
 
-        m_vo1->addVertexBuffer(
-            *m_bo,
+    vo.addVertexBuffer(
+        bo,
+        CelestiaGLProgram::ColorAttributeIndex,
+        4,
+        gl::VertexObject::DataType::UnsignedByte,
+        true,
+        sizeof(StarVertex),
+        offsetof(StarVertex, color));
+
+    if (pointSize)
+    {
+        vo.addVertexBuffer(
+            bo,
             CelestiaGLProgram::PointSizeAttributeIndex,
             1,
             gl::VertexObject::DataType::Float,
             false,
             sizeof(StarVertex),
             offsetof(StarVertex, size));
-
-        m_vo2->addVertexBuffer(
-            *m_bo,
-            CelestiaGLProgram::VertexCoordAttributeIndex,
-            3,
-            gl::VertexObject::DataType::Float,
-            false,
-            sizeof(StarVertex),
-            offsetof(StarVertex, position));
-
-        m_vo2->addVertexBuffer(
-            *m_bo,
-            CelestiaGLProgram::ColorAttributeIndex,
-            4,
-            gl::VertexObject::DataType::UnsignedByte,
-            true,
-            sizeof(StarVertex),
-            offsetof(StarVertex, color));
     }
 }
 
@@ -154,6 +242,38 @@ void PointStarVertexBuffer::finish()
     current = nullptr;
 }
 
+void PointStarVertexBuffer::Staging::clear()
+{
+    m_vertices.clear();
+}
+
+PointStarVertexBuffer::StaticBatch::StaticBatch() = default;
+
+PointStarVertexBuffer::StaticBatch::~StaticBatch() = default;
+
+void PointStarVertexBuffer::StaticBatch::set(const Staging &staging)
+{
+    if (m_bo == nullptr)
+    {
+        m_bo = std::make_unique<gl::Buffer>();
+        m_vo1 = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
+        m_vo2 = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
+        addVertexBuffers(*m_vo1, *m_bo, true);
+        addVertexBuffers(*m_vo2, *m_bo, false);
+    }
+
+    m_bo->setData(staging.m_vertices, gl::Buffer::BufferUsage::StaticDraw);
+    m_nStars = static_cast<capacity_t>(staging.m_vertices.size());
+}
+
+void PointStarVertexBuffer::StaticBatch::clear()
+{
+    m_vo1 = nullptr;
+    m_vo2 = nullptr;
+    m_bo = nullptr;
+    m_nStars = 0;
+}
+
 void PointStarVertexBuffer::enable()
 {
 #ifndef GL_ES
@@ -10,10 +10,13 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <vector>
 #include <Eigen/Core>
+#include <celengine/starsplatter.h>
+#include <celutil/color.h>
 
-class Color;
 class Renderer;
 class Texture;
 class CelestiaGLProgram;
@@ -27,9 +30,54 @@ class VertexObject;
 // PointStarVertexBuffer is used when hardware supports point sprites.
 class PointStarVertexBuffer
 {
+    struct StarVertex
+    {
+        Eigen::Vector3f position;
+        float size;
+        unsigned char color[4];
+    };
+
 public:
     using capacity_t = unsigned int;
 
+    // Vertices collected by a worker thread without access to the GL
+    // context; they are drawn by passing the staging array to addStars
+    // on the render thread.
+    class Staging
+    {
+    public:
+        void addStar(const Eigen::Vector3f &pos, const Color &color, float size);
+        void clear();
+
+    private:
+        std::vector<StarVertex> m_vertices;
+
+        friend class PointStarVertexBuffer;
+    };
+
+    // Vertices kept in a buffer on the graphics card, for stars which are
+    // drawn unchanged over many frames
+    class StaticBatch
+    {
+    public:
+        StaticBatch();
+        ~StaticBatch();
+        StaticBatch(const StaticBatch&) = delete;
+        StaticBatch& operator=(const StaticBatch&) = delete;
+
+        void set(const Staging &staging);
+        void clear();
+        capacity_t size() const { return m_nStars; }
+
+    private:
+        std::unique_ptr<celestia::gl::Buffer>       m_bo;
+        std::unique_ptr<celestia::gl::VertexObject> m_vo1;
+        std::unique_ptr<celestia::gl::VertexObject> m_vo2;
+        capacity_t                                  m_nStars{ 0 };
+
+        friend class PointStarVertexBuffer;
+    };
+
     PointStarVertexBuffer(const Renderer &renderer, capacity_t capacity);
     ~PointStarVertexBuffer() = default;
     PointStarVertexBuffer() = delete;
@@ -43,30 +91,42 @@ public:
     void render();
     void finish();
     void addStar(const Eigen::Vector3f &pos, const Color &color, float size);
+    void addStars(const Staging &staging);
+    // Draw the stars of a batch, their positions displaced by offset; they
+    // are not merged by the splatting
+    void render(const StaticBatch &batch, const Eigen::Vector3f &offset);
     void setTexture(Texture* texture);
     void setPointScale(float);
 
+    // Merge the stars up to maxSize pixels which fall in the same few
+    // pixels of the window until endSplatting(), which adds the merged
+    // stars; used for dense star fields. The projection and model view
+    // matrices must be those the stars are drawn with.
+    void startSplatting(float maxSize);
+    void endSplatting();
+
+    // Number of stars drawn since the buffer was created
+    std::uint64_t getStarsDrawn() const { return m_starsDrawn; }
+    // Number of stars merged into others since the buffer was created
+    std::uint64_t getStarsMerged() const { return m_splatter != nullptr ? m_splatter->getMergedCount() : 0; }
+
     static void enable();
     static void disable();
 
 private:
-    struct StarVertex
-    {
-        Eigen::Vector3f position;
-        float size;
-        unsigned char color[4];
-    };
-
     const Renderer                 &m_renderer;
     capacity_t                      m_capacity;
     capacity_t                      m_nStars                { 0 };
+    std::uint64_t                   m_starsDrawn            { 0 };
     std::unique_ptr<StarVertex[]>   m_vertices;
     Texture                        *m_texture               { nullptr };
     bool                            m_pointSizeFromVertex   { false };
     float                           m_pointScale            { 1.0f };
     CelestiaGLProgram              *m_prog                  { nullptr };
+    std::unique_ptr<celestia::engine::StarSplatter> m_splatter;
+    float                           m_splatMaxSize          { 0.0f };
+    bool                            m_splatting             { false };
 
-    std::unique_ptr<celestia::gl::Buffer>        m_bo;
     std::unique_ptr<celestia::gl::VertexObject>  m_vo1;
     std::unique_ptr<celestia::gl::VertexObject>  m_vo2;
     bool m_initialized{ false };
@@ -75,12 +135,27 @@ private:
 
     void makeCurrent();
     void setupVertexArrayObject();
+    static void addVertexBuffers(celestia::gl::VertexObject &vo,
+                                 celestia::gl::Buffer &bo,
+                                 bool pointSize);
+    void addVertex(const Eigen::Vector3f &pos, const Color &color, float size);
 };
 
 inline void
 PointStarVertexBuffer::addStar(const Eigen::Vector3f &pos,
                                const Color &color,
                                float size)
+{
+    if (m_splatting && size <= m_splatMaxSize && m_splatter->add(pos, color, size))
+        return;
+
+    addVertex(pos, color, size);
+}
+
+inline void
+PointStarVertexBuffer::addVertex(const Eigen::Vector3f &pos,
+                                 const Color &color,
+                                 float size)
 {
     if (m_nStars < m_capacity)
     {
@@ -96,3 +171,14 @@ PointStarVertexBuffer::addStar(const Eigen::Vector3f &pos,
         m_nStars = 0;
     }
 }
+
+inline void
+PointStarVertexBuffer::Staging::addStar(const Eigen::Vector3f &pos,
+                                        const Color &color,
+                                        float size)
+{
+    StarVertex& vertex = m_vertices.emplace_back();
+    vertex.position = pos;
+    vertex.size = size;
+    color.get(vertex.color);
+}
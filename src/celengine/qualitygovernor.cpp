@@ -0,0 +1,125 @@
+// qualitygovernor.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Render quality control from measured frame times.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "qualitygovernor.h"
+
+#include <algorithm>
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Weight of a new frame time in the running averages
+constexpr double AverageWeight = 0.1;
+
+// Frames measured at a level before it can be lowered
+constexpr int SettleFrames = 30;
+
+// Consecutive frames below RaiseMargin times the target needed to raise
+// the level
+constexpr int RaiseFrames = 120;
+constexpr double RaiseMargin = 0.7;
+
+// Reductions per level
+constexpr float MagnitudeStep = 0.25f;
+constexpr float OrbitSizeStep = 5.0f;
+constexpr float FeatureSizeStep = 5.0f;
+constexpr float GalaxyDetailStep = 0.1f;
+
+// The magnitude limit isn't lowered below that of the keyboard controls
+constexpr float MinFaintestAM45deg = 6.0f;
+constexpr float MinGalaxyDetail = 0.25f;
+
+// Levels above this also lower the texture resolution
+constexpr int TextureLevel = 6;
+
+void
+average(double& avg, double value, int frames)
+{
+    if (frames == 0)
+        avg = value;
+    else
+        avg += (value - avg) * AverageWeight;
+}
+
+} // end unnamed namespace
+
+QualityGovernor::QualityGovernor(double targetFrameTime) :
+    m_targetFrameTime(targetFrameTime)
+{
+}
+
+bool
+QualityGovernor::update(double simulationTime, double drawTime, std::optional<double> gpuTime)
+{
+    average(m_simulationTime, simulationTime, m_frames);
+    average(m_drawTime, drawTime, m_frames);
+    if (gpuTime.has_value())
+        average(m_gpuTime, *gpuTime, m_frames);
+
+    ++m_frames;
+
+    // The CPU and the GPU work on different frames, so the slower of them
+    // sets the frame rate
+    double frameTime = std::max(m_simulationTime + m_drawTime, m_gpuTime);
+
+    if (frameTime < m_targetFrameTime * RaiseMargin)
+        ++m_fastFrames;
+    else
+        m_fastFrames = 0;
+
+    if (m_frames < SettleFrames)
+        return false;
+
+    if (frameTime > m_targetFrameTime && m_level < MaxLevel)
+    {
+        setLevel(m_level + 1);
+        return true;
+    }
+
+    if (m_fastFrames >= RaiseFrames && m_level > 0)
+    {
+        setLevel(m_level - 1);
+        return true;
+    }
+
+    return false;
+}
+
+QualityGovernor::Settings
+QualityGovernor::settings(const Settings& base) const
+{
+    auto level = static_cast<float>(m_level);
+
+    Settings result;
+    result.faintestAM45deg = std::max(base.faintestAM45deg - MagnitudeStep * level,
+                                      std::min(base.faintestAM45deg, MinFaintestAM45deg));
+    result.minimumOrbitSize = base.minimumOrbitSize + OrbitSizeStep * level;
+    result.minimumFeatureSize = base.minimumFeatureSize + FeatureSizeStep * level;
+    result.galaxyDetail = std::max(base.galaxyDetail - GalaxyDetailStep * level,
+                                   std::min(base.galaxyDetail, MinGalaxyDetail));
+
+    auto textureSteps = static_cast<unsigned int>(std::max(m_level - TextureLevel, 0));
+    result.textureResolution = base.textureResolution - std::min(base.textureResolution, textureSteps);
+    return result;
+}
+
+void
+QualityGovernor::setLevel(int level)
+{
+    m_level = level;
+    m_frames = 0;
+    m_fastFrames = 0;
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,71 @@
+// qualitygovernor.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Render quality control from measured frame times.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <optional>
+
+namespace celestia::engine
+{
+
+// Picks a quality level so that the time of a frame stays below a target.
+// Level 0 renders with the settings chosen by the user; each further level
+// shows fewer stars, orbits, labels and galaxy blobs, and the last ones
+// lower the texture resolution, which is the most expensive change to
+// make. The level is lowered after the frame times settled above the
+// target, and raised only after they stayed well below it for a while, so
+// that it doesn't alternate between two levels.
+class QualityGovernor
+{
+public:
+    static constexpr int MaxLevel = 8;
+
+    // The settings adjusted by the governor
+    struct Settings
+    {
+        float faintestAM45deg;
+        float minimumOrbitSize;
+        float minimumFeatureSize;
+        float galaxyDetail;
+        unsigned int textureResolution;
+    };
+
+    // The target frame time is in seconds
+    explicit QualityGovernor(double targetFrameTime);
+
+    // Account for the CPU times spent on the simulation and on drawing a
+    // frame, and for its GPU time if it was measured, all in seconds.
+    // Return true if the level changed.
+    bool update(double simulationTime, double drawTime, std::optional<double> gpuTime);
+
+    int level() const { return m_level; }
+
+    // The settings of the current level, reduced from those of the user
+    Settings settings(const Settings& base) const;
+
+    // Average times of the stages of a frame in seconds
+    double simulationTime() const { return m_simulationTime; }
+    double drawTime() const { return m_drawTime; }
+    double gpuTime() const { return m_gpuTime; }
+
+private:
+    void setLevel(int level);
+
+    double m_targetFrameTime;
+    double m_simulationTime{ 0.0 };
+    double m_drawTime{ 0.0 };
+    double m_gpuTime{ 0.0 };
+    int m_frames{ 0 };
+    int m_fastFrames{ 0 };
+    int m_level{ 0 };
+};
+
+} // end namespace celestia::engine
@@ -131,8 +131,23 @@ RenderContext::getCameraOrientation() const
 }
 
 
+void
+RenderContext::setCulling(const celestia::math::Frustum* frustum, const Eigen::Vector3f& eyePos)
+{
+    cullingFrustum = frustum;
+    cullingEyePos = eyePos;
+}
+
+
 void
 RenderContext::drawGroup(gl::VertexObject &vao, const cmod::PrimitiveGroup& group)
+{
+    drawGroup(vao, group, 0, group.indicesCount);
+}
+
+
+void
+RenderContext::drawGroup(gl::VertexObject &vao, const cmod::PrimitiveGroup& group, int offset, int count)
 {
     // Skip rendering if this is the emissive pass but there's no
     // emissive texture.
@@ -158,7 +173,10 @@ RenderContext::drawGroup(gl::VertexObject &vao, const cmod::PrimitiveGroup& grou
         glActiveTexture(GL_TEXTURE0);
     }
 
-    vao.draw(convert(group.prim), group.indicesCount, group.indicesOffset);
+    if (instanceCount > 0)
+        vao.drawInstanced(convert(group.prim), count, instanceCount, group.indicesOffset + offset);
+    else
+        vao.draw(convert(group.prim), count, group.indicesOffset + offset);
 
 #ifndef GL_ES
     if (drawPoints)
@@ -252,16 +270,7 @@ GLSL_RenderContext::initLightingEnvironment()
     shaderProps.nLights = std::min(lightingState.nLights, MaxShaderLights);
 
     // Set the shadow information.
-    for (unsigned int li = 0; li < lightingState.nLights; li++)
-    {
-        if (lightingState.shadows[li] && !lightingState.shadows[li]->empty())
-        {
-            unsigned int nShadows = static_cast<unsigned int>(std::min(static_cast<std::size_t>(MaxShaderEclipseShadows),
-                                                                       lightingState.shadows[li]->size()));
-            shaderProps.setEclipseShadowCountForLight(li, nShadows);
-        }
-    }
-
+    shaderProps.setEclipseShadowCounts(lightingState);
 }
 
 void
@@ -417,9 +426,12 @@ GLSL_RenderContext::makeCurrent(const cmod::Material& m)
     if (hasShadowMap)
         shaderProps.texUsage |= TexUsage::ShadowMapTexture;
 
+    if (getInstanceCount() > 0)
+        shaderProps.texUsage |= TexUsage::Instanced;
+
     // Get a shader for the current rendering configuration
     assert(renderer != nullptr);
-    CelestiaGLProgram* prog = renderer->getShaderManager().getShader(shaderProps);
+    CelestiaGLProgram* prog = renderer->getShaderManager().getShaderAsync(shaderProps);
     if (prog == nullptr)
         return;
 
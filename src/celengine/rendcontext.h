@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <limits>
+
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
@@ -30,6 +32,11 @@ namespace celestia::gl
 class VertexObject;
 }
 
+namespace celestia::math
+{
+class Frustum;
+}
+
 class RenderContext
 {
  public:
@@ -39,7 +46,9 @@ class RenderContext
 
     virtual void makeCurrent(const cmod::Material&) = 0;
     virtual void updateShader(const cmod::VertexDescription& desc, cmod::PrimitiveGroupType primType);
-    virtual void drawGroup(celestia::gl::VertexObject &vao, const cmod::PrimitiveGroup& group);
+    void drawGroup(celestia::gl::VertexObject &vao, const cmod::PrimitiveGroup& group);
+    // Draw count indices of group, starting at its index offset
+    virtual void drawGroup(celestia::gl::VertexObject &vao, const cmod::PrimitiveGroup& group, int offset, int count);
 
     const cmod::Material* getMaterial() const;
     void setMaterial(const cmod::Material*);
@@ -62,6 +71,25 @@ class RenderContext
     void setCameraOrientation(const Eigen::Quaternionf& q);
     Eigen::Quaternionf getCameraOrientation() const;
 
+    // Let models skip the parts of large meshes which are outside frustum
+    // or face away from eyePos, both in the coordinates of the vertices. A
+    // null frustum disables culling.
+    void setCulling(const celestia::math::Frustum* frustum, const Eigen::Vector3f& eyePos);
+    const celestia::math::Frustum* getCullingFrustum() const { return cullingFrustum; }
+    const Eigen::Vector3f& getCullingEyePosition() const { return cullingEyePos; }
+
+    // Projected radius of the model in pixels, which selects the meshes
+    // drawn for models with several levels of detail. Without one, the
+    // most detailed meshes are drawn.
+    void setLODPixelSize(float pixelSize) { lodPixelSize = pixelSize; }
+    float getLODPixelSize() const { return lodPixelSize; }
+
+    // Number of copies of the geometry drawn by each draw call, with their
+    // model/view matrices in per-instance vertex attributes. Zero draws a
+    // single copy with the model/view matrix of the context.
+    void setInstanceCount(int count) { instanceCount = count; }
+    int getInstanceCount() const { return instanceCount; }
+
  protected:
     Renderer* renderer { nullptr };
     bool usePointSize{ false };
@@ -76,6 +104,10 @@ class RenderContext
     RenderPass renderPass{ PrimaryPass };
     float pointScale{ 1.0f };
     Eigen::Quaternionf cameraOrientation;  // required for drawing billboards
+    const celestia::math::Frustum* cullingFrustum{ nullptr };
+    Eigen::Vector3f cullingEyePos{ Eigen::Vector3f::Zero() };
+    float lodPixelSize{ std::numeric_limits<float>::infinity() };
+    int instanceCount{ 0 };
 };
 
 
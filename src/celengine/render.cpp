@@ -39,12 +39,15 @@
 #include "curveplot.h"
 #include "shadermanager.h"
 #include "rectangle.h"
-#include "framebuffer.h"
 #include "planetgrid.h"
 #include "pointstarvertexbuffer.h"
 #include "pointstarrenderer.h"
-#include "orbitsampler.h"
+#include "distantstarcache.h"
+#include "orbitpathcache.h"
 #include "rendcontext.h"
+#include "labelbatch.h"
+#include "occlusionqueries.h"
+#include "shadowmapcache.h"
 #include "textlayout.h"
 #include <celastro/astro.h>
 #include <celastro/date.h>
@@ -68,19 +71,32 @@
 #include <celrender/openclusterrenderer.h>
 #include <celrender/ringrenderer.h>
 #include <celrender/skygridrenderer.h>
+#include <celrender/starpickbuffer.h>
+#include <celrender/staticstarrenderer.h>
+#include <celrender/gl/binder.h>
 #include <celrender/gl/buffer.h>
+#include <celrender/gl/callcounters.h>
+#include <celrender/gl/streambuffer.h>
 #include <celrender/gl/vertexobject.h>
 #include <celutil/logger.h>
+#include <celutil/parallelfor.h>
 #include <celutil/utf8.h>
 #include <celutil/timer.h>
+#include <celutil/uploadbudget.h>
 #include <celttf/truetypefont.h>
 #include "glsupport.h"
+#include "gputimestamps.h"
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cstring>
 #include <cassert>
+#include <cctype>
 #include <sstream>
 #include <iomanip>
 #include <numeric>
+#include <thread>
+#include <utility>
 #ifdef _MSC_VER
 #include <malloc.h>
 #ifndef alloca
@@ -97,6 +113,38 @@ using celestia::util::GetLogger;
 
 static const int REF_DISTANCE_TO_SCREEN  = 400; //[mm]
 
+namespace
+{
+
+// Adds the time since the previous stage ended to each stage as it ends,
+// if stage timing is enabled
+class StageTimer
+{
+public:
+    explicit StageTimer(Renderer::StageTimes* times) :
+        m_times(times)
+    {
+        if (m_times != nullptr)
+            m_last = std::chrono::steady_clock::now();
+    }
+
+    void end(Renderer::RenderStage stage)
+    {
+        if (m_times == nullptr)
+            return;
+
+        auto now = std::chrono::steady_clock::now();
+        (*m_times)[static_cast<std::size_t>(stage)] += std::chrono::duration<double>(now - m_last).count();
+        m_last = now;
+    }
+
+private:
+    Renderer::StageTimes* m_times;
+    std::chrono::steady_clock::time_point m_last;
+};
+
+} // end unnamed namespace
+
 // Contribution from planetshine beyond this distance (in units of object radius)
 // is considered insignificant.
 static const float PLANETSHINE_DISTANCE_LIMIT_FACTOR = 100.0f;
@@ -118,6 +166,13 @@ static const float MaxFarNearRatio      = 2000000.0f;
 
 static const float MinRelativeOccluderRadius = 0.005f;
 
+// Adjacent depth buffer intervals are merged while the ratio of the far to
+// the near distance of the merged interval stays below this value.
+static const float MaxCoalescedFarNearRatio = 1000.0f;
+
+// Size of each of the three regions of the buffer for streamed vertices
+static const GLsizeiptr StreamBufferRegionSize = 1024 * 1024;
+
 // The minimum apparent size of an objects orbit in pixels before we display
 // a label for it.  This minimizes label clutter.
 static const float MinOrbitSizeForLabel = 20.0f;
@@ -136,6 +191,54 @@ static const float MaxAsterismLinesConstDist   = 600.0f;
 static const float MaxAsterismLabelsDist = 20.0f;
 static const float MaxAsterismLinesDist  = 6.52e4f;
 
+// Star catalogs with at least this many stars are searched for visible point
+// stars using several threads.
+static const std::uint32_t ParallelPointStarMinStars = 250000;
+static const unsigned int MaxPointStarThreads = 8;
+// Stars farther than this from the position of the distant star cache (in
+// light years) are drawn from it; this must be greater than the largest
+// SolarSystemMaxDistance plus the translation below
+static const float DistantStarCacheRadius = 20.0f;
+// Distance the observer may move before the cache is built again; the
+// brightness of the cached stars is then off by less than 0.02 magnitudes
+static const float DistantStarCacheMaxTranslation = 0.01f * DistantStarCacheRadius;
+// Deep sky catalogs at least this large are traversed on several threads
+static const std::uint32_t ParallelDSOMinObjects = 50000;
+static const unsigned int MaxDSOThreads = 8;
+// The orbits of frame trees with at least this many children are evaluated
+// in bulk before culling, and on several threads for the largest trees, such
+// as asteroid and TNO catalogs
+static const unsigned int BatchBodyMinChildren = 256;
+static const unsigned int ParallelBodyMinChildren = 4096;
+static const unsigned int MaxBodyThreads = 8;
+// Render lists with at least this many entries are culled and sorted on
+// several threads
+static const std::size_t ParallelCullMinEntries = 8192;
+static constexpr unsigned int MaxCullThreads = 8;
+// At time scales of at least this, bodies appearing smaller than this many
+// pixels, with their satellite systems, are positioned on osculating orbits
+// which are refitted when the time has moved by this many periods
+static const double FastForwardTimeScale = 1.0e6;
+static const double FastForwardMaxPixels = 1.0;
+static const double FastForwardRefitPeriods = 10.0;
+// Planetary systems with at least this many bodies are searched for eclipse
+// shadow casters using a bounding volume hierarchy
+static const int EclipseBVHMinCasters = 32;
+// Eclipse tests which fail by a wide margin are skipped for up to this many
+// days, or until the simulation time jumps by more than that
+static const double MaxEclipseMissInterval = 0.25;
+static const double MinEclipseMissInterval = 1.0 / 1440.0;
+static const std::size_t MaxEclipseMisses = 65536;
+
+// Bodies of the minor body catalogs are drawn as points in this color
+static const Color MinorBodyColor(1.0f, 0.95f, 0.85f);
+
+// Runs of at least this many bodies sharing a model are drawn instanced, if
+// their lighting differs by less than the limits below
+static const std::size_t MinInstancedBodies = 4;
+static const float MaxInstanceIrradianceDifference = 0.01f;
+static const float MinInstanceLightCosine = 0.9999f;
+
 // Static meshes and textures used by all instances of Simulation
 
 static bool commonDataInitialized = false;
@@ -148,10 +251,6 @@ static Texture* gaussianGlareTex = nullptr;
 
 static const float CoronaHeight = 0.2f;
 
-// Size at which the orbit cache will be flushed of old orbit paths
-static const unsigned int OrbitCacheCullThreshold = 200;
-// Age in frames at which unused orbit paths may be eliminated from the cache
-static const uint32_t OrbitCacheRetireAge = 16;
 
 Color Renderer::StarLabelColor          (0.471f, 0.356f, 0.682f);
 Color Renderer::PlanetLabelColor        (0.407f, 0.333f, 0.964f);
@@ -244,7 +343,6 @@ Renderer::Renderer() :
     glareVertexBuffer(nullptr),
     textureResolution(medres),
     frameCount(0),
-    lastOrbitCacheFlush(0),
     minOrbitSize(MinOrbitSizeForLabel),
     distanceLimit(1.0e6f),
     minFeatureSize(MinFeatureSizeForLabel),
@@ -260,6 +358,7 @@ Renderer::Renderer() :
     m_hollowMarkerRenderer(std::make_unique<LineRenderer>(*this, 1.0f, LineRenderer::PrimType::Lines, LineRenderer::StorageType::Static)),
     m_nebulaRenderer(std::make_unique<NebulaRenderer>(*this)),
     m_openClusterRenderer(std::make_unique<OpenClusterRenderer>(*this)),
+    m_orbitPathCache(std::make_unique<engine::OrbitPathCache>(*this)),
     m_ringRenderer(std::make_unique<RingRenderer>(*this)),
     m_skyGridRenderer(std::make_unique<SkyGridRenderer>(*this))
 {
@@ -503,6 +602,51 @@ bool operator<(const RenderListEntry& a, const RenderListEntry& b)
 }
 
 
+// Opaque bodies without blended parts may be drawn in any order within a
+// depth interval; bodies with atmospheres or rings are kept back to front.
+static bool
+isStateSortable(const RenderListEntry& rle)
+{
+    if (rle.renderableType != RenderListEntry::RenderableBody)
+        return false;
+
+    const BodyFeaturesManager* bodyFeaturesManager = GetBodyFeaturesManager();
+    return bodyFeaturesManager->getAtmosphere(rle.body) == nullptr &&
+           bodyFeaturesManager->getRings(rle.body) == nullptr;
+}
+
+
+// Key grouping the bodies drawn with the same model and surface texture,
+// and so with the same program and texture bindings
+static std::pair<ResourceHandle, ResourceHandle>
+stateSortKey(const RenderListEntry& rle, unsigned int textureResolution)
+{
+    return { rle.body->getGeometry(), rle.body->getSurface().baseTexture.tex[textureResolution] };
+}
+
+
+// Whether two bodies with the same model and surface texture also get the
+// same material, and can be drawn as instances of each other
+static bool
+isSameMaterial(const Surface& a, const Surface& b)
+{
+    return a.color == b.color &&
+           a.specularColor == b.specularColor &&
+           a.specularPower == b.specularPower &&
+           a.appearanceFlags == b.appearanceFlags;
+}
+
+
+// Instances are drawn with the light of the first one
+static bool
+isSimilarLight(const DirectionalLight& a, const DirectionalLight& b)
+{
+    return a.color == b.color &&
+           std::abs(a.irradiance - b.irradiance) <= MaxInstanceIrradianceDifference * a.irradiance &&
+           a.direction_eye.dot(b.direction_eye) >= MinInstanceLightCosine;
+}
+
+
 // Depth comparison for labels
 // Note that it's essential to declare this operator as a member
 // function of Renderer::Label; if it's not a class member, C++'s
@@ -532,6 +676,9 @@ bool Renderer::init(int winWidth, int winHeight, const DetailOptions& _detailOpt
 
     m_markerVO = std::make_unique<celestia::gl::VertexObject>();
     m_markerBO = std::make_unique<celestia::gl::Buffer>();
+    m_streamBuffer = std::make_unique<celestia::gl::StreamBuffer>(celestia::gl::Buffer::TargetHint::Array, StreamBufferRegionSize);
+    for (int i = 0; i < FontCount; i++)
+        m_labelBatches.push_back(std::make_unique<engine::LabelBatch>(*this));
 
     // Initialize static meshes and textures common to all instances of Renderer
     if (!commonDataInitialized)
@@ -557,6 +704,9 @@ bool Renderer::init(int winWidth, int winHeight, const DetailOptions& _detailOpt
     // LEQUAL rather than LESS required for multipass rendering
     glDepthFunc(GL_LEQUAL);
 
+    if (engine::OcclusionQueries::isSupported())
+        m_occlusionQueries = std::make_unique<engine::OcclusionQueries>(*this);
+
     resize(winWidth, winHeight);
 
     return true;
@@ -799,6 +949,20 @@ void Renderer::setMinimumFeatureSize(float pixels)
 }
 
 
+float Renderer::getGalaxyDetail() const
+{
+    return m_galaxyRenderer->getDetail();
+}
+
+
+// Scale the number of blobs drawn for galaxies
+void Renderer::setGalaxyDetail(float detail)
+{
+    m_galaxyRenderer->setDetail(std::clamp(detail, 0.0f, 1.0f));
+    markSettingsChanged();
+}
+
+
 float Renderer::getMinimumOrbitSize() const
 {
     return minOrbitSize;
@@ -889,8 +1053,8 @@ void Renderer::addAnnotation(vector<Annotation>& annotations,
         if (abs(y - win.y()) < 0.001) win.y() = y;
 
         Annotation a;
-        if (!special || markerRep == nullptr)
-             a.labelText = labelText;
+        if ((!special || markerRep == nullptr) && !labelText.empty())
+             a.labelText = m_annotationLabels.add(labelText);
         a.markerRep = markerRep;
         a.color = color;
         a.position = win;
@@ -1079,71 +1243,6 @@ void Renderer::renderOrbit(const OrbitPathListEntry& orbitPath,
 
     const auto* orbit = body != nullptr ? body->getOrbit(t) : orbitPath.star->getOrbit();
 
-    CurvePlot* cachedOrbit = nullptr;
-    if (auto cached = orbitCache.find(orbit); cached != orbitCache.end())
-    {
-        cachedOrbit = cached->second;
-        cachedOrbit->setLastUsed(frameCount);
-    }
-
-    // If it's not in the cache already
-    if (cachedOrbit == nullptr)
-    {
-        double startTime = t;
-
-        // Adjust the number of samples used for aperiodic orbits--these aren't
-        // true orbits, but are sampled trajectories, generally of spacecraft.
-        // Better control is really needed--some sort of adaptive sampling would
-        // be ideal.
-        if (orbit->isPeriodic())
-        {
-            startTime = t - orbit->getPeriod();
-        }
-        else
-        {
-            double begin = 0.0, end = 0.0;
-            orbit->getValidRange(begin, end);
-
-            if (begin != end)
-            {
-                startTime = begin;
-            }
-        }
-
-        cachedOrbit = new CurvePlot(*this);
-        cachedOrbit->setLastUsed(frameCount);
-
-        OrbitSampler sampler;
-        orbit->sample(startTime,
-                      startTime + orbit->getPeriod(),
-                      sampler);
-        sampler.insertForward(cachedOrbit);
-
-        // If the orbit cache is full, first try and eliminate some old orbits
-        if (orbitCache.size() > OrbitCacheCullThreshold)
-        {
-            // Check for old orbits at most once per frame
-            if (lastOrbitCacheFlush != frameCount)
-            {
-                for (auto iter = orbitCache.begin(); iter != orbitCache.end();)
-                {
-                    // Tricky code to eliminate a node in the orbit cache without screwing
-                    // up the iterator. Should work in all STL implementations.
-                    if (frameCount - iter->second->lastUsed() > OrbitCacheRetireAge)
-                        orbitCache.erase(iter++);
-                    else
-                        ++iter;
-                }
-                lastOrbitCacheFlush = frameCount;
-            }
-        }
-
-        orbitCache[orbit] = cachedOrbit;
-    }
-
-    if (cachedOrbit->empty())
-        return;
-
     //*** Orbit rendering parameters
 
     // The 'window' is the interval of time for which the orbit will be drawn.
@@ -1163,59 +1262,37 @@ void Renderer::renderOrbit(const OrbitPathListEntry& orbitPath,
     // The default value is 0.0.
     const double LinearFadeFraction = detailOptions.linearFadeFraction;
 
-    // Extra size of the internal sample cache.
-    const double WindowSlack        = 0.2;
-
     //***
 
     // 'Periodic' orbits are generally not strictly periodic because of perturbations
-    // from other bodies. Here we update the trajectory samples to make sure that the
-    // orbit covers a time range centered at the current time and covering a full revolution.
-    if (orbit->isPeriodic())
+    // from other bodies, so their samples follow a window centered at the current
+    // time and covering a full revolution. Trajectories are drawn over the whole
+    // time range where they are valid, or over a period around the current time
+    // if they are valid at all times.
+    double period = orbit->getPeriod();
+    double windowEnd = t + period * OrbitWindowEnd;
+    double windowStart = windowEnd - period * OrbitPeriodsShown;
+    if (!orbit->isPeriodic())
     {
-        double period = orbit->getPeriod();
-        double endTime = t + period * OrbitWindowEnd;
-        double startTime = endTime - period * OrbitPeriodsShown;
-
-        double currentWindowStart = cachedOrbit->startTime();
-        double currentWindowEnd = cachedOrbit->endTime();
-        double newWindowStart = startTime - period * WindowSlack;
-        double newWindowEnd = endTime + period * WindowSlack;
+        double begin = 0.0, end = 0.0;
+        orbit->getValidRange(begin, end);
 
-        if (startTime < currentWindowStart)
+        if (begin != end)
         {
-            // Remove samples at the end of the time window
-            cachedOrbit->removeSamplesAfter(newWindowEnd);
-
-            // Trim the first sample (because it will be duplicated when we sample the orbit.)
-            cachedOrbit->removeSamplesBefore(cachedOrbit->startTime() * (1.0 + 1.0e-15));
-
-            // Add the new samples
-            OrbitSampler sampler;
-            orbit->sample(newWindowStart, min(currentWindowStart, newWindowEnd), sampler);
-            sampler.insertBackward(cachedOrbit);
-#if DEBUG_ORBIT_CACHE
-            clog << "new sample count: " << cachedOrbit->sampleCount() << endl;
-#endif
+            windowStart = begin;
+            windowEnd = end;
         }
-        else if (endTime > currentWindowEnd)
+        else
         {
-            // Remove samples at the beginning of the time window
-            cachedOrbit->removeSamplesBefore(newWindowStart);
-
-            // Trim the last sample (because it will be duplicated when we sample the orbit.)
-            cachedOrbit->removeSamplesAfter(cachedOrbit->endTime() * (1.0 - 1.0e-15));
-
-            // Add the new samples
-            OrbitSampler sampler;
-            orbit->sample(max(currentWindowEnd, newWindowStart), newWindowEnd, sampler);
-            sampler.insertForward(cachedOrbit);
-#if DEBUG_ORBIT_CACHE
-            clog << "new sample count: " << cachedOrbit->sampleCount() << endl;
-#endif
+            windowStart = t - period * 0.5;
+            windowEnd = t + period * 0.5;
         }
     }
 
+    CurvePlot* cachedOrbit = m_orbitPathCache->get(orbit, windowStart, windowEnd, frameCount);
+    if (cachedOrbit->empty())
+        return;
+
     // We perform vertex tranformations on the CPU because double precision is necessary to
     // render orbits properly. Start by computing the modelview matrix, to transform orbit
     // vertices into camera space.
@@ -1251,12 +1328,19 @@ void Renderer::renderOrbit(const OrbitPathListEntry& orbitPath,
 
     if (orbit->isPeriodic())
     {
-        double period = orbit->getPeriod();
-        double windowEnd = t + period * OrbitWindowEnd;
-        double windowStart = windowEnd - period * OrbitPeriodsShown;
         double windowDuration = windowEnd - windowStart;
 
-        if (LinearFadeFraction == 0.0f || (renderFlags & ShowFadingOrbits) == 0)
+        bool faded = LinearFadeFraction != 0.0f && (renderFlags & ShowFadingOrbits) != 0;
+        double fadeEnd = faded ? windowEnd - windowDuration * (1.0 - LinearFadeFraction) : windowStart;
+
+        // Distant orbits are drawn from samples kept on the GPU
+        if (cachedOrbit->renderFromBuffer(modelview, subdivisionThreshold, pixelSize,
+                                          windowStart, windowEnd, orbitColor,
+                                          windowStart, fadeEnd))
+        {
+            // Nothing more to draw
+        }
+        else if (!faded)
         {
             cachedOrbit->render(modelview,
                                 nearZ, farZ, viewFrustumPlaneNormals,
@@ -1272,12 +1356,20 @@ void Renderer::renderOrbit(const OrbitPathListEntry& orbitPath,
                                      windowStart, windowEnd,
                                      orbitColor,
                                      windowStart,
-                                     windowEnd - windowDuration * (1.0 - LinearFadeFraction));
+                                     fadeEnd);
         }
     }
     else
     {
-        if ((renderFlags & ShowPartialTrajectories) != 0)
+        bool partial = (renderFlags & ShowPartialTrajectories) != 0;
+        if (cachedOrbit->renderFromBuffer(modelview, subdivisionThreshold, pixelSize,
+                                          cachedOrbit->startTime(),
+                                          partial ? t : cachedOrbit->endTime(),
+                                          orbitColor, 0.0, 0.0))
+        {
+            // Nothing more to draw
+        }
+        else if (partial)
         {
             // Show the trajectory from the start time until the current simulation time
             cachedOrbit->render(modelview,
@@ -1476,17 +1568,115 @@ void Renderer::renderItem(const RenderListEntry& rle,
 }
 
 
+// Arguments of the render() call running the frame graph
+struct Renderer::FramePassState
+{
+    const Observer& observer;
+    const Universe& universe;
+    const Selection& sel;
+    const math::InfiniteFrustum& frustum;
+    const math::InfiniteFrustum& xfrustum;
+    double now;
+    bool selectionVisible{ false };
+};
+
+// Start loading the textures and the model of a body which will be seen
+// soon, in the resolution which will be used
+void Renderer::prefetchBody(const Body& body)
+{
+    auto prefetchTexture = [this](const MultiResTexture& texture)
+    {
+        ResourceHandle h = texture.tex[textureResolution];
+        if (h == InvalidResource)
+            return;
+        GetTextureManager()->prefetch(h);
+        m_prefetchTextures.push_back(h);
+    };
+
+    const Surface& surface = body.getSurface();
+    prefetchTexture(surface.baseTexture);
+    prefetchTexture(surface.nightTexture);
+    prefetchTexture(surface.bumpTexture);
+    prefetchTexture(surface.specularTexture);
+    prefetchTexture(surface.overlayTexture);
+
+    const BodyFeaturesManager* bodyFeaturesManager = GetBodyFeaturesManager();
+    if (const Atmosphere* atmosphere = bodyFeaturesManager->getAtmosphere(&body); atmosphere != nullptr)
+        prefetchTexture(atmosphere->cloudTexture);
+    if (const RingSystem* rings = bodyFeaturesManager->getRings(&body); rings != nullptr)
+        prefetchTexture(rings->texture);
+
+    GetGeometryManager()->prefetch(body.getGeometry());
+}
+
+// Once the prefetched textures are loaded, also start loading the tiles
+// of the virtual textures which are needed first
+void Renderer::updatePrefetches()
+{
+    auto* textureManager = GetTextureManager();
+    auto it = std::remove_if(m_prefetchTextures.begin(), m_prefetchTextures.end(),
+                             [textureManager](ResourceHandle h)
+                             {
+                                 switch (textureManager->getState(h))
+                                 {
+                                 case ResourceState::Loaded:
+                                     if (Texture* texture = textureManager->find(h); texture != nullptr)
+                                         texture->prefetchBaseLevel();
+                                     return true;
+                                 case ResourceState::LoadingInProgress:
+                                     return false;
+                                 default:
+                                     // Failed, or not queued with synchronous loading
+                                     return true;
+                                 }
+                             });
+    m_prefetchTextures.erase(it, m_prefetchTextures.end());
+}
+
 void Renderer::render(const Observer& observer,
                       const Universe& universe,
                       float faintestMagNight,
                       const Selection& sel)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::render");
+    StageTimer stageTimer(m_stageTiming ? &m_stageTimes : nullptr);
+
     // Get the observer's time
     double now = observer.getTime();
     realTime = observer.getRealTime();
 
     frameCount++;
     settingsChanged = false;
+    if (!m_inViewGroup)
+    {
+        startSharedGeneration();
+        util::GetUploadBudget()->beginFrame();
+        animationsDrawn = false;
+    }
+    if (std::abs(m_timeScale) < FastForwardTimeScale)
+        m_approximateOrbits.clear();
+
+    // The textures and models read on the loader threads share the upload
+    // budget of the frame with the virtual texture tiles
+    GetTextureManager()->finishLoads(*util::GetUploadBudget());
+    GetTextureManager()->nextFrame();
+    GetGeometryManager()->finishLoads(*util::GetUploadBudget());
+    GetGeometryManager()->nextFrame();
+
+    // Load the resources of the object travelled to while approaching it
+    if (Selection destination = observer.getTravelDestination(); destination.body() != nullptr)
+    {
+        if (destination.body() != m_prefetchedBody)
+        {
+            m_prefetchedBody = destination.body();
+            prefetchBody(*destination.body());
+        }
+    }
+    else
+    {
+        m_prefetchedBody = nullptr;
+    }
+    updatePrefetches();
 
     // Compute the size of a pixel
     float zoom = observer.getZoom();
@@ -1523,6 +1713,7 @@ void Renderer::render(const Observer& observer,
     foregroundAnnotations.clear();
     backgroundAnnotations.clear();
     objectAnnotations.clear();
+    m_annotationLabels.clear();
 
     // Put all solar system bodies into the render list.  Stars close and
     // large enough to have discernible surface detail are also placed in
@@ -1532,6 +1723,7 @@ void Renderer::render(const Observer& observer,
     lightSourceList.clear();
     secondaryIlluminators.clear();
     nearStars.clear();
+    std::size_t frameListCapacity = getFrameListCapacity();
 
     // See if we want to use AutoMag.
     if ((renderFlags & ShowAutoMag) != 0)
@@ -1545,12 +1737,14 @@ void Renderer::render(const Observer& observer,
     }
 
     faintestPlanetMag = faintestMag;
+    stageTimer.end(RenderStage::Setup);
     if ((renderFlags & (ShowSolarSystemObjects | ShowOrbits)) != 0)
     {
         buildNearSystemsLists(universe, observer, xfrustum, now);
     }
 
     setupSecondaryLightSources(secondaryIlluminators, lightSourceList);
+    stageTimer.end(RenderStage::NearSystems);
 
     // Scan through the render list to see if we're inside a planetary
     // atmosphere.  If so, we need to adjust the sky color as well as the
@@ -1585,86 +1779,238 @@ void Renderer::render(const Observer& observer,
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Render sky grids first--these will always be in the background
-    renderSkyGrids(observer);
-
-    // Render deep sky objects
-    if ((renderFlags & ShowDeepSpaceObjects) != 0 && universe.getDSOCatalog() != nullptr)
+    // Draw the frame with the passes which are needed
+    FramePassState frame{ observer, universe, sel, frustum, xfrustum, now };
+    m_framePass = &frame;
+    if (m_frameGraph.empty())
+        buildFrameGraph();
+    m_frameGraph.compile();
+    m_frameGraph.execute([this, &stageTimer](engine::RenderGraph::PassId pass)
     {
-        renderDeepSkyObjects(universe, observer, faintestMag);
-    }
+        stageTimer.end(m_framePassStages[pass]);
+    });
+    m_framePass = nullptr;
+
+    if (getFrameListCapacity() != frameListCapacity)
+        ++m_renderStats.frameListGrowths;
+}
 
-    // Render stars
-    if ((renderFlags & ShowStars) != 0 && universe.getStarCatalog() != nullptr)
+// The passes drawn after the render list and the lights have been set up,
+// from the background to the foreground
+void
+Renderer::buildFrameGraph()
+{
+    using engine::RenderGraph;
+
+    RenderGraph& graph = m_frameGraph;
+    RenderGraph::ResourceId frameBuffer = graph.addResource("frame buffer", true);
+    RenderGraph::ResourceId renderItems = graph.addResource("render list", false, true);
+    RenderGraph::ResourceId backgroundLabels = graph.addResource("background annotations", false, true);
+    RenderGraph::ResourceId depthSortedLabels = graph.addResource("depth sorted annotations", false, true);
+    RenderGraph::ResourceId visibleItems = graph.addResource("visible items");
+    RenderGraph::ResourceId selectionVisible = graph.addResource("selection visible");
+
+    auto addPass = [this, &graph](RenderStage stage,
+                                  std::string_view name,
+                                  std::initializer_list<RenderGraph::ResourceId> reads,
+                                  std::initializer_list<RenderGraph::ResourceId> writes,
+                                  RenderGraph::Function execute,
+                                  RenderGraph::Predicate enabled = {})
     {
-        renderPointStars(*universe.getStarCatalog(), faintestMag, observer);
-    }
+        graph.addPass(name, reads, writes, std::move(execute), std::move(enabled));
+        m_framePassStages.push_back(stage);
+    };
 
-    // Translate the camera before rendering the asterisms and boundaries
-    // Set up the camera for star rendering; the units of this phase
-    // are light years.
-    Vector3f observerPosLY = -observer.getPosition().offsetFromLy(Vector3f::Zero());
+    // Sky grids first--these will always be in the background
+    addPass(RenderStage::Setup, "sky grids", {}, { frameBuffer },
+            [this] { renderSkyGrids(m_framePass->observer); });
 
-    Matrix4f projection = getProjectionMatrix();
-    Matrix4f modelView = getModelViewMatrix() * math::translate(observerPosLY);
+    addPass(RenderStage::DeepSky, "deep sky objects", {}, { frameBuffer, backgroundLabels },
+            [this] { renderDeepSkyObjects(m_framePass->universe, m_framePass->observer, faintestMag); },
+            [this]
+            {
+                return (renderFlags & ShowDeepSpaceObjects) != 0 &&
+                       m_framePass->universe.getDSOCatalog() != nullptr;
+            });
 
-    Matrices asterismMVP = { &projection, &modelView };
+    addPass(RenderStage::Stars, "stars", {}, { frameBuffer, backgroundLabels },
+            [this]
+            {
+                const Universe& universe = m_framePass->universe;
+                renderPointStars(*universe.getStarCatalog(), universe.getPagedStarCatalog(),
+                                 faintestMag, m_framePass->observer);
+            },
+            [this]
+            {
+                return (renderFlags & ShowStars) != 0 &&
+                       m_framePass->universe.getStarCatalog() != nullptr;
+            });
+
+    // The bodies of the minor body catalogs which were not promoted
+    addPass(RenderStage::Stars, "minor bodies", {}, { frameBuffer },
+            [this] { renderMinorBodies(m_framePass->universe, m_framePass->observer, m_framePass->now); },
+            [this]
+            {
+                return (renderFlags & ShowPlanets) != 0 &&
+                       util::is_set(bodyVisibilityMask, BodyClassification::Asteroid) &&
+                       !m_framePass->universe.getMinorBodyCatalogs().empty();
+            });
 
-    float dist = observerPosLY.norm() * 1.6e4f;
-    renderAsterisms(universe, dist, asterismMVP);
-    renderBoundaries(universe, dist, asterismMVP);
+    addPass(RenderStage::Asterisms, "asterisms", {}, { frameBuffer },
+            [this]
+            {
+                // Translate the camera before rendering the asterisms and
+                // boundaries; the units of this phase are light years.
+                Vector3f observerPosLY = -m_framePass->observer.getPosition().offsetFromLy(Vector3f::Zero());
 
-    // Render star and deep sky object labels
-    renderBackgroundAnnotations(FontNormal);
+                Matrix4f projection = getProjectionMatrix();
+                Matrix4f modelView = getModelViewMatrix() * math::translate(observerPosLY);
 
-    // Render constellations labels
-    if ((labelMode & ConstellationLabels) != 0 && universe.getAsterisms() != nullptr)
-    {
-        labelConstellations(*universe.getAsterisms(), observer);
-        renderBackgroundAnnotations(FontLarge);
-    }
+                Matrices asterismMVP = { &projection, &modelView };
 
-    if ((renderFlags & ShowMarkers) != 0)
-    {
-        markersToAnnotations(universe.getMarkers(), observer, now);
-    }
+                float dist = observerPosLY.norm() * 1.6e4f;
+                renderAsterisms(m_framePass->universe, dist, asterismMVP);
+                renderBoundaries(m_framePass->universe, dist, asterismMVP);
+            });
 
-    // Draw the selection cursor
-    bool selectionVisible = false;
-    if (!sel.empty() && (renderFlags & ShowMarkers) != 0)
-    {
-        selectionVisible = selectionToAnnotation(sel, observer, xfrustum, now);
-    }
+    // Star and deep sky object labels
+    addPass(RenderStage::Annotations, "background labels", { backgroundLabels }, { frameBuffer },
+            [this] { renderBackgroundAnnotations(FontNormal); });
+
+    addPass(RenderStage::Annotations, "constellation labels", {}, { frameBuffer },
+            [this]
+            {
+                labelConstellations(*m_framePass->universe.getAsterisms(), m_framePass->observer);
+                renderBackgroundAnnotations(FontLarge);
+            },
+            [this]
+            {
+                return (labelMode & ConstellationLabels) != 0 &&
+                       m_framePass->universe.getAsterisms() != nullptr;
+            });
 
-    // Render background markers; rendering of other markers is deferred until
-    // solar system objects are rendered.
-    renderBackgroundAnnotations(FontNormal);
+    addPass(RenderStage::Annotations, "markers", {}, { backgroundLabels, depthSortedLabels },
+            [this]
+            {
+                markersToAnnotations(m_framePass->universe.getMarkers(), m_framePass->observer, m_framePass->now);
+            },
+            [this] { return (renderFlags & ShowMarkers) != 0; });
+
+    // The selection cursor
+    addPass(RenderStage::Annotations, "selection", {}, { backgroundLabels, depthSortedLabels, selectionVisible },
+            [this]
+            {
+                m_framePass->selectionVisible = selectionToAnnotation(m_framePass->sel, m_framePass->observer,
+                                                                      m_framePass->xfrustum, m_framePass->now);
+            },
+            [this] { return !m_framePass->sel.empty() && (renderFlags & ShowMarkers) != 0; });
+
+    // Background markers; the other markers are drawn with the solar
+    // system objects
+    addPass(RenderStage::Annotations, "background markers", { backgroundLabels }, { frameBuffer },
+            [this] { renderBackgroundAnnotations(FontNormal); });
+
+    addPass(RenderStage::Annotations, "visible items", { renderItems, depthSortedLabels }, { visibleItems },
+            [this]
+            {
+                removeInvisibleItems(m_framePass->frustum);
 
-    removeInvisibleItems(frustum);
+                // Sort the annotations and the orbit paths
+                std::sort(depthSortedAnnotations.begin(), depthSortedAnnotations.end());
+                std::sort(orbitPathList.begin(), orbitPathList.end());
+            });
 
-    // Sort the annotations
-    sort(depthSortedAnnotations.begin(), depthSortedAnnotations.end());
+    addPass(RenderStage::SolarSystem, "solar system objects", { visibleItems }, { frameBuffer },
+            [this]
+            {
+#ifndef GL_ES
+                glPolygonMode(GL_FRONT_AND_BACK, (GLenum) renderMode);
+#endif
+                int nIntervals = buildDepthPartitions();
+                m_renderStats.renderListEntries += renderList.size();
+                m_renderStats.depthPartitions += static_cast<std::uint64_t>(nIntervals);
+                renderSolarSystemObjects(m_framePass->observer, nIntervals, m_framePass->now);
+            });
+
+    addPass(RenderStage::Annotations, "foreground labels", { selectionVisible }, { frameBuffer },
+            [this]
+            {
+                renderForegroundAnnotations(FontNormal);
 
-    // Sort the orbit paths
-    sort(orbitPathList.begin(), orbitPathList.end());
+                if (showSelectionPointer && !m_framePass->selectionVisible && (renderFlags & ShowMarkers) != 0)
+                    renderSelectionPointer(m_framePass->observer, m_framePass->now, m_framePass->xfrustum, m_framePass->sel);
 
 #ifndef GL_ES
-    glPolygonMode(GL_FRONT_AND_BACK, (GLenum) renderMode);
+                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 #endif
+            });
+}
+
+// Sum of the capacities of the lists rebuilt for each view, in bytes. The
+// lists are only cleared, so it changes only when one of them grows.
+std::size_t
+Renderer::getFrameListCapacity() const
+{
+    return (renderList.capacity() + m_renderListScratch.capacity()) * sizeof(RenderListEntry) +
+           orbitPathList.capacity() * sizeof(OrbitPathListEntry) +
+           secondaryIlluminators.capacity() * sizeof(SecondaryIlluminator) +
+           (backgroundAnnotations.capacity() + foregroundAnnotations.capacity() +
+            depthSortedAnnotations.capacity() + objectAnnotations.capacity()) * sizeof(Annotation) +
+           m_annotationLabels.capacity();
+}
+
+void
+Renderer::setProfilingEnabled(bool enable)
+{
+    if (enable && !m_profiler.hasGPUTimestampSource() && engine::GPUTimestampQueries::isSupported())
+        m_profiler.setGPUTimestampSource(std::make_unique<engine::GPUTimestampQueries>());
+    m_profiler.setEnabled(enable);
+}
 
-    int nIntervals = buildDepthPartitions();
-    renderSolarSystemObjects(observer, nIntervals, now);
+void
+Renderer::resetRenderStats()
+{
+    m_renderStats = engine::RenderStats();
+    m_callCountersStart = gl::callCounters;
+}
 
-    renderForegroundAnnotations(FontNormal);
+engine::RenderStats
+Renderer::getRenderStats() const
+{
+    engine::RenderStats stats = m_renderStats;
+    stats.drawCalls = gl::callCounters.drawCalls - m_callCountersStart.drawCalls;
+    stats.stateChanges = gl::callCounters.stateChanges - m_callCountersStart.stateChanges;
+    stats.shaderSwitches = gl::callCounters.shaderSwitches - m_callCountersStart.shaderSwitches;
+    stats.textureUploadBytes = gl::callCounters.textureUploadBytes - m_callCountersStart.textureUploadBytes;
+    stats.textureMemory = GetTextureManager()->getMemoryUsage();
+    stats.meshMemory = GetGeometryManager()->getMemoryUsage();
+    stats.uploadsDeferred = util::GetUploadBudget()->getDeferredCount();
+    return stats;
+}
 
-    if (showSelectionPointer && !selectionVisible && (renderFlags & ShowMarkers) != 0)
+std::string_view
+Renderer::getStageName(RenderStage stage)
+{
+    switch (stage)
     {
-        renderSelectionPointer(observer, now, xfrustum, sel);
+    case RenderStage::Setup:
+        return "setup"sv;
+    case RenderStage::NearSystems:
+        return "near_systems"sv;
+    case RenderStage::DeepSky:
+        return "deep_sky"sv;
+    case RenderStage::Stars:
+        return "stars"sv;
+    case RenderStage::Asterisms:
+        return "asterisms"sv;
+    case RenderStage::Annotations:
+        return "annotations"sv;
+    case RenderStage::SolarSystem:
+        return "solar_system"sv;
+    default:
+        assert(0);
+        return {};
     }
-
-#ifndef GL_ES
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-#endif
 }
 
 static Eigen::Vector3f
@@ -1732,7 +2078,8 @@ Renderer::calculatePointSize(float appMag,
 // jarring, however . . . so we'll blend in the particle view of the
 // object to smooth things out, making it dimmer as the disc size exceeds the
 // max disc size.
-void Renderer::renderObjectAsPoint(const Vector3f& position,
+void Renderer::renderObjectAsPoint(const void* object,
+                                   const Vector3f& position,
                                    float radius,
                                    float appMag,
                                    float discSizeInPixels,
@@ -1747,6 +2094,21 @@ void Renderer::renderObjectAsPoint(const Vector3f& position,
 
     if (discSizeInPixels < maxBlendDiscSize || useHalos)
     {
+        // Skip the point and its glare when the object was hidden in the
+        // previous frame. The test is done along the line of sight through
+        // the back of the object, where it lies in this depth interval,
+        // and at the front of the interval's depth range, so that the
+        // object's own mesh doesn't hide it.
+        if (m_occlusionQueries != nullptr && !m_inViewGroup)
+        {
+            m_occlusionQueries->addTest(object,
+                                        position + position.normalized() * radius,
+                                        *mvp.projection,
+                                        currentIntervalDepth);
+            if (m_occlusionQueries->isOccluded(object))
+                return;
+        }
+
         float fade = 1.0f;
         if (discSizeInPixels > maxDiscSize)
         {
@@ -1884,6 +2246,7 @@ Renderer::locationsToAnnotations(const Body& body,
 {
     assert(GetBodyFeaturesManager()->hasLocations(&body));
     auto locations = GetBodyFeaturesManager()->getLocations(&body);
+    const celestia::engine::LocationIndex* locationIndex = GetBodyFeaturesManager()->getLocationIndex(&body);
 
     Vector3f semiAxes = body.getSemiAxes();
 
@@ -1901,21 +2264,49 @@ Renderer::locationsToAnnotations(const Body& body,
 
     Matrix3d bodyMatrix = bodyOrientation.conjugate().toRotationMatrix();
 
-    for (const auto location : *locations)
+    // Only the labels in the cap of the body seen over the horizon can pass
+    // the ellipsoid test below. The sphere of the smallest semi-axis is
+    // inside the ellipsoid, so from outside the ellipsoid a label at
+    // distance rho from the center is hidden if it is further than
+    // acos(r / distance) + acos(r / rho) from the direction of the viewer.
+    double viewerDistance = viewRayOrigin.norm();
+    double cosCapAngle = -1.0;
+    if (double minRadius = semiAxes.minCoeff(); viewerDistance > boundingRadius && minRadius > 0.0)
+    {
+        double maxLabelRadius = locationIndex->maxRadius();
+        if (!body.isEllipsoid())
+            maxLabelRadius = std::max(maxLabelRadius, boundingRadius * 1.01);
+        maxLabelRadius *= 1.0 + labelOffset;
+
+        double capAngle = std::acos(minRadius / viewerDistance)
+                        + std::acos(std::min(1.0, minRadius / maxLabelRadius));
+        if (capAngle < celestia::numbers::pi)
+            cosCapAngle = std::cos(capAngle);
+    }
+
+    // The candidates come in decreasing importance, so that the most
+    // important labels win when overlapping labels are culled
+    locationIndex->query(viewRayOrigin / viewerDistance, cosCapAngle, m_locationCandidates);
+
+    // The candidates which pass the size and facing tests are compacted to
+    // the front of the list, with their label positions in the body frame,
+    // and then all tested against the ellipsoid together
+    if (m_locationLabelPositions.rows() < static_cast<Eigen::Index>(m_locationCandidates.size()))
+    {
+        m_locationLabelPositions.resize(m_locationCandidates.size(), 3);
+        m_locationOccluded.resize(m_locationCandidates.size());
+    }
+
+    Eigen::Index labelCount = 0;
+    for (std::uint32_t candidate : m_locationCandidates)
     {
+        const Location* location = (*locations)[candidate];
         auto featureType = location->getFeatureType();
         if ((featureType & locationFilter) == 0)
             continue;
 
         // Get the position of the location with respect to the planet center
-        Vector3f ppos = location->getPosition();
-
-        // Compute the bodycentric position of the location
-        Vector3d locPos = ppos.cast<double>();
-
-        // Get the planetocentric position of the label.  Add a slight scale factor
-        // to keep the point from being exactly on the surface.
-        Vector3d pcLabelPos = locPos * (1.0 + labelOffset);
+        Vector3d locPos = location->getPosition().cast<double>();
 
         // Get the camera space label position
         Vector3d labelPos = bodyCenter + bodyMatrix * locPos;
@@ -1930,6 +2321,10 @@ Renderer::locationsToAnnotations(const Body& body,
             continue;
         }
 
+        // Get the planetocentric position of the label.  Add a slight scale factor
+        // to keep the point from being exactly on the surface.
+        Vector3d pcLabelPos = locPos * (1.0 + labelOffset);
+
         // Labels on non-ellipsoidal bodies need special handling; the
         // ellipsoid visibility test will always fail for them, since they
         // will lie on the surface of the mesh, which is inside the
@@ -1942,20 +2337,29 @@ Renderer::locationsToAnnotations(const Body& body,
                 pcLabelPos = locPos * (boundingRadius * 1.01 / r);
         }
 
-        double t = 0.0;
-
-        // Test for an intersection of the eye-to-location ray with
-        // the planet ellipsoid.  If we hit the planet first, then
-        // the label is obscured by the planet.  An exact calculation
-        // for irregular objects would be too expensive, and the
-        // ellipsoid approximation works reasonably well for them.
-        Eigen::ParametrizedLine<double, 3> testRay(viewRayOrigin, pcLabelPos - viewRayOrigin);
+        m_locationLabelPositions.row(labelCount) = pcLabelPos.transpose();
+        m_locationCandidates[labelCount] = candidate;
+        ++labelCount;
+    }
 
-        if (bool hit = testIntersection(testRay, bodyEllipsoid, t);
-            hit && t < 1.0)
-        {
+    // Test for an intersection of the eye-to-location ray with
+    // the planet ellipsoid.  If we hit the planet first, then
+    // the label is obscured by the planet.  An exact calculation
+    // for irregular objects would be too expensive, and the
+    // ellipsoid approximation works reasonably well for them.
+    math::testSegmentOcclusion<double>(viewRayOrigin,
+                                       bodyEllipsoid,
+                                       m_locationLabelPositions.topRows(labelCount),
+                                       m_locationOccluded.head(labelCount));
+
+    for (Eigen::Index i = 0; i < labelCount; ++i)
+    {
+        if (m_locationOccluded[i])
             continue;
-        }
+
+        const Location* location = (*locations)[m_locationCandidates[i]];
+        auto featureType = location->getFeatureType();
+        Vector3d labelPos = bodyCenter + bodyMatrix * location->getPosition().cast<double>();
 
         // Calculate the intersection of the eye-to-label ray with the plane perpendicular to
         // the view normal that touches the front of the object's bounding sphere
@@ -2201,6 +2605,7 @@ void Renderer::renderObject(const Vector3f& pos,
                             const Matrices &m)
 {
     RenderInfo ri;
+    ri.shaderSlot = obj.shaderSlot;
     double now = observer.getTime();
 
     float altitude = distance - obj.radius;
@@ -2221,8 +2626,14 @@ void Renderer::renderObject(const Vector3f& pos,
     Geometry* geometry = nullptr;
     if (obj.geometry != InvalidResource)
     {
-        // This is a model loaded from a file
-        geometry = engine::GetGeometryManager()->find(obj.geometry);
+        // This is a model loaded from a file. Models are loaded in the
+        // background, and the object isn't drawn until its model is ready.
+        geometry = engine::GetGeometryManager()->findAsync(obj.geometry);
+        if (geometry == nullptr &&
+            engine::GetGeometryManager()->getState(obj.geometry) == ResourceState::LoadingInProgress)
+        {
+            return;
+        }
     }
 
     // Get the textures . . .
@@ -2239,6 +2650,20 @@ void Renderer::renderObject(const Vector3f& pos,
     if ((obj.surface->appearanceFlags & Surface::ApplyOverlay) != 0)
         ri.overlayTex = obj.surface->overlayTexture.find(textureResolution);
 
+    // The observer velocity is given in the observer frame; only its
+    // component toward the object matters for loading more detail ahead.
+    if (distance > 0.0f)
+    {
+        Quaterniond frameOrientation = observer.getFrame()->convertToUniversal(Quaterniond::Identity(), now);
+        Vector3f velocity = (frameOrientation.conjugate() * observer.getVelocity()).cast<float>();
+        float approachRate = velocity.dot(pos) / (distance * distance);
+        for (Texture* tex : { ri.baseTex, ri.bumpTex, ri.nightTex, ri.glossTex, ri.overlayTex })
+        {
+            if (tex != nullptr)
+                tex->setApproachRate(approachRate);
+        }
+    }
+
     // Scaling will be nonuniform for nonspherical planets. As long as the
     // deviation from spherical isn't too large, the nonuniform scale factor
     // shouldn't mess up the lighting calculations enough to be noticeable
@@ -2397,6 +2822,14 @@ void Renderer::renderObject(const Vector3f& pos,
         {
             ResourceHandle texOverride = obj.surface->baseTexture.tex[textureResolution];
 
+            // The view frustum is in units of the radius, while the model
+            // vertices are scaled by scaleFactors
+            math::Frustum modelFrustum = viewFrustum;
+            Vector4f frustumScale;
+            frustumScale << scaleFactors.cwiseInverse() * radius, 1.0f;
+            modelFrustum.transform(Matrix4f(frustumScale.asDiagonal()));
+            ri.modelFrustum = &modelFrustum;
+
             if (lit)
             {
                 renderGeometry_GLSL(geometry,
@@ -2421,6 +2854,7 @@ void Renderer::renderObject(const Vector3f& pos,
                                           astro::daysToSecs(now - astro::J2000),
                                           planetMVP, this);
             }
+            ri.modelFrustum = nullptr;
             glActiveTexture(GL_TEXTURE0);
         }
     }
@@ -2583,6 +3017,28 @@ bool Renderer::testEclipse(const Body& receiver,
         const DirectionalLight& light = lightingState.lights[lightIndex];
         LightingState::EclipseShadowVector& shadows = *lightingState.shadows[lightIndex];
 
+        // Skip pairs which recently missed by a wide margin. All recorded
+        // misses are dropped when the time jumps.
+        if (std::abs(now - m_eclipseMissTime) > MaxEclipseMissInterval ||
+            m_eclipseMisses.size() >= MaxEclipseMisses)
+        {
+            m_eclipseMisses.clear();
+        }
+        m_eclipseMissTime = now;
+
+        EclipsePair pair{ &receiver, &caster, lightIndex };
+        Vector3d lightDirection = light.position.normalized();
+        if (auto it = m_eclipseMisses.find(pair); it != m_eclipseMisses.end())
+        {
+            const EclipseMiss& miss = it->second;
+            if (now >= miss.validFrom && now <= miss.validUntil &&
+                (lightDirection - miss.lightDirection).norm() < miss.maxLightDeviation)
+            {
+                return false;
+            }
+            m_eclipseMisses.erase(it);
+        }
+
         // All of the eclipse related code assumes that both the caster
         // and receiver are spherical.  Irregular receivers will work more
         // or less correctly, but casters that are sufficiently non-spherical
@@ -2661,7 +3117,35 @@ bool Renderer::testEclipse(const Body& receiver,
         // If the caster has a ring system, see if it casts a shadow on the receiver.
         // Ring shadows are only supported in the OpenGL 2.0 path.
         const BodyFeaturesManager* bodyFeaturesManager = GetBodyFeaturesManager();
-        if (auto rings = bodyFeaturesManager->getRings(&caster); rings != nullptr)
+        auto rings = bodyFeaturesManager->getRings(&caster);
+
+        // Distance by which the receiver misses the shadows of the caster
+        // and its rings
+        double margin = dist - R;
+        if (rings != nullptr)
+            margin = std::min(margin, dist - (rings->outerRadius + receiver.getRadius()));
+
+        if (!isReceiverShadowed && margin > 0.0)
+        {
+            // Until the bodies have moved by half the margin, the caster can't
+            // shadow the receiver. The relative velocity is extrapolated, so
+            // the interval is kept short compared to the orbital periods of
+            // the bodies of a system.
+            double speed = (caster.getVelocity(now) - receiver.getVelocity(now)).norm();
+            double interval = speed > 0.0
+                            ? std::min(MaxEclipseMissInterval, 0.5 * margin / speed)
+                            : MaxEclipseMissInterval;
+            if (interval >= MinEclipseMissInterval)
+            {
+                // A change of the light direction moves the shadow axis by
+                // the angle times the distance to the caster
+                m_eclipseMisses.try_emplace(pair, EclipseMiss{ now - interval, now + interval,
+                                                               lightDirection,
+                                                               0.25 * margin / dir.norm() });
+            }
+        }
+
+        if (rings != nullptr)
         {
             bool shadowed = false;
 
@@ -2712,6 +3196,95 @@ bool Renderer::testEclipse(const Body& receiver,
 }
 
 
+namespace
+{
+
+// Return true if the body's orbit frame at the specified time belongs to the
+// frame tree or one of its subtrees
+bool
+isInFrameTree(const Body& body, const FrameTree* tree, double tdb)
+{
+    const FrameTree* owner = body.getTimeline()->findPhase(tdb)->getFrameTree();
+    while (owner != tree)
+    {
+        if (owner->isRoot())
+            return false;
+
+        // The default frame of a body's tree is centered on the body
+        const Body* parent = owner->getDefaultReferenceFrame()->getCenter().body();
+        owner = parent->getTimeline()->findPhase(tdb)->getFrameTree();
+    }
+
+    return true;
+}
+
+} // end unnamed namespace
+
+
+// Test for eclipse shadows cast on the receiver by the bodies of a planetary
+// system. In large systems, the casters are looked up in the bounding volume
+// hierarchy of the primary's frame tree, keeping only the bodies whose
+// shadow cylinder may reach the receiver.
+void Renderer::testEclipses(const Body& receiver,
+                            const PlanetarySystem& system,
+                            LightingState& lightingState,
+                            unsigned int lightIndex,
+                            double now)
+{
+    int nBodies = system.getSystemSize();
+    const Body* primary = system.getPrimaryBody();
+    const FrameTree* tree = primary == nullptr ? nullptr : primary->getFrameTree();
+    if (nBodies < EclipseBVHMinCasters || tree == nullptr)
+    {
+        for (int i = 0; i < nBodies; i++)
+        {
+            if (const Body* caster = system.getBody(i); caster != &receiver)
+                testEclipse(receiver, *caster, lightingState, lightIndex, now);
+        }
+        return;
+    }
+
+    // Bodies of the system which orbit outside the primary's tree, such as
+    // the partner of a binary around a barycenter, aren't in the hierarchy
+    for (int i = 0; i < nBodies; i++)
+    {
+        const Body* caster = system.getBody(i);
+        if (caster != &receiver && caster->extant(now) && !isInFrameTree(*caster, tree, now))
+            testEclipse(receiver, *caster, lightingState, lightIndex, now);
+    }
+
+    const DirectionalLight& light = lightingState.lights[lightIndex];
+    Vector3d receiverPos = receiver.getAstrocentricPosition(now);
+    Vector3d lightDir = light.position.normalized();
+    double lightDistance = light.position.norm();
+    double receiverRadius = receiver.getRadius();
+
+    // A caster shadows the receiver only if it is closer to the line from
+    // the receiver to the light than the sum of the receiver radius and the
+    // shadow radius, which grows with the apparent size of the light. The
+    // last term allows for the angle between this line and the shadow axis.
+    auto test = [&](const math::Sphered& sphere)
+    {
+        Vector3d offset = sphere.center - receiverPos;
+        double farDistance = offset.norm() + sphere.radius;
+        if (farDistance >= 0.5 * lightDistance)
+            return true;
+
+        double slack = receiverRadius +
+                       light.apparentSize * farDistance +
+                       1.6 * farDistance * farDistance / lightDistance;
+        double axisDistance = (offset - offset.dot(lightDir) * lightDir).norm();
+        return axisDistance <= sphere.radius + slack;
+    };
+
+    tree->getBodyBVH(now).traverse(test, [&](const engine::BodyBVH::Entry& entry)
+    {
+        if (entry.body != &receiver && entry.body->getSystem() == &system)
+            testEclipse(receiver, *entry.body, lightingState, lightIndex, now);
+    });
+}
+
+
 void Renderer::renderPlanet(Body& body,
                             const Vector3f& pos,
                             float distance,
@@ -2748,6 +3321,7 @@ void Renderer::renderPlanet(Body& body,
         rp.geometry = body.getGeometry();
         rp.semiAxes = body.getSemiAxes() * (1.0f / rp.radius);
         rp.geometryScale = body.getGeometryScale();
+        rp.shaderSlot = &body.getShaderSlot();
 
         Quaterniond q = body.getRotationModel(now)->spin(now) *
                         body.getEclipticToEquatorial(now);
@@ -2761,7 +3335,7 @@ void Renderer::renderPlanet(Body& body,
         bool isNormalized = false;
         const Geometry* geometry = nullptr;
         if (rp.geometry != InvalidResource)
-            geometry = engine::GetGeometryManager()->find(rp.geometry);
+            geometry = engine::GetGeometryManager()->findAsync(rp.geometry);
         if (geometry == nullptr || geometry->isNormalized())
         {
             scaleFactors = rp.semiAxes * rp.radius;
@@ -2807,60 +3381,8 @@ void Renderer::renderPlanet(Body& body,
         }
 
         // Calculate eclipse circumstances
-        if ((renderFlags & ShowEclipseShadows) != 0 && body.getSystem() != nullptr)
-        {
-            if (const auto *system = body.getSystem(); system->getPrimaryBody() == nullptr)
-            {
-                // The body is a planet.  Check for eclipse shadows
-                // from all of its satellites.
-                if (const auto *satellites = body.getSatellites(); satellites != nullptr)
-                {
-                    int nSatellites = satellites->getSystemSize();
-                    for (unsigned int li = 0; li < lights.nLights; li++)
-                    {
-                        if (lights.lights[li].castsShadows)
-                        {
-                            for (int i = 0; i < nSatellites; i++)
-                            {
-                                testEclipse(body, *satellites->getBody(i), lights, li, now);
-                            }
-                        }
-                    }
-                }
-            }
-            else
-            {
-                for (unsigned int li = 0; li < lights.nLights; li++)
-                {
-                    if (lights.lights[li].castsShadows)
-                    {
-                        // The body is a moon.  Check for eclipse shadows from
-                        // the parent planet and all satellites in the system.
-                        // Traverse up the hierarchy so that any parent objects
-                        // of the parent are also considered (TODO: their child
-                        // objects will not be checked for shadows.)
-                        const Body* planet = system->getPrimaryBody();
-                        while (planet != nullptr)
-                        {
-                            testEclipse(body, *planet, lights, li, now);
-                            if (planet->getSystem() != nullptr)
-                                planet = planet->getSystem()->getPrimaryBody();
-                            else
-                                planet = nullptr;
-                        }
-
-                        int nSatellites = system->getSystemSize();
-                        for (int i = 0; i < nSatellites; i++)
-                        {
-                            if (system->getBody(i) != &body)
-                            {
-                                testEclipse(body, *system->getBody(i), lights, li, now);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        if ((renderFlags & ShowEclipseShadows) != 0)
+            computeEclipseShadows(body, lights, now);
 
         // Sort out the ring shadows; only one ring shadow source is supported right now. This means
         // that exotic cases with shadows from two ring different ring systems aren't handled.
@@ -2964,11 +3486,22 @@ void Renderer::renderPlanet(Body& body,
         }
     }
 
+    renderBodyAsPoint(body, pos, appMag, discSizeInPixels, m);
+}
+
+
+void Renderer::renderBodyAsPoint(const Body& body,
+                                 const Vector3f& pos,
+                                 float appMag,
+                                 float discSizeInPixels,
+                                 const Matrices& m)
+{
     if (body.isVisibleAsPoint())
     {
         if (float maxCoeff = body.getSurface().color.toVector3().maxCoeff(); maxCoeff > 0.0f) // ignore [ 0 0 0 ]; used by old addons to make objects not get rendered as point
         {
-            renderObjectAsPoint(pos,
+            renderObjectAsPoint(&body,
+                                pos,
                                 body.getRadius(),
                                 appMag,
                                 discSizeInPixels,
@@ -2979,7 +3512,249 @@ void Renderer::renderPlanet(Body& body,
 }
 
 
-void Renderer::renderStar(const Star& star,
+// Set up the model instance of a body. Return false for bodies which the
+// instanced shaders can't draw: those lit by several lights, in eclipse,
+// with unlit or lunar-Lambert surfaces, non-uniformly scaled or showing
+// location labels.
+bool Renderer::setupBodyInstance(const RenderListEntry& rle,
+                                 float nearPlaneDistance,
+                                 double now,
+                                 BodyInstance& instance)
+{
+    const Body& body = *rle.body;
+    float altitude = rle.distance - body.getRadius();
+    float discSizeInPixels = body.getRadius() / (max(nearPlaneDistance, altitude) * pixelSize);
+    float maxDiscSize = (starStyle == ScaledDiscStars) ? MaxScaledDiscStarSize : 1.0f;
+    if (discSizeInPixels < maxDiscSize ||
+        !body.hasVisibleGeometry() ||
+        body.getGeometry() == InvalidResource ||
+        !displayedSurface.empty())
+    {
+        return false;
+    }
+
+    const Surface& surface = body.getSurface();
+    if ((surface.appearanceFlags & Surface::Emissive) != 0 || surface.lunarLambert != 0.0f)
+        return false;
+
+    if ((labelMode & LocationLabels) != 0 && GetBodyFeaturesManager()->hasLocations(&body))
+        return false;
+
+    const Geometry* geometry = engine::GetGeometryManager()->findAsync(body.getGeometry());
+    if (geometry == nullptr)
+        return false;
+
+    float scale;
+    if (geometry->isNormalized())
+    {
+        Vector3f semiAxes = body.getSemiAxes();
+        if (semiAxes.x() != semiAxes.y() || semiAxes.x() != semiAxes.z())
+            return false;
+        scale = semiAxes.x();
+    }
+    else
+    {
+        scale = body.getGeometryScale();
+    }
+
+    Quaterniond q = body.getRotationModel(now)->spin(now) *
+                    body.getEclipticToEquatorial(now);
+    Quaternionf orientation = body.getGeometryOrientation() * q.cast<float>();
+
+    LightingState lights;
+    setupObjectLighting(lightSourceList,
+                        secondaryIlluminators,
+                        orientation,
+                        Vector3f::Constant(scale),
+                        rle.position,
+                        geometry->isNormalized(),
+                        lights);
+    if (lights.nLights != 1)
+        return false;
+
+    if ((renderFlags & ShowEclipseShadows) != 0)
+    {
+        eclipseShadows[0].clear();
+        lights.shadows[0] = &eclipseShadows[0];
+        computeEclipseShadows(body, lights, now);
+        if (!eclipseShadows[0].empty())
+            return false;
+    }
+
+    Affine3f transform = Translation3f(rle.position) * orientation.conjugate() * Scaling(scale);
+    instance.rle = &rle;
+    instance.geometry.modelView = (m_modelMatrix * transform.matrix()).topRows<3>();
+    instance.geometry.pixelSize = discSizeInPixels;
+    instance.light = lights.lights[0];
+    instance.light.direction_eye = m_modelMatrix.topLeftCorner<3, 3>() * lights.lights[0].direction_eye;
+    instance.discSizeInPixels = discSizeInPixels;
+    return true;
+}
+
+
+void Renderer::renderModelRun(const RenderListEntry* const* first,
+                              const RenderListEntry* const* last,
+                              const Observer& observer,
+                              float nearPlaneDistance,
+                              float farPlaneDistance,
+                              const Matrices& m)
+{
+    // Shadow maps are rendered for each body
+    if (static_cast<std::size_t>(last - first) < MinInstancedBodies ||
+        !gl::hasInstancing() ||
+        getShadowMapCache() != nullptr)
+    {
+        for (; first != last; ++first)
+            renderItem(**first, observer, nearPlaneDistance, farPlaneDistance, m);
+        return;
+    }
+
+    double now = observer.getTime();
+    m_bodyInstances.clear();
+    for (; first != last; ++first)
+    {
+        BodyInstance instance;
+        if (!setupBodyInstance(**first, nearPlaneDistance, now, instance))
+        {
+            renderItem(**first, observer, nearPlaneDistance, farPlaneDistance, m);
+            continue;
+        }
+
+        if (!m_bodyInstances.empty() &&
+            !(isSameMaterial(m_bodyInstances.front().rle->body->getSurface(), instance.rle->body->getSurface()) &&
+              isSimilarLight(m_bodyInstances.front().light, instance.light)))
+        {
+            flushBodyInstances(observer, nearPlaneDistance, farPlaneDistance, m);
+        }
+
+        m_bodyInstances.push_back(instance);
+    }
+
+    flushBodyInstances(observer, nearPlaneDistance, farPlaneDistance, m);
+}
+
+
+// Draw the collected instances. Like renderGeometry_GLSL(), but lit in eye
+// coordinates, as the instances only share the direction of the light there.
+void Renderer::flushBodyInstances(const Observer& observer,
+                                  float nearPlaneDistance,
+                                  float farPlaneDistance,
+                                  const Matrices& m)
+{
+    if (m_bodyInstances.empty())
+        return;
+
+    Body& body = *m_bodyInstances.front().rle->body;
+    Geometry* geometry = engine::GetGeometryManager()->findAsync(body.getGeometry());
+    bool drawn = false;
+    if (m_bodyInstances.size() >= MinInstancedBodies && geometry != nullptr)
+    {
+        m_geometryInstances.clear();
+        for (const BodyInstance& instance : m_bodyInstances)
+            m_geometryInstances.push_back(instance.geometry);
+
+        LightingState ls;
+        ls.nLights = 1;
+        ls.lights[0] = m_bodyInstances.front().light;
+        ls.lights[0].direction_obj = ls.lights[0].direction_eye;
+        ls.eyeDir_obj = Vector3f::UnitZ();
+        ls.eyePos_obj = Vector3f::Zero();
+        ls.ambientColor = ambientColor.toVector3();
+
+        Matrix4f modelView = Matrix4f::Identity();
+        GLSL_RenderContext rc(this, ls, 1.0f, Quaternionf::Identity(), &modelView, m.projection);
+        rc.setInstanceCount(static_cast<int>(m_bodyInstances.size()));
+
+        Renderer::PipelineState ps;
+        ps.depthMask = true;
+        ps.depthTest = true;
+        setPipelineState(ps);
+
+        Surface& surface = body.getSurface();
+        ResourceHandle texOverride = surface.baseTexture.tex[textureResolution];
+        if (texOverride != InvalidResource)
+        {
+            const Texture* baseTex = surface.baseTexture.find(textureResolution);
+            cmod::Material material;
+            if (baseTex == nullptr || (surface.appearanceFlags & Surface::BlendTexture) != 0)
+                material.diffuse = cmod::Color(surface.color);
+            material.specular = cmod::Color(surface.specularColor);
+            material.specularPower = surface.specularPower;
+            material.setMap(cmod::TextureSemantic::DiffuseMap, texOverride);
+            rc.setMaterial(&material);
+            rc.lock();
+            drawn = geometry->renderInstances(rc, m_geometryInstances);
+        }
+        else
+        {
+            drawn = geometry->renderInstances(rc, m_geometryInstances);
+        }
+
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    for (const BodyInstance& instance : m_bodyInstances)
+    {
+        const RenderListEntry& rle = *instance.rle;
+        if (drawn)
+            renderBodyAsPoint(*rle.body, rle.position, rle.appMag, instance.discSizeInPixels, m);
+        else
+            renderItem(rle, observer, nearPlaneDistance, farPlaneDistance, m);
+    }
+
+    m_bodyInstances.clear();
+}
+
+
+// Add the eclipse shadows cast on body to the shadow lists of the lights
+void Renderer::computeEclipseShadows(const Body& body, LightingState& lights, double now)
+{
+    const auto *system = body.getSystem();
+    if (system == nullptr)
+        return;
+
+    if (system->getPrimaryBody() == nullptr)
+    {
+        // The body is a planet.  Check for eclipse shadows
+        // from all of its satellites.
+        if (const auto *satellites = body.getSatellites(); satellites != nullptr)
+        {
+            for (unsigned int li = 0; li < lights.nLights; li++)
+            {
+                if (lights.lights[li].castsShadows)
+                    testEclipses(body, *satellites, lights, li, now);
+            }
+        }
+    }
+    else
+    {
+        for (unsigned int li = 0; li < lights.nLights; li++)
+        {
+            if (lights.lights[li].castsShadows)
+            {
+                // The body is a moon.  Check for eclipse shadows from
+                // the parent planet and all satellites in the system.
+                // Traverse up the hierarchy so that any parent objects
+                // of the parent are also considered (TODO: their child
+                // objects will not be checked for shadows.)
+                const Body* planet = system->getPrimaryBody();
+                while (planet != nullptr)
+                {
+                    testEclipse(body, *planet, lights, li, now);
+                    if (planet->getSystem() != nullptr)
+                        planet = planet->getSystem()->getPrimaryBody();
+                    else
+                        planet = nullptr;
+                }
+
+                testEclipses(body, *system, lights, li, now);
+            }
+        }
+    }
+}
+
+
+void Renderer::renderStar(const Star& star,
                           const Vector3f& pos,
                           float distance,
                           float appMag,
@@ -3045,7 +3820,8 @@ void Renderer::renderStar(const Star& star,
                      rp, LightingState(), m);
     }
 
-    renderObjectAsPoint(pos,
+    renderObjectAsPoint(&star,
+                        pos,
                         star.getRadius(),
                         appMag,
                         discSizeInPixels,
@@ -3099,6 +3875,8 @@ void Renderer::renderReferenceMark(const ReferenceMark& refMark,
 
 void Renderer::renderAsterisms(const Universe& universe, float dist, const Matrices& mvp)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::renderAsterisms");
+
     auto *asterisms = universe.getAsterisms();
 
     if ((renderFlags & ShowDiagrams) == 0 || asterisms == nullptr)
@@ -3232,7 +4010,8 @@ void Renderer::addRenderListEntries(RenderListEntry& rle,
 
         if (body.getGeometry() != InvalidResource && rle.discSizeInPixels > 1)
         {
-            const Geometry* geometry = engine::GetGeometryManager()->find(body.getGeometry());
+            // Start loading the model as soon as the body is large enough
+            const Geometry* geometry = engine::GetGeometryManager()->findAsync(body.getGeometry());
             if (geometry == nullptr)
                 rle.isOpaque = true;
             else
@@ -3290,23 +4069,55 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
     double invCosViewAngle = 1.0 / cosViewConeAngle;
     double sinViewAngle = sqrt(1.0 - math::square(cosViewConeAngle));
 
-    unsigned int nChildren = tree != nullptr ? tree->childCount() : 0;
-    for (unsigned int i = 0; i < nChildren; i++)
-    {
-        const TimelinePhase* phase = tree->getChild(i);
+    // Only the children whose phase is active now need to be processed
+    static const std::vector<unsigned int> noChildren;
+    const std::vector<unsigned int>& activeChildren = tree != nullptr ? tree->getActiveChildren(now) : noChildren;
 
-        // No need to do anything if the phase isn't active now
-        if (!phase->includes(now))
-            continue;
+    // The children of one tree usually share their orbit frame, so its
+    // orientation is only computed again when the frame changes.
+    const Vector3d* phasePositions = evaluatePhasePositions(tree, now);
+    const ReferenceFrame* orbitFrame = nullptr;
+    Quaterniond orbitFrameOrientation;
 
+    bool fastForward = std::abs(m_timeScale) >= FastForwardTimeScale;
+    double frameDistance = (frameCenter - astrocentricObserverPos).norm();
+
+    for (unsigned int i : activeChildren)
+    {
+        const TimelinePhase* phase = tree->getChild(i);
         Body* body = phase->body();
 
         // pos_s: sun-relative position of object
         // pos_v: viewer-relative position of object
 
         // Get the position of the body relative to the sun.
-        Vector3d p = phase->orbit()->positionAtTime(now);
-        Vector3d pos_s = frameCenter + phase->orbitFrame()->getOrientation(now).conjugate() * p;
+        const celestia::ephem::Orbit* orbit = phase->orbit().get();
+        bool batched = phasePositions != nullptr && orbit->isReentrant();
+        if (fastForward && !batched && body != highlightObject.body())
+        {
+            // Approximate the orbit if the body and its satellites would be
+            // too small to see even from the nearest point of the orbit
+            double size = body->getCullingRadius();
+            if (const FrameTree* bodyTree = body->getFrameTree(); bodyTree != nullptr)
+                size = std::max(size, bodyTree->boundingSphereRadius());
+            double minDistance = frameDistance - orbit->getBoundingRadius();
+            if (minDistance > 0.0 && size < minDistance * pixelSize * FastForwardMaxPixels)
+            {
+                if (const celestia::ephem::Orbit* approximateOrbit = getApproximateOrbit(phase, now);
+                    approximateOrbit != nullptr)
+                {
+                    orbit = approximateOrbit;
+                }
+            }
+        }
+
+        Vector3d p = batched ? phasePositions[i] : orbit->positionAtTime(now);
+        if (phase->orbitFrame().get() != orbitFrame)
+        {
+            orbitFrame = phase->orbitFrame().get();
+            orbitFrameOrientation = orbitFrame->getOrientation(now);
+        }
+        Vector3d pos_s = frameCenter + orbitFrameOrientation.conjugate() * p;
 
         // We now have the positions of the observer and the planet relative
         // to the sun.  From these, compute the position of the body
@@ -3500,6 +4311,163 @@ void Renderer::buildRenderLists(const Vector3d& astrocentricObserverPos,
 }
 
 
+namespace
+{
+
+// Run worker(part) for part = 0 to nThreads - 1 on the calling thread and
+// the compute pool
+template<typename F>
+void
+runOnThreads(unsigned int nThreads, const F& worker)
+{
+    util::ParallelFor(nThreads, 1, nThreads, [&worker](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t part = begin; part < end; ++part)
+            worker(static_cast<unsigned int>(part));
+    });
+}
+
+} // end unnamed namespace
+
+
+/*! For a frame tree with many children, return the orbit positions of its
+ *  children, at the index of the child. Only the orbits which may be
+ *  evaluated concurrently are computed: the elliptical orbits as a batch,
+ *  the others one by one; the rest are left to buildRenderLists(). The
+ *  largest trees are split between several threads. The positions are
+ *  shared by the views of a view group. Smaller trees are left alone, and
+ *  nullptr is returned for them.
+ */
+const Vector3d* Renderer::evaluatePhasePositions(const FrameTree* tree, double now)
+{
+    unsigned int nChildren = tree != nullptr ? tree->childCount() : 0;
+    if (nChildren < BatchBodyMinChildren)
+        return nullptr;
+
+    bool valid;
+    SharedPositions& shared = getSharedPositions(tree, nChildren, now, valid);
+    Vector3d* positions = shared.positions.data();
+    if (valid)
+        return positions;
+
+    const FrameTree::ReentrantOrbits& orbits = tree->getReentrantOrbits();
+
+    unsigned int nThreads = nChildren >= ParallelBodyMinChildren
+                          ? std::clamp(std::thread::hardware_concurrency(), 1U, MaxBodyThreads)
+                          : 1U;
+    std::size_t nBatch = orbits.elliptical.size();
+    std::size_t nOthers = orbits.others.size();
+    auto worker = [tree, &orbits, now, positions, nBatch, nOthers, nThreads](unsigned int part)
+    {
+        orbits.elliptical.positionsAtTime(now, positions,
+                                          nBatch * part / nThreads,
+                                          nBatch * (part + 1) / nThreads);
+        for (std::size_t i = nOthers * part / nThreads; i < nOthers * (part + 1) / nThreads; i++)
+        {
+            const TimelinePhase* phase = tree->getChild(orbits.others[i]);
+            if (phase->includes(now))
+                positions[orbits.others[i]] = phase->orbit()->positionAtTime(now);
+        }
+    };
+
+    runOnThreads(nThreads, worker);
+
+    return positions;
+}
+
+
+/*! Return the shared positions for key, with room for count positions.
+ *  valid is set if they were already computed for this time in the
+ *  current generation; otherwise the caller must compute them.
+ */
+Renderer::SharedPositions&
+Renderer::getSharedPositions(const void* key, std::size_t count, double now, bool& valid)
+{
+    SharedPositions& shared = m_sharedPositions[key];
+    valid = shared.generation == m_sharedGeneration && shared.tdb == now &&
+            shared.positions.size() == count;
+    if (!valid)
+    {
+        shared.tdb = now;
+        shared.generation = m_sharedGeneration;
+        shared.positions.resize(count);
+    }
+
+    return shared;
+}
+
+
+/*! Return an osculating orbit approximating the orbit of the phase at
+ *  now, fitted again when now is more than a few periods away from its
+ *  epoch. nullptr is returned for orbits which are already elliptical or
+ *  aren't periodic, and for rotating orbit frames, where an osculating
+ *  orbit is meaningless.
+ */
+const celestia::ephem::Orbit*
+Renderer::getApproximateOrbit(const TimelinePhase* phase, double now)
+{
+    const std::shared_ptr<const celestia::ephem::Orbit>& source = phase->orbit();
+    ApproximateOrbit& approximate = m_approximateOrbits[phase];
+    if (approximate.source.lock() != source)
+    {
+        const ReferenceFrame* frame = phase->orbitFrame().get();
+        approximate.source = source;
+        approximate.orbit = nullptr;
+        approximate.epoch = now;
+        if (dynamic_cast<const celestia::ephem::EllipticalOrbit*>(source.get()) != nullptr ||
+            (dynamic_cast<const J2000EclipticFrame*>(frame) == nullptr &&
+             dynamic_cast<const J2000EquatorFrame*>(frame) == nullptr))
+        {
+            return nullptr;
+        }
+
+        approximate.orbit = celestia::ephem::CreateOsculatingOrbit(*source, now);
+    }
+    else if (approximate.orbit != nullptr &&
+             std::abs(now - approximate.epoch) > FastForwardRefitPeriods * source->getPeriod())
+    {
+        approximate.orbit = celestia::ephem::CreateOsculatingOrbit(*source, now);
+        approximate.epoch = now;
+    }
+
+    return approximate.orbit.get();
+}
+
+
+/*! Invalidate the shared positions. Those which weren't used in the last
+ *  generation are freed; the others keep their storage for reuse.
+ */
+void
+Renderer::startSharedGeneration()
+{
+    for (auto it = m_sharedPositions.begin(); it != m_sharedPositions.end();)
+    {
+        if (it->second.generation != m_sharedGeneration)
+            it = m_sharedPositions.erase(it);
+        else
+            ++it;
+    }
+
+    ++m_sharedGeneration;
+}
+
+
+void
+Renderer::beginViewGroup()
+{
+    startSharedGeneration();
+    util::GetUploadBudget()->beginFrame();
+    m_inViewGroup = true;
+}
+
+
+void
+Renderer::endViewGroup()
+{
+    m_inViewGroup = false;
+}
+
+
 void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
                                const Quaterniond& observerOrientation,
                                const math::InfiniteFrustum& viewFrustum,
@@ -3509,15 +4477,12 @@ void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
     Matrix3d viewMat = observerOrientation.toRotationMatrix();
     Vector3d viewMatZ = viewMat.row(2);
 
-    unsigned int nChildren = tree != nullptr ? tree->childCount() : 0;
-    for (unsigned int i = 0; i < nChildren; i++)
+    // Only the children whose phase is active now need to be processed
+    static const std::vector<unsigned int> noChildren;
+    const std::vector<unsigned int>& activeChildren = tree != nullptr ? tree->getActiveChildren(now) : noChildren;
+    for (unsigned int i : activeChildren)
     {
         const TimelinePhase* phase = tree->getChild(i);
-
-        // No need to do anything if the phase isn't active now
-        if (!phase->includes(now))
-            continue;
-
         Body* body = phase->body();
 
         // pos_s: sun-relative position of object
@@ -3569,43 +4534,39 @@ void Renderer::buildOrbitLists(const Vector3d& astrocentricObserverPos,
         }
 
         const FrameTree* subtree = body->getFrameTree();
-        if (subtree != nullptr)
+        if (subtree != nullptr && orbitsMayBeVisible(*subtree, pos_v, viewFrustum))
         {
-            // Only try to render orbits of child objects when:
-            //   - The apparent size of the subtree bounding sphere is large enough that
-            //     orbit paths will be visible, and
-            //   - The subtree bounding sphere isn't outside the view frustum
-            double dist_v = pos_v.norm();
-            auto distanceToBoundingSphere = (float) (dist_v - subtree->boundingSphereRadius());
-            bool traverseSubtree = false;
-            if (distanceToBoundingSphere > 0.0f)
-            {
-                // We're inside the subtree's bounding sphere
-                traverseSubtree = true;
-            }
-            else
-            {
-                float maxPossibleOrbitSize = (float) subtree->boundingSphereRadius() / ((float) dist_v * pixelSize);
-                if (maxPossibleOrbitSize > minOrbitSize)
-                    traverseSubtree = true;
-            }
-
-            if (traverseSubtree)
-            {
-                // See if the object or any of its children are within the view frustum
-                if (viewFrustum.testSphere(pos_v.cast<float>(), (float) subtree->boundingSphereRadius()) != math::FrustumAspect::Outside)
-                {
-                    buildOrbitLists(astrocentricObserverPos,
-                                    observerOrientation,
-                                    viewFrustum,
-                                    subtree,
-                                    now);
-                }
-            }
-        } // end subtree traverse
+            buildOrbitLists(astrocentricObserverPos,
+                            observerOrientation,
+                            viewFrustum,
+                            subtree,
+                            now);
+        }
     }
 }
 
+/*! Return false if none of the orbits in a frame tree with its center at
+ *  center_v relative to the observer can be drawn: either they are all
+ *  smaller than minOrbitSize pixels, or the bounding sphere of the tree is
+ *  outside of the view frustum. The largest orbit in the tree and its
+ *  bounding sphere give the bound without visiting the bodies, so whole
+ *  systems of small satellites are skipped.
+ */
+bool Renderer::orbitsMayBeVisible(const FrameTree& tree,
+                                  const Vector3d& center_v,
+                                  const math::InfiniteFrustum& viewFrustum) const
+{
+    // The orbit size of a body is measured at the distance of the body,
+    // which is at least this; inside the bounding sphere any orbit may be
+    // large enough.
+    double radius = tree.boundingSphereRadius();
+    double minDistance = center_v.norm() - radius;
+    if (minDistance > 0.0 && tree.maxOrbitRadius() / (minDistance * static_cast<double>(pixelSize)) <= static_cast<double>(minOrbitSize))
+        return false;
+
+    return viewFrustum.testSphere(center_v.cast<float>(), static_cast<float>(radius)) != math::FrustumAspect::Outside;
+}
+
 
 static Color getBodyLabelColor(BodyClassification classification)
 {
@@ -3795,9 +4756,12 @@ static float calcMaxFOV(float fovY_degrees, float aspectRatio)
 
 
 void Renderer::renderPointStars(const StarDatabase& starDB,
+                                engine::PagedStarOctree* pagedStars,
                                 float faintestMagNight,
                                 const Observer& observer)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::renderPointStars");
+
 #ifndef GL_ES
     // Disable multisample rendering when drawing point stars
     bool toggleAA = (starStyle == Renderer::PointStars && isMSAAEnabled());
@@ -3830,6 +4794,7 @@ void Renderer::renderPointStars(const StarDatabase& starDB,
     starRenderer.labelThresholdMag = 1.2f * max(1.0f, (faintestMag - 4.0f) * (1.0f - 0.5f * std::log10(effDistanceToScreen)));
 
     starRenderer.colorTemp = &starColors;
+    starRenderer.staticPointStars = m_useStaticStarBuffer;
 
     gaussianDiscTex->bind();
     starRenderer.starVertexBuffer->setTexture(gaussianDiscTex);
@@ -3844,20 +4809,126 @@ void Renderer::renderPointStars(const StarDatabase& starDB,
     else
         starRenderer.starVertexBuffer->startSprites();
 
+    // Faint stars are drawn at the base size; brighter ones are bigger or
+    // have a glare, and are drawn as usual
+    if (detailOptions.starSplatting)
+        starRenderer.starVertexBuffer->startSplatting(BaseStarDiscSize * static_cast<float>(screenDpi) / 96.0f);
+
     Renderer::PipelineState ps;
     ps.blending = true;
     ps.blendFunc = {GL_SRC_ALPHA, GL_ONE};
     setPipelineState(ps);
 
-    starDB.findVisibleStars(starRenderer,
-                            obsPos.cast<float>(),
-                            getCameraOrientationf(),
-                            math::degToRad(fov),
-                            getAspectRatio(),
-                            faintestMagNight);
+    engine::OctreeTraversalStats traversalStats;
+    std::uint64_t starsDrawn = pointStarVertexBuffer->getStarsDrawn();
+    std::uint64_t starsMerged = pointStarVertexBuffer->getStarsMerged();
+
+    bool useStarCache = false;
+    if (detailOptions.distantStarCache && !m_useStaticStarBuffer)
+    {
+        if (m_distantStarCache == nullptr)
+            m_distantStarCache = std::make_unique<engine::DistantStarCache>(DistantStarCacheRadius,
+                                                                            DistantStarCacheMaxTranslation);
+
+        engine::DistantStarCache::Key key;
+        key.starDB          = &starDB;
+        key.nStars          = starDB.size();
+        key.colorTable      = starColors.type();
+        key.faintestMag     = faintestMag;
+        key.limitingMag     = faintestMagNight;
+        key.brightnessScale = brightnessScale;
+        key.brightnessBias  = brightnessBias;
+        key.saturationMag   = satPoint;
+        key.baseSize        = BaseStarDiscSize * static_cast<float>(screenDpi) / 96.0f;
+        key.distanceLimit   = distanceLimit;
+        key.scaledDiscs     = starStyle == ScaledDiscStars;
+
+        std::uint64_t rebuilds = m_distantStarCache->getRebuildCount();
+        useStarCache = m_distantStarCache->update(starDB, starRenderer, obsPos, key, &traversalStats);
+        m_renderStats.starCacheRebuilds += m_distantStarCache->getRebuildCount() - rebuilds;
+    }
+
+    unsigned int nThreads = starDB.size() >= ParallelPointStarMinStars
+                          ? std::min(std::thread::hardware_concurrency(), MaxPointStarThreads)
+                          : 1U;
+    if (useStarCache)
+    {
+        m_distantStarCache->findNearStars(starDB, starRenderer, obsPos, faintestMagNight);
+        if ((labelMode & StarLabels) != 0)
+        {
+            // Only the labels of the cached stars are needed, so the search
+            // is limited to the label threshold
+            m_distantStarCache->findDistantStars(starDB,
+                                                 starRenderer,
+                                                 obsPos,
+                                                 getCameraOrientationf(),
+                                                 math::degToRad(fov),
+                                                 getAspectRatio(),
+                                                 std::min(faintestMagNight, starRenderer.labelThresholdMag),
+                                                 &traversalStats);
+        }
+        m_distantStarCache->render(*pointStarVertexBuffer, *glareVertexBuffer, obsPos);
+    }
+    else if (nThreads > 1)
+    {
+        while (m_starStagingHandlers.size() < nThreads)
+            m_starStagingHandlers.push_back(std::make_unique<PointStarStagingHandler>());
 
+        std::vector<StarRecordHandler*> workerHandlers;
+        workerHandlers.reserve(nThreads);
+        for (unsigned int i = 0; i < nThreads; ++i)
+        {
+            m_starStagingHandlers[i]->starRenderer = &starRenderer;
+            workerHandlers.push_back(m_starStagingHandlers[i].get());
+        }
+
+        starDB.findVisibleStarRecords(starRenderer,
+                                      workerHandlers,
+                                      obsPos.cast<float>(),
+                                      getCameraOrientationf(),
+                                      math::degToRad(fov),
+                                      getAspectRatio(),
+                                      faintestMagNight,
+                                      &traversalStats);
+
+        for (unsigned int i = 0; i < nThreads; ++i)
+            m_starStagingHandlers[i]->finish();
+    }
+    else
+    {
+        starDB.findVisibleStarRecords(starRenderer,
+                                      obsPos.cast<float>(),
+                                      getCameraOrientationf(),
+                                      math::degToRad(fov),
+                                      getAspectRatio(),
+                                      faintestMagNight,
+                                      &m_starVisibilityCache,
+                                      &traversalStats);
+    }
+
+    if (pagedStars != nullptr)
+    {
+        pagedStars->findVisibleStars(starRenderer,
+                                     obsPos.cast<float>(),
+                                     getCameraOrientationf(),
+                                     math::degToRad(fov),
+                                     getAspectRatio(),
+                                     faintestMagNight);
+    }
+
+    starRenderer.starVertexBuffer->endSplatting();
     starRenderer.starVertexBuffer->finish();
     starRenderer.glareVertexBuffer->finish();
+
+    if (m_useStaticStarBuffer)
+        renderStaticStars(starDB, faintestMagNight, obsPos);
+
+    m_renderStats.starNodesVisited += traversalStats.nodesVisited;
+    m_renderStats.starNodesAccepted += traversalStats.nodesAccepted;
+    m_renderStats.starsProcessed += traversalStats.objectsProcessed;
+    m_renderStats.starsDrawn += pointStarVertexBuffer->getStarsDrawn() - starsDrawn;
+    m_renderStats.starsMerged += pointStarVertexBuffer->getStarsMerged() - starsMerged;
+
     PointStarVertexBuffer::disable();
 
 #ifndef GL_ES
@@ -3866,10 +4937,156 @@ void Renderer::renderPointStars(const StarDatabase& starDB,
 #endif
 }
 
+/*! Draw the bodies of the minor body catalogs as points, with the star
+ *  vertex buffers. Their positions are computed by the orbit batch of each
+ *  catalog, and their brightness from the absolute magnitude and the
+ *  distances to the center star and the observer, ignoring the phase. The
+ *  points are drawn in the star pass, scaled to one light year along their
+ *  direction, so they don't occlude planets. Catalogs are skipped when the
+ *  observer is farther from their star than the solar system size.
+ */
+void Renderer::renderMinorBodies(const Universe& universe,
+                                 const Observer& observer,
+                                 double now)
+{
+    Vector3f viewNormal = getCameraOrientationf().conjugate() * -Vector3f::UnitZ();
+    double maxDistance = astro::lightYearsToKilometers(static_cast<double>(SolarSystemMaxDistance));
+    double auSquared = math::square(astro::KM_PER_AU<double>);
+    float pointScale = BaseStarDiscSize * static_cast<float>(getScreenDpi()) / 96.0f;
+
+    pointStarVertexBuffer->setTexture(gaussianDiscTex);
+    pointStarVertexBuffer->setPointScale(screenDpi / 96.0f);
+    glareVertexBuffer->setTexture(gaussianGlareTex);
+    glareVertexBuffer->setPointScale(screenDpi / 96.0f);
+
+    PointStarVertexBuffer::enable();
+    glareVertexBuffer->startSprites();
+    if (starStyle == PointStars)
+        pointStarVertexBuffer->startBasicPoints();
+    else
+        pointStarVertexBuffer->startSprites();
+
+    Renderer::PipelineState ps;
+    ps.blending = true;
+    ps.blendFunc = {GL_SRC_ALPHA, GL_ONE};
+    setPipelineState(ps);
+
+    for (const auto& catalog : universe.getMinorBodyCatalogs())
+    {
+        // Observer position relative to the center star
+        Vector3d obsPos = observer.getPosition().offsetFromKm(catalog->getCenter()->getPosition(now));
+        if (obsPos.norm() > maxDistance)
+            continue;
+
+        const ephem::EllipticalOrbitBatch& orbits = catalog->getOrbits();
+        std::size_t nBodies = orbits.size();
+        bool valid;
+        SharedPositions& shared = getSharedPositions(catalog.get(), nBodies, now, valid);
+        if (!valid)
+        {
+            unsigned int nThreads = nBodies >= ParallelBodyMinChildren
+                                  ? std::clamp(std::thread::hardware_concurrency(), 1U, MaxBodyThreads)
+                                  : 1U;
+            runOnThreads(nThreads, [&orbits, now, nBodies, nThreads, data = shared.positions.data()](unsigned int part)
+            {
+                orbits.positionsAtTime(now, data, nBodies * part / nThreads, nBodies * (part + 1) / nThreads);
+            });
+        }
+        const std::vector<Vector3d>& positions = shared.positions;
+
+        for (std::size_t i = 0; i < nBodies; i++)
+        {
+            auto index = static_cast<std::uint32_t>(i);
+            const Vector3d& pos_s = positions[i];
+            Vector3d pos_v = pos_s - obsPos;
+            double distance = pos_v.norm();
+            if (distance <= 0.0)
+                continue;
+
+            Vector3f direction = (pos_v / distance).cast<float>();
+            if (direction.dot(viewNormal) <= 0.0f)
+                continue;
+
+            auto appMag = static_cast<float>(catalog->getAbsoluteMagnitude(index)
+                                             + 5.0 * std::log10(pos_s.norm() * distance / auSquared));
+            if (appMag > faintestPlanetMag || catalog->getBody(index) != nullptr)
+                continue;
+
+            float pointSize, alpha, glareSize, glareAlpha;
+            calculatePointSize(appMag, pointScale, pointSize, alpha, glareSize, glareAlpha);
+            if (glareSize != 0.0f)
+                glareVertexBuffer->addStar(direction, Color(MinorBodyColor, glareAlpha), glareSize);
+            if (pointSize != 0.0f)
+                pointStarVertexBuffer->addStar(direction, Color(MinorBodyColor, alpha), pointSize);
+        }
+    }
+
+    pointStarVertexBuffer->finish();
+    glareVertexBuffer->finish();
+    PointStarVertexBuffer::disable();
+}
+
+void Renderer::renderStaticStars(const StarDatabase& starDB,
+                                 float faintestMagNight,
+                                 const Vector3d& obsPos)
+{
+    if (m_staticStarRenderer == nullptr)
+        m_staticStarRenderer = std::make_unique<StaticStarRenderer>(*this);
+
+    m_staticStarRanges.clear();
+    starDB.findVisibleStarRanges(m_staticStarRanges,
+                                 obsPos.cast<float>(),
+                                 getCameraOrientationf(),
+                                 math::degToRad(fov),
+                                 getAspectRatio(),
+                                 faintestMagNight);
+
+    StaticStarRenderer::Settings settings;
+    settings.obsPosition     = obsPos;
+    settings.faintestMag     = faintestMag;
+    settings.limitingMag     = faintestMagNight;
+    settings.brightnessScale = brightnessScale;
+    settings.brightnessBias  = brightnessBias;
+    settings.saturationMag   = satPoint;
+    settings.baseSize        = BaseStarDiscSize * static_cast<float>(screenDpi) / 96.0f;
+    settings.pointScale      = static_cast<float>(screenDpi) / 96.0f;
+    settings.minDistance     = SolarSystemMaxDistance;
+    settings.maxDistance     = distanceLimit;
+    settings.scaledDiscs     = starStyle == ScaledDiscStars;
+    settings.basicPoints     = starStyle == PointStars;
+    settings.starTexture     = gaussianDiscTex;
+    settings.glareTexture    = gaussianGlareTex;
+
+    m_staticStarRenderer->render(starDB, starColors, m_staticStarRanges, settings);
+
+    if (m_starPickBuffer != nullptr)
+    {
+        if (m_starPickBuffer->poll())
+        {
+            const auto& result = *m_starPickBuffer->getResult();
+            Star* star = result.starIndex.has_value() ? starDB.getStar(*result.starIndex) : nullptr;
+            m_starPick = StarPick{ result.x, result.y, star };
+        }
+
+        m_starPickBuffer->render(*this, *m_staticStarRenderer, starDB, starColors, m_staticStarRanges, settings);
+
+        // Restore the state of renderPointStars
+        Renderer::PipelineState ps;
+        ps.blending = true;
+        ps.blendFunc = {GL_SRC_ALPHA, GL_ONE};
+        setPipelineState(ps);
+    }
+
+    for (const auto& [first, last] : m_staticStarRanges)
+        m_renderStats.starsDrawn += last - first;
+}
+
 void Renderer::renderDeepSkyObjects(const Universe& universe,
                                     const Observer& observer,
                                     const float     faintestMagNight)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::renderDeepSkyObjects");
+
     DSORenderer dsoRenderer;
 
     auto cameraOrientation = getCameraOrientationf();
@@ -3915,12 +5132,53 @@ void Renderer::renderDeepSkyObjects(const Universe& universe,
     openClusterRep = MarkerRepresentation(MarkerRepresentation::Circle,   8.0f, OpenClusterLabelColor);
     globularRep    = MarkerRepresentation(MarkerRepresentation::Circle,   8.0f, GlobularLabelColor);
 
-    dsoDB->findVisibleDSOs(dsoRenderer,
-                           obsPos,
-                           cameraOrientation,
-                           math::degToRad(fov),
-                           getAspectRatio(),
-                           2 * faintestMagNight);
+    engine::OctreeTraversalStats traversalStats;
+    unsigned int nThreads = dsoDB->size() >= ParallelDSOMinObjects
+                          ? std::min(std::thread::hardware_concurrency(), MaxDSOThreads)
+                          : 1U;
+    if (nThreads > 1)
+    {
+        while (m_dsoStagingHandlers.size() < nThreads)
+            m_dsoStagingHandlers.push_back(std::make_unique<DSOStagingHandler>());
+
+        std::vector<engine::DSOHandler*> workerHandlers;
+        workerHandlers.reserve(nThreads);
+        for (unsigned int i = 0; i < nThreads; ++i)
+        {
+            m_dsoStagingHandlers[i]->dsoRenderer = &dsoRenderer;
+            workerHandlers.push_back(m_dsoStagingHandlers[i].get());
+        }
+
+        dsoDB->findVisibleDSOs(dsoRenderer,
+                               workerHandlers,
+                               obsPos,
+                               cameraOrientation,
+                               math::degToRad(fov),
+                               getAspectRatio(),
+                               2 * faintestMagNight,
+                               &traversalStats);
+
+        for (unsigned int i = 0; i < nThreads; ++i)
+            m_dsoStagingHandlers[i]->finish();
+    }
+    else
+    {
+        dsoDB->findVisibleDSOs(dsoRenderer,
+                               obsPos,
+                               cameraOrientation,
+                               math::degToRad(fov),
+                               getAspectRatio(),
+                               2 * faintestMagNight,
+                               &traversalStats);
+    }
+
+    m_renderStats.dsoNodesVisited += traversalStats.nodesVisited;
+    m_renderStats.dsoNodesAccepted += traversalStats.nodesAccepted;
+    m_renderStats.dsosProcessed += traversalStats.objectsProcessed;
+    m_renderStats.galaxiesDrawn += dsoRenderer.galaxiesDrawn;
+    m_renderStats.globularsDrawn += dsoRenderer.globularsDrawn;
+    m_renderStats.nebulaeDrawn += dsoRenderer.nebulaeDrawn;
+    m_renderStats.openClustersDrawn += dsoRenderer.openClustersDrawn;
 
     m_galaxyRenderer->render();
     m_globularRenderer->render();
@@ -4076,7 +5334,10 @@ Renderer::renderAnnotationMarker(const Annotation &a,
     Matrices mm = { m.projection, &mv };
 
     if (markerRep.symbol() == celestia::MarkerRepresentation::Crosshair)
+    {
         renderCrosshair(size, realTime, a.color, mm);
+        animationsDrawn = true;
+    }
     else
         markerRep.render(*this, size, mm);
 
@@ -4097,29 +5358,37 @@ Renderer::renderAnnotationMarker(const Annotation &a,
 
 void
 Renderer::renderAnnotationLabel(const Annotation &a,
-                                TextLayout &layout,
-                                float hOffset,
-                                float vOffset,
-                                float depth,
-                                const Matrices &m)
-{
-    glVertexAttrib(CelestiaGLProgram::ColorAttributeIndex, a.color);
-
-    Matrix4f mv = math::translate(*m.modelview,
-                                     std::trunc(a.position.x()) + hOffset + PixelOffset,
-                                     std::trunc(a.position.y()) + vOffset + PixelOffset,
-                                     depth);
-
-    layout.begin(*m.projection, mv);
-    layout.moveAbsolute(0.0f, 0.0f);
-    layout.render(a.labelText);
-    layout.end();
+                                engine::LabelBatch &batch,
+                                const TextureFont *font,
+                                float depth)
+{
+    TextLayout::HorizontalAlignment alignment = TextLayout::HorizontalAlignment::Left;
+    float hOffset = 0.0f;
+    float vOffset = 0.0f;
+
+    getLabelAlignmentInfo(a, font, alignment, hOffset, vOffset);
+
+    if (batch.add(a.labelText,
+                  alignment,
+                  a.color,
+                  std::trunc(a.position.x()) + hOffset + PixelOffset,
+                  std::trunc(a.position.y()) + vOffset + PixelOffset,
+                  depth))
+    {
+        ++m_renderStats.labelsDrawn;
+    }
+    else
+    {
+        ++m_renderStats.labelsCulled;
+    }
 }
 
 // stars and constellations. DSOs
 void Renderer::renderAnnotations(const vector<Annotation>& annotations,
                                  FontStyle fs)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::renderAnnotations");
+
     auto font = getFont(fs);
     if (font == nullptr)
         return;
@@ -4130,6 +5399,12 @@ void Renderer::renderAnnotations(const vector<Annotation>& annotations,
     Matrix4f mv = Matrix4f::Identity();
     Matrices m = { &m_orthoProjMatrix, &mv };
 
+    // Markers are drawn as they come, the labels are collected and drawn
+    // together afterwards
+    engine::LabelBatch &batch = *m_labelBatches[fs];
+    batch.begin(font, frameCount, detailOptions.labelOverlapCulling,
+                static_cast<float>(windowWidth), static_cast<float>(windowHeight));
+
     for (const auto &annotation : annotations)
     {
         if (annotation.markerRep != nullptr)
@@ -4139,16 +5414,11 @@ void Renderer::renderAnnotations(const vector<Annotation>& annotations,
 
         if (!annotation.labelText.empty())
         {
-            TextLayout::HorizontalAlignment alignment = TextLayout::HorizontalAlignment::Left;
-            float hOffset = 0.0f;
-            float vOffset = 0.0f;
-
-            getLabelAlignmentInfo(annotation, font.get(), alignment, hOffset, vOffset);
-
-            layout.setHorizontalAlignment(alignment);
-            renderAnnotationLabel(annotation, layout, hOffset, vOffset, 0.0f, m);
+            renderAnnotationLabel(annotation, batch, font.get(), 0.0f);
         }
     }
+
+    batch.end(m_orthoProjMatrix);
 }
 
 
@@ -4224,6 +5494,10 @@ Renderer::renderAnnotations(vector<Annotation>::iterator startIter,
     // projection matrix in order to get the label text position exactly right but need to mimic
     // the depth coordinate generation of a projection.
 
+    engine::LabelBatch &batch = *m_labelBatches[fs];
+    batch.begin(font, frameCount, detailOptions.labelOverlapCulling,
+                static_cast<float>(windowWidth), static_cast<float>(windowHeight));
+
     vector<Annotation>::iterator iter = startIter;
     for (; iter != endIter && iter->position.z() > nearDist; ++iter)
     {
@@ -4238,17 +5512,12 @@ Renderer::renderAnnotations(vector<Annotation>::iterator startIter,
 
         if (!iter->labelText.empty())
         {
-            TextLayout::HorizontalAlignment alignment = TextLayout::HorizontalAlignment::Left;
-            float labelHOffset = 0.0f;
-            float labelVOffset = 0.0f;
-
-            getLabelAlignmentInfo(*iter, font.get(), alignment, labelHOffset, labelVOffset);
-
-            layout.setHorizontalAlignment(alignment);
-            renderAnnotationLabel(*iter, layout, labelHOffset, labelVOffset, ndc_z, m);
+            renderAnnotationLabel(*iter, batch, font.get(), ndc_z);
         }
     }
 
+    batch.end(m_orthoProjMatrix);
+
     return iter;
 }
 
@@ -4363,7 +5632,7 @@ void Renderer::loadTextures(Body* body)
 
 void Renderer::invalidateOrbitCache()
 {
-    orbitCache.clear();
+    m_orbitPathCache->clear();
 }
 
 
@@ -4433,6 +5702,51 @@ void Renderer::setSolarSystemMaxDistance(float t)
     SolarSystemMaxDistance = std::clamp(t, 1.0f, 10.0f);
 }
 
+void Renderer::setStaticStarBuffer(bool enable)
+{
+    m_useStaticStarBuffer = enable;
+    if (!enable)
+    {
+        m_staticStarRenderer = nullptr;
+        m_starPickBuffer = nullptr;
+        m_starPick.reset();
+    }
+    else
+    {
+        // The distant stars are drawn from the static star buffer instead
+        m_distantStarCache = nullptr;
+    }
+}
+
+bool Renderer::getStaticStarBuffer() const
+{
+    return m_useStaticStarBuffer;
+}
+
+bool Renderer::requestStarPick(int x, int y)
+{
+    if (!detailOptions.gpuStarPicking || !m_useStaticStarBuffer)
+        return false;
+
+    if (m_starPickBuffer == nullptr)
+        m_starPickBuffer = std::make_unique<StarPickBuffer>();
+    m_starPickBuffer->request(x, y);
+    return true;
+}
+
+bool Renderer::hasPendingStarPick() const
+{
+    // The reads are only collected while the stars are drawn
+    return m_starPickBuffer != nullptr
+        && m_starPickBuffer->hasPending()
+        && (renderFlags & ShowStars) != 0;
+}
+
+void Renderer::setTimeScale(double timeScale)
+{
+    m_timeScale = timeScale;
+}
+
 
 void Renderer::getViewport(int* x, int* y, int* w, int* h) const
 {
@@ -4623,7 +5937,7 @@ static void draw_rectangle_solid(const Renderer &renderer,
     if (vbo == 0u)
         glGenBuffers(1, &vbo);
 
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    gl::Binder::get().bind(gl::Buffer::wrap(vbo));
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(RectVtx), vertices.data(), GL_STREAM_DRAW);
 
     glEnableVertexAttribArray(CelestiaGLProgram::VertexCoordAttributeIndex);
@@ -4647,6 +5961,7 @@ static void draw_rectangle_solid(const Renderer &renderer,
     prog->use();
     prog->setMVPMatrices(p, m);
 
+    ++gl::callCounters.drawCalls;
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 
     glDisableVertexAttribArray(CelestiaGLProgram::ColorAttributeIndex);
@@ -4654,7 +5969,7 @@ static void draw_rectangle_solid(const Renderer &renderer,
         glDisableVertexAttribArray(CelestiaGLProgram::TextureCoord0AttributeIndex);
     if (r.hasColors)
         glDisableVertexAttribArray(CelestiaGLProgram::VertexCoordAttributeIndex);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    gl::Binder::get().unbind(gl::Buffer::TargetHint::Array);
 }
 
 void Renderer::drawRectangle(const celestia::Rect &r,
@@ -4765,6 +6080,21 @@ bool Renderer::getInfo(map<string, string>& info) const
         info["MaxAnisotropy"] = fmt::format("{:.2f}", maxAnisotropy);
     }
 
+    // Memory held by the resource managers; see their memory budgets
+    const TextureManager* textureManager = GetTextureManager();
+    info["TextureMemory"] = fmt::format("{:.1f}", static_cast<double>(textureManager->getMemoryUsage()) / (1024.0 * 1024.0));
+    info["TexturesLoaded"] = to_string(textureManager->getLoadedCount());
+    const GeometryManager* geometryManager = GetGeometryManager();
+    info["ModelMemory"] = fmt::format("{:.1f}", static_cast<double>(geometryManager->getMemoryUsage()) / (1024.0 * 1024.0));
+    info["ModelsLoaded"] = to_string(geometryManager->getLoadedCount());
+
+    // Counters of the frame, with keys such as FrameDrawCalls
+    getRenderStats().forEach([&info](std::string_view name, std::uint64_t value)
+    {
+        auto initial = static_cast<char>(std::toupper(static_cast<unsigned char>(name.front())));
+        info[fmt::format("Frame{}{}", initial, name.substr(1))] = to_string(value);
+    });
+
 #if 0 // we don't use cubemaps yet
     GLint maxCubeMapSize = 0;
     glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &maxCubeMapSize);
@@ -4778,45 +6108,36 @@ bool Renderer::getInfo(map<string, string>& info) const
     return true;
 }
 
-FramebufferObject*
-Renderer::getShadowFBO(int index) const
+engine::ShadowMapCache*
+Renderer::getShadowMapCache() const
 {
-    return index == 0 ? m_shadowFBO.get() : nullptr;
-}
-
-void
-Renderer::createShadowFBO()
-{
-    m_shadowFBO = std::make_unique<FramebufferObject>(m_shadowMapSize,
-                                                      m_shadowMapSize,
-                                                      FramebufferObject::DepthAttachment);
-    if (!m_shadowFBO->isValid())
-    {
-        GetLogger()->warn("Error creating shadow FBO.\n");
-        m_shadowFBO = nullptr;
-    }
+    return m_shadowMapCache.get();
 }
 
 void
 Renderer::setShadowMapSize(unsigned size)
 {
     m_shadowMapSize = std::min(size, static_cast<unsigned>(gl::maxTextureSize));
-    if (m_shadowFBO != nullptr && m_shadowMapSize == m_shadowFBO->width())
+    if (m_shadowMapCache != nullptr && m_shadowMapSize == m_shadowMapCache->size())
         return;
     if (m_shadowMapSize == 0)
-        m_shadowFBO = nullptr;
+        m_shadowMapCache = nullptr;
     else
-        createShadowFBO();
+        m_shadowMapCache = std::make_unique<engine::ShadowMapCache>(m_shadowMapSize);
 }
 
 void
 Renderer::removeInvisibleItems(const math::InfiniteFrustum &frustum)
 {
-    // Remove objects from the render list that lie completely outside the
-    // view frustum.
-    auto notCulled = renderList.begin();
     const BodyFeaturesManager* bodyFeaturesManager = GetBodyFeaturesManager();
-    for (auto &ri : renderList)
+    Matrix3f cameraMatrix = getCameraOrientationf().toRotationMatrix();
+    float maxSpan = hypot((float) windowWidth, (float) windowHeight);
+    float nearZcoeff = cos(math::degToRad(fov / 2.0f)) * ((float) windowHeight / maxSpan);
+
+    // Return false if the object lies completely outside the view frustum,
+    // otherwise compute its depth range. Only the entry is written, so the
+    // entries may be tested on several threads.
+    auto isVisible = [&](RenderListEntry& ri)
     {
         bool convex = true;
         float radius = 1.0f;
@@ -4861,65 +6182,74 @@ Renderer::removeInvisibleItems(const math::InfiniteFrustum &frustum)
             break;
         }
 
-        Vector3f center = getCameraOrientationf().toRotationMatrix() * ri.position;
+        Vector3f center = cameraMatrix * ri.position;
         // Test the object's bounding sphere against the view frustum
-        if (frustum.testSphere(center, cullRadius) != math::FrustumAspect::Outside)
+        if (frustum.testSphere(center, cullRadius) == math::FrustumAspect::Outside)
+            return false;
+
+        float nearZ = center.norm() - radius;
+        nearZ = -nearZ * nearZcoeff;
+
+        if (nearZ > -MinNearPlaneDistance)
+            ri.nearZ = -max(MinNearPlaneDistance, radius / 2000.0f);
+        else
+            ri.nearZ = nearZ;
+
+        if (!convex)
         {
-            float nearZ = center.norm() - radius;
-            float maxSpan = hypot((float) windowWidth, (float) windowHeight);
-            float nearZcoeff = cos(math::degToRad(fov / 2.0f)) * ((float) windowHeight / maxSpan);
-            nearZ = -nearZ * nearZcoeff;
+            ri.farZ = center.z() - radius;
+            if (ri.farZ / ri.nearZ > MaxFarNearRatio * 0.5f)
+                ri.nearZ = ri.farZ / (MaxFarNearRatio * 0.5f);
+        }
+        else
+        {
+            // Make the far plane as close as possible
+            float d = center.norm();
 
-            if (nearZ > -MinNearPlaneDistance)
-                ri.nearZ = -max(MinNearPlaneDistance, radius / 2000.0f);
-            else
-                ri.nearZ = nearZ;
+            // Account for ellipsoidal objects
+            float eradius = radius;
+            if (ri.renderableType == RenderListEntry::RenderableBody)
+            {
+                float minSemiAxis = ri.body->getSemiAxes().minCoeff();
+                eradius *= minSemiAxis / radius;
+            }
 
-            if (!convex)
+            if (d > eradius)
             {
-                ri.farZ = center.z() - radius;
-                if (ri.farZ / ri.nearZ > MaxFarNearRatio * 0.5f)
-                    ri.nearZ = ri.farZ / (MaxFarNearRatio * 0.5f);
+                ri.farZ = ri.centerZ - ri.radius;
             }
             else
             {
-                // Make the far plane as close as possible
-                float d = center.norm();
-
-                // Account for ellipsoidal objects
-                float eradius = radius;
-                if (ri.renderableType == RenderListEntry::RenderableBody)
-                {
-                    float minSemiAxis = ri.body->getSemiAxes().minCoeff();
-                    eradius *= minSemiAxis / radius;
-                }
-
-                if (d > eradius)
-                {
-                    ri.farZ = ri.centerZ - ri.radius;
-                }
-                else
-                {
-                    // We're inside the bounding sphere (and, if the planet
-                    // is spherical, inside the planet.)
-                    ri.farZ = ri.nearZ * 2.0f;
-                }
+                // We're inside the bounding sphere (and, if the planet
+                // is spherical, inside the planet.)
+                ri.farZ = ri.nearZ * 2.0f;
+            }
 
-                if (cloudHeight > 0.0f)
-                {
-                    // If there's a cloud layer, we need to move the
-                    // far plane out so that the clouds aren't clipped
-                    float cloudLayerRadius = eradius + cloudHeight;
-                    ri.farZ -= sqrt(math::square(cloudLayerRadius) - math::square(eradius));
-                }
+            if (cloudHeight > 0.0f)
+            {
+                // If there's a cloud layer, we need to move the
+                // far plane out so that the clouds aren't clipped
+                float cloudLayerRadius = eradius + cloudHeight;
+                ri.farZ -= sqrt(math::square(cloudLayerRadius) - math::square(eradius));
             }
+        }
 
-            *notCulled = ri;
-            notCulled++;
+        return true;
+    };
+
+    // Remove the invisible objects from the range, keeping the order of the
+    // others; return the new end of the range
+    auto cull = [&isVisible](auto first, auto last)
+    {
+        auto notCulled = first;
+        for (auto iter = first; iter != last; ++iter)
+        {
+            if (isVisible(*iter))
+                *notCulled++ = *iter;
         }
-    }
 
-    renderList.resize(notCulled - renderList.begin());
+        return notCulled;
+    };
 
     // The calls to buildRenderLists/renderStars filled renderList
     // with visible bodies.  Sort it front to back, then
@@ -4927,7 +6257,65 @@ Renderer::removeInvisibleItems(const math::InfiniteFrustum &frustum)
     // ideal for performance; should render opaque objects front to
     // back, then translucent objects back to front. However, the
     // amount of overdraw in Celestia is typically low.)
-    sort(renderList.begin(), renderList.end());
+    std::size_t count = renderList.size();
+    unsigned int nThreads = count >= ParallelCullMinEntries
+                          ? std::clamp(std::thread::hardware_concurrency(), 1U, MaxCullThreads)
+                          : 1U;
+    if (nThreads == 1)
+    {
+        renderList.erase(cull(renderList.begin(), renderList.end()), renderList.end());
+        sort(renderList.begin(), renderList.end());
+        return;
+    }
+
+    // Each thread culls and sorts its part of the list in place
+    std::array<std::size_t, MaxCullThreads + 1> runs;
+    std::array<std::size_t, MaxCullThreads> runEnds;
+    RenderListEntry* entries = renderList.data();
+    runOnThreads(nThreads, [&](unsigned int part)
+    {
+        RenderListEntry* first = entries + count * part / nThreads;
+        RenderListEntry* last = cull(first, entries + count * (part + 1) / nThreads);
+        std::sort(first, last);
+        runEnds[part] = static_cast<std::size_t>(last - entries);
+    });
+
+    // Gather the sorted runs at the start of the list
+    runs[0] = 0;
+    for (unsigned int part = 0; part < nThreads; ++part)
+    {
+        std::size_t first = count * part / nThreads;
+        std::size_t runSize = runEnds[part] - first;
+        if (first != runs[part])
+            std::copy(entries + first, entries + runEnds[part], entries + runs[part]);
+        runs[part + 1] = runs[part] + runSize;
+    }
+    renderList.resize(runs[nThreads]);
+
+    // Merge pairs of runs until a single one is left, alternating between
+    // the list and the scratch list. The culled list is short, so the
+    // merges are cheaper on this thread than handed to the pool.
+    m_renderListScratch.resize(renderList.size());
+    for (unsigned int nRuns = nThreads; nRuns > 1; nRuns = (nRuns + 1) / 2)
+    {
+        const RenderListEntry* src = renderList.data();
+        RenderListEntry* dst = m_renderListScratch.data();
+        for (unsigned int pair = 0; pair < nRuns / 2; ++pair)
+        {
+            std::size_t first = runs[2 * pair];
+            std::size_t middle = runs[2 * pair + 1];
+            std::size_t last = runs[2 * pair + 2];
+            std::merge(src + first, src + middle, src + middle, src + last, dst + first);
+        }
+
+        if (nRuns % 2 != 0)
+            std::copy(src + runs[nRuns - 1], src + runs[nRuns], dst + runs[nRuns - 1]);
+        for (unsigned int run = 0; run <= nRuns / 2; ++run)
+            runs[run] = runs[std::min(2 * run, nRuns)];
+        if (nRuns % 2 != 0)
+            runs[(nRuns + 1) / 2] = runs[nRuns];
+        renderList.swap(m_renderListScratch);
+    }
 }
 
 bool
@@ -5031,6 +6419,8 @@ Renderer::buildNearSystemsLists(const Universe &universe,
                                 const math::InfiniteFrustum &xfrustum,
                                 double now)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::buildNearSystemsLists");
+
     UniversalCoord observerPos = observer.getPosition();
     Eigen::Quaterniond observerOrient = getCameraOrientation();
 
@@ -5073,12 +6463,17 @@ Renderer::buildNearSystemsLists(const Universe &universe,
         // Compute the position of the observer in astrocentric coordinates
         Vector3d astrocentricObserverPos = astrocentricPosition(observerPos, *sun, now);
 
-        // Build render lists for bodies and orbits paths
-        buildRenderLists(astrocentricObserverPos, xfrustum,
-                         observerOrient.conjugate() * -Vector3d::UnitZ(),
-                         Vector3d::Zero(), solarSysTree, observer, now);
-        if ((renderFlags & ShowOrbits) != 0)
+        // Build render lists for bodies and orbits paths; the zones are
+        // around the calls, as both recurse into the frame tree
+        {
+            CELESTIA_PROFILE_ZONE("Renderer::buildRenderLists");
+            buildRenderLists(astrocentricObserverPos, xfrustum,
+                             observerOrient.conjugate() * -Vector3d::UnitZ(),
+                             Vector3d::Zero(), solarSysTree, observer, now);
+        }
+        if ((renderFlags & ShowOrbits) != 0 && orbitsMayBeVisible(*solarSysTree, -astrocentricObserverPos, xfrustum))
         {
+            CELESTIA_PROFILE_ZONE("Renderer::buildOrbitLists");
             buildOrbitLists(astrocentricObserverPos, observerOrient,
                             xfrustum, solarSysTree, now);
         }
@@ -5226,8 +6621,30 @@ Renderer::buildDepthPartitions()
     }
 
     // We want to avoid overpartitioning the depth buffer. In this stage, we
-    // coalesce partitions that have small spans in the depth buffer.
-    // TODO: Implement this step!
+    // coalesce partitions that have small spans in the depth buffer. Every
+    // interval is a separate pass over the orbits, stars and annotations.
+    // Merging keeps the intervals contiguous, so the render list entries
+    // still fall into them in order.
+    int nCoalesced = 0;
+    for (i = 1; i < nIntervals; i++)
+    {
+        DepthBufferPartition& current = depthPartitions[nCoalesced];
+        const DepthBufferPartition& next = depthPartitions[i];
+        if (next.nearZ < 0.0f && current.farZ / next.nearZ <= MaxCoalescedFarNearRatio)
+        {
+            current.nearZ = next.nearZ;
+        }
+        else
+        {
+            nCoalesced++;
+            depthPartitions[nCoalesced] = next;
+            depthPartitions[nCoalesced].index = nCoalesced;
+        }
+    }
+
+    nIntervals = nCoalesced + 1;
+    depthPartitions.resize(nIntervals);
+
     return nIntervals;
 }
 
@@ -5236,13 +6653,21 @@ Renderer::renderSolarSystemObjects(const Observer &observer,
                                    int nIntervals,
                                    double now)
 {
+    CELESTIA_PROFILE_ZONE("Renderer::renderSolarSystemObjects");
+
     // Render everything that wasn't culled.
     auto annotation = depthSortedAnnotations.begin();
     float intervalSize = 1.0f / static_cast<float>(max(1, nIntervals));
     int i = static_cast<int>(renderList.size()) - 1;
+
+    bool useOcclusionQueries = m_occlusionQueries != nullptr && !m_inViewGroup;
+    if (useOcclusionQueries)
+        m_occlusionQueries->beginFrame();
+
     for (int interval = 0; interval < nIntervals; interval++)
     {
         currentIntervalIndex = interval;
+        currentIntervalDepth = 1.0f - (interval + 1) * intervalSize;
         beginObjectAnnotations();
 
         const float nearPlaneDistance = -depthPartitions[interval].nearZ;
@@ -5264,6 +6689,7 @@ Renderer::renderSolarSystemObjects(const Observer &observer,
         int firstInInterval = i;
 
         // Render just the opaque objects in the first pass
+        opaqueRenderList.clear();
         while (i >= 0 && renderList[i].farZ < depthPartitions[interval].nearZ)
         {
             // This interval should completely contain the item
@@ -5273,14 +6699,44 @@ Renderer::renderSolarSystemObjects(const Observer &observer,
             // Treat objects that are smaller than one pixel as transparent and
             // render them in the second pass.
             if (renderList[i].isOpaque && renderList[i].discSizeInPixels > 1.0f)
-                renderItem(renderList[i], observer, nearPlaneDistance, farPlaneDistance, m);
+                opaqueRenderList.push_back(&renderList[i]);
 
             i--;
         }
 
+        // Group the bodies sharing a model or texture to avoid switching
+        // programs and textures between them; the others follow in depth
+        // order.
+        auto unsortable = std::stable_partition(opaqueRenderList.begin(), opaqueRenderList.end(),
+                                                [](const RenderListEntry* rle) { return isStateSortable(*rle); });
+        std::stable_sort(opaqueRenderList.begin(), unsortable,
+                         [this](const RenderListEntry* a, const RenderListEntry* b)
+                         {
+                             return stateSortKey(*a, textureResolution) < stateSortKey(*b, textureResolution);
+                         });
+
+        // Runs of bodies sharing a model may be drawn instanced
+        for (auto it = opaqueRenderList.begin(); it != opaqueRenderList.end();)
+        {
+            auto runEnd = it + 1;
+            if (it < unsortable && (*it)->body->getGeometry() != InvalidResource)
+            {
+                auto key = stateSortKey(**it, textureResolution);
+                runEnd = std::find_if(runEnd, unsortable,
+                                      [this, &key](const RenderListEntry* rle)
+                                      {
+                                          return stateSortKey(*rle, textureResolution) != key;
+                                      });
+            }
+
+            renderModelRun(&*it, &*it + (runEnd - it), observer, nearPlaneDistance, farPlaneDistance, m);
+            it = runEnd;
+        }
+
         // Render orbit paths
         if (!orbitPathList.empty())
         {
+            CELESTIA_PROFILE_ZONE("Renderer::renderOrbits");
             math::Frustum intervalFrustum = projectionMode->getFrustum(nearPlaneDistance, farPlaneDistance, observer.getZoom());
 
             // Scan through the list of orbits and render any that overlap this interval
@@ -5339,6 +6795,10 @@ Renderer::renderSolarSystemObjects(const Observer &observer,
         endObjectAnnotations();
     }
 
+    // Test the points drawn in the frame against all of it
+    if (useOcclusionQueries)
+        m_occlusionQueries->runTests(m_modelMatrix);
+
     // reset the depth range
     glDepthRange(0, 1);
     setDefaultProjectionMatrix();
@@ -5353,11 +6813,13 @@ Renderer::setPipelineState(const Renderer::PipelineState &ps) noexcept
             glEnable(GL_BLEND);
         else
             glDisable(GL_BLEND);
+        ++gl::callCounters.stateChanges;
         m_pipelineState.blending = ps.blending;
     }
     if (ps.blending && (ps.blendFunc.src != m_pipelineState.blendFunc.src || ps.blendFunc.dst != m_pipelineState.blendFunc.dst))
     {
         glBlendFuncSeparate(ps.blendFunc.src, ps.blendFunc.dst, GL_ZERO, GL_ONE);
+        ++gl::callCounters.stateChanges;
         m_pipelineState.blendFunc = ps.blendFunc;
     }
     if (ps.depthTest != m_pipelineState.depthTest)
@@ -5366,11 +6828,13 @@ Renderer::setPipelineState(const Renderer::PipelineState &ps) noexcept
             glEnable(GL_DEPTH_TEST);
         else
             glDisable(GL_DEPTH_TEST);
+        ++gl::callCounters.stateChanges;
         m_pipelineState.depthTest = ps.depthTest;
     }
     if (ps.depthMask != m_pipelineState.depthMask)
     {
         glDepthMask(ps.depthMask ? GL_TRUE : GL_FALSE);
+        ++gl::callCounters.stateChanges;
         m_pipelineState.depthMask = ps.depthMask;
     }
     if (ps.smoothLines != m_pipelineState.smoothLines)
@@ -5380,6 +6844,7 @@ Renderer::setPipelineState(const Renderer::PipelineState &ps) noexcept
             glEnable(GL_LINE_SMOOTH);
         else
             glDisable(GL_LINE_SMOOTH);
+        ++gl::callCounters.stateChanges;
 #endif
         m_pipelineState.smoothLines = ps.smoothLines;
     }
@@ -10,15 +10,22 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <Eigen/Core>
 
 #include <celengine/body.h>
+#include <celengine/geometry.h>
 #include <celengine/lightenv.h>
 #include <celengine/universe.h>
 #include <celengine/selection.h>
@@ -26,27 +33,44 @@
 #include <celengine/starcolors.h>
 #include <celengine/projectionmode.h>
 #include <celengine/rendcontext.h>
+#include <celengine/rendergraph.h>
 #include <celengine/renderlistentry.h>
+#include <celengine/renderstats.h>
 #include <celengine/textlayout.h>
 #include <celrender/rendererfwd.h>
+#include <celrender/gl/callcounters.h>
+#include <celutil/profiler.h>
+#include <celutil/stringpool.h>
 
 class RendererWatcher;
 class FrameTree;
 class ReferenceMark;
 class CurvePlot;
 class PointStarVertexBuffer;
+class PointStarStagingHandler;
+class DSOStagingHandler;
 class Observer;
 class Surface;
 class TextureFont;
-class FramebufferObject;
 
 namespace celestia
 {
 class Rect;
 
+namespace engine
+{
+class DistantStarCache;
+class LabelBatch;
+class OcclusionQueries;
+class OrbitPathCache;
+class PagedStarOctree;
+class ShadowMapCache;
+}
+
 namespace gl
 {
 class Buffer;
+class StreamBuffer;
 class VertexObject;
 }
 
@@ -119,6 +143,18 @@ class Renderer
         double orbitWindowEnd{ 0.5 };
         double orbitPeriodsShown{ 1.0 };
         double linearFadeFraction{ 0.0 };
+        bool labelOverlapCulling{ false };
+        bool distanceFieldFonts{ false };
+        // Pick the point stars of the static star buffer on the graphics
+        // card, see requestStarPick()
+        bool gpuStarPicking{ false };
+        // Merge the faint point stars which cover the same pixels, for
+        // dense star fields
+        bool starSplatting{ false };
+        // Draw the point stars far from the observer from vertices kept
+        // while it stays in the same region and the magnitude settings
+        // don't change, instead of finding them each frame
+        bool distantStarCache{ false };
 #ifndef GL_ES
         bool useMesaPackInvert{ true };
 #endif
@@ -254,11 +290,14 @@ class Renderer
     void setMinimumOrbitSize(float);
     float getMinimumFeatureSize() const;
     void setMinimumFeatureSize(float);
+    float getGalaxyDetail() const;
+    void setGalaxyDetail(float);
     float getDistanceLimit() const;
     void setDistanceLimit(float);
     BodyClassification getOrbitMask() const;
     void setOrbitMask(BodyClassification);
     int getScreenDpi() const;
+    bool getDistanceFieldFonts() const { return detailOptions.distanceFieldFonts; }
     void setScreenDpi(int);
     int getWindowWidth() const;
     int getWindowHeight() const;
@@ -295,9 +334,44 @@ class Renderer
     [[deprecated]] void setVideoSync(bool);
     void setSolarSystemMaxDistance(float);
     void setShadowMapSize(unsigned);
+    // Keep the star catalog in a static vertex buffer, culling the point
+    // stars in the vertex shader instead of streaming them each frame.
+    void setStaticStarBuffer(bool);
+    bool getStaticStarBuffer() const;
+
+    struct StarPick
+    {
+        // Window position of the request, lower left origin
+        int x;
+        int y;
+        // Star nearest to the position, or null if there was none
+        Star* star;
+    };
+
+    // Pick the star of the static star buffer under the window position
+    // x, y, lower left origin, while the next frame is drawn; the result
+    // arrives a few frames later. Returns false unless the static star
+    // buffer and the gpuStarPicking detail option are enabled.
+    bool requestStarPick(int x, int y);
+    // Return true while the pixels of a star pick are being read back
+    bool hasPendingStarPick() const;
+    // Result of the most recent completed star pick
+    const std::optional<StarPick>& getStarPick() const { return m_starPick; }
 
     bool captureFrame(int, int, int, int, celestia::engine::PixelFormat format, unsigned char*) const;
 
+    // Simulation seconds per real second, zero when the time is paused. At
+    // very high rates the bodies too small to see are placed on osculating
+    // orbits which are only refitted now and then.
+    void setTimeScale(double);
+
+    // Render the following views, such as the views of a split window,
+    // for the same time: the positions of orbits and catalog bodies, which
+    // don't depend on the view, are computed for the first view and reused
+    // by the others until endViewGroup().
+    void beginViewGroup();
+    void endViewGroup();
+
     void renderMarker(celestia::MarkerRepresentation::Symbol symbol,
                       float size,
                       const Color &color,
@@ -381,7 +455,8 @@ class Renderer
 
     struct Annotation
     {
-        std::string labelText;
+        // Copy stored in m_annotationLabels, valid until the next view
+        std::string_view labelText;
         const celestia::MarkerRepresentation* markerRep;
         Color color;
         Eigen::Vector3f position;
@@ -415,6 +490,8 @@ class Renderer
                              float size = 0.0f);
 
     ShaderManager& getShaderManager() const { return *shaderManager; }
+    // Buffer for vertices which are drawn once, shared by the renderers
+    celestia::gl::StreamBuffer& getStreamBuffer() const { return *m_streamBuffer; }
 
     // Callbacks for renderables; these belong in a special renderer interface
     // only visible in object's render methods.
@@ -458,13 +535,49 @@ class Renderer
     std::shared_ptr<TextureFont> getFont(FontStyle) const;
 
     bool settingsHaveChanged() const;
+    // The last frame drew something which changes with the real time, like
+    // the pulsing selection cursor
+    bool hasAnimations() const { return animationsDrawn; }
     void markSettingsChanged();
 
     void addWatcher(RendererWatcher*);
     void removeWatcher(RendererWatcher*);
     void notifyWatchers() const;
 
-    FramebufferObject* getShadowFBO(int) const;
+    celestia::engine::ShadowMapCache* getShadowMapCache() const;
+    std::uint32_t getFrameCount() const { return frameCount; }
+
+    // Stages of render() whose CPU time can be measured, e.g. by benchmarks
+    enum class RenderStage
+    {
+        Setup,
+        NearSystems,
+        DeepSky,
+        Stars,
+        Asterisms,
+        Annotations,
+        SolarSystem,
+    };
+    static constexpr std::size_t RenderStageCount = 7;
+    using StageTimes = std::array<double, RenderStageCount>;
+
+    static std::string_view getStageName(RenderStage);
+    // The times, in seconds, are summed over the views drawn since the last
+    // call of resetStageTimes(), and only while stage timing is enabled.
+    void setStageTimingEnabled(bool enabled) { m_stageTiming = enabled; }
+    const StageTimes& getStageTimes() const { return m_stageTimes; }
+    void resetStageTimes() { m_stageTimes.fill(0.0); }
+
+    // Zones of the frames between beginFrame() and endFrame() of the
+    // profiler, with GPU times where timer queries are supported
+    void setProfilingEnabled(bool);
+    celestia::util::Profiler& getProfiler() { return m_profiler; }
+    const celestia::util::Profiler& getProfiler() const { return m_profiler; }
+
+    // Counters of the work done to draw the views since the last call of
+    // resetRenderStats(), which CelestiaCore makes at the start of a frame
+    void resetRenderStats();
+    celestia::engine::RenderStats getRenderStats() const;
 
  public:
     struct RenderProperties
@@ -478,6 +591,7 @@ class Renderer
         ResourceHandle geometry{ InvalidResource };
         Eigen::Quaternionf orientation{ Eigen::Quaternionf::Identity() };
         LightingState::EclipseShadowVector* eclipseShadows;
+        ShaderSlot* shaderSlot{ nullptr };
     };
 
     struct DepthBufferPartition
@@ -490,8 +604,15 @@ class Renderer
  private:
     void setFieldOfView(float);
     void renderPointStars(const StarDatabase& starDB,
+                          celestia::engine::PagedStarOctree* pagedStars,
                           float faintestVisible,
                           const Observer& observer);
+    void renderMinorBodies(const Universe& universe,
+                           const Observer& observer,
+                           double now);
+    void renderStaticStars(const StarDatabase& starDB,
+                           float faintestMagNight,
+                           const Eigen::Vector3d& obsPos);
     void renderDeepSkyObjects(const Universe&,
                               const Observer&,
                               float faintestMagNight);
@@ -517,14 +638,19 @@ class Renderer
                           const FrameTree* tree,
                           const Observer& observer,
                           double now);
+    const Eigen::Vector3d* evaluatePhasePositions(const FrameTree* tree, double now);
     void buildOrbitLists(const Eigen::Vector3d& astrocentricObserverPos,
                          const Eigen::Quaterniond& observerOrientation,
                          const celestia::math::InfiniteFrustum& viewFrustum,
                          const FrameTree* tree,
                          double now);
+    bool orbitsMayBeVisible(const FrameTree& tree,
+                            const Eigen::Vector3d& center_v,
+                            const celestia::math::InfiniteFrustum& viewFrustum) const;
     void buildLabelLists(const celestia::math::InfiniteFrustum& viewFrustum,
                          double now);
     int buildDepthPartitions();
+    std::size_t getFrameListCapacity() const;
 
 
     void addRenderListEntries(RenderListEntry& rle,
@@ -537,6 +663,12 @@ class Renderer
 
     void removeInvisibleItems(const celestia::math::InfiniteFrustum &frustum);
 
+    void prefetchBody(const Body& body);
+    void updatePrefetches();
+
+    struct FramePassState;
+    void buildFrameGraph();
+
     void renderObject(const Eigen::Vector3f& pos,
                       float distance,
                       const Observer& observer,
@@ -554,6 +686,42 @@ class Renderer
                       float, float,
                       const Matrices&);
 
+    void renderBodyAsPoint(const Body& body,
+                           const Eigen::Vector3f& pos,
+                           float appMag,
+                           float discSizeInPixels,
+                           const Matrices&);
+
+    void computeEclipseShadows(const Body& body, LightingState& lights, double now);
+
+    // A body drawn as one of the instances of its model
+    struct BodyInstance
+    {
+        const RenderListEntry* rle;
+        GeometryInstance geometry;
+        // The brightest light, with its direction in eye coordinates
+        DirectionalLight light;
+        float discSizeInPixels;
+    };
+
+    bool setupBodyInstance(const RenderListEntry& rle,
+                           float nearPlaneDistance,
+                           double now,
+                           BodyInstance& instance);
+
+    // Render opaque render list entries which share a model and surface
+    // texture, drawing those which allow it instanced
+    void renderModelRun(const RenderListEntry* const* first,
+                        const RenderListEntry* const* last,
+                        const Observer& observer,
+                        float nearPlaneDistance,
+                        float farPlaneDistance,
+                        const Matrices&);
+    void flushBodyInstances(const Observer& observer,
+                            float nearPlaneDistance,
+                            float farPlaneDistance,
+                            const Matrices&);
+
     void renderStar(const Star& star,
                     const Eigen::Vector3f& pos,
                     float distance,
@@ -583,7 +751,8 @@ class Renderer
                             float &glareSize,
                             float &glareAlpha) const;
 
-    void renderObjectAsPoint(const Eigen::Vector3f& center,
+    void renderObjectAsPoint(const void* object,
+                             const Eigen::Vector3f& center,
                              float radius,
                              float appMag,
                              float discSizeInPixels,
@@ -608,6 +777,11 @@ class Renderer
                      LightingState& lightingState,
                      unsigned int lightIndex,
                      double now);
+    void testEclipses(const Body& receiver,
+                      const PlanetarySystem& system,
+                      LightingState& lightingState,
+                      unsigned int lightIndex,
+                      double now);
 
     void labelConstellations(const AsterismList& asterisms,
                              const Observer& observer);
@@ -628,11 +802,9 @@ class Renderer
                                 float depth,
                                 const Matrices&);
     void renderAnnotationLabel(const Annotation &a,
-                               celestia::engine::TextLayout &layout,
-                               float hOffset,
-                               float vOffset,
-                               float depth,
-                               const Matrices&);
+                               celestia::engine::LabelBatch &batch,
+                               const TextureFont *font,
+                               float depth);
     void renderAnnotations(const std::vector<Annotation>&,
                            FontStyle fs);
     void renderBackgroundAnnotations(FontStyle fs);
@@ -673,8 +845,6 @@ class Renderer
 
     void updateBodyVisibilityMask();
 
-    void createShadowFBO();
-
  private:
     ShaderManager* shaderManager{ nullptr };
 
@@ -714,7 +884,59 @@ class Renderer
     Eigen::Matrix3d m_cameraTransform{ Eigen::Matrix3d::Identity() };
     PointStarVertexBuffer* pointStarVertexBuffer;
     PointStarVertexBuffer* glareVertexBuffer;
+    // Per-thread state of the parallel point star traversal
+    std::vector<std::unique_ptr<PointStarStagingHandler>> m_starStagingHandlers;
+    // Vertices of the distant point stars, see DetailOptions::distantStarCache
+    std::unique_ptr<celestia::engine::DistantStarCache> m_distantStarCache;
+    // Per-thread state of the parallel deep sky object traversal
+    std::vector<std::unique_ptr<DSOStagingHandler>> m_dsoStagingHandlers;
+    // Positions computed for one time which don't depend on the view: the
+    // orbit positions of the children of large frame trees and the
+    // positions of the bodies of minor body catalogs. Within a view group
+    // they are computed once and shared by all views; otherwise each call
+    // to render() starts a new generation.
+    struct SharedPositions
+    {
+        double tdb;
+        std::uint32_t generation;
+        std::vector<Eigen::Vector3d> positions;
+    };
+
+    SharedPositions& getSharedPositions(const void* key, std::size_t count, double now, bool& valid);
+    void startSharedGeneration();
+
+    std::unordered_map<const void*, SharedPositions> m_sharedPositions;
+    // Osculating orbits approximating the orbits of phases at high time
+    // scales, fitted at epoch. The orbit is null when the phase can't be
+    // approximated.
+    struct ApproximateOrbit
+    {
+        std::weak_ptr<const celestia::ephem::Orbit> source;
+        std::unique_ptr<celestia::ephem::Orbit> orbit;
+        double epoch;
+    };
+
+    const celestia::ephem::Orbit* getApproximateOrbit(const TimelinePhase* phase, double now);
+
+    std::unordered_map<const TimelinePhase*, ApproximateOrbit> m_approximateOrbits;
+    double m_timeScale{ 1.0 };
+    std::uint32_t m_sharedGeneration{ 0 };
+    bool m_inViewGroup{ false };
+    bool m_stageTiming{ false };
+    StageTimes m_stageTimes{};
+    celestia::util::Profiler m_profiler;
+    celestia::engine::RenderStats m_renderStats{};
+    celestia::gl::CallCounters m_callCountersStart{};
+    // Visible star octree nodes of the serial point star search
+    celestia::engine::StarOctreeVisibilityCache m_starVisibilityCache;
     std::vector<RenderListEntry> renderList;
+    // Destination of the merges of the render list sorted on several threads
+    std::vector<RenderListEntry> m_renderListScratch;
+    // Opaque entries of the depth interval being rendered
+    std::vector<const RenderListEntry*> opaqueRenderList;
+    // Bodies of the batch of instances being collected
+    std::vector<BodyInstance> m_bodyInstances;
+    std::vector<GeometryInstance> m_geometryInstances;
     std::vector<SecondaryIlluminator> secondaryIlluminators;
     std::vector<DepthBufferPartition> depthPartitions;
     std::vector<Annotation> backgroundAnnotations;
@@ -722,7 +944,59 @@ class Renderer
     std::vector<Annotation> depthSortedAnnotations;
     std::vector<Annotation> objectAnnotations;
     std::vector<OrbitPathListEntry> orbitPathList;
+    // Text of the annotations of the view being rendered; cleared at the
+    // start of each view, keeping its storage, as the lists above
+    celestia::util::StringPool m_annotationLabels;
+    // Passes drawing a view, built on the first one, with the stage each
+    // is timed in, and the arguments of the view being drawn
+    celestia::engine::RenderGraph m_frameGraph;
+    std::vector<RenderStage> m_framePassStages;
+    FramePassState* m_framePass{ nullptr };
+    // Destination of the goto whose resources were prefetched; only
+    // compared, as the body may have been removed since
+    const Body* m_prefetchedBody{ nullptr };
+    // Prefetched textures whose base tiles are loaded once they are
+    std::vector<ResourceHandle> m_prefetchTextures;
     LightingState::EclipseShadowVector eclipseShadows[MaxLights];
+
+    // Receiver, caster and light index of an eclipse test
+    struct EclipsePair
+    {
+        const Body* receiver;
+        const Body* caster;
+        unsigned int lightIndex;
+
+        friend bool operator==(const EclipsePair& lhs, const EclipsePair& rhs) noexcept
+        {
+            return lhs.receiver == rhs.receiver && lhs.caster == rhs.caster && lhs.lightIndex == rhs.lightIndex;
+        }
+    };
+
+    struct EclipsePairHasher
+    {
+        std::size_t operator()(const EclipsePair& pair) const noexcept
+        {
+            std::size_t seed = std::hash<const Body*>{}(pair.receiver);
+            seed ^= std::hash<const Body*>{}(pair.caster) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            seed ^= std::hash<unsigned int>{}(pair.lightIndex) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    // An eclipse test which failed by a wide margin. The pair isn't tested
+    // again while the time is within the interval and the light direction
+    // is within the deviation, as the bodies can't move far enough to
+    // produce a shadow before then.
+    struct EclipseMiss
+    {
+        double validFrom;
+        double validUntil;
+        Eigen::Vector3d lightDirection;
+        double maxLightDeviation;
+    };
+
+    std::unordered_map<EclipsePair, EclipseMiss, EclipsePairHasher> m_eclipseMisses;
+    double m_eclipseMissTime{ 0.0 };
     std::vector<const Star*> nearStars;
 
     std::vector<LightSource> lightSourceList;
@@ -741,14 +1015,13 @@ class Renderer
     uint32_t frameCount;
 
     int currentIntervalIndex{ 0 };
+    // Window depth of the front of the current depth interval
+    float currentIntervalDepth{ 0.0f };
 
     PipelineState m_pipelineState;
 
     std::array<int, 4> m_viewport { 0, 0, 0, 0 };
 
-    typedef std::map<const celestia::ephem::Orbit*, CurvePlot*> OrbitCache;
-    OrbitCache orbitCache;
-    uint32_t lastOrbitCacheFlush;
 
     float minOrbitSize;
     float distanceLimit;
@@ -761,6 +1034,7 @@ class Renderer
     Selection highlightObject;
 
     bool settingsChanged;
+    bool animationsDrawn{ false };
 
     // True if we're in between a begin/endObjectAnnotations
     bool objectAnnotationSetOpen;
@@ -774,10 +1048,15 @@ class Renderer
 
     // Size of a texture used in shadow mapping
     unsigned m_shadowMapSize { 0 };
-    std::unique_ptr<FramebufferObject> m_shadowFBO;
+    std::unique_ptr<celestia::engine::ShadowMapCache> m_shadowMapCache;
+
+    // Visibility tests of the objects drawn as points, used to skip their
+    // points and glare while they're behind other bodies
+    std::unique_ptr<celestia::engine::OcclusionQueries> m_occlusionQueries;
 
     std::unique_ptr<celestia::gl::VertexObject> m_markerVO;
     std::unique_ptr<celestia::gl::Buffer> m_markerBO;
+    std::unique_ptr<celestia::gl::StreamBuffer> m_streamBuffer;
     bool m_markerDataInitialized{ false };
 
     // Saturation magnitude used to calculate a point star size
@@ -794,8 +1073,20 @@ class Renderer
     std::unique_ptr<celestia::render::LineRenderer> m_hollowMarkerRenderer;
     std::unique_ptr<celestia::render::NebulaRenderer> m_nebulaRenderer;
     std::unique_ptr<celestia::render::OpenClusterRenderer> m_openClusterRenderer;
+    std::unique_ptr<celestia::engine::OrbitPathCache> m_orbitPathCache;
+    std::vector<std::unique_ptr<celestia::engine::LabelBatch>> m_labelBatches;
     std::unique_ptr<celestia::render::RingRenderer> m_ringRenderer;
     std::unique_ptr<celestia::render::SkyGridRenderer> m_skyGridRenderer;
+    std::unique_ptr<celestia::render::StaticStarRenderer> m_staticStarRenderer;
+    bool m_useStaticStarBuffer{ false };
+    std::vector<celestia::engine::StarOctreeVisibleRangesProcessor::RangeType> m_staticStarRanges;
+    std::unique_ptr<celestia::render::StarPickBuffer> m_starPickBuffer;
+    std::optional<StarPick> m_starPick;
+    // Indices of the locations of a body that may be visible, and the label
+    // positions of those tested for occlusion by the body
+    std::vector<std::uint32_t> m_locationCandidates;
+    Eigen::Array<double, Eigen::Dynamic, 3> m_locationLabelPositions;
+    Eigen::Array<bool, Eigen::Dynamic, 1> m_locationOccluded;
 
     // Location markers
  public:
@@ -39,6 +39,7 @@
 #include "renderinfo.h"
 #include "shadermanager.h"
 #include "shadowmap.h" // GL_ONLY_SHADOWS definition
+#include "shadowmapcache.h"
 #include "texture.h"
 
 using namespace celestia;
@@ -241,14 +242,7 @@ void renderEllipsoid_GLSL(const RenderInfo& ri,
     }
 
     // Set the shadow information.
-    for (unsigned int li = 0; li < ls.nLights; li++)
-    {
-        if (ls.shadows[li] && !ls.shadows[li]->empty())
-        {
-            auto nShadows = std::min(MaxShaderEclipseShadows, static_cast<unsigned int>(ls.shadows[li]->size()));
-            shadprop.setEclipseShadowCountForLight(li, nShadows);
-        }
-    }
+    shadprop.setEclipseShadowCounts(ls);
 
     if (ls.shadowingRingSystem)
     {
@@ -290,7 +284,7 @@ void renderEllipsoid_GLSL(const RenderInfo& ri,
 
 
     // Get a shader for the current rendering configuration
-    CelestiaGLProgram* prog = renderer->getShaderManager().getShader(shadprop);
+    CelestiaGLProgram* prog = renderer->getShaderManager().getShaderAsync(shadprop, ri.shaderSlot);
     if (prog == nullptr)
         return;
 
@@ -372,10 +366,13 @@ void renderGeometry_GLSL(Geometry* geometry,
                          const Matrices &m,
                          Renderer* renderer)
 {
-    auto *shadowBuffer = renderer->getShadowFBO(0);
-    Eigen::Matrix4f lightMatrix(Eigen::Matrix4f::Identity());
+    // Shadow maps are kept while the light doesn't move relative to the model
+    engine::ShadowMapCache::ShadowMap shadowMap;
+    if (auto *shadowMaps = renderer->getShadowMapCache(); shadowMaps != nullptr)
+        shadowMap = shadowMaps->get(geometry, ls.lights[0].direction_obj, renderer->getFrameCount());
+    FramebufferObject* shadowBuffer = shadowMap.fbo;
 
-    if (shadowBuffer != nullptr && shadowBuffer->isValid())
+    if (shadowMap.needsUpdate)
     {
         std::array<int, 4> viewport;
         renderer->getViewport(viewport);
@@ -395,7 +392,7 @@ void renderGeometry_GLSL(Geometry* geometry,
 #endif
 
         renderGeometryShadow_GLSL(geometry, shadowBuffer, ls, 0,
-                                  tsec, renderer, &lightMatrix);
+                                  tsec, renderer, shadowMap.lightMatrix);
         renderer->setViewport(viewport);
 #ifdef DEPTH_BUFFER_DEBUG
         glDisable(GL_DEPTH_TEST);
@@ -445,13 +442,15 @@ void renderGeometry_GLSL(Geometry* geometry,
         rc.setAtmosphere(atmosphere);
     }
 
-    if (shadowBuffer != nullptr && shadowBuffer->isValid())
+    if (shadowBuffer != nullptr)
     {
-        rc.setShadowMap(shadowBuffer->depthTexture(), shadowBuffer->width(), &lightMatrix);
+        rc.setShadowMap(shadowBuffer->depthTexture(), shadowBuffer->width(), shadowMap.lightMatrix);
     }
 
     rc.setCameraOrientation(ri.orientation);
     rc.setPointScale(ri.pointScale);
+    rc.setCulling(ri.modelFrustum, ri.eyePos_obj);
+    rc.setLODPixelSize(ri.pixWidth);
 
     // Handle extended material attributes (per model only, not per submesh)
     rc.setLunarLambert(ri.lunarLambert);
@@ -498,6 +497,8 @@ void renderGeometry_GLSL_Unlit(Geometry* geometry,
 {
     GLSLUnlit_RenderContext rc(renderer, geometryScale, m.modelview, m.projection);
     rc.setPointScale(ri.pointScale);
+    rc.setCulling(ri.modelFrustum, ri.eyePos_obj);
+    rc.setLODPixelSize(ri.pixWidth);
 
     Renderer::PipelineState ps;
     ps.depthMask = true;
@@ -575,18 +576,10 @@ void renderClouds_GLSL(const RenderInfo& ri,
     }
 
     // Set the shadow information.
-    for (unsigned int li = 0; li < ls.nLights; li++)
-    {
-        if (ls.shadows[li] && !ls.shadows[li]->empty())
-        {
-            unsigned int nShadows = std::min(MaxShaderEclipseShadows,
-                                             static_cast<unsigned int>(ls.shadows[li]->size()));
-            shadprop.setEclipseShadowCountForLight(li, nShadows);
-        }
-    }
+    shadprop.setEclipseShadowCounts(ls);
 
     // Get a shader for the current rendering configuration
-    CelestiaGLProgram* prog = renderer->getShaderManager().getShader(shadprop);
+    CelestiaGLProgram* prog = renderer->getShaderManager().getShaderAsync(shadprop);
     if (prog == nullptr)
         return;
 
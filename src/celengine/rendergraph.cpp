@@ -0,0 +1,97 @@
+// rendergraph.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Passes of a frame and the data which flows between them.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "rendergraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace celestia::engine
+{
+
+RenderGraph::ResourceId
+RenderGraph::addResource(std::string_view name, bool output, bool imported)
+{
+    m_resources.push_back(Resource{ std::string(name), output, imported });
+    return static_cast<ResourceId>(m_resources.size() - 1);
+}
+
+RenderGraph::PassId
+RenderGraph::addPass(std::string_view name,
+                     std::initializer_list<ResourceId> reads,
+                     std::initializer_list<ResourceId> writes,
+                     Function execute,
+                     Predicate enabled)
+{
+#ifndef NDEBUG
+    // What a pass reads must be imported or written by an earlier pass
+    for (ResourceId resource : reads)
+    {
+        assert(resource < m_resources.size());
+        assert(m_resources[resource].imported ||
+               std::any_of(m_passes.begin(), m_passes.end(),
+                           [resource](const Pass& pass)
+                           {
+                               return std::find(pass.writes.begin(), pass.writes.end(), resource) != pass.writes.end();
+                           }));
+    }
+    for (ResourceId resource : writes)
+        assert(resource < m_resources.size());
+#endif
+
+    m_passes.push_back(Pass{ std::string(name), reads, writes, std::move(execute), std::move(enabled) });
+    m_live.push_back(false);
+    return static_cast<PassId>(m_passes.size() - 1);
+}
+
+// Walk the passes backwards from the outputs: a pass is live if it is
+// enabled and writes a resource which is needed, and then what it reads is
+// needed by the passes before it. A resource stays needed when it is
+// written, as passes add to it.
+void
+RenderGraph::compile()
+{
+    m_needed.assign(m_resources.size(), false);
+    for (std::size_t i = 0; i < m_resources.size(); ++i)
+        m_needed[i] = m_resources[i].output;
+
+    for (std::size_t i = m_passes.size(); i-- > 0;)
+    {
+        const Pass& pass = m_passes[i];
+        bool live = std::any_of(pass.writes.begin(), pass.writes.end(),
+                                [this](ResourceId resource) { return m_needed[resource]; }) &&
+                    (!pass.enabled || pass.enabled());
+        m_live[i] = live;
+        if (!live)
+            continue;
+
+        for (ResourceId resource : pass.reads)
+            m_needed[resource] = true;
+    }
+}
+
+std::size_t
+RenderGraph::getLiveCount() const
+{
+    return static_cast<std::size_t>(std::count(m_live.begin(), m_live.end(), true));
+}
+
+void
+RenderGraph::clear()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_live.clear();
+    m_needed.clear();
+}
+
+} // end namespace celestia::engine
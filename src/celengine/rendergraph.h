@@ -0,0 +1,107 @@
+// rendergraph.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Passes of a frame and the data which flows between them.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace celestia::engine
+{
+
+// The passes which make up a frame, run in the order in which they were
+// added. Each pass declares the resources it reads and writes: the frame
+// buffer, or lists built for the later passes. compile() keeps the passes
+// which are enabled and contribute to an output, either directly or through
+// the resources read by the passes which do; the others are not run. A new
+// pass is added with its dependencies instead of being threaded through
+// the code which draws the frame.
+class RenderGraph
+{
+public:
+    using ResourceId = std::uint32_t;
+    using PassId = std::uint32_t;
+    using Function = std::function<void()>;
+    using Predicate = std::function<bool()>;
+
+    // Resources are written by the passes adding to them, so a pass doesn't
+    // hide what earlier passes wrote. Imported resources are built before
+    // the graph is run, and outputs are needed whether any pass reads them
+    // or not.
+    ResourceId addResource(std::string_view name, bool output = false, bool imported = false);
+
+    // Add a pass which runs execute if enabled, which may be empty, returns
+    // true in compile(). The resources must have been added before.
+    PassId addPass(std::string_view name,
+                   std::initializer_list<ResourceId> reads,
+                   std::initializer_list<ResourceId> writes,
+                   Function execute,
+                   Predicate enabled = {});
+
+    bool empty() const { return m_passes.empty(); }
+    std::size_t getPassCount() const { return m_passes.size(); }
+    std::string_view getPassName(PassId pass) const { return m_passes[pass].name; }
+    std::string_view getResourceName(ResourceId resource) const { return m_resources[resource].name; }
+
+    // Decide which passes are run by the next execute()
+    void compile();
+
+    // Return true if the pass was kept by the last compile()
+    bool isLive(PassId pass) const { return m_live[pass]; }
+    std::size_t getLiveCount() const;
+
+    // Run the live passes in order, calling afterPass(pass) after each one
+    template<typename F>
+    void execute(F&& afterPass) const
+    {
+        for (PassId pass = 0; pass < static_cast<PassId>(m_passes.size()); ++pass)
+        {
+            if (!m_live[pass])
+                continue;
+            m_passes[pass].execute();
+            afterPass(pass);
+        }
+    }
+
+    void execute() const { execute([](PassId) {}); }
+
+    void clear();
+
+private:
+    struct Resource
+    {
+        std::string name;
+        bool output;
+        bool imported;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::vector<ResourceId> reads;
+        std::vector<ResourceId> writes;
+        Function execute;
+        Predicate enabled;
+    };
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    // Results of compile(); kept to avoid allocations each frame
+    std::vector<bool> m_live;
+    std::vector<bool> m_needed;
+};
+
+} // end namespace celestia::engine
@@ -16,8 +16,14 @@
 
 
 class LODSphereMesh;
+struct ShaderSlot;
 class Texture;
 
+namespace celestia::math
+{
+class Frustum;
+}
+
 
 struct RenderInfo
 {
@@ -39,6 +45,10 @@ struct RenderInfo
     Eigen::Quaternionf orientation{ Eigen::Quaternionf::Identity() };
     float pixWidth{ 1.0f };
     float pointScale{ 1.0f };
+    ShaderSlot* shaderSlot{ nullptr };
+    // The view frustum in the coordinates of the model vertices, used to
+    // cull the parts of large models which are outside of it
+    const celestia::math::Frustum* modelFrustum{ nullptr };
 };
 
 extern LODSphereMesh* g_lodSphere;
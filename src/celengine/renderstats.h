@@ -0,0 +1,101 @@
+// renderstats.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Counters of the work done by the renderer to draw a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace celestia::engine
+{
+
+// The counters are summed over the views drawn since the last call of
+// Renderer::resetRenderStats(), except for the resident memory, which is
+// the size of the loaded textures and models when the stats are read.
+struct RenderStats
+{
+    std::uint64_t starNodesVisited{ 0 };
+    std::uint64_t starNodesAccepted{ 0 };
+    // Stars passed the magnitude tests of the octree traversal
+    std::uint64_t starsProcessed{ 0 };
+    // Stars drawn as points, including those of the static star buffer
+    // ranges, where the shader culls the faint ones
+    std::uint64_t starsDrawn{ 0 };
+    // Faint stars merged into others covering the same pixels
+    std::uint64_t starsMerged{ 0 };
+    // Times the distant star cache was built
+    std::uint64_t starCacheRebuilds{ 0 };
+
+    std::uint64_t dsoNodesVisited{ 0 };
+    std::uint64_t dsoNodesAccepted{ 0 };
+    std::uint64_t dsosProcessed{ 0 };
+    std::uint64_t galaxiesDrawn{ 0 };
+    std::uint64_t globularsDrawn{ 0 };
+    std::uint64_t nebulaeDrawn{ 0 };
+    std::uint64_t openClustersDrawn{ 0 };
+
+    std::uint64_t renderListEntries{ 0 };
+    std::uint64_t depthPartitions{ 0 };
+
+    std::uint64_t drawCalls{ 0 };
+    std::uint64_t stateChanges{ 0 };
+    std::uint64_t shaderSwitches{ 0 };
+    std::uint64_t textureUploadBytes{ 0 };
+
+    std::uint64_t textureMemory{ 0 };
+    std::uint64_t meshMemory{ 0 };
+    // Completed loads put off to a later frame by the upload budget
+    std::uint64_t uploadsDeferred{ 0 };
+
+    std::uint64_t labelsDrawn{ 0 };
+    std::uint64_t labelsCulled{ 0 };
+
+    // Views in which the render, orbit path or annotation lists, or the
+    // storage of the annotation labels, had to grow; it stays at zero once
+    // the scene is steady
+    std::uint64_t frameListGrowths{ 0 };
+
+    // Call f(name, value) for each counter, e.g. to list them in the HUD
+    // or in a script table
+    template<typename F>
+    void forEach(F&& f) const
+    {
+        using namespace std::string_view_literals;
+
+        f("starNodesVisited"sv,   starNodesVisited);
+        f("starNodesAccepted"sv,  starNodesAccepted);
+        f("starsProcessed"sv,     starsProcessed);
+        f("starsDrawn"sv,         starsDrawn);
+        f("starsMerged"sv,        starsMerged);
+        f("starCacheRebuilds"sv,  starCacheRebuilds);
+        f("dsoNodesVisited"sv,    dsoNodesVisited);
+        f("dsoNodesAccepted"sv,   dsoNodesAccepted);
+        f("dsosProcessed"sv,      dsosProcessed);
+        f("galaxiesDrawn"sv,      galaxiesDrawn);
+        f("globularsDrawn"sv,     globularsDrawn);
+        f("nebulaeDrawn"sv,       nebulaeDrawn);
+        f("openClustersDrawn"sv,  openClustersDrawn);
+        f("renderListEntries"sv,  renderListEntries);
+        f("depthPartitions"sv,    depthPartitions);
+        f("drawCalls"sv,          drawCalls);
+        f("stateChanges"sv,       stateChanges);
+        f("shaderSwitches"sv,     shaderSwitches);
+        f("textureUploadBytes"sv, textureUploadBytes);
+        f("textureMemory"sv,      textureMemory);
+        f("meshMemory"sv,         meshMemory);
+        f("uploadsDeferred"sv,    uploadsDeferred);
+        f("labelsDrawn"sv,        labelsDrawn);
+        f("labelsCulled"sv,       labelsCulled);
+        f("frameListGrowths"sv,   frameListGrowths);
+    }
+};
+
+} // end namespace celestia::engine
@@ -0,0 +1,152 @@
+// retainedtext.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Text kept in a vertex buffer and drawn again while it is unchanged.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "retainedtext.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include <celrender/gl/buffer.h>
+#include <celrender/gl/vertexobject.h>
+#include "glsupport.h"
+#include "shadermanager.h"
+
+namespace gl = celestia::gl;
+
+namespace celestia::engine
+{
+
+RetainedText::RetainedText() = default;
+
+RetainedText::~RetainedText() = default;
+
+RetainedText::RetainedText(RetainedText&&) noexcept = default;
+
+RetainedText& RetainedText::operator=(RetainedText&&) noexcept = default;
+
+void
+RetainedText::clear()
+{
+    m_runs.clear();
+    m_dirty = true;
+}
+
+void
+RetainedText::setColor(const Color& color)
+{
+    std::memcpy(&m_color, color.data(), sizeof(m_color));
+}
+
+std::pair<float, float>
+RetainedText::add(const std::shared_ptr<TextureFont>& font,
+                  std::u16string_view line,
+                  float x,
+                  float y)
+{
+    auto run = std::find_if(m_runs.begin(), m_runs.end(),
+                            [&font](const FontRun& r) { return r.font == font; });
+    if (run == m_runs.end())
+    {
+        // Keep the revision from before the layout, so that the text is
+        // laid out again if it loads a glyph itself
+        run = m_runs.insert(m_runs.end(), FontRun{ font, font->getAtlasRevision(), {} });
+    }
+
+    m_quads.clear();
+    auto next = font->layout(line, x, y, m_quads);
+
+    std::uint32_t color = m_color;
+    for (const TextureFont::GlyphQuad& q : m_quads)
+    {
+        run->vertices.push_back({ q.x1, q.y1, q.tx1, q.ty2, color });
+        run->vertices.push_back({ q.x2, q.y1, q.tx2, q.ty2, color });
+        run->vertices.push_back({ q.x1, q.y2, q.tx1, q.ty1, color });
+        run->vertices.push_back({ q.x2, q.y1, q.tx2, q.ty2, color });
+        run->vertices.push_back({ q.x2, q.y2, q.tx2, q.ty1, color });
+        run->vertices.push_back({ q.x1, q.y2, q.tx1, q.ty1, color });
+    }
+
+    m_dirty = true;
+    return next;
+}
+
+bool
+RetainedText::isCurrent() const
+{
+    return std::all_of(m_runs.begin(), m_runs.end(),
+                       [](const FontRun& r) { return r.atlasRevision == r.font->getAtlasRevision(); });
+}
+
+void
+RetainedText::draw(const Eigen::Matrix4f& projection)
+{
+    if (m_dirty)
+    {
+        m_vertices.clear();
+        for (FontRun& run : m_runs)
+        {
+            run.first = static_cast<int>(m_vertices.size());
+            m_vertices.insert(m_vertices.end(), run.vertices.begin(), run.vertices.end());
+        }
+
+        if (!m_vertices.empty())
+        {
+            if (m_bo == nullptr)
+            {
+                m_bo = std::make_unique<gl::Buffer>();
+                m_vo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Triangles);
+                m_vo->addVertexBuffer(*m_bo,
+                                      CelestiaGLProgram::VertexCoordAttributeIndex,
+                                      2,
+                                      gl::VertexObject::DataType::Float,
+                                      false,
+                                      sizeof(TextVertex),
+                                      offsetof(TextVertex, x));
+                m_vo->addVertexBuffer(*m_bo,
+                                      CelestiaGLProgram::TextureCoord0AttributeIndex,
+                                      2,
+                                      gl::VertexObject::DataType::Float,
+                                      false,
+                                      sizeof(TextVertex),
+                                      offsetof(TextVertex, u));
+                m_vo->addVertexBuffer(*m_bo,
+                                      CelestiaGLProgram::ColorAttributeIndex,
+                                      4,
+                                      gl::VertexObject::DataType::UnsignedByte,
+                                      true,
+                                      sizeof(TextVertex),
+                                      offsetof(TextVertex, color));
+            }
+
+            m_bo->setData(m_vertices, gl::Buffer::BufferUsage::StaticDraw);
+        }
+
+        m_dirty = false;
+    }
+
+    if (m_vo == nullptr)
+        return;
+
+    // The fonts set up their programs and atlases, the vertices are ours
+    for (const FontRun& run : m_runs)
+    {
+        if (run.vertices.empty())
+            continue;
+
+        run.font->setMVPMatrices(projection);
+        run.font->bind();
+        m_vo->draw(static_cast<int>(run.vertices.size()), run.first);
+        run.font->unbind();
+    }
+}
+
+} // end namespace celestia::engine
@@ -0,0 +1,98 @@
+// retainedtext.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Text kept in a vertex buffer and drawn again while it is unchanged.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celttf/truetypefont.h>
+#include <celutil/color.h>
+
+namespace celestia::gl
+{
+class Buffer;
+class VertexObject;
+}
+
+namespace celestia::engine
+{
+
+// Glyphs laid out once and uploaded to a static vertex buffer, with their
+// color in the vertices, so that the text is drawn with one draw call for
+// each font until its owner lays it out again. The texture coordinates
+// depend on the glyph atlases of the fonts, so the text must be laid out
+// again when isCurrent() returns false.
+class RetainedText
+{
+public:
+    RetainedText();
+    ~RetainedText();
+    RetainedText(RetainedText&&) noexcept;
+    RetainedText& operator=(RetainedText&&) noexcept;
+
+    RetainedText(const RetainedText&) = delete;
+    RetainedText& operator=(const RetainedText&) = delete;
+
+    // Discard the glyphs added before to lay out the text again
+    void clear();
+
+    // Set the color of the glyphs added next
+    void setColor(const Color& color);
+
+    // Add a line of text in font with its baseline starting at (x, y) and
+    // return the start position for the next glyph, like TextureFont::render
+    std::pair<float, float> add(const std::shared_ptr<TextureFont>& font,
+                                std::u16string_view line,
+                                float x,
+                                float y);
+
+    // Return false if the atlas of one of the fonts was rebuilt after the
+    // text was laid out
+    bool isCurrent() const;
+
+    // Draw the text with the projection, uploading it first if it was laid
+    // out again
+    void draw(const Eigen::Matrix4f& projection);
+
+private:
+    struct TextVertex
+    {
+        float x, y;
+        float u, v;
+        std::uint32_t color;
+    };
+
+    // The glyphs in one font, drawn with a single call
+    struct FontRun
+    {
+        std::shared_ptr<TextureFont> font;
+        unsigned int atlasRevision;
+        std::vector<TextVertex> vertices;
+        int first{ 0 };
+    };
+
+    std::vector<FontRun> m_runs;
+    std::vector<TextureFont::GlyphQuad> m_quads;
+    std::vector<TextVertex> m_vertices;
+    std::uint32_t m_color{ 0xffffffff };
+    bool m_dirty{ false };
+
+    std::unique_ptr<gl::Buffer> m_bo;
+    std::unique_ptr<gl::VertexObject> m_vo;
+};
+
+} // end namespace celestia::engine
@@ -0,0 +1,194 @@
+// shadercache.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// On-disk cache of linked shader programs.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "shadercache.h"
+
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <vector>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include <celutil/logger.h>
+#include "glshader.h"
+#include "glsupport.h"
+
+using celestia::util::GetLogger;
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+constexpr std::uint64_t FNVOffsetBasis = UINT64_C(0xcbf29ce484222325);
+constexpr std::uint64_t FNVPrime = UINT64_C(0x100000001b3);
+
+constexpr std::string_view PermutationsFile = "permutations.txt";
+
+// 64-bit FNV-1a, terminated by a zero byte so that the concatenation of
+// several strings can't collide with a different split of the same bytes
+std::uint64_t
+hashString(std::uint64_t hash, std::string_view str)
+{
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNVPrime;
+    }
+    return hash * FNVPrime;
+}
+
+std::string_view
+getGLString(GLenum name)
+{
+    const auto* str = reinterpret_cast<const char*>(glGetString(name));
+    return str == nullptr ? std::string_view() : std::string_view(str);
+}
+
+} // end unnamed namespace
+
+ShaderCache::ShaderCache(const fs::path& directory) :
+    m_directory(directory)
+{
+    m_driverHash = hashString(FNVOffsetBasis, getGLString(GL_VENDOR));
+    m_driverHash = hashString(m_driverHash, getGLString(GL_RENDERER));
+    m_driverHash = hashString(m_driverHash, getGLString(GL_VERSION));
+
+    std::error_code ec;
+    if (fs::create_directories(m_directory, ec); ec)
+        GetLogger()->error("Failed to create shader cache directory {}: {}\n", m_directory, ec.message());
+
+    readPermutations();
+}
+
+bool
+ShaderCache::isSupported()
+{
+#ifdef GL_ES
+    if (!gl::checkVersion(gl::GLES_3_0))
+        return false;
+#else
+    if (epoxy_gl_version() < 41 && !epoxy_has_gl_extension("GL_ARB_get_program_binary"))
+        return false;
+#endif
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+std::uint64_t
+ShaderCache::getKey(std::string_view vs, std::string_view gs, std::string_view fs) const
+{
+    return hashString(hashString(hashString(m_driverHash, vs), gs), fs);
+}
+
+GLProgram*
+ShaderCache::load(std::uint64_t key) const
+{
+    std::ifstream in(m_directory / fmt::format("{:016x}.bin", key), std::ios::binary);
+    if (!in.good())
+        return nullptr;
+
+    std::uint32_t format = 0;
+    in.read(reinterpret_cast<char*>(&format), sizeof(format)); /* Flawfinder: ignore */
+    std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in.eof() || binary.empty())
+        return nullptr;
+
+    GLProgram* prog = nullptr;
+    GLShaderStatus status = GLShaderLoader::CreateProgramFromBinary(static_cast<GLenum>(format),
+                                                                    binary.data(),
+                                                                    static_cast<GLsizei>(binary.size()),
+                                                                    &prog);
+    return status == GLShaderStatus::OK ? prog : nullptr;
+}
+
+void
+ShaderCache::store(std::uint64_t key, const GLProgram& program) const
+{
+    GLint length = 0;
+    glGetProgramiv(program.getID(), GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(static_cast<std::size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program.getID(), length, &length, &format, binary.data());
+    if (glGetError() != GL_NO_ERROR || length <= 0)
+        return;
+
+    // Write to a temporary file first, so that another instance never sees
+    // a partial binary
+    fs::path path = m_directory / fmt::format("{:016x}.bin", key);
+    fs::path tmpPath = m_directory / fmt::format("{:016x}.tmp", key);
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        auto format32 = static_cast<std::uint32_t>(format);
+        out.write(reinterpret_cast<const char*>(&format32), sizeof(format32));
+        out.write(binary.data(), length);
+        if (!out.good())
+        {
+            GetLogger()->error("Failed to write shader cache file {}\n", tmpPath);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    if (fs::rename(tmpPath, path, ec); ec)
+        fs::remove(tmpPath, ec);
+}
+
+void
+ShaderCache::readPermutations()
+{
+    std::ifstream in(m_directory / PermutationsFile);
+    in >> std::hex;
+
+    unsigned int lightModel;
+    unsigned int texUsage;
+    unsigned int nLights;
+    unsigned int effects;
+    std::uint32_t shadowCounts;
+    int fishEyeOverride;
+    while (in >> lightModel >> texUsage >> nLights >> effects >> shadowCounts >> fishEyeOverride)
+    {
+        ShaderProperties props;
+        props.lightModel = static_cast<LightingModel>(lightModel);
+        props.texUsage = static_cast<TexUsage>(texUsage);
+        props.nLights = static_cast<std::uint16_t>(nLights);
+        props.effects = static_cast<LightingEffects>(effects);
+        props.shadowCounts = shadowCounts;
+        props.fishEyeOverride = static_cast<FisheyeOverrideMode>(fishEyeOverride);
+        m_permutations.insert(props);
+    }
+}
+
+void
+ShaderCache::addPermutation(const ShaderProperties& props)
+{
+    if (!m_permutations.insert(props).second)
+        return;
+
+    std::ofstream out(m_directory / PermutationsFile, std::ios::app);
+    out << fmt::format("{:x} {:x} {:x} {:x} {:x} {:x}\n",
+                       static_cast<unsigned int>(props.lightModel),
+                       static_cast<unsigned int>(props.texUsage),
+                       static_cast<unsigned int>(props.nLights),
+                       static_cast<unsigned int>(props.effects),
+                       props.shadowCounts,
+                       static_cast<int>(props.fishEyeOverride));
+}
+
+} // end namespace celestia::engine
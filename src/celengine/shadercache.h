@@ -0,0 +1,60 @@
+// shadercache.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// On-disk cache of linked shader programs.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <string_view>
+
+#include <celcompat/filesystem.h>
+#include "shadermanager.h"
+
+namespace celestia::engine
+{
+
+// Keeps linked shader programs as driver specific binaries, so that a
+// program built in an earlier session is loaded with glProgramBinary
+// instead of being compiled and linked again. Programs are keyed by a hash
+// of their complete sources and of the vendor, renderer and version strings
+// of the driver. A binary which the driver rejects anyway is ignored, and
+// the program is built from source and stored again.
+//
+// The cache also records the ShaderProperties of the generated programs,
+// so that the permutations needed by the loaded catalogs can be built at
+// startup instead of when an object first needs them.
+class ShaderCache
+{
+public:
+    explicit ShaderCache(const fs::path& directory);
+
+    // Return true if the driver can return program binaries. Requires a
+    // current OpenGL context.
+    static bool isSupported();
+
+    std::uint64_t getKey(std::string_view vs, std::string_view gs, std::string_view fs) const;
+
+    // Return a linked program for key, or nullptr if there is none
+    GLProgram* load(std::uint64_t key) const;
+    void store(std::uint64_t key, const GLProgram& program) const;
+
+    const std::set<ShaderProperties>& getPermutations() const { return m_permutations; }
+    void addPermutation(const ShaderProperties& props);
+
+private:
+    void readPermutations();
+
+    fs::path m_directory;
+    std::uint64_t m_driverHash;
+    std::set<ShaderProperties> m_permutations;
+};
+
+} // end namespace celestia::engine
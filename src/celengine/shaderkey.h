@@ -0,0 +1,58 @@
+// shaderkey.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Compact keys for shader program lookups.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class CelestiaGLProgram;
+
+// All the fields of a ShaderProperties packed into two words
+struct ShaderKey
+{
+    std::uint64_t lo{ 0 };
+    std::uint64_t hi{ 0 };
+
+    friend bool operator==(const ShaderKey& lhs, const ShaderKey& rhs) noexcept
+    {
+        return lhs.lo == rhs.lo && lhs.hi == rhs.hi;
+    }
+
+    friend bool operator!=(const ShaderKey& lhs, const ShaderKey& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+};
+
+struct ShaderKeyHasher
+{
+    std::size_t operator()(const ShaderKey& key) const noexcept
+    {
+        // Fold the words together and mix them as the 64-bit finalizer
+        // of MurmurHash3 does
+        std::uint64_t h = (key.lo ^ (key.hi * UINT64_C(0xff51afd7ed558ccd)));
+        h ^= h >> 33;
+        h *= UINT64_C(0xc4ceb9fe1a85ec53);
+        h ^= h >> 29;
+        return static_cast<std::size_t>(h);
+    }
+};
+
+// The program last returned by ShaderManager for a caller that renders
+// the same object every frame. While the key and the revision of the
+// shader manager match, the program is used without a lookup.
+struct ShaderSlot
+{
+    ShaderKey key;
+    unsigned int revision{ 0 };
+    CelestiaGLProgram* program{ nullptr };
+};
@@ -32,6 +32,7 @@
 #include "atmosphere.h"
 #include "glsupport.h"
 #include "lightenv.h"
+#include "shadercache.h"
 
 
 using celestia::util::GetLogger;
@@ -153,12 +154,36 @@ constexpr std::string_view LineVertexPosition = R"glsl(
     gl_Position = vec4((thisPos.xy + transform) * thisPos.w, thisPos.zw);
 )glsl"sv;
 
+constexpr std::string_view InstancedVertexPosition = R"glsl(
+    set_vp(vertexPosition);
+)glsl"sv;
+
 std::string_view
 VertexPosition(const ShaderProperties& props)
 {
+    if (props.isInstanced())
+        return InstancedVertexPosition;
     return util::is_set(props.texUsage, TexUsage::LineAsTriangles) ? LineVertexPosition : NormalVertexPosition;
 }
 
+// Each instance of an instanced model has its own model/view matrix, which
+// moves its vertices to eye coordinates, where it's lit.
+constexpr std::string_view InstanceDeclarations = R"glsl(
+attribute vec4 in_ModelView0;
+attribute vec4 in_ModelView1;
+attribute vec4 in_ModelView2;
+
+vec4 instancePosition(vec4 p)
+{
+    return vec4(dot(in_ModelView0, p), dot(in_ModelView1, p), dot(in_ModelView2, p), 1.0);
+}
+
+vec3 instanceDirection(vec3 v)
+{
+    return vec3(dot(in_ModelView0.xyz, v), dot(in_ModelView1.xyz, v), dot(in_ModelView2.xyz, v));
+}
+)glsl"sv;
+
 constexpr std::string_view FragmentHeader = ""sv;
 
 constexpr std::string_view CommonAttribs = R"glsl(
@@ -711,49 +736,30 @@ AtmosphericEffects(const ShaderProperties& props)
     source += "    vec3 atmEnter = eyePosition + min(0.0, (-rq + d)) * eyeDir;\n";
     source += "    vec3 atmLeave = nposition;\n";
 
-    source += "    vec3 atmSamplePoint = (atmEnter + atmLeave) * 0.5;\n";
-    //source += "    vec3 atmSamplePoint = atmEnter * 0.2 + atmLeave * 0.8;\n";
-
-    // Compute the distance through the atmosphere from the sample point to the sun
+    // Optical depth of the atmosphere from the sample point to the sun, and
+    // along the view ray between the points where it enters the atmosphere
+    // and reaches the surface or leaves the atmosphere again. The optical
+    // depth of the view ray is the difference of the optical depths of
+    // rays from both ends pointing towards the eye.
     source += "    vec3 atmSamplePointSun = mix(atmEnter, atmLeave, 0.5);\n";
-    source += "    rq = dot(atmSamplePointSun, " + LightProperty(0, "direction") + ");\n";
-    source += "    qq = dot(atmSamplePointSun, atmSamplePointSun) - atmosphereRadius.y;\n";
-    source += "    d = sqrt(max(rq * rq - qq, 0.0));\n";
-    source += "    float distSun = -rq + d;\n";
-    source += "    float distAtm = length(atmEnter - atmLeave);\n";
-
-    // Compute the density of the atmosphere at the sample point; it falls off exponentially
-    // with the height above the planet's surface.
-#if 0
-    source += "    float h = max(0.0, length(atmSamplePoint) - atmosphereRadius.z);\n";
-    source += "    float density = exp(-h * mieH);\n";
-#else
-    source += "    float density = 0.0;\n";
-    source += "    atmSamplePoint = mix(atmEnter, atmLeave, 0.667);\n";
-    //source += "    atmSamplePoint = atmEnter * 0.1 + atmLeave * 0.9;\n";
-    source += "    float h = max(0.0, length(atmSamplePoint) - atmosphereRadius.z);\n";
-    source += "    density += exp(-h * mieH);\n";
-    source += "    atmSamplePoint = mix(atmEnter, atmLeave, 0.333);\n";
-    //source += "    atmSamplePoint = atmEnter * 0.9 + atmLeave * 0.1;\n";
-    source += "    h = max(0.0, length(atmSamplePoint) - atmosphereRadius.z);\n";
-    source += "    density += exp(-h * mieH);\n";
-#endif
+    source += "    float depthSun = opticalDepth(atmSamplePointSun, " + LightProperty(0, "direction") + ");\n";
+    source += "    float depthAtm = max(opticalDepth(atmLeave, eyeDir) - opticalDepth(atmEnter, eyeDir), 0.0);\n";
 
     bool hasAbsorption = true;
 
     std::string scatter;
     if (hasAbsorption)
     {
-        source += "    vec3 sunColor = " + LightProperty(0, "color") + " * exp(-extinctionCoeff * density * distSun);\n";
-        source += "    vec3 ex = exp(-extinctionCoeff * density * distAtm);\n";
+        source += "    vec3 sunColor = " + LightProperty(0, "color") + " * exp(-extinctionCoeff * depthSun);\n";
+        source += "    vec3 ex = exp(-extinctionCoeff * depthAtm);\n";
 
-        scatter = "(1.0 - exp(-scatterCoeffSum * density * distAtm))";
+        scatter = "(1.0 - exp(-scatterCoeffSum * depthAtm))";
     }
 #if 0
     else
     {
-        source += "    vec3 sunColor = exp(-scatterCoeffSum * density * distSun);\n";
-        source += "    vec3 ex = exp(-scatterCoeffSum * density * distAtm);\n";
+        source += "    vec3 sunColor = exp(-scatterCoeffSum * depthSun);\n";
+        source += "    vec3 ex = exp(-scatterCoeffSum * depthAtm);\n";
 
         // If there's no absorption, the extinction coefficients are just the scattering coefficients,
         // so there's no need to recompute the scattering.
@@ -870,6 +876,45 @@ ScatteringConstantDeclarations(const ShaderProperties& /*props*/)
 }
 
 
+// Optical depth of the atmosphere along a ray from p in direction dir, in
+// units of the object radius and relative to the density at the surface.
+// The density falls off exponentially with height, so the optical depth is
+// the scale height times the Chapman function, which is evaluated with the
+// approximation of Schuler ("An Approximation to the Chapman Grazing-
+// Incidence Function for Atmospheric Scattering", GPU Pro 3). Its error is
+// below 15% along all rays, while its cost is fixed.
+std::string
+ScatteringFunctions(const ShaderProperties& /*props*/)
+{
+    std::string source;
+
+    source += "float opticalDepth(vec3 p, vec3 dir)\n{\n";
+    source += "    float r = length(p);\n";
+    source += "    float mu = dot(p, dir) / r;\n";
+    // Planet radius and distance from the center in scale heights
+    source += "    float X = atmosphereRadius.z * mieH;\n";
+    source += "    float z = r * mieH;\n";
+    source += "    float h = max(z - X, 0.0);\n";
+    source += "    float c = sqrt(1.5707963 * z);\n";
+    source += "    float ch;\n";
+    source += "    if (mu >= 0.0)\n";
+    source += "    {\n";
+    source += "        ch = c / ((c - 1.0) * mu + 1.0) * exp(-h);\n";
+    source += "    }\n";
+    source += "    else\n";
+    source += "    {\n";
+    // The ray passes through its lowest point: add the whole ray through
+    // that point and remove the part behind p
+    source += "        float x0 = sqrt(1.0 - mu * mu) * z;\n";
+    source += "        ch = 2.0 * sqrt(1.5707963 * x0) * exp(min(X - x0, 20.0)) - c / (1.0 - (c - 1.0) * mu) * exp(-h);\n";
+    source += "    }\n";
+    source += "    return ch / mieH;\n";
+    source += "}\n";
+
+    return source;
+}
+
+
 std::string
 TextureSamplerDeclarations(const ShaderProperties& props)
 {
@@ -1064,6 +1109,9 @@ BindAttribLocations(const GLProgram *prog)
     glBindAttribLocation(prog->getID(), CelestiaGLProgram::ScaleFactorAttributeIndex,   "in_ScaleFactor");
     glBindAttribLocation(prog->getID(), CelestiaGLProgram::TangentAttributeIndex,       "in_Tangent");
     glBindAttribLocation(prog->getID(), CelestiaGLProgram::PointSizeAttributeIndex,     "in_PointSize");
+    glBindAttribLocation(prog->getID(), CelestiaGLProgram::InstanceModelViewAttributeIndex,     "in_ModelView0");
+    glBindAttribLocation(prog->getID(), CelestiaGLProgram::InstanceModelViewAttributeIndex + 1, "in_ModelView1");
+    glBindAttribLocation(prog->getID(), CelestiaGLProgram::InstanceModelViewAttributeIndex + 2, "in_ModelView2");
 }
 
 std::optional<std::string>
@@ -1189,6 +1237,26 @@ ShaderProperties::setEclipseShadowCountForLight(unsigned int lightIndex, unsigne
 }
 
 
+void
+ShaderProperties::setEclipseShadowCounts(const LightingState& ls)
+{
+    unsigned int nLights = std::min(ls.nLights, MaxShaderLights);
+    unsigned int shadowCount = 0;
+    for (unsigned int li = 0; li < nLights; li++)
+    {
+        if (ls.shadows[li] != nullptr)
+            shadowCount = std::max(shadowCount, static_cast<unsigned int>(std::min(static_cast<std::size_t>(MaxShaderEclipseShadows),
+                                                                                   ls.shadows[li]->size())));
+    }
+
+    if (shadowCount == 0)
+        return;
+
+    for (unsigned int li = 0; li < nLights; li++)
+        setEclipseShadowCountForLight(li, shadowCount);
+}
+
+
 bool
 ShaderProperties::hasRingShadowForLight(unsigned int lightIndex) const
 {
@@ -1298,6 +1366,12 @@ ShaderProperties::hasTextureCoordTransform() const
     return util::is_set(texUsage, TexUsage::TextureCoordTransform);
 }
 
+bool
+ShaderProperties::isInstanced() const
+{
+    return util::is_set(texUsage, TexUsage::Instanced);
+}
+
 bool
 ShaderProperties::hasSpecular() const
 {
@@ -1341,6 +1415,19 @@ bool ShaderProperties::usePointSize() const
 }
 
 
+ShaderKey ShaderProperties::getKey() const
+{
+    ShaderKey key;
+    key.lo = static_cast<std::uint64_t>(texUsage) |
+             static_cast<std::uint64_t>(shadowCounts) << 32;
+    key.hi = static_cast<std::uint64_t>(nLights) |
+             static_cast<std::uint64_t>(lightModel) << 16 |
+             static_cast<std::uint64_t>(effects) << 32 |
+             static_cast<std::uint64_t>(fishEyeOverride) << 48;
+    return key;
+}
+
+
 bool operator<(const ShaderProperties& p0, const ShaderProperties& p1)
 {
     return std::tie(p0.texUsage, p0.nLights, p0.shadowCounts, p0.effects, p0.fishEyeOverride, p0.lightModel)
@@ -1348,7 +1435,8 @@ bool operator<(const ShaderProperties& p0, const ShaderProperties& p1)
 }
 
 
-ShaderManager::ShaderManager()
+ShaderManager::ShaderManager() :
+    revision(++lastRevision)
 {
 #if defined(_DEBUG) || defined(DEBUG) || 1
     // Only write to shader log file if this is a debug build
@@ -1375,27 +1463,110 @@ ShaderManager::~ShaderManager()
         delete shader.second;
 
     staticShaders.clear();
+
+    for(const auto& shader : pendingShaders)
+        delete shader.second.program;
 }
 
 CelestiaGLProgram*
 ShaderManager::getShader(const ShaderProperties& props)
 {
-    auto iter = dynamicShaders.find(props);
+    auto iter = dynamicShaders.find(props.getKey());
     if (iter != dynamicShaders.end())
     {
         // Shader already exists
         return iter->second;
     }
+    else if (auto pending = pendingShaders.find(props); pending != pendingShaders.end())
+    {
+        // Wait for the shader started by getShaderAsync
+        return finishProgram(pending);
+    }
     else
     {
         // Create a new shader and add it to the table of created shaders
         CelestiaGLProgram* prog = buildProgram(props);
-        dynamicShaders[props] = prog;
+        dynamicShaders[props.getKey()] = prog;
 
         return prog;
     }
 }
 
+CelestiaGLProgram*
+ShaderManager::getShaderAsync(const ShaderProperties& props, ShaderSlot* slot)
+{
+    ShaderKey key = props.getKey();
+    if (slot != nullptr && slot->revision == revision && slot->key == key)
+        return slot->program;
+
+    CelestiaGLProgram* prog = gl::KHR_parallel_shader_compile && !synchronousBuilds
+        ? getShaderParallel(props, key)
+        : getShader(props);
+
+    // Don't remember a substitute for a program that's still being built
+    if (slot != nullptr && pendingShaders.find(props) == pendingShaders.end())
+    {
+        slot->key = key;
+        slot->revision = revision;
+        slot->program = prog;
+    }
+
+    return prog;
+}
+
+CelestiaGLProgram*
+ShaderManager::getShaderParallel(const ShaderProperties& props, const ShaderKey& key)
+{
+    if (auto iter = dynamicShaders.find(key); iter != dynamicShaders.end())
+        return iter->second;
+
+    auto pending = pendingShaders.find(props);
+    if (pending == pendingShaders.end())
+    {
+        std::string vs;
+        std::string fs;
+        buildSources(props, vs, fs);
+
+        PendingProgram program;
+        if (cache != nullptr)
+        {
+            program.key = cache->getKey(vs, {}, fs);
+            if (GLProgram* prog = cache->load(program.key); prog != nullptr)
+            {
+                auto* glslProg = new CelestiaGLProgram(*prog, props);
+                dynamicShaders[key] = glslProg;
+                return glslProg;
+            }
+        }
+
+        GLShaderLoader::CreateProgramDeferred(vs, fs, &program.program);
+        BindAttribLocations(program.program);
+        if (cache != nullptr)
+            glProgramParameteri(program.program->getID(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        program.program->startLink();
+
+        pending = pendingShaders.try_emplace(props, program).first;
+    }
+
+    if (pending->second.program->isLinkComplete())
+        return finishProgram(pending);
+
+    // Until the program is ready, substitute one without shadows and
+    // scattering. These use the last texture units, so the textures
+    // bound by the caller for the other effects remain usable.
+    ShaderProperties fallback = props;
+    fallback.shadowCounts = 0;
+    fallback.texUsage &= ~(TexUsage::RingShadowTexture |
+                           TexUsage::CloudShadowTexture |
+                           TexUsage::ShadowMapTexture |
+                           TexUsage::Scattering);
+    if (auto iter = dynamicShaders.find(fallback.getKey()); iter != dynamicShaders.end() && iter->second != nullptr)
+        return iter->second;
+
+    // There's nothing to fall back to, so wait
+    return finishProgram(pending);
+}
+
 CelestiaGLProgram*
 ShaderManager::getShader(std::string_view name, std::string_view vs, std::string_view fs)
 {
@@ -1498,7 +1669,7 @@ ShaderManager::getShaderGL3(std::string_view name, std::string_view vs, std::str
 }
 
 
-GLVertexShader*
+std::string
 ShaderManager::buildVertexShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -1534,6 +1705,9 @@ R"glsl(
     if (props.hasTextureCoordTransform())
         source += TextureTransformUniforms;
 
+    if (props.isInstanced())
+        source += InstanceDeclarations;
+
     source += DeclareLights(props);
     source += TextureCoordDeclarations(props, Shader_Out);
     source += DeclareUniform("textureOffset", Shader_Float);
@@ -1587,14 +1761,29 @@ R"glsl(
 
     // Begin main() function
     source += "\nvoid main(void)\n{\n";
-    if (props.lightModel != LightingModel::ParticleDiffuseModel)
-        source += "normal = in_Normal;\n";
+    if (props.isInstanced())
+    {
+        source += "vec4 vertexPosition = instancePosition(in_Position);\n";
+        if (props.lightModel != LightingModel::ParticleDiffuseModel)
+            source += "normal = instanceDirection(in_Normal);\n";
 
-    if (props.isViewDependent() || props.hasScattering() || props.hasEclipseShadows())
-        source += "position = in_Position.xyz;\n";
+        if (props.isViewDependent() || props.hasScattering() || props.hasEclipseShadows())
+            source += "position = vertexPosition.xyz;\n";
 
-    if (props.usesTangentSpaceLighting())
-        source += "tangent = in_Tangent;\n";
+        if (props.usesTangentSpaceLighting())
+            source += "tangent = instanceDirection(in_Tangent);\n";
+    }
+    else
+    {
+        if (props.lightModel != LightingModel::ParticleDiffuseModel)
+            source += "normal = in_Normal;\n";
+
+        if (props.isViewDependent() || props.hasScattering() || props.hasEclipseShadows())
+            source += "position = in_Position.xyz;\n";
+
+        if (props.usesTangentSpaceLighting())
+            source += "tangent = in_Tangent;\n";
+    }
 
     if (props.lightModel == LightingModel::UnlitModel && util::is_set(props.texUsage, TexUsage::VertexColors))
         source += "diff = in_Color;\n";
@@ -1737,13 +1926,11 @@ R"glsl(
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == GLShaderStatus::OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
+std::string
 ShaderManager::buildFragmentShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -1770,7 +1957,10 @@ ShaderManager::buildFragmentShader(const ShaderProperties& props)
     source += TextureCoordDeclarations(props, Shader_In);
 
     if (props.hasScattering())
+    {
         source += ScatteringConstantDeclarations(props);
+        source += ScatteringFunctions(props);
+    }
 
     source += DeclareUniform("eyePosition", Shader_Vector3);
 
@@ -2002,7 +2192,12 @@ ShaderManager::buildFragmentShader(const ShaderProperties& props)
 
             std::string illum(props.hasShadowsForLight(i) ? "shadow" : SeparateDiffuse(i));
             source += "diff.rgb += " + illum + " * " + LightProperty(i, "diffuse") + ";\n";
-            source += "NH = max(0.0, dot(N, normalize(" + LightProperty(i, "halfVector") + ")));\n";
+            // The half vector uniform is only right for the instance the
+            // lights were set up for
+            if (props.isInstanced())
+                source += "NH = max(0.0, dot(N, normalize(eyeDir + " + LightProperty(i, "direction") + ")));\n";
+            else
+                source += "NH = max(0.0, dot(N, normalize(" + LightProperty(i, "halfVector") + ")));\n";
             source += "spec.rgb += " + illum + " * pow(NH, shininess) * " + LightProperty(i, "specular") + ";\n";
             if (props.hasShadowMap() && i == 0)
                 source += ApplyShadow(true);
@@ -2097,12 +2292,10 @@ ShaderManager::buildFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == GLShaderStatus::OK ? fs : nullptr;
+    return source;
 }
 
-GLVertexShader*
+std::string
 ShaderManager::buildRingsVertexShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -2146,13 +2339,11 @@ ShaderManager::buildRingsVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == GLShaderStatus::OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
+std::string
 ShaderManager::buildRingsFragmentShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -2251,13 +2442,11 @@ ShaderManager::buildRingsFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == GLShaderStatus::OK ? fs : nullptr;
+    return source;
 }
 
 
-GLVertexShader*
+std::string
 ShaderManager::buildAtmosphereVertexShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -2284,13 +2473,11 @@ ShaderManager::buildAtmosphereVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == GLShaderStatus::OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
+std::string
 ShaderManager::buildAtmosphereFragmentShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -2299,6 +2486,7 @@ ShaderManager::buildAtmosphereFragmentShader(const ShaderProperties& props)
     source += DeclareLights(props);
     source += DeclareUniform("eyePosition", Shader_Vector3);
     source += ScatteringConstantDeclarations(props);
+    source += ScatteringFunctions(props);
 
     source += DeclareInput("position", Shader_Vector3);
     source += DeclareInput("normal", Shader_Vector3);
@@ -2338,15 +2526,13 @@ ShaderManager::buildAtmosphereFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == GLShaderStatus::OK ? fs : nullptr;
+    return source;
 }
 
 
 // The emissive shader ignores all lighting and uses the diffuse color
 // as the final fragment color.
-GLVertexShader*
+std::string
 ShaderManager::buildEmissiveVertexShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -2404,13 +2590,11 @@ ShaderManager::buildEmissiveVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source, &vs);
-    return status == GLShaderStatus::OK ? vs : nullptr;
+    return source;
 }
 
 
-GLFragmentShader*
+std::string
 ShaderManager::buildEmissiveFragmentShader(const ShaderProperties& props)
 {
     std::string source(VersionHeader);
@@ -2455,14 +2639,12 @@ ShaderManager::buildEmissiveFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source, &fs);
-    return status == GLShaderStatus::OK ? fs : nullptr;
+    return source;
 }
 
 
 // Build the vertex shader used for rendering particle systems.
-GLVertexShader*
+std::string
 ShaderManager::buildParticleVertexShader(const ShaderProperties& props)
 {
     std::ostringstream source;
@@ -2531,13 +2713,11 @@ ShaderManager::buildParticleVertexShader(const ShaderProperties& props)
 
     DumpVSSource(source);
 
-    GLVertexShader* vs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateVertexShader(source.str(), &vs);
-    return status == GLShaderStatus::OK ? vs : nullptr;
+    return source.str();
 }
 
 
-GLFragmentShader*
+std::string
 ShaderManager::buildParticleFragmentShader(const ShaderProperties& props)
 {
     std::ostringstream source;
@@ -2586,20 +2766,47 @@ ShaderManager::buildParticleFragmentShader(const ShaderProperties& props)
 
     DumpFSSource(source);
 
-    GLFragmentShader* fs = nullptr;
-    GLShaderStatus status = GLShaderLoader::CreateFragmentShader(source.str(), &fs);
-    return status == GLShaderStatus::OK ? fs : nullptr;
+    return source.str();
 }
 
-CelestiaGLProgram*
-ShaderManager::buildProgram(const ShaderProperties& props)
+GLShaderStatus
+ShaderManager::createProgram(const std::string& vs, const std::string& gs, const std::string& fs, GLProgram** prog)
 {
-    GLProgram* prog = nullptr;
-    GLShaderStatus status;
+    std::uint64_t key = 0;
+    if (cache != nullptr)
+    {
+        key = cache->getKey(vs, gs, fs);
+        if (*prog = cache->load(key); *prog != nullptr)
+            return GLShaderStatus::OK;
+    }
 
-    GLVertexShader* vs = nullptr;
-    GLFragmentShader* fs = nullptr;
+    GLShaderStatus status = gs.empty()
+        ? GLShaderLoader::CreateProgram(vs, fs, prog)
+        : GLShaderLoader::CreateProgram(vs, gs, fs, prog);
+    if (status != GLShaderStatus::OK)
+        return status;
+
+    BindAttribLocations(*prog);
+    if (cache != nullptr)
+        glProgramParameteri((*prog)->getID(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    status = (*prog)->link();
+    if (status != GLShaderStatus::OK)
+    {
+        delete *prog;
+        *prog = nullptr;
+        return status;
+    }
 
+    if (cache != nullptr)
+        cache->store(key, **prog);
+
+    return GLShaderStatus::OK;
+}
+
+void
+ShaderManager::buildSources(const ShaderProperties& props, std::string& vs, std::string& fs)
+{
     if (props.lightModel == LightingModel::RingIllumModel)
     {
         vs = buildRingsVertexShader(props);
@@ -2625,54 +2832,71 @@ ShaderManager::buildProgram(const ShaderProperties& props)
         vs = buildVertexShader(props);
         fs = buildFragmentShader(props);
     }
+}
+
+CelestiaGLProgram*
+ShaderManager::buildProgram(const ShaderProperties& props)
+{
+    std::string vs;
+    std::string fs;
+    buildSources(props, vs, fs);
 
-    if (vs != nullptr && fs != nullptr)
+    GLProgram* prog = nullptr;
+    if (createProgram(vs, {}, fs, &prog) != GLShaderStatus::OK)
     {
-        status = GLShaderLoader::CreateProgram(*vs, *fs, &prog);
-        if (status == GLShaderStatus::OK)
-        {
-            BindAttribLocations(prog);
-            status = prog->link();
-        }
+        // If the shader creation failed for some reason, substitute the
+        // error shader.
+        if (CreateErrorShader(&prog, fisheyeEnabled) != GLShaderStatus::OK)
+            return nullptr;
     }
-    else
+    else if (cache != nullptr)
     {
-        status = GLShaderStatus::CompileError;
+        cache->addPermutation(props);
     }
 
-    delete vs;
-    delete fs;
+    return new CelestiaGLProgram(*prog, props);
+}
 
-    if (status != GLShaderStatus::OK)
+CelestiaGLProgram*
+ShaderManager::finishProgram(std::map<ShaderProperties, PendingProgram>::iterator pending)
+{
+    ShaderProperties props = pending->first;
+    GLProgram* prog = pending->second.program;
+    std::uint64_t key = pending->second.key;
+    pendingShaders.erase(pending);
+
+    if (prog->getLinkStatus() != GLShaderStatus::OK)
     {
-        // If the shader creation failed for some reason, substitute the
-        // error shader.
+        delete prog;
+        prog = nullptr;
         if (CreateErrorShader(&prog, fisheyeEnabled) != GLShaderStatus::OK)
+        {
+            dynamicShaders[props.getKey()] = nullptr;
             return nullptr;
+        }
+    }
+    else if (cache != nullptr)
+    {
+        cache->store(key, *prog);
+        cache->addPermutation(props);
     }
 
-    return new CelestiaGLProgram(*prog, props);
+    auto* glslProg = new CelestiaGLProgram(*prog, props);
+    dynamicShaders[props.getKey()] = glslProg;
+    return glslProg;
 }
 
 CelestiaGLProgram*
 ShaderManager::buildProgram(std::string_view vs, std::string_view fs)
 {
     GLProgram* prog = nullptr;
-    GLShaderStatus status;
     std::string _vs = fmt::format("{}{}{}{}{}\n", VersionHeader, CommonHeader, VertexHeader, VPFunction(fisheyeEnabled), vs);
     std::string _fs = fmt::format("{}{}{}{}\n", VersionHeader, CommonHeader, FragmentHeader, fs);
 
     DumpVSSource(_vs);
     DumpFSSource(_fs);
 
-    status = GLShaderLoader::CreateProgram(_vs, _fs, &prog);
-    if (status == GLShaderStatus::OK)
-    {
-        BindAttribLocations(prog);
-        status = prog->link();
-    }
-
-    if (status != GLShaderStatus::OK)
+    if (createProgram(_vs, {}, _fs, &prog) != GLShaderStatus::OK)
     {
         // If the shader creation failed for some reason, substitute the
         // error shader.
@@ -2687,21 +2911,13 @@ CelestiaGLProgram*
 ShaderManager::buildProgramGL3(std::string_view vs, std::string_view fs)
 {
     GLProgram* prog = nullptr;
-    GLShaderStatus status;
     std::string _vs = fmt::format("{}{}{}{}{}\n", VersionHeaderGL3, CommonHeader, VertexHeader, VPFunction(fisheyeEnabled), vs);
     std::string _fs = fmt::format("{}{}{}{}\n", VersionHeaderGL3, CommonHeader, FragmentHeader, fs);
 
     DumpVSSource(_vs);
     DumpFSSource(_fs);
 
-    status = GLShaderLoader::CreateProgram(_vs, _fs, &prog);
-    if (status == GLShaderStatus::OK)
-    {
-        BindAttribLocations(prog);
-        status = prog->link();
-    }
-
-    if (status != GLShaderStatus::OK)
+    if (createProgram(_vs, {}, _fs, &prog) != GLShaderStatus::OK)
     {
         // If the shader creation failed for some reason, substitute the
         // error shader.
@@ -2725,7 +2941,6 @@ ShaderManager::buildProgramGL3(std::string_view vs, std::string_view gs, std::st
     }
 
     GLProgram* prog = nullptr;
-    GLShaderStatus status;
     auto _vs = fmt::format("{}{}{}{}\n", VersionHeaderGL3, CommonHeader, VertexHeader, vs);
     auto _gs = fmt::format("{}{}{}{}{}{}\n", VersionHeaderGL3, CommonHeader, layout, GeomHeaderGL3, VPFunction(fisheyeEnabled), gs);
     auto _fs = fmt::format("{}{}{}{}\n", VersionHeaderGL3, CommonHeader, FragmentHeader, fs);
@@ -2734,14 +2949,7 @@ ShaderManager::buildProgramGL3(std::string_view vs, std::string_view gs, std::st
     DumpGSSource(_gs);
     DumpFSSource(_fs);
 
-    status = GLShaderLoader::CreateProgram(_vs, _gs, _fs, &prog);
-    if (status == GLShaderStatus::OK)
-    {
-        BindAttribLocations(prog);
-        status = prog->link();
-    }
-
-    if (status != GLShaderStatus::OK)
+    if (createProgram(_vs, _gs, _fs, &prog) != GLShaderStatus::OK)
     {
         // If the shader creation failed for some reason, substitute the
         // error shader.
@@ -2757,6 +2965,33 @@ void ShaderManager::setFisheyeEnabled(bool enabled)
     fisheyeEnabled = enabled;
 }
 
+void ShaderManager::setSynchronousBuilds(bool enabled)
+{
+    synchronousBuilds = enabled;
+}
+
+bool ShaderManager::hasPendingBuilds() const
+{
+    return !pendingShaders.empty();
+}
+
+void ShaderManager::setCacheDirectory(const fs::path& directory)
+{
+    if (directory.empty() || !celestia::engine::ShaderCache::isSupported())
+        cache = nullptr;
+    else
+        cache = std::make_unique<celestia::engine::ShaderCache>(directory);
+}
+
+void ShaderManager::warmup()
+{
+    if (cache == nullptr)
+        return;
+
+    for (const ShaderProperties& props : cache->getPermutations())
+        getShader(props);
+}
+
 CelestiaGLProgram::CelestiaGLProgram(GLProgram& _program,
                                      const ShaderProperties& _props) :
     program(&_program),
@@ -3100,9 +3335,10 @@ CelestiaGLProgram::setEclipseShadowParameters(const LightingState& ls,
          li < std::min(ls.nLights, MaxShaderLights);
          li++)
     {
+        unsigned int nShadows = 0;
         if (ls.shadows[li] != nullptr)
         {
-            auto nShadows = std::min(MaxShaderEclipseShadows, static_cast<unsigned int>(ls.shadows[li]->size()));
+            nShadows = std::min(MaxShaderEclipseShadows, static_cast<unsigned int>(ls.shadows[li]->size()));
 
             for (unsigned int i = 0; i < nShadows; i++)
             {
@@ -3138,6 +3374,14 @@ CelestiaGLProgram::setEclipseShadowParameters(const LightingState& ls,
                 shadowParams.texGenT = m.row(1);
             }
         }
+
+        // Shaders may have more shadows than this light; with a maximum
+        // depth of zero they don't darken anything
+        for (unsigned int i = nShadows; i < MaxShaderEclipseShadows; i++)
+        {
+            shadows[li][i].falloff = 0.0f;
+            shadows[li][i].maxDepth = 0.0f;
+        }
     }
 }
 
@@ -12,18 +12,27 @@
 #include <array>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
+#include <celcompat/filesystem.h>
 #include <celutil/color.h>
 #include <celutil/flag.h>
 #include <celengine/glshader.h>
+#include <celengine/shaderkey.h>
 
 class Atmosphere;
 class LightingState;
 
+namespace celestia::engine
+{
+class ShaderCache;
+}
+
 enum class TexUsage : std::uint32_t
 {
     None                    =       0,
@@ -46,6 +55,7 @@ enum class TexUsage : std::uint32_t
     StaticPointSize         = 0x10000,
     LineAsTriangles         = 0x20000,
     TextureCoordTransform   = 0x40000,
+    Instanced               = 0x80000,
 };
 
 ENUM_CLASS_BITWISE_OPS(TexUsage);
@@ -92,6 +102,10 @@ class ShaderProperties
 
     unsigned int getEclipseShadowCountForLight(unsigned int lightIndex) const;
     void setEclipseShadowCountForLight(unsigned int lightIndex, unsigned int shadowCount);
+    // Set the eclipse shadow counts for the lights of ls. All lights get the
+    // largest count, so that objects with different eclipses share shaders;
+    // setEclipseShadowParameters() makes the extra shadows transparent.
+    void setEclipseShadowCounts(const LightingState& ls);
     bool hasEclipseShadows() const;
     bool hasRingShadowForLight(unsigned int lightIndex) const;
     void setRingShadowForLight(unsigned int lightIndex, bool enabled);
@@ -107,10 +121,13 @@ class ShaderProperties
     bool hasShadowsForLight(unsigned int) const;
     bool hasSharedTextureCoords() const;
     bool hasTextureCoordTransform() const;
+    bool isInstanced() const;
     bool hasSpecular() const;
     bool hasScattering() const;
     bool isViewDependent() const;
 
+    ShaderKey getKey() const;
+
 public:
     std::uint16_t nLights{ 0 };
     LightingModel lightModel{ LightingModel::DiffuseModel };
@@ -147,6 +164,8 @@ public:
     friend class ShaderManager;
 };
 
+bool operator<(const ShaderProperties&, const ShaderProperties&);
+
 constexpr inline unsigned int MaxShaderLights = 4;
 constexpr inline unsigned int MaxShaderEclipseShadows = 3;
 
@@ -209,6 +228,8 @@ public:
         IntensityAttributeIndex     = 9,
         NextVCoordAttributeIndex    = 10,
         ScaleFactorAttributeIndex   = 11,
+        // Rows of the model/view matrix of instanced models, up to 14
+        InstanceModelViewAttributeIndex = 12,
     };
 
     CelestiaGLProgramLight lights[MaxShaderLights];
@@ -320,36 +341,72 @@ public:
     ~ShaderManager();
 
     CelestiaGLProgram* getShader(const ShaderProperties&);
+    // Like getShader, but if the program has to be built, returns a
+    // simpler one which exists already until it's ready. Only differs with
+    // KHR_parallel_shader_compile. With a slot, the program found for the
+    // same properties in an earlier call is returned without a lookup.
+    CelestiaGLProgram* getShaderAsync(const ShaderProperties&, ShaderSlot* = nullptr);
     CelestiaGLProgram* getShader(std::string_view);
     CelestiaGLProgram* getShader(std::string_view, std::string_view, std::string_view);
     CelestiaGLProgram* getShaderGL3(std::string_view, const GeomShaderParams* = nullptr);
     CelestiaGLProgram* getShaderGL3(std::string_view, std::string_view, std::string_view, std::string_view);
 
     void setFisheyeEnabled(bool enabled);
+    // Make getShaderAsync wait for the programs to be built instead of
+    // returning substitutes
+    void setSynchronousBuilds(bool enabled);
+    // Programs returned by getShaderAsync are still being built
+    bool hasPendingBuilds() const;
+
+    // Keep linked programs in directory and load them from there in later
+    // sessions. Does nothing if the driver can't return program binaries.
+    void setCacheDirectory(const fs::path& directory);
+    // Build the programs for all the ShaderProperties permutations recorded
+    // in the cache directory
+    void warmup();
 
 private:
+    struct PendingProgram
+    {
+        GLProgram* program{ nullptr };
+        std::uint64_t key{ 0 };
+    };
+
+    GLShaderStatus createProgram(const std::string&, const std::string&, const std::string&, GLProgram**);
+
+    void buildSources(const ShaderProperties&, std::string&, std::string&);
+    CelestiaGLProgram* getShaderParallel(const ShaderProperties&, const ShaderKey&);
     CelestiaGLProgram* buildProgram(const ShaderProperties&);
+    CelestiaGLProgram* finishProgram(std::map<ShaderProperties, PendingProgram>::iterator);
     CelestiaGLProgram* buildProgram(std::string_view, std::string_view);
     CelestiaGLProgram* buildProgramGL3(std::string_view, std::string_view);
     CelestiaGLProgram* buildProgramGL3(std::string_view, std::string_view, std::string_view, const GeomShaderParams* = nullptr);
 
-    GLVertexShader* buildVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildFragmentShader(const ShaderProperties&);
+    std::string buildVertexShader(const ShaderProperties&);
+    std::string buildFragmentShader(const ShaderProperties&);
 
-    GLVertexShader* buildRingsVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildRingsFragmentShader(const ShaderProperties&);
+    std::string buildRingsVertexShader(const ShaderProperties&);
+    std::string buildRingsFragmentShader(const ShaderProperties&);
 
-    GLVertexShader* buildAtmosphereVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildAtmosphereFragmentShader(const ShaderProperties&);
+    std::string buildAtmosphereVertexShader(const ShaderProperties&);
+    std::string buildAtmosphereFragmentShader(const ShaderProperties&);
 
-    GLVertexShader* buildEmissiveVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildEmissiveFragmentShader(const ShaderProperties&);
+    std::string buildEmissiveVertexShader(const ShaderProperties&);
+    std::string buildEmissiveFragmentShader(const ShaderProperties&);
 
-    GLVertexShader* buildParticleVertexShader(const ShaderProperties&);
-    GLFragmentShader* buildParticleFragmentShader(const ShaderProperties&);
+    std::string buildParticleVertexShader(const ShaderProperties&);
+    std::string buildParticleFragmentShader(const ShaderProperties&);
 
-    std::map<ShaderProperties, CelestiaGLProgram*> dynamicShaders;
+    std::unordered_map<ShaderKey, CelestiaGLProgram*, ShaderKeyHasher> dynamicShaders;
     std::map<std::string_view, CelestiaGLProgram*> staticShaders;
+    std::map<ShaderProperties, PendingProgram> pendingShaders;
+
+    std::unique_ptr<celestia::engine::ShaderCache> cache;
+
+    // Distinguishes the ShaderSlots filled by this instance
+    static inline unsigned int lastRevision{ 0 };
+    unsigned int revision;
 
     bool fisheyeEnabled { false };
+    bool synchronousBuilds { false };
 };
@@ -0,0 +1,118 @@
+// shadowmapcache.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Shadow maps of models kept across frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "shadowmapcache.h"
+
+#include <algorithm>
+
+#include <celutil/logger.h>
+#include "framebuffer.h"
+#include "framebufferpool.h"
+
+using celestia::util::GetLogger;
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+// Number of models with a shadow map; past it the shadow map of the least
+// recently drawn model is taken over
+constexpr std::size_t MaxShadowMaps = 8;
+// Number of shadow maps rendered each frame, as long as the maps to
+// replace are usable
+constexpr unsigned int MaxUpdatesPerFrame = 2;
+// Sine of the angle the light may move through before the shadow map is
+// rendered again. The map covers the normalized model, so this moves its
+// outline by about a tenth of a texel at a resolution of 4096.
+constexpr float MaxLightAngle = 5.0e-5f;
+
+} // end unnamed namespace
+
+ShadowMapCache::ShadowMapCache(unsigned int size) :
+    m_size(size)
+{
+}
+
+ShadowMapCache::~ShadowMapCache()
+{
+    clear();
+}
+
+ShadowMapCache::ShadowMap
+ShadowMapCache::get(const Geometry* geometry, const Eigen::Vector3f& lightDirection, std::uint32_t frame)
+{
+    if (m_failed)
+        return {};
+
+    if (frame != m_frame)
+    {
+        m_frame = frame;
+        m_updates = 0;
+    }
+
+    Entry& entry = findEntry(geometry);
+    entry.lastUsed = frame;
+    if (entry.fbo == nullptr)
+    {
+        entry.fbo = GetFramebufferPool()->acquire(m_size, m_size, FramebufferObject::DepthAttachment);
+        if (!entry.fbo->isValid())
+        {
+            GetLogger()->warn("Error creating shadow FBO.\n");
+            m_failed = true;
+            clear();
+            return {};
+        }
+    }
+
+    bool moved = lightDirection.dot(entry.lightDirection) <= 0.0f ||
+                 lightDirection.cross(entry.lightDirection).norm() > MaxLightAngle;
+    bool needsUpdate = !entry.rendered || (moved && m_updates < MaxUpdatesPerFrame);
+    if (needsUpdate)
+    {
+        ++m_updates;
+        entry.lightDirection = lightDirection;
+        entry.rendered = true;
+    }
+
+    return { entry.fbo.get(), &entry.lightMatrix, needsUpdate };
+}
+
+// The framebuffers go back to the pool, e.g. for a cache of the same size
+// created when the setting is changed back
+void
+ShadowMapCache::clear()
+{
+    for (auto& [geometry, entry] : m_entries)
+        GetFramebufferPool()->release(std::move(entry.fbo));
+    m_entries.clear();
+}
+
+ShadowMapCache::Entry&
+ShadowMapCache::findEntry(const Geometry* geometry)
+{
+    if (auto it = m_entries.find(geometry); it != m_entries.end())
+        return it->second;
+
+    if (m_entries.size() < MaxShadowMaps)
+        return m_entries[geometry];
+
+    // Reuse the framebuffer of the least recently drawn model
+    auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+                                   [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; });
+    Entry entry;
+    entry.fbo = std::move(oldest->second.fbo);
+    m_entries.erase(oldest);
+    return m_entries.try_emplace(geometry, std::move(entry)).first->second;
+}
+
+} // end namespace celestia::engine
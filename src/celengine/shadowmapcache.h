@@ -0,0 +1,78 @@
+// shadowmapcache.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Shadow maps of models kept across frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include <Eigen/Core>
+
+class FramebufferObject;
+class Geometry;
+
+namespace celestia::engine
+{
+
+// Shadow maps of the models drawn recently. A shadow map is rendered in
+// model space, so it only depends on the direction of the light in model
+// space; it is kept while the light stays within a small angle of the
+// direction it was rendered for, and moving the model doesn't invalidate
+// it. Only a few stale maps are rendered again each frame, the others are
+// reused until a later frame.
+class ShadowMapCache
+{
+public:
+    struct ShadowMap
+    {
+        FramebufferObject* fbo{ nullptr };
+        // Transformation from model space to shadow map coordinates
+        Eigen::Matrix4f* lightMatrix{ nullptr };
+        // Whether the shadow map must be rendered into fbo and lightMatrix
+        // set before it is used
+        bool needsUpdate{ false };
+    };
+
+    explicit ShadowMapCache(unsigned int size);
+    ~ShadowMapCache();
+
+    ShadowMapCache(const ShadowMapCache&) = delete;
+    ShadowMapCache& operator=(const ShadowMapCache&) = delete;
+
+    unsigned int size() const { return m_size; }
+
+    // Return the shadow map of geometry lit from lightDirection, in model
+    // space, during frame. fbo is null if no framebuffer could be created.
+    ShadowMap get(const Geometry* geometry, const Eigen::Vector3f& lightDirection, std::uint32_t frame);
+
+    void clear();
+
+private:
+    struct Entry
+    {
+        std::unique_ptr<FramebufferObject> fbo;
+        Eigen::Vector3f lightDirection{ Eigen::Vector3f::Zero() };
+        Eigen::Matrix4f lightMatrix{ Eigen::Matrix4f::Identity() };
+        std::uint32_t lastUsed{ 0 };
+        bool rendered{ false };
+    };
+
+    Entry& findEntry(const Geometry* geometry);
+
+    unsigned int m_size;
+    std::unordered_map<const Geometry*, Entry> m_entries;
+    std::uint32_t m_frame{ 0 };
+    unsigned int m_updates{ 0 };
+    bool m_failed{ false };
+};
+
+} // end namespace celestia::engine
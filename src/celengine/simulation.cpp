@@ -45,6 +45,7 @@ static const Star* getSun(const Body* body)
 
 void Simulation::render(Renderer& renderer)
 {
+    renderer.setTimeScale(pauseState ? 0.0 : timeScale);
     renderer.render(*activeObserver,
                     *universe,
                     faintestVisible,
@@ -54,6 +55,7 @@ void Simulation::render(Renderer& renderer)
 
 void Simulation::render(Renderer& renderer, Observer& observer)
 {
+    renderer.setTimeScale(pauseState ? 0.0 : timeScale);
     renderer.render(observer,
                     *universe,
                     faintestVisible,
@@ -435,7 +437,10 @@ Selection Simulation::findObject(std::string_view s, bool i18n) const
     if (auto nearestSolarSystem = getNearestSolarSystem(); nearestSolarSystem != nullptr)
         path[nPathEntries++] = Selection(nearestSolarSystem->getStar());
 
-    return universe->find(s, {path, nPathEntries}, i18n);
+    Selection sel = universe->find(s, {path, nPathEntries}, i18n);
+    if (sel.empty())
+        sel = universe->findMinorBody(s);
+    return sel;
 }
 
 
@@ -453,7 +458,15 @@ Selection Simulation::findObjectFromPath(std::string_view s, bool i18n) const
     if (auto nearestSolarSystem = getNearestSolarSystem(); nearestSolarSystem != nullptr)
         path[nPathEntries++] = Selection(nearestSolarSystem->getStar());
 
-    return universe->findPath(s, {path, nPathEntries}, i18n);
+    Selection sel = universe->findPath(s, {path, nPathEntries}, i18n);
+    if (sel.empty())
+    {
+        // Bodies of the minor body catalogs only join their solar system
+        // when they are looked up; after that the path resolves normally.
+        auto pos = s.rfind('/');
+        sel = universe->findMinorBody(pos == std::string_view::npos ? s : s.substr(pos + 1));
+    }
+    return sel;
 }
 
 
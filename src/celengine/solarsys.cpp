@@ -18,6 +18,8 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <Eigen/Geometry>
@@ -103,11 +105,11 @@ enum BodyType
   The name and parent name are both mandatory.
 */
 
-void sscError(const Tokenizer& tok,
+void sscError(int lineNumber,
               const std::string& msg)
 {
     GetLogger()->error(_("Error in .ssc file (line {}): {}\n"),
-                      tok.getLineNumber(), msg);
+                      lineNumber, msg);
 }
 
 // Object class properties
@@ -1104,47 +1106,85 @@ Body* CreateReferencePoint(const std::string& name,
 }
 } // end unnamed namespace
 
+struct ParsedSolarSystemObjects::Definition
+{
+    DataDisposition disposition{ DataDisposition::Add };
+    std::string itemType;
+    std::vector<std::string> names;
+    std::string parentName;
+    Value objectData;
+    // Line at the end of the definition, for error messages
+    int lineNumber{ 0 };
+};
+
+ParsedSolarSystemObjects::ParsedSolarSystemObjects() = default;
+ParsedSolarSystemObjects::~ParsedSolarSystemObjects() = default;
+ParsedSolarSystemObjects::ParsedSolarSystemObjects(ParsedSolarSystemObjects&&) noexcept = default;
+ParsedSolarSystemObjects& ParsedSolarSystemObjects::operator=(ParsedSolarSystemObjects&&) noexcept = default;
+
+void ParsedSolarSystemObjects::setReplaceExisting(bool replace)
+{
+    replaceExisting = replace;
+}
+
+
 bool LoadSolarSystemObjects(std::istream& in,
                             Universe& universe,
                             const fs::path& directory)
 {
     Tokenizer tokenizer(&in);
-    Parser parser(&tokenizer);
+    return LoadSolarSystemObjects(tokenizer, universe, directory);
+}
+
+bool LoadSolarSystemObjects(Tokenizer& tokenizer,
+                            Universe& universe,
+                            const fs::path& directory)
+{
+    return ApplySolarSystemObjects(ParseSolarSystemObjects(tokenizer, directory), universe);
+}
 
-#ifdef ENABLE_NLS
-    std::string s = directory.string();
-    const char* d = s.c_str();
-    bindtextdomain(d, d); // domain name is the same as resource path
-#endif
 
+/*! Tokenize and parse the object definitions of an ssc file without
+ *  touching the universe, so that several files may be parsed at once.
+ *  If an error is found, the definitions before it are kept and the error
+ *  is reported by ApplySolarSystemObjects() after applying them.
+ */
+ParsedSolarSystemObjects
+ParseSolarSystemObjects(Tokenizer& tokenizer, const fs::path& directory)
+{
+    ParsedSolarSystemObjects parsed;
+    parsed.directory = directory;
+
+    Parser parser(&tokenizer);
     while (tokenizer.nextToken() != Tokenizer::TokenEnd)
     {
+        ParsedSolarSystemObjects::Definition definition;
+
         // Read the disposition; if none is specified, the default is Add.
-        DataDisposition disposition = DataDisposition::Add;
         if (auto tokenValue = tokenizer.getNameValue(); tokenValue.has_value())
         {
             if (*tokenValue == "Add")
             {
-                disposition = DataDisposition::Add;
+                definition.disposition = DataDisposition::Add;
                 tokenizer.nextToken();
             }
             else if (*tokenValue == "Replace")
             {
-                disposition = DataDisposition::Replace;
+                definition.disposition = DataDisposition::Replace;
                 tokenizer.nextToken();
             }
             else if (*tokenValue == "Modify")
             {
-                disposition = DataDisposition::Modify;
+                definition.disposition = DataDisposition::Modify;
                 tokenizer.nextToken();
             }
         }
 
         // Read the item type; if none is specified the default is Body
-        std::string itemType("Body");
+        definition.itemType = "Body";
         if (auto tokenValue = tokenizer.getNameValue(); tokenValue.has_value())
         {
-            itemType = *tokenValue;
+            definition.itemType = *tokenValue;
             tokenizer.nextToken();
         }
 
@@ -1157,39 +1197,37 @@ bool LoadSolarSystemObjects(std::istream& in,
         }
         else
         {
-            sscError(tokenizer, "object name expected");
-            return false;
+            parsed.errorLine = tokenizer.getLineNumber();
+            parsed.error = "object name expected";
+            break;
         }
 
         tokenizer.nextToken();
-        std::string parentName;
         if (auto tokenValue = tokenizer.getStringValue(); tokenValue.has_value())
         {
-            parentName = *tokenValue;
+            definition.parentName = *tokenValue;
         }
         else
         {
-            sscError(tokenizer, "bad parent object name");
-            return false;
+            parsed.errorLine = tokenizer.getLineNumber();
+            parsed.error = "bad parent object name";
+            break;
         }
 
-        const Value objectDataValue = parser.readValue();
-        const Hash* objectData = objectDataValue.getHash();
-        if (objectData == nullptr)
+        definition.objectData = parser.readValue();
+        definition.lineNumber = tokenizer.getLineNumber();
+        if (definition.objectData.getHash() == nullptr)
         {
-            sscError(tokenizer, "{ expected");
-            return false;
+            parsed.errorLine = definition.lineNumber;
+            parsed.error = "{ expected";
+            break;
         }
 
-        Selection parent = universe.findPath(parentName, {});
-        PlanetarySystem* parentSystem = nullptr;
-
-        std::vector<std::string> names;
         // Iterate through the string for names delimited
         // by ':', and insert them into the name list.
         if (nameList.empty())
         {
-            names.push_back("");
+            definition.names.push_back("");
         }
         else
         {
@@ -1203,10 +1241,66 @@ bool LoadSolarSystemObjects(std::istream& in,
                     length = next - startPos;
                     ++next;
                 }
-                names.push_back(nameList.substr(startPos, length));
+                definition.names.push_back(nameList.substr(startPos, length));
                 startPos   = next;
             }
         }
+
+        parsed.definitions.push_back(std::move(definition));
+    }
+
+    return parsed;
+}
+
+
+/*! Add the parsed objects to the universe in the order of their
+ *  definitions. Returns false if parsing stopped at an error.
+ *  If the universe defers solar systems, the definitions of the objects
+ *  under a star without a solar system are passed to the universe
+ *  instead, to be applied when the solar system is first needed.
+ */
+bool ApplySolarSystemObjects(ParsedSolarSystemObjects&& parsed, Universe& universe)
+{
+    const fs::path& directory = parsed.directory;
+
+#ifdef ENABLE_NLS
+    std::string s = directory.string();
+    const char* d = s.c_str();
+    bindtextdomain(d, d); // domain name is the same as resource path
+#endif
+
+    std::unordered_map<const Star*, ParsedSolarSystemObjects> deferred;
+
+    for (ParsedSolarSystemObjects::Definition& definition : parsed.definitions)
+    {
+        if (universe.isDeferringSolarSystems())
+        {
+            // Once a star has deferred objects, the later definitions under
+            // it are deferred too, so that they are applied in order.
+            const std::string& path = definition.parentName;
+            Selection root = universe.findPath(std::string_view(path).substr(0, path.find('/')), {});
+            if (const Star* star = root.star();
+                star != nullptr &&
+                (!universe.hasSolarSystem(star) ||
+                 universe.hasPendingSolarSystem(star) ||
+                 deferred.find(star) != deferred.end()))
+            {
+                auto& objects = deferred[star];
+                objects.directory = directory;
+                objects.definitions.push_back(std::move(definition));
+                continue;
+            }
+        }
+
+        DataDisposition disposition = definition.disposition;
+        const std::string& itemType = definition.itemType;
+        const std::vector<std::string>& names = definition.names;
+        const std::string& parentName = definition.parentName;
+        const Hash* objectData = definition.objectData.getHash();
+
+        Selection parent = universe.findPath(parentName, {});
+        PlanetarySystem* parentSystem = nullptr;
+
         std::string primaryName = names.front();
 
         BodyType bodyType = UnknownBodyType;
@@ -1232,16 +1326,19 @@ bool LoadSolarSystemObjects(std::istream& in,
             }
             else
             {
-                sscError(tokenizer, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
+                sscError(definition.lineNumber, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
             }
 
             if (parentSystem != nullptr)
             {
                 Body* existingBody = parentSystem->find(primaryName);
+                if (existingBody != nullptr && parsed.replaceExisting && disposition == DataDisposition::Add)
+                    disposition = DataDisposition::Replace;
+
                 if (existingBody)
                 {
                     if (disposition == DataDisposition::Add)
-                        sscError(tokenizer, fmt::sprintf(_("warning duplicate definition of %s %s\n"), parentName, primaryName));
+                        sscError(definition.lineNumber, fmt::sprintf(_("warning duplicate definition of %s %s\n"), parentName, primaryName));
                     else if (disposition == DataDisposition::Replace)
                         existingBody->setDefaultProperties();
                 }
@@ -1269,10 +1366,16 @@ bool LoadSolarSystemObjects(std::istream& in,
             if (parent.body() != nullptr)
                 GetBodyFeaturesManager()->addAlternateSurface(parent.body(), primaryName, std::move(surface));
             else
-                sscError(tokenizer, _("bad alternate surface"));
+                sscError(definition.lineNumber, _("bad alternate surface"));
         }
         else if (itemType == "Location")
         {
+            if (parent.body() != nullptr && parsed.replaceExisting &&
+                GetBodyFeaturesManager()->findLocation(parent.body(), primaryName) != nullptr)
+            {
+                continue;
+            }
+
             if (parent.body() != nullptr)
             {
                 std::unique_ptr<Location> location = CreateLocation(objectData, parent.body());
@@ -1284,16 +1387,25 @@ bool LoadSolarSystemObjects(std::istream& in,
                 }
                 else
                 {
-                    sscError(tokenizer, _("bad location"));
+                    sscError(definition.lineNumber, _("bad location"));
                 }
             }
             else
             {
-                sscError(tokenizer, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
+                sscError(definition.lineNumber, fmt::sprintf(_("parent body '%s' of '%s' not found.\n"), parentName, primaryName));
             }
         }
     }
 
+    for (auto& [star, objects] : deferred)
+        universe.addPendingSolarSystem(star, std::move(objects));
+
+    if (!parsed.error.empty())
+    {
+        sscError(parsed.errorLine, parsed.error);
+        return false;
+    }
+
     // TODO: Return some notification if there's an error parsing the file
     return true;
 }
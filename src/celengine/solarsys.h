@@ -13,6 +13,8 @@
 #include <iosfwd>
 #include <map>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <Eigen/Core>
 
@@ -22,6 +24,7 @@
 class FrameTree;
 class PlanetarySystem;
 class Star;
+class Tokenizer;
 class Universe;
 
 class SolarSystem
@@ -43,6 +46,46 @@ class SolarSystem
 
 using SolarSystemCatalog = std::map<std::uint32_t, std::unique_ptr<SolarSystem>>;
 
+/*! The object definitions of an ssc file, parsed independently of the
+ *  universe by ParseSolarSystemObjects() and added to it in order by
+ *  ApplySolarSystemObjects().
+ */
+class ParsedSolarSystemObjects
+{
+ public:
+    ParsedSolarSystemObjects();
+    ~ParsedSolarSystemObjects();
+
+    ParsedSolarSystemObjects(const ParsedSolarSystemObjects&) = delete;
+    ParsedSolarSystemObjects& operator=(const ParsedSolarSystemObjects&) = delete;
+    ParsedSolarSystemObjects(ParsedSolarSystemObjects&&) noexcept;
+    ParsedSolarSystemObjects& operator=(ParsedSolarSystemObjects&&) noexcept;
+
+    // For a file which is loaded again: the Add definitions of objects
+    // which already exist replace them instead of adding duplicates, and
+    // the locations which already exist are kept.
+    void setReplaceExisting(bool);
+
+ private:
+    struct Definition;
+
+    fs::path directory;
+    std::vector<Definition> definitions;
+    // Set if parsing stopped early; logged when the objects are applied
+    std::string error;
+    int errorLine{ 0 };
+    bool replaceExisting{ false };
+
+    friend ParsedSolarSystemObjects ParseSolarSystemObjects(Tokenizer&, const fs::path&);
+    friend bool ApplySolarSystemObjects(ParsedSolarSystemObjects&&, Universe&);
+};
+
+ParsedSolarSystemObjects ParseSolarSystemObjects(Tokenizer& tokenizer, const fs::path& dir);
+bool ApplySolarSystemObjects(ParsedSolarSystemObjects&& parsed, Universe& universe);
+
 bool LoadSolarSystemObjects(std::istream& in,
                             Universe& universe,
                             const fs::path& dir = fs::path());
+bool LoadSolarSystemObjects(Tokenizer& tokenizer,
+                            Universe& universe,
+                            const fs::path& dir = fs::path());
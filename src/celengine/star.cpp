@@ -22,6 +22,7 @@
 #include <celastro/date.h>
 #include <celephem/orbit.h>
 #include <celephem/rotation.h>
+#include <celutil/memoryreport.h>
 #include "univcoord.h"
 
 using namespace std::string_view_literals;
@@ -1071,6 +1072,15 @@ StarDetails::shared() const
     return isShared;
 }
 
+std::size_t
+StarDetails::getMemoryUsage() const
+{
+    std::size_t size = sizeof(StarDetails) + celestia::util::ContainerMemoryUsage(infoURL);
+    if (orbitingStars != nullptr)
+        size += sizeof(std::vector<Star*>) + celestia::util::ContainerMemoryUsage(*orbitingStars);
+    return size;
+}
+
 Star::Star(AstroCatalog::IndexNumber _indexNumber, const boost::intrusive_ptr<StarDetails>& _details) :
     indexNumber(_indexNumber),
     details(_details)
@@ -93,6 +93,10 @@ public:
     bool shared() const;
     inline bool hasCorona() const;
 
+    // Size of the details and the memory they own, excluding the orbit and
+    // rotation model, which may be shared with other objects
+    std::size_t getMemoryUsage() const;
+
     enum class Knowledge : unsigned int
     {
         None         = 0,
@@ -113,16 +117,21 @@ private:
 
     void computeOrbitalRadius();
 
+    // The shared details are owned by the StarDetailsManager, which is
+    // never destroyed, so only the per-star copies are reference counted.
+    // This keeps the atomic operations out of loading, copying and sorting
+    // the stars, nearly all of which use the shared details.
     inline friend void
     intrusive_ptr_add_ref(StarDetails* p)
     {
-        p->refCount.fetch_add(1, std::memory_order_relaxed);
+        if (!p->isShared)
+            p->refCount.fetch_add(1, std::memory_order_relaxed);
     }
 
     inline friend void
     intrusive_ptr_release(StarDetails* p)
     {
-        if (p->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        if (!p->isShared && p->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
             delete p;
     }
 
@@ -303,6 +312,10 @@ public:
 
     celestia::util::array_view<Star*> getOrbitingStars() const;
 
+    // Details shared by the stars of the same spectral class, or owned by
+    // this star if it has its own
+    const StarDetails* getDetails() const;
+
 private:
     AstroCatalog::IndexNumber indexNumber{ AstroCatalog::InvalidIndex };
     Eigen::Vector3f position{ Eigen::Vector3f::Zero() };
@@ -400,6 +413,12 @@ Star::getOrbitingStars() const
     return {};
 }
 
+inline const StarDetails*
+Star::getDetails() const
+{
+    return details.get();
+}
+
 inline bool
 Star::hasCorona() const
 {
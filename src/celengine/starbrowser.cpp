@@ -19,7 +19,9 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <limits>
 
+#include <celastro/astro.h>
 #include "star.h"
 #include "stardb.h"
 #include "univcoord.h"
@@ -49,6 +51,21 @@ distanceSquared(const Star* star,
     return distance;
 }
 
+// Stars closer than a light year are ranked by their position at the
+// browser time rather than their catalog position, which moves them by up
+// to the size of their orbit. Node distances are reduced by this much so
+// that they stay lower bounds.
+constexpr float OrbitMargin = 1.0f;
+
+// Lower bound of the distance from pos to the stars of an octree node with
+// the given center and half size
+inline float
+nodeDistance(const Eigen::Vector3f& pos, const Eigen::Vector3f& center, float size)
+{
+    float distance = ((pos - center).cwiseAbs().array() - size).max(0.0f).matrix().norm();
+    return std::max(0.0f, distance - OrbitMargin);
+}
+
 class DistanceComparison
 {
 public:
@@ -57,6 +74,11 @@ public:
     StarBrowserRecord createRecord(const Star*) const;
     void finalizeRecord(StarBrowserRecord&) const;
 
+    // Sort key of a record, and a lower bound of it for the stars of an
+    // octree node
+    float key(const StarBrowserRecord& record) const { return record.distance; }
+    float nodeKey(const Eigen::Vector3f&, float, float) const;
+
     bool operator()(const StarBrowserRecord&, const StarBrowserRecord&) const;
 
 private:
@@ -85,6 +107,14 @@ DistanceComparison::finalizeRecord(StarBrowserRecord& record) const
     record.appMag = record.star->getApparentMagnitude(record.distance);
 }
 
+float
+DistanceComparison::nodeKey(const Eigen::Vector3f& center, float size, float) const
+{
+    // Records hold the squared distance until they are finalized
+    float distance = nodeDistance(m_pos, center, size);
+    return distance * distance;
+}
+
 bool
 DistanceComparison::operator()(const StarBrowserRecord& lhs, const StarBrowserRecord& rhs) const
 {
@@ -99,6 +129,9 @@ public:
     StarBrowserRecord createRecord(const Star*) const;
     void finalizeRecord(const StarBrowserRecord&) const { /* no-op */ }
 
+    float key(const StarBrowserRecord& record) const { return record.appMag; }
+    float nodeKey(const Eigen::Vector3f&, float, float) const;
+
     bool operator()(const StarBrowserRecord&, const StarBrowserRecord&) const;
 
 private:
@@ -121,6 +154,17 @@ AppMagComparison::createRecord(const Star* star) const
     return result;
 }
 
+float
+AppMagComparison::nodeKey(const Eigen::Vector3f& center, float size, float brightFactor) const
+{
+    // Extinction only makes stars fainter, so the brightest absolute
+    // magnitude at the nearest distance bounds the apparent magnitude
+    float distance = nodeDistance(m_pos, center, size);
+    return distance > 0.0f
+        ? astro::absToAppMag(brightFactor, distance)
+        : -std::numeric_limits<float>::infinity();
+}
+
 bool
 AppMagComparison::operator()(const StarBrowserRecord& lhs, const StarBrowserRecord& rhs) const
 {
@@ -135,6 +179,9 @@ public:
     StarBrowserRecord createRecord(const Star*) const;
     void finalizeRecord(StarBrowserRecord&) const;
 
+    float key(const StarBrowserRecord& record) const { return record.star->getAbsoluteMagnitude(); }
+    float nodeKey(const Eigen::Vector3f&, float, float brightFactor) const { return brightFactor; }
+
     bool operator()(const StarBrowserRecord&, const StarBrowserRecord&) const;
 
 private:
@@ -170,19 +217,19 @@ AbsMagComparison::operator()(const StarBrowserRecord& lhs, const StarBrowserReco
 class StarFilter
 {
 public:
-    StarFilter(StarBrowser::Filter, const SolarSystemCatalog*);
+    StarFilter(StarBrowser::Filter, const Universe*);
     bool operator()(const Star*) const;
 
     void setSpectralTypeFilter(const std::function<bool(const char*)>&);
 
 private:
     StarBrowser::Filter m_filter;
-    const SolarSystemCatalog* m_solarSystems;
+    const Universe* m_universe;
     std::function<bool(const char*)> m_spectralTypeFilter{ nullptr };
 };
 
-StarFilter::StarFilter(StarBrowser::Filter filter, const SolarSystemCatalog* solarSystems) :
-    m_filter(filter), m_solarSystems(solarSystems)
+StarFilter::StarFilter(StarBrowser::Filter filter, const Universe* universe) :
+    m_filter(filter), m_universe(universe)
 {
 }
 
@@ -193,18 +240,17 @@ StarFilter::setSpectralTypeFilter(const std::function<bool(const char*)>& filter
 }
 
 bool
-parentHasPlanets(const SolarSystemCatalog* solarSystems, const Star* star)
+parentHasPlanets(const Universe* universe, const Star* star)
 {
     // When searching for visible stars only, also take planets orbiting the
     // parent barycenters into account
-    const auto end = solarSystems->end();
     for (;;)
     {
         star = star->getOrbitBarycenter();
         if (star == nullptr || star->getVisibility())
             return false;
 
-        if (solarSystems->find(star->getIndex()) != end)
+        if (universe->hasSolarSystem(star))
             return true;
     }
 }
@@ -228,8 +274,8 @@ StarFilter::operator()(const Star* star) const
     }
 
     if (util::is_set(m_filter, StarBrowser::Filter::WithPlanets) &&
-        m_solarSystems->find(star->getIndex()) == m_solarSystems->end() &&
-        !(visibleOnly && parentHasPlanets(m_solarSystems, star)))
+        !m_universe->hasSolarSystem(star) &&
+        !(visibleOnly && parentHasPlanets(m_universe, star)))
     {
         return false;
     }
@@ -239,6 +285,64 @@ StarFilter::operator()(const Star* star) const
         : true;
 }
 
+// Keeps the best records found by a best-first search of the star octree
+// in a heap whose front is the worst of them
+template<typename C>
+class RecordCollector
+{
+public:
+    RecordCollector(std::vector<StarBrowserRecord>& records,
+                    const C& comparison,
+                    const StarFilter& filter,
+                    std::uint32_t size,
+                    const StarOctree& octree) :
+        m_records(records), m_comparison(comparison), m_filter(filter), m_size(size), m_octree(octree)
+    {
+    }
+
+    float nodeKey(const Eigen::Vector3f& center, float size, float brightFactor) const
+    {
+        return m_comparison.nodeKey(center, size, brightFactor);
+    }
+
+    bool acceptKey(float key) const
+    {
+        return m_records.size() < m_size || key < m_comparison.key(m_records.front());
+    }
+
+    void process(OctreeObjectIndex index);
+
+private:
+    std::vector<StarBrowserRecord>& m_records;
+    const C& m_comparison;
+    const StarFilter& m_filter;
+    std::uint32_t m_size;
+    const StarOctree& m_octree;
+};
+
+template<typename C>
+void
+RecordCollector<C>::process(OctreeObjectIndex index)
+{
+    const Star* star = &m_octree[index];
+    if (!m_filter(star))
+        return;
+
+    StarBrowserRecord record = m_comparison.createRecord(star);
+    if (m_records.size() < m_size)
+    {
+        m_records.push_back(record);
+        std::push_heap(m_records.begin(), m_records.end(), m_comparison);
+    }
+    else if (m_comparison(record, m_records.front()))
+    {
+        // Only add stars that are better than the worst star in the list
+        std::pop_heap(m_records.begin(), m_records.end(), m_comparison);
+        m_records.back() = record;
+        std::push_heap(m_records.begin(), m_records.end(), m_comparison);
+    }
+}
+
 template<typename C>
 void populateRecords(std::vector<StarBrowserRecord>& records,
                      const C& comparison,
@@ -247,60 +351,16 @@ void populateRecords(std::vector<StarBrowserRecord>& records,
                      const StarDatabase& stardb)
 {
     records.clear();
-    if (size == 0)
+    if (size == 0 || stardb.size() == 0)
         return;
 
     records.reserve(size);
 
-    std::uint32_t totalStars = stardb.size();
-    if (totalStars == 0)
-        return;
-
-    records.reserve(size);
-    std::uint32_t index = 0;
-
-    // Add all stars that match the filter until we fill up the list
-    for (;;)
-    {
-        if (index == totalStars)
-        {
-            std::sort(records.begin(), records.end(), comparison);
-            for (StarBrowserRecord& record : records)
-            {
-                comparison.finalizeRecord(record);
-            }
-            return;
-        }
-
-        if (const Star* star = stardb.getStar(index); filter(star))
-        {
-            if (records.size() == size)
-                break;
-
-            records.push_back(comparison.createRecord(star));
-        }
-
-        ++index;
-    }
-
-    // We have filled up the number of requested stars, so only add stars that
-    // are better than the worst star in the list according to the predicate.
-    std::make_heap(records.begin(), records.end(), comparison);
-
-    for (; index < totalStars; ++index)
-    {
-        const Star* star = stardb.getStar(index);
-        if (!filter(star))
-            continue;
-
-        StarBrowserRecord record = comparison.createRecord(star);
-        if (comparison(record, records.front()))
-        {
-            std::pop_heap(records.begin(), records.end(), comparison);
-            records.back() = record;
-            std::push_heap(records.begin(), records.end(), comparison);
-        }
-    }
+    // The octree nodes are searched nearest, or brightest, first, so only
+    // the nodes which may hold stars better than the worst one found so far
+    // are visited
+    RecordCollector<C> collector(records, comparison, filter, size, stardb.getOctree());
+    stardb.getOctree().processBestFirst(collector);
 
     std::sort_heap(records.begin(), records.end(), comparison);
     for (StarBrowserRecord& record : records)
@@ -353,7 +413,7 @@ StarBrowser::setPosition(const UniversalCoord& ucPos)
 void
 StarBrowser::populate(std::vector<StarBrowserRecord>& records) const
 {
-    StarFilter filter(m_filter, m_universe->getSolarSystemCatalog());
+    StarFilter filter(m_filter, m_universe);
     if (m_spectralTypeFilter)
         filter.setSpectralTypeFilter(m_spectralTypeFilter);
     const auto stardb = m_universe->getStarCatalog();
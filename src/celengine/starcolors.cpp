@@ -13,7 +13,6 @@
 
 #include <algorithm>
 #include <array>
-#include <iterator>
 #include <memory>
 
 #include <Eigen/Core>
@@ -22,8 +21,8 @@
 namespace
 {
 
-constexpr std::size_t BlackbodyTableEntries = 401;
-constexpr float MaxTemperature = 40000.0f;
+constexpr std::size_t BlackbodyTableEntries = ColorTemperatureTable::TableEntries;
+constexpr float MaxTemperature = ColorTemperatureTable::MaxTemperature;
 constexpr float TemperatureStep = MaxTemperature / static_cast<float>(BlackbodyTableEntries - 1);
 
 // Temperature of the color table bucket containing the Sun
@@ -670,10 +669,8 @@ const Eigen::Vector3d VegaXYZ = temperatureToXYZ(VegaTemperatureBucket);
 
 void
 createBlackbodyTable(const Eigen::Vector3d& whitepoint,
-                     float& tempScale,
                      std::vector<Color>& colors)
 {
-    tempScale = (BlackbodyTableEntries - 1) / MaxTemperature;
     colors.clear();
     colors.reserve(BlackbodyTableEntries);
     colors.emplace_back(0.0f, 0.0f, 0.0f);
@@ -706,22 +703,27 @@ ColorTemperatureTable::setType(ColorTableType _type)
     switch (tableType)
     {
     case ColorTableType::Enhanced:
+        // Resample the coarse table to the common resolution
         colors.clear();
-        colors.reserve(StarColors_Enhanced.size());
-        std::copy(StarColors_Enhanced.cbegin(), StarColors_Enhanced.cend(), std::back_inserter(colors));
-        tempScale = static_cast<float>(StarColors_Enhanced.size() - 1) / MaxTemperature;
+        colors.reserve(BlackbodyTableEntries);
+        for (std::size_t i = 0; i < BlackbodyTableEntries; ++i)
+        {
+            auto index = static_cast<std::size_t>(std::nearbyint(static_cast<float>(i * (StarColors_Enhanced.size() - 1))
+                                                                 / static_cast<float>(BlackbodyTableEntries - 1)));
+            colors.push_back(StarColors_Enhanced[index]);
+        }
         return true;
 
     case ColorTableType::Blackbody_D65:
-        createBlackbodyTable(D65_XYZ, tempScale, colors);
+        createBlackbodyTable(D65_XYZ, colors);
         return true;
 
     case ColorTableType::SunWhite:
-        createBlackbodyTable(SunXYZ, tempScale, colors);
+        createBlackbodyTable(SunXYZ, colors);
         return true;
 
     case ColorTableType::VegaWhite:
-        createBlackbodyTable(VegaXYZ, tempScale, colors);
+        createBlackbodyTable(VegaXYZ, colors);
         return true;
 
     default:
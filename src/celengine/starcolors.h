@@ -13,6 +13,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include <Eigen/Core>
@@ -31,15 +32,33 @@ enum class ColorTableType
 class ColorTemperatureTable
 {
  public:
+    // All the tables have the same number of entries, so the index of a
+    // temperature does not depend on the table type.
+    static constexpr std::size_t TableEntries = 401;
+    static constexpr float MaxTemperature = 40000.0f;
+
     explicit ColorTemperatureTable(ColorTableType _type);
 
+    static std::uint16_t colorIndex(float temp)
+    {
+        constexpr float tempScale = static_cast<float>(TableEntries - 1) / MaxTemperature;
+        float index = std::nearbyint(temp * tempScale);
+        if (!(index > 0.0f))
+            return 0;
+        if (index >= static_cast<float>(TableEntries - 1))
+            return static_cast<std::uint16_t>(TableEntries - 1);
+        return static_cast<std::uint16_t>(index);
+    }
+
+    // Look up the color of an index returned by colorIndex()
+    Color indexedColor(std::uint16_t index) const
+    {
+        return colors[index];
+    }
+
     Color lookupColor(float temp) const
     {
-        auto colorTableIndex = static_cast<std::size_t>(std::nearbyint(temp * tempScale));
-        if (colorTableIndex >= colors.size())
-            return colors.back();
-        else
-            return colors[colorTableIndex];
+        return colors[colorIndex(temp)];
     }
 
     Color lookupTintColor(float temp, float saturation, float fadeFactor) const
@@ -59,6 +78,5 @@ class ColorTemperatureTable
 
  private:
     std::vector<Color> colors{ };
-    float tempScale;
     ColorTableType tableType;
 };
@@ -11,21 +11,32 @@
 #include "stardb.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
 #include <set>
+#include <unordered_set>
 
 #include <fmt/format.h>
 
 #include <celutil/gettext.h>
+#include <celutil/memoryreport.h>
+#include <celutil/parallelfor.h>
 
 using namespace std::string_view_literals;
 
 namespace compat = celestia::compat;
 namespace engine = celestia::engine;
+namespace util = celestia::util;
 
 namespace
 {
 
+// Depth of the roots of the subtrees processed by the worker threads in the
+// parallel star search; with depth 2 there are up to 64 subtrees, enough to
+// balance the load between a handful of threads.
+constexpr engine::OctreeDepthType ParallelSubtreeDepth = 2;
+
 std::string
 catalogNumberToString(AstroCatalog::IndexNumber catalogNumber)
 {
@@ -51,20 +62,10 @@ StarDatabase::~StarDatabase() = default;
 Star*
 StarDatabase::find(AstroCatalog::IndexNumber catalogNumber) const
 {
-    auto it = std::lower_bound(catalogNumberIndex.begin(), catalogNumberIndex.end(),
-                               catalogNumber,
-                               [this](std::uint32_t idx, AstroCatalog::IndexNumber catNum)
-                               {
-                                   return (*octreeRoot)[idx].getIndex() < catNum;
-                               });
-
-    if (it == catalogNumberIndex.end())
-        return nullptr;
-
-    Star* star = &(*octreeRoot)[*it];
-    return star->getIndex() == catalogNumber
-        ? star
-        : nullptr;
+    std::uint32_t idx = catalogNumberIndex.find(catalogNumber);
+    return idx == celestia::util::FlatIndex::InvalidValue
+        ? nullptr
+        : &(*octreeRoot)[idx];
 }
 
 Star*
@@ -120,12 +121,12 @@ StarDatabase::getStarName(const Star& star, [[maybe_unused]] bool i18n) const
 #ifdef ENABLE_NLS
         if (i18n)
         {
-            const char * local = D_(iter->second.c_str());
+            const char * local = D_(iter->second.data());
             if (iter->second != local)
                 return local;
         }
 #endif
-        return iter->second;
+        return std::string(iter->second);
     }
 
     /*
@@ -165,7 +166,7 @@ StarDatabase::getStarNameList(const Star& star, unsigned int maxNames) const
              iter != end && iter->first == catalogNumber;
              ++iter)
         {
-            append(D_(iter->second.c_str()));
+            append(D_(iter->second.data()));
             if (nameSet.size() == maxNames)
                 return starNames;
         }
@@ -204,32 +205,142 @@ StarDatabase::findVisibleStars(engine::StarHandler& starHandler,
                                float aspectRatio,
                                float limitingMag) const
 {
-    // Compute the bounding planes of an infinite view frustum
-    Eigen::Matrix3f rot = orientation.toRotationMatrix();
-    float h = std::tan(fovY * 0.5f);
-    float w = h * aspectRatio;
-    std::array<Eigen::Vector3f, 5> planeNormals
+    auto frustumPlanes = engine::computeFrustumPlanes(position, orientation, fovY, aspectRatio);
+    engine::StarOctreeVisibleObjectsProcessor processor(&starHandler,
+                                                        position,
+                                                        frustumPlanes,
+                                                        limitingMag);
+
+    octreeRoot->processDepthFirst(processor);
+}
+
+void
+StarDatabase::findVisibleStarRecords(engine::StarRecordHandler& starHandler,
+                                     const Eigen::Vector3f& position,
+                                     const Eigen::Quaternionf& orientation,
+                                     float fovY,
+                                     float aspectRatio,
+                                     float limitingMag,
+                                     engine::StarOctreeVisibilityCache* cache,
+                                     engine::OctreeTraversalStats* stats) const
+{
+    auto frustumPlanes = engine::computeFrustumPlanes(position, orientation, fovY, aspectRatio);
+    engine::StarOctreeVisibleRecordsProcessor processor(&starHandler,
+                                                        *octreeRoot,
+                                                        renderRecords,
+                                                        position,
+                                                        frustumPlanes,
+                                                        limitingMag);
+
+    if (cache == nullptr)
+        octreeRoot->processDepthFirstIndexed(processor);
+    else
+        cache->process(*octreeRoot, processor, position, orientation, fovY, aspectRatio, limitingMag);
+
+    if (stats != nullptr)
+        *stats += processor.traversalStats();
+}
+
+void
+StarDatabase::findAllVisibleStarRecords(engine::StarRecordHandler& starHandler,
+                                        const Eigen::Vector3f& position,
+                                        float limitingMag,
+                                        engine::OctreeTraversalStats* stats) const
+{
+    engine::StarOctreeVisibleRecordsProcessor processor(&starHandler,
+                                                        *octreeRoot,
+                                                        renderRecords,
+                                                        position,
+                                                        {},
+                                                        limitingMag);
+    octreeRoot->processDepthFirstIndexed(processor);
+
+    if (stats != nullptr)
+        *stats += processor.traversalStats();
+}
+
+void
+StarDatabase::findVisibleStarRecords(engine::StarRecordHandler& starHandler,
+                                     util::array_view<engine::StarRecordHandler*> workerHandlers,
+                                     const Eigen::Vector3f& position,
+                                     const Eigen::Quaternionf& orientation,
+                                     float fovY,
+                                     float aspectRatio,
+                                     float limitingMag,
+                                     engine::OctreeTraversalStats* stats) const
+{
+    if (workerHandlers.empty())
     {
-        Eigen::Vector3f(0.0f, 1.0f, -h),
-        Eigen::Vector3f(0.0f, -1.0f, -h),
-        Eigen::Vector3f(1.0f, 0.0f, -w),
-        Eigen::Vector3f(-1.0f, 0.0f, -w),
-        Eigen::Vector3f(0.0f, 0.0f, -1.0f),
+        findVisibleStarRecords(starHandler, position, orientation, fovY, aspectRatio, limitingMag, nullptr, stats);
+        return;
+    }
+
+    auto frustumPlanes = engine::computeFrustumPlanes(position, orientation, fovY, aspectRatio);
+    std::vector<engine::OctreeNodeIndex> subtrees;
+    {
+        engine::StarOctreeVisibleRecordsProcessor processor(&starHandler,
+                                                            *octreeRoot,
+                                                            renderRecords,
+                                                            position,
+                                                            frustumPlanes,
+                                                            limitingMag);
+        octreeRoot->processTopLevelsIndexed(processor, ParallelSubtreeDepth, subtrees);
+        if (stats != nullptr)
+            *stats += processor.traversalStats();
+    }
+
+    std::atomic<std::size_t> nextSubtree{ 0 };
+    std::vector<engine::OctreeTraversalStats> workerStats(workerHandlers.size());
+    auto worker = [&](std::size_t workerIndex)
+    {
+        engine::StarOctreeVisibleRecordsProcessor processor(workerHandlers[workerIndex],
+                                                            *octreeRoot,
+                                                            renderRecords,
+                                                            position,
+                                                            frustumPlanes,
+                                                            limitingMag);
+        for (;;)
+        {
+            std::size_t i = nextSubtree.fetch_add(1, std::memory_order_relaxed);
+            if (i >= subtrees.size())
+                break;
+            octreeRoot->processSubtreeIndexed(processor, subtrees[i]);
+        }
+
+        workerStats[workerIndex] = processor.traversalStats();
     };
 
-    std::array<Eigen::Hyperplane<float, 3>, 5> frustumPlanes;
-    for (unsigned int i = 0U; i < 5U; ++i)
+    // Each handler is used by one thread at a time; the calling thread and
+    // the compute pool run the workers
+    auto nWorkers = std::min(workerHandlers.size(), subtrees.size());
+    util::ParallelFor(nWorkers, 1, static_cast<unsigned int>(nWorkers), [&worker](std::size_t begin, std::size_t end)
     {
-        planeNormals[i] = rot.transpose() * planeNormals[i].normalized();
-        frustumPlanes[i] = Eigen::Hyperplane<float, 3>(planeNormals[i], position);
+        for (std::size_t i = begin; i < end; ++i)
+            worker(i);
+    });
+
+    if (stats != nullptr)
+    {
+        for (const engine::OctreeTraversalStats& s : workerStats)
+            *stats += s;
     }
+}
 
-    engine::StarOctreeVisibleObjectsProcessor processor(&starHandler,
-                                                        position,
-                                                        frustumPlanes,
-                                                        limitingMag);
+void
+StarDatabase::findVisibleStarRanges(std::vector<engine::StarOctreeVisibleRangesProcessor::RangeType>& ranges,
+                                    const Eigen::Vector3f& position,
+                                    const Eigen::Quaternionf& orientation,
+                                    float fovY,
+                                    float aspectRatio,
+                                    float limitingMag) const
+{
+    auto frustumPlanes = engine::computeFrustumPlanes(position, orientation, fovY, aspectRatio);
+    engine::StarOctreeVisibleRangesProcessor processor(&ranges,
+                                                       position,
+                                                       frustumPlanes,
+                                                       limitingMag);
 
-    octreeRoot->processDepthFirst(processor);
+    octreeRoot->processObjectRanges(processor);
 }
 
 void
@@ -249,3 +360,56 @@ StarDatabase::getNameDatabase() const
 {
     return namesDB.get();
 }
+
+void
+StarDatabase::reportMemoryUsage(util::MemoryReport& report) const
+{
+    constexpr std::string_view subsystem = "Star database"sv;
+
+    std::uint32_t nStars = size();
+    report.add(subsystem, "Stars"sv, octreeRoot->objectMemoryUsage(), nStars);
+    report.add(subsystem, "Render records"sv, util::ContainerMemoryUsage(renderRecords), renderRecords.size());
+    report.add(subsystem, "Octree nodes"sv, octreeRoot->nodeMemoryUsage(), octreeRoot->nodeCount());
+    report.add(subsystem, "Catalog number index"sv, catalogNumberIndex.getMemoryUsage(), catalogNumberIndex.size());
+
+    // Stars with their own details, e.g. those with an orbit, own a copy;
+    // the others share the details of their spectral class
+    std::unordered_set<const StarDetails*> details;
+    std::unordered_set<const StarDetails*> sharedDetails;
+    std::size_t detailsSize = 0;
+    std::size_t sharedSize = 0;
+    for (std::uint32_t i = 0; i < nStars; ++i)
+    {
+        const StarDetails* starDetails = getStar(i)->getDetails();
+        if (starDetails->shared())
+        {
+            if (sharedDetails.insert(starDetails).second)
+                sharedSize += starDetails->getMemoryUsage();
+        }
+        else if (details.insert(starDetails).second)
+        {
+            detailsSize += starDetails->getMemoryUsage();
+        }
+    }
+
+    report.add(subsystem, "Star details"sv, detailsSize, details.size());
+    report.add(subsystem, "Shared star details"sv, sharedSize, sharedDetails.size());
+
+    if (namesDB != nullptr)
+    {
+        report.add(subsystem, "Names"sv, namesDB->getMemoryUsage());
+        report.add(subsystem, "Cross indexes"sv, namesDB->getCrossIndexMemoryUsage());
+        if (std::size_t mapped = namesDB->getCrossIndexMappedSize(); mapped > 0)
+            report.add(subsystem, "Cross indexes (mapped)"sv, mapped);
+    }
+}
+
+void
+StarDatabase::buildRenderRecords()
+{
+    auto nStars = octreeRoot->size();
+    renderRecords.clear();
+    renderRecords.reserve(nStars);
+    for (std::uint32_t i = 0; i < nStars; ++i)
+        renderRecords.push_back(engine::StarRenderRecord::fromStar((*octreeRoot)[i]));
+}
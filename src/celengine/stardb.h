@@ -19,6 +19,7 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 
+#include <celutil/flatindex.h>
 #include "astroobj.h"
 #include "starname.h"
 #include "staroctree.h"
@@ -26,6 +27,11 @@
 class Star;
 class StarDatabaseBuilder;
 
+namespace celestia::util
+{
+class MemoryReport;
+}
+
 class StarDatabase
 {
 public:
@@ -48,6 +54,8 @@ public:
 
     inline Star* getStar(const std::uint32_t) const;
     inline std::uint32_t size() const;
+    // The star with index n is object n of the octree
+    inline const celestia::engine::StarOctree& getOctree() const;
 
     Star* find(AstroCatalog::IndexNumber catalogNumber) const;
     Star* find(std::string_view, bool i18n) const;
@@ -61,6 +69,49 @@ public:
                           float aspectRatio,
                           float limitingMag) const;
 
+    // Variant of findVisibleStars which reads the star positions and
+    // magnitudes from the compact render records. If a visibility cache is
+    // given, the octree nodes found in a previous call are reused where
+    // possible. The work done by the search is added to stats if given.
+    void findVisibleStarRecords(celestia::engine::StarRecordHandler& starHandler,
+                                const Eigen::Vector3f& obsPosition,
+                                const Eigen::Quaternionf& obsOrientation,
+                                float fovY,
+                                float aspectRatio,
+                                float limitingMag,
+                                celestia::engine::StarOctreeVisibilityCache* cache = nullptr,
+                                celestia::engine::OctreeTraversalStats* stats = nullptr) const;
+
+    // Parallel variant of findVisibleStarRecords. The upper levels of the
+    // octree are processed by starHandler on the calling thread; the
+    // subtrees below them are shared out between the worker handlers, each
+    // of which is called from a single thread. The handlers may therefore
+    // keep thread-local state, but must not touch each other's.
+    void findVisibleStarRecords(celestia::engine::StarRecordHandler& starHandler,
+                                celestia::util::array_view<celestia::engine::StarRecordHandler*> workerHandlers,
+                                const Eigen::Vector3f& obsPosition,
+                                const Eigen::Quaternionf& obsOrientation,
+                                float fovY,
+                                float aspectRatio,
+                                float limitingMag,
+                                celestia::engine::OctreeTraversalStats* stats = nullptr) const;
+
+    // As findVisibleStarRecords, but without the frustum test, so that the
+    // stars in every direction from the observer are processed
+    void findAllVisibleStarRecords(celestia::engine::StarRecordHandler& starHandler,
+                                   const Eigen::Vector3f& obsPosition,
+                                   float limitingMag,
+                                   celestia::engine::OctreeTraversalStats* stats = nullptr) const;
+
+    // Find the ranges of star indices in the octree nodes which may contain
+    // visible stars; the stars themselves are not tested.
+    void findVisibleStarRanges(std::vector<celestia::engine::StarOctreeVisibleRangesProcessor::RangeType>& ranges,
+                               const Eigen::Vector3f& obsPosition,
+                               const Eigen::Quaternionf& obsOrientation,
+                               float fovY,
+                               float aspectRatio,
+                               float limitingMag) const;
+
     void findCloseStars(celestia::engine::StarHandler& starHandler,
                         const Eigen::Vector3f& obsPosition,
                         float radius) const;
@@ -70,12 +121,18 @@ public:
 
     const StarNameDatabase* getNameDatabase() const;
 
+    void reportMemoryUsage(celestia::util::MemoryReport&) const;
+
 private:
     Star* searchCrossIndex(StarCatalog, AstroCatalog::IndexNumber number) const;
+    void buildRenderRecords();
 
     std::unique_ptr<StarNameDatabase>             namesDB;
-    std::vector<std::uint32_t>                    catalogNumberIndex;
+    // Catalog number to octree object index
+    celestia::util::FlatIndex                     catalogNumberIndex;
     std::unique_ptr<celestia::engine::StarOctree> octreeRoot;
+    // Render records, stored in the same order as the stars in the octree
+    std::vector<celestia::engine::StarRenderRecord> renderRecords;
 
     friend class StarDatabaseBuilder;
 };
@@ -91,3 +148,9 @@ StarDatabase::size() const
 {
     return octreeRoot->size();
 }
+
+inline const celestia::engine::StarOctree&
+StarDatabase::getOctree() const
+{
+    return *octreeRoot;
+}
@@ -14,10 +14,13 @@
 #include <array>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <fstream>
 #include <istream>
 #include <iterator>
 #include <string_view>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -33,14 +36,18 @@
 #include <celutil/binaryread.h>
 #include <celutil/fsutils.h>
 #include <celutil/gettext.h>
+#include <celutil/binarywrite.h>
 #include <celutil/logger.h>
+#include <celutil/mappedfile.h>
 #include <celutil/timer.h>
 #include <celutil/tokenizer.h>
+#include <celutil/tracelog.h>
 #include "hash.h"
 #include "meshmanager.h"
 #include "octreebuilder.h"
 #include "parser.h"
 #include "stardb.h"
+#include "starsdat.h"
 #include "stellarclass.h"
 #include "value.h"
 
@@ -53,6 +60,14 @@ namespace math = celestia::math;
 namespace util = celestia::util;
 
 using util::GetLogger;
+using engine::StarDBVersion;
+using engine::StarDBVersion2;
+using engine::STARSDAT_MAGIC;
+using engine::StarsDatHeader;
+using engine::StarsDatHeaderV2;
+using engine::StarsDatNode;
+using engine::StarsDatRecord;
+using engine::parseStarsDatHeader;
 
 struct StarDatabaseBuilder::StcHeader
 {
@@ -72,6 +87,34 @@ StarDatabaseBuilder::StcHeader::StcHeader(const fs::path& _path) :
 {
 }
 
+// Most stars in the catalogs only have a position, a spectral type and a
+// magnitude. Their properties are read straight from the tokenizer, without
+// building a hash, and applied without looking up all the other properties.
+struct StarDatabaseBuilder::FlatStarData
+{
+    enum Property : unsigned int
+    {
+        RA,
+        Dec,
+        Distance,
+        AppMag,
+        AbsMag,
+        SpectralType,
+    };
+
+    static constexpr std::array<std::string_view, 6> Names
+    {
+        "RA"sv, "Dec"sv, "Distance"sv, "AppMag"sv, "AbsMag"sv, "SpectralType"sv,
+    };
+
+    bool has(Property property) const { return (mask & (1U << property)) != 0; }
+
+    // The numbers in the order of the properties, up to AbsMag
+    std::array<double, SpectralType> values;
+    std::string spectralType;
+    unsigned int mask{ 0 };
+};
+
 template<>
 struct fmt::formatter<StarDatabaseBuilder::StcHeader> : formatter<std::string_view>
 {
@@ -95,6 +138,9 @@ namespace
 // 0 to 5 percent frame rate improvement.
 constexpr engine::OctreeObjectIndex StarOctreeSplitThreshold = 75;
 
+// Minimum number of stars for which the octree is built in parallel
+constexpr std::size_t ParallelOctreeMinStars = 100000;
+
 // The octree node into which a star is placed is dependent on two properties:
 // its obsPosition and its luminosity--the fainter the star, the deeper the node
 // in which it will reside.  Each node stores an absolute magnitude; no child
@@ -145,67 +191,105 @@ constexpr float STAR_OCTREE_MAGNITUDE = 6.0f;
 // origin.
 constexpr float VALID_APPMAG_DISTANCE_THRESHOLD = 1e-5f;
 
-constexpr std::string_view STARSDAT_MAGIC = "CELSTARS"sv;
-constexpr std::uint16_t StarDBVersion     = 0x0100;
-
-#pragma pack(push, 1)
+using StarsDatEntry = StarDatabaseBuilder::BinaryStar;
 
-// stars.dat header structure
-struct StarsDatHeader
+// Octree traits for converting stars.dat files. This must produce the same
+// octree as StarOctreeTraits for stars without custom details: such stars
+// have no orbit, so their orbital radius is always zero.
+struct StarsDatOctreeTraits
 {
-    StarsDatHeader() = delete;
-    char magic[8]; //NOSONAR
-    std::uint16_t version;
-    std::uint32_t counter;
+    using ObjectType = StarsDatEntry;
+    using PrecisionType = float;
+
+    static Eigen::Vector3f getPosition(const ObjectType& obj) { return obj.position; }
+    static float getRadius(const ObjectType&) { return 0.0f; }
+    static float getMagnitude(const ObjectType& obj) { return static_cast<float>(obj.absMag) / 256.0f; }
+    static float applyDecay(float factor) { return StarOctreeTraits::applyDecay(factor); }
 };
 
-// stars.dat record structure
-struct StarsDatRecord
+template<typename TRAITS, typename STORAGE>
+std::unique_ptr<engine::StaticOctree<typename TRAITS::ObjectType, float>>
+buildStarOctree(STORAGE&& objects)
 {
-    StarsDatRecord() = delete;
-    AstroCatalog::IndexNumber catNo;
-    float x;
-    float y;
-    float z;
-    std::int16_t absMag;
-    std::uint16_t spectralType;
-};
+    // Thread startup costs outweigh the gains for small catalogs
+    unsigned int maxThreads = objects.size() >= ParallelOctreeMinStars
+        ? std::max(std::thread::hardware_concurrency(), 1U)
+        : 1U;
 
-#pragma pack(pop)
+    float absMag = astro::appToAbsMag(STAR_OCTREE_MAGNITUDE,
+                                      StarDatabase::STAR_OCTREE_ROOT_SIZE * celestia::numbers::sqrt3_v<float>);
 
-static_assert(std::is_standard_layout_v<StarsDatHeader>);
-static_assert(std::is_standard_layout_v<StarsDatRecord>);
+    auto root = engine::makeDynamicOctree<TRAITS>(std::forward<STORAGE>(objects),
+                                                  Eigen::Vector3f(1000.0f, 1000.0f, 1000.0f),
+                                                  StarDatabase::STAR_OCTREE_ROOT_SIZE,
+                                                  absMag,
+                                                  StarOctreeSplitThreshold,
+                                                  maxThreads);
+    return root->build();
+}
 
 bool
-parseStarsDatHeader(std::istream& in, std::uint32_t& nStarsInFile)
+writeStarsDatV2(std::ostream& out,
+                const engine::StaticOctree<StarsDatEntry, float>& octree,
+                const std::vector<std::uint32_t>& catalogNumberIndex)
 {
-    std::array<char, sizeof(StarsDatHeader)> header;
-    if (!in.read(header.data(), header.size()).good()) /* Flawfinder: ignore */
+    out.write(STARSDAT_MAGIC.data(), STARSDAT_MAGIC.size());
+    if (!util::writeLE<std::uint16_t>(out, StarDBVersion2)
+        || !util::writeLE<std::uint32_t>(out, octree.size())
+        || !util::writeLE<std::uint32_t>(out, octree.nodeCount()))
+    {
         return false;
+    }
 
-    // Verify the magic string
-    if (auto magic = std::string_view(header.data() + offsetof(StarsDatHeader, magic), STARSDAT_MAGIC.size());
-        magic != STARSDAT_MAGIC)
+    for (std::uint32_t i = 0, nStars = octree.size(); i < nStars; ++i)
     {
-        return false;
+        const StarsDatEntry& entry = octree[i];
+        if (!util::writeLE<AstroCatalog::IndexNumber>(out, entry.catNo)
+            || !util::writeLE<float>(out, entry.position.x())
+            || !util::writeLE<float>(out, entry.position.y())
+            || !util::writeLE<float>(out, entry.position.z())
+            || !util::writeLE<std::int16_t>(out, entry.absMag)
+            || !util::writeLE<std::uint16_t>(out, entry.spectralType))
+        {
+            return false;
+        }
     }
 
-    // Verify the version
-    if (auto version = util::fromMemoryLE<std::uint16_t>(header.data() + offsetof(StarsDatHeader, version));
-        version != StarDBVersion)
+    for (engine::OctreeNodeIndex i = 0, nNodes = octree.nodeCount(); i < nNodes; ++i)
     {
-        return false;
+        const auto& node = octree.getNode(i);
+        if (!util::writeLE<float>(out, node.center.x())
+            || !util::writeLE<float>(out, node.center.y())
+            || !util::writeLE<float>(out, node.center.z())
+            || !util::writeLE<float>(out, node.scale)
+            || !util::writeLE<std::uint32_t>(out, node.right)
+            || !util::writeLE<std::uint32_t>(out, node.first)
+            || !util::writeLE<std::uint32_t>(out, node.last)
+            || !util::writeLE<float>(out, node.brightFactor))
+        {
+            return false;
+        }
     }
 
-    // Read the star count
-    nStarsInFile = util::fromMemoryLE<std::uint32_t>(header.data() + offsetof(StarsDatHeader, counter));
-    return true;
+    for (std::uint32_t idx : catalogNumberIndex)
+    {
+        if (!util::writeLE<std::uint32_t>(out, idx))
+            return false;
+    }
+
+    return out.good();
+}
+
+std::string
+stcErrorMessage(const StarDatabaseBuilder::StcHeader& header, std::string_view msg)
+{
+    return fmt::vformat(_("Error in .stc file ({}): {}\n"), fmt::make_format_args(header, msg));
 }
 
 inline void
 stcError(const StarDatabaseBuilder::StcHeader& header, std::string_view msg)
 {
-    GetLogger()->error(_("Error in .stc file ({}): {}\n"), header, msg);
+    GetLogger()->error("{}", stcErrorMessage(header, msg));
 }
 
 inline void
@@ -214,8 +298,10 @@ stcWarn(const StarDatabaseBuilder::StcHeader& header, std::string_view msg)
     GetLogger()->warn(_("Warning in .stc file ({}): {}\n"), header, msg);
 }
 
+// Errors are returned in error rather than logged, as this may run on a
+// loader thread
 bool
-parseStcHeader(Tokenizer& tokenizer, StarDatabaseBuilder::StcHeader& header)
+parseStcHeader(Tokenizer& tokenizer, StarDatabaseBuilder::StcHeader& header, std::string& error)
 {
     header.lineNumber = tokenizer.getLineNumber();
 
@@ -257,7 +343,7 @@ parseStcHeader(Tokenizer& tokenizer, StarDatabaseBuilder::StcHeader& header)
         }
         else
         {
-            stcError(header, _("unrecognized object type"));
+            error = stcErrorMessage(header, _("unrecognized object type"));
             return false;
         }
         tokenizer.nextToken();
@@ -293,7 +379,7 @@ parseStcHeader(Tokenizer& tokenizer, StarDatabaseBuilder::StcHeader& header)
     }
     else if (header.catalogNumber == AstroCatalog::InvalidIndex)
     {
-        stcError(header, _("entry missing name and catalog number"));
+        error = stcErrorMessage(header, _("entry missing name and catalog number"));
         return false;
     }
 
@@ -506,6 +592,97 @@ applyTemperatureBoloCorrection(const StarDatabaseBuilder::StcHeader& header,
     }
 }
 
+/*! Read the properties of a star definition after its opening brace. If
+ *  they are only the RA, Dec, Distance, SpectralType, AppMag and AbsMag of a
+ *  star, without units, they are stored in flat and true is returned.
+ *  Otherwise the properties already read are put into a hash, the rest of
+ *  them are read by the parser and false is returned; starData is null if
+ *  the definition has a syntax error.
+ */
+bool
+readFlatStar(Tokenizer& tokenizer,
+             Parser& parser,
+             StarDatabaseBuilder::FlatStarData& flat,
+             Value& starData)
+{
+    using FlatStarData = StarDatabaseBuilder::FlatStarData;
+
+    std::string name;
+    bool complete = false;
+    for (;;)
+    {
+        Tokenizer::TokenType tok = tokenizer.nextToken();
+        if (tok == Tokenizer::TokenEndGroup)
+        {
+            // Leave the errors of incomplete stars to the generic checks
+            if (flat.has(FlatStarData::RA) && flat.has(FlatStarData::Dec) &&
+                flat.has(FlatStarData::Distance) && flat.has(FlatStarData::SpectralType) &&
+                (flat.has(FlatStarData::AppMag) || flat.has(FlatStarData::AbsMag)))
+            {
+                return true;
+            }
+
+            complete = true;
+            break;
+        }
+
+        if (tok != Tokenizer::TokenName)
+        {
+            tokenizer.pushBack();
+            break;
+        }
+
+        auto key = *tokenizer.getNameValue();
+        auto it = std::find(FlatStarData::Names.begin(), FlatStarData::Names.end(), key);
+        if (it == FlatStarData::Names.end())
+        {
+            name = key;
+            break;
+        }
+
+        auto property = static_cast<FlatStarData::Property>(it - FlatStarData::Names.begin());
+        if (flat.has(property))
+        {
+            name = key;
+            break;
+        }
+
+        tok = tokenizer.nextToken();
+        if (property == FlatStarData::SpectralType && tok == Tokenizer::TokenString)
+            flat.spectralType = *tokenizer.getStringValue();
+        else if (property != FlatStarData::SpectralType && tok == Tokenizer::TokenNumber)
+            flat.values[property] = *tokenizer.getNumberValue();
+        else
+        {
+            // Units or another type of value
+            tokenizer.pushBack();
+            name = *it;
+            break;
+        }
+
+        flat.mask |= 1U << property;
+    }
+
+    auto hash = std::make_unique<Hash>();
+    for (unsigned int i = 0; i < FlatStarData::Names.size(); ++i)
+    {
+        auto property = static_cast<FlatStarData::Property>(i);
+        if (!flat.has(property))
+            continue;
+
+        hash->addValue(std::string(FlatStarData::Names[i]),
+                       property == FlatStarData::SpectralType
+                           ? Value(std::move(flat.spectralType))
+                           : Value(flat.values[i]));
+    }
+
+    if (!complete)
+        hash = parser.readHashEntries(std::move(hash), std::move(name));
+
+    starData = hash == nullptr ? Value() : Value(std::move(hash));
+    return false;
+}
+
 void
 applyCustomDetails(const StarDatabaseBuilder::StcHeader& header,
                    const AssociativeArray* starData,
@@ -586,10 +763,35 @@ bool
 StarDatabaseBuilder::loadBinary(std::istream& in)
 {
     Timer timer;
+    std::array<char, sizeof(StarsDatHeader)> header;
+    if (!in.read(header.data(), header.size()).good()) /* Flawfinder: ignore */
+        return false;
+
+    std::uint16_t version;
     std::uint32_t nStarsInFile;
-    if (!parseStarsDatHeader(in, nStarsInFile))
+    if (!parseStarsDatHeader(header.data(), version, nStarsInFile))
         return false;
 
+    if (version == StarDBVersion2)
+    {
+        std::uint32_t nNodes;
+        if (!util::readLE<std::uint32_t>(in, nNodes))
+            return false;
+
+        // The prebuilt octree is only usable once all of it has been read,
+        // so there is no benefit from processing it in chunks.
+        std::vector<char> buffer(static_cast<std::size_t>(nStarsInFile) * (sizeof(StarsDatRecord) + sizeof(std::uint32_t))
+                                 + static_cast<std::size_t>(nNodes) * sizeof(StarsDatNode));
+        if (!in.read(buffer.data(), buffer.size()).good() /* Flawfinder: ignore */
+            || !loadPrebuiltOctree(buffer.data(), nStarsInFile, nNodes))
+        {
+            return false;
+        }
+
+        indexBinaryStars(nStarsInFile, timer);
+        return true;
+    }
+
     constexpr std::uint32_t BUFFER_RECORDS = UINT32_C(4096) / sizeof(StarsDatRecord);
     std::vector<char> buffer(sizeof(StarsDatRecord) * BUFFER_RECORDS);
     std::uint32_t nStarsRemaining = nStarsInFile;
@@ -599,56 +801,267 @@ StarDatabaseBuilder::loadBinary(std::istream& in)
         if (!in.read(buffer.data(), sizeof(StarsDatRecord) * recordsToRead).good()) /* Flawfinder: ignore */
             return false;
 
-        const char* ptr = buffer.data();
-        for (std::uint32_t i = 0; i < recordsToRead; ++i)
+        addBinaryStars(buffer.data(), recordsToRead);
+        nStarsRemaining -= recordsToRead;
+    }
+
+    if (in.bad())
+        return false;
+
+    indexBinaryStars(nStarsInFile, timer);
+    return true;
+}
+
+/*! Load a binary star database by mapping it into memory. The records are
+ *  decoded in place without copying the file through a stream buffer. If the
+ *  file cannot be mapped, it is read through a stream instead.
+ */
+bool
+StarDatabaseBuilder::loadBinary(const fs::path& path)
+{
+    auto mappedFile = util::MappedFile::open(path);
+    if (mappedFile == nullptr)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return in.good() && loadBinary(in);
+    }
+
+    Timer timer;
+    const char* data = mappedFile->data();
+    std::size_t size = mappedFile->size();
+
+    std::uint16_t version;
+    std::uint32_t nStarsInFile;
+    if (size < sizeof(StarsDatHeader) || !parseStarsDatHeader(data, version, nStarsInFile))
+        return false;
+
+    if (version == StarDBVersion2)
+    {
+        if (size < sizeof(StarsDatHeaderV2))
+            return false;
+
+        auto nNodes = util::fromMemoryLE<std::uint32_t>(data + offsetof(StarsDatHeaderV2, nodeCount));
+        if (size - sizeof(StarsDatHeaderV2) < static_cast<std::size_t>(nStarsInFile) * (sizeof(StarsDatRecord) + sizeof(std::uint32_t))
+                                              + static_cast<std::size_t>(nNodes) * sizeof(StarsDatNode)
+            || !loadPrebuiltOctree(data + sizeof(StarsDatHeaderV2), nStarsInFile, nNodes))
         {
-            auto catNo = util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(StarsDatRecord, catNo));
-            Eigen::Vector3f position(util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, x)),
-                                     util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, y)),
-                                     util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, z)));
-            auto absMag = util::fromMemoryLE<std::int16_t>(ptr + offsetof(StarsDatRecord, absMag));
-            auto spectralType = util::fromMemoryLE<std::uint16_t>(ptr + offsetof(StarsDatRecord, spectralType));
-
-            boost::intrusive_ptr<StarDetails> details = nullptr;
-            if (StellarClass sc; sc.unpackV1(spectralType))
-                details = StarDetails::GetStarDetails(sc);
-
-            if (details == nullptr)
-            {
-                GetLogger()->error(_("Bad spectral type in star database, star #{}\n"), catNo);
-                continue;
-            }
+            return false;
+        }
+    }
+    else
+    {
+        if (size - sizeof(StarsDatHeader) < static_cast<std::size_t>(nStarsInFile) * sizeof(StarsDatRecord))
+            return false;
+
+        addBinaryStars(data + sizeof(StarsDatHeader), nStarsInFile);
+    }
+
+    indexBinaryStars(nStarsInFile, timer);
+    return true;
+}
+
+/*! Convert a version 1 stars.dat file to the version 2 layout, which stores
+ *  the stars already sorted into the octree together with the flattened
+ *  octree nodes and the catalog number index.
+ */
+bool
+StarDatabaseBuilder::convertBinary(std::istream& in, std::ostream& out)
+{
+    std::array<char, sizeof(StarsDatHeader)> header;
+    if (!in.read(header.data(), header.size()).good()) /* Flawfinder: ignore */
+        return false;
+
+    std::uint16_t version;
+    std::uint32_t nStarsInFile;
+    if (!parseStarsDatHeader(header.data(), version, nStarsInFile) || version != StarDBVersion)
+        return false;
 
-            Star& star = unsortedStars.emplace_back(catNo, details);
-            star.setPosition(position);
-            star.setAbsoluteMagnitude(static_cast<float>(absMag) / 256.0f);
+    std::vector<StarsDatEntry> entries;
+    entries.reserve(nStarsInFile);
+
+    std::array<char, sizeof(StarsDatRecord)> record;
+    for (std::uint32_t i = 0; i < nStarsInFile; ++i)
+    {
+        if (!in.read(record.data(), record.size()).good()) /* Flawfinder: ignore */
+            return false;
 
-            ptr += sizeof(StarsDatRecord);
+        const char* ptr = record.data();
+        auto catNo = util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(StarsDatRecord, catNo));
+        StellarClass sc;
+        if (!sc.unpackV1(util::fromMemoryLE<std::uint16_t>(ptr + offsetof(StarsDatRecord, spectralType)))
+            || StarDetails::GetStarDetails(sc) == nullptr)
+        {
+            GetLogger()->error(_("Bad spectral type in star database, star #{}\n"), catNo);
+            continue;
         }
 
-        nStarsRemaining -= recordsToRead;
+        entries.push_back(BinaryStar
+        {
+            catNo,
+            Eigen::Vector3f(util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, x)),
+                            util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, y)),
+                            util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, z))),
+            util::fromMemoryLE<std::int16_t>(ptr + offsetof(StarsDatRecord, absMag)),
+            sc.packV2(),
+        });
     }
 
-    if (in.bad())
+    return writeBinary(out, std::move(entries));
+}
+
+bool
+StarDatabaseBuilder::writeBinary(std::ostream& out, std::vector<BinaryStar>&& stars)
+{
+    auto octree = buildStarOctree<StarsDatOctreeTraits>(std::move(stars));
+
+    std::vector<std::uint32_t> catalogNumberIndex(octree->size());
+    for (std::uint32_t i = 0, nStars = octree->size(); i < nStars; ++i)
+        catalogNumberIndex[i] = i;
+
+    std::sort(catalogNumberIndex.begin(), catalogNumberIndex.end(),
+              [&octree](std::uint32_t idx0, std::uint32_t idx1)
+              {
+                  return (*octree)[idx0].catNo < (*octree)[idx1].catNo;
+              });
+
+    return writeStarsDatV2(out, *octree, catalogNumberIndex);
+}
+
+void
+StarDatabaseBuilder::addBinaryStars(const char* ptr, std::uint32_t nRecords)
+{
+    prebuiltIsValid = false;
+    unsortedStars.reserve(unsortedStars.size() + nRecords);
+    for (std::uint32_t i = 0; i < nRecords; ++i, ptr += sizeof(StarsDatRecord))
+    {
+        auto catNo = util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(StarsDatRecord, catNo));
+        Eigen::Vector3f position(util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, x)),
+                                 util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, y)),
+                                 util::fromMemoryLE<float>(ptr + offsetof(StarsDatRecord, z)));
+        auto absMag = util::fromMemoryLE<std::int16_t>(ptr + offsetof(StarsDatRecord, absMag));
+        auto spectralType = util::fromMemoryLE<std::uint16_t>(ptr + offsetof(StarsDatRecord, spectralType));
+
+        boost::intrusive_ptr<StarDetails> details = nullptr;
+        if (StellarClass sc; sc.unpackV1(spectralType))
+            details = StarDetails::GetStarDetails(sc);
+
+        if (details == nullptr)
+        {
+            GetLogger()->error(_("Bad spectral type in star database, star #{}\n"), catNo);
+            continue;
+        }
+
+        Star& star = unsortedStars.emplace_back(catNo, details);
+        star.setPosition(position);
+        star.setAbsoluteMagnitude(static_cast<float>(absMag) / 256.0f);
+    }
+}
+
+/*! Read the body of a version 2 stars.dat: the star records in octree order,
+ *  followed by the octree nodes and the catalog number index. The octree is
+ *  only kept if this is the first star data loaded; otherwise the stars are
+ *  added to the unsorted set and the octree is rebuilt in finish().
+ */
+bool
+StarDatabaseBuilder::loadPrebuiltOctree(const char* data, std::uint32_t nStars, std::uint32_t nNodes)
+{
+    const char* records = data;
+    const char* nodes = records + static_cast<std::size_t>(nStars) * sizeof(StarsDatRecord);
+    const char* index = nodes + static_cast<std::size_t>(nNodes) * sizeof(StarsDatNode);
+
+    bool usePrebuilt = unsortedStars.empty() && prebuiltStars.empty();
+    std::vector<Star> stars;
+    stars.reserve(nStars);
+
+    for (std::uint32_t i = 0; i < nStars; ++i, records += sizeof(StarsDatRecord))
+    {
+        auto catNo = util::fromMemoryLE<AstroCatalog::IndexNumber>(records + offsetof(StarsDatRecord, catNo));
+        auto spectralType = util::fromMemoryLE<std::uint16_t>(records + offsetof(StarsDatRecord, spectralType));
+
+        boost::intrusive_ptr<StarDetails> details = nullptr;
+        if (StellarClass sc; sc.unpackV2(spectralType))
+            details = StarDetails::GetStarDetails(sc);
+
+        // Dropping a star would invalidate the octree object ranges
+        if (details == nullptr)
+        {
+            GetLogger()->error(_("Bad spectral type in star database, star #{}\n"), catNo);
+            return false;
+        }
+
+        Star& star = stars.emplace_back(catNo, details);
+        star.setPosition(Eigen::Vector3f(util::fromMemoryLE<float>(records + offsetof(StarsDatRecord, x)),
+                                         util::fromMemoryLE<float>(records + offsetof(StarsDatRecord, y)),
+                                         util::fromMemoryLE<float>(records + offsetof(StarsDatRecord, z))));
+        star.setAbsoluteMagnitude(static_cast<float>(util::fromMemoryLE<std::int16_t>(records + offsetof(StarsDatRecord, absMag))) / 256.0f);
+    }
+
+    if (!usePrebuilt)
+    {
+        unsortedStars.reserve(unsortedStars.size() + stars.size());
+        for (Star& star : stars)
+            unsortedStars.emplace_back(std::move(star));
+        prebuiltIsValid = false;
+        return true;
+    }
+
+    std::vector<engine::StarOctree::NodeType> octreeNodes;
+    if (!engine::readStarsDatNodes(nodes, nNodes, nStars, octreeNodes))
         return false;
 
+    std::vector<std::uint32_t> catalogNumberIndex;
+    catalogNumberIndex.reserve(nStars);
+    for (std::uint32_t i = 0; i < nStars; ++i, index += sizeof(std::uint32_t))
+    {
+        auto idx = util::fromMemoryLE<std::uint32_t>(index);
+        if (idx >= nStars || (i > 0 && stars[idx].getIndex() < stars[catalogNumberIndex.back()].getIndex()))
+        {
+            GetLogger()->error(_("Bad catalog number index in star database\n"));
+            return false;
+        }
+
+        catalogNumberIndex.push_back(idx);
+    }
+
+    prebuiltStars = std::move(stars);
+    prebuiltNodes = std::move(octreeNodes);
+    prebuiltIndex = std::move(catalogNumberIndex);
+    prebuiltIsValid = true;
+    return true;
+}
+
+void
+StarDatabaseBuilder::indexBinaryStars(std::uint32_t nStarsInFile, const Timer& timer)
+{
     auto loadTime = timer.getTime();
 
     GetLogger()->debug("StarDatabase::read: nStars = {}, time = {} ms\n", nStarsInFile, loadTime);
-    GetLogger()->info(_("{} stars in binary database\n"), unsortedStars.size());
+    GetLogger()->info(_("{} stars in binary database\n"), unsortedStars.size() + prebuiltStars.size());
 
     // Create the temporary list of stars sorted by catalog number; this
     // will be used to lookup stars during file loading. After loading is
     // complete, the stars are sorted into an octree and this list gets
     // replaced.
-    binFileCatalogNumberIndex.reserve(unsortedStars.size());
-    for (Star& star : unsortedStars)
+    binFileCatalogNumberIndex.clear();
+    binFileCatalogNumberIndex.reserve(unsortedStars.size() + prebuiltStars.size());
+    if (prebuiltIsValid)
+    {
+        // The prebuilt catalog number index is already sorted
+        for (std::uint32_t idx : prebuiltIndex)
+            binFileCatalogNumberIndex.push_back(&prebuiltStars[idx]);
+        return;
+    }
+
+    for (Star& star : prebuiltStars)
         binFileCatalogNumberIndex.push_back(&star);
+    unsortedStars.forEachBlock([this](Star* stars, std::size_t count)
+    {
+        for (Star* star = stars; star != stars + count; ++star)
+            binFileCatalogNumberIndex.push_back(star);
+    });
 
     std::sort(binFileCatalogNumberIndex.begin(), binFileCatalogNumberIndex.end(),
                 [](const Star* star0, const Star* star1) { return star0->getIndex() < star1->getIndex(); });
-
-    return true;
 }
 
 /*! Load an STC file with star definitions. Each definition has the form:
@@ -684,35 +1097,114 @@ StarDatabaseBuilder::loadBinary(std::istream& in)
  *  Modify <name>     : error
  *  Modify <number>   : error
  */
+struct StarDatabaseBuilder::ParsedCatalog::Definition
+{
+    explicit Definition(const StcHeader& _header) : header(_header) {}
+
+    StcHeader header;
+    // Null for the stars read into flatData
+    Value starData;
+    std::optional<FlatStarData> flatData;
+};
+
+StarDatabaseBuilder::ParsedCatalog::ParsedCatalog() = default;
+StarDatabaseBuilder::ParsedCatalog::~ParsedCatalog() = default;
+StarDatabaseBuilder::ParsedCatalog::ParsedCatalog(ParsedCatalog&&) noexcept = default;
+StarDatabaseBuilder::ParsedCatalog& StarDatabaseBuilder::ParsedCatalog::operator=(ParsedCatalog&&) noexcept = default;
+
 bool
 StarDatabaseBuilder::load(std::istream& in, const fs::path& resourcePath)
+{
+    return merge(parse(in, resourcePath));
+}
+
+/*! Tokenize and parse the star definitions of an stc file without adding
+ *  them to the database. If an error is found, the definitions before it
+ *  are kept and merge() reports the error after applying them, as load()
+ *  would.
+ */
+StarDatabaseBuilder::ParsedCatalog
+StarDatabaseBuilder::parse(std::istream& in, const fs::path& resourcePath)
 {
     Tokenizer tokenizer(&in);
+    return parse(tokenizer, resourcePath);
+}
+
+StarDatabaseBuilder::ParsedCatalog
+StarDatabaseBuilder::parse(Tokenizer& tokenizer, const fs::path& resourcePath)
+{
+    ParsedCatalog catalog;
+    catalog.resourcePath = resourcePath;
+
     Parser parser(&tokenizer);
 
+    StcHeader header(catalog.resourcePath);
+    while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+    {
+        if (!parseStcHeader(tokenizer, header, catalog.error))
+            break;
+
+        // now goes the star definition
+        tokenizer.pushBack();
+
+        // Modify and Barycenter definitions are left to the generic path
+        bool flatCandidate = header.isStar && header.disposition != DataDisposition::Modify;
+        if (flatCandidate && tokenizer.nextToken() != Tokenizer::TokenBeginGroup)
+        {
+            tokenizer.pushBack();
+            flatCandidate = false;
+        }
+
+        Value starDataValue;
+        std::optional<FlatStarData> flatData;
+        if (flatCandidate)
+        {
+            FlatStarData flat;
+            if (readFlatStar(tokenizer, parser, flat, starDataValue))
+                flatData = std::move(flat);
+        }
+        else
+        {
+            starDataValue = parser.readValue();
+        }
+
+        if (!flatData.has_value() && starDataValue.getHash() == nullptr)
+        {
+            int lineNumber = tokenizer.getLineNumber();
+            catalog.error = fmt::vformat(_("Bad star definition at line {}.\n"),
+                                         fmt::make_format_args(lineNumber));
+            break;
+        }
+
+        auto& definition = catalog.definitions.emplace_back(header);
+        definition.starData = std::move(starDataValue);
+        definition.flatData = std::move(flatData);
+    }
+
+    return catalog;
+}
+
+/*! Add the definitions of a parsed stc file to the database. The catalog
+ *  number lookups, overrides and names are resolved here, in the order the
+ *  files are merged.
+ */
+bool
+StarDatabaseBuilder::merge(ParsedCatalog&& catalog)
+{
 #ifdef ENABLE_NLS
-    std::string domain = resourcePath.string();
+    std::string domain = catalog.resourcePath.string();
     const char *d = domain.c_str();
     bindtextdomain(d, d); // domain name is the same as resource path
 #else
     std::string domain;
 #endif
 
-    StcHeader header(resourcePath);
-    while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+    for (auto& definition : catalog.definitions)
     {
-        if (!parseStcHeader(tokenizer, header))
-            return false;
-
-        // now goes the star definition
-        tokenizer.pushBack();
-        const Value starDataValue = parser.readValue();
-        const Hash* starData = starDataValue.getHash();
-        if (starData == nullptr)
-        {
-            GetLogger()->error(_("Bad star definition at line {}.\n"), tokenizer.getLineNumber());
-            return false;
-        }
+        StcHeader& header = definition.header;
+        // The catalog may have been moved since it was parsed
+        header.path = &catalog.resourcePath;
+        const Hash* starData = definition.starData.getHash();
 
         if (header.disposition != DataDisposition::Add && header.catalogNumber == AstroCatalog::InvalidIndex)
             header.catalogNumber = starDB->namesDB->findCatalogNumberByName(header.names.front(), false);
@@ -733,19 +1225,34 @@ StarDatabaseBuilder::load(std::istream& in, const fs::path& resourcePath)
             }
         }
 
-        if (createOrUpdateStar(header, starData, star))
+        if (definition.flatData.has_value())
+        {
+            if (!createOrUpdateStar(header, *definition.flatData, star))
+                continue;
+        }
+        else if (createOrUpdateStar(header, starData, star))
         {
             loadCategories(header, starData, domain);
+        }
+        else
+        {
+            continue;
+        }
 
-            if (!header.names.empty())
-            {
-                starDB->namesDB->erase(header.catalogNumber);
-                for (const auto& name : header.names)
-                    starDB->namesDB->add(header.catalogNumber, name);
-            }
+        if (!header.names.empty())
+        {
+            starDB->namesDB->erase(header.catalogNumber);
+            for (const auto& name : header.names)
+                starDB->namesDB->add(header.catalogNumber, name);
         }
     }
 
+    if (!catalog.error.empty())
+    {
+        GetLogger()->error("{}", catalog.error);
+        return false;
+    }
+
     return true;
 }
 
@@ -758,10 +1265,29 @@ StarDatabaseBuilder::setNameDatabase(std::unique_ptr<StarNameDatabase>&& nameDB)
 std::unique_ptr<StarDatabase>
 StarDatabaseBuilder::finish()
 {
-    GetLogger()->info(_("Total star count: {}\n"), unsortedStars.size());
+    GetLogger()->info(_("Total star count: {}\n"), unsortedStars.size() + prebuiltStars.size());
+
+    {
+        util::TraceScope trace("Build star octree");
+        trace.addArg("stars", unsortedStars.size() + prebuiltStars.size());
+        trace.addArg("prebuilt", prebuiltIsValid ? 1 : 0);
+        if (prebuiltIsValid)
+        {
+            GetLogger()->debug("Using prebuilt star octree with {} nodes.\n", prebuiltNodes.size());
+            starDB->octreeRoot = std::make_unique<engine::StarOctree>(std::move(prebuiltNodes),
+                                                                      std::move(prebuiltStars));
+            prebuiltIndex = std::vector<std::uint32_t>();
+        }
+        else
+        {
+            buildOctree();
+        }
+    }
 
-    buildOctree();
-    buildIndexes();
+    {
+        util::TraceScope trace("Build star indexes");
+        buildIndexes();
+    }
 
     // Resolve all barycenters; this can't be done before star sorting. There's
     // still a bug here: final orbital radii aren't available until after
@@ -787,6 +1313,9 @@ StarDatabaseBuilder::finish()
         UserCategory::addObject(star, category);
     }
 
+    // Orbits are final only once the barycenters have been resolved
+    starDB->buildRenderRecords();
+
     return std::move(starDB);
 }
 
@@ -823,6 +1352,9 @@ StarDatabaseBuilder::createOrUpdateStar(const StcHeader& header,
     if (!checkMagnitudes(header, starData, star, distance, absMagnitude, extinction))
         return false;
 
+    // Any change to the star set may alter the octree structure
+    prebuiltIsValid = false;
+
     if (star == nullptr)
     {
         assert(newDetails != nullptr);
@@ -860,6 +1392,63 @@ StarDatabaseBuilder::createOrUpdateStar(const StcHeader& header,
     return true;
 }
 
+/*! Add or replace a star read into FlatStarData. This gives the same star
+ *  as the generic path for a definition with these properties only.
+ */
+bool
+StarDatabaseBuilder::createOrUpdateStar(const StcHeader& header,
+                                        const FlatStarData& flat,
+                                        Star* star)
+{
+    boost::intrusive_ptr<StarDetails> newDetails = StarDetails::GetStarDetails(StellarClass::parse(flat.spectralType));
+    if (newDetails == nullptr)
+    {
+        stcError(header, _("invalid SpectralType"));
+        return false;
+    }
+
+    // RA is in degrees unless units are given
+    Eigen::Vector3f position = astro::equatorialToCelestialCart(flat.values[FlatStarData::RA] / astro::DEG_PER_HRA,
+                                                                flat.values[FlatStarData::Dec],
+                                                                flat.values[FlatStarData::Distance]).cast<float>();
+    float distance = position.norm();
+
+    float absMagnitude;
+    if (flat.has(FlatStarData::AbsMag))
+    {
+        if (flat.has(FlatStarData::AppMag))
+            stcWarn(header, _("AppMag ignored when AbsMag is supplied"));
+        absMagnitude = static_cast<float>(flat.values[FlatStarData::AbsMag]);
+    }
+    else if (distance < VALID_APPMAG_DISTANCE_THRESHOLD)
+    {
+        stcError(header, _("AppMag cannot be used close to the origin"));
+        return false;
+    }
+    else
+    {
+        absMagnitude = astro::appToAbsMag(static_cast<float>(flat.values[FlatStarData::AppMag]), distance);
+    }
+
+    // Any change to the star set may alter the octree structure
+    prebuiltIsValid = false;
+
+    if (star == nullptr)
+    {
+        star = &unsortedStars.emplace_back(header.catalogNumber, newDetails);
+        stcFileCatalogNumberIndex[header.catalogNumber] = star;
+    }
+    else
+    {
+        star->details = newDetails;
+    }
+
+    star->setPosition(position);
+    star->setAbsoluteMagnitude(absMagnitude);
+    barycenters.erase(header.catalogNumber);
+    return true;
+}
+
 bool
 StarDatabaseBuilder::checkStcPosition(const StarDatabaseBuilder::StcHeader& header,
                                       const AssociativeArray* starData,
@@ -1063,19 +1652,20 @@ StarDatabaseBuilder::buildOctree()
 {
     // This should only be called once for the database
     GetLogger()->debug("Sorting stars into octree . . .\n");
-    auto starCount = static_cast<engine::OctreeObjectIndex>(unsortedStars.size());
 
-    float absMag = astro::appToAbsMag(STAR_OCTREE_MAGNITUDE,
-                                      StarDatabase::STAR_OCTREE_ROOT_SIZE * celestia::numbers::sqrt3_v<float>);
+    // Stars loaded from a prebuilt octree need to be re-sorted along with
+    // the stars from stc files.
+    for (Star& star : prebuiltStars)
+        unsortedStars.emplace_back(std::move(star));
 
-    auto root = engine::makeDynamicOctree<StarOctreeTraits>(std::move(unsortedStars),
-                                                            Eigen::Vector3f(1000.0f, 1000.0f, 1000.0f),
-                                                            StarDatabase::STAR_OCTREE_ROOT_SIZE,
-                                                            absMag,
-                                                            StarOctreeSplitThreshold);
+    prebuiltStars = std::vector<Star>();
+    prebuiltNodes = std::vector<engine::StarOctree::NodeType>();
+    prebuiltIndex = std::vector<std::uint32_t>();
+
+    auto starCount = static_cast<engine::OctreeObjectIndex>(unsortedStars.size());
 
     GetLogger()->debug("Spatially sorting stars for improved locality of reference . . .\n");
-    starDB->octreeRoot = root->build();
+    starDB->octreeRoot = buildStarOctree<StarOctreeTraits>(std::move(unsortedStars));
 
     GetLogger()->debug("{} stars total\nOctree has {} nodes and {} stars.\n",
                        starCount,
@@ -1088,22 +1678,13 @@ StarDatabaseBuilder::buildOctree()
 void
 StarDatabaseBuilder::buildIndexes()
 {
-    // This should only be called once for the database
-    // assert(catalogNumberIndexes[0] == nullptr);
-
     GetLogger()->info("Building catalog number indexes . . .\n");
 
-    auto nStars = starDB->octreeRoot->size();
-
-    starDB->catalogNumberIndex.clear();
-    starDB->catalogNumberIndex.reserve(nStars);
-    for (std::uint32_t i = 0; i < nStars; ++i)
-        starDB->catalogNumberIndex.push_back(i);
-
+    // Stars are inserted in octree order, so for duplicate catalog numbers
+    // the first star in the octree is found.
     const auto& octreeRoot = *starDB->octreeRoot;
-    std::sort(starDB->catalogNumberIndex.begin(), starDB->catalogNumberIndex.end(),
-              [&octreeRoot](std::uint32_t idx0, std::uint32_t idx1)
-              {
-                  return octreeRoot[idx0].getIndex() < octreeRoot[idx1].getIndex();
-              });
+    auto nStars = octreeRoot.size();
+    starDB->catalogNumberIndex.reset(nStars);
+    for (std::uint32_t i = 0; i < nStars; ++i)
+        starDB->catalogNumberIndex.insert(octreeRoot[i].getIndex(), i);
 }
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <iosfwd>
 #include <map>
 #include <memory>
@@ -30,6 +31,8 @@
 
 class AssociativeArray;
 class StarDatabase;
+class Timer;
+class Tokenizer;
 
 namespace celestia::ephem
 {
@@ -47,17 +50,63 @@ public:
     StarDatabaseBuilder(StarDatabaseBuilder&&) noexcept = delete;
     StarDatabaseBuilder& operator=(StarDatabaseBuilder&&) noexcept = delete;
 
+    // Star definitions read from an stc file. Parsing does not access the
+    // database, so several files may be parsed concurrently; the definitions
+    // are then applied in file order by merge().
+    class ParsedCatalog
+    {
+    public:
+        ParsedCatalog();
+        ~ParsedCatalog();
+        ParsedCatalog(const ParsedCatalog&) = delete;
+        ParsedCatalog& operator=(const ParsedCatalog&) = delete;
+        ParsedCatalog(ParsedCatalog&&) noexcept;
+        ParsedCatalog& operator=(ParsedCatalog&&) noexcept;
+
+    private:
+        struct Definition;
+
+        fs::path resourcePath;
+        std::vector<Definition> definitions;
+        // Set if parsing stopped early; logged by merge()
+        std::string error;
+
+        friend class StarDatabaseBuilder;
+    };
+
     bool load(std::istream&, const fs::path& resourcePath = fs::path());
+    static ParsedCatalog parse(std::istream&, const fs::path& resourcePath = fs::path());
+    static ParsedCatalog parse(Tokenizer&, const fs::path& resourcePath = fs::path());
+    bool merge(ParsedCatalog&&);
     bool loadBinary(std::istream&);
+    bool loadBinary(const fs::path&);
+
+    static bool convertBinary(std::istream&, std::ostream&);
+
+    // A star record of a version 2 stars.dat, with the absolute magnitude in
+    // units of 1/256 and the spectral type packed by StellarClass::packV2()
+    struct BinaryStar
+    {
+        AstroCatalog::IndexNumber catNo;
+        Eigen::Vector3f position;
+        std::int16_t absMag;
+        std::uint16_t spectralType;
+    };
+
+    // Sort the stars into octree order and write them with the octree and
+    // the catalog number index as a version 2 stars.dat
+    static bool writeBinary(std::ostream&, std::vector<BinaryStar>&&);
 
     void setNameDatabase(std::unique_ptr<StarNameDatabase>&&);
 
     std::unique_ptr<StarDatabase> finish();
 
     struct StcHeader;
+    struct FlatStarData;
 
 private:
     bool createOrUpdateStar(const StcHeader&, const AssociativeArray*, Star*);
+    bool createOrUpdateStar(const StcHeader&, const FlatStarData&, Star*);
     bool checkStcPosition(const StcHeader&,
                           const AssociativeArray*,
                           const Star*,
@@ -76,6 +125,10 @@ private:
                      const std::string& name,
                      const std::string& domain);
 
+    void addBinaryStars(const char*, std::uint32_t);
+    bool loadPrebuiltOctree(const char*, std::uint32_t, std::uint32_t);
+    void indexBinaryStars(std::uint32_t, const Timer&);
+
     void buildOctree();
     void buildIndexes();
     Star* findWhileLoading(AstroCatalog::IndexNumber catalogNumber) const;
@@ -91,4 +144,12 @@ private:
     std::map<AstroCatalog::IndexNumber, Star*> stcFileCatalogNumberIndex;
     std::map<AstroCatalog::IndexNumber, AstroCatalog::IndexNumber> barycenters;
     std::multimap<AstroCatalog::IndexNumber, UserCategoryId> categories;
+
+    // Stars, octree and catalog number index from a version 2 stars.dat.
+    // These are used directly by finish() unless further stars are added or
+    // modified, in which case the octree gets rebuilt.
+    std::vector<Star> prebuiltStars;
+    std::vector<celestia::engine::StarOctree::NodeType> prebuiltNodes;
+    std::vector<std::uint32_t> prebuiltIndex;
+    bool prebuiltIsValid{ false };
 };
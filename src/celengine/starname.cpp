@@ -16,12 +16,15 @@
 #include <cassert>
 #include <cctype>
 #include <cstddef>
+#include <fstream>
 #include <istream>
 #include <iterator>
 #include <optional>
 #include <string>
 #include <system_error>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <fmt/format.h>
 
@@ -46,6 +49,10 @@ namespace
 
 constexpr std::string_view CROSSINDEX_MAGIC = "CELINDEX"sv;
 constexpr std::uint16_t CrossIndexVersion   = 0x0100;
+// Version 2 files hold the records sorted by catalog number, then sorted by
+// Celestia catalog number without duplicates, so that they may be searched
+// where they are mapped
+constexpr std::uint16_t SortedCrossIndexVersion = 0x0200;
 
 constexpr std::string_view HDCatalogPrefix        = "HD "sv;
 constexpr std::string_view HIPPARCOSCatalogPrefix = "HIP "sv;
@@ -82,10 +89,23 @@ struct CrossIndexRecord
     std::uint32_t celCatalogNumber;
 };
 
+// sorted cross-index header structure, followed by the records in both
+// orders
+struct SortedCrossIndexHeader
+{
+    SortedCrossIndexHeader() = delete;
+    char magic[8]; //NOSONAR
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint32_t toCelestiaCount;
+    std::uint32_t fromCelestiaCount;
+};
+
 #pragma pack(pop)
 
 static_assert(std::is_standard_layout_v<CrossIndexHeader>);
 static_assert(std::is_standard_layout_v<CrossIndexRecord>);
+static_assert(std::is_standard_layout_v<SortedCrossIndexHeader>);
 
 constexpr unsigned int FIRST_NUMBERED_VARIABLE = 335;
 
@@ -269,30 +289,63 @@ parseCelestiaCatalogNumber(std::string_view name,
     return false;
 }
 
-// Verify that the cross index file has a correct header
-bool
-checkCrossIndexHeader(std::istream& in)
+// Verify that the cross index file has a correct header and return its
+// version, or zero
+std::uint16_t
+checkCrossIndexHeader(const char* header)
 {
-    std::array<char, sizeof(CrossIndexHeader)> header;
-    if (!in.read(header.data(), header.size()).good()) /* Flawfinder: ignore */
-        return false;
-
     // Verify the magic string
-    if (std::string_view(header.data() + offsetof(CrossIndexHeader, magic), CROSSINDEX_MAGIC.size()) != CROSSINDEX_MAGIC)
+    if (std::string_view(header + offsetof(CrossIndexHeader, magic), CROSSINDEX_MAGIC.size()) != CROSSINDEX_MAGIC)
     {
         GetLogger()->error(_("Bad header for cross index\n"));
-        return false;
+        return 0;
     }
 
     // Verify the version
-    if (auto version = util::fromMemoryLE<std::uint16_t>(header.data() + offsetof(CrossIndexHeader, version));
-        version != CrossIndexVersion)
+    auto version = util::fromMemoryLE<std::uint16_t>(header + offsetof(CrossIndexHeader, version));
+    if (version != CrossIndexVersion && version != SortedCrossIndexVersion)
     {
         GetLogger()->error(_("Bad version for cross index\n"));
-        return false;
+        return 0;
     }
 
-    return true;
+    return version;
+}
+
+// Search records sorted by the number at keyOffset for a key, and return
+// the number at valueOffset of the record found
+AstroCatalog::IndexNumber
+findSortedRecord(const char* records,
+                 std::uint32_t count,
+                 AstroCatalog::IndexNumber key,
+                 std::size_t keyOffset,
+                 std::size_t valueOffset)
+{
+    auto keyAt = [records, keyOffset](std::uint32_t i)
+    {
+        return util::fromMemoryLE<AstroCatalog::IndexNumber>(records + i * sizeof(CrossIndexRecord) + keyOffset);
+    };
+
+    std::uint32_t first = 0;
+    std::uint32_t length = count;
+    while (length > 0)
+    {
+        std::uint32_t half = length / 2;
+        if (keyAt(first + half) < key)
+        {
+            first += half + 1;
+            length -= half + 1;
+        }
+        else
+        {
+            length = half;
+        }
+    }
+
+    if (first == count || keyAt(first) != key)
+        return AstroCatalog::InvalidIndex;
+
+    return util::fromMemoryLE<AstroCatalog::IndexNumber>(records + first * sizeof(CrossIndexRecord) + valueOffset);
 }
 
 } // end unnamed namespace
@@ -331,11 +384,14 @@ StarNameDatabase::searchCrossIndexForCatalogNumber(StarCatalog catalog, AstroCat
         return AstroCatalog::InvalidIndex;
 
     const CrossIndex& xindex = crossIndices[catalogIndex];
-    auto iter = std::lower_bound(xindex.begin(), xindex.end(), number,
-                                 [](const CrossIndexEntry& ent, AstroCatalog::IndexNumber n) { return ent.catalogNumber < n; });
-    return iter == xindex.end() || iter->catalogNumber != number
-        ? AstroCatalog::InvalidIndex
-        : iter->celCatalogNumber;
+    if (xindex.file != nullptr)
+    {
+        return findSortedRecord(xindex.toCelestiaRecords, xindex.toCelestiaCount, number,
+                                offsetof(CrossIndexRecord, catalogNumber),
+                                offsetof(CrossIndexRecord, celCatalogNumber));
+    }
+
+    return xindex.toCelestia.find(number);
 }
 
 AstroCatalog::IndexNumber
@@ -346,14 +402,35 @@ StarNameDatabase::crossIndex(StarCatalog catalog, AstroCatalog::IndexNumber celC
         return AstroCatalog::InvalidIndex;
 
     const CrossIndex& xindex = crossIndices[catalogIndex];
+    if (xindex.file != nullptr)
+    {
+        return findSortedRecord(xindex.fromCelestiaRecords, xindex.fromCelestiaCount, celCatalogNumber,
+                                offsetof(CrossIndexRecord, celCatalogNumber),
+                                offsetof(CrossIndexRecord, catalogNumber));
+    }
+
+    return xindex.fromCelestia.find(celCatalogNumber);
+}
+
+std::size_t
+StarNameDatabase::getCrossIndexMemoryUsage() const
+{
+    std::size_t size = 0;
+    for (const CrossIndex& xindex : crossIndices)
+        size += xindex.toCelestia.getMemoryUsage() + xindex.fromCelestia.getMemoryUsage();
+    return size;
+}
 
-    // A simple linear search.  We could store cross indices sorted by
-    // both catalog numbers and trade memory for speed
-    auto iter = std::find_if(xindex.begin(), xindex.end(),
-                             [celCatalogNumber](const CrossIndexEntry& o) { return celCatalogNumber == o.celCatalogNumber; });
-    return iter == xindex.end()
-        ? AstroCatalog::InvalidIndex
-        : iter->catalogNumber;
+std::size_t
+StarNameDatabase::getCrossIndexMappedSize() const
+{
+    std::size_t size = 0;
+    for (const CrossIndex& xindex : crossIndices)
+    {
+        if (xindex.file != nullptr)
+            size += xindex.file->size();
+    }
+    return size;
 }
 
 AstroCatalog::IndexNumber
@@ -569,12 +646,31 @@ StarNameDatabase::loadCrossIndex(StarCatalog catalog, std::istream& in)
     if (catalogIndex >= crossIndices.size())
         return false;
 
-    if (!checkCrossIndexHeader(in))
+    std::array<char, sizeof(SortedCrossIndexHeader)> header;
+    if (!in.read(header.data(), sizeof(CrossIndexHeader)).good()) /* Flawfinder: ignore */
         return false;
 
+    std::uint16_t version = checkCrossIndexHeader(header.data());
+    if (version == 0)
+        return false;
+
+    std::uint32_t toCelestiaCount = 0;
+    std::uint32_t fromCelestiaCount = 0;
+    if (version == SortedCrossIndexVersion)
+    {
+        if (!in.read(header.data() + sizeof(CrossIndexHeader), sizeof(SortedCrossIndexHeader) - sizeof(CrossIndexHeader)).good()) /* Flawfinder: ignore */
+            return false;
+
+        toCelestiaCount = util::fromMemoryLE<std::uint32_t>(header.data() + offsetof(SortedCrossIndexHeader, toCelestiaCount));
+        fromCelestiaCount = util::fromMemoryLE<std::uint32_t>(header.data() + offsetof(SortedCrossIndexHeader, fromCelestiaCount));
+    }
+
     CrossIndex& xindex = crossIndices[catalogIndex];
     xindex = {};
 
+    // Pairs of catalog number and Celestia catalog number
+    std::vector<std::pair<AstroCatalog::IndexNumber, AstroCatalog::IndexNumber>> entries;
+
     constexpr std::uint32_t BUFFER_RECORDS = UINT32_C(4096) / sizeof(CrossIndexRecord);
     std::vector<char> buffer(sizeof(CrossIndexRecord) * BUFFER_RECORDS);
     bool hasMoreRecords = true;
@@ -585,7 +681,6 @@ StarNameDatabase::loadCrossIndex(StarCatalog catalog, std::istream& in)
         if (in.bad())
         {
             GetLogger()->error(_("Loading cross index failed\n"));
-            xindex = {};
             return false;
         }
         if (in.eof())
@@ -596,28 +691,94 @@ StarNameDatabase::loadCrossIndex(StarCatalog catalog, std::istream& in)
             if (bytesRead % sizeof(CrossIndexRecord) != 0)
             {
                 GetLogger()->error(_("Loading cross index failed - unexpected EOF\n"));
-                xindex = {};
                 return false;
             }
 
             hasMoreRecords = false;
         }
 
-        xindex.reserve(xindex.size() + remainingRecords);
-
         const char* ptr = buffer.data();
         while (remainingRecords-- > 0)
         {
-            CrossIndexEntry& ent = xindex.emplace_back();
-            ent.catalogNumber = util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(CrossIndexRecord, catalogNumber));
-            ent.celCatalogNumber = util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(CrossIndexRecord, celCatalogNumber));
+            entries.emplace_back(util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(CrossIndexRecord, catalogNumber)),
+                                 util::fromMemoryLE<AstroCatalog::IndexNumber>(ptr + offsetof(CrossIndexRecord, celCatalogNumber)));
             ptr += sizeof(CrossIndexRecord);
         }
     }
 
     GetLogger()->debug("Loaded xindex in {} ms\n", timer.getTime());
 
-    std::sort(xindex.begin(), xindex.end(),
-              [](const auto& lhs, const auto& rhs) { return lhs.catalogNumber < rhs.catalogNumber; });
+    if (version == SortedCrossIndexVersion)
+    {
+        // The records of both tables are already without duplicates
+        if (entries.size() != static_cast<std::size_t>(toCelestiaCount) + fromCelestiaCount)
+        {
+            GetLogger()->error(_("Loading cross index failed - unexpected EOF\n"));
+            return false;
+        }
+
+        xindex.toCelestia.reset(toCelestiaCount);
+        xindex.fromCelestia.reset(fromCelestiaCount);
+        for (std::uint32_t i = 0; i < toCelestiaCount; ++i)
+            xindex.toCelestia.insert(entries[i].first, entries[i].second);
+        for (std::size_t i = toCelestiaCount; i < entries.size(); ++i)
+            xindex.fromCelestia.insert(entries[i].second, entries[i].first);
+
+        return true;
+    }
+
+    // For duplicate entries, the lookups in both directions return the one
+    // with the lowest catalog number
+    std::sort(entries.begin(), entries.end());
+
+    xindex.toCelestia.reset(entries.size());
+    xindex.fromCelestia.reset(entries.size());
+    for (const auto& [catalogNumber, celCatalogNumber] : entries)
+    {
+        xindex.toCelestia.insert(catalogNumber, celCatalogNumber);
+        xindex.fromCelestia.insert(celCatalogNumber, catalogNumber);
+    }
+
     return true;
 }
+
+bool
+StarNameDatabase::loadCrossIndex(StarCatalog catalog, const fs::path& path)
+{
+    auto catalogIndex = static_cast<std::size_t>(catalog);
+    if (catalogIndex >= crossIndices.size())
+        return false;
+
+    // Sorted cross indexes are used where they are mapped, without reading
+    // them, and their pages are shared with other processes
+    if (auto file = util::MappedFile::open(path);
+        file != nullptr &&
+        file->size() >= sizeof(CrossIndexHeader) &&
+        util::fromMemoryLE<std::uint16_t>(file->data() + offsetof(CrossIndexHeader, version)) == SortedCrossIndexVersion)
+    {
+        if (file->size() < sizeof(SortedCrossIndexHeader) || checkCrossIndexHeader(file->data()) == 0)
+            return false;
+
+        const char* data = file->data();
+        auto toCelestiaCount = util::fromMemoryLE<std::uint32_t>(data + offsetof(SortedCrossIndexHeader, toCelestiaCount));
+        auto fromCelestiaCount = util::fromMemoryLE<std::uint32_t>(data + offsetof(SortedCrossIndexHeader, fromCelestiaCount));
+        if (file->size() != sizeof(SortedCrossIndexHeader) +
+                            (static_cast<std::size_t>(toCelestiaCount) + fromCelestiaCount) * sizeof(CrossIndexRecord))
+        {
+            GetLogger()->error(_("Loading cross index failed - unexpected EOF\n"));
+            return false;
+        }
+
+        CrossIndex& xindex = crossIndices[catalogIndex];
+        xindex = {};
+        xindex.toCelestiaRecords = data + sizeof(SortedCrossIndexHeader);
+        xindex.fromCelestiaRecords = xindex.toCelestiaRecords + toCelestiaCount * sizeof(CrossIndexRecord);
+        xindex.toCelestiaCount = toCelestiaCount;
+        xindex.fromCelestiaCount = fromCelestiaCount;
+        xindex.file = std::move(file);
+        return true;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    return in.good() && loadCrossIndex(catalog, in);
+}
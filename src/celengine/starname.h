@@ -19,7 +19,10 @@
 #include <memory>
 #include <string_view>
 
+#include <celcompat/filesystem.h>
 #include <celengine/name.h>
+#include <celutil/flatindex.h>
+#include <celutil/mappedfile.h>
 
 enum class StarCatalog : unsigned int
 {
@@ -53,19 +56,37 @@ public:
     AstroCatalog::IndexNumber crossIndex(StarCatalog, AstroCatalog::IndexNumber number) const;
 
     bool loadCrossIndex(StarCatalog, std::istream&);
+    // Sorted cross indexes are mapped and searched in place, others are
+    // read from the file
+    bool loadCrossIndex(StarCatalog, const fs::path&);
     static std::unique_ptr<StarNameDatabase> readNames(std::istream&);
 
+    using NameDatabase::getMemoryUsage;
+    // Memory used by the cross index tables read into memory, and size of
+    // the mapped cross index files
+    std::size_t getCrossIndexMemoryUsage() const;
+    std::size_t getCrossIndexMappedSize() const;
+
 private:
     static constexpr auto NumCatalogs = static_cast<std::size_t>(StarCatalog::_CatalogCount);
 
-    struct CrossIndexEntry
+    struct CrossIndex
     {
-        AstroCatalog::IndexNumber catalogNumber;
-        AstroCatalog::IndexNumber celCatalogNumber;
+        // Catalog number to Celestia catalog number
+        celestia::util::FlatIndex toCelestia;
+        // Celestia catalog number to catalog number
+        celestia::util::FlatIndex fromCelestia;
+
+        // Set instead of the tables above for a mapped sorted cross index:
+        // the records sorted by catalog number, then by Celestia catalog
+        // number
+        std::unique_ptr<celestia::util::MappedFile> file;
+        const char* toCelestiaRecords{ nullptr };
+        const char* fromCelestiaRecords{ nullptr };
+        std::uint32_t toCelestiaCount{ 0 };
+        std::uint32_t fromCelestiaCount{ 0 };
     };
 
-    using CrossIndex = std::vector<CrossIndexEntry>;
-
     AstroCatalog::IndexNumber findByName(std::string_view, bool) const;
     AstroCatalog::IndexNumber findFlamsteedOrVariable(std::string_view, std::string_view, bool) const;
     AstroCatalog::IndexNumber findBayer(std::string_view, std::string_view, bool) const;
@@ -12,9 +12,13 @@
 
 #include "staroctree.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include <celastro/astro.h>
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
+#include "starcolors.h"
 
 namespace celestia::engine
 {
@@ -34,35 +38,75 @@ constexpr float MAX_STAR_ORBIT_RADIUS = 1.0f;
 
 } // end unnamed namespace
 
-// The version of cppcheck used by Codacy doesn't seem to detect the field initializer
+// Compute the bounding planes of an infinite view frustum
+std::array<Eigen::Hyperplane<float, 3>, 5>
+computeFrustumPlanes(const Eigen::Vector3f& position,
+                     const Eigen::Quaternionf& orientation,
+                     float fovY,
+                     float aspectRatio)
+{
+    Eigen::Matrix3f rot = orientation.toRotationMatrix();
+    float h = std::tan(fovY * 0.5f);
+    float w = h * aspectRatio;
+    std::array<Eigen::Vector3f, 5> planeNormals
+    {
+        Eigen::Vector3f(0.0f, 1.0f, -h),
+        Eigen::Vector3f(0.0f, -1.0f, -h),
+        Eigen::Vector3f(1.0f, 0.0f, -w),
+        Eigen::Vector3f(-1.0f, 0.0f, -w),
+        Eigen::Vector3f(0.0f, 0.0f, -1.0f),
+    };
 
-StarOctreeVisibleObjectsProcessor::StarOctreeVisibleObjectsProcessor(StarHandler* starHandler, // cppcheck-suppress uninitMemberVar
-                                                                     const StarOctree::PointType& obsPosition,
-                                                                     util::array_view<PlaneType> frustumPlanes,
-                                                                     float limitingFactor) :
-    m_starHandler(starHandler),
+    std::array<Eigen::Hyperplane<float, 3>, 5> frustumPlanes;
+    for (unsigned int i = 0U; i < 5U; ++i)
+    {
+        planeNormals[i] = rot.transpose() * planeNormals[i].normalized();
+        frustumPlanes[i] = Eigen::Hyperplane<float, 3>(planeNormals[i], position);
+    }
+
+    return frustumPlanes;
+}
+
+StarRenderRecord
+StarRenderRecord::fromStar(const Star& star)
+{
+    std::uint16_t flags = 0;
+    if (star.getOrbit() != nullptr)
+        flags |= HasOrbit;
+    if (star.getExtinction() != 0.0f)
+        flags |= HasExtinction;
+
+    return StarRenderRecord
+    {
+        star.getPosition(),
+        star.getAbsoluteMagnitude(),
+        ColorTemperatureTable::colorIndex(star.getTemperature()),
+        flags,
+    };
+}
+
+StarOctreeVisibleNodeFilter::StarOctreeVisibleNodeFilter(const StarOctree::PointType& obsPosition, // cppcheck-suppress uninitMemberVar
+                                                         util::array_view<PlaneType> frustumPlanes,
+                                                         float limitingFactor) :
     m_obsPosition(obsPosition),
-    m_frustumPlanes(frustumPlanes),
+    m_frustum(frustumPlanes),
     m_limitingFactor(limitingFactor)
 {
 }
 
 bool
-StarOctreeVisibleObjectsProcessor::checkNode(const StarOctree::PointType& center,
-                                             float size,
-                                             float factor)
+StarOctreeVisibleNodeFilter::checkNode(const StarOctree::PointType& center,
+                                       float size,
+                                       float factor)
 {
+    ++m_stats.nodesVisited;
+
     // See if this node lies within the view frustum
 
-    // Test the cubic octree node against each one of the five
-    // planes that define the infinite view frustum.
-    for (unsigned int i = 0; i < 5; ++i)
-    {
-        const PlaneType& plane = m_frustumPlanes[i];
-        float r = size * plane.normal().cwiseAbs().sum();
-        if (plane.signedDistance(center) < -r)
-            return false;
-    }
+    // Test the cubic octree node against all of the planes that define
+    // the infinite view frustum.
+    if (m_frustum.isCubeOutside(center, size))
+        return false;
 
     // Compute the distance to node; this is equal to the distance to
     // the cellCenterPos of the node minus the boundingRadius of the node, scale * SQRT3.
@@ -75,9 +119,73 @@ StarOctreeVisibleObjectsProcessor::checkNode(const StarOctree::PointType& center
     // Dimmest absolute magnitude to process
     m_dimmest = minDistance > 0 ? (m_limitingFactor - distanceModulus) : 1000;
 
+    ++m_stats.nodesAccepted;
     return true;
 }
 
+StarOctreeVisibleNodeFilter::NodeVisibility
+StarOctreeVisibleNodeFilter::classifyNode(const StarOctree::PointType& center,
+                                          float size,
+                                          float factor,
+                                          float maxTranslation,
+                                          float maxRotation)
+{
+    // The frustum planes pass through the observer, so a rotation moves
+    // them by at most the rotation angle times the distance from the
+    // (translated) observer.
+    float distance = (m_obsPosition - center).norm();
+    float radius = size * numbers::sqrt3_v<float>;
+    float frustumMargin = maxTranslation + maxRotation * (distance + radius + maxTranslation);
+    // Accepted nodes are counted by acceptNode, and boundary nodes by the
+    // checkNode call which follows
+    auto frustum = m_frustum.classifyCube(center, size, frustumMargin);
+    if (frustum == OctreeFrustum<float>::Classification::Outside)
+    {
+        ++m_stats.nodesVisited;
+        return NodeVisibility::Rejected;
+    }
+
+    // The magnitude test is monotonic in the node distance, so evaluate it
+    // at the nearest and farthest distance reachable by the observer.
+    float minDistance = distance - radius;
+    float nearDistance = minDistance - maxTranslation;
+    float farDistance = minDistance + maxTranslation;
+    if (nearDistance > 0.0f && (factor + astro::distanceModulus(nearDistance)) > m_limitingFactor)
+    {
+        ++m_stats.nodesVisited;
+        return NodeVisibility::Rejected;
+    }
+
+    bool alwaysBright = farDistance <= 0.0f || (factor + astro::distanceModulus(farDistance)) <= m_limitingFactor;
+    if (frustum == OctreeFrustum<float>::Classification::Inside && alwaysBright)
+    {
+        acceptNode(center, size);
+        return NodeVisibility::Accepted;
+    }
+
+    return NodeVisibility::Boundary;
+}
+
+void
+StarOctreeVisibleNodeFilter::acceptNode(const StarOctree::PointType& center, float size)
+{
+    ++m_stats.nodesVisited;
+    ++m_stats.nodesAccepted;
+    float minDistance = (m_obsPosition - center).norm() - size * numbers::sqrt3_v<float>;
+    m_dimmest = minDistance > 0 ? (m_limitingFactor - astro::distanceModulus(minDistance)) : 1000;
+}
+
+// The version of cppcheck used by Codacy doesn't seem to detect the field initializer
+
+StarOctreeVisibleObjectsProcessor::StarOctreeVisibleObjectsProcessor(StarHandler* starHandler, // cppcheck-suppress uninitMemberVar
+                                                                     const StarOctree::PointType& obsPosition,
+                                                                     util::array_view<PlaneType> frustumPlanes,
+                                                                     float limitingFactor) :
+    StarOctreeVisibleNodeFilter(obsPosition, frustumPlanes, limitingFactor),
+    m_starHandler(starHandler)
+{
+}
+
 void
 StarOctreeVisibleObjectsProcessor::process(const Star& obj) const
 {
@@ -91,6 +199,59 @@ StarOctreeVisibleObjectsProcessor::process(const Star& obj) const
         m_starHandler->process(obj, distance, appMag);
 }
 
+StarOctreeVisibleRecordsProcessor::StarOctreeVisibleRecordsProcessor(StarRecordHandler* starHandler, // cppcheck-suppress uninitMemberVar
+                                                                     const StarOctree& octree,
+                                                                     util::array_view<StarRenderRecord> records,
+                                                                     const StarOctree::PointType& obsPosition,
+                                                                     util::array_view<PlaneType> frustumPlanes,
+                                                                     float limitingFactor) :
+    StarOctreeVisibleNodeFilter(obsPosition, frustumPlanes, limitingFactor),
+    m_starHandler(starHandler),
+    m_octree(&octree),
+    m_records(records)
+{
+}
+
+void
+StarOctreeVisibleRecordsProcessor::process(OctreeObjectIndex idx)
+{
+    const StarRenderRecord& record = m_records[idx];
+    if (record.absMag > m_dimmest)
+        return;
+
+    float distance = (m_obsPosition - record.position).norm();
+    float appMag   = astro::absToAppMag(record.absMag, distance);
+
+    // Extinction is rare, so it is read from the star only when present
+    const Star& obj = (*m_octree)[idx];
+    if ((record.flags & StarRenderRecord::HasExtinction) != 0)
+        appMag += obj.getExtinction() * distance;
+
+    if (appMag <= m_limitingFactor || (distance < MAX_STAR_ORBIT_RADIUS && (record.flags & StarRenderRecord::HasOrbit) != 0))
+    {
+        ++m_stats.objectsProcessed;
+        m_starHandler->process(obj, record, distance, appMag);
+    }
+}
+
+StarOctreeVisibleRangesProcessor::StarOctreeVisibleRangesProcessor(std::vector<RangeType>* ranges, // cppcheck-suppress uninitMemberVar
+                                                                   const StarOctree::PointType& obsPosition,
+                                                                   util::array_view<PlaneType> frustumPlanes,
+                                                                   float limitingFactor) :
+    StarOctreeVisibleNodeFilter(obsPosition, frustumPlanes, limitingFactor),
+    m_ranges(ranges)
+{
+}
+
+void
+StarOctreeVisibleRangesProcessor::process(OctreeObjectIndex first, OctreeObjectIndex last)
+{
+    if (!m_ranges->empty() && m_ranges->back().second == first)
+        m_ranges->back().second = last;
+    else
+        m_ranges->emplace_back(first, last);
+}
+
 StarOctreeCloseObjectsProcessor::StarOctreeCloseObjectsProcessor(StarHandler* starHandler,
                                                                  const StarOctree::PointType& obsPosition,
                                                                  float boundingRadius) :
@@ -125,4 +286,144 @@ StarOctreeCloseObjectsProcessor::process(const Star& obj) const
     }
 }
 
+StarOctreeVisibilityCache::StarOctreeVisibilityCache(float maxTranslation,
+                                                     float maxRotation) :
+    m_maxTranslation(maxTranslation),
+    m_maxRotation(maxRotation)
+{
+}
+
+void
+StarOctreeVisibilityCache::process(const StarOctree& octree,
+                                   StarOctreeVisibleRecordsProcessor& processor,
+                                   const Eigen::Vector3f& obsPosition,
+                                   const Eigen::Quaternionf& obsOrientation,
+                                   float fovY,
+                                   float aspectRatio,
+                                   float limitingFactor)
+{
+    if (isValid(octree, obsPosition, obsOrientation, fovY, aspectRatio, limitingFactor))
+    {
+        replay(octree, processor);
+        return;
+    }
+
+    m_octree = &octree;
+    m_nodeCount = octree.nodeCount();
+    m_obsPosition = obsPosition;
+    m_obsOrientation = obsOrientation;
+    m_fovY = fovY;
+    m_aspectRatio = aspectRatio;
+    m_limitingFactor = limitingFactor;
+    rebuild(octree, processor);
+}
+
+void
+StarOctreeVisibilityCache::invalidate()
+{
+    m_octree = nullptr;
+    m_entries.clear();
+}
+
+bool
+StarOctreeVisibilityCache::isValid(const StarOctree& octree,
+                                   const Eigen::Vector3f& obsPosition,
+                                   const Eigen::Quaternionf& obsOrientation,
+                                   float fovY,
+                                   float aspectRatio,
+                                   float limitingFactor) const
+{
+    return m_octree == &octree
+        && m_nodeCount == octree.nodeCount()
+        && fovY == m_fovY
+        && aspectRatio == m_aspectRatio
+        && limitingFactor == m_limitingFactor
+        && (obsPosition - m_obsPosition).norm() <= m_maxTranslation
+        && obsOrientation.angularDistance(m_obsOrientation) <= m_maxRotation;
+}
+
+// Full traversal, recording the nodes which are accepted for any observer
+// within the thresholds, and the nodes which need to be tested again.
+void
+StarOctreeVisibilityCache::rebuild(const StarOctree& octree,
+                                   StarOctreeVisibleRecordsProcessor& processor)
+{
+    m_entries.clear();
+
+    OctreeNodeIndex nodeIdx = 0;
+    OctreeNodeIndex endIdx = octree.nodeCount();
+    while (nodeIdx < endIdx)
+    {
+        const auto& node = octree.getNode(nodeIdx);
+        auto visibility = processor.classifyNode(node.center, node.scale, node.brightFactor,
+                                                 m_maxTranslation, m_maxRotation);
+        if (visibility == StarOctreeVisibleNodeFilter::NodeVisibility::Rejected)
+        {
+            nodeIdx = node.right;
+            continue;
+        }
+
+        if (visibility == StarOctreeVisibleNodeFilter::NodeVisibility::Boundary)
+        {
+            if (!processor.checkNode(node.center, node.scale, node.brightFactor))
+            {
+                m_entries.push_back(Entry{ nodeIdx, EntryType::BoundaryRejected });
+                nodeIdx = node.right;
+                continue;
+            }
+
+            m_entries.push_back(Entry{ nodeIdx, EntryType::BoundaryAccepted });
+        }
+        else
+        {
+            m_entries.push_back(Entry{ nodeIdx, EntryType::Accepted });
+        }
+
+        for (OctreeObjectIndex idx = node.first; idx < node.last; ++idx)
+            processor.process(idx);
+
+        ++nodeIdx;
+    }
+}
+
+void
+StarOctreeVisibilityCache::replay(const StarOctree& octree,
+                                  StarOctreeVisibleRecordsProcessor& processor) const
+{
+    auto entryIt = m_entries.begin();
+    while (entryIt != m_entries.end())
+    {
+        const auto& node = octree.getNode(entryIt->node);
+        switch (entryIt->type)
+        {
+        case EntryType::Accepted:
+            processor.acceptNode(node.center, node.scale);
+            break;
+
+        case EntryType::BoundaryAccepted:
+            if (!processor.checkNode(node.center, node.scale, node.brightFactor))
+            {
+                // Skip the cached descendants of the node
+                OctreeNodeIndex rightIdx = node.right;
+                entryIt = std::find_if(entryIt + 1, m_entries.end(),
+                                       [rightIdx](const Entry& entry) { return entry.node >= rightIdx; });
+                continue;
+            }
+            break;
+
+        case EntryType::BoundaryRejected:
+            // The descendants of the node are not cached, so the subtree is
+            // traversed in full if it has become visible.
+            octree.processSubtreeIndexed(processor, entryIt->node);
+            ++entryIt;
+            continue;
+        }
+
+        for (OctreeObjectIndex idx = node.first; idx < node.last; ++idx)
+            processor.process(idx);
+
+        ++entryIt;
+    }
+}
+
 } // end namespace celestia::engine
@@ -12,7 +12,10 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 #include <Eigen/Geometry>
 
@@ -25,6 +28,86 @@ namespace celestia::engine
 using StarOctree = StaticOctree<Star, float>;
 using StarHandler = OctreeProcessor<Star, float>;
 
+// Compact copy of the star properties read by the point star renderer for
+// every visible star. The records are stored in the same order as the stars
+// in the octree, so the octree object ranges index both arrays.
+struct StarRenderRecord
+{
+    enum : std::uint16_t
+    {
+        HasOrbit      = 0x1,
+        HasExtinction = 0x2,
+    };
+
+    static StarRenderRecord fromStar(const Star&);
+
+    Eigen::Vector3f position;
+    float absMag;
+    // Index of the temperature in the star color tables, see
+    // ColorTemperatureTable::colorIndex()
+    std::uint16_t colorIndex;
+    std::uint16_t flags;
+};
+
+static_assert(sizeof(StarRenderRecord) == 20);
+
+// Compute the bounding planes of an infinite view frustum
+std::array<Eigen::Hyperplane<float, 3>, 5> computeFrustumPlanes(const Eigen::Vector3f& position,
+                                                                const Eigen::Quaternionf& orientation,
+                                                                float fovY,
+                                                                float aspectRatio);
+
+class StarRecordHandler
+{
+public:
+    virtual ~StarRecordHandler() = default;
+    virtual void process(const Star&, const StarRenderRecord&, float distance, float appMag) = 0;
+
+protected:
+    StarRecordHandler() = default;
+};
+
+// Node culling shared by the visible object processors: an octree node is
+// accepted if it intersects the view frustum and its brightest star might be
+// brighter than the limiting magnitude.
+class StarOctreeVisibleNodeFilter
+{
+public:
+    using PlaneType = Eigen::Hyperplane<float, 3>;
+
+    enum class NodeVisibility
+    {
+        Rejected,
+        Boundary,
+        Accepted,
+    };
+
+    bool checkNode(const StarOctree::PointType&, float, float);
+    // As checkNode, but the result is Accepted or Rejected only if it does
+    // not change when the observer moves by up to maxTranslation and turns
+    // by up to maxRotation radians. The magnitude limit of the node is set
+    // if it passes checkNode.
+    NodeVisibility classifyNode(const StarOctree::PointType&, float, float, float maxTranslation, float maxRotation);
+    // Set the magnitude limit of a node known to be visible
+    void acceptNode(const StarOctree::PointType&, float);
+
+    // Each node is counted once, whether it is tested by checkNode,
+    // classifyNode or both
+    const OctreeTraversalStats& traversalStats() const { return m_stats; }
+
+protected:
+    StarOctreeVisibleNodeFilter(const StarOctree::PointType&,
+                                util::array_view<PlaneType>,
+                                float);
+
+    StarOctree::PointType m_obsPosition;
+    OctreeFrustum<float> m_frustum;
+    float m_limitingFactor;
+
+    float m_dimmest{ 1000.0f };
+    OctreeTraversalStats m_stats;
+};
+
 // This class searches the octree for objects that are likely to be visible
 // to a viewer with the specified obsPosition and limitingFactor.  The
 // octreeProcessor is invoked for each potentially visible object --no object with
@@ -32,26 +115,118 @@ using StarHandler = OctreeProcessor<Star, float>;
 // objects that are outside the view frustum may be.  Frustum tests are performed
 // only at the node level to optimize the octree traversal, so an exact test
 // (if one is required) is the responsibility of the callback method.
-class StarOctreeVisibleObjectsProcessor
+class StarOctreeVisibleObjectsProcessor : public StarOctreeVisibleNodeFilter
 {
 public:
-    using PlaneType = Eigen::Hyperplane<float, 3>;
-
     StarOctreeVisibleObjectsProcessor(StarHandler*,
                                       const StarOctree::PointType&,
                                       util::array_view<PlaneType>,
                                       float);
 
-    bool checkNode(const StarOctree::PointType&, float, float);
     void process(const Star&) const;
 
 private:
     StarHandler* m_starHandler;
-    StarOctree::PointType m_obsPosition;
-    util::array_view<PlaneType> m_frustumPlanes;
-    float m_limitingFactor;
+};
 
-    float m_dimmest{ 1000.0f };
+// As StarOctreeVisibleObjectsProcessor, but reads the star properties from
+// the compact render records; the Star objects themselves are only passed
+// through to the handler.
+class StarOctreeVisibleRecordsProcessor : public StarOctreeVisibleNodeFilter
+{
+public:
+    StarOctreeVisibleRecordsProcessor(StarRecordHandler*,
+                                      const StarOctree&,
+                                      util::array_view<StarRenderRecord>,
+                                      const StarOctree::PointType&,
+                                      util::array_view<PlaneType>,
+                                      float);
+
+    void process(OctreeObjectIndex);
+
+private:
+    StarRecordHandler* m_starHandler;
+    const StarOctree* m_octree;
+    util::array_view<StarRenderRecord> m_records;
+};
+
+// Collects the object ranges of the nodes which pass the visibility test,
+// merging adjacent ranges. This is used when the individual stars are culled
+// elsewhere, e.g. by the shader which draws the static star buffer.
+class StarOctreeVisibleRangesProcessor : public StarOctreeVisibleNodeFilter
+{
+public:
+    using RangeType = std::pair<OctreeObjectIndex, OctreeObjectIndex>;
+
+    StarOctreeVisibleRangesProcessor(std::vector<RangeType>*,
+                                     const StarOctree::PointType&,
+                                     util::array_view<PlaneType>,
+                                     float);
+
+    void process(OctreeObjectIndex, OctreeObjectIndex);
+
+private:
+    std::vector<RangeType>* m_ranges;
+};
+
+// Cache of the octree nodes accepted by a StarOctreeVisibleRecordsProcessor,
+// for an observer which moves slowly between frames. While the observer
+// stays within the translation and rotation thresholds of the frame in which
+// the cache was built, and the view parameters are unchanged, only the nodes
+// whose visibility may have changed are tested again. The visible stars are
+// the same as those found by a full traversal.
+class StarOctreeVisibilityCache
+{
+public:
+    explicit StarOctreeVisibilityCache(float maxTranslation = 0.01f,
+                                       float maxRotation = 0.01f);
+
+    void process(const StarOctree&,
+                 StarOctreeVisibleRecordsProcessor&,
+                 const Eigen::Vector3f& obsPosition,
+                 const Eigen::Quaternionf& obsOrientation,
+                 float fovY,
+                 float aspectRatio,
+                 float limitingFactor);
+
+    void invalidate();
+
+private:
+    enum class EntryType : std::uint8_t
+    {
+        Accepted,
+        BoundaryAccepted,
+        BoundaryRejected,
+    };
+
+    struct Entry
+    {
+        OctreeNodeIndex node;
+        EntryType type;
+    };
+
+    bool isValid(const StarOctree&,
+                 const Eigen::Vector3f&,
+                 const Eigen::Quaternionf&,
+                 float,
+                 float,
+                 float) const;
+    void rebuild(const StarOctree&, StarOctreeVisibleRecordsProcessor&);
+    void replay(const StarOctree&, StarOctreeVisibleRecordsProcessor&) const;
+
+    float m_maxTranslation;
+    float m_maxRotation;
+
+    const StarOctree* m_octree{ nullptr };
+    OctreeNodeIndex m_nodeCount{ 0 };
+    Eigen::Vector3f m_obsPosition{ Eigen::Vector3f::Zero() };
+    Eigen::Quaternionf m_obsOrientation{ Eigen::Quaternionf::Identity() };
+    float m_fovY{ 0.0f };
+    float m_aspectRatio{ 0.0f };
+    float m_limitingFactor{ 0.0f };
+
+    // Accepted and boundary nodes in depth-first order
+    std::vector<Entry> m_entries;
 };
 
 class StarOctreeCloseObjectsProcessor
@@ -0,0 +1,88 @@
+// starsdat.cpp
+//
+// Copyright (C) 2001-2024, the Celestia Development Team
+// Original version by Chris Laurel <claurel@gmail.com>
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "starsdat.h"
+
+#include <cstddef>
+
+#include <Eigen/Core>
+
+#include <celutil/binaryread.h>
+#include <celutil/gettext.h>
+#include <celutil/logger.h>
+
+namespace celestia::engine
+{
+
+bool
+parseStarsDatHeader(const char* header, std::uint16_t& version, std::uint32_t& nStarsInFile)
+{
+    // Verify the magic string
+    if (auto magic = std::string_view(header + offsetof(StarsDatHeader, magic), STARSDAT_MAGIC.size());
+        magic != STARSDAT_MAGIC)
+    {
+        return false;
+    }
+
+    // Verify the version
+    version = util::fromMemoryLE<std::uint16_t>(header + offsetof(StarsDatHeader, version));
+    if (version != StarDBVersion && version != StarDBVersion2)
+        return false;
+
+    // Read the star count
+    nStarsInFile = util::fromMemoryLE<std::uint32_t>(header + offsetof(StarsDatHeader, counter));
+    return true;
+}
+
+
+bool
+readStarsDatNode(const char* data,
+                 std::uint32_t i,
+                 std::uint32_t nStars,
+                 detail::StaticOctreeNode<float>& node)
+{
+    data += static_cast<std::size_t>(i) * sizeof(StarsDatNode);
+    node.center = Eigen::Vector3f(util::fromMemoryLE<float>(data + offsetof(StarsDatNode, x)),
+                                  util::fromMemoryLE<float>(data + offsetof(StarsDatNode, y)),
+                                  util::fromMemoryLE<float>(data + offsetof(StarsDatNode, z)));
+    node.scale = util::fromMemoryLE<float>(data + offsetof(StarsDatNode, scale));
+    node.right = util::fromMemoryLE<std::uint32_t>(data + offsetof(StarsDatNode, right));
+    node.first = util::fromMemoryLE<std::uint32_t>(data + offsetof(StarsDatNode, first));
+    node.last = util::fromMemoryLE<std::uint32_t>(data + offsetof(StarsDatNode, last));
+    node.brightFactor = util::fromMemoryLE<float>(data + offsetof(StarsDatNode, brightFactor));
+
+    // Skip links must point forwards to guarantee that traversal terminates
+    return (node.right > i || node.right == InvalidOctreeNode)
+        && node.first <= node.last
+        && node.last <= nStars;
+}
+
+bool
+readStarsDatNodes(const char* data,
+                  std::uint32_t nNodes,
+                  std::uint32_t nStars,
+                  std::vector<detail::StaticOctreeNode<float>>& nodes)
+{
+    nodes.clear();
+    nodes.reserve(nNodes);
+    for (std::uint32_t i = 0; i < nNodes; ++i)
+    {
+        auto& node = nodes.emplace_back(Eigen::Vector3f::Zero(), 0.0f);
+        if (!readStarsDatNode(data, i, nStars, node))
+        {
+            util::GetLogger()->error(_("Bad octree node in star database, node #{}\n"), i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // end namespace celestia::engine
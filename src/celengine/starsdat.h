@@ -0,0 +1,100 @@
+// starsdat.h
+//
+// Copyright (C) 2001-2024, the Celestia Development Team
+// Original version by Chris Laurel <claurel@gmail.com>
+//
+// Layout of the binary star database files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "astroobj.h"
+#include "octree.h"
+
+namespace celestia::engine
+{
+
+constexpr inline std::string_view STARSDAT_MAGIC = "CELSTARS";
+constexpr inline std::uint16_t StarDBVersion     = 0x0100;
+// Version 2 files store the stars in octree order, followed by the flattened
+// octree nodes and the catalog number index, so that no sorting is required
+// at load time. Spectral types use the StellarClass::packV2 encoding.
+constexpr inline std::uint16_t StarDBVersion2    = 0x0200;
+
+#pragma pack(push, 1)
+
+// stars.dat header structure
+struct StarsDatHeader
+{
+    StarsDatHeader() = delete;
+    char magic[8]; //NOSONAR
+    std::uint16_t version;
+    std::uint32_t counter;
+};
+
+// stars.dat record structure
+struct StarsDatRecord
+{
+    StarsDatRecord() = delete;
+    AstroCatalog::IndexNumber catNo;
+    float x;
+    float y;
+    float z;
+    std::int16_t absMag;
+    std::uint16_t spectralType;
+};
+
+// additional header fields in version 2 stars.dat
+struct StarsDatHeaderV2
+{
+    StarsDatHeaderV2() = delete;
+    StarsDatHeader header;
+    std::uint32_t nodeCount;
+};
+
+// version 2 stars.dat octree node
+struct StarsDatNode
+{
+    StarsDatNode() = delete;
+    float x;
+    float y;
+    float z;
+    float scale;
+    std::uint32_t right;
+    std::uint32_t first;
+    std::uint32_t last;
+    float brightFactor;
+};
+
+#pragma pack(pop)
+
+static_assert(std::is_standard_layout_v<StarsDatHeader>);
+static_assert(std::is_standard_layout_v<StarsDatRecord>);
+static_assert(std::is_standard_layout_v<StarsDatHeaderV2>);
+static_assert(std::is_standard_layout_v<StarsDatNode>);
+
+bool parseStarsDatHeader(const char* header, std::uint16_t& version, std::uint32_t& nStarsInFile);
+
+// Decode node i of the octree nodes of a version 2 stars.dat; return false
+// if it is invalid
+bool readStarsDatNode(const char* data,
+                      std::uint32_t i,
+                      std::uint32_t nStars,
+                      detail::StaticOctreeNode<float>& node);
+
+// Decode and validate the octree nodes of a version 2 stars.dat
+bool readStarsDatNodes(const char* data,
+                       std::uint32_t nNodes,
+                       std::uint32_t nStars,
+                       std::vector<detail::StaticOctreeNode<float>>& nodes);
+
+} // end namespace celestia::engine
@@ -0,0 +1,84 @@
+// starsplatter.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Merging of the faint point stars which cover the same pixels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "starsplatter.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include <Eigen/Geometry>
+
+namespace celestia::engine
+{
+
+void
+StarSplatter::begin(const Eigen::Matrix4f& mvp, int width, int height, int cellSize)
+{
+    m_mvp = mvp;
+    m_width = static_cast<float>(std::max(width, 1));
+    m_height = static_cast<float>(std::max(height, 1));
+    m_cellSize = std::max(cellSize, 1);
+
+    int columns = (std::max(width, 1) + m_cellSize - 1) / m_cellSize;
+    int rows = (std::max(height, 1) + m_cellSize - 1) / m_cellSize;
+    if (columns != m_columns || rows != m_rows)
+    {
+        m_columns = columns;
+        m_rows = rows;
+        m_cellIndex.assign(static_cast<std::size_t>(columns) * static_cast<std::size_t>(rows), -1);
+        m_cells.clear();
+    }
+}
+
+bool
+StarSplatter::add(const Eigen::Vector3f& position, const Color& color, float size)
+{
+    Eigen::Vector4f clip = m_mvp * position.homogeneous();
+    if (clip.w() <= 0.0f)
+        return false;
+
+    float x = (clip.x() / clip.w() + 1.0f) * 0.5f * m_width;
+    float y = (clip.y() / clip.w() + 1.0f) * 0.5f * m_height;
+    if (!(x >= 0.0f && x < m_width && y >= 0.0f && y < m_height))
+        return false;
+
+    auto column = std::min(static_cast<int>(x) / m_cellSize, m_columns - 1);
+    auto row = std::min(static_cast<int>(y) / m_cellSize, m_rows - 1);
+    auto index = static_cast<std::uint32_t>(row * m_columns + column);
+
+    float alpha = color.alpha();
+    std::int32_t& cellIndex = m_cellIndex[index];
+    if (cellIndex < 0)
+    {
+        cellIndex = static_cast<std::int32_t>(m_cells.size());
+        m_cells.push_back(Cell{ position, color, size, alpha,
+                                alpha, alpha * color.red(), alpha * color.green(), alpha * color.blue(),
+                                1, index });
+        return true;
+    }
+
+    Cell& cell = m_cells[static_cast<std::size_t>(cellIndex)];
+    if (alpha > cell.brightest)
+    {
+        cell.position = position;
+        cell.color = color;
+        cell.brightest = alpha;
+    }
+    cell.size = std::max(cell.size, size);
+    cell.flux += alpha;
+    cell.red += alpha * color.red();
+    cell.green += alpha * color.green();
+    cell.blue += alpha * color.blue();
+    ++cell.count;
+    return true;
+}
+
+} // end namespace celestia::engine
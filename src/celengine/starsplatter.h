@@ -0,0 +1,101 @@
+// starsplatter.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Merging of the faint point stars which cover the same pixels.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celutil/color.h>
+
+namespace celestia::engine
+{
+
+// Accumulates the light of the faint stars falling in each square cell of
+// a few pixels of the window, and then gives one star per cell, so that the
+// number of sprites drawn in dense star fields is bounded by the size of
+// the window instead of the number of stars. Stars are drawn with additive
+// blending, so a merged star has the summed brightness of the stars of its
+// cell and their brightness weighted color, saturated like the frame
+// buffer would; it is placed on the brightest of them.
+class StarSplatter
+{
+public:
+    // Start a frame drawn with the given projection and model view matrix
+    // into a window of width by height pixels
+    void begin(const Eigen::Matrix4f& mvp, int width, int height, int cellSize);
+
+    // Add a star; returns false if it is outside of the window, in which
+    // case it must be drawn as usual, as its sprite may still be visible
+    bool add(const Eigen::Vector3f& position, const Color& color, float size);
+
+    // Call emit(position, color, size) for each cell with stars, and reset
+    // the cells for the next frame
+    template<typename F>
+    void end(F&& emit)
+    {
+        for (const Cell& cell : m_cells)
+        {
+            if (cell.count == 1)
+            {
+                emit(cell.position, cell.color, cell.size);
+                continue;
+            }
+
+            float flux = cell.flux > 0.0f ? cell.flux : 1.0f;
+            emit(cell.position,
+                 Color(cell.red / flux, cell.green / flux, cell.blue / flux, cell.flux),
+                 cell.size);
+            m_merged += cell.count - 1;
+        }
+
+        for (const Cell& cell : m_cells)
+            m_cellIndex[cell.index] = -1;
+        m_cells.clear();
+    }
+
+    // Number of stars which were merged into others since the splatter
+    // was created
+    std::uint64_t getMergedCount() const { return m_merged; }
+
+private:
+    struct Cell
+    {
+        Eigen::Vector3f position;
+        // Color of the brightest star, drawn as is when it is alone
+        Color color;
+        float size;
+        float brightest;
+        // Sums of the alphas and of the color components weighted by alpha
+        float flux;
+        float red;
+        float green;
+        float blue;
+        std::uint32_t count;
+        std::uint32_t index;
+    };
+
+    Eigen::Matrix4f m_mvp{ Eigen::Matrix4f::Identity() };
+    float m_width{ 0.0f };
+    float m_height{ 0.0f };
+    int m_columns{ 0 };
+    int m_rows{ 0 };
+    int m_cellSize{ 1 };
+    // Index in m_cells of each cell of the window, or -1; kept across frames
+    // and only reset for the cells used
+    std::vector<std::int32_t> m_cellIndex;
+    std::vector<Cell> m_cells;
+    std::uint64_t m_merged{ 0 };
+};
+
+} // end namespace celestia::engine
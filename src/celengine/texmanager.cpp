@@ -91,27 +91,61 @@ TextureInfo::resolve(const fs::path& baseDir) const
 std::unique_ptr<Texture>
 TextureInfo::load(const fs::path& name) const
 {
-    Texture::AddressMode addressMode = Texture::EdgeClamp;
-    Texture::MipMapMode  mipMode     = Texture::DefaultMipMaps;
-    Texture::Colorspace  colorspace  = Texture::DefaultColorspace;
-
-    if (flags & WrapTexture)
-        addressMode = Texture::Wrap;
-    else if (flags & BorderClamp)
-        addressMode = Texture::BorderClamp;
+    if (bumpHeight == 0.0f)
+    {
+        GetLogger()->debug("Loading texture: {}\n", name);
+        return LoadTextureFromFile(name, addressMode(), mipMapMode(), colorspace());
+    }
 
-    if (flags & NoMipMaps)
-        mipMode = Texture::NoMipMaps;
+    GetLogger()->debug("Loading bump map: {}\n", name);
+    return LoadHeightMapFromFile(name, bumpHeight, addressMode());
+}
 
-    if (flags & LinearColorspace)
-        colorspace = Texture::LinearColorspace;
 
+std::unique_ptr<TextureFileData>
+TextureInfo::prepare(const fs::path& name) const
+{
     if (bumpHeight == 0.0f)
     {
         GetLogger()->debug("Loading texture: {}\n", name);
-        return LoadTextureFromFile(name, addressMode, mipMode, colorspace);
+        return ReadTextureFile(name, colorspace());
     }
 
     GetLogger()->debug("Loading bump map: {}\n", name);
-    return LoadHeightMapFromFile(name, bumpHeight, addressMode);
+    return ReadHeightMapFile(name, bumpHeight, addressMode());
+}
+
+
+std::unique_ptr<Texture>
+TextureInfo::finish(const fs::path& /*name*/, std::unique_ptr<TextureFileData>&& data) const
+{
+    // Normal maps computed from height maps always get mipmaps
+    return CreateTextureFromData(*data,
+                                 addressMode(),
+                                 bumpHeight == 0.0f ? mipMapMode() : Texture::DefaultMipMaps);
+}
+
+
+Texture::AddressMode
+TextureInfo::addressMode() const
+{
+    if (flags & WrapTexture)
+        return Texture::Wrap;
+    if (flags & BorderClamp)
+        return Texture::BorderClamp;
+    return Texture::EdgeClamp;
+}
+
+
+Texture::MipMapMode
+TextureInfo::mipMapMode() const
+{
+    return (flags & NoMipMaps) ? Texture::NoMipMaps : Texture::DefaultMipMaps;
+}
+
+
+Texture::Colorspace
+TextureInfo::colorspace() const
+{
+    return (flags & LinearColorspace) ? Texture::LinearColorspace : Texture::DefaultColorspace;
 }
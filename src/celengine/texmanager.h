@@ -32,6 +32,7 @@ private:
 public:
     using ResourceType = Texture;
     using ResourceKey = fs::path;
+    using PreparedType = TextureFileData;
 
     enum
     {
@@ -76,6 +77,15 @@ public:
 
     fs::path resolve(const fs::path&) const;
     std::unique_ptr<Texture> load(const fs::path&) const;
+    // Background loading: the file is decoded by prepare(), and the texture
+    // is created by finish()
+    std::unique_ptr<TextureFileData> prepare(const fs::path&) const;
+    std::unique_ptr<Texture> finish(const fs::path&, std::unique_ptr<TextureFileData>&&) const;
+
+private:
+    Texture::AddressMode addressMode() const;
+    Texture::MipMapMode mipMapMode() const;
+    Texture::Colorspace colorspace() const;
 };
 
 inline bool operator<(const TextureInfo& ti0, const TextureInfo& ti1)
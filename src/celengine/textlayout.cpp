@@ -11,6 +11,8 @@
 
 #include <cstddef>
 
+#include "retainedtext.h"
+
 #ifdef USE_ICU
 #include <celutil/flag.h>
 #include <celutil/unicode.h>
@@ -33,7 +35,8 @@ void TextLayout::setFont(const std::shared_ptr<TextureFont> &value)
         if (began)
         {
             flushInternal(true);
-            font->unbind();
+            if (target == nullptr)
+                font->unbind();
         }
         font = value;
         if (began)
@@ -43,8 +46,9 @@ void TextLayout::setFont(const std::shared_ptr<TextureFont> &value)
                 // we set a null font here, meaning that this session
                 // is no longer active
                 began = false;
+                target = nullptr;
             }
-            else
+            else if (target == nullptr)
             {
                 // bind the font and set the same info
                 font->bind();
@@ -117,6 +121,10 @@ void TextLayout::begin(const Eigen::Matrix4f &p, const Eigen::Matrix4f &m)
 {
     if (font == nullptr) return;
 
+    // finish laying out into a retained text
+    if (target != nullptr)
+        end();
+
     // if already began, do not call bind
     if (!began)
         font->bind();
@@ -126,6 +134,16 @@ void TextLayout::begin(const Eigen::Matrix4f &p, const Eigen::Matrix4f &m)
     modelview = m;
 }
 
+void TextLayout::begin(RetainedText &t)
+{
+    if (font == nullptr) return;
+
+    if (began)
+        end();
+    began = true;
+    target = &t;
+}
+
 void TextLayout::render(std::string_view text)
 {
     if (!began)
@@ -184,9 +202,10 @@ void TextLayout::end()
         return;
 
     flushInternal(true);
-    if (font != nullptr)
+    if (font != nullptr && target == nullptr)
         font->unbind();
     began = false;
+    target = nullptr;
 }
 
 std::pair<float, float> TextLayout::getCurrentPosition() const
@@ -232,7 +251,9 @@ void TextLayout::renderLine(std::u16string_view line)
     default:
         break;
     }
-    auto [newX, newY] = font->render(line, x, positionY);
+    auto [newX, newY] = target == nullptr
+        ? font->render(line, x, positionY)
+        : target->add(font, line, x, positionY);
     if (layoutDirectionFollowTextAlignment && horizontalAlignment == HorizontalAlignment::Right)
     {
         positionX = x;
@@ -255,7 +276,7 @@ void TextLayout::flushInternal(bool flushFont)
         currentLine.clear();
     }
 
-    if (flushFont)
+    if (flushFont && target == nullptr)
         font->flush();
 }
 
@@ -277,6 +298,11 @@ bool TextLayout::processString(std::string_view input, std::vector<std::u16strin
         // For readability, declare `line` outside the if statement
         if (line.empty()) // NOSONAR
             output.emplace_back();
+        else if (UTF8IsASCII(line))
+        {
+            // Shaping and reordering don't change ASCII text
+            output.emplace_back(line.begin(), line.end());
+        }
         else
         {
             if (!UTF8StringToUnicodeString(line, u16line))
@@ -302,10 +328,14 @@ bool TextLayout::processString(std::string_view input, std::vector<std::u16strin
     bool endsWithLineBreak  = false;
 
     std::u16string currentLine;
+    currentLine.reserve(input.size());
     while (i < len && validChar)
     {
-        std::int32_t ch = 0;
-        validChar = UTF8Decode(input, i, ch);
+        std::int32_t ch = static_cast<unsigned char>(input[i]);
+        if (ch < 0x80)
+            ++i;
+        else
+            validChar = UTF8Decode(input, i, ch);
         if (!validChar)
             return false;
 
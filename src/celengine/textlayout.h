@@ -20,6 +20,8 @@
 
 namespace celestia::engine
 {
+class RetainedText;
+
 /**
  * \class TextLayout textlayout.h celengine/textlayout.h
  *
@@ -37,6 +39,8 @@ namespace celestia::engine
  *           3. flush if needed (for example, needed if you change color via glVertexAttrib4f)
  *           4. render text
  *       3. end
+ *   To keep the text for drawing later, begin with a RetainedText instead of the matrices,
+ *   the text is then added to it rather than rendered.
  */
 class TextLayout
 {
@@ -90,6 +94,10 @@ class TextLayout
     /// @param m the modelview matrix
     void begin(const Eigen::Matrix4f &p, const Eigen::Matrix4f &m = Eigen::Matrix4f::Identity());
 
+    /// Start laying out text into the target instead of rendering it, the font is not bound
+    /// @param t the retained text to add the glyphs to
+    void begin(RetainedText &t);
+
     /// Render the given text, the text will be rendered in lines, must be called after begin
     /// @param text the text to render
     void render(std::string_view text);
@@ -109,9 +117,17 @@ class TextLayout
     /// @return the max width of all the lines in the text in the desired font
     static int getTextWidth(std::string_view text, const TextureFont *font);
 
+    /// Convert UTF-8 text to the UTF-16 lines which are passed to the font, applying
+    /// shaping and bidirectional reordering if available
+    /// @param input the text to convert
+    /// @param output vector to append the lines to
+    /// @return false if the text is not valid UTF-8
+    static bool processString(std::string_view input, std::vector<std::u16string> &output);
+
  private:
     float screenDpi;
     std::shared_ptr<TextureFont> font;
+    RetainedText *target{ nullptr };
 
     HorizontalAlignment horizontalAlignment;
 
@@ -130,8 +146,6 @@ class TextLayout
 
     void renderLine(std::u16string_view line);
     void flushInternal(bool flushFont);
-
-    static bool processString(std::string_view input, std::vector<std::u16string> &output);
 };
 
 }
@@ -10,17 +10,22 @@
 #include <algorithm>
 #include <array>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 #include <cmath>
+#include <optional>
 
 #include <Eigen/Core>
+#include <fmt/format.h>
 #include "glsupport.h"
 
+#include <celrender/gl/callcounters.h>
 #include <celutil/filetype.h>
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
 #include "framebuffer.h"
 #include "texture.h"
+#include "texturecache.h"
 #include "virtualtex.h"
 
 
@@ -37,6 +42,8 @@ struct TextureCaps
     GLint preferredAnisotropy;
 };
 
+std::unique_ptr<celestia::engine::TextureCache> textureCache;
+
 const
 TextureCaps& GetTextureCaps()
 {
@@ -240,6 +247,7 @@ LoadMipmapSet(const Image& img, GLenum target)
     {
         int mipWidth  = std::max(img.getWidth() >> mip, 1);
         int mipHeight = std::max(img.getHeight() >> mip, 1);
+        gl::callCounters.textureUploadBytes += static_cast<std::uint64_t>(img.getMipLevelSize(mip));
 
         if (img.isCompressed())
         {
@@ -270,6 +278,7 @@ void
 LoadMiplessTexture(const Image& img, GLenum target)
 {
     int internalFormat = getInternalFormat(img.getFormat());
+    gl::callCounters.textureUploadBytes += static_cast<std::uint64_t>(img.getMipLevelSize(0));
 
     if (img.isCompressed())
     {
@@ -315,6 +324,16 @@ CalcMipLevelCount(int w, int h)
     return std::max(ilog2(w), ilog2(h)) + 1;
 }
 
+// Estimate of the video memory used for an image; mipmaps generated by the
+// driver add a third
+std::size_t
+EstimateMemoryUsage(const Image& img, bool genMipmaps)
+{
+    auto size = static_cast<std::size_t>(img.getSize());
+    return genMipmaps ? size + size / 3 : size;
+}
+
+
 // Helper function for CreateProceduralCubeMap; return the normalized
 // vector pointing to (s, t) on the specified face.
 Eigen::Vector3f
@@ -449,7 +468,8 @@ ImageTexture::ImageTexture(const Image& img,
                            AddressMode addressMode,
                            MipMapMode mipMapMode) :
     Texture(img.getWidth(), img.getHeight()),
-    glName(0)
+    glName(0),
+    format(img.getFormat())
 {
     glGenTextures(1, &glName);
     glBindTexture(GL_TEXTURE_2D, glName);
@@ -464,6 +484,15 @@ ImageTexture::ImageTexture(const Image& img,
     {
         precomputedMipMaps = true;
     }
+#ifndef GL_ES
+    // Mipmaps can't be generated for compressed images, so use a partial
+    // set of levels rather than none. LoadMipmapSet limits the sampled
+    // levels to the ones supplied.
+    else if (mipmap && img.isCompressed() && mipLevelCount > 1)
+    {
+        precomputedMipMaps = true;
+    }
+#endif
 
     // We can't automatically generate mipmaps for compressed textures.
     // If a precomputed mipmap set isn't provided, turn off mipmapping entirely.
@@ -510,8 +539,10 @@ ImageTexture::ImageTexture(const Image& img,
     if (genMipmaps)
         glGenerateMipmap(GL_TEXTURE_2D);
 
+    mipmapped = mipmap;
     alpha = img.hasAlpha();
     compressed = img.isCompressed();
+    memoryUsage = EstimateMemoryUsage(img, genMipmaps);
 }
 
 
@@ -543,6 +574,44 @@ unsigned int ImageTexture::getName() const
 }
 
 
+bool ImageTexture::replaceImage(const Image& img)
+{
+    if (mipmapped ||
+        img.getFormat() != format ||
+        img.getWidth() != getWidth() ||
+        img.getHeight() != getHeight())
+    {
+        return false;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, glName);
+    gl::callCounters.textureUploadBytes += static_cast<std::uint64_t>(img.getMipLevelSize(0));
+    if (img.isCompressed())
+    {
+        glCompressedTexSubImage2D(GL_TEXTURE_2D,
+                                  0,
+                                  0, 0,
+                                  getWidth(), getHeight(),
+                                  getInternalFormat(format),
+                                  img.getMipLevelSize(0),
+                                  img.getMipLevel(0));
+    }
+    else
+    {
+        glTexSubImage2D(GL_TEXTURE_2D,
+                        0,
+                        0, 0,
+                        getWidth(), getHeight(),
+                        getExternalFormat(format),
+                        GL_UNSIGNED_BYTE,
+                        img.getMipLevel(0));
+    }
+
+    alpha = img.hasAlpha();
+    return true;
+}
+
+
 void ImageTexture::setBorderColor(Color borderColor)
 {
     bind();
@@ -584,16 +653,25 @@ TiledTexture::TiledTexture(const Image& img,
     if (!precomputedMipMaps && img.isCompressed())
         mipmap = false;
 
+    memoryUsage = EstimateMemoryUsage(img, mipmap && !precomputedMipMaps);
+
     GLenum texAddress = GetGLTexAddressMode(EdgeClamp);
     int components = img.getComponents();
 
-    // Create a temporary image which we'll use for the tile texels
+    // Create a temporary image which we'll use for the tile texels. On
+    // desktop GL, uncompressed tiles without prebuilt mipmaps are uploaded
+    // straight from the rows of the image, so only one level is needed.
     int tileWidth = img.getWidth() / uSplit;
     int tileHeight = img.getHeight() / vSplit;
-    int tileMipLevelCount = CalcMipLevelCount(tileWidth, tileHeight);
-    Image* tile = new Image(img.getFormat(),
-                            tileWidth, tileHeight,
-                            tileMipLevelCount);
+    int tileMipLevelCount = precomputedMipMaps ? CalcMipLevelCount(tileWidth, tileHeight) : 1;
+#ifndef GL_ES
+    bool needTileImage = precomputedMipMaps || img.isCompressed();
+#else
+    bool needTileImage = true;
+#endif
+    std::unique_ptr<Image> tile;
+    if (needTileImage)
+        tile = std::make_unique<Image>(img.getFormat(), tileWidth, tileHeight, tileMipLevelCount);
 
     for (int v = 0; v < vSplit; v++)
     {
@@ -676,23 +754,38 @@ TiledTexture::TiledTexture(const Image& img,
                 else
                 {
                     const std::uint8_t* tilePixels = img.getPixels() +
-                        (v * tileHeight * img.getWidth() + u * tileWidth) * components;
+                        v * tileHeight * img.getPitch() + u * tileWidth * components;
+#ifndef GL_ES
+                    // The rows of an image are padded to four bytes, which
+                    // is the default unpack alignment
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, img.getWidth());
+                    gl::callCounters.textureUploadBytes += static_cast<std::uint64_t>(tileWidth * tileHeight * components);
+                    glTexImage2D(GL_TEXTURE_2D,
+                                 0,
+                                 getInternalFormat(img.getFormat()),
+                                 tileWidth, tileHeight,
+                                 0,
+                                 getExternalFormat(img.getFormat()),
+                                 GL_UNSIGNED_BYTE,
+                                 tilePixels);
+                    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#else
                     for (int y = 0; y < tileHeight; y++)
                     {
-                        memcpy(tile->getPixels() + y * tileWidth * components,
-                               tilePixels + y * img.getWidth() * components,
+                        memcpy(tile->getPixelRow(y),
+                               tilePixels + y * img.getPitch(),
                                tileWidth * components);
                     }
+#endif
                 }
 
-                LoadMiplessTexture(*tile, GL_TEXTURE_2D);
+                if (tile != nullptr)
+                    LoadMiplessTexture(*tile, GL_TEXTURE_2D);
                 if (mipmap)
                     glGenerateMipmap(GL_TEXTURE_2D);
             }
         }
     }
-
-    delete tile;
 }
 
 
@@ -802,6 +895,8 @@ CubeMap::CubeMap(celestia::util::array_view<const Image*> faces) :
     }
     if (genMipmaps)
         glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+    memoryUsage = 6 * EstimateMemoryUsage(*faces[0], genMipmaps);
 }
 
 
@@ -914,60 +1009,144 @@ CreateProceduralCubeMap(int size,
 }
 
 
-std::unique_ptr<Texture>
-LoadTextureFromFile(const fs::path& filename,
-                    Texture::AddressMode addressMode,
-                    Texture::MipMapMode mipMode,
-                    Texture::Colorspace colorspace)
+std::unique_ptr<TextureFileData>
+ReadTextureFile(const fs::path& filename,
+                Texture::Colorspace colorspace)
 {
+    auto data = std::make_unique<TextureFileData>();
+
     // Check for a Celestia texture--these need to be handled specially.
     ContentType contentType = DetermineFileType(filename);
 
     if (contentType == ContentType::CelestiaTexture)
-        return LoadVirtualTexture(filename);
+    {
+        data->texture = LoadVirtualTexture(filename);
+        if (data->texture == nullptr)
+            return nullptr;
+        return data;
+    }
 
     // All other texture types are handled by first loading an image, then
     // creating a texture from that image.
-    std::unique_ptr<Image> img = Image::load(filename);
-    if (img == nullptr)
+    data->image = Image::load(filename);
+    if (data->image == nullptr)
         return nullptr;
 
     if (colorspace == Texture::LinearColorspace)
-        img->forceLinear();
+        data->image->forceLinear();
 
-    std::unique_ptr<Texture> tex = CreateTextureFromImage(*img, addressMode, mipMode);
+    // If the texture came from a .dxt5nm file then mark it as a dxt5
+    // compressed normal map. There's no separate OpenGL format for dxt5
+    // normal maps, so the file extension is the only thing that
+    // distinguishes it from a plain old dxt5 texture.
+    data->dxt5NormalMap = contentType == ContentType::DXT5NormalMap &&
+                          data->image->getFormat() == PixelFormat::DXT5;
 
-    if (contentType == ContentType::DXT5NormalMap)
+    return data;
+}
+
+
+// Load a height map from a file and convert it to a normal map.
+std::unique_ptr<TextureFileData>
+ReadHeightMapFile(const fs::path& filename,
+                  float height,
+                  Texture::AddressMode addressMode)
+{
+    bool wrap = addressMode == Texture::Wrap;
+    auto data = std::make_unique<TextureFileData>();
+
+    std::optional<std::uint64_t> cacheKey;
+    if (textureCache != nullptr)
     {
-        // If the texture came from a .dxt5nm file then mark it as a dxt5
-        // compressed normal map. There's no separate OpenGL format for dxt5
-        // normal maps, so the file extension is the only thing that
-        // distinguishes it from a plain old dxt5 texture.
-        if (img->getFormat() == PixelFormat::DXT5)
+        cacheKey = textureCache->getKey(filename, fmt::format("normalmap {} {}", height, wrap));
+        if (cacheKey.has_value())
         {
-            tex->setFormatOptions(Texture::DXT5NormalMap);
+            data->image = textureCache->load(*cacheKey);
+            if (data->image != nullptr)
+                return data;
         }
     }
 
+    auto img = Image::load(filename);
+    if (img == nullptr)
+        return nullptr;
+
+    img->forceLinear();
+
+    data->image = img->computeNormalMap(height, wrap);
+    if (data->image == nullptr)
+        return nullptr;
+
+    if (cacheKey.has_value())
+        textureCache->store(*cacheKey, *data->image);
+
+    return data;
+}
+
+
+std::size_t
+TextureFileData::getMemoryUsage() const
+{
+    std::size_t size = image == nullptr ? 0 : static_cast<std::size_t>(image->getSize());
+    if (texture != nullptr)
+        size += texture->getMemoryUsage();
+    return size;
+}
+
+// Create the texture from the contents of a file; this needs the OpenGL
+// context.
+std::unique_ptr<Texture>
+CreateTextureFromData(TextureFileData& data,
+                      Texture::AddressMode addressMode,
+                      Texture::MipMapMode mipMode)
+{
+    if (data.texture != nullptr)
+        return std::move(data.texture);
+
+    if (data.image == nullptr)
+        return nullptr;
+
+    std::unique_ptr<Texture> tex = CreateTextureFromImage(*data.image, addressMode, mipMode);
+    if (data.dxt5NormalMap)
+        tex->setFormatOptions(Texture::DXT5NormalMap);
+
     return tex;
 }
 
 
+std::unique_ptr<Texture>
+LoadTextureFromFile(const fs::path& filename,
+                    Texture::AddressMode addressMode,
+                    Texture::MipMapMode mipMode,
+                    Texture::Colorspace colorspace)
+{
+    auto data = ReadTextureFile(filename, colorspace);
+    if (data == nullptr)
+        return nullptr;
+
+    return CreateTextureFromData(*data, addressMode, mipMode);
+}
+
+
 // Load a height map texture from a file and convert it to a normal map.
 std::unique_ptr<Texture>
 LoadHeightMapFromFile(const fs::path& filename,
                       float height,
                       Texture::AddressMode addressMode)
 {
-    auto img = Image::load(filename);
-    if (img == nullptr)
+    auto data = ReadHeightMapFile(filename, height, addressMode);
+    if (data == nullptr)
         return nullptr;
 
-    img->forceLinear();
+    return CreateTextureFromData(*data, addressMode, Texture::DefaultMipMaps);
+}
 
-    auto normalMap = img->computeNormalMap(height, addressMode == Texture::Wrap);
-    if (normalMap == nullptr)
-        return nullptr;
 
-    return CreateTextureFromImage(*normalMap, addressMode, Texture::DefaultMipMaps);
+void
+SetTextureCacheDirectory(const fs::path& directory)
+{
+    if (directory.empty())
+        textureCache = nullptr;
+    else
+        textureCache = std::make_unique<celestia::engine::TextureCache>(directory);
 }
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -66,6 +67,13 @@ class Texture
     // is implemented.
     virtual void beginUsage() {};
     virtual void endUsage() {};
+    // Rate at which the observer is closing in on the textured object, as a
+    // fraction of its distance per second. Textures which stream their
+    // detail can use it to load ahead.
+    virtual void setApproachRate(float) {};
+    // Start loading the tiles of the lowest level of detail, so that the
+    // texture can be drawn as soon as it is used
+    virtual void prefetchBaseLevel() {};
 
     virtual void setBorderColor(Color);
 
@@ -76,6 +84,9 @@ class Texture
     bool hasAlpha() const { return alpha; }
     bool isCompressed() const { return compressed; }
 
+    //! Estimate of the video memory used by the texture, in bytes
+    virtual std::size_t getMemoryUsage() const { return memoryUsage; }
+
     /*! Identical formats may need to be treated in slightly different
      *  fashions. One (and currently the only) example is the DXT5 compressed
      *  normal map format, which is an ordinary DXT5 texture but requires some
@@ -115,6 +126,7 @@ class Texture
  protected:
     bool alpha{ false };
     bool compressed{ false };
+    std::size_t memoryUsage{ 0 };
 
  private:
     int width;
@@ -137,8 +149,15 @@ class ImageTexture : public Texture
 
     unsigned int getName() const;
 
+    // Replace the contents of a texture without mipmaps by an image of the
+    // same size and format, reusing the texture storage. Returns false,
+    // leaving the texture unchanged, if the image does not match.
+    bool replaceImage(const celestia::engine::Image& img);
+
  private:
     unsigned int glName;
+    celestia::engine::PixelFormat format;
+    bool mipmapped{ false };
 };
 
 
@@ -195,6 +214,31 @@ std::unique_ptr<Texture>
 CreateProceduralCubeMap(int size, celestia::engine::PixelFormat format,
                         ProceduralTexEval func);
 
+// Contents of a texture file, read and decoded without an OpenGL context.
+// Virtual textures need no upload and are created directly.
+struct TextureFileData
+{
+    std::unique_ptr<celestia::engine::Image> image;
+    std::unique_ptr<Texture> texture;
+    bool dxt5NormalMap{ false };
+
+    std::size_t getMemoryUsage() const;
+};
+
+std::unique_ptr<TextureFileData>
+ReadTextureFile(const fs::path& filename,
+                Texture::Colorspace colorspace = Texture::DefaultColorspace);
+
+std::unique_ptr<TextureFileData>
+ReadHeightMapFile(const fs::path& filename,
+                  float height,
+                  Texture::AddressMode addressMode = Texture::EdgeClamp);
+
+std::unique_ptr<Texture>
+CreateTextureFromData(TextureFileData& data,
+                      Texture::AddressMode addressMode = Texture::EdgeClamp,
+                      Texture::MipMapMode mipMode = Texture::DefaultMipMaps);
+
 std::unique_ptr<Texture>
 LoadTextureFromFile(const fs::path& filename,
                     Texture::AddressMode addressMode = Texture::EdgeClamp,
@@ -205,3 +249,8 @@ std::unique_ptr<Texture>
 LoadHeightMapFromFile(const fs::path& filename,
                       float height,
                       Texture::AddressMode addressMode = Texture::EdgeClamp);
+
+// Keep the normal maps computed from height maps in directory, so that they
+// are read back in later sessions. An empty path disables the cache. Must
+// be called before any height map is loaded.
+void SetTextureCacheDirectory(const fs::path& directory);
@@ -0,0 +1,151 @@
+// texturecache.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// On-disk cache of images derived from texture files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "texturecache.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include <celimage/image.h>
+#include <celutil/binaryread.h>
+#include <celutil/binarywrite.h>
+#include <celutil/logger.h>
+
+using celestia::util::GetLogger;
+
+namespace celestia::engine
+{
+
+namespace
+{
+
+constexpr std::uint64_t FNVOffsetBasis = UINT64_C(0xcbf29ce484222325);
+constexpr std::uint64_t FNVPrime = UINT64_C(0x100000001b3);
+
+constexpr std::array<char, 8> CacheFileMagic = { 'C', 'E', 'L', 'T', 'E', 'X', 'C', '1' };
+
+// 64-bit FNV-1a, terminated by a zero byte so that the concatenation of
+// several strings can't collide with a different split of the same bytes
+std::uint64_t
+hashString(std::uint64_t hash, std::string_view str)
+{
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNVPrime;
+    }
+    return hash * FNVPrime;
+}
+
+} // end unnamed namespace
+
+TextureCache::TextureCache(const fs::path& directory) :
+    m_directory(directory)
+{
+    std::error_code ec;
+    if (fs::create_directories(m_directory, ec); ec)
+        GetLogger()->error("Failed to create texture cache directory {}: {}\n", m_directory, ec.message());
+}
+
+std::optional<std::uint64_t>
+TextureCache::getKey(const fs::path& source, std::string_view derivation) const
+{
+    std::error_code ec;
+    fs::path absolute = fs::absolute(source, ec);
+    if (ec)
+        return std::nullopt;
+
+    auto size = fs::file_size(absolute, ec);
+    if (ec)
+        return std::nullopt;
+
+    auto mtime = fs::last_write_time(absolute, ec);
+    if (ec)
+        return std::nullopt;
+
+    std::uint64_t hash = hashString(FNVOffsetBasis, absolute.string());
+    hash = hashString(hash, fmt::format("{} {}", size, mtime.time_since_epoch().count()));
+    return hashString(hash, derivation);
+}
+
+std::unique_ptr<Image>
+TextureCache::load(std::uint64_t key) const
+{
+    std::ifstream in(m_directory / fmt::format("{:016x}.img", key), std::ios::binary);
+    if (!in.good())
+        return nullptr;
+
+    std::array<char, CacheFileMagic.size()> magic;
+    std::uint32_t format;
+    std::int32_t width;
+    std::int32_t height;
+    std::int32_t mipLevels;
+    if (!in.read(magic.data(), magic.size()).good() /* Flawfinder: ignore */
+        || magic != CacheFileMagic
+        || !util::readLE(in, format)
+        || !util::readLE(in, width)
+        || !util::readLE(in, height)
+        || !util::readLE(in, mipLevels)
+        || width <= 0 || height <= 0 || mipLevels <= 0)
+    {
+        return nullptr;
+    }
+
+    auto img = std::make_unique<Image>(static_cast<PixelFormat>(format), width, height, mipLevels);
+    if (!img->isValid())
+        return nullptr;
+
+    if (!in.read(reinterpret_cast<char*>(img->getPixels()), img->getSize()).good()) /* Flawfinder: ignore */
+        return nullptr;
+
+    return img;
+}
+
+void
+TextureCache::store(std::uint64_t key, const Image& image) const
+{
+    // Write to a temporary file first, so that another thread or instance
+    // never sees a partial image
+    fs::path path = m_directory / fmt::format("{:016x}.img", key);
+    fs::path tmpPath = m_directory / fmt::format("{:016x}-{:x}.tmp",
+                                                 key,
+                                                 std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        out.write(CacheFileMagic.data(), CacheFileMagic.size());
+        util::writeLE(out, static_cast<std::uint32_t>(image.getFormat()));
+        util::writeLE(out, static_cast<std::int32_t>(image.getWidth()));
+        util::writeLE(out, static_cast<std::int32_t>(image.getHeight()));
+        util::writeLE(out, static_cast<std::int32_t>(image.getMipLevelCount()));
+        out.write(reinterpret_cast<const char*>(image.getPixels()), image.getSize());
+        if (!out.good())
+        {
+            GetLogger()->error("Failed to write texture cache file {}\n", tmpPath);
+            out.close();
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    if (fs::rename(tmpPath, path, ec); ec)
+        fs::remove(tmpPath, ec);
+}
+
+} // end namespace celestia::engine
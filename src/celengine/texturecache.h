@@ -0,0 +1,52 @@
+// texturecache.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// On-disk cache of images derived from texture files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia::engine
+{
+
+class Image;
+
+// Keeps images which are expensive to derive from a texture file, such as
+// the normal maps computed from height maps, so that later sessions read
+// them back instead of building them again. Entries are keyed by a hash of
+// the path, size and modification time of the source file and of a
+// description of how the image was derived from it, so an entry is never
+// used again once its source changes. Entries are stored uncompressed, as
+// reading them has to be faster than deriving the image.
+//
+// The methods may be called from several threads at once.
+class TextureCache
+{
+public:
+    explicit TextureCache(const fs::path& directory);
+
+    // Return the key of the image derived from source, or nothing if the
+    // source file can't be found
+    std::optional<std::uint64_t> getKey(const fs::path& source, std::string_view derivation) const;
+
+    // Return the image stored for key, or nullptr if there is none
+    std::unique_ptr<Image> load(std::uint64_t key) const;
+    void store(std::uint64_t key, const Image& image) const;
+
+private:
+    fs::path m_directory;
+};
+
+} // end namespace celestia::engine
@@ -10,6 +10,8 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
+
 #include "celengine/timeline.h"
 #include "celengine/timelinephase.h"
 #include "celengine/frametree.h"
@@ -54,23 +56,38 @@ const TimelinePhase::SharedConstPtr&
 Timeline::findPhase(double t) const
 {
     // Find the phase containing time t. The overwhelming common case is
-    // nPhases = 1, so we special case that. Otherwise, we do a simple linear search,
-    // as the number of phases in a timeline should always be quite small.
+    // nPhases = 1, so we special case that. Otherwise the phase found by
+    // the previous lookup and the one after it are tried first, as the
+    // time usually moves forward by small steps, then the phases are
+    // searched by their end times, which increase since the phases are
+    // contiguous. Times before the first phase or after the last one are
+    // given the first or last phase.
     if (phases.size() == 1)
-    {
         return phases[0];
-    }
-    else
+
+    auto isPhaseOf = [this, t](std::size_t i)
+    {
+        return (i == 0 || t >= phases[i]->startTime()) &&
+               (i + 1 == phases.size() || t < phases[i]->endTime());
+    };
+
+    std::size_t hint = lastPhase.load(std::memory_order_relaxed);
+    if (hint < phases.size())
     {
-        for (const auto& phase : phases)
+        if (isPhaseOf(hint))
+            return phases[hint];
+        if (hint + 1 < phases.size() && isPhaseOf(hint + 1))
         {
-            if (t < phase->endTime())
-                return phase;
+            lastPhase.store(hint + 1, std::memory_order_relaxed);
+            return phases[hint + 1];
         }
-
-        // Time is greater than the end time of the final phase. Just return the final phase.
-        return phases.back();
     }
+
+    auto iter = std::upper_bound(phases.begin(), phases.end() - 1, t,
+                                 [](double time, const TimelinePhase::SharedConstPtr& phase)
+                                 { return time < phase->endTime(); });
+    lastPhase.store(static_cast<std::size_t>(iter - phases.begin()), std::memory_order_relaxed);
+    return *iter;
 }
 
 
@@ -131,3 +148,13 @@ Timeline::markChanged()
             phase->getFrameTree()->markChanged();
     }
 }
+
+
+std::size_t
+Timeline::getMemoryUsage() const
+{
+    // The phases are created with make_shared, which allocates the control
+    // block with the phase
+    return sizeof(Timeline) + phases.capacity() * sizeof(TimelinePhase::SharedConstPtr) +
+           phases.size() * (sizeof(TimelinePhase) + 2 * sizeof(void*));
+}
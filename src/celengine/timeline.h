@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <vector>
 #include "timelinephase.h"
@@ -33,6 +35,14 @@ public:
 
     void markChanged();
 
+    // Memory used by the timeline and its phases, excluding the orbits,
+    // rotation models and frames they refer to
+    std::size_t getMemoryUsage() const;
+
 private:
     std::vector<TimelinePhase::SharedConstPtr> phases;
+
+    // Index of the phase found by the last lookup. Times usually change
+    // little between lookups, so it is checked before searching.
+    mutable std::atomic<std::size_t> lastPhase{ 0 };
 };
@@ -11,7 +11,9 @@
 
 #include <utility>
 
+#include <celephem/chebyshevorbit.h>
 #include <celephem/samporbit.h>
+#include <celutil/filetype.h>
 
 namespace celestia::engine
 {
@@ -30,7 +32,10 @@ TrajectoryManager::find(const fs::path& source,
     if (auto cachedOrbit = it->second.lock(); cachedOrbit != nullptr)
         return cachedOrbit;
 
-    auto orbit = ephem::LoadSampledTrajectory(it->first.path, interpolation, precision);
+    // Chebyshev trajectories have their own interpolation and precision
+    auto orbit = DetermineFileType(it->first.path) == ContentType::CelestiaChebyshevTrajectory
+        ? ephem::LoadChebyshevTrajectory(it->first.path)
+        : ephem::LoadSampledTrajectory(it->first.path, interpolation, precision);
     if (orbit == nullptr)
     {
         orbits.erase(it);
@@ -71,9 +71,7 @@ class UniversalCoord
       */
     Eigen::Vector3d offsetFromKm(const UniversalCoord& uc) const
     {
-        return Eigen::Vector3d(static_cast<double>(x - uc.x),
-                               static_cast<double>(y - uc.y),
-                               static_cast<double>(z - uc.z)) * celestia::astro::microLightYearsToKilometers(1.0);
+        return offsetFromUly(uc) * celestia::astro::microLightYearsToKilometers(1.0);
     }
 
     /** Get the offset in light years of this coordinate from a point (also with
@@ -82,10 +80,11 @@ class UniversalCoord
       */
     Eigen::Vector3f offsetFromLy(const Eigen::Vector3f& v) const
     {
+        using celestia::util::DifferenceToDouble;
         Eigen::Vector3f vUly = v * 1.0e6f;
-        Eigen::Vector3f offsetUly(static_cast<float>(static_cast<double>(x - R128(vUly.x()))),
-                                  static_cast<float>(static_cast<double>(y - R128(vUly.y()))),
-                                  static_cast<float>(static_cast<double>(z - R128(vUly.z()))));
+        Eigen::Vector3f offsetUly(static_cast<float>(DifferenceToDouble(x, R128(vUly.x()))),
+                                  static_cast<float>(DifferenceToDouble(y, R128(vUly.y()))),
+                                  static_cast<float>(DifferenceToDouble(z, R128(vUly.z()))));
         return offsetUly * 1.0e-6f;
     }
 
@@ -99,9 +98,10 @@ class UniversalCoord
       */
     Eigen::Vector3d offsetFromUly(const UniversalCoord& uc) const
     {
-        return Eigen::Vector3d(static_cast<double>(x - uc.x),
-                               static_cast<double>(y - uc.y),
-                               static_cast<double>(z - uc.z));
+        using celestia::util::DifferenceToDouble;
+        return Eigen::Vector3d(DifferenceToDouble(x, uc.x),
+                               DifferenceToDouble(y, uc.y),
+                               DifferenceToDouble(z, uc.z));
     }
 
     /** Get the value of the coordinate in light years. The result is truncated to
@@ -109,9 +109,10 @@ class UniversalCoord
       */
     Eigen::Vector3d toLy() const
     {
-        return Eigen::Vector3d(static_cast<double>(x),
-                               static_cast<double>(y),
-                               static_cast<double>(z)) * 1.0e-6;
+        using celestia::util::ToDoubleInline;
+        return Eigen::Vector3d(ToDoubleInline(x),
+                               ToDoubleInline(y),
+                               ToDoubleInline(z)) * 1.0e-6;
     }
 
     double distanceFromKm(const UniversalCoord& uc) const
@@ -173,10 +174,12 @@ public:
 
 inline UniversalCoord operator+(const UniversalCoord& uc0, const UniversalCoord& uc1)
 {
-    return UniversalCoord(uc0.x + uc1.x, uc0.y + uc1.y, uc0.z + uc1.z);
+    using celestia::util::AddInline;
+    return UniversalCoord(AddInline(uc0.x, uc1.x), AddInline(uc0.y, uc1.y), AddInline(uc0.z, uc1.z));
 }
 
 inline UniversalCoord operator-(const UniversalCoord& uc0, const UniversalCoord& uc1)
 {
-    return UniversalCoord(uc0.x - uc1.x, uc0.y - uc1.y, uc0.z - uc1.z);
+    using celestia::util::SubtractInline;
+    return UniversalCoord(SubtractInline(uc0.x, uc1.x), SubtractInline(uc0.y, uc1.y), SubtractInline(uc0.z, uc1.z));
 }
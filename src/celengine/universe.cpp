@@ -15,16 +15,22 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
 #include <celmath/intersect.h>
 #include <celmath/ray.h>
 #include <celutil/greek.h>
+#include <celutil/memoryreport.h>
 #include <celutil/utf8.h>
 #include "asterism.h"
 #include "body.h"
+#include "bodybvh.h"
 #include "boundaries.h"
 #include "frametree.h"
 #include "location.h"
@@ -71,7 +77,7 @@ ClosestStarFinder::process(const Star& star, float distance, float /*unused*/)
 {
     if (distance < closestDistance)
     {
-        if (!withPlanets || universe->getSolarSystem(&star))
+        if (!withPlanets || universe->hasSolarSystem(&star))
         {
             closestStar = &star;
             closestDistance = distance;
@@ -111,20 +117,43 @@ struct PlanetPickInfo
     double closestDistance;
     double closestApproxDistance;
     Body* closestBody;
+    // Frame tree traversal order of closestBody; of bodies which are equally
+    // close, the last one in traversal order is picked
+    std::uint32_t closestOrder;
     Eigen::ParametrizedLine<double, 3> pickRay;
     double jd;
     float atanTolerance;
 };
 
+// Conservative test for the approximate pick: reject the sphere only if
+// no point inside it is closer to the pick ray than the closest body found.
 bool
-ApproxPlanetPickTraversal(Body* body, PlanetPickInfo& pickInfo)
+ApproxPlanetPickTest(const math::Sphered& sphere, const PlanetPickInfo& pickInfo)
 {
+    Eigen::Vector3d dir = sphere.center - pickInfo.pickRay.origin();
+    double distance = dir.norm();
+    if (distance <= sphere.radius)
+        return true;
+
+    double cosAngle = std::clamp(dir.dot(pickInfo.pickRay.direction()) / distance, -1.0, 1.0);
+    double minAngle = std::acos(cosAngle) - std::asin(sphere.radius / distance);
+    if (minAngle <= 0.0)
+        return true;
+
+    // Allow for the rounding of the angle computations
+    return std::max(std::sin(minAngle / 2.0), ANGULAR_RES) <= pickInfo.sinAngle2Closest * (1.0 + 1.0e-9);
+}
+
+void
+ApproxPlanetPickTraversal(const engine::BodyBVH::Entry& entry, PlanetPickInfo& pickInfo)
+{
+    Body* body = entry.body;
+
     // Reject invisible bodies and bodies that don't exist at the current time
     if (!body->isVisible() || !body->extant(pickInfo.jd) || !body->isClickable())
-        return true;
+        return;
 
-    Eigen::Vector3d bpos = body->getAstrocentricPosition(pickInfo.jd);
-    Eigen::Vector3d bodyDir = bpos - pickInfo.pickRay.origin();
+    Eigen::Vector3d bodyDir = entry.position - pickInfo.pickRay.origin();
     double distance = bodyDir.norm();
 
     // Check the apparent radius of the orbit against our tolerance factor.
@@ -133,33 +162,35 @@ ApproxPlanetPickTraversal(Body* body, PlanetPickInfo& pickInfo)
     if (auto appOrbitRadius = static_cast<float>(body->getOrbit(pickInfo.jd)->getBoundingRadius() / distance);
         std::max(static_cast<double>(pickInfo.atanTolerance), ANGULAR_RES) > appOrbitRadius)
     {
-        return true;
+        return;
     }
 
     bodyDir.normalize();
     Eigen::Vector3d bodyMiss = bodyDir - pickInfo.pickRay.direction();
-    if (double sinAngle2 = bodyMiss.norm() / 2.0; sinAngle2 <= pickInfo.sinAngle2Closest)
+    if (double sinAngle2 = std::max(bodyMiss.norm() / 2.0, ANGULAR_RES);
+        sinAngle2 < pickInfo.sinAngle2Closest ||
+        (sinAngle2 == pickInfo.sinAngle2Closest && entry.order >= pickInfo.closestOrder))
     {
-        pickInfo.sinAngle2Closest = std::max(sinAngle2, ANGULAR_RES);
+        pickInfo.sinAngle2Closest = sinAngle2;
         pickInfo.closestBody = body;
+        pickInfo.closestOrder = entry.order;
         pickInfo.closestApproxDistance = distance;
     }
-
-    return true;
 }
 
 // Perform an intersection test between the pick ray and a body
-bool
-ExactPlanetPickTraversal(Body* body, PlanetPickInfo& pickInfo)
+void
+ExactPlanetPickTraversal(const engine::BodyBVH::Entry& entry, PlanetPickInfo& pickInfo)
 {
-    Eigen::Vector3d bpos = body->getAstrocentricPosition(pickInfo.jd);
+    Body* body = entry.body;
+    const Eigen::Vector3d& bpos = entry.position;
     float radius = body->getRadius();
     double distance = -1.0;
 
     // Test for intersection with the bounding sphere
     if (!body->isVisible() || !body->extant(pickInfo.jd) || !body->isClickable() ||
         !math::testIntersection(pickInfo.pickRay, math::Sphered(bpos, radius), distance))
-        return true;
+        return;
 
     if (body->getGeometry() == InvalidResource)
     {
@@ -210,47 +241,14 @@ ExactPlanetPickTraversal(Body* body, PlanetPickInfo& pickInfo)
 
     if (double sinAngle2 = bodyMiss.norm() / 2.0;
         sinAngle2 < (celestia::numbers::sqrt2 * 0.5) && // sin(45 degrees) = sqrt(2)/2
-        distance > 0.0 && distance <= pickInfo.closestDistance)
+        distance > 0.0 &&
+        (distance < pickInfo.closestDistance ||
+         (distance == pickInfo.closestDistance && entry.order >= pickInfo.closestOrder)))
     {
         pickInfo.closestDistance = distance;
         pickInfo.closestBody = body;
+        pickInfo.closestOrder = entry.order;
     }
-
-    return true;
-}
-
-// Recursively traverse a frame tree; call the specified callback function for each
-// body in the tree. The callback function returns a boolean indicating whether
-// traversal should continue.
-//
-// TODO: This function works, but could use some cleanup:
-//   * Make it a member of the frame tree class
-//   * Combine info and func into a traversal callback class
-template<typename F>
-bool
-traverseFrameTree(const FrameTree* frameTree,
-                  double tdb,
-                  F func,
-                  PlanetPickInfo& info)
-{
-    for (unsigned int i = 0; i < frameTree->childCount(); i++)
-    {
-        const TimelinePhase* phase = frameTree->getChild(i);
-        if (!phase->includes(tdb))
-            continue;
-
-        Body* body = phase->body();
-        if (!func(body, info))
-            return false;
-
-        if (const FrameTree* bodyFrameTree = body->getFrameTree();
-            bodyFrameTree != nullptr && !traverseFrameTree(bodyFrameTree, tdb, func, info))
-        {
-            return false;
-        }
-    }
-
-    return true;
 }
 
 // StarPicker is a callback class for StarDatabase::findVisibleStars
@@ -548,6 +546,35 @@ getLocationsCompletion(std::vector<std::string>& completion,
     }
 }
 
+struct BodyMemoryUsage
+{
+    std::size_t bodies{ 0 };
+    std::size_t bodiesSize{ 0 };
+    std::size_t timelines{ 0 };
+    std::size_t phases{ 0 };
+    std::size_t timelinesSize{ 0 };
+};
+
+void
+addBodyMemoryUsage(const PlanetarySystem& system, BodyMemoryUsage& usage)
+{
+    for (int i = 0, nBodies = system.getSystemSize(); i < nBodies; ++i)
+    {
+        const Body* body = system.getBody(i);
+        ++usage.bodies;
+        usage.bodiesSize += body->getMemoryUsage();
+        if (const Timeline* timeline = body->getTimeline(); timeline != nullptr)
+        {
+            ++usage.timelines;
+            usage.phases += timeline->phaseCount();
+            usage.timelinesSize += timeline->getMemoryUsage();
+        }
+
+        if (const PlanetarySystem* satellites = body->getSatellites(); satellites != nullptr)
+            addBodyMemoryUsage(*satellites, usage);
+    }
+}
+
 } // end unnamed namespace
 
 // Needs definition of ConstellationBoundaries
@@ -563,6 +590,108 @@ void
 Universe::setStarCatalog(std::unique_ptr<StarDatabase>&& catalog)
 {
     starCatalog = std::move(catalog);
+    ++catalogGeneration;
+
+    std::scoped_lock lock(catalogNamesMutex);
+    for (auto& names : catalogNames)
+        names.clear();
+}
+
+celestia::engine::PagedStarOctree*
+Universe::getPagedStarCatalog() const
+{
+    return pagedStarCatalog.get();
+}
+
+void
+Universe::setPagedStarCatalog(std::unique_ptr<celestia::engine::PagedStarOctree>&& catalog)
+{
+    pagedStarCatalog = std::move(catalog);
+}
+
+const std::vector<std::unique_ptr<celestia::engine::MinorBodyCatalog>>&
+Universe::getMinorBodyCatalogs() const
+{
+    return minorBodyCatalogs;
+}
+
+void
+Universe::addMinorBodyCatalog(std::unique_ptr<celestia::engine::MinorBodyCatalog>&& catalog)
+{
+    minorBodyCatalogs.push_back(std::move(catalog));
+}
+
+void
+Universe::reportMemoryUsage(util::MemoryReport& report) const
+{
+    using namespace std::string_view_literals;
+
+    if (starCatalog != nullptr)
+        starCatalog->reportMemoryUsage(report);
+
+    if (pagedStarCatalog != nullptr)
+    {
+        report.add("Star database"sv, "Paged star blocks"sv, pagedStarCatalog->cachedBytes());
+    }
+
+    if (dsoCatalog != nullptr)
+        dsoCatalog->reportMemoryUsage(report);
+
+    constexpr std::string_view subsystem = "Solar systems"sv;
+    if (solarSystemCatalog != nullptr)
+    {
+        BodyMemoryUsage usage;
+        for (const auto& [starNum, solarSystem] : *solarSystemCatalog)
+        {
+            if (const PlanetarySystem* planets = solarSystem->getPlanets(); planets != nullptr)
+            {
+                usage.bodiesSize += planets->getMemoryUsage();
+                addBodyMemoryUsage(*planets, usage);
+            }
+        }
+
+        report.add(subsystem, "Solar systems"sv,
+                   solarSystemCatalog->size() * (sizeof(SolarSystem) + 4 * sizeof(void*)),
+                   solarSystemCatalog->size());
+        report.add(subsystem, "Bodies"sv, usage.bodiesSize, usage.bodies);
+        report.add(subsystem, "Timelines"sv, usage.timelinesSize, usage.timelines);
+    }
+
+    GetBodyFeaturesManager()->reportMemoryUsage(report);
+
+    std::size_t minorBodies = 0;
+    std::size_t minorBodiesSize = 0;
+    for (const auto& catalog : minorBodyCatalogs)
+    {
+        minorBodies += catalog->size();
+        minorBodiesSize += catalog->getMemoryUsage();
+    }
+    if (!minorBodyCatalogs.empty())
+        report.add(subsystem, "Minor body catalogs"sv, minorBodiesSize, minorBodies);
+
+    std::scoped_lock lock(catalogNamesMutex);
+    std::size_t cachedNames = 0;
+    std::size_t cachedNamesSize = 0;
+    for (const auto& names : catalogNames)
+    {
+        cachedNames += names.size();
+        cachedNamesSize += util::ContainerMemoryUsage(names);
+        for (const auto& entry : names)
+            cachedNamesSize += util::ContainerMemoryUsage(entry.first);
+    }
+    report.add("Universe"sv, "Catalog name cache"sv, cachedNamesSize, cachedNames);
+}
+
+Selection
+Universe::findMinorBody(std::string_view designation)
+{
+    for (const auto& catalog : minorBodyCatalogs)
+    {
+        if (auto index = catalog->find(designation); index != celestia::engine::MinorBodyCatalog::NotFound)
+            return Selection(catalog->promote(index, *this));
+    }
+
+    return Selection();
 }
 
 SolarSystemCatalog*
@@ -587,6 +716,11 @@ void
 Universe::setDSOCatalog(std::unique_ptr<DSODatabase>&& catalog)
 {
     dsoCatalog = std::move(catalog);
+    ++catalogGeneration;
+
+    std::scoped_lock lock(catalogNamesMutex);
+    for (auto& names : catalogNames)
+        names.clear();
 }
 
 AsterismList*
@@ -622,6 +756,14 @@ Universe::getSolarSystem(const Star* star) const
 
     auto starNum = star->getIndex();
     auto iter = solarSystemCatalog->find(starNum);
+    if (iter != solarSystemCatalog->end())
+        return iter->second.get();
+
+    if (pendingSolarSystems.find(starNum) == pendingSolarSystems.end())
+        return nullptr;
+
+    applyPendingSolarSystem(starNum);
+    iter = solarSystemCatalog->find(starNum);
     return iter == solarSystemCatalog->end()
         ? nullptr
         : iter->second.get();
@@ -669,16 +811,85 @@ Universe::getOrCreateSolarSystem(Star* star) const
     if (iter != solarSystemCatalog->end() && iter->first == starNum)
         return iter->second.get();
 
+    if (pendingSolarSystems.find(starNum) != pendingSolarSystems.end())
+    {
+        applyPendingSolarSystem(starNum);
+        iter = solarSystemCatalog->lower_bound(starNum);
+        if (iter != solarSystemCatalog->end() && iter->first == starNum)
+            return iter->second.get();
+    }
+
     iter = solarSystemCatalog->emplace_hint(iter, starNum, std::make_unique<SolarSystem>(star));
     return iter->second.get();
 }
 
+bool
+Universe::hasSolarSystem(const Star* star) const
+{
+    if (star == nullptr)
+        return false;
+
+    auto starNum = star->getIndex();
+    return solarSystemCatalog->find(starNum) != solarSystemCatalog->end() ||
+           pendingSolarSystems.find(starNum) != pendingSolarSystems.end();
+}
+
+void
+Universe::setDeferSolarSystems(bool defer)
+{
+    deferSolarSystems = defer;
+}
+
+bool
+Universe::isDeferringSolarSystems() const
+{
+    return deferSolarSystems;
+}
+
+bool
+Universe::hasPendingSolarSystem(const Star* star) const
+{
+    return pendingSolarSystems.find(star->getIndex()) != pendingSolarSystems.end();
+}
+
+void
+Universe::addPendingSolarSystem(const Star* star, ParsedSolarSystemObjects&& objects)
+{
+    pendingSolarSystems[star->getIndex()].push_back(std::move(objects));
+}
+
+// Create the bodies of a deferred solar system, in the order of the files
+// which defined them. The definitions are removed first, and nothing is
+// deferred while they are applied, so that references between deferred
+// systems create each one once.
+void
+Universe::applyPendingSolarSystem(std::uint32_t starNum) const
+{
+    auto pending = pendingSolarSystems.find(starNum);
+    std::vector<ParsedSolarSystemObjects> objects = std::move(pending->second);
+    pendingSolarSystems.erase(pending);
+
+    bool defer = std::exchange(deferSolarSystems, false);
+    // Applying the definitions only modifies the solar system catalog, which
+    // getOrCreateSolarSystem() already does through a const universe
+    auto& universe = const_cast<Universe&>(*this);
+    for (ParsedSolarSystemObjects& parsed : objects)
+        ApplySolarSystemObjects(std::move(parsed), universe);
+    deferSolarSystems = defer;
+}
+
 const celestia::MarkerList&
 Universe::getMarkers() const
 {
     return markers;
 }
 
+void
+Universe::setMarkers(celestia::MarkerList&& _markers)
+{
+    markers = std::move(_markers);
+}
+
 void
 Universe::markObject(const Selection& sel,
                      const celestia::MarkerRepresentation& rep,
@@ -705,6 +916,51 @@ Universe::markObject(const Selection& sel,
     marker.setSizing(sizing);
 }
 
+void
+Universe::markObjects(util::array_view<const Selection> objects,
+                      const celestia::MarkerRepresentation& rep,
+                      int priority,
+                      bool occludable,
+                      celestia::MarkerSizing sizing)
+{
+    std::unordered_map<Selection, std::size_t> markerIndices;
+    markerIndices.reserve(markers.size() + objects.size());
+    for (std::size_t i = 0; i < markers.size(); ++i)
+        markerIndices.try_emplace(markers[i].object(), i);
+
+    // Replaced markers are removed afterwards, so that the indices stay valid
+    std::vector<bool> replaced(markers.size(), false);
+    for (const Selection& sel : objects)
+    {
+        auto [it, inserted] = markerIndices.try_emplace(sel, markers.size());
+        if (!inserted)
+        {
+            if (priority < markers[it->second].priority())
+                continue;
+            replaced[it->second] = true;
+            it->second = markers.size();
+        }
+
+        celestia::Marker& marker = markers.emplace_back(sel);
+        marker.setRepresentation(rep);
+        marker.setPriority(priority);
+        marker.setOccludable(occludable);
+        marker.setSizing(sizing);
+        replaced.push_back(false);
+    }
+
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < markers.size(); ++i)
+    {
+        if (replaced[i])
+            continue;
+        if (kept != i)
+            markers[kept] = std::move(markers[i]);
+        ++kept;
+    }
+    markers.erase(markers.begin() + static_cast<std::ptrdiff_t>(kept), markers.end());
+}
+
 void
 Universe::unmarkObject(const Selection& sel, int priority)
 {
@@ -750,12 +1006,23 @@ Universe::pickPlanet(const SolarSystem& solarSystem,
     pickInfo.closestDistance = 1.0e50;
     pickInfo.closestApproxDistance = 1.0e50;
     pickInfo.closestBody = nullptr;
+    pickInfo.closestOrder = 0;
     pickInfo.jd = when;
     pickInfo.atanTolerance = (float) atan(tolerance);
 
+    const engine::BodyBVH& bvh = solarSystem.getFrameTree()->getBodyBVH(when);
+    auto exactTest = [&pickInfo](const math::Sphered& sphere)
+    {
+        double distance;
+        return math::testIntersection(pickInfo.pickRay, sphere, distance);
+    };
+    auto approxTest = [&pickInfo](const math::Sphered& sphere) { return ApproxPlanetPickTest(sphere, pickInfo); };
+    auto exactPick = [&pickInfo](const engine::BodyBVH::Entry& entry) { ExactPlanetPickTraversal(entry, pickInfo); };
+    auto approxPick = [&pickInfo](const engine::BodyBVH::Entry& entry) { ApproxPlanetPickTraversal(entry, pickInfo); };
+
     // First see if there's a planet|moon that the pick ray intersects.
     // Select the closest planet|moon intersected.
-    traverseFrameTree(solarSystem.getFrameTree(), when, &ExactPlanetPickTraversal, pickInfo);
+    bvh.traverse(exactTest, exactPick);
 
     if (pickInfo.closestBody != nullptr)
     {
@@ -764,7 +1031,8 @@ Universe::pickPlanet(const SolarSystem& solarSystem,
 
         // Check if there is a satellite in front of the primary body that is
         // sufficiently close to the pickRay
-        traverseFrameTree(solarSystem.getFrameTree(), when, &ApproxPlanetPickTraversal, pickInfo);
+        pickInfo.closestOrder = 0;
+        bvh.traverse(approxTest, approxPick);
 
         if (pickInfo.closestBody == closestBody)
             return  Selection(closestBody);
@@ -786,7 +1054,7 @@ Universe::pickPlanet(const SolarSystem& solarSystem,
     // clicks on a pixel where the planet's disc has been rendered--in order
     // to make distant planets visible on the screen at all, their apparent
     // size has to be greater than their actual disc size.
-    traverseFrameTree(solarSystem.getFrameTree(), when, &ApproxPlanetPickTraversal, pickInfo);
+    bvh.traverse(approxTest, approxPick);
 
     if (pickInfo.sinAngle2Closest <= sinTol2)
         return Selection(pickInfo.closestBody);
@@ -839,6 +1107,9 @@ Universe::pickDeepSkyObject(const UniversalCoord& origin,
                             float faintestMag,
                             float tolerance) const
 {
+    if (dsoCatalog == nullptr)
+        return Selection();
+
     Eigen::Vector3d orig = origin.toLy();
     Eigen::Vector3d dir = direction.cast<double>();
 
@@ -997,16 +1268,8 @@ Universe::findObjectInContext(const Selection& sel,
     return Selection();
 }
 
-// Select an object by name, with the following priority:
-//   1. Try to look up the name in the star catalog
-//   2. Search the deep sky catalog for a matching name.
-//   3. Check the solar systems for planet names; we don't make any decisions
-//      about which solar systems are relevant, and let the caller pass them
-//      to us to search.
 Selection
-Universe::find(std::string_view s,
-               util::array_view<const Selection> contexts,
-               bool i18n) const
+Universe::findInCatalogs(std::string_view s, bool i18n) const
 {
     if (starCatalog != nullptr)
     {
@@ -1028,6 +1291,48 @@ Universe::find(std::string_view s,
             return Selection(dso);
     }
 
+    return Selection();
+}
+
+// Look up a name in the star and deep sky catalogs, remembering the result.
+// The catalogs don't change once loaded, so only the number of names is
+// bounded.
+Selection
+Universe::findCachedInCatalogs(std::string_view s, bool i18n) const
+{
+    constexpr std::size_t MaxCatalogNames = 4096;
+
+    auto& names = catalogNames[i18n ? 1 : 0];
+    std::string name(s);
+    {
+        std::scoped_lock lock(catalogNamesMutex);
+        if (auto iter = names.find(name); iter != names.end())
+            return iter->second;
+    }
+
+    Selection sel = findInCatalogs(s, i18n);
+
+    std::scoped_lock lock(catalogNamesMutex);
+    if (names.size() >= MaxCatalogNames)
+        names.clear();
+    names.try_emplace(std::move(name), sel);
+    return sel;
+}
+
+// Select an object by name, with the following priority:
+//   1. Try to look up the name in the star catalog
+//   2. Search the deep sky catalog for a matching name.
+//   3. Check the solar systems for planet names; we don't make any decisions
+//      about which solar systems are relevant, and let the caller pass them
+//      to us to search.
+Selection
+Universe::find(std::string_view s,
+               util::array_view<const Selection> contexts,
+               bool i18n) const
+{
+    if (Selection sel = findCachedInCatalogs(s, i18n); !sel.empty())
+        return sel;
+
     for (const auto& context : contexts)
     {
         Selection sel = findObjectInContext(context, s, i18n);
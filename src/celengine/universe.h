@@ -11,14 +11,19 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include <celengine/boundaries.h>
 #include <celengine/univcoord.h>
 #include <celengine/stardb.h>
+#include <celengine/pagedstaroctree.h>
+#include <celengine/minorbodycatalog.h>
 #include <celengine/dsodb.h>
 #include <celengine/solarsys.h>
 #include <celengine/deepskyobj.h>
@@ -37,12 +42,27 @@ class Universe
     StarDatabase* getStarCatalog() const;
     void setStarCatalog(std::unique_ptr<StarDatabase>&&);
 
+    // Optional render-only catalog of faint stars, see PagedStarOctree
+    celestia::engine::PagedStarOctree* getPagedStarCatalog() const;
+    void setPagedStarCatalog(std::unique_ptr<celestia::engine::PagedStarOctree>&&);
+
+    // Optional compact catalogs of small bodies, see MinorBodyCatalog
+    const std::vector<std::unique_ptr<celestia::engine::MinorBodyCatalog>>& getMinorBodyCatalogs() const;
+    void addMinorBodyCatalog(std::unique_ptr<celestia::engine::MinorBodyCatalog>&&);
+    // Find a body of the minor body catalogs by its designation, promoting
+    // it to a Body
+    Selection findMinorBody(std::string_view designation);
+
     SolarSystemCatalog* getSolarSystemCatalog() const;
     void setSolarSystemCatalog(std::unique_ptr<SolarSystemCatalog>&&);
 
     DSODatabase* getDSOCatalog() const;
     void setDSOCatalog(std::unique_ptr<DSODatabase>&&);
 
+    // Incremented when the star or deep sky catalog is replaced, which
+    // invalidates the selections of their objects held elsewhere
+    std::uint32_t getCatalogGeneration() const { return catalogGeneration; }
+
     AsterismList* getAsterisms() const;
     void setAsterisms(std::unique_ptr<AsterismList>&&);
 
@@ -74,6 +94,17 @@ class Universe
     SolarSystem* getSolarSystem(const Star* star) const;
     SolarSystem* getSolarSystem(const Selection&) const;
     SolarSystem* getOrCreateSolarSystem(Star* star) const;
+    // Return true if the star has a solar system, without creating the
+    // bodies of a deferred one
+    bool hasSolarSystem(const Star* star) const;
+
+    // While set, ApplySolarSystemObjects() keeps back the definitions of
+    // the objects of stars without a solar system yet. They are applied by
+    // getSolarSystem() when the solar system is first needed.
+    void setDeferSolarSystems(bool defer);
+    bool isDeferringSolarSystems() const;
+    bool hasPendingSolarSystem(const Star* star) const;
+    void addPendingSolarSystem(const Star* star, ParsedSolarSystemObjects&& objects);
 
     void getNearStars(const UniversalCoord& position,
                       float maxDistance,
@@ -84,17 +115,34 @@ class Universe
                     int priority,
                     bool occludable = true,
                     celestia::MarkerSizing sizing = celestia::ConstantSize);
+    // Mark all the objects with the same representation; equivalent to
+    // calling markObject() for each, without searching the markers each time
+    void markObjects(celestia::util::array_view<const Selection>,
+                     const celestia::MarkerRepresentation& rep,
+                     int priority,
+                     bool occludable = true,
+                     celestia::MarkerSizing sizing = celestia::ConstantSize);
     void unmarkObject(const Selection&, int priority);
     void unmarkAll();
     bool isMarked(const Selection&, int priority) const;
     const celestia::MarkerList& getMarkers() const;
+    void setMarkers(celestia::MarkerList&&);
+
+    // Add the memory used by the catalogs and the solar system bodies; the
+    // orbits and rotation models are reported by their managers
+    void reportMemoryUsage(celestia::util::MemoryReport&) const;
 
  private:
+    void applyPendingSolarSystem(std::uint32_t starNum) const;
+
     void getCompletion(std::vector<std::string>& completion,
                        std::string_view s,
                        celestia::util::array_view<const Selection> contexts,
                        bool withLocations = false) const;
 
+    Selection findInCatalogs(std::string_view name, bool i18n) const;
+    Selection findCachedInCatalogs(std::string_view name, bool i18n) const;
+
     Selection findChildObject(const Selection& sel,
                               std::string_view name,
                               bool i18n = false) const;
@@ -123,11 +171,23 @@ class Universe
 
  private:
     std::unique_ptr<StarDatabase> starCatalog{nullptr};
+    std::unique_ptr<celestia::engine::PagedStarOctree> pagedStarCatalog{nullptr};
+    std::vector<std::unique_ptr<celestia::engine::MinorBodyCatalog>> minorBodyCatalogs{ };
     std::unique_ptr<DSODatabase> dsoCatalog{nullptr};
     std::unique_ptr<SolarSystemCatalog> solarSystemCatalog{nullptr};
+    mutable std::map<std::uint32_t, std::vector<ParsedSolarSystemObjects>> pendingSolarSystems{ };
+    mutable bool deferSolarSystems{ false };
     std::unique_ptr<AsterismList> asterisms{nullptr};
     std::unique_ptr<ConstellationBoundaries> boundaries{nullptr};
 
+    // Names looked up in the star and deep sky catalogs by find(), with
+    // their results, including names which were not found. Star names are
+    // resolved by trying several designation formats, and scripts and
+    // URLs look up the same few names again and again.
+    mutable std::unordered_map<std::string, Selection> catalogNames[2];
+    mutable std::mutex catalogNamesMutex;
+    std::uint32_t catalogGeneration{ 0 };
+
     celestia::MarkerList markers{ };
     std::vector<const Star*> closeStars{ };
 };
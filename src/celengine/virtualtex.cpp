@@ -10,9 +10,11 @@
 
 #include "virtualtex.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <fstream>
+#include <iterator>
 #include <optional>
 #include <system_error>
 #include <utility>
@@ -23,6 +25,8 @@
 #include <celutil/filetype.h>
 #include <celutil/logger.h>
 #include <celutil/tokenizer.h>
+#include <celutil/uploadbudget.h>
+#include <celutil/workerpool.h>
 
 
 using celestia::util::GetLogger;
@@ -33,6 +37,26 @@ namespace
 
 constexpr int MaxResolutionLevels = 13;
 
+// Limits on tiles which are loaded ahead of their use: the number submitted
+// per frame, the number collected per frame, and the number of tile loads in
+// flight above which nothing more is prefetched.
+constexpr std::size_t MaxPrefetchPerFrame = 4;
+constexpr std::size_t MaxPrefetchRequests = 64;
+constexpr unsigned int MaxPendingTiles = 16;
+
+// Textures of evicted tiles kept for reuse, and the number of frames a tile
+// must have been unused before it may be evicted
+constexpr std::size_t MaxFreeTileTextures = 16;
+constexpr unsigned int MinTileEvictionAge = 2;
+
+std::size_t tileMemoryBudget = 256 * 1024 * 1024;
+bool synchronousTileLoading = false;
+unsigned int pendingTileLoads = 0;
+
+// Approach rate, in distances per second, above which the tiles of the next
+// level of detail are prefetched
+constexpr float PrefetchApproachRate = 0.02f;
+
 
 constexpr bool
 isPow2(int x)
@@ -176,6 +200,10 @@ VirtualTexture::getTile(int lod, int u, int v)
     Tile* tile = node->tile.get();
     unsigned int tileLOD = 0;
 
+    // The most detailed tile on the way which is already resident
+    Tile* residentTile = tile != nullptr && tile->tex != nullptr ? tile : nullptr;
+    unsigned int residentLOD = 0;
+
     for (int n = 0; n < lod; n++)
     {
         unsigned int mask = 1 << (lod - n - 1);
@@ -188,6 +216,11 @@ VirtualTexture::getTile(int lod, int u, int v)
         {
             tile = node->tile.get();
             tileLOD = n + 1;
+            if (tile->tex != nullptr)
+            {
+                residentTile = tile;
+                residentLOD = tileLOD;
+            }
         }
     }
 
@@ -200,12 +233,24 @@ VirtualTexture::getTile(int lod, int u, int v)
     unsigned int tileV = v >> (lod - tileLOD);
     makeResident(tile, tileLOD, tileU, tileV);
 
-    // It's possible that we failed to make the tile resident, either
-    // because the texture file was bad, or there was an unresolvable
-    // out of memory situation.  In that case there is nothing else to
-    // do but return a texture tile with a null texture name.
+    // Once the requested tile itself is in use, look ahead at the tiles
+    // which will be needed next.
+    if (tile->tex != nullptr && tileLOD == (unsigned int) lod)
+        queueLookahead(tileLOD, tileU, tileV);
+
+    // The tile may still be loading, or we may have failed to make it
+    // resident, either because the texture file was bad, or there was an
+    // unresolvable out of memory situation.  Use a lower resolution tile
+    // if there is one, otherwise return a texture tile with a null
+    // texture name.
     if (!tile->tex)
-        return TextureTile(0);
+    {
+        if (residentTile == nullptr)
+            return TextureTile(0);
+
+        tile = residentTile;
+        tileLOD = residentLOD;
+    }
 
     // Set up the texture subrect to be the entire texture
     float texU = 0.0f;
@@ -220,6 +265,8 @@ VirtualTexture::getTile(int lod, int u, int v)
     texU = (u & ((1 << lodDiff) - 1)) * texDU;
     texV = (v & ((1 << lodDiff) - 1)) * texDV;
 
+    tile->lastUsed = ticks;
+
     return TextureTile(tile->tex->getName(), texU, texV, texDU, texDV);
 }
 
@@ -258,6 +305,9 @@ VirtualTexture::beginUsage()
 {
     ticks++;
     tilesRequested = 0;
+    finishTileLoads();
+    evictTiles();
+    issuePrefetches();
 }
 
 
@@ -267,55 +317,327 @@ VirtualTexture::endUsage()
 }
 
 
-std::unique_ptr<ImageTexture>
-VirtualTexture::loadTileTexture(unsigned int lod, unsigned int u, unsigned int v)
+void
+VirtualTexture::prefetchBaseLevel()
+{
+    if (synchronousTileLoading)
+        return;
+
+    for (unsigned int v = 0; v < (1U << baseSplit); v++)
+    {
+        for (unsigned int u = 0; u < (2U << baseSplit); u++)
+        {
+            if (pendingTiles >= MaxPendingTiles)
+                return;
+            if (Tile* tile = findTile(baseSplit, u, v); tile != nullptr)
+                makeResident(tile, baseSplit, u, v, true);
+        }
+    }
+}
+
+
+void
+VirtualTexture::setApproachRate(float rate)
+{
+    approachRate = rate;
+}
+
+
+std::size_t
+VirtualTexture::getMemoryUsage() const
+{
+    return residentBytes + freeBytes;
+}
+
+
+void
+VirtualTexture::setTileMemoryBudget(std::size_t budget)
+{
+    tileMemoryBudget = budget;
+}
+
+
+void
+VirtualTexture::setSynchronousTileLoading(bool enable)
 {
-    lod >>= baseSplit;
-    assert(lod < (unsigned)MaxResolutionLevels);
+    synchronousTileLoading = enable;
+}
 
+
+bool
+VirtualTexture::hasPendingTileLoads()
+{
+    return pendingTileLoads > 0;
+}
+
+
+fs::path
+VirtualTexture::tileFilePath(unsigned int lod, unsigned int u, unsigned int v) const
+{
     auto filename = fs::u8path(fmt::format("{}{}_{}", tilePrefix, u, v));
     filename += tileExt;
 
-    auto path = tilePath /
-                fmt::format("level{:d}", lod) /
-                filename;
+    return tilePath /
+           fmt::format("level{:d}", lod) /
+           filename;
+}
 
-    auto img = Image::load(path);
-    if (img == nullptr)
-        return nullptr;
 
+std::unique_ptr<ImageTexture>
+VirtualTexture::createTileTexture(const Image& img, unsigned int lod)
+{
     std::unique_ptr<ImageTexture> tex = nullptr;
 
     // Only use mip maps for the LOD 0; for higher LODs, the function of mip
     // mapping is built into the texture.
     MipMapMode mipMapMode = lod == 0 ? DefaultMipMaps : NoMipMaps;
 
-    if (isPow2(img->getWidth()) && isPow2(img->getHeight()))
-        tex = std::make_unique<ImageTexture>(*img, EdgeClamp, mipMapMode);
+    // Recycle the texture of an evicted tile of the same size and format
+    // rather than creating a new one
+    if (mipMapMode == NoMipMaps)
+    {
+        auto it = std::find_if(freeTextures.begin(), freeTextures.end(),
+                               [&img](const std::unique_ptr<ImageTexture>& t) { return t->replaceImage(img); });
+        if (it != freeTextures.end())
+        {
+            tex = std::move(*it);
+            freeTextures.erase(it);
+            freeBytes -= tex->getMemoryUsage();
+        }
+    }
+
+    if (tex == nullptr && isPow2(img.getWidth()) && isPow2(img.getHeight()))
+        tex = std::make_unique<ImageTexture>(img, EdgeClamp, mipMapMode);
 
     // TODO: Virtual textures can have tiles in different formats, some
     // compressed and some not. The compression flag doesn't make much
     // sense for them.
-    compressed = img->isCompressed();
+    compressed = img.isCompressed();
 
     return tex;
 }
 
 
-void VirtualTexture::makeResident(Tile* tile, unsigned int lod, unsigned int u, unsigned int v)
+// Tile images are read on the loader threads; the textures are created by
+// beginUsage() in a later frame. Until then, getTile() falls back to a
+// lower resolution tile.
+void VirtualTexture::makeResident(Tile* tile, unsigned int lod, unsigned int u, unsigned int v, bool prefetched)
 {
-    if (tile->tex == nullptr && !tile->loadFailed)
+    if (tile->tex == nullptr && !tile->loadFailed && !tile->loading)
     {
-        // Potentially evict other tiles in order to make this one fit
-        tile->tex = loadTileTexture(lod, u, v);
-        if (tile->tex == nullptr)
+        lod >>= baseSplit;
+        assert(lod < (unsigned)MaxResolutionLevels);
+
+        tile->loading = true;
+        ++pendingTiles;
+        ++pendingTileLoads;
+        if (synchronousTileLoading)
         {
-            tile->loadFailed = true;
+            finishTileLoad(LoadedTile{ tile, lod, Image::load(tileFilePath(lod, u, v)), prefetched });
+            return;
         }
+
+        celestia::util::GetLoaderPool()->submit([queue = loadedTiles, tile, lod, path = tileFilePath(lod, u, v), prefetched]
+        {
+            auto img = Image::load(path);
+            std::lock_guard lock(queue->mutex);
+            queue->tiles.push_back(LoadedTile{ tile, lod, std::move(img), prefetched });
+        });
     }
 }
 
 
+VirtualTexture::Tile*
+VirtualTexture::findTile(unsigned int lod, unsigned int u, unsigned int v) const
+{
+    const TileQuadtreeNode* node = &tileTree[u >> lod];
+    for (unsigned int n = 0; n < lod; n++)
+    {
+        unsigned int mask = 1 << (lod - n - 1);
+        unsigned int child = (((v & mask) << 1) | (u & mask)) >> (lod - n - 1);
+        if (!node->children[child])
+            return nullptr;
+        node = node->children[child].get();
+    }
+
+    return node->tile.get();
+}
+
+
+void VirtualTexture::requestPrefetch(unsigned int lod, unsigned int u, unsigned int v)
+{
+    if (prefetchRequests.size() >= MaxPrefetchRequests)
+        return;
+
+    const Tile* tile = findTile(lod, u, v);
+    if (tile != nullptr && tile->tex == nullptr && !tile->loadFailed && !tile->loading)
+        prefetchRequests.push_back(TileRequest{ lod, u, v });
+}
+
+
+// Queue the tiles around a tile which is in use: when the observer is
+// closing in, the four tiles of the next level of detail which cover it,
+// and always the neighbours at the same level, which come into view as the
+// object turns or the view pans. The longitude wraps around, the latitude
+// does not.
+void VirtualTexture::queueLookahead(unsigned int lod, unsigned int u, unsigned int v)
+{
+    if (approachRate > PrefetchApproachRate && lod + 1 < nResolutionLevels)
+    {
+        for (unsigned int i = 0; i < 4; i++)
+            requestPrefetch(lod + 1, u * 2 + (i & 1), v * 2 + (i >> 1));
+    }
+
+    unsigned int uCount = 2 << lod;
+    unsigned int vCount = 1 << lod;
+    requestPrefetch(lod, (u + 1) % uCount, v);
+    requestPrefetch(lod, (u + uCount - 1) % uCount, v);
+    if (v + 1 < vCount)
+        requestPrefetch(lod, u, v + 1);
+    if (v > 0)
+        requestPrefetch(lod, u, v - 1);
+}
+
+
+// Prefetches never compete with the tiles which are needed for the current
+// frame: they are only submitted while few loads are in flight, and the
+// requests which don't fit are dropped, to be collected again if they are
+// still relevant.
+void VirtualTexture::issuePrefetches()
+{
+    // Tiles loaded synchronously are never missing, so prefetching them
+    // would only slow down the frame
+    if (synchronousTileLoading)
+    {
+        prefetchRequests.clear();
+        return;
+    }
+
+    std::size_t issued = 0;
+    for (const TileRequest& request : prefetchRequests)
+    {
+        if (issued == MaxPrefetchPerFrame || pendingTiles >= MaxPendingTiles)
+            break;
+
+        Tile* tile = findTile(request.lod, request.u, request.v);
+        if (tile == nullptr || tile->loading || tile->tex != nullptr)
+            continue;
+
+        makeResident(tile, request.lod, request.u, request.v, true);
+        ++issued;
+    }
+
+    prefetchRequests.clear();
+}
+
+
+// Tiles are uploaded within the budget shared with the other resources;
+// the others wait in the queue for the next frames.
+void VirtualTexture::finishTileLoads()
+{
+    using celestia::util::UploadBudget;
+
+    std::vector<LoadedTile> loaded;
+    {
+        std::lock_guard lock(loadedTiles->mutex);
+        loaded.swap(loadedTiles->tiles);
+    }
+
+    UploadBudget* budget = celestia::util::GetUploadBudget();
+    std::vector<LoadedTile> deferred;
+    for (LoadedTile& loadedTile : loaded)
+    {
+        if (!budget->allows(loadedTile.prefetched ? UploadBudget::Priority::Prefetch
+                                                  : UploadBudget::Priority::Visible))
+        {
+            budget->defer();
+            deferred.push_back(std::move(loadedTile));
+            continue;
+        }
+
+        auto start = UploadBudget::Clock::now();
+        std::size_t bytesBefore = residentBytes;
+        finishTileLoad(loadedTile);
+        budget->charge(residentBytes - bytesBefore, UploadBudget::Clock::now() - start);
+    }
+
+    if (!deferred.empty())
+    {
+        std::lock_guard lock(loadedTiles->mutex);
+        loadedTiles->tiles.insert(loadedTiles->tiles.begin(),
+                                  std::make_move_iterator(deferred.begin()),
+                                  std::make_move_iterator(deferred.end()));
+    }
+}
+
+
+void VirtualTexture::finishTileLoad(const LoadedTile& loadedTile)
+{
+    Tile* tile = loadedTile.tile;
+    tile->loading = false;
+    --pendingTiles;
+    --pendingTileLoads;
+    if (loadedTile.image != nullptr)
+        tile->tex = createTileTexture(*loadedTile.image, loadedTile.lod);
+    if (tile->tex == nullptr)
+    {
+        tile->loadFailed = true;
+    }
+    else
+    {
+        tile->lastUsed = ticks;
+        residentBytes += tile->tex->getMemoryUsage();
+        residentTiles.push_back(ResidentTile{ tile, loadedTile.lod });
+    }
+}
+
+
+// Over budget, evict the least recently used tiles which were not used in
+// the last frame. The tiles of the lowest level of detail are kept: they
+// are the fallback of every other tile. Evicted tiles are loaded again by
+// getTile() when they are needed.
+void VirtualTexture::evictTiles()
+{
+    if (tileMemoryBudget == 0 || residentBytes <= tileMemoryBudget)
+        return;
+
+    std::sort(residentTiles.begin(), residentTiles.end(),
+              [](const ResidentTile& a, const ResidentTile& b) { return a.tile->lastUsed < b.tile->lastUsed; });
+
+    std::size_t kept = 0;
+    for (const ResidentTile& resident : residentTiles)
+    {
+        Tile* tile = resident.tile;
+        if (residentBytes > tileMemoryBudget &&
+            resident.lod != 0 &&
+            tile->lastUsed + MinTileEvictionAge <= ticks)
+        {
+            residentBytes -= tile->tex->getMemoryUsage();
+            releaseTileTexture(std::move(tile->tex));
+        }
+        else
+        {
+            residentTiles[kept++] = resident;
+        }
+    }
+
+    residentTiles.resize(kept);
+}
+
+
+void VirtualTexture::releaseTileTexture(std::unique_ptr<ImageTexture>&& tex)
+{
+    if (freeTextures.size() == MaxFreeTileTextures)
+    {
+        freeBytes -= freeTextures.front()->getMemoryUsage();
+        freeTextures.erase(freeTextures.begin());
+    }
+
+    freeBytes += tex->getMemoryUsage();
+    freeTextures.push_back(std::move(tex));
+}
+
+
 void VirtualTexture::populateTileTree()
 {
     // Count the number of resolution levels present
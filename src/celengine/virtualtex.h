@@ -10,8 +10,11 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include <celcompat/filesystem.h>
 #include <celengine/texture.h>
@@ -35,6 +38,18 @@ public:
     int getVTileCount(int lod) const override;
     void beginUsage() override;
     void endUsage() override;
+    void setApproachRate(float rate) override;
+    void prefetchBaseLevel() override;
+    std::size_t getMemoryUsage() const override;
+
+    // Memory available to the resident tiles of each virtual texture, in
+    // bytes; zero means no limit
+    static void setTileMemoryBudget(std::size_t budget);
+    // Load the tiles when they are requested instead of on the loader
+    // threads, so that no frame is drawn with lower resolution tiles
+    static void setSynchronousTileLoading(bool enable);
+    // Tiles of any virtual texture are being loaded
+    static bool hasPendingTileLoads();
 
 private:
     struct Tile
@@ -43,6 +58,24 @@ private:
         unsigned int lastUsed{ 0 };
         std::unique_ptr<ImageTexture> tex{ nullptr };
         bool loadFailed{ false };
+        bool loading{ false };
+    };
+
+    // Image of a tile read on a loader thread
+    struct LoadedTile
+    {
+        Tile* tile;
+        unsigned int lod;
+        std::unique_ptr<celestia::engine::Image> image;
+        // Requested ahead of use, so finished after the other uploads
+        bool prefetched;
+    };
+
+    // Shared with the loader jobs, which may outlive the texture
+    struct LoadedTileQueue
+    {
+        std::mutex mutex;
+        std::vector<LoadedTile> tiles;
     };
 
     struct TileQuadtreeNode
@@ -54,8 +87,17 @@ private:
 
     void populateTileTree();
     void addTileToTree(std::unique_ptr<Tile> tile, unsigned int lod, unsigned int u, unsigned int v);
-    void makeResident(Tile* tile, unsigned int lod, unsigned int u, unsigned int v);
-    std::unique_ptr<ImageTexture> loadTileTexture(unsigned int lod, unsigned int u, unsigned int v);
+    Tile* findTile(unsigned int lod, unsigned int u, unsigned int v) const;
+    void makeResident(Tile* tile, unsigned int lod, unsigned int u, unsigned int v, bool prefetched = false);
+    void requestPrefetch(unsigned int lod, unsigned int u, unsigned int v);
+    void queueLookahead(unsigned int lod, unsigned int u, unsigned int v);
+    void issuePrefetches();
+    void evictTiles();
+    void finishTileLoads();
+    void finishTileLoad(const LoadedTile&);
+    fs::path tileFilePath(unsigned int lod, unsigned int u, unsigned int v) const;
+    std::unique_ptr<ImageTexture> createTileTexture(const celestia::engine::Image& img, unsigned int lod);
+    void releaseTileTexture(std::unique_ptr<ImageTexture>&& tex);
 
 private:
     fs::path tilePath;
@@ -65,6 +107,33 @@ private:
     unsigned int ticks{ 0 };
     unsigned int tilesRequested{ 0 };
     unsigned int nResolutionLevels{ 0 };
+    std::size_t residentBytes{ 0 };
+    unsigned int pendingTiles{ 0 };
+    float approachRate{ 0.0f };
+
+    struct TileRequest
+    {
+        unsigned int lod;
+        unsigned int u;
+        unsigned int v;
+    };
+
+    // Tiles which are not needed yet but likely to be soon; collected by
+    // getTile() and submitted at the start of the next frame
+    std::vector<TileRequest> prefetchRequests;
+
+    struct ResidentTile
+    {
+        Tile* tile;
+        unsigned int lod;
+    };
+
+    // Tiles with a texture, in no particular order
+    std::vector<ResidentTile> residentTiles;
+    // Textures of evicted tiles, kept for reuse by tiles of the same size
+    // and format; they are counted in freeBytes, not residentBytes
+    std::vector<std::unique_ptr<ImageTexture>> freeTextures;
+    std::size_t freeBytes{ 0 };
 
     enum
     {
@@ -73,6 +142,7 @@ private:
     };
 
     std::array<TileQuadtreeNode, 2> tileTree{};
+    std::shared_ptr<LoadedTileQueue> loadedTiles{ std::make_shared<LoadedTileQueue>() };
 };
 
 
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace celestia::ephem
+{
+
+// A Chebyshev trajectory file has a header followed by count segments.
+// Each segment is two doubles for start and end times of the segment (TDB
+// Julian dates), then the Chebyshev coefficients of x, y and z in that
+// order, each coeffCount doubles. The constant term is not halved. Positions are in kilometers
+// in the J2000 ecliptic frame, as in xyzv files. The segments are sorted
+// by time and may have different spans.
+#pragma pack(push, 1)
+struct ChebyshevBinaryHeader
+{
+    ChebyshevBinaryHeader() = delete;
+
+    char magic[8];
+    std::uint16_t byteOrder;
+    std::uint16_t digits;
+    std::uint32_t coeffCount;
+    std::uint64_t count;
+};
+
+#pragma pack(pop)
+
+static_assert(std::is_standard_layout_v<ChebyshevBinaryHeader>);
+static_assert(sizeof(ChebyshevBinaryHeader) % sizeof(double) == 0);
+
+constexpr inline std::string_view CHEBYSHEV_MAGIC{ "CELCHEB\0", 8 };
+static_assert(CHEBYSHEV_MAGIC.size() == sizeof(ChebyshevBinaryHeader::magic));
+
+// Limit of coeffCount, well beyond the degrees worth fitting
+constexpr inline std::uint32_t ChebyshevMaxCoeffs = 64;
+
+// Number of doubles in a segment
+constexpr std::size_t
+ChebyshevSegmentSize(std::uint32_t coeffCount)
+{
+    return 2 + 3 * static_cast<std::size_t>(coeffCount);
+}
+
+}
@@ -0,0 +1,375 @@
+// chebyshevorbit.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Trajectories made of Chebyshev segments.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "chebyshevorbit.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celcompat/bit.h>
+#include <celutil/gettext.h>
+#include <celutil/logger.h>
+#include <celutil/mappedfile.h>
+#include "chebyshevbinary.h"
+#include "orbit.h"
+
+using celestia::util::GetLogger;
+
+namespace celestia::ephem
+{
+
+namespace
+{
+
+// Segments of the trajectory are either in a mapped file or, when the file
+// can't be mapped, in a buffer read from it.
+class ChebyshevOrbit final : public CachingOrbit
+{
+public:
+    ChebyshevOrbit(std::unique_ptr<util::MappedFile>&& file,
+                   std::vector<double>&& buffer,
+                   const double* segments,
+                   std::uint32_t coeffCount,
+                   std::size_t count,
+                   double boundingRadius);
+    ~ChebyshevOrbit() override = default;
+
+    Eigen::Vector3d computePosition(double jd) const override;
+    Eigen::Vector3d computeVelocity(double jd) const override;
+    double getPeriod() const override;
+    double getBoundingRadius() const override;
+    bool isPeriodic() const override;
+    void getValidRange(double& begin, double& end) const override;
+    bool isReentrant() const override { return true; }
+
+private:
+    const double* segment(std::size_t i) const { return segments + i * segmentSize; }
+    std::size_t findSegment(double jd) const;
+
+    std::unique_ptr<util::MappedFile> file;
+    std::vector<double> buffer;
+    const double* segments;
+    std::uint32_t coeffCount;
+    std::size_t segmentSize;
+    std::size_t count;
+    double boundingRadius;
+    mutable std::atomic<std::size_t> lastSegment{ 0 };
+};
+
+
+ChebyshevOrbit::ChebyshevOrbit(std::unique_ptr<util::MappedFile>&& _file,
+                               std::vector<double>&& _buffer,
+                               const double* _segments,
+                               std::uint32_t _coeffCount,
+                               std::size_t _count,
+                               double _boundingRadius) :
+    file(std::move(_file)),
+    buffer(std::move(_buffer)),
+    segments(_segments),
+    coeffCount(_coeffCount),
+    segmentSize(ChebyshevSegmentSize(_coeffCount)),
+    count(_count),
+    boundingRadius(_boundingRadius)
+{
+}
+
+
+// Return the last segment starting at or before jd, or the first segment
+// for times before the trajectory. As for sampled trajectories, the last
+// segment used is checked first.
+std::size_t
+ChebyshevOrbit::findSegment(double jd) const
+{
+    std::size_t n = lastSegment.load(std::memory_order_relaxed);
+    if (n < count && jd >= segment(n)[0] && jd <= segment(n)[1])
+        return n;
+
+    std::size_t low = 0;
+    std::size_t high = count;
+    while (low < high)
+    {
+        std::size_t mid = low + (high - low) / 2;
+        if (segment(mid)[0] <= jd)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    n = low > 0 ? low - 1 : 0;
+    lastSegment.store(n, std::memory_order_relaxed);
+    return n;
+}
+
+
+Eigen::Vector3d
+ChebyshevOrbit::computePosition(double jd) const
+{
+    const double* s = segment(findSegment(jd));
+    double x = std::clamp(2.0 * (jd - s[0]) / (s[1] - s[0]) - 1.0, -1.0, 1.0);
+
+    // Clenshaw's recurrence
+    const double* coeffs = s + 2;
+    Eigen::Vector3d b1 = Eigen::Vector3d::Zero();
+    Eigen::Vector3d b2 = Eigen::Vector3d::Zero();
+    for (std::uint32_t j = coeffCount - 1; j > 0; j--)
+    {
+        Eigen::Vector3d c(coeffs[j], coeffs[coeffCount + j], coeffs[2 * coeffCount + j]);
+        Eigen::Vector3d b0 = c + 2.0 * x * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+
+    Eigen::Vector3d c0(coeffs[0], coeffs[coeffCount], coeffs[2 * coeffCount]);
+    Eigen::Vector3d p = c0 + x * b1 - b2;
+
+    // Convert from the ecliptic frame of the file to Celestia's
+    return Eigen::Vector3d(p.x(), p.z(), -p.y());
+}
+
+
+Eigen::Vector3d
+ChebyshevOrbit::computeVelocity(double jd) const
+{
+    const double* s = segment(findSegment(jd));
+    if (jd < s[0] || jd > s[1])
+        return Eigen::Vector3d::Zero();
+
+    double x = 2.0 * (jd - s[0]) / (s[1] - s[0]) - 1.0;
+
+    // Derivatives of the Chebyshev polynomials from their recurrence,
+    // T'(n+1) = 2 T(n) + 2x T'(n) - T'(n-1)
+    const double* coeffs = s + 2;
+    double t0 = 1.0;
+    double t1 = x;
+    double dt0 = 0.0;
+    double dt1 = 1.0;
+    Eigen::Vector3d v = Eigen::Vector3d::Zero();
+    for (std::uint32_t j = 1; j < coeffCount; j++)
+    {
+        v += Eigen::Vector3d(coeffs[j], coeffs[coeffCount + j], coeffs[2 * coeffCount + j]) * dt1;
+
+        double t2 = 2.0 * x * t1 - t0;
+        double dt2 = 2.0 * t1 + 2.0 * x * dt1 - dt0;
+        t0 = t1;
+        t1 = t2;
+        dt0 = dt1;
+        dt1 = dt2;
+    }
+
+    v *= 2.0 / (s[1] - s[0]);
+    return Eigen::Vector3d(v.x(), v.z(), -v.y());
+}
+
+
+double
+ChebyshevOrbit::getPeriod() const
+{
+    return segment(count - 1)[1] - segment(0)[0];
+}
+
+
+double
+ChebyshevOrbit::getBoundingRadius() const
+{
+    return boundingRadius;
+}
+
+
+bool
+ChebyshevOrbit::isPeriodic() const
+{
+    return false;
+}
+
+
+void
+ChebyshevOrbit::getValidRange(double& begin, double& end) const
+{
+    begin = segment(0)[0];
+    end = segment(count - 1)[1];
+}
+
+
+bool
+ParseChebyshevHeader(const char* header,
+                     std::size_t size,
+                     const fs::path& filename,
+                     std::uint32_t& coeffCount,
+                     std::uint64_t& count)
+{
+    if (size < sizeof(ChebyshevBinaryHeader))
+    {
+        GetLogger()->error(_("Error reading header of {}.\n"), filename);
+        return false;
+    }
+
+    if (std::string_view(header + offsetof(ChebyshevBinaryHeader, magic), CHEBYSHEV_MAGIC.size()) != CHEBYSHEV_MAGIC)
+    {
+        GetLogger()->error(_("Bad Chebyshev trajectory file {}.\n"), filename);
+        return false;
+    }
+
+    decltype(ChebyshevBinaryHeader::byteOrder) byteOrder;
+    std::memcpy(&byteOrder, header + offsetof(ChebyshevBinaryHeader, byteOrder), sizeof(byteOrder));
+    if (byteOrder != static_cast<decltype(byteOrder)>(celestia::compat::endian::native))
+    {
+        GetLogger()->error(_("Unsupported byte order {}, expected {} in {}.\n"),
+                           byteOrder, static_cast<int>(celestia::compat::endian::native), filename);
+        return false;
+    }
+
+    decltype(ChebyshevBinaryHeader::digits) digits;
+    std::memcpy(&digits, header + offsetof(ChebyshevBinaryHeader, digits), sizeof(digits));
+    if (digits != std::numeric_limits<double>::digits)
+    {
+        GetLogger()->error(_("Unsupported digits number {}, expected {} in {}.\n"),
+                            digits, std::numeric_limits<double>::digits, filename);
+        return false;
+    }
+
+    std::memcpy(&coeffCount, header + offsetof(ChebyshevBinaryHeader, coeffCount), sizeof(coeffCount));
+    std::memcpy(&count, header + offsetof(ChebyshevBinaryHeader, count), sizeof(count));
+    if (coeffCount == 0 || coeffCount > ChebyshevMaxCoeffs || count == 0)
+    {
+        GetLogger()->error(_("Invalid segment count {} or coefficient count {} in {}.\n"), count, coeffCount, filename);
+        return false;
+    }
+
+    return true;
+}
+
+
+// Check that the segments are sorted and compute a bound on the distance
+// from the origin: a Chebyshev series is bounded by the sum of its
+// coefficients.
+bool
+CheckSegments(const double* segments,
+              std::uint32_t coeffCount,
+              std::size_t count,
+              const fs::path& filename,
+              double& boundingRadius)
+{
+    std::size_t segmentSize = ChebyshevSegmentSize(coeffCount);
+    double lastStart = -std::numeric_limits<double>::infinity();
+    boundingRadius = 0.0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const double* s = segments + i * segmentSize;
+        if (!(s[0] < s[1]) || !std::isfinite(s[0]) || !std::isfinite(s[1]) || s[0] < lastStart)
+        {
+            GetLogger()->error(_("Bad time span of segment {} in {}.\n"), i, filename);
+            return false;
+        }
+
+        lastStart = s[0];
+
+        Eigen::Vector3d bound = Eigen::Vector3d::Zero();
+        for (std::uint32_t j = 0; j < coeffCount; j++)
+        {
+            bound += Eigen::Vector3d(s[2 + j], s[2 + coeffCount + j], s[2 + 2 * coeffCount + j]).cwiseAbs();
+        }
+
+        boundingRadius = std::max(boundingRadius, bound.norm());
+    }
+
+    return true;
+}
+
+} // end unnamed namespace
+
+
+/*! Load a trajectory file made of Chebyshev segments. The file is mapped
+ *  when possible, so that only the segments used are read.
+ */
+std::shared_ptr<const Orbit>
+LoadChebyshevTrajectory(const fs::path& filename)
+{
+    std::uint32_t coeffCount = 0;
+    std::uint64_t count = 0;
+    std::unique_ptr<util::MappedFile> file = util::MappedFile::open(filename);
+    std::vector<double> buffer;
+    const double* segments = nullptr;
+
+    if (file != nullptr)
+    {
+        if (!ParseChebyshevHeader(file->data(), file->size(), filename, coeffCount, count))
+            return nullptr;
+
+        std::size_t available = (file->size() - sizeof(ChebyshevBinaryHeader)) / sizeof(double);
+        if (count > available / ChebyshevSegmentSize(coeffCount))
+        {
+            GetLogger()->error(_("Chebyshev trajectory file {} is truncated.\n"), filename);
+            return nullptr;
+        }
+
+        // The mapping is page aligned and the header a multiple of the size
+        // of a double, so the segments are aligned for reading in place.
+        segments = reinterpret_cast<const double*>(file->data() + sizeof(ChebyshevBinaryHeader));
+    }
+    else
+    {
+        std::ifstream in(filename, std::ios::in | std::ios::binary);
+        if (!in.good())
+        {
+            GetLogger()->error(_("Error opening Chebyshev trajectory file {}.\n"), filename);
+            return nullptr;
+        }
+
+        std::array<char, sizeof(ChebyshevBinaryHeader)> header;
+        in.read(header.data(), header.size()); /* Flawfinder: ignore */
+        if (!ParseChebyshevHeader(header.data(), static_cast<std::size_t>(in.gcount()), filename, coeffCount, count))
+            return nullptr;
+
+        std::error_code ec;
+        auto fileSize = fs::file_size(filename, ec);
+        if (ec || count > (fileSize - sizeof(ChebyshevBinaryHeader)) / sizeof(double) / ChebyshevSegmentSize(coeffCount))
+        {
+            GetLogger()->error(_("Chebyshev trajectory file {} is truncated.\n"), filename);
+            return nullptr;
+        }
+
+        buffer.resize(static_cast<std::size_t>(count) * ChebyshevSegmentSize(coeffCount));
+        auto byteCount = static_cast<std::streamsize>(buffer.size() * sizeof(double));
+        if (!in.read(reinterpret_cast<char*>(buffer.data()), byteCount).good()) /* Flawfinder: ignore */
+        {
+            GetLogger()->error(_("Error reading Chebyshev trajectory file {}.\n"), filename);
+            return nullptr;
+        }
+
+        segments = buffer.data();
+    }
+
+    double boundingRadius = 0.0;
+    if (!CheckSegments(segments, coeffCount, static_cast<std::size_t>(count), filename, boundingRadius))
+        return nullptr;
+
+    return std::make_shared<ChebyshevOrbit>(std::move(file),
+                                            std::move(buffer),
+                                            segments,
+                                            coeffCount,
+                                            static_cast<std::size_t>(count),
+                                            boundingRadius);
+}
+
+} // end namespace celestia::ephem
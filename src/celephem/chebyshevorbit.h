@@ -0,0 +1,25 @@
+// chebyshevorbit.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Trajectories made of Chebyshev segments.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <memory>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia::ephem
+{
+
+class Orbit;
+
+std::shared_ptr<const Orbit> LoadChebyshevTrajectory(const fs::path&);
+
+} // end namespace celestia::ephem
@@ -0,0 +1,147 @@
+// chebyshevwindow.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Chebyshev fit of an expensive function of time over a short window.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+#include <Eigen/Core>
+
+#include <celcompat/numbers.h>
+
+namespace celestia::ephem
+{
+
+// Fits a vector valued function of time with Chebyshev polynomials over a
+// window of time. When the function is evaluated at closely spaced times,
+// as when time runs at a moderate rate, it is evaluated at the nodes of
+// the fit once per window instead of at every time. At times further
+// apart, the function is evaluated directly.
+//
+// With a tolerance, the span of the windows adapts between minSpan and
+// maxSpan so that the estimated error of the fit stays below it.
+class ChebyshevWindow
+{
+ public:
+    explicit ChebyshevWindow(double span) :
+        ChebyshevWindow(span, span, span, std::numeric_limits<double>::infinity())
+    {
+    }
+
+    ChebyshevWindow(double _span, double _minSpan, double _maxSpan, double _tolerance) :
+        nextSpan(_span),
+        minSpan(_minSpan),
+        maxSpan(_maxSpan),
+        tolerance(_tolerance)
+    {
+    }
+
+    template<typename F>
+    Eigen::Vector3d
+    evaluate(double t, F&& f) const
+    {
+        // The window is shared by all threads evaluating the orbit; f must
+        // not keep any state of its own.
+        std::lock_guard<std::mutex> lock(mutex);
+        if (t >= start && t <= start + span)
+            return interpolate(t);
+
+        // Only fit a window when the last few times asked for were close
+        // enough for the evaluations at the nodes to pay off. A single
+        // close time is not enough, as velocities are computed from the
+        // positions at two close times.
+        double previous = lastTime;
+        lastTime = t;
+        if (std::abs(t - previous) <= nextSpan / (4.0 * NCoeffs))
+            ++closeTimes;
+        else
+            closeTimes = 0;
+
+        if (closeTimes < 2)
+            return f(t);
+
+        span = nextSpan;
+        for (;;)
+        {
+            // Place the window ahead of t in the direction time runs
+            start = t >= previous ? t : t - span;
+            fit(f);
+
+            // The last coefficients bound the error of the fit
+            double error = coeffs[NCoeffs - 1].norm() + coeffs[NCoeffs - 2].norm();
+            if (error > tolerance && span > minSpan)
+            {
+                span = std::max(span * 0.5, minSpan);
+                continue;
+            }
+
+            nextSpan = error < tolerance * 0.01 ? std::min(span * 2.0, maxSpan) : span;
+            return interpolate(t);
+        }
+    }
+
+ private:
+    static constexpr unsigned int NCoeffs = 12;
+
+    template<typename F>
+    void
+    fit(F& f) const
+    {
+        std::array<Eigen::Vector3d, NCoeffs> values;
+        for (unsigned int k = 0; k < NCoeffs; k++)
+        {
+            double x = std::cos(celestia::numbers::pi * (k + 0.5) / NCoeffs);
+            values[k] = f(start + (x + 1.0) * 0.5 * span);
+        }
+
+        for (unsigned int j = 0; j < NCoeffs; j++)
+        {
+            Eigen::Vector3d c = Eigen::Vector3d::Zero();
+            for (unsigned int k = 0; k < NCoeffs; k++)
+                c += values[k] * std::cos(celestia::numbers::pi * j * (k + 0.5) / NCoeffs);
+            coeffs[j] = c * (2.0 / NCoeffs);
+        }
+    }
+
+    Eigen::Vector3d
+    interpolate(double t) const
+    {
+        // Clenshaw's recurrence
+        double x = 2.0 * (t - start) / span - 1.0;
+        Eigen::Vector3d b1 = Eigen::Vector3d::Zero();
+        Eigen::Vector3d b2 = Eigen::Vector3d::Zero();
+        for (unsigned int j = NCoeffs - 1; j > 0; j--)
+        {
+            Eigen::Vector3d b0 = coeffs[j] + 2.0 * x * b1 - b2;
+            b2 = b1;
+            b1 = b0;
+        }
+
+        return coeffs[0] * 0.5 + x * b1 - b2;
+    }
+
+    mutable double span{ 0.0 };
+    mutable double nextSpan;
+    double minSpan;
+    double maxSpan;
+    double tolerance;
+    mutable double start{ std::numeric_limits<double>::quiet_NaN() };
+    mutable double lastTime{ std::numeric_limits<double>::quiet_NaN() };
+    mutable unsigned int closeTimes{ 0 };
+    mutable std::array<Eigen::Vector3d, NCoeffs> coeffs;
+    mutable std::mutex mutex;
+};
+
+} // end namespace celestia::ephem
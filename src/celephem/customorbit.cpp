@@ -14,7 +14,6 @@
 #include <cstddef>
 #include <cstring>
 #include <cmath>
-#include <fstream>
 #include <map>
 #include <memory>
 #include <utility>
@@ -57,6 +56,15 @@ constexpr double SaturnRadius = 60330.0;
 // the apocenter distance computed from the mean elements.
 constexpr double BoundingRadiusSlack = 1.2;
 
+// The analytic theories are evaluated through a FittedOrbit, so that they
+// are interpolated when time runs at a moderate rate
+template<typename T, typename... Args>
+std::shared_ptr<const CachingOrbit>
+MakeFittedOrbit(Args&&... args)
+{
+    return std::make_shared<FittedOrbit>(std::make_shared<T>(std::forward<Args>(args)...));
+}
+
 using PlanetElements = std::array<double, 9>;
 using StaticElements = std::array<double, 23>;
 
@@ -2699,13 +2707,13 @@ CreateUranianSatelliteOrbit(int n)
     assert(n >= 1 && n <= 5);
     --n;
 
-    return std::make_shared<UranianSatelliteOrbit>(uran_a[n], uran_n[n],
-                                                   uran_L0[n], uran_L1[n],
-                                                   uran_L_k[n], uran_L_theta[n],
-                                                   uran_L_phi[n], uran_z_k[n],
-                                                   uran_z_theta[n], uran_z_phi[n],
-                                                   uran_zeta_k[n], uran_zeta_theta[n],
-                                                   uran_zeta_phi[n]);
+    return MakeFittedOrbit<UranianSatelliteOrbit>(uran_a[n], uran_n[n],
+                                                  uran_L0[n], uran_L1[n],
+                                                  uran_L_k[n], uran_L_theta[n],
+                                                  uran_L_phi[n], uran_z_k[n],
+                                                  uran_z_theta[n], uran_z_phi[n],
+                                                  uran_zeta_k[n], uran_zeta_theta[n],
+                                                  uran_zeta_phi[n]);
 }
 
 /*! Orbit of Triton, from Seidelmann, _Explanatory Supplement to the
@@ -3044,11 +3052,31 @@ public:
         return boundingRadius;
     }
 
+    bool isReentrant() const override
+    {
+        return true;
+    }
+
+    // The states of all items are computed together and shared by the
+    // orbits using the ephemeris, which are evaluated at the same times
     Eigen::Vector3d computePosition(double tjd) const override
     {
-        // Get the position relative to the Earth (for the Moon) or
+        JPLEphStates states = ephem.getStates(tjd);
+        return toCelestiaFrame(relativeState(states.positions));
+    }
+
+    Eigen::Vector3d computeVelocity(double tjd) const override
+    {
+        JPLEphStates states = ephem.getStates(tjd);
+        return toCelestiaFrame(relativeState(states.velocities));
+    }
+
+private:
+    Eigen::Vector3d relativeState(const std::array<Eigen::Vector3d, JPLEphStates::NItems>& states) const
+    {
+        // Get the state relative to the Earth (for the Moon) or
         // the solar system barycenter.
-        Eigen::Vector3d pos = ephem.getPlanetPosition(target, tjd);
+        Eigen::Vector3d state = states[static_cast<std::size_t>(target)];
 
         if (center == JPLEphemItem::SSB && target != JPLEphemItem::Moon)
         {
@@ -3060,28 +3088,33 @@ public:
         }
         else
         {
-            Eigen::Vector3d centerPos = ephem.getPlanetPosition(center, tjd);
+            const auto& earthState = states[static_cast<std::size_t>(JPLEphemItem::Earth)];
+            Eigen::Vector3d centerState = states[static_cast<std::size_t>(center)];
             if (target == JPLEphemItem::Moon)
             {
-                pos += ephem.getPlanetPosition(JPLEphemItem::Earth, tjd);
+                state += earthState;
             }
             if (center == JPLEphemItem::Moon)
             {
-                centerPos += ephem.getPlanetPosition(JPLEphemItem::Earth, tjd);
+                centerState += earthState;
             }
 
-            // Compute the position of target relative to the center
-            pos -= centerPos;
+            // Compute the state of target relative to the center
+            state -= centerState;
         }
 
+        return state;
+    }
+
+    static Eigen::Vector3d toCelestiaFrame(const Eigen::Vector3d& v)
+    {
         // Rotate from the J2000 mean equator to the ecliptic
-        pos = math::XRotation(-astro::J2000Obliquity) * pos;
+        Eigen::Vector3d ecliptic = math::XRotation(-astro::J2000Obliquity) * v;
 
         // Convert to Celestia's coordinate system
-        return Eigen::Vector3d(pos.x(), pos.z(), -pos.y());
+        return Eigen::Vector3d(ecliptic.x(), ecliptic.z(), -ecliptic.y());
     }
 
-private:
     const JPLEphemeris& ephem;
     JPLEphemItem target;
     JPLEphemItem center;
@@ -3102,9 +3135,7 @@ CreateJPLEphOrbit(JPLEphemItem target,
     if (!jplephInitialized)
     {
         jplephInitialized = true;
-        std::ifstream in("data/jpleph.dat", std::ios::in | std::ios::binary);
-        if (in.good())
-            jpleph = JPLEphemeris::load(in);
+        jpleph = JPLEphemeris::load(fs::path("data/jpleph.dat"));
         if (jpleph != nullptr)
         {
             if (unsigned int deNumber = jpleph->getDENumber(); deNumber != 100)
@@ -3211,61 +3242,61 @@ enum class CustomOrbitType
 std::shared_ptr<const Orbit>
 CreateMercuryOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<MercuryOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<MercuryOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateVenusOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<VenusOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<VenusOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateEarthOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<EarthOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<EarthOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateMoonOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<LunarOrbit>(), yearToJD(-2000), yearToJD(4000), astro::EarthMass + astro::LunarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<LunarOrbit>(), yearToJD(-2000), yearToJD(4000), astro::EarthMass + astro::LunarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateMarsOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<MarsOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<MarsOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateJupiterOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<JupiterOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<JupiterOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateSaturnOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<SaturnOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<SaturnOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateUranusOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<UranusOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<UranusOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreateNeptuneOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<NeptuneOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<NeptuneOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 std::shared_ptr<const Orbit>
 CreatePlutoOrbit()
 {
-    return std::make_shared<MixedOrbit>(std::make_shared<PlutoOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
+    return std::make_shared<MixedOrbit>(MakeFittedOrbit<PlutoOrbit>(), yearToJD(-4000), yearToJD(4000), astro::SolarMass);
 }
 
 // JPL ephemerides for planets (relative to the Sun)
@@ -3429,110 +3460,110 @@ CreateJplSunSsbOrbit()
 std::shared_ptr<const Orbit>
 CreateHeleneOrbit()
 {
-    return std::make_shared<HTC20Orbit>(24, HeleneTerms.data(), HeleneAmps.data(), HeleneAngles, 2.736915, 380000);
+    return MakeFittedOrbit<HTC20Orbit>(24, HeleneTerms.data(), HeleneAmps.data(), HeleneAngles, 2.736915, 380000);
 }
 
 std::shared_ptr<const Orbit>
 CreateTelestoOrbit()
 {
-    return std::make_shared<HTC20Orbit>(12, TelestoTerms.data(), TelestoAmps.data(), TelestoAngles, 1.887802, 300000);
+    return MakeFittedOrbit<HTC20Orbit>(12, TelestoTerms.data(), TelestoAmps.data(), TelestoAngles, 1.887802, 300000);
 }
 
 std::shared_ptr<const Orbit>
 CreateCalypsoOrbit()
 {
-    return std::make_shared<HTC20Orbit>(24, CalypsoTerms.data(), CalypsoAmps.data(), CalypsoAngles, 1.887803, 300000);
+    return MakeFittedOrbit<HTC20Orbit>(24, CalypsoTerms.data(), CalypsoAmps.data(), CalypsoAngles, 1.887803, 300000);
 }
 
 // various planetary satellite orbits
 std::shared_ptr<const Orbit>
 CreatePhobosOrbit()
 {
-    return std::make_shared<PhobosOrbit>();
+    return MakeFittedOrbit<PhobosOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateDeimosOrbit()
 {
-    return std::make_shared<DeimosOrbit>();
+    return MakeFittedOrbit<DeimosOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateIoOrbit()
 {
-    return std::make_shared<IoOrbit>();
+    return MakeFittedOrbit<IoOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateEuropaOrbit()
 {
-    return std::make_shared<EuropaOrbit>();
+    return MakeFittedOrbit<EuropaOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateGanymedeOrbit()
 {
-    return std::make_shared<GanymedeOrbit>();
+    return MakeFittedOrbit<GanymedeOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateCallistoOrbit()
 {
-    return std::make_shared<CallistoOrbit>();
+    return MakeFittedOrbit<CallistoOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateMimasOrbit()
 {
-    return std::make_shared<MimasOrbit>();
+    return MakeFittedOrbit<MimasOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateEnceladusOrbit()
 {
-    return std::make_shared<EnceladusOrbit>();
+    return MakeFittedOrbit<EnceladusOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateTethysOrbit()
 {
-    return std::make_shared<TethysOrbit>();
+    return MakeFittedOrbit<TethysOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateDioneOrbit()
 {
-    return std::make_shared<DioneOrbit>();
+    return MakeFittedOrbit<DioneOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateRheaOrbit()
 {
-    return std::make_shared<RheaOrbit>();
+    return MakeFittedOrbit<RheaOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateTitanOrbit()
 {
-    return std::make_shared<TitanOrbit>();
+    return MakeFittedOrbit<TitanOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateHyperionOrbit()
 {
-    return std::make_shared<HyperionOrbit>();
+    return MakeFittedOrbit<HyperionOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreateIapetusOrbit()
 {
-    return std::make_shared<IapetusOrbit>();
+    return MakeFittedOrbit<IapetusOrbit>();
 }
 
 std::shared_ptr<const Orbit>
 CreatePhoebeOrbit()
 {
-    return std::make_shared<PhoebeOrbit>();
+    return MakeFittedOrbit<PhoebeOrbit>();
 }
 
 std::shared_ptr<const Orbit>
@@ -3568,7 +3599,7 @@ CreateOberonOrbit()
 std::shared_ptr<const Orbit>
 CreateTritonOrbit()
 {
-    return std::make_shared<TritonOrbit>();
+    return MakeFittedOrbit<TritonOrbit>();
 }
 
 using CustomOrbitFactory = std::shared_ptr<const Orbit> (*)();
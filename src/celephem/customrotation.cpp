@@ -152,8 +152,11 @@ public:
         else if (T > P03LP_VALID_CENTURIES)
             T = P03LP_VALID_CENTURIES;
 
-        PrecessionAngles prec = PrecObliquity_P03LP(T);
-        EclipticPole pole = EclipticPrecession_P03LP(T);
+        // The series are tabulated as the frame may be evaluated at a
+        // different time in every frame.
+        const PrecessionTable_P03LP& table = PrecessionTable_P03LP::shared();
+        PrecessionAngles prec = table.precObliquity(T);
+        EclipticPole pole = table.eclipticPrecession(T);
 
         double obliquity = math::degToRad(prec.epsA / 3600);
         double precession = math::degToRad(prec.pA / 3600);
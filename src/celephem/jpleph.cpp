@@ -10,14 +10,19 @@
 // Load JPL's DE200, DE405, and DE406 ephemerides and compute planet
 // positions.
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstring>
+#include <fstream>
 #include <istream>
+#include <memory>
+#include <mutex>
 #include <type_traits>
 
 #include <celcompat/bit.h>
+#include <celutil/mappedfile.h>
 #include "jpleph.h"
 
 namespace celestia::ephem
@@ -81,6 +86,27 @@ double readDouble(std::istream& in, bool swap)
     return d;
 }
 
+// The Chebyshev polynomials T_j(u) up to n, and with dcc non-null their
+// derivatives
+void chebyshevBasis(double u, unsigned int n, double* cc, double* dcc)
+{
+    cc[0] = 1.0;
+    cc[1] = u;
+    for (unsigned int j = 2; j < n; j++)
+        cc[j] = 2.0 * u * cc[j - 1] - cc[j - 2];
+
+    if (dcc == nullptr)
+        return;
+
+    dcc[0] = 0.0;
+    dcc[1] = 1.0;
+    for (unsigned int j = 2; j < n; j++)
+        dcc[j] = 2.0 * cc[j - 1] + 2.0 * u * dcc[j - 1] - dcc[j - 2];
+}
+
+// The coefficients of an item, one row per coordinate
+using ChebyshevCoeffs = Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic, Eigen::RowMajor>>;
+
 #pragma pack(push, 1)
 
 // These packed structs are only used for offset calculations, they should
@@ -134,6 +160,9 @@ static_assert(std::is_standard_layout_v<JPLEFileHeader>);
 } // end unnamed namespace
 
 
+JPLEphemeris::~JPLEphemeris() = default;
+
+
 unsigned int JPLEphemeris::getDENumber() const
 {
     return DENum;
@@ -159,6 +188,71 @@ bool JPLEphemeris::getByteSwap() const
     return swapBytes;
 }
 
+// Return the coefficients of an item in the record covering tjd, which
+// must be within the span of the ephemeris. The coefficients of mapped
+// records are byte swapped into buffer. Also returns the time tjd
+// normalized to [-1, 1] over its granule, and the length of the granule.
+const double* JPLEphemeris::findCoefficients(std::size_t item,
+                                             double tjd,
+                                             double* buffer,
+                                             double& u,
+                                             double& granuleDays) const
+{
+    // recNo is always >= 0:
+    auto recNo = (unsigned int) ((tjd - startDate) / daysPerInterval);
+    // Make sure we don't go past the end of the array if t == endDate
+    unsigned int nRecords = mappedRecords == nullptr ? static_cast<unsigned int>(records.size()) : nMappedRecords;
+    if (recNo >= nRecords)
+        recNo = nRecords - 1;
+
+    const JPLEphCoeffInfo& info = coeffInfo[item];
+    assert(info.nGranules >= 1);
+    assert(info.nGranules <= 32);
+    assert(info.nCoeffs <= MaxChebyshevCoeffs);
+
+    // The coefficients of a record follow its start and end time
+    double t0;
+    const char* mappedRecord = nullptr;
+    const JPLEphRecord* rec = nullptr;
+    if (mappedRecords == nullptr)
+    {
+        rec = &records[recNo];
+        t0 = rec->t0;
+    }
+    else
+    {
+        mappedRecord = mappedRecords + static_cast<std::size_t>(recNo) * recordSize * sizeof(double);
+        getMaybeSwapDouble(t0, mappedRecord, swapBytes);
+        mappedRecord += 2 * sizeof(double);
+    }
+
+    // offset is the index of the Chebyshev coefficients in the record
+    std::size_t offset = info.offset;
+
+    // nGranules is unsigned int so it will be compared against FFFFFFFF:
+    if (info.nGranules == (unsigned int) -1)
+    {
+        granuleDays = daysPerInterval;
+        u = 2.0 * (tjd - t0) / daysPerInterval - 1.0;
+    }
+    else
+    {
+        granuleDays = daysPerInterval / info.nGranules;
+        auto granule = (int) ((tjd - t0) / granuleDays);
+        double granuleStartDate = t0 + granuleDays * (double) granule;
+        offset += static_cast<std::size_t>(granule) * info.nCoeffs * 3;
+        u = 2.0 * (tjd - granuleStartDate) / granuleDays - 1.0;
+    }
+
+    if (rec != nullptr)
+        return rec->coeffs.data() + offset;
+
+    // Only the coefficients of the item are read from a mapped file
+    for (unsigned int i = 0; i < info.nCoeffs * 3; i++)
+        getMaybeSwapDouble(buffer[i], mappedRecord + (offset + i) * sizeof(double), swapBytes);
+    return buffer;
+}
+
 // Return the position of an object relative to the solar system barycenter
 // or the Earth (in the case of the Moon) at a specified TDB Julian date tjd.
 // If tjd is outside the span covered by the ephemeris it is clamped to a
@@ -184,74 +278,106 @@ Eigen::Vector3d JPLEphemeris::getPlanetPosition(JPLEphemItem planet, double tjd)
     }
 
     // Clamp time to [ startDate, endDate ]
-    if (tjd < startDate)
-        tjd = startDate;
-    else if (tjd > endDate)
-    tjd = endDate;
-
-    // recNo is always >= 0:
-    auto recNo = (unsigned int) ((tjd - startDate) / daysPerInterval);
-    // Make sure we don't go past the end of the array if t == endDate
-    if (recNo >= records.size())
-        recNo = records.size() - 1;
-    const JPLEphRecord* rec = &records[recNo];
+    tjd = std::clamp(tjd, startDate, endDate);
 
     auto planetIdx = static_cast<std::size_t>(planet);
+    double buffer[MaxChebyshevCoeffs * 3];
+    double u;
+    double granuleDays;
+    const double* coeffs = findCoefficients(planetIdx, tjd, buffer, u, granuleDays);
 
-    assert(coeffInfo[planetIdx].nGranules >= 1);
-    assert(coeffInfo[planetIdx].nGranules <= 32);
-    assert(coeffInfo[planetIdx].nCoeffs <= MaxChebyshevCoeffs);
+    // Evaluate the Chebyshev polynomials
+    double cc[MaxChebyshevCoeffs];
+    unsigned int nCoeffs = coeffInfo[planetIdx].nCoeffs;
+    chebyshevBasis(u, nCoeffs, cc, nullptr);
+    return ChebyshevCoeffs(coeffs, 3, nCoeffs) * Eigen::Map<const Eigen::VectorXd>(cc, nCoeffs);
+}
 
-    // u is the normalized time (in [-1, 1]) for interpolating
-    // coeffs is a pointer to the Chebyshev coefficients
-    double u = 0.0;
-    const double* coeffs = nullptr;
 
-    // nGranules is unsigned int so it will be compared against FFFFFFFF:
-    if (coeffInfo[planetIdx].nGranules == (unsigned int) -1)
-    {
-        coeffs = rec->coeffs.data() + coeffInfo[planetIdx].offset;
-        u = 2.0 * (tjd - rec->t0) / daysPerInterval - 1.0;
-    }
-    else
+// Compute the positions and velocities of all items at once. The Chebyshev
+// polynomials are evaluated once for all items with the same granule
+// length, which is in a few groups for the JPL ephemerides.
+void JPLEphemeris::computeStates(double tjd, JPLEphStates& states) const
+{
+    states.t = tjd;
+    tjd = std::clamp(tjd, startDate, endDate);
+
+    struct Basis
     {
-        double daysPerGranule = daysPerInterval / coeffInfo[planetIdx].nGranules;
-        auto granule = (int) ((tjd - rec->t0) / daysPerGranule);
-        double granuleStartDate = rec->t0 + daysPerGranule * (double) granule;
-        coeffs = rec->coeffs.data() + coeffInfo[planetIdx].offset +
-                 granule * coeffInfo[planetIdx].nCoeffs * 3;
-        u = 2.0 * (tjd - granuleStartDate) / daysPerGranule - 1.0;
-    }
+        unsigned int nGranules;
+        unsigned int nCoeffs;
+        double cc[MaxChebyshevCoeffs];
+        double dcc[MaxChebyshevCoeffs];
+    };
 
-    // Evaluate the Chebyshev polynomials
-    double sum[3];
-    double cc[MaxChebyshevCoeffs];
-    unsigned int nCoeffs = coeffInfo[planetIdx].nCoeffs;
-    for (int i = 0; i < 3; i++)
+    std::array<Basis, JPLEph_NBodies> bases;
+    std::size_t nBases = 0;
+
+    double buffer[MaxChebyshevCoeffs * 3];
+    for (std::size_t item = 0; item < JPLEph_NBodies; item++)
     {
-        cc[0] = 1.0;
-        cc[1] = u;
-        sum[i] = coeffs[i * nCoeffs] + coeffs[i * nCoeffs + 1] * u;
-        for (unsigned int j = 2; j < nCoeffs; j++)
+        double u;
+        double granuleDays;
+        const double* coeffs = findCoefficients(item, tjd, buffer, u, granuleDays);
+
+        unsigned int nCoeffs = coeffInfo[item].nCoeffs;
+        Basis* basis = std::find_if(bases.data(), bases.data() + nBases,
+                                    [&](const Basis& b) { return b.nGranules == coeffInfo[item].nGranules; });
+        if (basis == bases.data() + nBases)
+        {
+            ++nBases;
+            basis->nGranules = coeffInfo[item].nGranules;
+            basis->nCoeffs = 0;
+        }
+
+        // The basis of a granulation is extended for items with more coefficients
+        if (basis->nCoeffs < nCoeffs)
         {
-            cc[j] = 2.0 * u * cc[j - 1] - cc[j - 2];
-            sum[i] += coeffs[i * nCoeffs + j] * cc[j];
+            chebyshevBasis(u, nCoeffs, basis->cc, basis->dcc);
+            basis->nCoeffs = nCoeffs;
         }
+
+        auto c = ChebyshevCoeffs(coeffs, 3, nCoeffs);
+        states.positions[item] = c * Eigen::Map<const Eigen::VectorXd>(basis->cc, nCoeffs);
+        // The derivative is with respect to u, which spans two units over a granule
+        states.velocities[item] = c * Eigen::Map<const Eigen::VectorXd>(basis->dcc, nCoeffs) * (2.0 / granuleDays);
     }
 
-    return Eigen::Vector3d(sum[0], sum[1], sum[2]);
+    auto earth = static_cast<std::size_t>(JPLEphemItem::Earth);
+    auto emb = static_cast<std::size_t>(JPLEphemItem::EarthMoonBary);
+    auto moon = static_cast<std::size_t>(JPLEphemItem::Moon);
+    double moonFactor = 1.0 / (earthMoonMassRatio + 1.0);
+    states.positions[earth] = states.positions[emb] - states.positions[moon] * moonFactor;
+    states.velocities[earth] = states.velocities[emb] - states.velocities[moon] * moonFactor;
+
+    auto ssb = static_cast<std::size_t>(JPLEphemItem::SSB);
+    states.positions[ssb] = Eigen::Vector3d::Zero();
+    states.velocities[ssb] = Eigen::Vector3d::Zero();
 }
 
 
-JPLEphemeris* JPLEphemeris::load(std::istream& in)
+// Return the states of all items at tjd, like getPlanetPosition(). The
+// states of the last time asked for are kept, as the orbits of all
+// bodies with JPL ephemerides are evaluated at the same times.
+JPLEphStates JPLEphemeris::getStates(double tjd) const
 {
-    std::array<char, sizeof(JPLEFileHeader)> fh;
-    in.read(fh.data(), fh.size()); /* Flawfinder: ignore */
-    if (!in.good())
-        return nullptr;
+    std::lock_guard<std::mutex> lock(statesMutex);
+    if (!lastStatesValid || lastStates.t != tjd)
+    {
+        computeStates(tjd, lastStates);
+        lastStatesValid = true;
+    }
+
+    return lastStates;
+}
+
 
+// Create an ephemeris without records from the file header. The record
+// size of INPOP files is read by the caller.
+JPLEphemeris* JPLEphemeris::parseHeader(const char* header)
+{
     decltype(JPLEFileHeader::deNum) deNum;
-    std::memcpy(&deNum, fh.data() + offsetof(JPLEFileHeader, deNum), sizeof(deNum));
+    std::memcpy(&deNum, header + offsetof(JPLEFileHeader, deNum), sizeof(deNum));
     std::uint32_t deNum2 = compat::byteswap(deNum);
 
     bool swapBytes;
@@ -288,18 +414,18 @@ JPLEphemeris* JPLEphemeris::load(std::istream& in)
     eph->DENum = deNum;
 
     // Read the start time, end time, and time interval
-    getMaybeSwapDouble(eph->startDate,          fh.data() + offsetof(JPLEFileHeader, startDate),          swapBytes);
-    getMaybeSwapDouble(eph->endDate,            fh.data() + offsetof(JPLEFileHeader, endDate),            swapBytes);
-    getMaybeSwapDouble(eph->daysPerInterval,    fh.data() + offsetof(JPLEFileHeader, daysPerInterval),    swapBytes);
+    getMaybeSwapDouble(eph->startDate,          header + offsetof(JPLEFileHeader, startDate),          swapBytes);
+    getMaybeSwapDouble(eph->endDate,            header + offsetof(JPLEFileHeader, endDate),            swapBytes);
+    getMaybeSwapDouble(eph->daysPerInterval,    header + offsetof(JPLEFileHeader, daysPerInterval),    swapBytes);
     // kilometers per astronomical unit
-    getMaybeSwapDouble(eph->au,                 fh.data() + offsetof(JPLEFileHeader, au),                 swapBytes);
-    getMaybeSwapDouble(eph->earthMoonMassRatio, fh.data() + offsetof(JPLEFileHeader, earthMoonMassRatio), swapBytes);
+    getMaybeSwapDouble(eph->au,                 header + offsetof(JPLEFileHeader, au),                 swapBytes);
+    getMaybeSwapDouble(eph->earthMoonMassRatio, header + offsetof(JPLEFileHeader, earthMoonMassRatio), swapBytes);
 
     // Read the coefficient information for each item in the ephemeris
     eph->recordSize = 0;
     for (unsigned int i = 0; i < JPLEph_NItems; i++)
     {
-        const char* coeffInfo = fh.data() + offsetof(JPLEFileHeader, coeffInfo) + i * sizeof(JPLECoeff);
+        const char* coeffInfo = header + offsetof(JPLEFileHeader, coeffInfo) + i * sizeof(JPLECoeff);
         getMaybeSwapUint32(eph->coeffInfo[i].offset,    coeffInfo + offsetof(JPLECoeff, offset),    swapBytes);
         getMaybeSwapUint32(eph->coeffInfo[i].nCoeffs,   coeffInfo + offsetof(JPLECoeff, nCoeffs),   swapBytes);
         getMaybeSwapUint32(eph->coeffInfo[i].nGranules, coeffInfo + offsetof(JPLECoeff, nGranules), swapBytes);
@@ -309,15 +435,30 @@ JPLEphemeris* JPLEphemeris::load(std::istream& in)
         eph->recordSize += eph->coeffInfo[i].nCoeffs * eph->coeffInfo[i].nGranules * nRecords;
     }
 
-    const char* librationCoeffInfo = fh.data() + offsetof(JPLEFileHeader, librationCoeffInfo);
+    const char* librationCoeffInfo = header + offsetof(JPLEFileHeader, librationCoeffInfo);
     getMaybeSwapUint32(eph->librationCoeffInfo.offset,    librationCoeffInfo + offsetof(JPLECoeff, offset),    swapBytes);
     getMaybeSwapUint32(eph->librationCoeffInfo.nCoeffs,   librationCoeffInfo + offsetof(JPLECoeff, nCoeffs),   swapBytes);
     getMaybeSwapUint32(eph->librationCoeffInfo.nGranules, librationCoeffInfo + offsetof(JPLECoeff, nGranules), swapBytes);
     eph->recordSize += eph->librationCoeffInfo.nCoeffs * eph->librationCoeffInfo.nGranules * 3;
     eph->recordSize += 2;   // record start and end time
 
+    return eph;
+}
+
+
+JPLEphemeris* JPLEphemeris::load(std::istream& in)
+{
+    std::array<char, sizeof(JPLEFileHeader)> fh;
+    in.read(fh.data(), fh.size()); /* Flawfinder: ignore */
+    if (!in.good())
+        return nullptr;
+
+    JPLEphemeris* eph = parseHeader(fh.data());
+    if (eph == nullptr)
+        return nullptr;
+
     // if INPOP ephemeris, read record size
-    if (deNum == INPOP_DE_COMPATIBLE)
+    if (eph->DENum == INPOP_DE_COMPATIBLE)
     {
        eph->recordSize = readUint(in, eph->swapBytes);
        // Skip past the rest of the record
@@ -362,4 +503,40 @@ JPLEphemeris* JPLEphemeris::load(std::istream& in)
     return eph;
 }
 
+
+JPLEphemeris* JPLEphemeris::load(const fs::path& path)
+{
+    auto mappedFile = util::MappedFile::open(path);
+    if (mappedFile == nullptr)
+    {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        return in.good() ? load(in) : nullptr;
+    }
+
+    if (mappedFile->size() < sizeof(JPLEFileHeader) + sizeof(std::uint32_t))
+        return nullptr;
+
+    std::unique_ptr<JPLEphemeris> eph(parseHeader(mappedFile->data()));
+    if (eph == nullptr)
+        return nullptr;
+
+    if (eph->DENum == INPOP_DE_COMPATIBLE)
+        getMaybeSwapUint32(eph->recordSize, mappedFile->data() + sizeof(JPLEFileHeader), eph->swapBytes);
+
+    // The records follow the header record and the record of constants
+    auto nRecords = (unsigned int) ((eph->endDate - eph->startDate) /
+                        eph->daysPerInterval);
+    std::size_t recordBytes = static_cast<std::size_t>(eph->recordSize) * sizeof(double);
+    if (eph->recordSize <= 2 || nRecords == 0 ||
+        mappedFile->size() / recordBytes < static_cast<std::size_t>(nRecords) + 2)
+    {
+        return nullptr;
+    }
+
+    eph->mappedRecords = mappedFile->data() + 2 * recordBytes;
+    eph->nMappedRecords = nRecords;
+    eph->mappedFile = std::move(mappedFile);
+    return eph.release();
+}
+
 } // end namespace celestia::ephem
@@ -16,10 +16,19 @@
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include <Eigen/Core>
 
+#include <celcompat/filesystem.h>
+
+namespace celestia::util
+{
+class MappedFile;
+}
+
 namespace celestia::ephem
 {
 
@@ -60,6 +69,18 @@ struct JPLEphRecord
 };
 
 
+// Positions and velocities of all items at time t, in the frames of
+// getPlanetPosition(). Velocities are in km/day.
+struct JPLEphStates
+{
+    static constexpr std::size_t NItems = 13;
+
+    double t{ 0.0 };
+    std::array<Eigen::Vector3d, NItems> positions;
+    std::array<Eigen::Vector3d, NItems> velocities;
+};
+
+
 class JPLEphemeris
 {
 private:
@@ -68,11 +89,15 @@ private:
 public:
     static constexpr std::size_t JPLEph_NItems = 12;
 
-    ~JPLEphemeris() = default;
+    ~JPLEphemeris();
 
     Eigen::Vector3d getPlanetPosition(JPLEphemItem, double t) const;
+    JPLEphStates getStates(double t) const;
 
     static JPLEphemeris* load(std::istream&);
+    // Map the file into memory if possible, so that only the records which
+    // are used get paged in, otherwise read all of it
+    static JPLEphemeris* load(const fs::path&);
 
     unsigned int getDENumber() const;
     double getStartDate() const;
@@ -81,6 +106,18 @@ public:
     unsigned int getRecordSize() const;
 
 private:
+    // Items up to the Sun have Chebyshev coefficients of their own
+    static constexpr std::size_t JPLEph_NBodies = 11;
+
+    static JPLEphemeris* parseHeader(const char* header);
+
+    const double* findCoefficients(std::size_t item,
+                                   double tjd,
+                                   double* buffer,
+                                   double& u,
+                                   double& granuleDays) const;
+    void computeStates(double t, JPLEphStates& states) const;
+
     std::array<JPLEphCoeffInfo, JPLEph_NItems> coeffInfo;
     JPLEphCoeffInfo librationCoeffInfo;
 
@@ -95,7 +132,18 @@ private:
     unsigned int recordSize;  // number of doubles per record
     bool swapBytes;
 
+    // Records read from a stream
     std::vector<JPLEphRecord> records;
+
+    // Records of a mapped file, which are byte swapped when used
+    std::unique_ptr<util::MappedFile> mappedFile;
+    const char* mappedRecords{ nullptr };
+    unsigned int nMappedRecords{ 0 };
+
+    // The states of the last time asked for
+    mutable std::mutex statesMutex;
+    mutable JPLEphStates lastStates;
+    mutable bool lastStatesValid{ false };
 };
 
 } // end namespace celestia::ephem
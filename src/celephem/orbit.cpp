@@ -14,6 +14,7 @@
 #include <cassert>
 #include <cmath>
 #include <functional>
+#include <mutex>
 #include <utility>
 
 #include <celcompat/numbers.h>
@@ -158,13 +159,16 @@ void Orbit::sample(double startTime, double endTime, OrbitSampleProc& proc) cons
         double startValidInterval = 0.0;
         double endValidInterval = 0.0;
         getValidRange(startValidInterval, endValidInterval);
-        if (startValidInterval == endValidInterval)
+        if (startValidInterval != endValidInterval)
         {
             span = endValidInterval - startValidInterval;
         }
         else
         {
-            span = endTime - startTime;
+            // Use the nominal duration of trajectories valid at all times
+            // rather than that of the interval, so that samples taken to
+            // extend a window are as dense as the window
+            span = getPeriod() > 0.0 ? getPeriod() : endTime - startTime;
         }
     }
 
@@ -498,41 +502,53 @@ void HyperbolicOrbit::getValidRange(double& begin, double& end) const
 
 
 
+// The cache is only locked while it is read or updated. The position and
+// velocity are computed without the lock, so that computeVelocity() can
+// use positionAtTime(), and so that threads evaluating the same orbit at
+// once don't wait on each other.
 Eigen::Vector3d CachingOrbit::positionAtTime(double jd) const
 {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (jd == lastTime && positionCacheValid)
+            return lastPosition;
+    }
+
+    Eigen::Vector3d position = computePosition(jd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
     if (jd != lastTime)
     {
         lastTime = jd;
-        lastPosition = computePosition(jd);
-        positionCacheValid = true;
         velocityCacheValid = false;
     }
-    else if (!positionCacheValid)
-    {
-        lastPosition = computePosition(jd);
-        positionCacheValid = true;
-    }
 
-    return lastPosition;
+    lastPosition = position;
+    positionCacheValid = true;
+    return position;
 }
 
 
 Eigen::Vector3d CachingOrbit::velocityAtTime(double jd) const
 {
-    if (jd != lastTime)
     {
-        lastVelocity = computeVelocity(jd);
-        lastTime = jd;  // must be set *after* call to computeVelocity
-        positionCacheValid = false;
-        velocityCacheValid = true;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (jd == lastTime && velocityCacheValid)
+            return lastVelocity;
     }
-    else if (!velocityCacheValid)
+
+    Eigen::Vector3d velocity = computeVelocity(jd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (jd != lastTime)
     {
-        lastVelocity = computeVelocity(jd);
-        velocityCacheValid = true;
+        lastTime = jd;
+        positionCacheValid = false;
     }
 
-    return lastVelocity;
+    lastVelocity = velocity;
+    velocityCacheValid = true;
+    return velocity;
 }
 
 
@@ -555,6 +571,65 @@ Eigen::Vector3d CachingOrbit::computeVelocity(double jd) const
 }
 
 
+namespace
+{
+
+// Fitted orbits use windows of a sixteenth of the period, adapted between
+// a quarter and twice that, and no longer than this many days
+constexpr double MaxFittedSpan = 10.0;
+
+// Error of the fit of fitted orbits in kilometers
+constexpr double FitTolerance = 0.001;
+
+} // end unnamed namespace
+
+
+FittedOrbit::FittedOrbit(const std::shared_ptr<const CachingOrbit>& _orbit) :
+    orbit(_orbit),
+    window(std::min(_orbit->getPeriod() / 16.0, MaxFittedSpan),
+           std::min(_orbit->getPeriod() / 64.0, MaxFittedSpan),
+           std::min(_orbit->getPeriod() / 8.0, MaxFittedSpan),
+           FitTolerance)
+{
+}
+
+
+Eigen::Vector3d FittedOrbit::computePosition(double jd) const
+{
+    return window.evaluate(jd, [this](double t) { return orbit->computePosition(t); });
+}
+
+
+double FittedOrbit::getPeriod() const
+{
+    return orbit->getPeriod();
+}
+
+
+double FittedOrbit::getBoundingRadius() const
+{
+    return orbit->getBoundingRadius();
+}
+
+
+void FittedOrbit::sample(double startTime, double endTime, OrbitSampleProc& proc) const
+{
+    orbit->sample(startTime, endTime, proc);
+}
+
+
+bool FittedOrbit::isPeriodic() const
+{
+    return orbit->isPeriodic();
+}
+
+
+void FittedOrbit::getValidRange(double& begin, double& end) const
+{
+    orbit->getValidRange(begin, end);
+}
+
+
 MixedOrbit::MixedOrbit(const std::shared_ptr<const Orbit>& orbit, double t0, double t1, double mass) :
     primary(orbit),
     begin(t0),
@@ -709,4 +784,40 @@ void SynchronousOrbit::sample(double /* startTime */, double /* endTime */, Orbi
     // Empty method--we never want to show a synchronous orbit.
 }
 
+
+std::unique_ptr<Orbit>
+CreateOsculatingOrbit(const Orbit& orbit, double t)
+{
+    double period = orbit.getPeriod();
+    if (!orbit.isPeriodic() || !(period > 0.0))
+        return nullptr;
+
+    Eigen::Vector3d p = orbit.positionAtTime(t);
+    Eigen::Vector3d v = orbit.velocityAtTime(t);
+    double r = p.norm();
+    double c = v.squaredNorm() * math::square(period / (2.0 * celestia::numbers::pi));
+    if (!(r > 0.0) || !(c > 0.0))
+        return nullptr;
+
+    // Keeping the period, GM = 4 pi^2 a^3 / P^2 and the vis-viva equation
+    // give 2 a^3 / r - a^2 - v^2 P^2 / (4 pi^2) = 0 for the semi-major axis.
+    // The left side is convex and increasing for a > r / 3, so Newton's
+    // method converges from a start where it is positive.
+    double a = r + std::cbrt(c * r);
+    for (int i = 0; i < 50; i++)
+    {
+        double step = (2.0 * a * a * a / r - a * a - c) / (6.0 * a * a / r - 2.0 * a);
+        a -= step;
+        if (std::abs(step) <= a * 1.0e-12)
+            break;
+    }
+
+    double GM = 4.0 * math::square(celestia::numbers::pi) * a * a * a / math::square(period);
+    astro::KeplerElements elements = astro::StateVectorToElements(p, v, GM);
+    if (!(elements.eccentricity < 1.0))
+        return nullptr;
+
+    return std::make_unique<EllipticalOrbit>(elements, t);
+}
+
 } // end namespace celestia::ephem
@@ -10,10 +10,12 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 
 #include <Eigen/Core>
 
 #include <celastro/astro.h>
+#include "chebyshevwindow.h"
 
 class Body;
 
@@ -46,6 +48,10 @@ public:
 
     virtual bool isPeriodic() const { return true; };
 
+    // Return true if positionAtTime() keeps no state between calls, so that
+    // it may be called from several threads at once.
+    virtual bool isReentrant() const { return false; }
+
     // Return the time range over which the orbit is valid; if the orbit
     // is always valid, begin and end should be equal.
     virtual void getValidRange(double& begin, double& end) const
@@ -78,8 +84,11 @@ public:
     Eigen::Vector3d velocityAtTime(double) const override;
     double getPeriod() const override;
     double getBoundingRadius() const override;
+    bool isReentrant() const override { return true; }
 
 private:
+    friend class EllipticalOrbitBatch;
+
     double eccentricAnomaly(double) const;
     Eigen::Vector3d positionAtE(double) const;
     Eigen::Vector3d velocityAtE(double, double) const;
@@ -108,6 +117,7 @@ public:
     double getBoundingRadius() const override;
     bool isPeriodic() const override;
     void getValidRange(double& begin, double& end) const override;
+    bool isReentrant() const override { return true; }
 
 private:
     double eccentricAnomaly(double) const;
@@ -142,7 +152,9 @@ public:
  * Celestia may need require position of a planet more than once per frame; in
  * order to avoid redundant calculation, the CachingOrbit class saves the
  * result of the last calculation and uses it if the time matches the cached
- * time.
+ * time. The cache may be used from several threads at once; subclasses
+ * whose computePosition() and computeVelocity() keep no unguarded state
+ * can override isReentrant() to return true.
  */
 class CachingOrbit : public Orbit
 {
@@ -157,6 +169,7 @@ class CachingOrbit : public Orbit
     Eigen::Vector3d velocityAtTime(double jd) const override;
 
  private:
+    mutable std::mutex cacheMutex;
     mutable Eigen::Vector3d lastPosition;
     mutable Eigen::Vector3d lastVelocity;
     mutable double lastTime{ -1.0e30 };
@@ -165,6 +178,36 @@ class CachingOrbit : public Orbit
 };
 
 
+/*! A fitted orbit approximates an expensive CachingOrbit, such as one of
+ *  the analytic theories of the custom orbits, with Chebyshev polynomials
+ *  fitted over windows of at most a few days. The windows are only fitted
+ *  when the orbit is evaluated at closely spaced times, as when time runs
+ *  at a moderate rate, and their span adapts so that the error of the fit
+ *  stays below a metre.
+ */
+class FittedOrbit : public CachingOrbit
+{
+ public:
+    explicit FittedOrbit(const std::shared_ptr<const CachingOrbit>& orbit);
+    ~FittedOrbit() override = default;
+
+    Eigen::Vector3d computePosition(double jd) const override;
+    double getPeriod() const override;
+    double getBoundingRadius() const override;
+    void sample(double startTime, double endTime, OrbitSampleProc& proc) const override;
+    bool isPeriodic() const override;
+    void getValidRange(double& begin, double& end) const override;
+    // The fitted orbits are analytic theories without state of their own
+    bool isReentrant() const override { return true; }
+
+    const std::shared_ptr<const CachingOrbit>& getFittedOrbit() const { return orbit; }
+
+ private:
+    std::shared_ptr<const CachingOrbit> orbit;
+    ChebyshevWindow window;
+};
+
+
 /*! A mixed orbit is a composite orbit, typically used when you have a
  *  custom orbit calculation that is only valid over limited span of time.
  *  When a mixed orbit is constructed, it computes elliptical orbits
@@ -182,6 +225,8 @@ class MixedOrbit : public Orbit
     double getPeriod() const override;
     double getBoundingRadius() const override;
     void sample(double startTime, double endTime, OrbitSampleProc& proc) const override;
+    // The approximations outside the valid range are elliptical orbits
+    bool isReentrant() const override { return primary->isReentrant(); }
 
  private:
     std::shared_ptr<const Orbit> primary;
@@ -230,10 +275,17 @@ class FixedOrbit : public Orbit
     double getPeriod() const override;
     bool isPeriodic() const override;
     double getBoundingRadius() const override;
+    bool isReentrant() const override { return true; }
     void sample(double, double, OrbitSampleProc&) const override;
 
  private:
     Eigen::Vector3d position;
 };
 
+/*! Create an elliptical orbit osculating the specified periodic orbit at
+ *  time t, with the same period. Return nullptr if the orbit is not
+ *  periodic or its state at t isn't that of a bound orbit.
+ */
+std::unique_ptr<Orbit> CreateOsculatingOrbit(const Orbit& orbit, double t);
+
 }
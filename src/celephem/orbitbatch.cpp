@@ -0,0 +1,193 @@
+// orbitbatch.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Positions of many elliptical orbits computed together.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "orbitbatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <celcompat/numbers.h>
+#include <celmath/mathlib.h>
+#include "orbit.h"
+
+namespace celestia::ephem
+{
+
+namespace
+{
+
+// Orbits are solved in chunks small enough for the intermediate arrays to
+// stay on the stack and in the L1 cache
+constexpr std::size_t ChunkSize = 64;
+
+} // end unnamed namespace
+
+void
+EllipticalOrbitBatch::clear()
+{
+    m_groups = {};
+}
+
+void
+EllipticalOrbitBatch::add(const EllipticalOrbit& orbit, std::uint32_t index)
+{
+    // Same choice of method as EllipticalOrbit::eccentricAnomaly()
+    Solver solver = orbit.eccentricity < 0.2 ? FixedPoint
+                  : orbit.eccentricity < 0.9 ? Meeus
+                  : LaguerreConway;
+
+    Group& group = m_groups[solver];
+    group.semiMajorAxis.push_back(orbit.semiMajorAxis);
+    group.semiMinorAxis.push_back(orbit.semiMinorAxis);
+    group.eccentricity.push_back(orbit.eccentricity);
+    group.meanAnomalyAtEpoch.push_back(orbit.meanAnomalyAtEpoch);
+    group.meanMotion.push_back(2.0 * celestia::numbers::pi / orbit.period);
+    group.epoch.push_back(orbit.epoch);
+    for (int i = 0; i < 6; i++)
+        group.rotation[i].push_back(orbit.orbitPlaneRotation(i % 3, i / 3));
+    group.index.push_back(index);
+}
+
+std::size_t
+EllipticalOrbitBatch::size() const
+{
+    std::size_t count = 0;
+    for (const Group& group : m_groups)
+        count += group.index.size();
+    return count;
+}
+
+std::size_t
+EllipticalOrbitBatch::getMemoryUsage() const
+{
+    std::size_t doubles = 0;
+    std::size_t size = 0;
+    for (const Group& group : m_groups)
+    {
+        doubles += group.semiMajorAxis.capacity() + group.semiMinorAxis.capacity() +
+                   group.eccentricity.capacity() + group.meanAnomalyAtEpoch.capacity() +
+                   group.meanMotion.capacity() + group.epoch.capacity();
+        for (const auto& column : group.rotation)
+            doubles += column.capacity();
+        size += group.index.capacity() * sizeof(std::uint32_t);
+    }
+
+    return size + doubles * sizeof(double);
+}
+
+void
+EllipticalOrbitBatch::positionsAtTime(double jd, Eigen::Vector3d* positions,
+                                      std::size_t first, std::size_t last) const
+{
+    // Map the batch range onto the ranges of the groups
+    std::size_t groupStart = 0;
+    for (int solver = 0; solver < SolverCount && first < last; solver++)
+    {
+        const Group& group = m_groups[solver];
+        std::size_t groupEnd = groupStart + group.index.size();
+        if (first < groupEnd)
+        {
+            std::size_t begin = first - groupStart;
+            std::size_t end = std::min(last, groupEnd) - groupStart;
+            switch (solver)
+            {
+            case FixedPoint:
+                evaluate<FixedPoint>(group, jd, positions, begin, end);
+                break;
+            case Meeus:
+                evaluate<Meeus>(group, jd, positions, begin, end);
+                break;
+            default:
+                evaluate<LaguerreConway>(group, jd, positions, begin, end);
+                break;
+            }
+            first = groupStart + end;
+        }
+        groupStart = groupEnd;
+    }
+}
+
+// The iterations are those of the solvers used by EllipticalOrbit, with
+// the loops over the orbits of a chunk innermost.
+template<EllipticalOrbitBatch::Solver S>
+void
+EllipticalOrbitBatch::evaluate(const Group& group, double jd, Eigen::Vector3d* positions,
+                               std::size_t first, std::size_t last)
+{
+    double M[ChunkSize];
+    double E[ChunkSize];
+
+    for (std::size_t start = first; start < last; start += ChunkSize)
+    {
+        std::size_t n = std::min(ChunkSize, last - start);
+        const double* ecc = group.eccentricity.data() + start;
+
+        for (std::size_t k = 0; k < n; k++)
+        {
+            double t = jd - group.epoch[start + k];
+            M[k] = group.meanAnomalyAtEpoch[start + k] + t * group.meanMotion[start + k];
+        }
+
+        if constexpr (S == FixedPoint)
+        {
+            std::copy(M, M + n, E);
+            for (int iter = 0; iter < 5; iter++)
+            {
+                for (std::size_t k = 0; k < n; k++)
+                    E[k] = M[k] + ecc[k] * std::sin(E[k]);
+            }
+        }
+        else if constexpr (S == Meeus)
+        {
+            std::copy(M, M + n, E);
+            for (int iter = 0; iter < 6; iter++)
+            {
+                for (std::size_t k = 0; k < n; k++)
+                {
+                    double s = std::sin(E[k]);
+                    double c = std::cos(E[k]);
+                    E[k] = E[k] + (M[k] + ecc[k] * s - E[k]) / (1.0 - ecc[k] * c);
+                }
+            }
+        }
+        else
+        {
+            for (std::size_t k = 0; k < n; k++)
+                E[k] = M[k] + 0.85 * ecc[k] * math::sign(std::sin(M[k]));
+            for (int iter = 0; iter < 8; iter++)
+            {
+                for (std::size_t k = 0; k < n; k++)
+                {
+                    double s = ecc[k] * std::sin(E[k]);
+                    double c = ecc[k] * std::cos(E[k]);
+                    double f = E[k] - s - M[k];
+                    double f1 = 1.0 - c;
+                    double f2 = s;
+                    E[k] += -5.0 * f / (f1 + math::sign(f1) * std::sqrt(std::abs(16.0 * f1 * f1 - 20.0 * f * f2)));
+                }
+            }
+        }
+
+        for (std::size_t k = 0; k < n; k++)
+        {
+            std::size_t i = start + k;
+            double x = group.semiMajorAxis[i] * (std::cos(E[k]) - ecc[k]);
+            double y = group.semiMinorAxis[i] * std::sin(E[k]);
+
+            // Convert to Celestia's internal coordinate system
+            positions[group.index[i]] = Eigen::Vector3d(group.rotation[0][i] * x + group.rotation[3][i] * y,
+                                                        group.rotation[2][i] * x + group.rotation[5][i] * y,
+                                                        -(group.rotation[1][i] * x + group.rotation[4][i] * y));
+        }
+    }
+}
+
+} // end namespace celestia::ephem
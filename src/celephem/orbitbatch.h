@@ -0,0 +1,85 @@
+// orbitbatch.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Positions of many elliptical orbits computed together.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace celestia::ephem
+{
+
+class EllipticalOrbit;
+
+// Evaluates a population of elliptical orbits, such as an asteroid catalog,
+// without a virtual call per orbit. The elements are stored as one array
+// per element, and the orbits are grouped by the method used to solve
+// Kepler's equation, so that each group is solved with a fixed number of
+// iterations in loops the compiler can vectorize. The results are the same
+// as those of EllipticalOrbit::positionAtTime().
+class EllipticalOrbitBatch
+{
+public:
+    void clear();
+    // Add an orbit; its position is written at the given index of the
+    // output array
+    void add(const EllipticalOrbit& orbit, std::uint32_t index);
+
+    std::size_t size() const;
+    bool empty() const { return size() == 0; }
+    std::size_t getMemoryUsage() const;
+
+    // Compute the positions of the orbits with batch positions first to
+    // last - 1. The batch positions follow the solver groups, not the order
+    // in which the orbits were added, so that a batch can be split into
+    // ranges which are evaluated on different threads.
+    void positionsAtTime(double jd, Eigen::Vector3d* positions,
+                         std::size_t first, std::size_t last) const;
+    void positionsAtTime(double jd, Eigen::Vector3d* positions) const
+    {
+        positionsAtTime(jd, positions, 0, size());
+    }
+
+private:
+    enum Solver
+    {
+        FixedPoint     = 0,
+        Meeus          = 1,
+        LaguerreConway = 2,
+        SolverCount    = 3,
+    };
+
+    struct Group
+    {
+        std::vector<double> semiMajorAxis;
+        std::vector<double> semiMinorAxis;
+        std::vector<double> eccentricity;
+        std::vector<double> meanAnomalyAtEpoch;
+        std::vector<double> meanMotion;
+        std::vector<double> epoch;
+        // First two columns of the orbit plane rotation; the orbit lies in
+        // the plane of these two axes
+        std::array<std::vector<double>, 6> rotation;
+        std::vector<std::uint32_t> index;
+    };
+
+    template<Solver S>
+    static void evaluate(const Group& group, double jd, Eigen::Vector3d* positions,
+                         std::size_t first, std::size_t last);
+
+    std::array<Group, SolverCount> m_groups;
+};
+
+} // end namespace celestia::ephem
@@ -12,7 +12,10 @@
 
 #include "precession.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstddef>
 
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
@@ -75,6 +78,46 @@ constexpr std::array PrecessionTerms =
 // DE405 obliquity of the ecliptic
 constexpr double eps0 = 84381.40889;
 
+// The P03 long period precession theory for Earth is valid for a one
+// million year time span centered on J2000.
+constexpr double P03LP_VALID_CENTURIES = 5000.0;
+
+// Tolerance of the shared table in arcseconds
+constexpr double SharedTableTolerance = 0.001;
+
+// Upper bound for the step of the tables in centuries
+constexpr double MaxTableStep = 10.0;
+
+// Upper bound for the fourth derivative of the periodic terms, in
+// arcseconds per century^4, which bounds the error of cubic interpolation;
+// the polynomial terms are cubic and interpolated exactly.
+double
+maxFourthDerivative()
+{
+    double maxDerivative = 0.0;
+    auto addTerm = [](double& sum, double c, double s, double period)
+    {
+        double omega = 2.0 * celestia::numbers::pi / period;
+        sum += std::hypot(c, s) * omega * omega * omega * omega;
+    };
+
+    std::array<double, 4> sums{ };
+    for (const EclipticPrecessionTerm& p : EclipticPrecessionTerms)
+    {
+        addTerm(sums[0], p.Pc, p.Ps, p.period);
+        addTerm(sums[1], p.Qc, p.Qs, p.period);
+    }
+    for (const PrecessionTerm& p : PrecessionTerms)
+    {
+        addTerm(sums[2], p.pc, p.ps, p.period);
+        addTerm(sums[3], p.epsc, p.epss, p.period);
+    }
+
+    for (double sum : sums)
+        maxDerivative = std::max(maxDerivative, sum);
+    return maxDerivative;
+}
+
 } // end unnamed namespace
 
 
@@ -163,6 +206,78 @@ PrecObliquity_P03LP(double T)
 }
 
 
+PrecessionTable_P03LP::PrecessionTable_P03LP(double _begin, double end, double tolerance) :
+    begin(_begin)
+{
+    // The error of cubic interpolation between the middle samples of four
+    // is at most 3/128 h^4 max|f''''|
+    step = std::min(std::pow(tolerance * 128.0 / (3.0 * maxFourthDerivative()), 0.25), MaxTableStep);
+
+    // One more sample on each side of the range for the interpolation
+    begin -= step;
+    auto nSamples = static_cast<std::size_t>(std::ceil((end + step - begin) / step)) + 1;
+    samples.reserve(nSamples);
+    for (std::size_t i = 0; i < nSamples; i++)
+    {
+        double T = begin + static_cast<double>(i) * step;
+        EclipticPole pole = EclipticPrecession_P03LP(T);
+        PrecessionAngles angles = PrecObliquity_P03LP(T);
+        samples.push_back({ pole.PA, pole.QA, angles.pA, angles.epsA });
+    }
+}
+
+
+EclipticPole
+PrecessionTable_P03LP::eclipticPrecession(double T) const
+{
+    Sample s = interpolate(T);
+    return { s[0], s[1] };
+}
+
+
+PrecessionAngles
+PrecessionTable_P03LP::precObliquity(double T) const
+{
+    Sample s = interpolate(T);
+    return { s[2], s[3] };
+}
+
+
+// Lagrange interpolation with the two samples on each side of T
+PrecessionTable_P03LP::Sample
+PrecessionTable_P03LP::interpolate(double T) const
+{
+    double x = (T - begin) / step;
+    double index = std::clamp(std::floor(x), 1.0, static_cast<double>(samples.size() - 3));
+    auto i = static_cast<std::size_t>(index);
+    double u = x - index;
+
+    double w0 = -u * (u - 1.0) * (u - 2.0) / 6.0;
+    double w1 = (u + 1.0) * (u - 1.0) * (u - 2.0) / 2.0;
+    double w2 = -(u + 1.0) * u * (u - 2.0) / 2.0;
+    double w3 = (u + 1.0) * u * (u - 1.0) / 6.0;
+
+    Sample result;
+    for (std::size_t k = 0; k < result.size(); k++)
+    {
+        result[k] = w0 * samples[i - 1][k] + w1 * samples[i][k] +
+                    w2 * samples[i + 1][k] + w3 * samples[i + 2][k];
+    }
+
+    return result;
+}
+
+
+const PrecessionTable_P03LP&
+PrecessionTable_P03LP::shared()
+{
+    static const PrecessionTable_P03LP table(-P03LP_VALID_CENTURIES,
+                                             P03LP_VALID_CENTURIES,
+                                             SharedTableTolerance);
+    return table;
+}
+
+
 /*! Compute equatorial precession angles z, zeta, and theta using the P03
  *  precession model.
  */
@@ -12,6 +12,9 @@
 
 #pragma once
 
+#include <array>
+#include <vector>
+
 namespace celestia::ephem
 {
 
@@ -61,6 +64,37 @@ struct EquatorialPrecessionAngles
 extern EclipticPole EclipticPrecession_P03LP(double T);
 extern PrecessionAngles PrecObliquity_P03LP(double T);
 
+// The P03LP quantities tabulated over a range of centuries and
+// interpolated with cubic polynomials, for frames evaluated at many
+// different times, as when time runs fast. The step of the table is set
+// so that the interpolation error stays below the tolerance, in
+// arcseconds. Outside the range the quantities are extrapolated from the
+// nearest samples.
+class PrecessionTable_P03LP
+{
+ public:
+    PrecessionTable_P03LP(double begin, double end, double tolerance);
+
+    EclipticPole eclipticPrecession(double T) const;
+    PrecessionAngles precObliquity(double T) const;
+
+    double getStep() const { return step; }
+
+    // Table shared by the Earth rotation models, over the valid range of
+    // the theory with a tolerance of a milliarcsecond.
+    static const PrecessionTable_P03LP& shared();
+
+ private:
+    // PA, QA, pA and epsA
+    using Sample = std::array<double, 4>;
+
+    Sample interpolate(double T) const;
+
+    double begin;
+    double step;
+    std::vector<Sample> samples;
+};
+
 extern EclipticPole EclipticPrecession_P03(double T);
 extern EclipticAngles EclipticPrecessionAngles_P03(double T);
 extern PrecessionAngles PrecObliquity_P03(double T);
@@ -14,6 +14,7 @@
 #include "rotation.h"
 
 #include <cmath>
+#include <mutex>
 
 #include <celcompat/numbers.h>
 #include <celmath/geomutil.h>
@@ -69,66 +70,80 @@ CachingRotationModel::CachingRotationModel() :
 }
 
 
+// As in CachingOrbit, the cache is locked only while it is read or
+// updated, and the values are computed without the lock.
 Eigen::Quaterniond
 CachingRotationModel::spin(double tjd) const
 {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (tjd == lastTime && spinCacheValid)
+            return lastSpin;
+    }
+
+    Eigen::Quaterniond q = computeSpin(tjd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
     if (tjd != lastTime)
     {
         lastTime = tjd;
-        lastSpin = computeSpin(tjd);
-        spinCacheValid = true;
         equatorCacheValid = false;
         angularVelocityCacheValid = false;
     }
-    else if (!spinCacheValid)
-    {
-        lastSpin = computeSpin(tjd);
-        spinCacheValid = true;
-    }
 
-    return lastSpin;
+    lastSpin = q;
+    spinCacheValid = true;
+    return q;
 }
 
 
 Eigen::Quaterniond
 CachingRotationModel::equatorOrientationAtTime(double tjd) const
 {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (tjd == lastTime && equatorCacheValid)
+            return lastEquator;
+    }
+
+    Eigen::Quaterniond q = computeEquatorOrientation(tjd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
     if (tjd != lastTime)
     {
         lastTime = tjd;
-        lastEquator = computeEquatorOrientation(tjd);
         spinCacheValid = false;
-        equatorCacheValid = true;
         angularVelocityCacheValid = false;
     }
-    else if (!equatorCacheValid)
-    {
-        lastEquator = computeEquatorOrientation(tjd);
-        equatorCacheValid = true;
-    }
 
-    return lastEquator;
+    lastEquator = q;
+    equatorCacheValid = true;
+    return q;
 }
 
 
 Eigen::Vector3d
 CachingRotationModel::angularVelocityAtTime(double tjd) const
 {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (tjd == lastTime && angularVelocityCacheValid)
+            return lastAngularVelocity;
+    }
+
+    Eigen::Vector3d w = computeAngularVelocity(tjd);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
     if (tjd != lastTime)
     {
-        lastAngularVelocity = computeAngularVelocity(tjd);
         lastTime = tjd;
         spinCacheValid = false;
         equatorCacheValid = false;
-        angularVelocityCacheValid = true;
-    }
-    else if (!angularVelocityCacheValid)
-    {
-        lastAngularVelocity = computeAngularVelocity(tjd);
-        angularVelocityCacheValid = true;
     }
 
-    return lastAngularVelocity;
+    lastAngularVelocity = w;
+    angularVelocityCacheValid = true;
+    return w;
 }
 
 
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -99,6 +100,7 @@ class CachingRotationModel : public RotationModel
     bool isPeriodic() const override = 0;
 
 private:
+    mutable std::mutex cacheMutex;
     mutable Eigen::Quaterniond lastSpin;
     mutable Eigen::Quaterniond lastEquator;
     mutable Eigen::Vector3d lastAngularVelocity;
@@ -116,20 +116,69 @@ bool skipComments(std::istream& in)
 
 } // end namespace celestia::ephem::detail
 
-// Do a binary search to find the samples that define the orientation
-// at the current time. Cache the previous sample used and avoid
-// the search if it covers the requested time.
+SampleTimeIndex::SampleTimeIndex(celestia::util::array_view<double> sampleTimes)
+{
+    if (sampleTimes.size() < 2)
+        return;
+
+    // One interval per sample on average
+    std::size_t nBuckets = sampleTimes.size();
+    startTime = sampleTimes.front();
+    bucketsPerDay = static_cast<double>(nBuckets) / (sampleTimes.back() - startTime);
+
+    buckets.resize(nBuckets + 1);
+    std::uint32_t n = 0;
+    for (std::size_t i = 0; i <= nBuckets; ++i)
+    {
+        double bucketStart = startTime + static_cast<double>(i) / bucketsPerDay;
+        while (n < sampleTimes.size() && sampleTimes[n] < bucketStart)
+            ++n;
+        buckets[i] = n;
+    }
+}
+
+
+std::uint32_t
+SampleTimeIndex::find(double jd, celestia::util::array_view<double> sampleTimes) const
+{
+    if (!buckets.empty())
+    {
+        std::size_t lastBucket = buckets.size() - 2;
+        double bucket = (jd - startTime) * bucketsPerDay;
+        std::size_t i = 0;
+        if (bucket >= static_cast<double>(lastBucket))
+            i = lastBucket;
+        else if (bucket > 0.0)
+            i = static_cast<std::size_t>(bucket);
+
+        auto iter = std::lower_bound(sampleTimes.begin() + buckets[i], sampleTimes.begin() + buckets[i + 1], jd);
+        auto n = static_cast<std::uint32_t>(iter - sampleTimes.begin());
+
+        // The interval can be off by one due to rounding
+        if ((n == 0 || sampleTimes[n - 1] < jd) && (n == sampleTimes.size() || sampleTimes[n] >= jd))
+            return n;
+    }
+
+    auto iter = std::lower_bound(sampleTimes.begin(), sampleTimes.end(), jd);
+    return static_cast<std::uint32_t>(iter - sampleTimes.begin());
+}
+
+
+// Find the samples that define the orientation at the current time. Cache
+// the previous sample used and avoid the lookup if it covers the requested
+// time. The cached sample is only a hint, so threads sharing it don't need
+// any ordering between them.
 std::uint32_t
 GetSampleIndex(double jd,
-               std::uint32_t& lastSample,
-               celestia::util::array_view<double> sampleTimes)
+               std::atomic<std::uint32_t>& lastSample,
+               celestia::util::array_view<double> sampleTimes,
+               const SampleTimeIndex& index)
 {
-    std::uint32_t n = lastSample;
+    std::uint32_t n = lastSample.load(std::memory_order_relaxed);
     if (n < 1 || n >= sampleTimes.size() || jd < sampleTimes[n - 1] || jd > sampleTimes[n])
     {
-        auto iter = std::lower_bound(sampleTimes.begin(), sampleTimes.end(), jd);
-        n = static_cast<std::uint32_t>(iter - sampleTimes.begin());
-        lastSample = n;
+        n = index.find(jd, sampleTimes);
+        lastSample.store(n, std::memory_order_relaxed);
     }
 
     return n;
@@ -15,6 +15,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <fstream>
 #include <istream>
@@ -46,9 +48,34 @@ bool skipComments(std::istream& in);
 }
 
 
+// Index of the samples in uniform intervals of time, so that the samples
+// around a time are found in constant time for trajectories sampled at
+// roughly regular times, however far the time jumps.
+class SampleTimeIndex
+{
+public:
+    SampleTimeIndex() = default;
+    explicit SampleTimeIndex(celestia::util::array_view<double> sampleTimes);
+
+    // Return the index of the first sample at or after jd, like
+    // std::lower_bound() over sampleTimes
+    std::uint32_t find(double jd, celestia::util::array_view<double> sampleTimes) const;
+
+    std::size_t getMemoryUsage() const { return buckets.capacity() * sizeof(std::uint32_t); }
+
+private:
+    double startTime{ 0.0 };
+    double bucketsPerDay{ 0.0 };
+    // Index of the first sample at or after the start of each interval,
+    // and the number of samples at the end
+    std::vector<std::uint32_t> buckets;
+};
+
+
 std::uint32_t GetSampleIndex(double jd,
-                             std::uint32_t& lastSample,
-                             celestia::util::array_view<double> sampleTimes);
+                             std::atomic<std::uint32_t>& lastSample,
+                             celestia::util::array_view<double> sampleTimes,
+                             const SampleTimeIndex& index);
 
 
 template<typename T, typename F>
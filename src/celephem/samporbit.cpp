@@ -14,11 +14,13 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <istream>
+#include <limits>
 #include <string_view>
 #include <type_traits>
 #include <unordered_map>
@@ -34,6 +36,8 @@
 #include <celutil/fsutils.h>
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
+#include <celutil/mappedfile.h>
+#include <celutil/memoryreport.h>
 #include "orbit.h"
 #include "sampfile.h"
 #include "xyzvbinary.h"
@@ -60,12 +64,20 @@ struct Samples
 {
     Samples(std::vector<double>&& _times, std::vector<T>&& _samples) :
         times(std::move(_times)),
-        samples(std::move(_samples))
+        samples(std::move(_samples)),
+        index(times)
     {
     }
 
+    std::size_t getMemoryUsage() const
+    {
+        return sizeof(Samples) + times.capacity() * sizeof(double) + samples.capacity() * sizeof(T) +
+               index.getMemoryUsage();
+    }
+
     std::vector<double> times;
     std::vector<T> samples;
+    SampleTimeIndex index;
 };
 
 struct InterpolationParameters
@@ -118,6 +130,7 @@ public:
 
     bool isPeriodic() const override;
     void getValidRange(double& begin, double& end) const override;
+    bool isReentrant() const override { return true; }
 
     void sample(double startTime, double endTime, OrbitSampleProc& proc) const override;
 
@@ -126,7 +139,7 @@ private:
     util::array_view<double> sampleTimes;
     util::array_view<SampleXYZ<T>> positions;
     double boundingRadius;
-    mutable std::uint32_t lastSample{ 0 };
+    mutable std::atomic<std::uint32_t> lastSample{ 0 };
 
     TrajectoryInterpolation interpolation;
 
@@ -189,7 +202,7 @@ SampledOrbit<T>::computePosition(double jd) const
     if (sampleTimes.size() == 1)
         return positions.front().template cast<double>();
 
-    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes);
+    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes, samples->index);
     if (n == 0)
         return positions.front().template cast<double>();
     if (n == sampleTimes.size())
@@ -237,7 +250,7 @@ SampledOrbit<T>::computeVelocity(double jd) const
     if (sampleTimes.size() < 2)
         return Eigen::Vector3d::Zero();
 
-    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes);
+    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes, samples->index);
     if (n == 0 || n == sampleTimes.size())
         return Eigen::Vector3d::Zero();
 
@@ -363,6 +376,7 @@ public:
 
     bool isPeriodic() const override;
     void getValidRange(double& begin, double& end) const override;
+    bool isReentrant() const override { return true; }
 
     void sample(double startTime, double endTime, OrbitSampleProc& proc) const override;
 
@@ -373,7 +387,7 @@ private:
     util::array_view<double> sampleTimes;
     util::array_view<SampleXYZV<T>> posvels;
     double boundingRadius;
-    mutable std::uint32_t lastSample{ 0 };
+    mutable std::atomic<std::uint32_t> lastSample{ 0 };
 
     TrajectoryInterpolation interpolation;
 };
@@ -432,7 +446,7 @@ SampledOrbitXYZV<T>::computePosition(double jd) const
     if (sampleTimes.size() == 1)
         return posvels.front().position.template cast<double>();
 
-    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes);
+    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes, samples->index);
     if (n == 0)
         return posvels.front().position.template cast<double>();
     if (n == sampleTimes.size())
@@ -468,7 +482,7 @@ SampledOrbitXYZV<T>::computeVelocity(double jd) const
     if (sampleTimes.size() < 2)
         return Eigen::Vector3d::Zero();
 
-    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes);
+    std::uint32_t n = GetSampleIndex(jd, lastSample, sampleTimes, samples->index);
     if (n == 0 || n == sampleTimes.size())
         return Eigen::Vector3d::Zero();
 
@@ -560,26 +574,25 @@ LoadSamplesXYZAscii(const fs::path& filename)
     return std::make_shared<Samples<SampleXYZ<T>>>(std::move(sampleTimes), std::move(samples));
 }
 
+// Check the header of a binary xyzv file, which is followed by the records
+// if size is at least the size of the header
 bool
-ParseXYZVBinaryHeader(std::istream& in, const fs::path& filename)
+ParseXYZVBinaryHeader(const char* header, std::size_t size, const fs::path& filename)
 {
-    std::array<char, sizeof(XYZVBinaryHeader)> header;
-
-    // Sonar detects this as being in a critical section for some reason
-    if (!in.read(header.data(), header.size())) /* Flawfinder: ignore */ //NOSONAR
+    if (size < sizeof(XYZVBinaryHeader))
     {
         GetLogger()->error(_("Error reading header of {}.\n"), filename);
         return false;
     }
 
-    if (std::string_view(header.data() + offsetof(XYZVBinaryHeader, magic), XYZV_MAGIC.size()) != XYZV_MAGIC)
+    if (std::string_view(header + offsetof(XYZVBinaryHeader, magic), XYZV_MAGIC.size()) != XYZV_MAGIC)
     {
         GetLogger()->error(_("Bad binary xyzv file {}.\n"), filename);
         return false;
     }
 
     decltype(XYZVBinaryHeader::byteOrder) byteOrder;
-    std::memcpy(&byteOrder, header.data() + offsetof(XYZVBinaryHeader, byteOrder), sizeof(byteOrder));
+    std::memcpy(&byteOrder, header + offsetof(XYZVBinaryHeader, byteOrder), sizeof(byteOrder));
     if (byteOrder != static_cast<decltype(byteOrder)>(celestia::compat::endian::native))
     {
         GetLogger()->error(_("Unsupported byte order {}, expected {} in {}.\n"),
@@ -588,7 +601,7 @@ ParseXYZVBinaryHeader(std::istream& in, const fs::path& filename)
     }
 
     decltype(XYZVBinaryHeader::digits) digits;
-    std::memcpy(&digits, header.data() + offsetof(XYZVBinaryHeader, digits), sizeof(digits));
+    std::memcpy(&digits, header + offsetof(XYZVBinaryHeader, digits), sizeof(digits));
     if (digits != std::numeric_limits<double>::digits)
     {
         GetLogger()->error(_("Unsupported digits number {}, expected {} in {}.\n"),
@@ -597,7 +610,7 @@ ParseXYZVBinaryHeader(std::istream& in, const fs::path& filename)
     }
 
     decltype(XYZVBinaryHeader::count) count;
-    std::memcpy(&count, header.data() + offsetof(XYZVBinaryHeader, count), sizeof(count));
+    std::memcpy(&count, header + offsetof(XYZVBinaryHeader, count), sizeof(count));
     if (count == 0)
     {
         GetLogger()->error(_("Invalid record count {} in {}.\n"), count, filename);
@@ -607,20 +620,26 @@ ParseXYZVBinaryHeader(std::istream& in, const fs::path& filename)
     return true;
 }
 
-template<typename T>
 bool
-ReadXYZVBinarySample(std::istream& in, double& tdb, SampleXYZV<T>& sample)
+ParseXYZVBinaryHeader(std::istream& in, const fs::path& filename)
 {
-    std::array<char, sizeof(XYZVBinaryData)> data;
-    if (!in.read(data.data(), data.size())) /* Flawfinder: ignore */
-        return false;
+    std::array<char, sizeof(XYZVBinaryHeader)> header;
 
-    std::memcpy(&tdb, data.data() + offsetof(XYZVBinaryData, tdb), sizeof(double));
+    // Sonar detects this as being in a critical section for some reason
+    in.read(header.data(), header.size()); /* Flawfinder: ignore */ //NOSONAR
+    return ParseXYZVBinaryHeader(header.data(), static_cast<std::size_t>(in.gcount()), filename);
+}
+
+template<typename T>
+void
+ConvertXYZVBinarySample(const char* data, double& tdb, SampleXYZV<T>& sample)
+{
+    std::memcpy(&tdb, data + offsetof(XYZVBinaryData, tdb), sizeof(double));
 
     if constexpr (std::is_same_v<T, double>)
     {
-        std::memcpy(sample.position.data(), data.data() + offsetof(XYZVBinaryData, position), sizeof(double) * 3);
-        std::memcpy(sample.velocity.data(), data.data() + offsetof(XYZVBinaryData, velocity), sizeof(double) * 3);
+        std::memcpy(sample.position.data(), data + offsetof(XYZVBinaryData, position), sizeof(double) * 3);
+        std::memcpy(sample.velocity.data(), data + offsetof(XYZVBinaryData, velocity), sizeof(double) * 3);
 
         sample.velocity *= astro::daysToSecs(1.0);
     }
@@ -629,8 +648,8 @@ ReadXYZVBinarySample(std::istream& in, double& tdb, SampleXYZV<T>& sample)
         Eigen::Vector3d position;
         Eigen::Vector3d velocity;
 
-        std::memcpy(position.data(), data.data() + offsetof(XYZVBinaryData, position), sizeof(double) * 3);
-        std::memcpy(velocity.data(), data.data() + offsetof(XYZVBinaryData, velocity), sizeof(double) * 3);
+        std::memcpy(position.data(), data + offsetof(XYZVBinaryData, position), sizeof(double) * 3);
+        std::memcpy(velocity.data(), data + offsetof(XYZVBinaryData, velocity), sizeof(double) * 3);
 
         sample.position = position.template cast<T>();
         sample.velocity = (velocity * astro::daysToSecs(1.0)).template cast<T>();
@@ -638,16 +657,70 @@ ReadXYZVBinarySample(std::istream& in, double& tdb, SampleXYZV<T>& sample)
 
     convertToCelestiaCoordinates(sample.position);
     convertToCelestiaCoordinates(sample.velocity);
+}
 
+template<typename T>
+bool
+ReadXYZVBinarySample(std::istream& in, double& tdb, SampleXYZV<T>& sample)
+{
+    std::array<char, sizeof(XYZVBinaryData)> data;
+    if (!in.read(data.data(), data.size())) /* Flawfinder: ignore */
+        return false;
+
+    ConvertXYZVBinarySample(data.data(), tdb, sample);
     return true;
 }
 
+// Convert the records of a mapped binary xyzv file. This avoids a stream
+// read per record, and the vectors are sized from the file size.
+template<typename T>
+std::shared_ptr<const Samples<SampleXYZV<T>>>
+LoadSamplesXYZVMapped(const util::MappedFile& file, const fs::path& filename)
+{
+    if (!ParseXYZVBinaryHeader(file.data(), file.size(), filename))
+    {
+        GetLogger()->error(_("Could not read XYZV binary file {}.\n"), filename);
+        return nullptr;
+    }
+
+    // An incomplete record at the end is ignored, as when reading a stream
+    std::size_t nRecords = (file.size() - sizeof(XYZVBinaryHeader)) / sizeof(XYZVBinaryData);
+    std::vector<double> sampleTimes;
+    std::vector<SampleXYZV<T>> samples;
+    sampleTimes.reserve(nRecords);
+    samples.reserve(nRecords);
+
+    double lastSampleTime = -std::numeric_limits<double>::infinity();
+    bool hasOutOfOrderSamples = false;
+    const char* record = file.data() + sizeof(XYZVBinaryHeader);
+    for (std::size_t i = 0; i < nRecords; ++i, record += sizeof(XYZVBinaryData))
+    {
+        double tdb;
+        SampleXYZV<T> sample;
+        ConvertXYZVBinarySample(record, tdb, sample);
+        if (!detail::checkSampleOrdering(tdb, lastSampleTime, hasOutOfOrderSamples, filename))
+            continue;
+
+        sampleTimes.push_back(tdb);
+        samples.push_back(sample);
+    }
+
+    if (!detail::logIfNoSamples(!sampleTimes.empty(), filename))
+        return nullptr;
+
+    return std::make_shared<Samples<SampleXYZV<T>>>(std::move(sampleTimes),
+                                                    std::move(samples));
+}
+
 /* Load a binary xyzv sampled trajectory file.
  */
 template <typename T>
 std::shared_ptr<const Samples<SampleXYZV<T>>>
 LoadSamplesXYZVBinary(const fs::path& filename)
 {
+    if (auto mappedFile = util::MappedFile::open(filename); mappedFile != nullptr)
+        return LoadSamplesXYZVMapped<T>(*mappedFile, filename);
+
     std::vector<double> sampleTimes;
     std::vector<SampleXYZV<T>> samples;
 
@@ -761,6 +834,8 @@ public:
     std::shared_ptr<const Samples<SampleXYZV<float>>> findXYZVSingle(const fs::path&);
     std::shared_ptr<const Samples<SampleXYZV<double>>> findXYZVDouble(const fs::path&);
 
+    void reportMemoryUsage(util::MemoryReport&) const;
+
 private:
     SamplesMap<SampleXYZ<float>> samplesXYZSingle;
     SamplesMap<SampleXYZ<double>> samplesXYZDouble;
@@ -810,6 +885,121 @@ SamplesManager::findXYZVDouble(const fs::path& filename)
     }
 }
 
+constexpr std::string_view SamplesSubsystem = "Trajectories";
+
+template<typename T>
+using LiveSamples = std::vector<std::pair<fs::path, std::shared_ptr<const Samples<T>>>>;
+
+template<typename T>
+LiveSamples<T>
+getLiveSamples(const SamplesMap<T>& cache)
+{
+    LiveSamples<T> live;
+    for (const auto& [path, weakSamples] : cache)
+    {
+        if (auto samples = weakSamples.lock(); samples != nullptr)
+            live.emplace_back(path, std::move(samples));
+    }
+
+    // Sorted so that the duplicates are always reported in the same way
+    std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    return live;
+}
+
+template<typename T>
+bool
+sameSample(const SampleXYZ<T>& a, const SampleXYZ<T>& b)
+{
+    return a == b;
+}
+
+template<typename T>
+bool
+sameSample(const SampleXYZV<T>& a, const SampleXYZV<T>& b)
+{
+    return a.position == b.position && a.velocity == b.velocity;
+}
+
+template<typename T>
+bool
+sameSamples(const Samples<T>& a, const Samples<T>& b)
+{
+    return a.times == b.times &&
+           std::equal(a.samples.begin(), a.samples.end(), b.samples.begin(), b.samples.end(),
+                      [](const T& x, const T& y) { return sameSample(x, y); });
+}
+
+template<typename T>
+void
+reportSamples(util::MemoryReport& report, std::string_view item, const LiveSamples<T>& live)
+{
+    std::size_t size = 0;
+    for (const auto& entry : live)
+        size += entry.second->getMemoryUsage();
+    report.add(SamplesSubsystem, item, size, live.size());
+
+    // Files with the same samples, such as copies of a trajectory in two
+    // add-ons, or a text file and its binary version
+    std::vector<bool> duplicated(live.size(), false);
+    for (std::size_t i = 0; i < live.size(); ++i)
+    {
+        if (duplicated[i])
+            continue;
+
+        for (std::size_t j = i + 1; j < live.size(); ++j)
+        {
+            if (duplicated[j] || !sameSamples(*live[i].second, *live[j].second))
+                continue;
+
+            duplicated[j] = true;
+            report.addDuplicate(SamplesSubsystem,
+                                fmt::format("{} has the same samples as {}", live[j].first, live[i].first),
+                                live[j].second->getMemoryUsage());
+        }
+    }
+}
+
+// Files loaded in single and in double precision by different objects
+template<typename S, typename D>
+void
+reportPrecisionDuplicates(util::MemoryReport& report,
+                          const LiveSamples<S>& single,
+                          const SamplesMap<D>& doubleCache)
+{
+    for (const auto& [path, samples] : single)
+    {
+        auto it = doubleCache.find(path);
+        if (it == doubleCache.end() || it->second.expired())
+            continue;
+
+        report.addDuplicate(SamplesSubsystem,
+                            fmt::format("{} is loaded in single and double precision", path),
+                            samples->getMemoryUsage());
+    }
+}
+
+void
+SamplesManager::reportMemoryUsage(util::MemoryReport& report) const
+{
+    auto xyzSingle = getLiveSamples(samplesXYZSingle);
+    auto xyzvSingle = getLiveSamples(samplesXYZVSingle);
+
+    reportSamples(report, "Sampled positions (single precision)", xyzSingle);
+    reportSamples(report, "Sampled positions (double precision)", getLiveSamples(samplesXYZDouble));
+    reportSamples(report, "Sampled positions and velocities (single precision)", xyzvSingle);
+    reportSamples(report, "Sampled positions and velocities (double precision)", getLiveSamples(samplesXYZVDouble));
+
+    reportPrecisionDuplicates(report, xyzSingle, samplesXYZDouble);
+    reportPrecisionDuplicates(report, xyzvSingle, samplesXYZVDouble);
+}
+
+SamplesManager&
+GetSamplesManager()
+{
+    static SamplesManager samplesManager;
+    return samplesManager;
+}
+
 } // end unnamed namespace
 
 /*! Load a trajectory file containing positions without velocities.
@@ -819,7 +1009,7 @@ LoadSampledTrajectory(const fs::path& filename,
                       TrajectoryInterpolation interpolation,
                       TrajectoryPrecision precision)
 {
-    static SamplesManager samplesManager;
+    SamplesManager& samplesManager = GetSamplesManager();
     switch (DetermineFileType(filename))
     {
     case ContentType::CelestiaXYZTrajectory:
@@ -863,4 +1053,10 @@ LoadSampledTrajectory(const fs::path& filename,
     }
 }
 
+void
+ReportSampledTrajectoryMemory(util::MemoryReport& report)
+{
+    GetSamplesManager().reportMemoryUsage(report);
+}
+
 } // end namespace celestia::ephem
@@ -13,6 +13,11 @@
 
 #include <celcompat/filesystem.h>
 
+namespace celestia::util
+{
+class MemoryReport;
+}
+
 namespace celestia::ephem
 {
 
@@ -34,4 +39,8 @@ std::shared_ptr<const Orbit> LoadSampledTrajectory(const fs::path&,
                                                    TrajectoryInterpolation,
                                                    TrajectoryPrecision);
 
+// Add the memory used by the loaded samples to the report, and the files
+// whose samples are loaded twice
+void ReportSampledTrajectoryMemory(util::MemoryReport&);
+
 } // end namespace celestia::ephem
@@ -13,6 +13,7 @@
 
 #include "samporient.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <istream>
@@ -81,7 +82,8 @@ private:
     // the 16-byte alignment of Quaternionf
     std::vector<double> sampleTimes;
     std::vector<Eigen::Quaternionf> rotations;
-    mutable std::uint32_t lastSample{0};
+    SampleTimeIndex timeIndex;
+    mutable std::atomic<std::uint32_t> lastSample{0};
 };
 
 
@@ -93,6 +95,7 @@ SampledOrientation::SampledOrientation(std::vector<double>&& _sampleTimes,
     assert(!sampleTimes.empty() && sampleTimes.size() == rotations.size());
     sampleTimes.shrink_to_fit();
     rotations.shrink_to_fit();
+    timeIndex = SampleTimeIndex(sampleTimes);
 
     // Apply a 90-degree rotation around the x-axis to convert the orientation
     // to Celestia's coordinate system
@@ -139,7 +142,7 @@ SampledOrientation::getOrientation(double tjd) const
     if (sampleTimes.size() == 1)
         return rotations.front();
 
-    std::uint32_t n = GetSampleIndex(tjd, lastSample, sampleTimes);
+    std::uint32_t n = GetSampleIndex(tjd, lastSample, sampleTimes, timeIndex);
     if (n == 0)
         return rotations.front();
     else if (n == sampleTimes.size())
@@ -29,6 +29,15 @@ namespace
 
 constexpr double MILLISEC = astro::secsToDays(0.001);
 
+// Spans of the windows over which positions are fitted, in days. The
+// short ones are for spacecraft in low orbits or during flybys.
+constexpr double InitialFitSpan = 1.0 / 24.0;
+constexpr double MinFitSpan = 1.0 / 1440.0;
+constexpr double MaxFitSpan = 1.0;
+
+// Error of the fit in kilometers
+constexpr double FitTolerance = 0.001;
+
 } // end unnamed namespace
 
 /*! Create a new SPICE orbit using with a valid interval specified
@@ -47,7 +56,8 @@ SpiceOrbit::SpiceOrbit(std::string  _targetBodyName,
     spiceErr(false),
     validIntervalBegin(_beginning),
     validIntervalEnd(_ending),
-    useDefaultTimeInterval(false)
+    useDefaultTimeInterval(false),
+    window(InitialFitSpan, MinFitSpan, MaxFitSpan, FitTolerance)
 {
 }
 
@@ -70,7 +80,8 @@ SpiceOrbit::SpiceOrbit(std::string  _targetBodyName,
     spiceErr(false),
     validIntervalBegin(0.0),
     validIntervalEnd(0.0),
-    useDefaultTimeInterval(true)
+    useDefaultTimeInterval(true),
+    window(InitialFitSpan, MinFitSpan, MaxFitSpan, FitTolerance)
 {
 }
 
@@ -247,39 +258,47 @@ SpiceOrbit::computePosition(double jd) const
         jd = validIntervalEnd;
 
     if (spiceErr)
-    {
         return Eigen::Vector3d::Zero();
-    }
-    else
-    {
-        // Input time for SPICE is seconds after J2000
-        double t = astro::daysToSecs(jd - astro::J2000);
-        double position[3];
-        double lt;          // One way light travel time
 
-        spkgps_c(targetID,
-                 t,
-                 "eclipj2000",
-                 originID,
-                 position,
-                 &lt);
+    // The nodes of a window may be up to a span away from jd, they must
+    // stay in the valid interval
+    if (jd - MaxFitSpan < validIntervalBegin || jd + MaxFitSpan > validIntervalEnd)
+        return spicePosition(jd);
 
-        // This shouldn't happen, since we've already computed the valid
-        // coverage interval.
-        if (failed_c())
-        {
-            // Print the error message
-            char errMsg[1024];
-            getmsg_c("long", sizeof(errMsg), errMsg);
-            GetLogger()->warn("{}\n", errMsg);
+    return window.evaluate(jd, [this](double t) { return spicePosition(t); });
+}
 
-            // Reset the error state
-            reset_c();
-        }
 
-        // Transform into Celestia's coordinate system
-        return Eigen::Vector3d(position[0], position[2], -position[1]);
+Eigen::Vector3d
+SpiceOrbit::spicePosition(double jd) const
+{
+    // Input time for SPICE is seconds after J2000
+    double t = astro::daysToSecs(jd - astro::J2000);
+    double position[3];
+    double lt;          // One way light travel time
+
+    spkgps_c(targetID,
+             t,
+             "eclipj2000",
+             originID,
+             position,
+             &lt);
+
+    // This shouldn't happen, since we've already computed the valid
+    // coverage interval.
+    if (failed_c())
+    {
+        // Print the error message
+        char errMsg[1024];
+        getmsg_c("long", sizeof(errMsg), errMsg);
+        GetLogger()->warn("{}\n", errMsg);
+
+        // Reset the error state
+        reset_c();
     }
+
+    // Transform into Celestia's coordinate system
+    return Eigen::Vector3d(position[0], position[2], -position[1]);
 }
 
 
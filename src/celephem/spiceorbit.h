@@ -16,6 +16,7 @@
 #include <Eigen/Core>
 
 #include <celcompat/filesystem.h>
+#include "chebyshevwindow.h"
 #include "orbit.h"
 
 namespace celestia::ephem
@@ -77,7 +78,12 @@ class SpiceOrbit : public CachingOrbit
 
     bool useDefaultTimeInterval;
 
+    // Positions from SPICE are slow to compute, so they are fitted over
+    // short windows when the orbit is evaluated at close times
+    ChebyshevWindow window;
+
     bool init();
+    Eigen::Vector3d spicePosition(double jd) const;
     bool loadRequiredKernel(const fs::path&, const std::string&);
 };
 
@@ -0,0 +1,394 @@
+// streamingorbit.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Trajectories made of samples received while Celestia runs.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "streamingorbit.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#include <Eigen/Core>
+
+#include <celastro/date.h>
+#include <celcompat/charconv.h>
+#include <celutil/logger.h>
+#include "orbit.h"
+
+using celestia::util::GetLogger;
+
+namespace celestia::ephem
+{
+
+namespace
+{
+
+// Time the reader waits at the end of the source before it checks for new
+// lines again
+constexpr auto PollInterval = std::chrono::milliseconds(100);
+
+// Longest line kept while the source hasn't ended it; a longer one is
+// skipped up to its end
+constexpr std::size_t MaxLineLength = 4096;
+
+// Number of times a lookup starts over when the reader overwrote a sample
+// while it was being read
+constexpr int MaxLookups = 4;
+
+struct Sample
+{
+    double t;
+    Eigen::Vector3d position;
+    Eigen::Vector3d velocity;
+};
+
+/*! Ring buffer of the samples of a streaming trajectory, written by the
+ *  reader thread and read by any number of threads without locking. Each
+ *  slot is guarded by a sequence number which is odd while the slot is
+ *  written, so that a reader can tell whether the sample it read was
+ *  overwritten in the meantime.
+ */
+class SampleRing
+{
+ public:
+    explicit SampleRing(std::size_t _capacity) :
+        slots(std::make_unique<Slot[]>(_capacity)),
+        capacity(_capacity)
+    {
+    }
+
+    std::uint64_t count() const { return written.load(std::memory_order_acquire); }
+
+    // The oldest sample which can still be read
+    std::uint64_t first() const
+    {
+        std::uint64_t n = count();
+        return n >= capacity ? n - capacity + 1 : 0;
+    }
+
+    void push(const Sample& sample)
+    {
+        std::uint64_t index = written.load(std::memory_order_relaxed);
+        Slot& slot = slots[index % capacity];
+        slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::array<double, 7> values{ sample.t,
+                                      sample.position.x(), sample.position.y(), sample.position.z(),
+                                      sample.velocity.x(), sample.velocity.y(), sample.velocity.z() };
+        for (std::size_t i = 0; i < values.size(); ++i)
+            slot.values[i].store(values[i], std::memory_order_relaxed);
+
+        slot.sequence.store(index * 2 + 2, std::memory_order_release);
+        written.store(index + 1, std::memory_order_release);
+    }
+
+    // Returns false if the sample was overwritten or isn't written yet
+    bool read(std::uint64_t index, Sample& sample) const
+    {
+        const Slot& slot = slots[index % capacity];
+        std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != index * 2 + 2)
+            return false;
+
+        std::array<double, 7> values;
+        for (std::size_t i = 0; i < values.size(); ++i)
+            values[i] = slot.values[i].load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            return false;
+
+        sample.t = values[0];
+        sample.position = Eigen::Vector3d(values[1], values[2], values[3]);
+        sample.velocity = Eigen::Vector3d(values[4], values[5], values[6]);
+        return true;
+    }
+
+ private:
+    struct Slot
+    {
+        std::atomic<std::uint64_t> sequence{ 0 };
+        std::array<std::atomic<double>, 7> values;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t capacity;
+    std::atomic<std::uint64_t> written{ 0 };
+};
+
+bool
+isSeparator(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+// Parse a line of the source; values after the seventh are ignored, so
+// that telemetry with more columns can be read
+std::optional<Sample>
+parseSample(std::string_view line)
+{
+    std::array<double, 7> values;
+    const char* ptr = line.data();
+    const char* end = line.data() + line.size();
+    for (double& value : values)
+    {
+        while (ptr != end && isSeparator(*ptr))
+            ++ptr;
+        auto result = compat::from_chars(ptr, end, value);
+        if (result.ec != std::errc{})
+            return std::nullopt;
+        ptr = result.ptr;
+    }
+
+    // Convert from the J2000 ecliptic frame to Celestia's coordinates, and
+    // the velocity to km/day
+    Sample sample;
+    sample.t = values[0];
+    sample.position = Eigen::Vector3d(values[1], values[3], -values[2]);
+    sample.velocity = Eigen::Vector3d(values[4], values[6], -values[5]) * astro::daysToSecs(1.0);
+    return sample;
+}
+
+class StreamingOrbit : public CachingOrbit
+{
+ public:
+    StreamingOrbit(const fs::path& source, double retention, std::size_t maxSamples);
+    ~StreamingOrbit() override;
+
+    Eigen::Vector3d computePosition(double jd) const override;
+    Eigen::Vector3d computeVelocity(double jd) const override;
+    double getPeriod() const override;
+    double getBoundingRadius() const override;
+    bool isPeriodic() const override { return false; }
+
+ private:
+    bool findSamples(double jd, Sample& s0, Sample& s1) const;
+    std::optional<std::uint64_t> findFirstAfter(std::uint64_t begin, std::uint64_t end, double t) const;
+    void run();
+
+    fs::path source;
+    double retention;
+    SampleRing samples;
+    std::atomic<double> boundingRadius{ 0.0 };
+
+    std::atomic<bool> stopRequested{ false };
+    std::thread thread;
+};
+
+StreamingOrbit::StreamingOrbit(const fs::path& _source, double _retention, std::size_t maxSamples) :
+    source(_source),
+    retention(_retention),
+    samples(maxSamples)
+{
+    thread = std::thread(&StreamingOrbit::run, this);
+}
+
+StreamingOrbit::~StreamingOrbit()
+{
+    stopRequested = true;
+    thread.join();
+}
+
+double
+StreamingOrbit::getPeriod() const
+{
+    return retention;
+}
+
+double
+StreamingOrbit::getBoundingRadius() const
+{
+    return boundingRadius.load(std::memory_order_relaxed);
+}
+
+// Find the index of the first sample in [begin, end) later than t, or end
+// if there is none. Returns std::nullopt if a sample was overwritten.
+std::optional<std::uint64_t>
+StreamingOrbit::findFirstAfter(std::uint64_t begin, std::uint64_t end, double t) const
+{
+    Sample sample;
+    while (begin < end)
+    {
+        std::uint64_t middle = begin + (end - begin) / 2;
+        if (!samples.read(middle, sample))
+            return std::nullopt;
+        if (sample.t > t)
+            end = middle;
+        else
+            begin = middle + 1;
+    }
+
+    return begin;
+}
+
+// Find the samples around jd in the retention window; s0 and s1 are the
+// same sample when jd is outside of it. Returns false if there are none.
+bool
+StreamingOrbit::findSamples(double jd, Sample& s0, Sample& s1) const
+{
+    for (int lookup = 0; lookup < MaxLookups; ++lookup)
+    {
+        std::uint64_t first = samples.first();
+        std::uint64_t count = samples.count();
+        if (count == 0)
+            return false;
+
+        if (!samples.read(count - 1, s1))
+            continue;
+        if (jd >= s1.t)
+        {
+            s0 = s1;
+            return true;
+        }
+
+        // First sample of the retention window
+        auto windowStart = findFirstAfter(first, count, s1.t - retention);
+        if (!windowStart.has_value())
+            continue;
+        if (*windowStart == count)
+            windowStart = count - 1;
+        if (!samples.read(*windowStart, s0))
+            continue;
+        if (jd <= s0.t)
+        {
+            s1 = s0;
+            return true;
+        }
+
+        auto next = findFirstAfter(*windowStart, count, jd);
+        if (next.has_value() && samples.read(*next, s1) && samples.read(*next - 1, s0))
+            return true;
+    }
+
+    return false;
+}
+
+Eigen::Vector3d
+StreamingOrbit::computePosition(double jd) const
+{
+    Sample s0;
+    Sample s1;
+    if (!findSamples(jd, s0, s1))
+        return Eigen::Vector3d::Zero();
+    if (s1.t <= s0.t)
+        return s0.position;
+
+    // Cubic Hermite interpolation like SampledOrbitXYZV
+    double h = s1.t - s0.t;
+    double t = (jd - s0.t) / h;
+    Eigen::Vector3d v0 = s0.velocity * h;
+    Eigen::Vector3d v1 = s1.velocity * h;
+    Eigen::Vector3d a = 2.0 * (s0.position - s1.position) + v1 + v0;
+    Eigen::Vector3d b = 3.0 * (s1.position - s0.position) - 2.0 * v0 - v1;
+    return s0.position + t * (v0 + t * (b + t * a));
+}
+
+Eigen::Vector3d
+StreamingOrbit::computeVelocity(double jd) const
+{
+    Sample s0;
+    Sample s1;
+    if (!findSamples(jd, s0, s1) || s1.t <= s0.t)
+        return Eigen::Vector3d::Zero();
+
+    double h = s1.t - s0.t;
+    double t = (jd - s0.t) / h;
+    Eigen::Vector3d v0 = s0.velocity * h;
+    Eigen::Vector3d v1 = s1.velocity * h;
+    Eigen::Vector3d a3 = 3.0 * (2.0 * (s0.position - s1.position) + v1 + v0);
+    Eigen::Vector3d b2 = 2.0 * (3.0 * (s1.position - s0.position) - 2.0 * v0 - v1);
+    return (v0 + t * (b2 + t * a3)) / h;
+}
+
+void
+StreamingOrbit::run()
+{
+    std::ifstream in;
+    std::string line;
+    std::string pending;
+    double lastTime = -std::numeric_limits<double>::infinity();
+    bool reportedOpenError = false;
+    bool skippingLine = false;
+
+    while (!stopRequested)
+    {
+        if (!in.is_open())
+        {
+            in.open(source);
+            if (!in.is_open())
+            {
+                if (!reportedOpenError)
+                    GetLogger()->warn("Waiting for streaming trajectory source {}\n", source);
+                reportedOpenError = true;
+                std::this_thread::sleep_for(PollInterval);
+                continue;
+            }
+        }
+
+        if (!std::getline(in, line) || in.eof())
+        {
+            // Keep the start of a line which isn't complete yet
+            if (!skippingLine)
+                pending += line;
+            if (pending.size() > MaxLineLength)
+            {
+                GetLogger()->warn("Skipping overlong line in streaming trajectory source {}\n", source);
+                pending.clear();
+                skippingLine = true;
+            }
+            in.clear();
+            std::this_thread::sleep_for(PollInterval);
+            continue;
+        }
+
+        if (skippingLine)
+        {
+            // The end of the overlong line
+            skippingLine = false;
+            continue;
+        }
+
+        if (!pending.empty())
+        {
+            line.insert(0, pending);
+            pending.clear();
+        }
+
+        auto sample = parseSample(line);
+        if (!sample.has_value() || sample->t <= lastTime)
+            continue;
+
+        lastTime = sample->t;
+        boundingRadius.store(std::max(boundingRadius.load(std::memory_order_relaxed), sample->position.norm()),
+                             std::memory_order_relaxed);
+        samples.push(*sample);
+    }
+}
+
+} // end unnamed namespace
+
+std::shared_ptr<const Orbit>
+CreateStreamingTrajectory(const fs::path& source, double retention, std::size_t maxSamples)
+{
+    GetLogger()->verbose("Streaming trajectory from {}\n", source);
+    return std::make_shared<StreamingOrbit>(source, retention, std::clamp(maxSamples, std::size_t(2), MaxStreamingSamples));
+}
+
+} // end namespace celestia::ephem
@@ -0,0 +1,43 @@
+// streamingorbit.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Trajectories made of samples received while Celestia runs.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia::ephem
+{
+
+class Orbit;
+
+// Largest number of samples a streaming trajectory keeps
+constexpr std::size_t MaxStreamingSamples = std::size_t(1) << 24;
+
+/*! Create a trajectory which follows a text file as it is appended to, e.g.
+ *  by a telemetry receiver. Each line holds a sample with the same seven
+ *  values as a line of a .xyzv file, the TDB Julian date and the position
+ *  in km and velocity in km/s in the J2000 ecliptic frame, separated by
+ *  blanks or commas; other lines are skipped. The samples must come in
+ *  increasing time order and are interpolated like those of a .xyzv
+ *  trajectory.
+ *
+ *  At most maxSamples samples are kept, up to MaxStreamingSamples, and of those only the ones at most
+ *  retention days older than the newest one are used. Before the first and
+ *  after the last of them the position is held.
+ */
+std::shared_ptr<const Orbit> CreateStreamingTrajectory(const fs::path& source,
+                                                       double retention,
+                                                       std::size_t maxSamples);
+
+} // end namespace celestia::ephem
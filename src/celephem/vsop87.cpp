@@ -14,6 +14,7 @@
 
 #include "vsop87.h"
 
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstddef>
@@ -26,6 +27,7 @@
 #include <celastro/date.h>
 #include <celcompat/numbers.h>
 #include <celmath/mathlib.h>
+#include "chebyshevwindow.h"
 #include "orbit.h"
 
 namespace celestia::ephem
@@ -11014,6 +11016,21 @@ SumSeries(const VSOPSeries& series, double t)
     return x;
 }
 
+// Return the period in Julian millennia of the term with the highest
+// frequency in a set of series
+double
+ShortestPeriod(const VSOPSeries* series, std::size_t nSeries)
+{
+    double maxFrequency = 0.0;
+    for (std::size_t i = 0; i < nSeries; i++)
+    {
+        for (std::size_t j = 0; j < series[i].nTerms; j++)
+            maxFrequency = std::max(maxFrequency, std::abs(series[i].terms[j].C));
+    }
+
+    return maxFrequency > 0.0 ? 2.0 * celestia::numbers::pi / maxFrequency : 1.0;
+}
+
 class VSOP87Orbit : public CachingOrbit
 {
  private:
@@ -11025,6 +11042,45 @@ class VSOP87Orbit : public CachingOrbit
     std::size_t nR;
     double period;
     double boundingRadius;
+    // The window spans a quarter of the shortest period in the series,
+    // so that the error of the fit is far below their precision
+    ChebyshevWindow window;
+
+    // Return the sums of the series for l, b and r at t
+    Eigen::Vector3d
+    sumSeries(double t) const
+    {
+        Eigen::Vector3d lbr(Eigen::Vector3d::Zero());
+
+        std::size_t i;
+        double T;
+
+        // Evaluate series for l
+        T = 1;
+        for (i = 0; i < nL; i++)
+        {
+            lbr.x() += SumSeries(vsL[i], t) * T;
+            T = t * T;
+        }
+
+        // Evaluate series for b
+        T = 1;
+        for (i = 0; i < nB; i++)
+        {
+            lbr.y() += SumSeries(vsB[i], t) * T;
+            T = t * T;
+        }
+
+        // Evaluate series for r
+        T = 1;
+        for (i = 0; i < nR; i++)
+        {
+            lbr.z() += SumSeries(vsR[i], t) * T;
+            T = t * T;
+        }
+
+        return lbr;
+    }
 
  public:
     template<std::size_t NL, std::size_t NB, std::size_t NR>
@@ -11037,7 +11093,10 @@ class VSOP87Orbit : public CachingOrbit
         vsB(_vsB.data()), nB(_vsB.size()),
         vsR(_vsR.data()), nR(_vsR.size()),
         period(_period),
-        boundingRadius(_boundingRadius)
+        boundingRadius(_boundingRadius),
+        window(std::min({ ShortestPeriod(vsL, nL),
+                          ShortestPeriod(vsB, nB),
+                          ShortestPeriod(vsR, nR) }) * 0.25)
     {
     }
 
@@ -11055,6 +11114,12 @@ class VSOP87Orbit : public CachingOrbit
         return boundingRadius;
     }
 
+    bool
+    isReentrant() const override
+    {
+        return true;
+    }
+
     Eigen::Vector3d
     computePosition(double jd) const override
     {
@@ -11062,36 +11127,10 @@ class VSOP87Orbit : public CachingOrbit
         double t = (jd - 2451545.0) / 365250.0;
 
         // Heliocentric coordinates
-        double l = 0.0; // longitude
-        double b = 0.0; // latitude
-        double r = 0.0; // radius
-
-        std::size_t i;
-        double T;
-
-        // Evaluate series for l
-        T = 1;
-        for (i = 0; i < nL; i++)
-        {
-            l += SumSeries(vsL[i], t) * T;
-            T = t * T;
-        }
-
-        // Evaluate series for b
-        T = 1;
-        for (i = 0; i < nB; i++)
-        {
-            b += SumSeries(vsB[i], t) * T;
-            T = t * T;
-        }
-
-        // Evaluate series for r
-        T = 1;
-        for (i = 0; i < nR; i++)
-        {
-            r += SumSeries(vsR[i], t) * T;
-            T = t * T;
-        }
+        Eigen::Vector3d lbr = window.evaluate(t, [this](double tt) { return sumSeries(tt); });
+        double l = lbr.x(); // longitude
+        double b = lbr.y(); // latitude
+        double r = lbr.z(); // radius
 
         r *= astro::KM_PER_AU<double>;
 
@@ -11139,6 +11178,45 @@ class VSOP87OrbitRect : public CachingOrbit
     std::size_t nZ;
     double period;
     double boundingRadius;
+    // The window spans a quarter of the shortest period in the series,
+    // so that the error of the fit is far below their precision
+    ChebyshevWindow window;
+
+    // Return the sums of the series for x, y and z at t
+    Eigen::Vector3d
+    sumSeries(double t) const
+    {
+        Eigen::Vector3d v(Eigen::Vector3d::Zero());
+
+        std::size_t i;
+        double T;
+
+        // Evaluate series for x
+        T = 1;
+        for (i = 0; i < nX; i++)
+        {
+            v.x() += SumSeries(vsX[i], t) * T;
+            T = t * T;
+        }
+
+        // Evaluate series for y
+        T = 1;
+        for (i = 0; i < nY; i++)
+        {
+            v.y() += SumSeries(vsY[i], t) * T;
+            T = t * T;
+        }
+
+        // Evaluate series for z
+        T = 1;
+        for (i = 0; i < nZ; i++)
+        {
+            v.z() += SumSeries(vsZ[i], t) * T;
+            T = t * T;
+        }
+
+        return v;
+    }
 
  public:
     template<std::size_t NX, std::size_t NY, std::size_t NZ>
@@ -11151,7 +11229,10 @@ class VSOP87OrbitRect : public CachingOrbit
         vsY(_vsY.data()), nY(_vsY.size()),
         vsZ(_vsZ.data()), nZ(_vsZ.size()),
         period(_period),
-        boundingRadius(_boundingRadius)
+        boundingRadius(_boundingRadius),
+        window(std::min({ ShortestPeriod(vsX, nX),
+                          ShortestPeriod(vsY, nY),
+                          ShortestPeriod(vsZ, nZ) }) * 0.25)
     {
     }
 
@@ -11175,40 +11256,19 @@ class VSOP87OrbitRect : public CachingOrbit
         return boundingRadius;
     }
 
+    bool
+    isReentrant() const override
+    {
+        return true;
+    }
+
     Eigen::Vector3d
     computePosition(double jd) const override
     {
         // t is Julian millenia since J2000.0
         double t = (jd - 2451545.0) / 365250.0;
 
-        Eigen::Vector3d v(Eigen::Vector3d::Zero());
-
-        std::size_t i;
-        double T;
-
-        // Evaluate series for x
-        T = 1;
-        for (i = 0; i < nX; i++)
-        {
-            v.x() += SumSeries(vsX[i], t) * T;
-            T = t * T;
-        }
-
-        // Evaluate series for y
-        T = 1;
-        for (i = 0; i < nY; i++)
-        {
-            v.y() += SumSeries(vsY[i], t) * T;
-            T = t * T;
-        }
-
-        // Evaluate series for z
-        T = 1;
-        for (i = 0; i < nZ; i++)
-        {
-            v.z() += SumSeries(vsZ[i], t) * T;
-            T = t * T;
-        }
+        Eigen::Vector3d v = window.evaluate(t, [this](double tt) { return sumSeries(tt); });
 
         v *= astro::KM_PER_AU<double>;
 
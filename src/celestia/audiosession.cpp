@@ -3,12 +3,13 @@
 namespace celestia
 {
 
-AudioSession::AudioSession(const fs::path &path, float volume, float pan, bool loop, bool nopause) : m_volume(volume), m_pan(pan), m_loop(loop), m_nopause(nopause)
+AudioSession::AudioSession(const fs::path &path, float volume, float pan, bool loop, bool nopause) : m_path(resolvePath(path)), m_volume(volume), m_pan(pan), m_loop(loop), m_nopause(nopause)
 {
-    if (path.is_relative())
-        m_path = "sounds" / path;
-    else
-        m_path = path;
+}
+
+fs::path AudioSession::resolvePath(const fs::path &path)
+{
+    return path.is_relative() ? "sounds" / path : path;
 }
 
 void AudioSession::setVolume(float volume)
@@ -26,6 +26,9 @@ class AudioSession
     AudioSession &operator=(AudioSession&&) = delete;
 
     virtual ~AudioSession() = default;
+    // Open and decode the file ahead of play(), without holding up the
+    // caller, so that playing starts at once
+    virtual bool preload() = 0;
     virtual bool play(double startTime = -1.0) = 0;
     virtual bool isPlaying() const = 0;
     virtual void stop() = 0;
@@ -37,9 +40,12 @@ class AudioSession
     void setNoPause(bool nopause);
 
     bool nopause() const { return m_nopause; }
+    fs::path path() const { return m_path; }
+
+    // The path of the file a session created with path plays
+    static fs::path resolvePath(const fs::path &path);
 
  protected:
-    fs::path path() const { return m_path; }
     float volume() const { return m_volume; }
     float pan() const { return m_pan; }
     bool loop() const { return m_loop; }
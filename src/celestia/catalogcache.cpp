@@ -0,0 +1,113 @@
+// catalogcache.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Binary caches of the catalogs built from text files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "catalogcache.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <ios>
+#include <system_error>
+#include <thread>
+
+#include <fmt/format.h>
+
+#include <celutil/logger.h>
+
+namespace celestia
+{
+
+namespace
+{
+
+constexpr std::uint64_t FNVOffsetBasis = UINT64_C(0xcbf29ce484222325);
+constexpr std::uint64_t FNVPrime = UINT64_C(0x100000001b3);
+
+// 64-bit FNV-1a, terminated by a zero byte so that the concatenation of
+// several strings can't collide with a different split of the same bytes
+std::uint64_t
+hashString(std::uint64_t hash, std::string_view str)
+{
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNVPrime;
+    }
+    return hash * FNVPrime;
+}
+
+} // end unnamed namespace
+
+std::optional<fs::path>
+GetCatalogCachePath(const fs::path& directory,
+                    std::string_view version,
+                    const std::vector<fs::path>& files,
+                    std::string_view extension)
+{
+    std::uint64_t hash = hashString(FNVOffsetBasis, version);
+    for (const auto& file : files)
+    {
+        std::error_code ec;
+        fs::path absolute = fs::absolute(file, ec);
+        if (ec)
+            return std::nullopt;
+
+        auto size = fs::file_size(absolute, ec);
+        if (ec)
+            return std::nullopt;
+
+        auto mtime = fs::last_write_time(absolute, ec);
+        if (ec)
+            return std::nullopt;
+
+        hash = hashString(hash, absolute.string());
+        hash = hashString(hash, fmt::format("{} {}", size, mtime.time_since_epoch().count()));
+    }
+
+    return directory / fmt::format("{:016x}{}", hash, extension);
+}
+
+void
+StoreCatalogCache(const fs::path& path, const std::string& data)
+{
+    std::error_code ec;
+    if (fs::create_directories(path.parent_path(), ec); ec)
+    {
+        util::GetLogger()->error("Failed to create catalog cache directory {}: {}\n",
+                                 path.parent_path(), ec.message());
+        return;
+    }
+
+    for (auto iter = fs::directory_iterator(path.parent_path(), ec); iter != end(iter); iter.increment(ec))
+    {
+        if (!ec && iter->path().extension() == path.extension() && iter->path() != path)
+            fs::remove(iter->path(), ec);
+    }
+
+    fs::path tmpPath = path;
+    tmpPath += fmt::format("-{:x}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out.good())
+        {
+            util::GetLogger()->error("Failed to write catalog cache file {}\n", tmpPath);
+            out.close();
+            fs::remove(tmpPath, ec);
+            return;
+        }
+    }
+
+    if (fs::rename(tmpPath, path, ec); ec)
+        fs::remove(tmpPath, ec);
+}
+
+} // namespace celestia
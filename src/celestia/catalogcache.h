@@ -0,0 +1,39 @@
+// catalogcache.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Binary caches of the catalogs built from text files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia
+{
+
+// Return the path of the cache with the given extension built from the
+// files, named by a hash of the version and of their paths, sizes and
+// modification times, so that it is not used once a file is added, removed
+// or changed. The version should change whenever the data built from the
+// same files may differ.
+std::optional<fs::path> GetCatalogCachePath(const fs::path& directory,
+                                            std::string_view version,
+                                            const std::vector<fs::path>& files,
+                                            std::string_view extension);
+
+// Write the cache through a temporary file, so that another instance never
+// reads a partial one, and remove the caches with the same extension built
+// from earlier versions of the files.
+void StoreCatalogCache(const fs::path& path, const std::string& data);
+
+} // namespace celestia
@@ -10,8 +10,18 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <fstream>
+#include <iterator>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <celestia/progressnotifier.h>
 #include <celutil/array_view.h>
@@ -19,10 +29,46 @@
 #include <celutil/fsutils.h>
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
+#include <celutil/mappedfile.h>
+#include <celutil/tokenizer.h>
+#include <celutil/tracelog.h>
 
 namespace celestia
 {
 
+namespace detail
+{
+// Databases which can parse catalog files independently of the database
+// provide a ParsedCatalog type with static parse() and merge() methods.
+// Other databases may specialize CatalogParser instead.
+template<typename T, typename = void>
+struct CatalogParser
+{
+    static constexpr bool enabled = false;
+};
+
+template<typename T>
+struct CatalogParser<T, std::void_t<typename T::ParsedCatalog>>
+{
+    static constexpr bool enabled = true;
+    using ParsedCatalog = typename T::ParsedCatalog;
+
+    static ParsedCatalog parse(Tokenizer &tokenizer, const fs::path &path)
+    {
+        return T::parse(tokenizer, path);
+    }
+
+    static bool merge(T &db, ParsedCatalog &&catalog)
+    {
+        return db.merge(std::move(catalog));
+    }
+};
+
+// Limits the number of files held in memory after parsing
+constexpr std::size_t MaxLoaderThreads = 8;
+constexpr std::size_t FilesPerLoaderThread = 4;
+}
+
 template<class OBJDB> class CatalogLoader
 {
     OBJDB                     *m_objDB;
@@ -45,28 +91,20 @@ public:
     {
     }
 
-    bool load(std::istream &in, const fs::path &dir)
+    bool load(Tokenizer &tokenizer, const fs::path &dir)
     {
-        return m_objDB->load(in, dir);
+        return m_objDB->load(tokenizer, dir);
     }
 
     void process(const fs::path &filePath, const fs::path &parentPath)
     {
-        if (DetermineFileType(filePath) != m_contentType)
+        if (!accept(filePath))
             return;
 
-        if (std::find(std::begin(m_skipPaths), std::end(m_skipPaths), filePath)
-            != std::end(m_skipPaths))
-        {
-            util::GetLogger()->info(_("Skipping {} catalog: {}\n"), m_typeDesc, filePath);
-            return;
-        }
-        util::GetLogger()->info(_("Loading {} catalog: {}\n"), m_typeDesc, filePath);
-        if (m_notifier != nullptr)
-            m_notifier->update(filePath.filename().string());
-
-        if (std::ifstream catalogFile(filePath);
-            !catalogFile.good() || !load(catalogFile, parentPath))
+        notify(filePath);
+        bool loaded = false;
+        if (!tokenizeFile(filePath, [&](Tokenizer &tokenizer) { loaded = load(tokenizer, parentPath); }) ||
+            !loaded)
         {
             util::GetLogger()->error(_("Error reading {} catalog file: {}\n"),
                                      m_typeDesc,
@@ -74,30 +112,198 @@ public:
         }
     }
 
+    // Load a list of files in order. Unless parentPath is set, the parent
+    // directory of each file is used as its resource path. If the database
+    // supports it, the files are parsed on several threads and merged into
+    // the database in order.
+    void processFiles(util::array_view<fs::path>      files,
+                      const std::optional<fs::path> &parentPath = std::nullopt)
+    {
+        if constexpr (detail::CatalogParser<OBJDB>::enabled)
+        {
+            std::vector<const fs::path*> accepted;
+            for (const auto &file : files)
+            {
+                if (accept(file))
+                    accepted.push_back(&file);
+            }
+
+            parseFiles(accepted, parentPath);
+        }
+        else
+        {
+            for (const auto &file : files)
+                process(file, parentPath.value_or(file.parent_path()));
+        }
+    }
+
     void loadExtras(util::array_view<fs::path> dirs)
     {
-        std::vector<fs::path> entries;
-        std::error_code       ec;
+        for (const auto &dir : dirs)
+            processFiles(listDirectory(dir));
+    }
+
+    // Return the files which process() and loadExtras() would read, in the
+    // same order
+    std::vector<fs::path> findCatalogFiles(util::array_view<fs::path> files,
+                                           util::array_view<fs::path> dirs) const
+    {
+        std::vector<fs::path> found;
+        std::copy_if(std::begin(files), std::end(files), std::back_inserter(found),
+                     [this](const fs::path &file) { return isCatalogFile(file); });
         for (const auto &dir : dirs)
         {
-            if (!util::IsValidDirectory(dir))
+            for (auto &file : listDirectory(dir))
+            {
+                if (isCatalogFile(file))
+                    found.push_back(std::move(file));
+            }
+        }
+
+        return found;
+    }
+
+private:
+    // Call f with a tokenizer over the file. Catalogs can be hundreds of
+    // megabytes, so the file is mapped into memory and tokenized in place
+    // if possible, and read through a stream otherwise. Returns false if
+    // the file cannot be opened.
+    template<typename F>
+    static bool tokenizeFile(const fs::path &filePath, F &&f)
+    {
+        util::TraceScope trace("Parse catalog file");
+        trace.addArg("file", filePath.string());
+
+        if (auto mappedFile = util::MappedFile::open(filePath); mappedFile != nullptr)
+        {
+            trace.addArg("bytes", mappedFile->size());
+            Tokenizer tokenizer(std::string_view(mappedFile->data(), mappedFile->size()));
+            f(tokenizer);
+            return true;
+        }
+
+        std::ifstream catalogFile(filePath);
+        if (!catalogFile.good())
+            return false;
+
+        if (std::error_code ec; util::IsTracing())
+        {
+            if (auto size = fs::file_size(filePath, ec); !ec)
+                trace.addArg("bytes", size);
+        }
+
+        Tokenizer tokenizer(&catalogFile);
+        f(tokenizer);
+        return true;
+    }
+
+    // The files of the directory and its subdirectories, sorted
+    static std::vector<fs::path> listDirectory(const fs::path &dir)
+    {
+        std::vector<fs::path> entries;
+        if (!util::IsValidDirectory(dir))
+            return entries;
+
+        std::error_code ec;
+        for (auto iter = fs::recursive_directory_iterator(dir, ec); iter != end(iter);
+             iter.increment(ec))
+        {
+            if (ec)
                 continue;
+            if (!fs::is_directory(iter->path(), ec))
+                entries.push_back(iter->path());
+        }
+
+        std::sort(std::begin(entries), std::end(entries));
+        return entries;
+    }
 
-            entries.clear();
+    bool isSkipped(const fs::path &filePath) const
+    {
+        return std::find(std::begin(m_skipPaths), std::end(m_skipPaths), filePath)
+            != std::end(m_skipPaths);
+    }
 
-            for (auto iter = fs::recursive_directory_iterator(dir, ec); iter != end(iter);
-                 iter.increment(ec))
+    bool isCatalogFile(const fs::path &filePath) const
+    {
+        return DetermineFileType(filePath) == m_contentType && !isSkipped(filePath);
+    }
+
+    bool accept(const fs::path &filePath) const
+    {
+        if (DetermineFileType(filePath) != m_contentType)
+            return false;
+
+        if (isSkipped(filePath))
+        {
+            util::GetLogger()->info(_("Skipping {} catalog: {}\n"), m_typeDesc, filePath);
+            return false;
+        }
+
+        return true;
+    }
+
+    void notify(const fs::path &filePath) const
+    {
+        util::GetLogger()->info(_("Loading {} catalog: {}\n"), m_typeDesc, filePath);
+        if (m_notifier != nullptr)
+            m_notifier->update(filePath.filename().string());
+    }
+
+    // Parse the files in batches on a pool of threads. The database is only
+    // modified by merge(), which is called on this thread in file order, so
+    // the result is the same as loading the files one at a time.
+    void parseFiles(const std::vector<const fs::path*>  &files,
+                    const std::optional<fs::path>        &parentPath)
+    {
+        using Parser = detail::CatalogParser<OBJDB>;
+        using ParsedCatalog = typename Parser::ParsedCatalog;
+
+        std::size_t nThreads = std::clamp<std::size_t>(std::thread::hardware_concurrency(),
+                                                       1, detail::MaxLoaderThreads);
+        std::size_t batchSize = nThreads * detail::FilesPerLoaderThread;
+        std::vector<std::optional<ParsedCatalog>> parsed;
+
+        for (std::size_t batchStart = 0; batchStart < files.size(); batchStart += batchSize)
+        {
+            std::size_t batchCount = std::min(batchSize, files.size() - batchStart);
+            parsed.clear();
+            parsed.resize(batchCount);
+
+            std::atomic<std::size_t> nextFile{ 0 };
+            auto worker = [&]()
             {
-                if (ec)
-                    continue;
-                if (!fs::is_directory(iter->path(), ec))
-                    entries.push_back(iter->path());
-            }
+                for (std::size_t i = nextFile++; i < batchCount; i = nextFile++)
+                {
+                    const fs::path &filePath = *files[batchStart + i];
+                    tokenizeFile(filePath, [&](Tokenizer &tokenizer)
+                    {
+                        parsed[i] = Parser::parse(tokenizer, parentPath.value_or(filePath.parent_path()));
+                    });
+                }
+            };
 
-            std::sort(std::begin(entries), std::end(entries));
+            std::vector<std::thread> threads;
+            for (std::size_t i = 1, end = std::min(nThreads, batchCount); i < end; ++i)
+                threads.emplace_back(worker);
+            worker();
+            for (auto &thread : threads)
+                thread.join();
 
-            for (const auto &fn : entries)
-                process(fn, fn.parent_path());
+            for (std::size_t i = 0; i < batchCount; ++i)
+            {
+                const fs::path &filePath = *files[batchStart + i];
+                notify(filePath);
+
+                util::TraceScope trace("Merge catalog file");
+                trace.addArg("file", filePath.string());
+                if (!parsed[i].has_value() || !Parser::merge(*m_objDB, std::move(*parsed[i])))
+                {
+                    util::GetLogger()->error(_("Error reading {} catalog file: {}\n"),
+                                             m_typeDesc,
+                                             filePath);
+                }
+            }
         }
     }
 };
@@ -23,6 +23,7 @@
 #include <cstring>
 #include <cassert>
 #include <ctime>
+#include <chrono>
 #include <cinttypes>
 #include <fstream>
 #include <iomanip>
@@ -30,6 +31,7 @@
 #include <iterator>
 #include <memory>
 #include <set>
+#include <sstream>
 
 #include <Eigen/Geometry>
 #include <fmt/ostream.h>
@@ -50,14 +52,19 @@
 #include <celengine/fisheyeprojectionmode.h>
 #include <celengine/location.h>
 #include <celengine/mapmanager.h>
+#include <celengine/meshmanager.h>
 #include <celengine/multitexture.h>
 #include <celengine/overlay.h>
 #include <celengine/perspectiveprojectionmode.h>
 #include <celengine/planetgrid.h>
 #include <celengine/starname.h>
+#include <celengine/texmanager.h>
 #include <celengine/textlayout.h>
 #include <celengine/rectangle.h>
+#include <celengine/virtualtex.h>
 #include <celengine/visibleregion.h>
+#include <celephem/samporbit.h>
+#include <celestia/catalogcache.h>
 #include <celestia/configfile.h>
 #include <celestia/favorites.h>
 #include <celestia/loaddso.h>
@@ -76,11 +83,22 @@
 #include <celutil/fsutils.h>
 #include <celutil/logger.h>
 #include <celutil/gettext.h>
+#include <celutil/mappedfile.h>
+#include <celutil/memoryreport.h>
+#include <celutil/profiler.h>
+#include <celutil/tracelog.h>
+#include <celutil/uploadbudget.h>
 #include <celutil/utf8.h>
 
 #ifdef USE_MINIAUDIO
 #include "miniaudiosession.h"
 #endif
+#ifdef USE_REMOTE_CONTROL
+#include "remotecontrol.h"
+#endif
+#ifdef USE_CLUSTER
+#include "clustersync.h"
+#endif
 
 #ifdef CELX
 #include <celephem/scriptobject.h>
@@ -106,6 +124,8 @@ constexpr double fMaxKeyAccel = 20.0;
 constexpr float RotationBraking = 10.0f;
 constexpr float RotationDecay = 2.0f;
 constexpr double MaximumTimeRate = 1.0e15;
+// Number of URLs kept parsed by goToUrl()
+constexpr std::size_t MaxParsedUrls = 4096;
 constexpr auto stdFOV = static_cast<float>(45.0_deg);
 static float KeyRotationAccel = 120.0_deg;
 static float MouseRotationSensitivity = 1.0_deg;
@@ -115,6 +135,45 @@ std::locale CelestiaCore::loc = std::locale();
 namespace
 {
 
+// Set while tick() handles the queued input events, which then must not
+// be queued again
+thread_local bool replayingInput = false;
+
+// Changed when the data built from the same files may differ
+constexpr std::string_view AsterismCacheVersion = "astcache1";
+constexpr std::string_view BoundariesCacheVersion = "bndcache1";
+
+// Return the path of the cache built from file if the configuration has a
+// catalog cache directory
+std::optional<fs::path>
+getCachePath(const CelestiaConfig& config, std::string_view version,
+             const fs::path& file, std::string_view extension)
+{
+    if (config.paths.catalogCacheDirectory.empty())
+        return std::nullopt;
+    return GetCatalogCachePath(config.paths.catalogCacheDirectory, version, { file }, extension);
+}
+
+std::unique_ptr<MappedFile>
+openCache(const std::optional<fs::path>& cachePath)
+{
+    if (std::error_code ec; !cachePath.has_value() || !fs::exists(*cachePath, ec))
+        return nullptr;
+    return MappedFile::open(*cachePath);
+}
+
+template<typename T, typename F>
+void
+storeCache(const std::optional<fs::path>& cachePath, const T& data, F&& write)
+{
+    if (!cachePath.has_value())
+        return;
+
+    std::ostringstream out;
+    if (write(out, data))
+        StoreCatalogCache(*cachePath, out.str());
+}
+
 bool ReadLeapSecondsFile(const fs::path& path, std::vector<astro::LeapSecondRecord> &leapSeconds)
 {
     std::ifstream file(path);
@@ -214,15 +273,31 @@ CelestiaCore::CelestiaCore() :
 
 CelestiaCore::~CelestiaCore()
 {
+#ifdef USE_REMOTE_CONTROL
+    // The server thread uses the logger
+    remoteControl = nullptr;
+#endif
+
+    // The loader thread uses the logger and the resource managers
+    if (dsoCatalogLoader.valid())
+        dsoCatalogLoader.wait();
+
     if (movieCapture != nullptr)
         recordEnd();
 
+    // Screenshots still being read need the renderer's context
+    screenshotWriter = nullptr;
+
     delete timer;
     delete renderer;
 
     if (m_logfile.good())
         m_logfile.close();
 
+    // Write the trace if the startup didn't reach initRenderer, or of the
+    // frames recorded so far
+    StopTrace();
+
     DestroyLogger();
 }
 
@@ -414,6 +489,10 @@ static bool checkMask(int modifiers, int mask)
 
 void CelestiaCore::mouseButtonDown(float x, float y, int button)
 {
+    if (queueInput({ InputEvent::Type::MouseButtonDown, x, y, 0.0f, button }))
+        return;
+
+    redrawRequested = true;
     mouseMotion = 0.0f;
 
     Eigen::Vector2f newLocation(x, y);
@@ -444,6 +523,10 @@ void CelestiaCore::mouseButtonDown(float x, float y, int button)
 
 void CelestiaCore::mouseButtonUp(float x, float y, int button)
 {
+    if (queueInput({ InputEvent::Type::MouseButtonUp, x, y, 0.0f, button }))
+        return;
+
+    redrawRequested = true;
     dragLocation = std::nullopt;
     dragStartFromSurface = std::nullopt;
     dragStart = std::nullopt;
@@ -517,6 +600,10 @@ void CelestiaCore::mouseButtonUp(float x, float y, int button)
 
 void CelestiaCore::mouseWheel(float motion, int modifiers)
 {
+    if (queueInput({ InputEvent::Type::MouseWheel, 0.0f, 0.0f, motion, 0, modifiers }))
+        return;
+
+    redrawRequested = true;
     if (is_set(interactionFlags, InteractionFlags::ReverseWheel))
         motion = -motion;
 
@@ -540,9 +627,18 @@ void CelestiaCore::mouseWheel(float motion, int modifiers)
 /// x and y are the pixel coordinates relative to the widget.
 void CelestiaCore::mouseMove(float x, float y)
 {
+    if (queueInput({ InputEvent::Type::MouseHover, x, y }))
+        return;
+
     if (m_scriptHook != nullptr && m_scriptHook->call("mousemove", x, y))
         return;
 
+    // The distorted image of a viewport effect doesn't match the picking
+    // projection
+    hoverPosition = { static_cast<int>(x), metrics.height - 1 - static_cast<int>(y) };
+    if (!isViewportEffectUsed && renderer->requestStarPick(hoverPosition[0], hoverPosition[1]))
+        requestRedraw();
+
     if (viewManager->views().size() < 2 || cursorHandler == nullptr)
         return;
 
@@ -562,6 +658,10 @@ void CelestiaCore::mouseMove(float x, float y)
 
 void CelestiaCore::mouseMove(float dx, float dy, int modifiers)
 {
+    if (queueInput({ InputEvent::Type::MouseMove, dx, dy, 0.0f, 0, modifiers }))
+        return;
+
+    redrawRequested = true;
     auto oldLocation = dragLocation;
     auto proposedLocation = oldLocation;
 
@@ -718,6 +818,9 @@ void CelestiaCore::mouseMove(float dx, float dy, int modifiers)
 
 void CelestiaCore::joystickAxis(int axis, float amount)
 {
+    if (queueInput({ InputEvent::Type::JoystickAxis, 0.0f, 0.0f, amount, axis }))
+        return;
+
     float deadZone = 0.25f;
 
     if (abs(amount) < deadZone)
@@ -736,6 +839,10 @@ void CelestiaCore::joystickAxis(int axis, float amount)
 
 void CelestiaCore::joystickButton(int button, bool down)
 {
+    if (queueInput({ InputEvent::Type::JoystickButton, 0.0f, 0.0f, 0.0f, button, down ? 1 : 0 }))
+        return;
+
+    redrawRequested = true;
     if (button >= 0 && button < JoyButtonCount)
         joyButtonsPressed[button] = down;
 }
@@ -743,6 +850,10 @@ void CelestiaCore::joystickButton(int button, bool down)
 
 void CelestiaCore::pinchUpdate(float focusX, float focusY, float scale, bool zoomFOV)
 {
+    if (queueInput({ InputEvent::Type::PinchUpdate, focusX, focusY, scale, 0, zoomFOV ? 1 : 0 }))
+        return;
+
+    redrawRequested = true;
     viewManager->pickView(sim, metrics, focusX, focusY);
     const View *view = viewManager->activeView();
     bool focusZoomingEnabled = is_set(interactionFlags, InteractionFlags::FocusZooming);
@@ -763,6 +874,10 @@ void CelestiaCore::pinchUpdate(float focusX, float focusY, float scale, bool zoo
 
 void CelestiaCore::keyDown(int key, int modifiers)
 {
+    if (queueInput({ InputEvent::Type::KeyDown, 0.0f, 0.0f, 0.0f, key, modifiers }))
+        return;
+
+    redrawRequested = true;
     if (m_scriptHook != nullptr && m_scriptHook->call("keydown", float(key), float(modifiers)))
         return;
 
@@ -851,8 +966,12 @@ void CelestiaCore::keyDown(int key, int modifiers)
     }
 }
 
-void CelestiaCore::keyUp(int key, int)
+void CelestiaCore::keyUp(int key, int modifiers)
 {
+    if (queueInput({ InputEvent::Type::KeyUp, 0.0f, 0.0f, 0.0f, key, modifiers }))
+        return;
+
+    redrawRequested = true;
     KeyAccel = 1.0;
     if (std::islower(key))
         key = std::toupper(key);
@@ -888,6 +1007,15 @@ void CelestiaCore::charEntered(char c, int modifiers)
 
 void CelestiaCore::charEntered(const char *c_p, int modifiers)
 {
+    if (queuedInput && !replayingInput)
+    {
+        InputEvent event{ InputEvent::Type::CharEntered, 0.0f, 0.0f, 0.0f, 0, modifiers };
+        std::strncpy(event.text.data(), c_p, event.text.size() - 1);
+        queueInput(event);
+        return;
+    }
+
+    redrawRequested = true;
     Observer* observer = sim->getActiveObserver();
 
     char c = *c_p;
@@ -1710,7 +1838,60 @@ void CelestiaCore::start(double t)
     sysTime = timer->getTime();
 
     if (!startURL.empty())
+    {
+        // The URL may select a deep sky object
+        updateDeepSkyCatalog(true);
         goToUrl(startURL);
+    }
+}
+
+/// Swap the deep sky catalogs loaded in the background into the universe
+/// once they are ready, or wait for them.
+void CelestiaCore::updateDeepSkyCatalog(bool wait)
+{
+    if (!dsoCatalogLoader.valid() ||
+        (!wait && dsoCatalogLoader.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+    {
+        return;
+    }
+
+    std::unique_ptr<DSODatabase> dsoCatalog = dsoCatalogLoader.get();
+    if (dsoCatalog == nullptr)
+    {
+        GetLogger()->error(_("Cannot read DSO database.\n"));
+        flash(_("Cannot read DSO database."));
+        return;
+    }
+
+    flash(fmt::format(loc, _("Loaded {} deep sky objects"), dsoCatalog->size()));
+    universe->setDSOCatalog(std::move(dsoCatalog));
+}
+
+/// Read the watched solar system catalogs again if they were modified
+/// since they were last read. They are checked once a second.
+void CelestiaCore::reloadChangedCatalogs()
+{
+    if (watchedCatalogs.empty() || sysTime - lastCatalogCheck < 1.0)
+        return;
+
+    lastCatalogCheck = sysTime;
+    bool reloaded = false;
+    for (auto& [file, modified] : watchedCatalogs)
+    {
+        std::error_code ec;
+        auto lastModified = fs::last_write_time(file, ec);
+        if (ec || lastModified == modified)
+            continue;
+
+        modified = lastModified;
+        reloadSSO(file, universe);
+        flash(fmt::format(loc, _("Reloaded {}"), file.filename().string()));
+        reloaded = true;
+    }
+
+    // Orbit paths are cached by orbit, and the replaced orbits were freed
+    if (reloaded)
+        renderer->invalidateOrbitCache();
 }
 
 void CelestiaCore::setStartURL(const string &url)
@@ -1727,6 +1908,73 @@ void CelestiaCore::setStartURL(const string &url)
     }
 }
 
+void CelestiaCore::setQueuedInput(bool queued)
+{
+    if (queued && inputQueue == nullptr)
+        inputQueue = std::make_unique<SPSCQueue<InputEvent, 1024>>();
+    queuedInput = queued;
+}
+
+bool CelestiaCore::queueInput(const InputEvent& event)
+{
+    if (!queuedInput || replayingInput)
+        return false;
+
+    // The producer can't wait for the render thread, which may itself be
+    // waiting for the UI thread
+    if (!inputQueue->push(event))
+        GetLogger()->warn("Input event queue full, event dropped\n");
+    return true;
+}
+
+void CelestiaCore::handleQueuedInput()
+{
+    replayingInput = true;
+    while (auto event = inputQueue->pop())
+    {
+        switch (event->type)
+        {
+        case InputEvent::Type::CharEntered:
+            charEntered(event->text.data(), event->modifiers);
+            break;
+        case InputEvent::Type::KeyDown:
+            keyDown(event->code, event->modifiers);
+            break;
+        case InputEvent::Type::KeyUp:
+            keyUp(event->code, event->modifiers);
+            break;
+        case InputEvent::Type::MouseWheel:
+            mouseWheel(event->value, event->modifiers);
+            break;
+        case InputEvent::Type::MouseButtonDown:
+            mouseButtonDown(event->x, event->y, event->code);
+            break;
+        case InputEvent::Type::MouseButtonUp:
+            mouseButtonUp(event->x, event->y, event->code);
+            break;
+        case InputEvent::Type::MouseMove:
+            mouseMove(event->x, event->y, event->modifiers);
+            break;
+        case InputEvent::Type::MouseHover:
+            mouseMove(event->x, event->y);
+            break;
+        case InputEvent::Type::JoystickAxis:
+            joystickAxis(event->code, event->value);
+            break;
+        case InputEvent::Type::JoystickButton:
+            joystickButton(event->code, event->modifiers != 0);
+            break;
+        case InputEvent::Type::PinchUpdate:
+            pinchUpdate(event->x, event->y, event->value, event->modifiers != 0);
+            break;
+        case InputEvent::Type::Resize:
+            resize(event->code, event->modifiers);
+            break;
+        }
+    }
+    replayingInput = false;
+}
+
 void CelestiaCore::tick()
 {
     tick(timer->getTime() - sysTime);
@@ -1734,11 +1982,20 @@ void CelestiaCore::tick()
 
 void CelestiaCore::tick(double dt)
 {
+    if (queuedInput)
+        handleQueuedInput();
+
     sysTime += dt;
+    frameStartTime = timer->getTime();
+
+    updateDeepSkyCatalog(false);
+    reloadChangedCatalogs();
 
     // The time step is normally driven by the system clock; however, when
     // recording a movie, we fix the time step the frame rate of the movie.
-    if (movieCapture != nullptr && recording)
+    if (fixedTimeStep > 0.0)
+        dt = fixedTimeStep;
+    else if (movieCapture != nullptr && recording)
         dt = 1.0 / static_cast<double>(movieCapture->getFrameRate());
 
     // Pause script execution
@@ -1918,18 +2175,51 @@ void CelestiaCore::tick(double dt)
     if (m_scriptHook != nullptr)
         m_scriptHook->call("tick", dt);
 
+#ifdef USE_REMOTE_CONTROL
+    if (remoteControl != nullptr)
+        remoteControl->tick(dt);
+#endif
+
     sim->update(dt);
+
+#ifdef USE_CLUSTER
+    // A cluster slave replaces the state of the simulation by the master's
+    if (clusterSync != nullptr)
+        clusterSync->tick();
+#endif
+
+    simulationTime = timer->getTime() - frameStartTime;
 }
 
 
-void CelestiaCore::draw()
+bool CelestiaCore::draw()
 {
     if (!viewUpdateRequired())
-        return;
+        return false;
 
-    // Render each view
+    double drawStartTime = timer->getTime();
+    renderer->getProfiler().beginFrame();
+    renderer->resetRenderStats();
+
+    // Render each view. The views of a split window share the positions of
+    // orbits and catalog bodies, which are the same for all of them.
+    bool splitViews = viewManager->views().size() > 1;
+    if (splitViews)
+        renderer->beginViewGroup();
+    if (gpuFrameTimer != nullptr)
+        gpuFrameTimer->begin();
     for (const auto view : viewManager->views())
         draw(view);
+    std::optional<double> gpuTime;
+    if (gpuFrameTimer != nullptr)
+    {
+        gpuFrameTimer->end();
+        gpuTime = gpuFrameTimer->result();
+        if (gpuTime.has_value() && dynamicResolution != nullptr)
+            dynamicResolution->update(*gpuTime);
+    }
+    if (splitViews)
+        renderer->endViewGroup();
 
     // Reset to render to the main window
     if (viewManager->views().size() > 1)
@@ -1939,7 +2229,10 @@ void CelestiaCore::draw()
     if (toggleAA && (renderer->getRenderFlags() & Renderer::ShowCloudMaps))
         renderer->disableMSAA();
 
-    renderOverlay();
+    {
+        CELESTIA_PROFILE_ZONE("CelestiaCore::renderOverlay");
+        renderOverlay();
+    }
     if (showConsole)
     {
         console->setFont(hud->font());
@@ -1956,6 +2249,39 @@ void CelestiaCore::draw()
     if (movieCapture != nullptr && recording)
         movieCapture->captureFrame();
 
+    if (screenshotWriter != nullptr)
+    {
+        std::array<int, 4> viewport;
+        PixelFormat format;
+        getCaptureInfo(viewport, format);
+        screenshotWriter->capture(viewport, format);
+    }
+
+    if (qualityGovernor != nullptr)
+        updateQuality(timer->getTime() - drawStartTime, gpuTime);
+
+    renderer->getProfiler().endFrame();
+    if (m_traceFramesLeft > 1)
+        --m_traceFramesLeft;
+    else if (m_traceFramesLeft == 1)
+        stopFrameTrace();
+
+    // Leave the rest of the frame time to the garbage collection of the
+    // scripts, which otherwise runs during the script calls
+    if (m_script != nullptr || m_scriptHook != nullptr)
+    {
+        double frameEnd = frameStartTime + static_cast<double>(config->scriptFrameTime) * 0.001;
+        if (m_script != nullptr)
+            m_script->frameFinished(frameEnd - timer->getTime());
+        if (m_scriptHook != nullptr)
+            m_scriptHook->frameFinished(frameEnd - timer->getTime());
+    }
+
+#ifdef USE_CLUSTER
+    if (clusterSync != nullptr)
+        clusterSync->frameFinished();
+#endif
+
     // Frame rate counter
     nFrames++;
     if (nFrames == 100 || sysTime - fpsCounterStartTime > 10.0)
@@ -1964,11 +2290,27 @@ void CelestiaCore::draw()
         nFrames = 0;
         fpsCounterStartTime = sysTime;
     }
+
+    if (config->renderDetails.renderOnDemand)
+    {
+        drawnTime = sim->getTime();
+        drawnSelection = sim->getSelection();
+        drawnViews.clear();
+        for (const auto view : viewManager->views())
+            drawnViews.push_back(drawnView(*view));
+        redrawRequested = false;
+    }
+
+    return true;
 }
 
 
 void CelestiaCore::resize(GLsizei w, GLsizei h)
 {
+    if (queueInput({ InputEvent::Type::Resize, 0.0f, 0.0f, 0.0f, w, h }))
+        return;
+
+    redrawRequested = true;
     if (h == 0)
         h = 1;
 
@@ -1997,7 +2339,8 @@ void CelestiaCore::draw(View* view)
     if (viewportEffect != nullptr)
     {
         // create/update FBO for viewport effect
-        view->updateFBO(metrics.width, metrics.height);
+        view->updateFBO(metrics.width, metrics.height,
+                        dynamicResolution != nullptr ? dynamicResolution->scale() : 1.0f);
         fbo = view->getFBO();
     }
     bool process = fbo != nullptr && viewportEffect->preprocess(renderer, fbo);
@@ -2006,8 +2349,11 @@ void CelestiaCore::draw(View* view)
     auto y = static_cast<int>(view->y * static_cast<float>(metrics.height));
     auto viewWidth = static_cast<int>(view->width * static_cast<float>(metrics.width));
     auto viewHeight = static_cast<int>(view->height * static_cast<float>(metrics.height));
-    // If we need to process, we draw to the FBO which starts at point zero
-    renderer->setRenderRegion(process ? 0 : x, process ? 0 : y, viewWidth, viewHeight, !view->isRootView());
+    // If we need to process, we draw to the FBO which starts at point zero,
+    // and may be smaller than the view with dynamic resolution
+    int sceneWidth = process ? static_cast<int>(fbo->width()) : viewWidth;
+    int sceneHeight = process ? static_cast<int>(fbo->height()) : viewHeight;
+    renderer->setRenderRegion(process ? 0 : x, process ? 0 : y, sceneWidth, sceneHeight, !view->isRootView());
 
     if (view->isRootView())
         sim->render(*renderer);
@@ -2015,7 +2361,7 @@ void CelestiaCore::draw(View* view)
         sim->render(*renderer, *view->observer);
 
     // Viewport need to be reset to start from (x,y) instead of point zero
-    if (process && (x != 0 || y != 0))
+    if (process && (x != 0 || y != 0 || sceneWidth != viewWidth || sceneHeight != viewHeight))
         renderer->setRenderRegion(x, y, viewWidth, viewHeight);
 
     if (process && viewportEffect->prerender(renderer, fbo))
@@ -2030,6 +2376,7 @@ void CelestiaCore::draw(View* view)
 
 void CelestiaCore::setSafeAreaInsets(int left, int top, int right, int bottom)
 {
+    redrawRequested = true;
     metrics.insetLeft = left;
     metrics.insetTop = top;
     metrics.insetRight = right;
@@ -2070,39 +2417,95 @@ void CelestiaCore::setInteractionFlags(InteractionFlags flags)
 // can skip rendering, keep the GPU idle, and save power.
 bool CelestiaCore::viewUpdateRequired() const
 {
-#if 1
-    // Enable after 1.5.0
-    return true;
-#else
-    bool isPaused = sim->getPauseState() || sim->getTimeScale() == 0.0;
+    if (config == nullptr || !config->renderDetails.renderOnDemand || redrawRequested)
+        return true;
 
-    // See if the camera in any of the views is moving
-    bool observersMoving = false;
-    for (const auto v : views)
+    // Things which change on their own from frame to frame
+    if ((movieCapture != nullptr && recording) ||
+        scriptState == ScriptRunning ||
+        renderer->hasPendingStarPick() ||
+        showConsole ||
+        dollyMotion != 0.0 ||
+        zoomMotion != 0.0 ||
+        renderer->hasAnimations() ||
+        hud->messageChanging(timeInfo.currentTime) ||
+        viewManager->isFlashing())
     {
-        if (v->observer->getAngularVelocity().length() > 1.0e-10 ||
-            v->observer->getVelocity().length() > 1.0e-12)
-        {
-            observersMoving = true;
-            break;
-        }
+        return true;
     }
 
-    if (viewChanged ||
-        !isPaused ||
-        observersMoving ||
-        dollyMotion != 0.0 ||
-        zoomMotion != 0.0 ||
-        scriptState == ScriptRunning ||
-        renderer->settingsHaveChanged())
+    // Resources which will replace what was drawn in their place when
+    // they are loaded
+    if (GetTextureManager()->hasPendingLoads() ||
+        GetGeometryManager()->hasPendingLoads() ||
+        VirtualTexture::hasPendingTileLoads() ||
+        renderer->getShaderManager().hasPendingBuilds())
     {
         return true;
     }
-    else
+
+    if (renderer->settingsHaveChanged() ||
+        sim->getTime() != drawnTime ||
+        !(sim->getSelection() == drawnSelection))
     {
-        return false;
+        return true;
     }
-#endif
+
+    const auto& views = viewManager->views();
+    if (views.size() != drawnViews.size())
+        return true;
+
+    auto drawn = drawnViews.begin();
+    for (const auto view : views)
+    {
+        DrawnView current = drawnView(*view);
+        if (current.position.x != drawn->position.x ||
+            current.position.y != drawn->position.y ||
+            current.position.z != drawn->position.z ||
+            current.orientation.coeffs() != drawn->orientation.coeffs() ||
+            current.fov != drawn->fov ||
+            current.x != drawn->x ||
+            current.y != drawn->y ||
+            current.width != drawn->width ||
+            current.height != drawn->height)
+        {
+            return true;
+        }
+        ++drawn;
+    }
+
+    return false;
+}
+
+
+void CelestiaCore::requestRedraw()
+{
+    redrawRequested = true;
+}
+
+
+Selection CelestiaCore::getHoverSelection() const
+{
+    const auto& pick = renderer->getStarPick();
+    if (!pick.has_value() || pick->star == nullptr ||
+        pick->x != hoverPosition[0] || pick->y != hoverPosition[1])
+    {
+        return Selection();
+    }
+
+    return Selection(pick->star);
+}
+
+
+CelestiaCore::DrawnView CelestiaCore::drawnView(const View& view)
+{
+    return { view.observer->getPosition(),
+             view.observer->getOrientation(),
+             view.observer->getFOV(),
+             view.x,
+             view.y,
+             view.width,
+             view.height };
 }
 
 
@@ -2230,7 +2633,8 @@ void CelestiaCore::renderOverlay()
     if (m_scriptHook != nullptr)
         m_scriptHook->call("renderoverlay");
 
-    hud->renderOverlay(metrics, sim, *viewManager, movieCapture, timeInfo, m_script != nullptr, editMode);
+    hud->renderOverlay(metrics, sim, *viewManager, movieCapture, timeInfo, m_script != nullptr, editMode,
+                       renderer->getProfiler(), renderer->getRenderStats());
 }
 
 
@@ -2307,8 +2711,15 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
                                   const vector<fs::path>& extrasDirs,
                                   ProgressNotifier* progressNotifier)
 {
+    if (!m_startupTraceFile.empty())
+        StartTrace(m_startupTraceFile);
+
+    TraceScope traceSimulation("Initialize simulation");
+
     config = std::make_unique<CelestiaConfig>();
     bool hasConfig = false;
+    {
+    TraceScope traceConfig("Read configuration");
     if (!configFileName.empty())
     {
         hasConfig = ReadCelestiaConfig(configFileName, *config);
@@ -2329,6 +2740,7 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
         if (!localConfigFile.empty())
             hasConfig |= ReadCelestiaConfig(localConfigFile, *config);
     }
+    }
 
     if (!hasConfig)
     {
@@ -2340,6 +2752,13 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
     if (config->consoleLogRows > 100)
         console->setRowCount(config->consoleLogRows);
 
+    GetTextureManager()->setMemoryBudget(static_cast<std::size_t>(config->textureMemoryBudget) * 1024 * 1024);
+    GetGeometryManager()->setMemoryBudget(static_cast<std::size_t>(config->modelMemoryBudget) * 1024 * 1024);
+    VirtualTexture::setTileMemoryBudget(static_cast<std::size_t>(config->virtualTextureMemoryBudget) * 1024 * 1024);
+    util::GetUploadBudget()->setLimits(static_cast<std::size_t>(config->frameUploadBudget) * 1024 * 1024,
+                                       std::chrono::duration_cast<util::UploadBudget::Clock::duration>(
+                                           std::chrono::duration<float, std::milli>(config->frameUploadTime)));
+
     if (!config->paths.leapSecondsFile.empty())
         ReadLeapSecondsFile(config->paths.leapSecondsFile, leapSeconds);
 
@@ -2390,27 +2809,71 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
 
     StarDetails::SetStarTextures(config->starTextures);
 
+    {
+    TraceScope traceStars("Load stars");
     std::unique_ptr<StarDatabase> starCatalog = loadStars(*config, progressNotifier);
     if (starCatalog == nullptr)
     {
         fatalError(_("Cannot read star database."), false);
         return false;
     }
+    traceStars.addArg("stars", starCatalog->size());
     universe->setStarCatalog(std::move(starCatalog));
+    universe->setPagedStarCatalog(loadPagedStars(*config));
+    }
 
     /***** Load the deep sky catalogs *****/
 
-    std::unique_ptr<DSODatabase> dsoCatalog = loadDSO(*config, progressNotifier);
-    if (dsoCatalog == nullptr)
+    if (config->backgroundDeepSkyLoading)
     {
-        fatalError(_("Cannot read DSO database."), false);
-        return false;
+        // The worker has its own copy of the paths, which are still
+        // modified on this thread. Progress is shown in the HUD instead of
+        // the notifier, which may only be used from this thread.
+        auto dsoConfig = std::make_unique<CelestiaConfig>();
+        dsoConfig->paths = config->paths;
+        dsoCatalogLoader = std::async(std::launch::async, [dsoConfig = std::move(dsoConfig)]
+        {
+            TraceScope traceDSOs("Load deep sky objects");
+            std::unique_ptr<DSODatabase> dsoCatalog = loadDSO(*dsoConfig, nullptr);
+            if (dsoCatalog != nullptr)
+                traceDSOs.addArg("objects", dsoCatalog->size());
+            return dsoCatalog;
+        });
+        flash(_("Loading deep sky objects..."), 60.0);
+    }
+    else
+    {
+        TraceScope traceDSOs("Load deep sky objects");
+        std::unique_ptr<DSODatabase> dsoCatalog = loadDSO(*config, progressNotifier);
+        if (dsoCatalog == nullptr)
+        {
+            fatalError(_("Cannot read DSO database."), false);
+            return false;
+        }
+        traceDSOs.addArg("objects", dsoCatalog->size());
+        universe->setDSOCatalog(std::move(dsoCatalog));
     }
-    universe->setDSOCatalog(std::move(dsoCatalog));
 
     /***** Load the solar system catalogs *****/
 
+    {
+    TraceScope traceSolarSystems("Load solar systems");
     loadSSO(*config, progressNotifier, universe);
+    }
+
+    if (config->reloadChangedCatalogs)
+    {
+        for (fs::path& file : findExtrasSSOFiles(*config))
+        {
+            std::error_code ec;
+            auto modified = fs::last_write_time(file, ec);
+            if (!ec)
+                watchedCatalogs.emplace_back(std::move(file), modified);
+        }
+    }
+
+    {
+    TraceScope traceConstellations("Load asterisms and boundaries");
 
     // Load asterisms:
     if (!config->paths.asterismsFile.empty())
@@ -2418,17 +2881,30 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
 
     if (!config->paths.boundariesFile.empty())
     {
-        std::ifstream boundariesFile(config->paths.boundariesFile, ios::in);
-        if (!boundariesFile.good())
+        // With a catalog cache directory, the boundaries are kept as the
+        // vertices which are drawn
+        auto cachePath = getCachePath(*config, BoundariesCacheVersion, config->paths.boundariesFile, ".bnddb");
+        std::unique_ptr<ConstellationBoundaries> boundaries;
+        if (auto mappedFile = openCache(cachePath); mappedFile != nullptr)
+            boundaries = ReadBinaryBoundaries(mappedFile->data(), mappedFile->size());
+
+        if (boundaries != nullptr)
+        {
+            universe->setBoundaries(std::move(boundaries));
+        }
+        else if (std::ifstream boundariesFile(config->paths.boundariesFile, ios::in); !boundariesFile.good())
         {
             GetLogger()->error(_("Error opening constellation boundaries file {}.\n"),
                                config->paths.boundariesFile);
         }
         else
         {
-            universe->setBoundaries(ReadBoundaries(boundariesFile));
+            boundaries = ReadBoundaries(boundariesFile);
+            storeCache(cachePath, *boundaries, WriteBinaryBoundaries);
+            universe->setBoundaries(std::move(boundaries));
         }
     }
+    }
 
     // Load destinations list
     if (!config->paths.destinationsFile.empty())
@@ -2487,6 +2963,36 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
         }
     }
 
+    if (config->renderDetails.dynamicResolutionFrameTime > 0.0f)
+    {
+        if (!engine::GPUFrameTimer::isSupported())
+        {
+            GetLogger()->warn("Dynamic resolution needs GPU timer queries\n");
+        }
+        else
+        {
+            // The scaled scene is drawn to the window by the viewport effect
+            if (viewportEffect == nullptr)
+                viewportEffect = std::make_unique<PassthroughViewportEffect>();
+            dynamicResolution = std::make_unique<engine::DynamicResolution>(config->renderDetails.dynamicResolutionFrameTime * 0.001);
+            gpuFrameTimer = std::make_unique<engine::GPUFrameTimer>();
+        }
+    }
+
+    if (config->renderDetails.adaptiveQualityFrameTime > 0.0f)
+    {
+        // Without timer queries only the CPU time is accounted for
+        if (gpuFrameTimer == nullptr && engine::GPUFrameTimer::isSupported())
+            gpuFrameTimer = std::make_unique<engine::GPUFrameTimer>();
+        qualityGovernor = std::make_unique<engine::QualityGovernor>(config->renderDetails.adaptiveQualityFrameTime * 0.001);
+        qualityBase = { renderer->getFaintestAM45deg(),
+                        renderer->getMinimumOrbitSize(),
+                        renderer->getMinimumFeatureSize(),
+                        renderer->getGalaxyDetail(),
+                        renderer->getResolution() };
+        qualityApplied = qualityBase;
+    }
+
     if (!config->measurementSystem.empty())
     {
         if (compareIgnoringCase(config->measurementSystem, "imperial") == 0)
@@ -2562,6 +3068,20 @@ bool CelestiaCore::initSimulation(const fs::path& configFileName,
         cursorHandler->setCursorShape(defaultCursorShape);
     }
 
+#ifdef USE_REMOTE_CONTROL
+    if (config->remoteControlPort != 0 && config->remoteControlPort <= 0xffff)
+        remoteControl = RemoteControl::create(*this,
+                                              static_cast<std::uint16_t>(config->remoteControlPort),
+                                              config->remoteControlToken,
+                                              config->remoteControlFileWrites);
+#endif
+#ifdef USE_CLUSTER
+    clusterSync = ClusterSync::create(*this, config->cluster);
+#endif
+
+    if (config->fixedFrameRate > 0.0f)
+        setFixedTimeStep(1.0 / static_cast<double>(config->fixedFrameRate));
+
     return true;
 }
 
@@ -2592,16 +3112,32 @@ bool CelestiaCore::initRenderer([[maybe_unused]] bool useMesaPackInvert)
     detailOptions.orbitWindowEnd = config->renderDetails.orbitWindowEnd;
     detailOptions.orbitPeriodsShown = config->renderDetails.orbitPeriodsShown;
     detailOptions.linearFadeFraction = config->renderDetails.linearFadeFraction;
+    detailOptions.labelOverlapCulling = config->renderDetails.labelOverlapCulling;
+    detailOptions.distanceFieldFonts = config->renderDetails.distanceFieldFonts;
+    detailOptions.gpuStarPicking = config->renderDetails.gpuStarPicking;
+    detailOptions.starSplatting = config->renderDetails.starSplatting;
+    detailOptions.distantStarCache = config->renderDetails.distantStarCache;
 #ifndef GL_ES
     detailOptions.useMesaPackInvert = useMesaPackInvert;
 #endif
 
     // Prepare the scene for rendering.
+    {
+    TraceScope traceRenderer("Initialize renderer", "render");
     if (!renderer->init(metrics.width, metrics.height, detailOptions))
     {
         fatalError(_("Failed to initialize renderer"), false);
         return false;
     }
+    }
+
+    renderer->getShaderManager().setCacheDirectory(config->paths.shaderCacheDirectory);
+    SetTextureCacheDirectory(config->paths.textureCacheDirectory);
+    if (config->renderDetails.shaderWarmup)
+    {
+        TraceScope traceWarmup("Warm up shaders", "render");
+        renderer->getShaderManager().warmup();
+    }
 
     if ((renderer->getRenderFlags() & Renderer::ShowAutoMag) != 0)
     {
@@ -2609,6 +3145,8 @@ bool CelestiaCore::initRenderer([[maybe_unused]] bool useMesaPackInvert)
         setFaintestAutoMag();
     }
 
+    {
+    TraceScope traceFonts("Load fonts", "render");
     auto mainFont = config->fonts.mainFont.empty()
                 ? LoadFontHelper(renderer, "DejaVuSans.ttf,12")
                 : LoadFontHelper(renderer, config->fonts.mainFont);
@@ -2626,6 +3164,7 @@ bool CelestiaCore::initRenderer([[maybe_unused]] bool useMesaPackInvert)
     {
         hud->titleFont(mainFont);
     }
+    }
 
     // Set up the overlay
     {
@@ -2649,6 +3188,9 @@ bool CelestiaCore::initRenderer([[maybe_unused]] bool useMesaPackInvert)
 
     renderer->setFont(Renderer::FontLarge, hud->titleFont());
     renderer->setRTL(metrics.layoutDirection == LayoutDirection::RightToLeft);
+
+    // The startup trace ends when the first frame is ready to be drawn
+    StopTrace();
     return true;
 }
 
@@ -2764,6 +3306,7 @@ void CelestiaCore::setLightDelayActive(bool lightDelayActive)
 
 void CelestiaCore::setTextEnterMode(Hud::TextEnterMode mode)
 {
+    redrawRequested = true;
     if (mode != hud->textEnterMode())
     {
         hud->textEnterMode(mode);
@@ -2778,6 +3321,7 @@ Hud::TextEnterMode CelestiaCore::getTextEnterMode() const
 
 void CelestiaCore::setScreenDpi(int dpi)
 {
+    redrawRequested = true;
     metrics.screenDpi = dpi;
     renderer->setScreenDpi(dpi);
     setFOVFromZoom();
@@ -2831,6 +3375,7 @@ int CelestiaCore::getHudDetail()
 
 void CelestiaCore::setHudDetail(int newHudDetail)
 {
+    redrawRequested = true;
     hud->detail(newHudDetail);
     notifyWatchers(VerbosityLevelChanged);
 }
@@ -2879,6 +3424,7 @@ void CelestiaCore::recordBegin()
     {
         recording = true;
         movieCapture->recordingStatus(true);
+        updateSynchronousLoading();
     }
 }
 
@@ -2886,6 +3432,7 @@ void CelestiaCore::recordPause()
 {
     recording = false;
     if (movieCapture != nullptr) movieCapture->recordingStatus(false);
+    updateSynchronousLoading();
 }
 
 void CelestiaCore::recordEnd()
@@ -2904,6 +3451,70 @@ bool CelestiaCore::isCaptureActive()
     return movieCapture != nullptr;
 }
 
+void CelestiaCore::setFixedTimeStep(double step)
+{
+    fixedTimeStep = std::max(step, 0.0);
+    updateSynchronousLoading();
+}
+
+double CelestiaCore::getFixedTimeStep() const
+{
+    return fixedTimeStep;
+}
+
+// Frames which are recorded or drawn at a fixed step must not depend on how
+// fast the resources load, so the fallbacks used while they are loading in
+// the background are disabled.
+void CelestiaCore::updateSynchronousLoading()
+{
+    bool synchronous = fixedTimeStep > 0.0 || (movieCapture != nullptr && recording);
+    GetTextureManager()->setSynchronousLoading(synchronous);
+    GetGeometryManager()->setSynchronousLoading(synchronous);
+    VirtualTexture::setSynchronousTileLoading(synchronous);
+    renderer->getShaderManager().setSynchronousBuilds(synchronous);
+}
+
+void CelestiaCore::updateQuality(double drawTime, std::optional<double> gpuTime)
+{
+    // Frames of movies and offline renders don't take longer because of
+    // their frame rate, which is not that of the display
+    if (fixedTimeStep > 0.0 || (movieCapture != nullptr && recording))
+        return;
+
+    // The settings changed since they were applied are the user's choice
+    if (renderer->getFaintestAM45deg() != qualityApplied.faintestAM45deg)
+        qualityBase.faintestAM45deg = renderer->getFaintestAM45deg();
+    if (renderer->getMinimumOrbitSize() != qualityApplied.minimumOrbitSize)
+        qualityBase.minimumOrbitSize = renderer->getMinimumOrbitSize();
+    if (renderer->getMinimumFeatureSize() != qualityApplied.minimumFeatureSize)
+        qualityBase.minimumFeatureSize = renderer->getMinimumFeatureSize();
+    if (renderer->getGalaxyDetail() != qualityApplied.galaxyDetail)
+        qualityBase.galaxyDetail = renderer->getGalaxyDetail();
+    if (renderer->getResolution() != qualityApplied.textureResolution)
+        qualityBase.textureResolution = renderer->getResolution();
+
+    if (qualityGovernor->update(simulationTime, drawTime, gpuTime))
+    {
+        GetLogger()->debug("Quality level {}: simulation {:.1f} ms, drawing {:.1f} ms, GPU {:.1f} ms\n",
+                           qualityGovernor->level(),
+                           qualityGovernor->simulationTime() * 1000.0,
+                           qualityGovernor->drawTime() * 1000.0,
+                           qualityGovernor->gpuTime() * 1000.0);
+    }
+    qualityApplied = qualityGovernor->settings(qualityBase);
+
+    if (renderer->getFaintestAM45deg() != qualityApplied.faintestAM45deg)
+        renderer->setFaintestAM45deg(qualityApplied.faintestAM45deg);
+    if (renderer->getMinimumOrbitSize() != qualityApplied.minimumOrbitSize)
+        renderer->setMinimumOrbitSize(qualityApplied.minimumOrbitSize);
+    if (renderer->getMinimumFeatureSize() != qualityApplied.minimumFeatureSize)
+        renderer->setMinimumFeatureSize(qualityApplied.minimumFeatureSize);
+    if (renderer->getGalaxyDetail() != qualityApplied.galaxyDetail)
+        renderer->setGalaxyDetail(qualityApplied.galaxyDetail);
+    if (renderer->getResolution() != qualityApplied.textureResolution)
+        renderer->setResolution(qualityApplied.textureResolution);
+}
+
 bool CelestiaCore::isRecording()
 {
     return recording;
@@ -2947,17 +3558,57 @@ void CelestiaCore::notifyWatchers(int property)
 
 bool CelestiaCore::goToUrl(std::string_view urlStr)
 {
-    Url url(this);
-    if (!url.parse(urlStr))
+    std::string key(urlStr);
+    auto it = parsedUrls.find(key);
+    if (it == parsedUrls.end())
     {
-        fatalError(_("Invalid URL"));
-        return false;
+        Url url(this);
+        if (!url.parse(urlStr))
+        {
+            fatalError(_("Invalid URL"));
+            return false;
+        }
+
+        if (parsedUrls.size() >= MaxParsedUrls)
+            parsedUrls.clear();
+        it = parsedUrls.emplace(std::move(key), std::move(url)).first;
     }
-    url.goTo();
+    it->second.goTo();
     notifyWatchers(RenderFlagsChanged | LabelFlagsChanged);
     return true;
 }
 
+void CelestiaCore::saveScene(std::string_view name)
+{
+    SceneSnapshot snapshot = SceneSnapshot::capture(*this);
+    if (sceneBase == nullptr)
+    {
+        sceneBase = std::make_shared<const SceneSnapshot>(std::move(snapshot));
+        scenes.insert_or_assign(std::string(name), *sceneBase);
+    }
+    else
+    {
+        scenes.insert_or_assign(std::string(name), snapshot.deltaFrom(sceneBase));
+    }
+}
+
+bool CelestiaCore::restoreScene(std::string_view name)
+{
+    auto it = scenes.find(name);
+    if (it == scenes.end())
+    {
+        GetLogger()->error(_("Unknown scene {}\n"), name);
+        return false;
+    }
+
+    if (!it->second.apply(*this))
+    {
+        GetLogger()->error(_("Scene {} no longer matches the loaded catalogs\n"), name);
+        return false;
+    }
+    return true;
+}
+
 
 void CelestiaCore::addToHistory()
 {
@@ -3195,6 +3846,32 @@ bool CelestiaCore::saveScreenShot(const fs::path& filename, ContentType type) co
     return image.save(filename, type);
 }
 
+bool CelestiaCore::saveScreenShotAsync(const fs::path& filename, ContentType type,
+                                       celestia::ScreenshotWriter::Callback&& callback)
+{
+    if (type == ContentType::Unknown)
+        type = DetermineFileType(filename);
+
+    if (!Image::canSave(type))
+    {
+        GetLogger()->error(_("Unsupported image type: {}!\n"), filename);
+        return false;
+    }
+
+    if (screenshotWriter == nullptr)
+        screenshotWriter = std::make_unique<celestia::ScreenshotWriter>();
+
+    screenshotWriter->request(filename, type,
+                              [callback = std::move(callback)](const fs::path& path, bool success)
+                              {
+                                  if (!success)
+                                      GetLogger()->error(_("Unable to write screenshot {}\n"), path);
+                                  if (callback)
+                                      callback(path, success);
+                              });
+    return true;
+}
+
 #ifdef USE_MINIAUDIO
 std::shared_ptr<celestia::AudioSession> CelestiaCore::getAudioSession(int channel) const
 {
@@ -3210,12 +3887,45 @@ bool CelestiaCore::isPlayingAudio(int channel) const
 
 bool CelestiaCore::playAudio(int channel, const fs::path &path, double startTime, float volume, float pan, bool loop, bool nopause)
 {
+    // Play the file preloaded on the channel, which is already decoded
+    if (auto audioSession = getAudioSession(channel);
+        audioSession && !audioSession->isPlaying() && audioSession->path() == AudioSession::resolvePath(path))
+    {
+        audioSession->setVolume(volume);
+        audioSession->setPan(pan);
+        audioSession->setLoop(loop);
+        audioSession->setNoPause(nopause);
+        return audioSession->play(std::max(startTime, 0.0));
+    }
+
     stopAudio(channel);
     auto audioSession = make_shared<MiniAudioSession>(path, volume, pan, loop, nopause);
     audioSessions[channel] = audioSession;
     return audioSession->play(startTime);
 }
 
+bool CelestiaCore::preloadAudio(int channel, const fs::path &path, float volume, float pan, bool loop, bool nopause)
+{
+    // Leave the file alone if it is already on the channel
+    if (auto audioSession = getAudioSession(channel);
+        audioSession && audioSession->path() == AudioSession::resolvePath(path))
+    {
+        if (!audioSession->isPlaying())
+        {
+            audioSession->setVolume(volume);
+            audioSession->setPan(pan);
+            audioSession->setLoop(loop);
+            audioSession->setNoPause(nopause);
+        }
+        return audioSession->preload();
+    }
+
+    stopAudio(channel);
+    auto audioSession = make_shared<MiniAudioSession>(path, volume, pan, loop, nopause);
+    audioSessions[channel] = audioSession;
+    return audioSession->preload();
+}
+
 bool CelestiaCore::resumeAudio(int channel)
 {
     auto audioSession = getAudioSession(channel);
@@ -3333,11 +4043,101 @@ celestia::LayoutDirection CelestiaCore::getLayoutDirection() const
 
 void CelestiaCore::setLayoutDirection(celestia::LayoutDirection value)
 {
+    redrawRequested = true;
     metrics.layoutDirection = value;
     hud->setTextAlignment(metrics.layoutDirection);
     renderer->setRTL(metrics.layoutDirection == LayoutDirection::RightToLeft);
 }
 
+/// Record the time spent in the stages of initSimulation() and
+/// initRenderer() to a trace file. This must be set before calling
+/// initSimulation.
+void CelestiaCore::setStartupTraceFile(const fs::path& fn)
+{
+    m_startupTraceFile = fn;
+}
+
+/// Show the times of the zones of the frames, profiling them while the
+/// overlay is shown.
+void CelestiaCore::setProfilerOverlay(bool show)
+{
+    hud->hudSettings().showProfiler = show;
+    renderer->setProfilingEnabled(show || m_traceFramesLeft > 0);
+}
+
+bool CelestiaCore::getProfilerOverlay() const
+{
+    return hud->hudSettings().showProfiler;
+}
+
+/// Show the counters of the render statistics of the frame.
+void CelestiaCore::setRenderStatsOverlay(bool show)
+{
+    hud->hudSettings().showRenderStats = show;
+}
+
+bool CelestiaCore::getRenderStatsOverlay() const
+{
+    return hud->hudSettings().showRenderStats;
+}
+
+/// Add the memory used by the catalogs, the solar system bodies, the loaded
+/// trajectories, textures, models and fonts, and the heaps of the running
+/// scripts to the report.
+void CelestiaCore::reportMemoryUsage(MemoryReport& report) const
+{
+    if (universe != nullptr)
+        universe->reportMemoryUsage(report);
+
+    ephem::ReportSampledTrajectoryMemory(report);
+
+    // The sizes of the loaded textures and models are updated each frame
+    const TextureManager* textureManager = GetTextureManager();
+    report.add("Textures"sv, "GPU"sv, textureManager->getMemoryUsage(), textureManager->getLoadedCount());
+    report.add("Textures"sv, "CPU (decoded, waiting for upload)"sv, textureManager->getPendingMemoryUsage());
+
+    const GeometryManager* geometryManager = GetGeometryManager();
+    report.add("Models"sv, "Meshes (CPU and GPU)"sv, geometryManager->getMemoryUsage(), geometryManager->getLoadedCount());
+
+    ReportTextureFontMemory(report);
+
+    if (m_script != nullptr)
+    {
+        if (std::size_t size = m_script->getMemoryUsage(); size > 0)
+            report.add("Scripts"sv, "Lua heap (script)"sv, size);
+    }
+    if (m_scriptHook != nullptr)
+    {
+        if (std::size_t size = m_scriptHook->getMemoryUsage(); size > 0)
+            report.add("Scripts"sv, "Lua heap (hooks)"sv, size);
+    }
+}
+
+/// Record the zones of the next frames to a trace file, which is written
+/// after the given number of frames or by stopFrameTrace(). Fails while a
+/// trace is already being recorded.
+bool CelestiaCore::startFrameTrace(const fs::path& fn, unsigned int frames)
+{
+    if (frames == 0 || IsTracing() || !StartTrace(fn))
+        return false;
+
+    m_traceFramesLeft = frames;
+    renderer->setProfilingEnabled(true);
+    return true;
+}
+
+void CelestiaCore::stopFrameTrace()
+{
+    if (m_traceFramesLeft == 0)
+        return;
+
+    m_traceFramesLeft = 0;
+    // The last frames are only added once their GPU times are known
+    renderer->getProfiler().flush();
+    StopTrace();
+    renderer->setProfilingEnabled(hud->hudSettings().showProfiler);
+}
+
 void CelestiaCore::setLogFile(const fs::path &fn)
 {
     m_logfile = std::ofstream(fn);
@@ -3355,13 +4155,28 @@ void CelestiaCore::setLogFile(const fs::path &fn)
 
 void CelestiaCore::loadAsterismsFile(const fs::path &path)
 {
+    // With a catalog cache directory, the asterisms are kept with their
+    // stars resolved, so that later sessions don't look up the star names
+    const StarDatabase& starDB = *universe->getStarCatalog();
+    auto cachePath = getCachePath(*config, AsterismCacheVersion, path, ".astdb");
+    if (auto mappedFile = openCache(cachePath); mappedFile != nullptr)
+    {
+        if (auto asterisms = ReadBinaryAsterismList(mappedFile->data(), mappedFile->size(), starDB);
+            asterisms != nullptr)
+        {
+            universe->setAsterisms(std::move(asterisms));
+            return;
+        }
+    }
+
     if (ifstream asterismsFile(path, ios::in); !asterismsFile.good())
     {
         GetLogger()->error(_("Error opening asterisms file {}.\n"), path);
     }
     else
     {
-        std::unique_ptr<AsterismList> asterisms = ReadAsterismList(asterismsFile, *universe->getStarCatalog());
+        std::unique_ptr<AsterismList> asterisms = ReadAsterismList(asterismsFile, starDB);
+        storeCache(cachePath, *asterisms, WriteBinaryAsterismList);
         universe->setAsterisms(std::move(asterisms));
     }
 }
@@ -11,12 +11,15 @@
 
 #include <array>
 #include <fstream>
+#include <future>
 #include <locale>
+#include <map>
 #include <string>
 #include <functional>
 #include <string_view>
 #include <tuple>
 #include <optional>
+#include <unordered_map>
 #include <celutil/filetype.h>
 #include <celutil/timer.h>
 #include <celutil/watcher.h>
@@ -28,14 +31,20 @@
 #include <celengine/simulation.h>
 #include <celengine/overlayimage.h>
 #include <celengine/viewporteffect.h>
+#include <celengine/dynamicresolution.h>
+#include <celengine/gpuframetimer.h>
+#include <celengine/qualitygovernor.h>
 #include <celimage/pixelformat.h>
 #include <celutil/flag.h>
+#include <celutil/spscqueue.h>
 #include <celutil/tee.h>
 #include "configfile.h"
 #include "favorites.h"
 #include "destination.h"
 #include "hud.h"
 #include "moviecapture.h"
+#include "scenesnapshot.h"
+#include "screenshotwriter.h"
 #include "timeinfo.h"
 #include "view.h"
 #include "windowmetrics.h"
@@ -58,6 +67,16 @@ class ViewManager;
 #ifdef USE_MINIAUDIO
 class AudioSession;
 #endif
+#ifdef USE_REMOTE_CONTROL
+class RemoteControl;
+#endif
+#ifdef USE_CLUSTER
+class ClusterSync;
+#endif
+namespace util
+{
+class MemoryReport;
+}
 }
 
 typedef Watcher<CelestiaCore> CelestiaWatcher;
@@ -212,6 +231,10 @@ public:
     std::vector<Url>::size_type getHistoryCurrent() const;
     void setHistoryCurrent(std::vector<Url>::size_type curr);
 
+    // Scenes kept in memory for shows to jump between
+    void saveScene(std::string_view name);
+    bool restoreScene(std::string_view name);
+
     // event processing methods
     void charEntered(const char*, int modifiers = 0);
     void charEntered(char, int modifiers = 0);
@@ -226,7 +249,16 @@ public:
     void joystickButton(int button, bool down);
     void pinchUpdate(float focusX, float focusY, float scale, bool zoomFOV);
     void resize(GLsizei w, GLsizei h);
-    void draw();
+    // When set, the event processing methods above only queue the events
+    // and the next tick() handles them, so that a frontend can render on a
+    // thread of its own while its UI thread keeps receiving input. The
+    // events must then all come from one thread other than the one calling
+    // tick(), and the cursor handler is called from the latter. Set before
+    // the render thread starts.
+    void setQueuedInput(bool);
+    // Return false if the frame was not drawn because nothing visible
+    // changed since the last one, which is then still current
+    bool draw();
     void draw(celestia::View*);
     void tick();
     // Tick with elapsed time in seconds after last update, useful when
@@ -252,6 +284,14 @@ public:
     FavoritesList* getFavorites();
 
     bool viewUpdateRequired() const;
+    // Draw the next frame even if nothing seems to have changed, e.g. when
+    // the window was uncovered
+    void requestRedraw();
+    // Star under the mouse cursor, found on the graphics card when the
+    // GPUStarPicking and StaticStarBuffer options are enabled. The result
+    // follows the cursor by a few frames; until it catches up the
+    // selection is empty.
+    Selection getHoverSelection() const;
 
     const DestinationList* getDestinations();
 
@@ -269,6 +309,12 @@ public:
     bool isCaptureActive();
     bool isRecording();
 
+    // Advance the simulation and the scripts by a constant step each frame
+    // instead of the time elapsed, and draw no frame before the textures,
+    // models and shaders it needs are loaded; zero uses the timer
+    void setFixedTimeStep(double);
+    double getFixedTimeStep() const;
+
     void runScript(const fs::path& filename, bool i18n = true);
     void cancelScript();
 
@@ -325,6 +371,15 @@ public:
     void notifyWatchers(int);
 
     void setLogFile(const fs::path&);
+    void setStartupTraceFile(const fs::path&);
+
+    void setProfilerOverlay(bool);
+    bool getProfilerOverlay() const;
+    void setRenderStatsOverlay(bool);
+    bool getRenderStatsOverlay() const;
+    bool startFrameTrace(const fs::path&, unsigned int frames);
+    void stopFrameTrace();
+    void reportMemoryUsage(celestia::util::MemoryReport&) const;
 
     class Alerter
     {
@@ -377,12 +432,20 @@ public:
     void getCaptureInfo(std::array<int, 4>& viewport, celestia::engine::PixelFormat& format) const;
     bool captureImage(std::uint8_t* buffer, const std::array<int, 4>& viewport, celestia::engine::PixelFormat format) const;
     bool saveScreenShot(const fs::path&, ContentType = ContentType::Unknown) const;
+    // Write a screenshot of the next frame drawn without waiting for it to
+    // be encoded. The callback is called from a later draw() once the file
+    // has been written; failures are logged in any case.
+    bool saveScreenShotAsync(const fs::path&, ContentType = ContentType::Unknown,
+                             celestia::ScreenshotWriter::Callback&& callback = {});
 
     void loadAsterismsFile(const fs::path &path);
 
 #ifdef USE_MINIAUDIO
     bool isPlayingAudio(int channel) const;
     bool playAudio(int channel, const fs::path& path, double startTime, float volume, float pan, bool loop, bool nopause);
+    // Open the file on the channel without playing it, so that a later
+    // playAudio() of the same file starts at once
+    bool preloadAudio(int channel, const fs::path& path, float volume, float pan, bool loop, bool nopause);
     bool resumeAudio(int channel);
     void pauseAudio(int channel);
     void stopAudio(int channel);
@@ -408,9 +471,44 @@ public:
     void setLayoutDirection(celestia::LayoutDirection);
 
 private:
+    // Event processing call queued by the render thread mode; the meaning
+    // of the fields depends on the type
+    struct InputEvent
+    {
+        enum class Type
+        {
+            CharEntered,
+            KeyDown,
+            KeyUp,
+            MouseWheel,
+            MouseButtonDown,
+            MouseButtonUp,
+            MouseMove,
+            MouseHover,
+            JoystickAxis,
+            JoystickButton,
+            PinchUpdate,
+            Resize,
+        };
+
+        Type type;
+        float x{ 0.0f };
+        float y{ 0.0f };
+        float value{ 0.0f };
+        int code{ 0 };
+        int modifiers{ 0 };
+        // UTF-8 character of CharEntered, null terminated
+        std::array<char, 8> text{};
+    };
+
+    bool queueInput(const InputEvent&);
+    void handleQueuedInput();
+
     void charEnteredAutoComplete(const char*);
     void updateSelectionFromInput();
     void renderOverlay();
+    void updateDeepSkyCatalog(bool wait);
+    void reloadChangedCatalogs();
     Eigen::Vector3f getPickRay(float x, float y, const celestia::View *view);
     void updateFOV(float fov, const std::optional<Eigen::Vector2f> &focus, const celestia::View *view);
 #ifdef CELX
@@ -473,6 +571,9 @@ private:
     double zoomTime{ 0.0 };
 
     double sysTime{ 0.0 };
+    // Timer time at the start of the last tick, for the idle time at the
+    // end of the frame
+    double frameStartTime{ 0.0 };
 
     Eigen::Vector3f joystickRotation{ Eigen::Vector3f::Zero() };
     bool joyButtonsPressed[JoyButtonCount];
@@ -481,7 +582,11 @@ private:
     double KeyAccel{ 1.0 };
 
     MovieCapture* movieCapture{ nullptr };
+    std::unique_ptr<celestia::ScreenshotWriter> screenshotWriter;
     bool recording{ false };
+    double fixedTimeStep{ 0.0 };
+    void updateSynchronousLoading();
+    void updateQuality(double drawTime, std::optional<double> gpuTime);
 
 #ifdef USE_MINIAUDIO
     std::map<int, std::shared_ptr<celestia::AudioSession>> audioSessions;
@@ -498,6 +603,12 @@ private:
     std::vector<Url> history;
     std::vector<Url>::size_type historyCurrent{ 0 };
     std::string startURL;
+    // URLs parsed by goToUrl(), so that bookmarks and cue lists jumping
+    // to the same URLs again skip parsing them and looking up their objects
+    std::unordered_map<std::string, Url> parsedUrls;
+    // Scenes saved by saveScene(), stored as the difference to the first one
+    std::shared_ptr<const celestia::SceneSnapshot> sceneBase;
+    std::map<std::string, celestia::SceneSnapshot, std::less<>> scenes;
 
     std::unique_ptr<celestia::ViewManager> viewManager;
 
@@ -514,11 +625,65 @@ private:
     std::unique_ptr<ViewportEffect> viewportEffect { nullptr };
     bool isViewportEffectUsed { false };
 
+    // Scale of the resolution the views are rendered at, picked from the
+    // GPU frame times; the viewport effect scales them to the window
+    std::unique_ptr<celestia::engine::DynamicResolution> dynamicResolution;
+    std::unique_ptr<celestia::engine::GPUFrameTimer> gpuFrameTimer;
+
+    // Quality level picked from the CPU and GPU frame times. The settings
+    // of the renderer it reduces are those the user chose, which are
+    // updated when one of the settings applied is changed.
+    std::unique_ptr<celestia::engine::QualityGovernor> qualityGovernor;
+    celestia::engine::QualityGovernor::Settings qualityBase{};
+    celestia::engine::QualityGovernor::Settings qualityApplied{};
+    double simulationTime{ 0.0 };
+
+    // State of the last frame drawn, compared by viewUpdateRequired() when
+    // rendering on demand
+    struct DrawnView
+    {
+        UniversalCoord position;
+        Eigen::Quaterniond orientation;
+        float fov;
+        float x;
+        float y;
+        float width;
+        float height;
+    };
+    static DrawnView drawnView(const celestia::View&);
+    std::vector<DrawnView> drawnViews;
+    double drawnTime{ 0.0 };
+    Selection drawnSelection;
+    bool redrawRequested{ true };
+
+    // Window position of the mouse cursor, lower left origin
+    std::array<int, 2> hoverPosition{ -1, -1 };
+
+    bool queuedInput{ false };
+    std::unique_ptr<celestia::util::SPSCQueue<InputEvent, 1024>> inputQueue;
+
     ScriptSystemAccessPolicy scriptSystemAccessPolicy { ScriptSystemAccessPolicy::Ask };
 
     std::unique_ptr<Console> console;
+#ifdef USE_REMOTE_CONTROL
+    std::unique_ptr<celestia::RemoteControl> remoteControl;
+#endif
+#ifdef USE_CLUSTER
+    std::unique_ptr<celestia::ClusterSync> clusterSync;
+#endif
     std::ofstream m_logfile;
     teestream m_tee;
+    fs::path m_startupTraceFile;
+    // Frames left to record in the frame trace
+    unsigned int m_traceFramesLeft{ 0 };
+
+    // Deep sky catalogs loaded by a worker thread, swapped into the
+    // universe by tick() when they are ready
+    std::future<std::unique_ptr<DSODatabase>> dsoCatalogLoader;
+
+    // Solar system catalogs checked for changes with ReloadChangedCatalogs
+    std::vector<std::pair<fs::path, fs::file_time_type>> watchedCatalogs;
+    double lastCatalogCheck{ 0.0 };
 
     std::vector<celestia::astro::LeapSecondRecord> leapSeconds;
 
@@ -0,0 +1,421 @@
+// clustersync.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Keep the instances rendering the parts of a multi-projector display in
+// step.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "clustersync.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#include <celengine/observer.h>
+#include <celengine/render.h>
+#include <celengine/selection.h>
+#include <celengine/simulation.h>
+#include <celengine/univcoord.h>
+#include <celmath/geomutil.h>
+#include <celmath/mathlib.h>
+#include <celutil/logger.h>
+#include <celutil/stringutils.h>
+#include "celestiacore.h"
+#include "netsocket.h"
+#include "url.h"
+
+using celestia::util::GetLogger;
+using namespace celestia::net;
+
+namespace celestia
+{
+
+namespace
+{
+
+constexpr std::uint32_t PacketMagic = 0x54534c43; // "CLST"
+
+// Longest a master waits for the slaves to finish a frame and a slave
+// waits for the state of the next frame
+constexpr auto BarrierTimeout = std::chrono::milliseconds(100);
+
+constexpr std::size_t MaxPacketSize = 1024;
+
+enum PacketType : std::uint32_t
+{
+    StatePacket = 1,
+    AckPacket   = 2,
+};
+
+struct PacketHeader
+{
+    std::uint32_t magic;
+    std::uint32_t type;
+    std::uint64_t frame;
+};
+
+enum StateFlags : std::uint32_t
+{
+    Paused         = 0x01,
+    LightTimeDelay = 0x02,
+};
+
+// Followed in the packet by the encoded name of the selection
+struct FrameState
+{
+    double tdb;
+    double timeScale;
+    std::array<std::uint64_t, 6> position;
+    std::array<double, 4> orientation;
+    std::uint64_t renderFlags;
+    float fov;
+    std::int32_t labelMode;
+    std::uint32_t flags;
+    std::uint32_t selectionLength;
+};
+
+constexpr std::size_t StateOffset = sizeof(PacketHeader);
+constexpr std::size_t SelectionOffset = StateOffset + sizeof(FrameState);
+
+bool
+readHeader(const std::vector<char>& packet, PacketHeader& header)
+{
+    if (packet.size() < sizeof(PacketHeader))
+        return false;
+    std::memcpy(&header, packet.data(), sizeof(PacketHeader));
+    return header.magic == PacketMagic;
+}
+
+void
+sendPacket(SocketHandle s, const std::vector<char>& packet, std::uint32_t address, std::uint16_t port)
+{
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_addr.s_addr = address;
+    to.sin_port = port;
+    sendto(s, packet.data(), static_cast<int>(packet.size()), SendFlags,
+           reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+}
+
+// Wait up to timeout milliseconds for a packet; returns false when there
+// is none
+bool
+receivePacket(SocketHandle s, int timeout, std::vector<char>& packet, sockaddr_in& from)
+{
+    pollfd fd{ s, POLLIN, 0 };
+    if (pollSockets(&fd, 1, timeout) <= 0)
+        return false;
+
+    packet.resize(MaxPacketSize);
+    socklen_t fromLength = sizeof(from);
+    auto count = recvfrom(s, packet.data(), static_cast<int>(packet.size()), 0,
+                          reinterpret_cast<sockaddr*>(&from), &fromLength);
+    if (count < 0)
+        return false;
+
+    packet.resize(static_cast<std::size_t>(count));
+    return true;
+}
+
+int
+millisecondsUntil(std::chrono::steady_clock::time_point deadline)
+{
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return std::max(0, static_cast<int>(left.count()));
+}
+
+} // end unnamed namespace
+
+
+ClusterSync::ClusterSync(CelestiaCore& _appCore,
+                         Role _role,
+                         std::intptr_t _socket,
+                         std::uint32_t _groupAddress,
+                         std::uint16_t _port,
+                         unsigned int _nodes,
+                         const Eigen::Quaterniond& _viewRotation) :
+    appCore(_appCore),
+    role(_role),
+    socket(_socket),
+    groupAddress(_groupAddress),
+    port(_port),
+    nodes(_nodes),
+    viewRotation(_viewRotation)
+{
+}
+
+
+ClusterSync::~ClusterSync()
+{
+    closeSocket(static_cast<SocketHandle>(socket));
+    cleanup();
+}
+
+
+std::unique_ptr<ClusterSync>
+ClusterSync::create(CelestiaCore& appCore, const CelestiaConfig::Cluster& config)
+{
+    Role role;
+    if (compareIgnoringCase(config.mode, "master") == 0)
+        role = Role::Master;
+    else if (compareIgnoringCase(config.mode, "slave") == 0)
+        role = Role::Slave;
+    else
+    {
+        if (!config.mode.empty())
+            GetLogger()->warn("Unknown cluster mode {}\n", config.mode);
+        return nullptr;
+    }
+
+    in_addr group{};
+    if (inet_pton(AF_INET, config.group.c_str(), &group) != 1 || config.port == 0 || config.port > 0xffff)
+    {
+        GetLogger()->error("Invalid cluster group {} or port {}\n", config.group, config.port);
+        return nullptr;
+    }
+    auto port = htons(static_cast<std::uint16_t>(config.port));
+
+    if (!startup())
+    {
+        GetLogger()->error("Failed to initialize the sockets for the cluster\n");
+        return nullptr;
+    }
+
+    SocketHandle s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    bool success = s != InvalidSocket;
+    if (success && role == Role::Master)
+    {
+        // Keep the state within the local network, and let slaves on the
+        // same host receive it
+        unsigned char ttl = 1;
+        unsigned char loop = 1;
+        setsockopt(s, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl), sizeof(ttl));
+        setsockopt(s, IPPROTO_IP, IP_MULTICAST_LOOP, reinterpret_cast<const char*>(&loop), sizeof(loop));
+    }
+    else if (success)
+    {
+        int reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = port;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        ip_mreq membership{};
+        membership.imr_multiaddr = group;
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+        success = bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+                  setsockopt(s, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                             reinterpret_cast<const char*>(&membership), sizeof(membership)) == 0;
+    }
+
+    if (!success)
+    {
+        GetLogger()->error("Failed to open the cluster socket for {}:{}\n", config.group, config.port);
+        if (s != InvalidSocket)
+            closeSocket(s);
+        cleanup();
+        return nullptr;
+    }
+
+    Eigen::Quaterniond viewRotation = math::ZRotation(math::degToRad(static_cast<double>(config.viewRoll))) *
+                                      math::XRotation(math::degToRad(static_cast<double>(config.viewPitch))) *
+                                      math::YRotation(math::degToRad(static_cast<double>(config.viewHeading)));
+
+    GetLogger()->info("Cluster {} on {}:{}\n", role == Role::Master ? "master" : "slave",
+                      config.group, config.port);
+    return std::unique_ptr<ClusterSync>(new ClusterSync(appCore, role, static_cast<std::intptr_t>(s),
+                                                        group.s_addr, port, config.nodes, viewRotation));
+}
+
+
+void
+ClusterSync::tick()
+{
+    if (role == Role::Master)
+    {
+        waitForSlaves();
+        sendState();
+    }
+    else
+    {
+        receiveState();
+    }
+}
+
+
+void
+ClusterSync::frameFinished()
+{
+    if (role != Role::Slave || masterPort == 0)
+        return;
+
+    PacketHeader header{ PacketMagic, AckPacket, frame };
+    std::vector<char> packet(sizeof(header));
+    std::memcpy(packet.data(), &header, sizeof(header));
+    sendPacket(static_cast<SocketHandle>(socket), packet, masterAddress, masterPort);
+}
+
+
+void
+ClusterSync::waitForSlaves()
+{
+    if (nodes == 0 || frame == 0)
+        return;
+
+    auto s = static_cast<SocketHandle>(socket);
+    auto deadline = std::chrono::steady_clock::now() + BarrierTimeout;
+    std::vector<char> packet;
+    sockaddr_in from{};
+    while (acknowledged.size() < nodes && receivePacket(s, millisecondsUntil(deadline), packet, from))
+    {
+        PacketHeader header;
+        if (!readHeader(packet, header) || header.type != AckPacket || header.frame != frame)
+            continue;
+
+        auto slave = (static_cast<std::uint64_t>(from.sin_addr.s_addr) << 16) | from.sin_port;
+        if (std::find(acknowledged.begin(), acknowledged.end(), slave) == acknowledged.end())
+            acknowledged.push_back(slave);
+    }
+
+    acknowledged.clear();
+}
+
+
+void
+ClusterSync::sendState()
+{
+    ++frame;
+
+    Simulation* sim = appCore.getSimulation();
+    const Observer* observer = sim->getActiveObserver();
+    const Renderer* renderer = appCore.getRenderer();
+
+    FrameState state{};
+    state.tdb = sim->getTime();
+    state.timeScale = sim->getTimeScale();
+    UniversalCoord position = observer->getPosition();
+    state.position = { position.x.lo, position.x.hi,
+                       position.y.lo, position.y.hi,
+                       position.z.lo, position.z.hi };
+    Eigen::Quaterniond q = observer->getOrientation();
+    state.orientation = { q.w(), q.x(), q.y(), q.z() };
+    state.renderFlags = renderer->getRenderFlags();
+    state.fov = observer->getFOV();
+    state.labelMode = renderer->getLabelMode();
+    if (sim->getPauseState())
+        state.flags |= Paused;
+    if (appCore.getLightDelayActive())
+        state.flags |= LightTimeDelay;
+
+    std::string name = Url::getEncodedObjectName(sim->getSelection(), &appCore);
+    name.resize(std::min(name.size(), MaxPacketSize - SelectionOffset));
+    state.selectionLength = static_cast<std::uint32_t>(name.size());
+
+    PacketHeader header{ PacketMagic, StatePacket, frame };
+    std::vector<char> packet(SelectionOffset + name.size());
+    std::memcpy(packet.data(), &header, sizeof(header));
+    std::memcpy(packet.data() + StateOffset, &state, sizeof(state));
+    std::memcpy(packet.data() + SelectionOffset, name.data(), name.size());
+    sendPacket(static_cast<SocketHandle>(socket), packet, groupAddress, port);
+}
+
+
+void
+ClusterSync::receiveState()
+{
+    // Wait for the state of a new frame, then take the latest of those
+    // which arrived meanwhile
+    auto s = static_cast<SocketHandle>(socket);
+    auto deadline = std::chrono::steady_clock::now() + BarrierTimeout;
+    std::vector<char> packet;
+    std::vector<char> latest;
+    std::uint64_t latestFrame = frame;
+    sockaddr_in from{};
+    while (receivePacket(s, latest.empty() ? millisecondsUntil(deadline) : 0, packet, from))
+    {
+        PacketHeader header;
+        if (!readHeader(packet, header) || header.type != StatePacket || packet.size() < SelectionOffset)
+            continue;
+
+        // A restarted master numbers its frames from the start again
+        bool newMaster = from.sin_addr.s_addr != masterAddress || from.sin_port != masterPort;
+        if (header.frame > latestFrame || newMaster)
+        {
+            latestFrame = header.frame;
+            latest.swap(packet);
+            masterAddress = from.sin_addr.s_addr;
+            masterPort = from.sin_port;
+        }
+    }
+
+    if (latest.empty())
+    {
+        if (!waitingForMaster)
+            GetLogger()->warn("No state received from the cluster master\n");
+        waitingForMaster = true;
+        return;
+    }
+
+    waitingForMaster = false;
+    frame = latestFrame;
+    applyState(latest);
+}
+
+
+void
+ClusterSync::applyState(const std::vector<char>& packet)
+{
+    FrameState state;
+    std::memcpy(&state, packet.data() + StateOffset, sizeof(state));
+
+    Simulation* sim = appCore.getSimulation();
+    Renderer* renderer = appCore.getRenderer();
+
+    // The position and orientation are universal, and the simulation of the
+    // slave mustn't move the observer on its own
+    if (sim->getFrame()->getCoordinateSystem() != ObserverFrame::Universal)
+        sim->setFrame(ObserverFrame::Universal, Selection());
+    if (!sim->getTrackedObject().empty())
+        sim->setTrackedObject(Selection());
+
+    sim->setTime(state.tdb);
+    sim->setTimeScale(state.timeScale);
+    sim->setPauseState((state.flags & Paused) != 0);
+    appCore.setLightDelayActive((state.flags & LightTimeDelay) != 0);
+
+    const auto& p = state.position;
+    sim->setObserverPosition(UniversalCoord(R128(p[0], p[1]), R128(p[2], p[3]), R128(p[4], p[5])));
+    Eigen::Quaterniond q(state.orientation[0], state.orientation[1], state.orientation[2], state.orientation[3]);
+    Observer* observer = sim->getActiveObserver();
+    observer->setOrientation(viewRotation * q);
+    if (observer->getFOV() != state.fov)
+    {
+        observer->setFOV(state.fov);
+        appCore.setZoomFromFOV();
+    }
+
+    renderer->setRenderFlags(state.renderFlags);
+    renderer->setLabelMode(state.labelMode);
+
+    std::size_t length = std::min(static_cast<std::size_t>(state.selectionLength), packet.size() - SelectionOffset);
+    if (std::string_view name(packet.data() + SelectionOffset, length); name != selectionName)
+    {
+        selectionName = name;
+        std::string path = selectionName;
+        std::replace(path.begin(), path.end(), ':', '/');
+        sim->setSelection(path.empty() ? Selection() : sim->findObjectFromPath(path));
+    }
+}
+
+} // end namespace celestia
@@ -0,0 +1,101 @@
+// clustersync.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Keep the instances rendering the parts of a multi-projector display in
+// step.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include "configfile.h"
+
+class CelestiaCore;
+
+namespace celestia
+{
+
+/*! Synchronize a cluster of Celestia instances which each render a part of
+ *  the same display. The master sends the time, the observer position,
+ *  orientation and field of view, the render flags and the selection of
+ *  every frame to a UDP multicast group. The slaves apply that state in
+ *  their own frame instead of running the simulation themselves, and turn
+ *  the view by their configured heading, pitch and roll; the distortion of
+ *  each projector is left to the warp mesh viewport effect.
+ *
+ *  When the number of slaves is configured, each of them acknowledges a
+ *  frame once it is drawn, and the master waits for all the
+ *  acknowledgements of a frame before it sends the next one, which keeps
+ *  the nodes within a frame of each other. A node which stops responding
+ *  only delays the others by the barrier timeout.
+ *
+ *  The state is sent in the byte order of the master, so all the nodes
+ *  must be of the same architecture.
+ */
+class ClusterSync
+{
+ public:
+    ~ClusterSync();
+
+    ClusterSync(const ClusterSync&) = delete;
+    ClusterSync& operator=(const ClusterSync&) = delete;
+
+    // Returns nullptr if the cluster isn't configured or its sockets can't
+    // be opened
+    static std::unique_ptr<ClusterSync> create(CelestiaCore&, const CelestiaConfig::Cluster&);
+
+    // Called at the end of the tick: the master sends the state of the
+    // frame, a slave waits for it and applies it.
+    void tick();
+    // Called when a frame has been drawn
+    void frameFinished();
+
+    bool isSlave() const { return role == Role::Slave; }
+
+ private:
+    enum class Role
+    {
+        Master,
+        Slave,
+    };
+
+    ClusterSync(CelestiaCore&, Role, std::intptr_t socket, std::uint32_t groupAddress,
+                std::uint16_t port, unsigned int nodes, const Eigen::Quaterniond& viewRotation);
+
+    void waitForSlaves();
+    void sendState();
+    void receiveState();
+    void applyState(const std::vector<char>&);
+
+    CelestiaCore& appCore;
+    Role role;
+    std::intptr_t socket;
+
+    // Addresses and ports in network byte order
+    std::uint32_t groupAddress;
+    std::uint16_t port;
+    std::uint32_t masterAddress{ 0 };
+    std::uint16_t masterPort{ 0 };
+
+    unsigned int nodes;
+    Eigen::Quaterniond viewRotation;
+
+    std::uint64_t frame{ 0 };
+    // Slaves which have acknowledged the last frame sent
+    std::vector<std::uint64_t> acknowledged;
+    std::string selectionName;
+    bool waitingForMaster{ true };
+};
+
+} // end namespace celestia
@@ -133,10 +133,13 @@ void
 applyPaths(CelestiaConfig::Paths& paths, const Hash& hash)
 {
     applyPath(paths.starDatabaseFile, hash, "StarDatabase"sv);
+    applyPath(paths.pagedStarDatabaseFile, hash, "PagedStarDatabase"sv);
     applyPath(paths.starNamesFile, hash, "StarNameDatabase"sv);
     applyPathArray(paths.solarSystemFiles, hash, "SolarSystemCatalogs"sv);
+    applyPathArray(paths.minorBodyFiles, hash, "MinorBodyCatalogs"sv);
     applyPathArray(paths.starCatalogFiles, hash, "StarCatalogs"sv);
     applyPathArray(paths.dsoCatalogFiles, hash, "DeepSkyCatalogs"sv);
+    applyPath(paths.dsoDatabaseFile, hash, "DeepSkyDatabase"sv);
     applyPathArray(paths.extrasDirs, hash, "ExtrasDirectories"sv);
     applyPathArray(paths.skipExtras, hash, "SkipExtras"sv);
     applyPath(paths.asterismsFile, hash, "AsterismsFile"sv);
@@ -149,6 +152,9 @@ applyPaths(CelestiaConfig::Paths& paths, const Hash& hash)
     applyPath(paths.SAOCrossIndexFile, hash, "SAOCrossIndex"sv);
     applyPath(paths.warpMeshFile, hash, "WarpMeshFile"sv);
     applyPath(paths.leapSecondsFile, hash, "LeapSecondsFile"sv);
+    applyPath(paths.shaderCacheDirectory, hash, "ShaderCacheDirectory"sv);
+    applyPath(paths.textureCacheDirectory, hash, "TextureCacheDirectory"sv);
+    applyPath(paths.catalogCacheDirectory, hash, "CatalogCacheDirectory"sv);
 #ifdef CELX
     applyPath(paths.scriptScreenshotDirectory, hash, "ScriptScreenshotDirectory"sv);
     applyPath(paths.luaHook, hash, "LuaHook"sv);
@@ -191,10 +197,33 @@ applyRenderDetails(CelestiaConfig::RenderDetails& renderDetails, const Hash& has
     applyNumber(renderDetails.SolarSystemMaxDistance, hash, "SolarSystemMaxDistance"sv);
     renderDetails.SolarSystemMaxDistance = std::clamp(renderDetails.SolarSystemMaxDistance, 1.0f, 10.0f);
     applyNumber(renderDetails.ShadowMapSize, hash, "ShadowMapSize"sv);
+    applyBoolean(renderDetails.staticStarBuffer, hash, "StaticStarBuffer"sv);
+    applyBoolean(renderDetails.gpuStarPicking, hash, "GPUStarPicking"sv);
+    applyBoolean(renderDetails.starSplatting, hash, "StarSplatting"sv);
+    applyBoolean(renderDetails.distantStarCache, hash, "DistantStarCache"sv);
+    applyBoolean(renderDetails.shaderWarmup, hash, "ShaderWarmup"sv);
+    applyBoolean(renderDetails.labelOverlapCulling, hash, "LabelOverlapCulling"sv);
+    applyBoolean(renderDetails.distanceFieldFonts, hash, "DistanceFieldFonts"sv);
+    applyNumber(renderDetails.dynamicResolutionFrameTime, hash, "DynamicResolutionFrameTime"sv);
+    applyNumber(renderDetails.adaptiveQualityFrameTime, hash, "AdaptiveQualityFrameTime"sv);
+    applyBoolean(renderDetails.renderOnDemand, hash, "RenderOnDemand"sv);
     applyStringArray(renderDetails.ignoreGLExtensions, hash, "IgnoreGLExtensions"sv);
 }
 
 
+void
+applyCluster(CelestiaConfig::Cluster& cluster, const Hash& hash)
+{
+    applyString(cluster.mode, hash, "ClusterMode"sv);
+    applyString(cluster.group, hash, "ClusterGroup"sv);
+    applyNumber(cluster.port, hash, "ClusterPort"sv);
+    applyNumber(cluster.nodes, hash, "ClusterNodes"sv);
+    applyNumber(cluster.viewHeading, hash, "ClusterViewHeading"sv);
+    applyNumber(cluster.viewPitch, hash, "ClusterViewPitch"sv);
+    applyNumber(cluster.viewRoll, hash, "ClusterViewRoll"sv);
+}
+
+
 void
 applyStarTextures(StarDetails::StarTextureSet& starTextures, const Hash& hash, std::string_view key)
 {
@@ -270,18 +299,37 @@ bool ReadCelestiaConfig(const fs::path& filename, CelestiaConfig& config)
     applyFonts(config.fonts, *configParams);
     applyMouse(config.mouse, *configParams);
     applyRenderDetails(config.renderDetails, *configParams);
+    applyCluster(config.cluster, *configParams);
     applyStarTextures(config.starTextures, *configParams, "StarTextures"sv);
 
     applyString(config.projectionMode, *configParams, "ProjectionMode"sv);
     applyString(config.viewportEffect, *configParams, "ViewportEffect"sv);
     applyString(config.x264EncoderOptions, *configParams, "X264EncoderOptions"sv);
     applyString(config.ffvhEncoderOptions, *configParams, "FFVHEncoderOptions"sv);
+    applyString(config.videoHardwareEncoder, *configParams, "VideoHardwareEncoder"sv);
     applyString(config.measurementSystem, *configParams, "MeasurementSystem"sv);
     applyString(config.temperatureScale, *configParams, "TemperatureScale"sv);
     applyString(config.layoutDirection, *configParams, "LayoutDirection"sv);
     applyString(config.scriptSystemAccessPolicy, *configParams, "ScriptSystemAccessPolicy"sv);
 
     applyNumber(config.consoleLogRows, *configParams, "LogSize"sv);
+    applyNumber(config.pagedStarCacheSize, *configParams, "PagedStarCacheSize"sv);
+    applyBoolean(config.pagedStarQuantization, *configParams, "PagedStarQuantization"sv);
+    applyBoolean(config.lazySolarSystems, *configParams, "LazySolarSystems"sv);
+    applyNumber(config.scriptFrameTime, *configParams, "ScriptFrameTime"sv);
+    applyBoolean(config.scriptGenerationalGC, *configParams, "ScriptGenerationalGC"sv);
+    applyNumber(config.scriptHookTimeBudget, *configParams, "ScriptHookTimeBudget"sv);
+    applyNumber(config.remoteControlPort, *configParams, "RemoteControlPort"sv);
+    applyString(config.remoteControlToken, *configParams, "RemoteControlToken"sv);
+    applyBoolean(config.remoteControlFileWrites, *configParams, "RemoteControlFileWrites"sv);
+    applyNumber(config.fixedFrameRate, *configParams, "FixedFrameRate"sv);
+    applyBoolean(config.backgroundDeepSkyLoading, *configParams, "BackgroundDeepSkyLoading"sv);
+    applyBoolean(config.reloadChangedCatalogs, *configParams, "ReloadChangedCatalogs"sv);
+    applyNumber(config.textureMemoryBudget, *configParams, "TextureMemoryBudget"sv);
+    applyNumber(config.modelMemoryBudget, *configParams, "ModelMemoryBudget"sv);
+    applyNumber(config.virtualTextureMemoryBudget, *configParams, "VirtualTextureMemoryBudget"sv);
+    applyNumber(config.frameUploadBudget, *configParams, "FrameUploadBudget"sv);
+    applyNumber(config.frameUploadTime, *configParams, "FrameUploadTime"sv);
 
 #ifdef CELX
     // Move the value into the config object to retain ownership of the hash
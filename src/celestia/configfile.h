@@ -24,10 +24,13 @@ struct CelestiaConfig
     struct Paths
     {
         fs::path starDatabaseFile{ };
+        fs::path pagedStarDatabaseFile{ };
         fs::path starNamesFile{ };
         std::vector<fs::path> solarSystemFiles{ };
+        std::vector<fs::path> minorBodyFiles{ };
         std::vector<fs::path> starCatalogFiles{ };
         std::vector<fs::path> dsoCatalogFiles{ };
+        fs::path dsoDatabaseFile{ };
         std::vector<fs::path> extrasDirs{ };
         std::vector<fs::path> skipExtras{ };
         fs::path asterismsFile{ };
@@ -40,6 +43,9 @@ struct CelestiaConfig
         fs::path SAOCrossIndexFile{ };
         fs::path warpMeshFile{ };
         fs::path leapSecondsFile{ };
+        fs::path shaderCacheDirectory{ };
+        fs::path textureCacheDirectory{ };
+        fs::path catalogCacheDirectory{ };
 #ifdef CELX
         fs::path scriptScreenshotDirectory{ };
         fs::path luaHook{ };
@@ -75,9 +81,40 @@ struct CelestiaConfig
         unsigned int aaSamples{ 1 };
         float SolarSystemMaxDistance{ 1.0f };
         unsigned int ShadowMapSize{ 0 };
+        bool staticStarBuffer{ false };
+        bool gpuStarPicking{ false };
+        bool starSplatting{ false };
+        bool distantStarCache{ false };
+        bool shaderWarmup{ false };
+        bool labelOverlapCulling{ false };
+        bool distanceFieldFonts{ false };
+        // Target GPU time of a frame in milliseconds for dynamic
+        // resolution; zero renders at the full resolution
+        float dynamicResolutionFrameTime{ 0.0f };
+        // Target frame time in milliseconds for the adaptive quality;
+        // zero keeps the settings of the user
+        float adaptiveQualityFrameTime{ 0.0f };
+        // Draw frames only when something visible changed
+        bool renderOnDemand{ false };
         std::vector<std::string> ignoreGLExtensions{ };
     };
 
+    // Synchronization of the instances rendering the parts of a display
+    struct Cluster
+    {
+        // "master", "slave" or empty when the instance runs alone
+        std::string mode{ };
+        std::string group{ "239.255.42.99" };
+        unsigned int port{ 42990 };
+        // Number of slaves the master waits for before starting a frame
+        unsigned int nodes{ 0 };
+        // Direction of the view of a slave relative to the master's, in
+        // degrees
+        float viewHeading{ 0.0f };
+        float viewPitch{ 0.0f };
+        float viewRoll{ 0.0f };
+    };
+
     CelestiaConfig() = default;
     ~CelestiaConfig() = default;
     CelestiaConfig(const CelestiaConfig&) = delete;
@@ -89,11 +126,56 @@ struct CelestiaConfig
     Fonts fonts{ };
     Mouse mouse{ };
     RenderDetails renderDetails{ };
+    Cluster cluster{ };
     StarDetails::StarTextureSet starTextures{ };
 
     std::string scriptSystemAccessPolicy{ };
 
     unsigned int consoleLogRows{ 200 };
+    // Budget for the decoded blocks of the paged star database, in megabytes
+    unsigned int pagedStarCacheSize{ 256 };
+    // Store the positions of the cached paged stars relative to their
+    // octree node in 16 bits
+    bool pagedStarQuantization{ false };
+    // Create the bodies of the star systems in the extras directories when
+    // they are first needed instead of at startup
+    bool lazySolarSystems{ false };
+    // Load the deep sky catalogs on a worker thread while the stars, the
+    // solar systems and the renderer are initialized
+    bool backgroundDeepSkyLoading{ false };
+    // Read the solar system catalogs of the extras directories again when
+    // they are changed
+    bool reloadChangedCatalogs{ false };
+    // Frame time in milliseconds which the garbage collection steps of the
+    // Lua scripts fill up to after a frame is drawn; zero disables them
+    float scriptFrameTime{ 0.0f };
+    // Use the generational garbage collector of Lua 5.4 for the scripts
+    bool scriptGenerationalGC{ false };
+    // Time in milliseconds which the tick hook of the Lua hook script may
+    // run for in a frame before it is suspended and resumed in the next
+    // frame; zero runs it to completion within the hook timeout
+    float scriptHookTimeBudget{ 0.0f };
+    // Local TCP port the remote control server listens on; zero disables it
+    unsigned int remoteControlPort{ 0 };
+    // Secret which remote control clients must send as their first line
+    std::string remoteControlToken;
+    // Accept remote control commands which write files, like capture
+    bool remoteControlFileWrites{ false };
+    // Frames per second of simulation time for offline rendering, which
+    // advances the simulation by a fixed step each frame; zero follows the
+    // clock
+    float fixedFrameRate{ 0.0f };
+    // Memory budgets of the texture and model managers, in megabytes; zero
+    // means no limit
+    unsigned int textureMemoryBudget{ 0 };
+    unsigned int modelMemoryBudget{ 0 };
+    // Memory budget of the resident tiles of each virtual texture, in
+    // megabytes; zero means no limit
+    unsigned int virtualTextureMemoryBudget{ 256 };
+    // Data uploaded to the graphics card per frame for the resources read
+    // in the background, in megabytes and milliseconds; zero means no limit
+    unsigned int frameUploadBudget{ 32 };
+    float frameUploadTime{ 6.0f };
 
     std::string projectionMode{ };
     std::string viewportEffect{ };
@@ -102,6 +184,7 @@ struct CelestiaConfig
 
     std::string x264EncoderOptions{ };
     std::string ffvhEncoderOptions{ };
+    std::string videoHardwareEncoder{ };
 
     std::string layoutDirection{ };
 
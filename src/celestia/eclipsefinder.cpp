@@ -12,7 +12,13 @@
 
 #include "eclipsefinder.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <thread>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -27,7 +33,6 @@ namespace util = celestia::util;
 namespace
 {
 
-constexpr double dT = 1.0 / (24.0 * 60.0);
 constexpr auto EclipseObjectMask = BodyClassification::Planet      |
                                    BodyClassification::Moon        |
                                    BodyClassification::MinorMoon   |
@@ -37,99 +42,207 @@ constexpr auto EclipseObjectMask = BodyClassification::Planet      |
 // TODO: share this constant and function with render.cpp
 constexpr float MinRelativeOccluderRadius = 0.005f;
 
-bool
-testEclipse(const Body& receiver, const Body& caster, double now)
+// Bounds of the search step, which is otherwise set from the distance to
+// the shadow and the relative motion of the bodies
+constexpr double MinSearchStep = 1.0 / (24.0 * 60.0); // one minute
+constexpr double MaxSearchStep = 1.0;                  // one day
+
+// Fraction of the time needed to reach the shadow at the current relative
+// speed taken as the next step; this allows for speeds changing along
+// eccentric orbits
+constexpr double SearchStepSafety = 0.5;
+
+// Step used to leave an eclipse before bisecting its start or end
+constexpr double EdgeSearchStep = 1.0 / 24.0; // one hour
+
+// Precision of eclipse start and end times
+constexpr double DurationPrecision = 1.0 / (24.0 * 360.0); // ten seconds
+
+// The search range is split in chunks of about this many days per
+// satellite, which are searched concurrently; progress is reported after
+// each chunk
+constexpr double ChunkSpan = 30.0;
+constexpr unsigned int MaxSearchThreads = 16;
+
+// Return the distance in km from the receiver to the shadow volume of the
+// caster, negative when the receiver is in the shadow, or infinity when
+// the caster would not produce a relevant shadow.
+double
+shadowMargin(const Body& receiver, const Body& caster, double now)
 {
     // Ignore situations where the shadow casting body is much smaller than
     // the receiver, as these shadows aren't likely to be relevant.  Also,
     // ignore eclipses where the caster is not an ellipsoid, since we can't
     // generate correct shadows in this case.
-    if (caster.getRadius() >= receiver.getRadius() * MinRelativeOccluderRadius &&
-        caster.isEllipsoid())
+    if (caster.getRadius() < receiver.getRadius() * MinRelativeOccluderRadius ||
+        !caster.isEllipsoid())
     {
-        // All of the eclipse related code assumes that both the caster
-        // and receiver are spherical.  Irregular receivers will work more
-        // or less correctly, but casters that are sufficiently non-spherical
-        // will produce obviously incorrect shadows.  Another assumption we
-        // make is that the distance between the caster and receiver is much
-        // less than the distance between the sun and the receiver.  This
-        // approximation works everywhere in the solar system, and likely
-        // works for any orbitally stable pair of objects orbiting a star.
-        Eigen::Vector3d posReceiver = receiver.getAstrocentricPosition(now);
-        Eigen::Vector3d posCaster = caster.getAstrocentricPosition(now);
-
-        const Star* sun = receiver.getSystem()->getStar();
-        assert(sun != nullptr);
-        double distToSun = posReceiver.norm();
-        float appSunRadius = (float) (sun->getRadius() / distToSun);
-
-        Eigen::Vector3d dir = posCaster - posReceiver;
-        double distToCaster = dir.norm() - receiver.getRadius();
-        float appOccluderRadius = (float) (caster.getRadius() / distToCaster);
-
-        // The shadow radius is the radius of the occluder plus some additional
-        // amount that depends upon the apparent radius of the sun.  For
-        // a sun that's distant/small and effectively a point, the shadow
-        // radius will be the same as the radius of the occluder.
-        float shadowRadius = (1 + appSunRadius / appOccluderRadius) *
-            caster.getRadius();
-
-        // Test whether a shadow is cast on the receiver.  We want to know
-        // if the receiver lies within the shadow volume of the caster.  Since
-        // we're assuming that everything is a sphere and the sun is far
-        // away relative to the caster, the shadow volume is a
-        // cylinder capped at one end.  Testing for the intersection of a
-        // singly capped cylinder is as simple as checking the distance
-        // from the center of the receiver to the axis of the shadow cylinder.
-        // If the distance is less than the sum of the caster's and receiver's
-        // radii, then we have an eclipse.
-        float R = receiver.getRadius() + shadowRadius;
-        double dist = math::distance(posReceiver, Eigen::ParametrizedLine<double, 3>(posCaster, posCaster));
-        if (dist < R)
-        {
-            // Ignore "eclipses" where the caster and receiver have
-            // intersecting bounding spheres.
-            if (distToCaster > caster.getRadius())
-                return true;
-        }
+        return std::numeric_limits<double>::infinity();
     }
 
-    return false;
+    // All of the eclipse related code assumes that both the caster
+    // and receiver are spherical.  Irregular receivers will work more
+    // or less correctly, but casters that are sufficiently non-spherical
+    // will produce obviously incorrect shadows.  Another assumption we
+    // make is that the distance between the caster and receiver is much
+    // less than the distance between the sun and the receiver.  This
+    // approximation works everywhere in the solar system, and likely
+    // works for any orbitally stable pair of objects orbiting a star.
+    Eigen::Vector3d posReceiver = receiver.getAstrocentricPosition(now);
+    Eigen::Vector3d posCaster = caster.getAstrocentricPosition(now);
+
+    const Star* sun = receiver.getSystem()->getStar();
+    assert(sun != nullptr);
+    double distToSun = posReceiver.norm();
+    float appSunRadius = (float) (sun->getRadius() / distToSun);
+
+    Eigen::Vector3d dir = posCaster - posReceiver;
+    double distToCaster = dir.norm() - receiver.getRadius();
+    float appOccluderRadius = (float) (caster.getRadius() / distToCaster);
+
+    // The shadow radius is the radius of the occluder plus some additional
+    // amount that depends upon the apparent radius of the sun.  For
+    // a sun that's distant/small and effectively a point, the shadow
+    // radius will be the same as the radius of the occluder.
+    float shadowRadius = (1 + appSunRadius / appOccluderRadius) *
+        caster.getRadius();
+
+    // Test whether a shadow is cast on the receiver.  We want to know
+    // if the receiver lies within the shadow volume of the caster.  Since
+    // we're assuming that everything is a sphere and the sun is far
+    // away relative to the caster, the shadow volume is a
+    // cylinder capped at one end.  Testing for the intersection of a
+    // singly capped cylinder is as simple as checking the distance
+    // from the center of the receiver to the axis of the shadow cylinder.
+    // If the distance is less than the sum of the caster's and receiver's
+    // radii, then we have an eclipse.
+    float R = receiver.getRadius() + shadowRadius;
+    double dist = math::distance(posReceiver, Eigen::ParametrizedLine<double, 3>(posCaster, posCaster));
+
+    // Ignore "eclipses" where the caster and receiver have
+    // intersecting bounding spheres.
+    if (dist < R && distToCaster <= caster.getRadius())
+        return std::numeric_limits<double>::infinity();
+
+    return dist - R;
+}
+
+bool
+testEclipse(const Body& receiver, const Body& caster, double now)
+{
+    return shadowMargin(receiver, caster, now) < 0.0;
 }
 
+// Return the time that can be skipped while testing for an eclipse of the
+// receiver by the caster which is margin km from the shadow. The distance
+// to the shadow axis changes no faster than the speed of the receiver
+// relative to the caster, plus the speed at which the axis sweeps around
+// the sun at the caster-receiver distance.
 double
-findEclipseSpan(const Body& receiver, const Body& caster,
-                double now, double dt)
+searchStep(const Body& receiver, const Body& caster, double now, double margin)
 {
-    double t = now;
-    while (testEclipse(receiver, caster, t))
-        t += dt;
+    if (!std::isfinite(margin))
+        return MaxSearchStep;
 
-    return t;
+    const Star* sun = receiver.getSystem()->getStar();
+    Eigen::Vector3d velCaster = caster.getVelocity(now);
+    Eigen::Vector3d posCaster = caster.getAstrocentricPosition(now);
+    double separation = (posCaster - receiver.getAstrocentricPosition(now)).norm();
+    double sweepRate = (velCaster - sun->getVelocity(now)).norm() / posCaster.norm();
+    double speed = (velCaster - receiver.getVelocity(now)).norm() + separation * sweepRate;
+
+    if (speed <= 0.0)
+        return MaxSearchStep;
+
+    return std::clamp(SearchStepSafety * margin / speed, MinSearchStep, MaxSearchStep);
 }
 
+// Find the start (step < 0) or end (step > 0) of an eclipse in progress at
+// now, by stepping out of it then bisecting down to the precision.
+double
+findEclipseEdge(const Body& receiver, const Body& caster,
+                double now, double step, double precision)
+{
+    double inside = now;
+    double outside = now + step;
+    while (testEclipse(receiver, caster, outside))
+    {
+        inside = outside;
+        outside += step;
+    }
+
+    while (std::abs(outside - inside) > precision)
+    {
+        double mid = 0.5 * (inside + outside);
+        if (testEclipse(receiver, caster, mid))
+            inside = mid;
+        else
+            outside = mid;
+    }
+
+    return outside;
+}
+
+Eclipse
+makeEclipse(const Body& receiver, const Body& occulter, double now)
+{
+    Eclipse eclipse;
+    eclipse.startTime = findEclipseEdge(receiver, occulter, now, -EdgeSearchStep, DurationPrecision);
+    eclipse.endTime = findEclipseEdge(receiver, occulter, now, EdgeSearchStep, DurationPrecision);
+    eclipse.receiver = const_cast<Body*>(&receiver);
+    eclipse.occulter = const_cast<Body*>(&occulter);
+    return eclipse;
+}
+
+// A time chunk of the search for the eclipses involving one satellite
+struct SearchTask
+{
+    const Body* satellite;
+    double startTime;
+    double endTime;
+    bool first;
+    std::vector<Eclipse> eclipses;
+};
+
+// Search for the eclipses between the body and a satellite over the time
+// range of the task. An eclipse already in progress at the start of the
+// task is left to the previous task, which sees it start.
 void
-addEclipse(const Body& receiver, const Body& occulter,
-           double now,
-           double /*startStep*/, double /*minStep*/,
-           std::vector<Eclipse>& eclipses,
-           std::vector<double>& previousEclipseEndTimes, int i)
+searchEclipses(const Body& body, SearchTask& task, int eclipseTypeMask)
 {
-    if (testEclipse(receiver, occulter, now))
+    const Body& satellite = *task.satellite;
+    bool solar = (eclipseTypeMask & Eclipse::Solar) != 0;
+    bool lunar = (eclipseTypeMask & Eclipse::Lunar) != 0;
+
+    double t = task.startTime;
+    for (;;)
     {
-        Eclipse eclipse;
-#if 1
-        eclipse.startTime = findEclipseSpan(receiver, occulter, now, -dT);
-        eclipse.endTime = findEclipseSpan(receiver, occulter, now, dT);
-#else
-        eclipse.startTime = findEclipseStart(receiver, occulter, now, searchStep, minStep);
-        eclipse.endTime = findEclipseEnd(receiver, occulter, now, searchStep, minStep);
-#endif
-        eclipse.receiver = const_cast<Body*>(&receiver);
-        eclipse.occulter = const_cast<Body*>(&occulter);
-        eclipses.emplace_back(eclipse);
-
-        previousEclipseEndTimes[i] = eclipse.endTime;
+        double step = MaxSearchStep;
+        for (int type : { Eclipse::Solar, Eclipse::Lunar })
+        {
+            if (type == Eclipse::Solar ? !solar : !lunar)
+                continue;
+
+            const Body& receiver = type == Eclipse::Solar ? body : satellite;
+            const Body& caster = type == Eclipse::Solar ? satellite : body;
+            double margin = shadowMargin(receiver, caster, t);
+            if (margin < 0.0)
+            {
+                Eclipse eclipse = makeEclipse(receiver, caster, t);
+                if (task.first || eclipse.startTime >= task.startTime)
+                    task.eclipses.push_back(eclipse);
+
+                // Don't test again until the end of this eclipse
+                step = std::max(eclipse.endTime - t, MinSearchStep);
+                break;
+            }
+
+            step = std::min(step, searchStep(receiver, caster, t, margin));
+        }
+
+        if (t >= task.endTime)
+            break;
+        t = std::min(t + step, task.endTime);
     }
 }
 
@@ -142,6 +255,12 @@ EclipseFinder::EclipseFinder(const Body* _body,
 {
 }
 
+/*! Find the eclipses between the body and its satellites in the time
+ *  range. The search is split in chunks of time per satellite which are
+ *  run on several threads when the positions of all the bodies may be
+ *  computed concurrently. The watcher is only called from the calling
+ *  thread. The eclipses are returned sorted by start time.
+ */
 void EclipseFinder::findEclipses(double startDate,
                                  double endDate,
                                  int eclipseTypeMask,
@@ -153,53 +272,81 @@ void EclipseFinder::findEclipses(double startDate,
     if (satellites == nullptr)
         return;
 
-    // For each body, we'll need to store the time when the last eclipse ended
-    std::vector<double> previousEclipseEndTimes;
-
     // Make a list of satellites that we'll actually test for eclipses; ignore
     // spacecraft and very small objects.
-    std::vector<Body*> testBodies;
+    std::vector<const Body*> testBodies;
+    bool reentrant = body->hasReentrantPosition();
     for (int i = 0; i < satellites->getSystemSize(); i++)
     {
-        Body* obj = satellites->getBody(i);
+        const Body* obj = satellites->getBody(i);
         if (util::is_set(obj->getClassification(), EclipseObjectMask) &&
             obj->getRadius() >= body->getRadius() * MinRelativeOccluderRadius)
         {
             testBodies.push_back(obj);
-            previousEclipseEndTimes.push_back(startDate - 1.0);
+            reentrant = reentrant && obj->hasReentrantPosition();
         }
     }
 
-    if (testBodies.empty())
+    if (testBodies.empty() || endDate < startDate)
         return;
 
-    // TODO: Use a fixed step of one hour for now; we should use a binary
-    // search instead.
-    double searchStep = 1.0 / 24.0; // one hour
-
-    // Precision of eclipse duration calculation
-    double durationPrecision = 1.0 / (24.0 * 360.0); // ten seconds
+    unsigned int nThreads = reentrant
+                          ? std::clamp(std::thread::hardware_concurrency(), 1U, MaxSearchThreads)
+                          : 1U;
+    double span = endDate - startDate;
+    auto nChunks = static_cast<unsigned int>(std::max(std::ceil(span / ChunkSpan), 1.0));
 
-    for (double t = startDate; t <= endDate; t += searchStep)
+    std::vector<SearchTask> tasks;
+    tasks.reserve(testBodies.size() * nChunks);
+    for (unsigned int chunk = 0; chunk < nChunks; chunk++)
     {
-        if (watcher != nullptr)
+        for (const Body* satellite : testBodies)
         {
-            if (watcher->eclipseFinderProgressUpdate(t) == EclipseFinderWatcher::AbortOperation)
-                return;
+            tasks.push_back({ satellite,
+                              startDate + span * chunk / nChunks,
+                              chunk + 1 == nChunks ? endDate : startDate + span * (chunk + 1) / nChunks,
+                              chunk == 0,
+                              {} });
         }
+    }
 
-        for (unsigned int i = 0; i < testBodies.size(); i++)
+    std::atomic<std::size_t> nextTask{ 0 };
+    std::atomic<std::size_t> doneTasks{ 0 };
+    std::atomic<bool> aborted{ false };
+    auto worker = [this, &tasks, &nextTask, &doneTasks, &aborted, eclipseTypeMask,
+                   startDate, span](unsigned int part)
+    {
+        while (!aborted.load(std::memory_order_relaxed))
         {
-            // Only test for an eclipse if we're not in the middle of
-            // of previous one.
-            if (t <= previousEclipseEndTimes[i])
-                continue;
+            std::size_t i = nextTask.fetch_add(1, std::memory_order_relaxed);
+            if (i >= tasks.size())
+                break;
 
-            if (eclipseTypeMask & Eclipse::Solar)
-                addEclipse(*body, *testBodies[i], t, searchStep, durationPrecision, eclipses, previousEclipseEndTimes, i);
+            searchEclipses(*body, tasks[i], eclipseTypeMask);
+            std::size_t done = doneTasks.fetch_add(1, std::memory_order_relaxed) + 1;
 
-            if (eclipseTypeMask & Eclipse::Lunar)
-                addEclipse(*testBodies[i], *body, t, searchStep, durationPrecision, eclipses, previousEclipseEndTimes, i);
+            // Progress is reported from the calling thread only
+            if (part == 0 && watcher != nullptr)
+            {
+                double t = startDate + span * static_cast<double>(done) / static_cast<double>(tasks.size());
+                if (watcher->eclipseFinderProgressUpdate(t) == EclipseFinderWatcher::AbortOperation)
+                    aborted.store(true, std::memory_order_relaxed);
+            }
         }
-    }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    for (unsigned int part = 1; part < nThreads; part++)
+        threads.emplace_back(worker, part);
+    worker(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::size_t first = eclipses.size();
+    for (const SearchTask& task : tasks)
+        eclipses.insert(eclipses.end(), task.eclipses.begin(), task.eclipses.end());
+
+    std::stable_sort(eclipses.begin() + first, eclipses.end(),
+                     [](const Eclipse& a, const Eclipse& b) { return a.startTime < b.startTime; });
 }
@@ -0,0 +1,529 @@
+// eventsearch.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Search for conjunctions, occultations and transits as seen from a body.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "eventsearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celcompat/numbers.h>
+#include <celengine/body.h>
+#include <celengine/star.h>
+#include <celengine/stardb.h>
+#include <celengine/staroctree.h>
+#include <celengine/univcoord.h>
+
+namespace
+{
+
+// Bounds of the search step, which is otherwise set from the angular
+// distance to the event and the apparent motion of the objects
+constexpr double MinSearchStep = 1.0 / (24.0 * 60.0); // one minute
+constexpr double MaxSearchStep = 1.0;                  // one day
+
+// Fraction of the time needed to reach the event at the current apparent
+// speed taken as the next step
+constexpr double SearchStepSafety = 0.5;
+
+// First step used to leave an event before bisecting its start or end
+constexpr double EdgeSearchStep = 1.0 / 24.0; // one hour
+
+// Precision of event times
+constexpr double TimePrecision = 1.0 / (24.0 * 360.0); // ten seconds
+
+// Pairs of bodies are searched in chunks of about 30 days; star occultations
+// in chunks of a day, each with its own query of the star catalog
+constexpr double BodyChunkSpan = 30.0;
+constexpr double StarChunkSpan = 1.0;
+constexpr unsigned int MaxSearchThreads = 16;
+
+// Position of an object seen from the observer
+struct Apparent
+{
+    Eigen::Vector3d direction;
+    double distance;
+    double radius; // angular radius
+};
+
+Apparent
+apparentPosition(const Selection& sel, const UniversalCoord& origin, double t)
+{
+    // The catalog position of stars is good enough for their direction
+    // from the solar system, and doesn't evaluate any orbit
+    UniversalCoord position = sel.star() != nullptr
+        ? UniversalCoord::CreateLy(sel.star()->getPosition().cast<double>())
+        : sel.getPosition(t);
+
+    Apparent apparent;
+    apparent.direction = position.offsetFromKm(origin);
+    apparent.distance = apparent.direction.norm();
+    apparent.direction /= apparent.distance;
+    apparent.radius = std::asin(std::min(sel.radius() / apparent.distance, 1.0));
+    return apparent;
+}
+
+double
+angleBetween(const Eigen::Vector3d& u, const Eigen::Vector3d& v)
+{
+    return std::atan2(u.cross(v).norm(), u.dot(v));
+}
+
+// Search for the times when a pair of objects come close to each other in
+// the sky of the observer. Events are clipped to the time range, so that
+// objects which always stay close, like a planet and its moons, don't
+// stall the search.
+class PairSearch
+{
+ public:
+    PairSearch(const Body& _observer,
+               const Selection& _a,
+               const Selection& _b,
+               double _maxSeparation,
+               double _rangeBegin,
+               double _rangeEnd) :
+        observer(_observer), a(_a), b(_b), maxSeparation(_maxSeparation),
+        rangeBegin(_rangeBegin), rangeEnd(_rangeEnd)
+    {
+    }
+
+    void search(double startTime, double endTime, bool first,
+                int eventTypeMask, std::vector<CelestialEvent>& events) const;
+
+ private:
+    struct Sample
+    {
+        Apparent a;
+        Apparent b;
+        double separation;
+
+        double contactLimit() const { return a.radius + b.radius; }
+    };
+
+    Sample sample(double t) const;
+    double margin(double t) const;
+    double searchStep(double t, double margin) const;
+    double angularRate(const Selection&, double t, const Eigen::Vector3d& observerVelocity) const;
+    double findEdge(double t, double step) const;
+    double findContact(double outside, double inside) const;
+    double findPeak(double begin, double end) const;
+
+    const Body& observer;
+    Selection a;
+    Selection b;
+    double maxSeparation;
+    double rangeBegin;
+    double rangeEnd;
+};
+
+PairSearch::Sample
+PairSearch::sample(double t) const
+{
+    UniversalCoord origin = observer.getPosition(t);
+    Sample s;
+    s.a = apparentPosition(a, origin, t);
+    s.b = apparentPosition(b, origin, t);
+    s.separation = angleBetween(s.a.direction, s.b.direction);
+    return s;
+}
+
+// Angular distance to the event, negative during the event
+double
+PairSearch::margin(double t) const
+{
+    Sample s = sample(t);
+    return s.separation - std::max(maxSeparation, s.contactLimit());
+}
+
+// Return the time that can be skipped while the objects are margin
+// radians away from the event: their separation changes no faster than
+// the sum of their apparent angular speeds.
+double
+PairSearch::searchStep(double t, double margin) const
+{
+    Eigen::Vector3d observerVelocity = observer.getVelocity(t);
+    double rate = angularRate(a, t, observerVelocity) + angularRate(b, t, observerVelocity);
+    if (rate <= 0.0)
+        return MaxSearchStep;
+
+    return std::clamp(SearchStepSafety * margin / rate, MinSearchStep, MaxSearchStep);
+}
+
+double
+PairSearch::angularRate(const Selection& sel, double t, const Eigen::Vector3d& observerVelocity) const
+{
+    if (sel.body() == nullptr)
+        return 0.0;
+
+    Eigen::Vector3d offset = sel.getPosition(t).offsetFromKm(observer.getPosition(t));
+    Eigen::Vector3d velocity = sel.body()->getVelocity(t) - observerVelocity;
+    return offset.cross(velocity).norm() / offset.squaredNorm();
+}
+
+// Find the start (step < 0) or end (step > 0) of an event in progress at
+// t, by stepping out of it with growing steps then bisecting down to the
+// precision.
+double
+PairSearch::findEdge(double t, double step) const
+{
+    double inside = t;
+    double outside = std::clamp(t + step, rangeBegin, rangeEnd);
+    while (margin(outside) < 0.0)
+    {
+        if (outside == rangeBegin || outside == rangeEnd)
+            return outside;
+
+        inside = outside;
+        step = std::clamp(step * 2.0, -MaxSearchStep, MaxSearchStep);
+        outside = std::clamp(outside + step, rangeBegin, rangeEnd);
+    }
+
+    while (std::abs(outside - inside) > TimePrecision)
+    {
+        double mid = 0.5 * (inside + outside);
+        if (margin(mid) < 0.0)
+            inside = mid;
+        else
+            outside = mid;
+    }
+
+    return outside;
+}
+
+// Find the contact of the discs between a time when they are apart and a
+// time when they overlap.
+double
+PairSearch::findContact(double outside, double inside) const
+{
+    if (Sample s = sample(outside); s.separation < s.contactLimit())
+        return outside;
+
+    while (std::abs(outside - inside) > TimePrecision)
+    {
+        double mid = 0.5 * (inside + outside);
+        Sample s = sample(mid);
+        if (s.separation < s.contactLimit())
+            inside = mid;
+        else
+            outside = mid;
+    }
+
+    return outside;
+}
+
+// Golden section search for the smallest separation in the time range
+double
+PairSearch::findPeak(double begin, double end) const
+{
+    constexpr double invPhi = 0.6180339887498949;
+
+    double t0 = end - invPhi * (end - begin);
+    double t1 = begin + invPhi * (end - begin);
+    double s0 = sample(t0).separation;
+    double s1 = sample(t1).separation;
+    while (end - begin > TimePrecision)
+    {
+        if (s0 < s1)
+        {
+            end = t1;
+            t1 = t0;
+            s1 = s0;
+            t0 = end - invPhi * (end - begin);
+            s0 = sample(t0).separation;
+        }
+        else
+        {
+            begin = t0;
+            t0 = t1;
+            s0 = s1;
+            t1 = begin + invPhi * (end - begin);
+            s1 = sample(t1).separation;
+        }
+    }
+
+    return 0.5 * (begin + end);
+}
+
+// Search for the events over the time range. An event already in progress
+// at the start of the range is left to the previous range, which sees it
+// start, unless this is the first range.
+void
+PairSearch::search(double startTime, double endTime, bool first,
+                   int eventTypeMask, std::vector<CelestialEvent>& events) const
+{
+    double t = startTime;
+    for (;;)
+    {
+        double m = margin(t);
+        double step;
+        if (m < 0.0)
+        {
+            double begin = findEdge(t, -EdgeSearchStep);
+            double end = findEdge(t, EdgeSearchStep);
+
+            CelestialEvent event;
+            event.peakTime = findPeak(begin, end);
+            Sample peak = sample(event.peakTime);
+            bool aInFront = peak.a.distance < peak.b.distance;
+            event.foreground = aInFront ? a : b;
+            event.background = aInFront ? b : a;
+            event.separation = peak.separation;
+            if (peak.separation < peak.contactLimit())
+            {
+                const Apparent& fg = aInFront ? peak.a : peak.b;
+                const Apparent& bg = aInFront ? peak.b : peak.a;
+                event.type = fg.radius >= bg.radius ? CelestialEvent::Occultation : CelestialEvent::Transit;
+                event.startTime = findContact(begin, event.peakTime);
+                event.endTime = findContact(end, event.peakTime);
+            }
+            else
+            {
+                event.type = CelestialEvent::Conjunction;
+                event.startTime = begin;
+                event.endTime = end;
+            }
+
+            if ((first || begin >= startTime) && (eventTypeMask & event.type) != 0)
+                events.push_back(event);
+
+            step = std::max(end - t, MinSearchStep);
+        }
+        else
+        {
+            step = searchStep(t, m);
+        }
+
+        if (t >= endTime)
+            break;
+        t = std::min(t + step, endTime);
+    }
+}
+
+// Collect the stars within a cone
+class ConeStarHandler : public celestia::engine::StarHandler
+{
+ public:
+    ConeStarHandler(const Eigen::Vector3d& _origin,
+                    const Eigen::Vector3d& _axis,
+                    double _halfAngle) :
+        origin(_origin), axis(_axis), cosHalfAngle(std::cos(_halfAngle))
+    {
+    }
+
+    void process(const Star& star, float /*distance*/, float /*appMag*/) override
+    {
+        Eigen::Vector3d direction = (star.getPosition().cast<double>() - origin).normalized();
+        if (direction.dot(axis) >= cosHalfAngle)
+            found.push_back(&star);
+    }
+
+    std::vector<const Star*> found;
+
+ private:
+    Eigen::Vector3d origin;
+    Eigen::Vector3d axis;
+    double cosHalfAngle;
+};
+
+// Run task(i) for i = 0 to nTasks - 1 on nThreads threads, including the
+// calling thread, which reports the progress to the watcher after each of
+// its tasks.
+template<typename F>
+void
+runTasks(std::size_t nTasks, unsigned int nThreads,
+         double startDate, double endDate,
+         EventSearchWatcher* watcher, F&& task)
+{
+    std::atomic<std::size_t> nextTask{ 0 };
+    std::atomic<std::size_t> doneTasks{ 0 };
+    std::atomic<bool> aborted{ false };
+    auto worker = [&, nTasks, startDate, endDate, watcher](unsigned int part)
+    {
+        while (!aborted.load(std::memory_order_relaxed))
+        {
+            std::size_t i = nextTask.fetch_add(1, std::memory_order_relaxed);
+            if (i >= nTasks)
+                break;
+
+            task(i);
+            std::size_t done = doneTasks.fetch_add(1, std::memory_order_relaxed) + 1;
+
+            if (part == 0 && watcher != nullptr)
+            {
+                double t = startDate + (endDate - startDate) * static_cast<double>(done) / static_cast<double>(nTasks);
+                if (watcher->eventSearchProgressUpdate(t) == EventSearchWatcher::AbortOperation)
+                    aborted.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nThreads - 1);
+    for (unsigned int part = 1; part < nThreads; part++)
+        threads.emplace_back(worker, part);
+    worker(0);
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+unsigned int
+searchThreads(const Body& observer, const std::vector<const Body*>& bodies)
+{
+    bool reentrant = observer.hasReentrantPosition() &&
+                     std::all_of(bodies.begin(), bodies.end(),
+                                 [](const Body* body) { return body->hasReentrantPosition(); });
+    return reentrant
+        ? std::clamp(std::thread::hardware_concurrency(), 1U, MaxSearchThreads)
+        : 1U;
+}
+
+unsigned int
+chunkCount(double span, double chunkSpan)
+{
+    return static_cast<unsigned int>(std::max(std::ceil(span / chunkSpan), 1.0));
+}
+
+double
+chunkStart(double startDate, double endDate, unsigned int chunk, unsigned int nChunks)
+{
+    return chunk == nChunks ? endDate : startDate + (endDate - startDate) * chunk / nChunks;
+}
+
+void
+sortEvents(std::vector<CelestialEvent>& events, std::size_t first)
+{
+    std::stable_sort(events.begin() + first, events.end(),
+                     [](const CelestialEvent& e0, const CelestialEvent& e1) { return e0.peakTime < e1.peakTime; });
+}
+
+} // end unnamed namespace
+
+EventSearch::EventSearch(const Body* _observer,
+                         const StarDatabase* _stars,
+                         EventSearchWatcher* _watcher) :
+    observer(_observer),
+    stars(_stars),
+    watcher(_watcher)
+{
+}
+
+void
+EventSearch::findBodyEvents(const std::vector<const Body*>& bodies,
+                            double startDate,
+                            double endDate,
+                            double maxSeparation,
+                            int eventTypeMask,
+                            std::vector<CelestialEvent>& events) const
+{
+    if (endDate < startDate)
+        return;
+
+    std::vector<std::pair<const Body*, const Body*>> pairs;
+    for (std::size_t i = 0; i < bodies.size(); i++)
+    {
+        for (std::size_t j = i + 1; j < bodies.size(); j++)
+        {
+            if (bodies[i] != observer && bodies[j] != observer && bodies[i] != bodies[j])
+                pairs.emplace_back(bodies[i], bodies[j]);
+        }
+    }
+
+    if (pairs.empty())
+        return;
+
+    // Tasks are ordered by chunk first so that the progress follows time
+    unsigned int nChunks = chunkCount(endDate - startDate, BodyChunkSpan);
+    std::vector<std::vector<CelestialEvent>> results(pairs.size() * nChunks);
+    auto task = [&](std::size_t i)
+    {
+        auto chunk = static_cast<unsigned int>(i / pairs.size());
+        const auto& [a, b] = pairs[i % pairs.size()];
+        PairSearch search(*observer, Selection(const_cast<Body*>(a)), Selection(const_cast<Body*>(b)),
+                          maxSeparation, startDate, endDate);
+        search.search(chunkStart(startDate, endDate, chunk, nChunks),
+                      chunkStart(startDate, endDate, chunk + 1, nChunks),
+                      chunk == 0, eventTypeMask, results[i]);
+    };
+
+    runTasks(results.size(), searchThreads(*observer, bodies), startDate, endDate, watcher, task);
+
+    std::size_t first = events.size();
+    for (const auto& result : results)
+        events.insert(events.end(), result.begin(), result.end());
+    sortEvents(events, first);
+}
+
+void
+EventSearch::findStarOccultations(const std::vector<const Body*>& occulters,
+                                  double startDate,
+                                  double endDate,
+                                  float faintestMag,
+                                  std::vector<CelestialEvent>& events) const
+{
+    if (stars == nullptr || occulters.empty() || endDate < startDate)
+        return;
+
+    unsigned int nChunks = chunkCount(endDate - startDate, StarChunkSpan);
+    std::vector<std::vector<CelestialEvent>> results(occulters.size() * nChunks);
+    auto task = [&](std::size_t i)
+    {
+        auto chunk = static_cast<unsigned int>(i / occulters.size());
+        const Body* occulter = occulters[i % occulters.size()];
+        if (occulter == observer)
+            return;
+
+        Selection sel(const_cast<Body*>(occulter));
+        double t0 = chunkStart(startDate, endDate, chunk, nChunks);
+        double t1 = chunkStart(startDate, endDate, chunk + 1, nChunks);
+        double tMid = 0.5 * (t0 + t1);
+
+        // The stars which may be occulted are within a cone around the
+        // path of the occulter in the sky over the chunk
+        Apparent p0 = apparentPosition(sel, observer->getPosition(t0), t0);
+        Apparent p1 = apparentPosition(sel, observer->getPosition(t1), t1);
+        Apparent pMid = apparentPosition(sel, observer->getPosition(tMid), tMid);
+        double halfAngle = 1.5 * std::max(angleBetween(pMid.direction, p0.direction),
+                                          angleBetween(pMid.direction, p1.direction)) +
+                           std::max({ p0.radius, p1.radius, pMid.radius }) + 1.0e-4;
+        // Bodies sweeping that much of the sky in a chunk are too close to
+        // the observer for their occultations to be of interest
+        if (halfAngle >= 0.45 * celestia::numbers::pi)
+            return;
+
+        Eigen::Vector3d origin = observer->getPosition(tMid).toLy();
+        Eigen::Quaternionf rotation;
+        rotation.setFromTwoVectors(-Eigen::Vector3f::UnitZ(), pMid.direction.cast<float>());
+
+        ConeStarHandler handler(origin, pMid.direction, halfAngle);
+        stars->findVisibleStars(handler, origin.cast<float>(), rotation.conjugate(),
+                                static_cast<float>(2.0 * halfAngle), 1.0f, faintestMag);
+
+        for (const Star* star : handler.found)
+        {
+            PairSearch search(*observer, sel, Selection(const_cast<Star*>(star)), 0.0, startDate, endDate);
+            search.search(t0, t1, chunk == 0, CelestialEvent::Occultation, results[i]);
+        }
+    };
+
+    runTasks(results.size(), searchThreads(*observer, occulters), startDate, endDate, watcher, task);
+
+    std::size_t first = events.size();
+    for (const auto& result : results)
+        events.insert(events.end(), result.begin(), result.end());
+    sortEvents(events, first);
+}
@@ -0,0 +1,100 @@
+// eventsearch.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Search for conjunctions, occultations and transits as seen from a body.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <vector>
+
+#include <celengine/selection.h>
+
+class Body;
+class StarDatabase;
+
+
+struct CelestialEvent
+{
+    // values must be 2^n
+    enum Type
+    {
+        Conjunction = 0x01,
+        Occultation = 0x02,
+        Transit     = 0x04,
+    };
+
+    Type type{ Conjunction };
+
+    // The nearer and the farther object as seen from the observer
+    Selection foreground;
+    Selection background;
+
+    // For occultations and transits, the first and last contacts of the
+    // discs; for conjunctions, the span within the maximum separation
+    double startTime{ 0.0 };
+    double endTime{ 0.0 };
+
+    // Time and value of the smallest angular separation in radians
+    double peakTime{ 0.0 };
+    double separation{ 0.0 };
+};
+
+
+class EventSearchWatcher
+{
+ public:
+    enum Status
+    {
+        ContinueOperation = 0,
+        AbortOperation = 1,
+    };
+
+    virtual Status eventSearchProgressUpdate(double t) = 0;
+    virtual ~EventSearchWatcher() = default;
+};
+
+
+/*! Search for events between objects as seen from the center of an
+ *  observer body. A coarse scan steps through time as fast as the
+ *  apparent motion of the objects allows without missing an approach,
+ *  then the extent and the peak of each event are refined. The search is
+ *  split between threads by pairs of objects and chunks of time when the
+ *  positions of all the bodies may be computed concurrently. The watcher
+ *  is only called from the calling thread. Events are returned sorted by
+ *  peak time.
+ */
+class EventSearch
+{
+ public:
+    EventSearch(const Body* observer,
+                const StarDatabase* stars,
+                EventSearchWatcher* = nullptr);
+
+    // Find the events between each pair of bodies: conjunctions closer
+    // than maxSeparation radians, and occultations and transits.
+    void findBodyEvents(const std::vector<const Body*>& bodies,
+                        double startDate,
+                        double endDate,
+                        double maxSeparation,
+                        int eventTypeMask,
+                        std::vector<CelestialEvent>& events) const;
+
+    // Find the occultations of stars brighter than faintestMag by the
+    // occulters.
+    void findStarOccultations(const std::vector<const Body*>& occulters,
+                              double startDate,
+                              double endDate,
+                              float faintestMag,
+                              std::vector<CelestialEvent>& events) const;
+
+ private:
+    const Body* observer;
+    const StarDatabase* stars;
+    EventSearchWatcher* watcher;
+};
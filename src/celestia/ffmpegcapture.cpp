@@ -7,23 +7,71 @@ extern "C"
 {
 #include <libavcodec/avcodec.h>
 #include <libavutil/timestamp.h>
+#include <libavutil/hwcontext.h>
 #include <libavutil/pixdesc.h>
 #include <libavutil/opt.h>
 #include <libavformat/avformat.h>
 #include <libswscale/swscale.h>
 }
 
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <fmt/format.h>
 
 #include <celengine/render.h>
 #include <celimage/pixelformat.h>
+#include <celrender/framereadback.h>
 
 using namespace std;
 using namespace celestia;
 
+#if (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 10, 100)) // ffmpeg >= 4.0
+#define USE_HW_ENCODER 1
+#endif
+
+namespace
+{
+// Maximum number of captured frames waiting for the encoder; when the
+// encoder falls further behind, capturing blocks until it catches up
+constexpr std::size_t MaxQueuedFrames = 4;
+
+#ifdef USE_HW_ENCODER
+struct HardwareEncoder
+{
+    std::string_view name;    // name used in the configuration file
+    AVHWDeviceType   device;
+    AVPixelFormat    format;  // format of the frames on the device
+    const char      *suffix;  // suffix of the libav encoder names
+};
+
+constexpr HardwareEncoder hardwareEncoders[] =
+{
+    { "nvenc",        AV_HWDEVICE_TYPE_CUDA,         AV_PIX_FMT_CUDA,         "nvenc"        },
+    { "vaapi",        AV_HWDEVICE_TYPE_VAAPI,        AV_PIX_FMT_VAAPI,        "vaapi"        },
+    { "qsv",          AV_HWDEVICE_TYPE_QSV,          AV_PIX_FMT_QSV,          "qsv"          },
+    { "videotoolbox", AV_HWDEVICE_TYPE_VIDEOTOOLBOX, AV_PIX_FMT_VIDEOTOOLBOX, "videotoolbox" },
+};
+
+// all of the hardware encoders accept NV12 uploads
+constexpr AVPixelFormat HardwareUploadFormat = AV_PIX_FMT_NV12;
+constexpr int HardwareFramePoolSize = 20;
+#endif
+}
+
 // a wrapper around a single output AVStream
+//
+// Frames are read back from the framebuffer through a ring of pixel buffer
+// objects, so that the copy of a frame overlaps rendering of the following
+// ones. Retired frames are handed to an encoder thread which converts,
+// encodes and muxes them while the next frame is rendered.
 class FFMPEGCapturePrivate
 {
     FFMPEGCapturePrivate() = default;
@@ -33,25 +81,48 @@ class FFMPEGCapturePrivate
     bool addStream(int w, int h, float fps);
     bool openVideo();
     bool start();
-    bool writeVideoFrame(bool = false);
+    bool captureFrame();
     void finish();
     void setVideoCodec(int);
 
     bool isSupportedPixelFormat(enum AVPixelFormat) const;
-
+    const AVCodec *findHardwareEncoder();
+    bool initHardwareFrames();
+
+    bool retireFrame();
+    void runEncoder();
+    void stopEncoder();
+    bool encodeFrame(const std::uint8_t* pixels);
+    bool writeVideoFrame(AVFrame*);
     int writePacket();
 
     AVStream        *st       { nullptr };
     AVFrame         *frame    { nullptr };
-    AVFrame         *tmpfr    { nullptr };
     AVCodecContext  *enc      { nullptr };
     AVFormatContext *oc       { nullptr };
     const AVCodec   *vc       { nullptr };
     AVPacket        *pkt      { nullptr };
     SwsContext      *swsc     { nullptr };
+    // hardware encoding device and the frame uploaded to it
+    AVBufferRef     *hwDevice { nullptr };
+    AVFrame         *hwFrame  { nullptr };
+    AVPixelFormat   hwFormat  { AV_PIX_FMT_NONE };
 
     const Renderer  *renderer { nullptr };
 
+    std::unique_ptr<render::FrameReadback> readback;
+
+    // encoder thread and the frames queued for it
+    std::thread     encoder;
+    std::mutex      queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<std::vector<std::uint8_t>> queue;
+    std::vector<std::vector<std::uint8_t>> spareBuffers;
+    bool            stopping  { false   };
+    std::atomic<bool> failed  { false   };
+
+    // number of frames captured so far, including those not yet encoded
+    int             frameCount { 0      };
     // pts of the next frame that will be generated
     int64_t         nextPts   { 0       };
     // requested bitrate
@@ -65,6 +136,7 @@ class FFMPEGCapturePrivate
 
     fs::path        filename;
     std::string     vc_options;
+    std::string     hwEncoder;
 
  public:
 #if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 10, 100)) // ffmpeg < 4.0
@@ -112,6 +184,72 @@ bool FFMPEGCapturePrivate::isSupportedPixelFormat(enum AVPixelFormat format) con
     return false;
 }
 
+// find the hardware encoder for vc_id named by hwEncoder and open its
+// device; return nullptr to fall back to the software encoder
+const AVCodec *FFMPEGCapturePrivate::findHardwareEncoder()
+{
+#ifdef USE_HW_ENCODER
+    for (const auto &hw : hardwareEncoders)
+    {
+        if (hw.name != hwEncoder)
+            continue;
+
+        auto name = fmt::format("{}_{}", avcodec_get_name(vc_id), hw.suffix);
+        const AVCodec *codec = avcodec_find_encoder_by_name(name.c_str());
+        if (codec == nullptr)
+        {
+            fmt::print("Hardware encoder {} isn't found, using software encoding\n", name);
+            return nullptr;
+        }
+
+        if (av_hwdevice_ctx_create(&hwDevice, hw.device, nullptr, nullptr, 0) < 0)
+        {
+            fmt::print("Failed to open the {} device, using software encoding\n", hwEncoder);
+            return nullptr;
+        }
+
+        hwFormat = hw.format;
+        return codec;
+    }
+
+    fmt::print("Unknown hardware encoder {}\n", hwEncoder);
+#endif
+    return nullptr;
+}
+
+// create the pool of device frames the hardware encoder reads from
+bool FFMPEGCapturePrivate::initHardwareFrames()
+{
+#ifdef USE_HW_ENCODER
+    AVBufferRef *frames = av_hwframe_ctx_alloc(hwDevice);
+    if (frames == nullptr)
+    {
+        cout << "Unable to alloc hardware frames context\n";
+        return false;
+    }
+
+    auto *ctx = reinterpret_cast<AVHWFramesContext*>(frames->data);
+    ctx->format            = hwFormat;
+    ctx->sw_format         = HardwareUploadFormat;
+    ctx->width             = enc->width;
+    ctx->height            = enc->height;
+    ctx->initial_pool_size = HardwareFramePoolSize;
+
+    if (av_hwframe_ctx_init(frames) < 0)
+    {
+        cout << "Failed to init hardware frames context\n";
+        av_buffer_unref(&frames);
+        return false;
+    }
+
+    // the codec context takes ownership of the reference
+    enc->hw_frames_ctx = frames;
+    return true;
+#else
+    return false;
+#endif
+}
+
 #if AVCODEC_DEBUG
 static const char* to_str(AVOptionType type)
 {
@@ -210,7 +348,10 @@ bool FFMPEGCapturePrivate::addStream(int width, int height, float fps)
     this->fps = fps;
 
     // find the encoder
-    vc = avcodec_find_encoder(vc_id);
+    if (!hwEncoder.empty())
+        vc = findHardwareEncoder();
+    if (vc == nullptr)
+        vc = avcodec_find_encoder(vc_id);
     if (vc == nullptr)
     {
         cout << "Video codec isn't found\n";
@@ -263,7 +404,15 @@ bool FFMPEGCapturePrivate::addStream(int width, int height, float fps)
     enc->gop_size  = 12; // emit one intra frame every twelve frames at most
 
     // find a best pixel format to convert to from `format`
-    if (isSupportedPixelFormat(AV_PIX_FMT_YUV420P))
+    if (hwDevice != nullptr)
+    {
+        // frames are converted to the upload format and then copied to
+        // the device
+        enc->pix_fmt = hwFormat;
+        if (!initHardwareFrames())
+            return false;
+    }
+    else if (isSupportedPixelFormat(AV_PIX_FMT_YUV420P))
     {
         enc->pix_fmt = AV_PIX_FMT_YUV420P;
     }
@@ -319,6 +468,10 @@ bool FFMPEGCapturePrivate::start()
         return false;
     }
 
+    readback = std::make_unique<render::FrameReadback>(enc->width, enc->height,
+                                                       renderer->getPreferredCaptureFormat());
+    encoder = std::thread(&FFMPEGCapturePrivate::runEncoder, this);
+
     return true;
 }
 
@@ -353,7 +506,11 @@ bool FFMPEGCapturePrivate::openVideo()
         return false;
     }
 
+#ifdef USE_HW_ENCODER
+    frame->format = hwDevice != nullptr ? HardwareUploadFormat : enc->pix_fmt;
+#else
     frame->format = enc->pix_fmt;
+#endif
     frame->width  = enc->width;
     frame->height = enc->height;
 
@@ -364,36 +521,24 @@ bool FFMPEGCapturePrivate::openVideo()
         return false;
     }
 
-    if (enc->pix_fmt != format)
+    if (hwDevice != nullptr && (hwFrame = av_frame_alloc()) == nullptr)
+    {
+        cout << "Failed to allocate hardware frame\n";
+        return false;
+    }
+
+    if (frame->format != format)
     {
         // as we only grab a RGB24 picture, we must convert it
         // to the codec pixel format if needed
         swsc = sws_getContext(enc->width, enc->height, format,
-                              enc->width, enc->height, enc->pix_fmt,
+                              enc->width, enc->height, static_cast<AVPixelFormat>(frame->format),
                               SWS_BITEXACT, nullptr, nullptr, nullptr);
         if (swsc == nullptr)
         {
             cout << "Failed to allocate SWS context\n";
             return false;
         }
-
-        // allocate and init a temporary frame
-        if((tmpfr = av_frame_alloc()) == nullptr)
-        {
-            cout << "Failed to allocate temp frame\n";
-            return false;
-        }
-
-        tmpfr->format = format;
-        tmpfr->width  = enc->width;
-        tmpfr->height = enc->height;
-
-        // allocate the buffers for the frame data
-        if (av_frame_get_buffer(tmpfr, 32) < 0)
-        {
-            cout << "Failed to allocate temp frame buffer\n";
-            return false;
-        }
     }
 
     // copy the stream parameters to the muxer
@@ -406,52 +551,162 @@ bool FFMPEGCapturePrivate::openVideo()
     return true;
 }
 
-static void captureImage(AVFrame *pict, int width, int height, const Renderer *r)
+// start reading back the current frame; called from the rendering thread
+bool FFMPEGCapturePrivate::captureFrame()
 {
+    if (failed)
+        return false;
+
+    if (readback->full() && !retireFrame())
+        return false;
+
     int x, y, w, h;
-    r->getViewport(&x, &y, &w, &h);
+    renderer->getViewport(&x, &y, &w, &h);
+
+    x += (w - enc->width) / 2;
+    y += (h - enc->height) / 2;
+    if (!readback->read(x, y))
+    {
+        cout << "Failed to read the frame\n";
+        return false;
+    }
 
-    x += (w - width) / 2;
-    y += (h - height) / 2;
-    r->captureFrame(x, y, width, height,
-                    r->getPreferredCaptureFormat(),
-                    pict->data[0]);
+    frameCount++;
+    return true;
 }
 
-// encode one video frame and send it to the muxer
-// return 1 when encoding is finished, 0 otherwise
-bool FFMPEGCapturePrivate::writeVideoFrame(bool finalize)
+// wait for the oldest frame read back and queue it for the encoder
+bool FFMPEGCapturePrivate::retireFrame()
 {
-    AVFrame *frame = finalize ? nullptr : this->frame;
-    const int bytesPerPixel = hasAlpha ? 4 : 3;
+    const int pitch = (hasAlpha ? 4 : 3) * enc->width;
 
-    // check if we want to generate more frames
-    if (!finalize)
+    std::vector<std::uint8_t> pixels;
     {
-        // when we pass a frame to the encoder, it may keep a reference to it
-        // internally; make sure we do not overwrite it here
-        if (av_frame_make_writable(frame) < 0)
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (!spareBuffers.empty())
         {
-            cout << "Failed to make the frame writable\n";
-            return false;
+            pixels = std::move(spareBuffers.back());
+            spareBuffers.pop_back();
+        }
+    }
+    pixels.resize(static_cast<std::size_t>(pitch) * enc->height);
+
+    if (!readback->retire(pixels.data(), pitch))
+    {
+        cout << "Failed to map the frame\n";
+        failed = true;
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueChanged.wait(lock, [this] { return queue.size() < MaxQueuedFrames || failed; });
+    if (failed)
+        return false;
+
+    queue.push_back(std::move(pixels));
+    queueChanged.notify_all();
+    return true;
+}
+
+void FFMPEGCapturePrivate::runEncoder()
+{
+    for (;;)
+    {
+        std::vector<std::uint8_t> pixels;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueChanged.wait(lock, [this] { return !queue.empty() || stopping; });
+            if (queue.empty())
+                return;
+
+            pixels = std::move(queue.front());
+            queue.pop_front();
+            queueChanged.notify_all();
         }
 
-        if (enc->pix_fmt != format)
+        if (!encodeFrame(pixels.data()))
         {
-            captureImage(tmpfr, enc->width, enc->height, renderer);
-            // we need to compute the correct line width of our source data
-            const int linesize = bytesPerPixel * enc->width;
-            sws_scale(swsc, tmpfr->data, &linesize, 0, enc->height,
-                      frame->data, frame->linesize);
+            std::unique_lock<std::mutex> lock(queueMutex);
+            failed = true;
+            queue.clear();
+            queueChanged.notify_all();
+            return;
         }
-        else
+
+        std::unique_lock<std::mutex> lock(queueMutex);
+        spareBuffers.push_back(std::move(pixels));
+    }
+}
+
+// let the encoder thread finish the queued frames and wait for it
+void FFMPEGCapturePrivate::stopEncoder()
+{
+    if (!encoder.joinable())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueChanged.notify_all();
+    encoder.join();
+}
+
+// convert a frame captured from the framebuffer and encode it; called from
+// the encoder thread
+bool FFMPEGCapturePrivate::encodeFrame(const std::uint8_t* pixels)
+{
+    // when we pass a frame to the encoder, it may keep a reference to it
+    // internally; make sure we do not overwrite it here
+    if (av_frame_make_writable(frame) < 0)
+    {
+        cout << "Failed to make the frame writable\n";
+        return false;
+    }
+
+    // we need to compute the correct line width of our source data
+    const int linesize = (hasAlpha ? 4 : 3) * enc->width;
+    if (swsc != nullptr)
+    {
+        sws_scale(swsc, &pixels, &linesize, 0, enc->height,
+                  frame->data, frame->linesize);
+    }
+    else
+    {
+        for (int row = 0; row < enc->height; row++)
+        {
+            std::memcpy(frame->data[0] + static_cast<std::ptrdiff_t>(row) * frame->linesize[0],
+                        pixels + static_cast<std::ptrdiff_t>(row) * linesize,
+                        linesize);
+        }
+    }
+
+    frame->pts = nextPts++;
+
+#ifdef USE_HW_ENCODER
+    if (hwDevice != nullptr)
+    {
+        // upload the converted frame to the device
+        av_frame_unref(hwFrame);
+        if (av_hwframe_get_buffer(enc->hw_frames_ctx, hwFrame, 0) < 0 ||
+            av_hwframe_transfer_data(hwFrame, frame, 0) < 0)
         {
-            captureImage(frame, enc->width, enc->height, renderer);
+            cout << "Failed to upload the frame to the device\n";
+            return false;
         }
 
-        frame->pts = nextPts++;
+        hwFrame->pts = frame->pts;
+        return writeVideoFrame(hwFrame);
     }
+#endif
+
+    return writeVideoFrame(frame);
+}
 
+// encode one video frame and send it to the muxer; a null frame flushes
+// the encoder
+bool FFMPEGCapturePrivate::writeVideoFrame(AVFrame *frame)
+{
 #if (LIBAVCODEC_VERSION_INT < AV_VERSION_INT(58, 133, 100))
     av_init_packet(pkt);
 #endif
@@ -488,7 +743,16 @@ bool FFMPEGCapturePrivate::writeVideoFrame(bool finalize)
 
 void FFMPEGCapturePrivate::finish()
 {
-    writeVideoFrame(true);
+    // hand the frames still being read back to the encoder
+    while (!readback->empty())
+    {
+        if (!retireFrame())
+            break;
+    }
+    stopEncoder();
+    readback.reset();
+
+    writeVideoFrame(nullptr);
 
     // Write the trailer, if any. The trailer must be written before you
     // close the CodecContexts open when you wrote the header; otherwise
@@ -502,10 +766,11 @@ void FFMPEGCapturePrivate::finish()
 
 FFMPEGCapturePrivate::~FFMPEGCapturePrivate()
 {
+    stopEncoder();
     avcodec_free_context(&enc);
     av_frame_free(&frame);
-    if (tmpfr != nullptr)
-        av_frame_free(&tmpfr);
+    av_frame_free(&hwFrame);
+    av_buffer_unref(&hwDevice);
     avformat_free_context(oc);
     av_packet_free(&pkt);
 }
@@ -526,7 +791,7 @@ FFMPEGCapture::~FFMPEGCapture()
 
 int FFMPEGCapture::getFrameCount() const
 {
-    return d->nextPts;
+    return d->frameCount;
 }
 
 int FFMPEGCapture::getWidth() const
@@ -573,7 +838,7 @@ bool FFMPEGCapture::end()
 
 bool FFMPEGCapture::captureFrame()
 {
-    return d->capturing && d->writeVideoFrame();
+    return d->capturing && d->captureFrame();
 }
 
 void FFMPEGCapture::setVideoCodec(AVCodecID vc_id)
@@ -590,3 +855,8 @@ void FFMPEGCapture::setEncoderOptions(const std::string &s)
 {
     d->vc_options = s;
 }
+
+void FFMPEGCapture::setHardwareEncoder(const std::string &s)
+{
+    d->hwEncoder = s;
+}
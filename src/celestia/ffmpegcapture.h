@@ -32,6 +32,10 @@ public:
     void setVideoCodec(AVCodecID);
     void setBitRate(int64_t);
     void setEncoderOptions(const std::string&);
+    // Encode on the GPU through the named libav hardware encoder family:
+    // nvenc, vaapi, qsv or videotoolbox. An empty name, or one which isn't
+    // available, selects the software encoder.
+    void setHardwareEncoder(const std::string&);
 
 protected:
     void recordingStatusUpdated(bool) override { /* no action necessary */ };
@@ -103,7 +103,10 @@ captureMovie(const char* filename, const int resolution[], float fps,
     movieCapture->setVideoCodec(codec);
     movieCapture->setBitRate(bitrate);
     if (codec == AV_CODEC_ID_H264)
+    {
         movieCapture->setEncoderOptions(app->core->getConfig()->x264EncoderOptions);
+        movieCapture->setHardwareEncoder(app->core->getConfig()->videoHardwareEncoder);
+    }
     else
         movieCapture->setEncoderOptions(app->core->getConfig()->ffvhEncoderOptions);
 
@@ -48,12 +48,15 @@ glDrawFrame(AppData* app)
 
     if (app->bReady)
     {
-        app->core->draw();
+        // The last frame stays on screen when nothing changed
+        if (app->core->draw())
+        {
 #ifdef GTKGLEXT
-        gdk_gl_drawable_swap_buffers(GDK_GL_DRAWABLE(gldrawable));
+            gdk_gl_drawable_swap_buffers(GDK_GL_DRAWABLE(gldrawable));
 #else
-        gtk_egl_drawable_swap_buffers(app->glArea);
+            gtk_egl_drawable_swap_buffers(app->glArea);
 #endif
+        }
     }
 
 #ifdef GTKGLEXT
@@ -0,0 +1,561 @@
+// benchmain.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Offscreen frame benchmark which replays a script with fixed time steps
+// and reports the frame times as JSON.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <celcompat/charconv.h>
+#include <celcompat/filesystem.h>
+#include <celengine/glsupport.h>
+#include <celengine/gpuframetimer.h>
+#include <celengine/render.h>
+#include <celestia/celestiacore.h>
+#include <celestia/configfile.h>
+#include <celutil/gettext.h>
+#include <celutil/memoryreport.h>
+#include "offscreencontext.h"
+
+namespace celestia::headless
+{
+
+namespace
+{
+
+using clock = std::chrono::steady_clock;
+
+// Calls of operator new made by all threads; see the replacement operators
+// at the end of the file
+std::atomic<std::uint64_t> allocationCount{ 0 };
+std::atomic<std::uint64_t> allocatedBytes{ 0 };
+
+class BenchAlerter : public CelestiaCore::Alerter
+{
+public:
+    void fatalError(const std::string& msg) override
+    {
+        fmt::print(stderr, "{}\n", msg);
+    }
+};
+
+struct Options
+{
+    int width{ 1920 };
+    int height{ 1080 };
+    double fps{ 60.0 };
+    unsigned int warmupFrames{ 60 };
+    unsigned int frames{ 600 };
+    fs::path configFile;
+    fs::path outputFile;
+    fs::path script;
+    fs::path traceFile;
+    std::string name;
+    bool memoryReport{ false };
+};
+
+// Per-frame samples, in seconds, except for the allocations
+struct FrameSamples
+{
+    std::vector<double> cpu;
+    std::vector<double> simulation;
+    std::vector<double> gpu;
+    std::array<std::vector<double>, Renderer::RenderStageCount> stages;
+    std::vector<double> allocations;
+    std::vector<double> allocatedBytes;
+};
+
+template<typename T>
+bool
+parseNumber(std::string_view args, T& value)
+{
+    auto result = compat::from_chars(args.data(), args.data() + args.size(), value);
+    return result.ec == std::errc{} && result.ptr == args.data() + args.size();
+}
+
+bool
+parseSize(std::string_view s, int& width, int& height)
+{
+    auto x = s.find('x');
+    return x != std::string_view::npos &&
+           parseNumber(s.substr(0, x), width) &&
+           parseNumber(s.substr(x + 1), height) &&
+           width > 0 && height > 0;
+}
+
+void
+printUsage()
+{
+    fmt::print(stderr,
+               "Usage: celestia-bench [--size WIDTHxHEIGHT] [--conf FILE] [--dir DIR] [--fps RATE]\n"
+               "                      [--warmup FRAMES] [--frames FRAMES] [--name NAME] [--output FILE]\n"
+               "                      [--trace FILE] [--memory-report] SCRIPT\n");
+}
+
+std::string
+jsonString(std::string_view s)
+{
+    std::string result("\"");
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            fmt::format_to(std::back_inserter(result), "\\u{:04x}", static_cast<unsigned int>(c));
+        }
+        else
+        {
+            result += c;
+        }
+    }
+
+    result += '"';
+    return result;
+}
+
+std::string_view
+glString(GLenum name)
+{
+    const auto* s = reinterpret_cast<const char*>(glGetString(name));
+    return s == nullptr ? std::string_view{} : std::string_view(s);
+}
+
+// Nearest rank percentile of sorted samples
+double
+percentile(const std::vector<double>& sorted, double p)
+{
+    auto rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+    return sorted[std::max(rank, std::size_t(1)) - 1];
+}
+
+// Statistics of the samples multiplied by scale, by default from seconds to
+// milliseconds, or null without samples
+std::string
+jsonStats(std::vector<double> samples, double scale = 1000.0)
+{
+    if (samples.empty())
+        return "null";
+
+    std::sort(samples.begin(), samples.end());
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    return fmt::format(R"({{ "samples": {}, "mean": {:.4f}, "min": {:.4f}, "p50": {:.4f}, "p90": {:.4f}, )"
+                       R"("p95": {:.4f}, "p99": {:.4f}, "max": {:.4f} }})",
+                       samples.size(),
+                       mean * scale,
+                       samples.front() * scale,
+                       percentile(samples, 0.5) * scale,
+                       percentile(samples, 0.9) * scale,
+                       percentile(samples, 0.95) * scale,
+                       percentile(samples, 0.99) * scale,
+                       samples.back() * scale);
+}
+
+// The estimated memory of each subsystem, in the order of the report
+std::string
+jsonMemory(const util::MemoryReport& report)
+{
+    std::vector<std::string_view> subsystems;
+    for (const auto& entry : report.entries())
+    {
+        if (std::find(subsystems.begin(), subsystems.end(), entry.subsystem) == subsystems.end())
+            subsystems.emplace_back(entry.subsystem);
+    }
+
+    std::string json("{ ");
+    auto out = std::back_inserter(json);
+    for (std::string_view subsystem : subsystems)
+        fmt::format_to(out, "{}: {}, ", jsonString(subsystem), report.total(subsystem));
+    fmt::format_to(out, "\"total\": {} }}", report.total());
+    return json;
+}
+
+std::string
+toJson(const Options& options, FrameSamples&& samples, const util::MemoryReport& memory)
+{
+    std::string json;
+    auto out = std::back_inserter(json);
+    fmt::format_to(out, "{{\n");
+    fmt::format_to(out, "  \"scenario\": {},\n", jsonString(options.name));
+    fmt::format_to(out, "  \"script\": {},\n", jsonString(options.script.u8string()));
+    fmt::format_to(out, "  \"width\": {},\n  \"height\": {},\n", options.width, options.height);
+    fmt::format_to(out, "  \"fps\": {},\n", options.fps);
+    fmt::format_to(out, "  \"warmup_frames\": {},\n  \"frames\": {},\n", options.warmupFrames, options.frames);
+    fmt::format_to(out, "  \"gl_vendor\": {},\n", jsonString(glString(GL_VENDOR)));
+    fmt::format_to(out, "  \"gl_renderer\": {},\n", jsonString(glString(GL_RENDERER)));
+    fmt::format_to(out, "  \"gl_version\": {},\n", jsonString(glString(GL_VERSION)));
+    fmt::format_to(out, "  \"cpu_frame_ms\": {},\n", jsonStats(std::move(samples.cpu)));
+    fmt::format_to(out, "  \"simulation_ms\": {},\n", jsonStats(std::move(samples.simulation)));
+    fmt::format_to(out, "  \"gpu_frame_ms\": {},\n", jsonStats(std::move(samples.gpu)));
+    fmt::format_to(out, "  \"stages_ms\": {{\n");
+    for (std::size_t i = 0; i < Renderer::RenderStageCount; ++i)
+    {
+        fmt::format_to(out, "    {}: {}{}\n",
+                       jsonString(Renderer::getStageName(static_cast<Renderer::RenderStage>(i))),
+                       jsonStats(std::move(samples.stages[i])),
+                       i + 1 < Renderer::RenderStageCount ? "," : "");
+    }
+    fmt::format_to(out, "  }},\n");
+    fmt::format_to(out, "  \"allocations_per_frame\": {},\n", jsonStats(std::move(samples.allocations), 1.0));
+    fmt::format_to(out, "  \"allocated_bytes_per_frame\": {},\n", jsonStats(std::move(samples.allocatedBytes), 1.0));
+    fmt::format_to(out, "  \"memory_bytes\": {}\n", jsonMemory(memory));
+    fmt::format_to(out, "}}\n");
+    return json;
+}
+
+// Render the frames with a fixed time step, so that every run draws the
+// same frames whatever the rendering speed. The CPU time of a frame runs
+// from the start of tick() to the return of draw(); the GPU time is that
+// of the commands issued by draw(). The allocations include those of the
+// loader threads made meanwhile.
+FrameSamples
+runFrames(CelestiaCore& appCore, const Options& options, engine::GPUFrameTimer* gpuTimer)
+{
+    double frameStep = 1.0 / options.fps;
+    appCore.setFixedTimeStep(frameStep);
+    Renderer* renderer = appCore.getRenderer();
+
+    for (unsigned int i = 0; i < options.warmupFrames; ++i)
+    {
+        appCore.tick(frameStep);
+        appCore.requestRedraw();
+        appCore.draw();
+    }
+    glFinish();
+
+    FrameSamples samples;
+    samples.cpu.reserve(options.frames);
+    samples.simulation.reserve(options.frames);
+    samples.gpu.reserve(options.frames);
+    for (auto& stage : samples.stages)
+        stage.reserve(options.frames);
+    samples.allocations.reserve(options.frames);
+    samples.allocatedBytes.reserve(options.frames);
+
+    renderer->setStageTimingEnabled(true);
+    for (unsigned int i = 0; i < options.frames; ++i)
+    {
+        renderer->resetStageTimes();
+        std::uint64_t allocations = allocationCount.load(std::memory_order_relaxed);
+        std::uint64_t bytes = allocatedBytes.load(std::memory_order_relaxed);
+        auto start = clock::now();
+        appCore.tick(frameStep);
+        auto ticked = clock::now();
+
+        // Frames are drawn even when the view didn't change
+        appCore.requestRedraw();
+        if (gpuTimer != nullptr)
+            gpuTimer->begin();
+        appCore.draw();
+        if (gpuTimer != nullptr)
+            gpuTimer->end();
+        auto drawn = clock::now();
+        allocations = allocationCount.load(std::memory_order_relaxed) - allocations;
+        bytes = allocatedBytes.load(std::memory_order_relaxed) - bytes;
+
+        samples.cpu.push_back(std::chrono::duration<double>(drawn - start).count());
+        samples.simulation.push_back(std::chrono::duration<double>(ticked - start).count());
+        const auto& stageTimes = renderer->getStageTimes();
+        for (std::size_t j = 0; j < stageTimes.size(); ++j)
+            samples.stages[j].push_back(stageTimes[j]);
+        samples.allocations.push_back(static_cast<double>(allocations));
+        samples.allocatedBytes.push_back(static_cast<double>(bytes));
+
+        if (gpuTimer != nullptr)
+        {
+            if (auto gpuTime = gpuTimer->result(); gpuTime.has_value())
+                samples.gpu.push_back(*gpuTime);
+        }
+    }
+    renderer->setStageTimingEnabled(false);
+
+    // Collect the GPU times of the last frames
+    glFinish();
+    if (gpuTimer != nullptr)
+    {
+        while (auto gpuTime = gpuTimer->result())
+            samples.gpu.push_back(*gpuTime);
+    }
+
+    return samples;
+}
+
+bool
+parseOptions(int argc, char** argv, Options& options, const char*& dataDir)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue)
+        {
+            if (!parseSize(argv[++i], options.width, options.height))
+                return false;
+        }
+        else if (arg == "--conf" && hasValue)
+        {
+            options.configFile = fs::absolute(fs::u8path(argv[++i]));
+        }
+        else if (arg == "--dir" && hasValue)
+        {
+            dataDir = argv[++i];
+        }
+        else if (arg == "--fps" && hasValue)
+        {
+            if (!parseNumber(std::string_view(argv[++i]), options.fps) || !(options.fps > 0.0))
+                return false;
+        }
+        else if (arg == "--warmup" && hasValue)
+        {
+            if (!parseNumber(std::string_view(argv[++i]), options.warmupFrames))
+                return false;
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            if (!parseNumber(std::string_view(argv[++i]), options.frames) || options.frames == 0)
+                return false;
+        }
+        else if (arg == "--name" && hasValue)
+        {
+            options.name = argv[++i];
+        }
+        else if (arg == "--output" && hasValue)
+        {
+            options.outputFile = fs::absolute(fs::u8path(argv[++i]));
+        }
+        else if (arg == "--trace" && hasValue)
+        {
+            options.traceFile = fs::absolute(fs::u8path(argv[++i]));
+        }
+        else if (arg == "--memory-report")
+        {
+            options.memoryReport = true;
+        }
+        else if (options.script.empty() && !arg.empty() && arg.front() != '-')
+        {
+            options.script = fs::absolute(fs::u8path(arg));
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (options.script.empty())
+        return false;
+
+    if (options.name.empty())
+        options.name = options.script.stem().u8string();
+    return true;
+}
+
+int
+benchmain(int argc, char** argv)
+{
+    CelestiaCore::initLocale();
+
+#ifdef ENABLE_NLS
+    bindtextdomain("celestia", LOCALEDIR);
+    bind_textdomain_codeset("celestia", "UTF-8");
+    bindtextdomain("celestia-data", LOCALEDIR);
+    bind_textdomain_codeset("celestia-data", "UTF-8");
+    textdomain("celestia");
+#endif
+
+    Options options;
+    const char* dataDir = std::getenv("CELESTIA_DATA_DIR");
+    if (dataDir == nullptr)
+        dataDir = CONFIG_DATA_DIR;
+
+    if (!parseOptions(argc, argv, options, dataDir))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (!fs::exists(options.script))
+    {
+        fmt::print(stderr, "Cannot open script {}\n", options.script.string());
+        return 1;
+    }
+
+    std::error_code ec;
+    fs::current_path(dataDir, ec);
+    if (ec)
+    {
+        fmt::print(stderr, "Cannot chdir to {}, probably due to improper installation\n", dataDir);
+        return 1;
+    }
+
+    OffscreenContext context;
+    if (!context.create(options.width, options.height))
+        return 2;
+
+    gl::init();
+#ifndef GL_ES
+    if (!gl::checkVersion(gl::GL_2_1))
+    {
+        fmt::print(stderr, "Celestia requires OpenGL 2.1!\n");
+        return 2;
+    }
+#endif
+
+    auto appCore = std::make_unique<CelestiaCore>();
+    appCore->setAlerter(new BenchAlerter());
+    if (!options.traceFile.empty())
+        appCore->setStartupTraceFile(options.traceFile);
+    if (!appCore->initSimulation(options.configFile))
+    {
+        fmt::print(stderr, "Could not initialize Celestia!\n");
+        return 3;
+    }
+
+    if (!appCore->initRenderer())
+    {
+        fmt::print(stderr, "Could not initialize the renderer!\n");
+        return 3;
+    }
+
+    auto* renderer = appCore->getRenderer();
+    const auto* config = appCore->getConfig();
+    renderer->setRenderFlags(Renderer::DefaultRenderFlags);
+    renderer->setShadowMapSize(config->renderDetails.ShadowMapSize);
+    renderer->setStaticStarBuffer(config->renderDetails.staticStarBuffer);
+    renderer->setSolarSystemMaxDistance(config->renderDetails.SolarSystemMaxDistance);
+
+    // The frame time governors change what is drawn from one run to the
+    // next, and measure the GPU time themselves; timer queries can't nest.
+    std::unique_ptr<engine::GPUFrameTimer> gpuTimer;
+    if (config->renderDetails.dynamicResolutionFrameTime > 0.0f ||
+        config->renderDetails.adaptiveQualityFrameTime > 0.0f)
+    {
+        fmt::print(stderr, "Dynamic resolution or adaptive quality is enabled; runs won't be comparable "
+                           "and the GPU time isn't measured\n");
+    }
+    else if (engine::GPUFrameTimer::isSupported())
+    {
+        gpuTimer = std::make_unique<engine::GPUFrameTimer>();
+    }
+
+    appCore->start();
+    appCore->resize(options.width, options.height);
+    appCore->setHudDetail(0);
+    appCore->runScript(options.script);
+
+    FrameSamples samples = runFrames(*appCore, options, gpuTimer.get());
+
+    util::MemoryReport report;
+    appCore->reportMemoryUsage(report);
+    std::string json = toJson(options, std::move(samples), report);
+
+    // The full report goes to stderr, so that the JSON output is unchanged
+    if (options.memoryReport)
+        fmt::print(stderr, "{}", report.format());
+
+    if (options.outputFile.empty())
+    {
+        fmt::print("{}", json);
+        return 0;
+    }
+
+    std::ofstream out(options.outputFile);
+    if (!out.good() || !(out << json).good())
+    {
+        fmt::print(stderr, "Unable to write {}\n", options.outputFile.string());
+        return 4;
+    }
+
+    return 0;
+}
+
+} // end unnamed namespace
+
+} // end namespace celestia::headless
+
+// Count the allocations, replacing the global operator new of the whole
+// program, including the celestia library where the platform allows it. The
+// other forms of operator new, but for the aligned ones, call these.
+void*
+operator new(std::size_t size)
+{
+    celestia::headless::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    celestia::headless::allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+
+    for (;;)
+    {
+        if (void* ptr = std::malloc(size); ptr != nullptr)
+            return ptr;
+
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void*
+operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void
+operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+int
+main(int argc, char** argv)
+{
+    return celestia::headless::benchmain(argc, argv);
+}
@@ -0,0 +1,531 @@
+// headlessmain.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Offscreen frontend which renders the frames of a job file to images,
+// using an EGL pbuffer instead of a window.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <celcompat/charconv.h>
+#include <celcompat/filesystem.h>
+#include <celengine/glsupport.h>
+#include <celengine/render.h>
+#include <celengine/simulation.h>
+#include <celestia/celestiacore.h>
+#include <celestia/configfile.h>
+#include <celimage/image.h>
+#include <celrender/framereadback.h>
+#include <celutil/filetype.h>
+#include <celutil/gettext.h>
+#include "offscreencontext.h"
+
+using celestia::engine::Image;
+using celestia::engine::PixelFormat;
+
+namespace celestia::headless
+{
+
+namespace
+{
+
+// Frames whose readback is in flight before the oldest one is mapped
+constexpr std::size_t ReadbackDepth = 3;
+// Images waiting to be written before capturing blocks
+constexpr std::size_t MaxQueuedImages = 8;
+
+class HeadlessAlerter : public CelestiaCore::Alerter
+{
+public:
+    void fatalError(const std::string& msg) override
+    {
+        fmt::print(stderr, "{}\n", msg);
+    }
+};
+
+// Reads frames back without waiting for the GPU and writes them on a
+// separate thread. Each frame is read through a FrameReadback and only
+// retired once ReadbackDepth more frames have been issued, by which time
+// the transfer has completed. Encoding and writing the images, the slowest
+// part, overlaps with the rendering of the following frames.
+class ReadbackQueue
+{
+public:
+    ReadbackQueue(int width, int height);
+    ~ReadbackQueue();
+
+    ReadbackQueue(const ReadbackQueue&) = delete;
+    ReadbackQueue& operator=(const ReadbackQueue&) = delete;
+
+    void capture(fs::path&& path);
+    // Wait until all captured frames have been written
+    void finish();
+
+private:
+    void retire();
+    void submit(Image&& image, fs::path&& path);
+    void writeImages();
+
+    int m_width;
+    int m_height;
+
+    celestia::render::FrameReadback m_readback;
+    std::deque<fs::path> m_paths;
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::pair<Image, fs::path>> m_images;
+    bool m_writing{ false };
+    bool m_stop{ false };
+    std::thread m_writer;
+};
+
+ReadbackQueue::ReadbackQueue(int width, int height) :
+    m_width(width),
+    m_height(height),
+    m_readback(width, height, PixelFormat::RGB, ReadbackDepth),
+    m_writer(&ReadbackQueue::writeImages, this)
+{
+}
+
+ReadbackQueue::~ReadbackQueue()
+{
+    finish();
+
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_condition.notify_all();
+    m_writer.join();
+}
+
+void
+ReadbackQueue::capture(fs::path&& path)
+{
+    if (m_readback.full())
+        retire();
+
+    if (m_readback.read(0, 0))
+        m_paths.push_back(std::move(path));
+    else
+        fmt::print(stderr, "Unable to capture frame {}\n", path.string());
+}
+
+void
+ReadbackQueue::retire()
+{
+    fs::path path = std::move(m_paths.front());
+    m_paths.pop_front();
+
+    Image image(PixelFormat::RGB, m_width, m_height);
+    if (m_readback.retire(image.getPixels(), image.getPitch()))
+        submit(std::move(image), std::move(path));
+    else
+        fmt::print(stderr, "Unable to read back frame {}\n", path.string());
+}
+
+void
+ReadbackQueue::submit(Image&& image, fs::path&& path)
+{
+    std::unique_lock lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_images.size() < MaxQueuedImages; });
+    m_images.emplace_back(std::move(image), std::move(path));
+    lock.unlock();
+    m_condition.notify_all();
+}
+
+void
+ReadbackQueue::finish()
+{
+    while (!m_readback.empty())
+        retire();
+
+    std::unique_lock lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_images.empty() && !m_writing; });
+}
+
+void
+ReadbackQueue::writeImages()
+{
+    std::unique_lock lock(m_mutex);
+    for (;;)
+    {
+        m_condition.wait(lock, [this] { return m_stop || !m_images.empty(); });
+        if (m_images.empty())
+            return;
+
+        auto [image, path] = std::move(m_images.front());
+        m_images.pop_front();
+        m_writing = true;
+        lock.unlock();
+        m_condition.notify_all();
+
+        if (!image.save(path, DetermineFileType(path)))
+            fmt::print(stderr, "Unable to write {}\n", path.string());
+
+        lock.lock();
+        m_writing = false;
+        m_condition.notify_all();
+    }
+}
+
+// Runs the commands of a job file. Each line holds one command:
+//
+//     url <cel url>          go to a cel:// URL
+//     script <file>          start a .cel or .celx script
+//     time <julian date>     set the simulation time (TDB)
+//     timescale <factor>     set the rate of simulation time
+//     fps <rate>             set the frame rate, in frames per second of
+//                            real time; the default is 30
+//     hud <level>            set the detail of the text overlay, 0 to hide it
+//     warmup <frames>        render frames without writing them
+//     render <frames> <pattern>
+//                            render frames and write them to the files
+//                            named by the fmt pattern, which is given the
+//                            frame number, e.g. frames/{:05}.png
+//
+// Lines starting with # are comments. Frame numbers count the frames
+// written by all render commands of the job. The simulation advances by
+// the frame step exactly and each frame waits for the textures, models
+// and shaders it uses, so the frames don't depend on the rendering speed.
+class JobRunner
+{
+public:
+    JobRunner(CelestiaCore* appCore, ReadbackQueue* readback) :
+        m_appCore(appCore),
+        m_readback(readback)
+    {
+        m_appCore->setFixedTimeStep(m_frameStep);
+    }
+
+    bool run(std::istream& in);
+
+private:
+    bool runCommand(std::string_view command, std::string_view args);
+    void renderFrame();
+
+    CelestiaCore* m_appCore;
+    ReadbackQueue* m_readback;
+    double m_frameStep{ 1.0 / 30.0 };
+    unsigned int m_frameNumber{ 0 };
+};
+
+template<typename T>
+bool
+parseNumber(std::string_view args, T& value)
+{
+    auto result = compat::from_chars(args.data(), args.data() + args.size(), value);
+    return result.ec == std::errc{} && result.ptr == args.data() + args.size();
+}
+
+std::string_view
+trim(std::string_view s)
+{
+    auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos)
+        return {};
+    auto last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+bool
+JobRunner::run(std::istream& in)
+{
+    std::string line;
+    unsigned int lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        std::string_view text = trim(line);
+        if (text.empty() || text.front() == '#')
+            continue;
+
+        auto space = text.find_first_of(" \t");
+        std::string_view command = text.substr(0, space);
+        std::string_view args = space == std::string_view::npos ? std::string_view{} : trim(text.substr(space));
+        if (!runCommand(command, args))
+        {
+            fmt::print(stderr, "Error in job file at line {}: {}\n", lineNumber, text);
+            return false;
+        }
+    }
+
+    m_readback->finish();
+    return true;
+}
+
+bool
+JobRunner::runCommand(std::string_view command, std::string_view args)
+{
+    Simulation* sim = m_appCore->getSimulation();
+
+    if (command == "url")
+        return m_appCore->goToUrl(args);
+
+    if (command == "script")
+    {
+        m_appCore->runScript(fs::u8path(args));
+        return true;
+    }
+
+    if (command == "time")
+    {
+        double jd;
+        if (!parseNumber(args, jd))
+            return false;
+        sim->setTime(jd);
+        return true;
+    }
+
+    if (command == "timescale")
+    {
+        double timeScale;
+        if (!parseNumber(args, timeScale))
+            return false;
+        sim->setTimeScale(timeScale);
+        return true;
+    }
+
+    if (command == "fps")
+    {
+        double rate;
+        if (!parseNumber(args, rate) || rate <= 0.0)
+            return false;
+        m_frameStep = 1.0 / rate;
+        m_appCore->setFixedTimeStep(m_frameStep);
+        return true;
+    }
+
+    if (command == "hud")
+    {
+        int level;
+        if (!parseNumber(args, level))
+            return false;
+        m_appCore->setHudDetail(level);
+        return true;
+    }
+
+    if (command == "warmup")
+    {
+        unsigned int nFrames;
+        if (!parseNumber(args, nFrames))
+            return false;
+        for (unsigned int i = 0; i < nFrames; i++)
+            renderFrame();
+        return true;
+    }
+
+    if (command == "render")
+    {
+        auto space = args.find_first_of(" \t");
+        if (space == std::string_view::npos)
+            return false;
+
+        unsigned int nFrames;
+        std::string pattern(trim(args.substr(space)));
+        if (!parseNumber(args.substr(0, space), nFrames))
+            return false;
+
+        for (unsigned int i = 0; i < nFrames; i++, m_frameNumber++)
+        {
+            std::string filename;
+            try
+            {
+                filename = fmt::format(fmt::runtime(pattern), m_frameNumber);
+            }
+            catch (const fmt::format_error&)
+            {
+                return false;
+            }
+
+            renderFrame();
+            m_readback->capture(fs::u8path(filename));
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void
+JobRunner::renderFrame()
+{
+    m_appCore->tick(m_frameStep);
+    m_appCore->draw();
+}
+
+bool
+parseSize(std::string_view s, int& width, int& height)
+{
+    auto x = s.find('x');
+    return x != std::string_view::npos &&
+           parseNumber(s.substr(0, x), width) &&
+           parseNumber(s.substr(x + 1), height) &&
+           width > 0 && height > 0;
+}
+
+void
+printUsage()
+{
+    fmt::print(stderr, "Usage: celestia-headless [--size WIDTHxHEIGHT] [--conf FILE] [--dir DIR] [--trace FILE] JOBFILE\n");
+}
+
+int
+headlessmain(int argc, char** argv)
+{
+    CelestiaCore::initLocale();
+
+#ifdef ENABLE_NLS
+    bindtextdomain("celestia", LOCALEDIR);
+    bind_textdomain_codeset("celestia", "UTF-8");
+    bindtextdomain("celestia-data", LOCALEDIR);
+    bind_textdomain_codeset("celestia-data", "UTF-8");
+    textdomain("celestia");
+#endif
+
+    int width = 1920;
+    int height = 1080;
+    fs::path configFile;
+    const char* dataDir = std::getenv("CELESTIA_DATA_DIR");
+    if (dataDir == nullptr)
+        dataDir = CONFIG_DATA_DIR;
+
+    fs::path traceFile;
+    fs::path jobFile;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue)
+        {
+            if (!parseSize(argv[++i], width, height))
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (arg == "--conf" && hasValue)
+        {
+            configFile = fs::absolute(fs::u8path(argv[++i]));
+        }
+        else if (arg == "--dir" && hasValue)
+        {
+            dataDir = argv[++i];
+        }
+        else if (arg == "--trace" && hasValue)
+        {
+            traceFile = fs::absolute(fs::u8path(argv[++i]));
+        }
+        else if (jobFile.empty() && !arg.empty() && arg.front() != '-')
+        {
+            jobFile = fs::absolute(fs::u8path(arg));
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (jobFile.empty())
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::ifstream job(jobFile);
+    if (!job.good())
+    {
+        fmt::print(stderr, "Cannot open job file {}\n", jobFile.string());
+        return 1;
+    }
+
+    std::error_code ec;
+    fs::current_path(dataDir, ec);
+    if (ec)
+    {
+        fmt::print(stderr, "Cannot chdir to {}, probably due to improper installation\n", dataDir);
+        return 1;
+    }
+
+    OffscreenContext context;
+    if (!context.create(width, height))
+        return 2;
+
+    gl::init();
+#ifndef GL_ES
+    if (!gl::checkVersion(gl::GL_2_1))
+    {
+        fmt::print(stderr, "Celestia requires OpenGL 2.1!\n");
+        return 2;
+    }
+#endif
+
+    auto appCore = std::make_unique<CelestiaCore>();
+    appCore->setAlerter(new HeadlessAlerter());
+    if (!traceFile.empty())
+        appCore->setStartupTraceFile(traceFile);
+    if (!appCore->initSimulation(configFile))
+    {
+        fmt::print(stderr, "Could not initialize Celestia!\n");
+        return 3;
+    }
+
+    // Frames are flipped while they are copied out of the readback buffers
+    if (!appCore->initRenderer(false))
+    {
+        fmt::print(stderr, "Could not initialize the renderer!\n");
+        return 3;
+    }
+
+    auto* renderer = appCore->getRenderer();
+    const auto* config = appCore->getConfig();
+    renderer->setRenderFlags(Renderer::DefaultRenderFlags);
+    renderer->setShadowMapSize(config->renderDetails.ShadowMapSize);
+    renderer->setStaticStarBuffer(config->renderDetails.staticStarBuffer);
+    renderer->setSolarSystemMaxDistance(config->renderDetails.SolarSystemMaxDistance);
+
+    appCore->start();
+    appCore->resize(width, height);
+
+    bool ok;
+    {
+        ReadbackQueue readback(width, height);
+        ok = JobRunner(appCore.get(), &readback).run(job);
+    }
+
+    return ok ? 0 : 4;
+}
+
+} // end unnamed namespace
+
+} // end namespace celestia::headless
+
+int
+main(int argc, char** argv)
+{
+    return celestia::headless::headlessmain(argc, argv);
+}
@@ -0,0 +1,118 @@
+// offscreencontext.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// OpenGL context rendering to an EGL pbuffer instead of a window.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "offscreencontext.h"
+
+#include <cstdio>
+
+#include <fmt/format.h>
+
+namespace celestia::headless
+{
+
+OffscreenContext::~OffscreenContext()
+{
+    if (m_display == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_context != EGL_NO_CONTEXT)
+        eglDestroyContext(m_display, m_context);
+    if (m_surface != EGL_NO_SURFACE)
+        eglDestroySurface(m_display, m_surface);
+    eglTerminate(m_display);
+}
+
+EGLDisplay
+OffscreenContext::getDisplay()
+{
+    if (epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_EXT_platform_device") &&
+        epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_EXT_device_enumeration"))
+    {
+        EGLDeviceEXT device;
+        EGLint nDevices = 0;
+        if (eglQueryDevicesEXT(1, &device, &nDevices) && nDevices > 0)
+        {
+            EGLDisplay display = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+
+    if (epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless"))
+    {
+        EGLDisplay display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY)
+            return display;
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool
+OffscreenContext::create(int width, int height)
+{
+    m_display = getDisplay();
+    if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr))
+    {
+        fmt::print(stderr, "Could not initialize an EGL display\n");
+        m_display = EGL_NO_DISPLAY;
+        return false;
+    }
+
+#ifdef GL_ES
+    constexpr EGLint renderableType = EGL_OPENGL_ES2_BIT;
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+#else
+    constexpr EGLint renderableType = EGL_OPENGL_BIT;
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint* contextAttribs = nullptr;
+#endif
+
+    const EGLint configAttribs[] =
+    {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, renderableType,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint nConfigs = 0;
+    if (!eglChooseConfig(m_display, configAttribs, &config, 1, &nConfigs) || nConfigs == 0)
+    {
+        fmt::print(stderr, "No EGL configuration supports pbuffers\n");
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    m_surface = eglCreatePbufferSurface(m_display, config, surfaceAttribs);
+    if (m_surface == EGL_NO_SURFACE)
+    {
+        fmt::print(stderr, "Could not create a {}x{} pbuffer\n", width, height);
+        return false;
+    }
+
+    m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (m_context == EGL_NO_CONTEXT || !eglMakeCurrent(m_display, m_surface, m_surface, m_context))
+    {
+        fmt::print(stderr, "Could not create an OpenGL context\n");
+        return false;
+    }
+
+    return true;
+}
+
+} // end namespace celestia::headless
@@ -0,0 +1,42 @@
+// offscreencontext.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// OpenGL context rendering to an EGL pbuffer instead of a window.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <epoxy/egl.h>
+
+namespace celestia::headless
+{
+
+// An EGL display with a pbuffer surface and an OpenGL context. The device
+// platform is tried first, as it needs neither a window system nor a
+// display server, then the Mesa surfaceless platform and finally the
+// default display.
+class OffscreenContext
+{
+public:
+    OffscreenContext() = default;
+    ~OffscreenContext();
+
+    OffscreenContext(const OffscreenContext&) = delete;
+    OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+    bool create(int width, int height);
+
+private:
+    static EGLDisplay getDisplay();
+
+    EGLDisplay m_display{ EGL_NO_DISPLAY };
+    EGLSurface m_surface{ EGL_NO_SURFACE };
+    EGLContext m_context{ EGL_NO_CONTEXT };
+};
+
+} // end namespace celestia::headless
@@ -159,6 +159,12 @@ Helper::getRenderInfo(const Renderer *r)
     if (info.count("MaxAnisotropy") > 0)
         s += fmt::sprintf(_("Max anisotropy filtering: %s\n"), info["MaxAnisotropy"]);
 
+    if (info.count("TextureMemory") > 0 && info.count("TexturesLoaded") > 0)
+        s += fmt::sprintf(_("Texture memory: %s MiB in %s textures\n"), info["TextureMemory"], info["TexturesLoaded"]);
+
+    if (info.count("ModelMemory") > 0 && info.count("ModelsLoaded") > 0)
+        s += fmt::sprintf(_("Model memory: %s MiB in %s models\n"), info["ModelMemory"], info["ModelsLoaded"]);
+
     s += "\n";
 
     if (info.count("Extensions") > 0)
@@ -15,7 +15,12 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include <Eigen/Geometry>
@@ -32,6 +37,7 @@
 #include <celengine/overlay.h>
 #include <celengine/overlayimage.h>
 #include <celengine/rectangle.h>
+#include <celengine/renderstats.h>
 #include <celengine/simulation.h>
 #include <celengine/star.h>
 #include <celengine/textlayout.h>
@@ -43,6 +49,7 @@
 #include <celutil/gettext.h>
 #include <celutil/includeicu.h>
 #include <celutil/logger.h>
+#include <celutil/profiler.h>
 #include <celutil/utf8.h>
 #include "moviecapture.h"
 #include "textprintposition.h"
@@ -64,6 +71,59 @@ constexpr double OneFtInKm = 0.0003048;
 constexpr double OneLbInKg = 0.45359237;
 constexpr double OneLbPerFt3InKgPerM3 = OneLbInKg / math::cube(OneFtInKm * 1000.0);
 
+// Significant digits the values of the cached HUD texts are compared at,
+// more than they are shown with
+constexpr int CacheDigits = 7;
+// Precision in degrees the angles of the cached HUD texts are compared at
+constexpr double CacheAngle = 1.0e-6;
+
+// Collects HUD text with the same calls as Overlay, so that it can be
+// formatted once and printed until the values it shows change
+class InfoText
+{
+public:
+    explicit InfoText(std::string& _text) : text(_text) { text.clear(); }
+
+    void print(std::string_view s) { text.append(s); }
+
+    template <typename... T>
+    void print(const std::locale& loc, std::string_view format, const T&... args)
+    {
+        text.append(fmt::format(loc, format, args...));
+    }
+
+    template <typename... T>
+    void print(std::string_view format, const T&... args)
+    {
+        text.append(fmt::format(format, args...));
+    }
+
+    template <typename... T>
+    void printf(std::string_view format, const T&... args)
+    {
+        text.append(fmt::sprintf(format, args...));
+    }
+
+private:
+    std::string& text;
+};
+
+double
+roundSignificant(double value, int digits)
+{
+    if (value == 0.0 || !std::isfinite(value))
+        return value;
+
+    double scale = std::pow(10.0, digits - 1 - static_cast<int>(std::floor(std::log10(std::abs(value)))));
+    return std::round(value * scale) / scale;
+}
+
+double
+roundAngle(double angle)
+{
+    return std::round(angle / CacheAngle) * CacheAngle;
+}
+
 constexpr util::NumberFormat SigDigitNum = util::NumberFormat::GroupThousands | util::NumberFormat::SignificantFigures;
 
 constexpr float
@@ -149,7 +209,7 @@ DistanceKmToStr(const util::NumberFormatter& formatter, double distance, int dig
 }
 
 void
-displayRotationPeriod(const util::NumberFormatter& formatter, Overlay& overlay, double days)
+displayRotationPeriod(const util::NumberFormatter& formatter, InfoText& info, double days)
 {
     double unitValue;
     const char *unitStr;
@@ -175,31 +235,31 @@ displayRotationPeriod(const util::NumberFormatter& formatter, Overlay& overlay,
         unitStr = _("seconds");
     }
 
-    overlay.print(_("Rotation period: {} {}\n"), formatter.format(unitValue, 3), unitStr);
+    info.print(_("Rotation period: {} {}\n"), formatter.format(unitValue, 3), unitStr);
 }
 
 void
-displayMass(const util::NumberFormatter& formatter, Overlay& overlay, float mass, MeasurementSystem measurement)
+displayMass(const util::NumberFormatter& formatter, InfoText& info, float mass, MeasurementSystem measurement)
 {
     if (mass < 0.001f)
     {
         if (measurement == MeasurementSystem::Imperial)
-            overlay.print(_("Mass: {} lb\n"),
-                          formatter.format(mass * astro::EarthMass / static_cast<float>(OneLbInKg), 4, SigDigitNum));
+            info.print(_("Mass: {} lb\n"),
+                       formatter.format(mass * astro::EarthMass / static_cast<float>(OneLbInKg), 4, SigDigitNum));
         else
-            overlay.print(_("Mass: {} kg\n"),
-                          formatter.format(mass * astro::EarthMass, 4, SigDigitNum));
+            info.print(_("Mass: {} kg\n"),
+                       formatter.format(mass * astro::EarthMass, 4, SigDigitNum));
     }
     else if (mass > 50.0f)
-        overlay.print(_("Mass: {} Mj\n"),
-                      formatter.format(mass * astro::EarthMass / astro::JupiterMass, 4, SigDigitNum));
+        info.print(_("Mass: {} Mj\n"),
+                   formatter.format(mass * astro::EarthMass / astro::JupiterMass, 4, SigDigitNum));
     else
-        overlay.print(_("Mass: {} Me\n"),
-                      formatter.format(mass, 4, SigDigitNum));
+        info.print(_("Mass: {} Me\n"),
+                   formatter.format(mass, 4, SigDigitNum));
 }
 
 void
-displaySpeed(const util::NumberFormatter& formatter, Overlay& overlay, float speed, MeasurementSystem measurement)
+displaySpeed(const util::NumberFormatter& formatter, InfoText& info, float speed, MeasurementSystem measurement)
 {
     float unitValue;
     const char *unitStr;
@@ -245,7 +305,7 @@ displaySpeed(const util::NumberFormatter& formatter, Overlay& overlay, float spe
             unitStr = _("m/s");
         }
     }
-    overlay.print(_("Speed: {} {}\n"), formatter.format(unitValue, 3, SigDigitNum), unitStr);
+    info.print(_("Speed: {} {}\n"), formatter.format(unitValue, 3, SigDigitNum), unitStr);
 }
 
 // Display a positive angle as degrees, minutes, and seconds. If the angle is less than one
@@ -274,7 +334,7 @@ angleToStr(double angle, const std::locale& loc)
 }
 
 void
-displayApparentDiameter(Overlay& overlay, double radius, double distance, const std::locale& loc)
+displayApparentDiameter(InfoText& info, double radius, double distance, const std::locale& loc)
 {
     if (distance < radius)
         return;
@@ -284,36 +344,36 @@ displayApparentDiameter(Overlay& overlay, double radius, double distance, const
     // Only display the arc size if it's less than 160 degrees and greater
     // than one second--otherwise, it's probably not interesting data.
     if (arcSize < 160.0 && arcSize > 1.0 / 3600.0)
-        overlay.printf(_("Apparent diameter: %s\n"), angleToStr(arcSize, loc));
+        info.printf(_("Apparent diameter: %s\n"), angleToStr(arcSize, loc));
 }
 
 void
-displayDeclination(Overlay& overlay, double angle, const std::locale& loc)
+displayDeclination(InfoText& info, double angle, const std::locale& loc)
 {
     int degrees;
     int minutes;
     double seconds;
     astro::decimalToDegMinSec(angle, degrees, minutes, seconds);
 
-    overlay.print(loc, _("Dec: {:+d}{} {:02d}' {:.1f}\"\n"),
-                  std::abs(degrees), UTF8_DEGREE_SIGN,
-                  std::abs(minutes), std::abs(seconds));
+    info.print(loc, _("Dec: {:+d}{} {:02d}' {:.1f}\"\n"),
+               std::abs(degrees), UTF8_DEGREE_SIGN,
+               std::abs(minutes), std::abs(seconds));
 }
 
 void
-displayRightAscension(Overlay& overlay, double angle, const std::locale& loc)
+displayRightAscension(InfoText& info, double angle, const std::locale& loc)
 {
     int hours;
     int minutes;
     double seconds;
     astro::decimalToHourMinSec(angle, hours, minutes, seconds);
 
-    overlay.print(loc, _("RA: {}h {:02}m {:.1f}s\n"),
-                  hours, std::abs(minutes), std::abs(seconds));
+    info.print(loc, _("RA: {}h {:02}m {:.1f}s\n"),
+               hours, std::abs(minutes), std::abs(seconds));
 }
 
 void
-displayApparentMagnitude(Overlay& overlay,
+displayApparentMagnitude(InfoText& info,
                          float absMag,
                          double distance,
                          const std::locale& loc)
@@ -321,16 +381,17 @@ displayApparentMagnitude(Overlay& overlay,
     if (distance > 32.6167)
     {
         float appMag = astro::absToAppMag(absMag, static_cast<float>(distance));
-        overlay.print(loc, _("Apparent magnitude: {:.1f}\n"), appMag);
+        info.print(loc, _("Apparent magnitude: {:.1f}\n"), appMag);
     }
     else
     {
-        overlay.print(loc, _("Absolute magnitude: {:.1f}\n"), absMag);
+        info.print(loc, _("Absolute magnitude: {:.1f}\n"), absMag);
     }
 }
 
-void
-displayRADec(Overlay& overlay, const Eigen::Vector3d& v, const std::locale& loc)
+// Return the right ascension and declination of a direction in degrees
+std::pair<double, double>
+getRADec(const Eigen::Vector3d& v)
 {
     double phi = std::atan2(v.x(), v.z()) - celestia::numbers::pi / 2;
     if (phi < 0.0)
@@ -343,8 +404,7 @@ displayRADec(Overlay& overlay, const Eigen::Vector3d& v, const std::locale& loc)
         theta = -celestia::numbers::pi * 0.5 - theta;
 
 
-    displayRightAscension(overlay, math::radToDeg(phi), loc);
-    displayDeclination(overlay, math::radToDeg(theta), loc);
+    return { math::radToDeg(phi), math::radToDeg(theta) };
 }
 
 // Display nicely formatted planetocentric/planetographic coordinates.
@@ -352,7 +412,7 @@ displayRADec(Overlay& overlay, const Eigen::Vector3d& v, const std::locale& loc)
 // is in kilometers.
 void
 displayPlanetocentricCoords(const util::NumberFormatter& formatter,
-                            Overlay& overlay,
+                            InfoText& info,
                             const Body& body,
                             double longitude,
                             double latitude,
@@ -404,14 +464,14 @@ displayPlanetocentricCoords(const util::NumberFormatter& formatter,
         lat = std::abs(math::radToDeg(latitude));
     }
 
-    overlay.print(loc, _("{:.6f}{} {:.6f}{} {}"),
-                  lat, nsHemi, lon, ewHemi,
-                  DistanceKmToStr(formatter, altitude, 5, measurement));
+    info.print(loc, _("{:.6f}{} {:.6f}{} {}"),
+               lat, nsHemi, lon, ewHemi,
+               DistanceKmToStr(formatter, altitude, 5, measurement));
 }
 
 void
 displayStarInfo(const util::NumberFormatter& formatter,
-                Overlay& overlay,
+                InfoText& info,
                 int detail,
                 const Star& star,
                 const Universe& universe,
@@ -419,21 +479,21 @@ displayStarInfo(const util::NumberFormatter& formatter,
                 const HudSettings& hudSettings,
                 const std::locale& loc)
 {
-    overlay.printf(_("Distance: %s\n"),
-                   DistanceLyToStr(formatter, distance, 5, hudSettings.measurementSystem));
+    info.printf(_("Distance: %s\n"),
+                DistanceLyToStr(formatter, distance, 5, hudSettings.measurementSystem));
 
     if (!star.getVisibility())
     {
-        overlay.print(_("Star system barycenter\n"));
+        info.print(_("Star system barycenter\n"));
     }
     else
     {
-        overlay.print(loc, _("Abs (app) mag: {:.2f} ({:.2f})\n"),
-                      star.getAbsoluteMagnitude(),
-                      star.getApparentMagnitude(float(distance)));
+        info.print(loc, _("Abs (app) mag: {:.2f} ({:.2f})\n"),
+                   star.getAbsoluteMagnitude(),
+                   star.getApparentMagnitude(float(distance)));
 
         if (star.getLuminosity() > 1.0e-10f)
-            overlay.print(loc, _("Luminosity: {}x Sun\n"), formatter.format(star.getLuminosity(), 3, SigDigitNum));
+            info.print(loc, _("Luminosity: {}x Sun\n"), formatter.format(star.getLuminosity(), 3, SigDigitNum));
 
         const char* star_class;
         switch (star.getSpectralType()[0])
@@ -447,32 +507,32 @@ displayStarInfo(const util::NumberFormatter& formatter,
         default:
             star_class = star.getSpectralType();
         }
-        overlay.printf(_("Class: %s\n"), star_class);
+        info.printf(_("Class: %s\n"), star_class);
 
-        displayApparentDiameter(overlay, star.getRadius(),
+        displayApparentDiameter(info, star.getRadius(),
                                 astro::lightYearsToKilometers(distance), loc);
 
         if (detail > 1)
         {
-            overlay.printf(_("Surface temp: %s\n"),
-                           KelvinToStr(formatter, star.getTemperature(), 3, hudSettings.temperatureScale));
+            info.printf(_("Surface temp: %s\n"),
+                        KelvinToStr(formatter, star.getTemperature(), 3, hudSettings.temperatureScale));
 
             if (float solarRadii = star.getRadius() / 6.96e5f; solarRadii > 0.01f)
             {
-                overlay.print(_("Radius: {} Rsun  ({})\n"),
-                              formatter.format(star.getRadius() / 696000.0f, 2, SigDigitNum),
-                              DistanceKmToStr(formatter, star.getRadius(), 3, hudSettings.measurementSystem));
+                info.print(_("Radius: {} Rsun  ({})\n"),
+                           formatter.format(star.getRadius() / 696000.0f, 2, SigDigitNum),
+                           DistanceKmToStr(formatter, star.getRadius(), 3, hudSettings.measurementSystem));
             }
             else
             {
-                overlay.print(_("Radius: {}\n"),
-                              DistanceKmToStr(formatter, star.getRadius(), 3, hudSettings.measurementSystem));
+                info.print(_("Radius: {}\n"),
+                           DistanceKmToStr(formatter, star.getRadius(), 3, hudSettings.measurementSystem));
             }
 
             if (star.getRotationModel()->isPeriodic())
             {
                 auto period = static_cast<float>(star.getRotationModel()->getPeriod());
-                displayRotationPeriod(formatter, overlay, period);
+                displayRotationPeriod(formatter, info, period);
             }
         }
     }
@@ -481,57 +541,103 @@ displayStarInfo(const util::NumberFormatter& formatter,
     {
         const SolarSystem* sys = universe.getSolarSystem(&star);
         if (sys != nullptr && sys->getPlanets()->getSystemSize() != 0)
-            overlay.print(_("Planetary companions present\n"));
+            info.print(_("Planetary companions present\n"));
     }
 }
 
 void displayDSOinfo(const util::NumberFormatter& formatter,
-                    Overlay& overlay,
+                    InfoText& info,
                     const DeepSkyObject& dso,
                     double distance,
                     MeasurementSystem measurement,
                     const std::locale& loc)
 {
-    overlay.print(dso.getDescription());
-    overlay.print("\n");
+    info.print(dso.getDescription());
+    info.print("\n");
 
     if (distance >= 0.0)
     {
-        overlay.printf(_("Distance: %s\n"),
+        info.printf(_("Distance: %s\n"),
                      DistanceLyToStr(formatter, distance, 5, measurement));
     }
     else
     {
-        overlay.printf(_("Distance from center: %s\n"),
+        info.printf(_("Distance from center: %s\n"),
                      DistanceLyToStr(formatter, distance + dso.getRadius(), 5, measurement));
      }
-    overlay.printf(_("Radius: %s\n"),
+    info.printf(_("Radius: %s\n"),
                  DistanceLyToStr(formatter, dso.getRadius(), 5, measurement));
 
-    displayApparentDiameter(overlay, dso.getRadius(), distance, loc);
+    displayApparentDiameter(info, dso.getRadius(), distance, loc);
     if (dso.getAbsoluteMagnitude() > DSO_DEFAULT_ABS_MAGNITUDE)
     {
-        displayApparentMagnitude(overlay,
+        displayApparentMagnitude(info,
                                  dso.getAbsoluteMagnitude(),
                                  distance,
                                  loc);
     }
 }
 
+// Return the phase angle of the body in degrees, if it has a sun
+std::optional<double>
+getPhaseAngle(const Body& body, double t, const Eigen::Vector3d& viewVec)
+{
+    // Find the parent star of the body. This can be slightly complicated if
+    // the body orbits a barycenter instead of a star.
+    const Star* sun = nullptr;
+    for (const PlanetarySystem* system = body.getSystem(); system != nullptr;)
+    {
+        const Body* primaryBody = system->getPrimaryBody();
+        if (primaryBody == nullptr)
+        {
+            sun = system->getStar();
+            break;
+        }
+
+        system = primaryBody->getSystem();
+    }
+
+    if (sun == nullptr)
+        return std::nullopt;
+
+    if (!sun->getVisibility())
+    {
+        // The planet's orbit is defined with respect to a barycenter. If there's
+        // a single star orbiting the barycenter, we'll compute the phase angle
+        // for the planet with respect to that star. If there are no stars, the
+        // planet is an orphan, drifting through space with no star. We also skip
+        // displaying the phase angle when there are multiple stars (for now.)
+        auto orbitingStars = sun->getOrbitingStars();
+        if (orbitingStars.size() != 1)
+            return std::nullopt;
+
+        sun = orbitingStars.front();
+        if (!sun->getVisibility())
+            return std::nullopt;
+    }
+
+    Eigen::Vector3d sunVec = body.getPosition(t).offsetFromKm(sun->getPosition(t));
+    sunVec.normalize();
+    double cosPhaseAngle = std::clamp(sunVec.dot(viewVec.normalized()), -1.0, 1.0);
+    return math::radToDeg(std::acos(cosPhaseAngle));
+}
+
 void
 displayPlanetInfo(const util::NumberFormatter& formatter,
-                  Overlay& overlay,
+                  InfoText& info,
                   int detail,
                   const Body& body,
                   double t,
                   const Eigen::Vector3d& viewVec,
+                  std::optional<double> phaseAngle,
+                  float planetTemp,
                   const HudSettings& hudSettings,
                   const std::locale& loc)
 {
     double distanceKm = viewVec.norm();
     double distance = distanceKm - body.getRadius();
-    overlay.printf(_("Distance: %s\n"),
-                   DistanceKmToStr(formatter, distance, 5, hudSettings.measurementSystem));
+    info.printf(_("Distance: %s\n"),
+                DistanceKmToStr(formatter, distance, 5, hudSettings.measurementSystem));
 
     if (body.getClassification() == BodyClassification::Invisible)
     {
@@ -544,101 +650,58 @@ displayPlanetInfo(const util::NumberFormatter& formatter,
         double axis0 = semiAxes.x();
         double axis1 = semiAxes.z();
         double axis2 = semiAxes.y(); // polar semi-axis
-        overlay.print(_("Radius: {} ({} " UTF8_MULTIPLICATION_SIGN " {} " UTF8_MULTIPLICATION_SIGN " {})\n"),
-                      DistanceKmToStr(formatter, radiusMean, 5, hudSettings.measurementSystem),
-                      DistanceKmToStr(formatter, axis0, 5, hudSettings.measurementSystem),
-                      DistanceKmToStr(formatter, axis1, 5, hudSettings.measurementSystem),
-                      DistanceKmToStr(formatter, axis2, 5, hudSettings.measurementSystem));
+        info.print(_("Radius: {} ({} " UTF8_MULTIPLICATION_SIGN " {} " UTF8_MULTIPLICATION_SIGN " {})\n"),
+                   DistanceKmToStr(formatter, radiusMean, 5, hudSettings.measurementSystem),
+                   DistanceKmToStr(formatter, axis0, 5, hudSettings.measurementSystem),
+                   DistanceKmToStr(formatter, axis1, 5, hudSettings.measurementSystem),
+                   DistanceKmToStr(formatter, axis2, 5, hudSettings.measurementSystem));
     }
     else
     {
-        overlay.print(_("Radius: {}\n"),
-                      DistanceKmToStr(formatter, body.getRadius(), 5, hudSettings.measurementSystem));
+        info.print(_("Radius: {}\n"),
+                   DistanceKmToStr(formatter, body.getRadius(), 5, hudSettings.measurementSystem));
     }
 
-    displayApparentDiameter(overlay, body.getRadius(), distanceKm, loc);
+    displayApparentDiameter(info, body.getRadius(), distanceKm, loc);
 
-    // Display the phase angle
-
-    // Find the parent star of the body. This can be slightly complicated if
-    // the body orbits a barycenter instead of a star.
-    const Star* sun = nullptr;
-    for (const PlanetarySystem* system = body.getSystem(); system != nullptr;)
-    {
-        const Body* primaryBody = system->getPrimaryBody();
-        if (primaryBody == nullptr)
-        {
-            sun = system->getStar();
-            break;
-        }
-
-        system = primaryBody->getSystem();
-    }
-
-    if (sun != nullptr)
-    {
-        bool showPhaseAngle = false;
-        if (sun->getVisibility())
-        {
-            showPhaseAngle = true;
-        }
-        else if (auto orbitingStars = sun->getOrbitingStars(); orbitingStars.size() == 1)
-        {
-            // The planet's orbit is defined with respect to a barycenter. If there's
-            // a single star orbiting the barycenter, we'll compute the phase angle
-            // for the planet with respect to that star. If there are no stars, the
-            // planet is an orphan, drifting through space with no star. We also skip
-            // displaying the phase angle when there are multiple stars (for now.)
-            sun = orbitingStars.front();
-            showPhaseAngle = sun->getVisibility();
-        }
-
-        if (showPhaseAngle)
-        {
-            Eigen::Vector3d sunVec = body.getPosition(t).offsetFromKm(sun->getPosition(t));
-            sunVec.normalize();
-            double cosPhaseAngle = std::clamp(sunVec.dot(viewVec.normalized()), -1.0, 1.0);
-            double phaseAngle = acos(cosPhaseAngle);
-            overlay.print(loc, _("Phase angle: {:.1f}{}\n"), math::radToDeg(phaseAngle), UTF8_DEGREE_SIGN);
-        }
-    }
+    if (phaseAngle.has_value())
+        info.print(loc, _("Phase angle: {:.1f}{}\n"), *phaseAngle, UTF8_DEGREE_SIGN);
 
     if (detail > 1)
     {
         if (body.getRotationModel(t)->isPeriodic())
-            displayRotationPeriod(formatter, overlay, body.getRotationModel(t)->getPeriod());
+            displayRotationPeriod(formatter, info, body.getRotationModel(t)->getPeriod());
 
         if (body.getMass() > 0)
-            displayMass(formatter, overlay, body.getMass(), hudSettings.measurementSystem);
+            displayMass(formatter, info, body.getMass(), hudSettings.measurementSystem);
 
         if (float density = body.getDensity(); density > 0)
         {
             if (hudSettings.measurementSystem == MeasurementSystem::Imperial)
             {
-                overlay.print(_("Density: {} lb/ft³\n"),
-                              formatter.format(density / static_cast<float>(OneLbPerFt3InKgPerM3), 4, SigDigitNum));
+                info.print(_("Density: {} lb/ft³\n"),
+                           formatter.format(density / static_cast<float>(OneLbPerFt3InKgPerM3), 4, SigDigitNum));
             }
             else
             {
-                overlay.print(_("Density: {} kg/m³\n"), formatter.format(density, 4, SigDigitNum));
+                info.print(_("Density: {} kg/m³\n"), formatter.format(density, 4, SigDigitNum));
             }
         }
 
-        float planetTemp = body.getTemperature(t);
         if (planetTemp > 0)
-            overlay.printf(_("Temperature: %s\n"), KelvinToStr(formatter, planetTemp, 3, hudSettings.temperatureScale));
+            info.printf(_("Temperature: %s\n"), KelvinToStr(formatter, planetTemp, 3, hudSettings.temperatureScale));
     }
 }
 
 void
 displayLocationInfo(const util::NumberFormatter& formatter,
-                    Overlay& overlay,
+                    InfoText& info,
                     const Location& location,
                     double distanceKm,
                     MeasurementSystem measurement,
                     const std::locale& loc)
 {
-    overlay.printf(_("Distance: %s\n"), DistanceKmToStr(formatter, distanceKm, 5, measurement));
+    info.printf(_("Distance: %s\n"), DistanceKmToStr(formatter, distanceKm, 5, measurement));
 
     const Body* body = location.getParentBody();
     if (body == nullptr)
@@ -646,7 +709,7 @@ displayLocationInfo(const util::NumberFormatter& formatter,
 
     Eigen::Vector3f locPos = location.getPosition();
     Eigen::Vector3d lonLatAlt = body->cartesianToPlanetocentric(locPos.cast<double>());
-    displayPlanetocentricCoords(formatter, overlay, *body,
+    displayPlanetocentricCoords(formatter, info, *body,
                                 lonLatAlt.x(), lonLatAlt.y(), lonLatAlt.z(), measurement, loc);
 }
 
@@ -877,7 +940,9 @@ Hud::renderOverlay(const WindowMetrics& metrics,
                    const MovieCapture* movieCapture,
                    const TimeInfo& timeInfo,
                    bool isScriptRunning,
-                   bool editMode)
+                   bool editMode,
+                   const util::Profiler& profiler,
+                   const engine::RenderStats& renderStats)
 {
 #ifdef USE_ICU
     if (m_hudSettings.measurementSystem == MeasurementSystem::System)
@@ -911,7 +976,16 @@ Hud::renderOverlay(const WindowMetrics& metrics,
         else
             m_overlay->print("\n");
 
-        displaySpeed(*m_numberFormatter, *m_overlay, static_cast<float>(sim->getObserver().getVelocity().norm()), m_hudSettings.measurementSystem);
+        // The speed is shown with at most 3 significant digits
+        auto speed = static_cast<float>(roundSignificant(sim->getObserver().getVelocity().norm(), 5));
+        if (speed != m_speedKey || m_hudSettings.measurementSystem != m_speedMeasurement)
+        {
+            m_speedKey = speed;
+            m_speedMeasurement = m_hudSettings.measurementSystem;
+            InfoText info(m_speedText);
+            displaySpeed(*m_numberFormatter, info, speed, m_hudSettings.measurementSystem);
+        }
+        m_overlay->print(m_speedText);
 
         m_overlay->endText();
         m_overlay->restorePos();
@@ -932,10 +1006,18 @@ Hud::renderOverlay(const WindowMetrics& metrics,
 
     if (m_hudSettings.showMessage)
         renderTextMessages(metrics, timeInfo.currentTime);
+    else
+        m_messageDrawn = false;
 
     if (movieCapture != nullptr)
         renderMovieCapture(metrics, *movieCapture);
 
+    if (m_hudSettings.showProfiler)
+        renderProfiler(metrics, profiler);
+
+    if (m_hudSettings.showRenderStats)
+        renderRenderStats(metrics, renderStats);
+
     if (editMode)
     {
         m_overlay->savePos();
@@ -966,7 +1048,20 @@ Hud::renderTimeInfo(const WindowMetrics& metrics, const Simulation* sim, const T
     }
 
     double tdb = sim->getTime() + lt;
-    auto dateStr = m_dateFormatter->formatDate(tdb, timeInfo.timeZoneBias != 0, m_dateFormat);
+    // Apart from ISO 8601 the dates are shown to the second, so they need
+    // only be formatted again when the second changes
+    double dateKey = m_dateFormat == astro::Date::ISO8601
+        ? tdb
+        : std::floor(astro::julianDateToSeconds(static_cast<double>(astro::TDBtoUTC(tdb))));
+    bool local = timeInfo.timeZoneBias != 0;
+    if (dateKey != m_dateKey || local != m_dateLocal || m_dateFormat != m_dateKeyFormat)
+    {
+        m_dateKey = dateKey;
+        m_dateLocal = local;
+        m_dateKeyFormat = m_dateFormat;
+        m_dateStr = m_dateFormatter->formatDate(tdb, local, m_dateFormat);
+    }
+    const std::string& dateStr = m_dateStr;
     auto fullDateStr = timeInfo.lightTravelFlag ? dateStr + _("  LT") : dateStr;
 
     m_dateStrWidth = std::max(m_dateStrWidth, engine::TextLayout::getTextWidth(fullDateStr, m_hudFonts.font().get()) + 2 * m_hudFonts.emWidth());
@@ -1091,106 +1186,90 @@ Hud::renderSelectionInfo(const WindowMetrics& metrics,
                          Selection sel,
                          const Eigen::Vector3d& v)
 {
-    m_overlay->savePos();
-    m_overlay->setColor(0.7f, 0.7f, 1.0f, 1.0f);
-    m_overlay->moveBy(metrics.getSafeAreaStart(), metrics.getSafeAreaTop(m_hudFonts.titleFontHeight()));
-
-    m_overlay->beginText();
-
     switch (sel.getType())
     {
     case SelectionType::Star:
-        {
-            if (sel != m_lastSelection)
-            {
-                m_lastSelection = sel;
-                m_selectionNames = sim->getUniverse()->getStarCatalog()->getStarNameList(*sel.star());
-            }
-
-            m_overlay->setFont(m_hudFonts.titleFont());
-            m_overlay->print(m_selectionNames);
-            m_overlay->setFont(m_hudFonts.font());
-            m_overlay->print("\n");
-            displayStarInfo(*m_numberFormatter,
-                            *m_overlay,
-                             m_hudDetail,
-                            *(sel.star()),
-                            *(sim->getUniverse()),
-                             astro::kilometersToLightYears(v.norm()),
-                             m_hudSettings,
-                             loc);
-        }
+    case SelectionType::DeepSky:
+    case SelectionType::Body:
+    case SelectionType::Location:
         break;
+    default:
+        return;
+    }
 
-    case SelectionType::DeepSky:
+    const Universe& universe = *sim->getUniverse();
+    if (sel != m_lastSelection)
+    {
+        m_lastSelection = sel;
+        switch (sel.getType())
         {
-            if (sel != m_lastSelection)
-            {
-                m_lastSelection = sel;
-                m_selectionNames = sim->getUniverse()->getDSOCatalog()->getDSONameList(sel.deepsky());
-            }
-
-            m_overlay->setFont(m_hudFonts.titleFont());
-            m_overlay->print(m_selectionNames);
-            m_overlay->setFont(m_hudFonts.font());
-            m_overlay->print("\n");
-            displayDSOinfo(*m_numberFormatter,
-                           *m_overlay,
-                           *sel.deepsky(),
-                            astro::kilometersToLightYears(v.norm()) - sel.deepsky()->getRadius(),
-                            m_hudSettings.measurementSystem,
-                            loc);
+        case SelectionType::Star:
+            m_selectionNames = universe.getStarCatalog()->getStarNameList(*sel.star());
+            break;
+        case SelectionType::DeepSky:
+            m_selectionNames = universe.getDSOCatalog()->getDSONameList(sel.deepsky());
+            break;
+        case SelectionType::Body:
+            // Show all names for the body
+            m_selectionNames = getBodySelectionNames(*sel.body());
+            break;
+        case SelectionType::Location:
+            m_selectionNames = sel.location()->getName(true);
+            break;
+        default:
+            break;
         }
-        break;
+    }
 
+    // Find the values shown which change from frame to frame; the text is
+    // only formatted again when they change at the precision shown
+    SelectionInfoKey key{ sel,
+                          m_hudDetail,
+                          m_hudSettings.measurementSystem,
+                          m_hudSettings.temperatureScale };
+
+    double t = sim->getTime();
+    double distance = v.norm();
+    std::optional<double> phaseAngle;
+    float planetTemp = 0.0f;
+    switch (sel.getType())
+    {
+    case SelectionType::Star:
+        distance = astro::kilometersToLightYears(distance);
+        break;
+    case SelectionType::DeepSky:
+        distance = astro::kilometersToLightYears(distance) - sel.deepsky()->getRadius();
+        break;
     case SelectionType::Body:
         {
-            // Show all names for the body
-            if (sel != m_lastSelection)
+            const Body& body = *sel.body();
+            phaseAngle = getPhaseAngle(body, t, v);
+            if (phaseAngle.has_value())
+                key.phaseAngle = roundAngle(*phaseAngle);
+            if (m_hudDetail > 1)
             {
-                m_lastSelection = sel;
-                m_selectionNames = getBodySelectionNames(*sel.body());
+                planetTemp = body.getTemperature(t);
+                key.temperature = roundSignificant(planetTemp, CacheDigits);
+                key.rotationModel = body.getRotationModel(t);
             }
-
-            m_overlay->setFont(m_hudFonts.titleFont());
-            m_overlay->print(m_selectionNames);
-            m_overlay->setFont(m_hudFonts.font());
-            m_overlay->print("\n");
-            displayPlanetInfo(*m_numberFormatter,
-                              *m_overlay,
-                               m_hudDetail,
-                              *(sel.body()),
-                               sim->getTime(),
-                               v,
-                               m_hudSettings,
-                               loc);
+            // The distance shown is the altitude
+            key.distance = roundSignificant(distance - body.getRadius(), CacheDigits);
         }
         break;
-
-    case SelectionType::Location:
-        m_overlay->setFont(m_hudFonts.titleFont());
-        m_overlay->print(sel.location()->getName(true).c_str());
-        m_overlay->setFont(m_hudFonts.font());
-        m_overlay->print("\n");
-        displayLocationInfo(*m_numberFormatter,
-                            *m_overlay,
-                            *(sel.location()),
-                             v.norm(),
-                             m_hudSettings.measurementSystem,
-                             loc);
-        break;
-
     default:
         break;
     }
+    if (sel.getType() != SelectionType::Body)
+        key.distance = roundSignificant(distance, CacheDigits);
 
     // Display RA/Dec for the selection, but only when the observer is near
     // the Earth.
+    std::pair<double, double> raDec;
     if (const Body* refObject = sim->getFrame()->getRefObject().body();
         refObject != nullptr && refObject->getName() == "Earth")
     {
         UniversalCoord observerPos = sim->getObserver().getPosition();
-        double distToEarthCenter = observerPos.offsetFromKm(refObject->getPosition(sim->getTime())).norm();
+        double distToEarthCenter = observerPos.offsetFromKm(refObject->getPosition(t)).norm();
         double altitude = distToEarthCenter - refObject->getRadius();
         if (altitude < 1000.0 && (sel.getType() == SelectionType::Star || sel.getType() == SelectionType::DeepSky))
         {
@@ -1199,20 +1278,106 @@ Hud::renderSelectionInfo(const WindowMetrics& metrics,
             // Only show the coordinates for stars and deep sky objects, where
             // the geocentric values will match the apparent values for observers
             // near the Earth.
-            Eigen::Vector3d vEarth = sel.getPosition(sim->getTime()).offsetFromKm(refObject->getPosition(sim->getTime()));
+            Eigen::Vector3d vEarth = sel.getPosition(t).offsetFromKm(refObject->getPosition(t));
             vEarth = math::XRotation(astro::J2000Obliquity) * vEarth;
-            displayRADec(*m_overlay, vEarth, loc);
+            raDec = getRADec(vEarth);
+            key.showRADec = true;
+            key.ra = roundAngle(raDec.first);
+            key.dec = roundAngle(raDec.second);
+        }
+    }
+
+    if (!(key == m_selectionInfoKey))
+    {
+        m_selectionInfoKey = key;
+
+        InfoText info(m_selectionInfo);
+        switch (sel.getType())
+        {
+        case SelectionType::Star:
+            displayStarInfo(*m_numberFormatter,
+                            info,
+                            m_hudDetail,
+                            *(sel.star()),
+                            universe,
+                            distance,
+                            m_hudSettings,
+                            loc);
+            break;
+        case SelectionType::DeepSky:
+            displayDSOinfo(*m_numberFormatter,
+                           info,
+                           *sel.deepsky(),
+                           distance,
+                           m_hudSettings.measurementSystem,
+                           loc);
+            break;
+        case SelectionType::Body:
+            displayPlanetInfo(*m_numberFormatter,
+                              info,
+                              m_hudDetail,
+                              *(sel.body()),
+                              t,
+                              v,
+                              phaseAngle,
+                              planetTemp,
+                              m_hudSettings,
+                              loc);
+            break;
+        case SelectionType::Location:
+            displayLocationInfo(*m_numberFormatter,
+                                info,
+                                *(sel.location()),
+                                distance,
+                                m_hudSettings.measurementSystem,
+                                loc);
+            break;
+        default:
+            break;
+        }
+
+        if (key.showRADec)
+        {
+            displayRightAscension(info, raDec.first, loc);
+            displayDeclination(info, raDec.second, loc);
         }
     }
 
+    m_overlay->savePos();
+    m_overlay->setColor(0.7f, 0.7f, 1.0f, 1.0f);
+    m_overlay->moveBy(metrics.getSafeAreaStart(), metrics.getSafeAreaTop(m_hudFonts.titleFontHeight()));
+
+    m_overlay->beginText();
+    m_overlay->setFont(m_hudFonts.titleFont());
+    m_overlay->print(m_selectionNames);
+    m_overlay->setFont(m_hudFonts.font());
+    m_overlay->print("\n");
+    m_overlay->print(m_selectionInfo);
     m_overlay->endText();
     m_overlay->restorePos();
 }
 
+bool
+Hud::SelectionInfoKey::operator==(const SelectionInfoKey& other) const
+{
+    return selection == other.selection &&
+           detail == other.detail &&
+           measurementSystem == other.measurementSystem &&
+           temperatureScale == other.temperatureScale &&
+           distance == other.distance &&
+           phaseAngle == other.phaseAngle &&
+           temperature == other.temperature &&
+           rotationModel == other.rotationModel &&
+           showRADec == other.showRADec &&
+           ra == other.ra &&
+           dec == other.dec;
+}
+
 void
 Hud::renderTextMessages(const WindowMetrics& metrics, double currentTime)
 {
-    if (currentTime >= m_messageStart + m_messageDuration)
+    m_messageDrawn = currentTime < m_messageStart + m_messageDuration;
+    if (!m_messageDrawn)
         return;
 
     int x = 0;
@@ -1299,6 +1464,18 @@ Hud::showText(const TextPrintPosition& position,
     m_messageDuration = duration;
 }
 
+bool
+Hud::messageChanging(double currentTime) const
+{
+    if (!m_hudSettings.showMessage)
+        return false;
+
+    double end = m_messageStart + m_messageDuration;
+    if (m_messageDrawn)
+        return currentTime > end - 0.5;
+    return currentTime < end;
+}
+
 void
 Hud::setImage(std::unique_ptr<OverlayImage>&& _image, double currentTime)
 {
@@ -1306,4 +1483,113 @@ Hud::setImage(std::unique_ptr<OverlayImage>&& _image, double currentTime)
     m_image->setStartTime(static_cast<float>(currentTime));
 }
 
+void
+Hud::renderProfiler(const WindowMetrics& metrics, const util::Profiler& profiler)
+{
+    const auto& zones = profiler.getLastFrame();
+    if (zones.empty())
+        return;
+
+    const TextureFont* font = m_hudFonts.font().get();
+    int emWidth = m_hudFonts.emWidth();
+
+    // Child zones are indented under their parent
+    std::vector<std::string> names;
+    names.reserve(zones.size());
+    int nameWidth = engine::TextLayout::getTextWidth(_("Zone"), font);
+    for (const auto& zone : zones)
+    {
+        auto& name = names.emplace_back(static_cast<std::size_t>(zone.depth) * 2, ' ');
+        name += zone.name;
+        if (zone.count > 1)
+            fmt::format_to(std::back_inserter(name), " ({})", zone.count);
+        nameWidth = std::max(nameWidth, engine::TextLayout::getTextWidth(name, font));
+    }
+    nameWidth += emWidth;
+    int columnWidth = engine::TextLayout::getTextWidth("0000.000", font) + emWidth;
+
+    m_overlay->savePos();
+    m_overlay->setColor(0.7f, 0.7f, 1.0f, 1.0f);
+    m_overlay->moveBy(metrics.getSafeAreaEnd(nameWidth + 2 * columnWidth),
+                      metrics.getSafeAreaTop(m_hudFonts.fontHeight() * 5));
+
+    m_overlay->savePos();
+    m_overlay->beginText();
+    m_overlay->print(_("Zone"));
+    for (const auto& name : names)
+    {
+        m_overlay->print("\n");
+        m_overlay->print(name);
+    }
+    m_overlay->endText();
+    m_overlay->restorePos();
+
+    m_overlay->savePos();
+    m_overlay->moveBy(nameWidth, 0);
+    m_overlay->beginText();
+    m_overlay->print(_("CPU ms"));
+    for (const auto& zone : zones)
+        m_overlay->print(loc, "\n{:.3f}", zone.cpuTime * 1000.0);
+    m_overlay->endText();
+    m_overlay->restorePos();
+
+    m_overlay->savePos();
+    m_overlay->moveBy(nameWidth + columnWidth, 0);
+    m_overlay->beginText();
+    m_overlay->print(_("GPU ms"));
+    for (const auto& zone : zones)
+    {
+        if (zone.gpuTime.has_value())
+            m_overlay->print(loc, "\n{:.3f}", *zone.gpuTime * 1000.0);
+        else
+            m_overlay->print("\n-");
+    }
+    m_overlay->endText();
+    m_overlay->restorePos();
+
+    m_overlay->restorePos();
+}
+
+void
+Hud::renderRenderStats(const WindowMetrics& metrics, const engine::RenderStats& stats)
+{
+    const TextureFont* font = m_hudFonts.font().get();
+    int nameWidth = 0;
+    int nLines = 0;
+    stats.forEach([&](std::string_view name, std::uint64_t)
+    {
+        nameWidth = std::max(nameWidth, engine::TextLayout::getTextWidth(name, font));
+        ++nLines;
+    });
+    nameWidth += m_hudFonts.emWidth();
+
+    // Centered vertically on the left edge, clear of the selection info
+    m_overlay->savePos();
+    m_overlay->setColor(0.7f, 0.7f, 1.0f, 1.0f);
+    m_overlay->moveBy(metrics.getSafeAreaStart(),
+                      metrics.getSafeAreaBottom((metrics.getSafeAreaHeight() + m_hudFonts.fontHeight() * nLines) / 2));
+
+    m_overlay->beginText();
+    stats.forEach([this](std::string_view name, std::uint64_t)
+    {
+        m_overlay->print(name);
+        m_overlay->print("\n");
+    });
+    m_overlay->endText();
+
+    m_overlay->moveBy(nameWidth, 0);
+    m_overlay->beginText();
+    stats.forEach([this](std::string_view name, std::uint64_t value)
+    {
+        // Sizes in bytes are shown in MiB
+        if (name == "textureUploadBytes" || name == "textureMemory" || name == "meshMemory")
+            m_overlay->print(loc, "{:.1f} MiB\n", static_cast<double>(value) / (1024.0 * 1024.0));
+        else
+            m_overlay->print(loc, "{}\n", value);
+    });
+    m_overlay->endText();
+
+    m_overlay->restorePos();
+}
+
 } // end namespace celestia
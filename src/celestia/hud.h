@@ -47,6 +47,12 @@ class ViewManager;
 namespace engine
 {
 class DateFormatter;
+struct RenderStats;
+}
+
+namespace util
+{
+class Profiler;
 }
 
 enum class MeasurementSystem
@@ -109,6 +115,8 @@ struct HudSettings
 
     HudElements overlayElements{ HudElements::Default };
     bool showFPSCounter{ false };
+    bool showProfiler{ false };
+    bool showRenderStats{ false };
     bool showOverlayImage{ true };
     bool showMessage{ true };
 };
@@ -151,10 +159,14 @@ public:
                        const MovieCapture*,
                        const TimeInfo&,
                        bool isScriptRunning,
-                       bool editMode);
+                       bool editMode,
+                       const util::Profiler&,
+                       const engine::RenderStats&);
 
     void showText(const TextPrintPosition&, std::string_view, double duration, double currentTime);
     void setImage(std::unique_ptr<OverlayImage>&&, double);
+    // The text message appears, fades or disappears in the next frame
+    bool messageChanging(double currentTime) const;
 
     HudSettings& hudSettings() noexcept { return m_hudSettings; }
     const HudSettings& hudSettings() const noexcept { return m_hudSettings; }
@@ -165,6 +177,8 @@ private:
     void renderSelectionInfo(const WindowMetrics&, const Simulation*, Selection, const Eigen::Vector3d&);
     void renderTextMessages(const WindowMetrics&, double);
     void renderMovieCapture(const WindowMetrics&, const MovieCapture&);
+    void renderProfiler(const WindowMetrics&, const util::Profiler&);
+    void renderRenderStats(const WindowMetrics&, const engine::RenderStats&);
 
     HudSettings m_hudSettings;
     HudFonts m_hudFonts;
@@ -189,9 +203,41 @@ private:
     TextPrintPosition m_messageTextPosition;
     double m_messageStart{ -std::numeric_limits<double>::infinity() };
     double m_messageDuration{ 0.0 };
+    bool m_messageDrawn{ false };
 
     Selection m_lastSelection;
     std::string m_selectionNames;
+
+    // The values the cached selection info text was formatted for, rounded
+    // to a finer precision than they are shown with
+    struct SelectionInfoKey
+    {
+        Selection selection;
+        int detail{ -1 };
+        MeasurementSystem measurementSystem{ MeasurementSystem::Metric };
+        TemperatureScale temperatureScale{ TemperatureScale::Kelvin };
+        double distance{ 0.0 };
+        double phaseAngle{ -1.0 };
+        double temperature{ 0.0 };
+        const void* rotationModel{ nullptr };
+        bool showRADec{ false };
+        double ra{ 0.0 };
+        double dec{ 0.0 };
+
+        bool operator==(const SelectionInfoKey&) const;
+    };
+
+    SelectionInfoKey m_selectionInfoKey;
+    std::string m_selectionInfo;
+
+    std::string m_speedText;
+    float m_speedKey{ -1.0f };
+    MeasurementSystem m_speedMeasurement{ MeasurementSystem::Metric };
+
+    std::string m_dateStr;
+    double m_dateKey{ std::numeric_limits<double>::quiet_NaN() };
+    bool m_dateLocal{ false };
+    celestia::astro::Date::Format m_dateKeyFormat{ celestia::astro::Date::Locale };
 };
 
 ENUM_CLASS_BITWISE_OPS(Hud::TextEnterMode);
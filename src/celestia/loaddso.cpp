@@ -9,10 +9,16 @@
 
 #include "loaddso.h"
 
-#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 #include <celengine/dsodb.h>
 #include <celengine/dsodbbuilder.h>
+#include <celestia/catalogcache.h>
 #include <celestia/catalogloader.h>
 #include <celestia/configfile.h>
 #include <celestia/progressnotifier.h>
@@ -23,6 +29,40 @@ namespace celestia
 {
 using DeepSkyLoader = CatalogLoader<DSODatabaseBuilder>;
 
+namespace
+{
+
+// Changed when the objects built from the same files may differ
+constexpr std::string_view CacheVersion = "dsocache1";
+
+std::unique_ptr<DSODatabase>
+loadCache(const fs::path& path, const std::vector<fs::path>& files)
+{
+    if (std::error_code ec; !fs::exists(path, ec))
+        return nullptr;
+
+    DSODatabaseBuilder builder;
+    if (!builder.loadBinary(path))
+        return nullptr;
+
+#ifdef ENABLE_NLS
+    // The catalogs would have bound the translation domains of their
+    // resource paths
+    for (const auto& file : files)
+    {
+        std::string s = file.parent_path().string();
+        bindtextdomain(s.c_str(), s.c_str());
+    }
+#else
+    (void) files;
+#endif
+
+    util::GetLogger()->info(_("Loaded deep sky catalog cache {}\n"), path);
+    return builder.finish();
+}
+
+} // end unnamed namespace
+
 std::unique_ptr<DSODatabase>
 loadDSO(const CelestiaConfig &config, ProgressNotifier *progressNotifier)
 {
@@ -37,6 +77,37 @@ loadDSO(const CelestiaConfig &config, ProgressNotifier *progressNotifier)
                          progressNotifier,
                          config.paths.skipExtras);
 
+    // With a cache directory, the objects loaded from the catalog files
+    // below are kept as a binary catalog, which is used instead of the
+    // files while none of them changes.
+    std::optional<fs::path> cachePath;
+    std::vector<fs::path> catalogFiles;
+    if (!config.paths.catalogCacheDirectory.empty())
+    {
+        catalogFiles = loader.findCatalogFiles(config.paths.dsoCatalogFiles, config.paths.extrasDirs);
+        std::vector<fs::path> sources = catalogFiles;
+        if (!config.paths.dsoDatabaseFile.empty())
+            sources.insert(sources.begin(), config.paths.dsoDatabaseFile);
+
+        cachePath = GetCatalogCachePath(config.paths.catalogCacheDirectory, CacheVersion, sources, ".dsodb");
+        if (cachePath.has_value())
+        {
+            if (auto cached = loadCache(*cachePath, catalogFiles); cached != nullptr)
+                return cached;
+        }
+    }
+
+    // A binary catalog is loaded first, so that its prebuilt octree can be
+    // used if no other catalogs are present.
+    if (!config.paths.dsoDatabaseFile.empty())
+    {
+        if (progressNotifier != nullptr)
+            progressNotifier->update(config.paths.dsoDatabaseFile.string());
+
+        if (!dsoDB->loadBinary(config.paths.dsoDatabaseFile))
+            util::GetLogger()->error(_("Error reading deep sky catalog {}\n"), config.paths.dsoDatabaseFile);
+    }
+
     // Load first the vector of dsoCatalogFiles in the data directory (deepsky.dsc,
     // globulars.dsc, ...):
     fs::path empty;
@@ -46,6 +117,26 @@ loadDSO(const CelestiaConfig &config, ProgressNotifier *progressNotifier)
     // Next, read all the deep sky files in the extras directories
     loader.loadExtras(config.paths.extrasDirs);
 
+    // Without catalog files there is nothing to save over the binary
+    // catalog. writeBinary() uses up the objects, so the database is
+    // built again from the written catalog.
+    if (cachePath.has_value() && !catalogFiles.empty() && dsoDB->canWriteBinary())
+    {
+        std::ostringstream out;
+        if (dsoDB->writeBinary(out))
+        {
+            std::string data = out.str();
+            StoreCatalogCache(*cachePath, data);
+
+            DSODatabaseBuilder cached;
+            if (cached.loadBinary(data.data(), data.size()))
+                return cached.finish();
+        }
+
+        util::GetLogger()->error(_("Error building deep sky catalog cache\n"));
+        return nullptr;
+    }
+
     return dsoDB->finish();
 }
 
@@ -12,21 +12,42 @@
 #include <fstream>
 #include <memory>
 
+#include <celengine/minorbodycatalog.h>
 #include <celengine/universe.h>
 #include <celestia/configfile.h>
 #include <celestia/progressnotifier.h>
 #include <celestia/catalogloader.h>
 #include <celutil/gettext.h>
+#include <celutil/logger.h>
 
 namespace celestia
 {
 
+// Solar system catalogs are parsed on the loader threads and their objects
+// are added to the universe in file order
+template<>
+struct detail::CatalogParser<Universe>
+{
+    static constexpr bool enabled = true;
+    using ParsedCatalog = ParsedSolarSystemObjects;
+
+    static ParsedCatalog parse(Tokenizer &tokenizer, const fs::path &path)
+    {
+        return ParseSolarSystemObjects(tokenizer, path);
+    }
+
+    static bool merge(Universe &universe, ParsedCatalog &&catalog)
+    {
+        return ApplySolarSystemObjects(std::move(catalog), universe);
+    }
+};
+
 using SolarSystemLoader = CatalogLoader<Universe>;
 
 template<> bool
-CatalogLoader<Universe>::load(std::istream &in, const fs::path &dir)
+CatalogLoader<Universe>::load(Tokenizer &tokenizer, const fs::path &dir)
 {
-    return LoadSolarSystemObjects(in, *m_objDB, dir);
+    return LoadSolarSystemObjects(tokenizer, *m_objDB, dir);
 }
 
 void
@@ -45,12 +66,51 @@ loadSSO(const CelestiaConfig &config, ProgressNotifier *progressNotifier, Univer
                              config.paths.skipExtras);
 
     // First read the solar system files listed individually in the config file.
-    fs::path empty;
-    for (const auto &file : config.paths.solarSystemFiles)
-        loader.process(file, empty);
+    loader.processFiles(config.paths.solarSystemFiles, fs::path());
 
-    // Next, read all the solar system files in the extras directories
+    // Next, read all the solar system files in the extras directories. The
+    // bodies of other stars may be created when they are first needed.
+    universe->setDeferSolarSystems(config.lazySolarSystems);
     loader.loadExtras(config.paths.extrasDirs);
+    universe->setDeferSolarSystems(false);
+
+    for (const auto &file : config.paths.minorBodyFiles)
+    {
+        auto catalog = engine::MinorBodyCatalog::load(file, *universe->getStarCatalog());
+        if (catalog == nullptr)
+            continue;
+
+        util::GetLogger()->info(_("Loaded minor body catalog {}, {} bodies\n"), file, catalog->size());
+        universe->addMinorBodyCatalog(std::move(catalog));
+    }
+}
+
+std::vector<fs::path>
+findExtrasSSOFiles(const CelestiaConfig &config)
+{
+    SolarSystemLoader loader(nullptr,
+                             C_("catalog", "solar system"),
+                             ContentType::CelestiaCatalog,
+                             nullptr,
+                             config.paths.skipExtras);
+    return loader.findCatalogFiles({}, config.paths.extrasDirs);
+}
+
+bool
+reloadSSO(const fs::path &file, Universe *universe)
+{
+    std::ifstream in(file);
+    if (!in.good())
+    {
+        util::GetLogger()->error(_("Error opening solar system catalog {}.\n"), file);
+        return false;
+    }
+
+    util::GetLogger()->info(_("Reloading solar system catalog: {}\n"), file);
+    Tokenizer tokenizer(&in);
+    ParsedSolarSystemObjects parsed = ParseSolarSystemObjects(tokenizer, file.parent_path());
+    parsed.setReplaceExisting(true);
+    return ApplySolarSystemObjects(std::move(parsed), *universe);
 }
 
 } // namespace celestia
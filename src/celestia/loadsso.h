@@ -9,6 +9,9 @@
 
 #pragma once
 
+#include <vector>
+
+#include <celcompat/filesystem.h>
 #include <celengine/solarsys.h>
 
 class ProgressNotifier;
@@ -20,4 +23,11 @@ namespace celestia
 
 void loadSSO(const CelestiaConfig &config, ProgressNotifier *progressNotifier, Universe *universe);
 
+// The solar system catalogs of the extras directories, in loading order
+std::vector<fs::path> findExtrasSSOFiles(const CelestiaConfig &config);
+
+// Read a catalog of the extras directories again after it was changed,
+// updating the objects which it defined before
+bool reloadSSO(const fs::path &file, Universe *universe);
+
 } // namespace celestia
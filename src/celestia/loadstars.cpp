@@ -9,9 +9,12 @@
 
 #include "loadstars.h"
 
+#include <cstddef>
 #include <fstream>
+#include <system_error>
 
 #include <celcompat/filesystem.h>
+#include <celengine/pagedstaroctree.h>
 #include <celengine/stardb.h>
 #include <celengine/stardbbuilder.h>
 #include <celestia/catalogloader.h>
@@ -34,13 +37,13 @@ loadCrossIndex(StarNameDatabase& starNamesDB, StarCatalog catalog, const fs::pat
     if (filename.empty())
         return;
 
-    if (std::ifstream xrefFile(filename, std::ios::binary); xrefFile.good())
-    {
-        if (!starNamesDB.loadCrossIndex(catalog, xrefFile))
-            util::GetLogger()->error(_("Error reading cross index {}\n"), filename);
-        else
-            util::GetLogger()->info(_("Loaded cross index {}\n"), filename);
-    }
+    if (std::error_code ec; !fs::exists(filename, ec))
+        return;
+
+    if (!starNamesDB.loadCrossIndex(catalog, filename))
+        util::GetLogger()->error(_("Error reading cross index {}\n"), filename);
+    else
+        util::GetLogger()->info(_("Loaded cross index {}\n"), filename);
 }
 
 } // namespace
@@ -56,17 +59,15 @@ loadStars(const CelestiaConfig &config, ProgressNotifier *progressNotifier)
         if (progressNotifier)
             progressNotifier->update(path.string());
 
-        if (std::ifstream starFile(path, std::ios::binary); starFile.good())
+        if (std::error_code ec; !fs::exists(path, ec))
         {
-            if (!starDBBuilder.loadBinary(starFile))
-            {
-                util::GetLogger()->error(_("Error reading stars file\n"));
-                return nullptr;
-            }
+            util::GetLogger()->error(_("Error opening {}\n"), path);
+            return nullptr;
         }
-        else
+
+        if (!starDBBuilder.loadBinary(path))
         {
-            util::GetLogger()->error(_("Error opening {}\n"), path);
+            util::GetLogger()->error(_("Error reading stars file\n"));
             return nullptr;
         }
     }
@@ -103,9 +104,7 @@ loadStars(const CelestiaConfig &config, ProgressNotifier *progressNotifier)
                       config.paths.skipExtras);
 
     // Next, read any ASCII star catalog files specified in the StarCatalogs list.
-    fs::path empty;
-    for (const auto &file : config.paths.starCatalogFiles)
-        loader.process(file, empty);
+    loader.processFiles(config.paths.starCatalogFiles, fs::path());
 
     // Now, read supplemental star files from the extras directories
     loader.loadExtras(config.paths.extrasDirs);
@@ -113,4 +112,20 @@ loadStars(const CelestiaConfig &config, ProgressNotifier *progressNotifier)
     return starDBBuilder.finish();
 }
 
+std::unique_ptr<engine::PagedStarOctree>
+loadPagedStars(const CelestiaConfig &config)
+{
+    auto &path = config.paths.pagedStarDatabaseFile;
+    if (path.empty())
+        return nullptr;
+
+    auto pagedStars = engine::PagedStarOctree::open(path,
+                                                    static_cast<std::size_t>(config.pagedStarCacheSize) * 1024 * 1024,
+                                                    config.pagedStarQuantization);
+    if (pagedStars != nullptr)
+        util::GetLogger()->info(_("Loaded paged star database {}, {} stars\n"), path, pagedStars->size());
+
+    return pagedStars;
+}
+
 } // namespace celestia
@@ -12,6 +12,10 @@
 #include <memory>
 
 class StarDatabase;
+namespace celestia::engine
+{
+class PagedStarOctree;
+}
 class ProgressNotifier;
 struct CelestiaConfig;
 
@@ -21,4 +25,6 @@ namespace celestia
 std::unique_ptr<StarDatabase> loadStars(const CelestiaConfig &config,
                                         ProgressNotifier     *progressNotifier);
 
+std::unique_ptr<engine::PagedStarOctree> loadPagedStars(const CelestiaConfig &config);
+
 } // namespace celestia
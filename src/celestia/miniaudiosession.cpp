@@ -1,4 +1,5 @@
 #include "miniaudiosession.h"
+#include <mutex>
 #include <celutil/logger.h>
 
 #define MINIAUDIO_IMPLEMENTATION
@@ -9,6 +10,87 @@ using namespace celestia::util;
 namespace celestia
 {
 
+namespace
+{
+
+// The device and the engine mixing the sounds of all sessions. Starting
+// them opens the audio device, which can take a while, so they are shared
+// by all the sessions existing at the same time. The resource manager of
+// the engine decodes the sounds on its own thread.
+class MiniAudioEngine
+{
+ public:
+    MiniAudioEngine() = default;
+    ~MiniAudioEngine();
+
+    MiniAudioEngine(const MiniAudioEngine&) = delete;
+    MiniAudioEngine &operator=(const MiniAudioEngine&) = delete;
+
+    // Return the engine of the sessions, starting it if there are none
+    static std::shared_ptr<MiniAudioEngine> acquire();
+
+    ma_engine* get() { return &m_engine; }
+
+ private:
+    bool start();
+
+    ma_context m_context;
+    ma_engine m_engine;
+    bool m_started { false };
+};
+
+MiniAudioEngine::~MiniAudioEngine()
+{
+    if (m_started)
+    {
+        ma_engine_uninit(&m_engine);
+        ma_context_uninit(&m_context);
+    }
+}
+
+std::shared_ptr<MiniAudioEngine> MiniAudioEngine::acquire()
+{
+    static std::mutex mutex;
+    static std::weak_ptr<MiniAudioEngine> shared;
+
+    std::scoped_lock lock(mutex);
+    auto engine = shared.lock();
+    if (engine == nullptr)
+    {
+        engine = std::make_shared<MiniAudioEngine>();
+        if (!engine->start())
+            return nullptr;
+        shared = engine;
+    }
+    return engine;
+}
+
+bool MiniAudioEngine::start()
+{
+    auto config = ma_context_config_init();
+    // on iOS, explicitly set the correct category for correct routing
+    config.coreaudio.sessionCategory = ma_ios_session_category_playback;
+    ma_result result = ma_context_init(nullptr, 0, &config, &m_context);
+    if (result != MA_SUCCESS)
+    {
+        GetLogger()->error("Failed to init miniaudio context");
+        return false;
+    }
+    auto engineConfig = ma_engine_config_init();
+    engineConfig.pContext = &m_context;
+    result = ma_engine_init(&engineConfig, &m_engine);
+    if (result != MA_SUCCESS)
+    {
+        ma_context_uninit(&m_context);
+        GetLogger()->error("Failed to start miniaudio engine");
+        return false;
+    }
+    m_started = true;
+    return true;
+}
+
+} // end unnamed namespace
+
 class MiniAudioSessionPrivate
 {
  public:
@@ -28,8 +110,7 @@ class MiniAudioSessionPrivate
     MiniAudioSessionPrivate &operator=(const MiniAudioSessionPrivate&) = delete;
     MiniAudioSessionPrivate &operator=(MiniAudioSessionPrivate&&) = delete;
 
-    ma_context context;
-    ma_engine engine;
+    std::shared_ptr<MiniAudioEngine> engine;
     ma_sound sound;
     State state         { State::NotInitialized };
 };
@@ -44,8 +125,6 @@ MiniAudioSessionPrivate::~MiniAudioSessionPrivate()
     case State::SoundInitialzied:
         ma_sound_uninit(&sound);
     case State::EngineStarted:
-        ma_engine_uninit(&engine);
-        ma_context_uninit(&context);
     case State::NotInitialized:
         break;
     }
@@ -59,6 +138,24 @@ MiniAudioSession::MiniAudioSession(const fs::path &path, float volume, float pan
 
 MiniAudioSession::~MiniAudioSession() = default;
 
+bool MiniAudioSession::preload()
+{
+    switch (p->state)
+    {
+    case MiniAudioSessionPrivate::State::NotInitialized:
+        if (!startEngine())
+            return false;
+
+    case MiniAudioSessionPrivate::State::EngineStarted:
+        // decode the whole file into memory on the resource manager's
+        // thread, so that starting and seeking need no decoding
+        return initSound(true);
+
+    default:
+        return true;
+    }
+}
+
 bool MiniAudioSession::play(double startTime)
 {
     ma_result result;
@@ -68,20 +165,11 @@ bool MiniAudioSession::play(double startTime)
         // start the engine
         if (!startEngine())
             return false;
-        p->state = MiniAudioSessionPrivate::State::EngineStarted;
 
     case MiniAudioSessionPrivate::State::EngineStarted:
         // load sound file from disk
-        result = ma_sound_init_from_file(&p->engine, path().string().c_str(), MA_SOUND_FLAG_ASYNC, nullptr, nullptr, &p->sound);
-        if (result != MA_SUCCESS)
-        {
-            GetLogger()->error("Failed to load sound file {}", path());
+        if (!initSound(false))
             return false;
-        }
-        ma_sound_set_volume(&p->sound, volume());
-        ma_sound_set_pan(&p->sound, pan());
-        ma_sound_set_looping(&p->sound, loop() ? MA_TRUE : MA_FALSE);
-        p->state = MiniAudioSessionPrivate::State::SoundInitialzied;
 
     case MiniAudioSessionPrivate::State::SoundInitialzied:
         // start playing, seek if needed
@@ -152,7 +240,13 @@ bool MiniAudioSession::seek(double seconds)
 {
     if (p->state >= MiniAudioSessionPrivate::State::SoundInitialzied)
     {
-        ma_result result = ma_sound_seek_to_pcm_frame(&p->sound, static_cast<ma_uint64>(seconds * ma_engine_get_sample_rate(&p->engine)));
+        // The frames are counted at the rate of the file, which is only
+        // known once it has been opened
+        ma_uint32 sampleRate = 0;
+        if (ma_sound_get_data_format(&p->sound, nullptr, nullptr, &sampleRate, nullptr, 0) != MA_SUCCESS || sampleRate == 0)
+            sampleRate = ma_engine_get_sample_rate(p->engine->get());
+
+        ma_result result = ma_sound_seek_to_pcm_frame(&p->sound, static_cast<ma_uint64>(seconds * sampleRate));
         if (result != MA_SUCCESS)
         {
             GetLogger()->error("Failed to seek to {}", seconds);
@@ -185,25 +279,30 @@ bool MiniAudioSession::startEngine()
     if (p->state >= MiniAudioSessionPrivate::State::EngineStarted)
         return true;
 
-    auto config = ma_context_config_init();
-    // on iOS, explicitly set the correct category for correct routing
-    config.coreaudio.sessionCategory = ma_ios_session_category_playback;
-    ma_result result = ma_context_init(nullptr, 0, &config, &p->context);
-    if (result != MA_SUCCESS)
-    {
-        GetLogger()->error("Failed to init miniaudio context");
+    p->engine = MiniAudioEngine::acquire();
+    if (p->engine == nullptr)
         return false;
-    }
-    auto engineConfig = ma_engine_config_init();
-    engineConfig.pContext = &p->context;
-    result = ma_engine_init(&engineConfig, &p->engine);
+
+    p->state = MiniAudioSessionPrivate::State::EngineStarted;
+    return true;
+}
+
+bool MiniAudioSession::initSound(bool decode)
+{
+    ma_uint32 flags = MA_SOUND_FLAG_ASYNC;
+    if (decode)
+        flags |= MA_SOUND_FLAG_DECODE;
+
+    ma_result result = ma_sound_init_from_file(p->engine->get(), path().string().c_str(), flags, nullptr, nullptr, &p->sound);
     if (result != MA_SUCCESS)
     {
-        ma_context_uninit(&p->context);
-        GetLogger()->error("Failed to start miniaudio engine");
+        GetLogger()->error("Failed to load sound file {}", path());
         return false;
     }
-    p->state = MiniAudioSessionPrivate::State::EngineStarted;
+    ma_sound_set_volume(&p->sound, volume());
+    ma_sound_set_pan(&p->sound, pan());
+    ma_sound_set_looping(&p->sound, loop() ? MA_TRUE : MA_FALSE);
+    p->state = MiniAudioSessionPrivate::State::SoundInitialzied;
     return true;
 }
 
@@ -20,6 +20,7 @@ class MiniAudioSession: public AudioSession
     MiniAudioSession &operator=(const MiniAudioSession&) = delete;
     MiniAudioSession &operator=(MiniAudioSession&&) = delete;
 
+    bool preload() override;
     bool play(double startTime) override;
     bool isPlaying() const override;
     void stop() override;
@@ -34,6 +35,7 @@ class MiniAudioSession: public AudioSession
     std::unique_ptr<MiniAudioSessionPrivate> p  { nullptr };
 
     bool startEngine();
+    bool initSound(bool decode);
 };
 
 }
@@ -0,0 +1,96 @@
+// netsocket.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Thin wrapper over the differences between BSD and Windows sockets.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace celestia::net
+{
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr SocketHandle InvalidSocket = INVALID_SOCKET;
+
+// Windows sockets must be initialized by each user, and cleaned up as
+// many times as they were initialized
+inline bool
+startup()
+{
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+}
+
+inline void
+cleanup()
+{
+    WSACleanup();
+}
+
+inline void
+closeSocket(SocketHandle s)
+{
+    closesocket(s);
+}
+
+inline int
+pollSockets(pollfd* fds, std::size_t count, int timeout)
+{
+    return WSAPoll(fds, static_cast<ULONG>(count), timeout);
+}
+#else
+using SocketHandle = int;
+constexpr SocketHandle InvalidSocket = -1;
+
+inline bool
+startup()
+{
+    return true;
+}
+
+inline void
+cleanup()
+{
+    // nothing to do
+}
+
+inline void
+closeSocket(SocketHandle s)
+{
+    close(s);
+}
+
+inline int
+pollSockets(pollfd* fds, std::size_t count, int timeout)
+{
+    return poll(fds, static_cast<nfds_t>(count), timeout);
+}
+#endif
+
+// Don't raise SIGPIPE when a peer has gone away
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+} // end namespace celestia::net
@@ -300,6 +300,9 @@ CelestiaAppWindow::init(const CelestiaCommandLineOptions& options)
         m_appCore->setLogFile(fn);
     }
 
+    if (!options.traceFilename.isEmpty())
+        m_appCore->setStartupTraceFile(options.traceFilename.toUtf8().data());
+
     if (!m_appCore->initSimulation(configFileName,
                                    extrasDirectories,
                                    progress))
@@ -758,7 +761,10 @@ CelestiaAppWindow::slotCaptureVideo()
             movieCapture->setVideoCodec(vc);
             movieCapture->setBitRate(br);
             if (vc == AV_CODEC_ID_H264)
+            {
                 movieCapture->setEncoderOptions(m_appCore->getConfig()->x264EncoderOptions);
+                movieCapture->setHardwareEncoder(m_appCore->getConfig()->videoHardwareEncoder);
+            }
             else
                 movieCapture->setEncoderOptions(m_appCore->getConfig()->ffvhEncoderOptions);
 
@@ -1297,6 +1303,18 @@ CelestiaAppWindow::slotShowGLInfo()
         out << "<br>\n";
     }
 
+    if (info.count("TextureMemory") > 0 && info.count("TexturesLoaded") > 0)
+    {
+        out << QString(_("<b>Texture memory:</b> %1 MiB in %2 textures")).arg(info["TextureMemory"].c_str(), info["TexturesLoaded"].c_str());
+        out << "<br>\n";
+    }
+
+    if (info.count("ModelMemory") > 0 && info.count("ModelsLoaded") > 0)
+    {
+        out << QString(_("<b>Model memory:</b> %1 MiB in %2 models")).arg(info["ModelMemory"].c_str(), info["ModelsLoaded"].c_str());
+        out << "<br>\n";
+    }
+
 
     out << "<br>\n";
 
@@ -13,9 +13,12 @@
 #include "qtcelestialbrowser.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <numeric>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <Eigen/Core>
@@ -26,6 +29,7 @@
 #include <QAbstractTableModel>
 #include <QCheckBox>
 #include <QCollator>
+#include <QCollatorSortKey>
 #include <QColor>
 #include <QComboBox>
 #include <QGridLayout>
@@ -116,7 +120,7 @@ public:
     Selection itemAtRow(unsigned int row) const;
 
 private:
-    bool compareByName(const engine::StarBrowserRecord&, const engine::StarBrowserRecord&) const;
+    void sortByName(Qt::SortOrder);
     bool compareByDistance(const engine::StarBrowserRecord&, const engine::StarBrowserRecord&) const;
     bool compareByAppMag(const engine::StarBrowserRecord&, const engine::StarBrowserRecord&) const;
     bool compareByAbsMag(const engine::StarBrowserRecord&, const engine::StarBrowserRecord&) const;
@@ -260,12 +264,27 @@ CelestialBrowser::StarTableModel::itemForInfoPanel(const QModelIndex& _index)
     return sel;
 }
 
-bool
-CelestialBrowser::StarTableModel::compareByName(const engine::StarBrowserRecord& lhs,
-                                                const engine::StarBrowserRecord& rhs) const
+// Look up and collate each name once rather than once per comparison
+void
+CelestialBrowser::StarTableModel::sortByName(Qt::SortOrder order)
 {
-    return coll.compare(QString::fromUtf8(universe->getStarCatalog()->getStarName(*lhs.star, true).c_str()),
-                        QString::fromUtf8(universe->getStarCatalog()->getStarName(*rhs.star, true).c_str())) < 0;
+    std::vector<QCollatorSortKey> keys;
+    keys.reserve(records.size());
+    for (const engine::StarBrowserRecord& record : records)
+        keys.push_back(coll.sortKey(QString::fromStdString(universe->getStarCatalog()->getStarName(*record.star, true))));
+
+    std::vector<std::uint32_t> rows(records.size());
+    std::iota(rows.begin(), rows.end(), 0U);
+    std::sort(rows.begin(), rows.end(),
+              [&keys](std::uint32_t a, std::uint32_t b) { return keys[a].compare(keys[b]) < 0; });
+    if (order == Qt::DescendingOrder)
+        std::reverse(rows.begin(), rows.end());
+
+    std::vector<engine::StarBrowserRecord> sorted;
+    sorted.reserve(records.size());
+    for (std::uint32_t row : rows)
+        sorted.push_back(records[row]);
+    records = std::move(sorted);
 }
 
 bool
@@ -307,8 +326,9 @@ CelestialBrowser::StarTableModel::sort(int column, Qt::SortOrder order)
     switch (column)
     {
     case NameColumn:
-        compareFn = &StarTableModel::compareByName;
-        break;
+        sortByName(order);
+        dataChanged(index(0, 0), index(static_cast<int>(records.size() - 1), 4));
+        return;
     case DistanceColumn:
         compareFn = &StarTableModel::compareByDistance;
         break;
@@ -22,6 +22,7 @@ CelestiaCommandLineOptions ParseCommandLine(const QCoreApplication& app)
         { { "s", "nosplash" }, _("Skip the splash screen.") },
         { { "u", "url" }, _("Set the start cel:// URL or startup script path."), _("url") },
         { { "l", "log" }, _("Set the path to the log file."), _("logpath") },
+        { "trace", _("Write the time spent in the startup stages to a trace file."), _("tracepath") },
     });
 
     parser.process(app);
@@ -50,6 +51,10 @@ CelestiaCommandLineOptions ParseCommandLine(const QCoreApplication& app)
     if (!options.startURL.isEmpty() && !options.startURL.startsWith("cel:"))
         options.startURL = currentDirectory.absoluteFilePath(options.startURL);
 
+    options.traceFilename = parser.value("trace");
+    if (!options.traceFilename.isEmpty())
+        options.traceFilename = currentDirectory.absoluteFilePath(options.traceFilename);
+
     // logFilename is processed before the directory change
     options.logFilename = parser.value("log");
 
@@ -22,6 +22,7 @@ namespace celestia::qt
 struct CelestiaCommandLineOptions
 {
     QString logFilename{ };
+    QString traceFilename{ };
     QString startDirectory{ };
     QStringList extrasDirectories{ };
     QString startURL{ };
@@ -14,6 +14,8 @@
 
 #include <algorithm>
 #include <cstring>
+#include <limits>
+#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,6 +28,7 @@
 #include <QAbstractTableModel>
 #include <QCheckBox>
 #include <QCollator>
+#include <QCollatorSortKey>
 #include <QColor>
 #include <QComboBox>
 #include <QGridLayout>
@@ -117,6 +120,12 @@ public:
 
     bool operator()(const DeepSkyObject* dso0, const DeepSkyObject* dso1) const;
 
+    // The distance and brightness criteria order DSOs by a numeric key,
+    // which can be bounded for the DSOs of an octree node
+    bool hasKey() const;
+    double key(const DeepSkyObject* dso) const;
+    double nodeKey(const Eigen::Vector3d& center, double size, float brightFactor) const;
+
 private:
     Criterion criterion;
     Eigen::Vector3d pos;
@@ -140,19 +149,9 @@ DSOPredicate::operator()(const DeepSkyObject* dso0, const DeepSkyObject* dso1) c
     switch (criterion)
     {
     case Distance:
-        return ((pos - dso0->getPosition()).squaredNorm() <
-                (pos - dso1->getPosition()).squaredNorm());
-
     case Brightness:
-        {
-            double d0 = (pos - dso0->getPosition()).norm();
-            double d1 = (pos - dso1->getPosition()).norm();
-            return astro::absToAppMag((double) dso0->getAbsoluteMagnitude(), d0) <
-                   astro::absToAppMag((double) dso1->getAbsoluteMagnitude(), d1);
-        }
-
     case IntrinsicBrightness:
-        return dso0->getAbsoluteMagnitude() < dso1->getAbsoluteMagnitude();
+        return key(dso0) < key(dso1);
 
     case ObjectType:
         return std::strcmp(dso0->getType(), dso1->getType()) < 0;
@@ -166,12 +165,136 @@ DSOPredicate::operator()(const DeepSkyObject* dso0, const DeepSkyObject* dso1) c
     }
 }
 
+bool
+DSOPredicate::hasKey() const
+{
+    return criterion == Distance || criterion == Brightness || criterion == IntrinsicBrightness;
+}
+
+double
+DSOPredicate::key(const DeepSkyObject* dso) const
+{
+    switch (criterion)
+    {
+    case Distance:
+        return (pos - dso->getPosition()).squaredNorm();
+
+    case Brightness:
+        return astro::absToAppMag((double) dso->getAbsoluteMagnitude(), (pos - dso->getPosition()).norm());
+
+    case IntrinsicBrightness:
+        return dso->getAbsoluteMagnitude();
+
+    default:
+        return 0.0;
+    }
+}
+
+double
+DSOPredicate::nodeKey(const Eigen::Vector3d& center, double size, float brightFactor) const
+{
+    double distance = ((pos - center).cwiseAbs().array() - size).max(0.0).matrix().norm();
+    switch (criterion)
+    {
+    case Distance:
+        return distance * distance;
+
+    case Brightness:
+        // No DSO of the node is brighter than its brightest one at the
+        // nearest distance
+        return distance > 0.0
+            ? astro::absToAppMag((double) brightFactor, distance)
+            : -std::numeric_limits<double>::infinity();
+
+    case IntrinsicBrightness:
+        return brightFactor;
+
+    default:
+        return -std::numeric_limits<double>::infinity();
+    }
+}
+
+// Keeps the best DSOs found by a best-first search of the DSO octree in a
+// heap whose front is the worst of them
+class DSOCollector
+{
+public:
+    DSOCollector(std::vector<DeepSkyObject*>& dsos,
+                 const DSOFilterPredicate& filter,
+                 const DSOPredicate& comparison,
+                 unsigned int nDSOs,
+                 const engine::DSOOctree& octree) :
+        m_dsos(dsos), m_filter(filter), m_comparison(comparison), m_nDSOs(nDSOs), m_octree(octree)
+    {
+    }
+
+    double nodeKey(const Eigen::Vector3d& center, double size, float brightFactor) const
+    {
+        return m_comparison.nodeKey(center, size, brightFactor);
+    }
+
+    bool acceptKey(double key) const
+    {
+        return m_dsos.size() < m_nDSOs || key < m_worstKey;
+    }
+
+    void process(engine::OctreeObjectIndex index);
+
+private:
+    std::vector<DeepSkyObject*>& m_dsos;
+    const DSOFilterPredicate& m_filter;
+    const DSOPredicate& m_comparison;
+    unsigned int m_nDSOs;
+    const engine::DSOOctree& m_octree;
+    double m_worstKey{ std::numeric_limits<double>::infinity() };
+};
+
+void
+DSOCollector::process(engine::OctreeObjectIndex index)
+{
+    DeepSkyObject* dso = m_octree[index].get();
+    if (!m_filter(dso))
+        return;
+
+    if (m_dsos.size() < m_nDSOs)
+    {
+        m_dsos.push_back(dso);
+        std::push_heap(m_dsos.begin(), m_dsos.end(), m_comparison);
+    }
+    else if (m_comparison(dso, m_dsos.front()))
+    {
+        std::pop_heap(m_dsos.begin(), m_dsos.end(), m_comparison);
+        m_dsos.back() = dso;
+        std::push_heap(m_dsos.begin(), m_dsos.end(), m_comparison);
+    }
+    else
+    {
+        return;
+    }
+
+    if (m_dsos.size() == m_nDSOs)
+        m_worstKey = m_comparison.key(m_dsos.front());
+}
+
 void populateDsoVector(std::vector<DeepSkyObject*>& dsos,
                        const DSODatabase& dsodb,
                        const DSOFilterPredicate& filter,
                        const DSOPredicate& comparison,
                        unsigned int nDSOs)
 {
+    if (nDSOs == 0)
+        return;
+
+    if (comparison.hasKey())
+    {
+        // Only the octree nodes which may hold DSOs better than the worst
+        // one found so far are visited, nearest or brightest first
+        DSOCollector collector(dsos, filter, comparison, nDSOs, dsodb.getOctree());
+        dsodb.getOctree().processBestFirst(collector);
+        std::sort_heap(dsos.begin(), dsos.end(), comparison);
+        return;
+    }
+
     const std::uint32_t size = dsodb.size();
     std::uint32_t index = 0;
 
@@ -388,10 +511,44 @@ DeepSkyBrowser::DSOTableModel::sort(int column, Qt::SortOrder order)
 
     DSOPredicate pred(criterion, observerPos, universe);
 
-    std::sort(dsos.begin(), dsos.end(), pred);
+    // The names and magnitudes are computed once per row rather than once
+    // per comparison
+    std::vector<std::uint32_t> rows(dsos.size());
+    std::iota(rows.begin(), rows.end(), 0U);
+    if (criterion == DSOPredicate::Alphabetical)
+    {
+        QCollator coll;
+        coll.setNumericMode(true);
+        std::vector<QCollatorSortKey> keys;
+        keys.reserve(dsos.size());
+        for (const DeepSkyObject* dso : dsos)
+            keys.push_back(coll.sortKey(QString::fromStdString(universe->getDSOCatalog()->getDSOName(dso, true))));
+        std::sort(rows.begin(), rows.end(),
+                  [&keys](std::uint32_t a, std::uint32_t b) { return keys[a].compare(keys[b]) < 0; });
+    }
+    else if (pred.hasKey())
+    {
+        std::vector<double> keys;
+        keys.reserve(dsos.size());
+        for (const DeepSkyObject* dso : dsos)
+            keys.push_back(pred.key(dso));
+        std::sort(rows.begin(), rows.end(),
+                  [&keys](std::uint32_t a, std::uint32_t b) { return keys[a] < keys[b]; });
+    }
+    else
+    {
+        std::sort(rows.begin(), rows.end(),
+                  [this, &pred](std::uint32_t a, std::uint32_t b) { return pred(dsos[a], dsos[b]); });
+    }
 
     if (order == Qt::DescendingOrder)
-        std::reverse(dsos.begin(), dsos.end());
+        std::reverse(rows.begin(), rows.end());
+
+    std::vector<DeepSkyObject*> sorted;
+    sorted.reserve(dsos.size());
+    for (std::uint32_t row : rows)
+        sorted.push_back(dsos[row]);
+    dsos = std::move(sorted);
 
     dataChanged(index(0, 0), index(dsos.size() - 1, 4));
 }
@@ -403,7 +560,7 @@ DeepSkyBrowser::DSOTableModel::populate(const UniversalCoord& _observerPos,
                                         unsigned int nDSOs)
 {
     showType = filterPred.objectType == DeepSkyObjectType::Galaxy;
-    const DSODatabase& dsodb = *universe->getDSOCatalog();
+    const DSODatabase* dsodb = universe->getDSOCatalog();
 
     observerPos = _observerPos.offsetFromKm(UniversalCoord::Zero()) * astro::kilometersToLightYears(1.0);
 
@@ -417,8 +574,12 @@ DeepSkyBrowser::DSOTableModel::populate(const UniversalCoord& _observerPos,
         endResetModel();
     }
 
+    // The catalogs may still be loading in the background
+    if (dsodb == nullptr)
+        return;
+
     dsos.reserve(nDSOs);
-    populateDsoVector(dsos, dsodb, filterPred, pred, nDSOs);
+    populateDsoVector(dsos, *dsodb, filterPred, pred, nDSOs);
 
     beginInsertRows(QModelIndex(), 0, static_cast<int>(dsos.size()));
     endInsertRows();
@@ -27,10 +27,13 @@
 #include <QAbstractTableModel>
 #include <QAction>
 #include <QApplication>
+#include <QChar>
 #include <QComboBox>
 #include <QDate>
 #include <QDateEdit>
 #include <QDateTime>
+#include <QDoubleSpinBox>
+#include <QFormLayout>
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLatin1Char>
@@ -52,10 +55,14 @@
 #include <celengine/observer.h>
 #include <celengine/selection.h>
 #include <celengine/simulation.h>
+#include <celengine/star.h>
+#include <celengine/stardb.h>
 #include <celengine/univcoord.h>
+#include <celengine/universe.h>
 #include <celestia/celestiacore.h>
 #include <celmath/geomutil.h>
 #include <celmath/intersect.h>
+#include <celmath/mathlib.h>
 #include <celmath/sphere.h>
 #include <celutil/gettext.h>
 
@@ -75,6 +82,19 @@ constexpr std::array planets =
     N_("Pluto"),
 };
 
+// Bodies searched for conjunctions and occultations as seen from Earth
+constexpr std::array conjunctionBodies =
+{
+    "Sol/Earth/Moon",
+    "Sol/Mercury",
+    "Sol/Venus",
+    "Sol/Mars",
+    "Sol/Jupiter",
+    "Sol/Saturn",
+    "Sol/Uranus",
+    "Sol/Neptune",
+};
+
 // Find the point of maximum eclipse, either the intersection of the eclipsed body with the
 // ray from sun to occluder, or the nearest point to that ray if there is no intersection.
 // The returned point is relative to the center of the eclipsed body. Note that this function
@@ -259,6 +279,138 @@ EventFinder::EventTableModel::eclipseAtIndex(const QModelIndex& index) const
         return nullptr;
 }
 
+class EventFinder::CelestialEventTableModel : public QAbstractTableModel
+{
+public:
+    CelestialEventTableModel() = default;
+    ~CelestialEventTableModel() override = default;
+
+    // Methods from QAbstractTableModel
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    int rowCount(const QModelIndex& index) const override;
+    int columnCount(const QModelIndex& index) const override;
+
+    void setEvents(const std::vector<CelestialEvent>& events, const StarDatabase* stars);
+
+    const CelestialEvent* eventAtIndex(const QModelIndex& index) const;
+
+    enum
+    {
+        TypeColumn       = 0,
+        ForegroundColumn = 1,
+        BackgroundColumn = 2,
+        PeakTimeColumn   = 3,
+        SeparationColumn = 4,
+    };
+
+private:
+    struct Row
+    {
+        CelestialEvent event;
+        QString foreground;
+        QString background;
+    };
+
+    std::vector<Row> rows;
+};
+
+QVariant
+EventFinder::CelestialEventTableModel::data(const QModelIndex& index, int role) const
+{
+    if (role != Qt::DisplayRole || index.row() < 0 || index.row() >= (int) rows.size())
+        return QVariant();
+
+    const Row& row = rows[index.row()];
+
+    switch (index.column())
+    {
+    case TypeColumn:
+        switch (row.event.type)
+        {
+        case CelestialEvent::Occultation:
+            return QString(_("Occultation"));
+        case CelestialEvent::Transit:
+            return QString(_("Transit"));
+        default:
+            return QString(_("Conjunction"));
+        }
+    case ForegroundColumn:
+        return row.foreground;
+    case BackgroundColumn:
+        return row.background;
+    case PeakTimeColumn:
+        return TDBToQString(row.event.peakTime);
+    case SeparationColumn:
+        return QString::number(math::radToDeg(row.event.separation), 'f', 3) + QChar(0x00b0);
+    default:
+        return QVariant();
+    }
+}
+
+QVariant
+EventFinder::CelestialEventTableModel::headerData(int section, Qt::Orientation /*unused*/, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (section)
+    {
+    case TypeColumn:
+        return QString(_("Event"));
+    case ForegroundColumn:
+        return QString(_("Foreground"));
+    case BackgroundColumn:
+        return QString(_("Background"));
+    case PeakTimeColumn:
+        return QString(_("Time"));
+    case SeparationColumn:
+        return QString(_("Separation"));
+    default:
+        return QVariant();
+    }
+}
+
+int
+EventFinder::CelestialEventTableModel::rowCount(const QModelIndex& /*unused*/) const
+{
+    return (int) rows.size();
+}
+
+int
+EventFinder::CelestialEventTableModel::columnCount(const QModelIndex& /*unused*/) const
+{
+    return 5;
+}
+
+void
+EventFinder::CelestialEventTableModel::setEvents(const std::vector<CelestialEvent>& events,
+                                                 const StarDatabase* stars)
+{
+    auto name = [stars](const Selection& sel)
+    {
+        if (sel.star() != nullptr)
+            return QString::fromStdString(stars->getStarName(*sel.star(), true));
+        return QString::fromStdString(sel.body()->getName(true));
+    };
+
+    beginResetModel();
+    rows.clear();
+    for (const CelestialEvent& event : events)
+        rows.push_back({ event, name(event.foreground), name(event.background) });
+    endResetModel();
+}
+
+const CelestialEvent*
+EventFinder::CelestialEventTableModel::eventAtIndex(const QModelIndex& index) const
+{
+    int row = index.row();
+    if (row >= 0 && row < (int) rows.size())
+        return &rows[row].event;
+    else
+        return nullptr;
+}
+
 EventFinder::EventFinder(CelestiaCore* _appCore,
                          const QString& title,
                          QWidget* parent) :
@@ -324,6 +476,40 @@ EventFinder::EventFinder(CelestiaCore* _appCore,
     connect(findButton, SIGNAL(clicked()), this, SLOT(slotFindEclipses()));
     layout->addWidget(findButton);
 
+    // Conjunctions and occultations seen from Earth, over the same range
+    QGroupBox* conjunctionBox = new QGroupBox(_("Conjunctions and occultations"));
+    QVBoxLayout* conjunctionLayout = new QVBoxLayout();
+
+    conjunctionTable = new QTreeView();
+    conjunctionTable->setRootIsDecorated(false);
+    conjunctionTable->setAlternatingRowColors(true);
+    conjunctionTable->setItemsExpandable(false);
+    conjunctionTable->setUniformRowHeights(true);
+    connect(conjunctionTable, SIGNAL(activated(const QModelIndex&)),
+            this, SLOT(slotSetEventTime(const QModelIndex&)));
+    conjunctionLayout->addWidget(conjunctionTable);
+
+    QFormLayout* conjunctionForm = new QFormLayout();
+    separationEdit = new QDoubleSpinBox();
+    separationEdit->setRange(0.0, 10.0);
+    separationEdit->setSingleStep(0.1);
+    separationEdit->setSuffix(QString(QChar(0x00b0)));
+    separationEdit->setValue(1.0);
+    conjunctionForm->addRow(_("Maximum separation"), separationEdit);
+    magnitudeEdit = new QDoubleSpinBox();
+    magnitudeEdit->setRange(-2.0, 8.0);
+    magnitudeEdit->setSingleStep(0.5);
+    magnitudeEdit->setValue(4.0);
+    conjunctionForm->addRow(_("Faintest occulted star"), magnitudeEdit);
+    conjunctionLayout->addLayout(conjunctionForm);
+
+    QPushButton* findConjunctionsButton = new QPushButton(_("Find conjunctions"));
+    connect(findConjunctionsButton, SIGNAL(clicked()), this, SLOT(slotFindConjunctions()));
+    conjunctionLayout->addWidget(findConjunctionsButton);
+
+    conjunctionBox->setLayout(conjunctionLayout);
+    layout->addWidget(conjunctionBox);
+
     finderWidget->setLayout(layout);
 
     // Set default values:
@@ -337,11 +523,27 @@ EventFinder::EventFinder(CelestiaCore* _appCore,
     model = new EventTableModel();
     eventTable->setModel(model);
 
+    conjunctionModel = new CelestialEventTableModel();
+    conjunctionTable->setModel(conjunctionModel);
+
     this->setWidget(finderWidget);
 }
 
 EclipseFinderWatcher::Status
 EventFinder::eclipseFinderProgressUpdate(double t)
+{
+    return progressUpdate(t) ? EclipseFinderWatcher::AbortOperation : EclipseFinderWatcher::ContinueOperation;
+}
+
+EventSearchWatcher::Status
+EventFinder::eventSearchProgressUpdate(double t)
+{
+    return progressUpdate(t) ? EventSearchWatcher::AbortOperation : EventSearchWatcher::ContinueOperation;
+}
+
+// Update the progress dialog, and return true if the search was canceled
+bool
+EventFinder::progressUpdate(double t)
 {
     if (progress != nullptr)
     {
@@ -356,9 +558,9 @@ EventFinder::eclipseFinderProgressUpdate(double t)
             lastProgressUpdate = t;
         }
 
-        return progress->wasCanceled() ? AbortOperation : ContinueOperation;
+        return progress->wasCanceled();
     }
-    return EclipseFinderWatcher::ContinueOperation;
+    return false;
 }
 
 void
@@ -421,6 +623,83 @@ EventFinder::slotFindEclipses()
     eventTable->resizeColumnToContents(EventTableModel::StartTimeColumn);
 }
 
+void
+EventFinder::slotFindConjunctions()
+{
+    Simulation* sim = appCore->getSimulation();
+    Selection earth = sim->findObjectFromPath("Sol/Earth");
+    if (earth.body() == nullptr)
+        return;
+
+    std::vector<const Body*> bodies;
+    for (const char* path : conjunctionBodies)
+    {
+        Selection obj = sim->findObjectFromPath(path);
+        if (obj.body() != nullptr)
+            bodies.push_back(obj.body());
+    }
+
+    QDate startDate = startDateEdit->date();
+    QDate endDate = endDateEdit->date();
+
+    if (startDate > endDate)
+    {
+        QMessageBox::critical(this, _("Event Finder"),
+                              _("End date is earlier than start date."));
+        return;
+    }
+
+    const StarDatabase* stars = sim->getUniverse()->getStarCatalog();
+    EventSearch search(earth.body(), stars, this);
+    searchTimer.start();
+
+    double startTimeTDB = QDateToTDB(startDate);
+    double endTimeTDB = QDateToTDB(endDate);
+
+    searchSpan = endTimeTDB - startTimeTDB;
+    lastProgressUpdate = startTimeTDB;
+
+    progress = new QProgressDialog(_("Finding conjunctions..."), "Abort", (int) startTimeTDB, (int) endTimeTDB, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->show();
+
+    std::vector<CelestialEvent> events;
+    search.findBodyEvents(bodies, startTimeTDB, endTimeTDB,
+                          math::degToRad(separationEdit->value()),
+                          CelestialEvent::Conjunction | CelestialEvent::Occultation | CelestialEvent::Transit,
+                          events);
+
+    if (!progress->wasCanceled())
+    {
+        progress->setLabelText(_("Finding star occultations..."));
+        std::vector<CelestialEvent> occultations;
+        search.findStarOccultations(bodies, startTimeTDB, endTimeTDB,
+                                    static_cast<float>(magnitudeEdit->value()),
+                                    occultations);
+
+        std::size_t first = events.size();
+        events.insert(events.end(), occultations.begin(), occultations.end());
+        std::inplace_merge(events.begin(), events.begin() + first, events.end(),
+                           [](const CelestialEvent& e0, const CelestialEvent& e1) { return e0.peakTime < e1.peakTime; });
+    }
+
+    delete progress;
+    progress = nullptr;
+
+    conjunctionModel->setEvents(events, stars);
+
+    for (int column = 0; column < conjunctionModel->columnCount(QModelIndex()); column++)
+        conjunctionTable->resizeColumnToContents(column);
+}
+
+void
+EventFinder::slotSetEventTime(const QModelIndex& index)
+{
+    const CelestialEvent* event = conjunctionModel->eventAtIndex(index);
+    if (event != nullptr)
+        appCore->getSimulation()->setTime(event->peakTime);
+}
+
 void
 EventFinder::slotContextMenu(const QPoint& pos)
 {
@@ -16,10 +16,13 @@
 #include <QElapsedTimer>
 
 #include <celestia/eclipsefinder.h>
+#include <celestia/eventsearch.h>
 
 class QComboBox;
 class QDateEdit;
+class QDoubleSpinBox;
 class QMenu;
+class QModelIndex;
 class QPoint;
 class QProgressDialog;
 class QRadioButton;
@@ -32,7 +35,7 @@ class CelestiaCore;
 namespace celestia::qt
 {
 
-class EventFinder : public QDockWidget, EclipseFinderWatcher
+class EventFinder : public QDockWidget, EclipseFinderWatcher, EventSearchWatcher
 {
     Q_OBJECT
 
@@ -41,9 +44,12 @@ public:
     ~EventFinder() = default;
 
     EclipseFinderWatcher::Status eclipseFinderProgressUpdate(double t);
+    EventSearchWatcher::Status eventSearchProgressUpdate(double t);
 
 public slots:
     void slotFindEclipses();
+    void slotFindConjunctions();
+    void slotSetEventTime(const QModelIndex&);
     void slotContextMenu(const QPoint&);
 
     void slotSetEclipseTime();
@@ -54,6 +60,9 @@ public slots:
 
 private:
     class EventTableModel;
+    class CelestialEventTableModel;
+
+    bool progressUpdate(double t);
 
     CelestiaCore* appCore;
 
@@ -70,6 +79,11 @@ private:
     QTreeView* eventTable{ nullptr };
     QMenu* contextMenu{ nullptr };
 
+    QDoubleSpinBox* separationEdit{ nullptr };
+    QDoubleSpinBox* magnitudeEdit{ nullptr };
+    CelestialEventTableModel* conjunctionModel{ nullptr };
+    QTreeView* conjunctionTable{ nullptr };
+
     QProgressDialog* progress{ nullptr };
     double searchSpan{ 0.0 };
     double lastProgressUpdate{ 0.0 };
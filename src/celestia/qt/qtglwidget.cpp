@@ -153,6 +153,7 @@ CelestiaGlWidget::initializeGL()
 
     appRenderer->setSolarSystemMaxDistance(appCore->getConfig()->renderDetails.SolarSystemMaxDistance);
     appRenderer->setShadowMapSize(appCore->getConfig()->renderDetails.ShadowMapSize);
+    appRenderer->setStaticStarBuffer(appCore->getConfig()->renderDetails.staticStarBuffer);
 }
 
 void
@@ -168,23 +168,26 @@ private:
         int nChildren{0};
         int childIndex{0};
         BodyClassification classification{BodyClassification::EmptyMask};
+        // The children are created when the view first asks for them
+        bool populated{false};
     };
 
-    TreeItem* createTreeItem(Selection sel, TreeItem* parent, int childIndex);
+    TreeItem* createTreeItem(Selection sel, TreeItem* parent, int childIndex) const;
+    void populateChildren(TreeItem* item) const;
     void addTreeItemChildren(TreeItem* item,
                              const PlanetarySystem* sys,
-                             util::array_view<Star*> orbitingStars);
+                             util::array_view<Star*> orbitingStars) const;
     void addTreeItemChildrenFiltered(TreeItem* item,
                                      const PlanetarySystem* sys,
-                                     util::array_view<Star*> orbitingStars);
+                                     util::array_view<Star*> orbitingStars) const;
     void addTreeItemChildrenGrouped(TreeItem* item,
                                     const PlanetarySystem* sys,
                                     util::array_view<Star*> orbitingStars,
-                                    Selection parent);
+                                    Selection parent) const;
     TreeItem* createGroupTreeItem(BodyClassification classification,
                                   const std::vector<Body*>& objects,
                                   TreeItem* parent,
-                                  int childIndex);
+                                  int childIndex) const;
 
     TreeItem* itemAtIndex(const QModelIndex& index) const;
 
@@ -225,6 +228,7 @@ SolarSystemBrowser::SolarSystemTreeModel::buildModel(Star* star, bool _groupByCl
 
     rootItem = new TreeItem();
     rootItem->obj = Selection();
+    rootItem->populated = true;
 
     if (star != nullptr)
     {
@@ -243,17 +247,28 @@ SolarSystemBrowser::SolarSystemTreeModel::buildModel(Star* star, bool _groupByCl
 // way than it's represented internally, e.g. to group objects by
 // their classification. It also simplifies the code because stars
 // and solar system bodies can be treated almost identically once
-// the new tree is built.
+// the new tree is built. Only the items the view asks for are built, so
+// systems with many thousands of small bodies don't stall the browser.
 SolarSystemBrowser::SolarSystemTreeModel::TreeItem*
 SolarSystemBrowser::SolarSystemTreeModel::createTreeItem(Selection sel,
                                                          TreeItem* parent,
-                                                         int childIndex)
+                                                         int childIndex) const
 {
     auto* item = new TreeItem();
     item->parent = parent;
     item->obj = sel;
     item->childIndex = childIndex;
+    return item;
+}
 
+void
+SolarSystemBrowser::SolarSystemTreeModel::populateChildren(TreeItem* item) const
+{
+    if (item->populated)
+        return;
+
+    item->populated = true;
+    Selection sel = item->obj;
     util::array_view<Star*> orbitingStars;
 
     const PlanetarySystem* sys = nullptr;
@@ -280,14 +295,12 @@ SolarSystemBrowser::SolarSystemTreeModel::createTreeItem(Selection sel,
         addTreeItemChildrenFiltered(item, sys, orbitingStars);
     else
         addTreeItemChildren(item, sys, orbitingStars);
-
-    return item;
 }
 
 void
 SolarSystemBrowser::SolarSystemTreeModel::addTreeItemChildren(TreeItem* item,
                                                               const PlanetarySystem* sys,
-                                                              util::array_view<Star*> orbitingStars)
+                                                              util::array_view<Star*> orbitingStars) const
 {
     // Calculate the number of children: the number of orbiting stars plus
     // the number of orbiting solar system bodies.
@@ -323,7 +336,7 @@ SolarSystemBrowser::SolarSystemTreeModel::addTreeItemChildren(TreeItem* item,
 void
 SolarSystemBrowser::SolarSystemTreeModel::addTreeItemChildrenFiltered(TreeItem* item,
                                                                       const PlanetarySystem* sys,
-                                                                      util::array_view<Star*> orbitingStars)
+                                                                      util::array_view<Star*> orbitingStars) const
 {
     std::vector<Body*> bodies;
 
@@ -368,7 +381,7 @@ void
 SolarSystemBrowser::SolarSystemTreeModel::addTreeItemChildrenGrouped(TreeItem* item,
                                                                      const PlanetarySystem* sys,
                                                                      util::array_view<Star*> orbitingStars,
-                                                                     Selection parent)
+                                                                     Selection parent) const
 {
     std::vector<Body*> asteroids;
     std::vector<Body*> spacecraft;
@@ -530,12 +543,13 @@ SolarSystemBrowser::SolarSystemTreeModel::TreeItem*
 SolarSystemBrowser::SolarSystemTreeModel::createGroupTreeItem(BodyClassification classification,
                                                               const std::vector<Body*>& objects,
                                                               TreeItem* parent,
-                                                              int childIndex)
+                                                              int childIndex) const
 {
     auto* item = new TreeItem();
     item->parent = parent;
     item->childIndex = childIndex;
     item->classification = classification;
+    item->populated = true;
 
     if (!objects.empty())
     {
@@ -581,6 +595,7 @@ SolarSystemBrowser::SolarSystemTreeModel::index(int row, int column, const QMode
     else
         parentItem = static_cast<TreeItem*>(parent.internalPointer());
 
+    populateChildren(parentItem);
     if (row < parentItem->nChildren)
         return createIndex(row, column, parentItem->children[row]);
     else
@@ -683,7 +698,9 @@ SolarSystemBrowser::SolarSystemTreeModel::rowCount(const QModelIndex& parent) co
     if (!parent.isValid())
         return rootItem->nChildren;
 
-    return static_cast<TreeItem*>(parent.internalPointer())->nChildren;
+    auto* item = static_cast<TreeItem*>(parent.internalPointer());
+    populateChildren(item);
+    return item->nChildren;
 }
 
 // Override QAbstractDataModel::columnCount()
@@ -0,0 +1,418 @@
+// remotecontrol.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Network server which runs CEL commands sent by show control systems.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "remotecontrol.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include <celcompat/charconv.h>
+#include <celscript/legacy/cmdparser.h>
+#include <celscript/legacy/execenv.h>
+#include <celscript/legacy/execution.h>
+#include <celutil/logger.h>
+#include "celestiacore.h"
+#include "netsocket.h"
+
+using celestia::util::GetLogger;
+using namespace celestia::net;
+
+namespace celestia
+{
+
+namespace
+{
+
+// Time in milliseconds the I/O thread waits for the sockets before it
+// checks for replies to send and for the server to be stopped
+constexpr int PollInterval = 5;
+
+// Longest request accepted; a client sending longer lines is dropped
+constexpr std::size_t MaxLineLength = 65536;
+
+struct Client
+{
+    SocketHandle socket;
+    int id;
+    std::string input;
+    std::string output;
+    bool authenticated{ false };
+};
+
+class RemoteExecutionEnvironment : public scripts::ExecutionEnvironment
+{
+ public:
+    explicit RemoteExecutionEnvironment(CelestiaCore& _core) : core(_core) {}
+
+    Simulation* getSimulation() const override
+    {
+        return core.getSimulation();
+    }
+
+    Renderer* getRenderer() const override
+    {
+        return core.getRenderer();
+    }
+
+    CelestiaCore* getCelestiaCore() const override
+    {
+        return &core;
+    }
+
+    void showText(std::string_view s, int horig, int vorig, int hoff, int voff,
+                  double duration) override
+    {
+        core.showText(s, horig, vorig, hoff, voff, duration);
+    }
+
+ private:
+    CelestiaCore& core;
+};
+
+std::string_view
+trim(std::string_view s)
+{
+    auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos)
+        return {};
+    auto last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+// Browsers can send a text/plain POST to a local port, so a first line
+// like "POST / HTTP/1.1" closes the connection whatever the token is
+bool
+isHttpRequestLine(std::string_view line)
+{
+    auto methodEnd = line.find(' ');
+    auto versionStart = line.rfind(' ');
+    if (methodEnd == 0 || methodEnd == std::string_view::npos || versionStart == methodEnd)
+        return false;
+
+    std::string_view method = line.substr(0, methodEnd);
+    return std::all_of(method.begin(), method.end(), [](char c) { return c >= 'A' && c <= 'Z'; }) &&
+           line.substr(versionStart + 1).substr(0, 5) == "HTTP/";
+}
+
+// Compare in a time which doesn't depend on where the strings differ
+bool
+isToken(std::string_view line, std::string_view token)
+{
+    if (line.size() != token.size())
+        return false;
+
+    unsigned char diff = 0;
+    for (std::size_t i = 0; i < line.size(); ++i)
+        diff |= static_cast<unsigned char>(line[i] ^ token[i]);
+    return diff == 0;
+}
+
+} // end unnamed namespace
+
+
+RemoteControl::RemoteControl(CelestiaCore& _appCore,
+                             std::intptr_t _listener,
+                             std::string_view _token,
+                             bool _allowFileWrites) :
+    appCore(_appCore),
+    env(std::make_unique<RemoteExecutionEnvironment>(_appCore)),
+    listener(_listener),
+    token(_token),
+    allowFileWrites(_allowFileWrites)
+{
+    thread = std::thread(&RemoteControl::run, this);
+}
+
+
+RemoteControl::~RemoteControl()
+{
+    stopRequested = true;
+    if (thread.joinable())
+        thread.join();
+
+    closeSocket(static_cast<SocketHandle>(listener));
+    cleanup();
+}
+
+
+std::unique_ptr<RemoteControl>
+RemoteControl::create(CelestiaCore& appCore,
+                      std::uint16_t port,
+                      std::string_view token,
+                      bool allowFileWrites)
+{
+    if (trim(token).empty())
+    {
+        GetLogger()->error("RemoteControlToken must be set to start the remote control\n");
+        return nullptr;
+    }
+
+    if (!startup())
+    {
+        GetLogger()->error("Failed to initialize the sockets for the remote control\n");
+        return nullptr;
+    }
+
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s != InvalidSocket)
+    {
+        int reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+        // Only local clients are accepted; they still have to send the
+        // token, as any local program or web page can connect
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0 &&
+            listen(s, SOMAXCONN) == 0)
+        {
+            GetLogger()->info("Remote control listening on port {}\n", port);
+            return std::unique_ptr<RemoteControl>(new RemoteControl(appCore,
+                                                                    static_cast<std::intptr_t>(s),
+                                                                    trim(token),
+                                                                    allowFileWrites));
+        }
+        closeSocket(s);
+    }
+
+    GetLogger()->error("Failed to open port {} for the remote control\n", port);
+    cleanup();
+    return nullptr;
+}
+
+
+void
+RemoteControl::tick(double dt)
+{
+    ++frame;
+
+    std::vector<Message> messages;
+    {
+        std::scoped_lock lock(mutex);
+        messages.swap(received);
+    }
+
+    for (const Message& message : messages)
+    {
+        std::string_view text = trim(message.text);
+        if (text.empty())
+            continue;
+
+        if (text == "frame")
+        {
+            reply(message.client, fmt::format("frame {}", frame));
+            continue;
+        }
+
+        Request request{ message.client, frame, {} };
+        if (text.front() == '@')
+        {
+            auto [ptr, ec] = compat::from_chars(text.data() + 1, text.data() + text.size(), request.frame);
+            if (ec != std::errc{})
+            {
+                reply(message.client, "error invalid frame number");
+                continue;
+            }
+            text.remove_prefix(static_cast<std::size_t>(ptr - text.data()));
+        }
+        request.commands = text;
+
+        if (request.frame <= frame)
+            startCommands(request);
+        else
+            scheduled.push_back(std::move(request));
+    }
+
+    // Start the scheduled requests which are due in the order they were
+    // received
+    auto due = std::stable_partition(scheduled.begin(), scheduled.end(),
+                                     [this](const Request& r) { return r.frame > frame; });
+    std::for_each(due, scheduled.end(), [this](const Request& r) { startCommands(r); });
+    scheduled.erase(due, scheduled.end());
+
+    running.erase(std::remove_if(running.begin(), running.end(),
+                                 [dt](const auto& execution) { return execution->tick(dt); }),
+                  running.end());
+}
+
+
+void
+RemoteControl::startCommands(const Request& request)
+{
+    std::istringstream in("{ " + request.commands + " }");
+    scripts::CommandParser parser(in, appCore.scriptMaps());
+    scripts::CommandSequence commands = parser.parse();
+    if (commands.empty())
+    {
+        auto errors = parser.getErrors();
+        reply(request.client, fmt::format("error {}", errors.empty() ? "no commands" : errors[0]));
+        return;
+    }
+
+    if (!allowFileWrites &&
+        std::any_of(commands.begin(), commands.end(), [](const auto& command) { return command->writesFiles(); }))
+    {
+        reply(request.client, "error commands writing files are disabled");
+        return;
+    }
+
+    auto execution = std::make_unique<scripts::Execution>(std::move(commands), *env);
+    // The first tick of an execution only starts its clock, so that the
+    // commands are run by the tick of this frame
+    execution->tick(0.0);
+    running.push_back(std::move(execution));
+    reply(request.client, fmt::format("ok {}", frame));
+}
+
+
+void
+RemoteControl::reply(int client, std::string&& text)
+{
+    std::scoped_lock lock(mutex);
+    replies.push_back({ client, std::move(text) });
+}
+
+
+void
+RemoteControl::run()
+{
+    auto listenSocket = static_cast<SocketHandle>(listener);
+    std::vector<Client> clients;
+    std::vector<pollfd> fds;
+    std::vector<Message> messages;
+    std::array<char, 4096> buffer;
+    int nextClientId = 0;
+
+    while (!stopRequested)
+    {
+        {
+            std::scoped_lock lock(mutex);
+            messages.swap(replies);
+        }
+        for (Message& message : messages)
+        {
+            auto it = std::find_if(clients.begin(), clients.end(),
+                                   [&](const Client& c) { return c.id == message.client; });
+            if (it == clients.end())
+                continue;
+            it->output += message.text;
+            it->output += '\n';
+        }
+        messages.clear();
+
+        fds.clear();
+        for (const Client& client : clients)
+        {
+            auto events = static_cast<short>(client.output.empty() ? POLLIN : (POLLIN | POLLOUT));
+            fds.push_back({ client.socket, events, 0 });
+        }
+        fds.push_back({ listenSocket, POLLIN, 0 });
+
+        if (pollSockets(fds.data(), fds.size(), PollInterval) <= 0)
+            continue;
+
+        for (std::size_t i = 0; i < clients.size(); ++i)
+        {
+            Client& client = clients[i];
+            bool closed = false;
+            if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+            {
+                auto count = recv(client.socket, buffer.data(), static_cast<int>(buffer.size()), 0);
+                if (count <= 0)
+                {
+                    closed = true;
+                }
+                else
+                {
+                    client.input.append(buffer.data(), static_cast<std::size_t>(count));
+                    std::size_t start = 0;
+                    for (auto end = client.input.find('\n'); end != std::string::npos; end = client.input.find('\n', start))
+                    {
+                        std::string_view line(client.input.data() + start, end - start);
+                        start = end + 1;
+                        if (client.authenticated)
+                        {
+                            messages.push_back({ client.id, std::string(line) });
+                            continue;
+                        }
+
+                        // The first line must be the token; nothing is
+                        // run for a client until it was sent
+                        line = trim(line);
+                        if (isHttpRequestLine(line) || !isToken(line, token))
+                        {
+                            closed = true;
+                            break;
+                        }
+                        client.authenticated = true;
+                        client.output += "ok\n";
+                    }
+                    client.input.erase(0, start);
+                    closed = closed || client.input.size() > MaxLineLength;
+                }
+            }
+
+            if (!closed && (fds[i].revents & POLLOUT) != 0)
+            {
+                auto count = send(client.socket, client.output.data(), static_cast<int>(client.output.size()), SendFlags);
+                if (count < 0)
+                    closed = true;
+                else
+                    client.output.erase(0, static_cast<std::size_t>(count));
+            }
+
+            if (closed)
+            {
+                closeSocket(client.socket);
+                client.socket = InvalidSocket;
+            }
+        }
+
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [](const Client& c) { return c.socket == InvalidSocket; }),
+                      clients.end());
+
+        if ((fds.back().revents & POLLIN) != 0)
+        {
+            SocketHandle s = accept(listenSocket, nullptr, nullptr);
+            if (s != InvalidSocket)
+            {
+#ifdef SO_NOSIGPIPE
+                int noSigPipe = 1;
+                setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+                clients.push_back({ s, nextClientId++, {}, {} });
+            }
+        }
+
+        if (!messages.empty())
+        {
+            std::scoped_lock lock(mutex);
+            std::move(messages.begin(), messages.end(), std::back_inserter(received));
+            messages.clear();
+        }
+    }
+
+    for (const Client& client : clients)
+        closeSocket(client.socket);
+}
+
+} // end namespace celestia
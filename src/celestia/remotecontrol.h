@@ -0,0 +1,110 @@
+// remotecontrol.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Network server which runs CEL commands sent by show control systems.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class CelestiaCore;
+
+namespace celestia
+{
+
+namespace scripts
+{
+class Execution;
+class ExecutionEnvironment;
+}
+
+/*! Accept connections on a local TCP port and run the CEL commands
+ *  received on them. The first line sent by a client must be the token
+ *  of the server, which replies with "ok"; the connection is closed when
+ *  it is wrong. Each line after it is one request:
+ *
+ *    <commands>             run the commands in the next frame
+ *    @<frame> <commands>    run the commands in the given frame
+ *    frame                  reply with the number of the current frame
+ *
+ *  where commands are CEL commands without the enclosing braces, e.g.
+ *  'select { object "Mars" } goto { time 5 }'. Frames are numbered from
+ *  the start of the server. The server replies with "ok <frame>" when the
+ *  commands are started or with "error <message>" when they can't be
+ *  parsed or write files without allowFileWrites. Commands with a
+ *  duration run concurrently with those sent after them.
+ *
+ *  The sockets are served by a thread of their own; tick() hands the
+ *  requests over to the main thread once per frame.
+ */
+class RemoteControl
+{
+ public:
+    ~RemoteControl();
+
+    RemoteControl(const RemoteControl&) = delete;
+    RemoteControl& operator=(const RemoteControl&) = delete;
+
+    // Listen on port of the loopback interface for clients which send
+    // token; returns nullptr if the token is empty or the port can't be
+    // opened.
+    static std::unique_ptr<RemoteControl> create(CelestiaCore&,
+                                                 std::uint16_t port,
+                                                 std::string_view token,
+                                                 bool allowFileWrites);
+
+    void tick(double dt);
+
+ private:
+    struct Message
+    {
+        int client;
+        std::string text;
+    };
+
+    struct Request
+    {
+        int client;
+        std::uint64_t frame;
+        std::string commands;
+    };
+
+    RemoteControl(CelestiaCore&, std::intptr_t listener, std::string_view token, bool allowFileWrites);
+
+    void run();
+    void reply(int client, std::string&&);
+    void startCommands(const Request&);
+
+    CelestiaCore& appCore;
+    std::unique_ptr<scripts::ExecutionEnvironment> env;
+    std::intptr_t listener;
+    const std::string token;
+    const bool allowFileWrites;
+
+    std::uint64_t frame{ 0 };
+    std::vector<Request> scheduled;
+    std::vector<std::unique_ptr<scripts::Execution>> running;
+
+    // Shared with the I/O thread
+    std::mutex mutex;
+    std::vector<Message> received;
+    std::vector<Message> replies;
+    std::atomic<bool> stopRequested{ false };
+
+    std::thread thread;
+};
+
+} // end namespace celestia
@@ -0,0 +1,353 @@
+// scenesnapshot.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Binary snapshots of the state of a scene, for jumping between cues.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "scenesnapshot.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include <Eigen/Geometry>
+
+#include <celengine/body.h>
+#include <celengine/marker.h>
+#include <celengine/observer.h>
+#include <celengine/render.h>
+#include <celengine/selection.h>
+#include <celengine/simulation.h>
+#include <celengine/univcoord.h>
+#include <celengine/universe.h>
+#include <celutil/color.h>
+#include "celestiacore.h"
+#include "view.h"
+
+namespace celestia
+{
+
+namespace
+{
+
+// Differences between a snapshot and its base closer than this are merged
+// into one run, as each run costs its offset and length
+constexpr std::size_t MinRunGap = 2 * sizeof(std::uint32_t);
+
+class SnapshotWriter
+{
+ public:
+    explicit SnapshotWriter(std::vector<std::uint8_t>& _data) : data(_data) {}
+
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        auto size = data.size();
+        data.resize(size + sizeof(T));
+        std::memcpy(data.data() + size, &value, sizeof(T));
+    }
+
+    // Written field by field, so that no padding bytes make the deltas of
+    // equal selections differ
+    void write(const Selection& sel)
+    {
+        write(sel.getType());
+        switch (sel.getType())
+        {
+        case SelectionType::Star:
+            write(static_cast<void*>(sel.star()));
+            break;
+        case SelectionType::Body:
+            write(static_cast<void*>(sel.body()));
+            break;
+        case SelectionType::DeepSky:
+            write(static_cast<void*>(sel.deepsky()));
+            break;
+        case SelectionType::Location:
+            write(static_cast<void*>(sel.location()));
+            break;
+        default:
+            write(static_cast<void*>(nullptr));
+            break;
+        }
+    }
+
+    void write(const std::string& s)
+    {
+        write(static_cast<std::uint32_t>(s.size()));
+        data.insert(data.end(), s.begin(), s.end());
+    }
+
+ private:
+    std::vector<std::uint8_t>& data;
+};
+
+class SnapshotReader
+{
+ public:
+    explicit SnapshotReader(const std::vector<std::uint8_t>& _data) : data(_data) {}
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        assert(position + sizeof(T) <= data.size());
+        T value;
+        std::memcpy(&value, data.data() + position, sizeof(T));
+        position += sizeof(T);
+        return value;
+    }
+
+    Selection readSelection()
+    {
+        auto type = read<SelectionType>();
+        auto object = read<void*>();
+        switch (type)
+        {
+        case SelectionType::Star:
+            return Selection(static_cast<Star*>(object));
+        case SelectionType::Body:
+            return Selection(static_cast<Body*>(object));
+        case SelectionType::DeepSky:
+            return Selection(static_cast<DeepSkyObject*>(object));
+        case SelectionType::Location:
+            return Selection(static_cast<Location*>(object));
+        default:
+            return Selection();
+        }
+    }
+
+    std::string readString()
+    {
+        auto size = read<std::uint32_t>();
+        return std::string(reinterpret_cast<const char*>(bytes(size)), size);
+    }
+
+    const std::uint8_t* bytes(std::size_t size)
+    {
+        assert(position + size <= data.size());
+        const std::uint8_t* ptr = data.data() + position;
+        position += size;
+        return ptr;
+    }
+
+    bool atEnd() const { return position == data.size(); }
+
+ private:
+    const std::vector<std::uint8_t>& data;
+    std::size_t position{ 0 };
+};
+
+} // end unnamed namespace
+
+SceneSnapshot
+SceneSnapshot::capture(const CelestiaCore& appCore)
+{
+    const Simulation& sim = *appCore.getSimulation();
+    const Renderer& renderer = *appCore.getRenderer();
+
+    SceneSnapshot snapshot;
+    snapshot.generation = sim.getUniverse()->getCatalogGeneration();
+
+    SnapshotWriter writer(snapshot.data);
+    writer.write(sim.getTime());
+    writer.write(sim.getTimeScale());
+    writer.write(sim.getPauseState());
+    writer.write(appCore.getLightDelayActive());
+    writer.write(sim.getSelection());
+
+    writer.write(renderer.getRenderFlags());
+    writer.write(renderer.getLabelMode());
+    writer.write(renderer.getOrbitMask());
+    writer.write(sim.getFaintestVisible());
+    writer.write(renderer.getAmbientLightLevel());
+
+    std::vector<Observer*> observers = appCore.getObservers();
+    auto activeView = std::find(observers.begin(), observers.end(), sim.getActiveObserver()) - observers.begin();
+    writer.write(static_cast<std::uint32_t>(observers.size()));
+    writer.write(static_cast<std::uint32_t>(activeView));
+
+    for (const Observer* o : observers)
+    {
+        const Observer& observer = *o;
+        const ObserverFrame& frame = *observer.getFrame();
+        writer.write(frame.getCoordinateSystem());
+        writer.write(frame.getRefObject());
+        writer.write(frame.getTargetObject());
+        writer.write(observer.getTrackedObject());
+        writer.write(observer.getPosition());
+        Eigen::Quaterniond orientation = observer.getOrientation();
+        writer.write(orientation.w());
+        writer.write(orientation.x());
+        writer.write(orientation.y());
+        writer.write(orientation.z());
+        writer.write(observer.getFOV());
+    }
+
+    const MarkerList& markers = sim.getUniverse()->getMarkers();
+    writer.write(static_cast<std::uint32_t>(markers.size()));
+    for (const Marker& marker : markers)
+    {
+        const MarkerRepresentation& representation = marker.representation();
+        writer.write(marker.object());
+        writer.write(marker.priority());
+        writer.write(marker.occludable());
+        writer.write(marker.sizing());
+        writer.write(representation.symbol());
+        writer.write(representation.size());
+        writer.write(representation.color());
+        writer.write(representation.label());
+    }
+
+    return snapshot;
+}
+
+/*! The difference is stored as the size of the state followed by runs of
+ *  the offset and length of the differing bytes and the bytes themselves.
+ */
+SceneSnapshot
+SceneSnapshot::deltaFrom(const std::shared_ptr<const SceneSnapshot>& _base) const
+{
+    std::vector<std::uint8_t> state = decode();
+    std::vector<std::uint8_t> baseState = _base->decode();
+
+    SceneSnapshot delta;
+    delta.generation = generation;
+    delta.base = _base;
+
+    SnapshotWriter writer(delta.data);
+    writer.write(static_cast<std::uint32_t>(state.size()));
+
+    auto differs = [&](std::size_t i) { return i >= baseState.size() || state[i] != baseState[i]; };
+    std::size_t i = 0;
+    while (i < state.size())
+    {
+        if (!differs(i))
+        {
+            ++i;
+            continue;
+        }
+
+        // Extend the run until a stretch of MinRunGap equal bytes
+        std::size_t start = i;
+        std::size_t end = i + 1;
+        for (std::size_t j = end; j < state.size() && j - end < MinRunGap; ++j)
+        {
+            if (differs(j))
+                end = j + 1;
+        }
+
+        writer.write(static_cast<std::uint32_t>(start));
+        writer.write(static_cast<std::uint32_t>(end - start));
+        delta.data.insert(delta.data.end(), state.begin() + start, state.begin() + end);
+        i = end;
+    }
+
+    return delta;
+}
+
+std::vector<std::uint8_t>
+SceneSnapshot::decode() const
+{
+    if (base == nullptr)
+        return data;
+
+    std::vector<std::uint8_t> state = base->decode();
+    SnapshotReader reader(data);
+    state.resize(reader.read<std::uint32_t>());
+    while (!reader.atEnd())
+    {
+        auto start = reader.read<std::uint32_t>();
+        auto length = reader.read<std::uint32_t>();
+        std::memcpy(state.data() + start, reader.bytes(length), length);
+    }
+
+    return state;
+}
+
+bool
+SceneSnapshot::apply(CelestiaCore& appCore) const
+{
+    Simulation& sim = *appCore.getSimulation();
+    Renderer& renderer = *appCore.getRenderer();
+    Universe& universe = *sim.getUniverse();
+    if (universe.getCatalogGeneration() != generation)
+        return false;
+
+    std::vector<std::uint8_t> state = decode();
+    SnapshotReader reader(state);
+
+    sim.update(0.0);
+    sim.setTime(reader.read<double>());
+    sim.setTimeScale(reader.read<double>());
+    sim.setPauseState(reader.read<bool>());
+    appCore.setLightDelayActive(reader.read<bool>());
+    sim.setSelection(reader.readSelection());
+
+    renderer.setRenderFlags(reader.read<std::uint64_t>());
+    renderer.setLabelMode(reader.read<int>());
+    renderer.setOrbitMask(reader.read<BodyClassification>());
+    sim.setFaintestVisible(reader.read<float>());
+    renderer.setAmbientLightLevel(reader.read<float>());
+
+    auto nViews = reader.read<std::uint32_t>();
+    auto activeView = reader.read<std::uint32_t>();
+    std::vector<Observer*> observers = appCore.getObservers();
+
+    for (std::uint32_t i = 0; i < nViews; ++i)
+    {
+        auto coordSys = reader.read<ObserverFrame::CoordinateSystem>();
+        auto refObject = reader.readSelection();
+        auto targetObject = reader.readSelection();
+        auto trackedObject = reader.readSelection();
+        auto position = reader.read<UniversalCoord>();
+        auto w = reader.read<double>();
+        auto x = reader.read<double>();
+        auto y = reader.read<double>();
+        auto z = reader.read<double>();
+        auto fov = reader.read<float>();
+        if (i >= observers.size())
+            continue;
+
+        Observer& observer = *observers[i];
+        observer.cancelMotion();
+        observer.setFrame(coordSys, refObject, targetObject);
+        observer.setTrackedObject(trackedObject);
+        observer.setPosition(position);
+        observer.setOrientation(Eigen::Quaterniond(w, x, y, z));
+        observer.setFOV(fov);
+    }
+
+    if (activeView < observers.size())
+        appCore.setActiveView(appCore.getViewByObserver(observers[activeView]));
+    appCore.setZoomFromFOV();
+
+    MarkerList markers;
+    markers.reserve(reader.read<std::uint32_t>());
+    while (markers.size() < markers.capacity() && !reader.atEnd())
+    {
+        Marker& marker = markers.emplace_back(reader.readSelection());
+        marker.setPriority(reader.read<int>());
+        marker.setOccludable(reader.read<bool>());
+        marker.setSizing(reader.read<MarkerSizing>());
+        auto symbol = reader.read<MarkerRepresentation::Symbol>();
+        auto size = reader.read<float>();
+        auto color = reader.read<Color>();
+        marker.setRepresentation(MarkerRepresentation(symbol, size, color, reader.readString()));
+    }
+    universe.setMarkers(std::move(markers));
+
+    appCore.notifyWatchers(CelestiaCore::RenderFlagsChanged | CelestiaCore::LabelFlagsChanged);
+    appCore.requestRedraw();
+    return true;
+}
+
+} // end namespace celestia
@@ -0,0 +1,66 @@
+// scenesnapshot.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Binary snapshots of the state of a scene, for jumping between cues.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class CelestiaCore;
+
+namespace celestia
+{
+
+/*! Snapshot of the state of a scene held in memory, so that a show can
+ *  jump between prepared scenes within a frame: the time and time rate,
+ *  the selection, the position, orientation, field of view, frame and
+ *  tracked object of the observer of every view, the active view, the
+ *  render and label flags, the orbit mask, the limiting magnitude, the
+ *  ambient light and the markers.
+ *
+ *  The state is stored as bytes, with the objects referred to directly
+ *  rather than by name, so a snapshot can't be applied any more once the
+ *  star or deep sky catalog was replaced. A snapshot can be encoded as
+ *  the bytes differing from a base snapshot, so that cues which share most
+ *  of their state take little memory each.
+ *
+ *  The view layout isn't part of the snapshot: the observers are applied
+ *  to the views in order, as far as the current layout has views.
+ */
+class SceneSnapshot
+{
+ public:
+    static SceneSnapshot capture(const CelestiaCore&);
+
+    // Encode the snapshot as the difference to base, which the returned
+    // snapshot keeps a reference to.
+    SceneSnapshot deltaFrom(const std::shared_ptr<const SceneSnapshot>& base) const;
+
+    // Returns false if the catalogs changed since the snapshot was taken.
+    bool apply(CelestiaCore&) const;
+
+    // Size of the snapshot in bytes, without its base
+    std::size_t size() const { return data.size(); }
+
+ private:
+    SceneSnapshot() = default;
+
+    std::vector<std::uint8_t> decode() const;
+
+    // The state, or for a delta, runs of the bytes differing from the base
+    std::vector<std::uint8_t> data;
+    std::shared_ptr<const SceneSnapshot> base;
+    std::uint32_t generation{ 0 };
+};
+
+} // end namespace celestia
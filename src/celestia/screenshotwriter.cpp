@@ -0,0 +1,178 @@
+// screenshotwriter.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Screenshots read back and written without stalling the render thread.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "screenshotwriter.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include <celimage/image.h>
+#include <celrender/framereadback.h>
+#include <celutil/workerpool.h>
+
+using celestia::engine::Image;
+using celestia::engine::PixelFormat;
+
+namespace celestia
+{
+
+namespace
+{
+
+// Frames being read before the oldest one is waited for
+constexpr std::size_t ReadbackDepth = 3;
+// Images being encoded before retiring a frame blocks; at 8K each takes
+// about 100 MB
+constexpr std::size_t MaxEncodingImages = 4;
+// Each thread encodes a whole image, so more threads only help sequences
+// of screenshots
+constexpr unsigned int MaxEncoderThreads = 4;
+
+} // end unnamed namespace
+
+ScreenshotWriter::ScreenshotWriter() = default;
+
+ScreenshotWriter::~ScreenshotWriter()
+{
+    finish();
+    m_encoders = nullptr;
+}
+
+void
+ScreenshotWriter::request(const fs::path& path, ContentType type, Callback&& callback)
+{
+    if (m_encoders == nullptr)
+    {
+        unsigned int nThreads = std::clamp(std::thread::hardware_concurrency() / 2, 1U, MaxEncoderThreads);
+        m_encoders = std::make_unique<util::WorkerPool>(nThreads);
+    }
+
+    m_requests.push_back({ path, type, std::move(callback) });
+}
+
+void
+ScreenshotWriter::capture(const std::array<int, 4>& viewport, PixelFormat format)
+{
+    while (m_readback != nullptr && m_readback->ready())
+        retire();
+
+    if (!m_requests.empty())
+    {
+        if (m_readback == nullptr || m_format != format ||
+            m_readback->getWidth() != viewport[2] || m_readback->getHeight() != viewport[3])
+        {
+            while (m_readback != nullptr && !m_readback->empty())
+                retire();
+            m_readback = std::make_unique<render::FrameReadback>(viewport[2], viewport[3], format, ReadbackDepth);
+            m_format = format;
+        }
+        else if (m_readback->full())
+        {
+            retire();
+        }
+
+        if (m_readback->read(viewport[0], viewport[1]))
+        {
+            m_reading.push_back(std::move(m_requests));
+        }
+        else
+        {
+            std::scoped_lock lock(m_mutex);
+            for (Request& request : m_requests)
+                m_results.push_back({ std::move(request.callback), std::move(request.path), false });
+        }
+        m_requests.clear();
+    }
+
+    report();
+}
+
+void
+ScreenshotWriter::finish()
+{
+    while (!m_reading.empty())
+        retire();
+
+    {
+        std::unique_lock lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_encoding == 0; });
+    }
+
+    report();
+}
+
+bool
+ScreenshotWriter::busy() const
+{
+    if (!m_requests.empty() || !m_reading.empty())
+        return true;
+
+    std::scoped_lock lock(m_mutex);
+    return m_encoding > 0 || !m_results.empty();
+}
+
+void
+ScreenshotWriter::retire()
+{
+    std::vector<Request> requests = std::move(m_reading.front());
+    m_reading.pop_front();
+
+    auto image = std::make_shared<Image>(m_format, m_readback->getWidth(), m_readback->getHeight());
+    if (!m_readback->retire(image->getPixels(), image->getPitch()))
+    {
+        std::scoped_lock lock(m_mutex);
+        for (Request& request : requests)
+            m_results.push_back({ std::move(request.callback), std::move(request.path), false });
+        return;
+    }
+
+    for (Request& request : requests)
+        encode(image, std::move(request));
+}
+
+void
+ScreenshotWriter::encode(const std::shared_ptr<const Image>& image, Request&& request)
+{
+    {
+        std::unique_lock lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_encoding < MaxEncodingImages; });
+        ++m_encoding;
+    }
+
+    m_encoders->submit([this, image, request = std::move(request)]() mutable
+    {
+        bool success = image->save(request.path, request.type, true);
+
+        std::scoped_lock lock(m_mutex);
+        m_results.push_back({ std::move(request.callback), std::move(request.path), success });
+        --m_encoding;
+        m_condition.notify_all();
+    });
+}
+
+void
+ScreenshotWriter::report()
+{
+    std::deque<Result> results;
+    {
+        std::scoped_lock lock(m_mutex);
+        results.swap(m_results);
+    }
+
+    for (const Result& result : results)
+    {
+        if (result.callback)
+            result.callback(result.path, result.success);
+    }
+}
+
+} // end namespace celestia
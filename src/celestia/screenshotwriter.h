@@ -0,0 +1,110 @@
+// screenshotwriter.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Screenshots read back and written without stalling the render thread.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+#include <celimage/pixelformat.h>
+#include <celutil/filetype.h>
+
+namespace celestia
+{
+
+namespace engine
+{
+class Image;
+}
+
+namespace render
+{
+class FrameReadback;
+}
+
+namespace util
+{
+class WorkerPool;
+}
+
+// Writes screenshots of the frames rendered after they were requested. The
+// frame is copied into a pixel buffer object by capture(), retired by a
+// later call once the copy has completed, and then encoded and written by
+// worker threads, so that taking a sequence of screenshots doesn't hold up
+// the rendering. The callback of a request is called from capture() or
+// finish(), on the render thread, once the file has been written.
+class ScreenshotWriter
+{
+public:
+    // Called with the path of a screenshot and whether it was written
+    using Callback = std::function<void(const fs::path&, bool)>;
+
+    ScreenshotWriter();
+    ~ScreenshotWriter();
+
+    ScreenshotWriter(const ScreenshotWriter&) = delete;
+    ScreenshotWriter& operator=(const ScreenshotWriter&) = delete;
+
+    // Write a screenshot of the next frame to path
+    void request(const fs::path& path, ContentType type, Callback&& callback);
+
+    // Start reading the requested region of the frame which has just been
+    // rendered, retire the reads which have completed and report the
+    // screenshots which have been written. The OpenGL context must be
+    // current.
+    void capture(const std::array<int, 4>& viewport, engine::PixelFormat format);
+
+    // Wait until all screenshots have been written and reported
+    void finish();
+
+    // Return true if screenshots are being captured or written
+    bool busy() const;
+
+private:
+    struct Request
+    {
+        fs::path path;
+        ContentType type;
+        Callback callback;
+    };
+
+    struct Result
+    {
+        Callback callback;
+        fs::path path;
+        bool success;
+    };
+
+    void retire();
+    void encode(const std::shared_ptr<const engine::Image>& image, Request&& request);
+    void report();
+
+    std::unique_ptr<render::FrameReadback> m_readback;
+    engine::PixelFormat m_format{ engine::PixelFormat::RGB };
+    std::vector<Request> m_requests;
+    // Requests for each of the frames being read, in the order of the reads
+    std::deque<std::vector<Request>> m_reading;
+
+    std::unique_ptr<util::WorkerPool> m_encoders;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::size_t m_encoding{ 0 };
+    std::deque<Result> m_results;
+};
+
+} // end namespace celestia
@@ -187,8 +187,18 @@ SDL_Application::getScalingFactor() const
 void
 SDL_Application::display()
 {
-    m_appCore->draw();
-    SDL_GL_SwapWindow(m_mainWindow);
+    if (m_appCore->draw())
+    {
+        SDL_GL_SwapWindow(m_mainWindow);
+    }
+#ifndef __EMSCRIPTEN__
+    else
+    {
+        // Without a swap to wait for, wait for the next event instead of
+        // spinning; the simulation is still ticked at the frame rate
+        SDL_WaitEventTimeout(nullptr, 16);
+    }
+#endif
 }
 
 bool
@@ -211,6 +221,7 @@ SDL_Application::configure() const
 
     renderer->setRenderFlags(Renderer::DefaultRenderFlags);
     renderer->setShadowMapSize(config->renderDetails.ShadowMapSize);
+    renderer->setStaticStarBuffer(config->renderDetails.staticStarBuffer);
     renderer->setSolarSystemMaxDistance(config->renderDetails.SolarSystemMaxDistance);
 }
 
@@ -554,6 +565,9 @@ SDL_Application::handleWindowEvent(const SDL_WindowEvent &event)
         SDL_GL_GetDrawableSize(m_mainWindow, &m_windowWidth, &m_windowHeight);
         m_appCore->resize(m_windowWidth, m_windowHeight);
         break;
+    case SDL_WINDOWEVENT_EXPOSED:
+        m_appCore->requestRedraw();
+        break;
     default:
         break;
     }
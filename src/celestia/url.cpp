@@ -121,6 +121,13 @@ constexpr std::array modes
     Mode{ "PhaseLock"sv,  ObserverFrame::PhaseLock,   2 },
 };
 
+Selection
+findObject(const Simulation& sim, std::string path)
+{
+    std::replace(path.begin(), path.end(), ':', '/');
+    return sim.findObjectFromPath(path);
+}
+
 } // end unnamed namespace
 
 Url::Url(CelestiaCore *core) :
@@ -220,6 +227,8 @@ Url::goTo()
     auto *sim = m_appCore->getSimulation();
     auto *renderer = m_appCore->getRenderer();
 
+    resolveObjects();
+
     sim->update(0.0);
     sim->setFrame(m_ref.getCoordinateSystem(), m_ref.getRefObject(), m_ref.getTargetObject());
     sim->getActiveObserver()->setFOV(math::degToRad(m_state.m_fieldOfView));
@@ -227,30 +236,12 @@ Url::goTo()
     sim->setTimeScale(m_state.m_timeScale);
     sim->setPauseState(m_state.m_pauseState);
     m_appCore->setLightDelayActive(m_state.m_lightTimeDelay);
-    if (!m_state.m_selectedBodyName.empty())
-    {
-        auto body = m_state.m_selectedBodyName;
-        std::replace(body.begin(), body.end(), ':', '/');
-        auto sel = sim->findObjectFromPath(body);
-        sim->setSelection(sel);
-    }
-    else
-    {
-        sim->setSelection(Selection());
-    }
+    sim->setSelection(m_selected);
 
     if (!m_state.m_trackedBodyName.empty())
-    {
-        auto body = m_state.m_trackedBodyName;
-        std::replace(body.begin(), body.end(), ':', '/');
-        auto sel = sim->findObjectFromPath(body);
-        sim->setTrackedObject(sel);
-    }
-    else
-    {
-        if (!sim->getTrackedObject().empty())
-            sim->setTrackedObject(Selection());
-    }
+        sim->setTrackedObject(m_tracked);
+    else if (!sim->getTrackedObject().empty())
+        sim->setTrackedObject(Selection());
 
     renderer->setRenderFlags(m_state.m_renderFlags);
     renderer->setLabelMode(m_state.m_labelMode);
@@ -282,6 +273,40 @@ Url::goTo()
     return true;
 }
 
+void
+Url::resolveObjects()
+{
+    const Simulation& sim = *m_appCore->getSimulation();
+    std::uint32_t generation = sim.getUniverse()->getCatalogGeneration();
+    bool changed = !m_resolved || generation != m_generation;
+    m_resolved = true;
+    m_generation = generation;
+
+    if (changed && m_refFromPath)
+    {
+        switch (m_nBodies)
+        {
+        case 1:
+            m_ref = ObserverFrame(m_state.m_coordSys, findObject(sim, m_state.m_refBodyName));
+            break;
+        case 2:
+            m_ref = ObserverFrame(m_state.m_coordSys,
+                                  findObject(sim, m_state.m_refBodyName),
+                                  findObject(sim, m_state.m_targetBodyName));
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Objects which weren't found are looked up again, as they may be
+    // defined by catalogs loaded later
+    if (changed || m_selected.empty())
+        m_selected = m_state.m_selectedBodyName.empty() ? Selection() : findObject(sim, m_state.m_selectedBodyName);
+    if (changed || m_tracked.empty())
+        m_tracked = m_state.m_trackedBodyName.empty() ? Selection() : findObject(sim, m_state.m_trackedBodyName);
+}
+
 std::string
 Url::getAsString() const
 {
@@ -508,6 +533,13 @@ Url::parse(std::string_view urlStr)
     m_ref = ref;
     m_state = state;
     m_nBodies = nBodies;
+    // The reference objects were just looked up; the selected and tracked
+    // ones are looked up by goTo()
+    m_refFromPath = true;
+    m_resolved = true;
+    m_generation = m_appCore->getSimulation()->getUniverse()->getCatalogGeneration();
+    m_selected = Selection();
+    m_tracked = Selection();
     if (version == 4 && !initVersion4(params, timeStr))
         return false;
     else if (!initVersion3(params, timeStr))
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <map>
 #include <string>
 #include <string_view>
@@ -61,12 +62,15 @@ class Url
     static std::string encodeString(std::string_view);
 
     bool parse(std::string_view);
+    // The objects named by the URL are looked up by the first call and
+    // kept for the later ones, unless the catalogs have changed since.
     bool goTo();
     std::string getAsString() const;
 
  private:
     bool initVersion3(const std::map<std::string_view, std::string> &params, std::string_view timeStr);
     bool initVersion4(std::map<std::string_view, std::string> &params, std::string_view timeStr);
+    void resolveObjects();
 
     CelestiaState          m_state;
 
@@ -83,4 +87,9 @@ class Url
 
     int                    m_nBodies       { -1 };
     bool                   m_valid         { false };
+
+    // Catalog generation m_ref, m_selected and m_tracked were resolved in
+    std::uint32_t          m_generation    { 0 };
+    bool                   m_resolved      { false };
+    bool                   m_refFromPath   { false };
 };
@@ -9,7 +9,10 @@
 
 #include "view.h"
 
+#include <algorithm>
+
 #include <celengine/framebuffer.h>
+#include <celengine/framebufferpool.h>
 #include <celengine/glsupport.h>
 #include <celengine/overlay.h>
 #include <celengine/rectangle.h>
@@ -35,7 +38,10 @@ View::View(View::Type type,
 }
 
 
-View::~View() = default;
+View::~View()
+{
+    engine::GetFramebufferPool()->release(std::move(fbo));
+}
 
 
 void
@@ -245,7 +251,7 @@ View::reset()
     parent = nullptr;
     child1 = nullptr;
     child2 = nullptr;
-    fbo = nullptr;
+    engine::GetFramebufferPool()->release(std::move(fbo));
 }
 
 
@@ -261,16 +267,19 @@ View::drawBorder(Overlay* overlay, int gWidth, int gHeight, const Color &color,
 
 
 void
-View::updateFBO(int gWidth, int gHeight)
+View::updateFBO(int gWidth, int gHeight, float scale)
 {
-    auto newWidth = static_cast<GLuint>(width * gWidth);
-    auto newHeight = static_cast<GLuint>(height * gHeight);
+    auto newWidth = std::max(static_cast<GLuint>(width * gWidth * scale), 1u);
+    auto newHeight = std::max(static_cast<GLuint>(height * gHeight * scale), 1u);
     if (fbo && fbo.get()->width() == newWidth && fbo.get()->height() == newHeight)
         return;
 
-    // recreate FBO when FBO not exisits or on size change
-    fbo = std::make_unique<FramebufferObject>(newWidth, newHeight,
-                                              FramebufferObject::ColorAttachment | FramebufferObject::DepthAttachment);
+    // recreate FBO when FBO not exisits or on size change, reusing one of
+    // the new size if it was released before
+    auto* pool = engine::GetFramebufferPool();
+    pool->release(std::move(fbo));
+    fbo = pool->acquire(newWidth, newHeight,
+                        FramebufferObject::ColorAttachment | FramebufferObject::DepthAttachment);
     if (!fbo->isValid())
     {
         GetLogger()->error("Error creating view FBO.\n");
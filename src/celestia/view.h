@@ -49,7 +49,7 @@ public:
     void reset();
     static View* remove(View*);
     void drawBorder(Overlay*, int gWidth, int gHeight, const Color &color, float linewidth = 1.0f) const;
-    void updateFBO(int gWidth, int gHeight);
+    void updateFBO(int gWidth, int gHeight, float scale = 1.0f);
     FramebufferObject *getFBO() const;
 
     Type           type;
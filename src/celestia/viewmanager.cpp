@@ -332,6 +332,7 @@ ViewManager::deleteView(Simulation* sim, View* v)
 void
 ViewManager::renderBorders(Overlay* overlay, const WindowMetrics& metrics, double currentTime) const
 {
+    m_flashDrawn = false;
     if (m_views.size() < 2)
         return;
 
@@ -361,6 +362,7 @@ ViewManager::renderBorders(Overlay* overlay, const WindowMetrics& metrics, doubl
 
     if (currentTime < m_flashFrameStart + flashDuration)
     {
+        m_flashDrawn = true;
         auto alpha = static_cast<float>(1.0 - (currentTime - m_flashFrameStart) / flashDuration);
         av->drawBorder(overlay, metrics.width, metrics.height, {activeFrameColor, alpha}, 8);
     }
@@ -62,6 +62,8 @@ public:
     bool deleteView(Simulation*, View*);
 
     void renderBorders(Overlay*, const WindowMetrics&, double) const;
+    // The border of the active view is flashing
+    bool isFlashing() const noexcept { return m_startFlash || m_flashDrawn; }
 
     bool showViewFrames() const noexcept { return m_showViewFrames; }
     void showViewFrames(bool value) noexcept { m_showViewFrames = value; }
@@ -75,6 +77,7 @@ private:
 
     mutable double m_flashFrameStart{ -std::numeric_limits<double>::infinity() };
     mutable bool m_startFlash{ false };
+    mutable bool m_flashDrawn{ false };
 
     bool m_showViewFrames{ true };
     bool m_showActiveViewFrame{ false };
@@ -101,6 +101,7 @@ HandleCaptureImage(HWND hWnd, CelestiaCore* appCore)
     }
 
     // Redraw to make sure that the back buffer is up to date
+    appCore->requestRedraw();
     appCore->draw();
     if (!appCore->saveScreenShot(filename))
     {
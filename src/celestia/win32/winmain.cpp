@@ -713,6 +713,7 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
 
     appCore->getRenderer()->setSolarSystemMaxDistance(appCore->getConfig()->renderDetails.SolarSystemMaxDistance);
     appCore->getRenderer()->setShadowMapSize(appCore->getConfig()->renderDetails.ShadowMapSize);
+    appCore->getRenderer()->setStaticStarBuffer(appCore->getConfig()->renderDetails.staticStarBuffer);
 
     auto cursorHandler = std::make_unique<WinCursorHandler>(hDefaultCursor);
     appCore->setCursorHandler(cursorHandler.get());
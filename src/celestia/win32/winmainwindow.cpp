@@ -1125,8 +1125,9 @@ MainWindow::paint() const
     if (!bReady)
         return;
 
-    appCore->draw();
-    SwapBuffers(deviceContext);
+    // The last frame stays on screen when nothing changed
+    if (appCore->draw())
+        SwapBuffers(deviceContext);
     ValidateRect(hWnd, NULL);
 }
 
@@ -87,7 +87,10 @@ BeginMovieCapture(CelestiaCore* appCore,
     movieCapture->setVideoCodec(codec);
     movieCapture->setBitRate(bitrate);
     if (codec == AV_CODEC_ID_H264)
+    {
         movieCapture->setEncoderOptions(appCore->getConfig()->x264EncoderOptions);
+        movieCapture->setHardwareEncoder(appCore->getConfig()->videoHardwareEncoder);
+    }
     else
         movieCapture->setEncoderOptions(appCore->getConfig()->ffvhEncoderOptions);
 
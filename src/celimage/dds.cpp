@@ -13,6 +13,7 @@
 #include <fstream>
 #include <algorithm>
 #include <memory>
+#include <vector>
 #include <celengine/glsupport.h>
 #include <celutil/logger.h>
 #include <celutil/bytes.h>
@@ -74,7 +75,6 @@ struct DDSurfaceDesc
     std::uint32_t textureStage;
 };
 
-constexpr std::size_t DDS_MAX_BLOCK_SIZE = 16;
 
 constexpr std::uint32_t FourCC(const char *s)
 {
@@ -85,52 +85,42 @@ constexpr std::uint32_t FourCC(const char *s)
 }
 
 // decompress a DXTc texture to a RGBA texture, taken from https://github.com/ptitSeb/gl4es
+// The result has the width and height rounded up to a multiple of 4.
 std::unique_ptr<std::uint32_t[]>
 DecompressDXTc(std::uint32_t width, std::uint32_t height, PixelFormat format, bool transparent0, std::ifstream &in)
 {
-    // TODO: check with the size of the input data stream if the stream is in fact decompressed
-    // alloc memory
-    int blocksize = 0;
+    std::size_t blocksize = 0;
+    DXTcFormat dxtcFormat;
     switch (format)
     {
     case PixelFormat::DXT1:
         blocksize = 8;
+        dxtcFormat = DXTcFormat::DXT1;
         break;
     case PixelFormat::DXT3:
+        blocksize = 16;
+        dxtcFormat = DXTcFormat::DXT3;
+        break;
     case PixelFormat::DXT5:
         blocksize = 16;
+        dxtcFormat = DXTcFormat::DXT5;
         break;
     default:
         assert(0);
         return nullptr;
     }
-    auto pixels = std::make_unique<std::uint32_t[]>(((width + 3) & ~3) * ((height + 3) & ~3));
-    std::array<std::uint8_t, DDS_MAX_BLOCK_SIZE> block; // enough to hold DXT1/3/5 blocks
-    for (std::uint32_t y = 0; y < height; y += 4)
-    {
-        for (std::uint32_t x = 0; x < width; x += 4)
-        {
-            if (!in.good())
-                return nullptr;
 
-            in.read(reinterpret_cast<char*>(block.data()), blocksize); /* Flawfinder: ignore */
-            switch (format)
-            {
-            case PixelFormat::DXT1:
-                DecompressBlockDXT1(x, y, width, block.data(), transparent0, pixels.get());
-                break;
-            case PixelFormat::DXT3:
-                DecompressBlockDXT3(x, y, width, block.data(), transparent0, pixels.get());
-                break;
-            case PixelFormat::DXT5:
-                DecompressBlockDXT5(x, y, width, block.data(), transparent0, pixels.get());
-                break;
-            default:
-                assert(0);
-                return nullptr;
-            }
-        }
-    }
+    std::uint32_t paddedWidth = (width + 3) & ~3u;
+    std::uint32_t paddedHeight = (height + 3) & ~3u;
+
+    // Read the whole base level first, so that it can be decompressed in
+    // parallel
+    std::vector<std::uint8_t> blocks(static_cast<std::size_t>(paddedWidth / 4) * (paddedHeight / 4) * blocksize);
+    if (!in.read(reinterpret_cast<char*>(blocks.data()), static_cast<std::streamsize>(blocks.size())).good()) /* Flawfinder: ignore */
+        return nullptr;
+
+    auto pixels = std::make_unique<std::uint32_t[]>(static_cast<std::size_t>(paddedWidth) * paddedHeight);
+    celestia::engine::DecompressDXTc(dxtcFormat, paddedWidth, paddedHeight, blocks.data(), transparent0, pixels.get());
     return pixels;
 }
 
@@ -251,9 +241,8 @@ Image* LoadDDSImage(const fs::path& filename)
             bool transparent0 = format == PixelFormat::DXT1;
             if ((ddsd.width & 3) != 0 || (ddsd.height & 3) != 0)
             {
-                std::uint32_t nw = std::max(ddsd.width, 4u);
-                std::uint32_t nh = std::max(ddsd.height, 4u);
-                auto tmp = DecompressDXTc(nw, nh, format, transparent0, in);
+                std::uint32_t nw = (ddsd.width + 3) & ~3u;
+                auto tmp = DecompressDXTc(ddsd.width, ddsd.height, format, transparent0, in);
                 if (tmp != nullptr)
                 {
                     pixels = std::make_unique<std::uint32_t[]>(ddsd.width * ddsd.height);
@@ -1,4 +1,8 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
 
 #include "dds_decompress.h"
 
@@ -62,6 +66,12 @@ namespace celestia::engine
 namespace
 {
 
+// Rows of blocks decompressed by a thread at a time. Textures with fewer
+// rows are decompressed on the calling thread.
+constexpr std::uint32_t BlockRowsPerTask = 16;
+
+constexpr unsigned int MaxDecompressThreads = 8;
+
 constexpr std::uint32_t PackRGBA(std::uint8_t r, std::uint8_t g, std::uint8_t b, std::uint8_t a)
 {
     return static_cast<std::uint32_t>(r) |
@@ -336,4 +346,61 @@ void DecompressBlockDXT3(std::uint32_t x,
                                 alphaValues.data());
 }
 
+void DecompressDXTc(DXTcFormat format,
+                    std::uint32_t width,
+                    std::uint32_t height,
+                    const std::uint8_t* blocks,
+                    bool transparent0,
+                    std::uint32_t* image)
+{
+    using DecompressBlock = void (*)(std::uint32_t, std::uint32_t, std::uint32_t,
+                                     const std::uint8_t*, bool, std::uint32_t*);
+    DecompressBlock decompressBlock;
+    std::size_t blockSize;
+    switch (format)
+    {
+    case DXTcFormat::DXT1:
+        decompressBlock = DecompressBlockDXT1;
+        blockSize = 8;
+        break;
+    case DXTcFormat::DXT3:
+        decompressBlock = DecompressBlockDXT3;
+        blockSize = 16;
+        break;
+    default:
+        decompressBlock = DecompressBlockDXT5;
+        blockSize = 16;
+        break;
+    }
+
+    std::uint32_t blockRows = height / 4;
+    std::size_t rowSize = static_cast<std::size_t>(width / 4) * blockSize;
+    std::uint32_t tasks = (blockRows + BlockRowsPerTask - 1) / BlockRowsPerTask;
+
+    // Blocks only write their own pixels, so the rows can be decompressed
+    // in any order
+    std::atomic<std::uint32_t> nextTask{ 0 };
+    auto worker = [&]()
+    {
+        for (std::uint32_t task = nextTask++; task < tasks; task = nextTask++)
+        {
+            std::uint32_t endRow = std::min(blockRows, (task + 1) * BlockRowsPerTask);
+            for (std::uint32_t row = task * BlockRowsPerTask; row < endRow; ++row)
+            {
+                const std::uint8_t* block = blocks + row * rowSize;
+                for (std::uint32_t x = 0; x < width; x += 4, block += blockSize)
+                    decompressBlock(x, row * 4, width, block, transparent0, image);
+            }
+        }
+    };
+
+    unsigned int nThreads = std::clamp(std::thread::hardware_concurrency(), 1U, MaxDecompressThreads);
+    std::vector<std::thread> threads;
+    for (std::uint32_t i = 1, end = std::min<std::uint32_t>(nThreads, tasks); i < end; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
 } // namespace celestia::engine
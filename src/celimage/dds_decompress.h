@@ -48,4 +48,26 @@ void DecompressBlockDXT5(std::uint32_t x, std::uint32_t y, std::uint32_t width,
                          const std::uint8_t *blockStorage, bool transparent0,
                          std::uint32_t *image);
 
+enum class DXTcFormat
+{
+    DXT1,
+    DXT3,
+    DXT5,
+};
+
+/**
+ * @brief Decompresses a whole DXTc texture.
+ * Decompresses the blocks of a texture, stored row by row, into 'image'. Large
+ * textures have their rows of blocks spread over a pool of threads.
+ *
+ * @param format - format of the blocks.
+ * @param width - width of the texture being decompressed, a multiple of 4.
+ * @param height - height of the texture being decompressed, a multiple of 4.
+ * @param blocks - pointer to the blocks to decompress.
+ * @param image - pointer to image where the decompressed pixel data should be stored.
+*/
+void DecompressDXTc(DXTcFormat format, std::uint32_t width, std::uint32_t height,
+                    const std::uint8_t *blocks, bool transparent0,
+                    std::uint32_t *image);
+
 } // namespace celestia::engine
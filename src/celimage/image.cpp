@@ -10,9 +10,12 @@
 #include "image.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <thread>
 #include <tuple>
+#include <vector>
 
 #include <celutil/filetype.h>
 #include <celutil/gettext.h>
@@ -24,6 +27,11 @@ namespace celestia::engine
 namespace
 {
 
+// Rows of a normal map computed by a thread at a time
+constexpr int NormalMapRowsPerTask = 64;
+
+constexpr unsigned int MaxNormalMapThreads = 8;
+
 // All rows are padded to a size that's a multiple of 4 bytes
 int
 pad(int n)
@@ -323,36 +331,63 @@ Image::computeNormalMap(float scale, bool wrap) const
 
     auto normalMap = std::make_unique<Image>(PixelFormat::RGBA, width, height);
 
-    std::uint8_t* nmPixels = normalMap->getPixels();
-    int nmPitch = normalMap->getPitch();
-
-    // Compute normals using differences between adjacent texels.
-    for (int i = 0; i < height; i++)
+    // Rows are independent, so they are spread over a pool of threads
+    std::atomic<int> nextRows{ 0 };
+    auto worker = [&]()
     {
-        const auto rowBase = i * nmPitch;
-        const auto [i0, i1] = handleEdge(i, height, wrap);
-        for (int j = 0; j < width; j++)
+        for (int start = nextRows.fetch_add(NormalMapRowsPerTask);
+             start < height;
+             start = nextRows.fetch_add(NormalMapRowsPerTask))
         {
-            const auto [j0, j1] = handleEdge(j, width, wrap);
+            for (int i = start, end = std::min(start + NormalMapRowsPerTask, height); i < end; ++i)
+                computeNormalMapRow(*normalMap, i, scale, wrap);
+        }
+    };
 
-            auto h00 = static_cast<int>(pixels[i0 * pitch + j0 * components]);
-            auto h10 = static_cast<int>(pixels[i0 * pitch + j1 * components]);
-            auto h01 = static_cast<int>(pixels[i1 * pitch + j0 * components]);
+    int tasks = (height + NormalMapRowsPerTask - 1) / NormalMapRowsPerTask;
+    unsigned int nThreads = std::clamp(std::thread::hardware_concurrency(), 1U, MaxNormalMapThreads);
+    std::vector<std::thread> threads;
+    for (int i = 1, end = std::min(static_cast<int>(nThreads), tasks); i < end; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
 
-            auto dx = static_cast<float>(h10 - h00) * (1.0f / 255.0f) * scale;
-            auto dy = static_cast<float>(h01 - h00) * (1.0f / 255.0f) * scale;
+    return normalMap;
+}
 
-            float rmag = 1.0f / std::sqrt(dx * dx + dy * dy + 1.0f);
+// Compute row i of a normal map using differences between adjacent texels.
+// Only the first column needs the edge handling, which keeps it out of the
+// loop over the others.
+void
+Image::computeNormalMapRow(Image& normalMap, int i, float scale, bool wrap) const
+{
+    const auto [i0, i1] = handleEdge(i, height, wrap);
+    const std::uint8_t* row0 = pixels.get() + i0 * pitch;
+    const std::uint8_t* row1 = pixels.get() + i1 * pitch;
+    std::uint8_t* nmRow = normalMap.getPixelRow(i);
 
-            int n = rowBase + j * 4;
-            nmPixels[n]     = static_cast<std::uint8_t>(128 + 127 * dx * rmag);
-            nmPixels[n + 1] = static_cast<std::uint8_t>(128 + 127 * dy * rmag);
-            nmPixels[n + 2] = static_cast<std::uint8_t>(128 + 127 * rmag);
-            nmPixels[n + 3] = 255;
-        }
-    }
+    auto computeNormal = [=](int j0, int j1, std::uint8_t* n)
+    {
+        auto h00 = static_cast<int>(row0[j0 * components]);
+        auto h10 = static_cast<int>(row0[j1 * components]);
+        auto h01 = static_cast<int>(row1[j0 * components]);
 
-    return normalMap;
+        auto dx = static_cast<float>(h10 - h00) * (1.0f / 255.0f) * scale;
+        auto dy = static_cast<float>(h01 - h00) * (1.0f / 255.0f) * scale;
+
+        float rmag = 1.0f / std::sqrt(dx * dx + dy * dy + 1.0f);
+
+        n[0] = static_cast<std::uint8_t>(128 + 127 * dx * rmag);
+        n[1] = static_cast<std::uint8_t>(128 + 127 * dy * rmag);
+        n[2] = static_cast<std::uint8_t>(128 + 127 * rmag);
+        n[3] = 255;
+    };
+
+    const auto [j0, j1] = handleEdge(0, width, wrap);
+    computeNormal(j0, j1, nmRow);
+    for (int j = 1; j < width; j++)
+        computeNormal(j, j - 1, nmRow + j * 4);
 }
 
 void Image::forceLinear()
@@ -365,14 +400,14 @@ bool Image::canSave(ContentType type)
     return type == ContentType::PNG || type == ContentType::JPEG;
 }
 
-bool Image::save(const fs::path &path, ContentType type) const
+bool Image::save(const fs::path &path, ContentType type, bool fast) const
 {
     switch (type)
     {
     case ContentType::PNG:
-        return SavePNGImage(path, *this);
+        return SavePNGImage(path, *this, fast);
     case ContentType::JPEG:
-        return SaveJPEGImage(path, *this);
+        return SaveJPEGImage(path, *this, fast);
     default:
         return false;
     }
@@ -405,6 +440,9 @@ std::unique_ptr<Image> Image::load(const fs::path& filename)
     case ContentType::DXT5NormalMap:
         img = LoadDDSImage(filename);
         break;
+    case ContentType::KTX2:
+        img = LoadKTX2Image(filename);
+        break;
     default:
         util::GetLogger()->error(_("{}: unrecognized or unsupported image file type.\n"), filename);
         break;
@@ -61,11 +61,15 @@ public:
     void forceLinear();
 
     static bool canSave(ContentType type);
-    bool save(const fs::path &path, ContentType type) const;
+    // If fast is set, the encoding takes less time at the cost of a larger
+    // file
+    bool save(const fs::path &path, ContentType type, bool fast = false) const;
 
     static std::unique_ptr<Image> load(const fs::path& filename);
 
 private:
+    void computeNormalMapRow(Image& normalMap, int i, float scale, bool wrap) const;
+
     int width;
     int height;
     int pitch;
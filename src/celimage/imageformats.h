@@ -20,11 +20,12 @@ Image* LoadJPEGImage(const fs::path& filename);
 Image* LoadBMPImage(const fs::path& filename);
 Image* LoadPNGImage(const fs::path& filename);
 Image* LoadDDSImage(const fs::path& filename);
+Image* LoadKTX2Image(const fs::path& filename);
 #ifdef USE_LIBAVIF
 Image* LoadAVIFImage(const fs::path& filename);
 #endif
 
-bool SaveJPEGImage(const fs::path& filename, const Image& image);
-bool SavePNGImage(const fs::path& filename, const Image& image);
+bool SaveJPEGImage(const fs::path& filename, const Image& image, bool fast = false);
+bool SavePNGImage(const fs::path& filename, const Image& image, bool fast = false);
 
 } // namespace celestia::engine
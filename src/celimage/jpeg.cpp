@@ -49,7 +49,8 @@ bool SaveJPEGImage(const fs::path& filename,
                    int width, int height,
                    int rowStride,
                    const std::uint8_t *pixels,
-                   bool removeAlpha)
+                   bool removeAlpha,
+                   bool fast)
 {
 #ifdef _WIN32
     FILE* out = _wfopen(filename.c_str(), L"wb");
@@ -80,6 +81,8 @@ bool SaveJPEGImage(const fs::path& filename,
     jpeg_set_defaults(&cinfo);
 
     jpeg_set_quality(&cinfo, 90, TRUE);
+    if (fast)
+        cinfo.dct_method = JDCT_IFAST;
 
     jpeg_start_compress(&cinfo, TRUE);
 
@@ -250,14 +253,15 @@ Image* LoadJPEGImage(const fs::path& filename)
     return img;
 }
 
-bool SaveJPEGImage(const fs::path& filename, const Image& image)
+bool SaveJPEGImage(const fs::path& filename, const Image& image, bool fast)
 {
     return SaveJPEGImage(filename,
                          image.getWidth(),
                          image.getHeight(),
                          image.getPitch(),
                          image.getPixels(),
-                         image.hasAlpha());
+                         image.hasAlpha(),
+                         fast);
 }
 
 } // namespace celestia::engine
@@ -0,0 +1,298 @@
+// ktx2.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Loader for KTX 2.0 texture containers.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+#include <celengine/glsupport.h>
+#include <celutil/bytes.h>
+#include <celutil/logger.h>
+#include "dds_decompress.h"
+#include "image.h"
+
+namespace celestia::engine
+{
+namespace
+{
+
+constexpr std::array<std::uint8_t, 12> KTX2Identifier =
+{
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+};
+
+// Identifier, header and index, up to the level index
+constexpr std::size_t KTX2HeaderSize = 80;
+constexpr std::size_t KTX2LevelIndexEntrySize = 24;
+
+// Mip levels beyond this can't exist in a texture Celestia can load
+constexpr std::uint32_t KTX2MaxLevels = 32;
+
+// VkFormat values of the formats Celestia has a PixelFormat for
+enum VkFormat : std::uint32_t
+{
+    VK_FORMAT_R8_UNORM            = 9,
+    VK_FORMAT_R8_SRGB             = 15,
+    VK_FORMAT_R8G8_UNORM          = 16,
+    VK_FORMAT_R8G8_SRGB           = 22,
+    VK_FORMAT_R8G8B8_UNORM        = 23,
+    VK_FORMAT_R8G8B8_SRGB         = 29,
+    VK_FORMAT_R8G8B8A8_UNORM      = 37,
+    VK_FORMAT_R8G8B8A8_SRGB       = 43,
+    VK_FORMAT_B8G8R8A8_UNORM      = 44,
+    VK_FORMAT_BC1_RGB_UNORM_BLOCK  = 131,
+    VK_FORMAT_BC1_RGB_SRGB_BLOCK   = 132,
+    VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133,
+    VK_FORMAT_BC1_RGBA_SRGB_BLOCK  = 134,
+    VK_FORMAT_BC2_UNORM_BLOCK      = 135,
+    VK_FORMAT_BC2_SRGB_BLOCK       = 136,
+    VK_FORMAT_BC3_UNORM_BLOCK      = 137,
+    VK_FORMAT_BC3_SRGB_BLOCK       = 138,
+};
+
+template<typename T>
+T
+readLE(const std::uint8_t* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return impl::LE_TO_CPU(value);
+}
+
+PixelFormat
+toPixelFormat(std::uint32_t vkFormat)
+{
+    switch (vkFormat)
+    {
+    case VK_FORMAT_R8_UNORM:
+        return PixelFormat::Luminance;
+    case VK_FORMAT_R8_SRGB:
+        return PixelFormat::sLuminance;
+    case VK_FORMAT_R8G8_UNORM:
+        return PixelFormat::LumAlpha;
+    case VK_FORMAT_R8G8_SRGB:
+        return PixelFormat::sLumAlpha;
+    case VK_FORMAT_R8G8B8_UNORM:
+        return PixelFormat::RGB;
+    case VK_FORMAT_R8G8B8_SRGB:
+        return PixelFormat::sRGB;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+        return PixelFormat::RGBA;
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        return PixelFormat::sRGBA;
+#ifndef GL_ES
+    case VK_FORMAT_B8G8R8A8_UNORM:
+        return PixelFormat::BGRA;
+#endif
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        return PixelFormat::DXT1;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        return PixelFormat::DXT1_sRGBA;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+        return PixelFormat::DXT3;
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+        return PixelFormat::DXT3_sRGBA;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+        return PixelFormat::DXT5;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        return PixelFormat::DXT5_sRGBA;
+    default:
+        return PixelFormat::Invalid;
+    }
+}
+
+// Read a mip level. Uncompressed levels have tightly packed rows in KTX2
+// files, while the rows of an Image are padded to four bytes.
+bool
+readLevel(std::ifstream& in, Image& img, int level, std::uint64_t byteLength)
+{
+    auto* data = reinterpret_cast<char*>(img.getMipLevel(level));
+    auto levelSize = static_cast<std::uint64_t>(img.getMipLevelSize(level));
+    if (img.isCompressed())
+    {
+        return byteLength == levelSize &&
+               in.read(data, static_cast<std::streamsize>(byteLength)).good(); /* Flawfinder: ignore */
+    }
+
+    auto levelHeight = static_cast<std::uint64_t>(std::max(img.getHeight() >> level, 1));
+    auto levelWidth = static_cast<std::uint64_t>(std::max(img.getWidth() >> level, 1));
+    auto rowSize = levelWidth * static_cast<std::uint64_t>(img.getComponents());
+    auto pitch = levelSize / levelHeight;
+    if (byteLength != rowSize * levelHeight)
+        return false;
+
+    if (rowSize == pitch)
+        return in.read(data, static_cast<std::streamsize>(byteLength)).good(); /* Flawfinder: ignore */
+
+    for (std::uint64_t row = 0; row < levelHeight; row++)
+    {
+        if (!in.read(data + row * pitch, static_cast<std::streamsize>(rowSize)).good()) /* Flawfinder: ignore */
+            return false;
+    }
+
+    return true;
+}
+
+// Decompress the base level of a DXTc image for drivers without S3TC
+// support. Like for DDS files, DXT1 images lose their alpha channel.
+Image*
+decompressDXTc(const Image& img)
+{
+    int width = img.getWidth();
+    int height = img.getHeight();
+    int blockWidth = (width + 3) / 4;
+    int blockHeight = (height + 3) / 4;
+    bool transparent0 = false;
+    DXTcFormat dxtcFormat;
+    switch (img.getFormat())
+    {
+    case PixelFormat::DXT1:
+    case PixelFormat::DXT1_sRGBA:
+        transparent0 = true;
+        dxtcFormat = DXTcFormat::DXT1;
+        break;
+    case PixelFormat::DXT3:
+    case PixelFormat::DXT3_sRGBA:
+        dxtcFormat = DXTcFormat::DXT3;
+        break;
+    default:
+        dxtcFormat = DXTcFormat::DXT5;
+        break;
+    }
+
+    std::vector<std::uint32_t> pixels(static_cast<std::size_t>(blockWidth * 4) * static_cast<std::size_t>(blockHeight * 4));
+    DecompressDXTc(dxtcFormat,
+                   static_cast<std::uint32_t>(blockWidth * 4),
+                   static_cast<std::uint32_t>(blockHeight * 4),
+                   img.getMipLevel(0),
+                   transparent0,
+                   pixels.data());
+
+    bool sRGB = img.getFormat() == PixelFormat::DXT1_sRGBA ||
+                img.getFormat() == PixelFormat::DXT3_sRGBA ||
+                img.getFormat() == PixelFormat::DXT5_sRGBA;
+    PixelFormat format;
+    if (transparent0)
+        format = sRGB ? PixelFormat::sRGB : PixelFormat::RGB;
+    else
+        format = sRGB ? PixelFormat::sRGBA : PixelFormat::RGBA;
+
+    int components = transparent0 ? 3 : 4;
+    auto* result = new Image(format, width, height);
+    for (int y = 0; y < height; y++)
+    {
+        const auto* src = reinterpret_cast<const std::uint8_t*>(pixels.data() + static_cast<std::size_t>(y * blockWidth * 4));
+        std::uint8_t* dst = result->getPixelRow(y);
+        for (int x = 0; x < width; x++)
+            std::memcpy(dst + x * components, src + x * 4, components);
+    }
+
+    return result;
+}
+
+} // anonymous namespace
+
+Image* LoadKTX2Image(const fs::path& filename)
+{
+    std::ifstream in(filename, std::ios::in | std::ios::binary);
+    if (!in.good())
+    {
+        util::GetLogger()->error("Error opening KTX2 texture file {}.\n", filename);
+        return nullptr;
+    }
+
+    std::array<std::uint8_t, KTX2HeaderSize> header;
+    if (!in.read(reinterpret_cast<char*>(header.data()), header.size()).good() /* Flawfinder: ignore */
+        || std::memcmp(header.data(), KTX2Identifier.data(), KTX2Identifier.size()) != 0)
+    {
+        util::GetLogger()->error("KTX2 texture file {} has bad header.\n", filename);
+        return nullptr;
+    }
+
+    const std::uint8_t* fields = header.data() + KTX2Identifier.size();
+    auto vkFormat = readLE<std::uint32_t>(fields);
+    auto width = readLE<std::uint32_t>(fields + 8);
+    auto height = readLE<std::uint32_t>(fields + 12);
+    auto depth = readLE<std::uint32_t>(fields + 16);
+    auto layerCount = readLE<std::uint32_t>(fields + 20);
+    auto faceCount = readLE<std::uint32_t>(fields + 24);
+    auto levelCount = readLE<std::uint32_t>(fields + 28);
+    auto supercompression = readLE<std::uint32_t>(fields + 32);
+
+    if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1)
+    {
+        util::GetLogger()->error("KTX2 texture file {} is not a 2D texture.\n", filename);
+        return nullptr;
+    }
+
+    if (supercompression != 0)
+    {
+        util::GetLogger()->error("Supercompressed KTX2 texture file {} is not supported.\n", filename);
+        return nullptr;
+    }
+
+    PixelFormat format = toPixelFormat(vkFormat);
+    if (format == PixelFormat::Invalid)
+    {
+        util::GetLogger()->error("Unsupported format {} for KTX2 texture file {}.\n", vkFormat, filename);
+        return nullptr;
+    }
+
+    // A level count of zero asks for the mipmaps to be generated
+    levelCount = std::max(levelCount, 1u);
+    if (levelCount > KTX2MaxLevels)
+    {
+        util::GetLogger()->error("KTX2 texture file {} has bad level count.\n", filename);
+        return nullptr;
+    }
+
+    std::vector<std::uint8_t> levelIndex(static_cast<std::size_t>(levelCount) * KTX2LevelIndexEntrySize);
+    if (!in.read(reinterpret_cast<char*>(levelIndex.data()), levelIndex.size()).good()) /* Flawfinder: ignore */
+    {
+        util::GetLogger()->error("KTX2 texture file {} has bad level index.\n", filename);
+        return nullptr;
+    }
+
+    auto img = std::make_unique<Image>(format,
+                                       static_cast<int>(width),
+                                       static_cast<int>(height),
+                                       static_cast<int>(levelCount));
+    if (!img->isValid())
+        return nullptr;
+
+    // The levels are stored from the smallest to the largest one, while the
+    // image keeps them from the largest one
+    for (std::uint32_t level = 0; level < levelCount; level++)
+    {
+        const std::uint8_t* entry = levelIndex.data() + level * KTX2LevelIndexEntrySize;
+        auto byteOffset = readLE<std::uint64_t>(entry);
+        auto byteLength = readLE<std::uint64_t>(entry + 8);
+        in.seekg(static_cast<std::streamoff>(byteOffset));
+        if (!readLevel(in, *img, static_cast<int>(level), byteLength))
+        {
+            util::GetLogger()->error("Failed reading data from KTX2 texture file {}.\n", filename);
+            return nullptr;
+        }
+    }
+
+    if (img->isCompressed() && !gl::EXT_texture_compression_s3tc)
+        return decompressDXTc(*img);
+
+    return img.release();
+}
+
+} // namespace celestia::engine
@@ -37,7 +37,8 @@ bool SavePNGImage(const fs::path& filename,
                   int width, int height,
                   int rowStride,
                   const std::uint8_t *pixels,
-                  bool removeAlpha)
+                  bool removeAlpha,
+                  bool fast)
 {
 #ifdef _WIN32
     FILE* out = _wfopen(filename.c_str(), L"wb");
@@ -111,7 +112,16 @@ bool SavePNGImage(const fs::path& filename,
     // png_init_io(png_ptr, out);
     png_set_write_fn(png_ptr, (void*) out, PNGWriteData, nullptr);
 
-    png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+    if (fast)
+    {
+        // Sub filtering is almost free and still helps the fastest level
+        png_set_compression_level(png_ptr, Z_BEST_SPEED);
+        png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+    }
+    else
+    {
+        png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
+    }
     png_set_IHDR(png_ptr, info_ptr,
                  width, height,
                  8,
@@ -261,14 +271,15 @@ Image* LoadPNGImage(const fs::path& filename)
     return img;
 }
 
-bool SavePNGImage(const fs::path& filename, const Image& image)
+bool SavePNGImage(const fs::path& filename, const Image& image, bool fast)
 {
     return SavePNGImage(filename,
                         image.getWidth(),
                         image.getHeight(),
                         image.getPitch(),
                         image.getPixels(),
-                        image.hasAlpha());
+                        image.hasAlpha(),
+                        fast);
 }
 
 } // namespace celestia::engine
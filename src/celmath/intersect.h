@@ -132,4 +132,41 @@ template<class T> bool testIntersection(const Eigen::ParametrizedLine<T, 3>& ray
     }
     return false;
 }
+
+
+// Test the segments from origin to each of the points, whose coordinates
+// are the columns of points, against the ellipsoid. occluded[i] is set if
+// the segment to point i enters the ellipsoid before reaching the point,
+// as when testIntersection(ray, ellipsoid, t) gives t < 1 for the ray from
+// origin to point i. All points are processed as whole arrays so that
+// Eigen can vectorize the test.
+template<class T> void testSegmentOcclusion(const Eigen::Matrix<T, 3, 1>& origin,
+                                            const Ellipsoid<T>& e,
+                                            const Eigen::Ref<const Eigen::Array<T, Eigen::Dynamic, 3>>& points,
+                                            Eigen::Ref<Eigen::Array<bool, Eigen::Dynamic, 1>> occluded)
+{
+    using ArrayType = Eigen::Array<T, Eigen::Dynamic, 1>;
+
+    Eigen::Matrix<T, 3, 1> diff = origin - e.center;
+    Eigen::Matrix<T, 3, 1> s = e.axes.cwiseInverse().array().square();
+    Eigen::Matrix<T, 3, 1> sdiff = diff.cwiseProduct(s);
+    T c = diff.dot(sdiff) - static_cast<T>(1);
+
+    ArrayType dx = points.col(0) - origin.x();
+    ArrayType dy = points.col(1) - origin.y();
+    ArrayType dz = points.col(2) - origin.z();
+    ArrayType a = dx.square() * s.x() + dy.square() * s.y() + dz.square() * s.z();
+    ArrayType b = dx * sdiff.x() + dy * sdiff.y() + dz * sdiff.z();
+    ArrayType disc = b.square() - a * c;
+    ArrayType root = disc.max(static_cast<T>(0)).sqrt();
+    ArrayType sol0 = (-b + root) / a;
+    ArrayType sol1 = (-b - root) / a;
+
+    // The nearest solution in front of the origin, picked as in the single
+    // ray test
+    ArrayType t = (sol0 > static_cast<T>(0)).select((sol1 < static_cast<T>(0)).select(sol0, sol1), sol1);
+    occluded = disc >= static_cast<T>(0)
+            && (sol0 > static_cast<T>(0) || sol1 > static_cast<T>(0))
+            && t < static_cast<T>(1);
+}
 } // namespace celestia::math
@@ -12,8 +12,10 @@
 #include <array>
 #include <cstring>
 #include <iterator>
+#include <numeric>
 #include <tuple>
 #include <utility>
+#include <config.h>
 #include <celutil/logger.h>
 
 #ifdef HAVE_MESHOPTIMIZER
@@ -36,6 +38,180 @@ isOpaqueMaterial(const Material &material)
              material.blend != BlendMode::AdditiveBlend;
 }
 
+#ifndef HAVE_MESHOPTIMIZER
+// Size of the post-transform vertex cache the triangles are ordered for
+constexpr unsigned int VertexCacheSize = 16;
+
+// Reorder the triangles of a list for the post-transform vertex cache,
+// using Tipsify by Sander, Nehab and Barczak. The triangles are fanned
+// around one vertex after the other, picking the next vertex among the
+// ones just used by how likely it is still in the cache. The starts of the
+// runs which couldn't continue from a vertex used before are returned,
+// the triangles in between are kept together to reduce overdraw.
+std::vector<std::size_t>
+optimizeVertexCache(std::vector<Index32>& indices, unsigned int vertexCount)
+{
+    std::size_t triangleCount = indices.size() / 3;
+
+    // Triangles using each vertex
+    std::vector<std::uint32_t> liveTriangles(vertexCount, 0);
+    for (Index32 index : indices)
+        liveTriangles[index]++;
+
+    std::vector<std::size_t> adjacencyOffsets(vertexCount + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<std::uint32_t> adjacency(adjacencyOffsets.back());
+    std::vector<std::size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<Index32> deadEnds;
+    std::vector<Index32> candidates;
+    std::vector<Index32> result;
+    result.reserve(indices.size());
+    std::vector<std::size_t> runs;
+
+    unsigned int time = VertexCacheSize + 1;
+    Index32 cursor = 0;
+    auto fanning = static_cast<std::int64_t>(vertexCount > 0 ? 0 : -1);
+    bool newRun = true;
+    while (fanning >= 0)
+    {
+        if (newRun)
+            runs.push_back(result.size() / 3);
+
+        auto vertex = static_cast<Index32>(fanning);
+        candidates.clear();
+        for (std::size_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+        {
+            std::uint32_t triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+
+            for (std::size_t j = 0; j < 3; j++)
+            {
+                Index32 v = indices[triangle * 3 + j];
+                result.push_back(v);
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (time - cacheTime[v] > VertexCacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer the candidate which entered the cache first among the
+        // ones which will still be in it after fanning around them
+        fanning = -1;
+        unsigned int bestPriority = 0;
+        for (Index32 v : candidates)
+        {
+            if (liveTriangles[v] == 0)
+                continue;
+
+            unsigned int priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= VertexCacheSize)
+                priority = time - cacheTime[v];
+            if (priority > bestPriority || fanning < 0)
+            {
+                bestPriority = priority;
+                fanning = v;
+            }
+        }
+
+        newRun = fanning < 0;
+        while (fanning < 0 && !deadEnds.empty())
+        {
+            Index32 v = deadEnds.back();
+            deadEnds.pop_back();
+            if (liveTriangles[v] > 0)
+                fanning = v;
+        }
+
+        while (fanning < 0 && cursor < vertexCount)
+        {
+            if (liveTriangles[cursor] > 0)
+                fanning = cursor;
+            cursor++;
+        }
+    }
+
+    indices = std::move(result);
+    return runs;
+}
+
+
+// Draw the runs of triangles facing outward from the center of the mesh
+// first, as they are the most likely ones to hide others behind them
+void
+optimizeOverdraw(std::vector<Index32>& indices,
+                 const std::vector<std::size_t>& runs,
+                 const VWord* positions,
+                 unsigned int stride)
+{
+    struct Run
+    {
+        std::size_t first;
+        std::size_t count;
+        float order;
+    };
+
+    auto getPosition = [&](Index32 index)
+    {
+        Eigen::Vector3f p;
+        std::memcpy(p.data(), positions + index * stride, sizeof(float) * 3);
+        return p;
+    };
+
+    std::size_t triangleCount = indices.size() / 3;
+    std::vector<Run> sortedRuns;
+    sortedRuns.reserve(runs.size());
+    std::vector<Eigen::Vector3f> centers;
+    std::vector<Eigen::Vector3f> normals;
+    Eigen::Vector3f meshCenter = Eigen::Vector3f::Zero();
+    for (std::size_t r = 0; r < runs.size(); r++)
+    {
+        std::size_t end = r + 1 < runs.size() ? runs[r + 1] : triangleCount;
+        Eigen::Vector3f center = Eigen::Vector3f::Zero();
+        Eigen::Vector3f normal = Eigen::Vector3f::Zero();
+        for (std::size_t t = runs[r]; t < end; t++)
+        {
+            Eigen::Vector3f p0 = getPosition(indices[t * 3]);
+            Eigen::Vector3f p1 = getPosition(indices[t * 3 + 1]);
+            Eigen::Vector3f p2 = getPosition(indices[t * 3 + 2]);
+            center += p0 + p1 + p2;
+            normal += (p1 - p0).cross(p2 - p0);
+        }
+
+        meshCenter += center;
+        centers.push_back(center / static_cast<float>((end - runs[r]) * 3));
+        normals.push_back(normal);
+        sortedRuns.push_back({ runs[r], end - runs[r], 0.0f });
+    }
+
+    meshCenter /= static_cast<float>(triangleCount * 3);
+    for (std::size_t r = 0; r < sortedRuns.size(); r++)
+        sortedRuns[r].order = (centers[r] - meshCenter).dot(normals[r].normalized());
+
+    std::stable_sort(sortedRuns.begin(), sortedRuns.end(),
+                     [](const Run& a, const Run& b) { return a.order > b.order; });
+
+    std::vector<Index32> result;
+    result.reserve(indices.size());
+    for (const Run& run : sortedRuns)
+    {
+        result.insert(result.end(),
+                      indices.begin() + static_cast<std::ptrdiff_t>(run.first * 3),
+                      indices.begin() + static_cast<std::ptrdiff_t>((run.first + run.count) * 3));
+    }
+
+    indices = std::move(result);
+}
+#endif
+
 } // end unnamed namespace
 
 
@@ -165,6 +341,8 @@ Mesh::clone() const
     std::transform(groups.cbegin(), groups.cend(), std::back_inserter(newMesh.groups),
                    [](const PrimitiveGroup& group) { return group.clone(); });
     newMesh.name = name;
+    newMesh.lodMinPixelSize = lodMinPixelSize;
+    newMesh.lodMaxPixelSize = lodMaxPixelSize;
     return newMesh;
 }
 
@@ -264,6 +442,30 @@ Mesh::setName(std::string&& _name)
 }
 
 
+void
+Mesh::setLODRange(float minPixelSize, float maxPixelSize)
+{
+    lodMinPixelSize = minPixelSize;
+    lodMaxPixelSize = maxPixelSize;
+}
+
+
+bool
+Mesh::hasLODRange() const
+{
+    return lodMinPixelSize > 0.0f || lodMaxPixelSize != std::numeric_limits<float>::infinity();
+}
+
+
+bool
+Mesh::isInLODRange(float pixelSize) const
+{
+    // Without an upper limit, the mesh is also drawn at an infinite size
+    return pixelSize >= lodMinPixelSize &&
+           (pixelSize < lodMaxPixelSize || lodMaxPixelSize == std::numeric_limits<float>::infinity());
+}
+
+
 void
 Mesh::remapIndices(const std::vector<Index32>& indexMap)
 {
@@ -355,19 +557,62 @@ Mesh::mergePrimitiveGroups()
 void
 Mesh::optimize()
 {
-#ifdef HAVE_MESHOPTIMIZER
-    if (groups.size() != 1)
+    const VertexAttribute& position = vertexDesc.getAttribute(VertexAttributeSemantic::Position);
+    if (position.format != VertexAttributeFormat::Float3)
         return;
 
-    auto &g = groups.front();
+    bool reordered = false;
+    for (auto &g : groups)
+    {
+        if (g.prim != PrimitiveGroupType::TriList || g.indices.size() % 3 != 0)
+            continue;
+
+#ifdef HAVE_MESHOPTIMIZER
+        meshopt_optimizeVertexCache(g.indices.data(), g.indices.data(), g.indices.size(), nVertices);
+        meshopt_optimizeOverdraw(g.indices.data(), g.indices.data(), g.indices.size(),
+                                 reinterpret_cast<const float*>(vertices.data() + position.offsetWords),
+                                 nVertices, vertexDesc.strideBytes, 1.05f);
+#else
+        std::vector<std::size_t> runs = optimizeVertexCache(g.indices, nVertices);
+        optimizeOverdraw(g.indices, runs, vertices.data() + position.offsetWords, getVertexStrideWords());
+#endif
+        reordered = true;
+    }
 
-    if (g.prim != PrimitiveGroupType::TriList)
+    if (!reordered)
         return;
 
-    meshopt_optimizeVertexCache(g.indices.data(), g.indices.data(), g.indices.size(), nVertices);
-    meshopt_optimizeOverdraw(g.indices.data(), g.indices.data(), g.indices.size(), reinterpret_cast<float*>(vertices.data()), nVertices, vertexDesc.strideBytes, 1.05f);
-    meshopt_optimizeVertexFetch(vertices.data(), g.indices.data(), g.indices.size(), vertices.data(), nVertices, vertexDesc.strideBytes);
-#endif
+    // Order the vertices by their first use, so that they are fetched
+    // sequentially; vertices which aren't used by any group go last
+    constexpr Index32 NoIndex = ~0u;
+    std::vector<Index32> indexMap(nVertices, NoIndex);
+    Index32 nextIndex = 0;
+    for (const auto &g : groups)
+    {
+        for (Index32 index : g.indices)
+        {
+            if (indexMap[index] == NoIndex)
+                indexMap[index] = nextIndex++;
+        }
+    }
+
+    for (Index32& index : indexMap)
+    {
+        if (index == NoIndex)
+            index = nextIndex++;
+    }
+
+    unsigned int stride = getVertexStrideWords();
+    std::vector<VWord> newVertices(vertices.size());
+    for (unsigned int i = 0; i < nVertices; i++)
+    {
+        std::copy(vertices.begin() + static_cast<std::ptrdiff_t>(i * stride),
+                  vertices.begin() + static_cast<std::ptrdiff_t>((i + 1) * stride),
+                  newVertices.begin() + static_cast<std::ptrdiff_t>(indexMap[i] * stride));
+    }
+
+    vertices = std::move(newVertices);
+    remapIndices(indexMap);
 }
 
 void
@@ -662,6 +907,9 @@ Mesh::canMerge(const Mesh &other, const std::vector<Material> &materials) const
         std::tie(og.materialIndex, og.prim, other.vertexDesc.strideBytes))
         return false;
 
+    if (std::tie(lodMinPixelSize, lodMaxPixelSize) != std::tie(other.lodMinPixelSize, other.lodMaxPixelSize))
+        return false;
+
     if (!isOpaqueMaterial(materials[tg.materialIndex]) || !isOpaqueMaterial(materials[og.materialIndex]))
         return false;
 
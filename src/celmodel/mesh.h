@@ -13,6 +13,7 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
@@ -221,6 +222,16 @@ class Mesh
     const std::string& getName() const;
     void setName(std::string&&);
 
+    /*! Meshes of a model with several levels of detail are only drawn
+     *  while the projected radius of the model in pixels is at least
+     *  minPixelSize and less than maxPixelSize.
+     */
+    void setLODRange(float minPixelSize, float maxPixelSize);
+    float getLODMinPixelSize() const { return lodMinPixelSize; }
+    float getLODMaxPixelSize() const { return lodMaxPixelSize; }
+    bool hasLODRange() const;
+    bool isInLODRange(float pixelSize) const;
+
     bool pick(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, PickResult* result) const;
     bool pick(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, double& distance) const;
 
@@ -253,6 +264,9 @@ class Mesh
     std::vector<PrimitiveGroup> groups;
 
     std::string name;
+
+    float lodMinPixelSize{ 0.0f };
+    float lodMaxPixelSize{ std::numeric_limits<float>::infinity() };
 };
 
 Mesh GenerateTangents(const Mesh& mesh);
@@ -13,6 +13,7 @@
 #include <cassert>
 #include <cstring>
 #include <istream>
+#include <limits>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -22,6 +23,7 @@
 #include <fmt/format.h>
 #include <fmt/ostream.h>
 
+#include <celcompat/bit.h>
 #include <celutil/binaryread.h>
 #include <celutil/binarywrite.h>
 #include <celutil/logger.h>
@@ -60,6 +62,7 @@ constexpr std::string_view EndVertexDescToken = "end_vertexdesc"sv;
 constexpr std::string_view VerticesToken = "vertices"sv;
 constexpr std::string_view MaterialToken = "material"sv;
 constexpr std::string_view EndMaterialToken = "end_material"sv;
+constexpr std::string_view LODToken = "lod"sv;
 
 // Binary file tokens
 enum class CmodToken
@@ -78,6 +81,7 @@ enum class CmodToken
     Vertices      = 1013,
     Emissive      = 1014,
     Blend         = 1015,
+    LOD           = 1016,
 };
 
 enum class CmodType
@@ -172,6 +176,7 @@ defined here--they have the obvious definitions.
 <mesh_definition>     ::= mesh
                           <vertex_description>
                           <vertex_pool>
+                          [ <lod_range> ]
                           { <prim_group> }
                           end_mesh
 
@@ -192,6 +197,8 @@ defined here--they have the obvious definitions.
 
 <count>               ::= <unsigned_int>
 
+<lod_range>           ::= lod <float> [ <float> ]
+
 <prim_group>          ::= <prim_group_type> <material_index> <count>
                           { <unsigned_int> }
 
@@ -201,8 +208,19 @@ defined here--they have the obvious definitions.
 
 <material_index>      :: <unsigned_int> | -1
 \endcode
+
+The optional LOD range gives the minimum and maximum projected radius in
+pixels of the model at which the mesh is drawn; without a maximum, the
+mesh is drawn however large the model appears.
 */
 
+bool
+isValidLODRange(float minPixelSize, float maxPixelSize)
+{
+    return minPixelSize >= 0.0f && maxPixelSize > minPixelSize;
+}
+
+
 PrimitiveGroupType
 parsePrimitiveGroupType(std::string_view name)
 {
@@ -309,6 +327,7 @@ private:
     bool loadMaterial(Material& material);
     VertexDescription loadVertexDescription();
     bool loadMesh(Mesh& mesh);
+    bool loadLODRange(Mesh& mesh);
     std::vector<VWord> loadVertices(const VertexDescription& vertexDesc,
                                     unsigned int& vertexCount);
     bool loadUByte4Attribute(const VertexAttribute& attr,
@@ -687,6 +706,16 @@ AsciiModelLoader::loadMesh(Mesh& mesh)
     mesh.setVertexDescription(std::move(vertexDesc));
     mesh.setVertices(vertexCount, std::move(vertexData));
 
+    if (tok.nextToken() == Tokenizer::TokenName && tok.getNameValue() == LODToken)
+    {
+        if (!loadLODRange(mesh))
+            return false;
+    }
+    else
+    {
+        tok.pushBack();
+    }
+
     for (;;)
     {
         tok.nextToken();
@@ -769,6 +798,34 @@ AsciiModelLoader::loadMesh(Mesh& mesh)
 }
 
 
+bool
+AsciiModelLoader::loadLODRange(Mesh& mesh)
+{
+    tok.nextToken();
+    auto minPixelSize = tok.getNumberValue();
+    if (!minPixelSize.has_value())
+    {
+        reportError("LOD range expected");
+        return false;
+    }
+
+    auto maxPixelSize = static_cast<double>(std::numeric_limits<float>::infinity());
+    if (tok.nextToken() == Tokenizer::TokenNumber)
+        maxPixelSize = *tok.getNumberValue();
+    else
+        tok.pushBack();
+
+    if (!isValidLODRange(static_cast<float>(*minPixelSize), static_cast<float>(maxPixelSize)))
+    {
+        reportError("Bad LOD range");
+        return false;
+    }
+
+    mesh.setLODRange(static_cast<float>(*minPixelSize), static_cast<float>(maxPixelSize));
+    return true;
+}
+
+
 std::unique_ptr<Model>
 AsciiModelLoader::load()
 {
@@ -961,6 +1018,15 @@ AsciiModelWriter::writeMesh(const Mesh& mesh)
     fmt::print(*out, "\n");
     if (!out->good()) { return false; }
 
+    if (mesh.hasLODRange())
+    {
+        if (mesh.getLODMaxPixelSize() == std::numeric_limits<float>::infinity())
+            fmt::print(*out, "lod {}\n\n", mesh.getLODMinPixelSize());
+        else
+            fmt::print(*out, "lod {} {}\n\n", mesh.getLODMinPixelSize(), mesh.getLODMaxPixelSize());
+        if (!out->good()) { return false; }
+    }
+
     for (unsigned int groupIndex = 0; mesh.getGroup(groupIndex) != nullptr; groupIndex++)
     {
         if (!writeGroup(*mesh.getGroup(groupIndex))) { return false; }
@@ -1366,8 +1432,6 @@ private:
     bool loadMesh(Mesh& mesh);
     std::vector<VWord> loadVertices(const VertexDescription& vertexDesc,
                                     unsigned int& vertexCount);
-    bool loadAttribute(const VertexAttribute& attr,
-                       cmod::VWord* destination);
 
     std::istream* in;
 };
@@ -1660,6 +1724,21 @@ BinaryModelLoader::loadMesh(Mesh& mesh)
         {
             break;
         }
+        if (tok == static_cast<std::int16_t>(CmodToken::LOD))
+        {
+            float minPixelSize;
+            float maxPixelSize;
+            if (!readTypeFloat1(*in, minPixelSize)
+                || !readTypeFloat1(*in, maxPixelSize)
+                || !isValidLODRange(minPixelSize, maxPixelSize))
+            {
+                reportError("Bad LOD range");
+                return false;
+            }
+
+            mesh.setLODRange(minPixelSize, maxPixelSize);
+            continue;
+        }
         if (tok < 0 || tok >= static_cast<std::int16_t>(PrimitiveGroupType::PrimitiveTypeMax))
         {
             reportError("Bad primitive group type");
@@ -1675,19 +1754,24 @@ BinaryModelLoader::loadMesh(Mesh& mesh)
             return false;
         }
 
-        std::vector<Index32> indices;
-        indices.reserve(indexCount);
+        std::vector<Index32> indices(indexCount);
+        if (!in->read(reinterpret_cast<char*>(indices.data()), /* Flawfinder: ignore */
+                      static_cast<std::streamsize>(indexCount * sizeof(Index32))).good())
+        {
+            reportError("Could not read primitive indices");
+            return false;
+        }
 
-        for (unsigned int i = 0; i < indexCount; i++)
+        for (Index32& index : indices)
         {
-            std::uint32_t index;
-            if (!util::readLE<std::uint32_t>(*in, index) || index >= vertexCount)
+            if constexpr (celestia::compat::endian::native != celestia::compat::endian::little)
+                index = celestia::compat::byteswap(index);
+
+            if (index >= vertexCount)
             {
                 reportError("Index out of range");
                 return false;
             }
-
-            indices.push_back(index);
         }
 
         mesh.addGroup(type, materialIndex, std::move(indices));
@@ -1717,16 +1801,29 @@ BinaryModelLoader::loadVertices(const VertexDescription& vertexDesc,
     unsigned int vertexDataSize = stride * vertexCount;
     std::vector<VWord> vertexData(vertexDataSize);
 
-    unsigned int offset = 0;
-    for (unsigned int i = 0; i < vertexCount; i++, offset += stride)
+    // The attributes of a vertex are stored in the order of the vertex
+    // description, without padding, which is also their layout in memory.
+    // The vertices are thus read in a single block.
+    if (!in->read(reinterpret_cast<char*>(vertexData.data()), /* Flawfinder: ignore */
+                  static_cast<std::streamsize>(vertexDataSize * sizeof(VWord))).good())
     {
-        assert(offset < vertexDataSize);
-        for (const auto& attr : vertexDesc.attributes)
+        reportError("Failed to load vertex attribute");
+        return {};
+    }
+
+    // Floats are stored little-endian, UByte4 attributes as four bytes
+    if constexpr (celestia::compat::endian::native != celestia::compat::endian::little)
+    {
+        for (unsigned int offset = 0; offset < vertexDataSize; offset += stride)
         {
-            if (!loadAttribute(attr, vertexData.data() + offset))
+            for (const auto& attr : vertexDesc.attributes)
             {
-                reportError("Failed to load vertex attribute");
-                return {};
+                if (attr.format == VertexAttributeFormat::UByte4)
+                    continue;
+
+                VWord* words = vertexData.data() + offset + attr.offsetWords;
+                for (unsigned int i = 0; i < VertexAttribute::getFormatSizeWords(attr.format); ++i)
+                    words[i] = celestia::compat::byteswap(words[i]);
             }
         }
     }
@@ -1735,46 +1832,6 @@ BinaryModelLoader::loadVertices(const VertexDescription& vertexDesc,
 }
 
 
-bool
-BinaryModelLoader::loadAttribute(const VertexAttribute& attr,
-                                 cmod::VWord* destination)
-{
-    destination += attr.offsetWords;
-    if (attr.format == VertexAttributeFormat::UByte4)
-    {
-        return util::readNative<std::uint32_t>(*in, *destination);
-    }
-
-    std::array<float, 4> f;
-    std::size_t readCount;
-    switch (attr.format)
-    {
-    case VertexAttributeFormat::Float1:
-        readCount = 1;
-        break;
-    case VertexAttributeFormat::Float2:
-        readCount = 2;
-        break;
-    case VertexAttributeFormat::Float3:
-        readCount = 3;
-        break;
-    case VertexAttributeFormat::Float4:
-        readCount = 4;
-        break;
-    default:
-        return false;
-    }
-
-    for (std::size_t i = 0; i < readCount; ++i)
-    {
-        if (!util::readLE<float>(*in, f[i])) { return false; }
-    }
-
-    std::memcpy(destination, f.data(), sizeof(float) * readCount);
-    return true;
-}
-
-
 /***** Binary writer *****/
 
 bool writeToken(std::ostream& out, CmodToken val)
@@ -1890,6 +1947,14 @@ BinaryModelWriter::writeMesh(const Mesh& mesh)
         return false;
     }
 
+    if (mesh.hasLODRange()
+        && (!writeToken(*out, CmodToken::LOD)
+            || !writeTypeFloat1(*out, mesh.getLODMinPixelSize())
+            || !writeTypeFloat1(*out, mesh.getLODMaxPixelSize())))
+    {
+        return false;
+    }
+
     for (unsigned int groupIndex = 0; mesh.getGroup(groupIndex) != nullptr; groupIndex++)
     {
         if (!writeGroup(*mesh.getGroup(groupIndex))) { return false; }
@@ -19,13 +19,20 @@
 #include <celmodel/mesh.h>
 #include <celutil/array_view.h>
 #include <celutil/logger.h>
+#include <celutil/parallelfor.h>
 
 using celestia::util::GetLogger;
+using celestia::util::ParallelFor;
 using celestia::util::array_view;
 
 namespace
 {
 
+// Faces handled by each task of the parallel loops, and the maximum
+// number of threads they run on
+constexpr std::size_t FacesPerTask = 4096;
+constexpr unsigned int MaxTangentThreads = 8;
+
 struct Face
 {
     Eigen::Vector3f normal;
@@ -217,25 +224,28 @@ GenerateTangents(const Mesh& mesh)
     const VWord* vertexData = mesh.getVertexData();
 
     // Compute tangents for faces
-    for (std::uint32_t f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxTangentThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-        Eigen::Vector3f p0 = getVertex(vertexData, posOffset, stride, face.i[0]);
-        Eigen::Vector3f p1 = getVertex(vertexData, posOffset, stride, face.i[1]);
-        Eigen::Vector3f p2 = getVertex(vertexData, posOffset, stride, face.i[2]);
-        Eigen::Vector2f tc0 = getTexCoord(vertexData, texCoordOffset, stride, face.i[0]);
-        Eigen::Vector2f tc1 = getTexCoord(vertexData, texCoordOffset, stride, face.i[1]);
-        Eigen::Vector2f tc2 = getTexCoord(vertexData, texCoordOffset, stride, face.i[2]);
-        float s1 = tc1.x() - tc0.x();
-        float s2 = tc2.x() - tc0.x();
-        float t1 = tc1.y() - tc0.y();
-        float t2 = tc2.y() - tc0.y();
-        float a = s1 * t2 - s2 * t1;
-        if (a != 0.0f)
-            face.normal = (t2 * (p1 - p0) - t1 * (p2 - p0)) * (1.0f / a);
-        else
-            face.normal = Eigen::Vector3f::Zero();
-    }
+        for (std::size_t f = begin; f < end; f++)
+        {
+            Face& face = faces[f];
+            Eigen::Vector3f p0 = getVertex(vertexData, posOffset, stride, face.i[0]);
+            Eigen::Vector3f p1 = getVertex(vertexData, posOffset, stride, face.i[1]);
+            Eigen::Vector3f p2 = getVertex(vertexData, posOffset, stride, face.i[2]);
+            Eigen::Vector2f tc0 = getTexCoord(vertexData, texCoordOffset, stride, face.i[0]);
+            Eigen::Vector2f tc1 = getTexCoord(vertexData, texCoordOffset, stride, face.i[1]);
+            Eigen::Vector2f tc2 = getTexCoord(vertexData, texCoordOffset, stride, face.i[2]);
+            float s1 = tc1.x() - tc0.x();
+            float s2 = tc2.x() - tc0.x();
+            float t1 = tc1.y() - tc0.y();
+            float t2 = tc2.y() - tc0.y();
+            float a = s1 * t2 - s2 * t1;
+            if (a != 0.0f)
+                face.normal = (t2 * (p1 - p0) - t1 * (p2 - p0)) * (1.0f / a);
+            else
+                face.normal = Eigen::Vector3f::Zero();
+        }
+    });
 
     // Count the number of faces in which each vertex appears
     std::vector<std::uint32_t> faceCounts(nVertices, 0);
@@ -274,19 +284,6 @@ GenerateTangents(const Mesh& mesh)
         vertexFaces[face.i[2]][faceCounts[face.i[2]]--] = f;
     }
 
-    // Compute the vertex tangents by averaging
-    std::vector<Eigen::Vector3f> vertexTangents(nFaces * 3);
-    for (std::uint32_t f = 0; f < nFaces; f++)
-    {
-        const Face& face = faces[f];
-        for (std::uint32_t j = 0; j < 3; j++)
-        {
-            vertexTangents[f * 3 + j] = averageFaceVectors(faces, f,
-                                                           &vertexFaces[face.i[j]][1],
-                                                           vertexFaces[face.i[j]][0]);
-        }
-    }
-
     // Create the new vertex description
     VertexDescription newDesc = desc.clone();
     augmentVertexDescription(newDesc, VertexAttributeSemantic::Tangent, VertexAttributeFormat::Float3);
@@ -319,29 +316,36 @@ GenerateTangents(const Mesh& mesh)
         }
     }
 
-    // Copy the old vertex data along with the generated tangents to the
-    // new vertex data buffer.
+    // Compute the vertex tangents by averaging, and copy them along with
+    // the old vertex data to the new vertex data buffer.
     unsigned int newStride = newDesc.strideBytes / sizeof(VWord);
     std::vector<VWord> newVertexData(newStride * nFaces * 3);
-    for (std::uint32_t f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxTangentThreads, [&](std::size_t begin, std::size_t end)
     {
-        const Face& face = faces[f];
-
-        for (std::uint32_t j = 0; j < 3; j++)
+        for (std::size_t f = begin; f < end; f++)
         {
-            VWord* newVertex = newVertexData.data() + (f * 3 + j) * newStride;
-            copyVertex(newVertex, newDesc,
-                       vertexData, desc,
-                       face.i[j],
-                       fromOffsets);
-            std::memcpy(newVertex + tangentOffset, vertexTangents[f * 3 + j].data(), 3 * sizeof(float));
+            const Face& face = faces[f];
+
+            for (std::uint32_t j = 0; j < 3; j++)
+            {
+                Eigen::Vector3f tangent = averageFaceVectors(faces, static_cast<std::uint32_t>(f),
+                                                             &vertexFaces[face.i[j]][1],
+                                                             vertexFaces[face.i[j]][0]);
+                VWord* newVertex = newVertexData.data() + (f * 3 + j) * newStride;
+                copyVertex(newVertex, newDesc,
+                           vertexData, desc,
+                           face.i[j],
+                           fromOffsets);
+                std::memcpy(newVertex + tangentOffset, tangent.data(), 3 * sizeof(float));
+            }
         }
-    }
+    });
 
     // Create the Celestia mesh
     Mesh newMesh;
     newMesh.setVertexDescription(std::move(newDesc));
     newMesh.setVertices(nFaces * 3, std::move(newVertexData));
+    newMesh.setLODRange(mesh.getLODMinPixelSize(), mesh.getLODMaxPixelSize());
 
     std::uint32_t firstIndex = 0;
     for (std::uint32_t groupIndex = 0; mesh.getGroup(groupIndex) != nullptr; ++groupIndex)
@@ -39,25 +39,44 @@ void AsterismRenderer::render(const Color &defaultColor, const Matrices &mvp)
         m_initialized = true;
     }
 
-    m_lineRenderer.render(mvp, defaultColor, m_totalLineCount * 2);
-
     assert(m_asterisms->size() == m_lineCount.size());
 
-    int offset = 0;
+    // The lines of all asterisms stay in one static buffer, so hiding or
+    // recoloring an asterism only changes which ranges are drawn. Adjacent
+    // visible asterisms of the same color are drawn together.
     float opacity = defaultColor.alpha();
+    Color runColor = defaultColor;
+    int runOffset = 0;
+    int runCount = 0;
+    int offset = 0;
     for (std::size_t size = m_asterisms->size(), i = 0; i < size; i++)
     {
         const auto& ast = (*m_asterisms)[i];
-        if (!ast.getActive() || !ast.isColorOverridden())
+        if (ast.getActive())
         {
-            offset += m_lineCount[i];
-            continue;
+            Color color = ast.isColorOverridden() ? Color(ast.getOverrideColor(), opacity) : defaultColor;
+            if (runCount > 0 && color != runColor)
+            {
+                m_lineRenderer.render(mvp, runColor, runCount * 2, runOffset * 2);
+                runCount = 0;
+            }
+            if (runCount == 0)
+            {
+                runColor = color;
+                runOffset = offset;
+            }
+            runCount += m_lineCount[i];
+        }
+        else if (runCount > 0)
+        {
+            m_lineRenderer.render(mvp, runColor, runCount * 2, runOffset * 2);
+            runCount = 0;
         }
-
-        Color color = {ast.getOverrideColor(), opacity};
-        m_lineRenderer.render(mvp, color, m_lineCount[i] * 2, offset * 2);
         offset += m_lineCount[i];
     }
+
+    if (runCount > 0)
+        m_lineRenderer.render(mvp, runColor, runCount * 2, runOffset * 2);
     m_lineRenderer.finish();
 }
 
@@ -85,8 +104,6 @@ bool AsterismRenderer::prepare()
     if (vtx_num == 0)
         return false;
 
-    m_totalLineCount = vtx_num;
-
     for (const auto& ast : *m_asterisms)
     {
         for (int k = 0; k < ast.getChainCount(); k++)
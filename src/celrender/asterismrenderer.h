@@ -41,7 +41,6 @@ private:
     LineRenderer        m_lineRenderer;
     std::vector<int>    m_lineCount;
     const AsterismList *m_asterisms       { nullptr };
-    int                 m_totalLineCount  { 0 };
     bool                m_initialized     { false };
 };
 
@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 #include <Eigen/Geometry>
 
@@ -40,17 +41,13 @@ namespace
 {
 constexpr int MaxCometTailPoints = 120;
 constexpr int MaxCometTailSlices = 48;
-constexpr int MaxVertices = MaxCometTailPoints*MaxCometTailSlices;
-constexpr int MaxIndices = IndexListCapacity(MaxCometTailSlices, MaxCometTailPoints);
 
 // Distance from the Sun at which comet tails will start to fade out
 constexpr float CometTailAttenDistSol = astro::AUtoKilometers(5.0f);
 } // end unnamed namespace
 
 CometRenderer::CometRenderer(Renderer &renderer) :
-    m_renderer(renderer),
-    m_vertices(std::make_unique<CometTailVertex[]>(MaxVertices)),
-    m_indices(std::make_unique<ushort[]>(MaxIndices))
+    m_renderer(renderer)
 {
 }
 
@@ -68,12 +65,81 @@ CometRenderer::initGL()
 
     m_brightnessLoc = m_prog->attribIndex("in_Brightness");
 
-    m_vo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::TriangleStrip);
-    m_bo = std::make_unique<gl::Buffer>(gl::Buffer::TargetHint::Array);
-    m_io = std::make_unique<gl::Buffer>(gl::Buffer::TargetHint::ElementArray);
+    m_initialized = true;
+    return true;
+}
+
+void
+CometRenderer::deinitGL()
+{
+    m_initialized = false;
+    for (TailMesh &tail : m_tails)
+        tail = TailMesh();
+}
+
+// Build the mesh of a tail of unit length pointing along the z axis, with
+// the x and y axes standing for the u and w axes of the tail frame.
+gl::VertexObject &
+CometRenderer::getTail(int level)
+{
+    TailMesh &tail = m_tails[level];
+    if (tail.vo != nullptr)
+        return *tail.vo;
+
+    float lod = static_cast<float>(level + 1) / static_cast<float>(nLODs);
+    auto nTailPoints = static_cast<int>(MaxCometTailPoints * lod);
+    auto nTailSlices = static_cast<int>(MaxCometTailSlices * lod);
+
+    constexpr float dustTailRadius = 0.1f;
+
+    std::vector<CometTailVertex> vertices;
+    vertices.reserve(static_cast<std::size_t>(nTailPoints) * static_cast<std::size_t>(nTailSlices));
+    for (int i = 0; i < nTailPoints; i++)
+    {
+        float brightness = 1.0f - static_cast<float>(i) / static_cast<float>(nTailPoints - 1);
+        float alpha = static_cast<float>(i) / static_cast<float>(nTailPoints);
+        float z = alpha * alpha;
+
+        float w0, w1;
+        // Special case for the first vertex in the comet tail
+        if (i == 0)
+        {
+            w0 = 1.0f;
+            w1 = 0.0f;
+        }
+        else
+        {
+            float alpha0 = static_cast<float>(i - 1) / static_cast<float>(nTailPoints);
+            float sectionLength = z - alpha0 * alpha0;
+            float dr = dustTailRadius / static_cast<float>(nTailPoints) / sectionLength;
+            w0 = std::atan(dr);
+            float d = std::sqrt(1.0f + w0 * w0);
+            w1 = 1.0f / d;
+            w0 = w0 / d;
+        }
+
+        float radius = static_cast<float>(i) / static_cast<float>(nTailPoints) * dustTailRadius;
+        for (int j = 0; j < nTailSlices; j++)
+        {
+            float theta = 2.0f * numbers::pi_v<float> * static_cast<float>(j) / static_cast<float>(nTailSlices);
+            float s, c;
+            math::sincos(theta, s, c);
+            CometTailVertex &vtx = vertices.emplace_back();
+            vtx.normal = Eigen::Vector3f(s * w1, c * w1, w0).normalized();
+            vtx.point = Eigen::Vector3f(s * radius, c * radius, z);
+            vtx.brightness = brightness;
+        }
+    }
 
-    m_vo->addVertexBuffer(
-            *m_bo,
+    std::vector<ushort> indices;
+    BuildIndexList(static_cast<ushort>(nTailPoints - 1), static_cast<ushort>(nTailSlices), indices);
+
+    tail.bo = std::make_unique<gl::Buffer>(gl::Buffer::TargetHint::Array, vertices);
+    tail.io = std::make_unique<gl::Buffer>(gl::Buffer::TargetHint::ElementArray, indices);
+    tail.vo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::TriangleStrip);
+    tail.vo->setCount(IndexListCapacity(nTailSlices, nTailPoints))
+        .addVertexBuffer(
+            *tail.bo,
             CelestiaGLProgram::VertexCoordAttributeIndex,
             3,
             gl::VertexObject::DataType::Float,
@@ -81,7 +147,7 @@ CometRenderer::initGL()
             sizeof(CometTailVertex),
             offsetof(CometTailVertex, point))
         .addVertexBuffer(
-            *m_bo,
+            *tail.bo,
             CelestiaGLProgram::NormalAttributeIndex,
             3,
             gl::VertexObject::DataType::Float,
@@ -89,26 +155,18 @@ CometRenderer::initGL()
             sizeof(CometTailVertex),
             offsetof(CometTailVertex, normal))
         .addVertexBuffer(
-            *m_bo,
+            *tail.bo,
             m_brightnessLoc,
             1,
             gl::VertexObject::DataType::Float,
             false,
             sizeof(CometTailVertex),
             offsetof(CometTailVertex, brightness))
-        .setIndexBuffer(*m_io, 0, gl::VertexObject::IndexType::UnsignedShort);
+        .setIndexBuffer(*tail.io, 0, gl::VertexObject::IndexType::UnsignedShort);
+    tail.bo->unbind();
+    tail.io->unbind();
 
-    m_initialized = true;
-    return true;
-}
-
-void
-CometRenderer::deinitGL()
-{
-    m_initialized = false;
-    m_vo = nullptr;
-    m_bo = nullptr;
-    m_io = nullptr;
+    return *tail.vo;
 }
 
 void
@@ -119,23 +177,15 @@ CometRenderer::render(const Body &body,
                       float discSizeInPixels,
                       const Matrices &m)
 {
-    if (m_prog == nullptr)
+    if (m_prog == nullptr || dustTailLength <= 0.0f)
         return;
 
     double now = observer.getTime();
 
-    Eigen::Vector3f cometPoints[MaxCometTailPoints];
-#if 0
-    Eigen::Vector3d pos0 = body.getOrbit(now)->positionAtTime(now);
-    Eigen::Vector3d pos1 = body.getOrbit(now)->positionAtTime(now - 0.01);
-    Eigen::Vector3d vd = pos1 - pos0;
-#endif
-
     // Adjust the amount of triangles used for the comet tail based on
     // the screen size of the comet.
     float lod = std::clamp(discSizeInPixels / 1000.0f, 0.2f, 1.0f);
-    auto nTailPoints = static_cast<int>(MaxCometTailPoints * lod);
-    auto nTailSlices = static_cast<int>(MaxCometTailSlices * lod);
+    int level = std::clamp(static_cast<int>(std::ceil(lod * nLODs)) - 1, 0, nLODs - 1);
 
     float irradiance_max = 0.0f;
     // Find the sun with the largest irrradiance of light onto the comet
@@ -163,83 +213,19 @@ CometRenderer::render(const Body &body,
     // direction to sun with dominant light irradiance:
     Eigen::Vector3f sunDir = (pos.cast<double>() - sunPos).cast<float>().normalized();
 
-    float dustTailRadius = dustTailLength * 0.1f;
-
-    Eigen::Vector3f origin = -sunDir * (body.getRadius() * 100);
-
-    for (int i = 0; i < nTailPoints; i++)
-    {
-        float alpha = static_cast<float>(i) / static_cast<float>(nTailPoints);
-        alpha = alpha * alpha;
-        cometPoints[i] = origin + sunDir * (dustTailLength * alpha);
-    }
-
     // We need three axes to define the coordinate system for rendering the
     // comet. The first axis is the sun-to-comet direction, and the other
     // two are chose orthogonal to each other and the primary axis.
-    Eigen::Vector3f v = (cometPoints[1] - cometPoints[0]).normalized();
-    Eigen::Quaternionf q = body.getEclipticToEquatorial(now).cast<float>();
+    Eigen::Vector3f v = sunDir;
     Eigen::Vector3f u = v.unitOrthogonal();
     Eigen::Vector3f w = u.cross(v);
 
-    for (int i = 0; i < nTailPoints; i++)
-    {
-        float brightness = 1.0f - static_cast<float>(i) / static_cast<float>(nTailPoints - 1);
-        Eigen::Vector3f v0, v1;
-        float w0, w1;
-        // Special case for the first vertex in the comet tail
-        if (i == 0)
-        {
-            v0 = cometPoints[1] - cometPoints[0];
-            v0.normalize();
-            v1 = v0;
-            w0 = 1.0f;
-            w1 = 0.0f;
-        }
-        else
-        {
-            v0 = cometPoints[i] - cometPoints[i - 1];
-            float sectionLength = v0.norm();
-            v0.normalize();
+    Eigen::Matrix3f tailAxes;
+    tailAxes << u, w, v;
 
-            if (i == nTailPoints - 1)
-            {
-                v1 = v0;
-            }
-            else
-            {
-                v1 = (cometPoints[i + 1] - cometPoints[i]).normalized();
-                q.setFromTwoVectors(v0, v1);
-                Eigen::Matrix3f rot = q.toRotationMatrix();
-                u = rot * u;
-                v = rot * v;
-                w = rot * w;
-            }
-            float dr = dustTailRadius / static_cast<float>(nTailPoints) / sectionLength;
-            w0 = std::atan(dr);
-            float d = std::sqrt(1.0f + w0 * w0);
-            w1 = 1.0f / d;
-            w0 = w0 / d;
-        }
-
-        float radius = static_cast<float>(i) / static_cast<float>(nTailPoints) * dustTailRadius;
-        for (int j = 0; j < nTailSlices; j++)
-        {
-            float theta = 2.0f * numbers::pi_v<float> * static_cast<float>(j) / static_cast<float>(nTailSlices);
-            float s, c;
-            math::sincos(theta, s, c);
-            CometTailVertex& vtx = m_vertices[i * nTailSlices + j];
-            vtx.normal = u * (s * w1) + w * (c * w1) + v * w0;
-            vtx.normal.normalize();
-            s *= radius;
-            c *= radius;
-
-            vtx.point = cometPoints[i] + u * s + w * c;
-            vtx.brightness = brightness;
-        }
-    }
-
-    BuildIndexList(static_cast<ushort>(nTailPoints-1), static_cast<ushort>(nTailSlices), m_indices.get());
+    Eigen::Matrix4f tailTransform = Eigen::Matrix4f::Identity();
+    tailTransform.topLeftCorner<3, 3>() = tailAxes * dustTailLength;
+    tailTransform.topRightCorner<3, 1>() = -sunDir * (body.getRadius() * 100);
 
     // If fadeDistFromSun = x/x0 >= 1.0, comet tail starts fading,
     // i.e. fadeFactor quickly transits from 1 to 0.
@@ -252,22 +238,14 @@ CometRenderer::render(const Body &body,
     m_renderer.setPipelineState(ps);
 
     m_prog->use();
-    m_prog->setMVPMatrices(*m.projection, (*m.modelview) * math::translate(pos));
+    m_prog->setMVPMatrices(*m.projection, (*m.modelview) * math::translate(pos) * tailTransform);
     m_prog->vec3Param("color") = GetBodyFeaturesManager()->getCometTailColor(&body).toVector3();
-    m_prog->vec3Param("viewDir") = pos.normalized();
+    // The normals of the mesh are in the tail frame
+    m_prog->vec3Param("viewDir") = tailAxes.transpose() * pos.normalized();
     m_prog->floatParam("fadeFactor") = fadeFactor;
 
-    m_bo->invalidateData().setData(
-        util::array_view(m_vertices.get(), MaxVertices),
-        gl::Buffer::BufferUsage::StreamDraw);
-
-    m_io->invalidateData().setData(
-        util::array_view(m_indices.get(), MaxIndices),
-        gl::Buffer::BufferUsage::StreamDraw);
-
     glDisable(GL_CULL_FACE);
-    int count = IndexListCapacity(nTailSlices, nTailPoints);
-    m_vo->draw(count);
+    getTail(level).draw();
     glEnable(GL_CULL_FACE);
 }
 
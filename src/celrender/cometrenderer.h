@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <array>
 #include <memory>
 
 #include <Eigen/Core>
@@ -29,6 +30,11 @@ class VertexObject;
 namespace celestia::render
 {
 
+// Draws the dust tails of the comets from meshes built once for each level
+// of detail. The tail points away from the Sun along a straight line, so
+// its shape only depends on the number of points and slices; the mesh is
+// built for a tail of unit length, and is oriented, scaled and placed for
+// each comet by the model view matrix.
 class CometRenderer
 {
 public:
@@ -50,6 +56,7 @@ public:
     void deinitGL();
 
 private:
+    static constexpr int nLODs = 5;
 
     struct CometTailVertex
     {
@@ -58,15 +65,20 @@ private:
         float brightness;
     };
 
+    struct TailMesh
+    {
+        std::unique_ptr<gl::Buffer>       bo;
+        std::unique_ptr<gl::Buffer>       io;
+        std::unique_ptr<gl::VertexObject> vo;
+    };
+
+    gl::VertexObject &getTail(int level);
+
     Renderer                          &m_renderer;
     CelestiaGLProgram                 *m_prog{ nullptr };
     int                                m_brightnessLoc{ -1 };
     bool                               m_initialized{ false };
-    std::unique_ptr<CometTailVertex[]> m_vertices;
-    std::unique_ptr<unsigned short[]>  m_indices;
-    std::unique_ptr<gl::Buffer>        m_bo;
-    std::unique_ptr<gl::Buffer>        m_io;
-    std::unique_ptr<gl::VertexObject>  m_vo;
+    std::array<TailMesh, nLODs>        m_tails;
 };
 
 } // namespace celestia::render
@@ -0,0 +1,178 @@
+// framereadback.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Pipelined readback of rendered frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "framereadback.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace celestia::render
+{
+
+namespace
+{
+
+int
+bytesPerPixel(engine::PixelFormat format)
+{
+    return format == engine::PixelFormat::RGB
+#ifndef GL_ES
+           || format == engine::PixelFormat::BGR
+#endif
+           ? 3 : 4;
+}
+
+// Copy rows of pixels, reversing their order unless they were read top row
+// first
+void
+copyRows(const std::uint8_t* src, int srcPitch, std::uint8_t* dst, int dstPitch,
+         int height, bool inverted)
+{
+    int rowSize = std::min(srcPitch, dstPitch);
+    for (int row = 0; row < height; row++)
+    {
+        const std::uint8_t* srcRow = src + static_cast<std::ptrdiff_t>(inverted ? row : height - 1 - row) * srcPitch;
+        std::memcpy(dst + static_cast<std::ptrdiff_t>(row) * dstPitch, srcRow, rowSize);
+    }
+}
+
+} // end unnamed namespace
+
+FrameReadback::FrameReadback(int width, int height, engine::PixelFormat format, std::size_t depth) :
+    m_width(width),
+    m_height(height),
+    m_pitch((width * bytesPerPixel(format) + 3) & ~0x3),
+    m_format(format),
+    m_slots(std::max(depth, std::size_t(1)))
+{
+    std::size_t size = static_cast<std::size_t>(m_pitch) * static_cast<std::size_t>(height);
+#ifdef GL_ES
+    for (Slot& slot : m_slots)
+        slot.pixels.resize(size);
+#else
+    m_hasSync = gl::checkVersion(gl::GL_3_2) || epoxy_has_gl_extension("GL_ARB_sync");
+    for (Slot& slot : m_slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+#endif
+
+    for (std::size_t i = m_slots.size(); i-- > 0;)
+        m_free.push_back(i);
+}
+
+FrameReadback::~FrameReadback()
+{
+#ifndef GL_ES
+    for (Slot& slot : m_slots)
+    {
+        if (slot.fence != nullptr)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+#endif
+}
+
+bool
+FrameReadback::ready() const
+{
+    if (m_pending.empty())
+        return false;
+
+#ifndef GL_ES
+    const Slot& slot = m_slots[m_pending.front()];
+    if (slot.fence != nullptr)
+        return glClientWaitSync(slot.fence, 0, 0) != GL_TIMEOUT_EXPIRED;
+#endif
+    return true;
+}
+
+bool
+FrameReadback::read(int x, int y)
+{
+    if (m_free.empty())
+        return false;
+
+    std::size_t index = m_free.back();
+    Slot& slot = m_slots[index];
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+#ifdef GL_ES
+    glReadPixels(x, y, m_width, m_height, static_cast<GLenum>(m_format), GL_UNSIGNED_BYTE, slot.pixels.data());
+    slot.inverted = false;
+#else
+    // Let the driver flip the rows if it can
+    GLint inverted = GL_FALSE;
+    if (gl::MESA_pack_invert)
+    {
+        glGetIntegerv(GL_PACK_INVERT_MESA, &inverted);
+        glPixelStorei(GL_PACK_INVERT_MESA, GL_TRUE);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glReadPixels(x, y, m_width, m_height, static_cast<GLenum>(m_format), GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.inverted = gl::MESA_pack_invert;
+
+    if (gl::MESA_pack_invert)
+        glPixelStorei(GL_PACK_INVERT_MESA, inverted);
+
+    if (m_hasSync)
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif
+
+    if (glGetError() != GL_NO_ERROR)
+        return false;
+
+    m_free.pop_back();
+    m_pending.push_back(index);
+    return true;
+}
+
+bool
+FrameReadback::retire(std::uint8_t* pixels, int pitch)
+{
+    if (m_pending.empty())
+        return false;
+
+    std::size_t index = m_pending.front();
+    m_pending.pop_front();
+    m_free.push_back(index);
+    Slot& slot = m_slots[index];
+
+#ifdef GL_ES
+    copyRows(slot.pixels.data(), m_pitch, pixels, pitch, m_height, slot.inverted);
+    return true;
+#else
+    if (slot.fence != nullptr)
+    {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const auto* data = static_cast<const std::uint8_t*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if (data != nullptr)
+    {
+        copyRows(data, m_pitch, pixels, pitch, m_height, slot.inverted);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return data != nullptr;
+#endif
+}
+
+} // namespace celestia::render
@@ -0,0 +1,86 @@
+// framereadback.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Pipelined readback of rendered frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <celengine/glsupport.h>
+#include <celimage/pixelformat.h>
+
+namespace celestia::render
+{
+
+// Reads frames back from the framebuffer without stalling the pipeline.
+// read() starts copying a region of the framebuffer into a pixel buffer
+// object, followed by a fence where sync objects are supported. The copy
+// completes while the next frames are rendered; retire() then waits for the
+// oldest read and copies its pixels out, top row first. Up to depth reads
+// are in flight.
+//
+// OpenGL ES 2.0 has no pixel buffer objects; there the pixels are read
+// synchronously by read() and only handed out later by retire().
+class FrameReadback
+{
+public:
+    FrameReadback(int width, int height, engine::PixelFormat format, std::size_t depth = 3);
+    ~FrameReadback();
+
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    // Size of a row of pixels, padded to four bytes as by glReadPixels
+    int getPitch() const { return m_pitch; }
+
+    bool empty() const { return m_pending.empty(); }
+    bool full() const { return m_free.empty(); }
+    // Return true if the oldest read has completed, so that retire()
+    // won't block
+    bool ready() const;
+
+    // Start reading the region with lower left corner x, y. The queue
+    // must not be full.
+    bool read(int x, int y);
+    // Wait for the oldest read and copy it to pixels, whose rows are pitch
+    // bytes apart
+    bool retire(std::uint8_t* pixels, int pitch);
+
+private:
+    struct Slot
+    {
+#ifdef GL_ES
+        std::vector<std::uint8_t> pixels;
+#else
+        GLuint buffer{ 0 };
+        GLsync fence{ nullptr };
+#endif
+        bool inverted{ false }; // rows were read top row first
+    };
+
+    int m_width;
+    int m_height;
+    int m_pitch;
+    engine::PixelFormat m_format;
+#ifndef GL_ES
+    bool m_hasSync{ false };
+#endif
+
+    std::vector<Slot> m_slots;
+    std::vector<std::size_t> m_free;
+    std::deque<std::size_t> m_pending;
+};
+
+} // namespace celestia::render
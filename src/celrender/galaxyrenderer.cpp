@@ -8,9 +8,13 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstdint>
 #include <cmath>
+#include <tuple>
+#include <vector>
 
 #include <celengine/galaxy.h>
 #include <celengine/galaxyform.h>
@@ -22,6 +26,7 @@
 #include <celrender/gl/buffer.h>
 #include <celrender/gl/vertexobject.h>
 #include "galaxyrenderer.h"
+#include "instancebatcher.h"
 
 using celestia::engine::GalacticFormManager;
 
@@ -52,6 +57,56 @@ colorTextureEval(float u, float /*v*/, float /*w*/, std::uint8_t *pixel)
     Color::fromHSV(hue, 0.20f, 1.0f).get(pixel);
 }
 
+struct GalaxyVtx150
+{
+    Eigen::Matrix<GLshort, 3, 1>  position;
+    GLushort size;       // we scale blob by size=kSpriteScaleFactor**n
+    GLubyte  colorIndex; // color index [0; 255]
+    GLubyte  brightness; // blob brightness [0.0; 1.0] packed as normalized byte
+};
+
+void
+buildPointVertices(const engine::GalacticForm::BlobVector &points, std::vector<GalaxyVtx150> &glVertices)
+{
+    glVertices.reserve(points.size());
+
+    float sizeFactor = std::numeric_limits<GLushort>::max();
+    for (unsigned int i = 0, pow2 = 1; i < points.size(); ++i)
+    {
+        if ((i & pow2) != 0)
+        {
+            pow2 <<= 1;
+            sizeFactor *= kSpriteScaleFactor;
+        }
+        GalaxyVtx150 v;
+        Eigen::Vector3f p = points[i].position * std::numeric_limits<GLshort>::max();
+        v.position   = p.cast<GLshort>();
+        v.size       = static_cast<GLushort>(sizeFactor);
+        v.colorIndex = points[i].colorIndex;
+        v.brightness = points[i].brightness;
+
+        glVertices.push_back(v);
+    }
+}
+
+void
+addPointVertexBuffers(gl::VertexObject &vo, const gl::Buffer &bo, const CelestiaGLProgram *prog)
+{
+    vo.addVertexBuffer(
+        bo, CelestiaGLProgram::VertexCoordAttributeIndex,
+        3, gl::VertexObject::DataType::Short,
+        true, sizeof(GalaxyVtx150), offsetof(GalaxyVtx150, position));
+    vo.addVertexBuffer(
+        bo, prog->attribIndex("in_Size"), 1, gl::VertexObject::DataType::UnsignedShort,
+        true, sizeof(GalaxyVtx150), offsetof(GalaxyVtx150, size));
+    vo.addVertexBuffer(
+        bo, prog->attribIndex("in_ColorIndex"), 1, gl::VertexObject::DataType::UnsignedByte,
+        true, sizeof(GalaxyVtx150), offsetof(GalaxyVtx150, colorIndex));
+    vo.addVertexBuffer(
+        bo, prog->attribIndex("in_Brightness"), 1, gl::VertexObject::DataType::UnsignedByte,
+        true, sizeof(GalaxyVtx150), offsetof(GalaxyVtx150, brightness));
+}
+
 void
 BindTextures()
 {
@@ -107,8 +162,6 @@ GalaxyRenderer::GalaxyRenderer(Renderer &renderer) :
     m_objects.reserve(1024);
 }
 
-GalaxyRenderer::~GalaxyRenderer() = default; // define here as Object is not defined in the header file
-
 void
 GalaxyRenderer::update(const Eigen::Quaternionf &viewerOrientation, float pixelSize, float fov, float zoom)
 {
@@ -170,7 +223,7 @@ GalaxyRenderer::getRenderInfo(const GalaxyRenderer::Object &obj, float &brightne
         pr = m_renderer.getProjectionMatrix();
 
     const auto &points = galacticForm->blobs;
-    auto pointCount = static_cast<int>(static_cast<float>(points.size()) * std::clamp(obj.galaxy->getDetail(), 0.0f, 1.0f));
+    auto pointCount = static_cast<int>(static_cast<float>(points.size()) * std::clamp(obj.galaxy->getDetail() * m_detail, 0.0f, 1.0f));
     // find proper nPoints count
     if (minimumFeatureSize > 0.0f)
     {
@@ -193,6 +246,42 @@ struct GalaxyRenderer::RenderData
     gl::VertexObject vo{ util::NoCreateT{} };
 };
 
+struct GalaxyRenderer::Instance
+{
+    Eigen::Matrix4f m;
+    float           size;
+    float           brightness;
+    float           minimumFeatureSize;
+    float           nPoints;
+};
+
+struct GalaxyRenderer::InstanceKey
+{
+    int             formId;
+    float           nearZ;
+    float           farZ;
+    int             sizeClass;
+
+    bool operator<(const InstanceKey &other) const
+    {
+        return std::tie(formId, nearZ, farZ, sizeClass) < std::tie(other.formId, other.nearZ, other.farZ, other.sizeClass);
+    }
+
+    bool operator==(const InstanceKey &other) const
+    {
+        return std::tie(formId, nearZ, farZ, sizeClass) == std::tie(other.formId, other.nearZ, other.farZ, other.sizeClass);
+    }
+};
+
+struct GalaxyRenderer::InstancedData
+{
+    gl::Buffer                                instances{ gl::Buffer::TargetHint::Array };
+    std::vector<RenderData>                   renderData;
+    InstanceBatcher<InstanceKey, Instance>    batcher;
+};
+
+GalaxyRenderer::~GalaxyRenderer() = default; // define here as Object is not defined in the header file
+
 void
 GalaxyRenderer::renderGL2()
 {
@@ -350,6 +439,12 @@ GalaxyRenderer::initializeGL2(const CelestiaGLProgram *prog)
 void
 GalaxyRenderer::renderGL3()
 {
+    if (gl::hasInstancing())
+    {
+        renderInstancedGL3();
+        return;
+    }
+
     ShaderManager::GeomShaderParams params = {GL_POINTS, GL_TRIANGLE_STRIP, 4};
     CelestiaGLProgram *prog = m_renderer.getShaderManager().getShaderGL3("galaxy150", &params);
     if (prog == nullptr)
@@ -398,74 +493,140 @@ GalaxyRenderer::renderGL3()
 void
 GalaxyRenderer::initializeGL3(const CelestiaGLProgram *prog)
 {
-    struct GalaxyVtx
-    {
-        Eigen::Matrix<GLshort, 3, 1>  position;
-        GLushort size;       // we scale blob by size=kSpriteScaleFactor**n
-        GLubyte  colorIndex; // color index [0; 255]
-        GLubyte  brightness; // blob brightness [0.0; 1.0] packed as normalized byte
-    };
-
     if (m_initialized)
         return;
 
     m_initialized = true;
 
-    auto sizeLoc = prog->attribIndex("in_Size");
-    auto colorLoc = prog->attribIndex("in_ColorIndex");
-    auto brightnessLoc = prog->attribIndex("in_Brightness");
-
     const auto *gm = GalacticFormManager::get();
-    std::vector<GalaxyVtx> glVertices;
+    std::vector<GalaxyVtx150> glVertices;
 
     for (int count = gm->getCount(), id = 0; id < count; id++)
     {
         if (const auto* form = gm->getForm(id); form != nullptr)
         {
-            const auto &points = form->blobs;
-            glVertices.reserve(points.size());
+            buildPointVertices(form->blobs, glVertices);
 
-            float sizeFactor = std::numeric_limits<GLushort>::max();
-            for (unsigned int i = 0, pow2 = 1; i < points.size(); ++i)
-            {
-                if ((i & pow2) != 0)
-                {
-                    pow2 <<= 1;
-                    sizeFactor *= kSpriteScaleFactor;
-                }
-                GalaxyVtx v;
-                Eigen::Vector3f p = points[i].position * std::numeric_limits<GLshort>::max();
-                v.position   = p.cast<GLshort>();
-                v.size       = static_cast<GLushort>(sizeFactor);
-                v.colorIndex = points[i].colorIndex;
-                v.brightness = points[i].brightness;
+            gl::Buffer bo(gl::Buffer::TargetHint::Array, glVertices);
 
-                glVertices.push_back(v);
-            }
+            gl::VertexObject vo(gl::VertexObject::Primitive::Points);
+            addPointVertexBuffers(vo, bo, prog);
+
+            m_renderData.emplace_back(std::move(bo), std::move(vo));
+        }
+        else
+        {
+            m_renderData.emplace_back(gl::Buffer(util::NoCreateT{}), gl::VertexObject(util::NoCreateT{}));
+        }
+        glVertices.clear();
+    }
+}
+
+void
+GalaxyRenderer::renderInstancedGL3()
+{
+    ShaderManager::GeomShaderParams params = {GL_POINTS, GL_TRIANGLE_STRIP, 4};
+    CelestiaGLProgram *prog = m_renderer.getShaderManager().getShaderGL3("galaxyinst150", &params);
+    if (prog == nullptr)
+        return;
+
+    initializeInstancedGL3(prog);
+
+    auto &batcher = m_instancedData->batcher;
+    batcher.clear();
+    for (const auto &obj : m_objects)
+    {
+        float brightness = 0.0f;
+        float size = 0.0f;
+        float minimumFeatureSize = 0.0f;
+        Eigen::Matrix4f m;
+        Eigen::Matrix4f pr;
+        int nPoints = 0;
+
+        if (!getRenderInfo(obj, brightness, size, minimumFeatureSize, m, pr, nPoints) || nPoints <= 0)
+            continue;
+
+        batcher.add(InstanceKey{ obj.galaxy->getFormId(), obj.nearZ, obj.farZ, instanceSizeClass(nPoints) },
+                    Instance{ m, size, brightness, minimumFeatureSize, static_cast<float>(nPoints) });
+    }
+
+    if (batcher.empty())
+        return;
+
+    BindTextures();
+
+    prog->use();
+    prog->samplerParam("galaxyTex") = 0;
+    prog->samplerParam("colorTex") = 1;
+    prog->mat3Param("viewMat") = m_viewMat;
+
+    Renderer::PipelineState ps;
+    ps.blending = true;
+    ps.blendFunc = {GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA};
+    ps.smoothLines = true;
+    m_renderer.setPipelineState(ps);
+
+    batcher.render(m_instancedData->instances, [this, prog](const InstanceKey &key, const std::vector<Instance> &instances)
+    {
+        float maxPoints = 0.0f;
+        for (const Instance &instance : instances)
+            maxPoints = std::max(maxPoints, instance.nPoints);
+
+        Eigen::Matrix4f pr;
+        if (key.nearZ != 0.0f && key.farZ != 0.0f)
+            m_renderer.buildProjectionMatrix(pr, key.nearZ, key.farZ, m_zoom);
+        else
+            pr = m_renderer.getProjectionMatrix();
+        prog->setMVPMatrices(pr, m_renderer.getModelViewMatrix());
+
+        m_instancedData->renderData[key.formId].vo.drawInstanced(static_cast<int>(maxPoints), static_cast<int>(instances.size()));
+    });
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void
+GalaxyRenderer::initializeInstancedGL3(const CelestiaGLProgram *prog)
+{
+    if (m_instancedData != nullptr)
+        return;
+
+    m_instancedData = std::make_unique<InstancedData>();
+    const gl::Buffer &instances = m_instancedData->instances;
+    constexpr std::array<const char*, 4> modelAttributes = { "in_Model0", "in_Model1", "in_Model2", "in_Model3" };
+
+    const auto *gm = GalacticFormManager::get();
+    std::vector<GalaxyVtx150> glVertices;
+
+    for (int count = gm->getCount(), id = 0; id < count; id++)
+    {
+        if (const auto* form = gm->getForm(id); form != nullptr)
+        {
+            buildPointVertices(form->blobs, glVertices);
 
             gl::Buffer bo(gl::Buffer::TargetHint::Array, glVertices);
 
             gl::VertexObject vo(gl::VertexObject::Primitive::Points);
+            addPointVertexBuffers(vo, bo, prog);
 
-            vo.addVertexBuffer(
-                bo, CelestiaGLProgram::VertexCoordAttributeIndex,
-                3, gl::VertexObject::DataType::Short,
-                true, sizeof(GalaxyVtx), offsetof(GalaxyVtx, position));
-            vo.addVertexBuffer(
-                bo, sizeLoc, 1, gl::VertexObject::DataType::UnsignedShort,
-                true, sizeof(GalaxyVtx), offsetof(GalaxyVtx, size));
-            vo.addVertexBuffer(
-                bo, colorLoc, 1, gl::VertexObject::DataType::UnsignedByte,
-                true, sizeof(GalaxyVtx), offsetof(GalaxyVtx, colorIndex));
-            vo.addVertexBuffer(
-                bo, brightnessLoc, 1, gl::VertexObject::DataType::UnsignedByte,
-                true, sizeof(GalaxyVtx), offsetof(GalaxyVtx, brightness));
+            // The model matrix is passed as four column attributes
+            for (int column = 0; column < 4; ++column)
+            {
+                vo.addInstanceBuffer(
+                    instances, prog->attribIndex(modelAttributes[column]),
+                    4, gl::VertexObject::DataType::Float,
+                    false, sizeof(Instance), offsetof(Instance, m) + column * 4 * sizeof(float));
+            }
+            vo.addInstanceBuffer(
+                instances, prog->attribIndex("in_InstanceParams"),
+                4, gl::VertexObject::DataType::Float,
+                false, sizeof(Instance), offsetof(Instance, size));
 
-            m_renderData.emplace_back(std::move(bo), std::move(vo));
+            m_instancedData->renderData.emplace_back(std::move(bo), std::move(vo));
         }
         else
         {
-            m_renderData.emplace_back(gl::Buffer(util::NoCreateT{}), gl::VertexObject(util::NoCreateT{}));
+            m_instancedData->renderData.emplace_back(gl::Buffer(util::NoCreateT{}), gl::VertexObject(util::NoCreateT{}));
         }
         glVertices.clear();
     }
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <Eigen/Core>
@@ -36,6 +37,10 @@ public:
 
     void render();
 
+    // Fraction of the blobs of each galaxy drawn
+    float getDetail() const { return m_detail; }
+    void setDetail(float detail) { m_detail = detail; }
+
 private:
     struct Object;
 
@@ -52,6 +57,16 @@ private:
     void renderGL3();
     void initializeGL3(const CelestiaGLProgram *prog);
 
+    // Draw all galaxies sharing a form, projection and detail class with a
+    // single instanced draw call
+    struct Instance;
+    struct InstanceKey;
+    struct InstancedData;
+    std::unique_ptr<InstancedData> m_instancedData;
+
+    void renderInstancedGL3();
+    void initializeInstancedGL3(const CelestiaGLProgram *prog);
+
     // global state
     std::vector<Object>     m_objects;
     Renderer               &m_renderer;
@@ -63,6 +78,8 @@ private:
     float               m_fov{ 45.0f };
     float               m_zoom{ 1.0f };
 
+    float               m_detail{ 1.0f };
+
     bool                m_initialized{ false };
 };
 
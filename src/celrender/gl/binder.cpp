@@ -35,9 +35,11 @@ Binder::unbind(const Buffer &bo)
     case Buffer::TargetHint::Array:
         if (m_boundVbo == bo.id())
             return bindVBO(Buffer::TargetHint::Array, 0u);
+        break;
     case Buffer::TargetHint::ElementArray:
         if (m_boundIbo == bo.id())
             return bindVBO(Buffer::TargetHint::ElementArray, 0u);
+        break;
     default:
         break;
     }
@@ -83,8 +85,9 @@ Binder::bindVAO(GLuint id)
     {
         glBindVertexArray(id);
         m_boundVao = id;
-        m_boundVbo = 0u;
-        m_boundIbo = 0u;
+        // The element array binding is part of the VAO state, so it isn't
+        // known after switching; the array binding is global and stays.
+        m_boundIbo = UnknownBinding;
     }
     return *this;
 }
@@ -92,7 +95,6 @@ Binder::bindVAO(GLuint id)
 Binder&
 Binder::bindVBO(Buffer::TargetHint target, GLuint id)
 {
-    glBindBuffer(static_cast<GLenum>(target), id);
     switch (target)
     {
     case Buffer::TargetHint::Array:
@@ -110,6 +112,7 @@ Binder::bindVBO(Buffer::TargetHint target, GLuint id)
         }
         break;
     default:
+        glBindBuffer(static_cast<GLenum>(target), id);
         break;
     }
     return *this;
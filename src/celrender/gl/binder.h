@@ -19,6 +19,12 @@
 namespace celestia::gl
 {
 
+/**
+ * Binds buffers and vertex objects, skipping the GL calls which wouldn't
+ * change the current bindings. Code which shares buffers with the classes
+ * in this namespace must bind them through the Binder too, e.g. by
+ * wrapping them with Buffer::wrap(), so that the cached state stays valid.
+ */
 class Binder
 {
 public:
@@ -102,6 +108,9 @@ private:
     Binder &bindVAO(GLuint id);
     Binder &bindVBO(Buffer::TargetHint target, GLuint id);
 
+    //! Binding which isn't known and has to be set on the next bind.
+    static constexpr GLuint UnknownBinding = ~0u;
+
     GLuint m_boundVbo{ 0 };
     GLuint m_boundIbo{ 0 };
     GLuint m_boundVao{ 0 };
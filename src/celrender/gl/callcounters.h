@@ -0,0 +1,32 @@
+// callcounters.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Counters of the GL calls made to draw the frames.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+
+namespace celestia::gl
+{
+
+// The counters only increase; the renderer reports the difference from
+// the values at the start of a frame. GL calls are made from the render
+// thread only, so they are not atomic.
+struct CallCounters
+{
+    std::uint64_t drawCalls{ 0 };
+    std::uint64_t stateChanges{ 0 };
+    std::uint64_t shaderSwitches{ 0 };
+    std::uint64_t textureUploadBytes{ 0 };
+};
+
+inline CallCounters callCounters;
+
+} // end namespace celestia::gl
@@ -0,0 +1,130 @@
+// streambuffer.cpp
+//
+// Copyright (C) 2024-present, Celestia Development Team.
+//
+// Ring buffer for streamed vertex data.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "streambuffer.h"
+
+#include <cassert>
+
+namespace celestia::gl
+{
+
+namespace
+{
+
+inline GLsizeiptr
+alignUp(GLsizeiptr offset, GLsizeiptr alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+StreamBuffer::StreamBuffer(Buffer::TargetHint targetHint, GLsizeiptr regionSize) :
+    m_buffer(targetHint),
+    m_regionSize(regionSize)
+{
+#ifndef GL_ES
+    if (gl::ARB_buffer_storage)
+    {
+        constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        m_buffer.bind();
+        glBufferStorage(GLenum(targetHint), RegionCount * regionSize, nullptr, flags);
+        m_mapping = static_cast<std::uint8_t*>(glMapBufferRange(GLenum(targetHint), 0, RegionCount * regionSize, flags));
+        if (m_mapping == nullptr)
+        {
+            // The storage is immutable, so start over with a new buffer
+            m_buffer = Buffer(targetHint);
+        }
+    }
+#endif
+
+    if (m_mapping == nullptr)
+    {
+        m_staging.resize(static_cast<std::size_t>(regionSize));
+        m_buffer.setData(util::array_view<const void>(nullptr, regionSize), Buffer::BufferUsage::StreamDraw);
+    }
+}
+
+StreamBuffer::~StreamBuffer()
+{
+#ifndef GL_ES
+    for (GLsync fence : m_fences)
+    {
+        if (fence != nullptr)
+            glDeleteSync(fence);
+    }
+
+    if (m_mapping != nullptr)
+    {
+        m_buffer.bind();
+        glUnmapBuffer(GLenum(m_buffer.targetHint()));
+    }
+#endif
+}
+
+StreamBuffer::Allocation
+StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr alignment)
+{
+    // Offsets are aligned within the whole buffer, so that they can be
+    // turned into vertex indices
+    GLsizeiptr base = m_mapping == nullptr ? 0 : m_region * m_regionSize;
+    GLsizeiptr offset = alignUp(base + m_head, alignment) - base;
+    if (offset + size > m_regionSize)
+    {
+        nextRegion();
+        base = m_mapping == nullptr ? 0 : m_region * m_regionSize;
+        offset = alignUp(base, alignment) - base;
+        assert(offset + size <= m_regionSize);
+    }
+
+    m_head = offset + size;
+    if (m_mapping != nullptr)
+        return { m_mapping + base + offset, base + offset };
+    return { m_staging.data() + offset, offset };
+}
+
+void
+StreamBuffer::flush()
+{
+    if (m_mapping != nullptr || m_flushed == m_head)
+        return;
+
+    m_buffer.bind();
+    m_buffer.setSubData(m_flushed, util::array_view<const void>(m_staging.data() + m_flushed, m_head - m_flushed));
+    m_flushed = m_head;
+}
+
+void
+StreamBuffer::nextRegion()
+{
+    m_head = 0;
+    m_flushed = 0;
+
+    if (m_mapping == nullptr)
+    {
+        // Draws which were already issued keep the old storage
+        m_buffer.invalidateData();
+        return;
+    }
+
+#ifndef GL_ES
+    m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_region = (m_region + 1) % RegionCount;
+    if (GLsync &fence = m_fences[m_region]; fence != nullptr)
+    {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+#endif
+}
+
+} // namespace celestia::gl
@@ -0,0 +1,116 @@
+// streambuffer.h
+//
+// Copyright (C) 2024-present, Celestia Development Team.
+//
+// Ring buffer for streamed vertex data.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <celengine/glsupport.h>
+#include "buffer.h"
+
+namespace celestia::gl
+{
+
+/**
+ * @brief Streaming buffer.
+ *
+ * A buffer object for data which is written once and drawn once, which
+ * can be shared by all renderers that stream vertices every frame. Space
+ * is handed out in order from one of three regions of the buffer; when a
+ * region is full, the next one is reused after waiting for the GPU to
+ * finish drawing from it.
+ *
+ * With ARB_buffer_storage the buffer is mapped persistently, so data is
+ * written straight to memory which the GPU reads from. Otherwise data is
+ * written to a staging copy and uploaded by @ref flush(), and the buffer
+ * is orphaned instead of waited for.
+ */
+class StreamBuffer
+{
+public:
+    //! Space reserved by @ref allocate().
+    struct Allocation
+    {
+        //! Where to write the data.
+        void *data;
+        //! Offset of the data in the buffer.
+        GLintptr offset;
+    };
+
+    /**
+     * @brief Construct a new StreamBuffer object.
+     *
+     * @param targetHint Buffer target.
+     * @param regionSize Size of each of the regions in bytes.
+     */
+    StreamBuffer(Buffer::TargetHint targetHint, GLsizeiptr regionSize);
+
+    //! Destructor.
+    ~StreamBuffer();
+
+    //! Copying is prohibited.
+    StreamBuffer(const StreamBuffer&) = delete;
+
+    //! Copying is prohibited.
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    //! Return the underlying buffer, to attach to a vertex object.
+    Buffer& buffer();
+
+    //! Return the size of each region, which bounds the size of an allocation.
+    GLsizeiptr regionSize() const { return m_regionSize; }
+
+    /**
+     * @brief Reserve space for data.
+     *
+     * @param size Size of the data in bytes, which must fit in a region
+     * after alignment.
+     * @param alignment The offset of the data is a multiple of alignment,
+     * e.g. the size of a vertex.
+     * @return Where to write the data.
+     */
+    Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 4);
+
+    //! Make the data written since the last call available to the GPU.
+    void flush();
+
+private:
+    static constexpr unsigned int RegionCount = 3;
+
+    //! Switch to the next region.
+    void nextRegion();
+
+    Buffer m_buffer;
+    GLsizeiptr m_regionSize;
+    //! Offset of the free space in the current region
+    GLsizeiptr m_head{ 0 };
+    //! Offset in the current region up to which data has been uploaded
+    GLsizeiptr m_flushed{ 0 };
+    unsigned int m_region{ 0 };
+
+    //! Persistent mapping of the whole buffer, if supported
+    std::uint8_t *m_mapping{ nullptr };
+#ifndef GL_ES
+    std::array<GLsync, RegionCount> m_fences{};
+#endif
+    //! Copy of the data until it's uploaded without a persistent mapping
+    std::vector<std::uint8_t> m_staging;
+};
+
+inline Buffer&
+StreamBuffer::buffer()
+{
+    return m_buffer;
+}
+
+} // namespace celestia::gl
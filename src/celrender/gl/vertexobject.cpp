@@ -11,6 +11,7 @@
 
 #include "binder.h"
 #include "buffer.h"
+#include "callcounters.h"
 #include "vertexobject.h"
 
 #define PTR(p) (reinterpret_cast<void*>(p))
@@ -119,14 +120,16 @@ struct VertexObject::BufferDesc
                std::int16_t  location,
                std::uint8_t  elemSize,
                std::uint8_t  stride,
-               bool          normalized) :
+               bool          normalized,
+               std::uint8_t  divisor) :
         offset(offset),
         bufferId(bufferId),
         type(type),
         location(location),
         elemSize(elemSize),
         stride(stride),
-        normalized(normalized)
+        normalized(normalized),
+        divisor(divisor)
     {
     }
     GLsizeiptr    offset;
@@ -136,6 +139,7 @@ struct VertexObject::BufferDesc
     std::uint8_t  elemSize;   // 1, 2, 3, 4
     std::uint8_t  stride;     // WebGL allows only 255 bytes max
     bool          normalized;
+    std::uint8_t  divisor;    // 0 for per-vertex data, 1 for per-instance data
 };
 
 VertexObject&
@@ -150,7 +154,26 @@ VertexObject::addVertexBuffer(const Buffer &buffer, int location, int elemSize,
                               static_cast<std::uint16_t>(location),
                               static_cast<std::uint8_t>(elemSize),
                               static_cast<std::uint8_t>(stride),
-                              normalized);
+                              normalized,
+                              0);
+
+    return *this;
+}
+
+VertexObject&
+VertexObject::addInstanceBuffer(const Buffer &buffer, int location, int elemSize, VertexObject::DataType type, bool normalized, int stride, std::ptrdiff_t offset)
+{
+    if (buffer.targetHint() != Buffer::TargetHint::Array)
+        return *this;
+
+    m_bufferDesc.emplace_back(offset,
+                              buffer.id(),
+                              static_cast<std::uint16_t>(type),
+                              static_cast<std::uint16_t>(location),
+                              static_cast<std::uint8_t>(elemSize),
+                              static_cast<std::uint8_t>(stride),
+                              normalized,
+                              1);
 
     return *this;
 }
@@ -174,6 +197,7 @@ VertexObject::draw(VertexObject::Primitive primitive, int count, int first)
         return *this;
 
     bind();
+    ++callCounters.drawCalls;
 
     if (isIndexed())
     {
@@ -190,6 +214,36 @@ VertexObject::draw(VertexObject::Primitive primitive, int count, int first)
     return *this;
 }
 
+VertexObject&
+VertexObject::drawInstanced(int count, int instanceCount, int first)
+{
+    return drawInstanced(m_primitive, count, instanceCount, first);
+}
+
+VertexObject&
+VertexObject::drawInstanced(VertexObject::Primitive primitive, int count, int instanceCount, int first)
+{
+    if (count == 0 || instanceCount == 0)
+        return *this;
+
+    bind();
+    ++callCounters.drawCalls;
+
+    if (isIndexed())
+    {
+        auto offset = static_cast<std::ptrdiff_t>(first * (m_indexType == IndexType::UnsignedShort ? sizeof(GLushort) : sizeof(GLuint)));
+        glDrawElementsInstanced(GLenum(primitive), count, GLenum(m_indexType), PTR(offset), instanceCount);
+    }
+    else
+    {
+        glDrawArraysInstanced(GLenum(primitive), first, count, instanceCount);
+    }
+
+    unbind();
+
+    return *this;
+}
+
 VertexObject&
 VertexObject::setIndexBuffer(const Buffer &buffer, std::ptrdiff_t /*offset*/, VertexObject::IndexType type)
 {
@@ -225,6 +279,8 @@ VertexObject::enableAttribArrays() const
 
         glEnableVertexAttribArray(p.location);
         glVertexAttribPointer(p.location, p.elemSize, p.type, p.normalized ? GL_TRUE : GL_FALSE, p.stride, PTR(p.offset));
+        if (p.divisor != 0)
+            glVertexAttribDivisor(p.location, p.divisor);
     }
 
     if (isIndexed())
@@ -237,7 +293,11 @@ VertexObject::disableAttribArrays() const
     auto &binder = Binder::get();
 
     for (const auto &p : m_bufferDesc)
+    {
         glDisableVertexAttribArray(p.location);
+        if (p.divisor != 0)
+            glVertexAttribDivisor(p.location, 0);
+    }
 
     binder.unbind(Buffer::TargetHint::Array);
 
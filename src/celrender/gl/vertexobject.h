@@ -152,6 +152,36 @@ public:
      */
     VertexObject& draw(Primitive primitive, int count, int first = 0);
 
+    /**
+     * @brief Render several instances of VertexObject.
+     *
+     * Render VertexObject using a default primitive. Requires OpenGL 3.3 or
+     * OpenGL ES 3.0, see gl::hasInstancing().
+     *
+     * @param count Number of vertices to draw.
+     * @param instanceCount Number of instances to draw.
+     * @param first First vertex to draw.
+     * @return Reference to self.
+     *
+     * @see @ref addInstanceBuffer()
+     */
+    VertexObject& drawInstanced(int count, int instanceCount, int first = 0);
+
+    /**
+     * @brief Render several instances of VertexObject.
+     *
+     * Render VertexObject using a primitive provided.
+     *
+     * @param primitive Primitive.
+     * @param count Number of vertices to draw.
+     * @param instanceCount Number of instances to draw.
+     * @param first First vertex to draw.
+     * @return Reference to self.
+     *
+     * @see @ref addInstanceBuffer()
+     */
+    VertexObject& drawInstanced(Primitive primitive, int count, int instanceCount, int first = 0);
+
     /**
      * @brief Set the primitive.
      *
@@ -218,6 +248,17 @@ public:
      */
     VertexObject& addVertexBuffer(const Buffer &buffer, int location, int elemSize, DataType type, bool normalized = false, int stride = 0, std::ptrdiff_t offset = 0);
 
+    /**
+     * @brief Define an array of per-instance vertex attribute data.
+     *
+     * Same as addVertexBuffer() but the attribute advances once per instance
+     * instead of once per vertex. See documentation for glVertexAttribDivisor
+     * OpenGL method for more information.
+     *
+     * @see @ref addVertexBuffer() @ref drawInstanced()
+     */
+    VertexObject& addInstanceBuffer(const Buffer &buffer, int location, int elemSize, DataType type, bool normalized = false, int stride = 0, std::ptrdiff_t offset = 0);
+
     /**
      * @brief Add index buffer. The buffer is not owned by VertexObject.
      *
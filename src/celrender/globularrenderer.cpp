@@ -14,6 +14,8 @@
 #include <cstdint>
 #include <cmath>
 #include <memory>
+#include <tuple>
+#include <vector>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -30,6 +32,7 @@
 #include <celrender/gl/vertexobject.h>
 #include <celutil/color.h>
 #include "globularrenderer.h"
+#include "instancebatcher.h"
 
 namespace gl = celestia::gl;
 namespace util = celestia::util;
@@ -73,6 +76,12 @@ struct GlobularForm
     mutable gl::Buffer bo{ util::NoCreateT{} };
     mutable gl::VertexObject vo{ util::NoCreateT{} };
     mutable bool GLDataInitialized{ false };
+
+    // The same vertices with the per-globular attributes of the instanced
+    // tidal and star programs
+    mutable gl::VertexObject tidalInstancedVo{ util::NoCreateT{} };
+    mutable gl::VertexObject starInstancedVo{ util::NoCreateT{} };
+    mutable bool instancedGLDataInitialized{ false };
 };
 
 /// GlobularForm Manager
@@ -202,14 +211,36 @@ colorTextureEval(float u, float /*v*/, float /*w*/, std::uint8_t *pixel)
     }
 }
 
+struct GlobularVtx
+{
+    Eigen::Matrix<short, 3, 1> position;
+    std::array<std::uint8_t, 3> texCoord; // reuse it for starSize, relStarDensity and colorIndex
+};
+
+void
+addGlobularVertexBuffers(gl::VertexObject &vo, const gl::Buffer &bo)
+{
+    vo.addVertexBuffer(
+        bo,
+        CelestiaGLProgram::VertexCoordAttributeIndex,
+        3,
+        gl::VertexObject::DataType::Short,
+        true,
+        sizeof(GlobularVtx),
+        offsetof(GlobularVtx, position));
+    vo.addVertexBuffer(
+        bo,
+        CelestiaGLProgram::TextureCoord0AttributeIndex,
+        3,
+        gl::VertexObject::DataType::UnsignedByte,
+        true,
+        sizeof(GlobularVtx),
+        offsetof(GlobularVtx, texCoord));
+}
+
 void
 initGlobularData(gl::Buffer &bo, gl::VertexObject &vo, const GlobularForm::BlobVector &points)
 {
-    struct GlobularVtx
-    {
-        Eigen::Matrix<short, 3, 1> position;
-        std::array<std::uint8_t, 3> texCoord; // reuse it for starSize, relStarDensity and colorIndex
-    };
 
     std::vector<GlobularVtx> globularVtx;
     globularVtx.reserve(4 + points.size());
@@ -262,22 +293,7 @@ initGlobularData(gl::Buffer &bo, gl::VertexObject &vo, const GlobularForm::BlobV
 
     bo = gl::Buffer(gl::Buffer::TargetHint::Array, globularVtx);
     vo = gl::VertexObject(gl::VertexObject::Primitive::Points);
-    vo.addVertexBuffer(
-        bo,
-        CelestiaGLProgram::VertexCoordAttributeIndex,
-        3,
-        gl::VertexObject::DataType::Short,
-        true,
-        sizeof(GlobularVtx),
-        offsetof(GlobularVtx, position));
-    vo.addVertexBuffer(
-        bo,
-        CelestiaGLProgram::TextureCoord0AttributeIndex,
-        3,
-        gl::VertexObject::DataType::UnsignedByte,
-        true,
-        sizeof(GlobularVtx),
-        offsetof(GlobularVtx, texCoord));
+    addGlobularVertexBuffers(vo, bo);
 }
 
 void
@@ -456,6 +472,21 @@ GlobularFormManager::get()
     return globularFormManager;
 }
 
+// Set the King profile parameters of a form for the texture and vertex generators
+void
+setKingParameters(int formId)
+{
+    /* Use same 8 c-bins as in globularForms below!
+     * center value of (ic+1)th c-bin
+     */
+
+    float cbin = Globular::MinC
+           + (static_cast<float>(formId) + 0.5f) * Globular::BinWidth;
+
+    RRatio = std::pow(10.0f, cbin);
+    XI = 1.0f / std::sqrt(1.0f + RRatio * RRatio);
+}
+
 float
 CalculateSpriteSize(int w, int h, const Eigen::Matrix4f &pr, const Eigen::Matrix4f &mv, const Eigen::Matrix3f &viewMat, const celestia::engine::ProjectionMode *projectionMode)
 {
@@ -496,6 +527,18 @@ CalculateSpriteCount(const GlobularForm* form, float detail, float starSize, flo
     return nPoints;
 }
 
+// The instanced programs are built by getShaderGL3, whose version header
+// needs GLSL ES 3.20 on GLES
+bool
+hasInstancedShaders()
+{
+#ifdef GL_ES
+    return gl::hasInstancing() && gl::checkVersion(gl::GLES_3_2);
+#else
+    return gl::hasInstancing();
+#endif
+}
+
 } // anonymous namespace
 
 struct GlobularRenderer::Object
@@ -516,6 +559,51 @@ struct GlobularRenderer::Object
     const Globular *globular;
 };
 
+struct GlobularRenderer::RenderInfo
+{
+    const GlobularForm *form;
+    float               minimumFeatureSize;
+    float               pixelWeight;
+    float               tidalSize;
+    Eigen::Matrix4f     mv;
+    Eigen::Matrix4f     pr;
+};
+
+struct GlobularRenderer::Instance
+{
+    Eigen::Vector3f offset;
+    float           tidalSize;
+    Eigen::Matrix3f m;
+    float           brightness;
+    float           pixelWeight;
+    float           scale;
+    float           spriteEnd;  // index of the last star sprite + 1
+};
+
+struct GlobularRenderer::InstanceKey
+{
+    int   formId;
+    float nearZ;
+    float farZ;
+    int   sizeClass;
+
+    bool operator<(const InstanceKey &other) const
+    {
+        return std::tie(formId, nearZ, farZ, sizeClass) < std::tie(other.formId, other.nearZ, other.farZ, other.sizeClass);
+    }
+
+    bool operator==(const InstanceKey &other) const
+    {
+        return std::tie(formId, nearZ, farZ, sizeClass) == std::tie(other.formId, other.nearZ, other.farZ, other.sizeClass);
+    }
+};
+
+struct GlobularRenderer::InstancedData
+{
+    gl::Buffer                              instances{ gl::Buffer::TargetHint::Array };
+    InstanceBatcher<InstanceKey, Instance>  batcher;
+};
+
 GlobularRenderer::GlobularRenderer(Renderer &renderer) :
     m_renderer(renderer)
 {
@@ -546,6 +634,14 @@ GlobularRenderer::render()
     if (m_objects.empty())
         return;
 
+    // Draw each globular on its own when the instanced programs are
+    // missing or fail to compile
+    if (hasInstancedShaders() && renderInstanced())
+    {
+        m_objects.clear();
+        return;
+    }
+
     auto *tidalProg = m_renderer.getShaderManager().getShader("tidal");
     auto *globProg  = m_renderer.getShaderManager().getShader("globular");
     if (tidalProg == nullptr || globProg == nullptr)
@@ -578,20 +674,19 @@ GlobularRenderer::render()
     glActiveTexture(GL_TEXTURE0);
 }
 
-void
-GlobularRenderer::renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *globProg, const Object &obj) const
+bool
+GlobularRenderer::getRenderInfo(const Object &obj, RenderInfo &info) const
 {
     const Globular *globular = obj.globular;
-    auto* globularFormManager = GlobularFormManager::get();
 
-    const auto *form = globularFormManager->getForm(globular->getFormId());
-    if (form == nullptr)
-        return;
+    info.form = GlobularFormManager::get()->getForm(globular->getFormId());
+    if (info.form == nullptr)
+        return false;
 
     float radius = globular->getRadius();
     float distanceToDSO = std::max(0.0f, obj.offset.norm() - radius);
-    float minimumFeatureSize = 0.5f * m_pixelSize * distanceToDSO;
-    float diskSizeInPixels = radius / minimumFeatureSize;
+    info.minimumFeatureSize = 0.5f * m_pixelSize * distanceToDSO;
+    float diskSizeInPixels = radius / info.minimumFeatureSize;
 
     /*
      * Is the globular's apparent size big enough to
@@ -601,7 +696,7 @@ GlobularRenderer::renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *gl
      */
 
     if (diskSizeInPixels < 1.0f)
-        return;
+        return false;
 
     /*
      * When resolution (zoom) varies, the blended texture opacity is controlled by the
@@ -610,21 +705,33 @@ GlobularRenderer::renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *gl
      * The smaller P2 (<1), the faster pixelWeight -> 0, for diskSizeInPixels >= P1.
      */
 
-    float pixelWeight = 1.0f;
+    info.pixelWeight = 1.0f;
     if (diskSizeInPixels >= P1)
-        pixelWeight = 1.0f / (P2 + (1.0f - P2) * diskSizeInPixels / P1);
+        info.pixelWeight = 1.0f / (P2 + (1.0f - P2) * diskSizeInPixels / P1);
 
-    /* Use same 8 c-bins as in globularForms below!
-     * center value of (ic+1)th c-bin
-     */
+    info.tidalSize = 2.0f * globular->getBoundingSphereRadius();
 
-    float cbin = Globular::MinC
-           + (static_cast<float>(globular->getFormId()) + 0.5f) * Globular::BinWidth;
+    info.mv = math::translate(m_renderer.getModelViewMatrix(), obj.offset);
+    if (obj.nearZ != 0.0f && obj.farZ != 0.0f)
+        m_renderer.buildProjectionMatrix(info.pr, obj.nearZ, obj.farZ, m_zoom);
+    else
+        info.pr = m_renderer.getProjectionMatrix();
 
-    RRatio = std::pow(10.0f, cbin);
-    XI = 1.0f / std::sqrt(1.0f + RRatio * RRatio);
+    return true;
+}
+
+void
+GlobularRenderer::renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *globProg, const Object &obj) const
+{
+    RenderInfo info;
+    if (!getRenderInfo(obj, info))
+        return;
+
+    const Globular *globular = obj.globular;
+    auto* globularFormManager = GlobularFormManager::get();
+    const auto *form = info.form;
 
-    float tidalSize = 2.0f * globular->getBoundingSphereRadius();
+    setKingParameters(globular->getFormId());
 
     /* Render central cloud sprite (centerTex). It fades away when
      * distance from center or resolution increases sufficiently.
@@ -641,19 +748,12 @@ GlobularRenderer::renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *gl
     glActiveTexture(GL_TEXTURE1);
     globularFormManager->getCenterTex(obj.globular->getFormId())->bind();
 
-    Eigen::Matrix4f mv = math::translate(m_renderer.getModelViewMatrix(), obj.offset);
-    Eigen::Matrix4f pr;
-    if (obj.nearZ != 0.0f && obj.farZ != 0.0f)
-        m_renderer.buildProjectionMatrix(pr, obj.nearZ, obj.farZ, m_zoom);
-    else
-        pr = m_renderer.getProjectionMatrix();
-
     tidalProg->use();
-    tidalProg->setMVPMatrices(pr, mv);
+    tidalProg->setMVPMatrices(info.pr, info.mv);
     tidalProg->mat3Param("viewMat")      = m_viewMat;
     tidalProg->floatParam("brightness")  = obj.brightness;
-    tidalProg->floatParam("pixelWeight") = pixelWeight;
-    tidalProg->floatParam("tidalSize")   = tidalSize;
+    tidalProg->floatParam("pixelWeight") = info.pixelWeight;
+    tidalProg->floatParam("tidalSize")   = info.tidalSize;
     tidalProg->samplerParam("colorTex")  = 0;
     tidalProg->samplerParam("tidalTex")  = 1;
 
@@ -668,23 +768,166 @@ GlobularRenderer::renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *gl
     glActiveTexture(GL_TEXTURE2);
     GlobularFormManager::get()->getGlobularTex()->bind();
 
-    Eigen::Matrix3f mx = obj.globular->getOrientation().conjugate().toRotationMatrix() * Eigen::Scaling(tidalSize);
+    Eigen::Matrix3f mx = obj.globular->getOrientation().conjugate().toRotationMatrix() * Eigen::Scaling(info.tidalSize);
 
     int w, h; // NOSONAR
     m_renderer.getViewport(nullptr, nullptr, &w, &h);
-    float size = CalculateSpriteSize(w, h, pr, mv, m_viewMat, m_renderer.getProjectionMode().get());
+    float size = CalculateSpriteSize(w, h, info.pr, info.mv, m_viewMat, m_renderer.getProjectionMode().get());
 
     globProg->use();
-    globProg->setMVPMatrices(pr, mv);
+    globProg->setMVPMatrices(info.pr, info.mv);
     globProg->mat3Param("m")            = mx;
     globProg->vec3Param("offset")       = obj.offset;
     globProg->floatParam("brightness")  = obj.brightness;
-    globProg->floatParam("pixelWeight") = pixelWeight;
+    globProg->floatParam("pixelWeight") = info.pixelWeight;
     globProg->floatParam("scale")       = size * static_cast<float>(m_renderer.getScreenDpi()) / 96.0f;
     globProg->samplerParam("colorTex")  = 0;
     globProg->samplerParam("starTex")   = 2;
 
-    vo.draw(gl::VertexObject::Primitive::Points, CalculateSpriteCount(form, globular->getDetail(), obj.brightness, minimumFeatureSize), 4);
+    vo.draw(gl::VertexObject::Primitive::Points, CalculateSpriteCount(form, globular->getDetail(), obj.brightness, info.minimumFeatureSize), 4);
+}
+
+bool
+GlobularRenderer::renderInstanced()
+{
+    auto *tidalProg = m_renderer.getShaderManager().getShaderGL3("tidalinst150");
+    auto *globProg  = m_renderer.getShaderManager().getShaderGL3("globularinst150");
+    if (tidalProg == nullptr || globProg == nullptr)
+        return false;
+
+    if (m_instancedData == nullptr)
+        m_instancedData = std::make_unique<InstancedData>();
+
+    int w, h; // NOSONAR
+    m_renderer.getViewport(nullptr, nullptr, &w, &h);
+    float dpiScale = static_cast<float>(m_renderer.getScreenDpi()) / 96.0f;
+
+    auto &batcher = m_instancedData->batcher;
+    batcher.clear();
+    for (const auto &obj : m_objects)
+    {
+        RenderInfo info;
+        if (!getRenderInfo(obj, info))
+            continue;
+
+        int nPoints = CalculateSpriteCount(info.form, obj.globular->getDetail(), obj.brightness, info.minimumFeatureSize);
+        float size = CalculateSpriteSize(w, h, info.pr, info.mv, m_viewMat, m_renderer.getProjectionMode().get());
+
+        batcher.add(InstanceKey{ obj.globular->getFormId(), obj.nearZ, obj.farZ, instanceSizeClass(nPoints) },
+                    Instance
+                    {
+                        obj.offset,
+                        info.tidalSize,
+                        obj.globular->getOrientation().conjugate().toRotationMatrix() * Eigen::Scaling(info.tidalSize),
+                        obj.brightness,
+                        info.pixelWeight,
+                        size * dpiScale,
+                        static_cast<float>(4 + nPoints),
+                    });
+    }
+
+    if (batcher.empty())
+        return true;
+
+    GlobularFormManager* globularFormManager = GlobularFormManager::get();
+
+    glActiveTexture(GL_TEXTURE0);
+    globularFormManager->getColorTex()->bind();
+    glActiveTexture(GL_TEXTURE2);
+    globularFormManager->getGlobularTex()->bind();
+
+    Renderer::PipelineState ps;
+    ps.blending = true;
+    ps.blendFunc = {GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA};
+    ps.smoothLines = true;
+    m_renderer.setPipelineState(ps);
+
+#ifndef GL_ES
+    glEnable(GL_POINT_SPRITE);
+    glEnable(GL_VERTEX_PROGRAM_POINT_SIZE);
+#endif
+
+    const gl::Buffer &instances = m_instancedData->instances;
+    batcher.render(m_instancedData->instances, [&](const InstanceKey &key, const std::vector<Instance> &batch)
+    {
+        const auto *form = globularFormManager->getForm(key.formId);
+        setKingParameters(key.formId);
+
+        if (!form->instancedGLDataInitialized)
+        {
+            if (!form->GLDataInitialized)
+            {
+                initGlobularData(form->bo, form->vo, form->gblobs);
+                form->GLDataInitialized = true;
+            }
+
+            // Both programs read the offset and tidal size and the parameters
+            // from the same records; only the stars use the orientation
+            auto addInstanceBuffers = [&instances](gl::VertexObject &vo, const CelestiaGLProgram *prog)
+            {
+                vo.addInstanceBuffer(
+                    instances, prog->attribIndex("in_Offset"), 4, gl::VertexObject::DataType::Float,
+                    false, sizeof(Instance), offsetof(Instance, offset));
+                vo.addInstanceBuffer(
+                    instances, prog->attribIndex("in_InstanceParams"), 4, gl::VertexObject::DataType::Float,
+                    false, sizeof(Instance), offsetof(Instance, brightness));
+            };
+
+            form->tidalInstancedVo = gl::VertexObject(gl::VertexObject::Primitive::TriangleFan);
+            addGlobularVertexBuffers(form->tidalInstancedVo, form->bo);
+            addInstanceBuffers(form->tidalInstancedVo, tidalProg);
+
+            form->starInstancedVo = gl::VertexObject(gl::VertexObject::Primitive::Points);
+            addGlobularVertexBuffers(form->starInstancedVo, form->bo);
+            addInstanceBuffers(form->starInstancedVo, globProg);
+            constexpr std::array<const char*, 3> modelAttributes = { "in_Model0", "in_Model1", "in_Model2" };
+            for (int column = 0; column < 3; ++column)
+            {
+                form->starInstancedVo.addInstanceBuffer(
+                    instances, globProg->attribIndex(modelAttributes[column]), 3, gl::VertexObject::DataType::Float,
+                    false, sizeof(Instance), offsetof(Instance, m) + column * 3 * sizeof(float));
+            }
+
+            form->instancedGLDataInitialized = true;
+        }
+
+        Eigen::Matrix4f pr;
+        if (key.nearZ != 0.0f && key.farZ != 0.0f)
+            m_renderer.buildProjectionMatrix(pr, key.nearZ, key.farZ, m_zoom);
+        else
+            pr = m_renderer.getProjectionMatrix();
+
+        auto instanceCount = static_cast<int>(batch.size());
+
+        glActiveTexture(GL_TEXTURE1);
+        globularFormManager->getCenterTex(key.formId)->bind();
+
+        tidalProg->use();
+        tidalProg->setMVPMatrices(pr, m_renderer.getModelViewMatrix());
+        tidalProg->mat3Param("viewMat")     = m_viewMat;
+        tidalProg->samplerParam("colorTex") = 0;
+        tidalProg->samplerParam("tidalTex") = 1;
+        form->tidalInstancedVo.drawInstanced(4, instanceCount);
+
+        float spriteEnd = 4.0f;
+        for (const Instance &instance : batch)
+            spriteEnd = std::max(spriteEnd, instance.spriteEnd);
+        if (spriteEnd <= 4.0f)
+            return;
+
+        globProg->use();
+        globProg->setMVPMatrices(pr, m_renderer.getModelViewMatrix());
+        globProg->samplerParam("colorTex") = 0;
+        globProg->samplerParam("starTex")  = 2;
+        form->starInstancedVo.drawInstanced(static_cast<int>(spriteEnd) - 4, instanceCount, 4);
+    });
+
+#ifndef GL_ES
+    glDisable(GL_POINT_SPRITE);
+    glDisable(GL_VERTEX_PROGRAM_POINT_SIZE);
+#endif
+    glActiveTexture(GL_TEXTURE0);
+    return true;
 }
 
 } // namespace celestia::render
@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include <Eigen/Core>
@@ -37,9 +38,21 @@ public:
 
 private:
     struct Object;
+    struct RenderInfo;
 
+    bool getRenderInfo(const Object &obj, RenderInfo &info) const;
     void renderForm(CelestiaGLProgram *tidalProg, CelestiaGLProgram *globProg, const Object &obj) const;
 
+    // Draw all globulars sharing a form, projection and detail class with
+    // one instanced draw call for the tidal sprites and one for the stars
+    struct Instance;
+    struct InstanceKey;
+    struct InstancedData;
+    std::unique_ptr<InstancedData> m_instancedData;
+
+    // Returns false if the instanced programs aren't available
+    bool renderInstanced();
+
     // global state
     std::vector<Object> m_objects;
     Renderer           &m_renderer;
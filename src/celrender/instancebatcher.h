@@ -0,0 +1,95 @@
+// instancebatcher.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Groups per-object instance records into instanced draw calls.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <celrender/gl/buffer.h>
+
+namespace celestia::render
+{
+
+// Objects drawn with a vertex count which is rounded up to the same power
+// of two share a batch, so no object processes more than twice its own
+// vertices.
+inline int
+instanceSizeClass(int count)
+{
+    int result = 0;
+    while (result < 31 && (1 << result) < count)
+        ++result;
+    return result;
+}
+
+// Collects the instance records of the objects added during a frame and
+// draws them in batches: the records are sorted by key, and each run of
+// equal keys is uploaded to the instance buffer and drawn by a single
+// callback. The key holds everything which must be the same for the whole
+// draw call, such as the form, the projection or the detail class. KEY
+// must provide operator< and operator==, INSTANCE is uploaded as is.
+template<typename KEY, typename INSTANCE>
+class InstanceBatcher
+{
+public:
+    void clear()
+    {
+        m_entries.clear();
+        m_instances.clear();
+    }
+
+    bool empty() const { return m_instances.empty(); }
+
+    void add(const KEY &key, const INSTANCE &instance)
+    {
+        m_entries.push_back(Entry{ key, static_cast<std::uint32_t>(m_instances.size()) });
+        m_instances.push_back(instance);
+    }
+
+    // Call drawBatch(key, instances) for each batch, after uploading the
+    // instances of the batch to instanceBuffer
+    template<typename F>
+    void render(gl::Buffer &instanceBuffer, F &&drawBatch)
+    {
+        std::sort(m_entries.begin(), m_entries.end(),
+                  [](const Entry &a, const Entry &b) { return a.key < b.key; });
+
+        for (auto first = m_entries.cbegin(); first != m_entries.cend();)
+        {
+            auto last = std::find_if(first, m_entries.cend(),
+                                     [first](const Entry &entry) { return !(entry.key == first->key); });
+
+            m_batch.clear();
+            for (auto it = first; it != last; ++it)
+                m_batch.push_back(m_instances[it->index]);
+
+            instanceBuffer.invalidateData().setData(m_batch, gl::Buffer::BufferUsage::StreamDraw);
+            drawBatch(first->key, static_cast<const std::vector<INSTANCE>&>(m_batch));
+
+            first = last;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        KEY           key;
+        std::uint32_t index; // index of the record in m_instances
+    };
+
+    std::vector<Entry>    m_entries;
+    std::vector<INSTANCE> m_instances;
+    std::vector<INSTANCE> m_batch;
+};
+
+} // namespace celestia::render
@@ -13,11 +13,13 @@
 
 #include <array>
 #include <cstddef>
+#include <cstring>
 
 #include <celengine/glsupport.h>
 #include <celengine/render.h>
 #include <celengine/shadermanager.h>
 #include <celrender/gl/buffer.h>
+#include <celrender/gl/streambuffer.h>
 #include <celrender/gl/vertexobject.h>
 
 namespace celestia::render
@@ -62,21 +64,24 @@ LineRenderer::color_type() const
 void
 LineRenderer::draw_triangles(int count, int offset) const
 {
-    m_trVO->draw(gl::VertexObject::Primitive::Triangles, count, offset);
+    const auto &vo = m_streamed ? m_trStreamVO : m_trVO;
+    vo->draw(gl::VertexObject::Primitive::Triangles, count, offset + m_streamFirst);
 }
 
 //! Draw triangle strips.
 void
 LineRenderer::draw_triangle_strip(int count, int offset) const
 {
-    m_trVO->draw(gl::VertexObject::Primitive::TriangleStrip, count, offset);
+    const auto &vo = m_streamed ? m_trStreamVO : m_trVO;
+    vo->draw(gl::VertexObject::Primitive::TriangleStrip, count, offset + m_streamFirst);
 }
 
 //! Draw lines defained with segments.
 void
 LineRenderer::draw_lines(int count, int offset) const
 {
-    m_lnVO->draw(static_cast<gl::VertexObject::Primitive>(m_primType), count, offset);
+    const auto &vo = m_streamed ? m_lnStreamVO : m_lnVO;
+    vo->draw(static_cast<gl::VertexObject::Primitive>(m_primType), count, offset + m_streamFirst);
 }
 
 //! Enable GPU shader and set it's uniform values. Set line width.
@@ -110,37 +115,43 @@ LineRenderer::setup_shader()
     }
 }
 
-//! Allocate GPU memory for vertices and define its layout.
+//! Define the layout of line vertices stored in a buffer.
 void
-LineRenderer::create_vbo_lines()
+LineRenderer::add_line_attributes(gl::VertexObject &vo, gl::Buffer &bo) const
 {
-    m_lnVO = std::make_unique<gl::VertexObject>();
-    m_lnBO = std::make_unique<gl::Buffer>();
-
-    m_lnBO->setData(m_vertices, static_cast<gl::Buffer::BufferUsage>(m_storageType));
-
-    m_lnVO->addVertexBuffer(
-        *m_lnBO,
+    vo.addVertexBuffer(
+        bo,
         CelestiaGLProgram::VertexCoordAttributeIndex,
         pos_count(),
         gl::VertexObject::DataType::Float,
         false,
-        sizeof(m_vertices[0]),
+        sizeof(Vertex),
         offsetof(Vertex, pos));
 
     if (color_count() != 0)
     {
-        m_lnVO->addVertexBuffer(
-            *m_lnBO,
+        vo.addVertexBuffer(
+            bo,
             CelestiaGLProgram::ColorAttributeIndex,
             color_count(),
             color_type() == VF_UBYTE ? gl::VertexObject::DataType::UnsignedByte : gl::VertexObject::DataType::Float,
             color_type() == VF_UBYTE,
-            sizeof(m_vertices[0]),
+            sizeof(Vertex),
             offsetof(Vertex, color));
     }
 }
 
+//! Allocate GPU memory for vertices and define its layout.
+void
+LineRenderer::create_vbo_lines()
+{
+    m_lnVO = std::make_unique<gl::VertexObject>();
+    m_lnBO = std::make_unique<gl::Buffer>();
+
+    m_lnBO->setData(m_vertices, static_cast<gl::Buffer::BufferUsage>(m_storageType));
+    add_line_attributes(*m_lnVO, *m_lnBO);
+}
+
 //! Update or create GPU memory for vertices.
 void
 LineRenderer::setup_vbo_lines()
@@ -158,16 +169,13 @@ LineRenderer::setup_vbo_lines()
     }
 }
 
-//! Allocate GPU memory for vertices and define its layout.
+//! Define the layout of triangle vertices stored in a buffer.
 void
-LineRenderer::create_vbo_triangles()
+LineRenderer::add_triangle_attributes(gl::VertexObject &vo, gl::Buffer &bo) const
 {
-    m_trVO = std::make_unique<gl::VertexObject>();
-    m_trBO = std::make_unique<gl::Buffer>();
-
     GLsizei                    stride;
     std::array<std::size_t, 4> offset;
-    if (m_primType == PrimType::Lines || (m_hints & PREFER_SIMPLE_TRIANGLES) != 0)
+    if (uses_segments())
     {
         stride = static_cast<GLsizei>(sizeof(LineSegment));
         offset =
@@ -177,9 +185,6 @@ LineRenderer::create_vbo_triangles()
             offsetof(LineSegment, scale),
             offsetof(LineSegment, point1) + offsetof(Vertex, color)
         };
-
-        m_trBO->setData(m_segments, static_cast<gl::Buffer::BufferUsage>(m_storageType));
-        m_segments.clear();
     }
     else
     {
@@ -191,28 +196,25 @@ LineRenderer::create_vbo_triangles()
             offsetof(LineVertex, scale),
             offsetof(LineVertex, point) + offsetof(Vertex, color)
         };
-
-        m_trBO->setData(m_verticesTr, static_cast<gl::Buffer::BufferUsage>(m_storageType));
-        m_verticesTr.clear();
     }
-    m_trVO->addVertexBuffer(
-        *m_trBO,
+    vo.addVertexBuffer(
+        bo,
         CelestiaGLProgram::VertexCoordAttributeIndex,
         pos_count(),
         gl::VertexObject::DataType::Float,
         false,
         stride,
         static_cast<GLsizeiptr>(offset[0]));
-    m_trVO->addVertexBuffer(
-        *m_trBO,
+    vo.addVertexBuffer(
+        bo,
         CelestiaGLProgram::NextVCoordAttributeIndex,
         pos_count(),
         gl::VertexObject::DataType::Float,
         false,
         stride,
         static_cast<GLsizeiptr>(offset[1]));
-    m_trVO->addVertexBuffer(
-        *m_trBO,
+    vo.addVertexBuffer(
+        bo,
         CelestiaGLProgram::ScaleFactorAttributeIndex,
         1,
         gl::VertexObject::DataType::Float,
@@ -221,8 +223,8 @@ LineRenderer::create_vbo_triangles()
         static_cast<GLsizeiptr>(offset[2]));
     if (color_count() != 0)
     {
-        m_trVO->addVertexBuffer(
-            *m_trBO,
+        vo.addVertexBuffer(
+            bo,
             CelestiaGLProgram::ColorAttributeIndex,
             color_count(),
             color_type() == VF_UBYTE ? gl::VertexObject::DataType::UnsignedByte : gl::VertexObject::DataType::Float,
@@ -232,6 +234,26 @@ LineRenderer::create_vbo_triangles()
     }
 }
 
+//! Allocate GPU memory for vertices and define its layout.
+void
+LineRenderer::create_vbo_triangles()
+{
+    m_trVO = std::make_unique<gl::VertexObject>();
+    m_trBO = std::make_unique<gl::Buffer>();
+
+    if (uses_segments())
+    {
+        m_trBO->setData(m_segments, static_cast<gl::Buffer::BufferUsage>(m_storageType));
+        m_segments.clear();
+    }
+    else
+    {
+        m_trBO->setData(m_verticesTr, static_cast<gl::Buffer::BufferUsage>(m_storageType));
+        m_verticesTr.clear();
+    }
+    add_triangle_attributes(*m_trVO, *m_trBO);
+}
+
 //! Update or create GPU memory for vertices.
 void
 LineRenderer::setup_vbo_triangles()
@@ -242,7 +264,7 @@ LineRenderer::setup_vbo_triangles()
         {
             m_trBO->invalidateData();
 
-            if (m_primType == PrimType::Lines || (m_hints & PREFER_SIMPLE_TRIANGLES) != 0)
+            if (uses_segments())
             {
                 m_trBO->setData(m_segments);
             }
@@ -258,10 +280,73 @@ LineRenderer::setup_vbo_triangles()
     }
 }
 
+/**
+ * @brief Write vertices to the renderer's stream buffer.
+ *
+ * @return false if the vertices don't fit in the stream buffer.
+ */
+bool
+LineRenderer::setup_vbo_stream()
+{
+    const void *data;
+    GLsizeiptr  stride;
+    std::size_t count;
+    if (!m_useTriangles)
+    {
+        data   = m_vertices.data();
+        stride = sizeof(Vertex);
+        count  = m_vertices.size();
+    }
+    else if (uses_segments())
+    {
+        data   = m_segments.data();
+        stride = sizeof(LineSegment);
+        count  = m_segments.size();
+    }
+    else
+    {
+        data   = m_verticesTr.data();
+        stride = sizeof(LineVertex);
+        count  = m_verticesTr.size();
+    }
+
+    gl::StreamBuffer &stream = m_renderer.getStreamBuffer();
+    auto size = static_cast<GLsizeiptr>(count) * stride;
+    // Aligning the data to the vertex size may take up to another vertex
+    if (size + stride > stream.regionSize())
+        return false;
+
+    m_streamFirst = 0;
+    if (size > 0)
+    {
+        auto allocation = stream.allocate(size, stride);
+        std::memcpy(allocation.data, data, static_cast<std::size_t>(size));
+        stream.flush();
+        m_streamFirst = static_cast<int>(allocation.offset / stride);
+    }
+
+    auto &vo = m_useTriangles ? m_trStreamVO : m_lnStreamVO;
+    if (vo == nullptr)
+    {
+        vo = std::make_unique<gl::VertexObject>();
+        if (m_useTriangles)
+            add_triangle_attributes(*vo, stream.buffer());
+        else
+            add_line_attributes(*vo, stream.buffer());
+    }
+
+    return true;
+}
+
 //! Update or create GPU memory for vertices.
 void
 LineRenderer::setup_vbo()
 {
+    m_streamed = m_storageType != StorageType::Static && setup_vbo_stream();
+    if (m_streamed)
+        return;
+
+    m_streamFirst = 0;
     if (!m_useTriangles)
         setup_vbo_lines();
     else
@@ -388,6 +473,12 @@ LineRenderer::should_triangulate() const
     return rasterized_width() > celestia::gl::maxLineWidth;
 }
 
+bool
+LineRenderer::uses_segments() const
+{
+    return m_primType == PrimType::Lines || (m_hints & PREFER_SIMPLE_TRIANGLES) != 0;
+}
+
 float
 LineRenderer::width_multiplyer() const
 {
@@ -448,6 +539,8 @@ LineRenderer::finish()
         m_lnBO->unbind();
     if (m_trBO != nullptr)
         m_trBO->unbind();
+    if (m_streamed)
+        m_renderer.getStreamBuffer().buffer().unbind();
     m_inUse = false;
     m_prog = nullptr;
 }
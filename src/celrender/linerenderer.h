@@ -43,6 +43,9 @@ namespace celestia::render
  * For lines which are not updated (static storage) conversation into triangles is performed before
  * the actual rendering is done. For lines with dynamic or stream storage conversation into
  * triangles is performed immediatelly when a new vertex or segment is added.
+ * Vertices of lines with dynamic or stream storage are written to the renderer's shared stream
+ * buffer, so that renderers which update lines every frame don't each upload to their own buffer
+ * objects. Lines with static storage are kept in their own buffer objects.
  *
  * Worflow:
  *   1. create lr
@@ -254,6 +257,9 @@ private:
     void draw_triangle_strip(int count, int offset) const;
     void setup_shader();
     void setup_vbo();
+    bool setup_vbo_stream();
+    void add_line_attributes(gl::VertexObject &vo, gl::Buffer &bo) const;
+    void add_triangle_attributes(gl::VertexObject &vo, gl::Buffer &bo) const;
     void create_vbo_lines();
     void setup_vbo_lines();
     void create_vbo_triangles();
@@ -269,6 +275,7 @@ private:
     int color_count() const;
     int color_type() const;
     bool should_triangulate() const;
+    bool uses_segments() const;
     float width_multiplyer() const;
     float rasterized_width() const;
 
@@ -280,17 +287,21 @@ private:
     std::unique_ptr<gl::VertexObject>   m_trVO;
     std::unique_ptr<gl::Buffer>         m_lnBO;
     std::unique_ptr<gl::Buffer>         m_trBO;
+    std::unique_ptr<gl::VertexObject>   m_lnStreamVO;
+    std::unique_ptr<gl::VertexObject>   m_trStreamVO;
     const Renderer                     &m_renderer;
     float                               m_width;
     PrimType                            m_primType;
     StorageType                         m_storageType;
     VertexFormat                        m_format;
     int                                 m_hints{ 0 };
+    int                                 m_streamFirst{ 0 };
     bool                                m_useTriangles{ false };
     bool                                m_verticesTriangulated{ false };
     bool                                m_segmented{ false };
     bool                                m_loopDone{ false };
     bool                                m_inUse{ false };
+    bool                                m_streamed{ false };
     CelestiaGLProgram                  *m_prog{ nullptr };
 };
 
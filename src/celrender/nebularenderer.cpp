@@ -76,9 +76,12 @@ NebulaRenderer::render()
 void
 NebulaRenderer::renderNebula(const Object &obj) const
 {
-    Geometry *g = nullptr;
-    if (auto geometry = obj.nebula->getGeometry(); geometry != InvalidResource)
-        g = engine::GetGeometryManager()->find(geometry);
+    auto geometry = obj.nebula->getGeometry();
+    if (geometry == InvalidResource)
+        return;
+
+    // Nebulae are skipped until their model has been loaded
+    Geometry *g = engine::GetGeometryManager()->findAsync(geometry);
     if (g == nullptr)
         return;
 
@@ -15,4 +15,6 @@ class NebulaRenderer;
 class OpenClusterRenderer;
 class RingRenderer;
 class SkyGridRenderer;
+class StarPickBuffer;
+class StaticStarRenderer;
 }
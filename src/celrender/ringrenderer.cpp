@@ -33,6 +33,9 @@ namespace
 
 constexpr float SegmentSizeThreshold = 30.0f;
 constexpr std::uint32_t BaseSectionCount = UINT32_C(180);
+// Change of the light direction, in radians, for which the projection of
+// the ring shadow is computed again
+constexpr float ShadowDirectionTolerance = 1.0e-4f;
 
 struct RingVertex
 {
@@ -63,71 +66,64 @@ createShaderProperties(const LightingState& ls,
     return shadprop;
 }
 
-void
-setUpShadowParameters(CelestiaGLProgram* prog,
-                      const LightingState& ls,
-                      float planetOblateness)
+RingRenderer::ShadowProjection
+computeShadowProjection(const Eigen::Vector3f& lightDirection, float planetOblateness)
 {
-    for (unsigned int li = 0; li < ls.nLights; li++)
+    // Compute the projection vectors based on the sun direction.
+    // I'm being a little careless here--if the sun direction lies
+    // along the y-axis, this will fail.  It's unlikely that a
+    // planet would ever orbit underneath its sun (an orbital
+    // inclination of 90 degrees), but this should be made
+    // more robust anyway.
+    Eigen::Vector3f axis = Eigen::Vector3f::UnitY().cross(lightDirection);
+    float cosAngle = Eigen::Vector3f::UnitY().dot(lightDirection);
+    axis.normalize();
+
+    float tScale = 1.0f;
+    if (planetOblateness != 0.0f)
     {
-        const DirectionalLight& light = ls.lights[li];
-
-        // Compute the projection vectors based on the sun direction.
-        // I'm being a little careless here--if the sun direction lies
-        // along the y-axis, this will fail.  It's unlikely that a
-        // planet would ever orbit underneath its sun (an orbital
-        // inclination of 90 degrees), but this should be made
-        // more robust anyway.
-        Eigen::Vector3f axis = Eigen::Vector3f::UnitY().cross(light.direction_obj);
-        float cosAngle = Eigen::Vector3f::UnitY().dot(light.direction_obj);
-        axis.normalize();
-
-        float tScale = 1.0f;
-        if (planetOblateness != 0.0f)
-        {
-            // For oblate planets, the size of the shadow volume will vary
-            // based on the light direction.
+        // For oblate planets, the size of the shadow volume will vary
+        // based on the light direction.
 
-            // A vertical slice of the planet is an ellipse
-            float a = 1.0f;                          // semimajor axis
-            float b = a * (1.0f - planetOblateness); // semiminor axis
-            float ecc2 = 1.0f - (b * b) / (a * a);   // square of eccentricity
+        // A vertical slice of the planet is an ellipse
+        float a = 1.0f;                          // semimajor axis
+        float b = a * (1.0f - planetOblateness); // semiminor axis
+        float ecc2 = 1.0f - (b * b) / (a * a);   // square of eccentricity
 
-            // Calculate the radius of the ellipse at the incident angle of the
-            // light on the ring plane + 90 degrees.
-            float r = a * std::sqrt((1.0f - ecc2) /
-                                    (1.0f - ecc2 * math::square(cosAngle)));
-
-            tScale *= a / r;
-        }
+        // Calculate the radius of the ellipse at the incident angle of the
+        // light on the ring plane + 90 degrees.
+        float r = a * std::sqrt((1.0f - ecc2) /
+                                (1.0f - ecc2 * math::square(cosAngle)));
 
-        // The s axis is perpendicular to the shadow axis in the plane of the
-        // of the rings, and the t axis completes the orthonormal basis.
-        Eigen::Vector3f sAxis = axis * 0.5f;
-        Eigen::Vector3f tAxis = (axis.cross(light.direction_obj)) * 0.5f * tScale;
-        Eigen::Vector4f texGenS;
-        texGenS.head(3) = sAxis;
-        texGenS[3] = 0.5f;
-        Eigen::Vector4f texGenT;
-        texGenT.head(3) = tAxis;
-        texGenT[3] = 0.5f;
-
-        // r0 and r1 determine the size of the planet's shadow and penumbra
-        // on the rings.
-        // A more accurate ring shadow calculation would set r1 / r0
-        // to the ratio of the apparent sizes of the planet and sun as seen
-        // from the rings. Even more realism could be attained by letting
-        // this ratio vary across the rings, though it may not make enough
-        // of a visual difference to be worth the extra effort.
-        float r0 = 0.24f;
-        float r1 = 0.25f;
-        float bias = 1.0f / (1.0f - r1 / r0);
-
-        prog->shadows[li][0].texGenS = texGenS;
-        prog->shadows[li][0].texGenT = texGenT;
-        prog->shadows[li][0].maxDepth = 1.0f;
-        prog->shadows[li][0].falloff = bias / r0;
+        tScale *= a / r;
     }
+
+    // The s axis is perpendicular to the shadow axis in the plane of the
+    // of the rings, and the t axis completes the orthonormal basis.
+    Eigen::Vector3f sAxis = axis * 0.5f;
+    Eigen::Vector3f tAxis = (axis.cross(lightDirection)) * 0.5f * tScale;
+
+    RingRenderer::ShadowProjection projection;
+    projection.lightDirection = lightDirection;
+    projection.oblateness = planetOblateness;
+    projection.texGenS.head(3) = sAxis;
+    projection.texGenS[3] = 0.5f;
+    projection.texGenT.head(3) = tAxis;
+    projection.texGenT[3] = 0.5f;
+
+    // r0 and r1 determine the size of the planet's shadow and penumbra
+    // on the rings.
+    // A more accurate ring shadow calculation would set r1 / r0
+    // to the ratio of the apparent sizes of the planet and sun as seen
+    // from the rings. Even more realism could be attained by letting
+    // this ratio vary across the rings, though it may not make enough
+    // of a visual difference to be worth the extra effort.
+    float r0 = 0.24f;
+    float r1 = 0.25f;
+    float bias = 1.0f / (1.0f - r1 / r0);
+    projection.falloff = bias / r0;
+
+    return projection;
 }
 
 } // end unnamed namespace
@@ -176,7 +172,7 @@ RingRenderer::renderRings(RingSystem& rings,
     prog->ringRadius = inner;
     prog->ringWidth = outer - inner;
 
-    setUpShadowParameters(prog, ls, planetOblateness);
+    setUpShadowParameters(prog, rings, ls, planetOblateness);
 
     if (ringsTex != nullptr)
         ringsTex->bind();
@@ -202,6 +198,35 @@ RingRenderer::renderRings(RingSystem& rings,
     renderLOD(level, nSections);
 }
 
+// The projection of the planet shadow onto the ring plane only depends on
+// the light direction in the planet frame, which changes slowly, so it is
+// kept for each ring system and light until the direction changes by more
+// than ShadowDirectionTolerance.
+void
+RingRenderer::setUpShadowParameters(CelestiaGLProgram* prog,
+                                    const RingSystem& rings,
+                                    const LightingState& ls,
+                                    float planetOblateness)
+{
+    auto& cached = shadowProjections[&rings];
+    for (unsigned int li = 0; li < std::min(ls.nLights, MaxShaderLights); li++)
+    {
+        const Eigen::Vector3f& direction = ls.lights[li].direction_obj;
+        std::optional<ShadowProjection>& projection = cached[li];
+        if (!projection.has_value() ||
+            projection->oblateness != planetOblateness ||
+            (projection->lightDirection - direction).squaredNorm() > math::square(ShadowDirectionTolerance))
+        {
+            projection = computeShadowProjection(direction, planetOblateness);
+        }
+
+        prog->shadows[li][0].texGenS = projection->texGenS;
+        prog->shadows[li][0].texGenT = projection->texGenT;
+        prog->shadows[li][0].maxDepth = 1.0f;
+        prog->shadows[li][0].falloff = projection->falloff;
+    }
+}
+
 void
 RingRenderer::initializeLOD(unsigned int level, std::uint32_t nSections)
 {
@@ -13,11 +13,15 @@
 #include <array>
 #include <cstdint>
 #include <optional>
+#include <unordered_map>
 
+#include <Eigen/Core>
+
+#include <celengine/lightenv.h>
 #include "gl/buffer.h"
 #include "gl/vertexobject.h"
 
-class LightingState;
+class CelestiaGLProgram;
 struct Matrices;
 class Renderer;
 struct RenderInfo;
@@ -42,7 +46,18 @@ public:
                      const Matrices &m,
                      bool inside);
 
+    // Projection of the planet shadow onto the ring plane for a light
+    struct ShadowProjection
+    {
+        Eigen::Vector3f lightDirection;
+        float oblateness;
+        Eigen::Vector4f texGenS;
+        Eigen::Vector4f texGenT;
+        float falloff;
+    };
+
 private:
+    void setUpShadowParameters(CelestiaGLProgram*, const RingSystem&, const LightingState&, float);
     void initializeLOD(unsigned int, std::uint32_t);
     void renderLOD(unsigned int, std::uint32_t);
 
@@ -51,6 +66,7 @@ private:
     std::array<float, nLODs - 1> sectionScales;
     std::array<std::optional<gl::Buffer>, nLODs> buffers;
     std::array<std::optional<gl::VertexObject>, nLODs> vertexObjects;
+    std::unordered_map<const RingSystem*, std::array<std::optional<ShadowProjection>, MaxLights>> shadowProjections;
     Renderer& renderer;
 };
 
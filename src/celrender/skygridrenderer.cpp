@@ -19,16 +19,20 @@
 #include <iterator>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Geometry>
 #include <fmt/format.h>
 
 #include <celcompat/numbers.h>
 #include <celengine/render.h>
+#include <celengine/shadermanager.h>
 #include <celengine/skygrid.h>
 #include <celmath/mathlib.h>
 #include <celmath/geomutil.h>
 #include <celmath/vecgl.h>
+#include <celrender/gl/buffer.h>
+#include <celrender/gl/vertexobject.h>
 #include <celutil/color.h>
 #include "linerenderer.h"
 
@@ -41,8 +45,10 @@ namespace
 // The maximum number of parallels or meridians that will be visible
 constexpr double MAX_VISIBLE_ARCS = 10.0;
 
-// Number of line segments used to approximate one arc of the celestial sphere
-constexpr int ARC_SUBDIVISIONS = 100;
+// Latitude and longitude divisions of the sphere on which the shader draws
+// the grid lines
+constexpr int SPHERE_STACKS = 36;
+constexpr int SPHERE_SLICES = 72;
 
 // Size of the cross indicating the north and south poles
 constexpr double POLAR_CROSS_SIZE = 0.01;
@@ -293,6 +299,44 @@ longitudeLabel(int longitude, int longitudeStep,
     return result;
 }
 
+// Triangles of a unit sphere facing its center
+std::vector<Eigen::Vector3f>
+buildSphere()
+{
+    auto vertex = [](int stack, int slice)
+    {
+        double phi = numbers::pi * (static_cast<double>(stack) / SPHERE_STACKS - 0.5);
+        double theta = 2.0 * numbers::pi * static_cast<double>(slice) / SPHERE_SLICES;
+        double cosPhi;
+        double sinPhi;
+        math::sincos(phi, sinPhi, cosPhi);
+        double cosTheta;
+        double sinTheta;
+        math::sincos(theta, sinTheta, cosTheta);
+        // Celestia coordinates
+        return Eigen::Vector3f(static_cast<float>(cosPhi * cosTheta),
+                               static_cast<float>(sinPhi),
+                               static_cast<float>(-cosPhi * sinTheta));
+    };
+
+    std::vector<Eigen::Vector3f> vertices;
+    vertices.reserve(static_cast<std::size_t>(SPHERE_STACKS * SPHERE_SLICES * 6));
+    for (int i = 0; i < SPHERE_STACKS; ++i)
+    {
+        for (int j = 0; j < SPHERE_SLICES; ++j)
+        {
+            vertices.push_back(vertex(i, j));
+            vertices.push_back(vertex(i + 1, j));
+            vertices.push_back(vertex(i + 1, j + 1));
+            vertices.push_back(vertex(i, j));
+            vertices.push_back(vertex(i + 1, j + 1));
+            vertices.push_back(vertex(i, j + 1));
+        }
+    }
+
+    return vertices;
+}
+
 } // end unnamed namespace
 
 struct SkyGridRenderer::RenderInfo
@@ -444,7 +488,6 @@ SkyGridRenderer::RenderInfo::RenderInfo(double vfov, double viewAspectRatio,
 }
 
 SkyGridRenderer::SkyGridRenderer(Renderer& renderer) :
-    m_gridRenderer(std::make_unique<LineRenderer>(renderer, 1.0f, LineRenderer::PrimType::LineStrip, LineRenderer::StorageType::Stream)),
     m_crossRenderer(std::make_unique<LineRenderer>(renderer, 1.0f, LineRenderer::PrimType::Lines, LineRenderer::StorageType::Stream)),
     m_renderer(renderer)
 {
@@ -462,12 +505,16 @@ SkyGridRenderer::render(const engine::SkyGrid& grid, float zoom) const
     RenderInfo renderInfo(vfov, viewAspectRatio, cameraOrientation, grid);
 
     int decIncrement = parallelSpacing(renderInfo.idealParallelSpacing);
+    int raIncrement = meridianSpacing(renderInfo.idealMeridianSpacing, grid.longitudeUnits);
+    int totalLongitudeUnits = grid.longitudeUnits == engine::SkyGrid::LongitudeDegrees ? (DEG_MIN_SEC_TOTAL * 2) : HOUR_MIN_SEC_TOTAL;
     Eigen::Matrix3f cameraMatrix = cameraOrientation.cast<float>().toRotationMatrix();
 
-    m_gridRenderer->startUpdate();
+    // Render meridians only to the last latitude circle; this looks better
+    // than spokes radiating from the pole.
+    double maxMeridianAngle = numbers::pi * 0.5 * (1.0 - 2.0 * static_cast<double>(decIncrement) / static_cast<double>(DEG_MIN_SEC_TOTAL));
 
-    int count = drawParallels(renderInfo, cameraMatrix, grid.labelColor, decIncrement) +
-                drawMeridians(renderInfo, cameraMatrix, grid, decIncrement);
+    addParallelLabels(renderInfo, cameraMatrix, grid.labelColor, decIncrement);
+    addMeridianLabels(renderInfo, cameraMatrix, grid, raIncrement, maxMeridianAngle);
 
     // Radius of sphere is arbitrary, with the constraint that it shouldn't
     // intersect the near or far plane of the view frustum.
@@ -484,10 +531,33 @@ SkyGridRenderer::render(const engine::SkyGrid& grid, float zoom) const
     ps.smoothLines = true;
     m_renderer.setPipelineState(ps);
 
-    for (int offset = 0, i = 0; i < count; ++i)
+    // The lines are drawn by the fragment shader on a sphere around the
+    // observer, so the cost doesn't depend on the grid spacing
+    if (auto *prog = m_renderer.getShaderManager().getShader("skygrid"); prog != nullptr)
     {
-        m_gridRenderer->render(matrices, grid.lineColor, ARC_SUBDIVISIONS + 1, offset);
-        offset += ARC_SUBDIVISIONS + 1;
+        if (m_sphereVo == nullptr)
+        {
+            std::vector<Eigen::Vector3f> vertices = buildSphere();
+            m_sphereBo = std::make_unique<gl::Buffer>(gl::Buffer::TargetHint::Array, vertices);
+            m_sphereVo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Triangles);
+            m_sphereVo->setCount(static_cast<int>(vertices.size()));
+            m_sphereVo->addVertexBuffer(*m_sphereBo,
+                                        CelestiaGLProgram::VertexCoordAttributeIndex,
+                                        3,
+                                        gl::VertexObject::DataType::Float);
+        }
+
+        std::array<int, 4> viewport;
+        m_renderer.getViewport(viewport);
+
+        prog->use();
+        prog->setMVPMatrices(*matrices.projection, *matrices.modelview);
+        prog->vec2Param("viewportSize") = Eigen::Vector2f(static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+        prog->vec4Param("color") = grid.lineColor.toVector4();
+        prog->floatParam("parallelStep") = static_cast<float>(numbers::pi * static_cast<double>(decIncrement) / static_cast<double>(DEG_MIN_SEC_TOTAL));
+        prog->floatParam("meridianStep") = static_cast<float>(2.0 * numbers::pi * static_cast<double>(raIncrement) / static_cast<double>(totalLongitudeUnits));
+        prog->floatParam("maxMeridianLatitude") = static_cast<float>(maxMeridianAngle);
+        m_sphereVo->draw();
     }
 
     // Draw crosses indicating the north and south poles
@@ -502,45 +572,26 @@ SkyGridRenderer::render(const engine::SkyGrid& grid, float zoom) const
     m_crossRenderer->addVertex( 0.0f,                      -1.0f,  renderInfo.polarCrossSize);
     m_crossRenderer->render(matrices, grid.lineColor, 8);
 
-    m_gridRenderer->clear();
     m_crossRenderer->clear();
-    m_gridRenderer->finish();
     m_crossRenderer->finish();
 }
 
-int
-SkyGridRenderer::drawParallels(const RenderInfo& renderInfo,
-                               const Eigen::Matrix3f& cameraMatrix,
-                               const Color& labelColor,
-                               int decIncrement) const
+void
+SkyGridRenderer::addParallelLabels(const RenderInfo& renderInfo,
+                                   const Eigen::Matrix3f& cameraMatrix,
+                                   const Color& labelColor,
+                                   int decIncrement) const
 {
-    double arcStep = (renderInfo.maxTheta - renderInfo.minTheta) / static_cast<double>(ARC_SUBDIVISIONS);
-    double theta0 = renderInfo.minTheta;
-
     auto startDec = static_cast<int>(std::ceil (DEG_MIN_SEC_TOTAL * (renderInfo.minDec * numbers::inv_pi) / static_cast<double>(decIncrement))) * decIncrement;
     auto endDec   = static_cast<int>(std::floor(DEG_MIN_SEC_TOTAL * (renderInfo.maxDec * numbers::inv_pi) / static_cast<double>(decIncrement))) * decIncrement;
 
-    int count = 0;
     for (int dec = startDec; dec <= endDec; dec += decIncrement)
     {
-        ++count;
         double phi = numbers::pi * static_cast<double>(dec) / static_cast<double>(DEG_MIN_SEC_TOTAL);
         double cosPhi;
         double sinPhi;
         math::sincos(phi, sinPhi, cosPhi);
 
-        for (int j = 0; j <= ARC_SUBDIVISIONS; ++j)
-        {
-            double theta = theta0 + j * arcStep;
-            double cosTheta;
-            double sinTheta;
-            math::sincos(theta, sinTheta, cosTheta);
-            auto x = static_cast<float>(cosPhi * cosTheta);
-            auto y = static_cast<float>(cosPhi * sinTheta);
-            auto z = static_cast<float>(sinPhi);
-            m_gridRenderer->addVertex(x, z, -y);  // convert to Celestia coords
-        }
-
         // Place labels at the intersections of the view frustum planes
         // and the parallels.
         Eigen::Vector3d center(0.0, 0.0, sinPhi);
@@ -571,52 +622,28 @@ SkyGridRenderer::drawParallels(const RenderInfo& renderInfo,
                 m_renderer.addBackgroundAnnotation(nullptr, labelText, labelColor, p1, hAlign, vAlign);
         }
     }
-
-    return count;
 }
 
-int
-SkyGridRenderer::drawMeridians(const RenderInfo& renderInfo,
-                               const Eigen::Matrix3f& cameraMatrix,
-                               const engine::SkyGrid& grid,
-                               int decIncrement) const
+void
+SkyGridRenderer::addMeridianLabels(const RenderInfo& renderInfo,
+                                   const Eigen::Matrix3f& cameraMatrix,
+                                   const engine::SkyGrid& grid,
+                                   int raIncrement,
+                                   double maxMeridianAngle) const
 {
     int totalLongitudeUnits = grid.longitudeUnits == engine::SkyGrid::LongitudeDegrees ? (DEG_MIN_SEC_TOTAL * 2) : HOUR_MIN_SEC_TOTAL;
-    int raIncrement  = meridianSpacing(renderInfo.idealMeridianSpacing, grid.longitudeUnits);
     auto startRa  = static_cast<int>(std::ceil (totalLongitudeUnits * (renderInfo.minTheta * 0.5 * numbers::inv_pi) / static_cast<double>(raIncrement))) * raIncrement;
     auto endRa    = static_cast<int>(std::floor(totalLongitudeUnits * (renderInfo.maxTheta * 0.5 * numbers::inv_pi) / static_cast<double>(raIncrement))) * raIncrement;
 
-    // Render meridians only to the last latitude circle; this looks better
-    // than spokes radiating from the pole.
-    double maxMeridianAngle = numbers::pi * 0.5 * (1.0 - 2.0 * static_cast<double>(decIncrement) / static_cast<double>(DEG_MIN_SEC_TOTAL));
-    double minDec = std::max(renderInfo.minDec, -maxMeridianAngle);
-    double maxDec = std::min(renderInfo.maxDec,  maxMeridianAngle);
-    double arcStep = (maxDec - minDec) / static_cast<double>(ARC_SUBDIVISIONS);
-    double phi0 = minDec;
-
     double cosMaxMeridianAngle = std::cos(maxMeridianAngle);
 
-    int count = 0;
     for (int ra = startRa; ra <= endRa; ra += raIncrement)
     {
-        ++count;
         double theta = 2.0 * numbers::pi * (double) ra / (double) totalLongitudeUnits;
         double cosTheta;
         double sinTheta;
         math::sincos(theta, sinTheta, cosTheta);
 
-        for (int j = 0; j <= ARC_SUBDIVISIONS; ++j)
-        {
-            double phi = phi0 + j * arcStep;
-            double cosPhi;
-            double sinPhi;
-            math::sincos(phi, sinPhi, cosPhi);
-            auto x = static_cast<float>(cosPhi * cosTheta);
-            auto y = static_cast<float>(cosPhi * sinTheta);
-            auto z = static_cast<float>(sinPhi);
-            m_gridRenderer->addVertex(x, z, -y);  // convert to Celestia coords
-        }
-
         // Place labels at the intersections of the view frustum planes
         // and the meridians.
         Eigen::Vector3d center(Eigen::Vector3d::Zero());
@@ -647,8 +674,6 @@ SkyGridRenderer::drawMeridians(const RenderInfo& renderInfo,
                 m_renderer.addBackgroundAnnotation(nullptr, labelText, grid.labelColor, p1, hAlign, vAlign);
         }
     }
-
-    return count;
 }
 
 } // end namespace celestia::render
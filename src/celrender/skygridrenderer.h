@@ -26,11 +26,20 @@ namespace engine
 struct SkyGrid;
 } // end namespace celestia::engine
 
+namespace gl
+{
+class Buffer;
+class VertexObject;
+} // end namespace celestia::gl
+
 namespace render
 {
 
 class LineRenderer;
 
+// Draws the lines of a sky grid with a shader, on a static sphere around
+// the observer; only the spacing of the lines and the positions of their
+// labels are computed on the CPU.
 class SkyGridRenderer
 {
 public:
@@ -42,11 +51,13 @@ public:
 private:
     struct RenderInfo;
 
-    int drawParallels(const RenderInfo&, const Eigen::Matrix3f&, const Color&, int) const;
-    int drawMeridians(const RenderInfo&, const Eigen::Matrix3f&, const engine::SkyGrid&, int) const;
+    void addParallelLabels(const RenderInfo&, const Eigen::Matrix3f&, const Color&, int) const;
+    void addMeridianLabels(const RenderInfo&, const Eigen::Matrix3f&, const engine::SkyGrid&, int, double) const;
 
-    std::unique_ptr<celestia::render::LineRenderer> m_gridRenderer;
     std::unique_ptr<celestia::render::LineRenderer> m_crossRenderer;
+    // Created on first use
+    mutable std::unique_ptr<celestia::gl::Buffer> m_sphereBo;
+    mutable std::unique_ptr<celestia::gl::VertexObject> m_sphereVo;
     Renderer& m_renderer;
 };
 
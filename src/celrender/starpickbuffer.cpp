@@ -0,0 +1,197 @@
+// starpickbuffer.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Picking of the point stars on the graphics card.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "starpickbuffer.h"
+
+#include <limits>
+
+#include <celengine/framebuffer.h>
+#include <celengine/framebufferpool.h>
+#include <celengine/glsupport.h>
+#include <celengine/render.h>
+#include <celimage/pixelformat.h>
+#include "framereadback.h"
+
+namespace celestia::render
+{
+
+namespace
+{
+
+// The color attachment has an alpha channel only on OpenGL ES
+#ifdef GL_ES
+constexpr engine::PixelFormat IdFormat = engine::PixelFormat::RGBA;
+constexpr int IdPixelSize = 4;
+#else
+constexpr engine::PixelFormat IdFormat = engine::PixelFormat::RGB;
+constexpr int IdPixelSize = 3;
+#endif
+
+// Reads in flight; the result of a pick is available after as many frames
+constexpr std::size_t ReadbackDepth = 2;
+
+// Map the square region of the given size centered on the pixel x, y of the
+// viewport onto the whole clip volume, like gluPickMatrix
+Eigen::Matrix4f
+pickMatrix(int x, int y, int size, const std::array<int, 4>& viewport)
+{
+    float scaleX = static_cast<float>(viewport[2]) / static_cast<float>(size);
+    float scaleY = static_cast<float>(viewport[3]) / static_cast<float>(size);
+    float ndcX = 2.0f * (static_cast<float>(x - viewport[0]) + 0.5f) / static_cast<float>(viewport[2]) - 1.0f;
+    float ndcY = 2.0f * (static_cast<float>(y - viewport[1]) + 0.5f) / static_cast<float>(viewport[3]) - 1.0f;
+
+    Eigen::Matrix4f m = Eigen::Matrix4f::Identity();
+    m(0, 0) = scaleX;
+    m(1, 1) = scaleY;
+    m(0, 3) = -ndcX * scaleX;
+    m(1, 3) = -ndcY * scaleY;
+    return m;
+}
+
+} // end unnamed namespace
+
+StarPickBuffer::StarPickBuffer() = default;
+
+StarPickBuffer::~StarPickBuffer()
+{
+    engine::GetFramebufferPool()->release(std::move(m_fbo));
+}
+
+void
+StarPickBuffer::request(int x, int y)
+{
+    m_request = { x, y };
+}
+
+void
+StarPickBuffer::render(Renderer &renderer,
+                       StaticStarRenderer &starRenderer,
+                       const StarDatabase &starDB,
+                       const ColorTemperatureTable &colorTemp,
+                       util::array_view<StaticStarRenderer::RangeType> ranges,
+                       const StaticStarRenderer::Settings &settings)
+{
+    if (m_failed || !m_request.has_value())
+        return;
+
+    std::array<int, 4> viewport;
+    renderer.getViewport(viewport);
+    auto [x, y] = *m_request;
+    if (x < viewport[0] || x >= viewport[0] + viewport[2] ||
+        y < viewport[1] || y >= viewport[1] + viewport[3])
+    {
+        return;
+    }
+
+    if (m_fbo == nullptr)
+    {
+        m_fbo = engine::GetFramebufferPool()->acquire(RegionSize, RegionSize,
+                                                      FramebufferObject::ColorAttachment |
+                                                      FramebufferObject::DepthAttachment);
+        if (!m_fbo->isValid())
+        {
+            m_failed = true;
+            return;
+        }
+
+        m_readback = std::make_unique<FrameReadback>(RegionSize, RegionSize, IdFormat, ReadbackDepth);
+        m_pixels.resize(static_cast<std::size_t>(m_readback->getPitch()) * RegionSize);
+    }
+
+    if (m_readback->full())
+        return;
+
+    GLint oldFboId;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &oldFboId);
+    std::array<GLfloat, 4> clearColor;
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor.data());
+
+    m_fbo->bind();
+#ifndef GL_ES
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+#endif
+    glViewport(0, 0, RegionSize, RegionSize);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    Renderer::PipelineState ps;
+    ps.depthTest = true;
+    ps.depthMask = true;
+    renderer.setPipelineState(ps);
+
+    // Dithering could change the ids
+    glDisable(GL_DITHER);
+    starRenderer.renderIds(starDB, colorTemp, ranges, settings,
+                           pickMatrix(x, y, RegionSize, viewport) * renderer.getCurrentProjectionMatrix());
+    glEnable(GL_DITHER);
+
+    if (m_readback->read(0, 0))
+        m_pending.push_back({ x, y });
+
+    m_fbo->unbind(oldFboId);
+    renderer.setViewport(viewport);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+
+    m_request.reset();
+}
+
+bool
+StarPickBuffer::poll()
+{
+    bool updated = false;
+    while (m_readback != nullptr && !m_readback->empty() && m_readback->ready())
+    {
+        auto [x, y] = m_pending.front();
+        m_pending.pop_front();
+        if (!m_readback->retire(m_pixels.data(), m_readback->getPitch()))
+            continue;
+
+        m_result = decode(x, y);
+        updated = true;
+    }
+
+    return updated;
+}
+
+StarPickBuffer::Result
+StarPickBuffer::decode(int x, int y) const
+{
+    Result result{ x, y, std::nullopt };
+
+    // The region is square with the position at its center, so the order
+    // of the rows doesn't matter
+    int bestDistance = std::numeric_limits<int>::max();
+    int pitch = m_readback->getPitch();
+    for (int row = 0; row < RegionSize; ++row)
+    {
+        const std::uint8_t *pixel = m_pixels.data() + static_cast<std::size_t>(row) * pitch;
+        for (int column = 0; column < RegionSize; ++column, pixel += IdPixelSize)
+        {
+            std::uint32_t id = static_cast<std::uint32_t>(pixel[0])
+                             | (static_cast<std::uint32_t>(pixel[1]) << 8)
+                             | (static_cast<std::uint32_t>(pixel[2]) << 16);
+            if (id == 0)
+                continue;
+
+            int dx = column - PickRadius;
+            int dy = row - PickRadius;
+            if (int distance = dx * dx + dy * dy; distance < bestDistance)
+            {
+                bestDistance = distance;
+                result.starIndex = id - 1;
+            }
+        }
+    }
+
+    return result;
+}
+
+} // namespace celestia::render
@@ -0,0 +1,97 @@
+// starpickbuffer.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Picking of the point stars on the graphics card.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celrender/staticstarrenderer.h>
+
+class FramebufferObject;
+
+namespace celestia::render
+{
+
+class FrameReadback;
+
+// Finds the star under a window position by drawing the ids of the stars
+// of the static star buffer into a small offscreen framebuffer around it,
+// with the projection of the frame being rendered. The pixels are read
+// back asynchronously and the result is available a few frames later, so
+// the cost does not depend on the size of the catalog.
+class StarPickBuffer
+{
+public:
+    // Half the width of the square region searched around the position
+    static constexpr int PickRadius = 4;
+
+    struct Result
+    {
+        // Window position of the request, lower left origin
+        int x;
+        int y;
+        // Catalog index of the star nearest to the position, if any
+        std::optional<std::uint32_t> starIndex;
+    };
+
+    StarPickBuffer();
+    ~StarPickBuffer();
+
+    StarPickBuffer(const StarPickBuffer&) = delete;
+    StarPickBuffer& operator=(const StarPickBuffer&) = delete;
+
+    // Pick at the window position x, y during the next render() whose
+    // viewport contains it; replaces a request not yet drawn
+    void request(int x, int y);
+
+    // Draw the star ids for the pending request and start reading them
+    // back. The framebuffer, viewport and clear color are restored; the
+    // pipeline state must be reset by the caller.
+    void render(Renderer &renderer,
+                StaticStarRenderer &starRenderer,
+                const StarDatabase &starDB,
+                const ColorTemperatureTable &colorTemp,
+                util::array_view<StaticStarRenderer::RangeType> ranges,
+                const StaticStarRenderer::Settings &settings);
+
+    // Collect the reads which have completed, without waiting. Returns
+    // true if the result was updated.
+    bool poll();
+
+    // Return true while reads are in flight
+    bool hasPending() const { return !m_pending.empty(); }
+
+    // Result of the most recent completed pick
+    const std::optional<Result>& getResult() const { return m_result; }
+
+private:
+    static constexpr int RegionSize = 2 * PickRadius + 1;
+
+    Result decode(int x, int y) const;
+
+    std::optional<std::array<int, 2>> m_request;
+    std::unique_ptr<FramebufferObject> m_fbo;
+    std::unique_ptr<FrameReadback> m_readback;
+    // Positions of the reads in flight, oldest first
+    std::deque<std::array<int, 2>> m_pending;
+    std::vector<std::uint8_t> m_pixels;
+    std::optional<Result> m_result;
+    bool m_failed{ false };
+};
+
+} // namespace celestia::render
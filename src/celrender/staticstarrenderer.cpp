@@ -0,0 +1,271 @@
+// staticstarrenderer.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include <array>
+#include <vector>
+
+#include <celengine/glsupport.h>
+#include <celengine/render.h>
+#include <celengine/shadermanager.h>
+#include <celengine/star.h>
+#include <celengine/stardb.h>
+#include <celengine/texture.h>
+#include <celrender/gl/buffer.h>
+#include <celrender/gl/vertexobject.h>
+#include <celutil/color.h>
+#include "staticstarrenderer.h"
+
+namespace gl = celestia::gl;
+namespace util = celestia::util;
+
+namespace celestia::render
+{
+
+namespace
+{
+
+// Stars with orbits are drawn from the streamed vertex buffers, since their
+// positions change. They are kept in the static buffer, so that the octree
+// object ranges may be used as vertex ranges, but with a magnitude which
+// never passes the magnitude test of the vertex shader.
+constexpr float HiddenStarMagnitude = 1000.0f;
+
+enum class Pass : int
+{
+    Glare       = 0,
+    Sprites     = 1,
+    BasicPoints = 2,
+    Ids         = 3,
+};
+
+struct StarVertex
+{
+    Eigen::Vector3f position;
+    float absMag;
+    float extinction;
+    unsigned char color[4];
+};
+
+static_assert(sizeof(StarVertex) == 24);
+
+} // end unnamed namespace
+
+StaticStarRenderer::StaticStarRenderer(Renderer &renderer) :
+    m_renderer(renderer)
+{
+}
+
+StaticStarRenderer::~StaticStarRenderer() = default;
+
+void
+StaticStarRenderer::render(const StarDatabase &starDB,
+                           const ColorTemperatureTable &colorTemp,
+                           util::array_view<RangeType> ranges,
+                           const Settings &settings)
+{
+    if (ranges.empty())
+        return;
+
+    auto *prog = useProgram(starDB, colorTemp, settings, m_renderer.getCurrentProjectionMatrix());
+    if (prog == nullptr)
+        return;
+
+    settings.glareTexture->bind();
+    prog->intParam("pass") = static_cast<int>(Pass::Glare);
+    prog->intParam("useTexture") = 1;
+    draw(ranges);
+
+    if (settings.basicPoints)
+    {
+        prog->intParam("pass") = static_cast<int>(Pass::BasicPoints);
+        prog->intParam("useTexture") = 0;
+    }
+    else
+    {
+        settings.starTexture->bind();
+        prog->intParam("pass") = static_cast<int>(Pass::Sprites);
+    }
+    draw(ranges);
+}
+
+void
+StaticStarRenderer::renderIds(const StarDatabase &starDB,
+                              const ColorTemperatureTable &colorTemp,
+                              util::array_view<RangeType> ranges,
+                              const Settings &settings,
+                              const Eigen::Matrix4f &projection)
+{
+    if (ranges.empty() || starDB.size() > MaxIdStars)
+        return;
+
+    auto *prog = useProgram(starDB, colorTemp, settings, projection);
+    if (prog == nullptr)
+        return;
+
+    updateIds();
+    prog->intParam("pass") = static_cast<int>(Pass::Ids);
+    prog->intParam("useTexture") = 0;
+    for (const auto &[first, last] : ranges)
+        m_idVo->draw(static_cast<int>(last - first), static_cast<int>(first));
+}
+
+CelestiaGLProgram *
+StaticStarRenderer::useProgram(const StarDatabase &starDB,
+                               const ColorTemperatureTable &colorTemp,
+                               const Settings &settings,
+                               const Eigen::Matrix4f &projection)
+{
+    auto *prog = m_renderer.getShaderManager().getShader("staticstar");
+    if (prog == nullptr)
+        return nullptr;
+
+    update(starDB, colorTemp);
+    if (m_nStars == 0)
+        return nullptr;
+
+    // Split the observer position into a float and a remainder, so that the
+    // shader can reproduce the double precision subtraction.
+    Eigen::Vector3f obsHigh = settings.obsPosition.cast<float>();
+    Eigen::Vector3f obsLow = (settings.obsPosition - obsHigh.cast<double>()).cast<float>();
+
+    prog->use();
+    prog->setMVPMatrices(projection, m_renderer.getCurrentModelViewMatrix());
+    prog->samplerParam("starTex") = 0;
+    prog->vec3Param("observerHigh") = obsHigh;
+    prog->vec3Param("observerLow") = obsLow;
+    prog->floatParam("faintestMag") = settings.faintestMag;
+    prog->floatParam("limitingMag") = settings.limitingMag;
+    prog->floatParam("brightnessScale") = settings.brightnessScale;
+    prog->floatParam("brightnessBias") = settings.brightnessBias;
+    prog->floatParam("satPoint") = settings.saturationMag;
+    prog->floatParam("baseSize") = settings.baseSize;
+    prog->floatParam("pointScale") = settings.pointScale;
+    prog->floatParam("minDistance") = settings.minDistance;
+    prog->floatParam("maxDistance") = settings.maxDistance;
+    prog->intParam("scaledDiscs") = settings.scaledDiscs ? 1 : 0;
+    return prog;
+}
+
+void
+StaticStarRenderer::update(const StarDatabase &starDB, const ColorTemperatureTable &colorTemp)
+{
+    if (m_bo != nullptr
+        && m_starDB == &starDB
+        && m_nStars == starDB.size()
+        && m_colorTableType == colorTemp.type())
+    {
+        return;
+    }
+
+    m_starDB = &starDB;
+    m_nStars = starDB.size();
+    m_colorTableType = colorTemp.type();
+    m_idVo = nullptr;
+    m_idBo = nullptr;
+
+    std::vector<StarVertex> vertices;
+    vertices.reserve(m_nStars);
+    for (std::uint32_t i = 0; i < m_nStars; ++i)
+    {
+        const Star *star = starDB.getStar(i);
+        StarVertex &vertex = vertices.emplace_back();
+        vertex.position = star->getPosition();
+        vertex.absMag = star->getOrbit() == nullptr ? star->getAbsoluteMagnitude() : HiddenStarMagnitude;
+        vertex.extinction = star->getExtinction();
+        colorTemp.lookupColor(star->getTemperature()).get(vertex.color);
+    }
+
+    if (m_bo == nullptr)
+    {
+        m_bo = std::make_unique<gl::Buffer>();
+        m_vo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
+
+        m_vo->addVertexBuffer(
+            *m_bo,
+            CelestiaGLProgram::VertexCoordAttributeIndex,
+            3,
+            gl::VertexObject::DataType::Float,
+            false,
+            sizeof(StarVertex),
+            offsetof(StarVertex, position));
+        m_vo->addVertexBuffer(
+            *m_bo,
+            CelestiaGLProgram::TextureCoord0AttributeIndex,
+            2,
+            gl::VertexObject::DataType::Float,
+            false,
+            sizeof(StarVertex),
+            offsetof(StarVertex, absMag));
+        m_vo->addVertexBuffer(
+            *m_bo,
+            CelestiaGLProgram::ColorAttributeIndex,
+            4,
+            gl::VertexObject::DataType::UnsignedByte,
+            true,
+            sizeof(StarVertex),
+            offsetof(StarVertex, color));
+    }
+
+    m_bo->setData(vertices, gl::Buffer::BufferUsage::StaticDraw);
+}
+
+void
+StaticStarRenderer::updateIds()
+{
+    if (m_idBo != nullptr)
+        return;
+
+    std::vector<std::array<unsigned char, 4>> ids;
+    ids.reserve(m_nStars);
+    for (std::uint32_t i = 1; i <= m_nStars; ++i)
+    {
+        ids.push_back({ static_cast<unsigned char>(i & 0xff),
+                        static_cast<unsigned char>((i >> 8) & 0xff),
+                        static_cast<unsigned char>((i >> 16) & 0xff),
+                        0 });
+    }
+
+    m_idBo = std::make_unique<gl::Buffer>();
+    m_idBo->setData(ids, gl::Buffer::BufferUsage::StaticDraw);
+
+    m_idVo = std::make_unique<gl::VertexObject>(gl::VertexObject::Primitive::Points);
+    m_idVo->addVertexBuffer(
+        *m_bo,
+        CelestiaGLProgram::VertexCoordAttributeIndex,
+        3,
+        gl::VertexObject::DataType::Float,
+        false,
+        sizeof(StarVertex),
+        offsetof(StarVertex, position));
+    m_idVo->addVertexBuffer(
+        *m_bo,
+        CelestiaGLProgram::TextureCoord0AttributeIndex,
+        2,
+        gl::VertexObject::DataType::Float,
+        false,
+        sizeof(StarVertex),
+        offsetof(StarVertex, absMag));
+    m_idVo->addVertexBuffer(
+        *m_idBo,
+        CelestiaGLProgram::TextureCoord1AttributeIndex,
+        4,
+        gl::VertexObject::DataType::UnsignedByte,
+        true,
+        4,
+        0);
+}
+
+void
+StaticStarRenderer::draw(util::array_view<RangeType> ranges)
+{
+    for (const auto &[first, last] : ranges)
+        m_vo->draw(static_cast<int>(last - first), static_cast<int>(first));
+}
+
+} // namespace celestia::render
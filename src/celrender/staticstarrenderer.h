@@ -0,0 +1,109 @@
+// staticstarrenderer.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <Eigen/Core>
+
+#include <celengine/octree.h>
+#include <celengine/starcolors.h>
+#include <celutil/array_view.h>
+
+class CelestiaGLProgram;
+class Renderer;
+class StarDatabase;
+class Texture;
+
+namespace celestia::gl
+{
+class Buffer;
+class VertexObject;
+} // namespace celestia::gl
+
+namespace celestia::render
+{
+
+// Draws the point stars from a vertex buffer which holds the whole star
+// catalog and is uploaded only once. The magnitude test and the point size
+// computation are done by the vertex shader, so only the object ranges of
+// the visible octree nodes are passed from the CPU each frame. Stars with
+// orbits and stars closer than the solar system distance are excluded, as
+// their positions must be computed on the CPU.
+class StaticStarRenderer
+{
+public:
+    using RangeType = std::pair<engine::OctreeObjectIndex, engine::OctreeObjectIndex>;
+
+    struct Settings
+    {
+        Eigen::Vector3d obsPosition;
+        float faintestMag;
+        float limitingMag;
+        float brightnessScale;
+        float brightnessBias;
+        float saturationMag;
+        float baseSize;
+        float pointScale;
+        float minDistance;
+        float maxDistance;
+        bool scaledDiscs;
+        bool basicPoints;
+        Texture *starTexture;
+        Texture *glareTexture;
+    };
+
+    explicit StaticStarRenderer(Renderer &renderer);
+    ~StaticStarRenderer();
+
+    void render(const StarDatabase &starDB,
+                const ColorTemperatureTable &colorTemp,
+                util::array_view<RangeType> ranges,
+                const Settings &settings);
+
+    // Draw the discs of the stars with their catalog index plus one as the
+    // color, low byte in red, for picking. Where discs overlap the brighter
+    // star is in front, if the depth test is enabled.
+    void renderIds(const StarDatabase &starDB,
+                   const ColorTemperatureTable &colorTemp,
+                   util::array_view<RangeType> ranges,
+                   const Settings &settings,
+                   const Eigen::Matrix4f &projection);
+
+    // Largest catalog size for which renderIds() can draw the star ids
+    static constexpr std::uint32_t MaxIdStars = 0xfffffe;
+
+private:
+    CelestiaGLProgram *useProgram(const StarDatabase &starDB,
+                                  const ColorTemperatureTable &colorTemp,
+                                  const Settings &settings,
+                                  const Eigen::Matrix4f &projection);
+    void update(const StarDatabase &starDB, const ColorTemperatureTable &colorTemp);
+    void updateIds();
+    void draw(util::array_view<RangeType> ranges);
+
+    Renderer &m_renderer;
+
+    // Identity of the catalog in the buffer, rebuilt when any changes
+    const StarDatabase *m_starDB{ nullptr };
+    std::uint32_t m_nStars{ 0 };
+    ColorTableType m_colorTableType{ ColorTableType::Enhanced };
+
+    std::unique_ptr<gl::Buffer> m_bo;
+    std::unique_ptr<gl::VertexObject> m_vo;
+
+    // Star ids, only created once renderIds() is used
+    std::unique_ptr<gl::Buffer> m_idBo;
+    std::unique_ptr<gl::VertexObject> m_idVo;
+};
+
+} // namespace celestia::render
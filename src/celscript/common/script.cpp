@@ -32,4 +32,22 @@ bool IScript::handleTickEvent(double /*dt*/)
     return false;
 }
 
+void IScript::frameFinished(double /*idleTime*/)
+{
+}
+
+void IScriptHook::frameFinished(double /*idleTime*/) const
+{
+}
+
+std::size_t IScript::getMemoryUsage() const
+{
+    return 0;
+}
+
+std::size_t IScriptHook::getMemoryUsage() const
+{
+    return 0;
+}
+
 } // end namespace celestia::scripts
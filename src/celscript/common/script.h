@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
 
 #include <celcompat/filesystem.h>
@@ -28,6 +29,11 @@ class IScript
     virtual bool handleKeyEvent(const char* key);
     virtual bool handleTickEvent(double dt);
     virtual bool tick(double) = 0;
+    // Called after each frame with the time in seconds left before the
+    // next one
+    virtual void frameFinished(double idleTime);
+    // Memory used by the interpreter of the script, if it has one
+    virtual std::size_t getMemoryUsage() const;
 };
 
 class IScriptPlugin
@@ -66,6 +72,8 @@ class IScriptHook
     virtual bool call(const char *method, float x, float y) const = 0;
     virtual bool call(const char *method, float x, float y, int b) const = 0;
     virtual bool call(const char *method, double dt) const = 0;
+    virtual void frameFinished(double idleTime) const;
+    virtual std::size_t getMemoryUsage() const;
 
     CelestiaCore *appCore() const { return m_appCore; }
 
@@ -370,6 +370,42 @@ ParseResult parseSetUrlCommand(const Hash& paramList, const ScriptMaps&)
 }
 
 
+ParseResult parseSaveSceneCommand(const Hash& paramList, const ScriptMaps&)
+{
+    const std::string* name = paramList.getString("name");
+    return name == nullptr
+        ? makeError("Missing name parameter to savescene")
+        : std::make_unique<CommandSaveScene>(*name);
+}
+
+
+ParseResult parseRestoreSceneCommand(const Hash& paramList, const ScriptMaps&)
+{
+    const std::string* name = paramList.getString("name");
+    return name == nullptr
+        ? makeError("Missing name parameter to restorescene")
+        : std::make_unique<CommandRestoreScene>(*name);
+}
+
+
+ParseResult parseProfilerCommand(const Hash& paramList, const ScriptMaps&)
+{
+    auto overlay = paramList.getBoolean("overlay");
+    auto stats = paramList.getBoolean("stats");
+    const std::string* trace = paramList.getString("trace");
+    auto frames = paramList.getNumber<double>("frames").value_or(100.0);
+    if (!overlay.has_value() && !stats.has_value() && trace == nullptr)
+        return makeError("Missing overlay, stats or trace parameter to profiler");
+    if (!(frames >= 1.0))
+        return makeError("Bad number of frames for profiler");
+
+    return std::make_unique<CommandProfiler>(overlay,
+                                             stats,
+                                             trace == nullptr ? std::string{} : *trace,
+                                             static_cast<unsigned int>(frames));
+}
+
+
 ParseResult parseCenterCommand(const Hash& paramList, const ScriptMaps&)
 {
     auto t = paramList.getNumber<double>("time").value_or(1.0);
@@ -849,6 +885,33 @@ ParseResult parsePlayCommand(const Hash& paramList, const ScriptMaps&)
 }
 
 
+ParseResult parsePreloadAudioCommand(const Hash& paramList, const ScriptMaps&)
+{
+#ifdef USE_MINIAUDIO
+    int channel = std::max(paramList.getNumber<int>("channel").value_or(celestia::defaultAudioChannel),
+                           celestia::minAudioChannel);
+    float volume = std::clamp(paramList.getNumber<float>("volume").value_or(celestia::defaultAudioVolume),
+                              celestia::minAudioVolume, celestia::maxAudioVolume);
+    float pan = std::clamp(paramList.getNumber<float>("pan").value_or(celestia::defaultAudioPan),
+                           celestia::minAudioPan, celestia::maxAudioPan);
+    int loop = paramList.getNumber<int>("loop").value_or(0);
+    int nopause = paramList.getNumber<int>("nopause").value_or(0);
+
+    const std::string* filename = paramList.getString("filename");
+    if (filename == nullptr || filename->empty())
+        return makeError("Missing filename parameter to preloadaudio");
+
+    auto path = util::U8FileName(*filename);
+    if (!path.has_value())
+        return makeError("Invalid filename in preloadaudio command");
+
+    return std::make_unique<CommandPreloadAudio>(channel, volume, pan, loop == 1, *path, nopause == 1);
+#else
+    return std::make_unique<CommandNoOp>();
+#endif
+}
+
+
 ParseResult parseOverlayCommand(const Hash& paramList, const ScriptMaps&)
 {
     auto duration = paramList.getNumber<float>("duration").value_or(3.0f);
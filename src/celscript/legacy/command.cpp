@@ -33,6 +33,7 @@
 #include <celmath/mathlib.h>
 #include <celutil/filetype.h>
 #include <celutil/logger.h>
+#include <celutil/memoryreport.h>
 #include <celutil/stringutils.h>
 #include "execenv.h"
 
@@ -173,6 +174,68 @@ void CommandSetUrl::processInstantaneous(ExecutionEnvironment& env)
 }
 
 
+////////////////
+// SaveScene and RestoreScene commands: keep and jump to scenes in memory
+
+CommandSaveScene::CommandSaveScene(std::string _name) :
+    name(std::move(_name))
+{
+}
+
+void CommandSaveScene::processInstantaneous(ExecutionEnvironment& env)
+{
+    env.getCelestiaCore()->saveScene(name);
+}
+
+CommandRestoreScene::CommandRestoreScene(std::string _name) :
+    name(std::move(_name))
+{
+}
+
+void CommandRestoreScene::processInstantaneous(ExecutionEnvironment& env)
+{
+    env.getCelestiaCore()->restoreScene(name);
+}
+
+CommandProfiler::CommandProfiler(std::optional<bool> _overlay,
+                                 std::optional<bool> _stats,
+                                 std::string _traceFile,
+                                 unsigned int _frames) :
+    overlay(_overlay),
+    stats(_stats),
+    traceFile(std::move(_traceFile)),
+    frames(_frames)
+{
+}
+
+bool CommandProfiler::writesFiles() const
+{
+    return !traceFile.empty();
+}
+
+void CommandProfiler::processInstantaneous(ExecutionEnvironment& env)
+{
+    CelestiaCore* appCore = env.getCelestiaCore();
+    if (overlay.has_value())
+        appCore->setProfilerOverlay(*overlay);
+    if (stats.has_value())
+        appCore->setRenderStatsOverlay(*stats);
+    if (!traceFile.empty() && !appCore->startFrameTrace(fs::u8path(traceFile), frames))
+        GetLogger()->error("Unable to start a frame trace to {}\n", traceFile);
+}
+
+
+////////////////
+// Memory report command: log the memory used by each subsystem
+
+void CommandMemoryReport::processInstantaneous(ExecutionEnvironment& env)
+{
+    celestia::util::MemoryReport report;
+    env.getCelestiaCore()->reportMemoryUsage(report);
+    GetLogger()->info("{}", report.format());
+}
+
+
 ////////////////
 // Center command: go to the selected body
 
@@ -678,6 +741,11 @@ CommandCapture::CommandCapture(std::string _type, fs::path _filename)
 {
 }
 
+bool CommandCapture::writesFiles() const
+{
+    return true;
+}
+
 void CommandCapture::processInstantaneous(ExecutionEnvironment& env)
 {
     ContentType _type = ContentType::Unknown;
@@ -689,7 +757,7 @@ void CommandCapture::processInstantaneous(ExecutionEnvironment& env)
     else if (type == "avif")
         _type = ContentType::AVIF;
 #endif
-    env.getCelestiaCore()->saveScreenShot(filename, _type);
+    env.getCelestiaCore()->saveScreenShotAsync(filename, _type);
 }
 
 
@@ -912,6 +980,27 @@ void CommandPlay::processInstantaneous(ExecutionEnvironment& env)
                            loop.value_or(false),
                            nopause);
 }
+
+// PreloadAudio command
+CommandPreloadAudio::CommandPreloadAudio(int channel,
+                                         float volume,
+                                         float pan,
+                                         bool loop,
+                                         const fs::path &filename,
+                                         bool nopause) :
+    channel(channel),
+    volume(volume),
+    pan(pan),
+    loop(loop),
+    filename(filename),
+    nopause(nopause)
+{
+}
+
+void CommandPreloadAudio::processInstantaneous(ExecutionEnvironment& env)
+{
+    env.getCelestiaCore()->preloadAudio(channel, filename, volume, pan, loop, nopause);
+}
 #endif
 
 // ScriptImage command
@@ -43,6 +43,9 @@ class Command
 
     virtual void process(ExecutionEnvironment&, double t, double dt) = 0;
     virtual double getDuration() const = 0;
+
+    // Return true if the command writes to a file named by the script
+    virtual bool writesFiles() const { return false; }
 };
 
 using CommandSequence = std::vector<std::unique_ptr<Command>>;
@@ -167,6 +170,54 @@ class CommandSetUrl : public InstantaneousCommand
     std::string url;
 };
 
+class CommandSaveScene : public InstantaneousCommand
+{
+ public:
+    CommandSaveScene(std::string);
+
+ protected:
+    void processInstantaneous(ExecutionEnvironment&) override;
+
+ private:
+    std::string name;
+};
+
+class CommandRestoreScene : public InstantaneousCommand
+{
+ public:
+    CommandRestoreScene(std::string);
+
+ protected:
+    void processInstantaneous(ExecutionEnvironment&) override;
+
+ private:
+    std::string name;
+};
+
+class CommandProfiler : public InstantaneousCommand
+{
+ public:
+    CommandProfiler(std::optional<bool>, std::optional<bool>, std::string, unsigned int);
+
+    bool writesFiles() const override;
+
+ protected:
+    void processInstantaneous(ExecutionEnvironment&) override;
+
+ private:
+    std::optional<bool> overlay;
+    std::optional<bool> stats;
+    std::string traceFile;
+    unsigned int frames;
+};
+
+
+class CommandMemoryReport : public InstantaneousCommand
+{
+ protected:
+    void processInstantaneous(ExecutionEnvironment&) override;
+};
+
 
 class CommandCenter : public InstantaneousCommand
 {
@@ -605,6 +656,8 @@ class CommandCapture : public InstantaneousCommand
  public:
     CommandCapture(std::string, fs::path);
 
+    bool writesFiles() const override;
+
  protected:
     void processInstantaneous(ExecutionEnvironment&) override;
 
@@ -752,6 +805,28 @@ class CommandPlay : public InstantaneousCommand
     std::optional<fs::path> filename;
     bool nopause;
 };
+
+class CommandPreloadAudio : public InstantaneousCommand
+{
+ public:
+    CommandPreloadAudio(int channel,
+                        float volume,
+                        float pan,
+                        bool loop,
+                        const fs::path &filename,
+                        bool nopause);
+
+ protected:
+    void processInstantaneous(ExecutionEnvironment&) override;
+
+ private:
+    int channel;
+    float volume;
+    float pan;
+    bool loop;
+    fs::path filename;
+    bool nopause;
+};
 #endif
 
 class CommandScriptImage : public InstantaneousCommand
@@ -9,8 +9,13 @@
 
 #include "legacyscript.h"
 
+#include <cstddef>
 #include <fstream>
 #include <istream>
+#include <iterator>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
 
 #include <celestia/celestiacore.h>
 #include <celutil/gettext.h>
@@ -60,8 +65,49 @@ public:
     }
 };
 
+std::shared_ptr<const CommandSequence>
+parseScript(std::istream& scriptfile, const ScriptMaps& scriptMaps, std::string& errorMsg)
+{
+    CommandParser parser(scriptfile, scriptMaps);
+    CommandSequence script = parser.parse();
+    if (script.empty())
+    {
+        auto errors = parser.getErrors();
+        if (!errors.empty())
+            errorMsg = errors[0];
+        return nullptr;
+    }
+    return std::make_shared<const CommandSequence>(std::move(script));
+}
+
 } // end unnamed namespace
 
+// The parsed command sequences of the scripts which have been run, keyed by
+// the text of the script so that a file which is changed is parsed again.
+class CommandCache
+{
+ public:
+    std::shared_ptr<const CommandSequence> find(const std::string& text) const
+    {
+        auto it = entries.find(text);
+        return it == entries.end() ? nullptr : it->second;
+    }
+
+    void add(std::string&& text, const std::shared_ptr<const CommandSequence>& script)
+    {
+        // Scripts are small, so rather than tracking their use drop them
+        // all when the cache is full
+        if (entries.size() >= MaxEntries)
+            entries.clear();
+        entries.try_emplace(std::move(text), script);
+    }
+
+ private:
+    static constexpr std::size_t MaxEntries = 256;
+
+    std::unordered_map<std::string, std::shared_ptr<const CommandSequence>> entries;
+};
+
 LegacyScript::LegacyScript(CelestiaCore *core) :
     m_appCore(core),
     m_execEnv(std::make_unique<CoreExecutionEnvironment>(*core))
@@ -70,15 +116,10 @@ LegacyScript::LegacyScript(CelestiaCore *core) :
 
 bool LegacyScript::load(std::istream &scriptfile, const fs::path &/*path*/, std::string &errorMsg)
 {
-    CommandParser parser(scriptfile, m_appCore->scriptMaps());
-    CommandSequence script = parser.parse();
-    if (script.empty())
-    {
-        auto errors = parser.getErrors();
-        if (!errors.empty())
-            errorMsg = errors[0];
+    auto script = parseScript(scriptfile, m_appCore->scriptMaps(), errorMsg);
+    if (script == nullptr)
         return false;
-    }
+
     m_runningScript = std::make_unique<Execution>(std::move(script), *m_execEnv);
     return true;
 }
@@ -88,6 +129,14 @@ bool LegacyScript::tick(double dt)
     return m_runningScript->tick(dt);
 }
 
+LegacyScriptPlugin::LegacyScriptPlugin(CelestiaCore *appCore) :
+    IScriptPlugin(appCore),
+    m_commandCache(std::make_unique<CommandCache>())
+{
+}
+
+LegacyScriptPlugin::~LegacyScriptPlugin() = default;
+
 bool LegacyScriptPlugin::isOurFile(const fs::path &p) const
 {
     return p.extension() == ".cel";
@@ -102,15 +151,25 @@ std::unique_ptr<IScript> LegacyScriptPlugin::loadScript(const fs::path &path)
         return nullptr;
     }
 
-    auto script = std::make_unique<LegacyScript>(appCore());
-    std::string errorMsg;
-    if (!script->load(scriptfile, path, errorMsg))
+    std::string text(std::istreambuf_iterator<char>(scriptfile), {});
+    auto commands = m_commandCache->find(text);
+    if (commands == nullptr)
     {
-        if (errorMsg.empty())
-            errorMsg = _("Unknown error loading script");
-        appCore()->fatalError(errorMsg);
-        return nullptr;
+        std::istringstream in(text);
+        std::string errorMsg;
+        commands = parseScript(in, appCore()->scriptMaps(), errorMsg);
+        if (commands == nullptr)
+        {
+            if (errorMsg.empty())
+                errorMsg = _("Unknown error loading script");
+            appCore()->fatalError(errorMsg);
+            return nullptr;
+        }
+        m_commandCache->add(std::move(text), commands);
     }
+
+    auto script = std::make_unique<LegacyScript>(appCore());
+    script->m_runningScript = std::make_unique<Execution>(std::move(commands), *script->m_execEnv);
     return script;
 }
 
@@ -22,6 +22,7 @@ class CelestiaCore;
 namespace celestia::scripts
 {
 
+class CommandCache;
 class Execution;
 class ExecutionEnvironment;
 
@@ -47,8 +48,8 @@ class LegacyScriptPlugin : public IScriptPlugin
 {
  public:
     LegacyScriptPlugin() = delete;
-    LegacyScriptPlugin(CelestiaCore *appCore) : IScriptPlugin(appCore) {};
-    ~LegacyScriptPlugin() override = default;
+    LegacyScriptPlugin(CelestiaCore *appCore);
+    ~LegacyScriptPlugin() override;
     LegacyScriptPlugin(const LegacyScriptPlugin&) = delete;
     LegacyScriptPlugin(LegacyScriptPlugin&&) = delete;
     LegacyScriptPlugin& operator=(const LegacyScriptPlugin&) = delete;
@@ -56,6 +57,10 @@ class LegacyScriptPlugin : public IScriptPlugin
 
     bool isOurFile(const fs::path&) const override;
     std::unique_ptr<IScript> loadScript(const fs::path&) override;
+
+ private:
+    // Parsed scripts, so that running a script again doesn't parse it again
+    std::unique_ptr<CommandCache> m_commandCache;
 };
 
 } // end namespace celestia::scripts
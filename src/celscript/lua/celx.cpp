@@ -30,6 +30,7 @@
 #include <celutil/logger.h>
 #include <celutil/stringutils.h>
 #include <celestia/celestiacore.h>
+#include <celestia/configfile.h>
 #include <celestia/hud.h>
 #include <celestia/url.h>
 #include <celestia/viewmanager.h>
@@ -75,6 +76,9 @@ static constexpr std::array CelxClassNames
 // returning control to celestia
 static const double MaxTimeslice = 5.0;
 
+// Size of the garbage collection steps run between frames
+static const int GCStepSize = 16;
+
 // names of callback-functions in Lua:
 const char* KbdCallback = "celestia_keyboard_callback";
 const char* CleanupCallback = "celestia_cleanup_callback";
@@ -113,6 +117,17 @@ static void openLuaLibrary(lua_State* l,
 #endif
 }
 
+// Open the LuaJIT FFI library as the global ffi. As it can call any C
+// function, it's only opened together with the io and os libraries.
+static void openFFILibrary([[maybe_unused]] lua_State* l)
+{
+#ifdef LUAJIT_VERSION
+    lua_pushcfunction(l, luaopen_ffi);
+    lua_call(l, 0, 1);
+    lua_setglobal(l, LUA_FFILIBNAME);
+#endif
+}
+
 // Push a class name onto the Lua stack
 void PushClass(lua_State* l, int id)
 {
@@ -260,6 +275,14 @@ static void checkTimeslice(lua_State* l, lua_Debug* /*ar*/)
         return;
     }
 
+    // A tick hook running as a coroutine is suspended when its time in the
+    // frame is used up, and resumed in the next frame
+    if (luastate->hookSliceExpired(l))
+    {
+        lua_yield(l, 0);
+        return;
+    }
+
     if (luastate->timesliceExpired())
     {
         const char* errormsg = "Timeout: script hasn't returned control to celestia (forgot to call wait()?)";
@@ -353,6 +376,16 @@ bool LuaState::timesliceExpired()
 }
 
 
+bool LuaState::hookSliceExpired([[maybe_unused]] lua_State* l) const
+{
+#if LUA_VERSION_NUM >= 503
+    return l == hookThread && hookSliceEnd < getTime() && lua_isyieldable(l);
+#else
+    return false;
+#endif
+}
+
+
 static int resumeLuaThread(lua_State *L, lua_State *co, int narg)
 {
     int status, nres;
@@ -436,6 +469,7 @@ bool LuaState::charEntered(const char* c_p)
             openLuaLibrary(costate, LUA_LOADLIBNAME, luaopen_package);
             openLuaLibrary(costate, LUA_IOLIBNAME, luaopen_io);
             openLuaLibrary(costate, LUA_OSLIBNAME, luaopen_os);
+            openFFILibrary(costate);
             ioMode = IOMode::Allowed;
         }
         else
@@ -800,10 +834,16 @@ bool LuaState::tick(double dt)
         return false;
     }
 
-    if (dt == 0 || scriptAwakenTime > getTime())
+    // Delays passed to wait() count the time steps of the simulation, so
+    // that they follow a fixed time step and stop while the script is
+    // paused, like those of CEL scripts
+    scriptTime += dt;
+    if (dt == 0 || scriptAwakenTime > scriptTime)
         return false;
 
+    double resumeStart = getTime();
     int nArgs = resume();
+    frameScriptTime += getTime() - resumeStart;
     if (!isAlive()) // The script is complete
         return true;
 
@@ -817,7 +857,7 @@ bool LuaState::tick(double dt)
         delay = lua_tonumber(state, -1);
     else
         delay = 0.0;
-    scriptAwakenTime = getTime() + delay;
+    scriptAwakenTime = scriptTime + delay;
 
     // Clean up the stack
     lua_pop(state, nArgs);
@@ -825,6 +865,64 @@ bool LuaState::tick(double dt)
 }
 
 
+// Run the script until it is complete, without waiting for the delays
+// passed to wait(). Used for the Lua hook, whose methods can't be called
+// before its initialization is finished.
+void LuaState::runToCompletion()
+{
+    while (isAlive() && lua_tothread(state, -1) == costate)
+    {
+        int nArgs = resume();
+        if (isAlive())
+            lua_pop(state, nArgs);
+    }
+}
+
+
+void LuaState::frameFinished(double idleTime)
+{
+    stats.scriptTime = frameScriptTime;
+    frameScriptTime = 0.0;
+    stats.gcTime = 0.0;
+    if (idleTime <= 0.0)
+        return;
+
+    // Run incremental collector steps until the idle time is spent or a
+    // cycle is finished, so that less of the collection work is left for
+    // the script calls of the next frame. In generational mode each step
+    // is a whole minor collection, so only one is run.
+    double start = getTime();
+    double end = start + idleTime;
+    do
+    {
+        ++stats.gcSteps;
+        if (lua_gc(state, LUA_GCSTEP, GCStepSize) != 0)
+        {
+            ++stats.gcCycles;
+            break;
+        }
+    }
+    while (!generationalGC && getTime() < end);
+    stats.gcTime = getTime() - start;
+}
+
+
+const LuaState::Stats& LuaState::getStats() const
+{
+    return stats;
+}
+
+std::size_t LuaState::getMemoryUsage() const
+{
+    lua_State* state = getState();
+    if (state == nullptr)
+        return 0;
+
+    return static_cast<std::size_t>(lua_gc(state, LUA_GCCOUNT, 0)) * 1024 +
+           static_cast<std::size_t>(lua_gc(state, LUA_GCCOUNTB, 0));
+}
+
+
 void LuaState::requestIO()
 {
     // the script requested IO, set the mode
@@ -842,6 +940,7 @@ void LuaState::requestIO()
             openLuaLibrary(costate, LUA_LOADLIBNAME, luaopen_package);
             openLuaLibrary(costate, LUA_IOLIBNAME, luaopen_io);
             openLuaLibrary(costate, LUA_OSLIBNAME, luaopen_os);
+            openFFILibrary(costate);
             ioMode = IOMode::Allowed;
             break;
         case CelestiaCore::ScriptSystemAccessPolicy::Deny:
@@ -1078,6 +1177,20 @@ bool LuaState::init(CelestiaCore* appCore)
         return false;
     }
 
+    if (const CelestiaConfig* config = appCore->getConfig(); config != nullptr)
+    {
+#if LUA_VERSION_NUM >= 504
+        if (config->scriptGenerationalGC)
+        {
+            lua_gc(state, LUA_GCGEN, 0, 0);
+            generationalGC = true;
+        }
+#endif
+#if LUA_VERSION_NUM >= 503
+        hookTimeBudget = static_cast<double>(config->scriptHookTimeBudget) * 0.001;
+#endif
+    }
+
     lua_pushnumber(state, celestia::astro::KM_PER_LY<lua_Number>/1e6);
     lua_setglobal(state, "KM_PER_MICROLY");
 
@@ -1362,6 +1475,9 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
     if (!eventHandlerEnabled)
         return false;
 
+    if (hookTimeBudget > 0.0)
+        return resumeTickHook(obj, method, dt);
+
     lua_pushlightuserdata(costate, obj);
     lua_gettable(costate, LUA_REGISTRYINDEX);
     if (!lua_istable(costate, -1))
@@ -1379,7 +1495,8 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
         lua_remove(costate, -3);             // remove the Lua object from the stack
         lua_pushnumber(costate, dt);
 
-        timeout = getTime() + 1.0;
+        double callStart = getTime();
+        timeout = callStart + 1.0;
         if (lua_pcall(costate, 2, 1, 0) != 0)
         {
             GetLogger()->error("Error while executing Lua Hook: {}\n",
@@ -1389,6 +1506,7 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
         {
            handled = lua_toboolean(costate, -1) == 1;
         }
+        frameScriptTime += getTime() - callStart;
         lua_pop(costate, 1);             // pop the return value
     }
     else
@@ -1400,6 +1518,80 @@ bool LuaState::callLuaHook(void* obj, const char* method, double dt)
 }
 
 
+// Run a tick hook in a coroutine of its own which yields when the hook time
+// budget of the frame is used up. A call which hasn't finished is resumed
+// by the following ticks instead of starting a new one, so their time steps
+// are dropped.
+bool LuaState::resumeTickHook([[maybe_unused]] void* obj,
+                              [[maybe_unused]] const char* method,
+                              [[maybe_unused]] double dt)
+{
+#if LUA_VERSION_NUM >= 503
+    int nArgs = 0;
+    if (hookThread == nullptr)
+    {
+        lua_pushlightuserdata(costate, obj);
+        lua_gettable(costate, LUA_REGISTRYINDEX);
+        if (!lua_istable(costate, -1))
+        {
+            lua_pop(costate, 1);
+            return false;
+        }
+
+        lua_pushstring(costate, method);
+        lua_gettable(costate, -2);
+        if (!lua_isfunction(costate, -1))
+        {
+            lua_pop(costate, 2);
+            return false;
+        }
+
+        hookThread = lua_newthread(costate);
+        hookThreadRef = luaL_ref(costate, LUA_REGISTRYINDEX); // keep the thread alive
+        lua_sethook(hookThread, checkTimeslice, LUA_MASKCOUNT, 1000);
+
+        lua_insert(costate, -2);             // the Lua object after the method
+        lua_pushnumber(costate, dt);
+        lua_xmove(costate, hookThread, 3);
+        nArgs = 2;
+    }
+
+    double callStart = getTime();
+    hookSliceEnd = callStart + hookTimeBudget;
+    timeout = callStart + 1.0;
+#if LUA_VERSION_NUM >= 504
+    int nResults = 0;
+    int status = lua_resume(hookThread, costate, nArgs, &nResults);
+#else
+    int status = lua_resume(hookThread, costate, nArgs);
+#endif
+    frameScriptTime += getTime() - callStart;
+    if (status == LUA_YIELD)
+    {
+        lua_settop(hookThread, 0);
+        return false;
+    }
+
+    bool handled = false;
+    if (status == LUA_OK)
+    {
+        handled = lua_gettop(hookThread) > 0 && lua_toboolean(hookThread, 1) == 1;
+    }
+    else
+    {
+        GetLogger()->error("Error while executing Lua Hook: {}\n",
+                           lua_tostring(hookThread, -1));
+    }
+
+    luaL_unref(costate, LUA_REGISTRYINDEX, hookThreadRef);
+    hookThread = nullptr;
+    return handled;
+#else
+    return false;
+#endif
+}
+
+
 /**** Implementation of Celx LuaState wrapper ****/
 
 bool CelxLua::isValid(int i) const
@@ -11,6 +11,8 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 #include <vector>
@@ -53,9 +55,11 @@ public:
     bool createThread();
     int resume();
     bool tick(double);
+    void runToCompletion();
     void cleanup();
     bool isAlive() const;
     bool timesliceExpired();
+    bool hookSliceExpired(lua_State*) const;
     void requestIO();
 
     bool charEntered(const char*);
@@ -79,6 +83,23 @@ public:
     bool callLuaHook(void* obj, const char* method, float x, float y, int b);
     bool callLuaHook(void* obj, const char* method, double dt);
 
+    // Time spent in the script and in the garbage collection steps run
+    // between frames, in seconds
+    struct Stats
+    {
+        double scriptTime{ 0.0 };
+        double gcTime{ 0.0 };
+        std::uint64_t gcSteps{ 0 };
+        std::uint64_t gcCycles{ 0 };
+    };
+
+    // Called after a frame is drawn; idleTime is the time in seconds left
+    // for garbage collection steps before the next frame.
+    void frameFinished(double idleTime);
+    const Stats& getStats() const;
+    // Size of the Lua heap in bytes
+    std::size_t getMemoryUsage() const;
+
     enum class IOMode
     {
         NotDetermined  = 1,
@@ -92,9 +113,21 @@ private:
     lua_State* costate{ nullptr }; // coroutine stack
     bool alive{ false };
     Timer* timer;
+    double scriptTime{ 0.0 };
     double scriptAwakenTime{ 0.0 };
     IOMode ioMode{ IOMode::NotDetermined };
     bool eventHandlerEnabled{ false };
+    bool generationalGC{ false };
+    double frameScriptTime{ 0.0 };
+    Stats stats;
+
+    // Suspended call of the tick hook and the end of its time in the
+    // current frame
+    bool resumeTickHook(void* obj, const char* method, double dt);
+    double hookTimeBudget{ 0.0 };
+    lua_State* hookThread{ nullptr };
+    int hookThreadRef{ 0 };
+    double hookSliceEnd{ 0.0 };
 };
 
 celestia::View* getViewByObserver(const CelestiaCore*, const Observer*);
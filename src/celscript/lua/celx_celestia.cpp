@@ -10,9 +10,13 @@
 // of the License, or (at your option) any later version.
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <string_view>
+#include <vector>
 
 #include <fmt/format.h>
 
@@ -29,10 +33,12 @@
 #include <celttf/truetypefont.h>
 #include <celutil/gettext.h>
 #include <celutil/logger.h>
+#include <celutil/memoryreport.h>
 #include <celutil/stringutils.h>
 #include "celx.h"
 #include "celx_internal.h"
 #include "celx_celestia.h"
+#include "celx_ffi.h"
 #include "celx_frame.h"
 #include "celx_misc.h"
 #include "celx_observer.h"
@@ -346,6 +352,66 @@ static int celestia_getrenderflags(lua_State* l)
     return 1;
 }
 
+// Counters of the render statistics of the last frame drawn
+static int celestia_getrenderstats(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 1, "No arguments expected for celestia:getrenderstats()");
+    CelestiaCore* appCore = this_celestia(l);
+    lua_newtable(l);
+    appCore->getRenderer()->getRenderStats().forEach([l](std::string_view name, std::uint64_t value)
+    {
+        lua_pushlstring(l, name.data(), name.size());
+        lua_pushnumber(l, static_cast<lua_Number>(value));
+        lua_settable(l, -3);
+    });
+    return 1;
+}
+
+// Returns a table with the total in bytes, the formatted report, and arrays
+// of the entries and duplicates of the report
+static int celestia_getmemoryreport(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 1, "No arguments expected for celestia:getmemoryreport()");
+    CelxLua celx(l);
+    CelestiaCore* appCore = this_celestia(l);
+
+    celestia::util::MemoryReport report;
+    appCore->reportMemoryUsage(report);
+
+    lua_newtable(l);
+    celx.setTable("total", static_cast<lua_Number>(report.total()));
+    celx.setTable("text", report.format().c_str());
+
+    lua_pushstring(l, "entries");
+    lua_newtable(l);
+    int index = 1;
+    for (const auto& entry : report.entries())
+    {
+        lua_newtable(l);
+        celx.setTable("subsystem", entry.subsystem.c_str());
+        celx.setTable("item", entry.item.c_str());
+        celx.setTable("bytes", static_cast<lua_Number>(entry.bytes));
+        celx.setTable("count", static_cast<lua_Number>(entry.count));
+        lua_rawseti(l, -2, index++);
+    }
+    lua_settable(l, -3);
+
+    lua_pushstring(l, "duplicates");
+    lua_newtable(l);
+    index = 1;
+    for (const auto& duplicate : report.duplicates())
+    {
+        lua_newtable(l);
+        celx.setTable("subsystem", duplicate.subsystem.c_str());
+        celx.setTable("description", duplicate.description.c_str());
+        celx.setTable("bytes", static_cast<lua_Number>(duplicate.bytes));
+        lua_rawseti(l, -2, index++);
+    }
+    lua_settable(l, -3);
+
+    return 1;
+}
+
 int celestia_getscreendimension(lua_State* l)
 {
     Celx_CheckArgs(l, 1, 1, "No arguments expected for celestia:getscreendimension()");
@@ -1476,7 +1542,8 @@ static int celestia_getdsocount(lua_State* l)
 
     CelestiaCore* appCore = this_celestia(l);
     Universe* u = appCore->getSimulation()->getUniverse();
-    lua_pushnumber(l, u->getDSOCatalog()->size());
+    const DSODatabase* dsoCatalog = u->getDSOCatalog();
+    lua_pushnumber(l, dsoCatalog == nullptr ? 0 : dsoCatalog->size());
 
     return 1;
 }
@@ -1526,6 +1593,325 @@ static int celestia_dsos(lua_State* l)
     return 1;
 }
 
+namespace
+{
+
+// Filter of the bulk object queries, read from an optional table argument
+// with the fields brighterthan (apparent magnitude from the active
+// observer), within (distance from the active observer in light years),
+// max (number of objects) and, for deep sky objects, type.
+struct ObjectQuery
+{
+    float brighterThan{ std::numeric_limits<float>::infinity() };
+    float within{ std::numeric_limits<float>::infinity() };
+    std::size_t maxCount{ std::numeric_limits<std::size_t>::max() };
+    unsigned int dsoTypeMask{ ~0u };
+};
+
+constexpr unsigned int
+dsoTypeBit(DeepSkyObjectType dsoType)
+{
+    return 1u << static_cast<unsigned int>(dsoType);
+}
+
+lua_Number
+getQueryNumber(lua_State* l, int index, const char* field, lua_Number defaultValue)
+{
+    lua_getfield(l, index, field);
+    lua_Number value = defaultValue;
+    if (lua_isnumber(l, -1))
+        value = lua_tonumber(l, -1);
+    else if (!lua_isnil(l, -1))
+        Celx_DoError(l, "Numeric field expected in object query");
+    lua_pop(l, 1);
+    return value;
+}
+
+void
+readObjectQuery(lua_State* l, int index, ObjectQuery& query)
+{
+    if (lua_isnoneornil(l, index))
+        return;
+    if (!lua_istable(l, index))
+    {
+        Celx_DoError(l, "Object query must be a table");
+        return;
+    }
+
+    query.brighterThan = static_cast<float>(getQueryNumber(l, index, "brighterthan", query.brighterThan));
+    query.within = static_cast<float>(getQueryNumber(l, index, "within", query.within));
+    if (lua_Number maxCount = getQueryNumber(l, index, "max", -1.0); maxCount >= 0.0)
+        query.maxCount = static_cast<std::size_t>(maxCount);
+
+    lua_getfield(l, index, "type");
+    if (lua_isstring(l, -1))
+    {
+        std::string_view typeName = lua_tostring(l, -1);
+        if (typeName == "galaxy"sv)
+            query.dsoTypeMask = dsoTypeBit(DeepSkyObjectType::Galaxy);
+        else if (typeName == "globular"sv)
+            query.dsoTypeMask = dsoTypeBit(DeepSkyObjectType::Globular);
+        else if (typeName == "nebula"sv)
+            query.dsoTypeMask = dsoTypeBit(DeepSkyObjectType::Nebula);
+        else if (typeName == "opencluster"sv)
+            query.dsoTypeMask = dsoTypeBit(DeepSkyObjectType::OpenCluster);
+        else
+            Celx_DoError(l, "Unknown deep sky object type in object query");
+    }
+    else if (!lua_isnil(l, -1))
+    {
+        Celx_DoError(l, "Deep sky object type in object query must be a string");
+    }
+    lua_pop(l, 1);
+}
+
+class StarQueryHandler : public engine::StarHandler
+{
+public:
+    StarQueryHandler(const ObjectQuery& _query, std::vector<Selection>& _result) :
+        query(_query), result(_result)
+    {
+    }
+
+    void process(const Star& star, float distance, float appMag) override
+    {
+        if (result.size() < query.maxCount &&
+            distance <= query.within &&
+            appMag < query.brighterThan &&
+            star.getVisibility())
+        {
+            result.emplace_back(const_cast<Star*>(&star));
+        }
+    }
+
+private:
+    const ObjectQuery& query;
+    std::vector<Selection>& result;
+};
+
+class DSOQueryHandler : public engine::DSOHandler
+{
+public:
+    DSOQueryHandler(const ObjectQuery& _query, std::vector<Selection>& _result) :
+        query(_query), result(_result)
+    {
+    }
+
+    void process(const std::unique_ptr<DeepSkyObject>& dso, double distance, float appMag) override
+    {
+        add(*dso, distance, appMag);
+    }
+
+    void add(const DeepSkyObject& dso, double distance, float appMag)
+    {
+        if (result.size() < query.maxCount &&
+            distance <= query.within &&
+            appMag < query.brighterThan &&
+            (query.dsoTypeMask & dsoTypeBit(dso.getObjType())) != 0 &&
+            dso.isVisible())
+        {
+            result.emplace_back(const_cast<DeepSkyObject*>(&dso));
+        }
+    }
+
+private:
+    const ObjectQuery& query;
+    std::vector<Selection>& result;
+};
+
+// Find the stars matching the query; a distance limit is searched in the
+// octree instead of testing every star.
+void
+findStars(const Universe& universe,
+          const Eigen::Vector3d& obsPosition,
+          const ObjectQuery& query,
+          std::vector<Selection>& result)
+{
+    const StarDatabase* stars = universe.getStarCatalog();
+    if (stars == nullptr)
+        return;
+
+    StarQueryHandler handler(query, result);
+    if (std::isfinite(query.within))
+    {
+        stars->findCloseStars(handler, obsPosition.cast<float>(), query.within);
+        return;
+    }
+
+    for (std::uint32_t i = 0, nStars = stars->size(); i < nStars && result.size() < query.maxCount; ++i)
+    {
+        const Star* star = stars->getStar(i);
+        auto distance = static_cast<float>((star->getPosition().cast<double>() - obsPosition).norm());
+        handler.process(*star, distance, star->getApparentMagnitude(distance));
+    }
+}
+
+void
+findDSOs(const Universe& universe,
+         const Eigen::Vector3d& obsPosition,
+         const ObjectQuery& query,
+         std::vector<Selection>& result)
+{
+    const DSODatabase* dsos = universe.getDSOCatalog();
+    if (dsos == nullptr)
+        return;
+
+    DSOQueryHandler handler(query, result);
+    if (std::isfinite(query.within))
+    {
+        dsos->findCloseDSOs(handler, obsPosition, query.within);
+        return;
+    }
+
+    for (std::uint32_t i = 0, nDSOs = dsos->size(); i < nDSOs && result.size() < query.maxCount; ++i)
+    {
+        const DeepSkyObject* dso = dsos->getDSO(i);
+        double distance = (dso->getPosition() - obsPosition).norm();
+        handler.add(*dso, distance, astro::absToAppMag(dso->getAbsoluteMagnitude(),
+                                                      static_cast<float>(distance)));
+    }
+}
+
+// Push a table of the catalog numbers of the objects
+void
+pushCatalogNumbers(lua_State* l, const std::vector<Selection>& objects)
+{
+    lua_createtable(l, static_cast<int>(objects.size()), 0);
+    int i = 1;
+    for (const Selection& sel : objects)
+    {
+        AstroCatalog::IndexNumber catalogNumber = sel.getType() == SelectionType::Star
+            ? sel.star()->getIndex()
+            : sel.deepsky()->getIndex();
+        lua_pushnumber(l, static_cast<lua_Number>(catalogNumber));
+        lua_rawseti(l, -2, i++);
+    }
+}
+
+// Mark the objects with the marker given by the arguments from index on:
+// color, symbol and size, as for object:mark()
+void
+markObjects(lua_State* l, int index, Universe& universe, const std::vector<Selection>& objects)
+{
+    Color markColor(0.0f, 1.0f, 0.0f);
+    if (const char* colorString = Celx_SafeGetString(l, index, WrongType, "Marker color must be a string");
+        colorString != nullptr)
+    {
+        Color::parse(colorString, markColor);
+    }
+
+    auto markSymbol = celestia::MarkerRepresentation::Diamond;
+    if (const char* markerString = Celx_SafeGetString(l, index + 1, WrongType, "Marker symbol must be a string");
+        markerString != nullptr)
+    {
+        markSymbol = parseMarkerSymbol(markerString);
+    }
+
+    auto markSize = static_cast<float>(Celx_SafeGetNumber(l, index + 2, WrongType, "Marker size must be a number", 10.0));
+
+    celestia::MarkerRepresentation markerRep(markSymbol);
+    markerRep.setSize(std::clamp(markSize, 1.0f, 10000.0f));
+    markerRep.setColor(Color(markColor, 0.9f));
+    universe.markObjects(objects, markerRep, 1);
+}
+
+} // end unnamed namespace
+
+
+static int celestia_findstars(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 2, "Zero or one argument expected to function celestia:findstars");
+
+    CelestiaCore* appCore = this_celestia(l);
+    ObjectQuery query;
+    readObjectQuery(l, 2, query);
+
+    Simulation* sim = appCore->getSimulation();
+    std::vector<Selection> stars;
+    findStars(*sim->getUniverse(), sim->getActiveObserver()->getPosition().toLy(), query, stars);
+    pushCatalogNumbers(l, stars);
+
+    return 1;
+}
+
+
+static int celestia_finddsos(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 2, "Zero or one argument expected to function celestia:finddsos");
+
+    CelestiaCore* appCore = this_celestia(l);
+    ObjectQuery query;
+    readObjectQuery(l, 2, query);
+
+    Simulation* sim = appCore->getSimulation();
+    std::vector<Selection> dsos;
+    findDSOs(*sim->getUniverse(), sim->getActiveObserver()->getPosition().toLy(), query, dsos);
+    pushCatalogNumbers(l, dsos);
+
+    return 1;
+}
+
+
+static int celestia_markstars(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 5, "Zero to four arguments expected to function celestia:markstars");
+
+    CelestiaCore* appCore = this_celestia(l);
+    ObjectQuery query;
+    readObjectQuery(l, 2, query);
+
+    Simulation* sim = appCore->getSimulation();
+    std::vector<Selection> stars;
+    findStars(*sim->getUniverse(), sim->getActiveObserver()->getPosition().toLy(), query, stars);
+    markObjects(l, 3, *sim->getUniverse(), stars);
+    lua_pushnumber(l, static_cast<lua_Number>(stars.size()));
+
+    return 1;
+}
+
+
+static int celestia_markdsos(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 5, "Zero to four arguments expected to function celestia:markdsos");
+
+    CelestiaCore* appCore = this_celestia(l);
+    ObjectQuery query;
+    readObjectQuery(l, 2, query);
+
+    Simulation* sim = appCore->getSimulation();
+    std::vector<Selection> dsos;
+    findDSOs(*sim->getUniverse(), sim->getActiveObserver()->getPosition().toLy(), query, dsos);
+    markObjects(l, 3, *sim->getUniverse(), dsos);
+    lua_pushnumber(l, static_cast<lua_Number>(dsos.size()));
+
+    return 1;
+}
+
+static int celestia_getffiapi(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 1, "No arguments expected to function celestia:getffiapi");
+
+    return celx_pushffiapi(l);
+}
+
+// Return the time spent in the script and in the garbage collection steps
+// after the last frame, in milliseconds, and the memory used in kilobytes
+static int celestia_getscriptstats(lua_State* l)
+{
+    Celx_CheckArgs(l, 1, 1, "No arguments expected to function celestia:getscriptstats");
+
+    const LuaState* luastate = getLuaStateObject(l);
+    const LuaState::Stats& stats = luastate->getStats();
+    lua_newtable(l);
+    setTable(l, "scripttime", stats.scriptTime * 1000.0);
+    setTable(l, "gctime", stats.gcTime * 1000.0);
+    setTable(l, "gcsteps", static_cast<lua_Number>(stats.gcSteps));
+    setTable(l, "gccycles", static_cast<lua_Number>(stats.gcCycles));
+    setTable(l, "memory", static_cast<lua_Number>(lua_gc(l, LUA_GCCOUNT, 0)));
+
+    return 1;
+}
+
 static int celestia_setambient(lua_State* l)
 {
     Celx_CheckArgs(l, 2, 2, "One argument expected in celestia:setambient");
@@ -2116,7 +2502,8 @@ static int celestia_takescreenshot(lua_State* l)
 
     fs::path path = appCore->getConfig()->paths.scriptScreenshotDirectory;
     fs::path filepath = path / fmt::format("{}.{}", filenamestem, filetype);
-    success = appCore->saveScreenShot(filepath);
+    // The file is written in the background once the next frame is drawn
+    success = appCore->saveScreenShotAsync(filepath);
     lua_pushboolean(l, success);
 
     // no matter how long it really took, make it look like 0.1s to timeout check:
@@ -2360,6 +2747,32 @@ static int celestia_playaudio(lua_State* l)
     return 1;
 }
 
+static int celestia_preloadaudio(lua_State* l)
+{
+#ifdef USE_MINIAUDIO
+    Celx_CheckArgs(l, 3, 7, "Function celestia:preloadaudio requires two to six arguments");
+    int channel = celestia_getchannel(l, "First argument for celestia:preloadaudio must be a number");
+
+    const char* path = Celx_SafeGetString(l, 3, AllErrors, "Second argument to celestia:preloadaudio must be a string");
+    if (path == nullptr)
+    {
+        lua_pushboolean(l, false);
+        return 1;
+    }
+
+    float volume = clamp(static_cast<float>(Celx_SafeGetNumber(l, 4, WrongType, "Third argument to celestia:preloadaudio must be a number", static_cast<lua_Number>(defaultAudioVolume))), minAudioVolume, maxAudioVolume);
+    float pan = clamp(static_cast<float>(Celx_SafeGetNumber(l, 5, WrongType, "Fourth argument to celestia:preloadaudio must be a number", static_cast<lua_Number>(defaultAudioPan))), minAudioPan, maxAudioPan);
+    bool loop = Celx_SafeGetBoolean(l, 6, WrongType, "Fifth argument to celestia:preloadaudio must be a boolean", false);
+    bool nopause = Celx_SafeGetBoolean(l, 7, WrongType, "Sixth argument to celestia:preloadaudio must be a boolean", false);
+    CelestiaCore* appCore = this_celestia(l);
+    lua_pushboolean(l, appCore->preloadAudio(channel, path, volume, pan, loop, nopause));
+#else
+    Celx_DoError(l, "Audio playback is not supported");
+    lua_pushboolean(l, false);
+#endif
+    return 1;
+}
+
 static int celestia_resumeaudio(lua_State* l)
 {
 #ifdef USE_MINIAUDIO
@@ -2532,6 +2945,8 @@ void CreateCelestiaMetaTable(lua_State* l)
     Celx_RegisterMethod(l, "hide", celestia_hide);
     Celx_RegisterMethod(l, "getrenderflags", celestia_getrenderflags);
     Celx_RegisterMethod(l, "setrenderflags", celestia_setrenderflags);
+    Celx_RegisterMethod(l, "getrenderstats", celestia_getrenderstats);
+    Celx_RegisterMethod(l, "getmemoryreport", celestia_getmemoryreport);
     Celx_RegisterMethod(l, "getscreendimension", celestia_getscreendimension);
     Celx_RegisterMethod(l, "getwindowdimension", celestia_getwindowdimension);
     Celx_RegisterMethod(l, "getsafeareainsets", celestia_getsafeareainsets);
@@ -2618,6 +3033,12 @@ void CreateCelestiaMetaTable(lua_State* l)
     Celx_RegisterMethod(l, "geteventhandler", celestia_geteventhandler);
     Celx_RegisterMethod(l, "stars", celestia_stars);
     Celx_RegisterMethod(l, "dsos", celestia_dsos);
+    Celx_RegisterMethod(l, "findstars", celestia_findstars);
+    Celx_RegisterMethod(l, "finddsos", celestia_finddsos);
+    Celx_RegisterMethod(l, "markstars", celestia_markstars);
+    Celx_RegisterMethod(l, "markdsos", celestia_markdsos);
+    Celx_RegisterMethod(l, "getffiapi", celestia_getffiapi);
+    Celx_RegisterMethod(l, "getscriptstats", celestia_getscriptstats);
     Celx_RegisterMethod(l, "windowbordersvisible", celestia_windowbordersvisible);
     Celx_RegisterMethod(l, "setwindowbordersvisible", celestia_setwindowbordersvisible);
     Celx_RegisterMethod(l, "seturl", celestia_seturl);
@@ -2631,6 +3052,7 @@ void CreateCelestiaMetaTable(lua_State* l)
     // Audio playback
     Celx_RegisterMethod(l, "isplayingaudio", celestia_isplayingaudio);
     Celx_RegisterMethod(l, "playaudio", celestia_playaudio);
+    Celx_RegisterMethod(l, "preloadaudio", celestia_preloadaudio);
     Celx_RegisterMethod(l, "resumeaudio", celestia_resumeaudio);
     Celx_RegisterMethod(l, "pauseaudio", celestia_pauseaudio);
     Celx_RegisterMethod(l, "stopaudio", celestia_stopaudio);
@@ -0,0 +1,242 @@
+// celx_ffi.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Plain C interface to the celx vector, rotation and position math, for
+// scripts using the LuaJIT FFI.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "celx_ffi.h"
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celengine/univcoord.h>
+#include "celx.h"
+
+namespace
+{
+
+constexpr int CelxFFIVersion = 1;
+
+constexpr const char* CelxFFIDefinitions = R"(
+typedef struct celx_vec3 { double x, y, z; } celx_vec3;
+typedef struct celx_quat { double w, x, y, z; } celx_quat;
+typedef struct celx_r128 { uint64_t lo, hi; } celx_r128;
+typedef struct celx_position { celx_r128 x, y, z; } celx_position;
+typedef struct celx_ffi_api
+{
+    int version;
+    void (*vec3_add)(celx_vec3*, const celx_vec3*, const celx_vec3*);
+    void (*vec3_sub)(celx_vec3*, const celx_vec3*, const celx_vec3*);
+    void (*vec3_scale)(celx_vec3*, const celx_vec3*, double);
+    double (*vec3_dot)(const celx_vec3*, const celx_vec3*);
+    void (*vec3_cross)(celx_vec3*, const celx_vec3*, const celx_vec3*);
+    double (*vec3_length)(const celx_vec3*);
+    void (*vec3_normalize)(celx_vec3*, const celx_vec3*);
+    void (*quat_mul)(celx_quat*, const celx_quat*, const celx_quat*);
+    void (*quat_conjugate)(celx_quat*, const celx_quat*);
+    void (*quat_normalize)(celx_quat*, const celx_quat*);
+    void (*quat_transform)(celx_vec3*, const celx_quat*, const celx_vec3*);
+    void (*quat_slerp)(celx_quat*, const celx_quat*, const celx_quat*, double);
+    void (*quat_from_axis_angle)(celx_quat*, const celx_vec3*, double);
+    void (*position_from_uly)(celx_position*, const celx_vec3*);
+    void (*position_to_uly)(celx_vec3*, const celx_position*);
+    void (*position_offset)(celx_vec3*, const celx_position*, const celx_position*);
+    void (*position_add)(celx_position*, const celx_position*, const celx_vec3*);
+} celx_ffi_api;
+)";
+
+Eigen::Vector3d
+toEigen(const celx_vec3* v)
+{
+    return Eigen::Vector3d(v->x, v->y, v->z);
+}
+
+Eigen::Quaterniond
+toEigen(const celx_quat* q)
+{
+    return Eigen::Quaterniond(q->w, q->x, q->y, q->z);
+}
+
+R128
+toR128(const celx_r128& r)
+{
+    return R128(r.lo, r.hi);
+}
+
+UniversalCoord
+toUniversalCoord(const celx_position* p)
+{
+    return UniversalCoord(toR128(p->x), toR128(p->y), toR128(p->z));
+}
+
+void
+store(celx_vec3* out, const Eigen::Vector3d& v)
+{
+    out->x = v.x();
+    out->y = v.y();
+    out->z = v.z();
+}
+
+void
+store(celx_quat* out, const Eigen::Quaterniond& q)
+{
+    out->w = q.w();
+    out->x = q.x();
+    out->y = q.y();
+    out->z = q.z();
+}
+
+void
+store(celx_r128& out, const R128& r)
+{
+    out.lo = r.lo;
+    out.hi = r.hi;
+}
+
+void
+store(celx_position* out, const UniversalCoord& uc)
+{
+    store(out->x, uc.x);
+    store(out->y, uc.y);
+    store(out->z, uc.z);
+}
+
+void
+vec3Add(celx_vec3* out, const celx_vec3* a, const celx_vec3* b)
+{
+    store(out, toEigen(a) + toEigen(b));
+}
+
+void
+vec3Sub(celx_vec3* out, const celx_vec3* a, const celx_vec3* b)
+{
+    store(out, toEigen(a) - toEigen(b));
+}
+
+void
+vec3Scale(celx_vec3* out, const celx_vec3* a, double s)
+{
+    store(out, toEigen(a) * s);
+}
+
+double
+vec3Dot(const celx_vec3* a, const celx_vec3* b)
+{
+    return toEigen(a).dot(toEigen(b));
+}
+
+void
+vec3Cross(celx_vec3* out, const celx_vec3* a, const celx_vec3* b)
+{
+    store(out, toEigen(a).cross(toEigen(b)));
+}
+
+double
+vec3Length(const celx_vec3* a)
+{
+    return toEigen(a).norm();
+}
+
+void
+vec3Normalize(celx_vec3* out, const celx_vec3* a)
+{
+    store(out, toEigen(a).normalized());
+}
+
+void
+quatMul(celx_quat* out, const celx_quat* a, const celx_quat* b)
+{
+    store(out, toEigen(a) * toEigen(b));
+}
+
+void
+quatConjugate(celx_quat* out, const celx_quat* q)
+{
+    store(out, toEigen(q).conjugate());
+}
+
+void
+quatNormalize(celx_quat* out, const celx_quat* q)
+{
+    store(out, toEigen(q).normalized());
+}
+
+void
+quatTransform(celx_vec3* out, const celx_quat* q, const celx_vec3* v)
+{
+    store(out, toEigen(q).toRotationMatrix().adjoint() * toEigen(v));
+}
+
+void
+quatSlerp(celx_quat* out, const celx_quat* a, const celx_quat* b, double t)
+{
+    store(out, toEigen(a).slerp(t, toEigen(b)));
+}
+
+void
+quatFromAxisAngle(celx_quat* out, const celx_vec3* axis, double angle)
+{
+    store(out, Eigen::Quaterniond(Eigen::AngleAxisd(angle, toEigen(axis).normalized())));
+}
+
+void
+positionFromUly(celx_position* out, const celx_vec3* uly)
+{
+    store(out, UniversalCoord(toEigen(uly)));
+}
+
+void
+positionToUly(celx_vec3* out, const celx_position* p)
+{
+    store(out, toUniversalCoord(p).offsetFromUly(UniversalCoord::Zero()));
+}
+
+void
+positionOffset(celx_vec3* out, const celx_position* a, const celx_position* b)
+{
+    store(out, toUniversalCoord(a).offsetFromUly(toUniversalCoord(b)));
+}
+
+void
+positionAdd(celx_position* out, const celx_position* p, const celx_vec3* uly)
+{
+    store(out, toUniversalCoord(p).offsetUly(toEigen(uly)));
+}
+
+const celx_ffi_api CelxFFIApi
+{
+    CelxFFIVersion,
+    vec3Add,
+    vec3Sub,
+    vec3Scale,
+    vec3Dot,
+    vec3Cross,
+    vec3Length,
+    vec3Normalize,
+    quatMul,
+    quatConjugate,
+    quatNormalize,
+    quatTransform,
+    quatSlerp,
+    quatFromAxisAngle,
+    positionFromUly,
+    positionToUly,
+    positionOffset,
+    positionAdd,
+};
+
+} // end unnamed namespace
+
+int
+celx_pushffiapi(lua_State* l)
+{
+    lua_pushlightuserdata(l, const_cast<celx_ffi_api*>(&CelxFFIApi));
+    lua_pushstring(l, CelxFFIDefinitions);
+    return 2;
+}
@@ -0,0 +1,78 @@
+// celx_ffi.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Plain C interface to the celx vector, rotation and position math, for
+// scripts using the LuaJIT FFI. The functions write their results through
+// pointers, so none of them allocate.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+
+struct lua_State;
+
+extern "C"
+{
+
+// The declarations must match CelxFFIDefinitions in celx_ffi.cpp, which
+// are passed to ffi.cdef().
+
+struct celx_vec3
+{
+    double x, y, z;
+};
+
+struct celx_quat
+{
+    double w, x, y, z;
+};
+
+struct celx_r128
+{
+    std::uint64_t lo, hi;
+};
+
+// A universal coordinate, in micro-light years
+struct celx_position
+{
+    celx_r128 x, y, z;
+};
+
+struct celx_ffi_api
+{
+    int version;
+
+    void (*vec3_add)(celx_vec3* out, const celx_vec3* a, const celx_vec3* b);
+    void (*vec3_sub)(celx_vec3* out, const celx_vec3* a, const celx_vec3* b);
+    void (*vec3_scale)(celx_vec3* out, const celx_vec3* a, double s);
+    double (*vec3_dot)(const celx_vec3* a, const celx_vec3* b);
+    void (*vec3_cross)(celx_vec3* out, const celx_vec3* a, const celx_vec3* b);
+    double (*vec3_length)(const celx_vec3* a);
+    void (*vec3_normalize)(celx_vec3* out, const celx_vec3* a);
+
+    void (*quat_mul)(celx_quat* out, const celx_quat* a, const celx_quat* b);
+    void (*quat_conjugate)(celx_quat* out, const celx_quat* q);
+    void (*quat_normalize)(celx_quat* out, const celx_quat* q);
+    // Same as rotation:transform()
+    void (*quat_transform)(celx_vec3* out, const celx_quat* q, const celx_vec3* v);
+    void (*quat_slerp)(celx_quat* out, const celx_quat* a, const celx_quat* b, double t);
+    void (*quat_from_axis_angle)(celx_quat* out, const celx_vec3* axis, double angle);
+
+    void (*position_from_uly)(celx_position* out, const celx_vec3* uly);
+    void (*position_to_uly)(celx_vec3* out, const celx_position* p);
+    // Offset of a from b in micro-light years, as position:vectorto()
+    void (*position_offset)(celx_vec3* out, const celx_position* a, const celx_position* b);
+    void (*position_add)(celx_position* out, const celx_position* p, const celx_vec3* uly);
+};
+
+} // extern "C"
+
+// Push a light userdata pointing to the API and the string of C
+// declarations for ffi.cdef().
+int celx_pushffiapi(lua_State* l);
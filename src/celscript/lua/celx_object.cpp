@@ -11,6 +11,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <vector>
 
 #include <celengine/atmosphere.h>
 #include <celengine/body.h>
@@ -20,6 +21,8 @@
 #include <celengine/planetgrid.h>
 #include <celengine/multitexture.h>
 #include <celestia/celestiacore.h>
+#include <celestia/eventsearch.h>
+#include <celmath/mathlib.h>
 #include <celscript/common/scriptmaps.h>
 #include <celutil/logger.h>
 #include <celutil/stringutils.h>
@@ -81,7 +84,7 @@ static const char* dsoTypeName(DeepSkyObjectType dsoType)
     }
 }
 
-static celestia::MarkerRepresentation::Symbol parseMarkerSymbol(const string& name)
+celestia::MarkerRepresentation::Symbol parseMarkerSymbol(const string& name)
 {
     using namespace celestia;
 
@@ -1384,6 +1387,130 @@ static int object_gettemperature(lua_State* l)
     return 0;
 }
 
+// Read the bodies from an array of objects at the index of the stack
+static std::vector<const Body*> getBodyArray(lua_State* l, int index, const char* errorMessage)
+{
+    std::vector<const Body*> bodies;
+    if (!lua_istable(l, index))
+    {
+        Celx_DoError(l, errorMessage);
+        return bodies;
+    }
+
+    for (int i = 1;; i++)
+    {
+        lua_rawgeti(l, index, i);
+        if (lua_isnil(l, -1))
+        {
+            lua_pop(l, 1);
+            break;
+        }
+
+        Selection* sel = to_object(l, -1);
+        if (sel == nullptr || sel->body() == nullptr)
+        {
+            Celx_DoError(l, errorMessage);
+            break;
+        }
+
+        bodies.push_back(sel->body());
+        lua_pop(l, 1);
+    }
+
+    return bodies;
+}
+
+static void pushEvents(lua_State* l, const std::vector<CelestialEvent>& events)
+{
+    CelxLua celx(l);
+
+    lua_newtable(l);
+    for (std::size_t i = 0; i < events.size(); i++)
+    {
+        const CelestialEvent& event = events[i];
+        lua_newtable(l);
+        switch (event.type)
+        {
+        case CelestialEvent::Occultation:
+            celx.setTable("type", "occultation");
+            break;
+        case CelestialEvent::Transit:
+            celx.setTable("type", "transit");
+            break;
+        default:
+            celx.setTable("type", "conjunction");
+            break;
+        }
+
+        lua_pushstring(l, "foreground");
+        object_new(l, event.foreground);
+        lua_settable(l, -3);
+        lua_pushstring(l, "background");
+        object_new(l, event.background);
+        lua_settable(l, -3);
+
+        celx.setTable("start", event.startTime);
+        celx.setTable("peak", event.peakTime);
+        celx.setTable("finish", event.endTime);
+        celx.setTable("separation", celestia::math::radToDeg(event.separation));
+        lua_rawseti(l, -2, static_cast<int>(i + 1));
+    }
+}
+
+static int object_findevents(lua_State* l)
+{
+    CelxLua celx(l);
+    celx.checkArgs(4, 5, "Three or four arguments expected for object:findevents()");
+
+    Body* observer = this_object(l)->body();
+    if (observer == nullptr)
+    {
+        celx.doError("object:findevents() must be called on a body");
+        return 0;
+    }
+
+    std::vector<const Body*> bodies = getBodyArray(l, 2, "First argument to object:findevents() must be an array of bodies");
+    double startTime = celx.safeGetNumber(3, AllErrors, "Second argument to object:findevents() must be a number");
+    double endTime = celx.safeGetNumber(4, AllErrors, "Third argument to object:findevents() must be a number");
+    double maxSeparation = celx.safeGetNumber(5, WrongType, "Fourth argument to object:findevents() must be a number", 1.0);
+
+    CelestiaCore* appCore = celx.appCore(AllErrors);
+    EventSearch search(observer, appCore->getSimulation()->getUniverse()->getStarCatalog());
+    std::vector<CelestialEvent> events;
+    search.findBodyEvents(bodies, startTime, endTime, celestia::math::degToRad(maxSeparation),
+                          CelestialEvent::Conjunction | CelestialEvent::Occultation | CelestialEvent::Transit,
+                          events);
+
+    pushEvents(l, events);
+    return 1;
+}
+
+static int object_findoccultations(lua_State* l)
+{
+    CelxLua celx(l);
+    celx.checkArgs(4, 5, "Three or four arguments expected for object:findoccultations()");
+
+    Body* observer = this_object(l)->body();
+    if (observer == nullptr)
+    {
+        celx.doError("object:findoccultations() must be called on a body");
+        return 0;
+    }
+
+    std::vector<const Body*> occulters = getBodyArray(l, 2, "First argument to object:findoccultations() must be an array of bodies");
+    double startTime = celx.safeGetNumber(3, AllErrors, "Second argument to object:findoccultations() must be a number");
+    double endTime = celx.safeGetNumber(4, AllErrors, "Third argument to object:findoccultations() must be a number");
+    auto faintestMag = static_cast<float>(celx.safeGetNumber(5, WrongType, "Fourth argument to object:findoccultations() must be a number", 6.0));
+
+    CelestiaCore* appCore = celx.appCore(AllErrors);
+    EventSearch search(observer, appCore->getSimulation()->getUniverse()->getStarCatalog());
+    std::vector<CelestialEvent> events;
+    search.findStarOccultations(occulters, startTime, endTime, faintestMag, events);
+
+    pushEvents(l, events);
+    return 1;
+}
+
 void CreateObjectMetaTable(lua_State* l)
 {
     CelxLua celx(l);
@@ -1425,6 +1552,8 @@ void CreateObjectMetaTable(lua_State* l)
     celx.registerMethod("gettemperature", object_gettemperature);
     celx.registerMethod("getmass", object_getmass);
     celx.registerMethod("getdensity", object_getdensity);
+    celx.registerMethod("findevents", object_findevents);
+    celx.registerMethod("findoccultations", object_findoccultations);
 
     lua_pop(l, 1); // pop metatable off the stack
 }
@@ -11,6 +11,10 @@
 
 #pragma once
 
+#include <string>
+
+#include <celengine/marker.h>
+
 struct lua_State;
 class Selection;
 
@@ -23,3 +27,4 @@ extern void CreateObjectMetaTable(lua_State* l);
 extern void ExtendObjectMetaTable(lua_State* l);
 extern Selection* to_object(lua_State* l, int index);
 extern int object_new(lua_State* l, const Selection& sel);
+extern celestia::MarkerRepresentation::Symbol parseMarkerSymbol(const std::string& name);
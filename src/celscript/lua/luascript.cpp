@@ -77,6 +77,16 @@ bool LuaScript::tick(double dt)
     return m_celxScript->tick(dt);
 }
 
+void LuaScript::frameFinished(double idleTime)
+{
+    m_celxScript->frameFinished(idleTime);
+}
+
+std::size_t LuaScript::getMemoryUsage() const
+{
+    return m_celxScript->getMemoryUsage();
+}
+
 bool LuaScriptPlugin::isOurFile(const fs::path &p) const
 {
     auto ext = p.extension();
@@ -137,6 +147,16 @@ bool LuaHook::call(const char *method, double dt) const
     return m_state->callLuaHook(appCore(), method, dt);
 }
 
+void LuaHook::frameFinished(double idleTime) const
+{
+    m_state->frameFinished(idleTime);
+}
+
+std::size_t LuaHook::getMemoryUsage() const
+{
+    return m_state->getMemoryUsage();
+}
+
 class LuaPathFinder
 {
     set<fs::path> dirs;
@@ -250,7 +270,7 @@ bool CreateLuaEnvironment(CelestiaCore *appCore, const CelestiaConfig *config, P
             lh->m_state = unique_ptr<LuaState>(luaHook);
             appCore->setScriptHook(std::move(lh));
 
-            while (!luaHook->tick(0.1)) ;
+            luaHook->runToCompletion();
         }
     }
 
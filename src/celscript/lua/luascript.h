@@ -33,6 +33,8 @@ class LuaScript : public IScript
     bool handleKeyEvent(const char* key) override;
     bool handleTickEvent(double dt) override;
     bool tick(double) override;
+    void frameFinished(double idleTime) override;
+    std::size_t getMemoryUsage() const override;
 
  private:
     CelestiaCore *m_appCore;
@@ -72,6 +74,8 @@ class LuaHook : public IScriptHook
     bool call(const char *method, float x, float y) const override;
     bool call(const char *method, float x, float y, int b) const override;
     bool call(const char *method, double dt) const override;
+    void frameFinished(double idleTime) const override;
+    std::size_t getMemoryUsage() const override;
 
  private:
     std::unique_ptr<LuaState> m_state;
@@ -12,6 +12,8 @@
 #include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstring>
+#include <list>
 #include <memory>
 #include <system_error>
 #include <unordered_map>
@@ -25,9 +27,11 @@
 #include <celrender/gl/buffer.h>
 #include <celrender/gl/vertexobject.h>
 #include <celutil/logger.h>
+#include <celutil/memoryreport.h>
 #include <celutil/utf8.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
 
 #define DUMP_TEXTURE 0
 
@@ -35,6 +39,11 @@
 #include <fstream>
 #endif
 
+// FT_RENDER_MODE_SDF was added in FreeType 2.11
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 11)
+#define HAVE_FT_SDF 1
+#endif
+
 using celestia::compat::from_chars;
 using celestia::engine::Image;
 using celestia::engine::PixelFormat;
@@ -70,120 +79,87 @@ struct UnicodeBlock
 constexpr Glyph g_badGlyph = { 0, 0, 0, 0, 0, 0, 0, 0.0f, 0.0f };
 constexpr auto INVALID_POS = static_cast<std::size_t>(-1);
 
-} // end unnamed namespace
+// Glyphs outside of the common blocks are loaded together with the other
+// characters of their aligned block of this many code points
+constexpr FT_ULong GlyphBlockSize = 128;
 
-struct TextureFontPrivate
-{
-    struct FontVertex
-    {
-        FontVertex(float _x, float _y, float _u, float _v) : x(_x), y(_y), u(_u), v(_v)
-        {
-        }
-        float x, y;
-        float u, v;
-    };
-
-    static_assert(std::is_standard_layout_v<FontVertex>);
-
-    TextureFontPrivate(const Renderer *renderer);
-    ~TextureFontPrivate();
-    TextureFontPrivate() = delete;
-    TextureFontPrivate(const TextureFontPrivate &) = delete;
-    TextureFontPrivate(TextureFontPrivate &&) = default;
-    TextureFontPrivate &operator=(const TextureFontPrivate &) = delete;
-    TextureFontPrivate &operator=(TextureFontPrivate &&) = default;
+// Pixel size at which the glyphs of distance field atlases are rendered
+constexpr int DistanceFieldSize = 32;
+// Distance in pixels from the outline at which the distance field saturates
+constexpr int DistanceFieldSpread = 8;
 
-    std::pair<float, float> render(std::u16string_view line, float x, float y);
+/*
+ * The glyphs of a font face rendered into a texture. A bitmap atlas is
+ * rendered at the size of a single font. A distance field atlas is rendered
+ * at DistanceFieldSize and shared by all the fonts of the face, which scale
+ * its glyphs to their own size.
+ */
+struct GlyphAtlas
+{
+    GlyphAtlas(FT_Face face, bool distanceField);
+    ~GlyphAtlas();
+    GlyphAtlas(const GlyphAtlas &) = delete;
+    GlyphAtlas &operator=(const GlyphAtlas &) = delete;
 
-    bool                       buildAtlas();
+    bool                       build();
     void                       computeTextureSize();
-    bool                       loadGlyphInfo(FT_ULong /*ch*/, Glyph & /*c*/) const;
+    bool                       loadGlyph(FT_ULong /*ch*/, Glyph & /*c*/, std::vector<std::uint8_t> & /*bitmap*/) const;
     void                       initCommonGlyphs();
     int                        getCommonGlyphsCount();
-    const Glyph &              getGlyph(std::int32_t /*ch*/, char16_t /*fallback*/);
-    const Glyph &              getGlyph(FT_ULong /* ch */);
+    const Glyph *              find(FT_ULong /*ch*/) const;
+    const Glyph &              add(FT_ULong /*ch*/);
     [[nodiscard]] std::size_t  toPos(FT_ULong /*ch*/) const;
-    void                       optimize();
-    CelestiaGLProgram         *getProgram();
-    void                       flush();
-
-    const Renderer    *m_renderer;
-    CelestiaGLProgram *m_prog{ nullptr };
+    std::size_t                getMemoryUsage() const;
 
     FT_Face m_face; // font face
-
-    int m_maxAscent{ 0 };
-    int m_maxDescent{ 0 };
-    int m_maxWidth{ 0 };
+    bool    m_distanceField;
 
     int m_texWidth{ 0 };
     int m_texHeight{ 0 };
 
     std::unique_ptr<ImageTexture> m_tex; // texture object
+    unsigned int m_revision{ 0 }; // incremented when m_tex is rebuilt
 
     std::vector<Glyph> m_glyphs; // character information
+    std::vector<std::vector<std::uint8_t>> m_bitmaps; // glyph images, kept for rebuilding the texture
+    std::unordered_map<FT_ULong, std::size_t> m_extraGlyphs; // positions of the glyphs outside the common blocks
 
     std::array<UnicodeBlock, 2> m_unicodeBlocks;
 
     int m_commonGlyphsCount{ 0 };
-    int m_inserted{ 0 };
-
-    Eigen::Matrix4f m_projection;
-    Eigen::Matrix4f m_modelView;
-
-    std::vector<FontVertex> m_fontVertices;
-
-    gl::VertexObject m_vao{ gl::VertexObject::Primitive::Triangles };
-    gl::Buffer       m_vbo{ gl::Buffer::TargetHint::Array };
-    gl::Buffer       m_vio{ gl::Buffer::TargetHint::ElementArray };
-
-    bool m_shaderInUse{ false };
-
-    static constexpr std::size_t MaxVertices = 256; // This gives BO size 4kB, MUST be multiply of 4
-    static constexpr std::size_t MaxIndices = MaxVertices / 4 * 6;
 };
 
-
-TextureFontPrivate::TextureFontPrivate(const Renderer *renderer) : m_renderer(renderer)
+GlyphAtlas::GlyphAtlas(FT_Face face, bool distanceField) :
+    m_face(face),
+    m_distanceField(distanceField)
 {
     m_unicodeBlocks[0] = { 0x0020, 0x007E }; // Basic Latin
     m_unicodeBlocks[1] = { 0x03B1, 0x03CF }; // Lower case Greek
-
-    m_vao.addVertexBuffer(
-        m_vbo,
-        CelestiaGLProgram::VertexCoordAttributeIndex,
-        2,
-        gl::VertexObject::DataType::Float,
-        false,
-        sizeof(FontVertex),
-        offsetof(FontVertex, x));
-    m_vao.addVertexBuffer(
-        m_vbo,
-        CelestiaGLProgram::TextureCoord0AttributeIndex,
-        2,
-        gl::VertexObject::DataType::Float,
-        false,
-        sizeof(FontVertex),
-        offsetof(FontVertex, u));
-    m_vao.setIndexBuffer(m_vio, 0, gl::VertexObject::IndexType::UnsignedShort);
 }
 
-TextureFontPrivate::~TextureFontPrivate()
+GlyphAtlas::~GlyphAtlas()
 {
     if (m_face != nullptr)
         FT_Done_Face(m_face);
 }
 
 bool
-TextureFontPrivate::loadGlyphInfo(FT_ULong ch, Glyph &c) const
+GlyphAtlas::loadGlyph(FT_ULong ch, Glyph &c, std::vector<std::uint8_t> &bitmap) const
 {
     FT_GlyphSlot g = m_face->glyph;
-    if (FT_Load_Char(m_face, ch, FT_LOAD_RENDER) != 0)
+    if (FT_Load_Char(m_face, ch, m_distanceField ? FT_LOAD_DEFAULT : FT_LOAD_RENDER) != 0)
     {
         c.ch = 0;
         return false;
     }
 
+#ifdef HAVE_FT_SDF
+    // Glyphs without an outline, like spaces, have no distance field to
+    // render but still advance
+    if (m_distanceField)
+        FT_Render_Glyph(g, FT_RENDER_MODE_SDF);
+#endif
+
     c.ch = ch;
     c.ax = g->advance.x >> 6;
     c.ay = g->advance.y >> 6;
@@ -191,31 +167,41 @@ TextureFontPrivate::loadGlyphInfo(FT_ULong ch, Glyph &c) const
     c.bh = g->bitmap.rows;
     c.bl = g->bitmap_left;
     c.bt = g->bitmap_top;
+
+    bitmap.resize(static_cast<std::size_t>(c.bw) * c.bh);
+    for (unsigned int y = 0; y < c.bh; y++)
+    {
+        const std::uint8_t *src = g->bitmap.buffer + static_cast<std::ptrdiff_t>(y) * g->bitmap.pitch;
+        std::memcpy(bitmap.data() + static_cast<std::size_t>(y) * c.bw, src, c.bw);
+    }
     return true;
 }
 
 void
-TextureFontPrivate::initCommonGlyphs()
+GlyphAtlas::initCommonGlyphs()
 {
     if (!m_glyphs.empty())
         return;
 
     m_glyphs.reserve(256);
+    m_bitmaps.reserve(256);
 
     for (auto const &block : m_unicodeBlocks)
     {
         for (FT_ULong ch = block.first, e = block.last; ch <= e; ch++)
         {
             Glyph c;
-            if (!loadGlyphInfo(ch, c))
+            std::vector<std::uint8_t> bitmap;
+            if (!loadGlyph(ch, c, bitmap))
                 GetLogger()->warn("Loading character {:x} failed!\n", static_cast<unsigned>(ch));
             m_glyphs.push_back(c); // still pushing empty
+            m_bitmaps.push_back(std::move(bitmap));
         }
     }
 }
 
 void
-TextureFontPrivate::computeTextureSize()
+GlyphAtlas::computeTextureSize()
 {
     int roww = 0;
     int rowh = 0;
@@ -246,7 +232,7 @@ TextureFontPrivate::computeTextureSize()
 }
 
 bool
-TextureFontPrivate::buildAtlas()
+GlyphAtlas::build()
 {
     initCommonGlyphs();
     computeTextureSize();
@@ -259,21 +245,14 @@ TextureFontPrivate::buildAtlas()
     int oy = 0;
     int rowh = 0;
 
-    FT_GlyphSlot g = m_face->glyph;
-    for (auto &c : m_glyphs)
+    for (std::size_t i = 0; i < m_glyphs.size(); i++)
     {
+        Glyph &c = m_glyphs[i];
         if (c.ch == 0)
             continue; // skip bad glyphs
 
-        if (FT_Load_Char(m_face, c.ch, FT_LOAD_RENDER) != 0)
-        {
-            GetLogger()->warn("Loading character {:x} failed!\n", static_cast<unsigned>(c.ch));
-            c.ch = 0;
-            continue;
-        }
-
         // compute subimage position
-        if (ox + int(g->bitmap.width) > int(m_texWidth))
+        if (ox + static_cast<int>(c.bw) > m_texWidth)
         {
             oy += rowh;
             rowh = 0;
@@ -281,28 +260,28 @@ TextureFontPrivate::buildAtlas()
         }
 
         // copy glyph image to the destination image
-        auto bitmapRows = static_cast<int>(g->bitmap.rows);
-        for (int y = 0; y < bitmapRows; y++)
+        const std::vector<std::uint8_t> &bitmap = m_bitmaps[i];
+        for (unsigned int y = 0; y < c.bh; y++)
         {
-            std::uint8_t *dst = img->getPixelRow(oy + y) + ox * img->getComponents();
-            const std::uint8_t *src = g->bitmap.buffer + y * g->bitmap.width;
-            memcpy(dst, src, g->bitmap.width);
+            std::uint8_t *dst = img->getPixelRow(oy + static_cast<int>(y)) + ox * img->getComponents();
+            std::memcpy(dst, bitmap.data() + static_cast<std::size_t>(y) * c.bw, c.bw);
         }
 
         c.tx = static_cast<float>(ox) / static_cast<float>(m_texWidth);
         c.ty = static_cast<float>(oy) / static_cast<float>(m_texHeight);
 
-        rowh = std::max(rowh, static_cast<int>(g->bitmap.rows));
-        ox += g->bitmap.width + 1;
+        rowh = std::max(rowh, static_cast<int>(c.bh));
+        ox += c.bw + 1;
     }
 
     m_tex = std::make_unique<ImageTexture>(*img, Texture::EdgeClamp, Texture::NoMipMaps);
+    ++m_revision;
 
     return true;
 }
 
 int
-TextureFontPrivate::getCommonGlyphsCount()
+GlyphAtlas::getCommonGlyphsCount()
 {
     if (m_commonGlyphsCount == 0)
     {
@@ -313,7 +292,7 @@ TextureFontPrivate::getCommonGlyphsCount()
 }
 
 std::size_t
-TextureFontPrivate::toPos(FT_ULong ch) const
+GlyphAtlas::toPos(FT_ULong ch) const
 {
     std::size_t pos = 0;
 
@@ -333,6 +312,168 @@ TextureFontPrivate::toPos(FT_ULong ch) const
     return INVALID_POS;
 }
 
+/*
+ * Return the glyph of a character which is already in the atlas, or nullptr.
+ */
+const Glyph *
+GlyphAtlas::find(FT_ULong ch) const
+{
+    if (auto pos = toPos(ch); pos != INVALID_POS)
+        return &m_glyphs[pos];
+
+    auto it = m_extraGlyphs.find(ch);
+    return it == m_extraGlyphs.end() ? nullptr : &m_glyphs[it->second];
+}
+
+/*
+ * Add a character outside of the common blocks to the atlas. The other
+ * characters of its block which the face provides are added as well, so
+ * that text in another script rebuilds the texture once rather than for
+ * each new character.
+ */
+const Glyph &
+GlyphAtlas::add(FT_ULong ch)
+{
+    Glyph c;
+    std::vector<std::uint8_t> bitmap;
+    if (!loadGlyph(ch, c, bitmap))
+        return g_badGlyph;
+
+    getCommonGlyphsCount();
+    std::size_t pos = m_glyphs.size();
+    m_extraGlyphs.try_emplace(ch, pos);
+    m_glyphs.push_back(c);
+    m_bitmaps.push_back(std::move(bitmap));
+
+    FT_ULong first = ch - ch % GlyphBlockSize;
+    for (FT_ULong other = first; other < first + GlyphBlockSize; other++)
+    {
+        if (find(other) != nullptr || FT_Get_Char_Index(m_face, other) == 0)
+            continue;
+
+        if (!loadGlyph(other, c, bitmap))
+            continue;
+
+        m_extraGlyphs.try_emplace(other, m_glyphs.size());
+        m_glyphs.push_back(c);
+        m_bitmaps.push_back(std::move(bitmap));
+    }
+
+    build();
+
+    return m_glyphs[pos];
+}
+
+// Memory used by the glyphs kept for rebuilding the texture
+std::size_t
+GlyphAtlas::getMemoryUsage() const
+{
+    using celestia::util::ContainerMemoryUsage;
+
+    std::size_t size = sizeof(GlyphAtlas) + ContainerMemoryUsage(m_glyphs) + ContainerMemoryUsage(m_bitmaps) +
+                       ContainerMemoryUsage(m_extraGlyphs);
+    for (const auto &bitmap : m_bitmaps)
+        size += ContainerMemoryUsage(bitmap);
+    return size;
+}
+
+} // end unnamed namespace
+
+struct TextureFontPrivate
+{
+    struct FontVertex
+    {
+        FontVertex(float _x, float _y, float _u, float _v) : x(_x), y(_y), u(_u), v(_v)
+        {
+        }
+        float x, y;
+        float u, v;
+    };
+
+    static_assert(std::is_standard_layout_v<FontVertex>);
+
+    // A line laid out at the origin
+    struct GlyphRun
+    {
+        std::vector<TextureFont::GlyphQuad> quads;
+        std::pair<float, float> advance;
+        unsigned int atlasRevision{ 0 };
+    };
+
+    // Most recently used first
+    using GlyphRunList = std::list<std::pair<std::u16string, GlyphRun>>;
+
+    TextureFontPrivate(const Renderer *renderer);
+    ~TextureFontPrivate() = default;
+    TextureFontPrivate() = delete;
+    TextureFontPrivate(const TextureFontPrivate &) = delete;
+    TextureFontPrivate(TextureFontPrivate &&) = default;
+    TextureFontPrivate &operator=(const TextureFontPrivate &) = delete;
+    TextureFontPrivate &operator=(TextureFontPrivate &&) = default;
+
+    std::pair<float, float> render(std::u16string_view line, float x, float y);
+    std::pair<float, float> layout(std::u16string_view line, float x, float y, std::vector<TextureFont::GlyphQuad> &quads);
+    const GlyphRun &        getRun(std::u16string_view line);
+
+    const Glyph &              getGlyph(std::int32_t /*ch*/, char16_t /*fallback*/);
+    const Glyph &              getGlyph(FT_ULong /* ch */);
+    CelestiaGLProgram         *getProgram();
+    void                       flush();
+    std::size_t                getMemoryUsage() const;
+
+    const Renderer    *m_renderer;
+    CelestiaGLProgram *m_prog{ nullptr };
+
+    std::shared_ptr<GlyphAtlas> m_atlas;
+    float m_scale{ 1.0f }; // size of the font relative to the atlas glyphs
+
+    int m_maxAscent{ 0 };
+    int m_maxDescent{ 0 };
+    int m_maxWidth{ 0 };
+
+    Eigen::Matrix4f m_projection;
+    Eigen::Matrix4f m_modelView;
+
+    std::vector<FontVertex> m_fontVertices;
+
+    // Lines rendered recently, as the same HUD strings and object names
+    // are usually rendered again in the next frames
+    GlyphRunList m_runs;
+    std::unordered_map<std::u16string_view, GlyphRunList::iterator> m_runIndex;
+
+    gl::VertexObject m_vao{ gl::VertexObject::Primitive::Triangles };
+    gl::Buffer       m_vbo{ gl::Buffer::TargetHint::Array };
+    gl::Buffer       m_vio{ gl::Buffer::TargetHint::ElementArray };
+
+    bool m_shaderInUse{ false };
+
+    static constexpr std::size_t MaxVertices = 256; // This gives BO size 4kB, MUST be multiply of 4
+    static constexpr std::size_t MaxIndices = MaxVertices / 4 * 6;
+    static constexpr std::size_t MaxCachedRuns = 256;
+};
+
+
+TextureFontPrivate::TextureFontPrivate(const Renderer *renderer) : m_renderer(renderer)
+{
+    m_vao.addVertexBuffer(
+        m_vbo,
+        CelestiaGLProgram::VertexCoordAttributeIndex,
+        2,
+        gl::VertexObject::DataType::Float,
+        false,
+        sizeof(FontVertex),
+        offsetof(FontVertex, x));
+    m_vao.addVertexBuffer(
+        m_vbo,
+        CelestiaGLProgram::TextureCoord0AttributeIndex,
+        2,
+        gl::VertexObject::DataType::Float,
+        false,
+        sizeof(FontVertex),
+        offsetof(FontVertex, u));
+    m_vao.setIndexBuffer(m_vio, 0, gl::VertexObject::IndexType::UnsignedShort);
+}
+
 const Glyph &
 TextureFontPrivate::getGlyph(std::int32_t ch, char16_t fallback)
 {
@@ -350,48 +491,25 @@ TextureFontPrivate::getGlyph(std::int32_t ch, char16_t fallback)
 const Glyph &
 TextureFontPrivate::getGlyph(FT_ULong ch)
 {
-    if (auto pos = toPos(ch); pos != INVALID_POS)
-        return m_glyphs[pos];
-
-    auto it = std::find_if(m_glyphs.cbegin() + getCommonGlyphsCount(),
-                           m_glyphs.cend(),
-                           [ch](const Glyph &g) { return g.ch == ch; });
-
-    if (it != m_glyphs.end())
-        return *it;
-
-    Glyph c;
-    if (!loadGlyphInfo(ch, c))
-        return g_badGlyph;
+    if (const Glyph *g = m_atlas->find(ch); g != nullptr)
+        return *g;
 
     flush(); // render text to avoid garbled output due to changed texture
 
-    m_glyphs.push_back(c);
-    if (++m_inserted == 10) optimize();
-    buildAtlas();
-
-    return m_glyphs.back();
-}
-
-void
-TextureFontPrivate::optimize()
-{
-    m_inserted = 0;
+    return m_atlas->add(ch);
 }
 
 /*
- * Render text using the currently loaded font and currently set font size.
- * Rendering starts at coordinates (x, y), z is always 0.
- * The pixel coordinates that the FreeType2 library uses are scaled by (sx, sy).
+ * Lay out a line of text using the currently loaded font and currently set
+ * font size, starting at coordinates (x, y). The quads of the glyphs which
+ * have pixels are appended to quads, and the start position for the next
+ * glyph is returned.
  */
 std::pair<float, float>
-TextureFontPrivate::render(std::u16string_view line, float x, float y)
+TextureFontPrivate::layout(std::u16string_view line, float x, float y, std::vector<TextureFont::GlyphQuad> &quads)
 {
-    if (m_tex == nullptr)
-        return {0.0f, 0.0f};
-
-    // Use the texture containing the atlas
-    m_tex->bind();
+    const auto texWidth  = static_cast<float>(m_atlas->m_texWidth);
+    const auto texHeight = static_cast<float>(m_atlas->m_texHeight);
 
     std::u16string_view::size_type i = 0;
     while (i < line.size())
@@ -420,41 +538,96 @@ TextureFontPrivate::render(std::u16string_view line, float x, float y)
         auto &g = getGlyph(ch, u'?');
 
         // Calculate the vertex and texture coordinates
-        const float x1 = x + g.bl;
-        const float y1 = y + g.bt - g.bh;
-        const float w  = g.bw;
-        const float h  = g.bh;
-        const float x2 = x1 + w;
-        const float y2 = y1 + h;
+        const float x1 = x + static_cast<float>(g.bl) * m_scale;
+        const float y1 = y + static_cast<float>(g.bt - static_cast<int>(g.bh)) * m_scale;
+        const float w  = static_cast<float>(g.bw);
+        const float h  = static_cast<float>(g.bh);
 
         // Advance the cursor to the start of the next character
-        x += g.ax;
-        y += g.ay;
+        x += static_cast<float>(g.ax) * m_scale;
+        y += static_cast<float>(g.ay) * m_scale;
 
         // Skip glyphs that have no pixels
         if (g.bw == 0 || g.bh == 0) continue;
 
-        const float tx1 = g.tx;
-        const float ty1 = g.ty;
-        const float tx2 = tx1 + w / m_texWidth;
-        const float ty2 = ty1 + h / m_texHeight;
+        quads.push_back({ x1, y1, x1 + w * m_scale, y1 + h * m_scale,
+                          g.tx, g.ty, g.tx + w / texWidth, g.ty + h / texHeight });
+    }
 
-        m_fontVertices.emplace_back(x1, y1, tx1, ty2);
-        m_fontVertices.emplace_back(x2, y1, tx2, ty2);
-        m_fontVertices.emplace_back(x1, y2, tx1, ty1);
-        m_fontVertices.emplace_back(x2, y2, tx2, ty1);
+    return {x, y};
+}
+
+/*
+ * Render text using the currently loaded font and currently set font size.
+ * Rendering starts at coordinates (x, y), z is always 0.
+ * The pixel coordinates that the FreeType2 library uses are scaled by (sx, sy).
+ */
+std::pair<float, float>
+TextureFontPrivate::render(std::u16string_view line, float x, float y)
+{
+    if (m_atlas->m_tex == nullptr)
+        return {0.0f, 0.0f};
+
+    const GlyphRun &run = getRun(line);
+
+    // Use the texture containing the atlas
+    m_atlas->m_tex->bind();
+
+    for (const auto &q : run.quads)
+    {
+        m_fontVertices.emplace_back(x + q.x1, y + q.y1, q.tx1, q.ty2);
+        m_fontVertices.emplace_back(x + q.x2, y + q.y1, q.tx2, q.ty2);
+        m_fontVertices.emplace_back(x + q.x1, y + q.y2, q.tx1, q.ty1);
+        m_fontVertices.emplace_back(x + q.x2, y + q.y2, q.tx2, q.ty1);
 
         if (m_fontVertices.size() == MaxVertices) flush();
     }
 
-    return {x, y};
+    return {x + run.advance.first, y + run.advance.second};
+}
+
+/*
+ * Return the glyphs of a line laid out at the origin, from the cache of
+ * recently used lines if possible.
+ */
+const TextureFontPrivate::GlyphRun &
+TextureFontPrivate::getRun(std::u16string_view line)
+{
+    if (auto it = m_runIndex.find(line); it != m_runIndex.end())
+    {
+        m_runs.splice(m_runs.begin(), m_runs, it->second);
+        if (it->second->second.atlasRevision == m_atlas->m_revision)
+            return it->second->second;
+    }
+    else
+    {
+        if (m_runs.size() == MaxCachedRuns)
+        {
+            m_runIndex.erase(m_runs.back().first);
+            m_runs.pop_back();
+        }
+        m_runs.emplace_front(line, GlyphRun());
+        m_runIndex.try_emplace(m_runs.front().first, m_runs.begin());
+    }
+
+    // Loading a missing glyph rebuilds the atlas, which moves the glyphs
+    // laid out before it, so lay the line out again in that case
+    GlyphRun &run = m_runs.front().second;
+    do
+    {
+        run.atlasRevision = m_atlas->m_revision;
+        run.quads.clear();
+        run.advance = layout(line, 0.0f, 0.0f, run.quads);
+    } while (run.atlasRevision != m_atlas->m_revision);
+
+    return run;
 }
 
 CelestiaGLProgram *
 TextureFontPrivate::getProgram()
 {
     if (m_prog == nullptr)
-        m_prog = m_renderer->getShaderManager().getShader("text");
+        m_prog = m_renderer->getShaderManager().getShader(m_atlas->m_distanceField ? "textsdf" : "text");
     return m_prog;
 }
 
@@ -510,6 +683,35 @@ TextureFont::render(std::u16string_view line, float xoffset, float yoffset) cons
     return impl->render(line, xoffset, yoffset);
 }
 
+/**
+ * Lay out a string with the specified offset
+ *
+ * Compute the glyph quads of a string the same way as render() does, but
+ * append them to quads instead of drawing them. The texture coordinates
+ * remain valid until the atlas is rebuilt to add a glyph which wasn't
+ * loaded before, which changes getAtlasRevision().
+ *
+ * @param line -- line to lay out
+ * @param xoffset -- horizontal offset
+ * @param yoffset -- vertical offset
+ * @param quads -- vector to append the quads to
+ * @return the start position for the next glyph
+ */
+std::pair<float, float>
+TextureFont::layout(std::u16string_view line, float xoffset, float yoffset, std::vector<GlyphQuad> &quads) const
+{
+    return impl->layout(line, xoffset, yoffset, quads);
+}
+
+/**
+ * Return a counter which changes whenever the glyph atlas is rebuilt.
+ */
+unsigned int
+TextureFont::getAtlasRevision() const
+{
+    return impl->m_atlas->m_revision;
+}
+
 /**
  * Calculate string width in pixels
  *
@@ -521,14 +723,7 @@ TextureFont::render(std::u16string_view line, float xoffset, float yoffset) cons
 int
 TextureFont::getWidth(std::u16string_view line) const
 {
-    int  width     = 0;
-    for (auto ch : line)
-    {
-        auto &g = impl->getGlyph(ch, u'?');
-        width += g.ax;
-    }
-
-    return width;
+    return static_cast<int>(impl->getRun(line).advance.first);
 }
 
 /**
@@ -593,13 +788,19 @@ void
 TextureFont::bind()
 {
     auto *prog = impl->getProgram();
-    if (prog == nullptr || impl->m_tex == nullptr)
+    if (prog == nullptr || impl->m_atlas->m_tex == nullptr)
         return;
 
     glActiveTexture(GL_TEXTURE0);
-    impl->m_tex->bind();
+    impl->m_atlas->m_tex->bind();
     prog->use();
     prog->samplerParam("atlasTex") = 0;
+    if (impl->m_atlas->m_distanceField)
+    {
+        // Antialias over about one pixel on the screen; the distance field
+        // covers 2 * DistanceFieldSpread atlas pixels
+        prog->floatParam("sdfSmoothing") = 0.25f / (impl->m_scale * static_cast<float>(DistanceFieldSpread));
+    }
     prog->setMVPMatrices(impl->m_projection, impl->m_modelView);
     impl->m_shaderInUse = true;
 }
@@ -639,6 +840,23 @@ TextureFont::flush()
     impl->flush();
 }
 
+// Memory used by the font and its cached runs, excluding its atlas
+std::size_t
+TextureFontPrivate::getMemoryUsage() const
+{
+    using celestia::util::ContainerMemoryUsage;
+
+    std::size_t size = sizeof(TextureFont) + sizeof(TextureFontPrivate) + ContainerMemoryUsage(m_fontVertices) +
+                       ContainerMemoryUsage(m_runIndex);
+    for (const auto &[line, run] : m_runs)
+    {
+        // List nodes hold two links
+        size += sizeof(GlyphRunList::value_type) + 2 * sizeof(void *) +
+                line.capacity() * sizeof(char16_t) + ContainerMemoryUsage(run.quads);
+    }
+    return size;
+}
+
 namespace
 {
 
@@ -716,6 +934,48 @@ template<> struct std::hash<FontCacheKey>
 
 using FontCache = std::unordered_map<FontCacheKey, std::weak_ptr<TextureFont>>;
 
+struct AtlasCacheKey
+{
+    fs::path filename;
+    int index;
+
+    bool operator==(const AtlasCacheKey &other) const
+    {
+        return filename == other.filename && index == other.index;
+    }
+};
+
+template<> struct std::hash<AtlasCacheKey>
+{
+    std::size_t operator()(const AtlasCacheKey &k) const
+    {
+        return std::hash<std::string>()(k.filename.string()) ^ std::hash<int>()(k.index);
+    }
+};
+
+// Distance field atlases, shared by the fonts of all sizes of a face
+using AtlasCache = std::unordered_map<AtlasCacheKey, std::weak_ptr<GlyphAtlas>>;
+
+namespace
+{
+
+// Never destroyed, as fonts may be released after the end of main()
+FontCache &
+getFontCache()
+{
+    static FontCache *const fontCache = std::make_unique<FontCache>().release(); //NOSONAR
+    return *fontCache;
+}
+
+AtlasCache &
+getAtlasCache()
+{
+    static AtlasCache *const atlasCache = std::make_unique<AtlasCache>().release(); //NOSONAR
+    return *atlasCache;
+}
+
+} // end unnamed namespace
+
 std::shared_ptr<TextureFont>
 LoadTextureFont(const Renderer *r, const fs::path &filename, int index, int size)
 {
@@ -727,41 +987,125 @@ LoadTextureFont(const Renderer *r, const fs::path &filename, int index, int size
         return nullptr;
     }
 
-    // Init FontCache
-    static FontCache *fontCache = nullptr;
-    if (fontCache == nullptr)
-        fontCache = new FontCache;
+#ifdef HAVE_FT_SDF
+    // The default spread of 2 pixels is too small to scale glyphs up
+    static bool spreadSet = false;
+    if (!spreadSet)
+    {
+        FT_Int spread = DistanceFieldSpread;
+        FT_Property_Set(ftlib, "sdf", "spread", &spread);
+        spreadSet = true;
+    }
+#endif
+
+    FontCache &fontCache = getFontCache();
+    AtlasCache &atlasCache = getAtlasCache();
 
     int screenDpi = r->getScreenDpi();
 
+    bool distanceField = r->getDistanceFieldFonts();
+#ifndef HAVE_FT_SDF
+    if (distanceField)
+    {
+        static bool warned = false;
+        if (!warned)
+            GetLogger()->warn("Distance field fonts need FreeType 2.11 or later\n");
+        warned = true;
+        distanceField = false;
+    }
+#endif
+
     // Lookup for an existing cached font
-    std::weak_ptr<TextureFont> &font = (*fontCache)[{ filename, index, size, screenDpi }];
+    std::weak_ptr<TextureFont> &font = fontCache[{ filename, index, size, screenDpi }];
     std::shared_ptr<TextureFont> ret = font.lock();
     if (ret == nullptr)
     {
         int  psize    = TextureFont::kDefaultSize;
         int  pindex   = 0;
         auto nameonly = ParseFontName(filename, pindex, psize);
-        auto face     = LoadFontFace(ftlib, nameonly,
-                                     index > 0 ? index : pindex,
-                                     size > 0 ? size : psize,
-                                     screenDpi);
-        if (face == nullptr)
-            return nullptr;
+        int  faceIndex = index > 0 ? index : pindex;
+        int  faceSize  = size > 0 ? size : psize;
 
-        ret = std::make_shared<TextureFont>(r);
-        ret->impl->m_face = face;
+        std::shared_ptr<GlyphAtlas> atlas;
+        float scale = 1.0f;
+        if (distanceField)
+        {
+            std::weak_ptr<GlyphAtlas> &cachedAtlas = atlasCache[{ nameonly, faceIndex }];
+            atlas = cachedAtlas.lock();
+            if (atlas == nullptr)
+            {
+                auto face = LoadFontFace(ftlib, nameonly, faceIndex, DistanceFieldSize, 72);
+                if (face == nullptr)
+                    return nullptr;
+
+                atlas = std::make_shared<GlyphAtlas>(face, true);
+                if (!atlas->build())
+                    return nullptr;
+                cachedAtlas = atlas;
+            }
 
-        if (!ret->impl->buildAtlas())
+            // Pixel size of the font relative to the atlas glyphs
+            scale = static_cast<float>(faceSize * screenDpi) / static_cast<float>(DistanceFieldSize * 72);
+        }
+        else
         {
-            FT_Done_Face(face);
-            return nullptr;
+            auto face = LoadFontFace(ftlib, nameonly, faceIndex, faceSize, screenDpi);
+            if (face == nullptr)
+                return nullptr;
+
+            atlas = std::make_shared<GlyphAtlas>(face, false);
+            if (!atlas->build())
+                return nullptr;
         }
 
-        ret->setMaxAscent(static_cast<int>(face->size->metrics.ascender >> 6));
-        ret->setMaxDescent(static_cast<int>(-face->size->metrics.descender >> 6));
+        ret = std::make_shared<TextureFont>(r);
+        ret->impl->m_atlas = atlas;
+        ret->impl->m_scale = scale;
+
+        const FT_Size_Metrics &metrics = atlas->m_face->size->metrics;
+        ret->setMaxAscent(static_cast<int>(static_cast<float>(metrics.ascender) * scale / 64.0f));
+        ret->setMaxDescent(static_cast<int>(static_cast<float>(-metrics.descender) * scale / 64.0f));
 
         font = ret;
     }
     return ret;
 }
+
+void
+ReportTextureFontMemory(celestia::util::MemoryReport &report)
+{
+    using namespace std::string_view_literals;
+    constexpr std::string_view subsystem = "Fonts"sv;
+
+    std::size_t nFonts = 0;
+    std::size_t fontsSize = 0;
+    std::vector<const GlyphAtlas *> atlases;
+    for (const auto &[key, weakFont] : getFontCache())
+    {
+        auto font = weakFont.lock();
+        if (font == nullptr)
+            continue;
+
+        ++nFonts;
+        fontsSize += font->impl->getMemoryUsage();
+        // Distance field atlases are shared by the fonts of a face
+        if (const GlyphAtlas *atlas = font->impl->m_atlas.get();
+            atlas != nullptr && std::find(atlases.begin(), atlases.end(), atlas) == atlases.end())
+        {
+            atlases.push_back(atlas);
+        }
+    }
+
+    std::size_t atlasesSize = 0;
+    std::size_t texturesSize = 0;
+    for (const GlyphAtlas *atlas : atlases)
+    {
+        atlasesSize += atlas->getMemoryUsage();
+        if (atlas->m_tex != nullptr)
+            texturesSize += atlas->m_tex->getMemoryUsage();
+    }
+
+    report.add(subsystem, "Fonts"sv, fontsSize, nFonts);
+    report.add(subsystem, "Glyph atlases"sv, atlasesSize, atlases.size());
+    report.add(subsystem, "Glyph atlas textures (GPU)"sv, texturesSize, atlases.size());
+}
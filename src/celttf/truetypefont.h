@@ -11,6 +11,8 @@
 
 #include <memory>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
@@ -20,18 +22,34 @@
 class Renderer;
 class TextureFont;
 
+namespace celestia::util
+{
+class MemoryReport;
+}
+
 std::shared_ptr<TextureFont>
 LoadTextureFont(const Renderer *, const fs::path &, int index = 0, int size = 0);
 
 fs::path
 ParseFontName(const fs::path &, int &, int &);
 
+// Add the memory used by the loaded fonts and their glyph atlases
+void
+ReportTextureFontMemory(celestia::util::MemoryReport &);
+
 struct TextureFontPrivate;
 class TextureFont
 {
 public:
     constexpr static int kDefaultSize = 12;
 
+    // A glyph of a laid out line, in pixels and atlas texture coordinates
+    struct GlyphQuad
+    {
+        float x1, y1, x2, y2;
+        float tx1, ty1, tx2, ty2;
+    };
+
     TextureFont(const Renderer *);
     TextureFont() = delete;
     ~TextureFont();
@@ -44,6 +62,8 @@ public:
                         const Eigen::Matrix4f &m = Eigen::Matrix4f::Identity());
 
     std::pair<float, float> render(std::u16string_view line, float xoffset = 0.0f, float yoffset = 0.0f) const;
+    std::pair<float, float> layout(std::u16string_view line, float xoffset, float yoffset, std::vector<GlyphQuad> &quads) const;
+    unsigned int getAtlasRevision() const;
 
     int getWidth(std::u16string_view) const;
     int getMaxWidth() const;
@@ -63,4 +83,6 @@ private:
 
     friend std::shared_ptr<TextureFont>
     LoadTextureFont(const Renderer*, const fs::path&, int, int);
+    friend void
+    ReportTextureFontMemory(celestia::util::MemoryReport&);
 };
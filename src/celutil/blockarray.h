@@ -28,6 +28,12 @@
  *  - The address of a BlockArray element is guaranteed not to
  *    change over the lifetime of the BlockArray (or until the
  *    BlockArray is cleared.)
+ *
+ *  The elements are stored in blocks of BLOCKSIZE contiguous elements;
+ *  forEachBlock() visits them a block at a time, which avoids the index
+ *  computations of the iterators in tight loops. Blocks are allocated in
+ *  groups of growing size, and emptied blocks are kept for reuse until
+ *  the array is cleared.
  */
 template<typename T, std::size_t BLOCKSIZE = 1024>
 class BlockArray
@@ -143,15 +149,54 @@ public:
     using reverse_iterator = std::reverse_iterator<iterator>;
     using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
+    BlockArray() = default;
+    ~BlockArray() = default;
+
+    BlockArray(const BlockArray&) = delete;
+    BlockArray& operator=(const BlockArray&) = delete;
+
+    BlockArray(BlockArray&& other) noexcept { swap(other); }
+
+    BlockArray& operator=(BlockArray&& other) noexcept
+    {
+        BlockArray moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
     size_type size() const noexcept
     {
-        if (m_blocks.empty())
+        if (m_usedBlocks == 0)
             return 0;
-        return ((m_blocks.size() - 1) * BLOCKSIZE) + m_blocks.back()->size();
+        return ((m_usedBlocks - 1) * BLOCKSIZE) + m_blocks[m_usedBlocks - 1]->size();
     }
 
     size_type max_size() const noexcept { return static_cast<size_type>(std::numeric_limits<difference_type>::max()); }
-    bool empty() const noexcept { return m_blocks.empty(); }
+    bool empty() const noexcept { return m_usedBlocks == 0; }
+    size_type capacity() const noexcept { return m_blocks.size() * BLOCKSIZE; }
+
+    // Allocate the blocks for at least n elements in a single group
+    void reserve(size_type n)
+    {
+        size_type nBlocks = (n + BLOCKSIZE - 1) / BLOCKSIZE;
+        if (nBlocks > m_blocks.size())
+            allocateBlocks(nBlocks - m_blocks.size());
+    }
+
+    // Call f(data, count) for each block of contiguous elements, in order
+    template<typename F>
+    void forEachBlock(F&& f)
+    {
+        for (size_type i = 0; i < m_usedBlocks; ++i)
+            f(m_blocks[i]->data(), m_blocks[i]->size());
+    }
+
+    template<typename F>
+    void forEachBlock(F&& f) const
+    {
+        for (size_type i = 0; i < m_usedBlocks; ++i)
+            f(static_cast<const T*>(m_blocks[i]->data()), m_blocks[i]->size());
+    }
 
     iterator begin() noexcept { return iterator(this, 0); }
     const_iterator begin() const noexcept { return const_iterator(this, 0); }
@@ -172,51 +217,79 @@ public:
 
     reference front() { return m_blocks.front()->front(); }
     const_reference front() const { return m_blocks.front()->front(); }
-    reference back() { return m_blocks.back()->back(); }
-    const_reference back() const { return m_blocks.back()->back(); }
+    reference back() { return m_blocks[m_usedBlocks - 1]->back(); }
+    const_reference back() const { return m_blocks[m_usedBlocks - 1]->back(); }
 
     void push_back(const T& value)
     {
-        if (m_blocks.empty() || m_blocks.back()->size() == BLOCKSIZE)
-            m_blocks.push_back(std::make_unique<block_type>());
-        m_blocks.back()->push_back(value);
+        appendBlock().push_back(value);
     }
 
     void push_back(T&& value)
     {
-        if (m_blocks.empty() || m_blocks.back()->size() == BLOCKSIZE)
-            m_blocks.push_back(std::make_unique<block_type>());
-        m_blocks.back()->push_back(std::move(value));
+        appendBlock().push_back(std::move(value));
     }
 
     template<typename... Args>
     reference emplace_back(Args&&... args)
     {
-        if (m_blocks.empty() || m_blocks.back()->size() == BLOCKSIZE)
-            m_blocks.push_back(std::make_unique<block_type>());
-        return m_blocks.back()->emplace_back(std::forward<Args>(args)...);
+        return appendBlock().emplace_back(std::forward<Args>(args)...);
     }
 
     void pop_back()
     {
-        block_type* lastBlock = m_blocks.back();
+        block_type* lastBlock = m_blocks[m_usedBlocks - 1];
         lastBlock->pop_back();
         if (lastBlock->empty())
-            m_blocks.pop_back();
+            --m_usedBlocks;
     }
 
-    void clear() { m_blocks.clear(); }
+    // Destroy the elements and release the memory of all blocks
+    void clear()
+    {
+        m_blocks.clear();
+        m_groups.clear();
+        m_usedBlocks = 0;
+    }
 
     void swap(BlockArray& other) noexcept
     {
         using std::swap;
         swap(m_blocks, other.m_blocks);
+        swap(m_groups, other.m_groups);
+        swap(m_usedBlocks, other.m_usedBlocks);
     }
 
 private:
     using block_type = boost::container::static_vector<T, BLOCKSIZE>;
 
-    std::vector<std::unique_ptr<block_type>> m_blocks;
+    // Upper limit to the number of blocks allocated together when growing
+    static constexpr size_type MaxGroupBlocks = 64;
+
+    // Return the block to which the next element is appended
+    block_type& appendBlock()
+    {
+        if (m_usedBlocks > 0 && m_blocks[m_usedBlocks - 1]->size() < BLOCKSIZE)
+            return *m_blocks[m_usedBlocks - 1];
+
+        if (m_usedBlocks == m_blocks.size())
+            allocateBlocks(std::clamp(m_blocks.size(), size_type{ 1 }, MaxGroupBlocks));
+        return *m_blocks[m_usedBlocks++];
+    }
+
+    void allocateBlocks(size_type count)
+    {
+        auto& group = m_groups.emplace_back(std::make_unique<block_type[]>(count));
+        m_blocks.reserve(m_blocks.size() + count);
+        for (size_type i = 0; i < count; ++i)
+            m_blocks.push_back(&group[i]);
+    }
+
+    // All allocated blocks in order, the first m_usedBlocks of which hold
+    // the elements; the blocks are owned by m_groups.
+    std::vector<block_type*> m_blocks;
+    std::vector<std::unique_ptr<block_type[]>> m_groups;
+    size_type m_usedBlocks{ 0 };
 };
 
 template<typename T, std::size_t BLOCKSIZE1, std::size_t BLOCKSIZE2>
@@ -36,6 +36,7 @@ constexpr std::string_view CelestiaStarCatalogExt = ".stc"sv;
 constexpr std::string_view CelestiaDeepSkyCatalogExt = ".dsc"sv;
 constexpr std::string_view MKVExt = ".mkv"sv;
 constexpr std::string_view DDSExt = ".dds"sv;
+constexpr std::string_view KTX2Ext = ".ktx2"sv;
 constexpr std::string_view DXT5NormalMapExt = ".dxt5nm"sv;
 constexpr std::string_view CelestiaLegacyScriptExt = ".cel"sv;
 constexpr std::string_view CelestiaScriptExt = ".clx"sv;
@@ -44,6 +45,7 @@ constexpr std::string_view CelestiaModelExt = ".cmod"sv;
 constexpr std::string_view CelestiaXYZTrajectoryExt = ".xyz"sv;
 constexpr std::string_view CelestiaXYZVTrajectoryExt = ".xyzv"sv;
 constexpr std::string_view ContentXYZVBinaryExt = ".xyzvbin"sv;
+constexpr std::string_view CelestiaChebyshevTrajectoryExt = ".cheb"sv;
 constexpr std::string_view ContentWarpMeshExt = ".map"sv;
 
 } // end unnamed namespace
@@ -84,6 +86,8 @@ ContentType DetermineFileType(const fs::path& filename, bool isExtension)
         return ContentType::MKV;
     if (compareIgnoringCase(DDSExt, ext) == 0)
         return ContentType::DDS;
+    if (compareIgnoringCase(KTX2Ext, ext) == 0)
+        return ContentType::KTX2;
     if (compareIgnoringCase(CelestiaLegacyScriptExt, ext) == 0)
         return ContentType::CelestiaLegacyScript;
     if (compareIgnoringCase(CelestiaScriptExt, ext) == 0 ||
@@ -101,5 +105,7 @@ ContentType DetermineFileType(const fs::path& filename, bool isExtension)
         return ContentType::WarpMesh;
     if (compareIgnoringCase(ContentXYZVBinaryExt, ext) == 0)
         return ContentType::CelestiaXYZVBinary;
+    if (compareIgnoringCase(CelestiaChebyshevTrajectoryExt, ext) == 0)
+        return ContentType::CelestiaChebyshevTrajectory;
     return ContentType::Unknown;
 }
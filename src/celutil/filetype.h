@@ -38,6 +38,8 @@ enum class ContentType
 #ifdef USE_LIBAVIF
     AVIF                   = 23,
 #endif
+    KTX2                   = 24,
+    CelestiaChebyshevTrajectory = 25,
     Unknown                = -1,
 };
 
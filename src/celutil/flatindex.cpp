@@ -0,0 +1,100 @@
+// flatindex.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Open addressing hash table for 32-bit keys and values.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "flatindex.h"
+
+#include <utility>
+
+namespace celestia::util
+{
+
+namespace
+{
+
+constexpr unsigned int MinCapacityBits = 4;
+
+} // end unnamed namespace
+
+void
+FlatIndex::reset(std::size_t count)
+{
+    unsigned int bits = MinCapacityBits;
+    while (bits < 32 && (std::size_t(1) << bits) < count * 2)
+        ++bits;
+
+    m_slots.assign(std::size_t(1) << bits, Slot{ 0, InvalidValue });
+    m_size = 0;
+    m_shift = 32 - bits;
+}
+
+bool
+FlatIndex::insert(std::uint32_t key, std::uint32_t value)
+{
+    if (value == InvalidValue)
+        return false;
+
+    if ((m_size + 1) * 2 > m_slots.size())
+        grow();
+
+    std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = slotIndex(key);; i = (i + 1) & mask)
+    {
+        Slot& slot = m_slots[i];
+        if (slot.value == InvalidValue)
+        {
+            slot = Slot{ key, value };
+            ++m_size;
+            return true;
+        }
+
+        if (slot.key == key)
+            return false;
+    }
+}
+
+std::uint32_t
+FlatIndex::find(std::uint32_t key) const
+{
+    if (m_size == 0)
+        return InvalidValue;
+
+    std::size_t mask = m_slots.size() - 1;
+    for (std::size_t i = slotIndex(key);; i = (i + 1) & mask)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.value == InvalidValue)
+            return InvalidValue;
+        if (slot.key == key)
+            return slot.value;
+    }
+}
+
+// Fibonacci hashing: catalog numbers are often dense runs of integers,
+// which the multiplication spreads evenly over the table.
+std::size_t
+FlatIndex::slotIndex(std::uint32_t key) const
+{
+    return static_cast<std::size_t>((key * UINT32_C(2654435769)) >> m_shift);
+}
+
+void
+FlatIndex::grow()
+{
+    std::vector<Slot> slots = std::move(m_slots);
+    reset(slots.empty() ? 0 : slots.size());
+    for (const Slot& slot : slots)
+    {
+        if (slot.value != InvalidValue)
+            insert(slot.key, slot.value);
+    }
+}
+
+} // end namespace celestia::util
@@ -0,0 +1,58 @@
+// flatindex.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Open addressing hash table for 32-bit keys and values.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace celestia::util
+{
+
+// Lookup table from 32-bit keys, such as catalog numbers, to 32-bit values.
+// The table is filled once and then only queried. Keys and values are
+// stored together and probed linearly, and the capacity is kept at least
+// twice the number of entries, so a lookup usually reads a single cache
+// line. InvalidValue may not be used as a value: it marks empty slots.
+class FlatIndex
+{
+public:
+    static constexpr std::uint32_t InvalidValue = UINT32_MAX;
+
+    // Remove all entries and size the table for count entries
+    void reset(std::size_t count);
+    // Insert a key unless it is already present. Returns false if the key
+    // was present, in which case the existing value is kept, or if the value
+    // is InvalidValue.
+    bool insert(std::uint32_t key, std::uint32_t value);
+    std::uint32_t find(std::uint32_t key) const;
+
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    std::size_t getMemoryUsage() const { return m_slots.capacity() * sizeof(Slot); }
+
+private:
+    struct Slot
+    {
+        std::uint32_t key;
+        std::uint32_t value;
+    };
+
+    std::size_t slotIndex(std::uint32_t key) const;
+    void grow();
+
+    std::vector<Slot> m_slots;
+    std::size_t m_size{ 0 };
+    unsigned int m_shift{ 32 };
+};
+
+} // end namespace celestia::util
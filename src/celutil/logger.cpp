@@ -9,7 +9,15 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #ifdef _MSC_VER
 #include <windows.h>
@@ -20,6 +28,156 @@
 namespace celestia::util
 {
 
+namespace
+{
+
+// Messages waiting to be written beyond which new ones are dropped
+constexpr std::size_t MaxPendingRecords = 4096;
+
+void FlushLoggerAtExit()
+{
+    if (Logger::g_logger != nullptr)
+        Logger::g_logger->flush();
+}
+
+} // end unnamed namespace
+
+class Logger::AsyncSink
+{
+ public:
+    AsyncSink(Stream &log, Stream &err);
+    ~AsyncSink();
+
+    void push(Level level, std::string &&text);
+    void flush();
+
+ private:
+    struct Record
+    {
+        Level       level;
+        std::string text;
+    };
+
+    void addNotes();
+    void run();
+
+    Stream &m_log;
+    Stream &m_err;
+
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_drained;
+    std::vector<Record>     m_pending;
+    // Last message queued, and how many times it was repeated since
+    Level                   m_lastLevel{ Level::Info };
+    std::string             m_lastText;
+    std::size_t             m_repeats{ 0 };
+    std::size_t             m_dropped{ 0 };
+    bool                    m_writing{ false };
+    bool                    m_stop{ false };
+    std::thread             m_thread;
+};
+
+Logger::AsyncSink::AsyncSink(Stream &log, Stream &err) :
+    m_log(log),
+    m_err(err)
+{
+    m_thread = std::thread(&AsyncSink::run, this);
+}
+
+Logger::AsyncSink::~AsyncSink()
+{
+    flush();
+    {
+        std::scoped_lock lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void
+Logger::AsyncSink::push(Level level, std::string &&text)
+{
+    {
+        std::scoped_lock lock(m_mutex);
+        if (level == m_lastLevel && text == m_lastText)
+        {
+            ++m_repeats;
+            return;
+        }
+
+        addNotes();
+        if (m_pending.size() >= MaxPendingRecords)
+        {
+            ++m_dropped;
+            return;
+        }
+
+        m_lastLevel = level;
+        m_lastText = text;
+        m_pending.push_back({ level, std::move(text) });
+    }
+    m_wake.notify_one();
+}
+
+void
+Logger::AsyncSink::flush()
+{
+    std::unique_lock lock(m_mutex);
+    addNotes();
+    m_wake.notify_one();
+    m_drained.wait(lock, [this] { return m_pending.empty() && !m_writing; });
+}
+
+// Queue the counts of the repeated and dropped messages; called with the
+// mutex locked
+void
+Logger::AsyncSink::addNotes()
+{
+    if (m_repeats > 0)
+    {
+        m_pending.push_back({ m_lastLevel, fmt::format("Last message repeated {} times\n", m_repeats) });
+        m_repeats = 0;
+    }
+
+    if (m_dropped > 0 && m_pending.size() < MaxPendingRecords)
+    {
+        m_pending.push_back({ Level::Warning, fmt::format("{} log messages dropped\n", m_dropped) });
+        m_dropped = 0;
+    }
+}
+
+void
+Logger::AsyncSink::run()
+{
+    std::vector<Record> records;
+    std::unique_lock lock(m_mutex);
+    for (;;)
+    {
+        m_wake.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+        if (m_pending.empty())
+            break;
+
+        records.swap(m_pending);
+        m_writing = true;
+        lock.unlock();
+
+        for (const Record &record : records)
+        {
+            auto &stream = (record.level <= Level::Warning || record.level == Level::Debug) ? m_err : m_log;
+            stream << record.text;
+        }
+        m_log.flush();
+        m_err.flush();
+        records.clear();
+
+        lock.lock();
+        m_writing = false;
+        m_drained.notify_all();
+    }
+}
+
 Logger* Logger::g_logger = nullptr;
 
 Logger* GetLogger()
@@ -27,21 +185,27 @@ Logger* GetLogger()
     return Logger::g_logger;
 }
 
-Logger* CreateLogger(Level level)
+Logger* CreateLogger(Level level, Logger::Mode mode)
 {
-    return CreateLogger(level, std::clog, std::cerr);
+    return CreateLogger(level, std::clog, std::cerr, mode);
 }
 
-Logger* CreateLogger(Level level, Logger::Stream &log, Logger::Stream &err)
+Logger* CreateLogger(Level level, Logger::Stream &log, Logger::Stream &err, Logger::Mode mode)
 {
     if (Logger::g_logger == nullptr)
-        Logger::g_logger = new Logger(level, log, err);
+    {
+        Logger::g_logger = new Logger(level, log, err, mode);
+        // Write the messages still queued when exit() is called
+        if (mode == Logger::Mode::Asynchronous)
+            std::atexit(FlushLoggerAtExit);
+    }
     return Logger::g_logger;
 }
 
 void DestroyLogger()
 {
     delete Logger::g_logger;
+    Logger::g_logger = nullptr;
 }
 
 Logger::Logger() :
@@ -50,6 +214,23 @@ Logger::Logger() :
 {
 }
 
+Logger::Logger(Level level, Stream &log, Stream &err, Mode mode) :
+    m_log(log),
+    m_err(err),
+    m_level(level)
+{
+    if (mode == Mode::Asynchronous)
+        m_async = std::make_unique<AsyncSink>(log, err);
+}
+
+Logger::~Logger() = default;
+
+void Logger::flush() const
+{
+    if (m_async != nullptr)
+        m_async->flush();
+}
+
 void Logger::vlog(Level level, fmt::string_view format, fmt::format_args args) const
 {
 #ifdef _MSC_VER
@@ -60,6 +241,16 @@ void Logger::vlog(Level level, fmt::string_view format, fmt::format_args args) c
     }
 #endif
 
+    if (m_async != nullptr)
+    {
+        m_async->push(level, fmt::vformat(format, args));
+        // Errors may be followed by a crash or an exit, so they are written
+        // right away, after the messages before them
+        if (level == Level::Error)
+            m_async->flush();
+        return;
+    }
+
     auto &stream = (level <= Level::Warning || level == Level::Debug) ? m_err : m_log;
     fmt::vprint(stream, format, args);
 }
@@ -12,6 +12,7 @@
 #pragma once
 
 #include <iosfwd>
+#include <memory>
 #include <string_view>
 
 #ifdef _WIN32
@@ -59,12 +60,24 @@ class Logger
  public:
     using Stream = std::basic_ostream<char>;
 
+    enum class Mode
+    {
+        // Messages are written to the streams before the log functions
+        // return
+        Synchronous,
+        // Messages are formatted by the caller and written by a background
+        // thread; consecutive repeats of a message are counted instead of
+        // written, and messages are dropped while too many are waiting.
+        // Errors are still written before error() returns.
+        Asynchronous,
+    };
+
     Logger();
-    Logger(Level level, Stream &log, Stream &err) :
-        m_log(log),
-        m_err(err),
-        m_level(level)
-    {}
+    Logger(Level level, Stream &log, Stream &err, Mode mode = Mode::Synchronous);
+    ~Logger();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
 
     void setLevel(Level level)
     {
@@ -89,14 +102,20 @@ class Logger
     template <typename... Args> void
     log(Level, const char *format, const Args&... args) const;
 
+    // Wait until all the messages have been written
+    void flush() const;
+
     static Logger* g_logger;
 
  private:
+    class AsyncSink;
+
     void vlog(Level level, fmt::string_view format, fmt::format_args args) const;
 
     Stream &m_log;
     Stream &m_err;
     Level   m_level { Level::Info };
+    std::unique_ptr<AsyncSink> m_async;
 };
 
 template <typename... Args> void
@@ -137,10 +156,12 @@ Logger::error(const char *format, const Args&... args) const
 }
 
 Logger* GetLogger();
-Logger* CreateLogger(Level level = Level::Info);
+Logger* CreateLogger(Level level = Level::Info,
+                     Logger::Mode mode = Logger::Mode::Asynchronous);
 Logger* CreateLogger(Level level,
                      Logger::Stream &log,
-                     Logger::Stream &err);
+                     Logger::Stream &err,
+                     Logger::Mode mode = Logger::Mode::Asynchronous);
 void DestroyLogger();
 
 } // end namespace celestia::util
@@ -0,0 +1,138 @@
+// memoryreport.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Breakdown of the memory used by the subsystems of the engine.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "memoryreport.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include <fmt/format.h>
+
+namespace celestia::util
+{
+
+namespace
+{
+
+std::string
+formatBytes(std::size_t bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return fmt::format("{:.1f} MiB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+    if (bytes >= 1024)
+        return fmt::format("{:.1f} KiB", static_cast<double>(bytes) / 1024.0);
+    return fmt::format("{} B", bytes);
+}
+
+} // end unnamed namespace
+
+void
+MemoryReport::add(std::string_view subsystem, std::string_view item, std::size_t bytes, std::size_t count)
+{
+    auto& entry = m_entries.emplace_back();
+    entry.subsystem = subsystem;
+    entry.item = item;
+    entry.bytes = bytes;
+    entry.count = count;
+}
+
+void
+MemoryReport::addDuplicate(std::string_view subsystem, std::string_view description, std::size_t bytes)
+{
+    auto& duplicate = m_duplicates.emplace_back();
+    duplicate.subsystem = subsystem;
+    duplicate.description = description;
+    duplicate.bytes = bytes;
+}
+
+std::size_t
+MemoryReport::total() const
+{
+    std::size_t bytes = 0;
+    for (const Entry& entry : m_entries)
+        bytes += entry.bytes;
+    return bytes;
+}
+
+std::size_t
+MemoryReport::total(std::string_view subsystem) const
+{
+    std::size_t bytes = 0;
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.subsystem == subsystem)
+            bytes += entry.bytes;
+    }
+    return bytes;
+}
+
+std::string
+MemoryReport::format() const
+{
+    // Subsystems in the order they were first added, then sorted by size
+    std::vector<std::pair<std::string_view, std::size_t>> subsystems;
+    for (const Entry& entry : m_entries)
+    {
+        auto it = std::find_if(subsystems.begin(), subsystems.end(),
+                               [&entry](const auto& s) { return s.first == entry.subsystem; });
+        if (it == subsystems.end())
+            subsystems.emplace_back(entry.subsystem, entry.bytes);
+        else
+            it->second += entry.bytes;
+    }
+
+    std::stable_sort(subsystems.begin(), subsystems.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    fmt::memory_buffer buffer;
+    auto out = std::back_inserter(buffer);
+    fmt::format_to(out, "Memory usage: {}\n", formatBytes(total()));
+    for (const auto& [subsystem, bytes] : subsystems)
+    {
+        fmt::format_to(out, "  {}: {}\n", subsystem, formatBytes(bytes));
+
+        std::vector<const Entry*> items;
+        for (const Entry& entry : m_entries)
+        {
+            if (entry.subsystem == subsystem)
+                items.push_back(&entry);
+        }
+
+        std::stable_sort(items.begin(), items.end(),
+                         [](const Entry* a, const Entry* b) { return a->bytes > b->bytes; });
+        for (const Entry* entry : items)
+        {
+            if (entry->count > 0)
+                fmt::format_to(out, "    {}: {} ({})\n", entry->item, formatBytes(entry->bytes), entry->count);
+            else
+                fmt::format_to(out, "    {}: {}\n", entry->item, formatBytes(entry->bytes));
+        }
+    }
+
+    if (!m_duplicates.empty())
+    {
+        std::size_t duplicated = 0;
+        for (const Duplicate& duplicate : m_duplicates)
+            duplicated += duplicate.bytes;
+
+        fmt::format_to(out, "Duplicates: {}\n", formatBytes(duplicated));
+        for (const Duplicate& duplicate : m_duplicates)
+        {
+            fmt::format_to(out, "  {}: {} ({})\n",
+                           duplicate.subsystem, duplicate.description, formatBytes(duplicate.bytes));
+        }
+    }
+
+    return fmt::to_string(buffer);
+}
+
+} // end namespace celestia::util
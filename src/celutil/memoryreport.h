@@ -0,0 +1,108 @@
+// memoryreport.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Breakdown of the memory used by the subsystems of the engine.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace celestia::util
+{
+
+// The subsystems add the memory they hold to the report when asked, rather
+// than tracking their allocations, so the sizes are estimates: containers
+// are counted by their capacity and an allowance per node, and memory that
+// is shared between objects is counted once, by the subsystem owning it.
+class MemoryReport
+{
+public:
+    struct Entry
+    {
+        std::string subsystem;
+        std::string item;
+        std::size_t bytes;
+        // Number of objects counted in bytes, or zero if meaningless
+        std::size_t count;
+    };
+
+    // Memory held twice, such as the same file loaded by two paths; bytes
+    // is the size of the redundant copy, which is also counted in entries
+    struct Duplicate
+    {
+        std::string subsystem;
+        std::string description;
+        std::size_t bytes;
+    };
+
+    void add(std::string_view subsystem, std::string_view item, std::size_t bytes, std::size_t count = 0);
+    void addDuplicate(std::string_view subsystem, std::string_view description, std::size_t bytes);
+
+    const std::vector<Entry>& entries() const { return m_entries; }
+    const std::vector<Duplicate>& duplicates() const { return m_duplicates; }
+
+    std::size_t total() const;
+    std::size_t total(std::string_view subsystem) const;
+
+    // The subsystems and their items largest first, followed by the
+    // duplicates, one per line
+    std::string format() const;
+
+private:
+    std::vector<Entry> m_entries;
+    std::vector<Duplicate> m_duplicates;
+};
+
+// Estimates of the heap memory held by standard containers, excluding the
+// memory their elements point to
+template<typename T, typename A>
+std::size_t
+ContainerMemoryUsage(const std::vector<T, A>& v)
+{
+    return v.capacity() * sizeof(T);
+}
+
+inline std::size_t
+ContainerMemoryUsage(const std::string& s)
+{
+    // Short strings are stored in the object itself
+    return s.capacity() > std::string().capacity() ? s.capacity() + 1 : 0;
+}
+
+// Tree nodes hold the value, three links and a color
+template<typename K, typename V, typename C, typename A>
+std::size_t
+ContainerMemoryUsage(const std::map<K, V, C, A>& m)
+{
+    return m.size() * (sizeof(typename std::map<K, V, C, A>::value_type) + 4 * sizeof(void*));
+}
+
+template<typename K, typename V, typename C, typename A>
+std::size_t
+ContainerMemoryUsage(const std::multimap<K, V, C, A>& m)
+{
+    return m.size() * (sizeof(typename std::multimap<K, V, C, A>::value_type) + 4 * sizeof(void*));
+}
+
+// Hash nodes hold the value, a link and the cached hash, plus the bucket
+// array
+template<typename K, typename V, typename H, typename E, typename A>
+std::size_t
+ContainerMemoryUsage(const std::unordered_map<K, V, H, E, A>& m)
+{
+    return m.size() * (sizeof(typename std::unordered_map<K, V, H, E, A>::value_type) + 2 * sizeof(void*)) +
+           m.bucket_count() * sizeof(void*);
+}
+
+} // end namespace celestia::util
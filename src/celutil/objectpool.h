@@ -0,0 +1,91 @@
+// objectpool.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Storage for many objects of one type allocated from large blocks.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace celestia::util
+{
+
+// Hands out uninitialized storage for single objects of type T, taken from
+// blocks of BLOCKSIZE slots, so that objects allocated one after the other
+// are adjacent in memory and each allocation doesn't go to the heap. Freed
+// slots are reused; the blocks are only released with the pool. It may be
+// used from several threads.
+template<typename T, std::size_t BLOCKSIZE = 256>
+class ObjectPool
+{
+public:
+    static_assert(BLOCKSIZE > 0, "BLOCKSIZE must be greater than zero");
+
+    ObjectPool() = default;
+    ~ObjectPool() = default;
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    void* allocate()
+    {
+        std::scoped_lock lock(m_mutex);
+        if (m_free != nullptr)
+        {
+            Slot* slot = m_free;
+            m_free = slot->next;
+            return slot->storage;
+        }
+
+        if (m_remaining == 0)
+        {
+            m_next = m_blocks.emplace_back(std::make_unique<Slot[]>(BLOCKSIZE)).get();
+            m_remaining = BLOCKSIZE;
+        }
+
+        --m_remaining;
+        return (m_next++)->storage;
+    }
+
+    void deallocate(void* ptr) noexcept
+    {
+        if (ptr == nullptr)
+            return;
+
+        // storage is the first member, so the slot has the same address
+        auto slot = static_cast<Slot*>(ptr);
+        std::scoped_lock lock(m_mutex);
+        slot->next = m_free;
+        m_free = slot;
+    }
+
+    // Total size of the blocks, in bytes
+    std::size_t capacity() const
+    {
+        std::scoped_lock lock(m_mutex);
+        return m_blocks.size() * BLOCKSIZE * sizeof(Slot);
+    }
+
+private:
+    union Slot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        Slot* next;
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Slot[]>> m_blocks;
+    Slot* m_next{ nullptr };
+    std::size_t m_remaining{ 0 };
+    Slot* m_free{ nullptr };
+};
+
+} // end namespace celestia::util
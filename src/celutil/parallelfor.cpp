@@ -0,0 +1,106 @@
+// parallelfor.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Split a loop over a range of indices across threads.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "parallelfor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+#include "workerpool.h"
+
+namespace celestia::util::detail
+{
+
+namespace
+{
+
+// The chunks of a loop, claimed one by one by the threads taking part. A
+// job of the pool may start after all the chunks were done and the loop has
+// returned, so the state is shared with the jobs, and the body is only
+// called for the chunks claimed before that.
+class ParallelLoop
+{
+public:
+    ParallelLoop(std::size_t count, std::size_t chunkSize, const void* body, LoopBody invoke) :
+        m_count(count),
+        m_chunkSize(chunkSize),
+        m_chunks((count + chunkSize - 1) / chunkSize),
+        m_body(body),
+        m_invoke(invoke)
+    {
+    }
+
+    std::size_t chunks() const { return m_chunks; }
+
+    void work()
+    {
+        std::size_t done = 0;
+        for (std::size_t chunk = m_nextChunk++; chunk < m_chunks; chunk = m_nextChunk++)
+        {
+            m_invoke(m_body, chunk * m_chunkSize, std::min(m_count, (chunk + 1) * m_chunkSize));
+            ++done;
+        }
+
+        if (done == 0)
+            return;
+
+        std::scoped_lock lock(m_mutex);
+        m_done += done;
+        if (m_done == m_chunks)
+            m_finished.notify_all();
+    }
+
+    // The calling thread doesn't wait for the jobs which haven't started,
+    // so that a loop nested in a job of the pool can't deadlock
+    void wait()
+    {
+        std::unique_lock lock(m_mutex);
+        m_finished.wait(lock, [this] { return m_done == m_chunks; });
+    }
+
+private:
+    std::size_t m_count;
+    std::size_t m_chunkSize;
+    std::size_t m_chunks;
+    const void* m_body;
+    LoopBody m_invoke;
+
+    std::atomic<std::size_t> m_nextChunk{ 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+    std::size_t m_done{ 0 };
+};
+
+} // end unnamed namespace
+
+void
+RunParallelLoop(std::size_t count,
+                std::size_t chunkSize,
+                unsigned int nThreads,
+                const void* body,
+                LoopBody invoke)
+{
+    auto loop = std::make_shared<ParallelLoop>(count, chunkSize, body, invoke);
+
+    WorkerPool* pool = GetComputePool();
+    std::size_t nJobs = std::min({ static_cast<std::size_t>(nThreads - 1),
+                                   pool->threadCount(),
+                                   loop->chunks() - 1 });
+    for (std::size_t i = 0; i < nJobs; ++i)
+        pool->submit([loop] { loop->work(); });
+
+    loop->work();
+    loop->wait();
+}
+
+} // end namespace celestia::util::detail
@@ -0,0 +1,62 @@
+// parallelfor.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Split a loop over a range of indices across threads.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+namespace celestia::util
+{
+
+namespace detail
+{
+
+using LoopBody = void (*)(const void*, std::size_t, std::size_t);
+
+// Run the chunks of the loop on the calling thread and up to nThreads - 1
+// threads of the compute pool
+void RunParallelLoop(std::size_t count,
+                     std::size_t chunkSize,
+                     unsigned int nThreads,
+                     const void* body,
+                     LoopBody invoke);
+
+} // end namespace detail
+
+// Call body(begin, end) for consecutive chunks of up to chunkSize indices
+// covering [0, count), on up to maxThreads threads including the calling
+// one, or once for the whole range on a single thread. The other threads are those of the compute pool, so that loops run
+// every frame don't create threads. The chunks run in no particular order,
+// so the body must only write to data owned by its own indices. Returns
+// when all chunks are done.
+template<typename F>
+void
+ParallelFor(std::size_t count, std::size_t chunkSize, unsigned int maxThreads, const F& body)
+{
+    std::size_t chunks = (count + chunkSize - 1) / chunkSize;
+    unsigned int nThreads = std::clamp(std::thread::hardware_concurrency(), 1U, std::max(maxThreads, 1U));
+    if (chunks <= 1 || nThreads == 1)
+    {
+        if (count > 0)
+            body(std::size_t(0), count);
+        return;
+    }
+
+    detail::RunParallelLoop(count, chunkSize, nThreads, &body,
+                            [](const void* f, std::size_t begin, std::size_t end)
+                            {
+                                (*static_cast<const F*>(f))(begin, end);
+                            });
+}
+
+} // end namespace celestia::util
@@ -0,0 +1,256 @@
+// profiler.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Hierarchical CPU and GPU timing of the zones of a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "profiler.h"
+
+#include <map>
+#include <utility>
+
+#include "tracelog.h"
+
+namespace celestia::util
+{
+
+namespace
+{
+
+thread_local Profiler* currentProfiler = nullptr;
+
+// A zone merged with the other zones of the same name and parent
+struct ZoneNode
+{
+    std::string_view name;
+    double cpuTime{ 0.0 };
+    double gpuTime{ 0.0 };
+    unsigned int count{ 0 };
+    bool hasGPUTime{ true };
+    std::vector<std::size_t> children;
+};
+
+void
+flatten(const std::vector<ZoneNode>& nodes,
+        std::size_t index,
+        unsigned int depth,
+        std::vector<ProfileZoneTiming>& result)
+{
+    const ZoneNode& node = nodes[index];
+    auto& timing = result.emplace_back();
+    timing.name = node.name;
+    timing.depth = depth;
+    timing.count = node.count;
+    timing.cpuTime = node.cpuTime;
+    if (node.hasGPUTime)
+        timing.gpuTime = node.gpuTime;
+
+    for (std::size_t child : node.children)
+        flatten(nodes, child, depth + 1, result);
+}
+
+} // end unnamed namespace
+
+Profiler::~Profiler()
+{
+    if (currentProfiler == this)
+        currentProfiler = nullptr;
+}
+
+void
+Profiler::setEnabled(bool enabled)
+{
+    if (enabled == m_enabled)
+        return;
+
+    m_enabled = enabled;
+    if (!enabled)
+    {
+        flush();
+        m_lastFrame.clear();
+    }
+}
+
+void
+Profiler::setGPUTimestampSource(std::unique_ptr<GPUTimestampSource>&& gpu)
+{
+    flush();
+    m_gpu = std::move(gpu);
+}
+
+Profiler*
+Profiler::current()
+{
+    return currentProfiler;
+}
+
+std::uint32_t
+Profiler::recordGPU()
+{
+    return m_gpu == nullptr ? GPUTimestampSource::InvalidTimestamp : m_gpu->record();
+}
+
+void
+Profiler::beginFrame()
+{
+    if (!m_enabled || m_inFrame)
+        return;
+
+    m_inFrame = true;
+    m_depth = 0;
+    m_frame.zones.clear();
+    m_frame.start = clock::now();
+    m_frame.gpuStart = recordGPU();
+    currentProfiler = this;
+}
+
+void
+Profiler::endFrame()
+{
+#ifdef USE_TRACY
+    FrameMark;
+#endif
+    if (!m_inFrame)
+        return;
+
+    m_inFrame = false;
+    currentProfiler = nullptr;
+
+    // Zones left open by an exception are closed at the end of the frame
+    auto end = clock::now();
+    for (Zone& zone : m_frame.zones)
+    {
+        if (zone.end < zone.start)
+            zone.end = end;
+    }
+
+    m_pending.push_back(std::move(m_frame));
+    m_frame = Frame();
+
+    // The timestamps of the GPU complete in order, so the frames do too
+    while (!m_pending.empty() && (m_pending.size() > MaxPendingFrames || isComplete(m_pending.front())))
+    {
+        resolve(m_pending.front());
+        m_pending.pop_front();
+    }
+}
+
+void
+Profiler::flush()
+{
+    while (!m_pending.empty())
+    {
+        resolve(m_pending.front());
+        m_pending.pop_front();
+    }
+}
+
+std::size_t
+Profiler::beginZone(std::string_view name)
+{
+    auto& zone = m_frame.zones.emplace_back();
+    zone.name = name;
+    zone.depth = m_depth++;
+    zone.gpuStart = recordGPU();
+    zone.gpuEnd = GPUTimestampSource::InvalidTimestamp;
+    // Marked as open with an end before the start
+    zone.start = clock::now();
+    zone.end = clock::time_point::min();
+    return m_frame.zones.size() - 1;
+}
+
+void
+Profiler::endZone(std::size_t index)
+{
+    if (!m_inFrame || index >= m_frame.zones.size())
+        return;
+
+    Zone& zone = m_frame.zones[index];
+    zone.end = clock::now();
+    zone.gpuEnd = recordGPU();
+    --m_depth;
+}
+
+bool
+Profiler::isComplete(const Frame& frame) const
+{
+    if (m_gpu == nullptr)
+        return true;
+
+    // The last timestamp of the frame is that of the end of a zone
+    for (auto it = frame.zones.rbegin(); it != frame.zones.rend(); ++it)
+    {
+        if (it->gpuEnd != GPUTimestampSource::InvalidTimestamp)
+            return m_gpu->isAvailable(it->gpuEnd);
+    }
+
+    return frame.gpuStart == GPUTimestampSource::InvalidTimestamp || m_gpu->isAvailable(frame.gpuStart);
+}
+
+void
+Profiler::resolve(Frame& frame)
+{
+    using seconds = std::chrono::duration<double>;
+
+    // All the timestamps are taken to release them, even if unused
+    auto take = [this](std::uint32_t timestamp) -> std::optional<std::uint64_t>
+    {
+        if (m_gpu == nullptr || timestamp == GPUTimestampSource::InvalidTimestamp)
+            return std::nullopt;
+        return m_gpu->take(timestamp);
+    };
+
+    auto gpuFrameStart = take(frame.gpuStart);
+    bool tracing = IsTracing();
+
+    std::vector<ZoneNode> nodes(1);
+    std::map<std::pair<std::size_t, std::string_view>, std::size_t> nodeIndices;
+    std::vector<std::size_t> parents{ 0 };
+    for (const Zone& zone : frame.zones)
+    {
+        auto gpuStart = take(zone.gpuStart);
+        auto gpuEnd = take(zone.gpuEnd);
+
+        parents.resize(zone.depth + 1);
+        std::size_t parent = parents.back();
+        auto [it, inserted] = nodeIndices.try_emplace(std::make_pair(parent, zone.name), nodes.size());
+        if (inserted)
+        {
+            nodes.emplace_back().name = zone.name;
+            nodes[parent].children.push_back(it->second);
+        }
+
+        ZoneNode& node = nodes[it->second];
+        node.cpuTime += seconds(zone.end - zone.start).count();
+        ++node.count;
+        if (gpuStart.has_value() && gpuEnd.has_value())
+            node.gpuTime += static_cast<double>(*gpuEnd - *gpuStart) * 1.0e-9;
+        else
+            node.hasGPUTime = false;
+        parents.push_back(it->second);
+
+        if (!tracing)
+            continue;
+
+        AddTraceEvent(zone.name, "frame", zone.start, zone.end - zone.start);
+        // GPU zones are placed relative to the start of the frame on the CPU
+        if (gpuFrameStart.has_value() && gpuStart.has_value() && gpuEnd.has_value())
+        {
+            AddTraceEvent(zone.name, "gpu",
+                          frame.start + std::chrono::nanoseconds(*gpuStart - *gpuFrameStart),
+                          std::chrono::nanoseconds(*gpuEnd - *gpuStart),
+                          "GPU");
+        }
+    }
+
+    m_lastFrame.clear();
+    for (std::size_t child : nodes.front().children)
+        flatten(nodes, child, 0, m_lastFrame);
+}
+
+} // end namespace celestia::util
@@ -0,0 +1,164 @@
+// profiler.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Hierarchical CPU and GPU timing of the zones of a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#ifdef USE_TRACY
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace celestia::util
+{
+
+// Source of the GPU timestamps of the profiler, implemented with timer
+// queries by the renderer.
+class GPUTimestampSource
+{
+public:
+    static constexpr std::uint32_t InvalidTimestamp = std::numeric_limits<std::uint32_t>::max();
+
+    virtual ~GPUTimestampSource() = default;
+
+    // Record the time at which the GPU completes the commands issued so
+    // far. Returns InvalidTimestamp if no more timestamps can be pending.
+    virtual std::uint32_t record() = 0;
+    virtual bool isAvailable(std::uint32_t) = 0;
+    // Return the time of a recorded timestamp in nanoseconds, waiting for
+    // it if needed, and release it
+    virtual std::uint64_t take(std::uint32_t) = 0;
+};
+
+struct ProfileZoneTiming
+{
+    std::string_view name;
+    unsigned int depth;
+    // Number of zones of the same name and parent summed in the times
+    unsigned int count;
+    // Times in seconds
+    double cpuTime;
+    std::optional<double> gpuTime;
+};
+
+// Times the zones entered between beginFrame() and endFrame() on the
+// thread drawing the frames. Zones entered on other threads or while the
+// profiler is disabled cost a thread local lookup.
+//
+// GPU times are only known a few frames later, so getLastFrame() returns
+// the latest frame whose timestamps the GPU has completed. While a trace
+// is recorded, all the zones are added to it, the GPU ones on a GPU track.
+class Profiler
+{
+public:
+    Profiler() = default;
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void setEnabled(bool);
+    bool isEnabled() const { return m_enabled; }
+
+    void setGPUTimestampSource(std::unique_ptr<GPUTimestampSource>&&);
+    bool hasGPUTimestampSource() const { return m_gpu != nullptr; }
+
+    void beginFrame();
+    void endFrame();
+    // Wait for the GPU times of the pending frames and resolve them
+    void flush();
+
+    const std::vector<ProfileZoneTiming>& getLastFrame() const { return m_lastFrame; }
+
+    // The profiler of the frame being drawn on the calling thread, if any
+    static Profiler* current();
+
+    std::size_t beginZone(std::string_view);
+    void endZone(std::size_t);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Zone
+    {
+        std::string_view name;
+        unsigned int depth;
+        clock::time_point start;
+        clock::time_point end;
+        std::uint32_t gpuStart;
+        std::uint32_t gpuEnd;
+    };
+
+    struct Frame
+    {
+        clock::time_point start;
+        std::uint32_t gpuStart{ GPUTimestampSource::InvalidTimestamp };
+        std::vector<Zone> zones;
+    };
+
+    bool isComplete(const Frame&) const;
+    void resolve(Frame&);
+    std::uint32_t recordGPU();
+
+    static constexpr std::size_t MaxPendingFrames = 4;
+
+    std::unique_ptr<GPUTimestampSource> m_gpu;
+    Frame m_frame;
+    std::deque<Frame> m_pending;
+    std::vector<ProfileZoneTiming> m_lastFrame;
+    unsigned int m_depth{ 0 };
+    bool m_enabled{ false };
+    bool m_inFrame{ false };
+};
+
+// Times the scope it is declared in as a zone of the current frame
+class ProfileZone
+{
+public:
+    explicit ProfileZone(std::string_view name) :
+        m_profiler(Profiler::current())
+    {
+        if (m_profiler != nullptr)
+            m_index = m_profiler->beginZone(name);
+    }
+
+    ~ProfileZone()
+    {
+        if (m_profiler != nullptr)
+            m_profiler->endZone(m_index);
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    Profiler* m_profiler;
+    std::size_t m_index{ 0 };
+};
+
+} // end namespace celestia::util
+
+// Zones are declared with a string literal, which Tracy requires
+#ifdef USE_TRACY
+#define CELESTIA_PROFILE_ZONE(name) \
+    ZoneScopedN(name); \
+    ::celestia::util::ProfileZone celestiaProfileZone_(name)
+#else
+#define CELESTIA_PROFILE_ZONE(name) ::celestia::util::ProfileZone celestiaProfileZone_(name)
+#endif
@@ -9,27 +9,85 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <celcompat/filesystem.h>
+#include <celutil/profiler.h>
 #include <celutil/reshandle.h>
+#include <celutil/uploadbudget.h>
+#include <celutil/workerpool.h>
 
 
 enum class ResourceState {
-    NotLoaded     = 0,
-    Loaded        = 1,
-    LoadingFailed = 2,
+    NotLoaded         = 0,
+    Loaded            = 1,
+    LoadingFailed     = 2,
+    LoadingInProgress = 3,
 };
 
 
+namespace celestia::util::detail
+{
+
+// Resource types which define a PreparedType are loaded in two stages in the
+// background: prepare() reads and decodes the file on a loader thread, and
+// finish() does the work which needs the OpenGL context on the main thread.
+// Other resource types are loaded with load() on the loader thread.
+template<class T, class = void>
+struct ResourceLoadTraits
+{
+    static constexpr bool hasFinish = false;
+    using PreparedType = typename T::ResourceType;
+};
+
+template<class T>
+struct ResourceLoadTraits<T, std::void_t<typename T::PreparedType>>
+{
+    static constexpr bool hasFinish = true;
+    using PreparedType = typename T::PreparedType;
+};
+
+// Resources which have a getMemoryUsage() method count against the memory
+// budget of their manager
+template<class R, class = void>
+struct ResourceMemoryUsage
+{
+    static std::size_t get(const R&) { return 0; }
+};
+
+template<class R>
+struct ResourceMemoryUsage<R, std::void_t<decltype(std::declval<const R&>().getMemoryUsage())>>
+{
+    static std::size_t get(const R& resource) { return resource.getMemoryUsage(); }
+};
+
+} // end namespace celestia::util::detail
+
+
 template<class T> class ResourceManager
 {
  public:
+    using Clock = std::chrono::steady_clock;
+
     explicit ResourceManager(const fs::path& _baseDir) : baseDir(_baseDir) {};
-    ~ResourceManager() = default;
+
+    // Background loads refer to the manager, so wait for them to finish
+    ~ResourceManager()
+    {
+        std::unique_lock lock(mutex);
+        loadDone.wait(lock, [this] { return loadsInFlight == 0; });
+    }
 
     ResourceManager(const ResourceManager&) = delete;
     ResourceManager& operator=(const ResourceManager&) = delete;
@@ -40,6 +98,7 @@ template<class T> class ResourceManager
 
     ResourceHandle getHandle(const T& info)
     {
+        std::lock_guard lock(mutex);
         auto h = static_cast<ResourceHandle>(handles.size());
         if (auto [iter, inserted] = handles.try_emplace(info, h); inserted)
         {
@@ -54,29 +113,239 @@ template<class T> class ResourceManager
 
     ResourceType* find(ResourceHandle h)
     {
+        std::unique_lock lock(mutex);
         if (h < 0 || h >= static_cast<ResourceHandle>(handles.size()))
         {
             return nullptr;
         }
 
-        if (resources[h].state == ResourceState::NotLoaded)
+        InfoType& info = resources[h];
+        if (info.state == ResourceState::NotLoaded)
         {
-            loadResource(resources[h]);
+            loadResource(h);
+        }
+        else if (info.state == ResourceState::LoadingInProgress)
+        {
+            // The resource was requested with findAsync() before
+            waitForLoad(lock, h);
         }
 
-        return resources[h].state == ResourceState::Loaded
-            ? resources[h].resource.get()
-            : nullptr;
+        return use(info);
+    }
+
+    /*! Like find(), but a resource which is not loaded yet is queued for
+     *  loading on the loader threads, and nullptr is returned until the load
+     *  has been completed by finishLoads().
+     */
+    ResourceType* findAsync(ResourceHandle h)
+    {
+        std::unique_lock lock(mutex);
+        if (synchronousLoading)
+        {
+            lock.unlock();
+            return find(h);
+        }
+
+        if (h < 0 || h >= static_cast<ResourceHandle>(handles.size()))
+        {
+            return nullptr;
+        }
+
+        InfoType& info = resources[h];
+        if (info.state == ResourceState::NotLoaded)
+        {
+            startLoad(h);
+        }
+
+        // Needed now, even if it was prefetched
+        info.prefetched = false;
+        return use(info);
+    }
+
+    /*! Queue a resource which is not loaded yet for loading on the loader
+     *  threads, like findAsync(), but without using it, e.g. because it
+     *  will be needed shortly. Nothing is done with synchronous loading, as
+     *  the resource would then be loaded when it is needed anyway.
+     */
+    void prefetch(ResourceHandle h)
+    {
+        std::lock_guard lock(mutex);
+        if (synchronousLoading || h < 0 || h >= static_cast<ResourceHandle>(handles.size()))
+            return;
+
+        if (InfoType& info = resources[h]; info.state == ResourceState::NotLoaded)
+        {
+            info.prefetched = true;
+            startLoad(h);
+        }
+    }
+
+    /*! Make findAsync() wait for the resources to be loaded like find(), so
+     *  that no frame is drawn without them, e.g. for offline rendering.
+     */
+    void setSynchronousLoading(bool enable)
+    {
+        std::lock_guard lock(mutex);
+        synchronousLoading = enable;
+    }
+
+    ResourceState getState(ResourceHandle h) const
+    {
+        std::lock_guard lock(mutex);
+        if (h < 0 || h >= static_cast<ResourceHandle>(handles.size()))
+        {
+            return ResourceState::LoadingFailed;
+        }
+
+        return resources[h].state;
+    }
+
+    /*! Complete the background loads which have finished on the loader
+     *  threads. This must be called on the thread which owns the OpenGL
+     *  context, once per frame. Loads are completed while the budget allows
+     *  them, which is charged with their time and memory usage; prefetched
+     *  resources have the lower priority. The others are kept for the next
+     *  frames.
+     */
+    void finishLoads(celestia::util::UploadBudget& budget)
+    {
+        CELESTIA_PROFILE_ZONE("ResourceManager::finishLoads");
+        using Priority = celestia::util::UploadBudget::Priority;
+
+        std::lock_guard lock(mutex);
+        for (auto iter = completedLoads.begin(); iter != completedLoads.end();)
+        {
+            InfoType& info = resources[iter->handle];
+            if (!budget.allows(info.prefetched ? Priority::Prefetch : Priority::Visible))
+            {
+                budget.defer();
+                ++iter;
+                continue;
+            }
+
+            auto start = Clock::now();
+            CompletedLoad load = std::move(*iter);
+            iter = completedLoads.erase(iter);
+            finishLoad(std::move(load));
+            budget.charge(info.resource != nullptr ? MemoryUsage::get(*info.resource) : 0,
+                          Clock::now() - start);
+        }
+    }
+
+    /*! Like finishLoads() with a budget of the given time only, e.g. for a
+     *  manager whose loads don't compete with the renderer's.
+     */
+    void finishLoads(Clock::duration time)
+    {
+        celestia::util::UploadBudget budget(0, time);
+        finishLoads(budget);
+    }
+
+    /*! Limit the memory used by the loaded resources to budget bytes; zero,
+     *  the default, means no limit. Resources which are over the budget are
+     *  unloaded by nextFrame(), least recently used first, and are loaded
+     *  again when they are needed.
+     */
+    void setMemoryBudget(std::size_t budget)
+    {
+        std::lock_guard lock(mutex);
+        memoryBudget = budget;
+    }
+
+    //! Memory used by the loaded resources, as of the last nextFrame()
+    std::size_t getMemoryUsage() const
+    {
+        std::lock_guard lock(mutex);
+        return memoryUsage;
+    }
+
+    //! Memory held by the loads waiting for finishLoads(), such as decoded
+    //! images which haven't been uploaded yet
+    std::size_t getPendingMemoryUsage() const
+    {
+        std::lock_guard lock(mutex);
+        std::size_t size = 0;
+        for (const CompletedLoad& load : completedLoads)
+        {
+            if (load.data != nullptr)
+                size += PreparedMemoryUsage::get(*load.data);
+        }
+        return size;
+    }
+
+    //! Loads have been started which finishLoads() hasn't completed yet
+    bool hasPendingLoads() const
+    {
+        std::lock_guard lock(mutex);
+        return loadsInFlight > 0 || !completedLoads.empty();
+    }
+
+    std::size_t getLoadedCount() const
+    {
+        std::lock_guard lock(mutex);
+        return loadedHandles.size();
+    }
+
+    /*! Start a new frame for the last-used stamps of the resources, and
+     *  unload the least recently used resources while the memory usage
+     *  exceeds the budget. Resources used in the last MinEvictionAge frames
+     *  are never unloaded, as pointers to them may still be held. This must
+     *  be called on the thread which owns the OpenGL context.
+     */
+    void nextFrame()
+    {
+        std::lock_guard lock(mutex);
+        ++frame;
+
+        // Sizes change as resources are used, e.g. virtual texture tiles
+        memoryUsage = 0;
+        for (ResourceHandle h : loadedHandles)
+        {
+            InfoType& info = resources[h];
+            info.memoryUsage = MemoryUsage::get(*info.resource);
+            memoryUsage += info.memoryUsage;
+        }
+
+        if (memoryBudget == 0 || memoryUsage <= memoryBudget)
+            return;
+
+        std::sort(loadedHandles.begin(), loadedHandles.end(),
+                  [this](ResourceHandle a, ResourceHandle b) { return resources[a].lastUsed < resources[b].lastUsed; });
+
+        auto evicted = loadedHandles.begin();
+        for (; evicted != loadedHandles.end() && memoryUsage > memoryBudget; ++evicted)
+        {
+            InfoType& info = resources[*evicted];
+            if (frame - info.lastUsed <= MinEvictionAge)
+                break;
+
+            memoryUsage -= info.memoryUsage;
+            info.memoryUsage = 0;
+            info.resource.reset();
+            info.state = ResourceState::NotLoaded;
+        }
+
+        loadedHandles.erase(loadedHandles.begin(), evicted);
     }
 
  private:
     using KeyType = typename T::ResourceKey;
+    using LoadTraits = celestia::util::detail::ResourceLoadTraits<T>;
+    using PreparedType = typename LoadTraits::PreparedType;
+    using MemoryUsage = celestia::util::detail::ResourceMemoryUsage<ResourceType>;
+    using PreparedMemoryUsage = celestia::util::detail::ResourceMemoryUsage<PreparedType>;
+
+    static constexpr std::uint32_t MinEvictionAge = 2;
 
     struct InfoType
     {
         T info;
         ResourceState state{ ResourceState::NotLoaded };
         std::shared_ptr<ResourceType> resource{ nullptr };
+        std::size_t memoryUsage{ 0 };
+        std::uint32_t lastUsed{ 0 };
+        // Loaded before being needed; completed after the other loads
+        bool prefetched{ false };
 
         explicit InfoType(T _info) : info(std::move(_info)) {}
         InfoType(const InfoType&) = delete;
@@ -92,7 +361,17 @@ template<class T> class ResourceManager
         }
     };
 
-    using ResourceTable = std::vector<InfoType>;
+    // Result of a background load, waiting for finishLoads()
+    struct CompletedLoad
+    {
+        ResourceHandle handle;
+        KeyType resolvedKey;
+        std::unique_ptr<PreparedType> data;
+    };
+
+    // A deque, so that getHandle() does not move the entries which are
+    // being used on another thread
+    using ResourceTable = std::deque<InfoType>;
     using ResourceHandleMap = std::map<T, ResourceHandle>;
     using NameMap = std::map<KeyType, std::weak_ptr<ResourceType>>;
 
@@ -101,27 +380,134 @@ template<class T> class ResourceManager
     ResourceHandleMap handles{ };
     NameMap loadedResources{ };
 
-    void loadResource(InfoType& info)
+    // Background loads add handles for the resources they depend on, so all
+    // tables are protected by the mutex
+    mutable std::mutex mutex{ };
+    std::condition_variable loadDone{ };
+    std::deque<CompletedLoad> completedLoads{ };
+    unsigned int loadsInFlight{ 0 };
+
+    // Handles of the loaded resources, for the memory budget
+    std::vector<ResourceHandle> loadedHandles{ };
+    std::size_t memoryBudget{ 0 };
+    std::size_t memoryUsage{ 0 };
+    std::uint32_t frame{ 0 };
+    bool synchronousLoading{ false };
+
+    ResourceType* use(InfoType& info)
+    {
+        if (info.state != ResourceState::Loaded)
+            return nullptr;
+
+        info.lastUsed = frame;
+        return info.resource.get();
+    }
+
+    void setLoaded(ResourceHandle h)
+    {
+        InfoType& info = resources[h];
+        info.state = ResourceState::Loaded;
+        info.lastUsed = frame;
+        loadedHandles.push_back(h);
+    }
+
+    bool findLoaded(ResourceHandle h, const KeyType& resolvedKey)
     {
-        KeyType resolvedKey = info.resolve(baseDir);
         std::shared_ptr<ResourceType> resource = nullptr;
         if (auto iter = loadedResources.find(resolvedKey); iter != loadedResources.end())
             resource = iter->second.lock();
 
-        if (resource != nullptr)
+        if (resource == nullptr)
+            return false;
+
+        resources[h].resource = std::move(resource);
+        setLoaded(h);
+        return true;
+    }
+
+    void addLoaded(ResourceHandle h, KeyType&& resolvedKey)
+    {
+        InfoType& info = resources[h];
+        setLoaded(h);
+        if (auto [iter, inserted] = loadedResources.try_emplace(std::move(resolvedKey), info.resource); !inserted)
+            iter->second = info.resource;
+    }
+
+    void loadResource(ResourceHandle h)
+    {
+        CELESTIA_PROFILE_ZONE("ResourceManager::load");
+        InfoType& info = resources[h];
+        KeyType resolvedKey = info.resolve(baseDir);
+        if (findLoaded(h, resolvedKey))
+            return;
+
+        if (info.load(resolvedKey))
+            addLoaded(h, std::move(resolvedKey));
+        else
+            info.state = ResourceState::LoadingFailed;
+    }
+
+    void startLoad(ResourceHandle h)
+    {
+        InfoType& info = resources[h];
+        KeyType resolvedKey = info.resolve(baseDir);
+        if (findLoaded(h, resolvedKey))
+            return;
+
+        info.state = ResourceState::LoadingInProgress;
+        ++loadsInFlight;
+
+        // The job works on copies, as the table may change meanwhile
+        celestia::util::GetLoaderPool()->submit([this, h, loader = info.info, key = std::move(resolvedKey)]() mutable
         {
-            info.resource = std::move(resource);
-            info.state = ResourceState::Loaded;
+            std::unique_ptr<PreparedType> data;
+            if constexpr (LoadTraits::hasFinish)
+                data = loader.prepare(key);
+            else
+                data = loader.load(key);
+
+            {
+                std::lock_guard lock(mutex);
+                completedLoads.push_back(CompletedLoad{ h, std::move(key), std::move(data) });
+                --loadsInFlight;
+            }
+
+            loadDone.notify_all();
+        });
+    }
+
+    void waitForLoad(std::unique_lock<std::mutex>& lock, ResourceHandle h)
+    {
+        for (;;)
+        {
+            auto iter = std::find_if(completedLoads.begin(), completedLoads.end(),
+                                     [h](const CompletedLoad& load) { return load.handle == h; });
+            if (iter != completedLoads.end())
+            {
+                CompletedLoad load = std::move(*iter);
+                completedLoads.erase(iter);
+                finishLoad(std::move(load));
+                return;
+            }
+
+            loadDone.wait(lock);
         }
-        else if (info.load(resolvedKey))
+    }
+
+    void finishLoad(CompletedLoad&& load)
+    {
+        InfoType& info = resources[load.handle];
+        if (load.data != nullptr)
         {
-            info.state = ResourceState::Loaded;
-            if (auto [iter, inserted] = loadedResources.try_emplace(std::move(resolvedKey), info.resource); !inserted)
-                iter->second = info.resource;
+            if constexpr (LoadTraits::hasFinish)
+                info.resource = info.info.finish(load.resolvedKey, std::move(load.data));
+            else
+                info.resource = std::move(load.data);
         }
+
+        if (info.resource != nullptr)
+            addLoaded(load.handle, std::move(load.resolvedKey));
         else
-        {
             info.state = ResourceState::LoadingFailed;
-        }
     }
 };
@@ -0,0 +1,71 @@
+// spscqueue.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Bounded lock-free queue between a single producer and a single consumer.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <type_traits>
+
+namespace celestia::util
+{
+
+// Ring buffer of up to Capacity - 1 elements. push() may only be called by
+// one thread and pop() by one other thread; neither ever blocks.
+template<typename T, std::size_t Capacity>
+class SPSCQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Elements must be trivially copyable");
+
+public:
+    // Returns false if the queue is full
+    bool push(const T& value)
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        std::size_t next = (t + 1) & (Capacity - 1);
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+
+        elements[t] = value;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Returns std::nullopt if the queue is empty
+    std::optional<T> pop()
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return std::nullopt;
+
+        T value = elements[h];
+        head.store((h + 1) & (Capacity - 1), std::memory_order_release);
+        return value;
+    }
+
+    // Only exact when called by the consumer with no push in progress
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // Kept on separate cache lines so that the two threads don't contend
+    // for the line of the index they don't write
+    alignas(64) std::atomic<std::size_t> head{ 0 };
+    alignas(64) std::atomic<std::size_t> tail{ 0 };
+    alignas(64) std::array<T, Capacity> elements{};
+};
+
+} // end namespace celestia::util
@@ -0,0 +1,92 @@
+// stringpool.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "stringpool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace celestia::util
+{
+
+// The moved from pool is left empty, rather than pointing to the free
+// space of a block it no longer owns
+StringPool::StringPool(StringPool&& other) noexcept :
+    m_blocks(std::move(other.m_blocks)),
+    m_largeBlocks(std::move(other.m_largeBlocks)),
+    m_used(std::exchange(other.m_used, 0)),
+    m_next(std::exchange(other.m_next, nullptr)),
+    m_remaining(std::exchange(other.m_remaining, 0)),
+    m_capacity(std::exchange(other.m_capacity, 0))
+{
+    other.m_blocks.clear();
+    other.m_largeBlocks.clear();
+}
+
+StringPool&
+StringPool::operator=(StringPool&& other) noexcept
+{
+    m_blocks = std::move(other.m_blocks);
+    other.m_blocks.clear();
+    m_largeBlocks = std::move(other.m_largeBlocks);
+    other.m_largeBlocks.clear();
+    m_used = std::exchange(other.m_used, 0);
+    m_next = std::exchange(other.m_next, nullptr);
+    m_remaining = std::exchange(other.m_remaining, 0);
+    m_capacity = std::exchange(other.m_capacity, 0);
+    return *this;
+}
+
+std::string_view
+StringPool::add(std::string_view str)
+{
+    std::size_t size = str.size() + 1;
+    char* data;
+    if (size > BlockSize)
+    {
+        // Strings longer than a block get a block of their own, leaving the
+        // current block in use
+        data = m_largeBlocks.emplace_back(std::make_unique<char[]>(size)).get();
+        m_capacity += size;
+    }
+    else
+    {
+        if (size > m_remaining)
+        {
+            if (m_used == m_blocks.size())
+            {
+                m_blocks.emplace_back(std::make_unique<char[]>(BlockSize));
+                m_capacity += BlockSize;
+            }
+
+            m_next = m_blocks[m_used++].get();
+            m_remaining = BlockSize;
+        }
+
+        data = m_next;
+        m_next += size;
+        m_remaining -= size;
+    }
+
+    std::copy(str.begin(), str.end(), data);
+    data[str.size()] = '\0';
+    return std::string_view(data, str.size());
+}
+
+void
+StringPool::clear()
+{
+    m_largeBlocks.clear();
+    m_capacity = m_blocks.size() * BlockSize;
+    m_used = 0;
+    m_next = nullptr;
+    m_remaining = 0;
+}
+
+} // end namespace celestia::util
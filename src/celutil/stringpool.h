@@ -0,0 +1,60 @@
+// stringpool.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Storage for many small strings which are kept until it is destroyed.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace celestia::util
+{
+
+// Copies strings into large blocks instead of allocating each one, such as
+// the names of catalog objects. The copies are never moved, so the views
+// returned stay valid until the pool is destroyed, including after the pool
+// is moved. Each copy is followed by a null character, so its data may be
+// passed to C functions. A pool refilled for each frame can be cleared,
+// which keeps its blocks for the next strings.
+class StringPool
+{
+public:
+    StringPool() = default;
+    ~StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) noexcept;
+    StringPool& operator=(StringPool&&) noexcept;
+
+    std::string_view add(std::string_view str);
+
+    // Invalidate all the views returned so far. The blocks are kept and
+    // reused, except those of the strings longer than a block.
+    void clear();
+
+    // Total size of the blocks, in bytes
+    std::size_t capacity() const { return m_capacity; }
+
+private:
+    static constexpr std::size_t BlockSize = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    // Blocks of the strings longer than BlockSize
+    std::vector<std::unique_ptr<char[]>> m_largeBlocks;
+    // Number of blocks of m_blocks in use
+    std::size_t m_used{ 0 };
+    char* m_next{ nullptr };
+    std::size_t m_remaining{ 0 };
+    std::size_t m_capacity{ 0 };
+};
+
+} // end namespace celestia::util
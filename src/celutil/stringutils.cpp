@@ -10,43 +10,68 @@
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 
-#include <cctype>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include "stringutils.h"
 
-int compareIgnoringCase(std::string_view s1, std::string_view s2)
+namespace
+{
+
+// Upper case of the ASCII letters as by std::toupper in the C locale;
+// the names are UTF-8, whose other bytes must not be changed
+constexpr std::array<unsigned char, 256> UpperCaseTable = []()
+{
+    std::array<unsigned char, 256> table{};
+    for (unsigned int c = 0; c < 256; ++c)
+        table[c] = static_cast<unsigned char>(c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+    return table;
+}();
+
+inline int toUpper(char c)
 {
-    auto i1 = s1.begin();
-    auto i2 = s2.begin();
+    return UpperCaseTable[static_cast<unsigned char>(c)];
+}
 
-    for (;;)
+// Length of the common prefix of the first n characters of s1 and s2,
+// eight bytes at a time
+std::size_t commonPrefix(std::string_view s1, std::string_view s2, std::size_t n)
+{
+    std::size_t length = std::min({ s1.size(), s2.size(), n });
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t))
     {
-        if (i1 == s1.end()) { return i2 == s2.end() ? 0 : -1; }
-        if (i2 == s2.end()) { return 1; }
-        auto c1 = std::toupper(static_cast<unsigned char>(*i1));
-        auto c2 = std::toupper(static_cast<unsigned char>(*i2));
-        if (c1 != c2) { return c1 < c2 ? -1 : 1; }
-        ++i1;
-        ++i2;
+        if (std::memcmp(s1.data() + i, s2.data() + i, sizeof(std::uint64_t)) != 0)
+            break;
     }
+
+    while (i < length && s1[i] == s2[i])
+        ++i;
+
+    return i;
+}
+
+} // end unnamed namespace
+
+int compareIgnoringCase(std::string_view s1, std::string_view s2)
+{
+    return compareIgnoringCase(s1, s2, std::string_view::npos);
 }
 
 int compareIgnoringCase(std::string_view s1,
                         std::string_view s2,
                         std::string_view::size_type n)
 {
-    auto i1 = s1.begin();
-    auto i2 = s2.begin();
-
-    for (;;)
+    std::size_t i = commonPrefix(s1, s2, n);
+    for (;; ++i)
     {
-        if (n-- == 0) { return 0; }
-        if (i1 == s1.end()) { return i2 == s2.end() ? 0 : -1; }
-        if (i2 == s2.end()) { return 1; }
-        auto c1 = std::toupper(static_cast<unsigned char>(*i1));
-        auto c2 = std::toupper(static_cast<unsigned char>(*i2));
+        if (i == n) { return 0; }
+        if (i == s1.size()) { return i == s2.size() ? 0 : -1; }
+        if (i == s2.size()) { return 1; }
+        auto c1 = toUpper(s1[i]);
+        auto c2 = toUpper(s2[i]);
         if (c1 != c2) { return c1 < c2 ? -1 : 1; }
-        ++i1;
-        ++i2;
     }
 }
 
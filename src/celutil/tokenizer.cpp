@@ -158,6 +158,7 @@ public:
     using TokenValue = std::variant<std::monostate, std::int32_t, double, std::string_view, std::string>;
 
     TokenizerImpl(std::istream*, std::size_t);
+    explicit TokenizerImpl(std::string_view);
 
     TokenizerImpl(const TokenizerImpl&) = delete;
     TokenizerImpl& operator=(const TokenizerImpl&) = delete;
@@ -172,6 +173,9 @@ public:
 private:
     std::istream* in;
     std::vector<char> buffer;
+    // The characters being tokenized: the stream buffer, or the whole text
+    // if there is no stream
+    const char* text;
     std::size_t position{ 0 };
     std::size_t length{ 0 };
     TokenValue tokenValue{ std::in_place_type<std::monostate> };
@@ -204,7 +208,16 @@ private:
 
 TokenizerImpl::TokenizerImpl(std::istream* _in, std::size_t _bufferSize)
     : in(_in),
-      buffer(_bufferSize)
+      buffer(_bufferSize),
+      text(buffer.data())
+{}
+
+
+TokenizerImpl::TokenizerImpl(std::string_view _text)
+    : in(nullptr),
+      text(_text.data()),
+      length(_text.size()),
+      isEnded(true)
 {}
 
 
@@ -239,9 +252,9 @@ TokenizerImpl::skipWhitespace()
     for (;;)
     {
         // skip whitespace
-        auto bufferEnd = buffer.cbegin() + length;
-        auto it = std::find_if_not(buffer.cbegin() + position, bufferEnd, isWhitespace);
-        position = it - buffer.cbegin();
+        auto bufferEnd = text + length;
+        auto it = std::find_if_not(text + position, bufferEnd, isWhitespace);
+        position = it - text;
         if (it == bufferEnd)
         {
             if (isEnded) { return Tokenizer::TokenEnd; }
@@ -264,8 +277,8 @@ TokenizerImpl::skipWhitespace()
         // skip comments
         for (;;)
         {
-            it = std::find(buffer.cbegin() + position, bufferEnd, '\n');
-            position = it - buffer.cbegin();
+            it = std::find(text + position, bufferEnd, '\n');
+            position = it - text;
             if (it != bufferEnd)
             {
                 ++lineNumber;
@@ -275,7 +288,7 @@ TokenizerImpl::skipWhitespace()
 
             if (isEnded) { return Tokenizer::TokenEnd; }
             if (!fillBuffer()) { return Tokenizer::TokenError; }
-            bufferEnd = buffer.cbegin() + length;
+            bufferEnd = text + length;
         }
     }
 }
@@ -340,9 +353,9 @@ TokenizerImpl::readToken(char ch)
 bool
 TokenizerImpl::skipUTF8Bom()
 {
-    if (!fillBuffer()) { return false; }
+    if (in != nullptr && !fillBuffer()) { return false; }
     isAtStart = false;
-    if (length >= UTF8_BOM.size() && std::string_view(buffer.data(), UTF8_BOM.size()) == UTF8_BOM)
+    if (length >= UTF8_BOM.size() && std::string_view(text, UTF8_BOM.size()) == UTF8_BOM)
     {
         position += UTF8_BOM.size();
     }
@@ -357,9 +370,9 @@ TokenizerImpl::readName()
     std::size_t endPosition = position + 1;
     do
     {
-        auto bufferEnd = buffer.cbegin() + length;
-        auto it = std::find_if_not(buffer.cbegin() + endPosition, bufferEnd, isName);
-        endPosition = it - buffer.cbegin();
+        auto bufferEnd = text + length;
+        auto it = std::find_if_not(text + endPosition, bufferEnd, isName);
+        endPosition = it - text;
         if (it != bufferEnd || isEnded) { break; }
 
         if (!fillBuffer(&endPosition))
@@ -369,7 +382,7 @@ TokenizerImpl::readName()
         }
     } while (endPosition < length);
 
-    tokenValue.emplace<std::string_view>(buffer.data() + position, endPosition - position);
+    tokenValue.emplace<std::string_view>(text + position, endPosition - position);
     position = endPosition;
 
     return true;
@@ -387,9 +400,9 @@ TokenizerImpl::readNumber()
 
     while (state.part != NumberPart::End)
     {
-        auto bufferEnd = buffer.cbegin() + length;
-        auto it = std::find_if_not(buffer.cbegin() + state.endPosition, bufferEnd, isAsciiDigit);
-        state.endPosition = it - buffer.cbegin();
+        auto bufferEnd = text + length;
+        auto it = std::find_if_not(text + state.endPosition, bufferEnd, isAsciiDigit);
+        state.endPosition = it - text;
         if (it == bufferEnd)
         {
             if (isEnded)
@@ -434,7 +447,7 @@ TokenizerImpl::createNumberState()
 {
     NumberState state;
     state.endPosition = position + 1;
-    if (buffer[position] == '.')
+    if (text[position] == '.')
     {
         // decimal point must be followed by a digit
         if (auto check = peekAt(state.endPosition); !isAsciiDigit(check.value_or('\0')))
@@ -446,7 +459,7 @@ TokenizerImpl::createNumberState()
         state.isInteger = false;
         state.part = NumberPart::Fraction;
     }
-    else if (isSign(buffer[position]))
+    else if (isSign(text[position]))
     {
         // sign must be followed by either a decimal point or a digit
         if (auto check = peekAt(state.endPosition); check == '.')
@@ -528,10 +541,10 @@ TokenizerImpl::setNumber(const NumberState& numberState)
 {
     using celestia::compat::from_chars;
 
-    const char* startPtr = buffer.data() + position;
+    const char* startPtr = text + position;
     if (*startPtr == '+') { ++startPtr; }
 
-    const char* endPtr = buffer.data() + numberState.endPosition;
+    const char* endPtr = text + numberState.endPosition;
     position = numberState.endPosition;
 
     // detect negative zero in order to roundtrip CMOD correctly
@@ -578,7 +591,7 @@ TokenizerImpl::readString()
             return false;
         }
 
-        std::string_view run(buffer.data() + position + state.runStart,
+        std::string_view run(text + position + state.runStart,
                              state.runEnd - state.runStart);
 
         if (!state.checkUTF8(ch, run) && ch != '"') { continue; }
@@ -586,7 +599,7 @@ TokenizerImpl::readString()
         if (!parseChar(state, ch, run)) { return false;}
     }
 
-    const char* startPtr = buffer.data() + position;
+    const char* startPtr = text + position;
     position += state.runEnd + 1;
 
     if (state.runStart == 1)
@@ -671,8 +684,8 @@ TokenizerImpl::parseEscape(StringState& state, char ch)
                 return false;
             }
 
-            const char* uStart = buffer.data() + position + state.runEnd + 2;
-            const char* uEnd = buffer.data() + position + state.runEnd + 6;
+            const char* uStart = text + position + state.runEnd + 2;
+            const char* uEnd = text + position + state.runEnd + 6;
 
             std::uint32_t uch;
             if (auto [ptr, ec] = celestia::compat::from_chars(uStart, uEnd, uch, 16);
@@ -684,7 +697,7 @@ TokenizerImpl::parseEscape(StringState& state, char ch)
             }
             else
             {
-                position = ptr - buffer.data();
+                position = ptr - text;
                 return false;
             }
         }
@@ -740,9 +753,9 @@ TokenizerImpl::fillBuffer(std::size_t* alterOffset)
 std::optional<char>
 TokenizerImpl::peekAt(std::size_t& offset)
 {
-    if (offset < length) { return buffer[offset]; }
+    if (offset < length) { return text[offset]; }
     if (isEnded || !fillBuffer(&offset) || offset >= length) { return std::nullopt; }
-    return buffer[offset];
+    return text[offset];
 }
 
 
@@ -751,6 +764,11 @@ Tokenizer::Tokenizer(std::istream* _in, std::size_t buffer_size)
 {}
 
 
+Tokenizer::Tokenizer(std::string_view text)
+    : impl(std::make_unique<TokenizerImpl>(text))
+{}
+
+
 Tokenizer::~Tokenizer() = default;
 
 
@@ -45,6 +45,10 @@ public:
     static constexpr std::size_t DEFAULT_BUFFER_SIZE = 4096;
 
     Tokenizer(std::istream*, std::size_t = DEFAULT_BUFFER_SIZE);
+    // Tokenize text held in memory, such as a mapped file, without
+    // copying it. The text must outlive the tokenizer: names and strings
+    // without escapes are returned as views into it.
+    explicit Tokenizer(std::string_view);
     ~Tokenizer();
 
     TokenType nextToken();
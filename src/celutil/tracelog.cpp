@@ -0,0 +1,231 @@
+// tracelog.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "tracelog.h"
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include "logger.h"
+
+namespace celestia::util
+{
+
+namespace
+{
+
+struct TraceState
+{
+    std::mutex mutex;
+    std::ofstream file;
+    std::string events;
+    std::chrono::steady_clock::time_point origin;
+    // Small thread numbers are easier to read than thread ids
+    std::unordered_map<std::thread::id, unsigned int> threads;
+    std::map<std::string, unsigned int, std::less<>> tracks;
+};
+
+std::atomic<bool> tracing{ false };
+
+TraceState&
+getTraceState()
+{
+    static TraceState state;
+    return state;
+}
+
+void
+appendJSONString(std::string& dest, std::string_view str)
+{
+    dest.push_back('"');
+    for (char c : str)
+    {
+        switch (c)
+        {
+        case '"':
+            dest.append("\\\"");
+            break;
+        case '\\':
+            dest.append("\\\\");
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                fmt::format_to(std::back_inserter(dest), "\\u{:04x}", static_cast<unsigned int>(c));
+            else
+                dest.push_back(c);
+            break;
+        }
+    }
+    dest.push_back('"');
+}
+
+// Must be called with the mutex held
+unsigned int
+getTrackNumber(TraceState& state, std::string_view track)
+{
+    auto next = static_cast<unsigned int>(state.threads.size() + state.tracks.size()) + 1;
+    if (track.empty())
+        return state.threads.try_emplace(std::this_thread::get_id(), next).first->second;
+
+    if (auto it = state.tracks.find(track); it != state.tracks.end())
+        return it->second;
+
+    state.tracks.try_emplace(std::string(track), next);
+    if (!state.events.empty())
+        state.events.append(",\n");
+    fmt::format_to(std::back_inserter(state.events),
+                   "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":",
+                   next);
+    appendJSONString(state.events, track);
+    state.events.append("}}");
+    return next;
+}
+
+} // end unnamed namespace
+
+bool
+StartTrace(const fs::path& path)
+{
+    TraceState& state = getTraceState();
+    std::scoped_lock lock(state.mutex);
+
+    state.file = std::ofstream(path, std::ios::out | std::ios::trunc);
+    if (!state.file.good())
+    {
+        GetLogger()->error("Unable to open trace file {}\n", path);
+        return false;
+    }
+
+    state.events.clear();
+    state.threads.clear();
+    state.tracks.clear();
+    state.origin = std::chrono::steady_clock::now();
+    tracing = true;
+    return true;
+}
+
+void
+StopTrace()
+{
+    if (!tracing.exchange(false))
+        return;
+
+    TraceState& state = getTraceState();
+    std::scoped_lock lock(state.mutex);
+    state.file << "{\"traceEvents\":[\n" << state.events << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    state.file.close();
+    state.events = std::string();
+}
+
+bool
+IsTracing()
+{
+    return tracing;
+}
+
+TraceScope::TraceScope(std::string_view name, std::string_view category) :
+    m_active(tracing)
+{
+    if (!m_active)
+        return;
+
+    m_event.append("{\"name\":");
+    appendJSONString(m_event, name);
+    m_event.append(",\"cat\":");
+    appendJSONString(m_event, category);
+    m_start = clock::now();
+}
+
+TraceScope::~TraceScope()
+{
+    if (!m_active || !tracing)
+        return;
+
+    auto end = clock::now();
+
+    TraceState& state = getTraceState();
+    std::scoped_lock lock(state.mutex);
+
+    auto threadNumber = getTrackNumber(state, {});
+
+    using microseconds = std::chrono::duration<double, std::micro>;
+    if (!state.events.empty())
+        state.events.append(",\n");
+    state.events.append(m_event);
+    fmt::format_to(std::back_inserter(state.events),
+                   ",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.1f},\"dur\":{:.1f},\"args\":{{{}}}}}",
+                   threadNumber,
+                   microseconds(m_start - state.origin).count(),
+                   microseconds(end - m_start).count(),
+                   m_args);
+}
+
+void
+AddTraceEvent(std::string_view name,
+              std::string_view category,
+              std::chrono::steady_clock::time_point start,
+              std::chrono::steady_clock::duration duration,
+              std::string_view track)
+{
+    if (!tracing)
+        return;
+
+    TraceState& state = getTraceState();
+    std::scoped_lock lock(state.mutex);
+
+    auto trackNumber = getTrackNumber(state, track);
+
+    using microseconds = std::chrono::duration<double, std::micro>;
+    if (!state.events.empty())
+        state.events.append(",\n");
+    state.events.append("{\"name\":");
+    appendJSONString(state.events, name);
+    state.events.append(",\"cat\":");
+    appendJSONString(state.events, category);
+    fmt::format_to(std::back_inserter(state.events),
+                   ",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.1f},\"dur\":{:.1f}}}",
+                   trackNumber,
+                   microseconds(start - state.origin).count(),
+                   microseconds(duration).count());
+}
+
+void
+TraceScope::addArg(std::string_view key, std::uint64_t value)
+{
+    if (!m_active)
+        return;
+
+    if (!m_args.empty())
+        m_args.push_back(',');
+    appendJSONString(m_args, key);
+    fmt::format_to(std::back_inserter(m_args), ":{}", value);
+}
+
+void
+TraceScope::addArg(std::string_view key, std::string_view value)
+{
+    if (!m_active)
+        return;
+
+    if (!m_args.empty())
+        m_args.push_back(',');
+    appendJSONString(m_args, key);
+    m_args.push_back(':');
+    appendJSONString(m_args, value);
+}
+
+} // end namespace celestia::util
@@ -0,0 +1,64 @@
+// tracelog.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Timed scopes written to a file in the Chrome trace event format.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia::util
+{
+
+// Start recording the trace scopes of all threads, to be written to a file
+// which may be opened with chrome://tracing or https://ui.perfetto.dev.
+// Returns false if the file can't be created.
+bool StartTrace(const fs::path& path);
+// Write the events recorded since StartTrace() and stop recording
+void StopTrace();
+bool IsTracing();
+
+// Add a complete event timed by the caller while a trace is started, on the
+// track of the calling thread or else on the named track, such as "GPU"
+void AddTraceEvent(std::string_view name,
+                   std::string_view category,
+                   std::chrono::steady_clock::time_point start,
+                   std::chrono::steady_clock::duration duration,
+                   std::string_view track = {});
+
+// Records the time from its construction to its destruction as a complete
+// event while a trace is started, with the arguments added to it, such as
+// sizes and object counts. Does nothing otherwise.
+class TraceScope
+{
+public:
+    explicit TraceScope(std::string_view name, std::string_view category = "load");
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    void addArg(std::string_view key, std::uint64_t value);
+    void addArg(std::string_view key, std::string_view value);
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    bool m_active;
+    std::string m_event;
+    std::string m_args;
+    clock::time_point m_start;
+};
+
+} // end namespace celestia::util
@@ -17,6 +17,7 @@
 #include <celutil/flag.h>
 #include <celutil/includeicu.h>
 #include <celutil/uniquedel.h>
+#include <celutil/utf8.h>
 
 using celestia::util::is_set;
 
@@ -82,23 +83,24 @@ UTF8StringToUnicodeString(std::string_view input, std::u16string &output)
         return true;
     }
 
-    std::int32_t requiredSize;
-    UErrorCode error = U_ZERO_ERROR;
+    if (UTF8IsASCII(input))
+    {
+        output.assign(input.begin(), input.end());
+        return true;
+    }
 
-    // dry run to get the required size for unicode string
+    // A string never has more UTF-16 code units than UTF-8 bytes, so the
+    // conversion needs no dry run to find the size of the output
+    std::int32_t length;
+    UErrorCode error = U_ZERO_ERROR;
     auto inputLength = static_cast<std::int32_t>(input.size());
-    u_strFromUTF8(nullptr, 0, &requiredSize, input.data(), inputLength, &error);
-    if (U_FAILURE(error) && error != U_BUFFER_OVERFLOW_ERROR)
+    output.resize(input.size());
+    u_strFromUTF8(output.data(), inputLength, &length, input.data(), inputLength, &error);
+    if (U_FAILURE(error))
         return false;
 
-    output.resize(requiredSize);
-
-    // Clear the error to be reused
-    error = U_ZERO_ERROR;
-
-    // Get the actual data
-    u_strFromUTF8(output.data(), requiredSize, nullptr, input.data(), inputLength, &error);
-    return U_SUCCESS(error);
+    output.resize(static_cast<std::size_t>(length));
+    return true;
 }
 
 
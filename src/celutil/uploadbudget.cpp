@@ -0,0 +1,79 @@
+// uploadbudget.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Limit on the data uploaded to the graphics card in a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "uploadbudget.h"
+
+#include <memory>
+
+namespace celestia::util
+{
+
+namespace
+{
+
+// Limits until they are set from the configuration
+constexpr std::size_t DefaultMaxBytes = 32 * 1024 * 1024;
+constexpr std::chrono::milliseconds DefaultMaxTime{ 6 };
+
+} // end unnamed namespace
+
+UploadBudget::UploadBudget(std::size_t maxBytes, Clock::duration maxTime) :
+    m_maxBytes(maxBytes),
+    m_maxTime(maxTime)
+{
+}
+
+void
+UploadBudget::setLimits(std::size_t maxBytes, Clock::duration maxTime)
+{
+    m_maxBytes = maxBytes;
+    m_maxTime = maxTime;
+}
+
+void
+UploadBudget::beginFrame()
+{
+    m_bytes = 0;
+    m_time = Clock::duration::zero();
+    m_uploads = 0;
+    m_deferred = 0;
+}
+
+bool
+UploadBudget::allows(Priority priority) const
+{
+    if (priority == Priority::Visible && m_uploads == 0)
+        return true;
+
+    // Prefetches stop at half the limits, keeping the rest for what is
+    // needed right away
+    std::size_t maxBytes = priority == Priority::Prefetch ? m_maxBytes / 2 : m_maxBytes;
+    Clock::duration maxTime = priority == Priority::Prefetch ? m_maxTime / 2 : m_maxTime;
+    return (m_maxBytes == 0 || m_bytes < maxBytes) &&
+           (m_maxTime == Clock::duration::zero() || m_time < maxTime);
+}
+
+void
+UploadBudget::charge(std::size_t bytes, Clock::duration time)
+{
+    m_bytes += bytes;
+    m_time += time;
+    ++m_uploads;
+}
+
+UploadBudget*
+GetUploadBudget()
+{
+    static UploadBudget* const budget = std::make_unique<UploadBudget>(DefaultMaxBytes, DefaultMaxTime).release(); //NOSONAR
+    return budget;
+}
+
+} // end namespace celestia::util
@@ -0,0 +1,74 @@
+// uploadbudget.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Limit on the data uploaded to the graphics card in a frame.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace celestia::util
+{
+
+// Shares the bytes and the time which may be spent on uploads in a frame
+// between the streams which finish loads on the main thread, so that a
+// burst of completed loads is spread over several frames instead of
+// causing a hitch. Uploads of resources which are being drawn take
+// precedence over prefetches: these only get the first half of the
+// budget. It must be used on the thread which owns the OpenGL context.
+class UploadBudget
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Priority
+    {
+        Visible,
+        Prefetch,
+    };
+
+    UploadBudget() = default;
+    UploadBudget(std::size_t maxBytes, Clock::duration maxTime);
+
+    // Limits for each frame; zero means no limit
+    void setLimits(std::size_t maxBytes, Clock::duration maxTime);
+
+    // Start counting the uploads of a new frame
+    void beginFrame();
+
+    // Return true if an upload of the given priority may be done in this
+    // frame. The first visible upload of a frame is always allowed, so
+    // that an upload bigger than the budget still gets done.
+    bool allows(Priority priority) const;
+
+    // Count an upload which was done, and one which was put off to a
+    // later frame
+    void charge(std::size_t bytes, Clock::duration time);
+    void defer() { ++m_deferred; }
+
+    std::size_t getUploadedBytes() const { return m_bytes; }
+    std::uint32_t getUploadCount() const { return m_uploads; }
+    std::uint32_t getDeferredCount() const { return m_deferred; }
+
+private:
+    std::size_t m_maxBytes{ 0 };
+    Clock::duration m_maxTime{ Clock::duration::zero() };
+
+    std::size_t m_bytes{ 0 };
+    Clock::duration m_time{ Clock::duration::zero() };
+    std::uint32_t m_uploads{ 0 };
+    std::uint32_t m_deferred{ 0 };
+};
+
+// Budget shared by the renderer's resource streams
+UploadBudget* GetUploadBudget();
+
+} // end namespace celestia::util
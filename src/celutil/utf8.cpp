@@ -10,7 +10,9 @@
 
 #include "utf8.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <cwctype>
 
 
@@ -325,8 +327,67 @@ inline std::int32_t UTF8Normalize(std::int32_t ch)
     return static_cast<std::int32_t>((*normTable)[index]);
 }
 
+// Every byte of an eight byte word with its high bit set
+constexpr std::uint64_t HighBits = UINT64_C(0x8080808080808080);
+
+inline std::uint64_t loadWord(const char* p)
+{
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+inline bool isASCII(char c)
+{
+    return (static_cast<unsigned char>(c) & 0x80) == 0;
+}
+
+// Normalized form of an ASCII character, which only folds the case
+inline std::int32_t normalizeASCII(char c)
+{
+    return static_cast<std::int32_t>(WGL4_Normalization_00[static_cast<unsigned char>(c)]);
+}
+
+// Length of the common prefix of s0 and s1 which is only ASCII, eight bytes
+// at a time
+std::int32_t commonASCIIPrefix(std::string_view s0, std::string_view s1)
+{
+    std::size_t length = std::min(s0.size(), s1.size());
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t))
+    {
+        std::uint64_t w0 = loadWord(s0.data() + i);
+        if (w0 != loadWord(s1.data() + i) || (w0 & HighBits) != 0)
+            break;
+    }
+
+    while (i < length && s0[i] == s1[i] && isASCII(s0[i]))
+        ++i;
+
+    return static_cast<std::int32_t>(i);
+}
+
 } // namespace
 
+//! Return true if str only holds ASCII characters
+bool UTF8IsASCII(std::string_view str)
+{
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= str.size(); i += sizeof(std::uint64_t))
+    {
+        if ((loadWord(str.data() + i) & HighBits) != 0)
+            return false;
+    }
+
+    for (; i < str.size(); ++i)
+    {
+        if (!isASCII(str[i]))
+            return false;
+    }
+
+    return true;
+}
+
 //! Decode the UTF-8 character at the start of the string str. The decoded
 //! character is returned in ch; the return value of the function is true if
 //! a valid UTF-8 sequence was successfully decoded.
@@ -412,12 +473,21 @@ int UTF8StringCompare(std::string_view s0, std::string_view s1)
 {
     auto len0 = static_cast<std::int32_t>(s0.size());
     auto len1 = static_cast<std::int32_t>(s1.size());
-    std::int32_t i0 = 0;
-    std::int32_t i1 = 0;
+    std::int32_t i0 = commonASCIIPrefix(s0, s1);
+    std::int32_t i1 = i0;
     for (;;)
     {
         std::int32_t ch0;
         std::int32_t ch1;
+        if (i0 < len0 && i1 < len1 && isASCII(s0[i0]) && isASCII(s1[i1]))
+        {
+            ch0 = normalizeASCII(s0[i0++]);
+            ch1 = normalizeASCII(s1[i1++]);
+            if (ch0 != ch1)
+                return ch0 < ch1 ? -1 : 1;
+            continue;
+        }
+
         if (i0 >= len0 || !UTF8Decode(s0, i0, ch0))
             return (i1 >= len1 || !UTF8Decode(s1, i1, ch1)) ? 0 : -1;
         if (i1 >= len1 || !UTF8Decode(s1, i1, ch1))
@@ -437,8 +507,9 @@ bool UTF8StartsWith(std::string_view str, std::string_view prefix, bool ignoreCa
 {
     auto len0 = static_cast<std::int32_t>(str.size());
     auto len1 = static_cast<std::int32_t>(prefix.size());
-    std::int32_t i0 = 0;
-    std::int32_t i1 = 0;
+    // Equal characters are equal however they are folded
+    std::int32_t i0 = commonASCIIPrefix(str, prefix);
+    std::int32_t i1 = i0;
     for (;;)
     {
         std::int32_t ch0;
@@ -464,6 +535,46 @@ bool UTF8StartsWith(std::string_view str, std::string_view prefix, bool ignoreCa
     }
 }
 
+//! Append to dest the characters of str normalized and converted to lower
+//! case as UTF8StartsWith() compares them when ignoring case, so that a
+//! string starts with a prefix if and only if their folded forms do.  A
+//! folding stops and returns false at an invalid sequence.
+bool UTF8FoldCase(std::string_view str, std::string &dest)
+{
+    dest.reserve(dest.size() + str.size());
+
+    auto len = static_cast<std::int32_t>(str.size());
+    std::int32_t i = 0;
+    while (i < len)
+    {
+        // The normalization of ASCII characters already converts them to
+        // lower case
+        if (isASCII(str[i]))
+        {
+            dest.push_back(static_cast<char>(normalizeASCII(str[i++])));
+            continue;
+        }
+
+        std::int32_t start = i;
+        std::int32_t ch;
+        if (!UTF8Decode(str, i, ch))
+            return false;
+
+        std::int32_t folded = UTF8Normalize(ch);
+        if (folded >= 0 && folded <= WCHAR_MAX)
+            folded = static_cast<std::int32_t>(std::towlower(static_cast<std::wint_t>(folded)));
+
+        // Unchanged characters are copied, as UTF8Encode() may not support
+        // all of them
+        if (folded == ch)
+            dest.append(str.substr(static_cast<std::size_t>(start), static_cast<std::size_t>(i - start)));
+        else
+            UTF8Encode(static_cast<std::uint32_t>(folded), dest);
+    }
+
+    return true;
+}
+
 std::int32_t
 UTF8Validator::check(unsigned char c)
 {
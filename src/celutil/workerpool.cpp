@@ -0,0 +1,101 @@
+// workerpool.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Fixed set of threads running queued jobs.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "workerpool.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace celestia::util
+{
+
+namespace
+{
+
+// Loading is mostly bound by disk and decompression, and should leave the
+// render thread a core of its own
+constexpr unsigned int MaxLoaderThreads = 4;
+
+// The parallel loops use the calling thread too
+constexpr unsigned int MaxComputeThreads = 15;
+
+} // end unnamed namespace
+
+WorkerPool::WorkerPool(unsigned int nThreads)
+{
+    m_threads.reserve(nThreads);
+    for (unsigned int i = 0; i < nThreads; ++i)
+        m_threads.emplace_back(&WorkerPool::run, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+        m_jobs.clear();
+    }
+
+    m_jobAvailable.notify_all();
+    for (std::thread& thread : m_threads)
+        thread.join();
+}
+
+void
+WorkerPool::submit(std::function<void()>&& job)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+
+    m_jobAvailable.notify_one();
+}
+
+void
+WorkerPool::run()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_jobAvailable.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+            if (m_stopping)
+                return;
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+WorkerPool*
+GetLoaderPool()
+{
+    // Like the resource managers, the pool lives until the program exits
+    static WorkerPool* const pool = std::make_unique<WorkerPool>(
+        std::clamp(std::thread::hardware_concurrency(), 2U, MaxLoaderThreads + 1) - 1).release(); //NOSONAR
+    return pool;
+}
+
+WorkerPool*
+GetComputePool()
+{
+    static WorkerPool* const pool = std::make_unique<WorkerPool>(
+        std::clamp(std::thread::hardware_concurrency(), 2U, MaxComputeThreads + 1) - 1).release(); //NOSONAR
+    return pool;
+}
+
+} // end namespace celestia::util
@@ -0,0 +1,56 @@
+// workerpool.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Fixed set of threads running queued jobs.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace celestia::util
+{
+
+// Runs jobs on a fixed number of threads, in the order they were submitted.
+// The destructor waits for the jobs which are already running, discards the
+// ones which have not started, and joins the threads.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned int nThreads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()>&& job);
+
+    std::size_t threadCount() const { return m_threads.size(); }
+
+private:
+    void run();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    bool m_stopping{ false };
+};
+
+// The pool shared by the resource managers for reading and decoding files
+WorkerPool* GetLoaderPool();
+
+// The pool running the parallel loops of ParallelFor
+WorkerPool* GetComputePool();
+
+} // end namespace celestia::util
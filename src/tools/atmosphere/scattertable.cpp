@@ -40,8 +40,11 @@
 #include <cstdlib>
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 #include <map>
 #include <cassert>
+#include <thread>
+#include <vector>
 #include <Eigen/Core>
 #include <celmath/mathlib.h>
 
@@ -55,6 +58,7 @@ constexpr const unsigned int SunAngleSamples = 32;
 
 // Values settable via the command line
 static unsigned int ScatteringIntegrationSteps = 25;
+static unsigned int ThreadCount = 0;
 
 typedef map<string, double> ParameterSet;
 
@@ -86,6 +90,7 @@ public:
         return planetRadius + max(mieScaleHeight, rayleighScaleHeight) * 8.0f;
     }
 
+    // Returns nullptr when the table contains NaNs
     Vector3f* computeTransmittanceTable() const;
     Vector4f* computeInscatterTable() const;
 
@@ -105,26 +110,31 @@ public:
 //     - pathLength is the distance that the ray travels through the atmosphere
 //     - H is the scale height
 //     - R is the planet radius
-float opticalDepth(float r, float mu, float l, float H, float R)
-{
-    float a = sqrt(r * 0.5 / H);
-    float bx = a * mu;
-    float by = a * (mu + l / r);
-    float sbx = math::sign(bx);
-    float sby = math::sign(by);
-    float x = sby > sbx ? exp(bx * bx) : 0.0f;
-    float yx = sbx / (2.3193f * abs(bx) + sqrt(1.52f * bx * bx + 4.0f));
-    float yy = sby / (2.3193f * abs(by) + sqrt(1.52f * by * by + 4.0f)) *
-        exp(-l / H * (l / (2.0f * r) + mu));
-
-    return sqrt(6.2831f * H * r) * exp((R - r) / H) * (x + yx - yy);
+// The depths for the Rayleigh and Mie scale heights are computed together,
+// one in each lane of H.
+Array2f opticalDepth(float r, float mu, float l, const Array2f& H, float R)
+{
+    Array2f a = (r * 0.5f / H).sqrt();
+    Array2f bx = a * mu;
+    Array2f by = a * (mu + l / r);
+    Array2f sbx = bx.sign();
+    Array2f sby = by.sign();
+    Array2f x = (sby > sbx).select(bx.square().exp(), Array2f::Zero());
+    Array2f yx = sbx / (2.3193f * bx.abs() + (1.52f * bx.square() + 4.0f).sqrt());
+    Array2f yy = sby / (2.3193f * by.abs() + (1.52f * by.square() + 4.0f).sqrt()) *
+        (-l / H * (l / (2.0f * r) + mu)).exp();
+
+    return (6.2831f * H * r).sqrt() * ((R - r) / H).exp() * (x + yx - yy);
 }
 
 
 Vector3f transmittance(float r, float mu, float l, const Atmosphere& atm)
 {
-    float depthR = opticalDepth(r, mu, l, atm.rayleighScaleHeight, atm.planetRadius);
-    float depthM = opticalDepth(r, mu, l, atm.mieScaleHeight, atm.planetRadius);
+    Array2f depth = opticalDepth(r, mu, l,
+                                 Array2f(atm.rayleighScaleHeight, atm.mieScaleHeight),
+                                 atm.planetRadius);
+    float depthR = depth.x();
+    float depthM = depth.y();
     return (-depthR * atm.rayleighCoeff
             - depthM * Vector3f::Constant(atm.mieCoeff)
             - depthM * atm.absorptionCoeff).array().exp();
@@ -158,6 +168,26 @@ static inline float toMuS(float u)
 }
 
 
+// Call task(i) for i in [0, count) on ThreadCount threads
+template<typename F>
+static void parallelFor(unsigned int count, F&& task)
+{
+    atomic<unsigned int> next{ 0 };
+    auto worker = [&]()
+    {
+        for (unsigned int i = next++; i < count; i = next++)
+            task(i);
+    };
+
+    vector<thread> threads;
+    for (unsigned int i = 1; i < min(ThreadCount, count); ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (thread& t : threads)
+        t.join();
+}
+
+
 Vector3f*
 Atmosphere::computeTransmittanceTable() const
 {
@@ -207,7 +237,8 @@ Atmosphere::computeTransmittanceTable() const
                 cout << "NaN in transmittance table at (" << j << ", " << i << ")\n";
                 cout << transmittanceTable[index].x() << endl;
                 cout << "r=" << r << ", mu=" << mu << ", l=" << pathLength << endl;
-                exit(1);
+                delete[] transmittanceTable;
+                return nullptr;
             }
 
             if (transmittanceTable[index].x() > 1.0f)
@@ -251,7 +282,9 @@ Atmosphere::computeInscatterTable() const
 
         Vector2f eye(0.0f, r);
 
-        for (unsigned int j = 0; j < ViewAngleSamples; ++j)
+        // The view angles of a layer are independent and integrated in
+        // parallel
+        parallelFor(ViewAngleSamples, [&](unsigned int j)
         {
             float v = float(j) / float(ViewAngleSamples - 1);
             float mu = max(-1.0f, min(1.0f, toMu(v)));
@@ -273,6 +306,18 @@ Atmosphere::computeInscatterTable() const
                 pathLength = -r * cosTheta + sqrt(Rt2 - r2 * sinTheta2);
             }
 
+            float stepLength = pathLength / float(ScatteringIntegrationSteps);
+            Vector2f step = view * stepLength;
+
+            // Compute the transmittance along the path to the viewer from
+            // each sample; it doesn't depend on the sun angle.
+            vector<Vector3f> viewPathTransmittance(ScatteringIntegrationSteps);
+            for (unsigned int m = 0; m < ScatteringIntegrationSteps; ++m)
+            {
+                float distanceToViewer = stepLength * m;
+                viewPathTransmittance[m] = transmittance(r, mu, distanceToViewer, *this);
+            }
+
             for (unsigned int k = 0; k < SunAngleSamples; ++k)
             {
                 float w = float(k) / float(SunAngleSamples - 1);
@@ -281,22 +326,15 @@ Atmosphere::computeInscatterTable() const
                 float sinPhi = sqrt(max(0.0f, 1.0f - cosPhi * cosPhi));
                 Vector2f sun(sinPhi, cosPhi);
 
-                float stepLength = pathLength / float(ScatteringIntegrationSteps);
-                Vector2f step = view * stepLength;
-
                 Vector3f rayleigh = Vector3f::Zero();
                 float mie = 0.0f;
 
                 for (unsigned int m = 0; m < ScatteringIntegrationSteps; ++m)
                 {
                     Vector2f x = eye + step * m;
-                    float distanceToViewer = stepLength * m;
                     float rx2 = x.squaredNorm();
                     float rx = sqrt(rx2);
 
-                    // Compute the transmittance along the path to the viewer
-                    Vector3f viewPathTransmittance = transmittance(r, mu, distanceToViewer, *this);
-
                     // Compute the cosine and sine of the angle between the
                     // sun direction and zenith at the current sample.
                     float c = x.dot(sun) / rx;
@@ -312,7 +350,7 @@ Atmosphere::computeInscatterTable() const
                         float sunPathLength = -rx * c + sqrt(Rt2 - rx2 * s2);
                         Vector3f sunPathTransmittance = transmittance(rx, c, sunPathLength, *this);
 
-                        t = viewPathTransmittance.cwiseProduct(sunPathTransmittance);
+                        t = viewPathTransmittance[m].cwiseProduct(sunPathTransmittance);
                     }
                     else
                     {
@@ -330,12 +368,6 @@ Atmosphere::computeInscatterTable() const
                 unsigned int index = (i * ViewAngleSamples + j) * SunAngleSamples + k;
                 inscatter[index] << rayleigh.cwiseProduct(rayleighCoeff),
                                     mie * mieCoeff;
-                if (i == HeightSamples - 1 && k == 0)
-                {
-                    cout << acos(muS) * 180.0/M_PI << ", "
-                         << acos(mu) * 180.0/M_PI << ", "
-                         << inscatter[index].transpose() << endl;
-                }
 
 #if 0
                 // Emit warnings about NaNs in scatter table
@@ -345,7 +377,17 @@ Atmosphere::computeInscatterTable() const
                 }
 #endif
             }
-        }
+        });
+    }
+
+    float muS = toMuS(0.0f);
+    for (unsigned int j = 0; j < ViewAngleSamples; ++j)
+    {
+        float mu = max(-1.0f, min(1.0f, toMu(float(j) / float(ViewAngleSamples - 1))));
+        unsigned int index = ((HeightSamples - 1) * ViewAngleSamples + j) * SunAngleSamples;
+        cout << acos(muS) * 180.0/M_PI << ", "
+             << acos(mu) * 180.0/M_PI << ", "
+             << inscatter[index].transpose() << endl;
     }
 
     return inscatter;
@@ -355,11 +397,15 @@ Atmosphere::computeInscatterTable() const
 
 void usage()
 {
-    cerr << "Usage: scattertable [options] <config file>\n";
+    cerr << "Usage: scattertable [options] <config file> [<config file>...]\n";
     cerr << "   --output <filename> (or -o) : set filename of output image\n";
     cerr << "           (default is out.atm)\n";
     cerr << "   --scattersteps <value> (or -s)\n";
     cerr << "           set the number of integration steps for scattering\n";
+    cerr << "   --threads <value> (or -j)\n";
+    cerr << "           set the number of threads (default is one per core)\n";
+    cerr << "With several config files, the tables of each atmosphere are\n";
+    cerr << "named after its config file, e.g. earth-inscatter.dds\n";
 }
 
 
@@ -461,13 +507,12 @@ bool LoadParameterSet(ParameterSet& params, const string& filename)
 }
 
 
-string ConfigFileName;
+vector<string> ConfigFileNames;
 string OutputFileName("out.atm");
 
 bool parseCommandLine(int argc, char* argv[])
 {
     int i = 1;
-    int fileCount = 0;
 
     while (i < argc)
     {
@@ -490,6 +535,15 @@ bool parseCommandLine(int argc, char* argv[])
                 OutputFileName = string(argv[i + 1]);
                 i++;
             }
+            else if (!strcmp(argv[i], "-j") || !strcmp(argv[i], "--threads"))
+            {
+                if (i == argc - 1)
+                    return false;
+
+                if (sscanf(argv[i + 1], " %u", &ThreadCount) != 1)
+                    return false;
+                i++;
+            }
             else
             {
                 return false;
@@ -498,17 +552,9 @@ bool parseCommandLine(int argc, char* argv[])
         }
         else
         {
-            if (fileCount == 0)
-            {
-                // input filename first
-                ConfigFileName = string(argv[i]);
-                fileCount++;
-            }
-            else
-            {
-                // more than one filenames on the command line is an error
-                return false;
-            }
+            // Several config files generate the tables of several
+            // atmospheres in one run
+            ConfigFileNames.emplace_back(argv[i]);
             i++;
         }
     }
@@ -868,20 +914,15 @@ int main(void)
 }
 #endif
 
-int main(int argc, char* argv[])
+// Compute the tables of the atmosphere described in a config file; the
+// names of the written files start with prefix.
+static bool GenerateTables(const string& configFileName, const string& prefix)
 {
-    bool commandLineOK = parseCommandLine(argc, argv);
-    if (!commandLineOK || ConfigFileName.empty())
-    {
-        usage();
-        exit(1);
-    }
-
     ParameterSet params;
     SetDefaultParameters(params);
-    if (!LoadParameterSet(params, ConfigFileName))
+    if (!LoadParameterSet(params, configFileName))
     {
-        exit(1);
+        return false;
     }
 
     Atmosphere atmosphere;
@@ -899,6 +940,10 @@ int main(int argc, char* argv[])
     cout << "Generating transmittance table (" << ViewAngleSamples << "x"
          << HeightSamples << ")...\n";
     Vector3f* transmittanceTable = atmosphere.computeTransmittanceTable();
+    if (transmittanceTable == nullptr)
+    {
+        return false;
+    }
 
     cout << "Generating inscatter table (" << SunAngleSamples << "x"
          << ViewAngleSamples << "x" << HeightSamples << ")...\n";
@@ -963,14 +1008,58 @@ int main(int argc, char* argv[])
     out.close();
 #else
     // Write tables as separate DDS files
-    ofstream transmittanceOut("transmittance.dds", ostream::binary);
+    ofstream transmittanceOut(prefix + "transmittance.dds", ostream::binary);
     WriteTransmittanceTableDDS(transmittanceOut, transmittanceTable);
     transmittanceOut.close();
 
-    ofstream inscatterOut("inscatter.dds", ostream::binary);
+    ofstream inscatterOut(prefix + "inscatter.dds", ostream::binary);
     WriteInscatterTableDDS(inscatterOut, inscatterTable);
     inscatterOut.close();
 #endif
 
-    return 0;
+    delete[] transmittanceTable;
+    delete[] inscatterTable;
+
+    return true;
+}
+
+
+// When several atmospheres are generated, the tables of each are named
+// after its config file: earth.cfg gives earth-transmittance.dds and
+// earth-inscatter.dds.
+static string OutputPrefix(const string& configFileName)
+{
+    string name = configFileName.substr(configFileName.find_last_of("/\\") + 1);
+    return name.substr(0, name.rfind('.')) + "-";
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool commandLineOK = parseCommandLine(argc, argv);
+    if (!commandLineOK || ConfigFileNames.empty())
+    {
+        usage();
+        exit(1);
+    }
+
+    if (ThreadCount == 0)
+        ThreadCount = max(thread::hardware_concurrency(), 1u);
+
+    // A failed atmosphere doesn't stop the generation of the next ones
+    bool ok = true;
+    for (const string& configFileName : ConfigFileNames)
+    {
+        if (ConfigFileNames.size() > 1)
+            cout << "Atmosphere " << configFileName << endl;
+
+        string prefix = ConfigFileNames.size() > 1 ? OutputPrefix(configFileName) : string();
+        if (!GenerateTables(configFileName, prefix))
+        {
+            cerr << "Failed to generate the tables of " << configFileName << endl;
+            ok = false;
+        }
+    }
+
+    return ok ? 0 : 1;
 }
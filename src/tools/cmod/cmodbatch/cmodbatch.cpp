@@ -0,0 +1,680 @@
+// cmodbatch.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// Convert and optimize a directory or manifest of models to cmod files,
+// several models at a time. The operations are those of cmodfix; models
+// whose input and options haven't changed since the last run are skipped.
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <cel3ds/3dsmodel.h>
+#include <cel3ds/3dsread.h>
+#include <celcompat/filesystem.h>
+#include <celmath/mathlib.h>
+#include <celmodel/mesh.h>
+#include <celmodel/model.h>
+#include <celmodel/modelfile.h>
+#include <celutil/logger.h>
+#include <celutil/parallelfor.h>
+
+#include "cmodops.h"
+#include "convert3ds.h"
+#include "convertobj.h"
+#include "pathmanager.h"
+
+using celestia::util::CreateLogger;
+using celestia::util::ParallelFor;
+namespace math = celestia::math;
+
+namespace
+{
+
+constexpr unsigned int MaxThreads = 64;
+constexpr const char CacheFileName[] = "cmodbatch.cache";
+
+constexpr std::uint64_t FNVOffsetBasis = UINT64_C(0xcbf29ce484222325);
+constexpr std::uint64_t FNVPrime = UINT64_C(0x100000001b3);
+
+struct Options
+{
+    std::string inputPath;
+    std::string outputDirectory;
+    bool outputBinary{ true };
+    bool uniquify{ false };
+    bool genNormals{ false };
+    bool genTangents{ false };
+    bool weldVertices{ false };
+    bool mergeMeshes{ false };
+    bool reorder{ false };
+    float smoothAngle{ 60.0f };
+    unsigned int lodLevels{ 0 };
+    float lodPixelSize{ 256.0f };
+    unsigned int threads{ 0 };
+    bool force{ false };
+};
+
+struct Job
+{
+    fs::path input;
+    // Path of the output relative to the output directory
+    fs::path output;
+};
+
+struct Result
+{
+    enum Status
+    {
+        Converted,
+        UpToDate,
+        Failed,
+    };
+
+    Status status{ Failed };
+    std::uint64_t hash{ 0 };
+    std::uintmax_t inputSize{ 0 };
+    std::uintmax_t outputSize{ 0 };
+    unsigned int inputTriangles{ 0 };
+    unsigned int outputTriangles{ 0 };
+    std::string error;
+};
+
+void
+usage()
+{
+    std::cerr << "Usage: cmodbatch [options] <input directory or manifest> <output directory>\n";
+    std::cerr << "   The input is a directory searched for .cmod, .3ds and .obj models, or a\n";
+    std::cerr << "   manifest listing one model per line, relative to the manifest. Each model\n";
+    std::cerr << "   is written to the same relative path in the output directory as a .cmod.\n";
+    std::cerr << "   --ascii (or -a)       : output ASCII .cmod files instead of binary ones\n";
+    std::cerr << "   --uniquify (or -u)    : eliminate duplicate vertices\n";
+    std::cerr << "   --tangents (or -t)    : generate tangents\n";
+    std::cerr << "   --normals (or -n)     : generate normals\n";
+    std::cerr << "   --smooth (or -s) <angle> : smoothing angle for normal generation\n";
+    std::cerr << "   --weld (or -w)        : join identical vertices before normal generation\n";
+    std::cerr << "   --merge (or -m)       : merge submeshes to improve rendering performance\n";
+    std::cerr << "   --reorder (or -r)     : reorder triangles and vertices for the vertex caches\n";
+    std::cerr << "   --lod (or -l) <count> : add up to count simplified levels of detail\n";
+    std::cerr << "   --lodsize <pixels>    : projected radius below which the first level of detail is drawn\n";
+    std::cerr << "   --threads (or -j) <n> : maximum number of threads, one per core by default\n";
+    std::cerr << "   --force (or -f)       : convert all models, even those which are up to date\n";
+}
+
+bool
+parseCommandLine(int argc, char* argv[], Options& options)
+{
+    int fileCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-')
+        {
+            if (fileCount == 0)
+                options.inputPath = argv[i];
+            else if (fileCount == 1)
+                options.outputDirectory = argv[i];
+            else
+                return false;
+            fileCount++;
+        }
+        else if (!std::strcmp(argv[i], "-a") || !std::strcmp(argv[i], "--ascii"))
+        {
+            options.outputBinary = false;
+        }
+        else if (!std::strcmp(argv[i], "-u") || !std::strcmp(argv[i], "--uniquify"))
+        {
+            options.uniquify = true;
+        }
+        else if (!std::strcmp(argv[i], "-n") || !std::strcmp(argv[i], "--normals"))
+        {
+            options.genNormals = true;
+        }
+        else if (!std::strcmp(argv[i], "-t") || !std::strcmp(argv[i], "--tangents"))
+        {
+            options.genTangents = true;
+        }
+        else if (!std::strcmp(argv[i], "-w") || !std::strcmp(argv[i], "--weld"))
+        {
+            options.weldVertices = true;
+        }
+        else if (!std::strcmp(argv[i], "-m") || !std::strcmp(argv[i], "--merge"))
+        {
+            options.mergeMeshes = true;
+        }
+        else if (!std::strcmp(argv[i], "-r") || !std::strcmp(argv[i], "--reorder"))
+        {
+            options.reorder = true;
+        }
+        else if (!std::strcmp(argv[i], "-f") || !std::strcmp(argv[i], "--force"))
+        {
+            options.force = true;
+        }
+        else if (i == argc - 1)
+        {
+            return false;
+        }
+        else if (!std::strcmp(argv[i], "-s") || !std::strcmp(argv[i], "--smooth"))
+        {
+            if (std::sscanf(argv[++i], " %f", &options.smoothAngle) != 1)
+                return false;
+        }
+        else if (!std::strcmp(argv[i], "-l") || !std::strcmp(argv[i], "--lod"))
+        {
+            if (std::sscanf(argv[++i], " %u", &options.lodLevels) != 1)
+                return false;
+        }
+        else if (!std::strcmp(argv[i], "--lodsize"))
+        {
+            if (std::sscanf(argv[++i], " %f", &options.lodPixelSize) != 1 || !(options.lodPixelSize > 0.0f))
+                return false;
+        }
+        else if (!std::strcmp(argv[i], "-j") || !std::strcmp(argv[i], "--threads"))
+        {
+            if (std::sscanf(argv[++i], " %u", &options.threads) != 1)
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return fileCount == 2;
+}
+
+// 64-bit FNV-1a, terminated by a zero byte so that the concatenation of
+// two strings doesn't hash like a different pair
+std::uint64_t
+hashString(std::uint64_t hash, std::string_view str)
+{
+    for (char c : str)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= FNVPrime;
+    }
+    return hash * FNVPrime;
+}
+
+// The options which change the output are part of the hash of each model,
+// so that changing them converts all the models again
+std::string
+optionsSignature(const Options& options)
+{
+    return fmt::format("{} {} {} {} {} {} {} {} {} {}",
+                       options.outputBinary, options.uniquify, options.genNormals,
+                       options.genTangents, options.weldVertices, options.mergeMeshes,
+                       options.reorder, options.smoothAngle, options.lodLevels,
+                       options.lodPixelSize);
+}
+
+std::string
+lowercaseExtension(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+bool
+isModelFile(const fs::path& path)
+{
+    std::string ext = lowercaseExtension(path);
+    return ext == ".cmod" || ext == ".3ds" || ext == ".obj";
+}
+
+void
+addJob(std::vector<Job>& jobs, fs::path&& input, const fs::path& relative)
+{
+    fs::path output = relative;
+    output.replace_extension(".cmod");
+    jobs.push_back({ std::move(input), std::move(output) });
+}
+
+bool
+findJobs(const Options& options, std::vector<Job>& jobs)
+{
+    fs::path inputPath(options.inputPath);
+    std::error_code ec;
+    if (!fs::is_directory(inputPath, ec))
+    {
+        std::ifstream manifest(inputPath);
+        if (!manifest.good())
+        {
+            std::cerr << "Error opening " << options.inputPath << "\n";
+            return false;
+        }
+
+        // Blank lines and lines starting with # are skipped
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            fs::path relative(line);
+            addJob(jobs, inputPath.parent_path() / relative, relative);
+        }
+
+        return !manifest.bad();
+    }
+
+    // Don't pick up the output of an earlier run if the output directory is
+    // inside the input one
+    fs::path outputDirectory = fs::weakly_canonical(fs::path(options.outputDirectory), ec);
+    for (auto it = fs::recursive_directory_iterator(inputPath, ec);
+         it != fs::recursive_directory_iterator();
+         it.increment(ec))
+    {
+        if (ec)
+            break;
+
+        if (it->is_directory(ec))
+        {
+            if (fs::weakly_canonical(it->path(), ec) == outputDirectory)
+                it.disable_recursion_pending();
+            continue;
+        }
+
+        if (isModelFile(it->path()))
+            addJob(jobs, fs::path(it->path()), it->path().lexically_relative(inputPath));
+    }
+
+    if (ec)
+    {
+        std::cerr << "Error reading directory " << options.inputPath << "\n";
+        return false;
+    }
+
+    // Directory iteration order is unspecified; sort for a stable summary
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.output < b.output; });
+    return true;
+}
+
+// Lines of the cache file are the hash of a model followed by the path of
+// its output relative to the output directory
+std::map<std::string, std::uint64_t>
+loadCache(const fs::path& path)
+{
+    std::map<std::string, std::uint64_t> cache;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::size_t space = line.find(' ');
+        if (space == std::string::npos)
+            continue;
+
+        std::uint64_t hash;
+        if (auto ec = std::from_chars(line.data(), line.data() + space, hash, 16).ec; ec == std::errc{})
+            cache[line.substr(space + 1)] = hash;
+    }
+
+    return cache;
+}
+
+bool
+saveCache(const fs::path& path, const std::map<std::string, std::uint64_t>& cache)
+{
+    std::ofstream out(path);
+    for (const auto& [output, hash] : cache)
+        out << fmt::format("{:016x} {}\n", hash, output);
+    return out.good();
+}
+
+bool
+readFile(const fs::path& path, std::string& data)
+{
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.good())
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+std::unique_ptr<cmod::Model>
+loadModel(const fs::path& path, const std::string& data, cmodtools::PathManager& pathManager, std::string& error)
+{
+    std::istringstream in(data, std::ios::in | std::ios::binary);
+    std::string ext = lowercaseExtension(path);
+    if (ext == ".3ds")
+    {
+        std::unique_ptr<M3DScene> scene = Read3DSFile(in);
+        if (scene == nullptr)
+        {
+            error = "error reading 3DS file";
+            return nullptr;
+        }
+
+        return cmodtools::Convert3DSModel(*scene, pathManager.getHandle);
+    }
+
+    if (ext == ".obj")
+    {
+        cmodtools::WavefrontLoader loader(in);
+        std::unique_ptr<cmod::Model> model = loader.load();
+        if (model == nullptr)
+            error = loader.errorMessage();
+        return model;
+    }
+
+    return cmod::LoadModel(in, pathManager.getHandle);
+}
+
+unsigned int
+countTriangles(const cmod::Model& model)
+{
+    unsigned int count = 0;
+    for (unsigned int i = 0; model.getMesh(i) != nullptr; i++)
+        count += model.getMesh(i)->getPrimitiveCount();
+    return count;
+}
+
+std::unique_ptr<cmod::Model>
+copyMaterials(const cmod::Model& model)
+{
+    auto newModel = std::make_unique<cmod::Model>();
+    for (unsigned int i = 0; model.getMaterial(i) != nullptr; i++)
+        newModel->addMaterial(model.getMaterial(i)->clone());
+    return newModel;
+}
+
+// Apply the operations in the same order as cmodfix; the meshes of the
+// model are processed on up to meshThreads threads
+std::unique_ptr<cmod::Model>
+processModel(std::unique_ptr<cmod::Model> model, const Options& options, unsigned int meshThreads, std::string& error)
+{
+    if (options.genNormals || options.genTangents)
+    {
+        std::vector<cmod::Mesh> meshes(model->getMeshCount());
+        std::atomic<bool> ok{ true };
+        ParallelFor(meshes.size(), 1, meshThreads, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                cmod::Mesh mesh = model->getMesh(static_cast<unsigned int>(i))->clone();
+                if (options.genNormals)
+                {
+                    mesh = cmodtools::GenerateNormals(mesh, math::degToRad(options.smoothAngle), options.weldVertices);
+                    if (mesh.getVertexCount() == 0)
+                    {
+                        ok = false;
+                        continue;
+                    }
+                }
+
+                if (options.genTangents)
+                {
+                    mesh = cmodtools::GenerateTangents(mesh, options.weldVertices);
+                    if (mesh.getVertexCount() == 0)
+                    {
+                        ok = false;
+                        continue;
+                    }
+                }
+
+                meshes[i] = std::move(mesh);
+            }
+        });
+
+        if (!ok)
+        {
+            error = options.genTangents ? "error generating normals or tangents" : "error generating normals";
+            return nullptr;
+        }
+
+        std::unique_ptr<cmod::Model> newModel = copyMaterials(*model);
+        for (cmod::Mesh& mesh : meshes)
+            newModel->addMesh(std::move(mesh));
+        model = std::move(newModel);
+    }
+
+    if (options.mergeMeshes)
+        model = cmodtools::MergeModelMeshes(*model);
+
+    if (!options.uniquify && options.lodLevels == 0 && !options.reorder)
+        return model;
+
+    std::vector<std::vector<cmod::Mesh>> levels(model->getMeshCount());
+    ParallelFor(levels.size(), 1, meshThreads, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+        {
+            cmod::Mesh* mesh = model->getMesh(static_cast<unsigned int>(i));
+            if (options.uniquify)
+                cmodtools::UniquifyVertices(*mesh);
+
+            if (options.lodLevels > 0)
+            {
+                levels[i] = cmodtools::GenerateMeshLODs(*mesh, options.lodLevels, options.lodPixelSize);
+                if (options.reorder)
+                {
+                    for (cmod::Mesh& level : levels[i])
+                        level.optimize();
+                }
+            }
+            else if (options.reorder)
+            {
+                mesh->optimize();
+            }
+        }
+    });
+
+    if (options.lodLevels > 0)
+    {
+        std::unique_ptr<cmod::Model> newModel = copyMaterials(*model);
+        for (std::vector<cmod::Mesh>& meshLevels : levels)
+        {
+            for (cmod::Mesh& level : meshLevels)
+                newModel->addMesh(std::move(level));
+        }
+        model = std::move(newModel);
+    }
+
+    return model;
+}
+
+Result
+runJob(const Job& job, const Options& options, const std::map<std::string, std::uint64_t>& cache,
+       std::uint64_t optionsHash, unsigned int meshThreads)
+{
+    Result result;
+    std::string data;
+    if (!readFile(job.input, data))
+    {
+        result.error = "error reading the file";
+        return result;
+    }
+
+    result.inputSize = data.size();
+    result.hash = hashString(optionsHash, data);
+
+    fs::path outputPath = fs::path(options.outputDirectory) / job.output;
+    std::error_code ec;
+    if (!options.force)
+    {
+        auto it = cache.find(job.output.generic_string());
+        if (it != cache.end() && it->second == result.hash && fs::exists(outputPath, ec))
+        {
+            result.status = Result::UpToDate;
+            return result;
+        }
+    }
+
+    // Texture handles are local to each model; the shared path manager of
+    // the other tools isn't thread safe
+    cmodtools::PathManager pathManager;
+    std::unique_ptr<cmod::Model> model = loadModel(job.input, data, pathManager, result.error);
+    if (model == nullptr)
+    {
+        if (result.error.empty())
+            result.error = "error loading the model";
+        return result;
+    }
+
+    result.inputTriangles = countTriangles(*model);
+    model = processModel(std::move(model), options, meshThreads, result.error);
+    if (model == nullptr)
+        return result;
+    result.outputTriangles = countTriangles(*model);
+
+    if (fs::create_directories(outputPath.parent_path(), ec); ec)
+    {
+        result.error = "error creating the output directory";
+        return result;
+    }
+
+    std::ofstream out(outputPath, options.outputBinary ? std::ios::out | std::ios::binary : std::ios::out);
+    bool saved = out.good() && (options.outputBinary
+                                ? SaveModelBinary(model.get(), out, pathManager.getSource)
+                                : SaveModelAscii(model.get(), out, pathManager.getSource));
+    out.close();
+    if (!saved || !out.good())
+    {
+        result.error = "error writing " + outputPath.string();
+        return result;
+    }
+
+    result.outputSize = fs::file_size(outputPath, ec);
+    result.status = Result::Converted;
+    return result;
+}
+
+void
+printSummary(const std::vector<Job>& jobs, const std::vector<Result>& results)
+{
+    unsigned int converted = 0;
+    unsigned int upToDate = 0;
+    unsigned int failed = 0;
+    std::uintmax_t inputSize = 0;
+    std::uintmax_t outputSize = 0;
+    std::uint64_t inputTriangles = 0;
+    std::uint64_t outputTriangles = 0;
+
+    for (std::size_t i = 0; i < jobs.size(); i++)
+    {
+        const Result& result = results[i];
+        switch (result.status)
+        {
+        case Result::Converted:
+            fmt::print("{}: {} -> {} triangles, {} -> {} bytes\n", jobs[i].output.generic_string(),
+                       result.inputTriangles, result.outputTriangles, result.inputSize, result.outputSize);
+            converted++;
+            inputSize += result.inputSize;
+            outputSize += result.outputSize;
+            inputTriangles += result.inputTriangles;
+            outputTriangles += result.outputTriangles;
+            break;
+        case Result::UpToDate:
+            upToDate++;
+            break;
+        case Result::Failed:
+            fmt::print(stderr, "{}: {}\n", jobs[i].input.string(), result.error);
+            failed++;
+            break;
+        }
+    }
+
+    fmt::print("{} converted, {} up to date, {} failed\n", converted, upToDate, failed);
+    if (converted > 0)
+    {
+        fmt::print("Converted models: {} -> {} triangles, {} -> {} bytes\n",
+                   inputTriangles, outputTriangles, inputSize, outputSize);
+    }
+}
+
+} // end unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseCommandLine(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    CreateLogger();
+
+    std::vector<Job> jobs;
+    if (!findJobs(options, jobs))
+        return 1;
+
+    std::error_code ec;
+    if (fs::create_directories(options.outputDirectory, ec); ec)
+    {
+        std::cerr << "Error creating " << options.outputDirectory << "\n";
+        return 1;
+    }
+
+    fs::path cachePath = fs::path(options.outputDirectory) / CacheFileName;
+    std::map<std::string, std::uint64_t> cache = loadCache(cachePath);
+    std::uint64_t optionsHash = hashString(FNVOffsetBasis, optionsSignature(options));
+
+    // Models are spread over the threads; with fewer models than threads
+    // the meshes of each model share the rest
+    unsigned int nThreads = options.threads > 0
+        ? std::min(options.threads, MaxThreads)
+        : std::clamp(std::thread::hardware_concurrency(), 1U, MaxThreads);
+    auto fileThreads = static_cast<unsigned int>(std::clamp(jobs.size(), std::size_t(1), std::size_t(nThreads)));
+    unsigned int meshThreads = std::max(1U, nThreads / fileThreads);
+
+    std::vector<Result> results(jobs.size());
+    ParallelFor(jobs.size(), 1, fileThreads, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; i++)
+            results[i] = runJob(jobs[i], options, cache, optionsHash, meshThreads);
+    });
+
+    printSummary(jobs, results);
+
+    bool ok = true;
+    for (std::size_t i = 0; i < jobs.size(); i++)
+    {
+        std::string output = jobs[i].output.generic_string();
+        if (results[i].status == Result::Failed)
+        {
+            cache.erase(output);
+            ok = false;
+        }
+        else
+        {
+            cache[output] = results[i].hash;
+        }
+    }
+
+    if (!saveCache(cachePath, cache))
+    {
+        std::cerr << "Error writing " << cachePath.string() << "\n";
+        return 1;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -39,8 +39,11 @@ bool genTangents = false;
 bool weldVertices = false;
 bool mergeMeshes = false;
 bool stripify = false;
+bool reorder = false;
 unsigned int vertexCacheSize = 16;
 float smoothAngle = 60.0f;
+unsigned int lodLevels = 0;
+float lodPixelSize = 256.0f;
 
 
 void usage()
@@ -54,6 +57,9 @@ void usage()
     std::cerr << "   --smooth (or -s) <angle> : smoothing angle for normal generation\n";
     std::cerr << "   --weld (or -w)        : join identical vertices before normal generation\n";
     std::cerr << "   --merge (or -m)       : merge submeshes to improve rendering performance\n";
+    std::cerr << "   --reorder (or -r)     : reorder triangles and vertices for the vertex caches\n";
+    std::cerr << "   --lod (or -l) <count> : add up to count simplified levels of detail\n";
+    std::cerr << "   --lodsize <pixels>    : projected radius below which the first level of detail is drawn\n";
 #ifdef TRISTRIP
     std::cerr << "   --optimize (or -o)    : optimize by converting triangle lists to strips\n";
 #endif
@@ -101,6 +107,10 @@ bool parseCommandLine(int argc, char* argv[])
             {
                 stripify = true;
             }
+            else if (!std::strcmp(argv[i], "-r") || !std::strcmp(argv[i], "--reorder"))
+            {
+                reorder = true;
+            }
             else if (!std::strcmp(argv[i], "-s") || !std::strcmp(argv[i], "--smooth"))
             {
                 if (i == argc - 1)
@@ -114,6 +124,32 @@ bool parseCommandLine(int argc, char* argv[])
                     i++;
                 }
             }
+            else if (!std::strcmp(argv[i], "-l") || !std::strcmp(argv[i], "--lod"))
+            {
+                if (i == argc - 1)
+                {
+                    return false;
+                }
+                else
+                {
+                    if (std::sscanf(argv[i + 1], " %u", &lodLevels) != 1)
+                        return false;
+                    i++;
+                }
+            }
+            else if (!std::strcmp(argv[i], "--lodsize"))
+            {
+                if (i == argc - 1)
+                {
+                    return false;
+                }
+                else
+                {
+                    if (std::sscanf(argv[i + 1], " %f", &lodPixelSize) != 1 || !(lodPixelSize > 0.0f))
+                        return false;
+                    i++;
+                }
+            }
             else
             {
                 return false;
@@ -239,6 +275,19 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (lodLevels > 0)
+    {
+        model = cmodtools::GenerateModelLODs(*model, lodLevels, lodPixelSize);
+    }
+
+    if (reorder)
+    {
+        for (std::uint32_t i = 0; model->getMesh(i) != nullptr; i++)
+        {
+            model->getMesh(i)->optimize();
+        }
+    }
+
 #ifdef TRISTRIP
     if (stripify)
     {
@@ -14,6 +14,7 @@
 #include <array>
 #include <cmath>
 #include <cstddef>
+#include <limits>
 #include <type_traits>
 #include <utility>
 
@@ -1167,6 +1168,10 @@ ModelViewWidget::renderModel(cmod::Model* model)
         {
             const cmod::Mesh* mesh = model->getMesh(meshIndex);
 
+            // Only show the most detailed level of models with several
+            if (!mesh->isInLODRange(std::numeric_limits<float>::infinity()))
+                continue;
+
             setVertexArrays(mesh->getVertexDescription(), mesh->getVertexData());
             if (mesh->getVertexDescription().getAttribute(cmod::VertexAttributeSemantic::Normal).format == cmod::VertexAttributeFormat::Float3)
             {
@@ -14,13 +14,19 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <numeric>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <celmodel/model.h>
+#include <celutil/parallelfor.h>
 
 #include "cmodops.h"
 
@@ -30,6 +36,13 @@ namespace cmodtools
 
 namespace
 {
+using celestia::util::ParallelFor;
+
+// Faces handled by each task of the parallel loops, and the most threads
+// used for them
+constexpr std::size_t FacesPerTask = 4096;
+constexpr unsigned int MaxThreads = 8;
+
 struct Vertex
 {
     Vertex() :
@@ -391,6 +404,130 @@ joinVertices(std::vector<Face>& faces,
 }
 
 
+// Merge the points with exactly equal positions, like joinVertices with a
+// zero tolerance does, with a hash map instead of sorting all the vertices
+void
+joinIdenticalPoints(std::vector<Face>& faces,
+                    const cmod::VWord* vertexData,
+                    const cmod::VertexDescription& desc)
+{
+    std::uint32_t posOffset = desc.getAttribute(cmod::VertexAttributeSemantic::Position).offsetWords;
+    unsigned int stride = desc.strideBytes / sizeof(cmod::VWord);
+
+    using PointKey = std::array<std::uint32_t, 3>;
+    struct PointKeyHasher
+    {
+        std::size_t operator()(const PointKey& key) const noexcept
+        {
+            std::size_t h = key[0];
+            h = h * 0x9e3779b1U ^ key[1];
+            h = h * 0x9e3779b1U ^ key[2];
+            return h;
+        }
+    };
+
+    std::unordered_map<PointKey, std::uint32_t, PointKeyHasher> points;
+    points.reserve(faces.size() * 3);
+    for (Face& face : faces)
+    {
+        for (std::uint32_t k = 0; k < 3; k++)
+        {
+            std::array<float, 3> p;
+            std::memcpy(p.data(), vertexData + stride * face.i[k] + posOffset, sizeof(float) * 3);
+
+            // Negative and positive zero compare equal, adding zero turns
+            // the first into the second
+            PointKey key;
+            for (std::size_t c = 0; c < 3; c++)
+            {
+                float value = p[c] + 0.0f;
+                std::memcpy(&key[c], &value, sizeof(float));
+            }
+
+            // NaN positions never equal anything, like in joinVertices
+            if (std::isnan(p[0]) || std::isnan(p[1]) || std::isnan(p[2]))
+                face.vi[k] = face.i[k];
+            else
+                face.vi[k] = points.try_emplace(key, face.i[k]).first->second;
+        }
+    }
+}
+
+
+// Collapse of the edge between two vertices, moving the first one onto the
+// second. The stamps of both vertices at the time the cost was computed
+// tell if the collapse is out of date.
+struct EdgeCollapse
+{
+    double cost;
+    std::uint32_t from;
+    std::uint32_t to;
+    std::uint32_t fromStamp;
+    std::uint32_t toStamp;
+
+    bool operator>(const EdgeCollapse& other) const { return cost > other.cost; }
+};
+
+
+double
+collapseCost(const Eigen::Matrix4d& quadric, const Eigen::Vector3d& position)
+{
+    Eigen::Vector4d p(position.x(), position.y(), position.z(), 1.0);
+    return p.dot(quadric * p);
+}
+
+
+// Lock the vertices which share their position with another vertex, as they
+// are on a seam of texture coordinates or normals, and the vertices on a
+// border or non-manifold edge of the surface.
+std::vector<bool>
+findLockedVertices(const std::vector<Face>& faces, std::uint32_t nVertices)
+{
+    constexpr std::uint32_t NoVertex = ~0u;
+
+    std::vector<std::uint32_t> pointOf(nVertices, NoVertex);
+    std::vector<std::uint32_t> pointVertex(nVertices, NoVertex);
+    std::vector<bool> lockedPoints(nVertices, false);
+    std::vector<std::uint64_t> edges;
+    edges.reserve(faces.size() * 3);
+    for (const Face& face : faces)
+    {
+        for (std::uint32_t j = 0; j < 3; j++)
+        {
+            std::uint32_t point = face.vi[j];
+            pointOf[face.i[j]] = point;
+            if (pointVertex[point] == NoVertex)
+                pointVertex[point] = face.i[j];
+            else if (pointVertex[point] != face.i[j])
+                lockedPoints[point] = true;
+
+            std::uint32_t other = face.vi[(j + 1) % 3];
+            edges.push_back((static_cast<std::uint64_t>(std::min(point, other)) << 32) | std::max(point, other));
+        }
+    }
+
+    std::sort(edges.begin(), edges.end());
+    for (auto it = edges.begin(); it != edges.end();)
+    {
+        auto next = std::find_if(it, edges.end(), [&](std::uint64_t edge) { return edge != *it; });
+        if (next - it != 2)
+        {
+            lockedPoints[static_cast<std::uint32_t>(*it >> 32)] = true;
+            lockedPoints[static_cast<std::uint32_t>(*it & 0xffffffffu)] = true;
+        }
+        it = next;
+    }
+
+    std::vector<bool> locked(nVertices, false);
+    for (std::uint32_t i = 0; i < nVertices; i++)
+    {
+        if (pointOf[i] != NoVertex)
+            locked[i] = lockedPoints[pointOf[i]];
+    }
+
+    return locked;
+}
+
 } // end unnamed namespace
 
 
@@ -524,18 +661,21 @@ GenerateNormals(const cmod::Mesh& mesh, float smoothAngle, bool weld, float weld
     const cmod::VWord* vertexData = mesh.getVertexData();
 
     // Compute normals for the faces
-    for (f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-        Eigen::Vector3f p0 = getVertex(vertexData, posOffset, stride, face.i[0]);
-        Eigen::Vector3f p1 = getVertex(vertexData, posOffset, stride, face.i[1]);
-        Eigen::Vector3f p2 = getVertex(vertexData, posOffset, stride, face.i[2]);
-        face.normal = (p1 - p0).cross(p2 - p1);
-        if (face.normal.squaredNorm() > 0.0f)
+        for (std::size_t f = begin; f < end; f++)
         {
-            face.normal.normalize();
+            Face& face = faces[f];
+            Eigen::Vector3f p0 = getVertex(vertexData, posOffset, stride, face.i[0]);
+            Eigen::Vector3f p1 = getVertex(vertexData, posOffset, stride, face.i[1]);
+            Eigen::Vector3f p2 = getVertex(vertexData, posOffset, stride, face.i[2]);
+            face.normal = (p1 - p0).cross(p2 - p1);
+            if (face.normal.squaredNorm() > 0.0f)
+            {
+                face.normal.normalize();
+            }
         }
-    }
+    });
 
     // For each vertex, create a list of faces that contain it
     std::vector<std::uint32_t> faceCounts(nVertices, 0);
@@ -544,7 +684,11 @@ GenerateNormals(const cmod::Mesh& mesh, float smoothAngle, bool weld, float weld
     // If we're welding vertices before generating normals, find identical
     // points and merge them.  Otherwise, the point indices will be the same
     // as the attribute indices.
-    if (weld)
+    if (weld && weldTolerance == 0.0f)
+    {
+        joinIdenticalPoints(faces, vertexData, desc);
+    }
+    else if (weld)
     {
         joinVertices(faces, vertexData, desc,
                      PointOrderingPredicate(),
@@ -590,18 +734,21 @@ GenerateNormals(const cmod::Mesh& mesh, float smoothAngle, bool weld, float weld
 
     // Compute the vertex normals by averaging
     std::vector<Eigen::Vector3f> vertexNormals(nFaces * 3);
-    for (f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-        for (std::uint32_t j = 0; j < 3; j++)
+        for (std::size_t f = begin; f < end; f++)
         {
-            vertexNormals[f * 3 + j] =
-                averageFaceVectors(faces, f,
-                                   &vertexFaces[face.vi[j]][1],
-                                   vertexFaces[face.vi[j]][0],
-                                   cosSmoothAngle);
+            Face& face = faces[f];
+            for (std::uint32_t j = 0; j < 3; j++)
+            {
+                vertexNormals[f * 3 + j] =
+                    averageFaceVectors(faces, f,
+                                       &vertexFaces[face.vi[j]][1],
+                                       vertexFaces[face.vi[j]][0],
+                                       cosSmoothAngle);
+            }
         }
-    }
+    });
 
     // Finally, create a new mesh with normals included
 
@@ -641,26 +788,30 @@ GenerateNormals(const cmod::Mesh& mesh, float smoothAngle, bool weld, float weld
     // new vertex data buffer.
     unsigned int newStride = newDesc.strideBytes / sizeof(cmod::VWord);
     std::vector<cmod::VWord> newVertexData(newStride * nFaces * 3);
-    for (f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-
-        for (std::uint32_t j = 0; j < 3; j++)
+        for (std::size_t f = begin; f < end; f++)
         {
-            cmod::VWord* newVertex = newVertexData.data() + (f * 3 + j) * newStride;
-            copyVertex(newVertex, newDesc,
-                       vertexData, desc,
-                       face.i[j],
-                       fromOffsets);
-            std::memcpy(newVertex + normalOffset, &vertexNormals[f * 3 + j],
-                        cmod::VertexAttribute::getFormatSizeWords(cmod::VertexAttributeFormat::Float3) * sizeof(cmod::VWord));
+            Face& face = faces[f];
+
+            for (std::uint32_t j = 0; j < 3; j++)
+            {
+                cmod::VWord* newVertex = newVertexData.data() + (f * 3 + j) * newStride;
+                copyVertex(newVertex, newDesc,
+                           vertexData, desc,
+                           face.i[j],
+                           fromOffsets);
+                std::memcpy(newVertex + normalOffset, &vertexNormals[f * 3 + j],
+                            cmod::VertexAttribute::getFormatSizeWords(cmod::VertexAttributeFormat::Float3) * sizeof(cmod::VWord));
+            }
         }
-    }
+    });
 
     // Create the Celestia mesh
     cmod::Mesh newMesh;
     newMesh.setVertexDescription(std::move(newDesc));
     newMesh.setVertices(nFaces * 3, std::move(newVertexData));
+    newMesh.setLODRange(mesh.getLODMinPixelSize(), mesh.getLODMaxPixelSize());
 
     std::uint32_t firstIndex = 0;
     for (std::uint32_t groupIndex = 0; mesh.getGroup(groupIndex) != 0; ++groupIndex)
@@ -783,25 +934,28 @@ GenerateTangents(const cmod::Mesh& mesh, bool weld)
     const cmod::VWord* vertexData = mesh.getVertexData();
 
     // Compute tangents for faces
-    for (f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-        Eigen::Vector3f p0 = getVertex(vertexData, posOffset, stride, face.i[0]);
-        Eigen::Vector3f p1 = getVertex(vertexData, posOffset, stride, face.i[1]);
-        Eigen::Vector3f p2 = getVertex(vertexData, posOffset, stride, face.i[2]);
-        Eigen::Vector2f tc0 = getTexCoord(vertexData, texCoordOffset, stride, face.i[0]);
-        Eigen::Vector2f tc1 = getTexCoord(vertexData, texCoordOffset, stride, face.i[1]);
-        Eigen::Vector2f tc2 = getTexCoord(vertexData, texCoordOffset, stride, face.i[2]);
-        float s1 = tc1.x() - tc0.x();
-        float s2 = tc2.x() - tc0.x();
-        float t1 = tc1.y() - tc0.y();
-        float t2 = tc2.y() - tc0.y();
-        float a = s1 * t2 - s2 * t1;
-        if (a != 0.0f)
-            face.normal = (t2 * (p1 - p0) - t1 * (p2 - p0)) * (1.0f / a);
-        else
-            face.normal = Eigen::Vector3f::Zero();
-    }
+        for (std::size_t f = begin; f < end; f++)
+        {
+            Face& face = faces[f];
+            Eigen::Vector3f p0 = getVertex(vertexData, posOffset, stride, face.i[0]);
+            Eigen::Vector3f p1 = getVertex(vertexData, posOffset, stride, face.i[1]);
+            Eigen::Vector3f p2 = getVertex(vertexData, posOffset, stride, face.i[2]);
+            Eigen::Vector2f tc0 = getTexCoord(vertexData, texCoordOffset, stride, face.i[0]);
+            Eigen::Vector2f tc1 = getTexCoord(vertexData, texCoordOffset, stride, face.i[1]);
+            Eigen::Vector2f tc2 = getTexCoord(vertexData, texCoordOffset, stride, face.i[2]);
+            float s1 = tc1.x() - tc0.x();
+            float s2 = tc2.x() - tc0.x();
+            float t1 = tc1.y() - tc0.y();
+            float t2 = tc2.y() - tc0.y();
+            float a = s1 * t2 - s2 * t1;
+            if (a != 0.0f)
+                face.normal = (t2 * (p1 - p0) - t1 * (p2 - p0)) * (1.0f / a);
+            else
+                face.normal = Eigen::Vector3f::Zero();
+        }
+    });
 
     // For each vertex, create a list of faces that contain it
     std::uint32_t* faceCounts = new std::uint32_t[nVertices];
@@ -863,18 +1017,21 @@ GenerateTangents(const cmod::Mesh& mesh, bool weld)
 
     // Compute the vertex tangents by averaging
     std::vector<Eigen::Vector3f> vertexTangents(nFaces * 3);
-    for (f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-        for (std::uint32_t j = 0; j < 3; j++)
+        for (std::size_t f = begin; f < end; f++)
         {
-            vertexTangents[f * 3 + j] =
-                averageFaceVectors(faces, f,
-                                   &vertexFaces[face.vi[j]][1],
-                                   vertexFaces[face.vi[j]][0],
-                                   0.0f);
+            Face& face = faces[f];
+            for (std::uint32_t j = 0; j < 3; j++)
+            {
+                vertexTangents[f * 3 + j] =
+                    averageFaceVectors(faces, f,
+                                       &vertexFaces[face.vi[j]][1],
+                                       vertexFaces[face.vi[j]][0],
+                                       0.0f);
+            }
         }
-    }
+    });
 
     // Create the new vertex description
     cmod::VertexDescription newDesc = desc.clone();
@@ -912,25 +1069,29 @@ GenerateTangents(const cmod::Mesh& mesh, bool weld)
     // new vertex data buffer.
     unsigned int newStride = newDesc.strideBytes / sizeof(cmod::VWord);
     std::vector<cmod::VWord> newVertexData(newStride * nFaces * 3);
-    for (f = 0; f < nFaces; f++)
+    ParallelFor(nFaces, FacesPerTask, MaxThreads, [&](std::size_t begin, std::size_t end)
     {
-        Face& face = faces[f];
-
-        for (std::uint32_t j = 0; j < 3; j++)
+        for (std::size_t f = begin; f < end; f++)
         {
-            cmod::VWord* newVertex = newVertexData.data() + (f * 3 + j) * newStride;
-            copyVertex(newVertex, newDesc,
-                       vertexData, desc,
-                       face.i[j],
-                       fromOffsets);
-            std::memcpy(newVertex + tangentOffset, &vertexTangents[f * 3 + j], 3 * sizeof(float));
+            Face& face = faces[f];
+
+            for (std::uint32_t j = 0; j < 3; j++)
+            {
+                cmod::VWord* newVertex = newVertexData.data() + (f * 3 + j) * newStride;
+                copyVertex(newVertex, newDesc,
+                           vertexData, desc,
+                           face.i[j],
+                           fromOffsets);
+                std::memcpy(newVertex + tangentOffset, &vertexTangents[f * 3 + j], 3 * sizeof(float));
+            }
         }
-    }
+    });
 
     // Create the Celestia mesh
     cmod::Mesh newMesh;
     newMesh.setVertexDescription(std::move(newDesc));
     newMesh.setVertices(nFaces * 3, std::move(newVertexData));
+    newMesh.setLODRange(mesh.getLODMinPixelSize(), mesh.getLODMaxPixelSize());
 
     std::uint32_t firstIndex = 0;
     for (std::uint32_t groupIndex = 0; mesh.getGroup(groupIndex) != 0; ++groupIndex)
@@ -1040,6 +1201,278 @@ UniquifyVertices(cmod::Mesh& mesh)
 }
 
 
+/*! Reduce the number of triangles in a mesh of triangle lists to about
+ *  targetRatio times the original count. Edges are collapsed in the order
+ *  of the quadric error metric of Garland and Heckbert. A vertex is only
+ *  ever moved onto one of its neighbors, so that all of the vertex
+ *  attributes stay valid, and vertices on attribute seams and borders of
+ *  the surface are never moved, so that no cracks open. Return an empty
+ *  mesh if the mesh can't be simplified.
+ */
+cmod::Mesh
+SimplifyMesh(const cmod::Mesh& mesh, float targetRatio)
+{
+    const cmod::VertexDescription& desc = mesh.getVertexDescription();
+    if (desc.getAttribute(cmod::VertexAttributeSemantic::Position).format != cmod::VertexAttributeFormat::Float3)
+    {
+        std::cerr << "Vertex position must be a float3\n";
+        return cmod::Mesh();
+    }
+
+    for (std::uint32_t i = 0; mesh.getGroup(i) != nullptr; i++)
+    {
+        if (mesh.getGroup(i)->prim != cmod::PrimitiveGroupType::TriList)
+        {
+            std::cerr << "Only triangle lists can be simplified\n";
+            return cmod::Mesh();
+        }
+    }
+
+    // Vertices which only differ by index would be locked as a seam
+    cmod::Mesh work = mesh.clone();
+    UniquifyVertices(work);
+
+    const cmod::VWord* vertexData = work.getVertexData();
+    std::uint32_t nVertices = work.getVertexCount();
+    std::uint32_t posOffset = desc.getAttribute(cmod::VertexAttributeSemantic::Position).offsetWords;
+    std::uint32_t stride = work.getVertexStrideWords();
+
+    std::vector<Face> faces;
+    std::vector<std::uint32_t> faceGroups;
+    for (std::uint32_t i = 0; work.getGroup(i) != nullptr; i++)
+    {
+        const std::vector<cmod::Index32>& indices = work.getGroup(i)->indices;
+        for (std::size_t k = 0; k + 2 < indices.size(); k += 3)
+        {
+            Face face;
+            std::copy(indices.begin() + k, indices.begin() + k + 3, face.i);
+            faces.push_back(face);
+            faceGroups.push_back(i);
+        }
+    }
+
+    if (faces.empty())
+        return cmod::Mesh();
+
+    joinIdenticalPoints(faces, vertexData, desc);
+    std::vector<bool> locked = findLockedVertices(faces, nVertices);
+
+    std::vector<Eigen::Vector3d> positions(nVertices);
+    for (std::uint32_t i = 0; i < nVertices; i++)
+        positions[i] = getVertex(vertexData, posOffset, stride, i).cast<double>();
+
+    // The quadric of each vertex sums the squared distances to the planes
+    // of its faces, weighted by their areas
+    std::vector<Eigen::Matrix4d> quadrics(nVertices, Eigen::Matrix4d::Zero());
+    std::vector<std::vector<std::uint32_t>> vertexFaces(nVertices);
+    std::vector<bool> faceRemoved(faces.size(), false);
+    std::size_t liveFaces = faces.size();
+    for (std::uint32_t f = 0; f < faces.size(); f++)
+    {
+        const Face& face = faces[f];
+        if (face.i[0] == face.i[1] || face.i[1] == face.i[2] || face.i[2] == face.i[0])
+        {
+            faceRemoved[f] = true;
+            liveFaces--;
+            continue;
+        }
+
+        Eigen::Vector3d normal = (positions[face.i[1]] - positions[face.i[0]]).cross(positions[face.i[2]] - positions[face.i[0]]);
+        double area = normal.norm();
+        if (area > 0.0)
+        {
+            normal /= area;
+            Eigen::Vector4d plane(normal.x(), normal.y(), normal.z(), -normal.dot(positions[face.i[0]]));
+            for (std::uint32_t j = 0; j < 3; j++)
+                quadrics[face.i[j]] += area * plane * plane.transpose();
+        }
+
+        for (std::uint32_t j = 0; j < 3; j++)
+            vertexFaces[face.i[j]].push_back(f);
+    }
+
+    std::vector<std::uint32_t> stamps(nVertices, 0);
+    std::vector<bool> vertexRemoved(nVertices, false);
+    std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<>> collapses;
+    auto addCollapse = [&](std::uint32_t from, std::uint32_t to)
+    {
+        if (!locked[from])
+        {
+            double cost = collapseCost(quadrics[from] + quadrics[to], positions[to]);
+            collapses.push({ cost, from, to, stamps[from], stamps[to] });
+        }
+    };
+    auto addCollapses = [&](std::uint32_t v)
+    {
+        for (std::uint32_t f : vertexFaces[v])
+        {
+            for (std::uint32_t w : faces[f].i)
+            {
+                if (w != v)
+                {
+                    addCollapse(v, w);
+                    addCollapse(w, v);
+                }
+            }
+        }
+    };
+    auto getNeighbors = [&](std::uint32_t v, std::vector<std::uint32_t>& neighbors)
+    {
+        neighbors.clear();
+        for (std::uint32_t f : vertexFaces[v])
+        {
+            if (faceRemoved[f])
+                continue;
+            for (std::uint32_t w : faces[f].i)
+            {
+                if (w != v)
+                    neighbors.push_back(w);
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    };
+
+    for (std::uint32_t i = 0; i < nVertices; i++)
+    {
+        for (std::uint32_t f : vertexFaces[i])
+        {
+            for (std::uint32_t w : faces[f].i)
+            {
+                if (w != i)
+                    addCollapse(i, w);
+            }
+        }
+    }
+
+    auto targetFaces = static_cast<std::size_t>(static_cast<double>(faces.size()) * targetRatio);
+    std::vector<std::uint32_t> fromNeighbors;
+    std::vector<std::uint32_t> toNeighbors;
+    std::vector<std::uint32_t> commonNeighbors;
+    while (liveFaces > targetFaces && !collapses.empty())
+    {
+        EdgeCollapse collapse = collapses.top();
+        collapses.pop();
+
+        std::uint32_t u = collapse.from;
+        std::uint32_t v = collapse.to;
+        if (vertexRemoved[u] || vertexRemoved[v] ||
+            collapse.fromStamp != stamps[u] || collapse.toStamp != stamps[v])
+        {
+            continue;
+        }
+
+        // Keep the surface manifold: the only neighbors shared by both
+        // vertices must be the third corners of the faces they share
+        auto shared = static_cast<std::size_t>(std::count_if(vertexFaces[u].begin(), vertexFaces[u].end(), [&](std::uint32_t f)
+        {
+            return !faceRemoved[f] && std::find(std::begin(faces[f].i), std::end(faces[f].i), v) != std::end(faces[f].i);
+        }));
+        if (shared == 0)
+            continue;
+
+        getNeighbors(u, fromNeighbors);
+        getNeighbors(v, toNeighbors);
+        commonNeighbors.clear();
+        std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(),
+                              toNeighbors.begin(), toNeighbors.end(),
+                              std::back_inserter(commonNeighbors));
+        if (commonNeighbors.size() != shared)
+            continue;
+
+        // Don't flip any of the faces which are kept
+        bool flips = std::any_of(vertexFaces[u].begin(), vertexFaces[u].end(), [&](std::uint32_t f)
+        {
+            const Face& face = faces[f];
+            if (faceRemoved[f] || std::find(std::begin(face.i), std::end(face.i), v) != std::end(face.i))
+                return false;
+
+            std::array<Eigen::Vector3d, 3> p;
+            for (std::uint32_t j = 0; j < 3; j++)
+                p[j] = positions[face.i[j]];
+            Eigen::Vector3d before = (p[1] - p[0]).cross(p[2] - p[0]);
+            for (std::uint32_t j = 0; j < 3; j++)
+            {
+                if (face.i[j] == u)
+                    p[j] = positions[v];
+            }
+            Eigen::Vector3d after = (p[1] - p[0]).cross(p[2] - p[0]);
+            return before.dot(after) <= 0.0;
+        });
+        if (flips)
+            continue;
+
+        for (std::uint32_t f : vertexFaces[u])
+        {
+            if (faceRemoved[f])
+                continue;
+
+            Face& face = faces[f];
+            if (std::find(std::begin(face.i), std::end(face.i), v) != std::end(face.i))
+            {
+                faceRemoved[f] = true;
+                liveFaces--;
+            }
+            else
+            {
+                std::replace(std::begin(face.i), std::end(face.i), u, v);
+                vertexFaces[v].push_back(f);
+            }
+        }
+
+        vertexFaces[u].clear();
+        vertexRemoved[u] = true;
+        auto& facesOfV = vertexFaces[v];
+        facesOfV.erase(std::remove_if(facesOfV.begin(), facesOfV.end(), [&](std::uint32_t f) { return faceRemoved[f]; }),
+                       facesOfV.end());
+
+        quadrics[v] += quadrics[u];
+        stamps[v]++;
+        addCollapses(v);
+    }
+
+    // Build the mesh from the remaining faces and the vertices they use
+    constexpr std::uint32_t NoVertex = ~0u;
+    std::vector<std::uint32_t> vertexMap(nVertices, NoVertex);
+    std::vector<cmod::VWord> newVertexData;
+    std::uint32_t newVertexCount = 0;
+    std::vector<std::vector<cmod::Index32>> groupIndices(work.getGroupCount());
+    for (std::uint32_t f = 0; f < faces.size(); f++)
+    {
+        if (faceRemoved[f])
+            continue;
+
+        for (std::uint32_t index : faces[f].i)
+        {
+            if (vertexMap[index] == NoVertex)
+            {
+                vertexMap[index] = newVertexCount++;
+                newVertexData.insert(newVertexData.end(),
+                                     vertexData + index * stride,
+                                     vertexData + (index + 1) * stride);
+            }
+            groupIndices[faceGroups[f]].push_back(vertexMap[index]);
+        }
+    }
+
+    cmod::Mesh newMesh;
+    newMesh.setVertexDescription(desc.clone());
+    newMesh.setVertices(newVertexCount, std::move(newVertexData));
+    for (std::uint32_t i = 0; i < groupIndices.size(); i++)
+    {
+        if (!groupIndices[i].empty())
+        {
+            newMesh.addGroup(cmod::PrimitiveGroupType::TriList,
+                             work.getGroup(i)->materialIndex,
+                             std::move(groupIndices[i]));
+        }
+    }
+    newMesh.setName(std::string(mesh.getName()));
+
+    return newMesh;
+}
+
+
 // Merge all meshes that share the same vertex description
 std::unique_ptr<cmod::Model>
 MergeModelMeshes(const cmod::Model& model)
@@ -1051,9 +1484,18 @@ MergeModelMeshes(const cmod::Model& model)
         meshes.push_back(model.getMesh(i));
     }
 
-    // Sort the meshes by vertex description
+    // Sort the meshes by level of detail and vertex description
+    auto lodRange = [](const cmod::Mesh* mesh)
+    {
+        return std::make_tuple(mesh->getLODMinPixelSize(), mesh->getLODMaxPixelSize());
+    };
     std::sort(meshes.begin(), meshes.end(),
-              [](const cmod::Mesh* a, const cmod::Mesh* b) { return a->getVertexDescription() < b->getVertexDescription(); });
+              [&](const cmod::Mesh* a, const cmod::Mesh* b)
+              {
+                  if (lodRange(a) != lodRange(b))
+                      return lodRange(a) < lodRange(b);
+                  return a->getVertexDescription() < b->getVertexDescription();
+              });
 
     auto newModel = std::make_unique<cmod::Model>();
 
@@ -1074,7 +1516,8 @@ MergeModelMeshes(const cmod::Model& model)
              meshIndex + nMatchingMeshes < meshes.size();
              nMatchingMeshes++)
         {
-            if (!(meshes[meshIndex + nMatchingMeshes]->getVertexDescription() == desc))
+            if (!(meshes[meshIndex + nMatchingMeshes]->getVertexDescription() == desc) ||
+                lodRange(meshes[meshIndex + nMatchingMeshes]) != lodRange(meshes[meshIndex]))
             {
                 break;
             }
@@ -1106,6 +1549,7 @@ MergeModelMeshes(const cmod::Model& model)
         cmod::Mesh mergedMesh;
         mergedMesh.setVertexDescription(desc.clone());
         mergedMesh.setVertices(totalVertices, std::move(vertexData));
+        mergedMesh.setLODRange(meshes[meshIndex]->getLODMinPixelSize(), meshes[meshIndex]->getLODMaxPixelSize());
 
         // Reindex and add primitive groups
         vertexCount = 0;
@@ -1172,6 +1616,73 @@ GenerateModelNormals(const cmod::Model& model, float smoothAngle, bool weldVerti
 }
 
 
+/*! Return a mesh followed by up to levelCount coarser levels of detail,
+ *  each with about a quarter of the triangles of the level before it. The
+ *  mesh is drawn while the projected radius of the model is at least
+ *  pixelSize, and each level down to half of the size at which the level
+ *  before it stops being drawn. A mesh which already has a level of detail
+ *  or can't be simplified is returned alone, drawn at all sizes.
+ */
+std::vector<cmod::Mesh>
+GenerateMeshLODs(const cmod::Mesh& mesh, unsigned int levelCount, float pixelSize)
+{
+    // Fraction of the triangles of the level before to aim for
+    constexpr float LODTriangleRatio = 0.25f;
+    // Levels which don't remove at least this fraction of the triangles
+    // of the level before are dropped
+    constexpr float MinLODReduction = 0.1f;
+
+    std::vector<cmod::Mesh> levels;
+    levels.push_back(mesh.clone());
+    while (!mesh.hasLODRange() && levels.size() <= levelCount)
+    {
+        cmod::Mesh level = SimplifyMesh(levels.back(), LODTriangleRatio);
+        if (level.getPrimitiveCount() == 0 ||
+            static_cast<float>(level.getPrimitiveCount()) > static_cast<float>(levels.back().getPrimitiveCount()) * (1.0f - MinLODReduction))
+        {
+            break;
+        }
+
+        levels.push_back(std::move(level));
+    }
+
+    float maxPixelSize = std::numeric_limits<float>::infinity();
+    float minPixelSize = pixelSize;
+    for (std::size_t level = 0; level < levels.size() && levels.size() > 1; level++)
+    {
+        levels[level].setLODRange(level + 1 == levels.size() ? 0.0f : minPixelSize, maxPixelSize);
+        maxPixelSize = minPixelSize;
+        minPixelSize *= 0.5f;
+    }
+
+    return levels;
+}
+
+
+/*! Add up to levelCount coarser levels of detail to the meshes of a model,
+ *  as GenerateMeshLODs() does.
+ */
+std::unique_ptr<cmod::Model>
+GenerateModelLODs(const cmod::Model& model, unsigned int levelCount, float pixelSize)
+{
+    auto newModel = std::make_unique<cmod::Model>();
+
+    // Copy materials
+    for (unsigned int i = 0; model.getMaterial(i) != nullptr; i++)
+    {
+        newModel->addMaterial(model.getMaterial(i)->clone());
+    }
+
+    for (unsigned int i = 0; model.getMesh(i) != nullptr; i++)
+    {
+        for (cmod::Mesh& level : GenerateMeshLODs(*model.getMesh(i), levelCount, pixelSize))
+            newModel->addMesh(std::move(level));
+    }
+
+    return newModel;
+}
+
+
 #ifdef TRISTRIP
 bool
 ConvertToStrips(cmod::Mesh& mesh)
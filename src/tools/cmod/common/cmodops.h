@@ -13,6 +13,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 #include <Eigen/Core>
 
@@ -32,6 +33,10 @@ namespace cmodtools
 extern cmod::Mesh GenerateNormals(const cmod::Mesh& mesh, float smoothAngle, bool weld, float weldTolerance = 0.0f);
 extern cmod::Mesh GenerateTangents(const cmod::Mesh& mesh, bool weld);
 extern bool UniquifyVertices(cmod::Mesh& mesh);
+extern cmod::Mesh SimplifyMesh(const cmod::Mesh& mesh, float targetRatio);
+extern std::vector<cmod::Mesh> GenerateMeshLODs(const cmod::Mesh& mesh,
+                                                unsigned int levelCount,
+                                                float pixelSize);
 
 // Model operations
 extern std::unique_ptr<cmod::Model> MergeModelMeshes(const cmod::Model& model);
@@ -39,6 +44,9 @@ extern std::unique_ptr<cmod::Model> GenerateModelNormals(const cmod::Model& mode
                                                          float smoothAngle,
                                                          bool weldVertices,
                                                          float weldTolerance);
+extern std::unique_ptr<cmod::Model> GenerateModelLODs(const cmod::Model& model,
+                                                      unsigned int levelCount,
+                                                      float pixelSize);
 #ifdef TRISTRIP
 extern bool ConvertToStrips(cmod::Mesh& mesh);
 #endif
@@ -0,0 +1,61 @@
+// makedsodb.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// Convert deep sky catalogs (.dsc) to a binary deep sky catalog, which
+// contains a prebuilt octree for faster loading.
+
+#include <cstdio>
+#include <fstream>
+
+#include <fmt/format.h>
+
+#include <celcompat/filesystem.h>
+#include <celengine/dsodbbuilder.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fmt::print(stderr, "Usage: {} <input.dsc>... <output>\n", argv[0]);
+        return 1;
+    }
+
+    DSODatabaseBuilder builder;
+    for (int i = 1; i < argc - 1; ++i)
+    {
+        fs::path inputPath(argv[i]);
+        std::ifstream in(inputPath);
+        if (!in.good())
+        {
+            fmt::print(stderr, "Error opening {}\n", argv[i]);
+            return 1;
+        }
+
+        if (!builder.load(in, inputPath.parent_path()))
+        {
+            fmt::print(stderr, "Error reading {}\n", argv[i]);
+            return 1;
+        }
+    }
+
+    std::ofstream out(argv[argc - 1], std::ios::binary);
+    if (!out.good())
+    {
+        fmt::print(stderr, "Error opening {}\n", argv[argc - 1]);
+        return 1;
+    }
+
+    if (!builder.writeBinary(out))
+    {
+        fmt::print(stderr, "Error writing {}\n", argv[argc - 1]);
+        return 1;
+    }
+
+    return 0;
+}
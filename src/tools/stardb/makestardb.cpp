@@ -1,242 +1,657 @@
 // makestardb.cpp
 //
-// Copyright (C) 2004, Chris Laurel <claurel@shatters.net>
+// Copyright (C) 2004-present, the Celestia Development Team
+// Original version by Chris Laurel <claurel@shatters.net>
 //
 // This program is free software; you can redistribute it and/or
 // modify it under the terms of the GNU General Public License
 // as published by the Free Software Foundation; either version 2
 // of the License, or (at your option) any later version.
 //
-// Convert a file with ASCII star records to a Celestia star database
-
-#include <iostream>
+// Convert a file with ASCII star records or a Gaia CSV export to a Celestia
+// star database. The input is read in chunks of lines which are parsed on
+// several threads, so large catalogs convert at the speed of the disk.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include <iomanip>
-#include <cctype>
-#include <cassert>
-#include <celastro/astro.h>
-#include <celutil/bytes.h>
-#include <celengine/star.h>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+#include <fmt/format.h>
 
-using namespace std;
+#include <celastro/astro.h>
+#include <celengine/astroobj.h>
+#include <celengine/stardbbuilder.h>
+#include <celengine/stellarclass.h>
+#include <celutil/binarywrite.h>
+#include <celutil/stringutils.h>
 
 namespace astro = celestia::astro;
+namespace util = celestia::util;
+
+namespace
+{
 
-static string inputFilename;
-static string outputFilename;
-static bool useSphericalCoords = false;
+// Lines are read in chunks of about this size, several per thread
+constexpr std::size_t ChunkSize = 8 * 1024 * 1024;
+constexpr std::size_t ChunksPerThread = 2;
+constexpr unsigned int MaxThreads = 64;
 
+// Size of the header of a version 1 stars.dat up to the star count
+constexpr std::streamoff StarCountOffset = 10;
 
-void Usage()
+enum class InputFormat
 {
-    cerr << "Usage: makestardb [options] <input file> <output star database>\n";
-    cerr << "  Options:\n";
-    cerr << "    --spherical (or -s) : input file has spherical coords (RA/dec/distance\n";
-}
+    Cartesian,
+    Spherical,
+    GaiaCSV,
+};
 
+struct Options
+{
+    std::string inputFilename;
+    std::string outputFilename;
+    InputFormat format{ InputFormat::Cartesian };
+    bool prebuiltOctree{ false };
+    unsigned int threads{ 0 };
+    AstroCatalog::IndexNumber firstCatalogNumber{ 1 };
+    std::string catalogColumn;
+};
+
+struct ParsedStar
+{
+    // AstroCatalog::InvalidIndex for stars numbered in input order
+    AstroCatalog::IndexNumber catNo;
+    Eigen::Vector3f position;
+    float absMag;
+    StellarClass sc;
+};
+
+struct Chunk
+{
+    std::string text;
+    // Line number of the first line of text, from 1
+    std::size_t firstLine{ 0 };
+    std::vector<ParsedStar> stars;
+    std::size_t skipped{ 0 };
+    std::string error;
+};
+
+// Column indices of the fields of a Gaia export used for the conversion
+struct GaiaColumns
+{
+    std::size_t count{ 0 };
+    std::size_t ra{ 0 };
+    std::size_t dec{ 0 };
+    std::size_t parallax{ 0 };
+    std::size_t magnitude{ 0 };
+    std::optional<std::size_t> catalogNumber;
+    std::optional<std::size_t> spectralType;
+    std::optional<std::size_t> color;
+};
+
+void
+usage()
+{
+    fmt::print(stderr,
+               "Usage: makestardb [options] <input file> <output star database>\n"
+               "  Options:\n"
+               "    --spherical (or -s)    : input file has spherical coords (RA/dec/distance)\n"
+               "    --gaia-csv             : input file is a CSV export of the Gaia archive\n"
+               "    --catalog-column <col> : Gaia column of the catalog numbers, e.g. hip\n"
+               "    --first-number <n>     : first number of stars without a catalog number\n"
+               "    --octree (or -o)       : write a version 2 database with a prebuilt octree\n"
+               "    --threads <n>          : number of parsing threads\n");
+}
 
-bool parseCommandLine(int argc, char* argv[])
+bool
+parseCommandLine(int argc, char* argv[], Options& options)
 {
-    int i = 1;
     int fileCount = 0;
-
-    while (i < argc)
+    for (int i = 1; i < argc; ++i)
     {
-        if (argv[i][0] == '-')
+        std::string_view arg(argv[i]);
+        if (arg.empty() || arg[0] != '-')
         {
-            if (!strcmp(argv[i], "--spherical") || !strcmp(argv[i], "-s"))
-            {
-                useSphericalCoords = true;
-            }
+            if (fileCount == 0)
+                options.inputFilename = arg;
+            else if (fileCount == 1)
+                options.outputFilename = arg;
             else
-            {
-                cerr << "Unknown command line switch: " << argv[i] << '\n';
                 return false;
-            }
-            i++;
+            ++fileCount;
+            continue;
         }
-        else
+
+        bool hasValue = i + 1 < argc;
+        if (arg == "--spherical" || arg == "-s")
         {
-            if (fileCount == 0)
-            {
-                // input filename first
-                inputFilename = string(argv[i]);
-                fileCount++;
-            }
-            else if (fileCount == 1)
-            {
-                // output filename second
-                outputFilename = string(argv[i]);
-                fileCount++;
-            }
-            else
-            {
-                // more than two filenames on the command line is an error
+            options.format = InputFormat::Spherical;
+        }
+        else if (arg == "--gaia-csv")
+        {
+            options.format = InputFormat::GaiaCSV;
+        }
+        else if (arg == "--octree" || arg == "-o")
+        {
+            options.prebuiltOctree = true;
+        }
+        else if (arg == "--catalog-column" && hasValue)
+        {
+            options.catalogColumn = argv[++i];
+        }
+        else if (arg == "--first-number" && hasValue)
+        {
+            if (!to_number(argv[++i], options.firstCatalogNumber))
                 return false;
-            }
-            i++;
+        }
+        else if (arg == "--threads" && hasValue)
+        {
+            if (!to_number(argv[++i], options.threads))
+                return false;
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown command line switch: {}\n", arg);
+            return false;
         }
     }
 
-    return true;
+    return fileCount == 2;
 }
 
+// Split off the next field of s separated by sep, or by whitespace if sep
+// is zero
+std::string_view
+nextField(std::string_view& s, char sep)
+{
+    if (sep == '\0')
+    {
+        auto start = s.find_first_not_of(" \t\r");
+        if (start == std::string_view::npos)
+        {
+            s = {};
+            return {};
+        }
+
+        s.remove_prefix(start);
+        auto end = std::min(s.find_first_of(" \t\r"), s.size());
+        std::string_view field = s.substr(0, end);
+        s.remove_prefix(end);
+        return field;
+    }
+
+    // Quoted fields of CSV files may contain separators
+    std::size_t end = 0;
+    for (bool quoted = false; end < s.size() && (quoted || s[end] != sep); ++end)
+    {
+        if (s[end] == '"')
+            quoted = !quoted;
+    }
+
+    std::string_view field = s.substr(0, end);
+    s.remove_prefix(std::min(end + 1, s.size()));
+    if (field.size() >= 2 && field.front() == '"' && field.back() == '"')
+        field = field.substr(1, field.size() - 2);
+    return field;
+}
 
-static void writeUint(ostream& out, uint32_t n)
+template<typename T>
+bool
+parseField(std::string_view& s, T& value)
 {
-    LE_TO_CPU_INT32(n, n);
-    out.write(reinterpret_cast<const char*>(&n), sizeof n);
+    return to_number(nextField(s, '\0'), value);
 }
 
-static void writeFloat(ostream& out, float f)
+std::optional<ParsedStar>
+parseTextStar(std::string_view line, bool sphericalCoords, std::string& error)
 {
-    LE_TO_CPU_FLOAT(f, f);
-    out.write(reinterpret_cast<const char*>(&f), sizeof f);
+    ParsedStar star;
+    if (!parseField(line, star.catNo))
+    {
+        error = "Error parsing catalog number";
+        return std::nullopt;
+    }
+
+    std::array<float, 4> values;
+    for (float& value : values)
+    {
+        if (!parseField(line, value))
+        {
+            error = fmt::format("Error parsing position or magnitude of star {}", star.catNo);
+            return std::nullopt;
+        }
+    }
+
+    star.sc = StellarClass::parse(nextField(line, '\0'));
+
+    if (sphericalCoords)
+    {
+        auto [ra, dec, distance, appMag] = values;
+        Eigen::Vector3d pos = astro::equatorialToCelestialCart(static_cast<double>(ra) * 24.0 / 360.0,
+                                                               static_cast<double>(dec),
+                                                               static_cast<double>(distance));
+        star.position = pos.cast<float>();
+        star.absMag = static_cast<float>(appMag + 5 - 5 * std::log10(distance / 3.26));
+    }
+    else
+    {
+        star.position = Eigen::Vector3f(values[0], values[1], values[2]);
+        star.absMag = values[3];
+    }
+
+    return star;
 }
 
-static void writeUshort(ostream& out, uint16_t n)
+// Rough spectral class of a main sequence star from its BP-RP color index
+StellarClass
+classFromColor(float bpRp)
 {
-    LE_TO_CPU_INT16(n, n);
-    out.write(reinterpret_cast<const char*>(&n), sizeof n);
+    constexpr std::array<float, 6> ClassLimits{ -0.35f, 0.0f, 0.38f, 0.72f, 0.94f, 1.84f };
+    auto spectralClass = static_cast<StellarClass::SpectralClass>(
+        std::upper_bound(ClassLimits.begin(), ClassLimits.end(), bpRp) - ClassLimits.begin());
+    return StellarClass(StellarClass::NormalStar,
+                        spectralClass,
+                        StellarClass::Subclass_Unknown,
+                        StellarClass::Lum_Unknown);
 }
 
-static void writeShort(ostream& out, int16_t n)
+// Gaia rows without a positive parallax or a magnitude can't be placed and
+// are skipped rather than treated as errors
+std::optional<ParsedStar>
+parseGaiaStar(std::string_view line,
+              const GaiaColumns& columns,
+              std::vector<std::string_view>& fields,
+              bool& skip,
+              std::string& error)
 {
-    LE_TO_CPU_INT16(n, n);
-    out.write(reinterpret_cast<const char*>(&n), sizeof n);
+    fields.clear();
+    while (!line.empty() || fields.size() < columns.count)
+    {
+        if (fields.size() == columns.count)
+        {
+            error = "Too many fields";
+            return std::nullopt;
+        }
+        fields.push_back(nextField(line, ','));
+    }
+
+    double ra;
+    double dec;
+    double parallax;
+    float magnitude;
+    if (!to_number(fields[columns.ra], ra) || !to_number(fields[columns.dec], dec))
+    {
+        error = "Error parsing position";
+        return std::nullopt;
+    }
+
+    if (!to_number(fields[columns.parallax], parallax) || parallax <= 0.0
+        || !to_number(fields[columns.magnitude], magnitude))
+    {
+        skip = true;
+        return std::nullopt;
+    }
+
+    ParsedStar star;
+    star.catNo = AstroCatalog::InvalidIndex;
+    if (columns.catalogNumber.has_value() && !fields[*columns.catalogNumber].empty()
+        && !to_number(fields[*columns.catalogNumber], star.catNo))
+    {
+        error = "Error parsing catalog number";
+        return std::nullopt;
+    }
+
+    // Parallaxes are in milliarcseconds
+    double distance = astro::parsecsToLightYears(1000.0 / parallax);
+    star.position = astro::equatorialToCelestialCart(ra / 15.0, dec, distance).cast<float>();
+    star.absMag = astro::appToAbsMag(magnitude, static_cast<float>(distance));
+
+    float bpRp;
+    if (columns.spectralType.has_value() && !fields[*columns.spectralType].empty())
+        star.sc = StellarClass::parse(fields[*columns.spectralType]);
+    else if (columns.color.has_value() && to_number(fields[*columns.color], bpRp))
+        star.sc = classFromColor(bpRp);
+    else
+        star.sc = StellarClass(StellarClass::NormalStar,
+                               StellarClass::Spectral_Unknown,
+                               StellarClass::Subclass_Unknown,
+                               StellarClass::Lum_Unknown);
+    return star;
 }
 
+bool
+parseGaiaHeader(std::string_view header, const Options& options, GaiaColumns& columns)
+{
+    std::optional<std::size_t> ra;
+    std::optional<std::size_t> dec;
+    std::optional<std::size_t> parallax;
+    std::optional<std::size_t> magnitude;
+    while (!header.empty())
+    {
+        std::string_view name = nextField(header, ',');
+        if (!name.empty() && name.back() == '\r')
+            name.remove_suffix(1);
+
+        std::size_t index = columns.count++;
+        if (name == "ra")
+            ra = index;
+        else if (name == "dec")
+            dec = index;
+        else if (name == "parallax")
+            parallax = index;
+        else if (name == "phot_g_mean_mag")
+            magnitude = index;
+        else if (name == "spectral_type")
+            columns.spectralType = index;
+        else if (name == "bp_rp")
+            columns.color = index;
+        else if (!options.catalogColumn.empty() && name == options.catalogColumn)
+            columns.catalogNumber = index;
+    }
+
+    if (!ra.has_value() || !dec.has_value() || !parallax.has_value() || !magnitude.has_value())
+    {
+        fmt::print(stderr, "Gaia CSV files need ra, dec, parallax and phot_g_mean_mag columns.\n");
+        return false;
+    }
+
+    if (!options.catalogColumn.empty() && !columns.catalogNumber.has_value())
+    {
+        fmt::print(stderr, "Column {} not found.\n", options.catalogColumn);
+        return false;
+    }
+
+    columns.ra = *ra;
+    columns.dec = *dec;
+    columns.parallax = *parallax;
+    columns.magnitude = *magnitude;
+    return true;
+}
 
-bool WriteStarDatabase(istream& in, ostream& out, bool sphericalCoords)
+void
+parseChunk(Chunk& chunk, InputFormat format, const GaiaColumns& columns)
 {
-    unsigned int nStarsInFile = 0;
+    std::vector<std::string_view> fields;
+    std::string_view text(chunk.text);
+    for (std::size_t lineNumber = chunk.firstLine; !text.empty(); ++lineNumber)
+    {
+        auto end = std::min(text.find('\n'), text.size());
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(std::min(end + 1, text.size()));
+        if (line.find_first_not_of(" \t\r") == std::string_view::npos)
+            continue;
+
+        bool skip = false;
+        std::optional<ParsedStar> star = format == InputFormat::GaiaCSV
+            ? parseGaiaStar(line, columns, fields, skip, chunk.error)
+            : parseTextStar(line, format == InputFormat::Spherical, chunk.error);
+        if (star.has_value())
+        {
+            chunk.stars.push_back(*star);
+        }
+        else if (skip)
+        {
+            ++chunk.skipped;
+        }
+        else
+        {
+            chunk.error = fmt::format("line {}: {}", lineNumber, chunk.error);
+            return;
+        }
+    }
+
+    chunk.text = std::string();
+}
 
-    in >> nStarsInFile;
+// Read the next chunk of whole lines into text. A partial last line is
+// kept in carry for the next chunk.
+bool
+readChunk(std::istream& in, std::string& carry, std::string& text)
+{
+    text = std::move(carry);
+    carry.clear();
     if (!in.good())
+        return !text.empty();
+
+    std::size_t start = text.size();
+    text.resize(start + ChunkSize);
+    in.read(text.data() + start, static_cast<std::streamsize>(ChunkSize)); /* Flawfinder: ignore */
+    text.resize(start + static_cast<std::size_t>(in.gcount()));
+
+    if (in.good())
     {
-        cerr << "Error reading star count at beginning of input file.\n";
-        return 1;
+        auto lastLine = text.rfind('\n');
+        if (lastLine != std::string::npos)
+        {
+            carry.assign(text, lastLine + 1);
+            text.resize(lastLine + 1);
+        }
     }
 
-    // Write the header
-    out.write("CELSTARS", 8);
+    return !text.empty();
+}
+
+bool
+writeStarV1(std::ostream& out, const ParsedStar& star)
+{
+    return util::writeLE<AstroCatalog::IndexNumber>(out, star.catNo)
+        && util::writeLE<float>(out, star.position.x())
+        && util::writeLE<float>(out, star.position.y())
+        && util::writeLE<float>(out, star.position.z())
+        && util::writeLE<std::int16_t>(out, static_cast<std::int16_t>(star.absMag * 256.0f))
+        && util::writeLE<std::uint16_t>(out, star.sc.packV1());
+}
+
+class StarDatabaseWriter
+{
+public:
+    StarDatabaseWriter(std::ofstream& out, bool prebuiltOctree) :
+        m_out(out), m_prebuiltOctree(prebuiltOctree)
+    {}
+
+    // Version 1 databases are written as the stars come, with the count
+    // filled in by finish(); version 2 databases need the whole catalog to
+    // build the octree.
+    bool begin()
+    {
+        if (m_prebuiltOctree)
+            return true;
+
+        m_out.write("CELSTARS", 8);
+        return util::writeLE<std::uint16_t>(m_out, 0x0100) && util::writeLE<std::uint32_t>(m_out, 0);
+    }
 
-    // Write the version
-    writeShort(out, 0x0100);
+    bool add(const ParsedStar& star)
+    {
+        ++m_count;
+        if (!m_prebuiltOctree)
+            return writeStarV1(m_out, star);
 
-    writeUint(out, nStarsInFile);
+        m_stars.push_back(StarDatabaseBuilder::BinaryStar
+        {
+            star.catNo,
+            star.position,
+            static_cast<std::int16_t>(star.absMag * 256.0f),
+            star.sc.packV2(),
+        });
+        return true;
+    }
 
-    for (unsigned int record = 0; record < nStarsInFile; record++)
+    bool finish()
     {
-        unsigned int catalogNumber;
-        float x, y, z;
-        float absMag;
+        if (m_prebuiltOctree)
+            return StarDatabaseBuilder::writeBinary(m_out, std::move(m_stars));
 
-        in >> catalogNumber;
-        if (in.eof())
-            return true;
+        m_out.seekp(StarCountOffset);
+        return util::writeLE<std::uint32_t>(m_out, m_count) && m_out.good();
+    }
+
+    std::uint32_t count() const { return m_count; }
 
-        if (!in.good())
+private:
+    std::ofstream& m_out;
+    bool m_prebuiltOctree;
+    std::uint32_t m_count{ 0 };
+    std::vector<StarDatabaseBuilder::BinaryStar> m_stars;
+};
+
+bool
+writeStarDatabase(std::istream& in, std::ofstream& out, const Options& options)
+{
+    // Text files start with the number of stars, Gaia exports with the
+    // column names
+    std::string header;
+    std::optional<std::uint32_t> maxStars;
+    GaiaColumns columns;
+    do
+    {
+        if (!std::getline(in, header))
         {
-            cerr << "Error parsing catalog number for record #" << record << '\n';
+            fmt::print(stderr, "Error reading the header of the input file.\n");
             return false;
         }
+    } while (options.format == InputFormat::GaiaCSV && !header.empty() && header.front() == '#');
 
-        if (sphericalCoords)
+    if (options.format == InputFormat::GaiaCSV)
+    {
+        if (!parseGaiaHeader(header, options, columns))
+            return false;
+    }
+    else
+    {
+        std::string_view countField(header);
+        std::uint32_t nStars;
+        if (!to_number(nextField(countField, '\0'), nStars))
         {
-            float RA, dec, distance;
-            float appMag;
+            fmt::print(stderr, "Error reading star count at beginning of input file.\n");
+            return false;
+        }
 
-            in >> RA >> dec >> distance;
-            if (!in.good())
-            {
-                cerr << "Error parsing position of star " << catalogNumber << '\n';
-                return false;
-            }
+        maxStars = nStars;
+    }
 
-            in >> appMag;
-            if (!in.good())
+    unsigned int nThreads = options.threads > 0
+        ? std::min(options.threads, MaxThreads)
+        : std::clamp(std::thread::hardware_concurrency(), 1U, MaxThreads);
+    std::size_t batchSize = nThreads * ChunksPerThread;
+
+    StarDatabaseWriter writer(out, options.prebuiltOctree);
+    if (!writer.begin())
+        return false;
+
+    AstroCatalog::IndexNumber nextCatalogNumber = options.firstCatalogNumber;
+    std::size_t skipped = 0;
+    std::size_t nextLine = 2;
+    std::string carry;
+    std::vector<Chunk> chunks;
+    for (bool done = false; !done;)
+    {
+        chunks.clear();
+        while (chunks.size() < batchSize)
+        {
+            Chunk& chunk = chunks.emplace_back();
+            if (!readChunk(in, carry, chunk.text))
             {
-                cerr << "Error parsing magnitude of star " << catalogNumber << '\n';
-                return false;
+                chunks.pop_back();
+                break;
             }
 
-            Eigen::Vector3d pos =
-                astro::equatorialToCelestialCart((double) RA * 24.0 / 360.0,
-                                                 (double) dec,
-                                                 (double) distance);
-            x = (float) pos.x();
-            y = (float) pos.y();
-            z = (float) pos.z();
-            absMag = (float) (appMag + 5 - 5 * log10(distance / 3.26));
+            chunk.firstLine = nextLine;
+            nextLine += static_cast<std::size_t>(std::count(chunk.text.begin(), chunk.text.end(), '\n'));
         }
-        else
+
+        if (chunks.empty())
+            break;
+
+        std::atomic<std::size_t> nextChunk{ 0 };
+        auto worker = [&]()
+        {
+            for (std::size_t i = nextChunk++; i < chunks.size(); i = nextChunk++)
+                parseChunk(chunks[i], options.format, columns);
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1, end = std::min<std::size_t>(nThreads, chunks.size()); i < end; ++i)
+            threads.emplace_back(worker);
+        worker();
+        for (std::thread& thread : threads)
+            thread.join();
+
+        // The chunks are written in input order, up to the first error
+        for (const Chunk& chunk : chunks)
         {
-            in >> x >> y >> z;
-            if (!in.good())
+            skipped += chunk.skipped;
+            for (const ParsedStar& star : chunk.stars)
             {
-                cerr << "Error parsing position of star " << catalogNumber << '\n';
-                return false;
+                if (maxStars.has_value() && writer.count() == *maxStars)
+                {
+                    done = true;
+                    break;
+                }
+
+                if (star.catNo != AstroCatalog::InvalidIndex)
+                {
+                    if (!writer.add(star))
+                        return false;
+                    continue;
+                }
+
+                ParsedStar numbered = star;
+                numbered.catNo = nextCatalogNumber++;
+                if (!writer.add(numbered))
+                    return false;
             }
 
-            in >> absMag;
-            if (!in.good())
+            if (!chunk.error.empty() && !done)
             {
-                cerr << "Error parsing magnitude of star " << catalogNumber << '\n';
+                fmt::print(stderr, "Error in {}, {}\n", options.inputFilename, chunk.error);
                 return false;
             }
         }
-
-        string scString;
-        in >> scString;
-        StellarClass sc = StellarClass::parse(scString);
-#if 0
-        StarDetails* details = StarDetails::GetStarDetails(sc);
-        if (details == NULL)
-        {
-            cerr << "Error parsing spectral type of star " << catalogNumber << '\n';
-            return false;
-        }
-
-        // For spectral type parser debugging . . .
-        cout << scString << ' ' << details->getSpectralType() << '\n';
-#endif
-
-        writeUint(out, catalogNumber);
-        writeFloat(out, x);
-        writeFloat(out, y);
-        writeFloat(out, z);
-        writeShort(out, (int16_t) (absMag * 256.0f));
-        writeUshort(out, sc.packV1());
     }
 
-    return true;
+    if (skipped > 0)
+        fmt::print(stderr, "Skipped {} stars without a parallax or magnitude.\n", skipped);
+
+    return writer.finish();
 }
 
+} // end unnamed namespace
 
 int main(int argc, char* argv[])
 {
-    if (!parseCommandLine(argc, argv) || inputFilename.empty())
+    Options options;
+    if (!parseCommandLine(argc, argv, options))
     {
-        Usage();
+        usage();
         return 1;
     }
 
-    ifstream inputFile(inputFilename, ios::in);
+    std::ifstream inputFile(options.inputFilename, std::ios::in | std::ios::binary);
     if (!inputFile.good())
     {
-        cerr << "Error opening input file " << inputFilename << '\n';
+        fmt::print(stderr, "Error opening input file {}\n", options.inputFilename);
         return 1;
     }
 
-    ofstream stardbFile(outputFilename, ios::out | ios::binary);
+    std::ofstream stardbFile(options.outputFilename, std::ios::out | std::ios::binary);
     if (!stardbFile.good())
     {
-        cerr << "Error opening star database file " << outputFilename << '\n';
+        fmt::print(stderr, "Error opening star database file {}\n", options.outputFilename);
         return 1;
     }
 
-    bool success = WriteStarDatabase(inputFile, stardbFile, useSphericalCoords);
-
-    return success ? 0 : 1;
+    return writeStarDatabase(inputFile, stardbFile, options) ? 0 : 1;
 }
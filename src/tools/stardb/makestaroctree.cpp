@@ -0,0 +1,49 @@
+// makestaroctree.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// Convert a version 1 star database to the version 2 format, which contains
+// a prebuilt octree and catalog number index for faster loading.
+
+#include <cstdio>
+#include <fstream>
+
+#include <fmt/format.h>
+
+#include <celengine/stardbbuilder.h>
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fmt::print(stderr, "Usage: {} <input stars.dat> <output stars.dat>\n", argv[0]);
+        return 1;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in.good())
+    {
+        fmt::print(stderr, "Error opening {}\n", argv[1]);
+        return 1;
+    }
+
+    std::ofstream out(argv[2], std::ios::binary);
+    if (!out.good())
+    {
+        fmt::print(stderr, "Error opening {}\n", argv[2]);
+        return 1;
+    }
+
+    if (!StarDatabaseBuilder::convertBinary(in, out))
+    {
+        fmt::print(stderr, "Error converting {} to {}.\n", argv[1], argv[2]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -9,22 +9,28 @@
 //
 // Convert an ASCII cross index to binary
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include <celutil/bytes.h>
 
 
 static std::string inputFilename;
 static std::string outputFilename;
+static bool sorted = false;
 
 
 void Usage()
 {
-    std::cerr << "Usage: makexindex [input file] [output file]\n";
+    std::cerr << "Usage: makexindex [--sorted] [input file] [output file]\n";
 }
 
 
@@ -37,8 +43,13 @@ bool parseCommandLine(int argc, char* argv[])
     {
         if (argv[i][0] == '-')
         {
-            std::cerr << "Unknown command line switch: " << argv[i] << '\n';
-            return false;
+            if (std::string_view(argv[i]) != "--sorted")
+            {
+                std::cerr << "Unknown command line switch: " << argv[i] << '\n';
+                return false;
+            }
+            sorted = true;
+            i++;
         }
         else
         {
@@ -116,6 +127,67 @@ bool WriteCrossIndex(std::istream& in, std::ostream& out)
 }
 
 
+// Write a version 2 cross index: the records sorted by catalog number, then
+// the records sorted by Celestia catalog number. Of duplicate numbers, the
+// record with the lowest catalog number is kept, as when Celestia loads a
+// version 1 cross index.
+bool WriteSortedCrossIndex(std::istream& in, std::ostream& out)
+{
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> records;
+    for (;;)
+    {
+        std::uint32_t catalogNumber;
+        std::uint32_t celCatalogNumber;
+
+        in >> catalogNumber;
+        if (in.eof())
+            break;
+
+        in >> celCatalogNumber;
+        if (!in.good())
+        {
+            std::cerr << "Error parsing record #" << records.size() << '\n';
+            return false;
+        }
+
+        records.emplace_back(catalogNumber, celCatalogNumber);
+    }
+
+    std::sort(records.begin(), records.end());
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> toCelestia;
+    std::unique_copy(records.begin(), records.end(), std::back_inserter(toCelestia),
+                     [](const auto& a, const auto& b) { return a.first == b.first; });
+
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> fromCelestia(records);
+    std::stable_sort(fromCelestia.begin(), fromCelestia.end(),
+                     [](const auto& a, const auto& b) { return a.second < b.second; });
+    fromCelestia.erase(std::unique(fromCelestia.begin(), fromCelestia.end(),
+                                   [](const auto& a, const auto& b) { return a.second == b.second; }),
+                       fromCelestia.end());
+
+    out.write("CELINDEX", 8);
+    writeShort(out, 0x0200);
+    writeShort(out, 0);
+    writeUint(out, static_cast<std::uint32_t>(toCelestia.size()));
+    writeUint(out, static_cast<std::uint32_t>(fromCelestia.size()));
+
+    for (const auto& [catalogNumber, celCatalogNumber] : toCelestia)
+    {
+        writeUint(out, catalogNumber);
+        writeUint(out, celCatalogNumber);
+    }
+
+    for (const auto& [catalogNumber, celCatalogNumber] : fromCelestia)
+    {
+        writeUint(out, catalogNumber);
+        writeUint(out, celCatalogNumber);
+    }
+
+    return out.good();
+}
+
+
 int main(int argc, char* argv[])
 {
     if (!parseCommandLine(argc, argv)/* || inputFilename.empty()*/)
@@ -150,7 +222,9 @@ int main(int argc, char* argv[])
         outputFile = &fout;
     }
 
-    bool success = WriteCrossIndex(*inputFile, *outputFile);
+    bool success = sorted
+        ? WriteSortedCrossIndex(*inputFile, *outputFile)
+        : WriteCrossIndex(*inputFile, *outputFile);
 
     return success ? 0 : 1;
 }
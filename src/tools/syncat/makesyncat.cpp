@@ -0,0 +1,92 @@
+// makesyncat.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// Write a synthetic catalog of a given size, e.g. to test the loading and
+// rendering of catalogs much larger than those shipped with Celestia.
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <celutil/stringutils.h>
+#include "syncatalog.h"
+
+namespace syncat = celestia::syncat;
+
+namespace
+{
+
+void
+usage(const char* name)
+{
+    fmt::print(stderr,
+               "Usage: {} <kind> <count> <output file> [seed]\n"
+               "\n"
+               "kind is one of:\n"
+               "  stars      binary stars.dat\n"
+               "  stc        star catalog\n"
+               "  galaxies   deep sky catalog of galaxies\n"
+               "  asteroids  solar system catalog of main belt asteroids\n",
+               name);
+}
+
+} // end unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 4 || argc > 5)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::uint32_t count;
+    std::uint32_t seed = 1;
+    if (!to_number(argv[2], count) || (argc == 5 && !to_number(argv[4], seed)))
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string_view kind(argv[1]);
+    std::string catalog;
+    if (kind == "stars")
+        catalog = syncat::makeStarsDat(count, seed);
+    else if (kind == "stc")
+        catalog = syncat::makeStc(count, seed);
+    else if (kind == "galaxies")
+        catalog = syncat::makeGalaxyDsc(count, seed);
+    else if (kind == "asteroids")
+        catalog = syncat::makeMinorBodySsc(count, seed);
+    else
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::ofstream out(argv[3], std::ios::binary);
+    if (!out.good())
+    {
+        fmt::print(stderr, "Error opening {}\n", argv[3]);
+        return 1;
+    }
+
+    out.write(catalog.data(), static_cast<std::streamsize>(catalog.size()));
+    if (!out.good())
+    {
+        fmt::print(stderr, "Error writing {}\n", argv[3]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,327 @@
+// syncatalog.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Synthetic star, galaxy and minor body catalogs for tests and benchmarks.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "syncatalog.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <random>
+
+#include <Eigen/Core>
+#include <fmt/format.h>
+
+#include <celastro/astro.h>
+#include <celengine/stellarclass.h>
+#include <celmath/mathlib.h>
+#include <celmath/randutils.h>
+
+using namespace std::string_view_literals;
+
+namespace celestia::syncat
+{
+
+namespace
+{
+
+template<typename T>
+void
+append(std::string& s, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    s.append(bytes, sizeof(T));
+}
+
+constexpr std::array<StellarClass::SpectralClass, 7> SpectralClasses
+{
+    StellarClass::Spectral_O,
+    StellarClass::Spectral_B,
+    StellarClass::Spectral_A,
+    StellarClass::Spectral_F,
+    StellarClass::Spectral_G,
+    StellarClass::Spectral_K,
+    StellarClass::Spectral_M,
+};
+
+constexpr std::string_view SpectralLetters = "OBAFGKM"sv;
+
+// Fraction of the main sequence stars of each class near the Sun
+constexpr std::array<double, 7> SpectralAbundances
+{
+    0.00003, 0.0013, 0.006, 0.03, 0.076, 0.121, 0.7657,
+};
+
+// Main sequence absolute magnitude at subclass 0 of each class and at the
+// end of the M class
+constexpr std::array<float, 8> MainSequenceMagnitudes
+{
+    -6.0f, -4.0f, 0.6f, 2.7f, 4.4f, 5.9f, 8.8f, 16.0f,
+};
+
+constexpr float GiantFraction = 0.01f;
+
+struct SyntheticStar
+{
+    std::size_t spectralClass;
+    unsigned int subclass;
+    bool giant;
+    float absMag;
+};
+
+// Spectral classes and magnitudes drawn from the distributions above
+class StarGenerator
+{
+public:
+    template<typename RNG>
+    SyntheticStar operator()(RNG& rng)
+    {
+        SyntheticStar star;
+        star.giant = math::RealDists<float>::Unit(rng) < GiantFraction;
+        // Giants are evolved stars of classes G to M
+        star.spectralClass = star.giant ? giantClass(rng) : spectralClass(rng);
+        star.subclass = subclass(rng);
+        if (star.giant)
+        {
+            star.absMag = giantMag(rng);
+        }
+        else
+        {
+            float m0 = MainSequenceMagnitudes[star.spectralClass];
+            float m1 = MainSequenceMagnitudes[star.spectralClass + 1];
+            star.absMag = m0 + (m1 - m0) * static_cast<float>(star.subclass) / 10.0f + scatter(rng);
+        }
+
+        star.absMag = std::clamp(star.absMag, -20.0f, 20.0f);
+        return star;
+    }
+
+private:
+    std::discrete_distribution<std::size_t> spectralClass{ SpectralAbundances.begin(), SpectralAbundances.end() };
+    std::uniform_int_distribution<std::size_t> giantClass{ 4, 6 };
+    std::uniform_int_distribution<unsigned int> subclass{ 0, 9 };
+    std::normal_distribution<float> scatter{ 0.0f, 0.5f };
+    std::normal_distribution<float> giantMag{ 0.5f, 1.0f };
+};
+
+// Roughly the shape of the galaxy: most stars in an exponential disc, the
+// others in a halo around it
+template<typename RNG>
+Eigen::Vector3f
+starPosition(RNG& rng)
+{
+    constexpr float DiscRadius = 25000.0f;
+    constexpr float HaloFraction = 0.1f;
+
+    std::normal_distribution<float> haloRadius(0.0f, 8000.0f);
+    std::gamma_distribution<float> discRadius(2.0f, 6000.0f);
+    std::exponential_distribution<float> height(1.0f / 500.0f);
+    if (math::RealDists<float>::Unit(rng) < HaloFraction)
+        return math::randomOnSphere<float>(rng) * std::abs(haloRadius(rng));
+
+    float r;
+    do
+    {
+        r = discRadius(rng);
+    } while (r > DiscRadius);
+
+    Eigen::Vector2f direction = math::randomOnCircle<float>(rng);
+    float y = math::RealDists<float>::SignedUnit(rng) < 0.0f ? -height(rng) : height(rng);
+    return Eigen::Vector3f(r * direction.x(), y, r * direction.y());
+}
+
+// Distance from the origin of points uniform in the volume between two
+// spheres
+template<typename RNG>
+double
+volumeDistance(RNG& rng, double minDistance, double maxDistance)
+{
+    double u = math::RealDists<double>::Unit(rng);
+    return std::cbrt(math::cube(minDistance) + u * (math::cube(maxDistance) - math::cube(minDistance)));
+}
+
+// Rayleigh distributed values, as for the eccentricities and inclinations
+// of a dynamically excited population
+template<typename RNG>
+double
+rayleigh(RNG& rng, double sigma)
+{
+    return sigma * std::sqrt(-2.0 * std::log(1.0 - math::RealDists<double>::Unit(rng)));
+}
+
+} // end unnamed namespace
+
+std::string
+makeStarsDat(std::uint32_t count, std::uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    StarGenerator randomStar;
+
+    std::string data("CELSTARS");
+    data.reserve(data.size() + 6 + static_cast<std::size_t>(count) * 20);
+    append(data, std::uint16_t(0x0100));
+    append(data, count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        Eigen::Vector3f position = starPosition(rng);
+        SyntheticStar star = randomStar(rng);
+        StellarClass sc(StellarClass::NormalStar,
+                        SpectralClasses[star.spectralClass],
+                        star.subclass,
+                        star.giant ? StellarClass::Lum_III : StellarClass::Lum_V);
+        append(data, i + 1);
+        append(data, position.x());
+        append(data, position.y());
+        append(data, position.z());
+        append(data, static_cast<std::int16_t>(star.absMag * 256.0f));
+        append(data, sc.packV1());
+    }
+
+    return data;
+}
+
+std::string
+makeStc(std::uint32_t count, std::uint32_t seed)
+{
+    constexpr double MinDistance = 1.0;
+    constexpr double MaxDistance = 5000.0;
+
+    std::mt19937 rng(seed);
+    StarGenerator randomStar;
+
+    std::string stc;
+    auto out = std::back_inserter(stc);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        Eigen::Vector3d direction = math::randomOnSphere<double>(rng);
+        double distance = volumeDistance(rng, MinDistance, MaxDistance);
+        double ra = math::radToDeg(std::atan2(direction.y(), direction.x()));
+        double dec = math::radToDeg(std::asin(direction.z()));
+        SyntheticStar star = randomStar(rng);
+        float appMag = astro::absToAppMag(star.absMag, static_cast<float>(distance));
+
+        fmt::format_to(out,
+                       "{} {{ RA {:.6f} Dec {:.6f} Distance {:.3f} SpectralType \"{}{}{}\" AppMag {:.2f} }}\n",
+                       i + 1, ra < 0.0 ? ra + 360.0 : ra, dec, distance,
+                       SpectralLetters[star.spectralClass], star.subclass, star.giant ? "III" : "V",
+                       appMag);
+    }
+
+    return stc;
+}
+
+std::string
+makeGalaxyDsc(std::uint32_t count, std::uint32_t seed)
+{
+    constexpr double MinDistance = 1.0e6;
+    constexpr double MaxDistance = 5.0e8;
+
+    // Ellipticals, lenticulars, spirals, barred spirals and irregulars in
+    // the ratio 20:10:39:26:5
+    constexpr std::array<std::string_view, 16> Types
+    {
+        "E0"sv, "E1"sv, "E2"sv, "E3"sv, "E4"sv, "E5"sv, "E6"sv, "E7"sv,
+        "S0"sv, "Sa"sv, "Sb"sv, "Sc"sv, "SBa"sv, "SBb"sv, "SBc"sv, "Irr"sv,
+    };
+    constexpr std::array<double, 16> TypeWeights
+    {
+        2.5, 2.5, 2.5, 2.5, 2.5, 2.5, 2.5, 2.5,
+        10.0, 13.0, 13.0, 13.0, 8.67, 8.67, 8.67, 5.0,
+    };
+
+    std::mt19937 rng(seed);
+    std::discrete_distribution<std::size_t> type(TypeWeights.begin(), TypeWeights.end());
+    std::lognormal_distribution<double> radius(std::log(30000.0), 0.5);
+    std::normal_distribution<double> absMag(-20.0, 1.2);
+    std::uniform_real_distribution<double> angle(0.0, 360.0);
+
+    std::string dsc;
+    auto out = std::back_inserter(dsc);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        Eigen::Vector3d direction = math::randomOnSphere<double>(rng);
+        double distance = volumeDistance(rng, MinDistance, MaxDistance);
+        double ra = math::radToDeg(std::atan2(direction.y(), direction.x())) / 15.0;
+        double dec = math::radToDeg(std::asin(direction.z()));
+        Eigen::Vector3d axis = math::randomOnSphere<double>(rng);
+
+        fmt::format_to(out,
+                       "Galaxy \"SynGal {}\"\n"
+                       "{{\n"
+                       "\tType \"{}\"\n"
+                       "\tRA {:.6f}\n"
+                       "\tDec {:.6f}\n"
+                       "\tDistance {:.0f}\n"
+                       "\tRadius {:.0f}\n"
+                       "\tAxis [ {:.4f} {:.4f} {:.4f} ]\n"
+                       "\tAngle {:.2f}\n"
+                       "\tAbsMag {:.2f}\n"
+                       "}}\n\n",
+                       i + 1, Types[type(rng)], ra < 0.0 ? ra + 24.0 : ra, dec, distance,
+                       radius(rng), axis.x(), axis.y(), axis.z(), angle(rng), absMag(rng));
+    }
+
+    return dsc;
+}
+
+std::string
+makeMinorBodySsc(std::uint32_t count, std::uint32_t seed, std::string_view parent)
+{
+    // Cumulative size distribution N(>r) ~ r^-q from 1 km up
+    constexpr double MinRadius = 1.0;
+    constexpr double MaxRadius = 500.0;
+    constexpr double SizeIndex = 2.5;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> sma(2.1, 3.3);
+    std::uniform_real_distribution<double> angle(0.0, 360.0);
+    std::uniform_real_distribution<double> albedo(0.03, 0.3);
+    std::uniform_real_distribution<double> rotationPeriod(2.0, 20.0);
+
+    std::string ssc;
+    auto out = std::back_inserter(ssc);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        double a = sma(rng);
+        double e = std::min(rayleigh(rng, 0.1), 0.4);
+        double inclination = std::min(rayleigh(rng, 7.0), 40.0);
+        double r = std::min(MinRadius * std::pow(1.0 - math::RealDists<double>::Unit(rng), -1.0 / SizeIndex),
+                            MaxRadius);
+
+        fmt::format_to(out,
+                       "\"Asteroid {}\" \"{}\"\n"
+                       "{{\n"
+                       "\tClass \"asteroid\"\n"
+                       "\tRadius {:.2f}\n"
+                       "\tColor [ 0.6 0.55 0.5 ]\n"
+                       "\tEllipticalOrbit\n"
+                       "\t{{\n"
+                       "\t\tPeriod {:.6f}\n"
+                       "\t\tSemiMajorAxis {:.6f}\n"
+                       "\t\tEccentricity {:.6f}\n"
+                       "\t\tInclination {:.4f}\n"
+                       "\t\tAscendingNode {:.4f}\n"
+                       "\t\tArgOfPericenter {:.4f}\n"
+                       "\t\tMeanAnomaly {:.4f}\n"
+                       "\t}}\n"
+                       "\tUniformRotation {{ Period {:.3f} }}\n"
+                       "\tAlbedo {:.3f}\n"
+                       "}}\n\n",
+                       i + 1, parent, r, std::pow(a, 1.5), a, e, inclination,
+                       angle(rng), angle(rng), angle(rng), rotationPeriod(rng), albedo(rng));
+    }
+
+    return ssc;
+}
+
+} // end namespace celestia::syncat
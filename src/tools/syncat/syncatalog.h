@@ -0,0 +1,45 @@
+// syncatalog.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Synthetic star, galaxy and minor body catalogs for tests and benchmarks.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace celestia::syncat
+{
+
+// Each catalog depends only on the count and the seed of its std::mt19937,
+// so a test or benchmark can generate the same one on every run instead of
+// reading it from a file. The standard distributions are implementation
+// defined, so the values may differ between standard libraries.
+
+// A version 1 stars.dat with count stars in a disc about 50000 ly across
+// and a halo around it. The spectral classes follow their abundance in the
+// solar neighbourhood, with about one star in a hundred a giant, and the
+// absolute magnitudes follow the main sequence with some scatter.
+std::string makeStarsDat(std::uint32_t count, std::uint32_t seed);
+
+// A .stc catalog with count stars uniform in space within 5000 ly of the
+// Sun, with the classes and magnitudes of makeStarsDat.
+std::string makeStc(std::uint32_t count, std::uint32_t seed);
+
+// A .dsc catalog with count galaxies uniform in space between 1 and 500
+// million ly away, in roughly the proportions, sizes and magnitudes of the
+// Hubble types of the nearby universe.
+std::string makeGalaxyDsc(std::uint32_t count, std::uint32_t seed);
+
+// A .ssc catalog with count main belt asteroids on elliptical orbits
+// around the star parent, with a power law size distribution.
+std::string makeMinorBodySsc(std::uint32_t count, std::uint32_t seed, std::string_view parent = "Sol");
+
+} // end namespace celestia::syncat
@@ -0,0 +1,410 @@
+// traj2cheb.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Compile a trajectory into a file of Chebyshev segments.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// The source is a sampled trajectory (xyz, xyzv or binary xyzv, such as
+// the output of spice2xyzv) or one of the built-in custom orbits. Each
+// segment is fitted at the Chebyshev nodes and checked between them; its
+// span is halved until the error is within the tolerance, and grows again
+// along smooth parts of the trajectory.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <Eigen/Core>
+
+#include <celcompat/bit.h>
+#include <celcompat/numbers.h>
+#include <celephem/chebyshevbinary.h>
+#include <celephem/customorbit.h>
+#include <celephem/orbit.h>
+#include <celephem/samporbit.h>
+#include <celutil/filetype.h>
+
+using celestia::ephem::Orbit;
+
+namespace
+{
+
+constexpr double MinSpan = 1.0e-5;
+
+struct Options
+{
+    std::string source;
+    std::string outputFilename;
+    bool customOrbit{ false };
+    double begin{ std::numeric_limits<double>::quiet_NaN() };
+    double end{ std::numeric_limits<double>::quiet_NaN() };
+    double tolerance{ 0.001 };
+    double maxSpan{ 64.0 };
+    std::uint32_t coeffCount{ 12 };
+};
+
+
+void
+Usage()
+{
+    fmt::print(stderr,
+               "Usage: traj2cheb [options] <trajectory file> <output file>\n"
+               "       traj2cheb [options] --custom <orbit name> <output file>\n"
+               "  Options:\n"
+               "    --begin <jd>          : start of the trajectory (TDB)\n"
+               "    --end <jd>            : end of the trajectory (TDB)\n"
+               "    --tolerance <km>      : maximum error of the fit (default 0.001)\n"
+               "    --max-span <days>     : maximum span of a segment (default 64)\n"
+               "    --coefficients <n>    : coefficients per coordinate (default 12)\n"
+               "  The time range is required for custom orbits; it defaults to the\n"
+               "  range of the samples for trajectory files.\n");
+}
+
+
+bool
+ParseDouble(const char* arg, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(arg, &end);
+    return end != arg && *end == '\0' && std::isfinite(value);
+}
+
+
+bool
+ParseCommandLine(int argc, char* argv[], Options& options)
+{
+    int fileCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        if (arg == "--custom")
+        {
+            options.customOrbit = true;
+            continue;
+        }
+
+        if (arg.size() > 1 && arg[0] == '-')
+        {
+            if (i + 1 == argc)
+            {
+                fmt::print(stderr, "Missing value for {}\n", arg);
+                return false;
+            }
+
+            const char* value = argv[++i];
+            bool ok = false;
+            if (arg == "--begin")
+            {
+                ok = ParseDouble(value, options.begin);
+            }
+            else if (arg == "--end")
+            {
+                ok = ParseDouble(value, options.end);
+            }
+            else if (arg == "--tolerance")
+            {
+                ok = ParseDouble(value, options.tolerance) && options.tolerance > 0.0;
+            }
+            else if (arg == "--max-span")
+            {
+                ok = ParseDouble(value, options.maxSpan) && options.maxSpan >= MinSpan;
+            }
+            else if (arg == "--coefficients")
+            {
+                double n;
+                ok = ParseDouble(value, n) && n >= 2 && n <= celestia::ephem::ChebyshevMaxCoeffs && n == std::floor(n);
+                if (ok)
+                    options.coeffCount = static_cast<std::uint32_t>(n);
+            }
+            else
+            {
+                fmt::print(stderr, "Unknown command line switch: {}\n", arg);
+                return false;
+            }
+
+            if (!ok)
+            {
+                fmt::print(stderr, "Bad value {} for {}\n", value, arg);
+                return false;
+            }
+        }
+        else if (fileCount == 0)
+        {
+            options.source = arg;
+            fileCount++;
+        }
+        else if (fileCount == 1)
+        {
+            options.outputFilename = arg;
+            fileCount++;
+        }
+        else
+        {
+            fmt::print(stderr, "Too many file names on command line.\n");
+            return false;
+        }
+    }
+
+    return fileCount == 2;
+}
+
+
+std::shared_ptr<const Orbit>
+LoadSource(const Options& options)
+{
+    if (options.customOrbit)
+    {
+        // Fit the theory itself rather than the windows fitted to it at
+        // runtime, which are only accurate to about a metre
+        auto orbit = celestia::ephem::GetCustomOrbit(options.source);
+        if (const auto* fitted = dynamic_cast<const celestia::ephem::FittedOrbit*>(orbit.get()); fitted != nullptr)
+            return fitted->getFittedOrbit();
+        return orbit;
+    }
+
+    switch (DetermineFileType(options.source))
+    {
+    case ContentType::CelestiaXYZTrajectory:
+    case ContentType::CelestiaXYZVTrajectory:
+    case ContentType::CelestiaXYZVBinary:
+        return celestia::ephem::LoadSampledTrajectory(options.source,
+                                                      celestia::ephem::TrajectoryInterpolation::Cubic,
+                                                      celestia::ephem::TrajectoryPrecision::Double);
+    default:
+        fmt::print(stderr, "Unknown type of trajectory file {}\n", options.source);
+        return nullptr;
+    }
+}
+
+
+// Position in the J2000 ecliptic frame of the file
+Eigen::Vector3d
+EclipticPosition(const Orbit& orbit, double tdb)
+{
+    Eigen::Vector3d p = orbit.positionAtTime(tdb);
+    return Eigen::Vector3d(p.x(), -p.z(), p.y());
+}
+
+
+Eigen::Vector3d
+Evaluate(const std::vector<Eigen::Vector3d>& coeffs, double x)
+{
+    Eigen::Vector3d b1 = Eigen::Vector3d::Zero();
+    Eigen::Vector3d b2 = Eigen::Vector3d::Zero();
+    for (std::size_t j = coeffs.size() - 1; j > 0; j--)
+    {
+        Eigen::Vector3d b0 = coeffs[j] + 2.0 * x * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+
+    return coeffs[0] + x * b1 - b2;
+}
+
+
+// Fit a segment and return the largest error found between the nodes
+double
+FitSegment(const Orbit& orbit, double start, double span, std::vector<Eigen::Vector3d>& coeffs)
+{
+    using celestia::numbers::pi;
+
+    auto n = static_cast<unsigned int>(coeffs.size());
+    std::vector<Eigen::Vector3d> values(n);
+    for (unsigned int k = 0; k < n; k++)
+    {
+        double x = std::cos(pi * (k + 0.5) / n);
+        values[k] = EclipticPosition(orbit, start + (x + 1.0) * 0.5 * span);
+    }
+
+    for (unsigned int j = 0; j < n; j++)
+    {
+        Eigen::Vector3d c = Eigen::Vector3d::Zero();
+        for (unsigned int k = 0; k < n; k++)
+            c += values[k] * std::cos(pi * j * (k + 0.5) / n);
+        coeffs[j] = c * ((j == 0 ? 1.0 : 2.0) / n);
+    }
+
+    // Check at the ends and halfway between the nodes, where the error is
+    // largest
+    double error = 0.0;
+    for (unsigned int i = 0; i <= n; i++)
+    {
+        double x = std::cos(pi * i / n);
+        Eigen::Vector3d p = EclipticPosition(orbit, start + (x + 1.0) * 0.5 * span);
+        error = std::max(error, (Evaluate(coeffs, x) - p).norm());
+    }
+
+    return error;
+}
+
+
+bool
+WriteSegments(const Options& options, const Orbit& orbit, double begin, double end)
+{
+    using celestia::ephem::ChebyshevBinaryHeader;
+    using celestia::ephem::CHEBYSHEV_MAGIC;
+
+    std::ofstream out(options.outputFilename, std::ios::binary);
+    if (!out.good())
+    {
+        fmt::print(stderr, "Error opening {}.\n", options.outputFilename);
+        return false;
+    }
+
+    std::array<char, sizeof(ChebyshevBinaryHeader)> header = {};
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, magic), CHEBYSHEV_MAGIC.data(), CHEBYSHEV_MAGIC.size());
+
+    auto byteOrder = static_cast<decltype(ChebyshevBinaryHeader::byteOrder)>(celestia::compat::endian::native);
+    auto digits =    static_cast<decltype(ChebyshevBinaryHeader::digits)   >(std::numeric_limits<double>::digits);
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, byteOrder),  &byteOrder,          sizeof(byteOrder));
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, digits),     &digits,             sizeof(digits));
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, coeffCount), &options.coeffCount, sizeof(options.coeffCount));
+
+    // write empty header, will update it later
+    if (!out.write(header.data(), header.size()))
+        return false;
+
+    std::vector<Eigen::Vector3d> coeffs(options.coeffCount);
+    std::vector<Eigen::Vector3d> halfCoeffs(options.coeffCount);
+    std::vector<double> segment(celestia::ephem::ChebyshevSegmentSize(options.coeffCount));
+    decltype(ChebyshevBinaryHeader::count) count = 0;
+    std::uint64_t badCount = 0;
+    double maxError = 0.0;
+    double span = std::min(options.maxSpan, end - begin);
+    double start = begin;
+    while (start < end)
+    {
+        // Don't leave a sliver at the end of the trajectory
+        if (end - start - span < MinSpan)
+            span = end - start;
+
+        double trySpan = span;
+        double error = FitSegment(orbit, start, span, coeffs);
+        while (error > options.tolerance && span > MinSpan)
+        {
+            // Errors close to the tolerance which don't shrink with the span
+            // are noise in the source, like the rounding errors of theories
+            // evaluated at Julian dates; shorter segments won't help. Larger
+            // ones are discontinuities, which a segment boundary will match.
+            double halfSpan = std::max(span * 0.5, MinSpan);
+            double halfError = FitSegment(orbit, start, halfSpan, halfCoeffs);
+            if (halfError > error * 0.5 && error < options.tolerance * 10.0)
+                break;
+
+            span = halfSpan;
+            error = halfError;
+            std::swap(coeffs, halfCoeffs);
+        }
+
+        maxError = std::max(maxError, error);
+
+        // The last segment ends exactly at the end of the trajectory
+        double segmentEnd = span == end - start ? end : start + span;
+        segment[0] = start;
+        segment[1] = segmentEnd;
+        for (std::uint32_t j = 0; j < options.coeffCount; j++)
+        {
+            segment[2 + j]                          = coeffs[j].x();
+            segment[2 + options.coeffCount + j]     = coeffs[j].y();
+            segment[2 + 2 * options.coeffCount + j] = coeffs[j].z();
+        }
+
+        if (!out.write(reinterpret_cast<const char*>(segment.data()), segment.size() * sizeof(double)))
+        {
+            fmt::print(stderr, "Error writing output file, segment N{}\n", count);
+            return false;
+        }
+
+        count++;
+        start = segmentEnd;
+
+        // Try a longer span after a segment fitted at the first try, and
+        // past discontinuities
+        if (error > options.tolerance)
+            badCount++;
+        if (error > options.tolerance || span == trySpan)
+            span = std::min(span * 2.0, options.maxSpan);
+    }
+
+    fmt::print(stderr, "Written {} segments, largest error {} km.\n", count, maxError);
+    if (badCount > 0)
+        fmt::print(stderr, "{} segments are above the tolerance.\n", badCount);
+
+    // write actual header
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, count), &count, sizeof(count));
+
+    out.seekp(0);
+    return !!out.write(header.data(), header.size());
+}
+
+} // end unnamed namespace
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseCommandLine(argc, argv, options))
+    {
+        Usage();
+        return 1;
+    }
+
+    auto orbit = LoadSource(options);
+    if (orbit == nullptr)
+    {
+        fmt::print(stderr, "Error loading trajectory {}\n", options.source);
+        return 1;
+    }
+
+    double begin = options.begin;
+    double end = options.end;
+    if (std::isnan(begin) || std::isnan(end))
+    {
+        double validBegin = 0.0;
+        double validEnd = 0.0;
+        orbit->getValidRange(validBegin, validEnd);
+        if (validBegin == validEnd)
+        {
+            fmt::print(stderr, "No time range given for a trajectory valid at all times.\n");
+            return 1;
+        }
+
+        if (std::isnan(begin))
+            begin = validBegin;
+        if (std::isnan(end))
+            end = validEnd;
+    }
+
+    if (!(begin < end))
+    {
+        fmt::print(stderr, "Bad time range {} to {}.\n", begin, end);
+        return 1;
+    }
+
+    if (!WriteSegments(options, *orbit, begin, end))
+    {
+        fmt::print(stderr, "Error writing {}.\n", options.outputFilename);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,259 @@
+// dxtencoder.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Compression of images to DXT1 and DXT5 DDS files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "dxtencoder.h"
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <utility>
+
+#include <celutil/binarywrite.h>
+
+namespace celestia::tools
+{
+
+namespace
+{
+
+using Block = std::array<std::array<int, 4>, 16>;
+
+std::uint16_t
+packRGB565(const std::array<int, 3>& c)
+{
+    return static_cast<std::uint16_t>(((c[0] >> 3) << 11) | ((c[1] >> 2) << 5) | (c[2] >> 3));
+}
+
+std::array<int, 3>
+unpackRGB565(std::uint16_t c)
+{
+    int r = (c >> 11) & 0x1f;
+    int g = (c >> 5) & 0x3f;
+    int b = c & 0x1f;
+    return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+}
+
+void
+appendLE16(std::vector<std::uint8_t>& out, std::uint16_t value)
+{
+    out.push_back(static_cast<std::uint8_t>(value & 0xff));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+}
+
+void
+compressColorBlock(const Block& block, std::vector<std::uint8_t>& out)
+{
+    std::array<int, 3> mean{ 0, 0, 0 };
+    std::array<int, 3> lo{ 255, 255, 255 };
+    std::array<int, 3> hi{ 0, 0, 0 };
+    for (const auto& pixel : block)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mean[c] += pixel[c];
+            lo[c] = std::min(lo[c], pixel[c]);
+            hi[c] = std::max(hi[c], pixel[c]);
+        }
+    }
+
+    // Use the diagonal of the bounding box along which the colors vary:
+    // flip the channels which decrease as the widest one increases
+    int widest = 0;
+    for (int c = 1; c < 3; ++c)
+    {
+        if (hi[c] - lo[c] > hi[widest] - lo[widest])
+            widest = c;
+    }
+
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c == widest)
+            continue;
+
+        int covariance = 0;
+        for (const auto& pixel : block)
+            covariance += (pixel[widest] * 16 - mean[widest]) * (pixel[c] * 16 - mean[c]);
+        if (covariance < 0)
+            std::swap(lo[c], hi[c]);
+    }
+
+    // Inset the end points so that the outliers don't take the whole range
+    for (int c = 0; c < 3; ++c)
+    {
+        int inset = (hi[c] - lo[c]) / 16;
+        hi[c] = std::clamp(hi[c] - inset, 0, 255);
+        lo[c] = std::clamp(lo[c] + inset, 0, 255);
+    }
+
+    std::uint16_t c0 = packRGB565(hi);
+    std::uint16_t c1 = packRGB565(lo);
+    // c0 > c1 selects the four color mode
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    std::uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        std::array<std::array<int, 3>, 4> palette;
+        palette[0] = unpackRGB565(c0);
+        palette[1] = unpackRGB565(c1);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (std::size_t i = 0; i < block.size(); ++i)
+        {
+            std::uint32_t best = 0;
+            int bestDistance = INT_MAX;
+            for (std::uint32_t j = 0; j < 4; ++j)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c)
+                    distance += (block[i][c] - palette[j][c]) * (block[i][c] - palette[j][c]);
+                if (distance < bestDistance)
+                {
+                    best = j;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= best << (2 * i);
+        }
+    }
+
+    appendLE16(out, c0);
+    appendLE16(out, c1);
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(static_cast<std::uint8_t>(indices >> shift));
+}
+
+void
+compressAlphaBlock(const Block& block, std::vector<std::uint8_t>& out)
+{
+    int a0 = 0;
+    int a1 = 255;
+    for (const auto& pixel : block)
+    {
+        a0 = std::max(a0, pixel[3]);
+        a1 = std::min(a1, pixel[3]);
+    }
+
+    // a0 > a1 selects the eight value mode
+    std::uint64_t indices = 0;
+    if (a0 != a1)
+    {
+        std::array<int, 8> palette;
+        palette[0] = a0;
+        palette[1] = a1;
+        for (int j = 1; j < 7; ++j)
+            palette[j + 1] = ((7 - j) * a0 + j * a1) / 7;
+
+        for (std::size_t i = 0; i < block.size(); ++i)
+        {
+            std::uint64_t best = 0;
+            int bestDistance = INT_MAX;
+            for (std::uint64_t j = 0; j < 8; ++j)
+            {
+                int distance = std::abs(block[i][3] - palette[j]);
+                if (distance < bestDistance)
+                {
+                    best = j;
+                    bestDistance = distance;
+                }
+            }
+
+            indices |= best << (3 * i);
+        }
+    }
+
+    out.push_back(static_cast<std::uint8_t>(a0));
+    out.push_back(static_cast<std::uint8_t>(a1));
+    for (int shift = 0; shift < 48; shift += 8)
+        out.push_back(static_cast<std::uint8_t>(indices >> shift));
+}
+
+} // end unnamed namespace
+
+std::vector<std::uint8_t>
+compressDXT(const std::uint8_t* pixels, int width, int height, int pitch, int components)
+{
+    bool alpha = components == 4;
+    std::vector<std::uint8_t> blocks;
+    blocks.reserve(static_cast<std::size_t>(width / 4) * static_cast<std::size_t>(height / 4) * (alpha ? 16 : 8));
+
+    Block block;
+    for (int y = 0; y < height; y += 4)
+    {
+        for (int x = 0; x < width; x += 4)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                const std::uint8_t* pixel = pixels + (y + i / 4) * pitch + (x + i % 4) * components;
+                for (int c = 0; c < 3; ++c)
+                    block[i][c] = pixel[c];
+                block[i][3] = alpha ? pixel[3] : 255;
+            }
+
+            if (alpha)
+                compressAlphaBlock(block, blocks);
+            compressColorBlock(block, blocks);
+        }
+    }
+
+    return blocks;
+}
+
+bool
+writeDDS(const fs::path& path, const std::vector<std::uint8_t>& blocks, int width, int height, bool alpha)
+{
+    constexpr std::uint32_t DDSD_CAPS = 0x1;
+    constexpr std::uint32_t DDSD_HEIGHT = 0x2;
+    constexpr std::uint32_t DDSD_WIDTH = 0x4;
+    constexpr std::uint32_t DDSD_PIXELFORMAT = 0x1000;
+    constexpr std::uint32_t DDSD_LINEARSIZE = 0x80000;
+    constexpr std::uint32_t DDPF_FOURCC = 0x4;
+    constexpr std::uint32_t DDSCAPS_TEXTURE = 0x1000;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.good())
+        return false;
+
+    out.write("DDS ", 4);
+    util::writeLE<std::uint32_t>(out, 124);
+    util::writeLE<std::uint32_t>(out, DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_LINEARSIZE);
+    util::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(height));
+    util::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(width));
+    util::writeLE<std::uint32_t>(out, static_cast<std::uint32_t>(blocks.size()));
+    // Depth, mipmap count and reserved
+    for (int i = 0; i < 13; ++i)
+        util::writeLE<std::uint32_t>(out, 0);
+
+    // Pixel format
+    util::writeLE<std::uint32_t>(out, 32);
+    util::writeLE<std::uint32_t>(out, DDPF_FOURCC);
+    out.write(alpha ? "DXT5" : "DXT1", 4);
+    for (int i = 0; i < 5; ++i)
+        util::writeLE<std::uint32_t>(out, 0);
+
+    // Caps and reserved
+    util::writeLE<std::uint32_t>(out, DDSCAPS_TEXTURE);
+    for (int i = 0; i < 4; ++i)
+        util::writeLE<std::uint32_t>(out, 0);
+
+    out.write(reinterpret_cast<const char*>(blocks.data()), static_cast<std::streamsize>(blocks.size())); //NOSONAR
+    return out.good();
+}
+
+} // end namespace celestia::tools
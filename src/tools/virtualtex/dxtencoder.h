@@ -0,0 +1,40 @@
+// dxtencoder.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Compression of images to DXT1 and DXT5 DDS files.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia::tools
+{
+
+// Compress width x height pixels, both multiples of 4, with a row pitch of
+// pitch bytes. RGB pixels are compressed to DXT1 and RGBA pixels to DXT5.
+// The end points of each block are the corners of the bounding box along
+// the main diagonal of its colors, which is fast and good enough for the
+// smooth imagery of planetary maps.
+std::vector<std::uint8_t> compressDXT(const std::uint8_t* pixels,
+                                      int width,
+                                      int height,
+                                      int pitch,
+                                      int components);
+
+// Write the blocks of compressDXT() as a DDS file without mipmaps
+bool writeDDS(const fs::path& path,
+              const std::vector<std::uint8_t>& blocks,
+              int width,
+              int height,
+              bool alpha);
+
+} // end namespace celestia::tools
@@ -0,0 +1,393 @@
+// makevirtualtex.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// Cut a cylindrical map into the levels of tiles of a virtual texture.
+// The source image is read in strips one tile high, so maps much larger
+// than the memory can be processed; the tiles of a strip are written, and
+// the strip reduced for the next level, on several threads.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <celimage/image.h>
+#include <celutil/filetype.h>
+#include <celutil/logger.h>
+#include <celutil/stringutils.h>
+#include "dxtencoder.h"
+#include "rowreader.h"
+
+namespace tools = celestia::tools;
+using celestia::engine::Image;
+using celestia::engine::PixelFormat;
+
+namespace
+{
+
+constexpr unsigned int MaxThreads = 64;
+
+struct Options
+{
+    std::string sourceFilename;
+    std::string outputDirectory;
+    int tileSize{ 512 };
+    std::string tileType{ "dds" };
+    std::string tilePrefix{ "tx_" };
+    unsigned int threads{ 0 };
+};
+
+// One tile high band of a level; band v holds the rows of the tiles tx_u_v
+struct Level
+{
+    int width;
+    std::vector<std::uint8_t> rows;
+    int rowsFilled{ 0 };
+    int v{ 0 };
+};
+
+void
+usage()
+{
+    fmt::print(stderr,
+               "Usage: makevirtualtex [options] <source image> <output directory>\n"
+               "  Options:\n"
+               "    --tile-size <n>   : width and height of the tiles, 512 by default\n"
+               "    --type <ext>      : dds (default), png or jpg tiles; only dds tiles keep\n"
+               "                        the alpha channel\n"
+               "    --prefix <s>      : tile file name prefix, tx_ by default\n"
+               "    --threads <n>     : number of threads\n");
+}
+
+bool
+parseCommandLine(int argc, char* argv[], Options& options)
+{
+    int fileCount = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg(argv[i]);
+        if (arg.empty() || arg[0] != '-')
+        {
+            if (fileCount == 0)
+                options.sourceFilename = arg;
+            else if (fileCount == 1)
+                options.outputDirectory = arg;
+            else
+                return false;
+            ++fileCount;
+            continue;
+        }
+
+        if (i + 1 == argc)
+            return false;
+
+        if (arg == "--tile-size")
+        {
+            if (!to_number(argv[++i], options.tileSize))
+                return false;
+        }
+        else if (arg == "--type")
+        {
+            options.tileType = argv[++i];
+        }
+        else if (arg == "--prefix")
+        {
+            options.tilePrefix = argv[++i];
+        }
+        else if (arg == "--threads")
+        {
+            if (!to_number(argv[++i], options.threads))
+                return false;
+        }
+        else
+        {
+            fmt::print(stderr, "Unknown command line switch: {}\n", arg);
+            return false;
+        }
+    }
+
+    return fileCount == 2;
+}
+
+constexpr bool
+isPow2(int x)
+{
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+template<typename F>
+void
+parallelFor(int count, unsigned int nThreads, F&& task)
+{
+    std::atomic<int> next{ 0 };
+    auto worker = [&]()
+    {
+        for (int i = next++; i < count; i = next++)
+            task(i);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1, end = std::min(nThreads, static_cast<unsigned int>(count)); i < end; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+class PyramidWriter
+{
+public:
+    PyramidWriter(const Options& options, int components, int nLevels, unsigned int nThreads);
+
+    // The source rows are read into the band of the most detailed level,
+    // which is written when full
+    std::uint8_t* detailBand();
+    bool writeDetailBand();
+
+private:
+    bool writeBand(int lod);
+    bool writeTile(int lod, int u, int v, const std::uint8_t* pixels, int pitch) const;
+    void reduceBand(int lod);
+
+    const Options& m_options;
+    int m_components;
+    unsigned int m_nThreads;
+    ContentType m_contentType;
+    std::vector<Level> m_levels;
+};
+
+PyramidWriter::PyramidWriter(const Options& options, int components, int nLevels, unsigned int nThreads) :
+    m_options(options),
+    m_components(components),
+    m_nThreads(nThreads),
+    m_contentType(DetermineFileType(fs::path("tile." + options.tileType)))
+{
+    for (int lod = 0; lod < nLevels; ++lod)
+    {
+        Level& level = m_levels.emplace_back();
+        level.width = options.tileSize << (lod + 1);
+        level.rows.resize(static_cast<std::size_t>(level.width) * options.tileSize * components);
+    }
+}
+
+std::uint8_t*
+PyramidWriter::detailBand()
+{
+    return m_levels.back().rows.data();
+}
+
+bool
+PyramidWriter::writeDetailBand()
+{
+    m_levels.back().rowsFilled = m_options.tileSize;
+    return writeBand(static_cast<int>(m_levels.size()) - 1);
+}
+
+// Write the tiles of a full band, then reduce it into the next level,
+// whose band is full after every second band of this one
+bool
+PyramidWriter::writeBand(int lod)
+{
+    Level& level = m_levels[lod];
+    int tileSize = m_options.tileSize;
+    int pitch = level.width * m_components;
+
+    std::atomic<bool> ok{ true };
+    parallelFor(level.width / tileSize, m_nThreads, [&](int u)
+    {
+        const std::uint8_t* tile = level.rows.data() + static_cast<std::size_t>(u) * tileSize * m_components;
+        if (!writeTile(lod, u, level.v, tile, pitch))
+            ok = false;
+    });
+
+    if (lod > 0)
+        reduceBand(lod);
+
+    level.rowsFilled = 0;
+    ++level.v;
+    if (!ok)
+        return false;
+
+    return lod == 0 || m_levels[lod - 1].rowsFilled < tileSize || writeBand(lod - 1);
+}
+
+// Average the pixels of the band by 2x2 into the next band of the level
+// below
+void
+PyramidWriter::reduceBand(int lod)
+{
+    const Level& level = m_levels[lod];
+    Level& next = m_levels[lod - 1];
+    int srcPitch = level.width * m_components;
+    int dstPitch = next.width * m_components;
+    int components = m_components;
+
+    parallelFor(m_options.tileSize / 2, m_nThreads, [&](int row)
+    {
+        const std::uint8_t* src0 = level.rows.data() + static_cast<std::size_t>(2 * row) * srcPitch;
+        const std::uint8_t* src1 = src0 + srcPitch;
+        std::uint8_t* dst = next.rows.data() + static_cast<std::size_t>(next.rowsFilled + row) * dstPitch;
+        for (int x = 0; x < next.width; ++x)
+        {
+            for (int c = 0; c < components; ++c)
+            {
+                int i = 2 * x * components + c;
+                int sum = src0[i] + src0[i + components] + src1[i] + src1[i + components];
+                dst[x * components + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+            }
+        }
+    });
+
+    next.rowsFilled += m_options.tileSize / 2;
+}
+
+bool
+PyramidWriter::writeTile(int lod, int u, int v, const std::uint8_t* pixels, int pitch) const
+{
+    int tileSize = m_options.tileSize;
+    fs::path path = fs::path(m_options.outputDirectory)
+                  / fmt::format("level{}", lod)
+                  / fmt::format("{}{}_{}.{}", m_options.tilePrefix, u, v, m_options.tileType);
+
+    if (m_contentType == ContentType::DDS)
+    {
+        std::vector<std::uint8_t> blocks = tools::compressDXT(pixels, tileSize, tileSize, pitch, m_components);
+        return tools::writeDDS(path, blocks, tileSize, tileSize, m_components == 4);
+    }
+
+    Image image(m_components == 4 ? PixelFormat::RGBA : PixelFormat::RGB, tileSize, tileSize);
+    auto rowSize = static_cast<std::size_t>(tileSize) * m_components;
+    for (int y = 0; y < tileSize; ++y)
+        std::memcpy(image.getPixelRow(y), pixels + static_cast<std::size_t>(y) * pitch, rowSize);
+    return image.save(path, m_contentType);
+}
+
+bool
+writeVirtualTextureFile(const Options& options)
+{
+    fs::path directory = fs::path(options.outputDirectory);
+    if (!directory.has_filename())
+        directory = directory.parent_path();
+
+    fs::path ctxPath = directory;
+    ctxPath += ".ctx";
+    std::ofstream out(ctxPath);
+    if (!out.good())
+        return false;
+
+    out << fmt::format("VirtualTexture\n"
+                       "{{\n"
+                       "    ImageDirectory \"{}\"\n"
+                       "    BaseSplit 0\n"
+                       "    TileSize {}\n"
+                       "    TileType \"{}\"\n"
+                       "    TilePrefix \"{}\"\n"
+                       "}}\n",
+                       directory.filename().string(), options.tileSize, options.tileType, options.tilePrefix);
+    return out.good();
+}
+
+} // end unnamed namespace
+
+int main(int argc, char* argv[])
+{
+    celestia::util::CreateLogger();
+
+    Options options;
+    if (!parseCommandLine(argc, argv, options))
+    {
+        usage();
+        return 1;
+    }
+
+    if (options.tileSize < 64 || !isPow2(options.tileSize))
+    {
+        fmt::print(stderr, "The tile size must be a power of two >= 64.\n");
+        return 1;
+    }
+
+    ContentType tileType = DetermineFileType(fs::path("tile." + options.tileType));
+    if (tileType != ContentType::DDS && !Image::canSave(tileType))
+    {
+        fmt::print(stderr, "Tiles can't be written as {}.\n", options.tileType);
+        return 1;
+    }
+
+    std::unique_ptr<tools::RowReader> reader = tools::RowReader::open(options.sourceFilename);
+    if (reader == nullptr)
+    {
+        fmt::print(stderr, "Error reading {}\n", options.sourceFilename);
+        return 1;
+    }
+
+    // The most detailed level is the whole image: two tiles wide at the
+    // first level, and twice as many on each side at each next level
+    int width = reader->width();
+    if (reader->height() * 2 != width || width % (2 * options.tileSize) != 0
+        || !isPow2(width / (2 * options.tileSize)))
+    {
+        fmt::print(stderr,
+                   "The image must be twice as wide as high and a power of two times two tiles wide, not {}x{}.\n",
+                   width, reader->height());
+        return 1;
+    }
+
+    int nLevels = 1;
+    while ((options.tileSize << nLevels) < width)
+        ++nLevels;
+
+    for (int lod = 0; lod < nLevels; ++lod)
+    {
+        std::error_code ec;
+        fs::path levelPath = fs::path(options.outputDirectory) / fmt::format("level{}", lod);
+        if (!fs::create_directories(levelPath, ec) && ec)
+        {
+            fmt::print(stderr, "Error creating {}\n", levelPath.string());
+            return 1;
+        }
+    }
+
+    unsigned int nThreads = options.threads > 0
+        ? std::min(options.threads, MaxThreads)
+        : std::clamp(std::thread::hardware_concurrency(), 1U, MaxThreads);
+
+    PyramidWriter writer(options, reader->components(), nLevels, nThreads);
+    for (int row = 0; row < reader->height(); row += options.tileSize)
+    {
+        if (!reader->read(writer.detailBand(), options.tileSize))
+        {
+            fmt::print(stderr, "Error reading {}\n", options.sourceFilename);
+            return 1;
+        }
+
+        if (!writer.writeDetailBand())
+        {
+            fmt::print(stderr, "Error writing the tiles to {}\n", options.outputDirectory);
+            return 1;
+        }
+    }
+
+    if (!writeVirtualTextureFile(options))
+    {
+        fmt::print(stderr, "Error writing the virtual texture file\n");
+        return 1;
+    }
+
+    return 0;
+}
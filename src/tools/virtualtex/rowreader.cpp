@@ -0,0 +1,288 @@
+// rowreader.cpp
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Sequential reading of the pixel rows of images too large to load whole.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#include "rowreader.h"
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <setjmp.h>
+
+#include <png.h>
+extern "C"
+{
+#include <jpeglib.h>
+}
+
+#include <celimage/image.h>
+#include <celutil/filetype.h>
+
+using celestia::engine::Image;
+using celestia::engine::PixelFormat;
+
+namespace celestia::tools
+{
+
+namespace
+{
+
+std::FILE*
+openFile(const fs::path& path)
+{
+#ifdef _WIN32
+    return _wfopen(path.c_str(), L"rb");
+#else
+    return std::fopen(path.c_str(), "rb");
+#endif
+}
+
+void
+PNGReadData(png_structp png, png_bytep data, png_size_t length)
+{
+    auto* fp = static_cast<std::FILE*>(png_get_io_ptr(png));
+    if (std::fread(data, 1, length, fp) != length)
+        png_error(png, "Truncated PNG file");
+}
+
+class PNGRowReader : public RowReader
+{
+public:
+    ~PNGRowReader() override;
+
+    // Interlaced images can't be read by rows and are rejected
+    bool open(const fs::path&);
+    bool read(std::uint8_t* rows, int count) override;
+
+private:
+    std::FILE* m_file{ nullptr };
+    png_structp m_png{ nullptr };
+    png_infop m_info{ nullptr };
+};
+
+PNGRowReader::~PNGRowReader()
+{
+    if (m_png != nullptr)
+        png_destroy_read_struct(&m_png, m_info == nullptr ? nullptr : &m_info, nullptr);
+    if (m_file != nullptr)
+        std::fclose(m_file);
+}
+
+bool
+PNGRowReader::open(const fs::path& path)
+{
+    m_file = openFile(path);
+    if (m_file == nullptr)
+        return false;
+
+    std::array<png_byte, 8> header;
+    if (std::fread(header.data(), 1, header.size(), m_file) != header.size()
+        || png_sig_cmp(header.data(), 0, header.size()) != 0)
+    {
+        return false;
+    }
+
+    m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (m_png == nullptr)
+        return false;
+    m_info = png_create_info_struct(m_png);
+    if (m_info == nullptr)
+        return false;
+
+    if (setjmp(png_jmpbuf(m_png)))
+        return false;
+
+    png_set_read_fn(m_png, m_file, PNGReadData);
+    png_set_sig_bytes(m_png, static_cast<int>(header.size()));
+    png_read_info(m_png, m_info);
+
+    png_uint_32 width;
+    png_uint_32 height;
+    int bitDepth;
+    int colorType;
+    int interlaceType;
+    png_get_IHDR(m_png, m_info, &width, &height, &bitDepth, &colorType, &interlaceType, nullptr, nullptr);
+    if (interlaceType != PNG_INTERLACE_NONE)
+        return false;
+
+    if (colorType == PNG_COLOR_TYPE_PALETTE)
+        png_set_palette_to_rgb(m_png);
+    if (colorType == PNG_COLOR_TYPE_GRAY && bitDepth < 8)
+        png_set_expand_gray_1_2_4_to_8(m_png);
+    if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA)
+        png_set_gray_to_rgb(m_png);
+    if (png_get_valid(m_png, m_info, PNG_INFO_tRNS))
+        png_set_tRNS_to_alpha(m_png);
+    if (bitDepth == 16)
+        png_set_strip_16(m_png);
+    png_read_update_info(m_png, m_info);
+
+    m_width = static_cast<int>(width);
+    m_height = static_cast<int>(height);
+    m_components = png_get_channels(m_png, m_info);
+    return m_components == 3 || m_components == 4;
+}
+
+bool
+PNGRowReader::read(std::uint8_t* rows, int count)
+{
+    if (setjmp(png_jmpbuf(m_png)))
+        return false;
+
+    auto rowSize = static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_components);
+    for (int i = 0; i < count; ++i)
+        png_read_row(m_png, rows + static_cast<std::size_t>(i) * rowSize, nullptr);
+    return true;
+}
+
+struct JPEGErrorManager
+{
+    jpeg_error_mgr pub;
+    jmp_buf setjmpBuffer;
+};
+
+METHODDEF(void)
+JPEGErrorExit(j_common_ptr cinfo)
+{
+    (*cinfo->err->output_message)(cinfo);
+    longjmp(reinterpret_cast<JPEGErrorManager*>(cinfo->err)->setjmpBuffer, 1); //NOSONAR
+}
+
+class JPEGRowReader : public RowReader
+{
+public:
+    ~JPEGRowReader() override;
+
+    bool open(const fs::path&);
+    bool read(std::uint8_t* rows, int count) override;
+
+private:
+    std::FILE* m_file{ nullptr };
+    jpeg_decompress_struct m_cinfo{};
+    JPEGErrorManager m_error{};
+    bool m_created{ false };
+};
+
+JPEGRowReader::~JPEGRowReader()
+{
+    if (m_created)
+        jpeg_destroy_decompress(&m_cinfo);
+    if (m_file != nullptr)
+        std::fclose(m_file);
+}
+
+bool
+JPEGRowReader::open(const fs::path& path)
+{
+    m_file = openFile(path);
+    if (m_file == nullptr)
+        return false;
+
+    m_cinfo.err = jpeg_std_error(&m_error.pub);
+    m_error.pub.error_exit = JPEGErrorExit;
+    if (setjmp(m_error.setjmpBuffer))
+        return false;
+
+    jpeg_create_decompress(&m_cinfo);
+    m_created = true;
+    jpeg_stdio_src(&m_cinfo, m_file);
+    jpeg_read_header(&m_cinfo, TRUE);
+    m_cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&m_cinfo);
+
+    m_width = static_cast<int>(m_cinfo.output_width);
+    m_height = static_cast<int>(m_cinfo.output_height);
+    m_components = m_cinfo.output_components;
+    return m_components == 3;
+}
+
+bool
+JPEGRowReader::read(std::uint8_t* rows, int count)
+{
+    if (setjmp(m_error.setjmpBuffer))
+        return false;
+
+    auto rowSize = static_cast<std::size_t>(m_width) * 3;
+    for (int i = 0; i < count; ++i)
+    {
+        JSAMPROW row = rows + static_cast<std::size_t>(i) * rowSize;
+        if (jpeg_read_scanlines(&m_cinfo, &row, 1) != 1)
+            return false;
+    }
+
+    return true;
+}
+
+class ImageRowReader : public RowReader
+{
+public:
+    bool open(const fs::path&);
+    bool read(std::uint8_t* rows, int count) override;
+
+private:
+    std::unique_ptr<Image> m_image;
+    int m_nextRow{ 0 };
+};
+
+bool
+ImageRowReader::open(const fs::path& path)
+{
+    m_image = Image::load(path);
+    if (m_image == nullptr || m_image->getMipLevelCount() < 1)
+        return false;
+
+    PixelFormat format = m_image->getFormat();
+    if (format != PixelFormat::RGB && format != PixelFormat::RGBA)
+        return false;
+
+    m_width = m_image->getWidth();
+    m_height = m_image->getHeight();
+    m_components = m_image->getComponents();
+    return true;
+}
+
+bool
+ImageRowReader::read(std::uint8_t* rows, int count)
+{
+    if (m_nextRow + count > m_height)
+        return false;
+
+    auto rowSize = static_cast<std::size_t>(m_width) * static_cast<std::size_t>(m_components);
+    for (int i = 0; i < count; ++i, ++m_nextRow)
+        std::memcpy(rows + static_cast<std::size_t>(i) * rowSize, m_image->getPixelRow(m_nextRow), rowSize);
+    return true;
+}
+
+} // end unnamed namespace
+
+std::unique_ptr<RowReader>
+RowReader::open(const fs::path& path)
+{
+    switch (DetermineFileType(path))
+    {
+    case ContentType::PNG:
+        if (auto reader = std::make_unique<PNGRowReader>(); reader->open(path))
+            return reader;
+        break;
+    case ContentType::JPEG:
+        if (auto reader = std::make_unique<JPEGRowReader>(); reader->open(path))
+            return reader;
+        return nullptr;
+    default:
+        break;
+    }
+
+    // Including interlaced PNG files
+    if (auto reader = std::make_unique<ImageRowReader>(); reader->open(path))
+        return reader;
+    return nullptr;
+}
+
+} // end namespace celestia::tools
@@ -0,0 +1,46 @@
+// rowreader.h
+//
+// Copyright (C) 2024-present, the Celestia Development Team
+//
+// Sequential reading of the pixel rows of images too large to load whole.
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <celcompat/filesystem.h>
+
+namespace celestia::tools
+{
+
+// Rows are returned top down as 8 bit RGB, or RGBA for images with an
+// alpha channel
+class RowReader
+{
+public:
+    virtual ~RowReader() = default;
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int components() const { return m_components; }
+
+    // Read the next count rows to rows, each width() * components() bytes
+    virtual bool read(std::uint8_t* rows, int count) = 0;
+
+    // PNG and JPEG files are decoded as they are read; other formats are
+    // loaded whole by Image::load() and must be uncompressed
+    static std::unique_ptr<RowReader> open(const fs::path&);
+
+protected:
+    int m_width{ 0 };
+    int m_height{ 0 };
+    int m_components{ 3 };
+};
+
+} // end namespace celestia::tools
@@ -0,0 +1,226 @@
+#include "benchdata.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string_view>
+
+#include <fmt/format.h>
+
+#include <celengine/stardb.h>
+#include <celengine/stardbbuilder.h>
+
+#include "syncatalog.h"
+
+using namespace std::string_view_literals;
+
+namespace benchdata
+{
+
+namespace
+{
+
+constexpr std::int64_t MinObjects = 1000;
+constexpr std::int64_t DefaultMaxObjects = 1000000;
+constexpr std::int64_t MaxObjects = 10000000;
+
+template<typename T>
+void
+append(std::string& s, T value)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    s.append(bytes, sizeof(T));
+}
+
+template<typename T>
+void
+put(std::string& s, std::size_t offset, T value)
+{
+    std::memcpy(s.data() + offset, &value, sizeof(T));
+}
+
+constexpr std::array<std::string_view, 16> Syllables
+{
+    "al"sv, "be"sv, "cor"sv, "den"sv, "eb"sv, "fa"sv, "gi"sv, "har"sv,
+    "is"sv, "ka"sv, "lu"sv, "mir"sv, "nor"sv, "os"sv, "ran"sv, "tau"sv,
+};
+
+} // end unnamed namespace
+
+void
+objectCounts(benchmark::internal::Benchmark* b)
+{
+    std::int64_t maxObjects = DefaultMaxObjects;
+    if (const char* env = std::getenv("CELESTIA_BENCH_MAX_OBJECTS"); env != nullptr)
+        maxObjects = std::clamp(static_cast<std::int64_t>(std::atoll(env)), MinObjects, MaxObjects);
+
+    for (std::int64_t count = MinObjects; count <= maxObjects; count *= 10)
+        b->Arg(count);
+}
+
+std::string
+makeStarsDat(std::uint32_t count)
+{
+    return celestia::syncat::makeStarsDat(count, 1);
+}
+
+const StarDatabase&
+starDatabase(std::uint32_t count)
+{
+    static std::map<std::uint32_t, std::unique_ptr<StarDatabase>> databases;
+    auto& db = databases[count];
+    if (db == nullptr)
+    {
+        std::istringstream in(makeStarsDat(count));
+        StarDatabaseBuilder builder;
+        builder.loadBinary(in);
+        db = builder.finish();
+    }
+
+    return *db;
+}
+
+std::string
+makeStc(std::uint32_t count)
+{
+    return celestia::syncat::makeStc(count, 2);
+}
+
+std::string
+makeDsc(std::uint32_t count)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> ra(0.0f, 24.0f);
+    std::uniform_real_distribution<float> dec(-90.0f, 90.0f);
+    std::uniform_real_distribution<float> distance(100.0f, 1.0e7f);
+    std::uniform_real_distribution<float> radius(1.0f, 100.0f);
+    std::normal_distribution<float> absMag(-6.0f, 2.0f);
+
+    std::string dsc;
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        fmt::format_to(std::back_inserter(dsc),
+                       "{} \"DSO {}\"\n{{\n\tRA {:.6f}\n\tDec {:.6f}\n\tDistance {:.1f}\n\tRadius {:.2f}\n\tAbsMag {:.2f}\n}}\n",
+                       i % 2 == 0 ? "OpenCluster" : "Nebula", i, ra(rng), dec(rng), distance(rng), radius(rng), absMag(rng));
+    }
+
+    return dsc;
+}
+
+std::string
+makeSsc(std::uint32_t count)
+{
+    return celestia::syncat::makeMinorBodySsc(count, 4);
+}
+
+std::vector<std::string>
+makeNames(std::uint32_t count)
+{
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<std::size_t> syllable(0, Syllables.size() - 1);
+    std::uniform_int_distribution<int> nSyllables(2, 4);
+
+    std::vector<std::string> names;
+    names.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        std::string name;
+        for (int j = nSyllables(rng); j > 0; --j)
+            name += Syllables[syllable(rng)];
+        name[0] = static_cast<char>(name[0] - 'a' + 'A');
+        // Keep the names unique
+        fmt::format_to(std::back_inserter(name), " {}", i);
+        names.push_back(std::move(name));
+    }
+
+    return names;
+}
+
+std::string
+makeJPLEphemeris(std::uint32_t nRecords)
+{
+    // Offsets of the DE405 coefficients within a record (1-based and
+    // counting the two dates, as in the files), the number of coefficients
+    // per coordinate and the number of granules of each item
+    constexpr std::array<std::array<std::uint32_t, 3>, 13> CoeffInfo
+    { {
+        { 3, 14, 4 }, { 171, 10, 2 }, { 231, 13, 2 }, { 309, 11, 1 },
+        { 342, 8, 1 }, { 366, 7, 1 }, { 387, 6, 1 }, { 405, 6, 1 },
+        { 423, 6, 1 }, { 441, 13, 8 }, { 753, 11, 2 }, { 819, 10, 4 },
+        // Librations
+        { 899, 10, 4 },
+    } };
+    constexpr std::uint32_t RecordSize = 1018;
+    constexpr double StartDate = 2451536.5;
+    constexpr double DaysPerInterval = 32.0;
+
+    // The first record holds the header, the second the constants
+    std::string data(2 * RecordSize * sizeof(double), '\0');
+    put(data, 2652, StartDate);
+    put(data, 2660, StartDate + nRecords * DaysPerInterval);
+    put(data, 2668, DaysPerInterval);
+    put(data, 2676, std::uint32_t(0));
+    put(data, 2680, 149597870.691);
+    put(data, 2688, 81.30056);
+    for (std::size_t i = 0; i < 12; ++i)
+    {
+        for (std::size_t j = 0; j < 3; ++j)
+            put(data, 2696 + i * 12 + j * 4, CoeffInfo[i][j]);
+    }
+    put(data, 2840, std::uint32_t(405));
+    for (std::size_t j = 0; j < 3; ++j)
+        put(data, 2844 + j * 4, CoeffInfo[12][j]);
+
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<double> coeff(-1.0, 1.0);
+    data.reserve(data.size() + static_cast<std::size_t>(nRecords) * RecordSize * sizeof(double));
+    for (std::uint32_t i = 0; i < nRecords; ++i)
+    {
+        append(data, StartDate + i * DaysPerInterval);
+        append(data, StartDate + (i + 1) * DaysPerInterval);
+        // Chebyshev series converge, so the coefficients fall off; the
+        // scale of the leading ones is that of planetary distances in km
+        for (std::uint32_t j = 2; j < RecordSize; ++j)
+            append(data, coeff(rng) * 1.0e8 * std::pow(0.1, j % 14));
+    }
+
+    return data;
+}
+
+fs::path
+writeXYZTrajectory(std::uint32_t count)
+{
+    fs::path path = fs::temp_directory_path() / fmt::format("celestia-bench-{}.xyz", count);
+    std::ofstream out(path);
+    out.precision(12);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        double t = static_cast<double>(i);
+        out << 2451545.0 + t << ' '
+            << 1.5e8 * std::cos(t * 0.0172) << ' '
+            << 1.5e8 * std::sin(t * 0.0172) << ' '
+            << 1.0e6 * std::sin(t * 0.05) << '\n';
+    }
+
+    return path;
+}
+
+std::vector<std::uint8_t>
+makeDXTBlocks(std::size_t blockSize, std::uint32_t width, std::uint32_t height)
+{
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<std::uint8_t> blocks(blockSize * (width / 4) * (height / 4));
+    std::generate(blocks.begin(), blocks.end(), [&] { return static_cast<std::uint8_t>(byte(rng)); });
+    return blocks;
+}
+
+} // end namespace benchdata
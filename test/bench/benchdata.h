@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <celcompat/filesystem.h>
+
+class StarDatabase;
+
+namespace benchdata
+{
+
+// Registers the object counts a benchmark is run with, from 1000 up to
+// CELESTIA_BENCH_MAX_OBJECTS (default 1000000, at most 10000000) in steps
+// of a factor of 10.
+void objectCounts(benchmark::internal::Benchmark*);
+
+// The makeStarsDat, makeStc and makeSsc catalogs are those of the makesyncat
+// tool with fixed seeds.
+
+// A version 1 stars.dat with count stars spread over a disc and halo
+// about 50000 ly across, with a realistic spread of magnitudes.
+std::string makeStarsDat(std::uint32_t count);
+
+// The star database of makeStarsDat(count), built on first use and kept
+// until the end of the run.
+const StarDatabase& starDatabase(std::uint32_t count);
+
+// A .stc catalog with count stars given by RA, Dec and distance.
+std::string makeStc(std::uint32_t count);
+
+// A .dsc catalog with count open clusters and nebulae.
+std::string makeDsc(std::uint32_t count);
+
+// A .ssc catalog with count main belt asteroids with elliptical orbits and
+// a few nested tables each, around the star "Sol".
+std::string makeSsc(std::uint32_t count);
+
+// Names of count objects, e.g. for a name database.
+std::vector<std::string> makeNames(std::uint32_t count);
+
+// A DE405 layout ephemeris with nRecords 32 day records from JD 2451536.5,
+// whose coefficients are random but of plausible magnitudes.
+std::string makeJPLEphemeris(std::uint32_t nRecords);
+
+// Write an ASCII .xyz trajectory of count samples a day apart from
+// J2000 to a file in the temporary directory and return its path.
+fs::path writeXYZTrajectory(std::uint32_t count);
+
+// Random DXT blocks for a width x height texture.
+std::vector<std::uint8_t> makeDXTBlocks(std::size_t blockSize, std::uint32_t width, std::uint32_t height);
+
+} // end namespace benchdata
@@ -0,0 +1,32 @@
+#include <cstdint>
+#include <vector>
+
+#include <celimage/dds_decompress.h>
+
+#include "benchdata.h"
+
+namespace engine = celestia::engine;
+
+namespace
+{
+
+void
+BM_DecompressDXTc(benchmark::State& state, engine::DXTcFormat format, std::size_t blockSize)
+{
+    auto size = static_cast<std::uint32_t>(state.range(0));
+    std::vector<std::uint8_t> blocks = benchdata::makeDXTBlocks(blockSize, size, size);
+    std::vector<std::uint32_t> image(static_cast<std::size_t>(size) * size);
+    for (auto _ : state)
+    {
+        engine::DecompressDXTc(format, size, size, blocks.data(), false, image.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(image.size() * sizeof(std::uint32_t)));
+}
+
+} // end unnamed namespace
+
+BENCHMARK_CAPTURE(BM_DecompressDXTc, DXT1, engine::DXTcFormat::DXT1, 8)->RangeMultiplier(4)->Range(256, 4096)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DecompressDXTc, DXT3, engine::DXTcFormat::DXT3, 16)->RangeMultiplier(4)->Range(256, 4096)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_DecompressDXTc, DXT5, engine::DXTcFormat::DXT5, 16)->RangeMultiplier(4)->Range(256, 4096)->UseRealTime()->Unit(benchmark::kMillisecond);
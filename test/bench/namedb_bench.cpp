@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <celengine/name.h>
+
+#include "benchdata.h"
+
+namespace
+{
+
+const NameDatabase&
+nameDatabase(std::uint32_t count)
+{
+    static std::map<std::uint32_t, std::unique_ptr<NameDatabase>> databases;
+    auto& db = databases[count];
+    if (db == nullptr)
+    {
+        db = std::make_unique<NameDatabase>();
+        std::vector<std::string> names = benchdata::makeNames(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+            db->add(i, names[i]);
+
+        // Build the completion index outside of the measurement
+        std::vector<std::string> completion;
+        db->getCompletion(completion, "a");
+    }
+
+    return *db;
+}
+
+// Completion of what is typed into the goto dialog, from a short prefix
+// matching many names to one matching a single name
+void
+BM_NameDatabaseCompletion(benchmark::State& state)
+{
+    const NameDatabase& db = nameDatabase(static_cast<std::uint32_t>(state.range(0)));
+    const std::vector<std::string> prefixes{ "a", "Be", "corden", "Mirnorka 1" };
+    std::vector<std::string> completion;
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        completion.clear();
+        db.getCompletion(completion, prefixes[i++ % prefixes.size()]);
+        benchmark::DoNotOptimize(completion.data());
+    }
+}
+
+void
+BM_NameDatabaseLookup(benchmark::State& state)
+{
+    auto count = static_cast<std::uint32_t>(state.range(0));
+    const NameDatabase& db = nameDatabase(count);
+    std::vector<std::string> names = benchdata::makeNames(count);
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        auto catalogNumber = db.getCatalogNumberByName(names[(i++ * 7919) % names.size()], false);
+        benchmark::DoNotOptimize(catalogNumber);
+    }
+}
+
+} // end unnamed namespace
+
+BENCHMARK(BM_NameDatabaseCompletion)->Apply(benchdata::objectCounts)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_NameDatabaseLookup)->Apply(benchdata::objectCounts);
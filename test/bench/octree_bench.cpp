@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include <Eigen/Geometry>
+
+#include <celengine/deepskyobj.h>
+#include <celengine/dsodb.h>
+#include <celengine/dsodbbuilder.h>
+#include <celengine/star.h>
+#include <celengine/stardb.h>
+
+#include "benchdata.h"
+
+namespace engine = celestia::engine;
+
+namespace
+{
+
+constexpr float FovY = 0.8f;
+constexpr float AspectRatio = 1.6f;
+constexpr float LimitingMag = 8.0f;
+
+const DSODatabase&
+dsoDatabase(std::uint32_t count)
+{
+    static std::map<std::uint32_t, std::unique_ptr<DSODatabase>> databases;
+    auto& db = databases[count];
+    if (db == nullptr)
+    {
+        std::istringstream in(benchdata::makeDsc(count));
+        DSODatabaseBuilder builder;
+        builder.load(in);
+        db = builder.finish();
+    }
+
+    return *db;
+}
+
+// Views in a few directions from near the Sun, so that both the dense disc
+// and the sparse halo are traversed
+Eigen::Quaternionf
+viewOrientation(std::int64_t iteration)
+{
+    float angle = static_cast<float>(iteration % 16) * 0.3927f;
+    return Eigen::Quaternionf(Eigen::AngleAxisf(angle, Eigen::Vector3f::UnitY()))
+         * Eigen::Quaternionf(Eigen::AngleAxisf(0.2f * static_cast<float>(iteration % 3), Eigen::Vector3f::UnitX()));
+}
+
+class CountingStarHandler : public engine::StarHandler
+{
+public:
+    void process(const Star&, float distance, float appMag) override
+    {
+        ++count;
+        sum += distance + appMag;
+    }
+
+    std::int64_t count{ 0 };
+    float sum{ 0.0f };
+};
+
+class CountingStarRecordHandler : public engine::StarRecordHandler
+{
+public:
+    void process(const Star&, const engine::StarRenderRecord& record, float distance, float appMag) override
+    {
+        ++count;
+        sum += record.absMag + distance + appMag;
+    }
+
+    std::int64_t count{ 0 };
+    float sum{ 0.0f };
+};
+
+class CountingDSOHandler : public engine::DSOHandler
+{
+public:
+    void process(const std::unique_ptr<DeepSkyObject>&, double distance, float appMag) override
+    {
+        ++count;
+        sum += distance + appMag;
+    }
+
+    std::int64_t count{ 0 };
+    double sum{ 0.0 };
+};
+
+void
+BM_FindVisibleStars(benchmark::State& state)
+{
+    const StarDatabase& db = benchdata::starDatabase(static_cast<std::uint32_t>(state.range(0)));
+    Eigen::Vector3f obsPosition(0.0f, 0.0f, 0.0f);
+    CountingStarHandler handler;
+    std::int64_t iteration = 0;
+    for (auto _ : state)
+    {
+        db.findVisibleStars(handler, obsPosition, viewOrientation(iteration++), FovY, AspectRatio, LimitingMag);
+        benchmark::DoNotOptimize(handler.sum);
+    }
+
+    state.counters["visible"] = benchmark::Counter(static_cast<double>(handler.count), benchmark::Counter::kAvgIterations);
+}
+
+void
+BM_FindVisibleStarRecords(benchmark::State& state)
+{
+    const StarDatabase& db = benchdata::starDatabase(static_cast<std::uint32_t>(state.range(0)));
+    Eigen::Vector3f obsPosition(0.0f, 0.0f, 0.0f);
+    CountingStarRecordHandler handler;
+    std::int64_t iteration = 0;
+    for (auto _ : state)
+    {
+        db.findVisibleStarRecords(handler, obsPosition, viewOrientation(iteration++), FovY, AspectRatio, LimitingMag);
+        benchmark::DoNotOptimize(handler.sum);
+    }
+
+    state.counters["visible"] = benchmark::Counter(static_cast<double>(handler.count), benchmark::Counter::kAvgIterations);
+}
+
+void
+BM_FindVisibleDSOs(benchmark::State& state)
+{
+    const DSODatabase& db = dsoDatabase(static_cast<std::uint32_t>(state.range(0)));
+    Eigen::Vector3d obsPosition(0.0, 0.0, 0.0);
+    CountingDSOHandler handler;
+    std::int64_t iteration = 0;
+    for (auto _ : state)
+    {
+        db.findVisibleDSOs(handler, obsPosition, viewOrientation(iteration++), FovY, AspectRatio, LimitingMag);
+        benchmark::DoNotOptimize(handler.sum);
+    }
+
+    state.counters["visible"] = benchmark::Counter(static_cast<double>(handler.count), benchmark::Counter::kAvgIterations);
+}
+
+} // end unnamed namespace
+
+BENCHMARK(BM_FindVisibleStars)->Apply(benchdata::objectCounts)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindVisibleStarRecords)->Apply(benchdata::objectCounts)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindVisibleDSOs)->Apply(benchdata::objectCounts)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,115 @@
+#include <cstdint>
+#include <memory>
+#include <sstream>
+
+#include <Eigen/Core>
+
+#include <celastro/astro.h>
+#include <celephem/jpleph.h>
+#include <celephem/orbit.h>
+#include <celephem/samporbit.h>
+#include <celephem/vsop87.h>
+
+#include "benchdata.h"
+
+namespace astro = celestia::astro;
+namespace ephem = celestia::ephem;
+
+namespace
+{
+
+constexpr double J2000 = 2451545.0;
+
+// Successive evaluation times, far enough apart that no orbit can reuse
+// the position of the previous call
+double
+evaluationTime(std::int64_t iteration, double span)
+{
+    return J2000 + static_cast<double>(iteration % 4096) * (span / 4096.0);
+}
+
+void
+evaluate(benchmark::State& state, const ephem::Orbit& orbit, double span)
+{
+    std::int64_t iteration = 0;
+    for (auto _ : state)
+    {
+        Eigen::Vector3d position = orbit.positionAtTime(evaluationTime(iteration++, span));
+        benchmark::DoNotOptimize(position);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+void
+BM_EllipticalOrbit(benchmark::State& state)
+{
+    astro::KeplerElements elements;
+    elements.semimajorAxis = 1.5e8;
+    // Highly eccentric orbits take the most iterations to solve
+    elements.eccentricity = static_cast<double>(state.range(0)) / 100.0;
+    elements.inclination = 0.1;
+    elements.longAscendingNode = 1.2;
+    elements.argPericenter = 0.4;
+    elements.meanAnomaly = 0.3;
+    elements.period = 365.25;
+    ephem::EllipticalOrbit orbit(elements);
+    evaluate(state, orbit, 365.25);
+}
+
+void
+BM_SampledOrbit(benchmark::State& state)
+{
+    auto count = static_cast<std::uint32_t>(state.range(0));
+    auto orbit = ephem::LoadSampledTrajectory(benchdata::writeXYZTrajectory(count),
+                                              ephem::TrajectoryInterpolation::Cubic,
+                                              ephem::TrajectoryPrecision::Double);
+    if (orbit == nullptr)
+    {
+        state.SkipWithError("Failed to load the sampled trajectory");
+        return;
+    }
+
+    evaluate(state, *orbit, static_cast<double>(count));
+}
+
+void
+BM_VSOP87(benchmark::State& state)
+{
+    auto orbit = state.range(0) == 0 ? ephem::CreateVSOP87EarthOrbit() : ephem::CreateVSOP87NeptuneOrbit();
+    evaluate(state, *orbit, 36525.0);
+}
+
+void
+BM_JPLEphemeris(benchmark::State& state)
+{
+    constexpr std::uint32_t NRecords = 1200;
+    std::istringstream in(benchdata::makeJPLEphemeris(NRecords));
+    std::unique_ptr<ephem::JPLEphemeris> eph(ephem::JPLEphemeris::load(in));
+    if (eph == nullptr)
+    {
+        state.SkipWithError("Failed to load the ephemeris");
+        return;
+    }
+
+    auto item = static_cast<ephem::JPLEphemItem>(state.range(0));
+    std::int64_t iteration = 0;
+    for (auto _ : state)
+    {
+        Eigen::Vector3d position = eph->getPlanetPosition(item, evaluationTime(iteration++, 30000.0));
+        benchmark::DoNotOptimize(position);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+} // end unnamed namespace
+
+BENCHMARK(BM_EllipticalOrbit)->Arg(1)->Arg(50)->Arg(95);
+BENCHMARK(BM_SampledOrbit)->Apply(benchdata::objectCounts);
+// Earth and Neptune, which have the most and fewest terms
+BENCHMARK(BM_VSOP87)->Arg(0)->Arg(1);
+BENCHMARK(BM_JPLEphemeris)
+    ->Arg(static_cast<int>(ephem::JPLEphemItem::Mercury))
+    ->Arg(static_cast<int>(ephem::JPLEphemItem::Earth))
+    ->Arg(static_cast<int>(ephem::JPLEphemItem::Moon));
@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include <celengine/parser.h>
+#include <celengine/value.h>
+#include <celutil/tokenizer.h>
+
+#include "benchdata.h"
+
+namespace
+{
+
+// Only the ssc syntax matters here, so the catalog isn't scaled as far as
+// the object catalogs
+void
+bodyCounts(benchmark::internal::Benchmark* b)
+{
+    b->Arg(1000)->Arg(10000)->Arg(100000);
+}
+
+void
+BM_TokenizeSsc(benchmark::State& state)
+{
+    std::string ssc = benchdata::makeSsc(static_cast<std::uint32_t>(state.range(0)));
+    std::int64_t nTokens = 0;
+    for (auto _ : state)
+    {
+        std::istringstream in(ssc);
+        Tokenizer tokenizer(&in);
+        while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+            ++nTokens;
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(ssc.size()));
+    state.counters["tokens"] = benchmark::Counter(static_cast<double>(nTokens), benchmark::Counter::kAvgIterations);
+}
+
+void
+BM_TokenizeSscInMemory(benchmark::State& state)
+{
+    std::string ssc = benchdata::makeSsc(static_cast<std::uint32_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        Tokenizer tokenizer(ssc);
+        while (tokenizer.nextToken() != Tokenizer::TokenEnd)
+            continue;
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(ssc.size()));
+}
+
+// Read the name, the parent and the property hash of each body like the
+// solar system loader does
+void
+BM_ParseSsc(benchmark::State& state)
+{
+    std::string ssc = benchdata::makeSsc(static_cast<std::uint32_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        std::istringstream in(ssc);
+        Tokenizer tokenizer(&in);
+        Parser parser(&tokenizer);
+        while (tokenizer.nextToken() == Tokenizer::TokenString && tokenizer.nextToken() == Tokenizer::TokenString)
+        {
+            Value properties = parser.readValue();
+            if (properties.getHash() == nullptr)
+            {
+                state.SkipWithError("Syntax error in the generated catalog");
+                return;
+            }
+        }
+    }
+
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(ssc.size()));
+}
+
+} // end unnamed namespace
+
+BENCHMARK(BM_TokenizeSsc)->Apply(bodyCounts)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TokenizeSscInMemory)->Apply(bodyCounts)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParseSsc)->Apply(bodyCounts)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,423 @@
+#!/usr/bin/env python3
+
+# perfgate.py
+#
+# Copyright (C) 2024-present, the Celestia Development Team
+#
+# This program is free software; you can redistribute it and/or modify it under
+# the terms of the GNU General Public License as published by the Free Software
+# Foundation; either version 2 of the License, or (at your option) any later
+# version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+# FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+# details.
+#
+# You should have received a copy of the GNU General Public License along with
+# this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+
+
+"""Runs the benchmarks repeatedly and compares the results to a baseline.
+
+The run command runs the microbenchmarks of the bench target with Google
+Benchmark repetitions, and each scenario script with celestia-bench once per
+run, and writes the samples of every metric with their median and median
+absolute deviation:
+
+    perfgate.py run --bench build/test/bench/bench \\
+        --celestia-bench build/src/celestia/headless/celestia-bench \\
+        --scenario test/bench/scenarios/*.cel --runs 5 --output results.json
+
+The results of a build are the baseline of the next ones. The compare command,
+or run with --baseline, compares the medians of each metric, and flags those
+which grew by more than the threshold of their family when the change is
+significant according to a Mann-Whitney U test of the samples. It exits with
+status 1 if there is a regression, so that it can be used as a gate:
+
+    perfgate.py compare baseline.json results.json --threshold stage=15
+
+The metric families are micro (benchmark times), frame (frame times), stage
+(render stage times), alloc (allocations per frame), startup (startup trace
+stages) and memory (memory accounting by subsystem). Lower is better for all
+of them.
+"""
+
+import argparse
+import json
+import math
+import pathlib
+import platform
+import shlex
+import statistics
+import subprocess
+import sys
+import tempfile
+from typing import Dict, List, Optional
+
+
+FORMAT_VERSION = 1
+
+# Regression thresholds in percent of the baseline median
+DEFAULT_THRESHOLDS = {
+    'micro': 5.0,
+    'frame': 5.0,
+    'stage': 10.0,
+    'alloc': 5.0,
+    'startup': 10.0,
+    'memory': 5.0,
+}
+
+TIME_UNITS_NS = {'ns': 1.0, 'us': 1e3, 'ms': 1e6, 's': 1e9}
+
+
+class Metric:
+    """Samples of one metric over the runs"""
+
+    def __init__(self, family: str, unit: str):
+        self.family = family
+        self.unit = unit
+        self.samples: List[float] = []
+
+    def to_json(self) -> dict:
+        return {
+            'family': self.family,
+            'unit': self.unit,
+            'samples': self.samples,
+            'median': statistics.median(self.samples),
+            'mad': mad(self.samples),
+        }
+
+
+Metrics = Dict[str, Metric]
+
+
+def mad(samples: List[float]) -> float:
+    """Median absolute deviation of the samples"""
+    median = statistics.median(samples)
+    return statistics.median(abs(x - median) for x in samples)
+
+
+def add_sample(metrics: Metrics, name: str, family: str, unit: str, value: Optional[float]) -> None:
+    if value is None:
+        return
+    metric = metrics.setdefault(name, Metric(family, unit))
+    metric.samples.append(float(value))
+
+
+def run_command(args: List[str]) -> None:
+    print('Running', ' '.join(args), file=sys.stderr)
+    result = subprocess.run(args, stdout=subprocess.DEVNULL, check=False)
+    if result.returncode != 0:
+        raise RuntimeError(f'{args[0]} failed with status {result.returncode}')
+
+
+def run_microbenchmarks(options: argparse.Namespace, metrics: Metrics, tmpdir: pathlib.Path) -> dict:
+    """Run the bench target; Google Benchmark repeats each benchmark"""
+    out_path = tmpdir / 'micro.json'
+    args = [options.bench,
+            f'--benchmark_repetitions={options.runs}',
+            f'--benchmark_out={out_path}',
+            '--benchmark_out_format=json']
+    if options.bench_filter:
+        args.append(f'--benchmark_filter={options.bench_filter}')
+    run_command(args)
+
+    with open(out_path, 'r', encoding='utf-8') as file:
+        data = json.load(file)
+
+    for bench in data.get('benchmarks', []):
+        if bench.get('run_type', 'iteration') != 'iteration' or bench.get('error_occurred', False):
+            continue
+        name = bench.get('run_name', bench['name'])
+        scale = TIME_UNITS_NS.get(bench.get('time_unit', 'ns'), 1.0)
+        add_sample(metrics, f'micro/{name}', 'micro', 'ns', bench['real_time'] * scale)
+
+    return data.get('context', {})
+
+
+def startup_stages(trace_path: pathlib.Path) -> Dict[str, float]:
+    """Time of the startup stages in milliseconds, summed over the events of
+    the same name, with the time from the first to the end of the last one"""
+    with open(trace_path, 'r', encoding='utf-8') as file:
+        events = [e for e in json.load(file).get('traceEvents', []) if e.get('ph') == 'X']
+
+    stages: Dict[str, float] = {}
+    for event in events:
+        stages[event['name']] = stages.get(event['name'], 0.0) + event['dur'] / 1000.0
+
+    if events:
+        start = min(e['ts'] for e in events)
+        end = max(e['ts'] + e['dur'] for e in events)
+        stages['total'] = (end - start) / 1000.0
+    return stages
+
+
+def stat(value: Optional[dict], key: str) -> Optional[float]:
+    return None if value is None else value[key]
+
+
+def run_scenario(options: argparse.Namespace, script: pathlib.Path, metrics: Metrics,
+                 tmpdir: pathlib.Path) -> dict:
+    """Run one scenario script with celestia-bench and add its metrics"""
+    name = script.stem
+    out_path = tmpdir / f'{name}.json'
+    trace_path = tmpdir / f'{name}.trace.json'
+    if trace_path.exists():
+        trace_path.unlink()
+    args = [options.celestia_bench, '--name', name, '--output', str(out_path), '--trace', str(trace_path)]
+    args.extend(shlex.split(options.celestia_bench_args or ''))
+    args.append(str(script))
+    run_command(args)
+
+    with open(out_path, 'r', encoding='utf-8') as file:
+        data = json.load(file)
+
+    # The frame times are taken at their median, the stages and allocations,
+    # which are zero for many frames, at their mean
+    for key in ('cpu_frame_ms', 'simulation_ms', 'gpu_frame_ms'):
+        add_sample(metrics, f'frame/{name}/{key}', 'frame', 'ms', stat(data.get(key), 'p50'))
+    for stage, value in data.get('stages_ms', {}).items():
+        add_sample(metrics, f'stage/{name}/{stage}', 'stage', 'ms', stat(value, 'mean'))
+    add_sample(metrics, f'alloc/{name}/allocations', 'alloc', 'count',
+               stat(data.get('allocations_per_frame'), 'mean'))
+    add_sample(metrics, f'alloc/{name}/allocated_bytes', 'alloc', 'bytes',
+               stat(data.get('allocated_bytes_per_frame'), 'mean'))
+    for subsystem, value in data.get('memory_bytes', {}).items():
+        add_sample(metrics, f'memory/{name}/{subsystem}', 'memory', 'bytes', value)
+
+    if trace_path.exists():
+        for stage, value in startup_stages(trace_path).items():
+            add_sample(metrics, f'startup/{name}/{stage}', 'startup', 'ms', value)
+
+    return {key: data.get(key) for key in ('gl_vendor', 'gl_renderer', 'gl_version', 'width', 'height')}
+
+
+def run(options: argparse.Namespace) -> dict:
+    if options.runs < 1:
+        raise RuntimeError('--runs must be at least 1')
+    if not options.bench and not options.scenario:
+        raise RuntimeError('Nothing to run, give --bench or --scenario')
+    if options.scenario and not options.celestia_bench:
+        raise RuntimeError('--scenario needs --celestia-bench')
+
+    metrics: Metrics = {}
+    environment = {'host': platform.node(), 'system': platform.platform()}
+    with tempfile.TemporaryDirectory() as tmp:
+        tmpdir = pathlib.Path(tmp)
+        if options.bench:
+            environment['bench'] = run_microbenchmarks(options, metrics, tmpdir)
+
+        # The scenarios are interleaved, so that a slow period of the machine
+        # spreads over all of them rather than shifting one
+        for _ in range(options.runs):
+            for script in options.scenario:
+                environment['celestia_bench'] = run_scenario(options, pathlib.Path(script), metrics, tmpdir)
+
+    return {
+        'version': FORMAT_VERSION,
+        'runs': options.runs,
+        'environment': environment,
+        'metrics': {name: metric.to_json() for name, metric in sorted(metrics.items())},
+    }
+
+
+def mann_whitney_p(a: List[float], b: List[float]) -> float:
+    """Two-sided p-value of the Mann-Whitney U test, with the normal
+    approximation corrected for ties"""
+    n1 = len(a)
+    n2 = len(b)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+
+    values = sorted([(x, 0) for x in a] + [(x, 1) for x in b])
+    n = n1 + n2
+    rank_sum = 0.0
+    tie_term = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j + 1 < n and values[j + 1][0] == values[i][0]:
+            j += 1
+        rank = (i + j) / 2.0 + 1.0
+        rank_sum += rank * sum(1 for k in range(i, j + 1) if values[k][1] == 0)
+        ties = j - i + 1
+        tie_term += ties ** 3 - ties
+        i = j + 1
+
+    u = rank_sum - n1 * (n1 + 1) / 2.0
+    mean = n1 * n2 / 2.0
+    variance = n1 * n2 / 12.0 * ((n + 1) - tie_term / (n * (n - 1)))
+    if variance <= 0.0:
+        return 1.0
+
+    z = (abs(u - mean) - 0.5) / math.sqrt(variance)
+    return min(1.0, math.erfc(max(z, 0.0) / math.sqrt(2.0)))
+
+
+def compare(baseline: dict, results: dict, thresholds: Dict[str, float], alpha: float,
+            min_ms: float) -> dict:
+    """Compare the metrics of results to those of the baseline"""
+    base_metrics = baseline['metrics']
+    new_metrics = results['metrics']
+    rows = []
+    for name in sorted(set(base_metrics) & set(new_metrics)):
+        base = base_metrics[name]
+        new = new_metrics[name]
+        family = new['family']
+        if base['median'] != 0.0:
+            delta = (new['median'] - base['median']) / abs(base['median']) * 100.0
+        else:
+            delta = 0.0 if new['median'] == 0.0 else math.inf
+
+        p = mann_whitney_p(base['samples'], new['samples'])
+        threshold = thresholds.get(family, 5.0)
+        # Times too short to be measured reliably aren't gated
+        negligible = new['unit'] == 'ms' and max(base['median'], new['median']) < min_ms
+        status = 'unchanged'
+        if p < alpha and not negligible:
+            if delta > threshold:
+                status = 'regression'
+            elif delta < -threshold:
+                status = 'improvement'
+
+        rows.append({
+            'metric': name,
+            'family': family,
+            'unit': new['unit'],
+            'baseline': base['median'],
+            'baseline_mad': base['mad'],
+            'median': new['median'],
+            'mad': new['mad'],
+            'delta_percent': delta,
+            'p_value': p,
+            'threshold_percent': threshold,
+            'status': status,
+        })
+
+    return {
+        'alpha': alpha,
+        'metrics': rows,
+        'missing': sorted(set(base_metrics) - set(new_metrics)),
+        'added': sorted(set(new_metrics) - set(base_metrics)),
+        'regressions': sum(1 for r in rows if r['status'] == 'regression'),
+        'improvements': sum(1 for r in rows if r['status'] == 'improvement'),
+    }
+
+
+def format_value(value: float, unit: str) -> str:
+    if unit == 'bytes':
+        return f'{value / 1024.0:.1f} KiB'
+    if unit == 'count':
+        return f'{value:.1f}'
+    return f'{value:.4g} {unit}'
+
+
+def print_report(report: dict, verbose: bool) -> None:
+    order = {'regression': 0, 'improvement': 1, 'unchanged': 2}
+    rows = sorted(report['metrics'], key=lambda r: (order[r['status']], -abs(r['delta_percent'])))
+    for row in rows:
+        if row['status'] == 'unchanged' and not verbose:
+            continue
+        print(f"{row['status'].upper():12} {row['metric']}: "
+              f"{format_value(row['baseline'], row['unit'])} -> {format_value(row['median'], row['unit'])} "
+              f"({row['delta_percent']:+.1f}%, MAD {format_value(row['mad'], row['unit'])}, "
+              f"p={row['p_value']:.3f}, threshold {row['threshold_percent']:g}%)")
+
+    for name in report['missing']:
+        print(f'MISSING      {name}')
+    if verbose:
+        for name in report['added']:
+            print(f'ADDED        {name}')
+
+    print(f"{len(report['metrics'])} metrics compared, {report['regressions']} regressions, "
+          f"{report['improvements']} improvements")
+
+
+def parse_thresholds(args: Optional[List[str]]) -> Dict[str, float]:
+    thresholds = dict(DEFAULT_THRESHOLDS)
+    for arg in args or []:
+        family, sep, value = arg.partition('=')
+        if not sep:
+            thresholds = {key: float(arg) for key in thresholds}
+        elif family in thresholds:
+            thresholds[family] = float(value)
+        else:
+            raise RuntimeError(f'Unknown metric family {family}')
+    return thresholds
+
+
+def load_json(path: str) -> dict:
+    with open(path, 'r', encoding='utf-8') as file:
+        data = json.load(file)
+    if data.get('version') != FORMAT_VERSION:
+        raise RuntimeError(f'{path} is not a perfgate results file of version {FORMAT_VERSION}')
+    return data
+
+
+def write_json(path: str, data: dict) -> None:
+    with open(path, 'w', encoding='utf-8') as file:
+        json.dump(data, file, indent=2)
+        file.write('\n')
+
+
+def gate(options: argparse.Namespace, baseline: dict, results: dict) -> int:
+    if min(baseline['runs'], results['runs']) < 3:
+        print('Warning: with fewer than 3 runs no change can be significant', file=sys.stderr)
+
+    report = compare(baseline, results, parse_thresholds(options.threshold), options.alpha, options.min_ms)
+    print_report(report, options.verbose)
+    if options.report:
+        write_json(options.report, report)
+    return 1 if report['regressions'] > 0 else 0
+
+
+def add_compare_options(parser: argparse.ArgumentParser) -> None:
+    parser.add_argument('--threshold', action='append', metavar='[FAMILY=]PERCENT',
+                        help='regression threshold of a metric family, or of all of them')
+    parser.add_argument('--alpha', type=float, default=0.05,
+                        help='significance level of the test (default: %(default)s)')
+    parser.add_argument('--min-ms', type=float, default=0.05,
+                        help='times below this are not gated (default: %(default)s)')
+    parser.add_argument('--report', help='write the comparison as JSON to this file')
+    parser.add_argument('--verbose', action='store_true', help='list the unchanged metrics too')
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    run_parser = commands.add_parser('run', help='run the benchmarks')
+    run_parser.add_argument('--bench', help='path of the microbenchmark executable')
+    run_parser.add_argument('--bench-filter', help='regular expression of the microbenchmarks to run')
+    run_parser.add_argument('--celestia-bench', help='path of celestia-bench')
+    run_parser.add_argument('--celestia-bench-args', metavar='ARGS',
+                            help='arguments passed to celestia-bench, such as "--dir DIR --frames 300"')
+    run_parser.add_argument('--scenario', nargs='*', default=[], help='scenario scripts')
+    run_parser.add_argument('--runs', type=int, default=5, help='repetitions (default: %(default)s)')
+    run_parser.add_argument('--output', required=True, help='results file to write')
+    run_parser.add_argument('--baseline', help='compare the results to this results file')
+    add_compare_options(run_parser)
+
+    compare_parser = commands.add_parser('compare', help='compare results to a baseline')
+    compare_parser.add_argument('baseline', help='results file of the baseline')
+    compare_parser.add_argument('results', help='results file to compare')
+    add_compare_options(compare_parser)
+
+    options = parser.parse_args()
+    try:
+        if options.command == 'run':
+            baseline = load_json(options.baseline) if options.baseline else None
+            results = run(options)
+            write_json(options.output, results)
+            return gate(options, baseline, results) if baseline is not None else 0
+
+        return gate(options, load_json(options.baseline), load_json(options.results))
+    except (OSError, RuntimeError, ValueError, KeyError) as e:
+        print(f'perfgate: {e}', file=sys.stderr)
+        return 2
+
+
+if __name__ == '__main__':
+    sys.exit(main())
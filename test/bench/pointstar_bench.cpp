@@ -0,0 +1,68 @@
+#include <cstdint>
+
+#include <Eigen/Geometry>
+
+#include <celengine/pointstarrenderer.h>
+#include <celengine/pointstarvertexbuffer.h>
+#include <celengine/render.h>
+#include <celengine/starcolors.h>
+#include <celengine/stardb.h>
+
+#include "benchdata.h"
+
+namespace engine = celestia::engine;
+
+namespace
+{
+
+// Runs the thread-safe part of PointStarRenderer::process, which all the
+// distant stars go through; the stars it hands back to the render thread
+// are only counted, as drawing them requires a GL context.
+class StagingHandler : public engine::StarRecordHandler
+{
+public:
+    void process(const Star&, const engine::StarRenderRecord& record, float distance, float appMag) override
+    {
+        if (!starRenderer->processStaged(record, distance, appMag, starVertices, glareVertices))
+            ++deferred;
+    }
+
+    PointStarRenderer* starRenderer{ nullptr };
+    PointStarVertexBuffer::Staging starVertices;
+    PointStarVertexBuffer::Staging glareVertices;
+    std::int64_t deferred{ 0 };
+};
+
+void
+BM_PointStarRendererProcess(benchmark::State& state)
+{
+    const StarDatabase& db = benchdata::starDatabase(static_cast<std::uint32_t>(state.range(0)));
+    Renderer renderer;
+    ColorTemperatureTable colorTemp(ColorTableType::Blackbody_D65);
+
+    Eigen::Quaternionf orientation = Eigen::Quaternionf::Identity();
+    PointStarRenderer starRenderer;
+    starRenderer.renderer = &renderer;
+    starRenderer.colorTemp = &colorTemp;
+    starRenderer.starDB = &db;
+    starRenderer.obsPos = Eigen::Vector3d::Zero();
+    starRenderer.viewNormal = orientation.conjugate() * -Eigen::Vector3f::UnitZ();
+    starRenderer.faintestMag = 10.0f;
+    starRenderer.SolarSystemMaxDistance = 0.01f;
+
+    StagingHandler handler;
+    handler.starRenderer = &starRenderer;
+    for (auto _ : state)
+    {
+        handler.starVertices.clear();
+        handler.glareVertices.clear();
+        db.findVisibleStarRecords(handler, Eigen::Vector3f::Zero(), orientation, 0.8f, 1.6f, 10.0f);
+        benchmark::ClobberMemory();
+    }
+
+    state.counters["deferred"] = benchmark::Counter(static_cast<double>(handler.deferred), benchmark::Counter::kAvgIterations);
+}
+
+} // end unnamed namespace
+
+BENCHMARK(BM_PointStarRendererProcess)->Apply(benchdata::objectCounts)->Unit(benchmark::kMicrosecond);
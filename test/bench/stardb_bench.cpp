@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <celengine/stardb.h>
+#include <celengine/stardbbuilder.h>
+
+#include "benchdata.h"
+
+namespace
+{
+
+void
+BM_StarDatabaseLoadBinary(benchmark::State& state)
+{
+    std::string starsDat = benchdata::makeStarsDat(static_cast<std::uint32_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        std::istringstream in(starsDat);
+        StarDatabaseBuilder builder;
+        if (!builder.loadBinary(in))
+        {
+            state.SkipWithError("Failed to load the generated stars.dat");
+            return;
+        }
+
+        std::unique_ptr<StarDatabase> db = builder.finish();
+        benchmark::DoNotOptimize(db.get());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Text catalogs are much slower to read, so they are scaled only as far
+// as the largest add-on catalogs
+void
+BM_StarDatabaseLoadStc(benchmark::State& state)
+{
+    std::string stc = benchdata::makeStc(static_cast<std::uint32_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        std::istringstream in(stc);
+        StarDatabaseBuilder builder;
+        if (!builder.load(in))
+        {
+            state.SkipWithError("Failed to load the generated catalog");
+            return;
+        }
+
+        std::unique_ptr<StarDatabase> db = builder.finish();
+        benchmark::DoNotOptimize(db.get());
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // end unnamed namespace
+
+BENCHMARK(BM_StarDatabaseLoadBinary)->Apply(benchdata::objectCounts)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StarDatabaseLoadStc)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <ios>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <vector>
@@ -58,4 +59,39 @@ TEST_CASE("CMOD binary to ASCII roundtrip")
                        std::istreambuf_iterator<char>(roundtrippedData), end));
 }
 
+TEST_CASE("CMOD LOD ranges roundtrip")
+{
+    cmod::HandleGetter handleGetter = [](const fs::path&) { return static_cast<ResourceHandle>(0); };
+    cmod::SourceGetter sourceGetter = [](ResourceHandle) { return fs::path("texture.png"); };
+
+    std::ifstream f("testmodel.cmod", std::ios::in | std::ios::binary);
+    REQUIRE(f.good());
+    std::unique_ptr<cmod::Model> model = cmod::LoadModel(f, handleGetter);
+    REQUIRE(model != nullptr);
+    REQUIRE(model->getMeshCount() > 0);
+
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    cmod::Mesh* mesh = model->getMesh(0);
+    REQUIRE(!mesh->hasLODRange());
+    mesh->setLODRange(64.0f, infinity);
+    REQUIRE(mesh->hasLODRange());
+    REQUIRE(mesh->isInLODRange(infinity));
+    REQUIRE(!mesh->isInLODRange(32.0f));
+
+    std::stringstream asciiData;
+    REQUIRE(cmod::SaveModelAscii(model.get(), asciiData, sourceGetter));
+    std::unique_ptr<cmod::Model> modelFromAscii = cmod::LoadModel(asciiData, handleGetter);
+    REQUIRE(modelFromAscii != nullptr);
+    REQUIRE(modelFromAscii->getMesh(0)->getLODMinPixelSize() == 64.0f);
+    REQUIRE(modelFromAscii->getMesh(0)->getLODMaxPixelSize() == infinity);
+
+    modelFromAscii->getMesh(0)->setLODRange(0.0f, 64.0f);
+    std::stringstream binaryData;
+    REQUIRE(cmod::SaveModelBinary(modelFromAscii.get(), binaryData, sourceGetter));
+    std::unique_ptr<cmod::Model> modelFromBinary = cmod::LoadModel(binaryData, handleGetter);
+    REQUIRE(modelFromBinary != nullptr);
+    REQUIRE(modelFromBinary->getMesh(0)->getLODMinPixelSize() == 0.0f);
+    REQUIRE(modelFromBinary->getMesh(0)->getLODMaxPixelSize() == 64.0f);
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,84 @@
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include <celutil/blockarray.h>
+
+#include <doctest.h>
+
+TEST_SUITE_BEGIN("BlockArray");
+
+TEST_CASE("Element addresses are stable")
+{
+    BlockArray<int, 4> array;
+    std::vector<const int*> addresses;
+    for (int i = 0; i < 100; ++i)
+        addresses.push_back(&array.emplace_back(i));
+
+    REQUIRE(array.size() == 100);
+    for (std::size_t i = 0; i < addresses.size(); ++i)
+    {
+        REQUIRE(&array[i] == addresses[i]);
+        REQUIRE(array[i] == static_cast<int>(i));
+    }
+}
+
+TEST_CASE("forEachBlock visits the elements in order")
+{
+    BlockArray<int, 4> array;
+    for (int i = 0; i < 10; ++i)
+        array.push_back(i);
+
+    std::vector<int> visited;
+    std::vector<std::size_t> counts;
+    std::as_const(array).forEachBlock([&](const int* data, std::size_t count)
+    {
+        counts.push_back(count);
+        visited.insert(visited.end(), data, data + count);
+    });
+
+    std::vector<int> expected(10);
+    std::iota(expected.begin(), expected.end(), 0);
+    REQUIRE(visited == expected);
+    REQUIRE(counts == std::vector<std::size_t>{ 4, 4, 2 });
+
+    array.forEachBlock([](int* data, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            data[i] *= 2;
+    });
+    REQUIRE(array.back() == 18);
+}
+
+TEST_CASE("Blocks are reused and released")
+{
+    BlockArray<int, 4> array;
+    array.reserve(10);
+    REQUIRE(array.empty());
+    REQUIRE(array.capacity() == 12);
+
+    for (int i = 0; i < 12; ++i)
+        array.push_back(i);
+    REQUIRE(array.capacity() == 12);
+
+    for (int i = 0; i < 5; ++i)
+        array.pop_back();
+    REQUIRE(array.size() == 7);
+    REQUIRE(array.back() == 6);
+    REQUIRE(array.capacity() == 12);
+
+    array.push_back(7);
+    REQUIRE(array.size() == 8);
+    REQUIRE(array.back() == 7);
+
+    BlockArray<int, 4> moved(std::move(array));
+    REQUIRE(moved.size() == 8);
+    REQUIRE(array.empty());
+
+    moved.clear();
+    REQUIRE(moved.empty());
+    REQUIRE(moved.capacity() == 0);
+}
+
+TEST_SUITE_END();
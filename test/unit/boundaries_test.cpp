@@ -0,0 +1,37 @@
+#include <sstream>
+#include <string>
+
+#include <celengine/boundaries.h>
+
+#include <doctest.h>
+
+TEST_SUITE_BEGIN("Boundaries");
+
+TEST_CASE("Binary boundaries round trip")
+{
+    std::istringstream in("# comment\n"
+                          " 22.0 +35.0 AND O\n"
+                          " 22.5 +35.0 AND O\n"
+                          " 23.0 +36.5 AND O\n"
+                          "  1.0 -10.0 CET O\n"
+                          "  1.5 -12.0 CET O\n");
+    auto boundaries = ReadBoundaries(in);
+    REQUIRE(boundaries != nullptr);
+    REQUIRE(boundaries->getChains().size() == 2);
+
+    std::ostringstream out;
+    REQUIRE(WriteBinaryBoundaries(out, *boundaries));
+    std::string data = out.str();
+
+    auto loaded = ReadBinaryBoundaries(data.data(), data.size());
+    REQUIRE(loaded != nullptr);
+    REQUIRE(loaded->getChains() == boundaries->getChains());
+
+    // Truncated or trailing data is rejected
+    REQUIRE(ReadBinaryBoundaries(data.data(), data.size() - 1) == nullptr);
+    data.push_back('\0');
+    REQUIRE(ReadBinaryBoundaries(data.data(), data.size()) == nullptr);
+    REQUIRE(ReadBinaryBoundaries("CELSTARS", 8) == nullptr);
+}
+
+TEST_SUITE_END();
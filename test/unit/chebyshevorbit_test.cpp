@@ -0,0 +1,121 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celcompat/bit.h>
+#include <celcompat/filesystem.h>
+#include <celephem/chebyshevbinary.h>
+#include <celephem/chebyshevorbit.h>
+#include <celephem/orbit.h>
+
+#include <doctest.h>
+
+using namespace celestia::ephem;
+
+namespace
+{
+
+constexpr std::uint32_t CoeffCount = 3;
+
+// Write a header and the segments to a file, with count segments in the
+// header
+fs::path
+writeFile(const char* name, const std::vector<double>& segments, std::uint64_t count)
+{
+    std::vector<char> header(sizeof(ChebyshevBinaryHeader));
+    auto byteOrder = static_cast<std::uint16_t>(celestia::compat::endian::native);
+    auto digits = static_cast<std::uint16_t>(std::numeric_limits<double>::digits);
+    std::uint32_t coeffCount = CoeffCount;
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, magic), CHEBYSHEV_MAGIC.data(), CHEBYSHEV_MAGIC.size());
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, byteOrder), &byteOrder, sizeof(byteOrder));
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, digits), &digits, sizeof(digits));
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, coeffCount), &coeffCount, sizeof(coeffCount));
+    std::memcpy(header.data() + offsetof(ChebyshevBinaryHeader, count), &count, sizeof(count));
+
+    fs::path path = fs::temp_directory_path() / name;
+    std::ofstream out(path, std::ios::binary);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(reinterpret_cast<const char*>(segments.data()),
+              static_cast<std::streamsize>(segments.size() * sizeof(double)));
+    return path;
+}
+
+// Two segments: x = 1000 + 100 T1 + 10 T2 and y = -500 + 50 T1 over
+// [0, 10], then constant z = 42 over [10, 30]
+std::vector<double>
+makeSegments()
+{
+    return {
+        0.0, 10.0,
+        1000.0, 100.0, 10.0,
+        -500.0, 50.0, 0.0,
+        0.0, 0.0, 0.0,
+
+        10.0, 30.0,
+        0.0, 0.0, 0.0,
+        0.0, 0.0, 0.0,
+        42.0, 0.0, 0.0,
+    };
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("Chebyshev trajectories");
+
+TEST_CASE("Chebyshev trajectory positions and velocities")
+{
+    fs::path path = writeFile("celestia_cheb_test.cheb", makeSegments(), 2);
+    auto orbit = LoadChebyshevTrajectory(path);
+    REQUIRE(orbit != nullptr);
+
+    double begin = 0.0;
+    double end = 0.0;
+    orbit->getValidRange(begin, end);
+    REQUIRE(begin == 0.0);
+    REQUIRE(end == 30.0);
+
+    // At t = 7.5, x = 0.5, T1 = 0.5 and T2 = -0.5. Ecliptic (x, y, z) is
+    // (x, z, -y) in Celestia's frame.
+    Eigen::Vector3d p = orbit->positionAtTime(7.5);
+    REQUIRE(p.x() == doctest::Approx(1045.0));
+    REQUIRE(p.y() == doctest::Approx(0.0));
+    REQUIRE(p.z() == doctest::Approx(475.0));
+
+    // dx/dt = (100 + 40 x) * 2 / span
+    Eigen::Vector3d v = orbit->velocityAtTime(7.5);
+    REQUIRE(v.x() == doctest::Approx(24.0));
+    REQUIRE(v.z() == doctest::Approx(-10.0));
+
+    p = orbit->positionAtTime(20.0);
+    REQUIRE(p.y() == doctest::Approx(42.0));
+
+    // Times outside the trajectory are clamped to its ends
+    p = orbit->positionAtTime(-5.0);
+    REQUIRE(p.x() == doctest::Approx(910.0));
+    REQUIRE(orbit->velocityAtTime(-5.0).isZero());
+
+    fs::remove(path);
+}
+
+TEST_CASE("Chebyshev trajectory files are checked")
+{
+    std::vector<double> segments = makeSegments();
+
+    // More segments in the header than in the file
+    fs::path path = writeFile("celestia_cheb_truncated.cheb", segments, 3);
+    REQUIRE(LoadChebyshevTrajectory(path) == nullptr);
+    fs::remove(path);
+
+    // Segments out of order
+    segments[11] = -10.0;
+    path = writeFile("celestia_cheb_unordered.cheb", segments, 2);
+    REQUIRE(LoadChebyshevTrajectory(path) == nullptr);
+    fs::remove(path);
+}
+
+TEST_SUITE_END();
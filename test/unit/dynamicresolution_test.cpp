@@ -0,0 +1,64 @@
+#include <celengine/dynamicresolution.h>
+
+#include <doctest.h>
+
+using celestia::engine::DynamicResolution;
+
+namespace
+{
+
+// Frame time of a GPU spending cost seconds on a frame at full scale
+double
+frameTime(const DynamicResolution& dr, double cost)
+{
+    return cost * static_cast<double>(dr.scale() * dr.scale());
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("DynamicResolution");
+
+TEST_CASE("Scale stays at full resolution within the target")
+{
+    DynamicResolution dr(0.016);
+    for (int i = 0; i < 200; ++i)
+        REQUIRE_FALSE(dr.update(0.010));
+    REQUIRE(dr.scale() == 1.0f);
+}
+
+TEST_CASE("Scale drops until the frame time fits the target")
+{
+    DynamicResolution dr(0.016);
+    for (int i = 0; i < 1000; ++i)
+        dr.update(frameTime(dr, 0.030));
+
+    float scale = dr.scale();
+    REQUIRE(scale < 1.0f);
+    REQUIRE(frameTime(dr, 0.030) <= 0.016);
+    // The scale doesn't oscillate once it fits
+    for (int i = 0; i < 1000; ++i)
+        REQUIRE_FALSE(dr.update(frameTime(dr, 0.030)));
+    REQUIRE(dr.scale() == scale);
+}
+
+TEST_CASE("Scale doesn't drop below the minimum")
+{
+    DynamicResolution dr(0.016);
+    for (int i = 0; i < 1000; ++i)
+        dr.update(1.0);
+    REQUIRE(dr.scale() == DynamicResolution::MinScale);
+}
+
+TEST_CASE("Scale recovers when the load goes away")
+{
+    DynamicResolution dr(0.016);
+    for (int i = 0; i < 1000; ++i)
+        dr.update(frameTime(dr, 0.030));
+    REQUIRE(dr.scale() < 1.0f);
+
+    for (int i = 0; i < 1000; ++i)
+        dr.update(frameTime(dr, 0.008));
+    REQUIRE(dr.scale() == 1.0f);
+}
+
+TEST_SUITE_END();
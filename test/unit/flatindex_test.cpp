@@ -0,0 +1,51 @@
+#include <cstdint>
+
+#include <celutil/flatindex.h>
+
+#include <doctest.h>
+
+using celestia::util::FlatIndex;
+
+TEST_SUITE_BEGIN("FlatIndex");
+
+TEST_CASE("Empty index")
+{
+    FlatIndex index;
+    REQUIRE(index.empty());
+    REQUIRE(index.find(0) == FlatIndex::InvalidValue);
+    REQUIRE(index.find(42) == FlatIndex::InvalidValue);
+}
+
+TEST_CASE("Insert and find")
+{
+    FlatIndex index;
+    index.reset(4);
+
+    SUBCASE("Dense keys with growth")
+    {
+        for (std::uint32_t i = 0; i < 1000; ++i)
+            REQUIRE(index.insert(i, i * 3));
+
+        REQUIRE(index.size() == 1000);
+        for (std::uint32_t i = 0; i < 1000; ++i)
+            REQUIRE(index.find(i) == i * 3);
+        REQUIRE(index.find(1000) == FlatIndex::InvalidValue);
+    }
+
+    SUBCASE("Duplicate keys keep the first value")
+    {
+        REQUIRE(index.insert(UINT32_MAX, 1));
+        REQUIRE_FALSE(index.insert(UINT32_MAX, 2));
+        REQUIRE(index.find(UINT32_MAX) == 1);
+        REQUIRE(index.size() == 1);
+    }
+
+    SUBCASE("Invalid values are not stored")
+    {
+        REQUIRE_FALSE(index.insert(7, FlatIndex::InvalidValue));
+        REQUIRE(index.empty());
+        REQUIRE(index.find(7) == FlatIndex::InvalidValue);
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,49 @@
+#include <random>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include <celmath/intersect.h>
+
+#include <doctest.h>
+
+namespace math = celestia::math;
+
+TEST_SUITE_BEGIN("Intersect");
+
+TEST_CASE("Segment occlusion matches the single ray test")
+{
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-3.0, 3.0);
+
+    math::Ellipsoidd ellipsoid(Eigen::Vector3d(0.1, -0.2, 0.05), Eigen::Vector3d(1.0, 0.8, 0.5));
+    for (const Eigen::Vector3d& origin : { Eigen::Vector3d(5.0, 1.0, -2.0),
+                                           Eigen::Vector3d(0.0, 0.0, 0.3),
+                                           Eigen::Vector3d(-1.2, 0.1, 0.0) })
+    {
+        constexpr int count = 1000;
+        Eigen::Array<double, Eigen::Dynamic, 3> points(count, 3);
+        for (int i = 0; i < count; ++i)
+            points.row(i) << dist(gen), dist(gen), dist(gen);
+
+        Eigen::Array<bool, Eigen::Dynamic, 1> occluded(count);
+        math::testSegmentOcclusion<double>(origin, ellipsoid, points, occluded);
+
+        int hidden = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            Eigen::Vector3d point = points.row(i).transpose();
+            Eigen::ParametrizedLine<double, 3> ray(origin, point - origin);
+            double t = 0.0;
+            bool expected = math::testIntersection(ray, ellipsoid, t) && t < 1.0;
+            REQUIRE(occluded[i] == expected);
+            if (expected)
+                ++hidden;
+        }
+
+        REQUIRE(hidden > 0);
+        REQUIRE(hidden < count);
+    }
+}
+
+TEST_SUITE_END();
@@ -1,9 +1,11 @@
 #include <array>
 #include <cmath>
+#include <vector>
 
 #include <celastro/astro.h>
 #include <celcompat/numbers.h>
 #include <celephem/orbit.h>
+#include <celephem/orbitbatch.h>
 #include <celmath/mathlib.h>
 #include <celutil/array_view.h>
 
@@ -136,4 +138,72 @@ TEST_CASE("Hyperbolic orbits")
     }
 }
 
+TEST_CASE("Elliptical orbit batch")
+{
+    constexpr std::array testEccentricities{ 0.0, 0.1, 0.6, 0.95 };
+    constexpr std::array testTimes{ -3650.0, 0.0, 1234.5 };
+
+    std::vector<celestia::ephem::EllipticalOrbit> orbits;
+    celestia::ephem::EllipticalOrbitBatch batch;
+    for (double period : testPeriods)
+    for (double eccentricity : testEccentricities)
+    for (double angleDeg : testAngles)
+    {
+        astro::KeplerElements elements;
+        elements.period = period;
+        elements.semimajorAxis = std::cbrt(GMsun * math::square(period) / fourpi2);
+        elements.eccentricity = eccentricity;
+        elements.inclination = math::degToRad(std::abs(angleDeg));
+        elements.longAscendingNode = math::degToRad(angleDeg);
+        elements.argPericenter = math::degToRad(-angleDeg);
+        elements.meanAnomaly = math::degToRad(angleDeg);
+        orbits.emplace_back(elements, 2451545.0 + angleDeg);
+    }
+
+    for (std::size_t i = 0; i < orbits.size(); i++)
+        batch.add(orbits[i], static_cast<std::uint32_t>(i));
+    REQUIRE(batch.size() == orbits.size());
+
+    std::vector<Eigen::Vector3d> positions(orbits.size());
+    for (double t : testTimes)
+    {
+        // Evaluate in two ranges which split a solver group
+        std::size_t split = batch.size() / 2 + 1;
+        batch.positionsAtTime(2451545.0 + t, positions.data(), 0, split);
+        batch.positionsAtTime(2451545.0 + t, positions.data(), split, batch.size());
+
+        for (std::size_t i = 0; i < orbits.size(); i++)
+        {
+            Eigen::Vector3d expected = orbits[i].positionAtTime(2451545.0 + t);
+            REQUIRE((positions[i] - expected).norm() <= 1.0e-9 * expected.norm());
+        }
+    }
+}
+
+TEST_CASE("Osculating orbits")
+{
+    astro::KeplerElements elements;
+    elements.period = 365.25;
+    elements.semimajorAxis = std::cbrt(GMsun * math::square(elements.period) / fourpi2);
+    elements.eccentricity = 0.3;
+    elements.inclination = math::degToRad(20.0);
+    elements.longAscendingNode = math::degToRad(60.0);
+    elements.argPericenter = math::degToRad(-45.0);
+    elements.meanAnomaly = math::degToRad(10.0);
+    celestia::ephem::EllipticalOrbit orbit(elements, 2451545.0);
+
+    // An elliptical orbit is its own osculating orbit
+    auto osculating = celestia::ephem::CreateOsculatingOrbit(orbit, 2451545.0 + 100.0);
+    REQUIRE(osculating != nullptr);
+    REQUIRE(osculating->getPeriod() == doctest::Approx(elements.period));
+    for (double t : { -1000.0, 0.0, 12.5, 5000.0 })
+    {
+        Eigen::Vector3d expected = orbit.positionAtTime(2451545.0 + t);
+        REQUIRE((osculating->positionAtTime(2451545.0 + t) - expected).norm() <= 1.0e-6 * expected.norm());
+    }
+
+    celestia::ephem::FixedOrbit fixed(Eigen::Vector3d(1.0, 2.0, 3.0));
+    REQUIRE(celestia::ephem::CreateOsculatingOrbit(fixed, 2451545.0) == nullptr);
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,66 @@
+#include <Eigen/Geometry>
+
+#include <celengine/labelgrid.h>
+
+#include <doctest.h>
+
+using celestia::engine::LabelGrid;
+
+namespace
+{
+
+Eigen::AlignedBox2f
+makeBox(float x, float y, float width, float height)
+{
+    return Eigen::AlignedBox2f(Eigen::Vector2f(x, y), Eigen::Vector2f(x + width, y + height));
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("LabelGrid");
+
+TEST_CASE("Overlapping labels are rejected")
+{
+    LabelGrid grid(32.0f);
+    grid.reset(640.0f, 480.0f);
+
+    REQUIRE(grid.reserve(makeBox(100.0f, 100.0f, 80.0f, 12.0f)));
+    REQUIRE_FALSE(grid.reserve(makeBox(150.0f, 105.0f, 80.0f, 12.0f)));
+    REQUIRE_FALSE(grid.reserve(makeBox(60.0f, 90.0f, 300.0f, 40.0f)));
+    REQUIRE(grid.reserve(makeBox(100.0f, 120.0f, 80.0f, 12.0f)));
+}
+
+TEST_CASE("Labels sharing an edge are accepted")
+{
+    LabelGrid grid(32.0f);
+    grid.reset(640.0f, 480.0f);
+
+    REQUIRE(grid.reserve(makeBox(0.0f, 0.0f, 64.0f, 12.0f)));
+    REQUIRE(grid.reserve(makeBox(64.0f, 0.0f, 64.0f, 12.0f)));
+    REQUIRE(grid.reserve(makeBox(0.0f, 12.0f, 64.0f, 12.0f)));
+}
+
+TEST_CASE("Labels outside the viewport are rejected")
+{
+    LabelGrid grid(32.0f);
+    grid.reset(640.0f, 480.0f);
+
+    REQUIRE_FALSE(grid.reserve(makeBox(-100.0f, 100.0f, 50.0f, 12.0f)));
+    REQUIRE_FALSE(grid.reserve(makeBox(700.0f, 100.0f, 50.0f, 12.0f)));
+    // Partly visible labels are kept, and the hidden part still counts
+    REQUIRE(grid.reserve(makeBox(600.0f, 470.0f, 100.0f, 20.0f)));
+    REQUIRE_FALSE(grid.reserve(makeBox(620.0f, 475.0f, 10.0f, 2.0f)));
+}
+
+TEST_CASE("Reset forgets reserved areas")
+{
+    LabelGrid grid(32.0f);
+    grid.reset(640.0f, 480.0f);
+    REQUIRE(grid.reserve(makeBox(10.0f, 10.0f, 50.0f, 12.0f)));
+
+    grid.reset(320.0f, 240.0f);
+    REQUIRE(grid.reserve(makeBox(10.0f, 10.0f, 50.0f, 12.0f)));
+    REQUIRE_FALSE(grid.reserve(makeBox(400.0f, 10.0f, 50.0f, 12.0f)));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celengine/locationindex.h>
+
+#include <doctest.h>
+
+using celestia::engine::LocationIndex;
+
+namespace
+{
+
+std::vector<LocationIndex::Entry>
+makeEntries(std::size_t count)
+{
+    std::mt19937 gen(42);
+    std::normal_distribution<float> normal;
+    std::uniform_real_distribution<float> priority(0.0f, 100.0f);
+
+    std::vector<LocationIndex::Entry> entries;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        Eigen::Vector3f direction(normal(gen), normal(gen), normal(gen));
+        entries.push_back({ direction.normalized() * 6378.0f, priority(gen) });
+    }
+
+    return entries;
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("LocationIndex");
+
+TEST_CASE("Query returns every entry inside the cap")
+{
+    std::vector<LocationIndex::Entry> entries = makeEntries(5000);
+    LocationIndex index;
+    index.build(entries);
+
+    std::vector<std::uint32_t> result;
+    for (double cosAngle : { 0.99, 0.8, 0.0, -0.5 })
+    {
+        Eigen::Vector3d axis = Eigen::Vector3d(0.3, -0.5, 0.8).normalized();
+        index.query(axis, cosAngle, result);
+
+        std::vector<std::uint32_t> sorted = result;
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t inside = 0;
+        for (std::uint32_t i = 0; i < entries.size(); ++i)
+        {
+            if (entries[i].position.cast<double>().normalized().dot(axis) >= cosAngle)
+            {
+                REQUIRE(std::binary_search(sorted.begin(), sorted.end(), i));
+                ++inside;
+            }
+        }
+
+        REQUIRE(result.size() >= inside);
+        if (cosAngle > 0.0)
+            REQUIRE(result.size() < entries.size());
+    }
+}
+
+TEST_CASE("Query sorts by decreasing priority")
+{
+    std::vector<LocationIndex::Entry> entries = makeEntries(1000);
+    LocationIndex index;
+    index.build(entries);
+
+    std::vector<std::uint32_t> result;
+    index.query(Eigen::Vector3d::UnitX(), -1.0, result);
+    REQUIRE(result.size() == entries.size());
+    for (std::size_t i = 1; i < result.size(); ++i)
+        REQUIRE(entries[result[i - 1]].priority >= entries[result[i]].priority);
+}
+
+TEST_CASE("Entries at the center are always returned")
+{
+    std::vector<LocationIndex::Entry> entries = makeEntries(100);
+    entries.push_back({ Eigen::Vector3f::Zero(), 1000.0f });
+    LocationIndex index;
+    index.build(entries);
+
+    std::vector<std::uint32_t> result;
+    index.query(Eigen::Vector3d::UnitZ(), 0.999, result);
+    REQUIRE(!result.empty());
+    REQUIRE(result.front() == 100);
+    REQUIRE(index.maxRadius() == doctest::Approx(6378.0f));
+}
+
+TEST_SUITE_END();
@@ -157,6 +157,32 @@ TEST_CASE("logger")
         REQUIRE(err.str() == "s=1 e=a\n");
         REQUIRE(log.str().empty());
     }
+
+    SUBCASE("Asynchronous")
+    {
+        std::ostringstream err, log;
+        Logger logger(Level::Info, log, err, Logger::Mode::Asynchronous);
+
+        logger.info("hello world\n");
+        logger.warn("string={}\n", "foobar");
+        logger.flush();
+        REQUIRE(log.str() == "hello world\n");
+        REQUIRE(err.str() == "string=foobar\n");
+        CLEAR(log);
+        CLEAR(err);
+
+        for (int i = 0; i < 3; ++i)
+            logger.warn("repeated\n");
+        logger.warn("other\n");
+        logger.flush();
+        REQUIRE(err.str() == "repeated\nLast message repeated 2 times\nother\n");
+        REQUIRE(log.str().empty());
+        CLEAR(err);
+
+        // Errors are written before error() returns
+        logger.error("number={}\n", 123);
+        REQUIRE(err.str() == "number=123\n");
+    }
 }
 
 TEST_SUITE_END();
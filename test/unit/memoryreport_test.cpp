@@ -0,0 +1,60 @@
+#include <string>
+
+#include <celutil/memoryreport.h>
+
+#include <doctest.h>
+
+using celestia::util::MemoryReport;
+
+TEST_SUITE_BEGIN("MemoryReport");
+
+TEST_CASE("Totals are summed by subsystem")
+{
+    MemoryReport report;
+    report.add("Stars", "Records", 1000, 10);
+    report.add("Textures", "GPU", 4096, 2);
+    report.add("Stars", "Names", 500);
+
+    REQUIRE(report.entries().size() == 3);
+    REQUIRE(report.total() == 5596);
+    REQUIRE(report.total("Stars") == 1500);
+    REQUIRE(report.total("Textures") == 4096);
+    REQUIRE(report.total("Fonts") == 0);
+}
+
+TEST_CASE("Subsystems are formatted largest first")
+{
+    MemoryReport report;
+    report.add("Stars", "Records", 1000, 10);
+    report.add("Textures", "GPU", 4096, 2);
+    report.add("Stars", "Names", 2000);
+
+    std::string text = report.format();
+    auto stars = text.find("Stars: ");
+    auto textures = text.find("Textures: ");
+    REQUIRE(textures != std::string::npos);
+    REQUIRE(stars != std::string::npos);
+    REQUIRE(textures < stars);
+    REQUIRE(text.find("Names") < text.find("Records"));
+    REQUIRE(text.find("(10)") != std::string::npos);
+    REQUIRE(text.find("Duplicates") == std::string::npos);
+}
+
+TEST_CASE("Duplicates are listed after the subsystems")
+{
+    MemoryReport report;
+    report.add("Trajectories", "Sampled", 2048, 2);
+    report.addDuplicate("Trajectories", "a.xyz and b.xyz", 1024);
+
+    REQUIRE(report.duplicates().size() == 1);
+    REQUIRE(report.duplicates().front().bytes == 1024);
+    // Duplicates are already counted in the entries
+    REQUIRE(report.total() == 2048);
+
+    std::string text = report.format();
+    auto duplicates = text.find("Duplicates: 1.0 KiB");
+    REQUIRE(duplicates != std::string::npos);
+    REQUIRE(text.find("a.xyz and b.xyz") > duplicates);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <celengine/name.h>
+
+#include <doctest.h>
+
+namespace
+{
+
+std::vector<std::string>
+complete(const NameDatabase& db, std::string_view prefix)
+{
+    std::vector<std::string> completion;
+    db.getCompletion(completion, prefix);
+    std::sort(completion.begin(), completion.end());
+    return completion;
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("NameDatabase");
+
+TEST_CASE("NameDatabase completes names by prefix")
+{
+    NameDatabase db;
+    db.add(1, "Sirius");
+    db.add(2, "Sirrah");
+    db.add(3, "Vega");
+    db.add(4, "Siriusb");
+    db.add(5, "\xc3\x89toile"); // Étoile
+
+    REQUIRE(complete(db, "sir") == std::vector<std::string>{ "Sirius", "Siriusb", "Sirrah" });
+    REQUIRE(complete(db, "SIRI") == std::vector<std::string>{ "Sirius", "Siriusb" });
+    REQUIRE(complete(db, "Sirius") == std::vector<std::string>{ "Sirius", "Siriusb" });
+    REQUIRE(complete(db, "vegas").empty());
+    REQUIRE(complete(db, "").size() == 5);
+
+    // Non-ASCII letters are compared ignoring case too
+    REQUIRE(complete(db, "\xc3\xa9t") == std::vector<std::string>{ "\xc3\x89toile" });
+
+    // Names added after a completion are found
+    db.add(6, "Sirona");
+    REQUIRE(complete(db, "siro") == std::vector<std::string>{ "Sirona" });
+}
+
+TEST_CASE("NameDatabase completes Greek letters")
+{
+    NameDatabase db;
+    db.add(1, "ALF Cen");
+    db.add(2, "ALF Ori");
+    db.add(3, "BET Ori");
+
+    std::vector<std::string> completion;
+    db.getCompletion(completion, "alpha");
+    REQUIRE(completion.size() == 2);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,52 @@
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include <celutil/objectpool.h>
+
+#include <doctest.h>
+
+using celestia::util::ObjectPool;
+
+namespace
+{
+
+struct alignas(16) Item
+{
+    double values[3];
+};
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("ObjectPool");
+
+TEST_CASE("Allocations are distinct and aligned")
+{
+    ObjectPool<Item, 8> pool;
+    std::set<void*> pointers;
+    for (int i = 0; i < 20; ++i)
+    {
+        void* ptr = pool.allocate();
+        REQUIRE(reinterpret_cast<std::uintptr_t>(ptr) % alignof(Item) == 0);
+        pointers.insert(ptr);
+    }
+
+    REQUIRE(pointers.size() == 20);
+    REQUIRE(pool.capacity() == 3 * 8 * sizeof(Item));
+}
+
+TEST_CASE("Freed slots are reused")
+{
+    ObjectPool<Item, 8> pool;
+    std::vector<void*> pointers;
+    for (int i = 0; i < 8; ++i)
+        pointers.push_back(pool.allocate());
+
+    pool.deallocate(pointers[3]);
+    pool.deallocate(pointers[5]);
+    REQUIRE(pool.allocate() == pointers[5]);
+    REQUIRE(pool.allocate() == pointers[3]);
+    REQUIRE(pool.capacity() == 8 * sizeof(Item));
+}
+
+TEST_SUITE_END();
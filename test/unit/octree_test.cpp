@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celengine/octreebuilder.h>
+
+#include <doctest.h>
+
+namespace engine = celestia::engine;
+
+namespace
+{
+
+struct TestObject
+{
+    std::uint32_t id;
+    Eigen::Vector3f position;
+    float radius;
+    float magnitude;
+};
+
+struct TestOctreeTraits
+{
+    using ObjectType = TestObject;
+    using PrecisionType = float;
+
+    static Eigen::Vector3f getPosition(const ObjectType& obj) { return obj.position; }
+    static float getRadius(const ObjectType& obj) { return obj.radius; }
+    static float getMagnitude(const ObjectType& obj) { return obj.magnitude; }
+    static float applyDecay(float factor) { return factor + 1.50515f; }
+};
+
+std::vector<TestObject>
+makeObjects(std::uint32_t count)
+{
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> posDist(0.0f, 200.0f);
+    std::uniform_real_distribution<float> magDist(-5.0f, 15.0f);
+    std::uniform_real_distribution<float> radiusDist(0.0f, 1.0f);
+
+    std::vector<TestObject> objects;
+    objects.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        float radius = radiusDist(rng);
+        objects.push_back(TestObject
+        {
+            i,
+            Eigen::Vector3f(posDist(rng), posDist(rng), posDist(rng)),
+            radius > 0.95f ? radius * 10.0f : 0.0f,
+            magDist(rng),
+        });
+    }
+
+    // Some objects outside the root node
+    objects.push_back(TestObject{ count, Eigen::Vector3f(5000.0f, 0.0f, 0.0f), 0.0f, 1.0f });
+    return objects;
+}
+
+using TestOctree = engine::StaticOctree<TestObject, float>;
+
+std::unique_ptr<TestOctree>
+buildOctree(unsigned int maxThreads)
+{
+    auto root = engine::makeDynamicOctree<TestOctreeTraits>(makeObjects(20000),
+                                                            Eigen::Vector3f(1.0f, 2.0f, 3.0f),
+                                                            1000.0f,
+                                                            -2.0f,
+                                                            20,
+                                                            maxThreads);
+    return root->build();
+}
+
+// Accepts nodes whose brightest object is brighter than the limit, and
+// records the indices of the objects it is passed.
+struct CollectingProcessor
+{
+    bool checkNode(const Eigen::Vector3f&, float, float factor) const { return factor < 5.0f; }
+    void process(engine::OctreeObjectIndex idx) { indices.push_back(idx); }
+
+    std::vector<engine::OctreeObjectIndex> indices;
+};
+
+// Keeps the squared distances of the objects nearest to a point in a heap
+// whose front is the farthest of them.
+struct NearestProcessor
+{
+    float nodeKey(const Eigen::Vector3f& center, float size, float) const
+    {
+        float distance = ((point - center).cwiseAbs().array() - size).max(0.0f).matrix().norm();
+        return distance * distance;
+    }
+
+    bool acceptKey(float key) const { return distances.size() < count || key < distances.front(); }
+
+    void process(engine::OctreeObjectIndex idx)
+    {
+        float distance = ((*octree)[idx].position - point).squaredNorm();
+        if (distances.size() < count)
+        {
+            distances.push_back(distance);
+            std::push_heap(distances.begin(), distances.end());
+        }
+        else if (distance < distances.front())
+        {
+            std::pop_heap(distances.begin(), distances.end());
+            distances.back() = distance;
+            std::push_heap(distances.begin(), distances.end());
+        }
+    }
+
+    const TestOctree* octree;
+    Eigen::Vector3f point;
+    std::size_t count;
+    std::vector<float> distances;
+};
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("Octree");
+
+TEST_CASE("Parallel octree build matches serial build")
+{
+    auto serial = buildOctree(1);
+    auto parallel = buildOctree(4);
+
+    REQUIRE(serial->nodeCount() > 8);
+    REQUIRE(serial->nodeCount() == parallel->nodeCount());
+    REQUIRE(serial->size() == parallel->size());
+
+    for (engine::OctreeNodeIndex i = 0; i < serial->nodeCount(); ++i)
+    {
+        const auto& serialNode = serial->getNode(i);
+        const auto& parallelNode = parallel->getNode(i);
+        REQUIRE(serialNode.center == parallelNode.center);
+        REQUIRE(serialNode.scale == parallelNode.scale);
+        REQUIRE(serialNode.right == parallelNode.right);
+        REQUIRE(serialNode.first == parallelNode.first);
+        REQUIRE(serialNode.last == parallelNode.last);
+        REQUIRE(serialNode.brightFactor == parallelNode.brightFactor);
+    }
+
+    for (engine::OctreeObjectIndex i = 0; i < serial->size(); ++i)
+        REQUIRE((*serial)[i].id == (*parallel)[i].id);
+}
+
+TEST_CASE("Subtree traversal visits the same objects as depth-first traversal")
+{
+    auto octree = buildOctree(1);
+
+    CollectingProcessor depthFirst;
+    octree->processDepthFirstIndexed(depthFirst);
+
+    CollectingProcessor split;
+    std::vector<engine::OctreeNodeIndex> subtrees;
+    octree->processTopLevelsIndexed(split, 2, subtrees);
+    REQUIRE(!subtrees.empty());
+    for (engine::OctreeNodeIndex subtree : subtrees)
+        octree->processSubtreeIndexed(split, subtree);
+
+    REQUIRE(!depthFirst.indices.empty());
+    std::sort(depthFirst.indices.begin(), depthFirst.indices.end());
+    std::sort(split.indices.begin(), split.indices.end());
+    REQUIRE(depthFirst.indices == split.indices);
+}
+
+TEST_CASE("Best-first traversal finds the nearest objects")
+{
+    auto octree = buildOctree(1);
+
+    for (const Eigen::Vector3f& point : { Eigen::Vector3f(0.0f, 0.0f, 0.0f),
+                                          Eigen::Vector3f(150.0f, -80.0f, 20.0f),
+                                          Eigen::Vector3f(4900.0f, 0.0f, 0.0f) })
+    {
+        NearestProcessor nearest{ octree.get(), point, 50, {} };
+        octree->processBestFirst(nearest);
+        std::sort_heap(nearest.distances.begin(), nearest.distances.end());
+
+        std::vector<float> expected;
+        for (engine::OctreeObjectIndex i = 0; i < octree->size(); ++i)
+            expected.push_back(((*octree)[i].position - point).squaredNorm());
+        std::sort(expected.begin(), expected.end());
+        expected.resize(nearest.count);
+
+        REQUIRE(nearest.distances == expected);
+    }
+}
+
+TEST_CASE("Frustum classification accounts for plane displacement")
+{
+    std::array planes{ Eigen::Hyperplane<float, 3>(Eigen::Vector3f::UnitX(), 0.0f) };
+    engine::OctreeFrustum<float> frustum(planes);
+    using Classification = engine::OctreeFrustum<float>::Classification;
+
+    REQUIRE(frustum.classifyCube(Eigen::Vector3f(10.0f, 0.0f, 0.0f), 1.0f, 1.0f) == Classification::Inside);
+    REQUIRE(frustum.classifyCube(Eigen::Vector3f(-10.0f, 0.0f, 0.0f), 1.0f, 1.0f) == Classification::Outside);
+    REQUIRE(frustum.classifyCube(Eigen::Vector3f(-1.5f, 0.0f, 0.0f), 1.0f, 1.0f) == Classification::Boundary);
+    REQUIRE(frustum.classifyCube(Eigen::Vector3f(-2.5f, 0.0f, 0.0f), 1.0f, 1.0f) == Classification::Outside);
+    REQUIRE(!frustum.isCubeOutside(Eigen::Vector3f(-0.5f, 0.0f, 0.0f), 1.0f));
+}
+
+TEST_SUITE_END();
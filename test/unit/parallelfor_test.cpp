@@ -0,0 +1,66 @@
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <celutil/parallelfor.h>
+
+#include <doctest.h>
+
+using celestia::util::ParallelFor;
+
+TEST_SUITE_BEGIN("ParallelFor");
+
+TEST_CASE("Every index is visited once")
+{
+    constexpr std::size_t count = 10007;
+    std::vector<int> visits(count, 0);
+    ParallelFor(count, 64, 8, [&](std::size_t begin, std::size_t end)
+    {
+        REQUIRE(begin < end);
+        for (std::size_t i = begin; i < end; ++i)
+            ++visits[i];
+    });
+
+    for (int v : visits)
+        REQUIRE(v == 1);
+}
+
+TEST_CASE("Repeated loops reuse the pool")
+{
+    std::atomic<std::size_t> total{ 0 };
+    for (int i = 0; i < 1000; ++i)
+    {
+        ParallelFor(16, 1, 8, [&](std::size_t begin, std::size_t end)
+        {
+            total += end - begin;
+        });
+    }
+
+    REQUIRE(total == 16000);
+}
+
+TEST_CASE("Nested loops complete")
+{
+    std::atomic<std::size_t> total{ 0 };
+    ParallelFor(8, 1, 8, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            ParallelFor(100, 10, 8, [&](std::size_t b, std::size_t e)
+            {
+                total += e - b;
+            });
+        }
+    });
+
+    REQUIRE(total == 800);
+}
+
+TEST_CASE("Empty loops don't call the body")
+{
+    bool called = false;
+    ParallelFor(0, 1, 8, [&](std::size_t, std::size_t) { called = true; });
+    REQUIRE(!called);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,42 @@
+#include <cmath>
+
+#include <celephem/precession.h>
+
+#include <doctest.h>
+
+using namespace celestia::ephem;
+
+TEST_SUITE_BEGIN("Precession");
+
+TEST_CASE("Tabulated P03LP precession")
+{
+    constexpr double tolerance = 0.001;
+    const PrecessionTable_P03LP& table = PrecessionTable_P03LP::shared();
+
+    // Times between the samples, over the whole range and beyond it
+    for (double T = -5003.0; T <= 5003.0; T += 1.37)
+    {
+        EclipticPole pole = EclipticPrecession_P03LP(T);
+        EclipticPole tabulatedPole = table.eclipticPrecession(T);
+        REQUIRE(std::abs(pole.PA - tabulatedPole.PA) < tolerance);
+        REQUIRE(std::abs(pole.QA - tabulatedPole.QA) < tolerance);
+
+        PrecessionAngles angles = PrecObliquity_P03LP(T);
+        PrecessionAngles tabulatedAngles = table.precObliquity(T);
+        REQUIRE(std::abs(angles.pA - tabulatedAngles.pA) < tolerance);
+        REQUIRE(std::abs(angles.epsA - tabulatedAngles.epsA) < tolerance);
+    }
+}
+
+TEST_CASE("Precession table step follows the tolerance")
+{
+    PrecessionTable_P03LP coarse(-10.0, 10.0, 0.1);
+    PrecessionTable_P03LP fine(-10.0, 10.0, 0.0001);
+    REQUIRE(fine.getStep() < coarse.getStep());
+
+    EclipticPole pole = EclipticPrecession_P03LP(3.3);
+    REQUIRE(std::abs(pole.PA - coarse.eclipticPrecession(3.3).PA) < 0.1);
+    REQUIRE(std::abs(pole.PA - fine.eclipticPrecession(3.3).PA) < 0.0001);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,121 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <celutil/profiler.h>
+
+#include <doctest.h>
+
+using namespace std::string_view_literals;
+using celestia::util::GPUTimestampSource;
+using celestia::util::Profiler;
+using celestia::util::ProfileZone;
+
+namespace
+{
+
+// Timestamps 1 ms apart, which become available when released
+class FakeTimestamps : public GPUTimestampSource
+{
+public:
+    std::uint32_t record() override
+    {
+        times.push_back(static_cast<std::uint64_t>(times.size()) * 1000000);
+        return static_cast<std::uint32_t>(times.size() - 1);
+    }
+
+    bool isAvailable(std::uint32_t) override { return available; }
+    std::uint64_t take(std::uint32_t index) override { return times[index]; }
+
+    std::vector<std::uint64_t> times;
+    bool available{ false };
+};
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("Profiler");
+
+TEST_CASE("Zones are only recorded while the profiler is enabled")
+{
+    Profiler profiler;
+    profiler.beginFrame();
+    REQUIRE(Profiler::current() == nullptr);
+    {
+        ProfileZone zone("a");
+    }
+    profiler.endFrame();
+    REQUIRE(profiler.getLastFrame().empty());
+
+    profiler.setEnabled(true);
+    profiler.beginFrame();
+    REQUIRE(Profiler::current() == &profiler);
+    {
+        ProfileZone zone("a");
+    }
+    profiler.endFrame();
+    REQUIRE(Profiler::current() == nullptr);
+    REQUIRE(profiler.getLastFrame().size() == 1);
+}
+
+TEST_CASE("Zones of the same name and parent are merged")
+{
+    Profiler profiler;
+    profiler.setEnabled(true);
+    profiler.beginFrame();
+    {
+        ProfileZone outer("outer");
+        for (int i = 0; i < 3; ++i)
+        {
+            ProfileZone inner("inner");
+            ProfileZone leaf("leaf");
+        }
+        ProfileZone other("other");
+    }
+    {
+        ProfileZone inner("inner");
+    }
+    profiler.endFrame();
+
+    const auto& zones = profiler.getLastFrame();
+    REQUIRE(zones.size() == 5);
+    REQUIRE(zones[0].name == "outer"sv);
+    REQUIRE(zones[0].depth == 0);
+    REQUIRE(zones[1].name == "inner"sv);
+    REQUIRE(zones[1].depth == 1);
+    REQUIRE(zones[1].count == 3);
+    REQUIRE(zones[2].name == "leaf"sv);
+    REQUIRE(zones[2].depth == 2);
+    REQUIRE(zones[2].count == 3);
+    REQUIRE(zones[3].name == "other"sv);
+    REQUIRE(zones[3].depth == 1);
+    REQUIRE(zones[4].name == "inner"sv);
+    REQUIRE(zones[4].depth == 0);
+    REQUIRE(zones[4].count == 1);
+    REQUIRE(zones[0].cpuTime >= zones[1].cpuTime);
+    REQUIRE(!zones[0].gpuTime.has_value());
+}
+
+TEST_CASE("Frames wait for their GPU times")
+{
+    Profiler profiler;
+    auto timestamps = std::make_unique<FakeTimestamps>();
+    FakeTimestamps* fake = timestamps.get();
+    profiler.setGPUTimestampSource(std::move(timestamps));
+    profiler.setEnabled(true);
+
+    profiler.beginFrame();
+    {
+        ProfileZone zone("a");
+    }
+    profiler.endFrame();
+    REQUIRE(profiler.getLastFrame().empty());
+
+    fake->available = true;
+    profiler.flush();
+    const auto& zones = profiler.getLastFrame();
+    REQUIRE(zones.size() == 1);
+    REQUIRE(zones[0].gpuTime.has_value());
+    REQUIRE(*zones[0].gpuTime == doctest::Approx(0.001));
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,89 @@
+#include <celengine/qualitygovernor.h>
+
+#include <doctest.h>
+
+using celestia::engine::QualityGovernor;
+
+namespace
+{
+
+// Frame time of a scene costing cost seconds at level 0, where each level
+// saves a tenth of it
+double
+frameTime(const QualityGovernor& qg, double cost)
+{
+    return cost * (1.0 - 0.1 * static_cast<double>(qg.level()));
+}
+
+const QualityGovernor::Settings base{ 8.0f, 20.0f, 20.0f, 1.0f, 2 };
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("QualityGovernor");
+
+TEST_CASE("Level stays at full quality within the target")
+{
+    QualityGovernor qg(0.016);
+    for (int i = 0; i < 500; ++i)
+        REQUIRE_FALSE(qg.update(0.004, 0.006, 0.010));
+    REQUIRE(qg.level() == 0);
+
+    auto settings = qg.settings(base);
+    REQUIRE(settings.faintestAM45deg == base.faintestAM45deg);
+    REQUIRE(settings.minimumOrbitSize == base.minimumOrbitSize);
+    REQUIRE(settings.galaxyDetail == base.galaxyDetail);
+    REQUIRE(settings.textureResolution == base.textureResolution);
+}
+
+TEST_CASE("Level rises until the frame time fits the target")
+{
+    QualityGovernor qg(0.016);
+    for (int i = 0; i < 1000; ++i)
+        qg.update(0.0, frameTime(qg, 0.020), std::nullopt);
+
+    int level = qg.level();
+    REQUIRE(level > 0);
+    REQUIRE(frameTime(qg, 0.020) <= 0.016);
+    // The level doesn't oscillate once it fits
+    for (int i = 0; i < 1000; ++i)
+        REQUIRE_FALSE(qg.update(0.0, frameTime(qg, 0.020), std::nullopt));
+    REQUIRE(qg.level() == level);
+}
+
+TEST_CASE("GPU bound frames reduce the quality")
+{
+    QualityGovernor qg(0.016);
+    for (int i = 0; i < 100; ++i)
+        qg.update(0.002, 0.002, 0.030);
+    REQUIRE(qg.level() > 0);
+}
+
+TEST_CASE("Settings are reduced from those of the user")
+{
+    QualityGovernor qg(0.016);
+    for (int i = 0; i < 10000; ++i)
+        qg.update(1.0, 1.0, 1.0);
+    REQUIRE(qg.level() == QualityGovernor::MaxLevel);
+
+    auto settings = qg.settings(base);
+    REQUIRE(settings.faintestAM45deg < base.faintestAM45deg);
+    REQUIRE(settings.faintestAM45deg >= 6.0f);
+    REQUIRE(settings.minimumOrbitSize > base.minimumOrbitSize);
+    REQUIRE(settings.minimumFeatureSize > base.minimumFeatureSize);
+    REQUIRE(settings.galaxyDetail < base.galaxyDetail);
+    REQUIRE(settings.textureResolution == 0);
+}
+
+TEST_CASE("Level recovers when the load goes away")
+{
+    QualityGovernor qg(0.016);
+    for (int i = 0; i < 1000; ++i)
+        qg.update(0.0, frameTime(qg, 0.030), std::nullopt);
+    REQUIRE(qg.level() > 0);
+
+    for (int i = 0; i < 5000; ++i)
+        qg.update(0.0, frameTime(qg, 0.005), std::nullopt);
+    REQUIRE(qg.level() == 0);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,66 @@
+#include <string>
+
+#include <celengine/rendergraph.h>
+
+#include <doctest.h>
+
+using celestia::engine::RenderGraph;
+
+TEST_SUITE_BEGIN("RenderGraph");
+
+TEST_CASE("Passes run in order")
+{
+    RenderGraph graph;
+    RenderGraph::ResourceId frame = graph.addResource("frame", true);
+
+    std::string order;
+    graph.addPass("a", {}, { frame }, [&order] { order += 'a'; });
+    graph.addPass("b", {}, { frame }, [&order] { order += 'b'; });
+    graph.addPass("c", { frame }, { frame }, [&order] { order += 'c'; });
+
+    graph.compile();
+    REQUIRE(graph.getLiveCount() == 3);
+
+    std::string after;
+    graph.execute([&graph, &after](RenderGraph::PassId pass) { after += graph.getPassName(pass); });
+    REQUIRE(order == "abc");
+    REQUIRE(after == "abc");
+}
+
+TEST_CASE("Unused passes are culled")
+{
+    RenderGraph graph;
+    RenderGraph::ResourceId frame = graph.addResource("frame", true);
+    RenderGraph::ResourceId list = graph.addResource("list");
+    RenderGraph::ResourceId unused = graph.addResource("unused");
+
+    bool drawList = true;
+    std::string order;
+    auto build = graph.addPass("build", {}, { list }, [&order] { order += 'b'; });
+    auto debug = graph.addPass("debug", {}, { unused }, [&order] { order += 'd'; });
+    auto draw = graph.addPass("draw", { list }, { frame }, [&order] { order += 'l'; },
+                              [&drawList] { return drawList; });
+    graph.addPass("overlay", {}, { frame }, [&order] { order += 'o'; });
+
+    graph.compile();
+    REQUIRE(graph.isLive(build));
+    REQUIRE(!graph.isLive(debug));
+    REQUIRE(graph.isLive(draw));
+    graph.execute();
+    REQUIRE(order == "blo");
+
+    // Without the pass reading it, the list isn't built
+    drawList = false;
+    order.clear();
+    graph.compile();
+    REQUIRE(!graph.isLive(build));
+    REQUIRE(!graph.isLive(draw));
+    REQUIRE(graph.getLiveCount() == 1);
+    graph.execute();
+    REQUIRE(order == "o");
+
+    graph.clear();
+    REQUIRE(graph.empty());
+}
+
+TEST_SUITE_END();
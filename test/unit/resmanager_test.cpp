@@ -0,0 +1,191 @@
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <celutil/resmanager.h>
+
+#include <doctest.h>
+
+namespace
+{
+
+struct TestResource
+{
+    std::string name;
+    bool finished{ false };
+
+    std::size_t getMemoryUsage() const { return 100; }
+};
+
+class TwoStageInfo
+{
+public:
+    using ResourceType = TestResource;
+    using ResourceKey = fs::path;
+    using PreparedType = TestResource;
+
+    explicit TwoStageInfo(const fs::path& _source) : source(_source) {}
+
+    fs::path resolve(const fs::path& baseDir) const { return baseDir / source; }
+
+    std::unique_ptr<TestResource> load(const fs::path& key) const
+    {
+        return finish(key, prepare(key));
+    }
+
+    std::unique_ptr<TestResource> prepare(const fs::path& key) const
+    {
+        if (key.filename() == "missing")
+            return nullptr;
+        return std::make_unique<TestResource>(TestResource{ key.generic_string() });
+    }
+
+    std::unique_ptr<TestResource> finish(const fs::path&, std::unique_ptr<TestResource>&& resource) const
+    {
+        resource->finished = true;
+        return std::move(resource);
+    }
+
+private:
+    fs::path source;
+
+    friend bool operator<(const TwoStageInfo& a, const TwoStageInfo& b) { return a.source < b.source; }
+};
+
+// Complete pending loads until the resource has left the in-progress state
+template<typename T>
+ResourceState
+waitForLoad(ResourceManager<T>& manager, ResourceHandle h)
+{
+    for (int i = 0; i < 1000 && manager.getState(h) == ResourceState::LoadingInProgress; ++i)
+    {
+        manager.finishLoads(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return manager.getState(h);
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("ResourceManager");
+
+TEST_CASE("Synchronous loading")
+{
+    ResourceManager<TwoStageInfo> manager("base");
+    ResourceHandle h = manager.getHandle(TwoStageInfo("a"));
+    REQUIRE(manager.getHandle(TwoStageInfo("a")) == h);
+    REQUIRE(manager.getState(h) == ResourceState::NotLoaded);
+
+    const TestResource* resource = manager.find(h);
+    REQUIRE(resource != nullptr);
+    REQUIRE(resource->name == "base/a");
+    REQUIRE(resource->finished);
+    REQUIRE(manager.getState(h) == ResourceState::Loaded);
+
+    REQUIRE(manager.find(InvalidResource) == nullptr);
+}
+
+TEST_CASE("Background loading")
+{
+    ResourceManager<TwoStageInfo> manager("base");
+    ResourceHandle h = manager.getHandle(TwoStageInfo("a"));
+
+    SUBCASE("Completed by finishLoads")
+    {
+        REQUIRE(manager.findAsync(h) == nullptr);
+        REQUIRE(waitForLoad(manager, h) == ResourceState::Loaded);
+
+        const TestResource* resource = manager.findAsync(h);
+        REQUIRE(resource != nullptr);
+        REQUIRE(resource->finished);
+        REQUIRE(manager.find(h) == resource);
+    }
+
+    SUBCASE("Completed by find")
+    {
+        REQUIRE(manager.findAsync(h) == nullptr);
+        const TestResource* resource = manager.find(h);
+        REQUIRE(resource != nullptr);
+        REQUIRE(resource->finished);
+        REQUIRE(manager.getState(h) == ResourceState::Loaded);
+    }
+
+    SUBCASE("Failed load")
+    {
+        ResourceHandle missing = manager.getHandle(TwoStageInfo("missing"));
+        REQUIRE(manager.findAsync(missing) == nullptr);
+        REQUIRE(waitForLoad(manager, missing) == ResourceState::LoadingFailed);
+        REQUIRE(manager.findAsync(missing) == nullptr);
+    }
+}
+
+TEST_CASE("Upload budget")
+{
+    using celestia::util::UploadBudget;
+
+    ResourceManager<TwoStageInfo> manager("base");
+    ResourceHandle prefetched = manager.getHandle(TwoStageInfo("a"));
+    ResourceHandle visible = manager.getHandle(TwoStageInfo("b"));
+
+    manager.prefetch(prefetched);
+    REQUIRE(manager.getState(prefetched) == ResourceState::LoadingInProgress);
+    REQUIRE(manager.findAsync(visible) == nullptr);
+
+    // A frame which already uploaded more than half of its budget only
+    // completes the load which is needed
+    for (int i = 0; i < 1000 && manager.getState(visible) == ResourceState::LoadingInProgress; ++i)
+    {
+        UploadBudget budget(150, UploadBudget::Clock::duration::zero());
+        budget.charge(100, UploadBudget::Clock::duration::zero());
+        manager.finishLoads(budget);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    REQUIRE(manager.getState(visible) == ResourceState::Loaded);
+    REQUIRE(manager.getState(prefetched) == ResourceState::LoadingInProgress);
+
+    REQUIRE(waitForLoad(manager, prefetched) == ResourceState::Loaded);
+    REQUIRE(manager.findAsync(prefetched) != nullptr);
+}
+
+TEST_CASE("Memory budget")
+{
+    ResourceManager<TwoStageInfo> manager("base");
+    ResourceHandle a = manager.getHandle(TwoStageInfo("a"));
+    ResourceHandle b = manager.getHandle(TwoStageInfo("b"));
+    ResourceHandle c = manager.getHandle(TwoStageInfo("c"));
+    manager.setMemoryBudget(250);
+
+    REQUIRE(manager.find(a) != nullptr);
+    REQUIRE(manager.find(b) != nullptr);
+    manager.nextFrame();
+    REQUIRE(manager.getMemoryUsage() == 200);
+    REQUIRE(manager.getLoadedCount() == 2);
+
+    // Recently used resources are kept even when over the budget
+    REQUIRE(manager.find(c) != nullptr);
+    manager.nextFrame();
+    REQUIRE(manager.getMemoryUsage() == 300);
+
+    // Keep using b and c; a is the least recently used
+    for (int i = 0; i < 3; ++i)
+    {
+        REQUIRE(manager.find(b) != nullptr);
+        REQUIRE(manager.find(c) != nullptr);
+        manager.nextFrame();
+    }
+
+    REQUIRE(manager.getMemoryUsage() == 200);
+    REQUIRE(manager.getLoadedCount() == 2);
+    REQUIRE(manager.getState(a) == ResourceState::NotLoaded);
+    REQUIRE(manager.getState(b) == ResourceState::Loaded);
+
+    // An evicted resource is loaded again
+    REQUIRE(manager.find(a) != nullptr);
+    REQUIRE(manager.getState(a) == ResourceState::Loaded);
+}
+
+TEST_SUITE_END();
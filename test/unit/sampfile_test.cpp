@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <celephem/sampfile.h>
+
+#include <doctest.h>
+
+using celestia::ephem::GetSampleIndex;
+using celestia::ephem::SampleTimeIndex;
+
+namespace
+{
+
+std::uint32_t
+lowerBound(const std::vector<double>& times, double jd)
+{
+    return static_cast<std::uint32_t>(std::lower_bound(times.begin(), times.end(), jd) - times.begin());
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("Sample files");
+
+TEST_CASE("Sample time index matches a binary search")
+{
+    // Regular samples, with a dense cluster and a long gap
+    std::vector<double> times;
+    for (int i = 0; i < 100; ++i)
+        times.push_back(2451545.0 + i * 0.5);
+    for (int i = 1; i <= 200; ++i)
+        times.push_back(times.back() + 0.001);
+    times.push_back(times.back() + 300.0);
+    for (int i = 0; i < 50; ++i)
+        times.push_back(times.back() + 1.0);
+
+    SampleTimeIndex index(times);
+    for (double jd = times.front() - 10.0; jd < times.back() + 10.0; jd += 0.0137)
+        REQUIRE(index.find(jd, times) == lowerBound(times, jd));
+
+    for (double jd : times)
+        REQUIRE(index.find(jd, times) == lowerBound(times, jd));
+}
+
+TEST_CASE("Sample index lookups jump around")
+{
+    std::vector<double> times;
+    for (int i = 0; i < 1000; ++i)
+        times.push_back(i * 0.25);
+
+    SampleTimeIndex index(times);
+    std::atomic<std::uint32_t> lastSample{ 0 };
+    REQUIRE(GetSampleIndex(100.1, lastSample, times, index) == 401);
+    REQUIRE(GetSampleIndex(3.0, lastSample, times, index) == 12);
+    REQUIRE(GetSampleIndex(3.1, lastSample, times, index) == 13);
+    REQUIRE(GetSampleIndex(-1.0, lastSample, times, index) == 0);
+    REQUIRE(GetSampleIndex(1000.0, lastSample, times, index) == 1000);
+}
+
+TEST_CASE("Sample time index of a single sample")
+{
+    std::vector<double> times{ 10.0 };
+    SampleTimeIndex index(times);
+    REQUIRE(index.find(5.0, times) == 0);
+    REQUIRE(index.find(10.0, times) == 0);
+    REQUIRE(index.find(15.0, times) == 1);
+}
+
+TEST_SUITE_END();
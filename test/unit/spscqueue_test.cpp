@@ -0,0 +1,81 @@
+#include <thread>
+
+#include <celutil/spscqueue.h>
+
+#include <doctest.h>
+
+using celestia::util::SPSCQueue;
+
+TEST_SUITE_BEGIN("SPSCQueue");
+
+TEST_CASE("Elements are popped in the order they were pushed")
+{
+    SPSCQueue<int, 8> queue;
+    REQUIRE(queue.empty());
+    REQUIRE(!queue.pop().has_value());
+
+    for (int i = 0; i < 3; ++i)
+        REQUIRE(queue.push(i));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        auto value = queue.pop();
+        REQUIRE(value.has_value());
+        REQUIRE(*value == i);
+    }
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Push fails when the queue is full")
+{
+    SPSCQueue<int, 4> queue;
+    for (int round = 0; round < 3; ++round)
+    {
+        REQUIRE(queue.push(1));
+        REQUIRE(queue.push(2));
+        REQUIRE(queue.push(3));
+        REQUIRE(!queue.push(4));
+
+        REQUIRE(queue.pop() == 1);
+        REQUIRE(queue.push(4));
+        REQUIRE(queue.pop() == 2);
+        REQUIRE(queue.pop() == 3);
+        REQUIRE(queue.pop() == 4);
+        REQUIRE(queue.empty());
+    }
+}
+
+TEST_CASE("Elements are passed between threads")
+{
+    constexpr int Count = 100000;
+    SPSCQueue<int, 64> queue;
+
+    std::thread producer([&queue]()
+    {
+        for (int i = 0; i < Count;)
+        {
+            if (queue.push(i))
+                ++i;
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    int expected = 0;
+    while (expected < Count)
+    {
+        if (auto value = queue.pop(); value.has_value())
+        {
+            REQUIRE(*value == expected);
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    REQUIRE(queue.empty());
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <fstream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <celcompat/filesystem.h>
+#include <celengine/starname.h>
+
+#include <doctest.h>
+
+namespace
+{
+
+void
+writeUint(std::ofstream& out, std::uint32_t n)
+{
+    for (int i = 0; i < 4; ++i)
+        out.put(static_cast<char>((n >> (8 * i)) & 0xff));
+}
+
+void
+writeShort(std::ofstream& out, std::uint16_t n)
+{
+    out.put(static_cast<char>(n & 0xff));
+    out.put(static_cast<char>(n >> 8));
+}
+
+using Records = std::vector<std::pair<std::uint32_t, std::uint32_t>>;
+
+fs::path
+writeCrossIndex(const char* name,
+                std::uint16_t version,
+                const Records& records,
+                std::uint32_t toCount = 0,
+                std::uint32_t fromCount = 0)
+{
+    fs::path path = fs::temp_directory_path() / name;
+    std::ofstream out(path, std::ios::binary);
+    out.write("CELINDEX", 8);
+    writeShort(out, version);
+    if (version == 0x0200)
+    {
+        writeShort(out, 0);
+        writeUint(out, toCount);
+        writeUint(out, fromCount);
+    }
+
+    for (const auto& [catalogNumber, celCatalogNumber] : records)
+    {
+        writeUint(out, catalogNumber);
+        writeUint(out, celCatalogNumber);
+    }
+    return path;
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("StarNameDatabase");
+
+TEST_CASE("Sorted cross indexes match unsorted ones")
+{
+    // HD 10 appears twice, and HIP 7 has two HD numbers
+    fs::path unsortedPath = writeCrossIndex("celestia_xindex_v1.dat", 0x0100,
+                                            { { 30, 5 }, { 10, 9 }, { 20, 7 }, { 10, 8 }, { 40, 7 } });
+    fs::path sortedPath = writeCrossIndex("celestia_xindex_v2.dat", 0x0200,
+                                          { { 10, 8 }, { 20, 7 }, { 30, 5 }, { 40, 7 },
+                                            { 30, 5 }, { 20, 7 }, { 10, 8 }, { 10, 9 } },
+                                          4, 4);
+
+    StarNameDatabase unsorted;
+    REQUIRE(unsorted.loadCrossIndex(StarCatalog::HenryDraper, unsortedPath));
+    StarNameDatabase sorted;
+    REQUIRE(sorted.loadCrossIndex(StarCatalog::HenryDraper, sortedPath));
+
+    for (const StarNameDatabase* db : { &unsorted, &sorted })
+    {
+        REQUIRE(db->searchCrossIndexForCatalogNumber(StarCatalog::HenryDraper, 10) == 8);
+        REQUIRE(db->searchCrossIndexForCatalogNumber(StarCatalog::HenryDraper, 40) == 7);
+        REQUIRE(db->searchCrossIndexForCatalogNumber(StarCatalog::HenryDraper, 15) == AstroCatalog::InvalidIndex);
+        REQUIRE(db->crossIndex(StarCatalog::HenryDraper, 7) == 20);
+        REQUIRE(db->crossIndex(StarCatalog::HenryDraper, 5) == 30);
+        REQUIRE(db->crossIndex(StarCatalog::HenryDraper, 9) == 10);
+        REQUIRE(db->crossIndex(StarCatalog::HenryDraper, 6) == AstroCatalog::InvalidIndex);
+        REQUIRE(db->crossIndex(StarCatalog::SAO, 7) == AstroCatalog::InvalidIndex);
+    }
+
+    fs::remove(unsortedPath);
+    fs::remove(sortedPath);
+}
+
+TEST_CASE("Truncated sorted cross indexes are rejected")
+{
+    fs::path path = writeCrossIndex("celestia_xindex_short.dat", 0x0200, { { 10, 8 }, { 8, 10 } }, 1, 2);
+    StarNameDatabase db;
+    REQUIRE(!db.loadCrossIndex(StarCatalog::HenryDraper, path));
+    fs::remove(path);
+}
+
+TEST_SUITE_END();
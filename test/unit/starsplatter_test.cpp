@@ -0,0 +1,83 @@
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <celengine/starsplatter.h>
+#include <celutil/color.h>
+
+#include <doctest.h>
+
+using celestia::engine::StarSplatter;
+
+namespace
+{
+
+struct Splat
+{
+    Eigen::Vector3f position;
+    Color color;
+    float size;
+};
+
+std::vector<Splat>
+endFrame(StarSplatter& splatter)
+{
+    std::vector<Splat> splats;
+    splatter.end([&splats](const Eigen::Vector3f& position, const Color& color, float size)
+    {
+        splats.push_back(Splat{ position, color, size });
+    });
+    return splats;
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("StarSplatter");
+
+// With the identity matrix, x and y in [-1, 1] cover the window
+TEST_CASE("Stars in the same cell are merged")
+{
+    StarSplatter splatter;
+    splatter.begin(Eigen::Matrix4f::Identity(), 100, 100, 2);
+
+    REQUIRE(splatter.add(Eigen::Vector3f(0.001f, 0.001f, 0.0f), Color(1.0f, 0.0f, 0.0f, 0.25f), 5.0f));
+    REQUIRE(splatter.add(Eigen::Vector3f(0.002f, 0.002f, 0.0f), Color(0.0f, 0.0f, 1.0f, 0.5f), 5.0f));
+    REQUIRE(splatter.add(Eigen::Vector3f(0.5f, 0.5f, 0.0f), Color(1.0f, 1.0f, 1.0f, 0.1f), 4.0f));
+
+    // Outside of the window
+    REQUIRE(!splatter.add(Eigen::Vector3f(1.5f, 0.0f, 0.0f), Color(1.0f, 1.0f, 1.0f, 0.1f), 4.0f));
+
+    std::vector<Splat> splats = endFrame(splatter);
+    REQUIRE(splats.size() == 2);
+    REQUIRE(splatter.getMergedCount() == 1);
+
+    // Placed on the brightest star, with the summed brightness
+    const Splat& merged = splats[0];
+    REQUIRE(merged.position.isApprox(Eigen::Vector3f(0.002f, 0.002f, 0.0f)));
+    REQUIRE(merged.color.alpha() == doctest::Approx(0.75f).epsilon(0.01));
+    REQUIRE(merged.color.red() == doctest::Approx(1.0f / 3.0f).epsilon(0.02));
+    REQUIRE(merged.color.blue() == doctest::Approx(2.0f / 3.0f).epsilon(0.02));
+
+    // A lone star is unchanged
+    REQUIRE(splats[1].color.alpha() == doctest::Approx(0.1f).epsilon(0.05));
+    REQUIRE(splats[1].size == 4.0f);
+
+    // The cells are empty for the next frame
+    splatter.begin(Eigen::Matrix4f::Identity(), 100, 100, 2);
+    REQUIRE(endFrame(splatter).empty());
+}
+
+TEST_CASE("Merged brightness saturates")
+{
+    StarSplatter splatter;
+    splatter.begin(Eigen::Matrix4f::Identity(), 10, 10, 2);
+    for (int i = 0; i < 10; ++i)
+        REQUIRE(splatter.add(Eigen::Vector3f(0.01f, 0.01f, 0.0f), Color(1.0f, 1.0f, 1.0f, 0.5f), 5.0f));
+
+    std::vector<Splat> splats = endFrame(splatter);
+    REQUIRE(splats.size() == 1);
+    REQUIRE(splats[0].color.alpha() == 1.0f);
+    REQUIRE(splatter.getMergedCount() == 9);
+}
+
+TEST_SUITE_END();
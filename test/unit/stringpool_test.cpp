@@ -0,0 +1,59 @@
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <celutil/stringpool.h>
+
+#include <doctest.h>
+
+using celestia::util::StringPool;
+
+TEST_SUITE_BEGIN("StringPool");
+
+TEST_CASE("StringPool keeps null terminated copies")
+{
+    StringPool pool;
+    std::vector<std::string_view> views;
+    std::vector<std::string> strings;
+    for (int i = 0; i < 10000; ++i)
+    {
+        strings.push_back("HIP " + std::to_string(i));
+        views.push_back(pool.add(strings.back()));
+    }
+
+    // A string longer than a block
+    std::string longString(100000, 'x');
+    std::string_view longView = pool.add(longString);
+
+    StringPool moved = std::move(pool);
+    std::string_view last = moved.add("Sirius");
+
+    for (std::size_t i = 0; i < strings.size(); ++i)
+    {
+        REQUIRE(views[i] == strings[i]);
+        REQUIRE(std::strlen(views[i].data()) == strings[i].size());
+    }
+    REQUIRE(longView == longString);
+    REQUIRE(last == "Sirius");
+    REQUIRE(pool.add(std::string_view()).empty());
+}
+
+TEST_CASE("StringPool reuses its blocks after clear")
+{
+    StringPool pool;
+    for (int i = 0; i < 10000; ++i)
+        pool.add("HIP " + std::to_string(i));
+    pool.add(std::string(100000, 'x'));
+
+    std::size_t capacity = pool.capacity();
+    pool.clear();
+    REQUIRE(pool.capacity() == capacity - 100001);
+
+    std::size_t blocksCapacity = pool.capacity();
+    for (int i = 0; i < 10000; ++i)
+        REQUIRE(pool.add("HIP " + std::to_string(i)) == "HIP " + std::to_string(i));
+    REQUIRE(pool.capacity() == blocksCapacity);
+}
+
+TEST_SUITE_END();
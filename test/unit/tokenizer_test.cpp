@@ -518,4 +518,37 @@ TEST_CASE("Tokenizer skips comments")
     }
 }
 
+TEST_CASE("Tokenizer reads text in memory")
+{
+    std::string text = "\357\273\277Name = { Value -1.5e3 \"abc\" \"a\\nb\" } # comment\n"
+                       "Integer 42\n"
+                       ".";
+    Tokenizer tok(text);
+
+    REQUIRE(tok.nextToken() == Tokenizer::TokenName);
+    auto name = tok.getNameValue();
+    REQUIRE(name == "Name");
+    // Names are not copied
+    REQUIRE(name->data() == text.data() + 3);
+
+    REQUIRE(tok.nextToken() == Tokenizer::TokenEquals);
+    REQUIRE(tok.nextToken() == Tokenizer::TokenBeginGroup);
+    REQUIRE(tok.nextToken() == Tokenizer::TokenName);
+    REQUIRE(tok.nextToken() == Tokenizer::TokenNumber);
+    REQUIRE(tok.getNumberValue() == -1500.0);
+    REQUIRE(tok.nextToken() == Tokenizer::TokenString);
+    REQUIRE(tok.getStringValue() == "abc");
+    REQUIRE(tok.nextToken() == Tokenizer::TokenString);
+    REQUIRE(tok.getStringValue() == "a\nb");
+    REQUIRE(tok.nextToken() == Tokenizer::TokenEndGroup);
+
+    REQUIRE(tok.nextToken() == Tokenizer::TokenName);
+    REQUIRE(tok.getLineNumber() == 2);
+    REQUIRE(tok.nextToken() == Tokenizer::TokenNumber);
+    REQUIRE(tok.getIntegerValue() == 42);
+
+    // A decimal point at the end of the text must be followed by a digit
+    REQUIRE(tok.nextToken() == Tokenizer::TokenError);
+}
+
 TEST_SUITE_END();
@@ -0,0 +1,80 @@
+#include <cstdint>
+#include <random>
+
+#include <Eigen/Core>
+
+#include <celengine/univcoord.h>
+
+#include <doctest.h>
+
+using celestia::util::AddInline;
+using celestia::util::DifferenceToDouble;
+using celestia::util::SubtractInline;
+using celestia::util::ToDoubleInline;
+
+namespace
+{
+
+R128
+randomR128(std::mt19937_64& gen)
+{
+    // Mostly coordinates within the simulated volume, with some values
+    // that cross the carry boundaries
+    std::uint64_t lo = gen();
+    std::uint64_t hi = gen();
+    switch (gen() % 4)
+    {
+    case 0:
+        return R128(lo, hi >> 2);
+    case 1:
+        return R128(lo, ~(hi >> 2));
+    case 2:
+        return R128(~static_cast<std::uint64_t>(0), hi);
+    default:
+        return R128(0, hi);
+    }
+}
+
+} // end unnamed namespace
+
+TEST_SUITE_BEGIN("UniversalCoord");
+
+TEST_CASE("Inline R128 arithmetic matches the R128 operators")
+{
+    std::mt19937_64 gen(7);
+    for (int i = 0; i < 10000; ++i)
+    {
+        R128 a = randomR128(gen);
+        R128 b = randomR128(gen);
+
+        R128 sum = a + b;
+        R128 inlineSum = AddInline(a, b);
+        REQUIRE(inlineSum.lo == sum.lo);
+        REQUIRE(inlineSum.hi == sum.hi);
+
+        R128 difference = a - b;
+        R128 inlineDifference = SubtractInline(a, b);
+        REQUIRE(inlineDifference.lo == difference.lo);
+        REQUIRE(inlineDifference.hi == difference.hi);
+
+        REQUIRE(ToDoubleInline(a) == static_cast<double>(a));
+        REQUIRE(DifferenceToDouble(a, b) == static_cast<double>(a - b));
+    }
+
+    REQUIRE(ToDoubleInline(R128(0, static_cast<std::uint64_t>(1) << 63)) == -9223372036854775808.0);
+}
+
+TEST_CASE("UniversalCoord offsets")
+{
+    UniversalCoord a = UniversalCoord::CreateLy(Eigen::Vector3d(1000.0, -20.0, 3.5));
+    UniversalCoord b = a.offsetKm(Eigen::Vector3d(1.0e6, -2.5e5, 0.125));
+
+    Eigen::Vector3d offset = b.offsetFromKm(a);
+    REQUIRE(offset.x() == doctest::Approx(1.0e6));
+    REQUIRE(offset.y() == doctest::Approx(-2.5e5));
+    REQUIRE(offset.z() == doctest::Approx(0.125).epsilon(1e-6));
+    REQUIRE(a.offsetFromKm(b) == -offset);
+    REQUIRE((b - a).offsetFromKm(UniversalCoord::Zero()) == offset);
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,54 @@
+#include <chrono>
+
+#include <celutil/uploadbudget.h>
+
+#include <doctest.h>
+
+using celestia::util::UploadBudget;
+
+TEST_SUITE_BEGIN("UploadBudget");
+
+TEST_CASE("Byte limit")
+{
+    UploadBudget budget(100, UploadBudget::Clock::duration::zero());
+    REQUIRE(budget.allows(UploadBudget::Priority::Visible));
+    REQUIRE(budget.allows(UploadBudget::Priority::Prefetch));
+
+    // The first upload of a frame is done whatever its size
+    budget.charge(60, UploadBudget::Clock::duration::zero());
+    REQUIRE(budget.allows(UploadBudget::Priority::Visible));
+    REQUIRE(!budget.allows(UploadBudget::Priority::Prefetch));
+
+    budget.charge(60, UploadBudget::Clock::duration::zero());
+    REQUIRE(!budget.allows(UploadBudget::Priority::Visible));
+    REQUIRE(budget.getUploadedBytes() == 120);
+    REQUIRE(budget.getUploadCount() == 2);
+
+    budget.defer();
+    REQUIRE(budget.getDeferredCount() == 1);
+
+    budget.beginFrame();
+    REQUIRE(budget.allows(UploadBudget::Priority::Prefetch));
+    REQUIRE(budget.getUploadedBytes() == 0);
+    REQUIRE(budget.getDeferredCount() == 0);
+}
+
+TEST_CASE("Time limit")
+{
+    UploadBudget budget(0, std::chrono::milliseconds(4));
+    budget.charge(1000000, std::chrono::milliseconds(1));
+    REQUIRE(budget.allows(UploadBudget::Priority::Visible));
+    REQUIRE(budget.allows(UploadBudget::Priority::Prefetch));
+
+    budget.charge(1000000, std::chrono::milliseconds(2));
+    REQUIRE(budget.allows(UploadBudget::Priority::Visible));
+    REQUIRE(!budget.allows(UploadBudget::Priority::Prefetch));
+
+    budget.charge(1000000, std::chrono::milliseconds(2));
+    REQUIRE(!budget.allows(UploadBudget::Priority::Visible));
+
+    budget.setLimits(0, UploadBudget::Clock::duration::zero());
+    REQUIRE(budget.allows(UploadBudget::Priority::Prefetch));
+}
+
+TEST_SUITE_END();
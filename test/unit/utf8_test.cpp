@@ -0,0 +1,63 @@
+#include <string>
+
+#include <celutil/stringutils.h>
+#include <celutil/utf8.h>
+
+#include <doctest.h>
+
+TEST_SUITE_BEGIN("UTF8");
+
+TEST_CASE("UTF8StringCompare")
+{
+    REQUIRE(UTF8StringCompare("Alpha Centauri", "alpha centauri") == 0);
+    REQUIRE(UTF8StringCompare("Alpha Centauri A", "Alpha Centauri B") == -1);
+    REQUIRE(UTF8StringCompare("Alpha Centauri B", "alpha centauri a") == 1);
+    REQUIRE(UTF8StringCompare("Alpha Centauri", "Alpha Centauri A") == -1);
+    REQUIRE(UTF8StringCompare("Alpha Centauri A", "Alpha Centauri") == 1);
+    REQUIRE(UTF8StringCompare("", "") == 0);
+
+    // Accented letters are normalized, also after an ASCII prefix
+    REQUIRE(UTF8StringCompare("Proxima T\303\251", "proxima te") == 0);
+    REQUIRE(UTF8StringCompare("\303\211psilon", "epsilon") == 0);
+    REQUIRE(UTF8StringCompare("Proxima T\303\251a", "proxima teb") == -1);
+}
+
+TEST_CASE("UTF8StartsWith")
+{
+    REQUIRE(UTF8StartsWith("Alpha Centauri", "Alpha Cen"));
+    REQUIRE(UTF8StartsWith("Alpha Centauri", "alpha cen"));
+    REQUIRE(UTF8StartsWith("Alpha Centauri", "ALPHA CEN", true));
+    REQUIRE(!UTF8StartsWith("Alpha Centauri", "Alpha Cex"));
+    REQUIRE(!UTF8StartsWith("Alpha", "Alpha Centauri"));
+}
+
+TEST_CASE("UTF8FoldCase")
+{
+    std::string folded;
+    REQUIRE(UTF8FoldCase("Alpha CENTAURI \303\211", folded));
+    REQUIRE(folded == "alpha centauri e");
+
+    folded.clear();
+    REQUIRE(!UTF8FoldCase("Alpha\377", folded));
+}
+
+TEST_CASE("UTF8IsASCII")
+{
+    REQUIRE(UTF8IsASCII(""));
+    REQUIRE(UTF8IsASCII("Alpha Centauri"));
+    REQUIRE(!UTF8IsASCII("Alpha Centauri \303\211"));
+    REQUIRE(!UTF8IsASCII("\303\211"));
+}
+
+TEST_CASE("compareIgnoringCase")
+{
+    REQUIRE(compareIgnoringCase("Alpha Centauri", "ALPHA CENTAURI") == 0);
+    REQUIRE(compareIgnoringCase("Alpha Centauri A", "alpha centauri b") < 0);
+    REQUIRE(compareIgnoringCase("Alpha Centauri", "alpha centaur") > 0);
+    REQUIRE(compareIgnoringCase("Alpha Centauri A", "alpha centauri b", 14) == 0);
+    REQUIRE(compareIgnoringCase("Alpha", "alpha centauri", 5) == 0);
+    REQUIRE(compareIgnoringCase("Alpha", "alpha centauri", 6) < 0);
+    REQUIRE(compareIgnoringCase("\303\211", "\303\251") != 0);
+}
+
+TEST_SUITE_END();